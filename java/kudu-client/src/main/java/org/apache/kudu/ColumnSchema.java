@@ -64,7 +64,9 @@ public class ColumnSchema {
     GROUP_VARINT(EncodingType.GROUP_VARINT),
     RLE(EncodingType.RLE),
     DICT_ENCODING(EncodingType.DICT_ENCODING),
-    BIT_SHUFFLE(EncodingType.BIT_SHUFFLE);
+    BIT_SHUFFLE(EncodingType.BIT_SHUFFLE),
+    FOR_DELTA(EncodingType.FOR_DELTA),
+    FSST_ENCODING(EncodingType.FSST_ENCODING);
 
     final EncodingType internalPbType;
 
@@ -89,7 +91,8 @@ public class ColumnSchema {
     NO_COMPRESSION(CompressionType.NO_COMPRESSION),
     SNAPPY(CompressionType.SNAPPY),
     LZ4(CompressionType.LZ4),
-    ZLIB(CompressionType.ZLIB);
+    ZLIB(CompressionType.ZLIB),
+    ZSTD(CompressionType.ZSTD);
 
     final CompressionType internalPbType;
 
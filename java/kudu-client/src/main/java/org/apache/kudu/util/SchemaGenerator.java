@@ -214,7 +214,8 @@ public class SchemaGenerator {
             Encoding.AUTO_ENCODING,
             Encoding.PLAIN_ENCODING,
             Encoding.BIT_SHUFFLE,
-            Encoding.RLE));
+            Encoding.RLE,
+            Encoding.FOR_DELTA));
         break;
       case FLOAT:
       case DOUBLE:
@@ -231,7 +232,8 @@ public class SchemaGenerator {
             Encoding.AUTO_ENCODING,
             Encoding.PLAIN_ENCODING,
             Encoding.PREFIX_ENCODING,
-            Encoding.DICT_ENCODING));
+            Encoding.DICT_ENCODING,
+            Encoding.FSST_ENCODING));
         break;
       case BOOL:
         validEncodings.retainAll(Arrays.asList(
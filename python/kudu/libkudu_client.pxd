@@ -135,6 +135,8 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         EncodingType_BIT_SHUFFLE " kudu::client::KuduColumnStorageAttributes::BIT_SHUFFLE"
         EncodingType_RLE " kudu::client::KuduColumnStorageAttributes::RLE"
         EncodingType_DICT " kudu::client::KuduColumnStorageAttributes::DICT_ENCODING"
+        EncodingType_FOR_DELTA " kudu::client::KuduColumnStorageAttributes::FOR_DELTA"
+        EncodingType_FSST " kudu::client::KuduColumnStorageAttributes::FSST_ENCODING"
 
     enum CompressionType" kudu::client::KuduColumnStorageAttributes::CompressionType":
         CompressionType_DEFAULT " kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION"
@@ -142,6 +144,7 @@ cdef extern from "kudu/client/schema.h" namespace "kudu::client" nogil:
         CompressionType_SNAPPY " kudu::client::KuduColumnStorageAttributes::SNAPPY"
         CompressionType_LZ4 " kudu::client::KuduColumnStorageAttributes::LZ4"
         CompressionType_ZLIB " kudu::client::KuduColumnStorageAttributes::ZLIB"
+        CompressionType_ZSTD " kudu::client::KuduColumnStorageAttributes::ZSTD"
 
     cdef struct KuduColumnStorageAttributes:
         KuduColumnStorageAttributes()
@@ -62,6 +62,7 @@ COMPRESSION_NONE = CompressionType_NONE
 COMPRESSION_SNAPPY = CompressionType_SNAPPY
 COMPRESSION_LZ4 = CompressionType_LZ4
 COMPRESSION_ZLIB = CompressionType_ZLIB
+COMPRESSION_ZSTD = CompressionType_ZSTD
 
 cdef dict _compression_types = {
     'default': COMPRESSION_DEFAULT,
@@ -69,6 +70,7 @@ cdef dict _compression_types = {
     'snappy': COMPRESSION_SNAPPY,
     'lz4': COMPRESSION_LZ4,
     'zlib': COMPRESSION_ZLIB,
+    'zstd': COMPRESSION_ZSTD,
 }
 
 cdef dict _compression_type_to_name = _reverse_dict(_compression_types)
@@ -81,6 +83,8 @@ ENCODING_PREFIX = EncodingType_PREFIX
 ENCODING_BIT_SHUFFLE = EncodingType_BIT_SHUFFLE
 ENCODING_RLE = EncodingType_RLE
 ENCODING_DICT = EncodingType_DICT
+ENCODING_FOR_DELTA = EncodingType_FOR_DELTA
+ENCODING_FSST = EncodingType_FSST
 
 cdef dict _encoding_types = {
     'auto': ENCODING_AUTO,
@@ -89,6 +93,8 @@ cdef dict _encoding_types = {
     'bitshuffle': ENCODING_BIT_SHUFFLE,
     'rle': ENCODING_RLE,
     'dict': ENCODING_DICT,
+    'for_delta': ENCODING_FOR_DELTA,
+    'fsst': ENCODING_FSST,
 }
 
 cdef dict _encoding_type_to_name = _reverse_dict(_encoding_types)
@@ -0,0 +1,646 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Macro benchmark suite of standard write and scan scenarios run directly
+// against a local tablet, without consensus or RPC:
+//
+//   ycsb-a .. ycsb-f  The YCSB core workloads: A (50% reads, 50% updates),
+//                     B (95% reads, 5% updates), C (reads only), D (95% reads
+//                     of the latest rows, 5% inserts), E (95% short range
+//                     scans, 5% inserts) and F (50% reads, 50%
+//                     read-modify-writes). Keys are chosen with a skewed
+//                     distribution, as with YCSB's zipfian distribution.
+//   timeseries        Appends of metrics from a number of hosts, followed by
+//                     range scans of time windows of single hosts.
+//   wide              Scans of projections of 1, 10 and all of the columns of
+//                     a wide table.
+//   heavy_update      Full scans of a table whose rows were updated a number
+//                     of times, before and after a major delta compaction.
+//
+// The workloads are single-threaded and seeded, so that the operations are
+// the same from run to run. The results are written as JSON, with the
+// workloads and their operations in a fixed order so that the results of
+// two builds can be diffed.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row_operations.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
+#include "kudu/common/scan_spec.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-harness.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/env.h"
+#include "kudu/util/env_util.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/random.h"
+#include "kudu/util/status.h"
+#include "kudu/util/version_info.h"
+
+DEFINE_string(workloads, "ycsb-a,ycsb-b,ycsb-c,ycsb-d,ycsb-e,ycsb-f,timeseries,wide,heavy_update",
+              "Comma-separated list of the workloads to run");
+DEFINE_int64(num_rows, 100000,
+             "Number of rows loaded into the tablet of each workload before "
+             "its operations are run");
+DEFINE_int64(num_ops, 100000,
+             "Number of operations run by each of the YCSB workloads");
+DEFINE_int32(ycsb_field_length, 100,
+             "Length of each of the 10 string fields of the rows of the YCSB workloads");
+DEFINE_int32(ycsb_max_scan_length, 100,
+             "Maximum number of rows read by the scans of the YCSB E workload");
+DEFINE_int32(timeseries_num_hosts, 10,
+             "Number of hosts whose metrics are appended by the timeseries workload");
+DEFINE_int32(timeseries_num_scans, 1000,
+             "Number of range scans of the timeseries workload");
+DEFINE_double(timeseries_scan_window, 0.01,
+              "Fraction of each host's time range read by the scans of "
+              "the timeseries workload");
+DEFINE_int32(wide_num_columns, 100,
+             "Number of non-key columns of the table of the wide workload");
+DEFINE_int32(num_scans, 5,
+             "Number of times each scan of the wide and heavy_update workloads is run");
+DEFINE_int32(heavy_update_passes, 5,
+             "Number of times each row is updated by the heavy_update workload. "
+             "The delta memory stores are flushed after each pass.");
+DEFINE_bool(flush_after_load, true,
+            "Whether to flush the loaded rows to disk before running a workload's "
+            "operations, rather than running them against the MemRowSet");
+DEFINE_uint32(seed, 1, "Seed of the random number generator of the workloads");
+DEFINE_string(data_dir, "",
+              "Directory under which the tablets are created. Defaults to a "
+              "subdirectory of the test directory.");
+DEFINE_string(output_file, "",
+              "File to which the JSON results are written. If empty, they are "
+              "written to stdout.");
+
+using kudu::tablet::LocalTabletWriter;
+using kudu::tablet::Tablet;
+using kudu::tablet::TabletHarness;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+constexpr int kYcsbNumFields = 10;
+
+// Scatters the keys picked with a skewed distribution, so that the hot keys
+// aren't all adjacent.
+int64_t ScatterKey(uint64_t k, int64_t n) {
+  return static_cast<int64_t>((k * 0x9E3779B97F4A7C15ULL) % static_cast<uint64_t>(n));
+}
+
+// Returns a key in [0, n), skewed towards a small set of hot keys.
+int64_t SkewedKey(Random* r, int64_t n) {
+  const int max_log = std::min(Bits::Log2Floor64(n), 31);
+  return ScatterKey(r->Skewed(max_log), n);
+}
+
+// Returns a key in [0, n), skewed towards the latest keys.
+int64_t LatestKey(Random* r, int64_t n) {
+  const int max_log = std::min(Bits::Log2Floor64(n), 31);
+  return n - 1 - std::min<int64_t>(r->Skewed(max_log), n - 1);
+}
+
+// The latencies of an operation of a workload.
+class OpStats {
+ public:
+  explicit OpStats(string name)
+      : name_(std::move(name)),
+        // Track latencies of up to 100 seconds, with 3 significant digits.
+        hist_(100 * 1000 * 1000, 3) {
+  }
+
+  void Record(const MonoTime& start) {
+    hist_.Increment((MonoTime::Now() - start).ToMicroseconds());
+  }
+
+  void ToJson(JsonWriter* jw) const {
+    jw->StartObject();
+    jw->String("op");
+    jw->String(name_);
+    jw->String("count");
+    jw->Int64(hist_.TotalCount());
+    jw->String("mean_us");
+    jw->Double(hist_.MeanValue());
+    jw->String("p50_us");
+    jw->Uint64(hist_.ValueAtPercentile(50));
+    jw->String("p99_us");
+    jw->Uint64(hist_.ValueAtPercentile(99));
+    jw->String("p999_us");
+    jw->Uint64(hist_.ValueAtPercentile(99.9));
+    jw->String("max_us");
+    jw->Uint64(hist_.MaxValue());
+    jw->EndObject();
+  }
+
+ private:
+  const string name_;
+  HdrHistogram hist_;
+};
+
+// The results of a workload.
+struct WorkloadResult {
+  string workload;
+  int64_t load_rows = 0;
+  double load_rows_per_sec = 0;
+  int64_t ops = 0;
+  double ops_per_sec = 0;
+  // Only set for the workloads measuring scan throughput.
+  vector<std::pair<string, double>> scan_rows_per_sec;
+  vector<unique_ptr<OpStats>> op_stats;
+
+  OpStats* AddOp(const string& name) {
+    op_stats.emplace_back(new OpStats(name));
+    return op_stats.back().get();
+  }
+
+  void ToJson(JsonWriter* jw) const {
+    jw->StartObject();
+    jw->String("workload");
+    jw->String(workload);
+    jw->String("load_rows");
+    jw->Int64(load_rows);
+    jw->String("load_rows_per_sec");
+    jw->Double(load_rows_per_sec);
+    jw->String("ops");
+    jw->Int64(ops);
+    jw->String("ops_per_sec");
+    jw->Double(ops_per_sec);
+    jw->String("scans");
+    jw->StartObject();
+    for (const auto& s : scan_rows_per_sec) {
+      jw->String(s.first);
+      jw->Double(s.second);
+    }
+    jw->EndObject();
+    jw->String("latencies");
+    jw->StartArray();
+    for (const auto& s : op_stats) {
+      s->ToJson(jw);
+    }
+    jw->EndArray();
+    jw->EndObject();
+  }
+};
+
+// A tablet created for a workload, and a writer to it.
+class BenchTablet {
+ public:
+  BenchTablet(const Schema& client_schema, string root_dir)
+      : client_schema_(client_schema),
+        harness_(SchemaBuilder(client_schema).Build(),
+                 TabletHarness::Options(std::move(root_dir))) {
+  }
+
+  Status Open() {
+    RETURN_NOT_OK(harness_.Create(/*first_time=*/true));
+    RETURN_NOT_OK(harness_.Open());
+    writer_.reset(new LocalTabletWriter(tablet(), &client_schema_));
+    return Status::OK();
+  }
+
+  Tablet* tablet() { return harness_.mutable_tablet(); }
+  LocalTabletWriter* writer() { return writer_.get(); }
+  const Schema& client_schema() const { return client_schema_; }
+
+  // Scans the rows matching 'spec', returning the number of rows in 'rows'.
+  // If 'spec' is null, all of the rows are scanned.
+  Status Scan(const Schema& projection, ScanSpec* spec, int64_t* rows) {
+    if (spec) {
+      Arena arena(1024);
+      spec->OptimizeScan(*tablet()->schema(), &arena, true);
+    }
+    unique_ptr<RowwiseIterator> iter;
+    RETURN_NOT_OK(tablet()->NewRowIterator(projection, &iter));
+    RETURN_NOT_OK(iter->Init(spec));
+    RowBlockMemory mem(32 * 1024);
+    RowBlock block(&iter->schema(), 1024, &mem);
+    int64_t n = 0;
+    while (iter->HasNext()) {
+      mem.Reset();
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      n += block.selection_vector()->CountSelected();
+    }
+    *rows = n;
+    return Status::OK();
+  }
+
+ private:
+  const Schema client_schema_;
+  TabletHarness harness_;
+  unique_ptr<LocalTabletWriter> writer_;
+};
+
+double PerSec(int64_t n, const MonoTime& start) {
+  return n / std::max((MonoTime::Now() - start).ToSeconds(), 1e-9);
+}
+
+string RandomString(Random* r, int len) {
+  string s(len, 'a');
+  for (auto& c : s) {
+    c = 'a' + r->Uniform(26);
+  }
+  return s;
+}
+
+class TabletBench {
+ public:
+  TabletBench() : rng_(FLAGS_seed) {}
+
+  Status Init() {
+    root_dir_ = FLAGS_data_dir;
+    if (root_dir_.empty()) {
+      RETURN_NOT_OK(Env::Default()->GetTestDirectory(&root_dir_));
+      root_dir_ = JoinPathSegments(root_dir_, "tablet_bench");
+    }
+    RETURN_NOT_OK(env_util::CreateDirIfMissing(Env::Default(), root_dir_));
+    return Status::OK();
+  }
+
+  Status Run(const string& workload, WorkloadResult* result) {
+    result->workload = workload;
+    // Each workload gets a fresh tablet, and the same random choices from
+    // run to run.
+    rng_.Reset(FLAGS_seed);
+    const string dir = JoinPathSegments(root_dir_, workload);
+    if (Env::Default()->FileExists(dir)) {
+      RETURN_NOT_OK(Env::Default()->DeleteRecursively(dir));
+    }
+    if (workload.size() == 6 && HasPrefixString(workload, "ycsb-")) {
+      return RunYcsb(workload.back(), dir, result);
+    }
+    if (workload == "timeseries") {
+      return RunTimeSeries(dir, result);
+    }
+    if (workload == "wide") {
+      return RunWide(dir, result);
+    }
+    if (workload == "heavy_update") {
+      return RunHeavyUpdate(dir, result);
+    }
+    return Status::InvalidArgument("unknown workload", workload);
+  }
+
+ private:
+  static Schema YcsbSchema() {
+    vector<ColumnSchema> cols = { ColumnSchema("key", INT64) };
+    for (int i = 0; i < kYcsbNumFields; i++) {
+      cols.emplace_back(Substitute("field$0", i), STRING);
+    }
+    return Schema(cols, 1);
+  }
+
+  Status YcsbWrite(BenchTablet* t, RowOperationsPB::Type type, int64_t key, bool all_fields) {
+    KuduPartialRow row(&t->client_schema());
+    RETURN_NOT_OK(row.SetInt64(0, key));
+    if (all_fields) {
+      for (int i = 0; i < kYcsbNumFields; i++) {
+        RETURN_NOT_OK(row.SetStringCopy(i + 1, RandomString(&rng_, FLAGS_ycsb_field_length)));
+      }
+    } else {
+      // As with YCSB, updates write a single field.
+      RETURN_NOT_OK(row.SetStringCopy(1 + rng_.Uniform(kYcsbNumFields),
+                                      RandomString(&rng_, FLAGS_ycsb_field_length)));
+    }
+    return t->writer()->Write(type, row);
+  }
+
+  // Reads 'len' rows starting at 'key'.
+  static Status YcsbRead(BenchTablet* t, int64_t key, int64_t len) {
+    const Schema& schema = *t->tablet()->schema();
+    const int64_t upper = key + len;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema.column(0), &key, &upper));
+    int64_t rows;
+    return t->Scan(t->client_schema(), &spec, &rows);
+  }
+
+  Status Load(BenchTablet* t, int64_t num_rows, WorkloadResult* result,
+              const std::function<Status(int64_t)>& insert_row) {
+    const MonoTime start = MonoTime::Now();
+    for (int64_t i = 0; i < num_rows; i++) {
+      RETURN_NOT_OK(insert_row(i));
+    }
+    if (FLAGS_flush_after_load) {
+      RETURN_NOT_OK(t->tablet()->Flush());
+    }
+    result->load_rows = num_rows;
+    result->load_rows_per_sec = PerSec(num_rows, start);
+    return Status::OK();
+  }
+
+  Status RunYcsb(char mix, const string& dir, WorkloadResult* result) {
+    BenchTablet t(YcsbSchema(), dir);
+    RETURN_NOT_OK(t.Open());
+    RETURN_NOT_OK(Load(&t, FLAGS_num_rows, result, [&](int64_t i) {
+      return YcsbWrite(&t, RowOperationsPB::INSERT, i, /*all_fields=*/true);
+    }));
+
+    // The percentage of reads (or scans, for E) of the mix. The remaining
+    // operations are updates, inserts or read-modify-writes.
+    int read_pct;
+    switch (mix) {
+      case 'a': read_pct = 50; break;
+      case 'b': read_pct = 95; break;
+      case 'c': read_pct = 100; break;
+      case 'd': read_pct = 95; break;
+      case 'e': read_pct = 95; break;
+      case 'f': read_pct = 50; break;
+      default: return Status::InvalidArgument("unknown YCSB workload", string(1, mix));
+    }
+    OpStats* reads = result->AddOp(mix == 'e' ? "scan" : "read");
+    OpStats* writes = nullptr;
+    if (read_pct < 100) {
+      switch (mix) {
+        case 'd': case 'e': writes = result->AddOp("insert"); break;
+        case 'f': writes = result->AddOp("read_modify_write"); break;
+        default: writes = result->AddOp("update"); break;
+      }
+    }
+
+    int64_t num_keys = FLAGS_num_rows;
+    const MonoTime start = MonoTime::Now();
+    for (int64_t i = 0; i < FLAGS_num_ops; i++) {
+      const MonoTime op_start = MonoTime::Now();
+      if (rng_.Uniform(100) < read_pct) {
+        switch (mix) {
+          case 'd':
+            // Reads of the latest rows.
+            RETURN_NOT_OK(YcsbRead(&t, LatestKey(&rng_, num_keys), 1));
+            break;
+          case 'e':
+            RETURN_NOT_OK(YcsbRead(&t, SkewedKey(&rng_, num_keys),
+                                   1 + rng_.Uniform(FLAGS_ycsb_max_scan_length)));
+            break;
+          default:
+            RETURN_NOT_OK(YcsbRead(&t, SkewedKey(&rng_, num_keys), 1));
+            break;
+        }
+        reads->Record(op_start);
+      } else {
+        switch (mix) {
+          case 'd': case 'e':
+            RETURN_NOT_OK(YcsbWrite(&t, RowOperationsPB::INSERT, num_keys++,
+                                    /*all_fields=*/true));
+            break;
+          case 'f': {
+            const int64_t key = SkewedKey(&rng_, num_keys);
+            RETURN_NOT_OK(YcsbRead(&t, key, 1));
+            RETURN_NOT_OK(YcsbWrite(&t, RowOperationsPB::UPDATE, key, /*all_fields=*/false));
+            break;
+          }
+          default:
+            RETURN_NOT_OK(YcsbWrite(&t, RowOperationsPB::UPDATE, SkewedKey(&rng_, num_keys),
+                                    /*all_fields=*/false));
+            break;
+        }
+        writes->Record(op_start);
+      }
+    }
+    result->ops = FLAGS_num_ops;
+    result->ops_per_sec = PerSec(FLAGS_num_ops, start);
+    return Status::OK();
+  }
+
+  Status RunTimeSeries(const string& dir, WorkloadResult* result) {
+    BenchTablet t(Schema({ ColumnSchema("host", STRING),
+                           ColumnSchema("ts", INT64),
+                           ColumnSchema("value", DOUBLE) }, 2), dir);
+    RETURN_NOT_OK(t.Open());
+    const int num_hosts = std::max(FLAGS_timeseries_num_hosts, 1);
+    const int64_t points_per_host = std::max<int64_t>(FLAGS_num_rows / num_hosts, 1);
+    vector<string> hosts;
+    for (int i = 0; i < num_hosts; i++) {
+      hosts.emplace_back(Substitute("host-$0", i));
+    }
+
+    // The metrics of all of the hosts are appended in time order, one
+    // point per host per second.
+    OpStats* appends = result->AddOp("append");
+    RETURN_NOT_OK(Load(&t, points_per_host * num_hosts, result, [&](int64_t i) {
+      const MonoTime op_start = MonoTime::Now();
+      KuduPartialRow row(&t.client_schema());
+      RETURN_NOT_OK(row.SetStringCopy(0, hosts[i % num_hosts]));
+      RETURN_NOT_OK(row.SetInt64(1, (i / num_hosts) * 1000000));
+      RETURN_NOT_OK(row.SetDouble(2, rng_.NextDoubleFraction()));
+      RETURN_NOT_OK(t.writer()->Insert(row));
+      appends->Record(op_start);
+      return Status::OK();
+    }));
+
+    const Schema& schema = *t.tablet()->schema();
+    const int64_t window = std::max<int64_t>(
+        points_per_host * FLAGS_timeseries_scan_window, 1) * 1000000;
+    OpStats* scans = result->AddOp("range_scan");
+    int64_t rows_scanned = 0;
+    const MonoTime start = MonoTime::Now();
+    for (int i = 0; i < FLAGS_timeseries_num_scans; i++) {
+      const MonoTime op_start = MonoTime::Now();
+      const Slice host(hosts[rng_.Uniform(num_hosts)]);
+      const int64_t lower = rng_.Uniform64(points_per_host) * 1000000;
+      const int64_t upper = lower + window;
+      ScanSpec spec;
+      spec.AddPredicate(ColumnPredicate::Equality(schema.column(0), &host));
+      spec.AddPredicate(ColumnPredicate::Range(schema.column(1), &lower, &upper));
+      int64_t rows;
+      RETURN_NOT_OK(t.Scan(t.client_schema(), &spec, &rows));
+      rows_scanned += rows;
+      scans->Record(op_start);
+    }
+    result->ops = FLAGS_timeseries_num_scans;
+    result->ops_per_sec = PerSec(FLAGS_timeseries_num_scans, start);
+    result->scan_rows_per_sec.emplace_back("range_scan", PerSec(rows_scanned, start));
+    return Status::OK();
+  }
+
+  // Runs --num_scans full scans of 'projection', recording their throughput
+  // as 'name'.
+  static Status TimeScans(BenchTablet* t, const string& name, const Schema& projection,
+                          WorkloadResult* result) {
+    OpStats* scans = result->AddOp(name);
+    int64_t rows_scanned = 0;
+    const MonoTime start = MonoTime::Now();
+    for (int i = 0; i < FLAGS_num_scans; i++) {
+      const MonoTime op_start = MonoTime::Now();
+      int64_t rows;
+      RETURN_NOT_OK(t->Scan(projection, nullptr, &rows));
+      rows_scanned += rows;
+      scans->Record(op_start);
+    }
+    result->ops += FLAGS_num_scans;
+    result->scan_rows_per_sec.emplace_back(name, PerSec(rows_scanned, start));
+    return Status::OK();
+  }
+
+  Status RunWide(const string& dir, WorkloadResult* result) {
+    vector<ColumnSchema> cols = { ColumnSchema("key", INT64) };
+    for (int i = 0; i < FLAGS_wide_num_columns; i++) {
+      cols.emplace_back(Substitute("c$0", i), INT64);
+    }
+    BenchTablet t(Schema(cols, 1), dir);
+    RETURN_NOT_OK(t.Open());
+    RETURN_NOT_OK(Load(&t, FLAGS_num_rows, result, [&](int64_t i) {
+      KuduPartialRow row(&t.client_schema());
+      RETURN_NOT_OK(row.SetInt64(0, i));
+      for (int c = 1; c <= FLAGS_wide_num_columns; c++) {
+        // A mix of low and high cardinality columns.
+        RETURN_NOT_OK(row.SetInt64(c, c % 2 ? rng_.Uniform(16) : rng_.Next64()));
+      }
+      return t.writer()->Insert(row);
+    }));
+
+    const MonoTime start = MonoTime::Now();
+    for (const int n : { 1, 10, FLAGS_wide_num_columns }) {
+      if (n > FLAGS_wide_num_columns) {
+        continue;
+      }
+      vector<ColumnSchema> proj_cols(cols.begin() + 1, cols.begin() + 1 + n);
+      RETURN_NOT_OK(TimeScans(&t, Substitute("scan_$0_columns", n),
+                              Schema(proj_cols, 0), result));
+    }
+    result->ops_per_sec = PerSec(result->ops, start);
+    return Status::OK();
+  }
+
+  Status RunHeavyUpdate(const string& dir, WorkloadResult* result) {
+    BenchTablet t(Schema({ ColumnSchema("key", INT64),
+                           ColumnSchema("v0", INT64),
+                           ColumnSchema("v1", INT64) }, 1), dir);
+    RETURN_NOT_OK(t.Open());
+    RETURN_NOT_OK(Load(&t, FLAGS_num_rows, result, [&](int64_t i) {
+      KuduPartialRow row(&t.client_schema());
+      RETURN_NOT_OK(row.SetInt64(0, i));
+      RETURN_NOT_OK(row.SetInt64(1, 0));
+      RETURN_NOT_OK(row.SetInt64(2, 0));
+      return t.writer()->Insert(row);
+    }));
+
+    OpStats* updates = result->AddOp("update");
+    for (int pass = 1; pass <= FLAGS_heavy_update_passes; pass++) {
+      for (int64_t i = 0; i < FLAGS_num_rows; i++) {
+        const MonoTime op_start = MonoTime::Now();
+        KuduPartialRow row(&t.client_schema());
+        RETURN_NOT_OK(row.SetInt64(0, i));
+        RETURN_NOT_OK(row.SetInt64(1 + (i + pass) % 2, pass));
+        RETURN_NOT_OK(t.writer()->Update(row));
+        updates->Record(op_start);
+      }
+      RETURN_NOT_OK(t.tablet()->FlushAllDMSForTests());
+    }
+
+    const MonoTime start = MonoTime::Now();
+    const Schema projection = t.client_schema();
+    RETURN_NOT_OK(TimeScans(&t, "scan_with_deltas", projection, result));
+    RETURN_NOT_OK(t.tablet()->MajorCompactAllDeltaStoresForTests());
+    RETURN_NOT_OK(TimeScans(&t, "scan_after_major_delta_compaction", projection, result));
+    result->ops_per_sec = PerSec(result->ops, start);
+    return Status::OK();
+  }
+
+  Random rng_;
+  string root_dir_;
+};
+
+Status RunBenchmarks() {
+  TabletBench bench;
+  RETURN_NOT_OK(bench.Init());
+
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::PRETTY);
+  jw.StartObject();
+  jw.String("version");
+  jw.String(VersionInfo::GetShortVersionInfo());
+  jw.String("config");
+  jw.StartObject();
+  jw.String("num_rows");
+  jw.Int64(FLAGS_num_rows);
+  jw.String("num_ops");
+  jw.Int64(FLAGS_num_ops);
+  jw.String("flush_after_load");
+  jw.Bool(FLAGS_flush_after_load);
+  jw.String("seed");
+  jw.Uint64(FLAGS_seed);
+  jw.EndObject();
+  jw.String("results");
+  jw.StartArray();
+  for (const auto& workload : strings::Split(FLAGS_workloads, ",", strings::SkipEmpty())) {
+    LOG(INFO) << "Running workload " << workload;
+    WorkloadResult result;
+    RETURN_NOT_OK_PREPEND(bench.Run(workload.ToString(), &result),
+                          Substitute("workload $0 failed", workload.ToString()));
+    result.ToJson(&jw);
+  }
+  jw.EndArray();
+  jw.EndObject();
+
+  if (FLAGS_output_file.empty()) {
+    std::cout << out.str() << std::endl;
+    return Status::OK();
+  }
+  std::ofstream f(FLAGS_output_file);
+  f << out.str() << std::endl;
+  f.close();
+  if (!f) {
+    return Status::IOError("could not write results", FLAGS_output_file);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+} // namespace kudu
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+  kudu::Status s = kudu::RunBenchmarks();
+  if (!s.ok()) {
+    LOG(ERROR) << s.ToString();
+    return 1;
+  }
+  return 0;
+}
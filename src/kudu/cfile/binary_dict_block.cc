@@ -40,6 +40,7 @@
 #include "kudu/common/types.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
@@ -207,6 +208,15 @@ BinaryDictBlockDecoder::BinaryDictBlockDecoder(scoped_refptr<BlockHandle> block,
       parent_cfile_iter_(iter) {
 }
 
+BinaryDictBlockDecoder::BinaryDictBlockDecoder(scoped_refptr<BlockHandle> block,
+                                               BinaryPlainBlockDecoder* dict_decoder)
+    : block_(std::move(block)),
+      data_(block_->data()),
+      parsed_(false),
+      dict_decoder_(dict_decoder),
+      parent_cfile_iter_(nullptr) {
+}
+
 Status BinaryDictBlockDecoder::ParseHeader() {
   CHECK(!parsed_);
 
@@ -277,6 +287,7 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return data_decoder_->CopyNextAndEval(n, ctx, sel, dst);
   }
 
+  DCHECK(parent_cfile_iter_);
   // Predicates that have no matching words should return no data.
   SelectionVector* codewords_matching_pred = parent_cfile_iter_->GetCodeWordsMatchingPredicate();
   CHECK(codewords_matching_pred != nullptr);
@@ -290,8 +301,9 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return Status::OK();
   }
 
-  // IsNotNull predicates should return all data.
-  if (ctx->pred()->predicate_type() == PredicateType::IsNotNull) {
+  // Predicates that match every word, e.g. IsNotNull or a range covering the
+  // whole dictionary, should return all data.
+  if (parent_cfile_iter_->AllCodeWordsMatchPredicate()) {
     return CopyNextDecodeStrings(n, dst);
   }
 
@@ -300,19 +312,23 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
   // Load the rows' codeword values into a buffer for scanning.
   BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
   codeword_buf_.resize(*n * sizeof(uint32_t));
-  d_bptr->CopyNextValuesToArray(n, codeword_buf_.data());
+  RETURN_NOT_OK(d_bptr->CopyNextValuesToArray(n, codeword_buf_.data()));
+  const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
+  const uint8_t* matching_bitmap = codewords_matching_pred->bitmap();
   Slice* out = reinterpret_cast<Slice*>(dst->data());
-  for (size_t i = 0; i < *n; i++, out++) {
+  for (size_t i = 0; i < *n; i++) {
     // Check with the SelectionVectorView to see whether the data has already
     // been cleared, in which case we can skip evaluation.
     if (!sel->TestBit(i)) {
       continue;
     }
-    uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
-    if (BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
+    // The predicate was resolved against the dictionary up front, so
+    // evaluating it on a row is a single bitmap lookup on its codeword.
+    const uint32_t codeword = UnalignedLoad<uint32_t>(codewords + i);
+    if (BitmapTest(matching_bitmap, codeword)) {
       // Row is included in predicate: point the cell in the block
       // to the entry in the dictionary.
-      *out = dict_decoder_->string_at_index(codeword);
+      out[i] = dict_decoder_->string_at_index(codeword);
       retain_dict = true;
     } else {
       // Mark that the row will not be returned.
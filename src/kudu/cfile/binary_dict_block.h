@@ -142,6 +142,12 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
  public:
   explicit BinaryDictBlockDecoder(scoped_refptr<BlockHandle> block, CFileIterator* iter);
 
+  // Creates a decoder looking the codewords of the block up in 'dict_decoder',
+  // for blocks which are decoded outside of a CFileIterator. Predicates can't
+  // be evaluated by such decoders, i.e. CopyNextAndEval() may not be called.
+  BinaryDictBlockDecoder(scoped_refptr<BlockHandle> block,
+                         BinaryPlainBlockDecoder* dict_decoder);
+
   virtual Status ParseHeader() OVERRIDE;
   virtual void SeekToPositionInBlock(uint pos) OVERRIDE;
   virtual Status SeekAtOrAfterValue(const void* value, bool* exact_match) OVERRIDE;
@@ -85,6 +85,31 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+TEST(TestBlockCache, TestCompressedTier) {
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  BlockCache cache(512 * 1024 * 1024, 64 * 1024 * 1024);
+  ASSERT_TRUE(cache.has_compressed_tier());
+  BlockCache::CacheKey key(BlockCache::FileId(1234), 1);
+
+  // Insert into the compressed tier.
+  BlockCache::PendingEntry data = cache.Allocate(key, data_size, BlockCache::Tier::COMPRESSED);
+  memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle inserted_handle;
+  cache.Insert(&data, &inserted_handle);
+  ASSERT_TRUE(inserted_handle.valid());
+
+  // The entry is only found in the tier it was inserted into.
+  BlockCacheHandle retrieved_handle;
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle));
+  ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &retrieved_handle,
+                           BlockCache::Tier::COMPRESSED));
+  ASSERT_EQ(0, memcmp(retrieved_handle.data().data(), DATA_TO_CACHE, data_size));
+
+  // The compressed tier is disabled by default.
+  BlockCache uncompressed_only(512 * 1024 * 1024);
+  ASSERT_FALSE(uncompressed_only.has_compressed_tier());
+}
+
 
 } // namespace cfile
 } // namespace kudu
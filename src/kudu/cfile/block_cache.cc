@@ -19,22 +19,29 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/secondary_block_cache.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/block_cache_metrics.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/cache_metrics.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flag_validators.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/string_case.h"
 
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
@@ -44,6 +51,27 @@ TAG_FLAG(block_cache_capacity_mb, stable);
 // The idea is to avoid the corresponding group flag validator striking
 // while running anything but master and tserver. As for the master and tserver,
 // those have the default value for this flag set to 'false'.
+DEFINE_int64(block_cache_compressed_capacity_mb, 0,
+             "Capacity in MB of the block cache tier holding blocks of compressed "
+             "CFiles in their compressed form. Blocks read from disk are cached in "
+             "this tier, and only decompressed into the regular block cache once read "
+             "again. If 0, the tier is disabled and blocks are cached decompressed "
+             "only. The tier is always kept in DRAM.");
+TAG_FLAG(block_cache_compressed_capacity_mb, experimental);
+
+DEFINE_string(block_cache_secondary_file, "",
+              "Path of a file on a local device, preferably an SSD, in which to keep "
+              "the blocks evicted from the block cache, up to "
+              "--block_cache_secondary_capacity_mb. Misses of the block cache are "
+              "looked up there before the blocks are read from the data directories. "
+              "The file is overwritten at startup. If empty, or if the capacity is 0, "
+              "evicted blocks are dropped.");
+TAG_FLAG(block_cache_secondary_file, experimental);
+
+DEFINE_int64(block_cache_secondary_capacity_mb, 0,
+             "Capacity in MB of the file of --block_cache_secondary_file.");
+TAG_FLAG(block_cache_secondary_capacity_mb, experimental);
+
 DEFINE_bool(force_block_cache_capacity, true,
             "Force Kudu to accept the block cache size, even if it is unsafe.");
 TAG_FLAG(force_block_cache_capacity, unsafe);
@@ -57,6 +85,22 @@ DEFINE_string(block_cache_type, "DRAM",
               "libmemkind 1.8.0 or newer must be available on the system; "
               "otherwise Kudu will crash.");
 
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which eviction policy to use for the block cache. Valid choices "
+              "are 'LRU', 'SLRU' or 'CLOCK'. 'SLRU' keeps blocks which were read more "
+              "than once in a protected segment of the cache and only admits new "
+              "blocks into a full cache if they've been read about as often as "
+              "the blocks they'd evict, so large scans don't flush the blocks used "
+              "by other workloads. 'CLOCK' approximates LRU without serializing "
+              "concurrent lookups of the cache, at the cost of more expensive "
+              "insertions. 'SLRU' and 'CLOCK' are only supported with "
+              "--block_cache_type=DRAM.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+using std::string;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
 using strings::Substitute;
 
 template <class T> class scoped_refptr;
@@ -69,10 +113,29 @@ namespace cfile {
 
 namespace {
 
+bool ValidateEvictionPolicy(const char* flagname, const string& value) {
+  if (iequals(value, "LRU") || iequals(value, "SLRU") || iequals(value, "CLOCK")) {
+    return true;
+  }
+  LOG(ERROR) << Substitute("unknown value for --$0 flag: '$1' "
+                           "(expected 'LRU', 'SLRU' or 'CLOCK')",
+                           flagname, value);
+  return false;
+}
+DEFINE_validator(block_cache_eviction_policy, &ValidateEvictionPolicy);
+
 Cache* CreateCache(int64_t capacity) {
   const auto mem_type = BlockCache::GetConfiguredCacheMemoryTypeOrDie();
   switch (mem_type) {
     case Cache::MemoryType::DRAM:
+      if (iequals(FLAGS_block_cache_eviction_policy, "SLRU")) {
+        return NewCache<Cache::EvictionPolicy::SLRU, Cache::MemoryType::DRAM>(
+            capacity, "block_cache");
+      }
+      if (iequals(FLAGS_block_cache_eviction_policy, "CLOCK")) {
+        return NewCache<Cache::EvictionPolicy::CLOCK, Cache::MemoryType::DRAM>(
+            capacity, "block_cache");
+      }
       return NewCache<Cache::EvictionPolicy::LRU, Cache::MemoryType::DRAM>(
           capacity, "block_cache");
     case Cache::MemoryType::NVM:
@@ -84,6 +147,24 @@ Cache* CreateCache(int64_t capacity) {
   }
 }
 
+// Returns the secondary cache configured by the flags, or nullptr if there is
+// none or it can't be created.
+unique_ptr<SecondaryBlockCache> CreateSecondaryCache() {
+  if (FLAGS_block_cache_secondary_file.empty() || FLAGS_block_cache_secondary_capacity_mb <= 0) {
+    return nullptr;
+  }
+  unique_ptr<SecondaryBlockCache> cache;
+  Status s = SecondaryBlockCache::Create(Env::Default(), FLAGS_block_cache_secondary_file,
+                                         FLAGS_block_cache_secondary_capacity_mb * 1024 * 1024,
+                                         &cache);
+  if (!s.ok()) {
+    LOG(WARNING) << "unable to create the secondary block cache, continuing without it: "
+                 << s.ToString();
+    return nullptr;
+  }
+  return cache;
+}
+
 } // anonymous namespace
 
 bool ValidateBlockCacheCapacity() {
@@ -93,7 +174,8 @@ bool ValidateBlockCacheCapacity() {
   if (FLAGS_block_cache_type != "DRAM") {
     return true;
   }
-  int64_t capacity = FLAGS_block_cache_capacity_mb * 1024 * 1024;
+  int64_t capacity =
+      (FLAGS_block_cache_capacity_mb + FLAGS_block_cache_compressed_capacity_mb) * 1024 * 1024;
   int64_t mpt = process_memory::MemoryPressureThreshold();
   if (capacity > mpt) {
     LOG(ERROR) << Substitute("Block cache capacity exceeds the memory pressure "
@@ -118,6 +200,20 @@ bool ValidateBlockCacheCapacity() {
 
 GROUP_FLAG_VALIDATOR(block_cache_capacity_mb, ValidateBlockCacheCapacity);
 
+namespace {
+bool ValidateBlockCacheEvictionPolicy() {
+  if (!iequals(FLAGS_block_cache_type, "DRAM") &&
+      !iequals(FLAGS_block_cache_eviction_policy, "LRU")) {
+    LOG(ERROR) << Substitute("--block_cache_eviction_policy=$0 is not supported "
+                             "with --block_cache_type=$1",
+                             FLAGS_block_cache_eviction_policy, FLAGS_block_cache_type);
+    return false;
+  }
+  return true;
+}
+} // anonymous namespace
+GROUP_FLAG_VALIDATOR(block_cache_eviction_policy, ValidateBlockCacheEvictionPolicy);
+
 Cache::MemoryType BlockCache::GetConfiguredCacheMemoryTypeOrDie() {
     ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
   if (FLAGS_block_cache_type == "NVM") {
@@ -133,35 +229,100 @@ Cache::MemoryType BlockCache::GetConfiguredCacheMemoryTypeOrDie() {
 }
 
 BlockCache::BlockCache()
-    : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
+    : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024,
+                 FLAGS_block_cache_compressed_capacity_mb * 1024 * 1024,
+                 CreateSecondaryCache()) {
 }
 
-BlockCache::BlockCache(size_t capacity)
-    : cache_(CreateCache(capacity)) {
+BlockCache::BlockCache(size_t capacity, size_t compressed_capacity)
+    : BlockCache(capacity, compressed_capacity, nullptr) {
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size) {
+BlockCache::BlockCache(size_t capacity, size_t compressed_capacity,
+                       unique_ptr<SecondaryBlockCache> secondary_cache)
+    : secondary_cache_(std::move(secondary_cache)),
+      cache_(CreateCache(capacity)) {
+  if (compressed_capacity > 0) {
+    compressed_cache_.reset(NewCache<Cache::EvictionPolicy::LRU, Cache::MemoryType::DRAM>(
+        compressed_capacity, "compressed_block_cache"));
+  }
+}
+
+BlockCache::~BlockCache() {
+  // The entries destroyed with the cache aren't worth writing out.
+  if (secondary_cache_) {
+    secondary_cache_->Shutdown();
+  }
+}
+
+Cache* BlockCache::GetCache(Tier tier) const {
+  if (tier == Tier::COMPRESSED) {
+    return DCHECK_NOTNULL(compressed_cache_.get());
+  }
+  return cache_.get();
+}
+
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t block_size,
+                                              Tier tier) {
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
-  return PendingEntry(cache_->Allocate(key_slice, block_size));
+  return PendingEntry(GetCache(tier)->Allocate(key_slice, block_size));
 }
 
 bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-                        BlockCacheHandle* handle) {
-  auto h(cache_->Lookup(
-      Slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key)), behavior));
+                        BlockCacheHandle* handle, Tier tier) {
+  const Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  auto h(GetCache(tier)->Lookup(key_slice, behavior));
   if (h) {
     handle->SetHandle(std::move(h));
     return true;
   }
-  return false;
+  if (!secondary_cache_ || tier != Tier::UNCOMPRESSED ||
+      behavior != Cache::EXPECT_IN_CACHE) {
+    return false;
+  }
+  PendingEntry entry;
+  if (!secondary_cache_->Lookup(key_slice, [&](size_t size) -> uint8_t* {
+        entry = Allocate(key, size);
+        return entry.valid() ? entry.val_ptr() : nullptr;
+      })) {
+    return false;
+  }
+  Insert(&entry, handle);
+  return true;
 }
 
 void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  auto h(cache_->Insert(std::move(entry->handle_),
-                        /* eviction_callback= */ nullptr));
+  // The pending entry is tied to the cache of the tier it was allocated from.
+  Cache* cache = entry->handle_.get_deleter().cache();
+  // The secondary cache only backs the UNCOMPRESSED tier.
+  Cache::EvictionCallback* eviction_callback =
+      cache == cache_.get() ? secondary_cache_.get() : nullptr;
+  auto h(cache->Insert(std::move(entry->handle_), eviction_callback));
   inserted->SetHandle(std::move(h));
 }
 
+void BlockCache::GetKeys(vector<CacheKey>* keys) const {
+  // Keys are gathered by declaring every entry valid to Invalidate().
+  unordered_set<string> key_strs;
+  const Cache::InvalidationControl ctl(
+      [&](Slice key, Slice /* value */) {
+        if (key.size() == sizeof(CacheKey)) {
+          key_strs.emplace(key.ToString());
+        }
+        return true;
+      });
+  cache_->Invalidate(ctl);
+  if (compressed_cache_) {
+    compressed_cache_->Invalidate(ctl);
+  }
+  keys->reserve(keys->size() + key_strs.size());
+  for (const auto& key_str : key_strs) {
+    CacheKey key(FileId(0), 0);
+    memcpy(&key, key_str.data(), sizeof(key));
+    keys->push_back(key);
+  }
+}
+
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity,
                                       Cache::ExistingMetricsPolicy metrics_policy) {
   std::unique_ptr<BlockCacheMetrics> metrics(new BlockCacheMetrics(metric_entity));
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/macros.h"
@@ -37,6 +38,7 @@ class MetricEntity;
 namespace cfile {
 
 class BlockCacheHandle;
+class SecondaryBlockCache;
 
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
@@ -113,23 +115,54 @@ class BlockCache {
     Cache::UniquePendingHandle handle_;
   };
 
+  // The tiers of the block cache.
+  //
+  // Besides the decompressed blocks in the UNCOMPRESSED tier, blocks of
+  // compressed CFiles may be kept in their on-disk form in the COMPRESSED
+  // tier, which is a separate DRAM cache of its own capacity. Since compressed
+  // blocks are several times smaller, the COMPRESSED tier can hold a much
+  // larger working set, at the cost of decompressing blocks on each hit.
+  enum class Tier {
+    UNCOMPRESSED,
+    COMPRESSED,
+  };
+
   static BlockCache* GetSingleton() {
     return Singleton<BlockCache>::get();
   }
 
-  explicit BlockCache(size_t capacity);
+  // Creates a block cache of 'capacity' bytes. The COMPRESSED tier is only
+  // enabled if 'compressed_capacity' is non-zero.
+  explicit BlockCache(size_t capacity, size_t compressed_capacity = 0);
+
+  // Like the above, with the blocks evicted from the UNCOMPRESSED tier kept in
+  // 'secondary_cache', and looked up there on misses.
+  BlockCache(size_t capacity, size_t compressed_capacity,
+             std::unique_ptr<SecondaryBlockCache> secondary_cache);
+
+  ~BlockCache();
+
+  // Whether the COMPRESSED tier is enabled.
+  bool has_compressed_tier() const {
+    return compressed_cache_ != nullptr;
+  }
 
-  // Lookup the given block in the cache.
+  // Lookup the given block in the given tier of the cache.
   //
   // If the entry is found, then sets *handle to refer to the entry.
   // This object's destructor will release the cache entry so it may be freed again.
   // Alternatively,  handle->Release() may be used to explicitly release it.
   //
+  // Misses of the UNCOMPRESSED tier are looked up in the secondary cache, if
+  // any, unless 'behavior' is NO_EXPECT_IN_CACHE: blocks found there are
+  // inserted back into the tier.
+  //
   // Returns true to indicate that the entry was found, false otherwise.
   bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-              BlockCacheHandle* handle);
+              BlockCacheHandle* handle, Tier tier = Tier::UNCOMPRESSED);
 
-  // Pass a metric entity to the cache to start recording metrics.
+  // Pass a metric entity to the cache to start recording metrics of the
+  // UNCOMPRESSED tier.
   // This should be called before the block cache starts serving blocks.
   // Not calling StartInstrumentation will simply result in no block cache-related metrics.
   // Calling StartInstrumentation multiple times will reset the metrics each time.
@@ -155,20 +188,39 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the given tier of the cache.
+  // The COMPRESSED tier must be enabled to allocate from it.
+  PendingEntry Allocate(const CacheKey& key, size_t block_size,
+                        Tier tier = Tier::UNCOMPRESSED);
 
-  // Insert the given block into the cache. 'inserted' is set to refer to the
-  // entry in the cache.
+  // Insert the given block into the tier of the cache it was allocated from.
+  // 'inserted' is set to refer to the entry in the cache.
   void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
 
+  // Appends the keys of all the blocks in the cache, of either tier, to 'keys'.
+  // Keys of blocks in both tiers are only appended once.
+  //
+  // NOTE: this iterates over all the entries of the cache while holding the
+  // locks of its shards, so it should be called sparingly.
+  void GetKeys(std::vector<CacheKey>* keys) const;
+
  private:
   friend class Singleton<BlockCache>;
   BlockCache();
 
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
+  Cache* GetCache(Tier tier) const;
+
+  // The cache of the blocks evicted from 'cache_', or nullptr if there is
+  // none. Declared first to be destroyed last: 'cache_' calls it back as its
+  // entries are destroyed.
+  std::unique_ptr<SecondaryBlockCache> secondary_cache_;
+
   std::unique_ptr<Cache> cache_;
+
+  // The cache of the COMPRESSED tier, or nullptr if it's disabled.
+  std::unique_ptr<Cache> compressed_cache_;
 };
 
 // Scoped reference to a block from the block cache.
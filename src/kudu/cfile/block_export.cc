@@ -0,0 +1,262 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/block_export.h"
+
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/binary_dict_block.h"
+#include "kudu/cfile/binary_plain_block.h"
+#include "kudu/cfile/block_compression.h"
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/block_pointer.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/rle-encoding.h"
+
+using kudu::fs::IOContext;
+using std::pair;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+// Sets '*blocks' to the data blocks of 'reader', as by ListExportableBlocks(),
+// and '*ptrs' to where they're stored.
+Status GetExportableBlocks(const IOContext* io_context,
+                           const CFileReader& reader,
+                           vector<ExportedCFile::Block>* blocks,
+                           vector<BlockPointer>* ptrs) {
+  vector<pair<rowid_t, BlockPointer>> data_blocks;
+  RETURN_NOT_OK(reader.GetDataBlocks(io_context, &data_blocks));
+  const int64_t num_values = reader.footer().num_values();
+  blocks->clear();
+  blocks->reserve(data_blocks.size());
+  ptrs->clear();
+  ptrs->reserve(data_blocks.size());
+  for (int i = 0; i < data_blocks.size(); i++) {
+    const int64_t end = i + 1 < data_blocks.size() ? data_blocks[i + 1].first : num_values;
+    if (PREDICT_FALSE(end <= data_blocks[i].first)) {
+      return Status::Corruption(Substitute("data block $0 of $1 has no values",
+                                           data_blocks[i].second.ToString(),
+                                           reader.ToString()));
+    }
+    ExportedCFile::Block block;
+    block.first_row = data_blocks[i].first;
+    block.num_rows = end - data_blocks[i].first;
+    block.offset = 0;
+    block.size = data_blocks[i].second.size();
+    blocks->push_back(block);
+    ptrs->push_back(data_blocks[i].second);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status ListExportableBlocks(const IOContext* io_context,
+                            const CFileReader& reader,
+                            vector<ExportedCFile::Block>* blocks,
+                            uint64_t* dictionary_size) {
+  vector<BlockPointer> ptrs;
+  RETURN_NOT_OK(GetExportableBlocks(io_context, reader, blocks, &ptrs));
+  const CFileFooterPB& footer = reader.footer();
+  *dictionary_size = footer.has_dict_block_ptr() ?
+      BlockPointer(footer.dict_block_ptr()).size() : 0;
+  return Status::OK();
+}
+
+Status ExportCFile(const IOContext* io_context,
+                   const CFileReader& reader,
+                   rowid_t start_row,
+                   rowid_t end_row,
+                   ExportedCFile* out) {
+  DCHECK_LE(start_row, end_row);
+  const CFileFooterPB& footer = reader.footer();
+  out->type = footer.data_type();
+  out->encoding = footer.encoding();
+  out->compression = footer.compression();
+  out->cfile_version = reader.cfile_version();
+  out->is_nullable = reader.is_nullable();
+  out->dictionary.clear();
+  out->data.clear();
+  out->blocks.clear();
+
+  if (footer.has_dict_block_ptr()) {
+    RETURN_NOT_OK(reader.ReadRawBlock(io_context, BlockPointer(footer.dict_block_ptr()),
+                                      &out->dictionary));
+  }
+
+  vector<ExportedCFile::Block> blocks;
+  vector<BlockPointer> ptrs;
+  RETURN_NOT_OK(GetExportableBlocks(io_context, reader, &blocks, &ptrs));
+  for (int i = 0; i < blocks.size(); i++) {
+    ExportedCFile::Block block = blocks[i];
+    if (block.first_row + block.num_rows <= start_row) {
+      continue;
+    }
+    if (block.first_row >= end_row) {
+      break;
+    }
+    block.offset = out->data.size();
+    RETURN_NOT_OK(reader.ReadRawBlock(io_context, ptrs[i], &out->data));
+    block.size = out->data.size() - block.offset;
+    out->blocks.push_back(block);
+  }
+  return Status::OK();
+}
+
+ExportedBlockDecoder::ExportedBlockDecoder(const ExportedCFile* file)
+    : file_(file),
+      type_info_(nullptr),
+      type_encoding_info_(nullptr),
+      codec_(nullptr) {
+}
+
+ExportedBlockDecoder::~ExportedBlockDecoder() {}
+
+Status ExportedBlockDecoder::Init() {
+  type_info_ = GetTypeInfo(file_->type);
+  RETURN_NOT_OK(TypeEncodingInfo::Get(type_info_, file_->encoding, &type_encoding_info_));
+  if (file_->compression != NO_COMPRESSION) {
+    RETURN_NOT_OK(GetCompressionCodec(file_->compression, &codec_));
+  }
+  if ((file_->dictionary.size() == 0) != (file_->encoding != DICT_ENCODING)) {
+    return Status::InvalidArgument(
+        "dictionary encoded files, and only those, must have a dictionary");
+  }
+  if (file_->encoding == DICT_ENCODING) {
+    scoped_refptr<BlockHandle> dict;
+    RETURN_NOT_OK(Decompress(Slice(file_->dictionary), &dict));
+    dict_decoder_.reset(new BinaryPlainBlockDecoder(std::move(dict)));
+    RETURN_NOT_OK_PREPEND(dict_decoder_->ParseHeader(), "unable to decode dictionary");
+  }
+  return Status::OK();
+}
+
+Status ExportedBlockDecoder::Decompress(const Slice& block,
+                                        scoped_refptr<BlockHandle>* handle) const {
+  if (codec_ == nullptr) {
+    uint8_t* data = new uint8_t[block.size()];
+    memcpy(data, block.data(), block.size());
+    *handle = BlockHandle::WithOwnedData(Slice(data, block.size()));
+    return Status::OK();
+  }
+  CompressedBlockDecoder uncompressor(codec_, file_->cfile_version, block);
+  RETURN_NOT_OK_PREPEND(uncompressor.Init(), "unable to validate compressed block");
+  unique_ptr<uint8_t[]> data(new uint8_t[uncompressor.uncompressed_size()]);
+  RETURN_NOT_OK_PREPEND(uncompressor.UncompressIntoBuffer(data.get()),
+                        "unable to uncompress block");
+  *handle = BlockHandle::WithOwnedData(Slice(data.release(), uncompressor.uncompressed_size()));
+  return Status::OK();
+}
+
+Status ExportedBlockDecoder::DecodeBlock(const Slice& block, ColumnBlock* dst, size_t* num_rows) {
+  DCHECK(type_info_) << "must Init()";
+  if (PREDICT_FALSE(dst->type_info()->type() != type_info_->type() ||
+                    dst->is_nullable() != file_->is_nullable)) {
+    return Status::InvalidArgument("destination doesn't match the exported cfile");
+  }
+  scoped_refptr<BlockHandle> handle;
+  RETURN_NOT_OK(Decompress(block, &handle));
+
+  // Like CFileIterator, strip the header of nullable blocks, which tells how
+  // many rows the block has and which of them are null.
+  uint32_t num_rows_in_block = 0;
+  Slice non_null_bitmap;
+  if (file_->is_nullable) {
+    Slice data = handle->data();
+    uint32_t bitmap_size;
+    if (!GetVarint32(&data, &num_rows_in_block) ||
+        !GetVarint32(&data, &bitmap_size) ||
+        data.size() < bitmap_size) {
+      return Status::Corruption("bad null header");
+    }
+    non_null_bitmap = Slice(data.data(), bitmap_size);
+    data.remove_prefix(bitmap_size);
+    handle = handle->SubrangeBlock(data.data() - handle->data().data(), data.size());
+  }
+
+  unique_ptr<BlockDecoder> decoder;
+  if (file_->encoding == DICT_ENCODING) {
+    // The codewords are looked up in the exported dictionary rather than in
+    // that of a CFileIterator.
+    decoder.reset(new BinaryDictBlockDecoder(std::move(handle), dict_decoder_.get()));
+  } else {
+    RETURN_NOT_OK(type_encoding_info_->CreateBlockDecoder(&decoder, std::move(handle), nullptr));
+  }
+  RETURN_NOT_OK_PREPEND(decoder->ParseHeader(), "unable to decode data block header");
+  if (!file_->is_nullable) {
+    num_rows_in_block = decoder->Count();
+  }
+  if (PREDICT_FALSE(num_rows_in_block > dst->nrows())) {
+    return Status::InvalidArgument(Substitute("block of $0 rows doesn't fit in $1 rows",
+                                              num_rows_in_block, dst->nrows()));
+  }
+
+  ColumnDataView dst_view(dst);
+  if (!file_->is_nullable) {
+    size_t n = num_rows_in_block;
+    RETURN_NOT_OK(decoder->CopyNextValues(&n, &dst_view));
+    if (PREDICT_FALSE(n != num_rows_in_block)) {
+      return Status::Corruption("data block ended early");
+    }
+    *num_rows = n;
+    return Status::OK();
+  }
+
+  RleDecoder<bool> rle_decoder(non_null_bitmap.data(), non_null_bitmap.size(), 1);
+  size_t remaining = num_rows_in_block;
+  while (remaining > 0) {
+    bool not_null = false;
+    size_t run = rle_decoder.GetNextRun(&not_null, remaining);
+    if (PREDICT_FALSE(run == 0)) {
+      return Status::Corruption(
+          Substitute("unexpected EOF on NULL bitmap read, expected $0 more rows", remaining));
+    }
+    if (not_null) {
+      size_t n = run;
+      RETURN_NOT_OK(decoder->CopyNextValues(&n, &dst_view));
+      if (PREDICT_FALSE(n != run)) {
+        return Status::Corruption("data block ended early");
+      }
+    }
+    dst_view.SetNullBits(run, not_null);
+    dst_view.Advance(run);
+    remaining -= run;
+  }
+  *num_rows = num_rows_in_block;
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
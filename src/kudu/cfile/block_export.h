@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Exporting the data blocks of cfiles as they're stored, and decoding them
+// outside of a CFileReader.
+//
+// Scans which don't need the values to be processed by the server, i.e. which
+// have no predicates and read rowsets with no deltas relevant to their
+// snapshot, may have the blocks shipped still encoded (and compressed),
+// leaving the decoding to the reader. This saves the server the CPU spent
+// decoding and re-serializing the values, and usually the network too since
+// the encoded blocks are smaller than the decoded rows.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class CompressionCodec;
+class TypeInfo;
+
+namespace fs {
+struct IOContext;
+} // namespace fs
+
+namespace cfile {
+
+class BinaryPlainBlockDecoder;
+class BlockHandle;
+class CFileReader;
+class TypeEncodingInfo;
+
+// The data blocks of a cfile as they're stored, with what it takes to decode
+// them.
+struct ExportedCFile {
+  struct Block {
+    // The ordinal of the first value of the block.
+    rowid_t first_row;
+    uint32_t num_rows;
+    // The position of the block in 'data'.
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  DataType type = UNKNOWN_DATA;
+  EncodingType encoding = UNKNOWN_ENCODING;
+  CompressionType compression = NO_COMPRESSION;
+  int cfile_version = 0;
+  bool is_nullable = false;
+
+  // The dictionary block of DICT_ENCODING cfiles, as stored. Empty otherwise.
+  faststring dictionary;
+
+  // The data blocks, as stored, back to back.
+  faststring data;
+  std::vector<Block> blocks;
+};
+
+// Sets '*blocks' to the data blocks of 'reader', with the size each has as
+// stored and no offset, and '*dictionary_size' to the size of its dictionary
+// block, or 0 if it has none. Reads the positional index, so that the blocks
+// to export can be picked without reading them. The cfile must have a
+// positional index.
+Status ListExportableBlocks(const fs::IOContext* io_context,
+                            const CFileReader& reader,
+                            std::vector<ExportedCFile::Block>* blocks,
+                            uint64_t* dictionary_size);
+
+// Reads the data blocks of 'reader' which hold values of the rows
+// [start_row, end_row) into 'out', without decoding them. The first and
+// last blocks may hold values of rows out of the range too. The cfile must
+// have a positional index.
+Status ExportCFile(const fs::IOContext* io_context,
+                   const CFileReader& reader,
+                   rowid_t start_row,
+                   rowid_t end_row,
+                   ExportedCFile* out);
+
+// Decodes the data blocks of an exported cfile.
+//
+// Not thread-safe.
+class ExportedBlockDecoder {
+ public:
+  // Only the fields describing the blocks and the dictionary of 'file' are
+  // used, which must outlive the decoder: the data blocks may be passed to
+  // DecodeBlock() from anywhere.
+  explicit ExportedBlockDecoder(const ExportedCFile* file);
+  ~ExportedBlockDecoder();
+
+  // Validates the description of the file and decodes its dictionary, if any.
+  Status Init();
+
+  // Decodes the values of the stored data block 'block' into 'dst', from its
+  // first row on. 'dst' must be of the type of the file, nullable if the file
+  // is, and have room for all the values of the block. Strings may point into
+  // memory whose references are retained by the RowBlockMemory of 'dst'.
+  //
+  // Sets '*num_rows' to the number of values decoded.
+  Status DecodeBlock(const Slice& block, ColumnBlock* dst, size_t* num_rows);
+
+ private:
+  // Sets '*handle' to the decompressed 'block'.
+  Status Decompress(const Slice& block, scoped_refptr<BlockHandle>* handle) const;
+
+  const ExportedCFile* const file_;
+  const TypeInfo* type_info_;
+  const TypeEncodingInfo* type_encoding_info_;
+  const CompressionCodec* codec_;
+
+  // The decoder of the dictionary of DICT_ENCODING files.
+  std::unique_ptr<BinaryPlainBlockDecoder> dict_decoder_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExportedBlockDecoder);
+};
+
+} // namespace cfile
+} // namespace kudu
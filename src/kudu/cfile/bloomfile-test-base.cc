@@ -24,6 +24,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
@@ -71,7 +72,7 @@ void BloomFileTestBase::AppendBlooms(BloomFileWriter* bfw) {
   }
 }
 
-void BloomFileTestBase::WriteTestBloomFile() {
+void BloomFileTestBase::WriteTestBloomFile(BloomBlockHeaderPB::Format format) {
   unique_ptr<fs::WritableBlock> sink;
   ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
   block_id_ = sink->id();
@@ -84,7 +85,7 @@ void BloomFileTestBase::WriteTestBloomFile() {
       << "Invalid parameters: --n_keys isn't set large enough to fill even "
       << "one bloom filter of the requested --bloom_size_bytes";
 
-  BloomFileWriter bfw(std::move(sink), sizing);
+  BloomFileWriter bfw(std::move(sink), sizing, format);
 
   ASSERT_OK(bfw.Start());
   AppendBlooms(&bfw);
@@ -20,6 +20,7 @@
 #include <memory>
 
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/util/status.h"
@@ -34,8 +35,9 @@ class BloomFileTestBase : public KuduTest {
 
   void SetUp() override;
 
-  // Creates a test bloomfile on disk. The block ID is written to block_id_.
-  void WriteTestBloomFile();
+  // Creates a test bloomfile with blocks of the given format on disk. The
+  // block ID is written to block_id_.
+  void WriteTestBloomFile(BloomBlockHeaderPB::Format format = BloomBlockHeaderPB::CLASSIC);
 
   // Opens the bloomfile with block id block_id_ for reading.
   // WriteTestBloomFile() must have been called. The reader is written to bfr_.
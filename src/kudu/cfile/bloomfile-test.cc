@@ -22,12 +22,14 @@
 #include <memory>
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/bloomfile-test-base.h"
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs-test-util.h"
@@ -49,6 +51,7 @@ using kudu::fs::CountingReadableBlock;
 using kudu::fs::ReadableBlock;
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 namespace cfile {
@@ -94,6 +97,47 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+TEST_F(BloomFileTest, TestWriteAndReadSplitBlock) {
+  NO_FATALS(WriteTestBloomFile(BloomBlockHeaderPB::SPLIT_BLOCK));
+  ASSERT_OK(OpenBloomFile());
+  VerifyBloomFile();
+}
+
+// Test that checking a sorted batch of keys gives the same results as checking
+// them one by one.
+TEST_F(BloomFileTest, TestCheckKeysPresent) {
+  for (auto format : { BloomBlockHeaderPB::CLASSIC, BloomBlockHeaderPB::SPLIT_BLOCK }) {
+    SCOPED_TRACE(BloomBlockHeaderPB::Format_Name(format));
+    NO_FATALS(WriteTestBloomFile(format));
+    ASSERT_OK(OpenBloomFile());
+
+    // Every key in the range, half of which were inserted.
+    const int kNumProbes = FLAGS_n_keys << kKeyShift;
+    vector<uint64_t> keys(kNumProbes);
+    vector<BloomKeyProbe> probes;
+    probes.reserve(kNumProbes);
+    for (uint64_t i = 0; i < kNumProbes; i++) {
+      keys[i] = BigEndian::FromHost64(i);
+      probes.emplace_back(Slice(reinterpret_cast<const uint8_t*>(&keys[i]), sizeof(keys[i])));
+    }
+    vector<const BloomKeyProbe*> probe_ptrs;
+    for (const auto& probe : probes) {
+      probe_ptrs.emplace_back(&probe);
+    }
+    unique_ptr<bool[]> present(new bool[kNumProbes]);
+    ASSERT_OK(bfr()->CheckKeysPresent(probe_ptrs, nullptr, present.get()));
+
+    for (int i = 0; i < kNumProbes; i++) {
+      bool single_present;
+      ASSERT_OK_FAST(bfr()->CheckKeyPresent(probes[i], nullptr, &single_present));
+      ASSERT_EQ(single_present, present[i]) << i;
+      if (i % (1 << kKeyShift) == 0) {
+        ASSERT_TRUE(present[i]) << i;
+      }
+    }
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   NO_FATALS(WriteTestBloomFile());
@@ -16,6 +16,8 @@
 // under the License.
 #include "kudu/cfile/bloomfile.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <ostream>
@@ -37,11 +39,16 @@
 #include "kudu/common/types.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/bits.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/block_bloom_filter.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/hash.pb.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
@@ -54,6 +61,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace cfile {
@@ -69,6 +77,12 @@ static Atomic64 g_next_nonce = 0;
 
 namespace {
 
+// The size of the smallest split-block bloom filter, i.e. a single bucket.
+constexpr int kSplitBlockMinLogSpaceBytes = 5;
+
+// The number of bits set for each key of a split-block bloom filter.
+constexpr int kSplitBlockNumHashes = 8;
+
 // Frequently, a thread processing a batch of operations will consult the same BloomFile
 // many times in a row. So, we keep a thread-local cache of the state for recently-accessed
 // BloomFileReaders so that we can avoid doing repetitive work.
@@ -87,6 +101,8 @@ class BloomCacheItem {
   // The block handle and parsed BloomFilter corresponding to cur_block_pointer.
   scoped_refptr<BlockHandle> cur_block_handle;
   BloomFilter cur_bloom;
+  // Set instead of 'cur_bloom' if the block is a SPLIT_BLOCK one.
+  unique_ptr<BlockBloomFilter> cur_split_block_bloom;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomCacheItem);
@@ -99,8 +115,24 @@ using BloomCacheTLC = ThreadLocalCache<uint64_t, BloomCacheItem>;
 ////////////////////////////////////////////////////////////
 
 BloomFileWriter::BloomFileWriter(unique_ptr<WritableBlock> block,
-                                 const BloomFilterSizing &sizing)
-  : bloom_builder_(sizing) {
+                                 const BloomFilterSizing &sizing,
+                                 BloomBlockHeaderPB::Format format)
+  : format_(format),
+    bloom_builder_(sizing),
+    split_block_log_space_bytes_(0),
+    split_block_expected_count_(0) {
+  if (format_ == BloomBlockHeaderPB::SPLIT_BLOCK) {
+    // Give SPLIT_BLOCK blocks the false positive rate of CLASSIC ones.
+    split_block_log_space_bytes_ = std::max<int>(
+        Bits::Log2Floor64(sizing.n_bytes()), kSplitBlockMinLogSpaceBytes);
+    const double bits_per_key =
+        sizing.n_bytes() * 8.0 / std::max<size_t>(1, sizing.expected_count());
+    const double fp_rate = std::exp(-bits_per_key * M_LN2 * M_LN2);
+    split_block_expected_count_ = std::max<size_t>(
+        1, BlockBloomFilter::MaxNdv(split_block_log_space_bytes_, fp_rate));
+    split_block_hashes_.reserve(split_block_expected_count_);
+  }
+
   cfile::WriterOptions opts;
   opts.write_posidx = false;
   opts.write_validx = true;
@@ -126,7 +158,7 @@ Status BloomFileWriter::Finish() {
 }
 
 Status BloomFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction) {
-  if (bloom_builder_.count() > 0) {
+  if (current_block_count() > 0) {
     RETURN_NOT_OK(FinishCurrentBloomBlock());
   }
   return writer_->FinishAndReleaseBlock(transaction);
@@ -140,16 +172,24 @@ Status BloomFileWriter::AppendKeys(
   const Slice *keys, size_t n_keys) {
 
   // If this is the call on a new bloom, copy the first key.
-  if (bloom_builder_.count() == 0 && n_keys > 0) {
+  if (current_block_count() == 0 && n_keys > 0) {
     first_key_.assign_copy(keys[0].data(), keys[0].size());
   }
 
+  const bool split_block = format_ == BloomBlockHeaderPB::SPLIT_BLOCK;
+  const size_t expected_count = split_block ?
+      split_block_expected_count_ : bloom_builder_.expected_count();
   for (size_t i = 0; i < n_keys; i++) {
 
-    bloom_builder_.AddKey(BloomKeyProbe(keys[i]));
+    BloomKeyProbe probe(keys[i]);
+    if (split_block) {
+      split_block_hashes_.emplace_back(probe.initial_hash());
+    } else {
+      bloom_builder_.AddKey(probe);
+    }
 
     // Bloom has reached optimal occupancy: flush it to the file
-    if (PREDICT_FALSE(bloom_builder_.count() >= bloom_builder_.expected_count())) {
+    if (PREDICT_FALSE(current_block_count() >= expected_count)) {
       RETURN_NOT_OK(FinishCurrentBloomBlock());
 
       // Update the last key and set the next key as the first key of the next block.
@@ -171,7 +211,23 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
 
   // Encode the header.
   BloomBlockHeaderPB hdr;
-  hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  BlockBloomFilter split_block_bloom(DefaultBlockBloomFilterBufferAllocator::GetSingleton());
+  Slice bloom_data;
+  if (format_ == BloomBlockHeaderPB::SPLIT_BLOCK) {
+    // Split-block blooms always set one bit in each of the words of a bucket.
+    hdr.set_num_hash_functions(kSplitBlockNumHashes);
+    hdr.set_format(BloomBlockHeaderPB::SPLIT_BLOCK);
+    // The keys are hashed by the writer and the reader; the hash algorithm of
+    // the filter itself is never used.
+    RETURN_NOT_OK(split_block_bloom.Init(split_block_log_space_bytes_, FAST_HASH, 0));
+    for (uint32_t hash : split_block_hashes_) {
+      split_block_bloom.Insert(hash);
+    }
+    bloom_data = split_block_bloom.directory();
+  } else {
+    hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+    bloom_data = bloom_builder_.slice();
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, static_cast<uint32_t>(hdr.ByteSizeLong()));
   pb_util::AppendToString(hdr, &hdr_str);
@@ -179,7 +235,7 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // The data is the concatenation of the header and the bloom itself.
   vector<Slice> slices;
   slices.emplace_back(hdr_str);
-  slices.push_back(bloom_builder_.slice());
+  slices.push_back(bloom_data);
 
   // Append to the file.
   Slice start_key(first_key_);
@@ -187,6 +243,7 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   RETURN_NOT_OK(writer_->AppendRawBlock(slices, 0, &start_key, last_key, "bloom block"));
 
   bloom_builder_.Clear();
+  split_block_hashes_.clear();
 
   #ifndef NDEBUG
   first_key_.assign_copy("POST_RESET");
@@ -291,6 +348,14 @@ Status BloomFileReader::ParseBlockHeader(const Slice& block,
 Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
                                         const IOContext* io_context,
                                         bool *maybe_present) {
+  const BloomKeyProbe* probe_ptr = &probe;
+  return CheckKeysPresent(ArrayView<const BloomKeyProbe* const>(&probe_ptr, 1),
+                          io_context, maybe_present);
+}
+
+Status BloomFileReader::CheckKeysPresent(ArrayView<const BloomKeyProbe* const> probes,
+                                         const IOContext* io_context,
+                                         bool* maybe_present) {
   DCHECK(init_once_.init_succeeded());
 
   // Since we frequently will access the same BloomFile many times in a row
@@ -309,38 +374,61 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
       << "Cached index reader does not match expected instance";
 
   IndexTreeIterator* index_iter = &bci->index_iter;
-  Status s = index_iter->SeekAtOrBefore(probe.key());
-  if (PREDICT_FALSE(s.IsNotFound())) {
-    // Seek to before the first entry in the file.
-    *maybe_present = false;
-    return Status::OK();
-  }
-  RETURN_NOT_OK(s);
-
-  // Successfully found the pointer to the bloom block.
-  BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
-
-  // If the previous lookup from this bloom on this thread seeked to a different
-  // block in the BloomFile, we need to read the correct block and re-hydrate the
-  // BloomFilter instance.
-  if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
-    scoped_refptr<BlockHandle> dblk_data;
-    RETURN_NOT_OK(reader_->ReadBlock(io_context, bblk_ptr,
-                                     CFileReader::CACHE_BLOCK, &dblk_data));
-
-    // Parse the header in the block.
-    BloomBlockHeaderPB hdr;
-    Slice bloom_data;
-    RETURN_NOT_OK(ParseBlockHeader(dblk_data->data(), &hdr, &bloom_data));
-
-    // Save the data back into our threadlocal cache.
-    bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions());
-    bci->cur_block_pointer = bblk_ptr;
-    bci->cur_block_handle = std::move(dblk_data);
-  }
+  for (size_t i = 0; i < probes.size(); i++) {
+    const BloomKeyProbe& probe = *probes[i];
+    Status s = index_iter->SeekAtOrBefore(probe.key());
+    if (PREDICT_FALSE(s.IsNotFound())) {
+      // Seek to before the first entry in the file.
+      maybe_present[i] = false;
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    // Successfully found the pointer to the bloom block.
+    BlockPointer bblk_ptr = index_iter->GetCurrentBlockPointer();
+
+    // If the previous lookup from this bloom on this thread seeked to a different
+    // block in the BloomFile, we need to read the correct block and re-hydrate the
+    // BloomFilter instance.
+    if (!bci->cur_block_pointer.Equals(bblk_ptr)) {
+      scoped_refptr<BlockHandle> dblk_data;
+      RETURN_NOT_OK(reader_->ReadBlock(io_context, bblk_ptr,
+                                       CFileReader::CACHE_BLOCK, &dblk_data));
+
+      // Parse the header in the block.
+      BloomBlockHeaderPB hdr;
+      Slice bloom_data;
+      RETURN_NOT_OK(ParseBlockHeader(dblk_data->data(), &hdr, &bloom_data));
+
+      // Save the data back into our threadlocal cache.
+      if (hdr.format() == BloomBlockHeaderPB::SPLIT_BLOCK) {
+        if (!bci->cur_split_block_bloom) {
+          bci->cur_split_block_bloom.reset(new BlockBloomFilter(
+              DefaultBlockBloomFilterBufferAllocator::GetSingleton()));
+        }
+        // The filter needs its directory to be aligned, so it's copied.
+        if (PREDICT_FALSE(bloom_data.empty() ||
+                          (bloom_data.size() & (bloom_data.size() - 1)) != 0)) {
+          return Status::Corruption(Substitute(
+              "invalid split-block bloom size $0 in block $1",
+              bloom_data.size(), bblk_ptr.ToString()));
+        }
+        RETURN_NOT_OK(bci->cur_split_block_bloom->InitFromDirectory(
+            Bits::Log2Floor64(bloom_data.size()), bloom_data, false, FAST_HASH, 0));
+        bci->cur_bloom = BloomFilter();
+      } else {
+        bci->cur_split_block_bloom.reset();
+        bci->cur_bloom = BloomFilter(bloom_data, hdr.num_hash_functions());
+      }
+      bci->cur_block_pointer = bblk_ptr;
+      bci->cur_block_handle = std::move(dblk_data);
+    }
 
-  // Actually check the bloom filter.
-  *maybe_present = bci->cur_bloom.MayContainKey(probe);
+    // Actually check the bloom filter.
+    maybe_present[i] = bci->cur_split_block_bloom ?
+        bci->cur_split_block_bloom->Find(probe.initial_hash()) :
+        bci->cur_bloom.MayContainKey(probe);
+  }
   return Status::OK();
 }
 
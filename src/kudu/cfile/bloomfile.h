@@ -20,10 +20,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/array_view.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/mem_tracker.h"
@@ -42,13 +45,16 @@ class WritableBlock;
 
 namespace cfile {
 
-class BloomBlockHeaderPB;
 struct ReaderOptions;
 
 class BloomFileWriter {
  public:
+  // Bloom blocks are written in 'format'. SPLIT_BLOCK blocks are sized to
+  // keep the false positive rate of CLASSIC blocks of the given 'sizing',
+  // rounding their size down to a power of two.
   BloomFileWriter(std::unique_ptr<fs::WritableBlock> block,
-                  const BloomFilterSizing &sizing);
+                  const BloomFilterSizing &sizing,
+                  BloomBlockHeaderPB::Format format = BloomBlockHeaderPB::CLASSIC);
 
   Status Start();
   Status AppendKeys(const Slice *keys, size_t n_keys);
@@ -68,10 +74,26 @@ class BloomFileWriter {
 
   Status FinishCurrentBloomBlock();
 
+  // Returns the number of keys in the current bloom block.
+  size_t current_block_count() const {
+    return format_ == BloomBlockHeaderPB::SPLIT_BLOCK ?
+        split_block_hashes_.size() : bloom_builder_.count();
+  }
+
   std::unique_ptr<cfile::CFileWriter> writer_;
 
+  const BloomBlockHeaderPB::Format format_;
+
+  // Builder of CLASSIC bloom blocks.
   BloomFilterBuilder bloom_builder_;
 
+  // Log2 of the size of SPLIT_BLOCK bloom blocks, the number of keys each
+  // holds, and the 32-bit hashes of the keys of the current block, as
+  // BlockBloomFilter takes them: see BloomKeyProbe::initial_hash().
+  int split_block_log_space_bytes_;
+  size_t split_block_expected_count_;
+  std::vector<uint32_t> split_block_hashes_;
+
   // first key inserted in the current block.
   faststring first_key_;
 
@@ -117,6 +139,15 @@ class BloomFileReader {
                          const fs::IOContext* io_context,
                          bool* maybe_present);
 
+  // Like CheckKeyPresent(), but for a batch of keys. The i-th entry of
+  // 'maybe_present' is set for the i-th probe.
+  //
+  // Probes sorted by key are checked fastest, since consecutive probes then
+  // mostly fall into the same bloom block.
+  Status CheckKeysPresent(ArrayView<const BloomKeyProbe* const> probes,
+                          const fs::IOContext* io_context,
+                          bool* maybe_present);
+
   // Can be called before Init().
   uint64_t FileSize() const {
     return reader_->file_size();
@@ -25,6 +25,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -32,6 +33,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_export.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile-test-base.h"
@@ -42,6 +44,7 @@
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock-test-util.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
@@ -82,10 +85,12 @@ class Arena;
 }  // namespace kudu
 
 DECLARE_bool(cfile_write_checksums);
+DECLARE_int32(cfile_prefetch_blocks);
 DECLARE_bool(cfile_verify_checksums);
 DECLARE_string(block_cache_type);
 DECLARE_bool(force_block_cache_capacity);
 DECLARE_int64(block_cache_capacity_mb);
+DECLARE_int64(block_cache_compressed_capacity_mb);
 DECLARE_string(nvm_cache_path);
 DECLARE_bool(nvm_cache_simulate_allocation_failure);
 
@@ -398,6 +403,80 @@ class TestCFile : public CFileTestBase {
 
     return Status::OK();
   }
+
+  // Writes a file with 'encoding' and 'compression', exports its data blocks
+  // and checks that decoding them yields the values read by a CFileIterator.
+  template<class DataGeneratorType>
+  void TestExportBlocks(DataGeneratorType* generator,
+                        EncodingType encoding,
+                        CompressionType compression) {
+    constexpr DataType kType = DataGeneratorType::kDataType;
+    const bool nullable = DataGeneratorType::has_nulls();
+    const size_t kNumRows = 10000;
+    BlockId block_id;
+    WriteTestFile(generator, encoding, compression, kNumRows, SMALL_BLOCKSIZE, &block_id);
+    unique_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+    ScopedColumnBlock<kType> expected(kNumRows, nullable);
+    unique_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    ASSERT_OK(iter->SeekToFirst());
+    SelectionVector sel(kNumRows);
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&expected, &sel);
+    size_t n = kNumRows;
+    ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+    ASSERT_EQ(kNumRows, n);
+
+    ExportedCFile exported;
+    ASSERT_OK(ExportCFile(nullptr, *reader, 0, kNumRows, &exported));
+    ASSERT_EQ(encoding, exported.encoding);
+    ASSERT_EQ(compression, exported.compression);
+    ASSERT_EQ(encoding == DICT_ENCODING, exported.dictionary.size() > 0);
+    ASSERT_GT(exported.blocks.size(), 1);
+
+    ExportedBlockDecoder decoder(&exported);
+    ASSERT_OK(decoder.Init());
+    size_t next_row = 0;
+    for (const auto& block : exported.blocks) {
+      ASSERT_EQ(next_row, block.first_row);
+      ScopedColumnBlock<kType> out(block.num_rows, nullable);
+      size_t num_rows;
+      ASSERT_OK(decoder.DecodeBlock(Slice(exported.data.data() + block.offset, block.size),
+                                    &out, &num_rows));
+      ASSERT_EQ(block.num_rows, num_rows);
+      for (size_t i = 0; i < num_rows; i++) {
+        const size_t row = block.first_row + i;
+        if (nullable) {
+          ASSERT_EQ(expected.is_null(row), out.is_null(i)) << "row " << row;
+          if (out.is_null(i)) {
+            continue;
+          }
+        }
+        ASSERT_EQ(expected[row], out[i]) << "row " << row;
+      }
+      next_row += num_rows;
+    }
+    ASSERT_EQ(kNumRows, next_row);
+
+    // The blocks are listed without being read.
+    vector<ExportedCFile::Block> blocks;
+    uint64_t dictionary_size;
+    ASSERT_OK(ListExportableBlocks(nullptr, *reader, &blocks, &dictionary_size));
+    ASSERT_EQ(exported.blocks.size(), blocks.size());
+    ASSERT_EQ(encoding == DICT_ENCODING, dictionary_size > 0);
+
+    // Only the blocks with rows of the range are exported.
+    const ExportedCFile::Block& middle = exported.blocks[exported.blocks.size() / 2];
+    ExportedCFile partial;
+    ASSERT_OK(ExportCFile(nullptr, *reader, middle.first_row,
+                          middle.first_row + middle.num_rows, &partial));
+    ASSERT_EQ(1, partial.blocks.size());
+    ASSERT_EQ(middle.first_row, partial.blocks[0].first_row);
+    ASSERT_EQ(middle.size, partial.data.size());
+  }
 };
 
 // Subclass of TestCFile which is parameterized on the block cache type.
@@ -968,6 +1047,100 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestNullDictStrings) {
   TestNullTypes(&generator, DICT_ENCODING, LZ4);
 }
 
+// Test that zone maps are written for each data block and rule out the rows
+// of the blocks which can't match a predicate.
+TEST_P(TestCFileBothCacheMemoryTypes, TestZoneMaps) {
+  RETURN_IF_NO_NVM_CACHE(GetParam());
+
+  // Write ascending values, with every tenth row NULL.
+  const int kNumRows = 10000;
+  BlockId block_id;
+  {
+    unique_ptr<WritableBlock> sink;
+    ASSERT_OK(fs_manager_->CreateNewBlock({}, &sink));
+    block_id = sink->id();
+    WriterOptions opts;
+    opts.write_posidx = true;
+    opts.write_zone_maps = true;
+    opts.storage_attributes.cfile_block_size = 1024;
+    CFileWriter w(opts, GetTypeInfo(INT32), true, std::move(sink));
+    ASSERT_OK(w.Start());
+    int32_t values[kNumRows];
+    uint8_t non_null_bitmap[BitmapSize(kNumRows)];
+    for (int i = 0; i < kNumRows; i++) {
+      values[i] = i;
+      BitmapChange(non_null_bitmap, i, i % 10 != 0);
+    }
+    ASSERT_OK(w.AppendNullableEntries(non_null_bitmap, values, kNumRows));
+    ASSERT_OK(w.Finish());
+  }
+
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+  // The zone maps should cover the whole file, in order.
+  const auto& zone_maps = reader->footer().zone_maps();
+  ASSERT_GT(zone_maps.size(), 1);
+  rowid_t next_ordinal = 0;
+  int null_count = 0;
+  for (const auto& zone_map : zone_maps) {
+    ASSERT_EQ(next_ordinal, zone_map.first_ordinal());
+    next_ordinal += zone_map.num_rows();
+    null_count += zone_map.null_count();
+    int32_t min;
+    int32_t max;
+    ASSERT_EQ(sizeof(min), zone_map.min_value().size());
+    memcpy(&min, zone_map.min_value().data(), sizeof(min));
+    memcpy(&max, zone_map.max_value().data(), sizeof(max));
+    ASSERT_LE(static_cast<int32_t>(zone_map.first_ordinal()), min);
+    ASSERT_GE(static_cast<int32_t>(zone_map.first_ordinal() + zone_map.num_rows() - 1), max);
+  }
+  ASSERT_EQ(kNumRows, next_ordinal);
+  ASSERT_EQ(kNumRows / 10, null_count);
+
+  unique_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+  ColumnSchema col("c", INT32, /*is_nullable=*/true);
+  bool may_match;
+
+  // A range in the middle of the file only matches the rows around it.
+  int32_t lower = 5001;
+  int32_t upper = 5005;
+  auto range = ColumnPredicate::Range(col, &lower, &upper);
+  ASSERT_OK(iter->MayMatch(range, 0, 100, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(iter->MayMatch(range, 4990, 100, &may_match));
+  ASSERT_TRUE(may_match);
+  ASSERT_OK(iter->MayMatch(range, 9900, 100, &may_match));
+  ASSERT_FALSE(may_match);
+
+  auto equality = ColumnPredicate::Equality(col, &lower);
+  ASSERT_OK(iter->MayMatch(equality, 0, 100, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(iter->MayMatch(equality, 5000, 10, &may_match));
+  ASSERT_TRUE(may_match);
+
+  int32_t out_of_range = kNumRows * 2;
+  vector<const void*> in_list_values = { &lower, &out_of_range };
+  auto in_list = ColumnPredicate::InList(col, &in_list_values);
+  ASSERT_OK(iter->MayMatch(in_list, 0, 100, &may_match));
+  ASSERT_FALSE(may_match);
+  ASSERT_OK(iter->MayMatch(in_list, 5000, 10, &may_match));
+  ASSERT_TRUE(may_match);
+
+  // Every block has NULLs and non-NULL values.
+  ASSERT_OK(iter->MayMatch(ColumnPredicate::IsNull(col), 0, 100, &may_match));
+  ASSERT_TRUE(may_match);
+  ASSERT_OK(iter->MayMatch(ColumnPredicate::IsNotNull(col), 0, 100, &may_match));
+  ASSERT_TRUE(may_match);
+
+  // Rows past the end of the zone maps can't be ruled out.
+  ASSERT_OK(iter->MayMatch(range, kNumRows - 10, 100, &may_match));
+  ASSERT_TRUE(may_match);
+}
+
 TEST_P(TestCFileBothCacheMemoryTypes, TestReleaseBlock) {
   RETURN_IF_NO_NVM_CACHE(GetParam());
 
@@ -1078,6 +1251,224 @@ TEST_P(TestCFileBothCacheMemoryTypes, TestCacheKeysAreStable) {
   }
 }
 
+// Test loading the data blocks at given offsets into the block cache.
+TEST_P(TestCFileBothCacheMemoryTypes, TestLoadBlocksIntoCache) {
+  RETURN_IF_NO_NVM_CACHE(GetParam());
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+  auto cache_hits = [&]() {
+    return down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value();
+  };
+
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, SMALL_BLOCKSIZE, &block_id);
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+  // Collect the pointers to the data blocks.
+  vector<BlockPointer> ptrs;
+  unique_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+  while (true) {
+    ptrs.push_back(iter->GetCurrentBlockPointer());
+    if (!iter->HasNext()) {
+      break;
+    }
+    ASSERT_OK(iter->Next());
+  }
+  ASSERT_GT(ptrs.size(), 5);
+
+  // Offsets not matching any data block are ignored.
+  std::unordered_set<uint64_t> offsets = { ptrs[2].offset(), ptrs[5].offset(),
+                                           ptrs[5].offset() + 1 };
+  int num_loaded;
+  ASSERT_OK(reader->LoadBlocksIntoCache(nullptr, offsets, []() { return true; }, &num_loaded));
+  ASSERT_EQ(2, num_loaded);
+  for (int i = 0; i < ptrs.size(); i++) {
+    int64_t hits_before = cache_hits();
+    scoped_refptr<BlockHandle> bh;
+    ASSERT_OK(reader->ReadBlock(nullptr, ptrs[i], CFileReader::CACHE_BLOCK, &bh));
+    ASSERT_EQ(i == 2 || i == 5 ? 1 : 0, cache_hits() - hits_before) << "block " << i;
+  }
+
+  // Loading stops once the callback says so.
+  Status s = reader->LoadBlocksIntoCache(nullptr, offsets, []() { return false; }, &num_loaded);
+  ASSERT_TRUE(s.IsAborted()) << s.ToString();
+  ASSERT_EQ(0, num_loaded);
+}
+
+// Test that reading several data blocks at once returns the same blocks as
+// reading them one at a time, and detects corrupt blocks.
+TEST_P(TestCFileBothCacheMemoryTypes, TestReadBlocks) {
+  RETURN_IF_NO_NVM_CACHE(GetParam());
+  FLAGS_cfile_write_checksums = true;
+  FLAGS_cfile_verify_checksums = true;
+
+  for (auto compression : { NO_COMPRESSION, LZ4 }) {
+    SCOPED_TRACE(compression);
+    BlockId block_id;
+    UInt32DataGenerator<false> generator;
+    WriteTestFile(&generator, PLAIN_ENCODING, compression, 10000, SMALL_BLOCKSIZE, &block_id);
+    unique_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    unique_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+    vector<BlockPointer> ptrs;
+    unique_ptr<IndexTreeIterator> iter(
+        IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+    while (true) {
+      ptrs.push_back(iter->GetCurrentBlockPointer());
+      if (!iter->HasNext()) {
+        break;
+      }
+      ASSERT_OK(iter->Next());
+    }
+    ASSERT_GT(ptrs.size(), 5);
+
+    // Cache some of the blocks, so that the batch mixes hits and misses.
+    scoped_refptr<BlockHandle> cached;
+    ASSERT_OK(reader->ReadBlock(nullptr, ptrs[1], CFileReader::CACHE_BLOCK, &cached));
+    vector<scoped_refptr<BlockHandle>> handles;
+    ASSERT_OK(reader->ReadBlocks(nullptr, ptrs, CFileReader::CACHE_BLOCK, &handles));
+    ASSERT_EQ(ptrs.size(), handles.size());
+    for (int i = 0; i < ptrs.size(); i++) {
+      scoped_refptr<BlockHandle> bh;
+      ASSERT_OK(reader->ReadBlock(nullptr, ptrs[i], CFileReader::DONT_CACHE_BLOCK, &bh));
+      ASSERT_EQ(bh->data(), handles[i]->data()) << "block " << i;
+    }
+
+    // Corrupt one of the data blocks; reading it in a batch fails.
+    BlockId corrupt_id;
+    ASSERT_OK(CreateCorruptBlock(fs_manager_.get(), block_id, ptrs[3].offset() + 1, 0,
+                                 &corrupt_id));
+    unique_ptr<ReadableBlock> corrupt_source;
+    ASSERT_OK(fs_manager_->OpenBlock(corrupt_id, &corrupt_source));
+    unique_ptr<CFileReader> corrupt_reader;
+    ASSERT_OK(CFileReader::Open(std::move(corrupt_source), ReaderOptions(), &corrupt_reader));
+    Status s = corrupt_reader->ReadBlocks(nullptr, ptrs, CFileReader::DONT_CACHE_BLOCK,
+                                          &handles);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+    ASSERT_STR_CONTAINS(s.ToString(), ptrs[3].ToString());
+  }
+}
+
+// Test that blocks of compressed files are first cached in the compressed
+// tier, and only cached decompressed once read again.
+TEST_P(TestCFileBothCacheMemoryTypes, TestCompressedCacheTier) {
+  RETURN_IF_NO_NVM_CACHE(GetParam());
+  FLAGS_block_cache_compressed_capacity_mb = 16;
+  Singleton<BlockCache>::UnsafeReset();
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache* cache = BlockCache::GetSingleton();
+  ASSERT_TRUE(cache->has_compressed_tier());
+  cache->StartInstrumentation(entity);
+  auto cache_hits = [&]() {
+    return down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value();
+  };
+
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, LZ4, 10000, SMALL_BLOCKSIZE, &block_id);
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+  unique_ptr<IndexTreeIterator> iter(
+      IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(iter->SeekToFirst());
+  const BlockPointer ptr = iter->GetCurrentBlockPointer();
+
+  // The first read caches the compressed block, the second one decompresses
+  // it into the uncompressed tier, where the third one finds it.
+  string first_data;
+  for (int i = 0; i < 3; i++) {
+    int64_t hits_before = cache_hits();
+    scoped_refptr<BlockHandle> bh;
+    ASSERT_OK(reader->ReadBlock(nullptr, ptr, CFileReader::CACHE_BLOCK, &bh));
+    ASSERT_EQ(i == 2 ? 1 : 0, cache_hits() - hits_before) << "read " << i;
+    if (i == 0) {
+      first_data = bh->data().ToString();
+    } else {
+      ASSERT_EQ(first_data, bh->data().ToString()) << "read " << i;
+    }
+  }
+}
+
+// Test that preparing a batch reads the following data blocks into the cache.
+TEST_P(TestCFileBothCacheMemoryTypes, TestPrefetchBlocks) {
+  RETURN_IF_NO_NVM_CACHE(GetParam());
+  const int kPrefetchBlocks = 4;
+  FLAGS_cfile_prefetch_blocks = kPrefetchBlocks;
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+  auto cache_hits = [&]() {
+    return down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value();
+  };
+
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, SMALL_BLOCKSIZE, &block_id);
+  unique_ptr<ReadableBlock> source;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+  unique_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+  {
+    unique_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+    ASSERT_OK(iter->SeekToFirst());
+    size_t n = 1;
+    ASSERT_OK(iter->PrepareBatch(&n));
+    ASSERT_OK(iter->FinishBatch());
+    // Destroying the iterator waits for its prefetches to complete.
+  }
+
+  // The blocks following the first one should now be cached, up to the number
+  // of blocks prefetched.
+  unique_ptr<IndexTreeIterator> idx_iter(
+      IndexTreeIterator::Create(nullptr, reader.get(), reader->posidx_root()));
+  ASSERT_OK(idx_iter->SeekToFirst());
+  for (int i = 1; i <= kPrefetchBlocks + 1; i++) {
+    ASSERT_OK(idx_iter->Next());
+    int64_t hits_before = cache_hits();
+    scoped_refptr<BlockHandle> bh;
+    ASSERT_OK(reader->ReadBlock(nullptr, idx_iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK, &bh));
+    ASSERT_EQ(i <= kPrefetchBlocks ? 1 : 0, cache_hits() - hits_before) << "block " << i;
+  }
+
+  // Scanning with prefetching returns the same data.
+  unique_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, nullptr));
+  ASSERT_OK(iter->SeekToFirst());
+  ScopedColumnBlock<UINT32> out(100);
+  SelectionVector sel(100);
+  UInt32DataGenerator<false> expected;
+  for (int row = 0; iter->HasNext(); row += 100) {
+    size_t n = 100;
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&out, &sel);
+    ASSERT_OK_FAST(iter->CopyNextValues(&n, &ctx));
+    ASSERT_EQ(100, n);
+    for (int i = 0; i < n; i++) {
+      ASSERT_EQ(expected.BuildTestValue(0, row + i), out[i]) << "row " << row + i;
+    }
+  }
+}
+
 // Inject failures in nvm allocation and ensure that we can still read a file.
 TEST_P(TestCFileBothCacheMemoryTypes, TestNvmAllocationFailure) {
   if (GetParam() != Cache::MemoryType::NVM) return;
@@ -1131,5 +1522,27 @@ TEST_P(TestCFileDifferentCodecs, TestUncompressible) {
   }
 }
 
+// Test that the exported data blocks of files decode to the values of the
+// files, whatever their encoding.
+TEST_P(TestCFileDifferentCodecs, TestExportBlocks) {
+  const auto codec = GetParam();
+  {
+    UInt32DataGenerator<true> generator;
+    NO_FATALS(TestExportBlocks(&generator, BIT_SHUFFLE, codec));
+  }
+  {
+    Int64DataGenerator<false> generator;
+    NO_FATALS(TestExportBlocks(&generator, RLE, codec));
+  }
+  {
+    StringDataGenerator<true> generator("hello %zu");
+    NO_FATALS(TestExportBlocks(&generator, PREFIX_ENCODING, codec));
+  }
+  {
+    DuplicateStringDataGenerator<true> generator("hello %zu", 100);
+    NO_FATALS(TestExportBlocks(&generator, DICT_ENCODING, codec));
+  }
+}
+
 } // namespace cfile
 } // namespace kudu
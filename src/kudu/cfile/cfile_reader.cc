@@ -19,8 +19,10 @@
 
 #include <algorithm>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <ostream>
+#include <unordered_set>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -43,10 +45,13 @@
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/rowid.h"
 #include "kudu/common/types.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/io_context.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/basictypes.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -68,6 +73,7 @@
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
@@ -83,11 +89,28 @@ DEFINE_double(cfile_inject_corruption, 0,
               "with a corruption status");
 TAG_FLAG(cfile_inject_corruption, hidden);
 
+DEFINE_int32(cfile_prefetch_blocks, 0,
+             "Number of upcoming data blocks of each column to read ahead of the scan into "
+             "the block cache, so that the IO of the later blocks overlaps with the decoding "
+             "of the current ones. Reads are issued from a dedicated thread pool. Only "
+             "applies to scans which cache the blocks they read. If 0, data blocks are only "
+             "read when the scan reaches them.");
+TAG_FLAG(cfile_prefetch_blocks, advanced);
+TAG_FLAG(cfile_prefetch_blocks, experimental);
+TAG_FLAG(cfile_prefetch_blocks, runtime);
+
+DEFINE_int32(cfile_prefetch_num_threads, 8,
+             "Maximum number of threads used to prefetch CFile data blocks. "
+             "See --cfile_prefetch_blocks.");
+TAG_FLAG(cfile_prefetch_num_threads, advanced);
+TAG_FLAG(cfile_prefetch_num_threads, experimental);
+
 using kudu::fault_injection::MaybeTrue;
 using kudu::fs::ErrorHandlerType;
 using kudu::fs::IOContext;
 using kudu::fs::ReadableBlock;
 using kudu::pb_util::SecureDebugString;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -97,6 +120,25 @@ using strings::Substitute;
 namespace kudu {
 namespace cfile {
 
+namespace {
+
+// Returns the thread pool shared by all CFileIterators for prefetching data
+// blocks, creating it on first use.
+ThreadPool* PrefetchPool() {
+  // Intentionally leaked: iterators may still be prefetching at exit.
+  static ThreadPool* pool = []() {
+    unique_ptr<ThreadPool> p;
+    CHECK_OK(ThreadPoolBuilder("cfile-prefetch")
+             .set_min_threads(0)
+             .set_max_threads(FLAGS_cfile_prefetch_num_threads)
+             .Build(&p));
+    return p.release();
+  }();
+  return pool;
+}
+
+} // anonymous namespace
+
 const char* CFILE_CACHE_MISS_BYTES_METRIC_NAME = "cfile_cache_miss_bytes";
 const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME = "cfile_cache_hit_bytes";
 
@@ -330,11 +372,15 @@ bool CFileReader::has_checksums() const {
 }
 
 Status CFileReader::VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const {
-  uint32_t expected_checksum = DecodeFixed32(checksum.data());
   uint32_t checksum_value = 0;
   for (auto& d : data) {
     checksum_value = crc::Crc32c(d.data(), d.size(), checksum_value);
   }
+  return CheckChecksum(checksum_value, checksum);
+}
+
+Status CFileReader::CheckChecksum(uint32_t checksum_value, const Slice& checksum) const {
+  uint32_t expected_checksum = DecodeFixed32(checksum.data());
   if (PREDICT_FALSE(checksum_value != expected_checksum ||
                     MaybeTrue(FLAGS_cfile_inject_corruption))) {
     return Status::Corruption(
@@ -344,8 +390,6 @@ Status CFileReader::VerifyChecksum(ArrayView<const Slice> data, const Slice& che
   return Status::OK();
 }
 
-namespace {
-
 // ScratchMemory acts as a holder for the destination buffer for a block read.
 // The buffer itself could either be allocated on the heap or be the value of
 // a pending block cache entry.
@@ -373,9 +417,10 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size,
+                            BlockCache::Tier tier = BlockCache::Tier::UNCOMPRESSED) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, size, tier);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -429,13 +474,15 @@ class ScratchMemory {
   int size_;
   DISALLOW_COPY_AND_ASSIGN(ScratchMemory);
 };
-} // anonymous namespace
 
 Status CFileReader::ReadBlock(const IOContext* io_context,
                               const BlockPointer& ptr,
                               CacheControl cache_control,
-                              scoped_refptr<BlockHandle>* ret) const {
+                              scoped_refptr<BlockHandle>* ret,
+                              bool* read_from_disk) const {
   DCHECK(init_once_.init_succeeded());
+  fs::ScopedIOPriority io_priority(
+      io_context ? io_context->priority : fs::ScopedIOPriority::Current());
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
     "bad offset " << ptr.ToString() << " in file of size "
@@ -450,59 +497,108 @@ Status CFileReader::ReadBlock(const IOContext* io_context,
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
     *ret = BlockHandle::WithDataFromCache(std::move(bc_handle));
     // Cache hit
+    if (read_from_disk) {
+      *read_from_disk = false;
+    }
     return Status::OK();
   }
 
-  // Cache miss: need to read ourselves.
-  // We issue trace events only in the cache miss case since we expect the
-  // tracing overhead to be small compared to the IO (even if it's a memcpy
-  // from the Linux cache).
-  TRACE_EVENT1("io", "CFileReader::ReadBlock(cache miss)",
-               "cfile", ToString());
-  TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
-  TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
-
-  uint32_t data_size = ptr.size();
-  if (has_checksums()) {
-    if (PREDICT_FALSE(kChecksumSize > data_size)) {
-      return Status::Corruption("invalid data size for block pointer",
-                                ptr.ToString());
-    }
-    data_size -= kChecksumSize;
+  // Blocks of compressed files may also be cached in their compressed form.
+  // Such blocks are only decompressed into the block cache once hit in the
+  // compressed tier, so only the blocks which are read repeatedly take the
+  // space of their decompressed form.
+  const bool use_compressed_tier =
+      codec_ != nullptr && cache_control == CACHE_BLOCK && cache->has_compressed_tier();
+  BlockCacheHandle compressed_handle;
+  bool compressed_hit = false;
+  if (use_compressed_tier) {
+    compressed_hit = cache->Lookup(key, cache_behavior, &compressed_handle,
+                                   BlockCache::Tier::COMPRESSED);
   }
 
   ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, data_size);
-  } else {
-    scratch.AllocateFromHeap(data_size);
+  Slice block;
+  if (read_from_disk) {
+    *read_from_disk = !compressed_hit;
   }
-  uint8_t* buf = scratch.get();
-  Slice block(buf, data_size);
-  uint8_t checksum_scratch[kChecksumSize];
-  Slice checksum(checksum_scratch, kChecksumSize);
+  if (compressed_hit) {
+    TRACE_COUNTER_INCREMENT("cfile_compressed_cache_hit", 1);
+    block = compressed_handle.data();
+  } else {
+    // Cache miss: need to read ourselves.
+    // We issue trace events only in the cache miss case since we expect the
+    // tracing overhead to be small compared to the IO (even if it's a memcpy
+    // from the Linux cache).
+    TRACE_EVENT1("io", "CFileReader::ReadBlock(cache miss)",
+                 "cfile", ToString());
+    TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
+    TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
+
+    uint32_t data_size = ptr.size();
+    if (has_checksums()) {
+      if (PREDICT_FALSE(kChecksumSize > data_size)) {
+        return Status::Corruption("invalid data size for block pointer",
+                                  ptr.ToString());
+      }
+      data_size -= kChecksumSize;
+    }
 
-  // Read the data and checksum if needed.
-  Slice results_backing[] = { block, checksum };
-  bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
-  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
-  RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
-                        Substitute("failed to read CFile block $0 at $1",
-                                   block_id().ToString(), ptr.ToString()));
+    // If we are reading uncompressed data and plan to cache the result,
+    // then we should allocate our scratch memory directly from the cache.
+    // This avoids an extra memory copy in the case of an NVM cache.
+    // Likewise for compressed data which is to be cached in the compressed tier.
+    if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
+      scratch.TryAllocateFromCache(cache, key, data_size);
+    } else if (use_compressed_tier) {
+      scratch.TryAllocateFromCache(cache, key, data_size, BlockCache::Tier::COMPRESSED);
+    } else {
+      scratch.AllocateFromHeap(data_size);
+    }
+    block = Slice(scratch.get(), data_size);
+    uint8_t checksum_scratch[kChecksumSize];
+    Slice checksum(checksum_scratch, kChecksumSize);
+
+    // Read the data and checksum if needed.
+    Slice results_backing[] = { block, checksum };
+    bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
+    ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
+    RETURN_NOT_OK_PREPEND(block_->ReadV(ptr.offset(), results),
+                          Substitute("failed to read CFile block $0 at $1",
+                                     block_id().ToString(), ptr.ToString()));
+
+    if (has_checksums() && FLAGS_cfile_verify_checksums) {
+      Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
+      if (!s.ok()) {
+        RETURN_NOT_OK_HANDLE_CORRUPTION(
+            s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                         block_id().ToString(), ptr.ToString())),
+            HandleCorruption(io_context));
+      }
+    }
 
-  if (has_checksums() && FLAGS_cfile_verify_checksums) {
-    Status s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
-    if (!s.ok()) {
-      RETURN_NOT_OK_HANDLE_CORRUPTION(
-          s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
-                                       block_id().ToString(), ptr.ToString())),
-          HandleCorruption(io_context));
+    if (use_compressed_tier && scratch.IsFromCache()) {
+      // Hand the compressed block over to the compressed tier. The handle
+      // keeps it alive while it's decompressed below.
+      cache->Insert(scratch.mutable_pending_entry(), &compressed_handle);
+      ignore_result(scratch.release());
+      block = compressed_handle.data();
     }
   }
 
+  return FinishReadBlock(ptr, cache_control, !use_compressed_tier || compressed_hit,
+                         block, &scratch, ret);
+}
+
+Status CFileReader::FinishReadBlock(const BlockPointer& ptr,
+                                    CacheControl cache_control,
+                                    bool cache_decompressed,
+                                    Slice block,
+                                    ScratchMemory* scratch,
+                                    scoped_refptr<BlockHandle>* ret) const {
+  BlockCache* cache = BlockCache::GetSingleton();
+  BlockCache::CacheKey key(block_->id(), ptr.offset());
+  BlockCacheHandle bc_handle;
+
   // Decompress the block
   if (codec_ != nullptr) {
     // Init the decompressor and get the size required for the uncompressed buffer.
@@ -518,8 +614,10 @@ Status CFileReader::ReadBlock(const IOContext* io_context,
 
     // If we plan to put the uncompressed block in the cache, we should
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
+    // Blocks just read into the compressed tier are not cached decompressed
+    // until they are read again.
     ScratchMemory decompressed_scratch;
-    if (cache_control == CACHE_BLOCK) {
+    if (cache_control == CACHE_BLOCK && cache_decompressed) {
       decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
     } else {
       decompressed_scratch.AllocateFromHeap(uncompressed_size);
@@ -535,36 +633,279 @@ Status CFileReader::ReadBlock(const IOContext* io_context,
     // Now that we've decompressed, we don't need to keep holding onto the original
     // scratch buffer. Instead, we have to start holding onto our decompression
     // output buffer.
-    scratch.Swap(&decompressed_scratch);
+    scratch->Swap(&decompressed_scratch);
 
     // Set the result block to our decompressed data.
-    block = Slice(buf, uncompressed_size);
+    block = scratch->as_slice();
   }
 
   // It's possible that one of the TryAllocateFromCache() calls above
   // failed, in which case we don't insert it into the cache regardless
   // of what the user requested. The scratch memory includes both the
   // generated key and the data read from disk.
-  if (cache_control == CACHE_BLOCK && scratch.IsFromCache()) {
-    cache->Insert(scratch.mutable_pending_entry(), &bc_handle);
+  if (cache_control == CACHE_BLOCK && scratch->IsFromCache()) {
+    cache->Insert(scratch->mutable_pending_entry(), &bc_handle);
     *ret = BlockHandle::WithDataFromCache(std::move(bc_handle));
   } else {
     // We get here by either not intending to cache the block or
     // if the entry could not be allocated from the block cache.
     // Since we allocate memory to include the key for the cache entry
     // we must reset the block.
-    DCHECK_EQ(block.data(), buf);
-    DCHECK(!scratch.IsFromCache());
-    *ret = BlockHandle::WithOwnedData(scratch.as_slice());
+    DCHECK_EQ(block.data(), scratch->get());
+    DCHECK(!scratch->IsFromCache());
+    *ret = BlockHandle::WithOwnedData(scratch->as_slice());
   }
 
   // The cache or the BlockHandle now has ownership over the memory, so release
   // the scoped pointer.
-  ignore_result(scratch.release());
+  ignore_result(scratch->release());
+
+  return Status::OK();
+}
+
+Status CFileReader::ReadBlocks(const IOContext* io_context,
+                               ArrayView<const BlockPointer> ptrs,
+                               CacheControl cache_control,
+                               vector<scoped_refptr<BlockHandle>>* ret) const {
+  DCHECK(init_once_.init_succeeded());
+  fs::ScopedIOPriority io_priority(
+      io_context ? io_context->priority : fs::ScopedIOPriority::Current());
+  ret->clear();
+  ret->resize(ptrs.size());
+  BlockCache* cache = BlockCache::GetSingleton();
+
+  // Blocks which go through the compressed tier are cached in two steps; leave
+  // them to ReadBlock().
+  if (codec_ != nullptr && cache_control == CACHE_BLOCK && cache->has_compressed_tier()) {
+    for (size_t i = 0; i < ptrs.size(); i++) {
+      RETURN_NOT_OK(ReadBlock(io_context, ptrs[i], cache_control, &(*ret)[i]));
+    }
+    return Status::OK();
+  }
+
+  // Serve what we can from the cache. Blocks in the cache were verified when
+  // they were read, so they're not checksummed again.
+  Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
+      Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
+  vector<size_t> misses;
+  for (size_t i = 0; i < ptrs.size(); i++) {
+    const BlockPointer& ptr = ptrs[i];
+    CHECK(ptr.offset() > 0 &&
+          ptr.offset() + ptr.size() < file_size_) <<
+      "bad offset " << ptr.ToString() << " in file of size "
+                    << file_size_;
+    BlockCacheHandle bc_handle;
+    BlockCache::CacheKey key(block_->id(), ptr.offset());
+    if (cache->Lookup(key, cache_behavior, &bc_handle)) {
+      TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
+      TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
+      (*ret)[i] = BlockHandle::WithDataFromCache(std::move(bc_handle));
+    } else {
+      misses.push_back(i);
+    }
+  }
+  if (misses.empty()) {
+    return Status::OK();
+  }
+  TRACE_EVENT1("io", "CFileReader::ReadBlocks(cache miss)",
+               "cfile", ToString());
+
+  // Allocate the buffers of the missed blocks the same way ReadBlock() does.
+  const size_t num_misses = misses.size();
+  unique_ptr<ScratchMemory[]> scratches(new ScratchMemory[num_misses]);
+  vector<Slice> blocks(num_misses);
+  unique_ptr<uint8_t[]> checksums_scratch(new uint8_t[num_misses * kChecksumSize]);
+  vector<Slice> checksums(num_misses);
+  for (size_t j = 0; j < num_misses; j++) {
+    const BlockPointer& ptr = ptrs[misses[j]];
+    TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
+    TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
+    uint32_t data_size = ptr.size();
+    if (has_checksums()) {
+      if (PREDICT_FALSE(kChecksumSize > data_size)) {
+        return Status::Corruption("invalid data size for block pointer",
+                                  ptr.ToString());
+      }
+      data_size -= kChecksumSize;
+    }
+    if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
+      BlockCache::CacheKey key(block_->id(), ptr.offset());
+      scratches[j].TryAllocateFromCache(cache, key, data_size);
+    } else {
+      scratches[j].AllocateFromHeap(data_size);
+    }
+    blocks[j] = Slice(scratches[j].get(), data_size);
+    checksums[j] = Slice(&checksums_scratch[j * kChecksumSize], kChecksumSize);
+  }
+
+  // Read each run of blocks which are adjacent in the file, along with their
+  // checksums, with a single ReadV().
+  vector<Slice> results;
+  size_t run_start = 0;
+  for (size_t j = 0; j < num_misses; j++) {
+    const BlockPointer& ptr = ptrs[misses[j]];
+    results.push_back(blocks[j]);
+    if (has_checksums()) {
+      results.push_back(checksums[j]);
+    }
+    if (j + 1 < num_misses && ptrs[misses[j + 1]].offset() == ptr.offset() + ptr.size()) {
+      continue;
+    }
+    const BlockPointer& first = ptrs[misses[run_start]];
+    RETURN_NOT_OK_PREPEND(block_->ReadV(first.offset(), results),
+                          Substitute("failed to read CFile blocks $0 at $1",
+                                     block_id().ToString(), first.ToString()));
+    results.clear();
+    run_start = j + 1;
+  }
+
+  // Verify all the checksums at once.
+  if (has_checksums() && FLAGS_cfile_verify_checksums) {
+    vector<uint32_t> crcs(num_misses);
+    crc::Crc32cBatch(blocks, crcs.data());
+    for (size_t j = 0; j < num_misses; j++) {
+      Status s = CheckChecksum(crcs[j], checksums[j]);
+      if (!s.ok()) {
+        RETURN_NOT_OK_HANDLE_CORRUPTION(
+            s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                         block_id().ToString(), ptrs[misses[j]].ToString())),
+            HandleCorruption(io_context));
+      }
+    }
+  }
+
+  for (size_t j = 0; j < num_misses; j++) {
+    RETURN_NOT_OK(FinishReadBlock(ptrs[misses[j]], cache_control, /*cache_decompressed=*/true,
+                                  blocks[j], &scratches[j], &(*ret)[misses[j]]));
+  }
+  return Status::OK();
+}
+
+Status CFileReader::ReadRawBlock(const IOContext* io_context,
+                                 const BlockPointer& ptr,
+                                 faststring* dst) const {
+  DCHECK(init_once_.init_succeeded());
+  fs::ScopedIOPriority io_priority(
+      io_context ? io_context->priority : fs::ScopedIOPriority::Current());
+  if (PREDICT_FALSE(ptr.offset() == 0 || ptr.offset() + ptr.size() >= file_size_)) {
+    return Status::Corruption(Substitute("bad offset $0 in file of size $1",
+                                         ptr.ToString(), file_size_));
+  }
+  uint32_t data_size = ptr.size();
+  if (has_checksums()) {
+    if (PREDICT_FALSE(kChecksumSize > data_size)) {
+      return Status::Corruption("invalid data size for block pointer",
+                                ptr.ToString());
+    }
+    data_size -= kChecksumSize;
+  }
+
+  const size_t old_size = dst->size();
+  dst->resize(old_size + data_size);
+  Slice block(dst->data() + old_size, data_size);
+  uint8_t checksum_scratch[kChecksumSize];
+  Slice checksum(checksum_scratch, kChecksumSize);
+  Slice results_backing[] = { block, checksum };
+  const bool read_checksum = has_checksums() && FLAGS_cfile_verify_checksums;
+  ArrayView<Slice> results(results_backing, read_checksum ? 2 : 1);
+  Status s = block_->ReadV(ptr.offset(), results);
+  if (PREDICT_FALSE(!s.ok())) {
+    dst->resize(old_size);
+    return s.CloneAndPrepend(Substitute("failed to read CFile block $0 at $1",
+                                        block_id().ToString(), ptr.ToString()));
+  }
+  if (read_checksum) {
+    s = VerifyChecksum(ArrayView<const Slice>(&block, 1), checksum);
+    if (!s.ok()) {
+      dst->resize(old_size);
+      RETURN_NOT_OK_HANDLE_CORRUPTION(
+          s.CloneAndPrepend(Substitute("checksum error on CFile block $0 at $1",
+                                       block_id().ToString(), ptr.ToString())),
+          HandleCorruption(io_context));
+    }
+  }
+  return Status::OK();
+}
 
+Status CFileReader::GetDataBlocks(const IOContext* io_context,
+                                  vector<pair<rowid_t, BlockPointer>>* blocks) const {
+  DCHECK(init_once_.init_succeeded());
+  blocks->clear();
+  if (!has_posidx()) {
+    return Status::NotSupported("cfile has no positional index", ToString());
+  }
+  if (footer().num_values() == 0) {
+    return Status::OK();
+  }
+  unique_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(
+      io_context, this, posidx_root()));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  while (true) {
+    Slice key = iter->GetCurrentKey();
+    rowid_t first_row;
+    Status s = KeyEncoderTraits<UINT32, faststring>::DecodeKeyPortion(
+        &key, /*is_last=*/true, /*arena=*/nullptr, reinterpret_cast<uint8_t*>(&first_row));
+    RETURN_NOT_OK_PREPEND(s, "bad positional index key");
+    blocks->emplace_back(first_row, iter->GetCurrentBlockPointer());
+    if (!iter->HasNext()) {
+      break;
+    }
+    RETURN_NOT_OK(iter->Next());
+  }
   return Status::OK();
 }
 
+Status CFileReader::LoadBlocksIntoCache(const IOContext* io_context,
+                                        const std::unordered_set<uint64_t>& offsets,
+                                        const std::function<bool()>& before_read,
+                                        int* num_loaded) const {
+  DCHECK(init_once_.init_succeeded());
+  *num_loaded = 0;
+  if (offsets.empty() || (!has_posidx() && !has_validx())) {
+    return Status::OK();
+  }
+  // The data blocks are read in batches, so that adjacent blocks are read
+  // and verified together.
+  const size_t kMaxBlocksPerBatch = 32;
+  vector<BlockPointer> batch;
+  vector<scoped_refptr<BlockHandle>> handles;
+  const auto read_batch = [&]() {
+    RETURN_NOT_OK(ReadBlocks(io_context, batch, CACHE_BLOCK, &handles));
+    *num_loaded += batch.size();
+    batch.clear();
+    handles.clear();
+    return Status::OK();
+  };
+
+  // Both indexes point to all the data blocks; iterating over either one
+  // also reads its index blocks into the cache.
+  unique_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(
+      io_context, this, has_posidx() ? posidx_root() : validx_root()));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  size_t num_remaining = offsets.size();
+  while (true) {
+    const BlockPointer& ptr = iter->GetCurrentBlockPointer();
+    if (ContainsKey(offsets, ptr.offset())) {
+      if (!before_read()) {
+        RETURN_NOT_OK(read_batch());
+        return Status::Aborted("stopped loading blocks into the cache");
+      }
+      batch.push_back(ptr);
+      if (batch.size() == kMaxBlocksPerBatch) {
+        RETURN_NOT_OK(read_batch());
+      }
+      if (--num_remaining == 0) {
+        break;
+      }
+    }
+    if (!iter->HasNext()) {
+      break;
+    }
+    RETURN_NOT_OK(iter->Next());
+  }
+  return read_batch();
+}
+
 Status CFileReader::CountRows(rowid_t *count) const {
   *count = footer().num_values();
   return Status::OK();
@@ -682,7 +1023,11 @@ CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control,
                              const IOContext* io_context)
   : reader_(reader),
+    all_codewords_match_pred_(false),
     seeked_(nullptr),
+    prefetch_iter_source_(nullptr),
+    prefetch_seeked_(false),
+    prefetch_ahead_(0),
     prepared_(false),
     cache_control_(cache_control),
     last_prepare_idx_(-1),
@@ -691,6 +1036,10 @@ CFileIterator::CFileIterator(CFileReader* reader,
 }
 
 CFileIterator::~CFileIterator() {
+  // Wait for any in-flight prefetches, which reference the reader and the IO context.
+  if (prefetch_token_) {
+    prefetch_token_->Shutdown();
+  }
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -807,6 +1156,14 @@ Status CFileIterator::SeekToFirst() {
 
 Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
                                     bool *exact_match) {
+  // Seeks in increasing key order, e.g. for a batch of key presence checks,
+  // often land in the data block prepared by the previous seek. Hold on to
+  // that block so it doesn't have to be read and decoded again.
+  pblock_pool_scoped_ptr prev_block = prepared_block_pool_.make_scoped_ptr(nullptr);
+  if (prepared_blocks_.size() == 1) {
+    prev_block.reset(prepared_blocks_[0]);
+    prepared_blocks_.clear();
+  }
   RETURN_NOT_OK(PrepareForNewSeek());
   DCHECK_EQ(reader_->is_nullable(), false);
 
@@ -825,9 +1182,18 @@ Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
   }
   RETURN_NOT_OK(s);
 
-  pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(
-    prepared_block_pool_.Construct());
-  RETURN_NOT_OK(ReadCurrentDataBlock(*validx_iter_, b.get()));
+  pblock_pool_scoped_ptr b = prepared_block_pool_.make_scoped_ptr(nullptr);
+  if (prev_block && prev_block->dblk_ptr_.Equals(validx_iter_->GetCurrentBlockPointer())) {
+    // The seek within the block below is absolute, so only the bookkeeping
+    // of the block's previous position needs to be reset.
+    b = std::move(prev_block);
+    b->idx_in_block_ = 0;
+    b->needs_rewind_ = false;
+    b->rewind_idx_ = 0;
+  } else {
+    b.reset(prepared_block_pool_.Construct());
+    RETURN_NOT_OK(ReadCurrentDataBlock(*validx_iter_, b.get()));
+  }
 
   Status dblk_seek_status;
   if (key.num_key_columns() > 1) {
@@ -868,6 +1234,232 @@ Status CFileIterator::SeekAtOrAfter(const EncodedKey &key,
   return Status::OK();
 }
 
+namespace {
+
+// Points 'min' and 'max' at the bounds of the values summarized by
+// 'zone_map', backed by 'min_slice' and 'max_slice'. Returns false if the zone
+// map has no usable bounds.
+bool GetZoneMapBounds(const TypeInfo* type_info,
+                      const ZoneMapPB& zone_map,
+                      Slice* min_slice,
+                      Slice* max_slice,
+                      const void** min,
+                      const void** max) {
+  if (!zone_map.has_min_value() || !zone_map.has_max_value()) {
+    return false;
+  }
+  *min_slice = Slice(zone_map.min_value());
+  *max_slice = Slice(zone_map.max_value());
+  const bool is_binary = type_info->physical_type() == BINARY;
+  if (!is_binary && (min_slice->size() != type_info->size() ||
+                     max_slice->size() != type_info->size())) {
+    return false;
+  }
+  *min = is_binary ? static_cast<const void*>(min_slice) : min_slice->data();
+  *max = is_binary ? static_cast<const void*>(max_slice) : max_slice->data();
+  return true;
+}
+
+// Returns false if no row summarized by 'zone_map' can satisfy 'pred'.
+bool ZoneMapMayMatch(const TypeInfo* type_info,
+                     const ZoneMapPB& zone_map,
+                     const ColumnPredicate& pred) {
+  const uint32_t num_non_null = zone_map.num_rows() - zone_map.null_count();
+  switch (pred.predicate_type()) {
+    case PredicateType::None:
+      return false;
+    case PredicateType::IsNull:
+      return zone_map.null_count() > 0;
+    case PredicateType::IsNotNull:
+      return num_non_null > 0;
+    default:
+      break;
+  }
+  // The remaining predicates never match NULLs.
+  if (num_non_null == 0) {
+    return false;
+  }
+  Slice min_slice;
+  Slice max_slice;
+  const void* min;
+  const void* max;
+  if (!GetZoneMapBounds(type_info, zone_map, &min_slice, &max_slice, &min, &max)) {
+    return true;
+  }
+
+  switch (pred.predicate_type()) {
+    case PredicateType::Equality:
+      return type_info->Compare(min, pred.raw_lower()) <= 0 &&
+             type_info->Compare(max, pred.raw_lower()) >= 0;
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter:
+      // Bloom filter predicates may also carry range bounds.
+      return (pred.raw_lower() == nullptr || type_info->Compare(max, pred.raw_lower()) >= 0) &&
+             (pred.raw_upper() == nullptr || type_info->Compare(min, pred.raw_upper()) < 0);
+    case PredicateType::InList: {
+      // The values are sorted: look for the first one which isn't below 'min'.
+      const auto& values = pred.raw_values();
+      auto it = std::lower_bound(values.begin(), values.end(), min,
+                                 [&](const void* lhs, const void* rhs) {
+                                   return type_info->Compare(lhs, rhs) < 0;
+                                 });
+      return it != values.end() && type_info->Compare(*it, max) <= 0;
+    }
+    default:
+      return true;
+  }
+}
+
+} // anonymous namespace
+
+Status CFileReader::GetMaxValue(const IOContext* io_context, string* max, bool* has_max) {
+  RETURN_NOT_OK(Init(io_context));
+  *has_max = false;
+  if (type_info_->physical_type() == BINARY) {
+    return Status::OK();
+  }
+  const auto& zone_maps = footer().zone_maps();
+  int64_t num_rows = 0;
+  string result;
+  for (const auto& zone_map : zone_maps) {
+    num_rows += zone_map.num_rows();
+    if (zone_map.num_rows() == zone_map.null_count()) {
+      continue;
+    }
+    Slice min_slice;
+    Slice max_slice;
+    const void* min;
+    const void* max_value;
+    if (!GetZoneMapBounds(type_info_, zone_map, &min_slice, &max_slice, &min, &max_value)) {
+      return Status::OK();
+    }
+    if (result.empty() || type_info_->Compare(max_value, result.data()) > 0) {
+      result.assign(reinterpret_cast<const char*>(max_slice.data()), max_slice.size());
+    }
+  }
+  // Every row must be covered by a zone map.
+  if (result.empty() || num_rows != footer().num_values()) {
+    return Status::OK();
+  }
+  *max = std::move(result);
+  *has_max = true;
+  return Status::OK();
+}
+
+Status CFileReader::NarrowSortedOrdinalRange(const ColumnPredicate& pred,
+                                             const IOContext* io_context,
+                                             rowid_t* lower_bound,
+                                             rowid_t* upper_bound) {
+  RETURN_NOT_OK(Init(io_context));
+  const auto& zone_maps = footer().zone_maps();
+  if (zone_maps.empty() ||
+      pred.column().type_info()->physical_type() != type_info_->physical_type()) {
+    return Status::OK();
+  }
+  const void* lower;
+  const void* upper;
+  bool upper_inclusive;
+  switch (pred.predicate_type()) {
+    case PredicateType::Equality:
+      lower = pred.raw_lower();
+      upper = pred.raw_lower();
+      upper_inclusive = true;
+      break;
+    case PredicateType::Range:
+      lower = pred.raw_lower();
+      upper = pred.raw_upper();
+      upper_inclusive = false;
+      break;
+    default:
+      return Status::OK();
+  }
+
+  // Since the values are sorted, so are the bounds of the blocks. The search
+  // gives up if it probes a block without usable bounds.
+  bool searchable = true;
+  const auto block_before_lower = [&](const ZoneMapPB& zone_map) {
+    Slice min_slice;
+    Slice max_slice;
+    const void* min;
+    const void* max;
+    if (!GetZoneMapBounds(type_info_, zone_map, &min_slice, &max_slice, &min, &max)) {
+      searchable = false;
+      return false;
+    }
+    return type_info_->Compare(max, lower) < 0;
+  };
+  const auto block_before_upper = [&](const ZoneMapPB& zone_map) {
+    Slice min_slice;
+    Slice max_slice;
+    const void* min;
+    const void* max;
+    if (!GetZoneMapBounds(type_info_, zone_map, &min_slice, &max_slice, &min, &max)) {
+      searchable = false;
+      return false;
+    }
+    const int cmp = type_info_->Compare(min, upper);
+    return upper_inclusive ? cmp <= 0 : cmp < 0;
+  };
+
+  rowid_t new_lower = *lower_bound;
+  rowid_t new_upper = *upper_bound;
+  if (lower) {
+    auto it = std::partition_point(zone_maps.begin(), zone_maps.end(), block_before_lower);
+    new_lower = it == zone_maps.end() ? *upper_bound : it->first_ordinal();
+  }
+  if (upper) {
+    auto it = std::partition_point(zone_maps.begin(), zone_maps.end(), block_before_upper);
+    if (it != zone_maps.end()) {
+      new_upper = it->first_ordinal();
+    }
+  }
+  if (!searchable) {
+    return Status::OK();
+  }
+  *upper_bound = std::min(*upper_bound, new_upper);
+  *lower_bound = std::min(std::max(*lower_bound, new_lower), *upper_bound);
+  return Status::OK();
+}
+
+Status CFileIterator::MayMatch(const ColumnPredicate& pred,
+                               rowid_t ord_idx,
+                               size_t n,
+                               bool* may_match) {
+  *may_match = true;
+  RETURN_NOT_OK(reader_->Init(io_context_));
+
+  const auto& zone_maps = reader_->footer().zone_maps();
+  const TypeInfo* type_info = reader_->type_info();
+  if (zone_maps.empty() || n == 0 ||
+      pred.column().type_info()->physical_type() != type_info->physical_type()) {
+    return Status::OK();
+  }
+
+  // Find the block holding 'ord_idx'.
+  auto it = std::upper_bound(zone_maps.begin(), zone_maps.end(), ord_idx,
+                             [](rowid_t ord, const ZoneMapPB& zone_map) {
+                               return ord < zone_map.first_ordinal();
+                             });
+  if (it == zone_maps.begin()) {
+    return Status::OK();
+  }
+  --it;
+
+  // Every block overlapping the range must be ruled out.
+  const rowid_t end_idx = ord_idx + n;
+  rowid_t next_ordinal = it->first_ordinal();
+  for (; it != zone_maps.end() && next_ordinal < end_idx; ++it) {
+    if (it->first_ordinal() != next_ordinal ||
+        ZoneMapMayMatch(type_info, *it, pred)) {
+      return Status::OK();
+    }
+    next_ordinal += it->num_rows();
+  }
+  // Rows past the last zone map can't be ruled out.
+  *may_match = next_ordinal < end_idx;
+  return Status::OK();
+}
+
 Status CFileIterator::PrepareForNewSeek() {
   // Fully open the CFileReader if it was lazily opened earlier.
   //
@@ -902,6 +1494,7 @@ Status CFileIterator::PrepareForNewSeek() {
   }
 
   seeked_ = nullptr;
+  prefetch_seeked_ = false;
   for (PreparedBlock *pb : prepared_blocks_) {
     prepared_block_pool_.Destroy(pb);
   }
@@ -949,8 +1542,9 @@ Status DecodeNullInfo(scoped_refptr<BlockHandle>* data_block_handle,
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
   prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
-  RETURN_NOT_OK(reader_->ReadBlock(
-      io_context_, prep_block->dblk_ptr_, cache_control_, &prep_block->dblk_handle_));
+  bool read_from_disk;
+  RETURN_NOT_OK(reader_->ReadBlock(io_context_, prep_block->dblk_ptr_, cache_control_,
+                                   &prep_block->dblk_handle_, &read_from_disk));
 
   uint32_t num_rows_in_block = 0;
   scoped_refptr<BlockHandle> data_block = prep_block->dblk_handle_;
@@ -978,6 +1572,7 @@ Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
 
   io_stats_.cells_read += num_rows_in_block;
   io_stats_.blocks_read++;
+  io_stats_.blocks_read_from_disk += read_from_disk ? 1 : 0;
   io_stats_.bytes_read += total_size_read;
 
   prep_block->idx_in_block_ = 0;
@@ -1023,8 +1618,17 @@ Status CFileIterator::PrepareBatch(size_t *n) {
     } else if (!s.ok()) {
       return s;
     }
+    if (prefetch_seeked_) {
+      if (prefetch_ahead_ > 0) {
+        prefetch_ahead_--;
+      } else {
+        // The prefetch iterator fell behind: reposition it.
+        prefetch_seeked_ = false;
+      }
+    }
     RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
   }
+  PrefetchUpcomingBlocks();
 
   // Seek the first block in the queue such that the first value to be read
   // corresponds to start_idx
@@ -1055,6 +1659,48 @@ Status CFileIterator::PrepareBatch(size_t *n) {
   return Status::OK();
 }
 
+void CFileIterator::PrefetchUpcomingBlocks() {
+  const int num_blocks = FLAGS_cfile_prefetch_blocks;
+  // There's no point in reading blocks ahead if they're not kept in the cache.
+  if (num_blocks <= 0 || cache_control_ != CFileReader::CACHE_BLOCK) {
+    return;
+  }
+  if (!prefetch_token_) {
+    prefetch_token_ = PrefetchPool()->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  }
+
+  if (!prefetch_seeked_) {
+    if (prefetch_iter_source_ != seeked_) {
+      const auto& footer = reader_->footer();
+      BlockPointer root(seeked_ == posidx_iter_.get() ? footer.posidx_info().root_block()
+                                                      : footer.validx_info().root_block());
+      prefetch_iter_.reset(IndexTreeIterator::Create(io_context_, reader_, root));
+      prefetch_iter_source_ = seeked_;
+    }
+    if (!prefetch_iter_->SeekAtOrBefore(seeked_->GetCurrentKey()).ok()) {
+      return;
+    }
+    prefetch_seeked_ = true;
+    prefetch_ahead_ = 0;
+  }
+
+  while (prefetch_ahead_ < num_blocks && prefetch_iter_->HasNext()) {
+    if (!prefetch_iter_->Next().ok()) {
+      prefetch_seeked_ = false;
+      return;
+    }
+    prefetch_ahead_++;
+    const CFileReader* reader = reader_;
+    const IOContext* io_context = io_context_;
+    const BlockPointer ptr = prefetch_iter_->GetCurrentBlockPointer();
+    // If the pool is backed up, move on: the block will be read when needed.
+    ignore_result(prefetch_token_->Submit([reader, io_context, ptr]() {
+      scoped_refptr<BlockHandle> handle;
+      ignore_result(reader->ReadBlock(io_context, ptr, CFileReader::CACHE_BLOCK, &handle));
+    }));
+  }
+}
+
 Status CFileIterator::FinishBatch() {
   CHECK(prepared_) << "no batch prepared";
   prepared_ = false;
@@ -1107,21 +1753,42 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   DCHECK_LE(rem, ctx->block()->nrows());
 
   // Determine the matching codewords for dictionary encoding if they haven't
-  // yet been determined for this CFile.
+  // yet been determined for this CFile. The predicate is evaluated once per
+  // distinct value here, after which the dictionary-coded blocks only need to
+  // look up their codewords in the resulting bitmap.
   if (dict_decoder_ && ctx->DecoderEvalNotDisabled() && !codewords_matching_pred_) {
     size_t nwords = dict_decoder_->Count();
     if (nwords > 0) {
       codewords_matching_pred_.reset(new SelectionVector(nwords));
       codewords_matching_pred_->SetAllFalse();
+      size_t nmatching = 0;
       for (size_t i = 0; i < nwords; i++) {
         Slice cur_string = dict_decoder_->string_at_index(i);
         if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void *>(&cur_string))) {
           BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
+          nmatching++;
         }
       }
+      all_codewords_match_pred_ = nmatching == nwords;
     }
   }
   for (PreparedBlock *pb : prepared_blocks_) {
+    if (ctx->skip_unselected_rows()) {
+      // If none of the rows this block contributes to the batch are selected,
+      // skip decoding it altogether.
+      const uint32_t start_in_block = pb->needs_rewind_ ? pb->rewind_idx_ : pb->idx_in_block_;
+      const size_t nrows = std::min(rem, pb->num_rows_in_block_ - start_in_block);
+      if (!remaining_sel.AnySelected(nrows)) {
+        SkipRowsInBlock(pb, start_in_block, nrows, ctx->block()->is_nullable(), &remaining_dst);
+        rem -= nrows;
+        remaining_dst.Advance(nrows);
+        remaining_sel.Advance(nrows);
+        if (rem == 0) {
+          break;
+        }
+        continue;
+      }
+    }
     if (pb->needs_rewind_) {
       // Seek back to the saved position.
       SeekToPositionInBlock(pb, pb->rewind_idx_);
@@ -1213,6 +1880,25 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   return Status::OK();
 }
 
+void CFileIterator::SkipRowsInBlock(PreparedBlock* pb,
+                                    uint32_t start_in_block,
+                                    size_t nrows,
+                                    bool is_nullable,
+                                    ColumnDataView* dst) {
+#ifndef NDEBUG
+  kudu::OverwriteWithPattern(reinterpret_cast<char *>(dst->data()),
+                             dst->stride() * nrows,
+                             "SKIPPEDSKIPPEDSKIPPED");
+#endif
+  if (is_nullable) {
+    dst->SetNullBits(nrows, false);
+  }
+  // The decoders haven't moved, so leave 'idx_in_block_' alone and seek them
+  // past the skipped rows if the block is read again, e.g. by the next batch.
+  pb->rewind_idx_ = start_in_block + nrows;
+  pb->needs_rewind_ = true;
+}
+
 Status CFileIterator::CopyNextValues(size_t* n, ColumnMaterializationContext* ctx) {
   RETURN_NOT_OK(PrepareBatch(n));
   RETURN_NOT_OK(Scan(ctx));
@@ -18,8 +18,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -46,10 +49,13 @@
 
 namespace kudu {
 
+class ColumnDataView;
 class ColumnMaterializationContext;
+class ColumnPredicate;
 class CompressionCodec;
 class EncodedKey;
 class SelectionVector;
+class ThreadPoolToken;
 class TypeInfo;
 
 namespace fs {
@@ -63,6 +69,7 @@ namespace cfile {
 class BinaryPlainBlockDecoder;
 class CFileIterator;
 class IndexTreeIterator;
+class ScratchMemory;
 class TypeEncodingInfo;
 struct ReaderOptions;
 
@@ -103,17 +110,71 @@ class CFileReader {
 
   // Reads the data block pointed to by `ptr`. Will pull the data block from
   // the block cache if it exists, and reads from the filesystem block
-  // otherwise.
+  // otherwise. If 'read_from_disk' is not null, it's set to whether the block
+  // missed the block cache.
   Status ReadBlock(const fs::IOContext* io_context,
                    const BlockPointer& ptr,
                    CacheControl cache_control,
-                   scoped_refptr<BlockHandle>* ret) const;
+                   scoped_refptr<BlockHandle>* ret,
+                   bool* read_from_disk = nullptr) const;
+
+  // Reads the data blocks pointed to by 'ptrs' into 'ret', in the same order.
+  // Like ReadBlock(), but the blocks which are not in the block cache and are
+  // adjacent in the file (and in 'ptrs') are read with a single I/O, and the
+  // checksums of all the blocks read are verified in one batch.
+  Status ReadBlocks(const fs::IOContext* io_context,
+                    ArrayView<const BlockPointer> ptrs,
+                    CacheControl cache_control,
+                    std::vector<scoped_refptr<BlockHandle>>* ret) const;
+
+  // Appends the data block pointed to by 'ptr' to 'dst' as it's stored in the
+  // file, i.e. still compressed if the file is, and without its checksum,
+  // which is verified. The block cache is bypassed.
+  Status ReadRawBlock(const fs::IOContext* io_context,
+                      const BlockPointer& ptr,
+                      faststring* dst) const;
+
+  // Sets '*blocks' to the pointers to the data blocks of the cfile in ordinal
+  // order, along with the ordinal of the first value of each.
+  //
+  // Returns NotSupported if the cfile has no position-based index.
+  Status GetDataBlocks(const fs::IOContext* io_context,
+                       std::vector<std::pair<rowid_t, BlockPointer>>* blocks) const;
+
+  // Reads the data blocks at the given offsets into the block cache, along
+  // with the index blocks leading to them. Offsets which don't match the
+  // start of any data block are ignored.
+  //
+  // 'before_read' is called before reading each data block; if it returns
+  // false, the remaining blocks are skipped and Status::Aborted is returned.
+  // On return, '*num_loaded' is set to the number of data blocks read.
+  Status LoadBlocksIntoCache(const fs::IOContext* io_context,
+                             const std::unordered_set<uint64_t>& offsets,
+                             const std::function<bool()>& before_read,
+                             int* num_loaded) const;
 
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
   // the data)
   Status CountRows(rowid_t *count) const;
 
+  // Narrows [*lower_bound, *upper_bound) to the ordinals of the data blocks
+  // which may hold values satisfying 'pred', an equality or range predicate,
+  // by binary searching the zone maps of the blocks. Only valid if the values
+  // of the cfile are non-null and non-decreasing in ordinal order. The bounds
+  // are left as they are if the zone maps can't be searched.
+  Status NarrowSortedOrdinalRange(const ColumnPredicate& pred,
+                                  const fs::IOContext* io_context,
+                                  rowid_t* lower_bound,
+                                  rowid_t* upper_bound);
+
+  // Sets '*max' to the largest non-null value of the cfile, in the in-memory
+  // cell format of its type, according to the zone maps of its data blocks.
+  // '*has_max' is set to false if the zone maps can't tell, e.g. because they
+  // weren't written, or if the cfile has no non-null values. Binary cfiles
+  // aren't supported.
+  Status GetMaxValue(const fs::IOContext* io_context, std::string* max, bool* has_max);
+
   // Retrieve the given metadata entry into 'val'.
   // Returns true if the entry was found, otherwise returns false.
   //
@@ -159,6 +220,13 @@ class CFileReader {
     return footer().compression() != NO_COMPRESSION;
   }
 
+  // The version of the cfile format, which the layout of compressed blocks
+  // depends on.
+  uint8_t cfile_version() const {
+    DCHECK(init_once_.init_succeeded());
+    return cfile_version_;
+  }
+
   // Advanced access to the cfile. This is used by the
   // delta reader code. TODO: think about reorganizing this:
   // delta files can probably be done more cleanly.
@@ -201,6 +269,21 @@ class CFileReader {
   Status ReadAndParseFooter();
   Status VerifyChecksum(ArrayView<const Slice> data, const Slice& checksum) const;
 
+  // Returns Status::Corruption unless 'checksum_value' matches the checksum
+  // stored in 'checksum'.
+  Status CheckChecksum(uint32_t checksum_value, const Slice& checksum) const;
+
+  // Decompresses the block read into 'scratch', if the file is compressed,
+  // and hands it over to the block cache (if 'cache_control' says so) or to
+  // 'ret'. If 'cache_decompressed' is false, the decompressed block isn't
+  // cached.
+  Status FinishReadBlock(const BlockPointer& ptr,
+                         CacheControl cache_control,
+                         bool cache_decompressed,
+                         Slice block,
+                         ScratchMemory* scratch,
+                         scoped_refptr<BlockHandle>* ret) const;
+
   // Returns the memory usage of the object including the object itself.
   size_t memory_footprint() const;
 
@@ -276,6 +359,19 @@ class ColumnIterator {
   // batch left off.
   virtual Status FinishBatch() = 0;
 
+  // Sets '*may_match' to false if none of the 'n' rows starting at ordinal
+  // 'ord_idx' can satisfy 'pred', judging from summary statistics of the
+  // underlying data. This doesn't change the position of the iterator.
+  //
+  // The default implementation never rules out any rows.
+  virtual Status MayMatch(const ColumnPredicate& /*pred*/,
+                          rowid_t /*ord_idx*/,
+                          size_t /*n*/,
+                          bool* may_match) {
+    *may_match = true;
+    return Status::OK();
+  }
+
   virtual const IteratorStats& io_statistics() const = 0;
 };
 
@@ -380,6 +476,12 @@ class CFileIterator : public ColumnIterator {
   // batch left off.
   Status FinishBatch() OVERRIDE;
 
+  // Consults the zone maps of the cfile's data blocks, if any.
+  Status MayMatch(const ColumnPredicate& pred,
+                  rowid_t ord_idx,
+                  size_t n,
+                  bool* may_match) override;
+
   // Return true if the next call to PrepareBatch will return at least one row.
   bool HasNext() const;
 
@@ -402,6 +504,10 @@ class CFileIterator : public ColumnIterator {
   // single set of predicate-satisfying codewords.
   SelectionVector* GetCodeWordsMatchingPredicate() { return codewords_matching_pred_.get(); }
 
+  // Returns true if every codeword of the dictionary matches the predicate,
+  // in which case the decoders don't need to evaluate it row by row.
+  bool AllCodeWordsMatchPredicate() const { return all_codewords_match_pred_; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CFileIterator);
 
@@ -448,6 +554,15 @@ class CFileIterator : public ColumnIterator {
   // Seek the given PreparedBlock to the given index within it.
   void SeekToPositionInBlock(PreparedBlock *pb, uint32_t idx_in_block);
 
+  // Skips the 'nrows' rows of the given PreparedBlock starting at
+  // 'start_in_block' without decoding them, since none of them are selected.
+  // Their cells in 'dst' are left unset, and marked NULL if 'is_nullable'.
+  void SkipRowsInBlock(PreparedBlock* pb,
+                       uint32_t start_in_block,
+                       size_t nrows,
+                       bool is_nullable,
+                       ColumnDataView* dst);
+
   // Read the data block currently pointed to by idx_iter_
   // into the given PreparedBlock structure.
   //
@@ -463,6 +578,14 @@ class CFileIterator : public ColumnIterator {
   // seek-related state.
   Status PrepareForNewSeek();
 
+  // Issue asynchronous reads of the data blocks following the block 'seeked_'
+  // is pointed to, keeping up to FLAGS_cfile_prefetch_blocks of them ahead, so
+  // that they're already in the block cache by the time they're scanned.
+  //
+  // Prefetching is best-effort: any errors are left to be surfaced when the
+  // blocks are read by the iterator itself.
+  void PrefetchUpcomingBlocks();
+
   CFileReader* reader_;
 
   std::unique_ptr<IndexTreeIterator> posidx_iter_;
@@ -474,11 +597,25 @@ class CFileIterator : public ColumnIterator {
 
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
+  bool all_codewords_match_pred_;
 
   // The currently in-use index iterator. This is equal to either
   // posidx_iter_.get(), validx_iter_.get(), or NULL if not seeked.
   IndexTreeIterator *seeked_;
 
+  // Index iterator running ahead of 'seeked_' over the blocks being prefetched,
+  // on the same index as 'prefetch_iter_source_'.
+  std::unique_ptr<IndexTreeIterator> prefetch_iter_;
+  const IndexTreeIterator* prefetch_iter_source_;
+
+  // Whether 'prefetch_iter_' is positioned relative to 'seeked_', in which case
+  // it's 'prefetch_ahead_' blocks ahead of it. Reset by every seek.
+  bool prefetch_seeked_;
+  int prefetch_ahead_;
+
+  // Token for submitting prefetches to the shared prefetch thread pool.
+  std::unique_ptr<ThreadPoolToken> prefetch_token_;
+
   // Data blocks that contain data relevant to the currently Prepared
   // batch of rows.
   // These pointers are allocated from the prepared_block_pool_ below.
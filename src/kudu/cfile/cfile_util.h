@@ -79,6 +79,10 @@ struct WriterOptions {
   // instead of entire keys.
   bool optimize_index_keys;
 
+  // Whether to write per-block min/max statistics into the footer. Only
+  // meaningful for files whose data blocks are built from appended values.
+  bool write_zone_maps;
+
   // Column storage attributes.
   //
   // Default: all default values as specified in the constructor in
@@ -17,10 +17,13 @@
 
 #include "kudu/cfile/cfile_writer.h"
 
+#include <cmath>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <numeric>
 #include <ostream>
+#include <type_traits>
 #include <utility>
 
 #include <boost/optional/optional.hpp>
@@ -54,13 +57,19 @@ DEFINE_int32(cfile_default_block_size, 256*1024, "The default block size to use
 TAG_FLAG(cfile_default_block_size, advanced);
 
 DEFINE_string(cfile_default_compression_codec, "no_compression",
-              "Default cfile block compression codec.");
+              "Default cfile block compression codec. One of no_compression, "
+              "snappy, lz4, zlib or zstd.");
 TAG_FLAG(cfile_default_compression_codec, advanced);
 
 DEFINE_bool(cfile_write_checksums, true,
             "Write CRC32 checksums for each block");
 TAG_FLAG(cfile_write_checksums, evolving);
 
+DEFINE_bool(cfile_write_zone_maps, true,
+            "Write the min/max values of each data block of column cfiles into the "
+            "footer, so that scans can skip blocks which can't match their predicates");
+TAG_FLAG(cfile_write_zone_maps, advanced);
+
 using google::protobuf::RepeatedPtrField;
 using kudu::fs::BlockCreationTransaction;
 using kudu::fs::BlockManager;
@@ -81,6 +90,119 @@ const size_t kChecksumSize = sizeof(uint32_t);
 
 static const size_t kMinBlockSize = 512;
 
+// Binary values longer than this aren't tracked by zone maps, so that the
+// footer doesn't bloat with large cells.
+static const size_t kMaxZoneMapValueSize = 256;
+
+////////////////////////////////////////////////////////////
+// ZoneMapBuilder
+////////////////////////////////////////////////////////////
+
+ZoneMapBuilder::ZoneMapBuilder(const TypeInfo* typeinfo)
+  : typeinfo_(typeinfo),
+    is_binary_(typeinfo->physical_type() == BINARY),
+    value_count_(0),
+    bounds_valid_(true) {
+}
+
+void ZoneMapBuilder::AddValues(const void* cells, size_t count) {
+  if (count == 0 || !bounds_valid_) {
+    return;
+  }
+  switch (typeinfo_->physical_type()) {
+    case BOOL: AddValuesForType<BOOL>(cells, count); break;
+    case INT8: AddValuesForType<INT8>(cells, count); break;
+    case UINT8: AddValuesForType<UINT8>(cells, count); break;
+    case INT16: AddValuesForType<INT16>(cells, count); break;
+    case UINT16: AddValuesForType<UINT16>(cells, count); break;
+    case INT32: AddValuesForType<INT32>(cells, count); break;
+    case UINT32: AddValuesForType<UINT32>(cells, count); break;
+    case INT64: AddValuesForType<INT64>(cells, count); break;
+    case UINT64: AddValuesForType<UINT64>(cells, count); break;
+    case INT128: AddValuesForType<INT128>(cells, count); break;
+    case FLOAT: AddValuesForType<FLOAT>(cells, count); break;
+    case DOUBLE: AddValuesForType<DOUBLE>(cells, count); break;
+    case BINARY: AddValuesForType<BINARY>(cells, count); break;
+    default:
+      bounds_valid_ = false;
+      break;
+  }
+}
+
+template<DataType PhysicalType>
+void ZoneMapBuilder::AddValuesForType(const void* cells, size_t count) {
+  typedef DataTypeTraits<PhysicalType> Traits;
+  typedef typename Traits::cpp_type CppType;
+  const uint8_t* cell = reinterpret_cast<const uint8_t*>(cells);
+  const void* min = value_count_ > 0 ? min_cell() : nullptr;
+  const void* max = value_count_ > 0 ? max_cell() : nullptr;
+  for (size_t i = 0; i < count; i++, cell += sizeof(CppType)) {
+    if constexpr (std::is_floating_point<CppType>::value) {
+      // NaN is unordered, so a block holding one has no meaningful bounds.
+      if (std::isnan(UnalignedLoad<CppType>(cell))) {
+        bounds_valid_ = false;
+        return;
+      }
+    }
+    if (min == nullptr || Traits::Compare(cell, min) < 0) {
+      min = cell;
+    }
+    if (max == nullptr || Traits::Compare(cell, max) > 0) {
+      max = cell;
+    }
+  }
+  value_count_ += count;
+
+  // The new bounds may point into 'cells', which belong to the caller: copy
+  // them out.
+  auto copy_cell = [&](const void* src, string* dst, Slice* dst_slice) {
+    if (is_binary_) {
+      const Slice* s = reinterpret_cast<const Slice*>(src);
+      if (s->size() > kMaxZoneMapValueSize) {
+        bounds_valid_ = false;
+        return;
+      }
+      dst->assign(reinterpret_cast<const char*>(s->data()), s->size());
+      *dst_slice = Slice(*dst);
+    } else {
+      dst->assign(reinterpret_cast<const char*>(src), sizeof(CppType));
+    }
+  };
+  if (min != min_cell()) {
+    copy_cell(min, &min_, &min_slice_);
+  }
+  if (max != max_cell()) {
+    copy_cell(max, &max_, &max_slice_);
+  }
+}
+
+const void* ZoneMapBuilder::min_cell() const {
+  return is_binary_ ? static_cast<const void*>(&min_slice_) : min_.data();
+}
+
+const void* ZoneMapBuilder::max_cell() const {
+  return is_binary_ ? static_cast<const void*>(&max_slice_) : max_.data();
+}
+
+void ZoneMapBuilder::Finish(rowid_t first_ordinal,
+                            size_t num_rows,
+                            size_t null_count,
+                            ZoneMapPB* pb) {
+  DCHECK_LE(null_count, num_rows);
+  pb->Clear();
+  pb->set_first_ordinal(first_ordinal);
+  pb->set_num_rows(num_rows);
+  if (null_count > 0) {
+    pb->set_null_count(null_count);
+  }
+  if (bounds_valid_ && value_count_ > 0) {
+    pb->set_min_value(min_);
+    pb->set_max_value(max_);
+  }
+  value_count_ = 0;
+  bounds_valid_ = true;
+}
+
 ////////////////////////////////////////////////////////////
 // CFileWriter
 ////////////////////////////////////////////////////////////
@@ -138,6 +260,10 @@ CFileWriter::CFileWriter(WriterOptions options,
 
     validx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
+
+  if (options_.write_zone_maps && FLAGS_cfile_write_zone_maps) {
+    zone_map_builder_.reset(new ZoneMapBuilder(typeinfo_));
+  }
 }
 
 CFileWriter::~CFileWriter() {
@@ -150,7 +276,9 @@ Status CFileWriter::Start() {
 
   if (compression_ != NO_COMPRESSION) {
     const CompressionCodec* codec;
-    RETURN_NOT_OK(GetCompressionCodec(compression_, &codec));
+    RETURN_NOT_OK(GetCompressionCodec(compression_,
+                                      options_.storage_attributes.compression_level,
+                                      &codec));
     block_compressor_.reset(new CompressedBlockBuilder(codec));
   }
 
@@ -238,6 +366,11 @@ Status CFileWriter::FinishAndReleaseBlock(BlockCreationTransaction* transaction)
     footer.mutable_validx_info()->CopyFrom(validx_info);
   }
 
+  for (auto& zone_map : zone_maps_) {
+    footer.add_zone_maps()->Swap(&zone_map);
+  }
+  zone_maps_.clear();
+
   // Optionally append extra information to the end of cfile.
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
@@ -305,6 +438,9 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
   while (rem > 0) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
+    if (zone_map_builder_) {
+      zone_map_builder_->AddValues(ptr, n);
+    }
 
     ptr += typeinfo_->size() * n;
     rem -= n;
@@ -335,6 +471,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       do {
         int n = data_block_->Add(ptr, rem);
         DCHECK_GE(n, 0);
+        if (zone_map_builder_) {
+          zone_map_builder_->AddValues(ptr, n);
+        }
 
         non_null_bitmap_builder_->AddRun(true, n);
         ptr += n * typeinfo_->size();
@@ -357,7 +496,8 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
 }
 
 Status CFileWriter::FinishCurDataBlock() {
-  uint32_t num_elems_in_block = data_block_->Count();
+  const uint32_t num_values_in_block = data_block_->Count();
+  uint32_t num_elems_in_block = num_values_in_block;
   if (is_nullable_) {
     num_elems_in_block = non_null_bitmap_builder_->nitems();
   }
@@ -399,6 +539,13 @@ Status CFileWriter::FinishCurDataBlock() {
                             Slice(last_key_),
                             "data block");
 
+  if (zone_map_builder_) {
+    zone_maps_.emplace_back();
+    zone_map_builder_->Finish(first_elem_ord, num_elems_in_block,
+                              num_elems_in_block - num_values_in_block,
+                              &zone_maps_.back());
+  }
+
   if (is_nullable_) {
     non_null_bitmap_builder_->Reset();
   }
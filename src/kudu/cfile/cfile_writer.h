@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/rowid.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
@@ -47,6 +48,7 @@ class CompressedBlockBuilder;
 class FileMetadataPairPB;
 class IndexTreeBuilder;
 class TypeEncodingInfo;
+class ZoneMapPB;
 
 // Magic used in header/footer
 extern const char kMagicStringV1[];
@@ -89,6 +91,44 @@ class NullBitmapBuilder {
   RleEncoder<bool> rle_encoder_;
 };
 
+// Tracks the min/max non-null values of the data block being written.
+class ZoneMapBuilder {
+ public:
+  explicit ZoneMapBuilder(const TypeInfo* typeinfo);
+
+  // Folds 'count' non-null cells, in the in-memory format of the column's
+  // type, into the stats of the current block.
+  void AddValues(const void* cells, size_t count);
+
+  // Fills 'pb' with the stats of the current block, which holds 'num_rows'
+  // rows (of which 'null_count' are NULL) starting at 'first_ordinal', and
+  // resets the builder for the next block.
+  void Finish(rowid_t first_ordinal, size_t num_rows, size_t null_count, ZoneMapPB* pb);
+
+ private:
+  template<DataType PhysicalType>
+  void AddValuesForType(const void* cells, size_t count);
+
+  // Returns pointers to the current bounds, in the in-memory cell format.
+  const void* min_cell() const;
+  const void* max_cell() const;
+
+  const TypeInfo* const typeinfo_;
+  const bool is_binary_;
+
+  // The number of values folded into the current block.
+  size_t value_count_;
+
+  // False if the bounds of the current block can't be trusted.
+  bool bounds_valid_;
+
+  // The current bounds, and slices pointing to them for BINARY columns.
+  std::string min_;
+  std::string max_;
+  Slice min_slice_;
+  Slice max_slice_;
+};
+
 // Main class used to write a CFile.
 class CFileWriter {
  public:
@@ -227,6 +267,10 @@ class CFileWriter {
   std::unique_ptr<IndexTreeBuilder> validx_builder_;
   std::unique_ptr<NullBitmapBuilder> non_null_bitmap_builder_;
   std::unique_ptr<CompressedBlockBuilder> block_compressor_;
+  std::unique_ptr<ZoneMapBuilder> zone_map_builder_;
+
+  // Zone maps of the data blocks written so far, flushed into the footer.
+  std::vector<ZoneMapPB> zone_maps_;
 
   enum State {
     kWriterInitialized,
@@ -39,6 +39,7 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/fsst_block.h"
 #include "kudu/cfile/type_encodings.h"
 #include "kudu/common/columnblock-test-util.h"
 #include "kudu/common/columnblock.h"
@@ -46,6 +47,7 @@
 #include "kudu/common/rowblock_memory.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stringprintf.h"
@@ -806,6 +808,79 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, block->data().size());
 }
 
+// Test for FOR delta block on sorted and unsorted INT64 sequences, including
+// deltas which span the full range of the type.
+TEST_F(TestEncoding, TestForDeltaInt64BlockEncoder) {
+  using limits = std::numeric_limits<int64_t>;
+  Random rng(SeedRandom());
+  vector<int64_t> sorted = CreateRandomIntegersInRange<int64_t>(10000, -1000000, 1000000, &rng);
+  std::sort(sorted.begin(), sorted.end());
+  vector<int64_t> decreasing(sorted.rbegin(), sorted.rend());
+  auto sequences = {
+      sorted,
+      decreasing,
+      CreateRandomIntegersInRange<int64_t>(10000, limits::min(), limits::max(), &rng),
+      vector<int64_t>{ limits::min(), limits::max(), limits::min(), 0, limits::max() }
+  };
+  for (const auto& ints : sequences) {
+    TestEncodeDecodeTemplateBlockEncoder<INT64>(ints.data(), ints.size(), FOR_DELTA);
+  }
+}
+
+// Test that FOR delta encoding packs a column of increasing timestamps much
+// more tightly than the raw values.
+TEST_F(TestEncoding, TestForDeltaTimestampBlockSize) {
+  const int kSize = 10000;
+  Random rng(SeedRandom());
+  vector<int64_t> timestamps;
+  int64_t ts = 1600000000000000L;
+  for (int i = 0; i < kSize; i++) {
+    // Roughly one row per millisecond, with some jitter.
+    ts += 1000 + rng.Uniform(100);
+    timestamps.push_back(ts);
+  }
+  TestEncodeDecodeTemplateBlockEncoder<INT64>(timestamps.data(), kSize, FOR_DELTA);
+
+  auto bb = CreateBlockBuilderOrDie(UNIXTIME_MICROS, FOR_DELTA);
+  bb->Add(reinterpret_cast<const uint8_t*>(timestamps.data()), kSize);
+  scoped_refptr<BlockHandle> block = FinishAndMakeContiguous(bb.get(), 0);
+  LOG(INFO) << "FOR delta encoded size for " << kSize << " timestamps: "
+            << block->data().size();
+  // Each delta takes 7 bits, versus 64 bits for the plain value.
+  ASSERT_LT(block->data().size(), kSize * sizeof(int64_t) / 5);
+
+  // A perfectly regular sequence needs no packed bits at all.
+  for (int i = 0; i < kSize; i++) {
+    timestamps[i] = 1600000000000000L + i * 1000;
+  }
+  bb->Reset();
+  bb->Add(reinterpret_cast<const uint8_t*>(timestamps.data()), kSize);
+  block = FinishAndMakeContiguous(bb.get(), 0);
+  ASSERT_LT(block->data().size(), kSize * sizeof(int64_t) / 50);
+}
+
+TEST_F(TestEncoding, TestForDeltaEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode(INT32, FOR_DELTA);
+}
+
+// Test that a truncated FOR delta block is reported as corrupt.
+TEST_F(TestEncoding, TestForDeltaBlockTruncation) {
+  vector<int32_t> ints(1000);
+  for (size_t i = 0; i < ints.size(); i++) {
+    ints[i] = i * i;
+  }
+  auto bb = CreateBlockBuilderOrDie(INT32, FOR_DELTA);
+  bb->Add(reinterpret_cast<const uint8_t*>(ints.data()), ints.size());
+  scoped_refptr<BlockHandle> block = FinishAndMakeContiguous(bb.get(), 0);
+  Slice data = block->data();
+  for (size_t size = 0; size < data.size(); size += 7) {
+    auto bd = CreateBlockDecoderOrDie(INT32, FOR_DELTA,
+                                      MakeContiguous({ Slice(data.data(), size) }));
+    Status s = bd->ParseHeader();
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip(PLAIN_ENCODING);
 }
@@ -862,6 +937,74 @@ TEST_F(TestEncoding, TestBinaryPrefixBlockBuilderTruncation) {
   TestBinaryBlockTruncation<BinaryPrefixBlockDecoder>(PREFIX_ENCODING);
 }
 
+TEST_F(TestEncoding, TestFsstBlockBuilderSeekByValueSmallBlock) {
+  TestBinarySeekByValueSmallBlock(FSST_ENCODING);
+}
+
+TEST_F(TestEncoding, TestFsstBlockBuilderSeekByValueLargeBlock) {
+  TestStringSeekByValueLargeBlock(FSST_ENCODING);
+}
+
+TEST_F(TestEncoding, TestFsstBlockBuilderRoundTrip) {
+  TestBinaryBlockRoundTrip(FSST_ENCODING);
+}
+
+TEST_F(TestEncoding, TestFsstEmptyBlockEncodeDecode) {
+  TestEmptyBlockEncodeDecode(BINARY, FSST_ENCODING);
+}
+
+// Test that every truncation of an FSST block is reported as corrupt.
+TEST_F(TestEncoding, TestFsstBlockBuilderTruncation) {
+  auto bb = CreateBlockBuilderOrDie(BINARY, FSST_ENCODING);
+  scoped_refptr<BlockHandle> block = CreateBinaryBlock(
+      bb.get(), 100, [](int item) { return StringPrintf("hello %d", item); });
+  Slice data = block->data();
+  for (size_t size = 0; size < data.size(); size++) {
+    auto bd = CreateBlockDecoderOrDie(BINARY, FSST_ENCODING,
+                                      MakeContiguous({ Slice(data.data(), size) }));
+    Status s = bd->ParseHeader();
+    ASSERT_TRUE(s.IsCorruption()) << size << ": " << s.ToString();
+    if (size < FsstBlockDecoder::kMinHeaderSize) {
+      ASSERT_STR_CONTAINS(s.ToString(), "not enough bytes for header");
+    }
+  }
+}
+
+// Test that FSST encoding compresses strings which share substrings, and
+// that the strings survive the round trip.
+TEST_F(TestEncoding, TestFsstBlockSize) {
+  const int kCount = 2000;
+  const char* const kHosts[] = { "www.example.com", "images.example.org", "api.example.net" };
+  const char* const kPaths[] = { "/products/", "/static/img/", "/v1/users/", "/search?q=" };
+  const auto url = [&](int i) {
+    Random local_rng(i);
+    return strings::Substitute("https://$0$1$2", kHosts[local_rng.Uniform(arraysize(kHosts))],
+                               kPaths[local_rng.Uniform(arraysize(kPaths))],
+                               local_rng.Uniform(1000000));
+  };
+  size_t raw_size = 0;
+  for (int i = 0; i < kCount; i++) {
+    raw_size += url(i).size();
+  }
+
+  auto bb = CreateBlockBuilderOrDie(BINARY, FSST_ENCODING);
+  scoped_refptr<BlockHandle> block = CreateBinaryBlock(bb.get(), kCount, url);
+  LOG(INFO) << "FSST encoded size for " << raw_size << " bytes of URLs: "
+            << block->data().size();
+  ASSERT_LT(block->data().size(), raw_size / 2);
+
+  auto bd = CreateBlockDecoderOrDie(BINARY, FSST_ENCODING, std::move(block));
+  ASSERT_OK(bd->ParseHeader());
+  ScopedColumnBlock<STRING> cb(kCount);
+  ColumnDataView cdv(&cb);
+  size_t n = kCount;
+  ASSERT_OK(bd->CopyNextValues(&n, &cdv));
+  ASSERT_EQ(kCount, n);
+  for (int i = 0; i < kCount; i++) {
+    ASSERT_EQ(url(i), cb[i].ToString());
+  }
+}
+
 class IntEncodingTest : public TestEncoding, public ::testing::WithParamInterface<EncodingType> {
  public:
   template <DataType IntType>
@@ -882,7 +1025,7 @@ class IntEncodingTest : public TestEncoding, public ::testing::WithParamInterfac
   }
 };
 INSTANTIATE_TEST_SUITE_P(Encodings, IntEncodingTest,
-                         ::testing::Values(RLE, PLAIN_ENCODING, BIT_SHUFFLE));
+                         ::testing::Values(RLE, PLAIN_ENCODING, BIT_SHUFFLE, FOR_DELTA));
 
 TEST_P(IntEncodingTest, TestSeekAllTypes) {
   this->template DoIntSeekTest<UINT8>(100, 1000, true);
@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/for_delta_block.h"
+
+#include <array>
+#include <utility>
+
+#include "kudu/gutil/port.h"
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+typedef void (*UnpackFunc)(const uint8_t* src, size_t n, uint64_t* dst);
+
+// Unpacks values of a fixed bit width. Since the shift amounts and the
+// mask are compile-time constants, each iteration is branch-free.
+template<int kBitWidth>
+void UnpackFixedWidth(const uint8_t* src, size_t n, uint64_t* dst) {
+  if constexpr (kBitWidth == 0) {
+    std::fill(dst, dst + n, 0);
+  } else if constexpr (kBitWidth == 64) {
+    memcpy(dst, src, n * sizeof(uint64_t));
+  } else {
+    constexpr uint64_t kMask = (1ULL << kBitWidth) - 1;
+    for (size_t i = 0; i < n; i++) {
+      const size_t bit = i * kBitWidth;
+      const uint8_t* p = src + bit / 8;
+      const int shift = bit % 8;
+      if constexpr (kBitWidth <= 57) {
+        // The value and its leading bit shift fit in a single 64-bit word.
+        dst[i] = (UnalignedLoad<uint64_t>(p) >> shift) & kMask;
+      } else {
+        // The value may straddle into a ninth byte.
+        uint64_t word = UnalignedLoad<uint64_t>(p) >> shift;
+        if (shift != 0) {
+          word |= UnalignedLoad<uint64_t>(p + 8) << (64 - shift);
+        }
+        dst[i] = word & kMask;
+      }
+    }
+  }
+}
+
+template<size_t... kBitWidths>
+constexpr std::array<UnpackFunc, sizeof...(kBitWidths)> MakeUnpackTable(
+    std::index_sequence<kBitWidths...> /*unused*/) {
+  return {{ &UnpackFixedWidth<kBitWidths>... }};
+}
+
+constexpr std::array<UnpackFunc, 65> kUnpackFuncs =
+    MakeUnpackTable(std::make_index_sequence<65>());
+
+} // anonymous namespace
+
+void ForDeltaPackBits(const uint64_t* values, size_t n, int bit_width, faststring* dst) {
+  DCHECK_GE(bit_width, 0);
+  DCHECK_LE(bit_width, 64);
+  if (bit_width == 0 || n == 0) {
+    return;
+  }
+  const uint64_t mask = bit_width == 64 ? ~0ULL : (1ULL << bit_width) - 1;
+  unsigned __int128 acc = 0;
+  int acc_bits = 0;
+  for (size_t i = 0; i < n; i++) {
+    acc |= static_cast<unsigned __int128>(values[i] & mask) << acc_bits;
+    acc_bits += bit_width;
+    while (acc_bits >= 8) {
+      dst->push_back(static_cast<char>(acc & 0xff));
+      acc >>= 8;
+      acc_bits -= 8;
+    }
+  }
+  if (acc_bits > 0) {
+    dst->push_back(static_cast<char>(acc & 0xff));
+  }
+}
+
+void ForDeltaUnpackBits(const uint8_t* src, size_t n, int bit_width, uint64_t* dst) {
+  DCHECK_GE(bit_width, 0);
+  DCHECK_LE(bit_width, 64);
+  kUnpackFuncs[bit_width](src, n, dst);
+}
+
+} // namespace cfile
+} // namespace kudu
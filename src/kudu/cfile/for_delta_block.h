@@ -0,0 +1,400 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Frame-of-reference delta encoding for integer blocks. Sorted or nearly
+// sorted columns, such as timestamps and sequence numbers, have small and
+// regular deltas between consecutive values, which this encoding packs into
+// a few bits per value.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace cfile {
+
+// The number of values in a miniblock. Each miniblock has its own reference
+// delta and bit width, so that an outlier only widens the offsets of the
+// miniblock it appears in.
+constexpr int kForDeltaMiniBlockSize = 128;
+
+// The number of zero bytes appended after the last miniblock, so that the
+// unpacking routine may always load 16 bytes at a time without reading past
+// the end of the block.
+constexpr int kForDeltaPaddingBytes = 16;
+
+// Appends the low 'bit_width' bits of each of the 'n' values in 'values' to
+// 'dst', packed densely in little-endian bit order.
+void ForDeltaPackBits(const uint64_t* values, size_t n, int bit_width, faststring* dst);
+
+// Unpacks 'n' values of 'bit_width' bits each from 'src', which must be
+// followed by at least kForDeltaPaddingBytes readable bytes.
+//
+// The unpacking loop is specialized on the bit width so that the compiler
+// can unroll and vectorize it.
+void ForDeltaUnpackBits(const uint8_t* src, size_t n, int bit_width, uint64_t* dst);
+
+// ForDeltaBlockBuilder encodes integer blocks as a sequence of miniblocks
+// of kForDeltaMiniBlockSize values, each storing its first value verbatim
+// followed by the deltas between consecutive values relative to the
+// smallest delta in the miniblock.
+//
+// The block format is as follows:
+//
+// 1. Header: (8 bytes total)
+//
+//    <first_ordinal> [32-bit]
+//      The ordinal offset of the first element in the block.
+//
+//    <num_elements> [32-bit]
+//      The number of elements encoded in the block.
+//
+// 2. Miniblocks, each encoding up to kForDeltaMiniBlockSize elements
+//
+//    <base_value> [size of type]
+//      The first value of the miniblock.
+//
+//    <min_delta> [size of type]
+//      The smallest delta between consecutive values in the miniblock,
+//      compared as signed integers.
+//
+//    <bit_width> [8-bit]
+//      The number of bits used to store each packed delta, between 0 and
+//      the bit size of the type.
+//
+//    <packed_deltas> [ceil((num_values - 1) * bit_width / 8) bytes]
+//      For each value after the first, the delta to its predecessor minus
+//      <min_delta>, packed in little-endian bit order.
+//
+// 3. kForDeltaPaddingBytes zero bytes.
+//
+//   NOTE: all on-disk ints are encoded little-endian, and all deltas are
+//   computed with wrap-around unsigned arithmetic, so that any sequence of
+//   values round-trips.
+//
+// A column of evenly spaced timestamps has a zero bit width, and thus
+// costs a few bytes per 128 values.
+template<DataType Type>
+class ForDeltaBlockBuilder final : public BlockBuilder {
+ public:
+  explicit ForDeltaBlockBuilder(const WriterOptions* options)
+      : count_(0),
+        options_(options) {
+    Reset();
+  }
+
+  void Reset() override {
+    auto block_size = options_->storage_attributes.cfile_block_size;
+    count_ = 0;
+    data_.clear();
+    data_.reserve(block_size);
+    buffer_.clear();
+    finished_ = false;
+    rem_elem_capacity_ = block_size / kSizeOfType;
+  }
+
+  bool IsBlockFull() const override {
+    return rem_elem_capacity_ == 0;
+  }
+
+  int Add(const uint8_t* vals, size_t count) override {
+    DCHECK(!finished_);
+    int to_add = std::min<int>(rem_elem_capacity_, count);
+    data_.append(vals, to_add * kSizeOfType);
+    count_ += to_add;
+    rem_elem_capacity_ -= to_add;
+    return to_add;
+  }
+
+  size_t Count() const override {
+    return count_;
+  }
+
+  Status GetFirstKey(void* key) const override {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[0], kSizeOfType);
+    return Status::OK();
+  }
+
+  Status GetLastKey(void* key) const override {
+    DCHECK(finished_);
+    if (count_ == 0) {
+      return Status::NotFound("no keys in data block");
+    }
+    memcpy(key, &data_[(count_ - 1) * kSizeOfType], kSizeOfType);
+    return Status::OK();
+  }
+
+  void Finish(rowid_t ordinal_pos, std::vector<Slice>* slices) override {
+    buffer_.clear();
+    buffer_.resize(kHeaderSize);
+    InlineEncodeFixed32(&buffer_[0], ordinal_pos);
+    InlineEncodeFixed32(&buffer_[4], count_);
+
+    uint64_t offsets[kForDeltaMiniBlockSize];
+    for (uint32_t start = 0; start < count_; start += kForDeltaMiniBlockSize) {
+      const uint32_t end = std::min<uint32_t>(start + kForDeltaMiniBlockSize, count_);
+
+      // Find the smallest delta, compared as signed so that a decreasing
+      // run doesn't force the full bit width.
+      SignedType min_delta = std::numeric_limits<SignedType>::max();
+      for (uint32_t i = start + 1; i < end; i++) {
+        min_delta = std::min<SignedType>(min_delta, Delta(i));
+      }
+      if (end - start == 1) {
+        min_delta = 0;
+      }
+
+      uint64_t max_offset = 0;
+      for (uint32_t i = start + 1; i < end; i++) {
+        UnsignedType offset = static_cast<UnsignedType>(Delta(i)) -
+                              static_cast<UnsignedType>(min_delta);
+        offsets[i - start - 1] = offset;
+        max_offset = std::max<uint64_t>(max_offset, offset);
+      }
+      const int bit_width = max_offset == 0 ? 0 : Bits::Log2Floor64(max_offset) + 1;
+
+      buffer_.append(&data_[start * kSizeOfType], kSizeOfType);
+      buffer_.append(&min_delta, kSizeOfType);
+      buffer_.push_back(static_cast<uint8_t>(bit_width));
+      ForDeltaPackBits(offsets, end - start - 1, bit_width, &buffer_);
+    }
+    buffer_.resize(buffer_.size() + kForDeltaPaddingBytes);
+    memset(&buffer_[buffer_.size() - kForDeltaPaddingBytes], 0, kForDeltaPaddingBytes);
+
+    finished_ = true;
+    *slices = { Slice(buffer_) };
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  typedef typename std::make_signed<CppType>::type SignedType;
+
+  static const size_t kHeaderSize = sizeof(uint32_t) * 2;
+  static const size_t kSizeOfType = TypeTraits<Type>::size;
+
+  UnsignedType cell(uint32_t idx) const {
+    return UnalignedLoad<UnsignedType>(&data_[idx * kSizeOfType]);
+  }
+
+  // Returns the wrapped-around difference between the value at 'idx' and
+  // its predecessor.
+  SignedType Delta(uint32_t idx) const {
+    return static_cast<SignedType>(static_cast<UnsignedType>(cell(idx) - cell(idx - 1)));
+  }
+
+  faststring data_;
+  faststring buffer_;
+  uint32_t count_;
+  int rem_elem_capacity_;
+  bool finished_;
+  const WriterOptions* options_;
+};
+
+template<DataType Type>
+class ForDeltaBlockDecoder final : public BlockDecoder {
+ public:
+  explicit ForDeltaBlockDecoder(scoped_refptr<BlockHandle> block)
+      : block_(std::move(block)),
+        data_(block_->data()),
+        parsed_(false),
+        ordinal_pos_base_(0),
+        num_elems_(0),
+        cur_idx_(0) {
+  }
+
+  Status ParseHeader() override {
+    CHECK(!parsed_);
+    if (data_.size() < kHeaderSize + kForDeltaPaddingBytes) {
+      return Status::Corruption(
+          strings::Substitute("not enough bytes for header: FOR delta block size ($0) "
+                              "less than expected minimum length ($1)",
+                              data_.size(), kHeaderSize + kForDeltaPaddingBytes));
+    }
+    ordinal_pos_base_ = DecodeFixed32(&data_[0]);
+    num_elems_ = DecodeFixed32(&data_[4]);
+    RETURN_NOT_OK(Expand());
+    parsed_ = true;
+    return Status::OK();
+  }
+
+  void SeekToPositionInBlock(uint pos) override {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    if (PREDICT_FALSE(num_elems_ == 0)) {
+      DCHECK_EQ(0, pos);
+      return;
+    }
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  Status SeekAtOrAfterValue(const void* value_void, bool* exact) override {
+    DCHECK(parsed_);
+    CppType target = UnalignedLoad<CppType>(value_void);
+    uint32_t left = 0;
+    uint32_t right = num_elems_;
+    while (left != right) {
+      uint32_t mid = left + (right - left) / 2;
+      CppType mid_key = decoded_value(mid);
+      if (mid_key == target) {
+        cur_idx_ = mid;
+        *exact = true;
+        return Status::OK();
+      }
+      if (mid_key > target) {
+        right = mid;
+      } else {
+        left = mid + 1;
+      }
+    }
+
+    *exact = false;
+    cur_idx_ = left;
+    if (cur_idx_ == num_elems_) {
+      return Status::NotFound("after last key in block");
+    }
+    return Status::OK();
+  }
+
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) override {
+    DCHECK(parsed_);
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    memcpy(dst->data(), &decoded_[cur_idx_ * kSizeOfType], max_fetch * kSizeOfType);
+    *n = max_fetch;
+    cur_idx_ += max_fetch;
+    return Status::OK();
+  }
+
+  size_t GetCurrentIndex() const override {
+    DCHECK(parsed_) << "must parse header first";
+    return cur_idx_;
+  }
+
+  rowid_t GetFirstRowId() const override {
+    return ordinal_pos_base_;
+  }
+
+  size_t Count() const override {
+    return num_elems_;
+  }
+
+  bool HasNext() const override {
+    return (num_elems_ - cur_idx_) > 0;
+  }
+
+ private:
+  typedef typename TypeTraits<Type>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+
+  static const size_t kHeaderSize = sizeof(uint32_t) * 2;
+  static const size_t kSizeOfType = TypeTraits<Type>::size;
+  static const size_t kMiniBlockHeaderSize = kSizeOfType * 2 + 1;
+
+  CppType decoded_value(uint32_t idx) const {
+    return UnalignedLoad<CppType>(&decoded_[idx * kSizeOfType]);
+  }
+
+  // Decodes all of the miniblocks into 'decoded_'.
+  Status Expand() {
+    decoded_.resize(num_elems_ * kSizeOfType);
+    // The last kForDeltaPaddingBytes bytes are padding and hold no data.
+    const size_t data_end = data_.size() - kForDeltaPaddingBytes;
+    size_t pos = kHeaderSize;
+    uint64_t offsets[kForDeltaMiniBlockSize];
+    for (uint32_t start = 0; start < num_elems_; start += kForDeltaMiniBlockSize) {
+      const uint32_t num_vals = std::min<uint32_t>(kForDeltaMiniBlockSize, num_elems_ - start);
+      if (PREDICT_FALSE(data_end - pos < kMiniBlockHeaderSize)) {
+        return Status::Corruption(strings::Substitute(
+            "FOR delta miniblock at offset $0 truncated", pos));
+      }
+      const UnsignedType base = UnalignedLoad<UnsignedType>(&data_[pos]);
+      const UnsignedType min_delta = UnalignedLoad<UnsignedType>(&data_[pos + kSizeOfType]);
+      const int bit_width = data_[pos + kSizeOfType * 2];
+      pos += kMiniBlockHeaderSize;
+      if (PREDICT_FALSE(bit_width > kSizeOfType * 8)) {
+        return Status::Corruption(strings::Substitute(
+            "invalid bit width $0 in FOR delta miniblock", bit_width));
+      }
+      const size_t packed_size = ((num_vals - 1) * bit_width + 7) / 8;
+      if (PREDICT_FALSE(data_end - pos < packed_size)) {
+        return Status::Corruption(strings::Substitute(
+            "FOR delta miniblock at offset $0 truncated", pos));
+      }
+      ForDeltaUnpackBits(&data_[pos], num_vals - 1, bit_width, offsets);
+      pos += packed_size;
+
+      uint8_t* out = &decoded_[start * kSizeOfType];
+      UnsignedType val = base;
+      UnalignedStore<UnsignedType>(out, val);
+      for (uint32_t i = 1; i < num_vals; i++) {
+        val += static_cast<UnsignedType>(min_delta + static_cast<UnsignedType>(offsets[i - 1]));
+        UnalignedStore<UnsignedType>(out + i * kSizeOfType, val);
+      }
+    }
+    if (PREDICT_FALSE(pos != data_end)) {
+      return Status::Corruption(strings::Substitute(
+          "FOR delta block has $0 unexpected trailing bytes", data_end - pos));
+    }
+    return Status::OK();
+  }
+
+  scoped_refptr<BlockHandle> block_;
+  Slice data_;
+  bool parsed_;
+
+  rowid_t ordinal_pos_base_;
+  uint32_t num_elems_;
+  size_t cur_idx_;
+  faststring decoded_;
+};
+
+} // namespace cfile
+} // namespace kudu
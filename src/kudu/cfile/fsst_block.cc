@@ -0,0 +1,598 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/fsst_block.h"
+
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/group_varint-inl.h"
+#include "kudu/util/hexdump.h"
+#include "kudu/util/memory/arena.h"
+
+using std::map;
+using std::pair;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+// The number of rounds of refinement of the symbol table. Each round may
+// merge pairs of adjacent symbols of the previous round, so the symbols
+// reach their maximum length after log2(8) rounds, and the remaining rounds
+// prune the symbols whose gain didn't hold up.
+constexpr int kNumGenerations = 5;
+
+// The symbols are counted by "pseudo-code": the codes of the symbols, and
+// 256 plus the value of the escaped bytes.
+constexpr int kNumPseudoCodes = 512;
+
+uint64_t SymbolMask(int len) {
+  DCHECK_GE(len, 1);
+  DCHECK_LE(len, FsstSymbolTable::kMaxSymbolLength);
+  return len == 8 ? ~0ULL : (1ULL << (len * 8)) - 1;
+}
+
+Status CopyToArena(const Slice& str, Arena* arena, Slice* out) {
+  if (str.empty()) {
+    *out = Slice();
+    return Status::OK();
+  }
+  const uint8_t* data = arena->AddSlice(str);
+  if (PREDICT_FALSE(data == nullptr)) {
+    return Status::IOError(
+        "Out of memory",
+        StringPrintf("Failed to allocate %d bytes in output arena",
+                     static_cast<int>(str.size())));
+  }
+  *out = Slice(data, str.size());
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+FsstSymbolTable::FsstSymbolTable() {
+  Reset(0);
+}
+
+void FsstSymbolTable::Reset(int num_symbols) {
+  DCHECK_LE(num_symbols, kMaxSymbols);
+  num_symbols_ = num_symbols;
+  memset(symbols_, 0, sizeof(symbols_));
+  memset(lengths_, 0, sizeof(lengths_));
+  for (auto& codes : codes_by_first_byte_) {
+    codes.clear();
+  }
+}
+
+void FsstSymbolTable::BuildIndex() {
+  for (int code = 0; code < num_symbols_; code++) {
+    codes_by_first_byte_[symbols_[code] & 0xff].push_back(code);
+  }
+  for (auto& codes : codes_by_first_byte_) {
+    std::stable_sort(codes.begin(), codes.end(), [&](uint8_t a, uint8_t b) {
+      return lengths_[a] > lengths_[b];
+    });
+  }
+}
+
+int FsstSymbolTable::FindLongestSymbol(const uint8_t* p, size_t len) const {
+  DCHECK_GT(len, 0);
+  uint64_t word = 0;
+  memcpy(&word, p, std::min<size_t>(len, kMaxSymbolLength));
+  for (uint8_t code : codes_by_first_byte_[*p]) {
+    const int sym_len = lengths_[code];
+    if (sym_len <= len && (word & SymbolMask(sym_len)) == symbols_[code]) {
+      return code;
+    }
+  }
+  return -1;
+}
+
+void FsstSymbolTable::Build(const vector<Slice>& sample) {
+  Reset(0);
+  for (int gen = 0; gen < kNumGenerations; gen++) {
+    // Count how often each symbol of the current table, and each pair of
+    // adjacent symbols, is used to compress the sample.
+    vector<uint64_t> counts(kNumPseudoCodes, 0);
+    unordered_map<uint32_t, uint64_t> pair_counts;
+    for (const Slice& str : sample) {
+      const uint8_t* p = str.data();
+      const uint8_t* end = p + str.size();
+      int prev = -1;
+      while (p < end) {
+        const int code = FindLongestSymbol(p, end - p);
+        int cur;
+        int len;
+        if (code >= 0) {
+          cur = code;
+          len = lengths_[code];
+          if (len > 1) {
+            // The first byte is a candidate of its own, in case the longer
+            // symbol doesn't survive.
+            counts[256 + *p]++;
+          }
+        } else {
+          cur = 256 + *p;
+          len = 1;
+        }
+        counts[cur]++;
+        if (prev >= 0) {
+          pair_counts[(static_cast<uint32_t>(prev) << 16) | cur]++;
+        }
+        prev = cur;
+        p += len;
+      }
+    }
+
+    // The candidates of the next table, keyed by (length, bytes), with the
+    // number of bytes they would have compressed.
+    map<pair<int, uint64_t>, uint64_t> gains;
+    const auto symbol_of = [&](int pseudo_code) {
+      return pseudo_code < 256 ?
+          std::make_pair(static_cast<int>(lengths_[pseudo_code]), symbols_[pseudo_code]) :
+          std::make_pair(1, static_cast<uint64_t>(pseudo_code - 256));
+    };
+    for (int pc = 0; pc < kNumPseudoCodes; pc++) {
+      if (counts[pc] > 0) {
+        const auto sym = symbol_of(pc);
+        gains[sym] += counts[pc] * sym.first;
+      }
+    }
+    for (const auto& e : pair_counts) {
+      const auto first = symbol_of(e.first >> 16);
+      const auto second = symbol_of(e.first & 0xffff);
+      const int len = first.first + second.first;
+      if (len > kMaxSymbolLength) {
+        continue;
+      }
+      gains[{ len, first.second | (second.second << (first.first * 8)) }] += e.second * len;
+    }
+
+    // Keep the candidates with the highest gains, preferring the longer ones.
+    vector<pair<uint64_t, pair<int, uint64_t>>> candidates;
+    candidates.reserve(gains.size());
+    for (const auto& e : gains) {
+      candidates.emplace_back(e.second, e.first);
+    }
+    const size_t num_symbols = std::min<size_t>(candidates.size(), kMaxSymbols);
+    std::partial_sort(candidates.begin(), candidates.begin() + num_symbols, candidates.end(),
+                      [](const pair<uint64_t, pair<int, uint64_t>>& a,
+                         const pair<uint64_t, pair<int, uint64_t>>& b) {
+                        return std::tie(a.first, a.second.first, b.second.second) >
+                               std::tie(b.first, b.second.first, a.second.second);
+                      });
+    Reset(num_symbols);
+    for (int code = 0; code < num_symbols; code++) {
+      lengths_[code] = candidates[code].second.first;
+      symbols_[code] = candidates[code].second.second;
+    }
+    BuildIndex();
+  }
+}
+
+void FsstSymbolTable::Compress(const Slice& str, faststring* out) const {
+  const uint8_t* p = str.data();
+  const uint8_t* end = p + str.size();
+  while (p < end) {
+    const int code = FindLongestSymbol(p, end - p);
+    if (code >= 0) {
+      out->push_back(code);
+      p += lengths_[code];
+    } else {
+      out->push_back(kEscapeCode);
+      out->push_back(*p++);
+    }
+  }
+}
+
+size_t FsstSymbolTable::DecompressedLength(const Slice& compressed) const {
+  size_t len = 0;
+  for (size_t i = 0; i < compressed.size();) {
+    const uint8_t code = compressed[i];
+    if (code == kEscapeCode) {
+      // A trailing escape code is ignored.
+      len += i + 1 < compressed.size() ? 1 : 0;
+      i += 2;
+    } else {
+      len += lengths_[code];
+      i++;
+    }
+  }
+  return len;
+}
+
+void FsstSymbolTable::Decompress(const Slice& compressed, uint8_t* out) const {
+  for (size_t i = 0; i < compressed.size();) {
+    const uint8_t code = compressed[i];
+    if (code == kEscapeCode) {
+      if (i + 1 < compressed.size()) {
+        *out++ = compressed[i + 1];
+      }
+      i += 2;
+    } else {
+      // Codes without a symbol have a length of 0.
+      memcpy(out, &symbols_[code], lengths_[code]);
+      out += lengths_[code];
+      i++;
+    }
+  }
+}
+
+void FsstSymbolTable::Serialize(faststring* out) const {
+  out->push_back(num_symbols_);
+  for (int code = 0; code < num_symbols_; code++) {
+    out->push_back(lengths_[code]);
+  }
+  for (int code = 0; code < num_symbols_; code++) {
+    out->append(&symbols_[code], lengths_[code]);
+  }
+}
+
+Status FsstSymbolTable::Deserialize(const uint8_t** p, const uint8_t* limit) {
+  const uint8_t* cur = *p;
+  if (PREDICT_FALSE(cur >= limit)) {
+    return Status::Corruption("missing symbol table in FSST block");
+  }
+  const int num_symbols = *cur++;
+  if (PREDICT_FALSE(limit - cur < num_symbols)) {
+    return Status::Corruption(Substitute("truncated symbol table in FSST block: $0 symbols",
+                                         num_symbols));
+  }
+  Reset(num_symbols);
+  size_t total_len = 0;
+  for (int code = 0; code < num_symbols; code++) {
+    const uint8_t len = *cur++;
+    if (PREDICT_FALSE(len < 1 || len > kMaxSymbolLength)) {
+      Reset(0);
+      return Status::Corruption(Substitute("invalid length of symbol $0 in FSST block: $1",
+                                           code, len));
+    }
+    lengths_[code] = len;
+    total_len += len;
+  }
+  if (PREDICT_FALSE(limit - cur < total_len)) {
+    Reset(0);
+    return Status::Corruption(Substitute("truncated symbol table in FSST block: $0 symbols",
+                                         num_symbols));
+  }
+  for (int code = 0; code < num_symbols; code++) {
+    memcpy(&symbols_[code], cur, lengths_[code]);
+    cur += lengths_[code];
+  }
+  BuildIndex();
+  *p = cur;
+  return Status::OK();
+}
+
+////////////////////////////////////////////////////////////
+// Encoding
+////////////////////////////////////////////////////////////
+
+FsstBlockBuilder::FsstBlockBuilder(const WriterOptions* options)
+    : options_(options) {
+  Reset();
+}
+FsstBlockBuilder::~FsstBlockBuilder() = default;
+
+void FsstBlockBuilder::Reset() {
+  raw_.clear();
+  raw_offsets_.clear();
+  buffer_.clear();
+  finished_ = false;
+}
+
+bool FsstBlockBuilder::IsBlockFull() const {
+  // The size of the strings before compression, so that a block is never
+  // larger than it would have been with the plain encoding.
+  return raw_.size() + raw_offsets_.size() * sizeof(uint32_t) >
+      options_->storage_attributes.cfile_block_size;
+}
+
+int FsstBlockBuilder::Add(const uint8_t* vals, size_t count) {
+  DCHECK(!finished_);
+  DCHECK_GT(count, 0);
+  size_t i = 0;
+  while (!IsBlockFull() && i < count) {
+    const Slice* src = reinterpret_cast<const Slice*>(vals);
+    raw_offsets_.push_back(raw_.size());
+    raw_.append(src->data(), src->size());
+    i++;
+    vals += sizeof(Slice);
+  }
+  return i;
+}
+
+void FsstBlockBuilder::Finish(rowid_t ordinal_pos, vector<Slice>* slices) {
+  finished_ = true;
+  const size_t num_elems = raw_offsets_.size();
+
+  // Build the symbol table from strings spread across the block.
+  vector<Slice> sample;
+  const size_t stride = raw_.size() <= kSampleSize ? 1 : raw_.size() / kSampleSize + 1;
+  for (size_t i = 0; i < num_elems; i += stride) {
+    sample.emplace_back(raw_string(i));
+  }
+  table_.Build(sample);
+
+  buffer_.clear();
+  buffer_.reserve(kHeaderSize + raw_.size() / 2);
+  buffer_.resize(kHeaderSize);
+  table_.Serialize(&buffer_);
+
+  vector<uint32_t> offsets;
+  offsets.reserve(num_elems);
+  for (size_t i = 0; i < num_elems; i++) {
+    offsets.push_back(buffer_.size());
+    table_.Compress(raw_string(i), &buffer_);
+  }
+  const size_t offsets_pos = buffer_.size();
+
+  InlineEncodeFixed32(&buffer_[0], ordinal_pos);
+  InlineEncodeFixed32(&buffer_[4], num_elems);
+  InlineEncodeFixed32(&buffer_[8], offsets_pos);
+
+  if (!offsets.empty()) {
+    coding::AppendGroupVarInt32Sequence(&buffer_, 0, &offsets[0], offsets.size());
+  }
+
+  *slices = { Slice(buffer_) };
+}
+
+size_t FsstBlockBuilder::Count() const {
+  return raw_offsets_.size();
+}
+
+Status FsstBlockBuilder::GetFirstKey(void* key_void) const {
+  CHECK(finished_);
+  if (raw_offsets_.empty()) {
+    return Status::NotFound("no keys in data block");
+  }
+  *reinterpret_cast<Slice*>(key_void) = raw_string(0);
+  return Status::OK();
+}
+
+Status FsstBlockBuilder::GetLastKey(void* key_void) const {
+  CHECK(finished_);
+  if (raw_offsets_.empty()) {
+    return Status::NotFound("no keys in data block");
+  }
+  *reinterpret_cast<Slice*>(key_void) = raw_string(raw_offsets_.size() - 1);
+  return Status::OK();
+}
+
+////////////////////////////////////////////////////////////
+// Decoding
+////////////////////////////////////////////////////////////
+
+FsstBlockDecoder::FsstBlockDecoder(scoped_refptr<BlockHandle> block)
+    : block_(std::move(block)),
+      data_(block_->data()),
+      parsed_(false),
+      num_elems_(0),
+      ordinal_pos_base_(0),
+      cur_idx_(0) {
+}
+FsstBlockDecoder::~FsstBlockDecoder() = default;
+
+Status FsstBlockDecoder::ParseHeader() {
+  CHECK(!parsed_);
+
+  if (data_.size() < kMinHeaderSize) {
+    return Status::Corruption(
+        Substitute("not enough bytes for header: FSST block header "
+                   "size ($0) less than minimum possible header length ($1)",
+                   data_.size(), kMinHeaderSize));
+  }
+
+  ordinal_pos_base_  = DecodeFixed32(&data_[0]);
+  num_elems_         = DecodeFixed32(&data_[4]);
+  size_t offsets_pos = DecodeFixed32(&data_[8]);
+
+  if (offsets_pos > data_.size()) {
+    return Status::Corruption(
+        StringPrintf("offsets_pos %ld > block size %ld in FSST block",
+                     offsets_pos, data_.size()));
+  }
+
+  const uint8_t* p = data_.data() + FsstBlockBuilder::kHeaderSize;
+  const uint8_t* offsets_start = data_.data() + offsets_pos;
+  if (p > offsets_start) {
+    return Status::Corruption("offsets_pos points into the header of FSST block");
+  }
+  RETURN_NOT_OK(table_.Deserialize(&p, offsets_start));
+  const uint32_t strings_pos = p - data_.data();
+
+  // Decode the offsets of the strings, which must take up the rest of the
+  // block, so that a truncated block isn't mistaken for a shorter one.
+  p = offsets_start;
+  const uint8_t* limit = data_.data() + data_.size();
+  offsets_buf_.resize(sizeof(uint32_t) * (num_elems_ + 1));
+  uint32_t* dst_ptr = reinterpret_cast<uint32_t*>(offsets_buf_.data());
+  for (size_t rem = num_elems_; rem > 0;) {
+    uint32_t ints[4];
+    p = coding::DecodeGroupVarInt32_SlowButSafe(p, &ints[0], &ints[1], &ints[2], &ints[3]);
+    if (PREDICT_FALSE(p > limit)) {
+      LOG(WARNING) << "bad block: " << HexDump(data_);
+      return Status::Corruption("unable to decode offsets in FSST block");
+    }
+    const size_t n = std::min<size_t>(rem, 4);
+    for (size_t i = 0; i < n; i++) {
+      *dst_ptr++ = ints[i];
+    }
+    rem -= n;
+  }
+  if (PREDICT_FALSE(p != limit)) {
+    return Status::Corruption(Substitute("$0 unexpected bytes after the offsets in FSST block",
+                                         limit - p));
+  }
+  *dst_ptr = offsets_pos;
+
+  uint32_t prev = strings_pos;
+  for (size_t i = 0; i <= num_elems_; i++) {
+    const uint32_t cur = offset(i);
+    if (PREDICT_FALSE(cur < prev || cur > offsets_pos)) {
+      return Status::Corruption(Substitute("invalid offset $0 of string $1 in FSST block",
+                                           cur, i));
+    }
+    prev = cur;
+  }
+
+  parsed_ = true;
+  return Status::OK();
+}
+
+void FsstBlockDecoder::SeekToPositionInBlock(uint pos) {
+  if (PREDICT_FALSE(num_elems_ == 0)) {
+    DCHECK_EQ(0, pos);
+    return;
+  }
+
+  DCHECK_LE(pos, num_elems_);
+  cur_idx_ = pos;
+}
+
+Slice FsstBlockDecoder::DecompressToScratch(size_t idx) {
+  const Slice compressed = compressed_at_index(idx);
+  scratch_.resize(table_.DecompressedLength(compressed));
+  table_.Decompress(compressed, scratch_.data());
+  return Slice(scratch_);
+}
+
+Status FsstBlockDecoder::DecompressToArena(size_t idx, Arena* arena, Slice* out) const {
+  const Slice compressed = compressed_at_index(idx);
+  const size_t len = table_.DecompressedLength(compressed);
+  if (len == 0) {
+    *out = Slice();
+    return Status::OK();
+  }
+  uint8_t* data = static_cast<uint8_t*>(arena->AllocateBytes(len));
+  if (PREDICT_FALSE(data == nullptr)) {
+    return Status::IOError(
+        "Out of memory",
+        StringPrintf("Failed to allocate %d bytes in output arena", static_cast<int>(len)));
+  }
+  table_.Decompress(compressed, data);
+  *out = Slice(data, len);
+  return Status::OK();
+}
+
+Status FsstBlockDecoder::SeekAtOrAfterValue(const void* value_void, bool* exact) {
+  DCHECK(value_void != nullptr);
+
+  const Slice& target = *reinterpret_cast<const Slice*>(value_void);
+
+  uint32_t left = 0;
+  uint32_t right = num_elems_;
+  while (left != right) {
+    uint32_t mid = (left + right) / 2;
+    int c = DecompressToScratch(mid).compare(target);
+    if (c < 0) {
+      left = mid + 1;
+    } else if (c > 0) {
+      right = mid;
+    } else {
+      cur_idx_ = mid;
+      *exact = true;
+      return Status::OK();
+    }
+  }
+  *exact = false;
+  cur_idx_ = left;
+  if (cur_idx_ == num_elems_) {
+    return Status::NotFound("after last key in block");
+  }
+
+  return Status::OK();
+}
+
+Status FsstBlockDecoder::CopyNextValues(size_t* n, ColumnDataView* dst) {
+  DCHECK(parsed_);
+  CHECK_EQ(dst->type_info()->physical_type(), BINARY);
+  DCHECK_LE(*n, dst->nrows());
+  DCHECK_EQ(dst->stride(), sizeof(Slice));
+  if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+    *n = 0;
+    return Status::OK();
+  }
+  const size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+
+  Slice* out = reinterpret_cast<Slice*>(dst->data());
+  for (size_t i = 0; i < max_fetch; i++, out++, cur_idx_++) {
+    RETURN_NOT_OK(DecompressToArena(cur_idx_, dst->arena(), out));
+  }
+  *n = max_fetch;
+  return Status::OK();
+}
+
+Status FsstBlockDecoder::CopyNextAndEval(size_t* n,
+                                         ColumnMaterializationContext* ctx,
+                                         SelectionVectorView* sel,
+                                         ColumnDataView* dst) {
+  DCHECK(parsed_);
+  CHECK_EQ(dst->type_info()->physical_type(), BINARY);
+  DCHECK_LE(*n, dst->nrows());
+  DCHECK_EQ(dst->stride(), sizeof(Slice));
+  ctx->SetDecoderEvalSupported();
+  if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+    *n = 0;
+    return Status::OK();
+  }
+  const size_t max_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+
+  // Only the strings which match the predicate are copied to the arena.
+  Slice* out = reinterpret_cast<Slice*>(dst->data());
+  for (size_t i = 0; i < max_fetch; i++, out++, cur_idx_++) {
+    if (!sel->TestBit(i)) {
+      continue;
+    }
+    const Slice elem = DecompressToScratch(cur_idx_);
+    if (ctx->pred()->EvaluateCell<BINARY>(static_cast<const void*>(&elem))) {
+      RETURN_NOT_OK(CopyToArena(elem, dst->arena(), out));
+    } else {
+      sel->ClearBit(i);
+    }
+  }
+  *n = max_fetch;
+  return Status::OK();
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,250 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Block encoding for strings which replaces frequent substrings with one-byte
+// codes, in the style of FSST ("Fast Static Symbol Table"). Each block has its
+// own table of up to 255 symbols of 1 to 8 bytes, built from a sample of the
+// strings of the block. Code 255 escapes the byte which follows it.
+//
+// Unlike the general-purpose block compression codecs, each string is
+// compressed on its own, so a string may be decoded without decoding the
+// rest of the block. Repetitive strings such as URLs, paths and log lines
+// usually compress to a third to a half of their size.
+//
+// The block consists of:
+// Header:
+//   ordinal_pos (32-bit fixed)
+//   num_elems (32-bit fixed)
+//   offsets_pos (32-bit fixed): position of the first offset, relative to block start
+// Symbol table:
+//   num_symbols (8-bit)
+//   the length of each symbol (8-bit each)
+//   the bytes of each symbol, concatenated
+// Strings:
+//   the compressed strings
+// Offsets:  [pointed to by offsets_pos]
+//   gvint-encoded offsets pointing to the beginning of each compressed string.
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/common/rowid.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Arena;
+class ColumnDataView;
+class ColumnMaterializationContext;
+class SelectionVectorView;
+
+namespace cfile {
+
+class BlockHandle;
+struct WriterOptions;
+
+// The symbol table of an FSST block.
+class FsstSymbolTable {
+ public:
+  static constexpr int kMaxSymbols = 255;
+  static constexpr int kMaxSymbolLength = 8;
+  static constexpr uint8_t kEscapeCode = 255;
+
+  FsstSymbolTable();
+
+  // Builds the table which best compresses 'sample'.
+  void Build(const std::vector<Slice>& sample);
+
+  // Appends the compressed 'str' to 'out'.
+  void Compress(const Slice& str, faststring* out) const;
+
+  // Returns the length of the decompressed 'compressed'.
+  size_t DecompressedLength(const Slice& compressed) const;
+
+  // Decompresses 'compressed' to 'out', which must have room for
+  // DecompressedLength(compressed) bytes.
+  void Decompress(const Slice& compressed, uint8_t* out) const;
+
+  // Appends the table to 'out'.
+  void Serialize(faststring* out) const;
+
+  // Parses a table written by Serialize() from the bytes in [*p, limit),
+  // advancing '*p' past it.
+  Status Deserialize(const uint8_t** p, const uint8_t* limit);
+
+  int num_symbols() const {
+    return num_symbols_;
+  }
+
+ private:
+  // Clears the table and the index of the symbols by first byte.
+  void Reset(int num_symbols);
+
+  // Sorts the codes of each first byte by decreasing length, so that the
+  // longest symbol matching a string is found first.
+  void BuildIndex();
+
+  // Returns the code of the longest symbol which prefixes the 'len' bytes at
+  // 'p', or -1 if there is none.
+  int FindLongestSymbol(const uint8_t* p, size_t len) const;
+
+  int num_symbols_;
+  // The bytes of each symbol, packed in little-endian order.
+  uint64_t symbols_[kMaxSymbols];
+  uint8_t lengths_[kMaxSymbols + 1];
+  // The codes of the symbols starting with each byte.
+  std::vector<uint8_t> codes_by_first_byte_[256];
+};
+
+class FsstBlockBuilder final : public BlockBuilder {
+ public:
+  explicit FsstBlockBuilder(const WriterOptions* options);
+  ~FsstBlockBuilder();
+
+  bool IsBlockFull() const override;
+
+  int Add(const uint8_t* vals, size_t count) override;
+
+  void Finish(rowid_t ordinal_pos, std::vector<Slice>* slices) override;
+
+  void Reset() override;
+
+  size_t Count() const override;
+
+  // Return the first added key.
+  // key should be a Slice*
+  Status GetFirstKey(void* key) const override;
+
+  // Return the last added key.
+  // key should be a Slice*
+  Status GetLastKey(void* key) const override;
+
+  // Length of a header.
+  static constexpr size_t kHeaderSize = sizeof(uint32_t) * 3;
+
+  // The number of bytes of strings from which the symbol table is built.
+  static constexpr size_t kSampleSize = 16 * 1024;
+
+ private:
+  Slice raw_string(size_t idx) const {
+    const uint32_t end = idx + 1 == raw_offsets_.size() ? raw_.size() : raw_offsets_[idx + 1];
+    return Slice(&raw_[raw_offsets_[idx]], end - raw_offsets_[idx]);
+  }
+
+  // The uncompressed strings, and the offset of each of them in 'raw_'.
+  faststring raw_;
+  std::vector<uint32_t> raw_offsets_;
+
+  faststring buffer_;
+  FsstSymbolTable table_;
+
+  bool finished_;
+
+  const WriterOptions* options_;
+};
+
+class FsstBlockDecoder final : public BlockDecoder {
+ public:
+  explicit FsstBlockDecoder(scoped_refptr<BlockHandle> block);
+  ~FsstBlockDecoder();
+
+  Status ParseHeader() override;
+  void SeekToPositionInBlock(uint pos) override;
+  Status SeekAtOrAfterValue(const void* value, bool* exact_match) override;
+  Status CopyNextValues(size_t* n, ColumnDataView* dst) override;
+  Status CopyNextAndEval(size_t* n,
+                         ColumnMaterializationContext* ctx,
+                         SelectionVectorView* sel,
+                         ColumnDataView* dst) override;
+
+  bool HasNext() const override {
+    DCHECK(parsed_);
+    return cur_idx_ < num_elems_;
+  }
+
+  size_t Count() const override {
+    DCHECK(parsed_);
+    return num_elems_;
+  }
+
+  size_t GetCurrentIndex() const override {
+    DCHECK(parsed_);
+    return cur_idx_;
+  }
+
+  rowid_t GetFirstRowId() const override {
+    return ordinal_pos_base_;
+  }
+
+  // Minimum length of a header: the fixed fields and an empty symbol table.
+  static constexpr size_t kMinHeaderSize = sizeof(uint32_t) * 3 + 1;
+
+ private:
+  // Returns the compressed string with index 'idx'.
+  Slice compressed_at_index(size_t idx) const {
+    const uint32_t start = offset(idx);
+    return Slice(&data_[start], offset(idx + 1) - start);
+  }
+
+  // Decompresses the string with index 'idx' into 'scratch_'.
+  Slice DecompressToScratch(size_t idx);
+
+  // Decompresses the string with index 'idx' into 'arena'.
+  Status DecompressToArena(size_t idx, Arena* arena, Slice* out) const;
+
+  uint32_t offset(size_t idx) const {
+    const uint8_t* p = &offsets_buf_[idx * sizeof(uint32_t)];
+    uint32_t ret;
+    memcpy(&ret, p, sizeof(uint32_t));
+    return ret;
+  }
+
+  scoped_refptr<BlockHandle> block_;
+  Slice data_;
+  bool parsed_;
+
+  FsstSymbolTable table_;
+
+  // The offsets of the compressed strings in 'data_', with one extra offset
+  // at the end pointing after the last string.
+  faststring offsets_buf_;
+
+  uint32_t num_elems_;
+  rowid_t ordinal_pos_base_;
+
+  // Index of the currently seeked element in the block.
+  uint32_t cur_idx_;
+
+  // Holds the decompressed strings which are only compared, e.g. while
+  // seeking or evaluating predicates.
+  faststring scratch_;
+};
+
+} // namespace cfile
+} // namespace kudu
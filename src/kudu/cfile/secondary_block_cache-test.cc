@@ -0,0 +1,161 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/secondary_block_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/env.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace cfile {
+
+class SecondaryBlockCacheTest : public KuduTest {
+ protected:
+  void CreateCache(int64_t capacity, unique_ptr<SecondaryBlockCache>* cache) {
+    ASSERT_OK(SecondaryBlockCache::Create(env_, GetTestPath("secondary_cache"), capacity, cache));
+  }
+
+  // Looks up 'key' in 'cache', setting 'value' to its block if found.
+  static bool Lookup(SecondaryBlockCache* cache, const string& key, string* value) {
+    return cache->Lookup(key, [&](size_t size) {
+      value->resize(size);
+      return reinterpret_cast<uint8_t*>(&(*value)[0]);
+    });
+  }
+};
+
+TEST_F(SecondaryBlockCacheTest, TestLookup) {
+  unique_ptr<SecondaryBlockCache> cache;
+  NO_FATALS(CreateCache(1024 * 1024, &cache));
+  string value;
+  ASSERT_FALSE(Lookup(cache.get(), "a", &value));
+
+  cache->EvictedEntry("a", "value of a");
+  cache->EvictedEntry("b", string(10000, 'b'));
+  cache->WaitForWritesForTests();
+  ASSERT_TRUE(Lookup(cache.get(), "a", &value));
+  ASSERT_EQ("value of a", value);
+  ASSERT_TRUE(Lookup(cache.get(), "b", &value));
+  ASSERT_EQ(string(10000, 'b'), value);
+  ASSERT_FALSE(Lookup(cache.get(), "c", &value));
+
+  // Blocks aren't read if there's nowhere to read them to.
+  ASSERT_FALSE(cache->Lookup("a", [](size_t /*size*/) { return nullptr; }));
+
+  // Nothing is cached anymore after shutdown.
+  cache->Shutdown();
+  cache->EvictedEntry("c", "value of c");
+  ASSERT_FALSE(Lookup(cache.get(), "c", &value));
+  ASSERT_TRUE(Lookup(cache.get(), "a", &value));
+}
+
+// New blocks overwrite the oldest ones once the log wraps around.
+TEST_F(SecondaryBlockCacheTest, TestWrapAround) {
+  unique_ptr<SecondaryBlockCache> cache;
+  // Room for 4 records of at most 4KB.
+  NO_FATALS(CreateCache(16 * 1024, &cache));
+  for (int i = 0; i < 6; i++) {
+    cache->EvictedEntry(std::to_string(i), string(100, 'a' + i));
+  }
+  cache->WaitForWritesForTests();
+  string value;
+  ASSERT_FALSE(Lookup(cache.get(), "0", &value));
+  ASSERT_FALSE(Lookup(cache.get(), "1", &value));
+  for (int i = 2; i < 6; i++) {
+    ASSERT_TRUE(Lookup(cache.get(), std::to_string(i), &value));
+    ASSERT_EQ(string(100, 'a' + i), value);
+  }
+
+  // Blocks larger than the whole cache are dropped.
+  cache->EvictedEntry("big", string(16 * 1024, 'z'));
+  cache->WaitForWritesForTests();
+  ASSERT_FALSE(Lookup(cache.get(), "big", &value));
+  ASSERT_TRUE(Lookup(cache.get(), "5", &value));
+}
+
+// Blocks which don't match their checksum are treated as missing.
+TEST_F(SecondaryBlockCacheTest, TestCorruption) {
+  unique_ptr<SecondaryBlockCache> cache;
+  NO_FATALS(CreateCache(1024 * 1024, &cache));
+  cache->EvictedEntry("a", "value of a");
+  cache->WaitForWritesForTests();
+
+  unique_ptr<RWFile> file;
+  RWFileOptions opts;
+  opts.mode = Env::MUST_EXIST;
+  opts.is_sensitive = true;
+  ASSERT_OK(env_->NewRWFile(opts, GetTestPath("secondary_cache"), &file));
+  const uint64_t offset = file->GetEncryptionHeaderSize() > 0 ? 4096 : 0;
+  char c;
+  ASSERT_OK(file->Read(offset + 20, Slice(reinterpret_cast<uint8_t*>(&c), 1)));
+  c ^= 1;
+  ASSERT_OK(file->Write(offset + 20, Slice(reinterpret_cast<uint8_t*>(&c), 1)));
+  ASSERT_OK(file->Close());
+
+  string value;
+  ASSERT_FALSE(Lookup(cache.get(), "a", &value));
+}
+
+// The blocks evicted from a block cache are found again in its secondary cache.
+TEST_F(SecondaryBlockCacheTest, TestBlockCache) {
+  unique_ptr<SecondaryBlockCache> secondary;
+  NO_FATALS(CreateCache(16 * 1024 * 1024, &secondary));
+  SecondaryBlockCache* secondary_ptr = secondary.get();
+  BlockCache cache(64 * 1024, 0, std::move(secondary));
+
+  constexpr int kNumBlocks = 100;
+  const string data(4000, 'x');
+  for (int i = 0; i < kNumBlocks; i++) {
+    BlockCache::CacheKey key(BlockCache::FileId(1), i);
+    BlockCache::PendingEntry entry = cache.Allocate(key, data.size());
+    ASSERT_TRUE(entry.valid());
+    memcpy(entry.val_ptr(), data.data(), data.size());
+    BlockCacheHandle handle;
+    cache.Insert(&entry, &handle);
+  }
+  secondary_ptr->WaitForWritesForTests();
+
+  for (int i = 0; i < kNumBlocks; i++) {
+    BlockCache::CacheKey key(BlockCache::FileId(1), i);
+    BlockCacheHandle handle;
+    ASSERT_TRUE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &handle)) << i;
+    ASSERT_EQ(data, handle.data().ToString());
+  }
+
+  // Lookups not expecting to hit the cache don't go to the secondary cache:
+  // the first block was evicted from the DRAM cache again since.
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.Lookup(BlockCache::CacheKey(BlockCache::FileId(1), 0),
+                            Cache::NO_EXPECT_IN_CACHE, &handle));
+}
+
+} // namespace cfile
+} // namespace kudu
@@ -0,0 +1,229 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/cfile/secondary_block_cache.h"
+
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/alignment.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/threadpool.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace cfile {
+
+namespace {
+
+// The records are aligned for direct I/O.
+constexpr int64_t kRecordAlignment = 4096;
+
+// Blocks evicted while this many bytes are waiting to be written are dropped.
+constexpr int64_t kMaxQueuedBytes = 64 * 1024 * 1024;
+
+constexpr uint32_t kRecordMagic = 0x6b736263; // "kscb"
+
+// The header of a record, followed by the key and the value of the block.
+struct RecordHeader {
+  uint32_t magic;
+  uint32_t key_size;
+  uint32_t value_size;
+  // The CRC32C of the key, then the value.
+  uint32_t checksum;
+} PACKED;
+
+uint32_t Checksum(const Slice& key, const Slice& value) {
+  return crc::Crc32c(value.data(), value.size(), crc::Crc32c(key.data(), key.size()));
+}
+
+} // anonymous namespace
+
+Status SecondaryBlockCache::Create(Env* env, const string& path, int64_t capacity,
+                                   unique_ptr<SecondaryBlockCache>* cache) {
+  capacity -= capacity % kRecordAlignment;
+  if (capacity <= 0) {
+    return Status::InvalidArgument("capacity of the secondary block cache is too small");
+  }
+  RWFileOptions opts;
+  opts.mode = Env::CREATE_OR_OPEN_WITH_TRUNCATE;
+  // The blocks hold table data, to be encrypted if data at rest is.
+  opts.is_sensitive = true;
+  // The page cache would only hold the blocks twice in DRAM.
+  opts.direct_io = true;
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK_PREPEND(env->NewRWFile(opts, path, &file),
+                        "could not create the secondary block cache file");
+  // The records follow the encryption header, if any.
+  const int64_t base_offset = KUDU_ALIGN_UP(file->GetEncryptionHeaderSize(), kRecordAlignment);
+  RETURN_NOT_OK_PREPEND(file->PreAllocate(base_offset, capacity, RWFile::CHANGE_FILE_SIZE),
+                        "could not allocate the secondary block cache file");
+  unique_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("secondary-block-cache")
+                .set_min_threads(1)
+                .set_max_threads(1)
+                .Build(&pool));
+  cache->reset(new SecondaryBlockCache(base_offset, capacity, std::move(file), std::move(pool)));
+  return Status::OK();
+}
+
+SecondaryBlockCache::SecondaryBlockCache(int64_t base_offset, int64_t capacity,
+                                         unique_ptr<RWFile> file, unique_ptr<ThreadPool> pool)
+    : base_offset_(base_offset),
+      capacity_(capacity),
+      file_(std::move(file)),
+      pool_(std::move(pool)),
+      queued_bytes_(0),
+      shutdown_(false),
+      head_(0) {
+}
+
+SecondaryBlockCache::~SecondaryBlockCache() {
+  Shutdown();
+}
+
+void SecondaryBlockCache::Shutdown() {
+  if (!shutdown_.exchange(true)) {
+    pool_->Shutdown();
+  }
+}
+
+void SecondaryBlockCache::WaitForWritesForTests() {
+  pool_->Wait();
+}
+
+void SecondaryBlockCache::EvictedEntry(Slice key, Slice value) {
+  if (shutdown_) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    // The blocks never change: one cached already needn't be written again.
+    if (ContainsKey(entries_, key.ToString())) {
+      return;
+    }
+  }
+  const int64_t size = key.size() + value.size();
+  if (queued_bytes_.fetch_add(size) + size > kMaxQueuedBytes) {
+    queued_bytes_ -= size;
+    return;
+  }
+  string key_str = key.ToString();
+  string value_str = value.ToString();
+  Status s = pool_->Submit([this, size, key_str = std::move(key_str),
+                            value_str = std::move(value_str)]() {
+    WriteBlock(key_str, value_str);
+    queued_bytes_ -= size;
+  });
+  if (PREDICT_FALSE(!s.ok())) {
+    queued_bytes_ -= size;
+  }
+}
+
+void SecondaryBlockCache::WriteBlock(const string& key, const string& value) {
+  const int64_t len = KUDU_ALIGN_UP(
+      static_cast<int64_t>(sizeof(RecordHeader) + key.size() + value.size()), kRecordAlignment);
+  if (len > capacity_) {
+    return;
+  }
+  int64_t offset;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    if (ContainsKey(entries_, key)) {
+      return;
+    }
+    if (head_ + len > capacity_) {
+      head_ = 0;
+    }
+    // Drop the entries of the records about to be overwritten. Those of the
+    // records before the head end at the head at most.
+    auto it = keys_by_offset_.lower_bound(head_);
+    while (it != keys_by_offset_.end() && it->first < head_ + len) {
+      entries_.erase(it->second);
+      it = keys_by_offset_.erase(it);
+    }
+    offset = head_;
+    head_ += len;
+  }
+
+  string header(sizeof(RecordHeader), '\0');
+  RecordHeader* h = reinterpret_cast<RecordHeader*>(&header[0]);
+  h->magic = kRecordMagic;
+  h->key_size = key.size();
+  h->value_size = value.size();
+  h->checksum = Checksum(key, value);
+  header.append(key);
+  const Slice data[] = { header, value };
+  Status s = file_->WriteV(base_offset_ + offset, data);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 10) << "could not write to the secondary block cache: "
+                                   << s.ToString() << THROTTLE_MSG;
+    return;
+  }
+
+  // Only once written may the block be read.
+  std::lock_guard<std::mutex> l(lock_);
+  entries_[key] = Entry{ offset, static_cast<uint32_t>(value.size()) };
+  keys_by_offset_[offset] = key;
+}
+
+bool SecondaryBlockCache::Lookup(const Slice& key,
+                                 const std::function<uint8_t*(size_t)>& allocate) {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    const Entry* e = FindOrNull(entries_, key.ToString());
+    if (!e) {
+      return false;
+    }
+    entry = *e;
+  }
+  uint8_t* dst = allocate(entry.size);
+  if (!dst) {
+    return false;
+  }
+
+  // The record may have been overwritten since it was looked up, in which
+  // case it doesn't match the key or its checksum anymore.
+  string header(sizeof(RecordHeader) + key.size(), '\0');
+  const Slice value(dst, entry.size);
+  Slice data[] = { Slice(&header[0], header.size()), value };
+  Status s = file_->ReadV(base_offset_ + entry.offset, data);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 10) << "could not read from the secondary block cache: "
+                                   << s.ToString() << THROTTLE_MSG;
+    return false;
+  }
+  const RecordHeader* h = reinterpret_cast<const RecordHeader*>(header.data());
+  return h->magic == kRecordMagic &&
+         h->key_size == key.size() &&
+         h->value_size == entry.size &&
+         memcmp(header.data() + sizeof(RecordHeader), key.data(), key.size()) == 0 &&
+         h->checksum == Checksum(key, value);
+}
+
+} // namespace cfile
+} // namespace kudu
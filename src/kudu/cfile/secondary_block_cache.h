@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+class RWFile;
+class ThreadPool;
+
+namespace cfile {
+
+// A cache of blocks in a file on a local device, e.g. an SSD in front of HDD
+// data directories, holding the blocks evicted from the block cache in DRAM.
+// Misses of the DRAM cache are looked up here before the blocks are read from
+// the data directories.
+//
+// The file is a circular log of records, each a block with its key and a
+// checksum: new blocks overwrite the oldest ones, whose entries in the
+// in-memory index are dropped first. Blocks whose record doesn't match the
+// index entry or its checksum when read are treated as missing. The index
+// isn't persisted: the cache starts empty.
+//
+// The blocks are written by a background thread, off the path of the reads
+// which evict them from the DRAM cache. Blocks evicted while too many bytes
+// are already waiting to be written are dropped.
+//
+// Thread-safe.
+class SecondaryBlockCache : public Cache::EvictionCallback {
+ public:
+  // Creates a cache of 'capacity' bytes in a file named 'path', replacing any
+  // previous one.
+  static Status Create(Env* env, const std::string& path, int64_t capacity,
+                       std::unique_ptr<SecondaryBlockCache>* cache);
+
+  ~SecondaryBlockCache() override;
+
+  // Queues the block of key 'key' evicted from the DRAM cache, unless cached
+  // already, and stops after shutdown.
+  void EvictedEntry(Slice key, Slice value) override;
+
+  // Looks up the block of key 'key'. If it's cached, reads it into the buffer
+  // of its size returned by 'allocate' and returns true. If 'allocate' returns
+  // nullptr, the block isn't read.
+  bool Lookup(const Slice& key, const std::function<uint8_t*(size_t)>& allocate);
+
+  // Stops accepting new blocks, and waits for the queued ones to be written.
+  void Shutdown();
+
+  // Waits for the queued blocks to be written.
+  void WaitForWritesForTests();
+
+ private:
+  // The location of a block in the log.
+  struct Entry {
+    int64_t offset;
+    uint32_t size;
+  };
+
+  SecondaryBlockCache(int64_t base_offset, int64_t capacity, std::unique_ptr<RWFile> file,
+                      std::unique_ptr<ThreadPool> pool);
+
+  // Writes the block 'value' of key 'key' at the head of the log.
+  void WriteBlock(const std::string& key, const std::string& value);
+
+  // The offset in the file of the log, past the encryption header of the file.
+  const int64_t base_offset_;
+  // The capacity, a multiple of the alignment of the records.
+  const int64_t capacity_;
+  const std::unique_ptr<RWFile> file_;
+
+  // Writes the blocks, one at a time.
+  std::unique_ptr<ThreadPool> pool_;
+  std::atomic<int64_t> queued_bytes_;
+  std::atomic<bool> shutdown_;
+
+  // Protects the index, and the head of the log.
+  std::mutex lock_;
+  std::unordered_map<std::string, Entry> entries_;
+  // The keys of the entries, by offset.
+  std::map<int64_t, std::string> keys_by_offset_;
+  // Where the next record is written.
+  int64_t head_;
+
+  DISALLOW_COPY_AND_ASSIGN(SecondaryBlockCache);
+};
+
+} // namespace cfile
+} // namespace kudu
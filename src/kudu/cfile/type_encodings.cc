@@ -27,6 +27,8 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/bshuf_block.h" // IWYU pragma: keep
+#include "kudu/cfile/for_delta_block.h" // IWYU pragma: keep
+#include "kudu/cfile/fsst_block.h" // IWYU pragma: keep
 #include "kudu/cfile/plain_bitmap_block.h" // IWYU pragma: keep
 #include "kudu/cfile/plain_block.h" // IWYU pragma: keep
 #include "kudu/cfile/rle_block.h" // IWYU pragma: keep
@@ -107,6 +109,11 @@ template<>
 struct DataTypeEncodingTraits<BINARY, PREFIX_ENCODING>
     : public EncodingTraits<BinaryPrefixBlockBuilder, BinaryPrefixBlockDecoder> {};
 
+// Template specialization for strings compressed with a per-block symbol table.
+template<>
+struct DataTypeEncodingTraits<BINARY, FSST_ENCODING>
+    : public EncodingTraits<FsstBlockBuilder, FsstBlockDecoder> {};
+
 // Template for dictionary encoding
 template<>
 struct DataTypeEncodingTraits<BINARY, DICT_ENCODING>
@@ -123,6 +130,10 @@ template<DataType IntType>
 struct DataTypeEncodingTraits<IntType, RLE>
     : public EncodingTraits<RleIntBlockBuilder<IntType>, RleIntBlockDecoder<IntType>> {};
 
+template<DataType IntType>
+struct DataTypeEncodingTraits<IntType, FOR_DELTA>
+    : public EncodingTraits<ForDeltaBlockBuilder<IntType>, ForDeltaBlockDecoder<IntType>> {};
+
 template<typename TypeEncodingTraitsClass>
 TypeEncodingInfo::TypeEncodingInfo(TypeEncodingTraitsClass /*t*/)
     : encoding_type_(TypeEncodingTraitsClass::kEncodingType),
@@ -180,27 +191,35 @@ class TypeEncodingResolver {
     AddMapping<UINT8, BIT_SHUFFLE>();
     AddMapping<UINT8, PLAIN_ENCODING>();
     AddMapping<UINT8, RLE>();
+    AddMapping<UINT8, FOR_DELTA>();
     AddMapping<INT8, BIT_SHUFFLE>();
     AddMapping<INT8, PLAIN_ENCODING>();
     AddMapping<INT8, RLE>();
+    AddMapping<INT8, FOR_DELTA>();
     AddMapping<UINT16, BIT_SHUFFLE>();
     AddMapping<UINT16, PLAIN_ENCODING>();
     AddMapping<UINT16, RLE>();
+    AddMapping<UINT16, FOR_DELTA>();
     AddMapping<INT16, BIT_SHUFFLE>();
     AddMapping<INT16, PLAIN_ENCODING>();
     AddMapping<INT16, RLE>();
+    AddMapping<INT16, FOR_DELTA>();
     AddMapping<UINT32, BIT_SHUFFLE>();
     AddMapping<UINT32, RLE>();
     AddMapping<UINT32, PLAIN_ENCODING>();
+    AddMapping<UINT32, FOR_DELTA>();
     AddMapping<INT32, BIT_SHUFFLE>();
     AddMapping<INT32, PLAIN_ENCODING>();
     AddMapping<INT32, RLE>();
+    AddMapping<INT32, FOR_DELTA>();
     AddMapping<UINT64, BIT_SHUFFLE>();
     AddMapping<UINT64, PLAIN_ENCODING>();
     AddMapping<UINT64, RLE>();
+    AddMapping<UINT64, FOR_DELTA>();
     AddMapping<INT64, BIT_SHUFFLE>();
     AddMapping<INT64, PLAIN_ENCODING>();
     AddMapping<INT64, RLE>();
+    AddMapping<INT64, FOR_DELTA>();
     AddMapping<FLOAT, BIT_SHUFFLE>();
     AddMapping<FLOAT, PLAIN_ENCODING>();
     AddMapping<DOUBLE, BIT_SHUFFLE>();
@@ -208,6 +227,7 @@ class TypeEncodingResolver {
     AddMapping<BINARY, DICT_ENCODING>();
     AddMapping<BINARY, PLAIN_ENCODING>();
     AddMapping<BINARY, PREFIX_ENCODING>();
+    AddMapping<BINARY, FSST_ENCODING>();
     AddMapping<BOOL, RLE>();
     AddMapping<BOOL, PLAIN_ENCODING>();
     AddMapping<INT128, BIT_SHUFFLE>();
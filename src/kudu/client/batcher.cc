@@ -17,6 +17,7 @@
 
 #include "kudu/client/batcher.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <functional>
 #include <mutex>
@@ -26,6 +27,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/client/callbacks.h"
@@ -58,7 +60,9 @@
 #include "kudu/security/token.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 
 namespace kudu {
@@ -67,6 +71,7 @@ class Messenger;
 }  // namespace rpc
 }  // namespace kudu
 
+using kudu::client::internal::ColumnarInsertOp;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using kudu::rpc::CredentialsPolicy;
@@ -76,7 +81,11 @@ using kudu::rpc::RequestTracker;
 using kudu::rpc::ResponseCallback;
 using kudu::rpc::RetriableRpc;
 using kudu::rpc::RetriableRpcStatus;
+using kudu::rpc::RpcController;
 using kudu::security::SignedTokenPB;
+using kudu::tserver::MultiWriteRequestPB;
+using kudu::tserver::MultiWriteResponsePB;
+using kudu::tserver::TabletServerFeatures;
 using kudu::tserver::WriteRequestPB;
 using kudu::tserver::WriteResponsePB;
 using kudu::tserver::WriteResponsePB_PerRowErrorPB;
@@ -88,6 +97,14 @@ using std::unordered_map;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(client_use_multi_write, false,
+            "Whether to send the writes flushed to different tablets whose "
+            "leaders are on the same tablet server in a single MultiWrite RPC, "
+            "rather than in one Write RPC per tablet. Writes in the context of "
+            "a multi-row transaction are always sent per tablet.");
+TAG_FLAG(client_use_multi_write, experimental);
+TAG_FLAG(client_use_multi_write, runtime);
+
 namespace kudu {
 
 class RowOperationsPB;
@@ -228,8 +245,26 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   }
   const vector<InFlightOp*>& ops() const { return ops_; }
   const WriteResponsePB& resp() const { return resp_; }
+
+  // Whether the request carries columnar inserts, which only tablet servers
+  // with the COLUMNAR_WRITES feature accept.
+  bool has_columnar() const { return has_columnar_; }
+
+  // Sets 'op_idx' to the index of the op which the row at 'row_index' of the
+  // request belongs to, and 'row_in_op' to the row's index among the rows of
+  // a columnar op, or to -1. Returns false if there's no such row.
+  bool FindRow(int64_t row_index, size_t* op_idx, int* row_in_op) const;
   const string& tablet_id() const { return tablet_id_; }
 
+  // The request, for a MultiWriteRpc to send as part of a MultiWrite RPC
+  // rather than this RPC sending it itself.
+  WriteRequestPB* mutable_req() { return &req_; }
+
+  // Completes the write sent as part of a MultiWrite RPC with 'status', and
+  // with its response in 'resp' (swapped into this RPC's), if any. Deletes
+  // this object.
+  void FinishWithoutSending(const Status& status, WriteResponsePB* resp);
+
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
   RetriableRpcStatus AnalyzeResponse(const Status& rpc_cb_status) override;
@@ -264,6 +299,12 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  bool has_columnar_;
+
+  // For each op, the index of its first row in the request. Only set if the
+  // request has columnar inserts: otherwise, the ops have a row each.
+  vector<int64_t> first_rows_;
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -277,7 +318,8 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
+      tablet_id_(tablet_id),
+      has_columnar_(false) {
   const Schema* schema = table()->schema().schema_;
 
   req_.set_tablet_id(tablet_id_);
@@ -314,6 +356,8 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
   // Add the rows
   int ctr = 0;
   RowOperationsPBEncoder enc(requested);
+  int64_t num_rows = 0;
+  int64_t num_row_ops = 0;
   for (InFlightOp* op : ops_) {
 #ifndef NDEBUG
     // Run the same verification that is about to be run by the tablet server
@@ -326,7 +370,30 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
         << " not in partition " << partition_schema.PartitionDebugString(partition, *schema);
 #endif
 
-    enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
+    // The rows of columnar inserts are sent in columnar form, placed among
+    // the row-wise operations so that the server applies them in order.
+    const auto* columnar = dynamic_cast<const ColumnarInsertOp*>(op->write_op.get());
+    if (columnar) {
+      if (!has_columnar_) {
+        has_columnar_ = true;
+        first_rows_.reserve(ops_.size());
+        for (int64_t i = 0; i < num_rows; i++) {
+          first_rows_.push_back(i);
+        }
+      }
+      first_rows_.push_back(num_rows);
+      auto* block = requested->add_columnar_blocks();
+      *block = columnar->block();
+      block->set_row_op_index(num_row_ops);
+      num_rows += columnar->num_rows();
+    } else {
+      if (has_columnar_) {
+        first_rows_.push_back(num_rows);
+      }
+      enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
+      num_rows++;
+      num_row_ops++;
+    }
 
     // Set the state now, even though we haven't yet sent it -- at this point
     // there is no return, and we're definitely going to send it. If we waited
@@ -422,8 +489,37 @@ string WriteRpc::ToString() const {
                     tablet_id_, ops_.size(), num_attempts());
 }
 
+bool WriteRpc::FindRow(int64_t row_index, size_t* op_idx, int* row_in_op) const {
+  if (!has_columnar_) {
+    if (row_index < 0 || row_index >= ops_.size()) {
+      return false;
+    }
+    *op_idx = row_index;
+    *row_in_op = -1;
+    return true;
+  }
+  // The op whose first row is the last one at or before 'row_index'.
+  auto it = std::upper_bound(first_rows_.begin(), first_rows_.end(), row_index);
+  if (row_index < 0 || it == first_rows_.begin()) {
+    return false;
+  }
+  *op_idx = it - first_rows_.begin() - 1;
+  const auto* columnar = dynamic_cast<const ColumnarInsertOp*>(ops_[*op_idx]->write_op.get());
+  const int64_t offset = row_index - first_rows_[*op_idx];
+  if (!columnar) {
+    *row_in_op = -1;
+    return offset == 0;
+  }
+  *row_in_op = offset;
+  return offset < columnar->num_rows();
+}
+
 void WriteRpc::Try(RemoteTabletServer* replica, const ResponseCallback& callback) {
   VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString();
+  if (has_columnar_) {
+    mutable_retrier()->mutable_controller()->RequireServerFeature(
+        TabletServerFeatures::COLUMNAR_WRITES);
+  }
   replica->proxy()->WriteAsync(req_, &resp_,
                                mutable_retrier()->mutable_controller(),
                                callback);
@@ -441,6 +537,13 @@ void WriteRpc::Finish(const Status& status) {
   batcher_->ProcessWriteResponse(*this, final_status);
 }
 
+void WriteRpc::FinishWithoutSending(const Status& status, WriteResponsePB* resp) {
+  if (resp) {
+    resp_.Swap(resp);
+  }
+  Finish(status);
+}
+
 RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
   RetriableRpcStatus result;
   result.status = rpc_cb_status;
@@ -473,6 +576,9 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
       (resp_.has_error() &&
        resp_.error().code() == tserver::TabletServerErrorPB::TXN_LOCKED_RETRY_OP)) {
     result.result = RetriableRpcStatus::SERVICE_UNAVAILABLE;
+    if (resp_.has_error() && resp_.error().has_retry_after_ms()) {
+      result.retry_after = MonoDelta::FromMilliseconds(resp_.error().retry_after_ms());
+    }
     return result;
   }
 
@@ -598,6 +704,118 @@ void WriteRpc::GotNewAuthzTokenRetryCb(const Status& status) {
   RetriableRpc::GotNewAuthzTokenRetryCb(status);
 }
 
+// A MultiWrite RPC to a tablet server, carrying the writes of WriteRpcs to
+// tablets whose leader is cached as being that server. The WriteRpcs are
+// only sent themselves, and retried as usual, if their write can't be applied
+// as part of the MultiWrite RPC: e.g. because the server doesn't support it,
+// or is no longer the tablet's leader.
+//
+// The MultiWrite RPC itself isn't retried, and its writes' results aren't
+// tracked by the server: a write which fails in the MultiWrite RPC is only
+// sent again if the server didn't submit it to its tablet, so that it surely
+// wasn't applied.
+//
+// Deletes itself once the RPC completes.
+class MultiWriteRpc {
+ public:
+  MultiWriteRpc(KuduClient* client,
+                RemoteTabletServer* server,
+                vector<WriteRpc*> rpcs,
+                const MonoTime& deadline)
+      : client_(client),
+        server_(server),
+        rpcs_(std::move(rpcs)) {
+    controller_.set_deadline(deadline);
+    controller_.RequireServerFeature(TabletServerFeatures::MULTI_WRITE);
+    for (const WriteRpc* rpc : rpcs_) {
+      if (rpc->has_columnar()) {
+        controller_.RequireServerFeature(TabletServerFeatures::COLUMNAR_WRITES);
+        break;
+      }
+    }
+  }
+
+  void SendRpc() {
+    // Requests are swapped rather than copied. They're swapped back once the
+    // RPC completes, for the RPCs which need to send them again.
+    for (WriteRpc* rpc : rpcs_) {
+      req_.add_writes()->Swap(rpc->mutable_req());
+    }
+    server_->InitProxy(client_, [this](const Status& s) { this->InitProxyCb(s); });
+  }
+
+ private:
+  void InitProxyCb(const Status& s) {
+    if (PREDICT_FALSE(!s.ok())) {
+      VLOG(1) << Substitute("Failed to initialize proxy to $0: $1",
+                            server_->ToString(), s.ToString());
+      Finish(s);
+      return;
+    }
+    VLOG(2) << Substitute("Writing batches to $0 tablets to $1",
+                          rpcs_.size(), server_->ToString());
+    server_->proxy()->MultiWriteAsync(req_, &resp_, &controller_,
+                                      [this]() { this->Finish(this->controller_.status()); });
+  }
+
+  void Finish(const Status& s) {
+    unique_ptr<MultiWriteRpc> this_instance(this);
+    for (int i = 0; i < req_.writes_size(); i++) {
+      rpcs_[i]->mutable_req()->Swap(req_.mutable_writes(i));
+    }
+
+    if (PREDICT_FALSE(!s.ok())) {
+      // If the server didn't process the RPC, the writes are sent again. It
+      // may have, and their outcome is unknown, if it failed otherwise.
+      const bool may_have_applied = !controller_.negotiation_failed() &&
+          !(s.IsRemoteError() && controller_.error_response());
+      for (WriteRpc* rpc : rpcs_) {
+        if (may_have_applied) {
+          rpc->FinishWithoutSending(s.CloneAndPrepend(Substitute(
+              "Failed to write to tablet server $0", server_->ToString())), nullptr);
+        } else {
+          rpc->SendRpc();
+        }
+      }
+      return;
+    }
+
+    DCHECK_EQ(req_.writes_size(), resp_.responses_size());
+    DCHECK_EQ(req_.writes_size(), resp_.submitted_size());
+    for (int i = 0; i < req_.writes_size(); i++) {
+      if (i >= resp_.responses_size()) {
+        rpcs_[i]->SendRpc();
+        continue;
+      }
+      const auto& write_resp = resp_.responses(i);
+      if (!write_resp.has_error()) {
+        rpcs_[i]->FinishWithoutSending(Status::OK(), resp_.mutable_responses(i));
+        continue;
+      }
+      // Unless the server says otherwise, the write may have been applied.
+      if (i < resp_.submitted_size() && !resp_.submitted(i)) {
+        // The write wasn't applied: e.g. the server isn't the tablet's leader
+        // anymore. Its RPC is sent, and retried, as it would otherwise be.
+        rpcs_[i]->SendRpc();
+        continue;
+      }
+      // The write was submitted and then failed, e.g. because it timed out:
+      // sending it again could apply it twice.
+      const Status s = StatusFromPB(write_resp.error().status()).CloneAndPrepend(
+          Substitute("Failed to write to tablet server $0", server_->ToString()));
+      rpcs_[i]->FinishWithoutSending(s, resp_.mutable_responses(i));
+    }
+  }
+
+  KuduClient* const client_;
+  RemoteTabletServer* const server_;
+  const vector<WriteRpc*> rpcs_;
+
+  MultiWriteRequestPB req_;
+  MultiWriteResponsePB resp_;
+  RpcController controller_;
+};
+
 Batcher::Batcher(KuduClient* client,
                  scoped_refptr<ErrorCollector> error_collector,
                  sp::weak_ptr<KuduSession> session,
@@ -886,6 +1104,33 @@ void Batcher::FlushBuffersIfReady() {
     ops_copy.swap(per_tablet_ops_);
   }
 
+  // Tablets whose leader is cached as being the same server are written to
+  // in a single RPC.
+  if (FLAGS_client_use_multi_write && !txn_id_.IsValid()) {
+    unordered_map<RemoteTabletServer*, vector<RemoteTablet*>> tablets_by_leader;
+    for (const OpsMap::value_type& e : ops_copy) {
+      RemoteTabletServer* leader = e.first->LeaderTServer();
+      if (leader) {
+        tablets_by_leader[leader].push_back(e.first);
+      }
+    }
+    for (const auto& e : tablets_by_leader) {
+      if (e.second.size() < 2) {
+        continue;
+      }
+      vector<WriteRpc*> rpcs;
+      rpcs.reserve(e.second.size());
+      for (RemoteTablet* tablet : e.second) {
+        auto it = ops_copy.find(tablet);
+        rpcs.push_back(NewWriteRpc(tablet, it->second));
+        ops_copy.erase(it);
+      }
+      VLOG(3) << "FlushBuffersIfReady: already in flushing state, immediately flushing to "
+              << rpcs.size() << " tablets led by " << e.first->ToString();
+      (new MultiWriteRpc(client_, e.first, std::move(rpcs), deadline_))->SendRpc();
+    }
+  }
+
   // Now flush the ops for each tablet.
   for (const OpsMap::value_type& e : ops_copy) {
     RemoteTablet* tablet = e.first;
@@ -898,6 +1143,10 @@ void Batcher::FlushBuffersIfReady() {
 }
 
 void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
+  NewWriteRpc(tablet, ops)->SendRpc();
+}
+
+WriteRpc* Batcher::NewWriteRpc(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
   CHECK(!ops.empty());
 
   // Create and send an RPC that aggregates the ops. The RPC is freed when
@@ -912,15 +1161,14 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
                                 client_->data_->meta_cache_,
                                 ops[0]->write_op->table(),
                                 tablet));
-  WriteRpc* rpc = new WriteRpc(this,
-                               server_picker,
-                               client_->data_->request_tracker_,
-                               ops,
-                               deadline_,
-                               client_->data_->messenger_,
-                               tablet->tablet_id(),
-                               client_->data_->GetLatestObservedTimestamp());
-  rpc->SendRpc();
+  return new WriteRpc(this,
+                      server_picker,
+                      client_->data_->request_tracker_,
+                      ops,
+                      deadline_,
+                      client_->data_->messenger_,
+                      tablet->tablet_id(),
+                      client_->data_->GetLatestObservedTimestamp());
 }
 
 void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
@@ -949,7 +1197,9 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
     // TODO(todd): handle case where we get one of the more specific TS errors
     // like the tablet not being hosted?
 
-    if (err_pb.row_index() >= rpc.ops().size()) {
+    size_t op_idx;
+    int row_in_op;
+    if (!rpc.FindRow(err_pb.row_index(), &op_idx, &row_in_op)) {
       LOG(ERROR) << "Received a per_row_error for an out-of-bound op index "
                  << err_pb.row_index() << " (sent only "
                  << rpc.ops().size() << " ops)";
@@ -957,7 +1207,16 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
                  << SecureDebugString(rpc.resp());
       continue;
     }
-    unique_ptr<KuduWriteOperation> op = std::move(rpc.ops()[err_pb.row_index()]->write_op);
+    unique_ptr<KuduWriteOperation> op;
+    if (row_in_op >= 0) {
+      // The error is specific to one of the rows of a columnar insert, which
+      // remains in the op for the errors of its other rows.
+      const auto* columnar =
+          static_cast<const ColumnarInsertOp*>(rpc.ops()[op_idx]->write_op.get());
+      op = columnar->NewRowInsert(row_in_op);
+    } else {
+      op = std::move(rpc.ops()[op_idx]->write_op);
+    }
     VLOG(2) << "Error on op " << op->ToString() << ": "
             << SecureShortDebugString(err_pb.error());
     Status op_status = StatusFromPB(err_pb.error());
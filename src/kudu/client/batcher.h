@@ -162,6 +162,10 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   void FlushBuffersIfReady();
   void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
 
+  // Creates an RPC to write 'ops' to 'tablet', without sending it. The RPC
+  // takes ownership of the ops.
+  WriteRpc* NewWriteRpc(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
+
   // Cleans up an RPC response, scooping out any errors and passing them up
   // to the batcher.
   void ProcessWriteResponse(const WriteRpc& rpc, const Status& s);
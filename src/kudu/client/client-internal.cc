@@ -32,7 +32,7 @@
 
 #include <boost/container/small_vector.hpp>
 #include <boost/container/vector.hpp>
-#include <gflags/gflags_declare.h>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/stubs/common.h>
 
@@ -40,15 +40,19 @@
 #include "kudu/client/master_proxy_rpc.h"
 #include "kudu/client/master_rpc.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/scanner-internal.h"
 #include "kudu/client/schema.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
@@ -63,23 +67,45 @@
 #include "kudu/security/cert.h"
 #include "kudu/security/tls_context.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/openssl_util.h"
 #include "kudu/util/thread_restrictions.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_bool(client_prefer_low_latency_replicas, false,
+            "Whether scans using the CLOSEST_REPLICA selection should pick, among "
+            "equally close replicas, one at random with a probability inversely "
+            "proportional to the latency with which its tablet server has served "
+            "the client's recent scan RPCs. If false, one of the equally close "
+            "replicas is picked uniformly at random.");
+TAG_FLAG(client_prefer_low_latency_replicas, experimental);
+TAG_FLAG(client_prefer_low_latency_replicas, runtime);
+
+DEFINE_int32(client_async_scan_max_threads, 4,
+             "The maximum number of threads used by a client's asynchronous "
+             "scans for the steps which block: opening the scans of tablets, "
+             "retrying failed scan requests, and parallel scans. Fetching the "
+             "next batch of a tablet's scan doesn't use a thread.");
+TAG_FLAG(client_async_scan_max_threads, advanced);
 
 DECLARE_int32(dns_resolver_max_threads_num);
 DECLARE_uint32(dns_resolver_cache_capacity_mb);
 DECLARE_uint32(dns_resolver_cache_ttl_sec);
+DECLARE_uint32(client_scan_result_cache_capacity_mb);
+DECLARE_uint32(client_scan_result_cache_ttl_sec);
 
 
 using boost::container::small_vector;
 using kudu::client::internal::AsyncLeaderMasterRpc;
 using kudu::client::internal::ConnectToClusterRpc;
+using kudu::client::internal::RemoteReplica;
 using kudu::client::internal::RemoteTablet;
 using kudu::client::internal::RemoteTabletServer;
+using kudu::consensus::RaftPeerPB;
 using kudu::master::AlterTableRequestPB;
 using kudu::master::AlterTableResponsePB;
 using kudu::master::ConnectToMasterResponsePB;
@@ -170,7 +196,13 @@ KuduClient::Data::Data()
           FLAGS_dns_resolver_max_threads_num,
           FLAGS_dns_resolver_cache_capacity_mb * 1024 * 1024,
           MonoDelta::FromSeconds(FLAGS_dns_resolver_cache_ttl_sec))),
+      scan_result_cache_(FLAGS_client_scan_result_cache_capacity_mb == 0 ? nullptr :
+          new internal::ScanResultCache(
+              FLAGS_client_scan_result_cache_capacity_mb * 1024 * 1024,
+              MonoDelta::FromSeconds(FLAGS_client_scan_result_cache_ttl_sec),
+              {}, 0, "client-scan-result-cache")),
       hive_metastore_sasl_enabled_(false),
+      next_lookup_master_(0),
       latest_observed_timestamp_(KuduClient::kNoTimestamp) {
 }
 
@@ -182,6 +214,7 @@ KuduClient::Data::~Data() {
   // fix urgently, because typically once a client is shutting down, latency
   // jitter on the reactor is not a big deal (and DNS resolutions are not in flight).
   ThreadRestrictions::ScopedAllowWait allow_wait;
+  async_scan_pool_.reset();
   dns_resolver_.reset();
 }
 
@@ -199,13 +232,74 @@ int InitRandomSelectionInt() {
 }
 static const int kRandomSelectionInt = InitRandomSelectionInt();
 
+// Returns the smoothed scan latency of the tablet server in microseconds, or 0
+// if no scan latency has been recorded for it yet.
+int64_t ScanLatencyUs(const RemoteTabletServer& rts) {
+  const MonoDelta latency = rts.smoothed_scan_latency();
+  return latency.Initialized() ? latency.ToMicroseconds() : 0;
+}
+
+// Returns the number of leading components the locations 'a' and 'b' have in
+// common, e.g. 1 for "/dc1/rack1" and "/dc1/rack2".
+int CommonLocationDepth(const string& a, const string& b) {
+  const vector<StringPiece> a_parts = strings::Split(a, "/", strings::SkipEmpty());
+  const vector<StringPiece> b_parts = strings::Split(b, "/", strings::SkipEmpty());
+  int depth = 0;
+  while (depth < a_parts.size() && depth < b_parts.size() &&
+         a_parts[depth] == b_parts[depth]) {
+    depth++;
+  }
+  return depth;
+}
+
+// Picks one of the replicas of 'tier', all equally close to the client.
+template<class Tier>
+RemoteTabletServer* PickReplica(const Tier& tier) {
+  DCHECK(!tier.empty());
+  const uint32_t random = static_cast<uint32_t>(kRandomSelectionInt);
+  if (!FLAGS_client_prefer_low_latency_replicas) {
+    return tier[random % tier.size()];
+  }
+  // Servers not scanned yet count as fast as the fastest one, so they get
+  // sampled.
+  int64_t min_latency_us = std::numeric_limits<int64_t>::max();
+  for (const RemoteTabletServer* rts : tier) {
+    const int64_t latency_us = ScanLatencyUs(*rts);
+    if (latency_us > 0) {
+      min_latency_us = std::min(min_latency_us, latency_us);
+    }
+  }
+  if (min_latency_us == std::numeric_limits<int64_t>::max()) {
+    return tier[random % tier.size()];
+  }
+  small_vector<double, 3> weights;
+  double total_weight = 0;
+  for (const RemoteTabletServer* rts : tier) {
+    const int64_t latency_us = ScanLatencyUs(*rts);
+    weights.push_back(1.0 / (latency_us > 0 ? latency_us : min_latency_us));
+    total_weight += weights.back();
+  }
+  // The random selection integer sets the point of the distribution of the
+  // weights the process picks, for the process to stick to a replica while
+  // the latencies don't change much.
+  double point = (random % 1000000) / 1e6 * total_weight;
+  for (size_t i = 0; i < tier.size(); i++) {
+    point -= weights[i];
+    if (point < 0) {
+      return tier[i];
+    }
+  }
+  return tier[tier.size() - 1];
+}
+
 } // anonymous namespace
 
 RemoteTabletServer* KuduClient::Data::SelectTServer(
     const scoped_refptr<RemoteTablet>& rt,
     const ReplicaSelection selection,
     const set<string>& blacklist,
-    vector<RemoteTabletServer*>* candidates) const {
+    vector<RemoteTabletServer*>* candidates,
+    bool allow_non_voters) const {
   RemoteTabletServer* ret = nullptr;
   candidates->clear();
   switch (selection) {
@@ -221,7 +315,13 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(
     }
     case CLOSEST_REPLICA:
     case FIRST_REPLICA: {
-      rt->GetRemoteTabletServers(candidates);
+      vector<RemoteReplica> replicas;
+      rt->GetRemoteReplicas(&replicas);
+      for (const RemoteReplica& replica : replicas) {
+        if (allow_non_voters || replica.role != RaftPeerPB::LEARNER) {
+          candidates->push_back(replica.ts);
+        }
+      }
       // Exclude all the blacklisted candidates.
       vector<RemoteTabletServer*> filtered;
       for (RemoteTabletServer* rts : *candidates) {
@@ -240,38 +340,48 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(
       // Choose a replica as follows:
       // 1. If there is a replica local to the client according to its IP and
       //    assigned location, pick it. If there are multiple, pick a random one.
-      // 2. Otherwise, if there is a replica in the same assigned location,
-      //    pick it. If there are multiple, pick a random one.
-      // 3. If there are no local replicas or replicas in the same location,
-      //    pick a random replica.
-      // TODO(wdberkeley): Eventually, the client might use the hierarchical
-      // structure of a location to determine proximity.
-      // NOTE: this is the same logic implemented in RemoteTablet.java.
+      // 2. Otherwise, if there are replicas whose assigned location shares
+      //    leading components with the client's, e.g. "/dc1/rack2" for a
+      //    client in "/dc1/rack1", pick one of those sharing the most. If
+      //    there are multiple, pick a random one.
+      // 3. Otherwise, pick a random replica.
+      // With --client_prefer_low_latency_replicas, the random picks are
+      // weighted by the inverse of the smoothed scan latency of the servers.
+      // NOTE: this extends the logic implemented in RemoteTablet.java, which
+      // only considers replicas with exactly the client's location in step 2.
       const string client_location = location();
       small_vector<RemoteTabletServer*, 1> local;
-      small_vector<RemoteTabletServer*, 3> same_location;
+      small_vector<RemoteTabletServer*, 3> closest_location;
       local.reserve(filtered.size());
-      same_location.reserve(filtered.size());
+      closest_location.reserve(filtered.size());
+      int closest_depth = 0;
       for (RemoteTabletServer* rts : filtered) {
-        bool ts_same_location = !client_location.empty() && client_location == rts->location();
+        const string ts_location = rts->location();
+        bool ts_same_location = !client_location.empty() && client_location == ts_location;
         // Only consider a server "local" if the client is in the same
         // location, or if there is missing location info.
-        if (client_location.empty() || rts->location().empty() ||
+        if (client_location.empty() || ts_location.empty() ||
             ts_same_location) {
           if (IsTabletServerLocal(*rts)) {
             local.push_back(rts);
           }
         }
-        if (ts_same_location) {
-          same_location.push_back(rts);
+        const int depth = ts_same_location ? std::numeric_limits<int>::max()
+                                           : CommonLocationDepth(client_location, ts_location);
+        if (depth > 0 && depth >= closest_depth) {
+          if (depth > closest_depth) {
+            closest_location.clear();
+            closest_depth = depth;
+          }
+          closest_location.push_back(rts);
         }
       }
       if (!local.empty()) {
-        ret = local[kRandomSelectionInt % local.size()];
-      } else if (!same_location.empty()) {
-        ret = same_location[kRandomSelectionInt % same_location.size()];
+        ret = PickReplica(local);
+      } else if (!closest_location.empty()) {
+        ret = PickReplica(closest_location);
       } else if (!filtered.empty()) {
-        ret = filtered[kRandomSelectionInt % filtered.size()];
+        ret = PickReplica(filtered);
       }
       break;
     }
@@ -289,9 +399,11 @@ Status KuduClient::Data::GetTabletServer(KuduClient* client,
                                          ReplicaSelection selection,
                                          const set<string>& blacklist,
                                          vector<RemoteTabletServer*>* candidates,
-                                         RemoteTabletServer** ts) {
+                                         RemoteTabletServer** ts,
+                                         bool allow_non_voters) {
   // TODO: write a proper async version of this for async client.
-  RemoteTabletServer* ret = SelectTServer(rt, selection, blacklist, candidates);
+  RemoteTabletServer* ret = SelectTServer(rt, selection, blacklist, candidates,
+                                          allow_non_voters);
   if (PREDICT_FALSE(ret == nullptr)) {
     // Construct a blacklist string if applicable.
     string blacklist_string = "";
@@ -465,6 +577,14 @@ Status KuduClient::Data::ListTablesWithInfo(KuduClient* client,
   return Status::OK();
 }
 
+Status KuduClient::Data::InitAsyncScanPool() {
+  // The threads are only started as asynchronous scans need them.
+  return ThreadPoolBuilder("client-async-scan")
+      .set_min_threads(0)
+      .set_max_threads(FLAGS_client_async_scan_max_threads)
+      .Build(&async_scan_pool_);
+}
+
 Status KuduClient::Data::InitLocalHostNames() {
   // Currently, we just use our configured hostname, and resolve it to come up with
   // a list of potentially local hosts. It would be better to iterate over all of
@@ -709,6 +829,15 @@ void KuduClient::Data::ConnectedToClusterCb(
       for (const auto& hostport : connect_response.master_addrs()) {
         master_hostports_.emplace_back(HostPort(hostport.host(), hostport.port()));
       }
+      lookup_master_proxies_.clear();
+      if (master_hostports_.size() > 1) {
+        for (const auto& hostport : master_hostports_) {
+          auto proxy = std::make_shared<MasterServiceProxy>(
+              messenger_, hostport, dns_resolver_.get());
+          proxy->set_user_credentials(user_credentials_);
+          lookup_master_proxies_.emplace_back(std::move(proxy));
+        }
+      }
 
       const auto& hive_config = connect_response.hms_config();
       hive_metastore_uris_ = hive_config.hms_uris();
@@ -886,6 +1015,15 @@ shared_ptr<master::MasterServiceProxy> KuduClient::Data::master_proxy() const {
   return master_proxy_;
 }
 
+shared_ptr<master::MasterServiceProxy> KuduClient::Data::lookup_master_proxy() {
+  std::lock_guard<simple_spinlock> l(leader_master_lock_);
+  if (lookup_master_proxies_.empty()) {
+    return nullptr;
+  }
+  next_lookup_master_ = (next_lookup_master_ + 1) % lookup_master_proxies_.size();
+  return lookup_master_proxies_[next_lookup_master_];
+}
+
 std::shared_ptr<transactions::TxnManagerServiceProxy>
 KuduClient::Data::txn_manager_proxy() const {
   std::lock_guard<simple_spinlock> l(leader_master_lock_);
@@ -44,6 +44,9 @@ namespace kudu {
 class DnsResolver;
 class PartitionSchema;
 class Sockaddr;
+class ThreadPool;
+template<typename K, typename V>
+class TTLCache;
 
 namespace security {
 class SignedTokenPB;
@@ -78,6 +81,8 @@ namespace internal {
 class ConnectToClusterRpc;
 class MetaCache;
 class RemoteTablet;
+struct CachedScanResult;
+typedef TTLCache<std::string, CachedScanResult> ScanResultCache;
 class RemoteTabletServer;
 } // namespace internal
 
@@ -94,12 +99,17 @@ class KuduClient::Data {
   // The 'candidates' return parameter indicates tservers that are live and meet the selection
   // criteria, but are possibly filtered by the blacklist. This is useful for implementing
   // retry logic.
+  //
+  // Unless 'allow_non_voters' is true, the replicas which aren't voters, e.g.
+  // read replicas, aren't selected: they may lag behind the voters arbitrarily,
+  // so they're only fit for reads which wait for them to catch up.
   Status GetTabletServer(KuduClient* client,
                          const scoped_refptr<internal::RemoteTablet>& rt,
                          ReplicaSelection selection,
                          const std::set<std::string>& blacklist,
                          std::vector<internal::RemoteTabletServer*>* candidates,
-                         internal::RemoteTabletServer** ts);
+                         internal::RemoteTabletServer** ts,
+                         bool allow_non_voters = false);
 
   static Status CreateTable(KuduClient* client,
                             const master::CreateTableRequestPB& req,
@@ -175,6 +185,8 @@ class KuduClient::Data {
 
   Status InitLocalHostNames();
 
+  Status InitAsyncScanPool();
+
   bool IsLocalHostPort(const HostPort& hp) const;
 
   bool IsTabletServerLocal(const internal::RemoteTabletServer& rts) const;
@@ -192,7 +204,8 @@ class KuduClient::Data {
       const scoped_refptr<internal::RemoteTablet>& rt,
       const ReplicaSelection selection,
       const std::set<std::string>& blacklist,
-      std::vector<internal::RemoteTabletServer*>* candidates) const;
+      std::vector<internal::RemoteTabletServer*>* candidates,
+      bool allow_non_voters = false) const;
 
   // Sets 'master_proxy_' from the address specified by 'leader_addr'.
   // Called by ConnectToClusterRpc::SendRpcCb() upon successful completion.
@@ -247,6 +260,10 @@ class KuduClient::Data {
                        const security::SignedTokenPB& token);
 
   std::shared_ptr<master::MasterServiceProxy> master_proxy() const;
+
+  // Returns a proxy to one of the masters, each taken in turn, to send a
+  // tablet location lookup to. Returns nullptr if there's a single master.
+  std::shared_ptr<master::MasterServiceProxy> lookup_master_proxy();
   std::shared_ptr<transactions::TxnManagerServiceProxy> txn_manager_proxy() const;
 
   HostPort leader_master_hostport() const;
@@ -288,6 +305,14 @@ class KuduClient::Data {
   // upon learning of its expiration.
   internal::AuthzTokenCache authz_token_cache_;
 
+  // The rows of tablets scanned by KuduScanners with result caching enabled,
+  // or nullptr if --client_scan_result_cache_capacity_mb is 0.
+  std::unique_ptr<internal::ScanResultCache> scan_result_cache_;
+
+  // Runs the steps of asynchronous scans which block. See
+  // KuduScanner::NextBatchAsync().
+  std::unique_ptr<ThreadPool> async_scan_pool_;
+
   // Set of hostnames and IPs on the local host.
   // This is initialized at client startup.
   std::unordered_set<std::string> local_host_names_;
@@ -317,6 +342,12 @@ class KuduClient::Data {
   // Proxy to the leader master.
   std::shared_ptr<master::MasterServiceProxy> master_proxy_;
 
+  // Proxies to every master in 'master_hostports_', to spread tablet location
+  // lookups across them. Empty if there's a single master. Lookups go to the
+  // master at 'next_lookup_master_' next.
+  std::vector<std::shared_ptr<master::MasterServiceProxy>> lookup_master_proxies_;
+  size_t next_lookup_master_;
+
   // A proxy to TxnManagerService instance. As of now, every master hosts
   // a TxnManagerService, so it's easy to find one.
   //
@@ -334,6 +365,7 @@ class KuduClient::Data {
 
   // Protects 'leader_master_rpc_{any,primary}_creds_',
   // 'leader_master_hostport_', 'master_hostports_', 'master_proxy_',
+  // 'lookup_master_proxies_', 'next_lookup_master_',
   // 'location_', and 'cluster_id'.
   //
   // See: KuduClient::Data::ConnectToClusterAsync for a more
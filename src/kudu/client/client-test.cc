@@ -23,6 +23,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
+#include <future>
 #include <initializer_list>
 #include <iterator>
 #include <map>
@@ -45,6 +46,7 @@
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
+#include "kudu/client/arrow_c_data-internal.h"
 #include "kudu/client/batcher.h"
 #include "kudu/client/callbacks.h"
 #include "kudu/client/client-internal.h"
@@ -74,6 +76,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/txn_id.h"
+#include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/atomicops.h"
@@ -97,12 +100,14 @@
 #include "kudu/mini-cluster/internal_mini_cluster.h"
 #include "kudu/mini-cluster/mini_cluster.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/service_pool.h"
 #include "kudu/security/tls_context.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/transactions/transactions.pb.h"
 #include "kudu/tserver/mini_tablet_server.h"
@@ -111,13 +116,16 @@
 #include "kudu/tserver/tablet_server_options.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/barrier.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"  // IWYU pragma: keep
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
@@ -138,6 +146,9 @@ class PartitionKey;
 DECLARE_bool(allow_unsafe_replication_factor);
 DECLARE_bool(catalog_manager_support_live_row_count);
 DECLARE_bool(catalog_manager_support_on_disk_size);
+DECLARE_bool(client_scan_hedging);
+DECLARE_bool(client_scan_prefetch);
+DECLARE_bool(client_use_multi_write);
 DECLARE_bool(client_use_unix_domain_sockets);
 DECLARE_bool(enable_per_range_hash_schemas);
 DECLARE_bool(enable_txn_system_client_init);
@@ -167,6 +178,7 @@ DECLARE_int32(max_table_comment_length);
 DECLARE_int32(min_num_replicas);
 DECLARE_int32(raft_heartbeat_interval_ms);
 DECLARE_int32(scanner_batch_size_rows);
+DECLARE_int32(scanner_default_batch_size_bytes);
 DECLARE_int32(scanner_gc_check_interval_us);
 DECLARE_int32(scanner_inject_latency_on_each_batch_ms);
 DECLARE_int32(scanner_max_batch_size_bytes);
@@ -194,6 +206,7 @@ METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetMasterRegi
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableLocations);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTableSchema);
 METRIC_DECLARE_histogram(handler_latency_kudu_master_MasterService_GetTabletLocations);
+METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_MultiWrite);
 METRIC_DECLARE_histogram(handler_latency_kudu_tserver_TabletServerService_Scan);
 
 using base::subtle::Atomic32;
@@ -1232,6 +1245,131 @@ TEST_F(ClientTest, TestColumnarScan) {
   ASSERT_EQ(num_rows, total_rows);
 }
 
+// A columnar batch exported through the Arrow C data interface keeps its
+// data after the batch is reused for the next one.
+TEST_F(ClientTest, TestColumnarScanExportToArrow) {
+  const int kNumRows = 1000;
+  FLAGS_scanner_batch_size_rows = 100;
+  NO_FATALS(InsertTestRows(client_table_.get(), kNumRows));
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT));
+  ASSERT_OK(scanner.Open());
+
+  KuduColumnarScanBatch batch;
+  int total_rows = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    ArrowSchema schema;
+    ArrowArray array;
+    ASSERT_OK(batch.ExportToArrow(&schema, &array));
+    ASSERT_EQ(0, batch.NumRows());
+
+    ASSERT_STREQ("+s", schema.format);
+    ASSERT_EQ(4, schema.n_children);
+    ASSERT_STREQ("key", schema.children[0]->name);
+    ASSERT_STREQ("i", schema.children[0]->format);
+    ASSERT_EQ(0, schema.children[0]->flags);
+    ASSERT_STREQ("u", schema.children[2]->format);
+    ASSERT_EQ(ARROW_FLAG_NULLABLE, schema.children[2]->flags);
+    schema.release(&schema);
+    ASSERT_EQ(nullptr, schema.release);
+
+    ASSERT_EQ(4, array.n_children);
+    const ArrowArray* keys = array.children[0];
+    const ArrowArray* strings = array.children[2];
+    ASSERT_EQ(array.length, keys->length);
+    ASSERT_EQ(2, keys->n_buffers);
+    ASSERT_EQ(3, strings->n_buffers);
+    const auto* key_data = static_cast<const int32_t*>(keys->buffers[1]);
+    const auto* offsets = static_cast<const int32_t*>(strings->buffers[1]);
+    const auto* chars = static_cast<const char*>(strings->buffers[2]);
+    for (int64_t i = 0; i < array.length; i++) {
+      const int row_idx = total_rows + i;
+      EXPECT_EQ(row_idx, key_data[i]);
+      EXPECT_EQ(Substitute("hello $0", row_idx),
+                string(chars + offsets[i], offsets[i + 1] - offsets[i]));
+    }
+    total_rows += array.length;
+    array.release(&array);
+    ASSERT_EQ(nullptr, array.release);
+  }
+  ASSERT_EQ(kNumRows, total_rows);
+}
+
+// With COLUMNAR_DICTIONARY_ENCODING, the dictionary-encoded string column is sent
+// as a dictionary and codes, both from disk and from the MemRowSet.
+TEST_F(ClientTest, TestColumnarScanDictionaryEncoding) {
+  const int kNumRows = 1000;
+  FLAGS_scanner_batch_size_rows = 100;
+  const auto value_of = [](int row_idx) { return Substitute("value $0", row_idx % 3); };
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  for (int i = 0; i < kNumRows; i++) {
+    unique_ptr<KuduInsert> insert(client_table_->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt32("key", i));
+    ASSERT_OK(insert->mutable_row()->SetInt32("int_val", i));
+    ASSERT_OK(insert->mutable_row()->SetStringCopy("string_val", value_of(i)));
+    ASSERT_OK(session->Apply(insert.release()));
+    if (i == kNumRows / 2) {
+      ASSERT_OK(session->Flush());
+      ASSERT_OK(cluster_->FlushTablet(GetFirstTabletId(client_table_.get())));
+    }
+  }
+  ASSERT_OK(session->Flush());
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetProjectedColumnNames({ "key", "string_val" }));
+  ASSERT_OK(scanner.SetRowFormatFlags(KuduScanner::COLUMNAR_LAYOUT |
+                                      KuduScanner::COLUMNAR_DICTIONARY_ENCODING));
+  ASSERT_OK(scanner.Open());
+  KuduColumnarScanBatch batch;
+  int total_rows = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    if (batch.NumRows() == 0) {
+      continue;
+    }
+    Slice keys;
+    ASSERT_OK(batch.GetFixedLengthColumn(0, &keys));
+    Slice codes;
+    Slice offsets;
+    Slice data;
+    ASSERT_OK(batch.GetDictionaryColumn(1, &codes, &offsets, &data));
+    ASSERT_LE(offsets.size() / sizeof(uint32_t) - 1, 3);
+    Status s = batch.GetVariableLengthColumn(1, &offsets, &data);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+    s = batch.GetDictionaryColumn(0, &codes, &offsets, &data);
+    ASSERT_TRUE(s.IsNotFound()) << s.ToString();
+    ASSERT_OK(batch.GetDictionaryColumn(1, &codes, &offsets, &data));
+
+    const auto* key_data = reinterpret_cast<const int32_t*>(keys.data());
+    const auto* code_data = reinterpret_cast<const uint32_t*>(codes.data());
+    const auto* offset_data = reinterpret_cast<const uint32_t*>(offsets.data());
+    for (int i = 0; i < batch.NumRows(); i++) {
+      const uint32_t code = code_data[i];
+      EXPECT_EQ(value_of(key_data[i]),
+                Slice(&data[offset_data[code]], offset_data[code + 1] - offset_data[code]));
+    }
+
+    // The column is exported to Arrow as a dictionary.
+    ArrowSchema schema;
+    ArrowArray array;
+    ASSERT_OK(batch.ExportToArrow(&schema, &array));
+    ASSERT_STREQ("i", schema.children[1]->format);
+    ASSERT_NE(nullptr, schema.children[1]->dictionary);
+    ASSERT_STREQ("u", schema.children[1]->dictionary->format);
+    ASSERT_EQ(nullptr, schema.children[0]->dictionary);
+    ASSERT_NE(nullptr, array.children[1]->dictionary);
+    ASSERT_EQ(offsets.size() / sizeof(uint32_t) - 1, array.children[1]->dictionary->length);
+    schema.release(&schema);
+    ASSERT_EQ(nullptr, schema.release);
+    total_rows += array.length;
+    array.release(&array);
+    ASSERT_EQ(nullptr, array.release);
+  }
+  ASSERT_EQ(kNumRows, total_rows);
+}
+
 const KuduScanner::ReadMode read_modes[] = {
     KuduScanner::READ_LATEST,
     KuduScanner::READ_AT_SNAPSHOT,
@@ -2430,6 +2568,59 @@ TEST_F(ClientTest, TestMetaCacheExpiryWithKeysAndIds) {
   ASSERT_FALSE(entry.stale());
 }
 
+// Test prefetching the locations of all the tablets of a table, and passing
+// them to another client.
+TEST_F(ClientTest, TestPrefetchAndLoadTabletLocations) {
+  vector<Partition> partitions;
+  ASSERT_OK(client_table_->ListPartitions(&partitions));
+  ASSERT_GT(partitions.size(), 1);
+
+  shared_ptr<KuduClient> source_client;
+  ASSERT_OK(cluster_->CreateClient(nullptr, &source_client));
+  shared_ptr<KuduTable> source_table;
+  ASSERT_OK(source_client->OpenTable(kTableName, &source_table));
+  ASSERT_OK(source_table->PrefetchTabletLocations());
+  internal::MetaCacheEntry entry;
+  for (const auto& partition : partitions) {
+    ASSERT_TRUE(source_client->data_->meta_cache_->LookupEntryByKeyFastPath(
+        source_table.get(), partition.begin(), &entry));
+  }
+
+  string buf;
+  ASSERT_OK(source_table->SerializeTabletLocations(&buf));
+  TableLocationsPB pb;
+  ASSERT_TRUE(pb.ParseFromString(buf));
+  ASSERT_EQ(source_table->id(), pb.table_id());
+  ASSERT_EQ(partitions.size(), pb.tablets_size());
+
+  shared_ptr<KuduClient> dest_client;
+  ASSERT_OK(cluster_->CreateClient(nullptr, &dest_client));
+  shared_ptr<KuduTable> dest_table;
+  ASSERT_OK(dest_client->OpenTable(kTableName, &dest_table));
+  ASSERT_OK(dest_table->LoadTabletLocations(buf));
+  for (const auto& partition : partitions) {
+    ASSERT_TRUE(dest_client->data_->meta_cache_->LookupEntryByKeyFastPath(
+        dest_table.get(), partition.begin(), &entry));
+    ASSERT_FALSE(entry.is_non_covered_range());
+  }
+
+  // The locations of one table can't be loaded for another.
+  shared_ptr<KuduTable> other_table;
+  ASSERT_OK(CreateTable("other", 1, {}, {}, &other_table));
+  Status s = other_table->LoadTabletLocations(buf);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = dest_table->LoadTabletLocations("garbage");
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Writes go to the tablet servers without looking anything up from the
+  // masters.
+  cluster_->ShutdownNodes(cluster::ClusterNodes::MASTERS_ONLY);
+  shared_ptr<KuduSession> session(dest_client->NewSession());
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  NO_FATALS(InsertTestRows(dest_table.get(), session.get(), 20));
+  ASSERT_OK(session->Flush());
+}
+
 // Test that if our cache entry indicates there is no leader, we will perform a
 // lookup and refresh our cache entry.
 TEST_F(ClientTest, TestMetaCacheLookupNoLeaders) {
@@ -2707,6 +2898,366 @@ static void AssertScannersDisappear(const tserver::ScannerManager* manager) {
   FAIL() << "Waited too long for the scanner to close";
 }
 
+// A new scan request outstanding for longer than usual is also sent to another
+// replica. The scan returns the same rows, and the scanner opened on the
+// replica whose response wasn't used is closed.
+TEST_F(ClientTest, TestHedgedScans) {
+  const string kTableName = "TestHedgedScans";
+  const int kNumReplicas = 3;
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(CreateTable(kTableName, kNumReplicas, {}, {}, &table));
+  NO_FATALS(InsertTestRows(table.get(), FLAGS_test_scan_num_rows));
+
+  FLAGS_client_scan_hedging = true;
+  const auto scan = [&](vector<string>* rows) {
+    KuduScanner scanner(table.get());
+    RETURN_NOT_OK(scanner.SetSelection(KuduClient::CLOSEST_REPLICA));
+    RETURN_NOT_OK(scanner.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+    // Small batches, so that the scan opens a scanner on the tablet server.
+    RETURN_NOT_OK(scanner.SetBatchSizeBytes(1));
+    return ScanToStrings(&scanner, rows);
+  };
+  const auto scan_rpcs = [&](int idx) {
+    return METRIC_handler_latency_kudu_tserver_TabletServerService_Scan.Instantiate(
+        cluster_->mini_tablet_server(idx)->server()->metric_entity())->TotalCount();
+  };
+
+  // Fast scans establish the usual scan latency of the replicas.
+  vector<string> expected_rows;
+  for (int i = 0; i < 5; i++) {
+    vector<string> rows;
+    ASSERT_OK(scan(&rows));
+    ASSERT_EQ(FLAGS_test_scan_num_rows, rows.size());
+    expected_rows.swap(rows);
+  }
+
+  vector<int64_t> rpcs_before;
+  for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+    rpcs_before.push_back(scan_rpcs(i));
+  }
+  FLAGS_scanner_inject_latency_on_each_batch_ms = 100;
+  vector<string> rows;
+  ASSERT_OK(scan(&rows));
+  FLAGS_scanner_inject_latency_on_each_batch_ms = 0;
+  ASSERT_EQ(expected_rows, rows);
+
+  // Scanner continuations only go to the replica whose response was used, so
+  // a second replica serving scans means the scan was hedged.
+  int num_servers_scanned = 0;
+  for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+    if (scan_rpcs(i) > rpcs_before[i]) {
+      num_servers_scanned++;
+    }
+    NO_FATALS(AssertScannersDisappear(
+        cluster_->mini_tablet_server(i)->server()->scanner_manager()));
+  }
+  ASSERT_GE(num_servers_scanned, 2);
+}
+
+// A prefetching scanner returns the same rows, and asks for larger batches
+// once its caller has to wait for them.
+TEST_F(ClientTest, TestScanPrefetch) {
+  NO_FATALS(InsertTestRows(client_table_.get(), FLAGS_test_scan_num_rows));
+  // Batches of 10 rows, unless the scanner asks for more.
+  FLAGS_scanner_default_batch_size_bytes = 1;
+  FLAGS_scanner_batch_size_rows = 10;
+
+  vector<string> expected_rows;
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(ScanToStrings(&scanner, &expected_rows));
+  }
+  ASSERT_EQ(FLAGS_test_scan_num_rows, expected_rows.size());
+
+  FLAGS_client_scan_prefetch = true;
+  FLAGS_scanner_inject_latency_on_each_batch_ms = 10;
+  KuduScanner scanner(client_table_.get());
+  vector<string> rows;
+  ASSERT_OK(ScanToStrings(&scanner, &rows));
+  ASSERT_EQ(expected_rows, rows);
+  ASSERT_GT(scanner.data_->adaptive_batch_size_bytes_, 0);
+}
+
+// A runtime filter added mid-scan applies to the rest of the current tablet's
+// batches, and to the tablets scanned next.
+TEST_F(ClientTest, TestScanWithRuntimeFilter) {
+  NO_FATALS(InsertTestRows(client_table_.get(), FLAGS_test_scan_num_rows));
+  // Batches of 10 rows, so that most are continuations of a tablet's scan.
+  FLAGS_scanner_default_batch_size_bytes = 1;
+  FLAGS_scanner_batch_size_rows = 10;
+
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.Open());
+  ASSERT_TRUE(scanner.HasMoreRows());
+  KuduScanBatch batch;
+  ASSERT_OK(scanner.NextBatch(&batch));
+  const int num_first_rows = batch.NumRows();
+  ASSERT_LT(num_first_rows, FLAGS_test_scan_num_rows);
+
+  // No row has a negative int_val.
+  ASSERT_OK(scanner.AddRuntimeFilter(client_table_->NewComparisonPredicate(
+      "int_val", KuduPredicate::LESS, KuduValue::FromInt(0))));
+  int num_rows = num_first_rows;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    num_rows += batch.NumRows();
+  }
+  ASSERT_EQ(num_first_rows, num_rows);
+
+  // The filter must be on a projected column.
+  KuduScanner key_scanner(client_table_.get());
+  ASSERT_OK(key_scanner.SetProjectedColumnNames({ "key" }));
+  ASSERT_OK(key_scanner.Open());
+  Status s = key_scanner.AddRuntimeFilter(client_table_->NewComparisonPredicate(
+      "int_val", KuduPredicate::LESS, KuduValue::FromInt(0)));
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  KuduScanner parallel_scanner(client_table_.get());
+  ASSERT_OK(parallel_scanner.SetParallelism(2));
+  ASSERT_OK(parallel_scanner.Open());
+  s = parallel_scanner.AddRuntimeFilter(client_table_->NewComparisonPredicate(
+      "int_val", KuduPredicate::LESS, KuduValue::FromInt(0)));
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+}
+
+// Scanning with NextBatchAsync() returns the same rows as with NextBatch(),
+// for both serial and parallel scans.
+TEST_F(ClientTest, TestScanNextBatchAsync) {
+  NO_FATALS(InsertTestRows(client_table_.get(), FLAGS_test_scan_num_rows));
+  // Batches of 10 rows, so that most are continuations of a tablet's scan.
+  FLAGS_scanner_default_batch_size_bytes = 1;
+  FLAGS_scanner_batch_size_rows = 10;
+
+  vector<string> expected_rows;
+  {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(ScanToStrings(&scanner, &expected_rows));
+  }
+  ASSERT_EQ(FLAGS_test_scan_num_rows, expected_rows.size());
+  std::sort(expected_rows.begin(), expected_rows.end());
+
+  for (int parallelism : { 1, 2 }) {
+    SCOPED_TRACE(parallelism);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetParallelism(parallelism));
+    ASSERT_OK(scanner.Open());
+    vector<string> rows;
+    KuduScanBatch batch;
+    while (scanner.HasMoreRows()) {
+      std::promise<Status> done;
+      KuduStatusFunctionCallback<std::promise<Status>*> cb(
+          [](std::promise<Status>* done, const Status& s) { done->set_value(s); }, &done);
+      scanner.NextBatchAsync(&batch, &cb);
+      ASSERT_OK(done.get_future().get());
+      for (const KuduScanBatch::RowPtr row : batch) {
+        rows.push_back(row.ToString());
+      }
+    }
+    std::sort(rows.begin(), rows.end());
+    ASSERT_EQ(expected_rows, rows);
+  }
+}
+
+// Scans with result caching enabled are served from the client's cache while
+// the tablets' data is unchanged, without the tablets being scanned.
+TEST_F(ClientTest, TestScanResultCache) {
+  NO_FATALS(InsertTestRows(client_table_.get(), 100));
+
+  const auto scans_started = [&]() {
+    vector<scoped_refptr<TabletReplica>> replicas;
+    cluster_->mini_tablet_server(0)->server()->tablet_manager()->GetTabletReplicas(&replicas);
+    int64_t total = 0;
+    for (const auto& replica : replicas) {
+      if (replica->tablet_metadata()->table_id() == client_table_->id()) {
+        total += replica->tablet()->metrics()->scans_started->value();
+      }
+    }
+    return total;
+  };
+  const auto scan = [&](vector<string>* rows) {
+    rows->clear();
+    KuduScanner scanner(client_table_.get());
+    RETURN_NOT_OK(scanner.SetCacheResults(true));
+    return ScanToStrings(&scanner, rows);
+  };
+
+  vector<string> expected_rows;
+  ASSERT_OK(scan(&expected_rows));
+  ASSERT_EQ(100, expected_rows.size());
+  const int64_t num_scans = scans_started();
+
+  vector<string> rows;
+  ASSERT_OK(scan(&rows));
+  ASSERT_EQ(expected_rows, rows);
+  ASSERT_EQ(num_scans, scans_started());
+
+  // The rows written since are returned by the next scan.
+  NO_FATALS(InsertTestRows(client_table_.get(), 1, 100));
+  ASSERT_OK(scan(&rows));
+  ASSERT_EQ(101, rows.size());
+  ASSERT_GT(scans_started(), num_scans);
+}
+
+// A parallel scan returns the same rows as a serial one, in the same order if
+// it's fault-tolerant, even when the buffer only fits a batch at a time.
+TEST_F(ClientTest, TestParallelScan) {
+  NO_FATALS(InsertTestRows(client_table_.get(), FLAGS_test_scan_num_rows));
+
+  const auto scan = [&](int parallelism, bool fault_tolerant, vector<string>* rows) {
+    KuduScanner scanner(client_table_.get());
+    RETURN_NOT_OK(scanner.SetParallelism(parallelism));
+    RETURN_NOT_OK(scanner.SetParallelScanBufferBytes(1));
+    RETURN_NOT_OK(scanner.SetBatchSizeBytes(1024));
+    if (fault_tolerant) {
+      RETURN_NOT_OK(scanner.SetFaultTolerant());
+    }
+    return ScanToStrings(&scanner, rows);
+  };
+
+  for (bool fault_tolerant : { false, true }) {
+    SCOPED_TRACE(fault_tolerant);
+    vector<string> expected_rows;
+    ASSERT_OK(scan(1, fault_tolerant, &expected_rows));
+    ASSERT_EQ(FLAGS_test_scan_num_rows, expected_rows.size());
+
+    vector<string> rows;
+    ASSERT_OK(scan(4, fault_tolerant, &rows));
+    if (!fault_tolerant) {
+      std::sort(expected_rows.begin(), expected_rows.end());
+      std::sort(rows.begin(), rows.end());
+    }
+    ASSERT_EQ(expected_rows, rows);
+  }
+
+  // Limits aren't supported.
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetParallelism(2));
+  ASSERT_OK(scanner.SetLimit(10));
+  Status s = scanner.Open();
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+}
+
+// With --client_use_multi_write, writes to tablets led by the same tablet
+// server are sent in MultiWrite RPCs, and their rows' errors are reported as
+// with Write RPCs.
+TEST_F(ClientTest, TestMultiWrite) {
+  FLAGS_client_use_multi_write = true;
+  const string kTableName = "TestMultiWrite";
+  const int kNumTablets = 3 * cluster_->num_tablet_servers();
+  unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+  ASSERT_OK(table_creator->table_name(kTableName)
+            .schema(&schema_)
+            .num_replicas(1)
+            .add_hash_partitions({ "key" }, kNumTablets)
+            .Create());
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client_->OpenTable(kTableName, &table));
+
+  const auto num_rpcs = [&](HistogramPrototype* metric) {
+    int64_t count = 0;
+    for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+      count += metric->Instantiate(
+          cluster_->mini_tablet_server(i)->server()->metric_entity())->TotalCount();
+    }
+    return count;
+  };
+
+  constexpr int kNumRows = 1000;
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  NO_FATALS(InsertTestRows(table.get(), session.get(), kNumRows));
+  ASSERT_OK(session->Flush());
+  ASSERT_EQ(kNumRows, CountRowsFromClient(table.get()));
+  const auto num_multi_writes =
+      num_rpcs(&METRIC_handler_latency_kudu_tserver_TabletServerService_MultiWrite);
+  ASSERT_GT(num_multi_writes, 0);
+  ASSERT_LE(num_multi_writes, cluster_->num_tablet_servers());
+
+  // Inserting the same rows again fails for each of them.
+  NO_FATALS(InsertTestRows(table.get(), session.get(), kNumRows));
+  Status s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  vector<KuduError*> errors;
+  ElementDeleter drop(&errors);
+  bool overflowed;
+  session->GetPendingErrors(&errors, &overflowed);
+  ASSERT_FALSE(overflowed);
+  ASSERT_EQ(kNumRows, errors.size());
+  for (const auto* error : errors) {
+    ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+  }
+  ASSERT_GT(num_rpcs(&METRIC_handler_latency_kudu_tserver_TabletServerService_MultiWrite),
+            num_multi_writes);
+}
+
+// Test inserting the rows of a columnar batch into a table with several
+// tablets.
+TEST_F(ClientTest, TestApplyColumnarBatch) {
+  constexpr int kNumRows = 20;
+  vector<int32_t> keys;
+  vector<int32_t> int_vals;
+  vector<uint32_t> string_offsets = { 0 };
+  string strings;
+  vector<uint8_t> string_non_nulls(BitmapSize(kNumRows));
+  for (int i = 0; i < kNumRows; i++) {
+    keys.push_back(i);
+    int_vals.push_back(i * 2);
+    if (i % 3 != 0) {
+      strings += Substitute("s$0", i);
+      BitmapSet(string_non_nulls.data(), i);
+    }
+    string_offsets.push_back(strings.size());
+  }
+
+  const auto slice_of = [](const auto& values) {
+    return Slice(reinterpret_cast<const uint8_t*>(values.data()),
+                 values.size() * sizeof(values[0]));
+  };
+  KuduColumnarInsertBatch batch(client_table_, kNumRows);
+  ASSERT_OK(batch.SetColumn(0, slice_of(keys)));
+  ASSERT_OK(batch.SetColumn(1, slice_of(int_vals)));
+  ASSERT_OK(batch.SetVarLenColumn(2, slice_of(string_offsets), strings,
+                                  slice_of(string_non_nulls)));
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  // All of the columns must be set, including those with a default.
+  Status s = session->ApplyColumnarBatch(batch);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "non_null_with_default");
+  ASSERT_OK(batch.SetColumn(3, slice_of(keys)));
+
+  // The batch's rows are split among the tablets.
+  ASSERT_OK(session->ApplyColumnarBatch(batch));
+  ASSERT_EQ(2, session->CountBufferedOperations());
+  ASSERT_OK(session->Flush());
+  vector<string> rows;
+  ASSERT_OK(ScanTableToStrings(client_table_.get(), &rows));
+  ASSERT_EQ(kNumRows, rows.size());
+  ASSERT_TRUE(std::find(rows.begin(), rows.end(),
+                        "(int32 key=3, int32 int_val=6, string string_val=NULL, "
+                        "int32 non_null_with_default=3)") != rows.end());
+  ASSERT_TRUE(std::find(rows.begin(), rows.end(),
+                        "(int32 key=10, int32 int_val=20, string string_val=\"s10\", "
+                        "int32 non_null_with_default=10)") != rows.end());
+
+  // Inserting the same rows again fails for each of them, as it would if
+  // they were inserted one by one.
+  ASSERT_OK(session->ApplyColumnarBatch(batch));
+  s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  vector<KuduError*> errors;
+  ElementDeleter drop(&errors);
+  bool overflowed;
+  session->GetPendingErrors(&errors, &overflowed);
+  ASSERT_FALSE(overflowed);
+  ASSERT_EQ(kNumRows, errors.size());
+  for (const auto* error : errors) {
+    ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+    ASSERT_STR_CONTAINS(error->failed_op().ToString(), "INSERT (int32 key=");
+  }
+}
+
 namespace {
 
 int64_t SumResults(const KuduScanBatch& batch) {
@@ -4128,6 +4679,51 @@ TEST_F(ClientTest, TestAutoFlushBackgroundSmallOps) {
   EXPECT_EQ(kRowNum, CountRowsFromClient(client_table_.get()));
 }
 
+// A test scenario for AUTO_FLUSH_BACKGROUND mode: several threads applying
+// rows concurrently to the same session. The buffer limit must hold, and all
+// the rows must reach the table.
+TEST_F(ClientTest, TestAutoFlushBackgroundConcurrentApply) {
+  constexpr size_t kBufferSizeBytes = 4096;
+  constexpr int kNumThreads = 8;
+  constexpr int kRowsPerThread = 1000;
+  shared_ptr<KuduSession> session(client_->NewSession());
+  ASSERT_OK(session->SetMutationBufferSpace(kBufferSizeBytes));
+  ASSERT_OK(session->SetMutationBufferMaxNum(4));
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+
+  int64_t monitor_max_buffer_size = 0;
+  CountDownLatch monitor_run_ctl(1);
+  thread monitor([&]() {
+    MonitorSessionBufferSize(session.get(),
+                             &monitor_run_ctl, &monitor_max_buffer_size);
+  });
+
+  vector<thread> threads;
+  vector<Status> statuses(kNumThreads);
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kRowsPerThread && statuses[t].ok(); i++) {
+        const int key = t * kRowsPerThread + i;
+        statuses[t] = ApplyInsertToSession(session.get(), client_table_, key, key, "x");
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& s : statuses) {
+    ASSERT_OK(s);
+  }
+  EXPECT_OK(session->Flush());
+  EXPECT_EQ(0, session->CountPendingErrors());
+  EXPECT_FALSE(session->HasPendingOperations());
+
+  monitor_run_ctl.CountDown();
+  monitor.join();
+  EXPECT_GE(kBufferSizeBytes, monitor_max_buffer_size);
+  EXPECT_EQ(kNumThreads * kRowsPerThread, CountRowsFromClient(client_table_.get()));
+}
+
 // A test scenario for AUTO_FLUSH_BACKGROUND mode:
 // applying a bunch of rows every one of which is so big in size that
 // a couple of those do not fit into the buffer. This should be OK:
@@ -6841,6 +7437,75 @@ TEST_F(ClientTest, TestPartitioner) {
   ASSERT_EQ(-1, part_index);
 }
 
+// Test that the partitions of the rows of columnar batches are those of the
+// rows partitioned one at a time.
+TEST_F(ClientTest, TestPartitionColumnarBatch) {
+  const char* kTableName = "TestPartitionColumnarBatch";
+  vector<unique_ptr<KuduPartialRow>> split_rows;
+  for (int32_t split : {3333, 6666}) {
+    unique_ptr<KuduPartialRow> row(schema_.NewRow());
+    ASSERT_OK(row->SetInt32("key", split));
+    split_rows.emplace_back(std::move(row));
+  }
+  unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+  table_creator->table_name(kTableName)
+      .schema(&schema_)
+      .num_replicas(1)
+      .add_hash_partitions({ "key" }, 3)
+      .set_range_partition_columns({ "key" });
+  for (const auto& row : split_rows) {
+    table_creator->add_range_partition_split(new KuduPartialRow(*row));
+  }
+  ASSERT_OK(table_creator->Create());
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client_->OpenTable(kTableName, &table));
+
+  // Runs of consecutive keys mixed with keys all over the key space.
+  const int kNumRows = 10000;
+  vector<int32_t> keys;
+  for (int i = 0; i < kNumRows; i++) {
+    keys.push_back(i % 2 == 0 ? i : (i * 7919) % kNumRows);
+  }
+  KuduColumnarInsertBatch batch(table, kNumRows);
+  ASSERT_OK(batch.SetColumn(0, Slice(reinterpret_cast<const uint8_t*>(keys.data()),
+                                     keys.size() * sizeof(int32_t))));
+
+  const auto check_partitions = [&]() {
+    KuduPartitioner* part_raw;
+    ASSERT_OK(KuduPartitionerBuilder(table).Build(&part_raw));
+    unique_ptr<KuduPartitioner> part(part_raw);
+    vector<int> partitions;
+    ASSERT_OK(part->PartitionColumnarBatch(batch, &partitions));
+    ASSERT_EQ(kNumRows, partitions.size());
+    unique_ptr<KuduPartialRow> row(table->schema().NewRow());
+    for (int i = 0; i < kNumRows; i++) {
+      ASSERT_OK(row->SetInt32(0, keys[i]));
+      int part_index;
+      ASSERT_OK(part->PartitionRow(*row, &part_index));
+      ASSERT_EQ(part_index, partitions[i]) << "key " << keys[i];
+    }
+  };
+  NO_FATALS(check_partitions());
+
+  // The rows of non-covered ranges have no partition.
+  unique_ptr<KuduTableAlterer> alterer(client_->NewTableAlterer(kTableName));
+  alterer->DropRangePartition(schema_.NewRow(), new KuduPartialRow(*split_rows[0]));
+  ASSERT_OK(alterer->Alter());
+  NO_FATALS(check_partitions());
+
+  // The columns of the partition key must be set, and the batch must be of the
+  // partitioner's table.
+  KuduPartitioner* part_raw;
+  ASSERT_OK(KuduPartitionerBuilder(table).Build(&part_raw));
+  unique_ptr<KuduPartitioner> part(part_raw);
+  vector<int> partitions;
+  Status s = part->PartitionColumnarBatch(KuduColumnarInsertBatch(table, 1), &partitions);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "'key' not set");
+  s = part->PartitionColumnarBatch(KuduColumnarInsertBatch(client_table_, 1), &partitions);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 TEST_F(ClientTest, TestInvalidPartitionerBuilder) {
   KuduPartitioner* part;
   Status s = KuduPartitionerBuilder(client_table_)
@@ -8526,6 +9191,32 @@ TEST_F(ClientTestUnixSocket, TestConnectViaUnixSocket) {
   ASSERT_EQ(1, total_unix_conns);
 }
 
+// A client which can't reach the unix domain socket advertised by a local
+// tablet server falls back to connecting via TCP.
+TEST_F(ClientTestUnixSocket, TestFallBackToTcp) {
+  const auto* mts = cluster_->mini_tablet_server(0);
+  master::TSInfoPB pb;
+  pb.set_permanent_uuid(mts->server()->instance_pb().permanent_uuid());
+  *pb.add_rpc_addresses() = HostPortToPB(HostPort(mts->bound_rpc_addr()));
+  pb.set_unix_domain_socket_path("@kudu-unreachable-socket");
+  internal::RemoteTabletServer rts(pb);
+
+  const auto ping = [&]() {
+    Synchronizer sync;
+    rts.InitProxy(client_.get(), sync.AsStatusCallback());
+    RETURN_NOT_OK(sync.Wait());
+    tserver::PingRequestPB req;
+    tserver::PingResponsePB resp;
+    rpc::RpcController rpc;
+    rpc.set_timeout(MonoDelta::FromSeconds(10));
+    return rts.proxy()->Ping(req, &resp, &rpc);
+  };
+  Status s = ping();
+  ASSERT_TRUE(s.IsNetworkError()) << s.ToString();
+  rts.MarkFailed(s);
+  ASSERT_OK(ping());
+}
+
 class MultiTServerClientTest : public ClientTest {
  public:
   void SetUp() override {
@@ -42,6 +42,7 @@
 #include "kudu/client/error_collector.h"
 #include "kudu/client/master_proxy_rpc.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner-internal.h"
 #include "kudu/client/partitioner-internal.h"
 #include "kudu/client/replica-internal.h"
 #include "kudu/client/row_result.h"
@@ -58,7 +59,9 @@
 #include "kudu/client/tablet-internal.h"
 #include "kudu/client/tablet_server-internal.h"
 #include "kudu/client/transaction-internal.h"
+#include "kudu/client/txn_manager_proxy_rpc.h"
 #include "kudu/client/value.h"
+#include "kudu/client/write_op-internal.h"
 #include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
@@ -73,12 +76,15 @@
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master.proxy.h"
+#include "kudu/master/txn_manager.pb.h"
+#include "kudu/master/txn_manager.proxy.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/request_tracker.h"
 #include "kudu/rpc/response_callback.h"
@@ -101,9 +107,12 @@
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/openssl_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/version_info.h"
 
 using kudu::client::internal::AsyncLeaderMasterRpc;
+using kudu::client::internal::AsyncRandomTxnManagerRpc;
+using kudu::client::internal::ColumnarInsertOp;
 using kudu::client::internal::MetaCache;
 using kudu::client::sp::shared_ptr;
 using kudu::consensus::RaftPeerPB;
@@ -127,6 +136,9 @@ using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
 using kudu::rpc::UserCredentials;
+using kudu::transactions::GetSnapshotTimestampRequestPB;
+using kudu::transactions::GetSnapshotTimestampResponsePB;
+using kudu::transactions::TxnManagerServiceProxy;
 using kudu::tserver::ScanResponsePB;
 using std::map;
 using std::set;
@@ -416,6 +428,7 @@ Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
   // Init local host names used for locality decisions.
   RETURN_NOT_OK_PREPEND(c->data_->InitLocalHostNames(),
                         "Could not determine local host names");
+  RETURN_NOT_OK(c->data_->InitAsyncScanPool());
 
   c->data_->request_tracker_ = new rpc::RequestTracker(c->data_->client_id_);
 
@@ -681,6 +694,7 @@ Status KuduClient::GetTableStatistics(const string& table_name,
   GetTableStatisticsResponsePB resp;
   TableIdentifierPB* table = req.mutable_table();
   table->set_table_name(table_name);
+  req.set_include_column_stats(true);
   MonoTime deadline = MonoTime::Now() + default_admin_operation_timeout();
   Synchronizer sync;
   AsyncLeaderMasterRpc<GetTableStatisticsRequestPB, GetTableStatisticsResponsePB> rpc(
@@ -698,6 +712,10 @@ Status KuduClient::GetTableStatistics(const string& table_name,
       resp.has_live_row_count() ? boost::optional<int64_t>(resp.live_row_count()) : boost::none,
       resp.has_disk_size_limit() ? boost::optional<int64_t>(resp.disk_size_limit()) : boost::none,
       resp.has_row_count_limit() ? boost::optional<int64_t>(resp.row_count_limit()) : boost::none);
+  for (const auto& entry : resp.column_stats()) {
+    table_statistics->data_->column_stats_[entry.column_name()] = {
+        entry.num_distinct_values(), static_cast<int64_t>(entry.stats().null_count()) };
+  }
 
   *statistics = table_statistics.release();
   return Status::OK();
@@ -735,6 +753,32 @@ void KuduClient::SetLatestObservedTimestamp(uint64_t ht_timestamp) {
   data_->UpdateLatestObservedTimestamp(ht_timestamp);
 }
 
+Status KuduClient::GetSnapshotTimestamp(uint64_t* ht_timestamp) {
+  GetSnapshotTimestampResponsePB resp;
+  {
+    GetSnapshotTimestampRequestPB req;
+    const uint64_t latest_ts = data_->GetLatestObservedTimestamp();
+    if (latest_ts != kNoTimestamp) {
+      req.set_propagated_timestamp(latest_ts);
+    }
+    Synchronizer sync;
+    AsyncRandomTxnManagerRpc<GetSnapshotTimestampRequestPB,
+                             GetSnapshotTimestampResponsePB> rpc(
+        MonoTime::Now() + default_admin_operation_timeout(), this,
+        BackoffType::EXPONENTIAL, std::move(req), &resp,
+        &TxnManagerServiceProxy::GetSnapshotTimestampAsync, "GetSnapshotTimestamp",
+        sync.AsStatusCallback());
+    rpc.SendRpc();
+    RETURN_NOT_OK(sync.Wait());
+  }
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  DCHECK(resp.has_snapshot_timestamp());
+  *ht_timestamp = resp.snapshot_timestamp();
+  return Status::OK();
+}
+
 Status KuduClient::ExportAuthenticationCredentials(string* authn_creds) const {
   AuthenticationCredentialsPB pb;
 
@@ -1091,6 +1135,16 @@ int64_t KuduTableStatistics::live_row_count_limit() const {
   return data_->live_row_count_limit_ ? *data_->live_row_count_limit_ : -1;
 }
 
+int64_t KuduTableStatistics::num_distinct_values(const string& column_name) const {
+  const auto* stats = FindOrNull(data_->column_stats_, column_name);
+  return stats ? stats->num_distinct_values : -1;
+}
+
+int64_t KuduTableStatistics::null_count(const string& column_name) const {
+  const auto* stats = FindOrNull(data_->column_stats_, column_name);
+  return stats ? stats->null_count : -1;
+}
+
 std::string KuduTableStatistics::ToString() const {
   return data_->ToString();
 }
@@ -1314,6 +1368,30 @@ Status KuduTable::ListPartitions(vector<Partition>* partitions) {
   return Status::OK();
 }
 
+Status KuduTable::PrefetchTabletLocations() {
+  auto& client = data_->client_;
+  const auto deadline = MonoTime::Now() + client->default_admin_operation_timeout();
+  return client->data_->meta_cache_->PrefetchTableLocations(this, deadline);
+}
+
+Status KuduTable::SerializeTabletLocations(string* buf) const {
+  DCHECK(buf);
+  TableLocationsPB pb;
+  data_->client_->data_->meta_cache_->GetTableLocations(this, &pb);
+  if (!pb.SerializeToString(buf)) {
+    return Status::Corruption("unable to serialize tablet locations");
+  }
+  return Status::OK();
+}
+
+Status KuduTable::LoadTabletLocations(const string& buf) {
+  TableLocationsPB pb;
+  if (!pb.ParseFromString(buf)) {
+    return Status::Corruption("unable to deserialize tablet locations");
+  }
+  return data_->client_->data_->meta_cache_->AddTableLocations(this, pb);
+}
+
 ////////////////////////////////////////////////////////////
 // Error
 ////////////////////////////////////////////////////////////
@@ -1411,6 +1489,19 @@ Status KuduSession::Apply(KuduWriteOperation* write_op) {
   return Status::OK();
 }
 
+Status KuduSession::ApplyColumnarBatch(const KuduColumnarInsertBatch& batch) {
+  vector<unique_ptr<ColumnarInsertOp>> ops;
+  RETURN_NOT_OK(batch.data_->Split(data_->buffer_bytes_limit_, &ops));
+  for (auto& op : ops) {
+    RETURN_NOT_OK(data_->ApplyWriteOp(op.release()));
+  }
+  // See the thread-safety note in Apply().
+  if (data_->flush_mode_ == AUTO_FLUSH_SYNC) {
+    RETURN_NOT_OK(data_->Flush());
+  }
+  return Status::OK();
+}
+
 Status KuduSession::Flush() {
   return data_->Flush();
 }
@@ -1764,6 +1855,19 @@ Status KuduScanner::AddConjunctPredicate(KuduPredicate* pred) {
   return data_->mutable_configuration()->AddConjunctPredicate(std::move(p));
 }
 
+Status KuduScanner::AddRuntimeFilter(KuduPredicate* pred) {
+  // Take ownership even if returning non-OK status.
+  unique_ptr<KuduPredicate> p(pred);
+  if (!data_->open_) {
+    return data_->mutable_configuration()->AddConjunctPredicate(std::move(p));
+  }
+  if (data_->parallel_) {
+    return Status::NotSupported("parallel scans don't support runtime filters");
+  }
+  return data_->mutable_configuration()->AddRuntimeFilter(std::move(p),
+                                                          &data_->pending_runtime_filters_);
+}
+
 Status KuduScanner::AddLowerBound(const KuduPartialRow& key) {
   return data_->mutable_configuration()->AddLowerBound(key);
 }
@@ -1827,6 +1931,7 @@ Status KuduScanner::SetRowFormatFlags(uint64_t flags) {
     case NO_FLAGS:
     case PAD_UNIXTIME_MICROS_TO_16_BYTES:
     case COLUMNAR_LAYOUT:
+    case COLUMNAR_LAYOUT | COLUMNAR_DICTIONARY_ENCODING:
       break;
     default:
       return Status::InvalidArgument(Substitute("Invalid row format flags: $0", flags));
@@ -1845,6 +1950,28 @@ Status KuduScanner::SetLimit(int64_t limit) {
   return data_->mutable_configuration()->SetLimit(limit);
 }
 
+Status KuduScanner::SetParallelism(int parallelism) {
+  if (data_->open_) {
+    return Status::IllegalState("Parallelism must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetParallelism(parallelism);
+}
+
+Status KuduScanner::SetParallelScanBufferBytes(int64_t buffer_bytes) {
+  if (data_->open_) {
+    return Status::IllegalState("Parallel scan buffer size must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetParallelScanBufferBytes(buffer_bytes);
+}
+
+Status KuduScanner::SetCacheResults(bool cache_results) {
+  if (data_->open_) {
+    return Status::IllegalState("Result caching must be set before Open()");
+  }
+  data_->mutable_configuration()->SetCacheResults(cache_results);
+  return Status::OK();
+}
+
 const ResourceMetrics& KuduScanner::GetResourceMetrics() const {
   return data_->resource_metrics_;
 }
@@ -1885,6 +2012,17 @@ string KuduScanner::ToCSVRowString() const {
 Status KuduScanner::Open() {
   CHECK(!data_->open_) << "Scanner already open";
 
+  if (data_->configuration().parallelism() > 1) {
+    if (data_->configuration().spec().has_limit()) {
+      return Status::NotSupported("parallel scans don't support limits");
+    }
+    data_->parallel_.reset(new internal::ParallelScanner(data_->table_.get(),
+                                                         data_->mutable_configuration()));
+    RETURN_NOT_OK(data_->parallel_->Open());
+    data_->open_ = true;
+    return Status::OK();
+  }
+
   if (data_->configuration().has_start_timestamp()) {
     RETURN_NOT_OK(data_->mutable_configuration()->AddIsDeletedColumn());
   }
@@ -1927,6 +2065,9 @@ Status KuduScanner::Open() {
 }
 
 Status KuduScanner::KeepAlive() {
+  if (data_->parallel_) {
+    return Status::NotSupported("parallel scans don't support keep-alive requests");
+  }
   return data_->KeepAlive();
 }
 
@@ -1935,11 +2076,21 @@ void KuduScanner::Close() {
 
   VLOG(2) << "Ending " << data_->DebugString();
 
+  if (data_->parallel_) {
+    // The parallel scanner is kept: the rows it returned refer to it.
+    data_->parallel_->Close();
+    data_->open_ = false;
+    return;
+  }
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
   // This is reflected in the Open() response. In this case, there is no server-side state
   // to clean up.
+  // Any prefetched batches are dropped along with the scanner.
+  data_->prefetch_.reset();
+  data_->pipelined_prefetches_.clear();
   if (!data_->next_req_.scanner_id().empty()) {
     CHECK(data_->proxy_);
     unique_ptr<CloseCallback> closer(new CloseCallback);
@@ -1959,6 +2110,9 @@ void KuduScanner::Close() {
 
 bool KuduScanner::HasMoreRows() const {
   CHECK(data_->open_);
+  if (data_->parallel_) {
+    return data_->parallel_->HasMoreRows();
+  }
   return !data_->short_circuit_ &&                 // The scan is not short circuited
       (data_->data_in_open_ ||                     // more data in hand
        data_->last_response_.has_more_results() || // more data in this tablet
@@ -1977,10 +2131,56 @@ Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
 }
 
 Status KuduScanner::NextBatch(KuduScanBatch* batch) {
+  if (data_->parallel_) {
+    CHECK(data_->open_);
+    return data_->parallel_->NextBatch(batch);
+  }
   return NextBatch(batch->data_);
 }
 
+void KuduScanner::NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb) {
+  CHECK(data_->open_);
+  const auto run_on_pool = [this, batch, cb]() {
+    Status s = data_->table_->client()->data_->async_scan_pool_->Submit(
+        [this, batch, cb]() { cb->Run(this->NextBatch(batch)); });
+    if (!s.ok()) {
+      cb->Run(s);
+    }
+  };
+
+  if (!data_->parallel_ &&
+      !data_->short_circuit_ &&
+      !data_->data_in_open_ &&
+      data_->last_response_.has_more_results()) {
+    // Send the request for the tablet's next batch unless it's in flight
+    // already, and let NextBatch() take its response once it's received:
+    // right away if it's a successful one.
+    if (!data_->prefetch_) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+      data_->SendPrefetch();
+    }
+    data_->WhenPrefetchReceived([this, batch, cb, run_on_pool](bool success) {
+      if (success) {
+        cb->Run(this->NextBatch(batch));
+      } else {
+        run_on_pool();
+      }
+    });
+    return;
+  }
+  if (data_->parallel_ ||
+      (!data_->short_circuit_ && !data_->data_in_open_ && data_->MoreTablets())) {
+    run_on_pool();
+    return;
+  }
+  // The batch is in hand, or there are no more rows.
+  cb->Run(NextBatch(batch));
+}
+
 Status KuduScanner::NextBatch(KuduColumnarScanBatch* batch) {
+  if (data_->parallel_) {
+    return Status::NotSupported("parallel scans don't support columnar batches");
+  }
   return NextBatch(batch->data_);
 }
 
@@ -2003,11 +2203,21 @@ Status KuduScanner::NextBatch(internal::ScanBatchDataInterface* batch_data) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
-    return batch_data->Reset(&data_->controller_,
-                             data_->configuration().projection(),
-                             data_->configuration().client_projection(),
-                             data_->configuration().row_format_flags(),
-                             &data_->last_response_);
+    if (data_->cached_result_) {
+      Status s = batch_data->ResetFromCache(data_->configuration().projection(),
+                                            data_->configuration().client_projection(),
+                                            data_->configuration().row_format_flags(),
+                                            data_->cached_result_.value());
+      data_->cached_result_ = internal::ScanResultCache::EntryHandle();
+      return s;
+    }
+    RETURN_NOT_OK(batch_data->Reset(&data_->controller_,
+                                    data_->configuration().projection(),
+                                    data_->configuration().client_projection(),
+                                    data_->configuration().row_format_flags(),
+                                    &data_->last_response_));
+    data_->MaybePrefetch();
+    return Status::OK();
   }
 
   if (data_->last_response_.has_more_results()) {
@@ -2015,11 +2225,16 @@ Status KuduScanner::NextBatch(internal::ScanBatchDataInterface* batch_data) {
     VLOG(2) << "Continuing " << data_->DebugString();
 
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    if (!data_->prefetch_) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
       bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      // If the request was prefetched, only retries are sent here.
+      ScanRpcStatus result = data_->prefetch_ ?
+          data_->ReceivePrefetch(batch_deadline) :
+          data_->SendScanRpc(batch_deadline, allow_time_for_failover);
 
       // Success case.
       if (result.result == ScanRpcStatus::OK) {
@@ -2027,11 +2242,13 @@ Status KuduScanner::NextBatch(internal::ScanBatchDataInterface* batch_data) {
           data_->last_primary_key_ = data_->last_response_.last_primary_key();
         }
         data_->scan_attempts_ = 0;
-        return batch_data->Reset(&data_->controller_,
-                                 data_->configuration().projection(),
-                                 data_->configuration().client_projection(),
-                                 data_->configuration().row_format_flags(),
-                                 &data_->last_response_);
+        RETURN_NOT_OK(batch_data->Reset(&data_->controller_,
+                                        data_->configuration().projection(),
+                                        data_->configuration().client_projection(),
+                                        data_->configuration().row_format_flags(),
+                                        &data_->last_response_));
+        data_->MaybePrefetch();
+        return Status::OK();
       }
 
       data_->scan_attempts_++;
@@ -2084,6 +2301,9 @@ Status KuduScanner::NextBatch(internal::ScanBatchDataInterface* batch_data) {
 
 Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   CHECK(data_->open_);
+  if (data_->parallel_) {
+    return Status::NotSupported("parallel scans have no single current server");
+  }
   internal::RemoteTabletServer* rts = data_->ts_;
   CHECK(rts);
   vector<HostPort> host_ports;
@@ -2100,6 +2320,58 @@ Status KuduScanner::GetCurrentServer(KuduTabletServer** server) {
   return Status::OK();
 }
 
+Status KuduScanner::GetResumeToken(string* token) const {
+  CHECK(data_->open_);
+  const ScanConfiguration& configuration = data_->configuration();
+  if (data_->parallel_) {
+    return Status::NotSupported("parallel scans can't be resumed");
+  }
+  if (!configuration.is_fault_tolerant()) {
+    return Status::NotSupported("only fault-tolerant scans can be resumed");
+  }
+  if (configuration.spec().has_limit()) {
+    return Status::NotSupported("scans with a limit can't be resumed");
+  }
+  if (configuration.has_start_timestamp()) {
+    return Status::NotSupported("diff scans can't be resumed");
+  }
+  if (data_->table_->data_->partition_schema_.HasCustomHashSchemas()) {
+    return Status::NotSupported(Substitute(
+        "$0: scans of tables with custom per-range hash schemas can't be resumed",
+        data_->table_->name()));
+  }
+  if (!HasMoreRows()) {
+    return Status::IllegalState("the scan is complete");
+  }
+  if (data_->data_in_open_) {
+    // The key of the last row returned was replaced by the last key of the
+    // rows fetched by the open, which haven't been returned.
+    return Status::IllegalState("the rows fetched by the scan's open must be fetched first");
+  }
+
+  ScanTokenPB pb;
+  RETURN_NOT_OK(KuduScanTokenBuilder::Data::ConfigurationToPB(
+      configuration, /*include_table_metadata=*/false, &pb));
+  DCHECK(pb.has_snap_timestamp());
+
+  // The rest of the scan starts at the current tablet.
+  const PartitionKey& lower_bound = std::max(configuration.spec().lower_bound_partition_key(),
+                                             data_->remote_->partition().begin());
+  pb.set_lower_bound_partition_key(lower_bound.ToString());
+  const PartitionKey& upper_bound = configuration.spec().exclusive_upper_bound_partition_key();
+  if (!upper_bound.empty()) {
+    pb.set_upper_bound_partition_key(upper_bound.ToString());
+  }
+  if (!data_->last_primary_key_.empty()) {
+    pb.add_feature_flags(ScanTokenPB::ResumeAfterPrimaryKey);
+    pb.set_resume_after_primary_key(data_->last_primary_key_);
+  }
+  if (!pb.SerializeToString(token)) {
+    return Status::Corruption("unable to serialize the resume token");
+  }
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduScanToken
 ////////////////////////////////////////////////////////////
@@ -2199,6 +2471,11 @@ Status KuduScanTokenBuilder::IncludeTabletMetadata(bool include_metadata) {
   return Status::OK();
 }
 
+Status KuduScanTokenBuilder::SetSplitSizeBytes(uint64_t split_size_bytes) {
+  data_->SetSplitSizeBytes(split_size_bytes);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::AddConjunctPredicate(KuduPredicate* pred) {
   unique_ptr<KuduPredicate> p(pred);
   return data_->mutable_configuration()->AddConjunctPredicate(std::move(p));
@@ -2327,5 +2604,10 @@ Status KuduPartitioner::PartitionRow(const KuduPartialRow& row, int* partition)
   return data_->PartitionRow(row, partition);
 }
 
+Status KuduPartitioner::PartitionColumnarBatch(const KuduColumnarInsertBatch& batch,
+                                               vector<int>* partitions) {
+  return data_->PartitionColumnarBatch(*batch.data_, partitions);
+}
+
 } // namespace client
 } // namespace kudu
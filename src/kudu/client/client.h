@@ -89,6 +89,7 @@ class TableLister;
 
 namespace client {
 
+class KuduColumnarInsertBatch;
 class KuduColumnarScanBatch;
 class KuduDelete;
 class KuduDeleteIgnore;
@@ -117,6 +118,7 @@ class ErrorCollector;
 class GetTableSchemaRpc;
 class LookupRpc;
 class MetaCache;
+class ParallelScanner;
 class RemoteTablet;
 class RemoteTabletServer;
 class ReplicaController;
@@ -906,6 +908,25 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   ///   Timestamp encoded in HybridTime format.
   void SetLatestObservedTimestamp(uint64_t ht_timestamp);
 
+  /// Get a timestamp at which to scan a consistent snapshot of any number
+  /// of tables, as with a read-only transaction.
+  ///
+  /// The timestamp is chosen by the cluster's TxnManager. It's no earlier
+  /// than the latest timestamp observed by this client, e.g. the commit
+  /// timestamp of a transaction committed with this client, and otherwise
+  /// trails the current time enough so that tablet servers have most likely
+  /// applied every write up to it already. Scanners in READ_AT_SNAPSHOT mode
+  /// set to it with KuduScanner::SetSnapshotRaw() thus read a consistent
+  /// snapshot without waiting on the tablet servers' safe time.
+  ///
+  /// @note This method is experimental and will either disappear or
+  ///   change in a future release.
+  ///
+  /// @param [out] ht_timestamp
+  ///   The snapshot timestamp, encoded in HybridTime format.
+  /// @return Operation status.
+  Status GetSnapshotTimestamp(uint64_t* ht_timestamp) WARN_UNUSED_RESULT;
+
   /// Export the current authentication credentials from this client. This includes
   /// the necessary credentials to authenticate to the cluster, as well as to
   /// authenticate the cluster to the client.
@@ -1016,6 +1037,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   FRIEND_TEST(ClientTest, TestMetaCacheLookupNoLeaders);
   FRIEND_TEST(ClientTest, TestMetaCacheWithKeysAndIds);
   FRIEND_TEST(ClientTest, TestNonCoveringRangePartitions);
+  FRIEND_TEST(ClientTest, TestPrefetchAndLoadTabletLocations);
   FRIEND_TEST(ClientTest, TestRetrieveAuthzTokenInParallel);
   FRIEND_TEST(ClientTest, TestReplicatedTabletWritesWithLeaderElection);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
@@ -1484,6 +1506,25 @@ class KUDU_EXPORT KuduTableStatistics {
   /// but it should also support database level row count limit.
   int64_t live_row_count_limit() const;
 
+  /// @param [in] column_name
+  ///   Name of a column of the table.
+  /// @return The estimated number of distinct non-NULL values of the column.
+  ///  -1 is returned if there are no statistics of the column.
+  ///
+  /// @note The statistics of the columns are experimental. They're computed
+  /// by the tablet servers running with --report_tablet_column_statistics,
+  /// over the data flushed to disk, and account for the rows mutated since
+  /// only once those are compacted.
+  int64_t num_distinct_values(const std::string& column_name) const;
+
+  /// @param [in] column_name
+  ///   Name of a column of the table.
+  /// @return The number of NULL values of the column.
+  ///  -1 is returned if there are no statistics of the column.
+  ///
+  /// @note See num_distinct_values() about the statistics of the columns.
+  int64_t null_count(const std::string& column_name) const;
+
   /// Stringify this Statistics.
   ///
   /// @return A string describing this statistics
@@ -1750,6 +1791,36 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   /// @return The table's extra configuration properties.
   const std::map<std::string, std::string>& extra_configs() const;
 
+  /// Look up the locations of all the table's tablets, and cache them in
+  /// the client, so that writes and scans don't have to look them up one
+  /// key range at a time. The locations are fetched from the master in as
+  /// few round trips as possible. This operation has a timeout equal to the
+  /// client's default admin operation timeout.
+  ///
+  /// @return Status object for the operation.
+  Status PrefetchTabletLocations();
+
+  /// Serialize the locations of the table's tablets cached by the client,
+  /// so that they can be loaded into another client with
+  /// LoadTabletLocations(). Only the locations which haven't expired are
+  /// serialized.
+  ///
+  /// @param [out] buf
+  ///   The serialized tablet locations.
+  /// @return Status object for the operation.
+  Status SerializeTabletLocations(std::string* buf) const;
+
+  /// Cache tablet locations serialized by SerializeTabletLocations(),
+  /// possibly by another client. The locations of the tablets cached
+  /// already are kept. The loaded locations expire at the same time they
+  /// would have in the client they were serialized by, plus the time spent
+  /// in between; stale ones are refreshed from the master as usual.
+  ///
+  /// @param [in] buf
+  ///   The serialized tablet locations of this table.
+  /// @return Status object for the operation.
+  Status LoadTabletLocations(const std::string& buf);
+
   /// @cond PRIVATE_API
 
   /// List the partitions of this table in 'partitions'. This operation may
@@ -2176,7 +2247,10 @@ class KUDU_EXPORT KuduError {
 /// Users who are familiar with the Hibernate ORM framework should find this
 /// concept of a Session familiar.
 ///
-/// @note This class is not thread-safe.
+/// @note This class is not thread-safe, except that in the
+///   AUTO_FLUSH_BACKGROUND and MANUAL_FLUSH modes, Apply() and
+///   ApplyColumnarBatch() may be called concurrently, e.g. by several threads
+///   feeding the same mutation buffer.
 class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession> {
  public:
   ~KuduSession();
@@ -2419,6 +2493,25 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status Apply(KuduWriteOperation* write_op) WARN_UNUSED_RESULT;
 
+  /// Apply the inserts of a columnar batch.
+  ///
+  /// The rows of the batch are split among the tablets of the table, and
+  /// buffered as one write operation per tablet (or more, if they don't fit
+  /// in the mutation buffer together), which behave like the operations
+  /// applied with Apply(). A failure of one of them is reported in the
+  /// session's error collector as a KuduInsert error for each of its rows.
+  ///
+  /// The data of the batch is copied: the batch may be destroyed once this
+  /// method returns. Only tablet servers which support columnar writes
+  /// accept the operations.
+  ///
+  /// @param [in] batch
+  ///   The batch to apply. All of the table's columns must be set.
+  /// @return Operation result status. If the batch is malformed, none of its
+  ///   rows are applied. If an error is returned after some of the batch's
+  ///   write operations have been applied, the others aren't.
+  Status ApplyColumnarBatch(const KuduColumnarInsertBatch& batch) WARN_UNUSED_RESULT;
+
   /// Flush any pending writes.
   ///
   /// This method initiates flushing of the current batch of buffered
@@ -2718,6 +2811,25 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status AddConjunctPredicate(KuduPredicate* pred) WARN_UNUSED_RESULT;
 
+  /// Add a predicate to a scan which may already be open, e.g. a filter
+  /// built from the other side of a join while this side is being scanned.
+  ///
+  /// Before Open(), this is the same as AddConjunctPredicate(). Afterwards,
+  /// the predicate is sent along with the next request for the current
+  /// tablet's rows, and is part of the predicates of the tablets scanned
+  /// later. The filter is advisory: the batches already received, or being
+  /// prefetched, may contain rows which don't match it, as may those of
+  /// tablet servers which don't support runtime filters, so the caller must
+  /// still apply it to the rows returned.
+  ///
+  /// @param [in] pred
+  ///   Predicate to add. The KuduScanner instance takes ownership of the
+  ///   parameter even if a bad Status is returned. Once the scanner is
+  ///   open, the predicate must be on a column of the projection.
+  /// @return Operation result status. Parallel scans don't support adding
+  ///   predicates once they're open.
+  Status AddRuntimeFilter(KuduPredicate* pred) WARN_UNUSED_RESULT;
+
   /// Add a lower bound (inclusive) primary key for the scan.
   ///
   /// If any bound is already added, this bound is intersected with that one.
@@ -2856,6 +2968,33 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status NextBatch(KuduScanBatch* batch);
 
+  /// Fetch the next batch of results for this scanner asynchronously.
+  ///
+  /// Like NextBatch(KuduScanBatch*), but returns right away, and invokes
+  /// @c cb with the result of the operation once it completes.
+  ///
+  /// Fetching the next batch of the tablet being scanned doesn't tie up a
+  /// thread while the request is in flight, so that a few threads can drive
+  /// many concurrent scans. The steps which may block, i.e. opening the scan
+  /// of the next tablet, retrying failed requests, and the batches of
+  /// parallel scans, are run on a pool of threads shared by the client's
+  /// scanners.
+  ///
+  /// As in all other async functions in Kudu, the callback may be called
+  /// either from an IO thread or the same thread which calls NextBatchAsync.
+  /// The callback should not block.
+  ///
+  /// @note No other method of the scanner may be called, and the scanner may
+  ///   not be destroyed, until @c cb has been invoked.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the result. It must remain valid until @c cb is
+  ///   invoked.
+  /// @param [in] cb
+  ///   Callback to call once the batch has been fetched. The @c cb must
+  ///   remain valid until it is invoked.
+  void NextBatchAsync(KuduScanBatch* batch, KuduStatusCallback* cb);
+
   /// Fetch the next batch of columnar results for this scanner.
   ///
   /// This variant may only be used when the scan is configured with the
@@ -2879,6 +3018,27 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status GetCurrentServer(KuduTabletServer** server);
 
+  /// Get a token to resume the scan with from where it's at.
+  ///
+  /// The token is a serialized scan token, for
+  /// KuduScanToken::DeserializeIntoScanner(), of the rest of the scan: the
+  /// tablets not scanned yet, and the rows of the current tablet after the
+  /// last one returned by NextBatch(), at the scan's snapshot timestamp.
+  /// It allows a process to resume a long scan, e.g. after a restart,
+  /// without returning the rows it already processed again. The scan is
+  /// resumed at any replica of the tablets.
+  ///
+  /// Only open fault-tolerant scans without a limit can be resumed. Diff
+  /// scans, parallel scans and scans of tables with custom per-range hash
+  /// schemas can't be. A token may be requested after any call to
+  /// NextBatch(), but not between Open() and the first NextBatch() call if
+  /// Open() fetched rows.
+  ///
+  /// @param [out] token
+  ///   The serialized token.
+  /// @return Operation result status.
+  Status GetResumeToken(std::string* token) const WARN_UNUSED_RESULT;
+
   /// @return Cumulative resource metrics since the scan was started.
   const ResourceMetrics& GetResourceMetrics() const;
 
@@ -3008,6 +3168,15 @@ class KUDU_EXPORT KuduScanner {
   /// code path.
   static const uint64_t COLUMNAR_LAYOUT = 1 << 1;
 
+  /// With COLUMNAR_LAYOUT, have the server send the string and binary columns
+  /// stored with DICT_ENCODING (the default for them) as dictionaries of their
+  /// distinct values and a code per cell, rather than as the values of each
+  /// cell. This makes low-cardinality columns much cheaper to scan and transfer.
+  /// See KuduColumnarScanBatch::GetDictionaryColumn.
+  ///
+  /// NOTE: older versions of the Kudu server do not support this feature.
+  static const uint64_t COLUMNAR_DICTIONARY_ENCODING = 1 << 2;
+
   /// Optionally set row format modifier flags.
   ///
   /// If flags is RowFormatFlags::NO_FLAGS, then no modifications will be made to the row
@@ -3045,6 +3214,54 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetLimit(int64_t limit) WARN_UNUSED_RESULT;
 
+  /// Scan several tablets of the table concurrently.
+  ///
+  /// With parallelism greater than 1, the scanner keeps up to @c parallelism
+  /// tablets in flight on background threads, and NextBatch() returns the
+  /// batches they have buffered. Fault-tolerant (i.e. ordered) scans return
+  /// the tablets one after another, exactly as a serial scan would. Other
+  /// scans return batches in whichever order they arrive. A
+  /// @c READ_AT_SNAPSHOT scan without a snapshot timestamp scans all tablets
+  /// at the timestamp chosen by the first one.
+  ///
+  /// Parallel scans don't support SetLimit(), KeepAlive(),
+  /// GetCurrentServer(), or columnar batches.
+  ///
+  /// @param [in] parallelism
+  ///   The maximum number of tablets to scan at once. The default is 1.
+  /// @return Operation result status.
+  Status SetParallelism(int parallelism) WARN_UNUSED_RESULT;
+
+  /// Set the amount of row data a parallel scan may buffer ahead of the
+  /// caller, 64 MiB by default.
+  ///
+  /// Once the budget is used up, the tablets' scanners pause until the
+  /// caller consumes some batches.
+  ///
+  /// @param [in] buffer_bytes
+  ///   The buffer budget, in bytes.
+  /// @return Operation result status.
+  Status SetParallelScanBufferBytes(int64_t buffer_bytes) WARN_UNUSED_RESULT;
+
+  /// Serve repeated scans from rows cached by the client when possible.
+  ///
+  /// The client keeps the rows returned by each tablet whose scan completes
+  /// in a single batch, and the next identical scan of the tablet asks the
+  /// tablet server whether the tablet's data has changed since. If it hasn't,
+  /// the cached rows are returned without the tablet being scanned again, or
+  /// the rows being sent over the network. This suits small, frequently
+  /// repeated lookups, such as dimension table scans.
+  ///
+  /// Only @c READ_LATEST scans returning row-wise batches use the cache: the
+  /// setting is ignored for other scans. The cache's size is set by the
+  /// client's --client_scan_result_cache_capacity_mb flag, and the cache is
+  /// disabled (making this setting a no-op) if it's 0.
+  ///
+  /// @param [in] cache_results
+  ///   Whether to use the client's scan result cache. Default is @c false.
+  /// @return Operation result status.
+  Status SetCacheResults(bool cache_results) WARN_UNUSED_RESULT;
+
   /// @return String representation of this scan.
   ///
   /// @internal
@@ -3059,10 +3276,12 @@ class KUDU_EXPORT KuduScanner {
   Status NextBatch(internal::ScanBatchDataInterface* batch);
 
   friend class KuduScanToken;
+  friend class internal::ParallelScanner;
   FRIEND_TEST(ClientTest, TestBlockScannerHijackingAttempts);
   FRIEND_TEST(ClientTest, TestScanCloseProxy);
   FRIEND_TEST(ClientTest, TestScanFaultTolerance);
   FRIEND_TEST(ClientTest, TestScanNoBlockCaching);
+  FRIEND_TEST(ClientTest, TestScanPrefetch);
   FRIEND_TEST(ClientTest, TestScanTimeout);
   FRIEND_TEST(ClientTest, TestReadAtSnapshotNoTimestampSet);
   FRIEND_TEST(ConsistencyITest, TestSnapshotScanTimestampReuse);
@@ -3260,6 +3479,18 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @return Operation result status.
   Status IncludeTabletMetadata(bool include_metadata) WARN_UNUSED_RESULT;
 
+  /// Split the tablets' primary key ranges into chunks of about the given
+  /// size, and build a scan token per chunk rather than per tablet. The
+  /// chunks are computed by the tablet servers, from the on-disk size of the
+  /// tablets' data in the projected columns, so tablets with more data get
+  /// more tokens. The tablets are split concurrently.
+  ///
+  /// @param [in] split_size_bytes
+  ///   The approximate amount of data each token should cover. 0 (the
+  ///   default) builds one token per tablet.
+  /// @return Operation result status.
+  Status SetSplitSizeBytes(uint64_t split_size_bytes) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -3273,6 +3504,9 @@ class KUDU_EXPORT KuduScanTokenBuilder {
  private:
   class KUDU_NO_EXPORT Data;
 
+  friend class KuduScanner;
+  friend class internal::ParallelScanner;
+
   // Owned.
   Data* data_;
 
@@ -3355,9 +3589,31 @@ class KUDU_EXPORT KuduPartitioner {
   ///   provided row does not have all columns of the partition key
   ///   set.
   Status PartitionRow(const KuduPartialRow& row, int* partition);
+
+  /// Determine the partition indices of all the rows of a columnar batch.
+  ///
+  /// The result is that of PartitionRow() for each of the rows, but the
+  /// partition keys are encoded straight from the columns of the batch,
+  /// without building a KuduPartialRow nor allocating per row. This is the
+  /// way to partition rows in bulk, e.g. to shuffle them by tablet before
+  /// writing them.
+  ///
+  /// @param [in] batch
+  ///   The rows to be partitioned, of the partitioner's table. Only the
+  ///   columns of the partition key must be set.
+  /// @param [out] partitions
+  ///   The resulting partition index of each row of the batch, or -1 for the
+  ///   rows falling into a non-covered range.
+  ///
+  /// @return Status::OK if successful. May return a bad Status if the batch
+  ///   is of another table, or doesn't have all the columns of the
+  ///   partition key set.
+  Status PartitionColumnarBatch(const KuduColumnarInsertBatch& batch,
+                                std::vector<int>* partitions);
  private:
   class KUDU_NO_EXPORT Data;
 
+  friend class KuduColumnarInsertBatch;
   friend class KuduPartitionerBuilder;
 
   explicit KuduPartitioner(Data* data);
@@ -17,15 +17,125 @@
 
 #include "kudu/client/columnar_scan_batch.h"
 
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/client/arrow_c_data-internal.h"
 #include "kudu/client/scanner-internal.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/slice.h"
 
-namespace kudu {
-class Slice;
+using std::deque;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
 
+namespace kudu {
 namespace client {
 
+namespace {
+
+// What an exported schema and its children point to. It's shared by all of
+// them, since a consumer may move the children out of the top-level schema
+// and release them separately.
+struct ExportedSchema {
+  vector<string> formats;
+  vector<string> names;
+  // The formats of the values of dictionary-encoded columns, empty for others.
+  vector<string> dictionary_formats;
+  deque<ArrowSchema> children;
+  vector<ArrowSchema*> child_ptrs;
+  deque<ArrowSchema> dictionaries;
+};
+
+// Likewise, for an exported array: the batch data holding the rows, and any
+// buffers converted from it.
+struct ExportedArray {
+  unique_ptr<KuduColumnarScanBatch> batch;
+  vector<unique_ptr<uint8_t[]>> converted;
+  deque<vector<const void*>> buffers;
+  deque<ArrowArray> children;
+  vector<ArrowArray*> child_ptrs;
+  deque<ArrowArray> dictionaries;
+};
+
+// Stands in for the buffers of empty arrays, which consumers may not expect
+// to be null. It's also a valid offsets buffer of an empty array.
+const uint32_t kEmptyBuffer[1] = { 0 };
+
+const void* BufferOf(const Slice& data) {
+  return data.empty() ? static_cast<const void*>(kEmptyBuffer) : data.data();
+}
+
+template<class T>
+void ReleaseArrow(T* arrow) {
+  for (int64_t i = 0; i < arrow->n_children; i++) {
+    T* child = arrow->children[i];
+    if (child->release) {
+      child->release(child);
+    }
+  }
+  if (arrow->dictionary && arrow->dictionary->release) {
+    arrow->dictionary->release(arrow->dictionary);
+  }
+  delete static_cast<shared_ptr<void>*>(arrow->private_data);
+  arrow->release = nullptr;
+}
+
+void ReleaseArrowSchema(ArrowSchema* schema) {
+  ReleaseArrow(schema);
+}
+
+void ReleaseArrowArray(ArrowArray* array) {
+  ReleaseArrow(array);
+}
+
+// Returns the format string of the Arrow type for 'col' in 'format'.
+Status ArrowFormat(const ColumnSchema& col, string* format) {
+  const auto& attributes = col.type_attributes();
+  switch (col.type_info()->type()) {
+    case BOOL: // fall-through
+    case IS_DELETED: *format = "b"; break;
+    case INT8: *format = "c"; break;
+    case INT16: *format = "s"; break;
+    case INT32: *format = "i"; break;
+    case INT64: *format = "l"; break;
+    case FLOAT: *format = "f"; break;
+    case DOUBLE: *format = "g"; break;
+    case UNIXTIME_MICROS: *format = "tsu:"; break;
+    case DATE: *format = "tdD"; break;
+    case STRING: // fall-through
+    case VARCHAR: *format = "u"; break;
+    case BINARY: *format = "z"; break;
+    case DECIMAL32:
+      *format = Substitute("d:$0,$1,32", attributes.precision, attributes.scale);
+      break;
+    case DECIMAL64:
+      *format = Substitute("d:$0,$1,64", attributes.precision, attributes.scale);
+      break;
+    case DECIMAL128:
+      *format = Substitute("d:$0,$1", attributes.precision, attributes.scale);
+      break;
+    default:
+      return Status::NotSupported("column type has no Arrow equivalent", col.ToString());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 KuduColumnarScanBatch::KuduColumnarScanBatch()
     : data_(new KuduColumnarScanBatch::Data()) {
 }
@@ -46,6 +156,13 @@ Status KuduColumnarScanBatch::GetVariableLengthColumn(int idx, Slice* offsets, S
   return data_->GetVariableLengthColumn(idx, offsets, data);
 }
 
+Status KuduColumnarScanBatch::GetDictionaryColumn(int idx,
+                                                  Slice* codes,
+                                                  Slice* dictionary_offsets,
+                                                  Slice* dictionary_data) const {
+  return data_->GetDictionaryColumn(idx, codes, dictionary_offsets, dictionary_data);
+}
+
 Status KuduColumnarScanBatch::GetNonNullBitmapForColumn(int idx, Slice* data) const {
   RETURN_NOT_OK(data_->CheckColumnIndex(idx));
   const auto& col = data_->resp_data_.columns(idx);
@@ -55,5 +172,159 @@ Status KuduColumnarScanBatch::GetNonNullBitmapForColumn(int idx, Slice* data) co
   return data_->controller_.GetInboundSidecar(col.non_null_bitmap_sidecar(), data);
 }
 
+Status KuduColumnarScanBatch::ExportToArrow(ArrowSchema* schema, ArrowArray* array) {
+  const Schema* projection = data_->projection_;
+  if (!projection) {
+    return Status::IllegalState("no batch to export");
+  }
+  const int num_cols = projection->num_columns();
+  const int64_t num_rows = NumRows();
+
+  auto exported_schema = std::make_shared<ExportedSchema>();
+  auto exported_array = std::make_shared<ExportedArray>();
+  exported_schema->formats.resize(num_cols);
+  exported_schema->names.resize(num_cols);
+  exported_schema->dictionary_formats.resize(num_cols);
+  for (int i = 0; i < num_cols; i++) {
+    const ColumnSchema& col = projection->column(i);
+    RETURN_NOT_OK(ArrowFormat(col, &exported_schema->formats[i]));
+    exported_schema->names[i] = col.name();
+    const bool dictionary =
+        num_rows > 0 && data_->resp_data_.columns(i).has_dictionary_codes_sidecar();
+    if (dictionary) {
+      // Dictionary-encoded columns are exported as their int32 codes, with the
+      // values as the dictionary.
+      exported_schema->dictionary_formats[i] = std::move(exported_schema->formats[i]);
+      exported_schema->formats[i] = "i";
+    }
+
+    vector<const void*> buffers;
+    Slice non_null_bitmap;
+    if (col.is_nullable() && num_rows > 0) {
+      RETURN_NOT_OK(GetNonNullBitmapForColumn(i, &non_null_bitmap));
+    }
+    buffers.push_back(non_null_bitmap.empty() ? nullptr : non_null_bitmap.data());
+    if (dictionary) {
+      Slice codes;
+      Slice offsets;
+      Slice varlen_data;
+      RETURN_NOT_OK(data_->GetDictionaryColumn(i, &codes, &offsets, &varlen_data));
+      buffers.push_back(BufferOf(codes));
+
+      exported_array->buffers.emplace_back(
+          vector<const void*>{ nullptr, BufferOf(offsets), BufferOf(varlen_data) });
+      ArrowArray values;
+      values.length = offsets.empty() ? 0 : offsets.size() / sizeof(uint32_t) - 1;
+      values.null_count = 0;
+      values.offset = 0;
+      values.n_buffers = 3;
+      values.n_children = 0;
+      values.buffers = exported_array->buffers.back().data();
+      values.children = nullptr;
+      values.dictionary = nullptr;
+      values.release = &ReleaseArrowArray;
+      values.private_data = new shared_ptr<void>(exported_array);
+      exported_array->dictionaries.push_back(values);
+    } else if (col.type_info()->physical_type() == BINARY) {
+      Slice offsets;
+      Slice varlen_data;
+      if (num_rows > 0) {
+        RETURN_NOT_OK(GetVariableLengthColumn(i, &offsets, &varlen_data));
+      }
+      buffers.push_back(BufferOf(offsets));
+      buffers.push_back(BufferOf(varlen_data));
+    } else {
+      Slice cells;
+      if (num_rows > 0) {
+        RETURN_NOT_OK(GetFixedLengthColumn(i, &cells));
+      }
+      if (col.type_info()->physical_type() == BOOL) {
+        // Arrow packs booleans into a bitmap.
+        unique_ptr<uint8_t[]> bits(new uint8_t[BitmapSize(num_rows)]());
+        for (int64_t r = 0; r < num_rows; r++) {
+          if (cells[r]) {
+            BitmapSet(bits.get(), r);
+          }
+        }
+        buffers.push_back(bits.get());
+        exported_array->converted.emplace_back(std::move(bits));
+      } else {
+        buffers.push_back(BufferOf(cells));
+      }
+    }
+
+    ArrowArray child;
+    child.length = num_rows;
+    child.null_count = non_null_bitmap.empty() ? 0 : -1;
+    child.offset = 0;
+    child.n_buffers = buffers.size();
+    child.n_children = 0;
+    exported_array->buffers.emplace_back(std::move(buffers));
+    child.buffers = exported_array->buffers.back().data();
+    child.children = nullptr;
+    child.dictionary = dictionary ? &exported_array->dictionaries.back() : nullptr;
+    child.release = &ReleaseArrowArray;
+    child.private_data = new shared_ptr<void>(exported_array);
+    exported_array->children.push_back(child);
+  }
+
+  // Nothing can fail past this point: the exported arrays take the data over.
+  exported_array->batch.reset(new KuduColumnarScanBatch);
+  std::swap(data_, exported_array->batch->data_);
+
+  for (int i = 0; i < num_cols; i++) {
+    ArrowSchema child;
+    child.format = exported_schema->formats[i].c_str();
+    child.name = exported_schema->names[i].c_str();
+    child.metadata = nullptr;
+    child.flags = projection->column(i).is_nullable() ? ARROW_FLAG_NULLABLE : 0;
+    child.n_children = 0;
+    child.children = nullptr;
+    child.dictionary = nullptr;
+    if (!exported_schema->dictionary_formats[i].empty()) {
+      ArrowSchema values;
+      values.format = exported_schema->dictionary_formats[i].c_str();
+      values.name = "";
+      values.metadata = nullptr;
+      values.flags = 0;
+      values.n_children = 0;
+      values.children = nullptr;
+      values.dictionary = nullptr;
+      values.release = &ReleaseArrowSchema;
+      values.private_data = new shared_ptr<void>(exported_schema);
+      exported_schema->dictionaries.push_back(values);
+      child.dictionary = &exported_schema->dictionaries.back();
+    }
+    child.release = &ReleaseArrowSchema;
+    child.private_data = new shared_ptr<void>(exported_schema);
+    exported_schema->children.push_back(child);
+    exported_schema->child_ptrs.push_back(&exported_schema->children.back());
+    exported_array->child_ptrs.push_back(&exported_array->children[i]);
+  }
+
+  schema->format = "+s";
+  schema->name = "";
+  schema->metadata = nullptr;
+  schema->flags = 0;
+  schema->n_children = num_cols;
+  schema->children = exported_schema->child_ptrs.data();
+  schema->dictionary = nullptr;
+  schema->release = &ReleaseArrowSchema;
+  schema->private_data = new shared_ptr<void>(exported_schema);
+
+  exported_array->buffers.emplace_back(1, nullptr);
+  array->length = num_rows;
+  array->null_count = 0;
+  array->offset = 0;
+  array->n_buffers = 1;
+  array->n_children = num_cols;
+  array->buffers = exported_array->buffers.back().data();
+  array->children = exported_array->child_ptrs.data();
+  array->dictionary = nullptr;
+  array->release = &ReleaseArrowArray;
+  array->private_data = new shared_ptr<void>(exported_array);
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
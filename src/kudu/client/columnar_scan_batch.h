@@ -26,6 +26,10 @@
 #include "kudu/util/kudu_export.h"
 #include "kudu/util/status.h"
 
+// Defined by the Arrow C data interface, e.g. in arrow/c/abi.h.
+struct ArrowArray;
+struct ArrowSchema;
+
 namespace kudu {
 class Slice;
 
@@ -84,9 +88,33 @@ class KUDU_EXPORT KuduColumnarScanBatch {
   ///   the ending offset of that cell.
   /// @param [out] data
   ///   The variable-length data.
-  /// @return Operation result status.
+  /// @return Operation result status. InvalidArgument if the column is
+  ///   dictionary-encoded in this batch: use GetDictionaryColumn instead.
   Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
 
+  /// Return the dictionary and the codes of a variable-length-typed column with
+  /// index 'idx' which the server sent dictionary-encoded, as it does for the
+  /// columns stored with DICT_ENCODING if the scan is configured with the
+  /// KuduScanner::COLUMNAR_DICTIONARY_ENCODING row format flag. The dictionary
+  /// only holds the values of this batch's cells.
+  ///
+  /// @note The Slices returned are only valid for the lifetime of the KuduColumnarScanBatch.
+  ///
+  /// @param [in] idx
+  ///   The column index.
+  /// @param [out] codes
+  ///   NumRows() little-endian int32 codes, each the index of a cell's value in
+  ///   the dictionary. The codes of null cells are those of an empty value.
+  /// @param [out] dictionary_offsets
+  ///   The offsets of the values of the dictionary within 'dictionary_data', in
+  ///   the format of the offsets returned by GetVariableLengthColumn.
+  /// @param [out] dictionary_data
+  ///   The variable-length data of the dictionary.
+  /// @return Operation result status. NotFound if the column isn't
+  ///   dictionary-encoded in this batch.
+  Status GetDictionaryColumn(int idx, Slice* codes, Slice* dictionary_offsets,
+                             Slice* dictionary_data) const;
+
   /// Get a bitmap corresponding to the non-null status of the cells in the given column.
   ///
   /// It is an error to call this function on a column which is not marked as nullable
@@ -104,6 +132,27 @@ class KUDU_EXPORT KuduColumnarScanBatch {
   /// @return Operation result status.
   Status GetNonNullBitmapForColumn(int idx, Slice* data) const;
 
+  /// Export the batch through the Arrow C data interface[2], as a struct
+  /// array with a child array per projected column.
+  ///
+  /// The exported arrays take over the batch's data, leaving the batch
+  /// empty, and use it in place: only BOOL columns, which are sent one byte
+  /// per cell, are converted into Arrow's bit-packed layout. STRING and
+  /// VARCHAR columns are exported as @c utf8, dictionary-encoded ones as
+  /// dictionaries with @c int32 indices, UNIXTIME_MICROS columns as
+  /// timestamps without a time zone, and DECIMAL columns as decimals of
+  /// the width they're stored with.
+  ///
+  /// [2] https://arrow.apache.org/docs/format/CDataInterface.html
+  ///
+  /// @param [out] schema
+  ///   The schema of the exported array. The caller must release it.
+  /// @param [out] array
+  ///   The exported array. The caller must release it.
+  /// @return Operation result status. On failure, neither @c schema nor
+  ///   @c array is set, and the batch is left unchanged.
+  Status ExportToArrow(struct ArrowSchema* schema, struct ArrowArray* array);
+
  private:
   class KUDU_NO_EXPORT Data;
 
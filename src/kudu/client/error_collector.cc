@@ -23,6 +23,7 @@
 
 #include "kudu/client/client.h"
 #include "kudu/client/error-internal.h"
+#include "kudu/client/write_op-internal.h"
 #include "kudu/client/write_op.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -66,6 +67,17 @@ Status ErrorCollector::SetMaxMemSize(size_t size_bytes) {
 }
 
 void ErrorCollector::AddError(std::unique_ptr<KuduError> error) {
+  // The failure of the inserts of a columnar batch is reported for each of
+  // them, as if they had been applied one by one.
+  if (const auto* columnar = dynamic_cast<const ColumnarInsertOp*>(
+          error->data_->failed_op_.get())) {
+    for (int i = 0; i < columnar->num_rows(); i++) {
+      AddError(std::unique_ptr<KuduError>(
+          new KuduError(columnar->NewRowInsert(i).release(), error->status())));
+    }
+    return;
+  }
+
   std::lock_guard<simple_spinlock> l(lock_);
   const size_t error_size_bytes = error->data_->failed_op_->SizeInBuffer();
 
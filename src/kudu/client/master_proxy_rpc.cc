@@ -41,6 +41,7 @@
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
 
+using std::shared_ptr;
 using std::string;
 using std::vector;
 using strings::Substitute;
@@ -91,6 +92,20 @@ using rpc::RpcController;
 namespace client {
 namespace internal {
 
+namespace {
+
+// Whether 'resp' carries an error of any kind.
+template <class RespClass>
+bool HasErrors(const RespClass& resp) {
+  return resp.has_error();
+}
+
+bool HasErrors(const GetTabletLocationsResponsePB& resp) {
+  return resp.has_error() || resp.errors_size() > 0;
+}
+
+} // anonymous namespace
+
 template <class ReqClass, class RespClass>
 AsyncLeaderMasterRpc<ReqClass, RespClass>::AsyncLeaderMasterRpc(
     const MonoTime& deadline,
@@ -131,7 +146,16 @@ void AsyncLeaderMasterRpc<ReqClass, RespClass>::SendRpc() {
   for (uint32_t required_feature_flag : required_feature_flags_) {
     controller->RequireServerFeature(required_feature_flag);
   }
-  func_(client_->data_->master_proxy().get(), *req_, resp_, controller,
+  shared_ptr<MasterServiceProxy> proxy;
+  if (send_to_any_master_) {
+    send_to_any_master_ = false;
+    proxy = client_->data_->lookup_master_proxy();
+  }
+  sent_to_any_master_ = proxy != nullptr;
+  if (!proxy) {
+    proxy = client_->data_->master_proxy();
+  }
+  func_(proxy.get(), *req_, resp_, controller,
         [this]() { this->SendRpcCb(Status::OK()); });
 }
 
@@ -187,6 +211,18 @@ void AsyncLeaderMasterRpc<ReqClass, RespClass>::ResetMasterLeaderAndRetry(
 template <class ReqClass, class RespClass>
 bool AsyncLeaderMasterRpc<ReqClass, RespClass>::RetryOrReconnectIfNecessary(
     Status* status) {
+  // Whatever went wrong with a master other than the leader (e.g. it's a
+  // follower that doesn't serve the RPC, or its metadata is out of date),
+  // the RPC is resent to the leader right away.
+  if (sent_to_any_master_) {
+    sent_to_any_master_ = false;
+    if (!status->ok() || !retrier().controller().status().ok() || HasErrors(*resp_)) {
+      VLOG(2) << Substitute("Resending $0 request to the leader master", rpc_name_);
+      resp_->Clear();
+      SendRpc();
+      return true;
+    }
+  }
   const string retry_warning = Substitute("Re-attempting $0 request to leader Master ($1)",
       rpc_name_, client_->data_->leader_master_hostport().ToString());
   auto warn_on_retry = MakeScopedCleanup([&retry_warning] {
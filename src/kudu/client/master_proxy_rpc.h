@@ -104,6 +104,13 @@ class AsyncLeaderMasterRpc : public rpc::Rpc {
   bool RetryOrReconnectIfNecessary(Status* status);
 
  protected:
+  // Sends the first attempt of the RPC to one of the masters, taken in turn,
+  // rather than to the leader. It's resent to the leader should that master
+  // fail it in any way. Meant for lookups that follower masters may serve.
+  void SendFirstAttemptToAnyMaster() {
+    send_to_any_master_ = true;
+  }
+
   // Handles 'status', retrying if necessary, and calling the user-provided
   // callback as appropriate.
   void SendRpcCb(const Status& status) override;
@@ -139,6 +146,12 @@ class AsyncLeaderMasterRpc : public rpc::Rpc {
   // List of master-side feature flags required to send this RPC. If the
   // master(s) is missing any of these flags, the RPC will yield an error.
   const std::vector<uint32_t> required_feature_flags_;
+
+ private:
+  // Whether the next attempt is to be sent to any master, and whether the
+  // last one was.
+  bool send_to_any_master_ = false;
+  bool sent_to_any_master_ = false;
 };
 
 } // namespace internal
@@ -17,8 +17,11 @@
 
 #include "kudu/client/meta_cache.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -33,6 +36,7 @@
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/client.h"
+#include "kudu/client/client.pb.h"
 #include "kudu/client/master_proxy_rpc.h"
 #include "kudu/client/schema.h"
 #include "kudu/common/common.pb.h"
@@ -50,6 +54,7 @@
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
@@ -72,6 +77,7 @@ using kudu::rpc::BackoffType;
 using kudu::rpc::CredentialsPolicy;
 using kudu::tserver::TabletServerAdminServiceProxy;
 using kudu::tserver::TabletServerServiceProxy;
+using std::map;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -79,14 +85,15 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
-// TODO(todd) before enabling by default, need to think about how this works with
-// docker/k8s -- I think the abstract namespace is scoped to a given k8s pod. We
-// probably need to have the client blacklist the socket if it attempts to use it
-// and can't connect.
-DEFINE_bool(client_use_unix_domain_sockets, false,
+// The abstract namespace is scoped to a network namespace, so a client in
+// a different container than a co-located tablet server might not be able to
+// reach the server's socket. In that case the client falls back to TCP after
+// the first failed attempt: see RemoteTabletServer::MarkFailed().
+DEFINE_bool(client_use_unix_domain_sockets, true,
             "Whether to try to connect to tablet servers using unix domain sockets. "
             "This will only be attempted if the server has indicated that it is listening "
-            "on such a socket and the client is running on the same host.");
+            "on such a socket and the client is running on the same host. If connecting "
+            "via the socket fails, the client uses TCP for that server instead.");
 TAG_FLAG(client_use_unix_domain_sockets, experimental);
 
 DEFINE_int32(client_tablet_locations_by_id_ttl_ms, 60 * 60 * 1000, // 60 minutes
@@ -95,6 +102,14 @@ DEFINE_int32(client_tablet_locations_by_id_ttl_ms, 60 * 60 * 1000, // 60 minutes
 TAG_FLAG(client_tablet_locations_by_id_ttl_ms, advanced);
 TAG_FLAG(client_tablet_locations_by_id_ttl_ms, runtime);
 
+DEFINE_bool(client_lookups_from_any_master, false,
+            "Whether to send tablet location lookups to each of the masters in "
+            "turn, rather than only to the leader master. Only useful with "
+            "follower masters that serve lookups (--master_follower_serve_lookups); "
+            "a lookup failed by a follower is resent to the leader master.");
+TAG_FLAG(client_lookups_from_any_master, experimental);
+TAG_FLAG(client_lookups_from_any_master, runtime);
+
 namespace kudu {
 namespace client {
 namespace internal {
@@ -124,6 +139,7 @@ void RemoteTabletServer::DnsResolutionFinished(const HostPort& hp,
 
   VLOG(1) << "Successfully resolved " << hp.ToString() << ": "
           << (*addrs)[0].ToString();
+  const bool uses_unix_domain_socket = (*addrs)[0].is_unix();
   auto proxy = std::make_shared<TabletServerServiceProxy>(
         client->data_->messenger_, (*addrs)[0], hp.host());
   proxy->set_user_credentials(client->data_->user_credentials_);
@@ -135,21 +151,28 @@ void RemoteTabletServer::DnsResolutionFinished(const HostPort& hp,
     proxy_ = std::move(proxy);
     admin_proxy_ = std::move(admin_proxy);
     proxy_->set_user_credentials(client->data_->user_credentials_);
+    proxy_uses_unix_domain_socket_ = uses_unix_domain_socket;
   }
   user_callback(s);
 }
 
 void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb) {
   HostPort hp;
+  boost::optional<string> unix_domain_socket_path;
   {
     std::unique_lock<simple_spinlock> l(lock_);
 
-    if (proxy_) {
+    // A proxy using an unreachable unix domain socket is replaced, but kept
+    // until then: concurrent callers of proxy() rely on it being set.
+    if (proxy_ && !(proxy_uses_unix_domain_socket_ && unix_domain_socket_failed_)) {
       // Already have a proxy created.
       l.unlock();
       cb(Status::OK());
       return;
     }
+    if (!unix_domain_socket_failed_) {
+      unix_domain_socket_path = unix_domain_socket_path_;
+    }
 
     CHECK(!rpc_hostports_.empty());
     // TODO: if the TS advertises multiple host/ports, pick the right one
@@ -159,14 +182,14 @@ void RemoteTabletServer::InitProxy(KuduClient* client, const StatusCallback& cb)
 
   auto addrs = new vector<Sockaddr>;
 
-  if (FLAGS_client_use_unix_domain_sockets && unix_domain_socket_path_ &&
+  if (FLAGS_client_use_unix_domain_sockets && unix_domain_socket_path &&
       client->data_->IsLocalHostPort(hp)) {
     Sockaddr unix_socket;
-    Status parse_status = unix_socket.ParseUnixDomainPath(*unix_domain_socket_path_);
+    Status parse_status = unix_socket.ParseUnixDomainPath(*unix_domain_socket_path);
     if (!parse_status.ok()) {
       KLOG_EVERY_N_SECS(WARNING, 60)
           << Substitute("Tablet server $0 ($1) reported an invalid UNIX domain socket path '$2'",
-                        hp.ToString(), uuid_, *unix_domain_socket_path_);
+                        hp.ToString(), uuid_, *unix_domain_socket_path);
       // Fall through to normal TCP path.
     } else {
       VLOG(1) << Substitute("Will try to connect to UNIX socket $0 for local tablet server $1 ($2)",
@@ -193,11 +216,56 @@ void RemoteTabletServer::Update(const master::TSInfoPB& pb) {
     rpc_hostports_.emplace_back(hostport_pb.host(), hostport_pb.port());
   }
   location_ = pb.location();
+  boost::optional<string> unix_domain_socket_path;
   if (pb.has_unix_domain_socket_path()) {
-    unix_domain_socket_path_ = pb.unix_domain_socket_path();
-  } else {
-    unix_domain_socket_path_ = boost::none;
+    unix_domain_socket_path = pb.unix_domain_socket_path();
+  }
+  if (unix_domain_socket_path != unix_domain_socket_path_) {
+    // Give a newly advertised socket a chance.
+    unix_domain_socket_failed_ = false;
+  }
+  unix_domain_socket_path_ = std::move(unix_domain_socket_path);
+}
+
+void RemoteTabletServer::MarkFailed(const Status& status) {
+  if (!status.IsNetworkError()) {
+    return;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (proxy_uses_unix_domain_socket_ && !unix_domain_socket_failed_) {
+    LOG(INFO) << Substitute("falling back to TCP for tablet server $0: $1",
+                            uuid_, status.ToString());
+    unix_domain_socket_failed_ = true;
+  }
+}
+
+void RemoteTabletServer::RecordScanLatency(const MonoDelta& latency) {
+  const int64_t sample_us = std::max<int64_t>(latency.ToMicroseconds(), 0);
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (scan_latency_us_ < 0) {
+    scan_latency_us_ = sample_us;
+    scan_latency_dev_us_ = sample_us / 2;
+    return;
+  }
+  // The gains are 1/8 for the latency and 1/4 for its deviation, as in TCP.
+  scan_latency_dev_us_ += (std::abs(scan_latency_us_ - sample_us) - scan_latency_dev_us_) / 4;
+  scan_latency_us_ += (sample_us - scan_latency_us_) / 8;
+}
+
+MonoDelta RemoteTabletServer::smoothed_scan_latency() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (scan_latency_us_ < 0) {
+    return MonoDelta();
   }
+  return MonoDelta::FromMicroseconds(scan_latency_us_);
+}
+
+MonoDelta RemoteTabletServer::scan_latency_threshold() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (scan_latency_us_ < 0) {
+    return MonoDelta();
+  }
+  return MonoDelta::FromMicroseconds(scan_latency_us_ + 4 * scan_latency_dev_us_);
 }
 
 const string& RemoteTabletServer::permanent_uuid() const {
@@ -667,6 +735,9 @@ LookupRpcById::LookupRpcById(scoped_refptr<MetaCache> meta_cache,
       remote_tablet_(remote_tablet) {
   req_.add_tablet_ids(tablet_id_);
   req_.set_intern_ts_infos_in_response(true);
+  if (FLAGS_client_lookups_from_any_master) {
+    SendFirstAttemptToAnyMaster();
+  }
 }
 
 void LookupRpcById::SendRpc() {
@@ -854,6 +925,9 @@ LookupRpc::LookupRpc(scoped_refptr<MetaCache> meta_cache,
       lookup_type_(lookup_type),
       replica_visibility_(replica_visibility) {
   DCHECK(deadline.Initialized());
+  if (FLAGS_client_lookups_from_any_master) {
+    SendFirstAttemptToAnyMaster();
+  }
 }
 
 LookupRpc::~LookupRpc() {
@@ -1352,11 +1426,164 @@ void MetaCache::LookupTabletById(KuduClient* client,
   rpc->SendRpcSlowPath();
 }
 
+Status MetaCache::PrefetchTableLocations(const KuduTable* table, const MonoTime& deadline) {
+  // Every lower bound lookup that misses the cache fetches the locations of
+  // the next kFetchTabletsPerRangeLookup tablets, so walking the table's
+  // tablets in order only goes to the master once per as many tablets.
+  PartitionKey partition_key;
+  while (true) {
+    scoped_refptr<RemoteTablet> tablet;
+    Synchronizer sync;
+    LookupTabletByKey(table, partition_key, deadline, LookupType::kLowerBound,
+                      &tablet, sync.AsStatusCallback());
+    const Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // The rest of the partition key space isn't covered by any tablet.
+      return Status::OK();
+    }
+    RETURN_NOT_OK_PREPEND(s, Substitute("failed to prefetch locations of table $0",
+                                        table->name()));
+    if (tablet->partition().end().empty()) {
+      return Status::OK();
+    }
+    partition_key = tablet->partition().end();
+  }
+}
+
+namespace {
+
+// Sets 'tablet_pb' to the locations of the tablet of 'entry'.
+void TabletMetadataFromEntry(const MetaCacheEntry& entry, TabletMetadataPB* tablet_pb) {
+  tablet_pb->set_tablet_id(entry.tablet()->tablet_id());
+  entry.tablet()->partition().ToPB(tablet_pb->mutable_partition());
+  const MonoDelta ttl = entry.expiration_time() - MonoTime::Now();
+  tablet_pb->set_ttl_millis(ttl.ToMilliseconds());
+
+  // Build the list of server metadata.
+  vector<RemoteTabletServer*> servers;
+  map<string, int> server_index_map;
+  entry.tablet()->GetRemoteTabletServers(&servers);
+  for (int i = 0; i < servers.size(); i++) {
+    RemoteTabletServer* server = servers[i];
+    ServerMetadataPB* server_pb = tablet_pb->add_tablet_servers();
+    server_pb->set_uuid(server->permanent_uuid());
+    server_pb->set_location(server->location());
+    vector<HostPort> host_ports;
+    server->GetHostPorts(&host_ports);
+    for (const HostPort& host_port : host_ports) {
+      *server_pb->add_rpc_addresses() = HostPortToPB(host_port);
+      server_index_map[host_port.ToString()] = i;
+    }
+  }
+
+  // Build the list of replica metadata.
+  vector<RemoteReplica> replicas;
+  entry.tablet()->GetRemoteReplicas(&replicas);
+  for (const RemoteReplica& replica : replicas) {
+    vector<HostPort> host_ports;
+    replica.ts->GetHostPorts(&host_ports);
+    TabletMetadataPB::ReplicaMetadataPB* replica_pb = tablet_pb->add_replicas();
+    replica_pb->set_role(replica.role);
+    replica_pb->set_ts_idx(server_index_map[host_ports[0].ToString()]);
+  }
+}
+
+} // anonymous namespace
+
+bool MetaCache::GetTabletMetadata(const KuduTable* table,
+                                  const PartitionKey& partition_key,
+                                  TabletMetadataPB* tablet_pb) {
+  MetaCacheEntry entry;
+  if (!LookupEntryByKeyFastPath(table, partition_key, &entry) ||
+      entry.is_non_covered_range() || entry.stale()) {
+    return false;
+  }
+  TabletMetadataFromEntry(entry, tablet_pb);
+  return true;
+}
+
+Status MetaCache::AddTabletMetadata(const KuduTable* table, const TabletMetadataPB& tablet_pb) {
+  Partition partition;
+  Partition::FromPB(tablet_pb.partition(), &partition);
+  MetaCacheEntry entry;
+  if (LookupEntryByKeyFastPath(table, partition.begin(), &entry)) {
+    return Status::OK();
+  }
+
+  // Generate a fake GetTableLocationsResponsePB to pass to
+  // ProcessGetTableLocationsResponse() in order to "inject" the tablet
+  // metadata into the cache.
+  GetTableLocationsResponsePB mock_resp;
+  mock_resp.set_ttl_millis(tablet_pb.ttl_millis());
+
+  // Populate the locations.
+  TabletLocationsPB* locations_pb = mock_resp.add_tablet_locations();
+  locations_pb->set_tablet_id(tablet_pb.tablet_id());
+  partition.ToPB(locations_pb->mutable_partition());
+  for (const TabletMetadataPB::ReplicaMetadataPB& replica_meta : tablet_pb.replicas()) {
+    TabletLocationsPB::InternedReplicaPB* replica_pb = locations_pb->add_interned_replicas();
+    replica_pb->set_ts_info_idx(replica_meta.ts_idx());
+    replica_pb->set_role(replica_meta.role());
+    if (replica_meta.has_dimension_label()) {
+      replica_pb->set_dimension_label(replica_meta.dimension_label());
+    }
+  }
+
+  // Populate the servers.
+  for (const ServerMetadataPB& server_meta : tablet_pb.tablet_servers()) {
+    TSInfoPB* server_pb = mock_resp.add_ts_infos();
+    server_pb->set_permanent_uuid(server_meta.uuid());
+    server_pb->set_location(server_meta.location());
+    for (const HostPortPB& host_port : server_meta.rpc_addresses()) {
+      *server_pb->add_rpc_addresses() = host_port;
+    }
+  }
+
+  return ProcessGetTableLocationsResponse(
+      table, partition.begin(), true, mock_resp, &entry, 1);
+}
+
+void MetaCache::GetTableLocations(const KuduTable* table, TableLocationsPB* locations_pb) {
+  vector<MetaCacheEntry> entries;
+  {
+    shared_lock<rw_spinlock> l(lock_.get_lock());
+    const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
+    if (tablets) {
+      for (const auto& e : *tablets) {
+        if (!e.second.is_non_covered_range() && !e.second.stale()) {
+          entries.emplace_back(e.second);
+        }
+      }
+    }
+  }
+  locations_pb->Clear();
+  locations_pb->set_table_id(table->id());
+  for (const auto& entry : entries) {
+    TabletMetadataFromEntry(entry, locations_pb->add_tablets());
+  }
+}
+
+Status MetaCache::AddTableLocations(const KuduTable* table,
+                                    const TableLocationsPB& locations_pb) {
+  if (locations_pb.table_id() != table->id()) {
+    return Status::InvalidArgument(
+        Substitute("tablet locations are for table $0, not for table $1 ($2)",
+                   locations_pb.table_id(), table->name(), table->id()));
+  }
+  for (const auto& tablet_pb : locations_pb.tablets()) {
+    RETURN_NOT_OK_PREPEND(AddTabletMetadata(table, tablet_pb),
+                          Substitute("failed to cache locations of tablet $0",
+                                     tablet_pb.tablet_id()));
+  }
+  return Status::OK();
+}
+
 void MetaCache::MarkTSFailed(RemoteTabletServer* ts,
                              const Status& status) {
   LOG(INFO) << Substitute("marking tablet server $0 as failed", ts->ToString());
   SCOPED_LOG_SLOW_EXECUTION(WARNING, 50, "marking tablet server as failed");
   const auto ts_status = status.CloneAndPrepend("TS failed");
+  ts->MarkFailed(status);
 
   shared_lock<rw_spinlock> l(lock_.get_lock());
   // TODO(adar): replace with a ts->tablet multimap for faster lookup?
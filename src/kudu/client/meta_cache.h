@@ -66,6 +66,8 @@ class ClientTest_TestMasterLookupPermits_Test;
 class ClientTest_TestMetaCacheExpiry_Test;
 class KuduClient;
 class KuduTable;
+class TableLocationsPB;
+class TabletMetadataPB;
 
 namespace internal {
 
@@ -98,6 +100,13 @@ class RemoteTabletServer {
   // Requires that 'pb''s UUID matches this server.
   void Update(const master::TSInfoPB& pb);
 
+  // Note a failure of an RPC sent to this tablet server. If the failure is
+  // a network error and the current proxy connects via the server's unix
+  // domain socket, the socket is considered unreachable from this client
+  // (e.g. the client runs in a different network namespace) and the next call
+  // to InitProxy() sets up a proxy connecting via TCP instead.
+  void MarkFailed(const Status& status);
+
   // Return the current proxy to this tablet server. Requires that InitProxy()
   // be called prior to this.
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy() const;
@@ -114,6 +123,21 @@ class RemoteTabletServer {
   // If no location is assigned, the returned string will be empty.
   std::string location() const;
 
+  // Record the latency of a scan RPC served by this tablet server. The client
+  // keeps a smoothed estimate of the latency and of its mean deviation, the
+  // same way TCP estimates round-trip times (see RFC 6298).
+  void RecordScanLatency(const MonoDelta& latency);
+
+  // Return the smoothed scan latency of this tablet server, or an
+  // uninitialized MonoDelta if no scan latency has been recorded yet.
+  MonoDelta smoothed_scan_latency() const;
+
+  // Return how long a scan RPC to this tablet server may be outstanding before
+  // it's considered unusually slow: the smoothed latency plus four times its
+  // mean deviation. Returns an uninitialized MonoDelta if no scan latency has
+  // been recorded yet.
+  MonoDelta scan_latency_threshold() const;
+
  private:
   // Internal callback for DNS resolution.
   void DnsResolutionFinished(const HostPort& hp,
@@ -134,6 +158,16 @@ class RemoteTabletServer {
   // server is local to the client.
   boost::optional<std::string> unix_domain_socket_path_;
 
+  // Whether connecting via 'unix_domain_socket_path_' has failed, and whether
+  // the current proxy connects via that path.
+  bool unix_domain_socket_failed_ = false;
+  bool proxy_uses_unix_domain_socket_ = false;
+
+  // Smoothed scan latency and its mean deviation, in microseconds. Negative
+  // if no scan latency has been recorded yet.
+  int64_t scan_latency_us_ = -1;
+  int64_t scan_latency_dev_us_ = 0;
+
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
   std::shared_ptr<tserver::TabletServerAdminServiceProxy> admin_proxy_;
 
@@ -444,6 +478,30 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
   bool LookupEntryByIdFastPath(const std::string& tablet_id,
                                MetaCacheEntry* entry);
 
+  // Looks up the locations of all the tablets of 'table', and caches them.
+  // The tablets whose locations are cached already aren't looked up again,
+  // the others are fetched from the master kFetchTabletsPerRangeLookup at a
+  // time. Blocks until done, or until 'deadline' has passed.
+  Status PrefetchTableLocations(const KuduTable* table, const MonoTime& deadline);
+
+  // Sets 'tablet_pb' to the locations of the tablet of 'table' covering
+  // 'partition_key', and returns true, if they're cached and not stale.
+  bool GetTabletMetadata(const KuduTable* table,
+                         const PartitionKey& partition_key,
+                         TabletMetadataPB* tablet_pb);
+
+  // Caches the tablet locations in 'tablet_pb', unless the locations of a
+  // tablet covering the start of its partition are cached already.
+  Status AddTabletMetadata(const KuduTable* table, const TabletMetadataPB& tablet_pb);
+
+  // Writes the locations of the tablets of 'table' that are cached and not
+  // stale to 'locations_pb'.
+  void GetTableLocations(const KuduTable* table, TableLocationsPB* locations_pb);
+
+  // Caches the tablet locations in 'locations_pb' with AddTabletMetadata().
+  // Returns InvalidArgument if they're not for 'table'.
+  Status AddTableLocations(const KuduTable* table, const TableLocationsPB& locations_pb);
+
   // Process the response for the given key-based lookup parameters, indexing
   // the location information as appropriate.
   Status ProcessGetTableLocationsResponse(const KuduTable* table,
@@ -0,0 +1,252 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/parallel_scanner-internal.h"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/client/scan_batch.h"
+#include "kudu/client/scan_configuration.h"
+#include "kudu/client/scan_token-internal.h"
+#include "kudu/client/scanner-internal.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
+
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+namespace internal {
+
+namespace {
+
+// The amount of row data held by 'batch'.
+int64_t BatchBytes(const KuduScanBatch& batch) {
+  return batch.direct_data().size() + batch.indirect_data().size();
+}
+
+} // anonymous namespace
+
+ParallelScanner::ParallelScanner(KuduTable* table, ScanConfiguration* configuration)
+    : table_(table),
+      configuration_(configuration),
+      ordered_(configuration->is_fault_tolerant()),
+      cond_(&lock_),
+      buffered_bytes_(0),
+      buffered_batches_(0),
+      num_done_(0),
+      closing_(false),
+      next_tablet_(0) {
+}
+
+ParallelScanner::~ParallelScanner() {
+  Close();
+}
+
+Status ParallelScanner::Open() {
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  KuduScanTokenBuilder::Data builder(table_);
+  RETURN_NOT_OK(builder.Build(configuration_, &tokens));
+  for (auto* token : tokens) {
+    tokens_.emplace_back(token);
+  }
+  tokens.clear();
+  tablets_.resize(tokens_.size());
+  VLOG(2) << Substitute("Scanning $0 tablets of table $1, $2 at a time",
+                        tokens_.size(), table_->name(), configuration_->parallelism());
+
+  // The tokens' projection doesn't include the IS_DELETED column: the
+  // tablets' scanners add it when they're opened, like KuduScanner::Open().
+  if (configuration_->has_start_timestamp()) {
+    RETURN_NOT_OK(configuration_->AddIsDeletedColumn());
+  }
+
+  if (configuration_->read_mode() == KuduScanner::READ_AT_SNAPSHOT &&
+      !configuration_->has_snapshot_timestamp() &&
+      !tokens_.empty()) {
+    RETURN_NOT_OK(OpenTablet(0));
+    const ScanConfiguration& first = tablets_[0].scanner->data_->configuration();
+    CHECK(first.has_snapshot_timestamp());
+    configuration_->SetSnapshotRaw(first.snapshot_timestamp());
+  }
+
+  RETURN_NOT_OK(ThreadPoolBuilder("parallel-scan")
+                .set_max_threads(configuration_->parallelism())
+                .Build(&pool_));
+  // The pool runs the tasks in order, so the task of the tablet returned
+  // next in an ordered scan is never queued behind the later tablets'.
+  for (size_t i = 0; i < tokens_.size(); i++) {
+    RETURN_NOT_OK(pool_->Submit([this, i]() { this->ScanTablet(i); }));
+  }
+  return Status::OK();
+}
+
+bool ParallelScanner::HasMoreRows() const {
+  MutexLock l(lock_);
+  // If a tablet's scan failed, NextBatch() returns the error.
+  return !status_.ok() || buffered_batches_ > 0 || num_done_ < tablets_.size();
+}
+
+Status ParallelScanner::NextBatch(KuduScanBatch* batch) {
+  batch->data_->Clear();
+
+  unique_ptr<KuduScanBatch> next;
+  {
+    MutexLock l(lock_);
+    size_t idx;
+    while (status_.ok() && !FindBatch(&idx)) {
+      if (buffered_batches_ == 0 && num_done_ == tablets_.size()) {
+        return Status::OK();
+      }
+      cond_.Wait();
+    }
+    RETURN_NOT_OK(status_);
+
+    auto& batches = tablets_[idx].batches;
+    next = std::move(batches.front());
+    batches.pop_front();
+    buffered_bytes_ -= BatchBytes(*next);
+    buffered_batches_--;
+    cond_.Broadcast();
+  }
+
+  // The caller's batch takes over the buffered batch's data, and its own
+  // (empty) data is destroyed along with 'next'.
+  std::swap(batch->data_, next->data_);
+  return Status::OK();
+}
+
+void ParallelScanner::Close() {
+  {
+    MutexLock l(lock_);
+    closing_ = true;
+    cond_.Broadcast();
+  }
+  if (pool_) {
+    pool_->Shutdown();
+  }
+  for (auto& tablet : tablets_) {
+    if (tablet.scanner) {
+      tablet.scanner->Close();
+    }
+  }
+}
+
+Status ParallelScanner::OpenTablet(size_t idx) {
+  KuduScanner* scanner_raw;
+  RETURN_NOT_OK(tokens_[idx]->IntoKuduScanner(&scanner_raw));
+  unique_ptr<KuduScanner> scanner(scanner_raw);
+
+  // These aren't part of the token.
+  RETURN_NOT_OK(scanner->SetSelection(configuration_->selection()));
+  RETURN_NOT_OK(scanner->SetRowFormatFlags(configuration_->row_format_flags()));
+  RETURN_NOT_OK(scanner->SetCacheResults(configuration_->cache_results()));
+  if (configuration_->read_mode() == KuduScanner::READ_AT_SNAPSHOT &&
+      !configuration_->has_start_timestamp() &&
+      configuration_->has_snapshot_timestamp()) {
+    RETURN_NOT_OK(scanner->SetSnapshotRaw(configuration_->snapshot_timestamp()));
+  }
+
+  RETURN_NOT_OK(scanner->Open());
+  tablets_[idx].scanner = std::move(scanner);
+  return Status::OK();
+}
+
+void ParallelScanner::ScanTablet(size_t idx) {
+  TabletScan* tablet = &tablets_[idx];
+  Status s;
+  if (!tablet->scanner) {
+    s = OpenTablet(idx);
+  }
+
+  while (s.ok() && tablet->scanner->HasMoreRows()) {
+    {
+      MutexLock l(lock_);
+      while (!closing_ &&
+             buffered_bytes_ >= configuration_->parallel_scan_buffer_bytes() &&
+             !(ordered_ && idx == next_tablet_)) {
+        cond_.Wait();
+      }
+      if (closing_) {
+        break;
+      }
+    }
+
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch);
+    s = tablet->scanner->NextBatch(batch.get());
+    if (!s.ok() || batch->NumRows() == 0) {
+      continue;
+    }
+    MutexLock l(lock_);
+    buffered_bytes_ += BatchBytes(*batch);
+    buffered_batches_++;
+    tablet->batches.emplace_back(std::move(batch));
+    cond_.Broadcast();
+  }
+
+  // Release the tablet server's scanner right away if the scan was cut short.
+  if (tablet->scanner) {
+    tablet->scanner->Close();
+  }
+
+  MutexLock l(lock_);
+  if (!s.ok() && status_.ok()) {
+    status_ = s.CloneAndPrepend(
+        Substitute("scan of tablet $0 failed", tokens_[idx]->tablet().id()));
+  }
+  tablet->done = true;
+  num_done_++;
+  cond_.Broadcast();
+}
+
+bool ParallelScanner::FindBatch(size_t* idx) {
+  if (ordered_) {
+    while (next_tablet_ < tablets_.size() &&
+           tablets_[next_tablet_].done &&
+           tablets_[next_tablet_].batches.empty()) {
+      next_tablet_++;
+      // The next tablet's task may be waiting for room in the buffer.
+      cond_.Broadcast();
+    }
+    if (next_tablet_ == tablets_.size() || tablets_[next_tablet_].batches.empty()) {
+      return false;
+    }
+    *idx = next_tablet_;
+    return true;
+  }
+
+  for (size_t i = 0; i < tablets_.size(); i++) {
+    const size_t candidate = (next_tablet_ + i) % tablets_.size();
+    if (!tablets_[candidate].batches.empty()) {
+      *idx = candidate;
+      next_tablet_ = candidate + 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
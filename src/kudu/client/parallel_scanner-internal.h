@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ThreadPool;
+
+namespace client {
+
+class KuduScanBatch;
+class ScanConfiguration;
+
+namespace internal {
+
+// Scans the tablets of a KuduScanner's scan concurrently, one scan token
+// (and so one tablet) per task, and hands out the batches they buffer.
+//
+// The tasks run on a pool with one thread per tablet in flight. Each task
+// scans its tablet with a KuduScanner of its own, and queues the batches it
+// receives until NextBatch() takes them. Once the queued batches reach the
+// configured buffer budget, the tasks wait for the caller to catch up.
+//
+// In a fault-tolerant scan, batches are returned in the order a serial scan
+// would return them: all of the first tablet's batches, then the second
+// tablet's, etc. The task scanning the tablet being returned never waits for
+// the buffer, otherwise the later tablets could use up all of it first.
+//
+// This class is not thread-safe, in the same way KuduScanner isn't.
+class ParallelScanner {
+ public:
+  // 'table' and 'configuration' are the scanner's. They must outlive this
+  // object.
+  ParallelScanner(KuduTable* table, ScanConfiguration* configuration);
+  ~ParallelScanner();
+
+  // Splits the scan into tablets and starts scanning them. Adds the
+  // IS_DELETED column to 'configuration' for diff scans, as the tablets'
+  // scanners do.
+  //
+  // A READ_AT_SNAPSHOT scan without a snapshot timestamp opens the first
+  // tablet before returning, so that the others can be scanned at the
+  // snapshot timestamp picked for it. That timestamp is also set in
+  // 'configuration'.
+  Status Open();
+
+  // Whether there may be more rows to return.
+  bool HasMoreRows() const;
+
+  // Waits for a batch to be available, and swaps it into 'batch'. Leaves
+  // 'batch' empty if there are no more rows. Returns the first error
+  // encountered by any of the tablets' scans.
+  //
+  // The rows of 'batch' remain valid until this object is destroyed.
+  Status NextBatch(KuduScanBatch* batch);
+
+  // Stops and closes the tablets' scans. The rows returned remain valid.
+  void Close();
+
+ private:
+  struct TabletScan {
+    // The scanner for the tablet, created once its scan starts. Kept until
+    // this object is destroyed: the batches returned refer to its projection.
+    // Only used by the tablet's task, or with no tasks running.
+    std::unique_ptr<KuduScanner> scanner;
+
+    // The batches received but not yet returned.
+    std::deque<std::unique_ptr<KuduScanBatch>> batches;
+
+    // Whether the tablet's scan has completed, successfully or not.
+    bool done = false;
+  };
+
+  // Creates the scanner for the token of the tablet at 'idx', and opens it.
+  Status OpenTablet(size_t idx);
+
+  // Scans the tablet at 'idx' to completion. Run on 'pool_'.
+  void ScanTablet(size_t idx);
+
+  // Sets 'idx' to a tablet with a batch to return, and returns true, if
+  // there's one. Must be called with 'lock_' held.
+  bool FindBatch(size_t* idx);
+
+  KuduTable* const table_;
+  ScanConfiguration* const configuration_;
+  const bool ordered_;
+
+  std::vector<std::unique_ptr<KuduScanToken>> tokens_;
+  std::unique_ptr<ThreadPool> pool_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // Protected by 'lock_'.
+  std::vector<TabletScan> tablets_;
+  int64_t buffered_bytes_;
+  size_t buffered_batches_;
+  size_t num_done_;
+  bool closing_;
+  Status status_;
+
+  // For ordered scans, the tablet whose batches are being returned. For
+  // unordered ones, the tablet to look at first for the next batch, so that
+  // no tablet is starved. Protected by 'lock_'.
+  size_t next_tablet_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScanner);
+};
+
+} // namespace internal
+} // namespace client
+} // namespace kudu
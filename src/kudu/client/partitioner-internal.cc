@@ -17,21 +17,35 @@
 
 #include "kudu/client/partitioner-internal.h"
 
+#include <cstdint>
+#include <cstring>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/client.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/schema.h"
 #include "kudu/client/table-internal.h"
+#include "kudu/client/write_op-internal.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/async_util.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace client {
@@ -76,6 +90,130 @@ Status KuduPartitionerBuilder::Data::Build(KuduPartitioner** partitioner) {
   return Status::OK();
 }
 
+namespace {
+
+// A column of a partition key, in a columnar batch.
+struct KeyColumn {
+  const TypeInfo* type_info;
+  const KeyEncoder<string>* encoder;
+  bool is_varlen;
+  // The values, or the offsets of the values in 'varlen_data' if is_varlen.
+  Slice data;
+  Slice varlen_data;
+};
+
+// Encodes the cells of 'row' in 'columns' into 'buf', like
+// PartitionSchema::EncodeColumns() does with the cells of a KuduPartialRow.
+void EncodeCells(const vector<const KeyColumn*>& columns, int row, string* buf) {
+  for (int i = 0; i < columns.size(); i++) {
+    const KeyColumn& column = *columns[i];
+    const bool is_last = i + 1 == columns.size();
+    if (column.is_varlen) {
+      const uint8_t* offsets = column.data.data() + row * sizeof(uint32_t);
+      const uint32_t start = UnalignedLoad<uint32_t>(offsets);
+      const uint32_t end = UnalignedLoad<uint32_t>(offsets + sizeof(uint32_t));
+      const Slice cell(column.varlen_data.data() + start, end - start);
+      column.encoder->Encode(&cell, is_last, buf);
+    } else {
+      // The cells of the batch may not be aligned.
+      alignas(kLargestTypeSize) uint8_t cell[kLargestTypeSize];
+      const size_t size = column.type_info->size();
+      memcpy(cell, column.data.data() + row * size, size);
+      column.encoder->Encode(cell, is_last, buf);
+    }
+  }
+}
+
+} // anonymous namespace
+
+Status KuduPartitioner::Data::PartitionColumnarBatch(
+    const KuduColumnarInsertBatch::Data& batch, vector<int>* partitions) {
+  if (PREDICT_FALSE(batch.table_->id() != table_->id())) {
+    return Status::InvalidArgument(Substitute(
+        "batch of table $0 can't be partitioned by the partitioner of table $1",
+        batch.table_->name(), table_->name()));
+  }
+  const Schema* schema = table_->schema().schema_;
+  const PartitionSchema& partition_schema = table_->data_->partition_schema_;
+
+  // The columns of the partition key, found once for the whole batch.
+  unordered_map<ColumnId, KeyColumn> key_columns;
+  const auto find_columns = [&](const vector<ColumnId>& column_ids,
+                                vector<const KeyColumn*>* columns) -> Status {
+    for (ColumnId column_id : column_ids) {
+      auto it = key_columns.find(column_id);
+      if (it == key_columns.end()) {
+        const int col_idx = schema->find_column_by_id(column_id);
+        CHECK_NE(Schema::kColumnNotFound, col_idx);
+        const auto& values = batch.column(col_idx);
+        if (PREDICT_FALSE(!values.is_set)) {
+          return Status::InvalidArgument(Substitute(
+              "partition key column '$0' not set in columnar batch",
+              schema->column(col_idx).name()));
+        }
+        const TypeInfo* type_info = schema->column(col_idx).type_info();
+        it = key_columns.emplace(column_id, KeyColumn{
+            type_info, &GetKeyEncoder<string>(type_info), values.is_varlen,
+            values.data, values.varlen_data }).first;
+      }
+      columns->push_back(&it->second);
+    }
+    return Status::OK();
+  };
+  vector<const KeyColumn*> range_columns;
+  RETURN_NOT_OK(find_columns(partition_schema.range_schema().column_ids, &range_columns));
+
+  // The hash dimensions of the hash schemas used by the rows, with their
+  // columns: the table-wide one, or those of ranges with custom hash schemas.
+  typedef vector<std::pair<const PartitionSchema::HashDimension*,
+                           vector<const KeyColumn*>>> HashDimensionColumns;
+  unordered_map<const PartitionSchema::HashSchema*, HashDimensionColumns> hash_schemas;
+  const auto& hash_encoder = GetKeyEncoder<string>(GetTypeInfo(UINT32));
+
+  // The partition keys are encoded into the same buffers, row after row. Rows
+  // of the same partition often come in runs, for which the lookup of the
+  // partition is skipped.
+  partitions->resize(batch.num_rows_);
+  PartitionKey key;
+  string* range_key = key.mutable_range_key();
+  string* hash_key = key.mutable_hash_key();
+  string hash_columns;
+  auto partition = partitions_by_start_key_.end();
+  auto next_partition = partitions_by_start_key_.end();
+  for (int row = 0; row < batch.num_rows_; row++) {
+    range_key->clear();
+    EncodeCells(range_columns, row, range_key);
+
+    const auto& hash_schema = partition_schema.GetHashSchemaForRange(*range_key);
+    auto hash_it = hash_schemas.find(&hash_schema);
+    if (PREDICT_FALSE(hash_it == hash_schemas.end())) {
+      HashDimensionColumns dimensions;
+      for (const auto& hash_dimension : hash_schema) {
+        vector<const KeyColumn*> columns;
+        RETURN_NOT_OK(find_columns(hash_dimension.column_ids, &columns));
+        dimensions.emplace_back(&hash_dimension, std::move(columns));
+      }
+      hash_it = hash_schemas.emplace(&hash_schema, std::move(dimensions)).first;
+    }
+    hash_key->clear();
+    for (const auto& dimension : hash_it->second) {
+      hash_columns.clear();
+      EncodeCells(dimension.second, row, &hash_columns);
+      const uint32_t bucket =
+          PartitionSchema::HashValueForEncodedColumns(hash_columns, *dimension.first);
+      hash_encoder.Encode(&bucket, hash_key);
+    }
+
+    if (partition == partitions_by_start_key_.end() || key < partition->first ||
+        (next_partition != partitions_by_start_key_.end() && !(key < next_partition->first))) {
+      next_partition = partitions_by_start_key_.upper_bound(key);
+      partition = std::prev(next_partition);
+    }
+    (*partitions)[row] = partition->second;
+  }
+  return Status::OK();
+}
+
 Status KuduPartitioner::Data::PartitionRow(
     const KuduPartialRow& row, int* partition) {
   auto partition_key = table_->data_->partition_schema_.EncodeKey(row);
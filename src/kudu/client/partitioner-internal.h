@@ -19,9 +19,11 @@
 #include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "kudu/client/client.h"
 #include "kudu/client/shared_ptr.h" // IWYU pragma: keep
+#include "kudu/client/write_op.h"
 #include "kudu/common/partition.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
@@ -68,6 +70,9 @@ class KuduPartitioner::Data {
  public:
   Status PartitionRow(const KuduPartialRow& row, int* partition);
 
+  Status PartitionColumnarBatch(const KuduColumnarInsertBatch::Data& batch,
+                                std::vector<int>* partitions);
+
   sp::shared_ptr<KuduTable> table_;
   std::map<PartitionKey, int> partitions_by_start_key_;
   int num_partitions_ = 0;
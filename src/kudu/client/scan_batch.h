@@ -48,6 +48,10 @@ class TableScanner;
 namespace client {
 class KuduSchema;
 
+namespace internal {
+class ParallelScanner;
+} // namespace internal
+
 /// @brief A batch of zero or more rows returned by a scan operation.
 ///
 /// Every call to KuduScanner::NextBatch() returns a batch of zero or more rows.
@@ -154,6 +158,7 @@ class KUDU_EXPORT KuduScanBatch {
  private:
   class KUDU_NO_EXPORT Data;
   friend class KuduScanner;
+  friend class internal::ParallelScanner;
   friend class tools::ReplicaDumper;
 
   Data* data_;
@@ -30,7 +30,9 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
+#include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/strings/substitute.h"
 
 namespace kudu {
@@ -47,6 +49,7 @@ namespace client {
 const uint64_t ScanConfiguration::kNoTimestamp = KuduClient::kNoTimestamp;
 const int ScanConfiguration::kHtTimestampBitsToShift = 12;
 const char* ScanConfiguration::kDefaultIsDeletedColName = "is_deleted";
+const int64_t ScanConfiguration::kDefaultParallelScanBufferBytes = 64 * 1024 * 1024;
 
 ScanConfiguration::ScanConfiguration(KuduTable* table)
     : table_(table),
@@ -62,7 +65,10 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       lower_bound_propagation_timestamp_(kNoTimestamp),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(256),
-      row_format_flags_(KuduScanner::NO_FLAGS) {
+      row_format_flags_(KuduScanner::NO_FLAGS),
+      parallelism_(1),
+      parallel_scan_buffer_bytes_(kDefaultParallelScanBufferBytes),
+      cache_results_(false) {
 }
 
 Status ScanConfiguration::SetProjectedColumnNames(const vector<string>& col_names) {
@@ -105,6 +111,34 @@ void ScanConfiguration::AddConjunctPredicate(ColumnPredicate pred) {
   spec_.AddPredicate(std::move(pred));
 }
 
+Status ScanConfiguration::AddRuntimeFilter(unique_ptr<KuduPredicate> pred,
+                                           vector<ColumnPredicatePB>* filters) {
+  // Take ownership even if returning non-OK status.
+  auto* pred_raw_ptr = pred.get();
+  predicates_pool_.emplace_back(std::move(pred));
+
+  ScanSpec spec;
+  RETURN_NOT_OK(pred_raw_ptr->data_->AddToScanSpec(&spec, &arena_));
+  for (const auto& name_and_pred : spec.predicates()) {
+    if (projection_->find_column(name_and_pred.first) == Schema::kColumnNotFound) {
+      return Status::InvalidArgument(strings::Substitute(
+          "runtime filter on column $0 which is not projected", name_and_pred.first));
+    }
+  }
+  for (const auto& name_and_pred : spec.predicates()) {
+    const ColumnPredicate& p = name_and_pred.second;
+    filters->emplace_back();
+    if (p.predicate_type() == PredicateType::None) {
+      // Matches no rows, as an empty IN list does once parsed.
+      filters->back().set_column(p.column().name());
+      filters->back().mutable_in_list();
+    } else {
+      ColumnPredicateToPB(p, &filters->back());
+    }
+  }
+  return pred_raw_ptr->data_->AddToScanSpec(&spec_, &arena_);
+}
+
 Status ScanConfiguration::AddLowerBound(const KuduPartialRow& key) {
   string encoded;
   RETURN_NOT_OK(key.EncodeRowKey(&encoded));
@@ -220,6 +254,26 @@ Status ScanConfiguration::SetLimit(int64_t limit) {
   return Status::OK();
 }
 
+Status ScanConfiguration::SetParallelism(int parallelism) {
+  if (parallelism < 1) {
+    return Status::InvalidArgument("Parallelism must be positive");
+  }
+  parallelism_ = parallelism;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetParallelScanBufferBytes(int64_t buffer_bytes) {
+  if (buffer_bytes <= 0) {
+    return Status::InvalidArgument("Parallel scan buffer size must be positive");
+  }
+  parallel_scan_buffer_bytes_ = buffer_bytes;
+  return Status::OK();
+}
+
+void ScanConfiguration::SetCacheResults(bool cache_results) {
+  cache_results_ = cache_results;
+}
+
 Status ScanConfiguration::AddIsDeletedColumn() {
   CHECK(has_start_timestamp());
   CHECK(has_snapshot_timestamp());
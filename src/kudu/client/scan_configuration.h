@@ -39,6 +39,7 @@
 namespace kudu {
 
 class ColumnPredicate;
+class ColumnPredicatePB;
 class KuduPartialRow;
 class PartitionKey;
 
@@ -61,6 +62,12 @@ class ScanConfiguration {
 
   void AddConjunctPredicate(ColumnPredicate pred);
 
+  // Adds 'pred' like AddConjunctPredicate(), and appends the column
+  // predicates it's made of to 'filters', to be sent as the runtime filters
+  // of a scan in progress. 'pred' may only be on a projected column.
+  Status AddRuntimeFilter(std::unique_ptr<KuduPredicate> pred,
+                          std::vector<ColumnPredicatePB>* filters) WARN_UNUSED_RESULT;
+
   Status AddLowerBound(const KuduPartialRow& key);
 
   Status AddUpperBound(const KuduPartialRow& key);
@@ -99,6 +106,12 @@ class ScanConfiguration {
 
   Status SetLimit(int64_t limit);
 
+  Status SetParallelism(int parallelism);
+
+  Status SetParallelScanBufferBytes(int64_t buffer_bytes);
+
+  void SetCacheResults(bool cache_results);
+
   // Adds an IS_DELETED virtual column to the projection.
   //
   // Can only be used with diff scans.
@@ -184,6 +197,18 @@ class ScanConfiguration {
     return row_format_flags_;
   }
 
+  int parallelism() const {
+    return parallelism_;
+  }
+
+  int64_t parallel_scan_buffer_bytes() const {
+    return parallel_scan_buffer_bytes_;
+  }
+
+  bool cache_results() const {
+    return cache_results_;
+  }
+
   Arena* arena() {
     return &arena_;
   }
@@ -192,6 +217,7 @@ class ScanConfiguration {
   friend class KuduScanTokenBuilder;
 
   static const uint64_t kNoTimestamp;
+  static const int64_t kDefaultParallelScanBufferBytes;
   static const int kHtTimestampBitsToShift;
   static const char* kDefaultIsDeletedColName;
 
@@ -237,6 +263,15 @@ class ScanConfiguration {
   std::deque<std::unique_ptr<KuduPredicate>> predicates_pool_;
 
   uint64_t row_format_flags_;
+
+  // The number of tablets scanned concurrently, and the amount of row data
+  // they may buffer ahead of the caller. See KuduScanner::SetParallelism().
+  int parallelism_;
+  int64_t parallel_scan_buffer_bytes_;
+
+  // Whether the client caches the tablets' results to serve repeated scans.
+  // See KuduScanner::SetCacheResults().
+  bool cache_results_;
 };
 
 } // namespace client
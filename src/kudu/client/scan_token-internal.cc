@@ -18,15 +18,18 @@
 #include "kudu/client/scan_token-internal.h"
 
 #include <cstdint>
+#include <iterator>
 #include <map>
 #include <memory>
 #include <ostream>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <google/protobuf/stubs/common.h>
 #include <google/protobuf/stubs/port.h>
@@ -40,6 +43,7 @@
 #include "kudu/client/shared_ptr.h" // IWYU pragma: keep
 #include "kudu/client/tablet-internal.h"
 #include "kudu/client/tablet_server-internal.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partition.h"
@@ -53,15 +57,21 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
+#include "kudu/rpc/rpc_controller.h"
 #include "kudu/security/token.pb.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
+DECLARE_bool(client_scan_trim_in_list_predicates);
+
 using std::string;
 using std::map;
+using std::set;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
@@ -69,17 +79,15 @@ using strings::Substitute;
 namespace kudu {
 
 class ColumnPredicate;
-using master::GetTableLocationsResponsePB;
 using master::TableIdentifierPB;
-using master::TabletLocationsPB;
-using master::TSInfoPB;
+using rpc::RpcController;
 using security::SignedTokenPB;
+using tserver::SplitKeyRangeRequestPB;
+using tserver::SplitKeyRangeResponsePB;
 
 namespace client {
 
 using internal::MetaCache;
-using internal::MetaCacheEntry;
-using internal::RemoteReplica;
 using internal::RemoteTabletServer;
 
 KuduScanToken::Data::Data(KuduTable* table,
@@ -150,48 +158,8 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
 
   // Prime the client tablet location cache if no entry is already present.
   if (message.has_tablet_metadata()) {
-    const TabletMetadataPB& tablet_metadata = message.tablet_metadata();
-    Partition partition;
-    Partition::FromPB(tablet_metadata.partition(), &partition);
-    MetaCacheEntry entry;
-    if (!client->data_->meta_cache_->LookupEntryByKeyFastPath(table.get(),
-        partition.begin(), &entry)) {
-      // Generate a fake GetTableLocationsResponsePB to pass to the client
-      // meta cache in order to "inject" the tablet metadata into the client.
-      GetTableLocationsResponsePB mock_resp;
-      mock_resp.set_ttl_millis(tablet_metadata.ttl_millis());
-
-      // Populate the locations.
-      TabletLocationsPB locations_pb;
-      locations_pb.set_tablet_id(tablet_metadata.tablet_id());
-      PartitionPB partition_pb;
-      partition.ToPB(&partition_pb);
-      *locations_pb.mutable_partition() = std::move(partition_pb);
-      for (const TabletMetadataPB::ReplicaMetadataPB& replica_meta : tablet_metadata.replicas()) {
-        TabletLocationsPB::InternedReplicaPB replica_pb;
-        replica_pb.set_ts_info_idx(replica_meta.ts_idx());
-        replica_pb.set_role(replica_meta.role());
-        if (replica_meta.has_dimension_label()) {
-          replica_pb.set_dimension_label(replica_meta.dimension_label());
-        }
-        *locations_pb.add_interned_replicas() = std::move(replica_pb);
-      }
-      *mock_resp.add_tablet_locations() = std::move(locations_pb);
-
-      // Populate the servers.
-      for (const ServerMetadataPB& server_meta : tablet_metadata.tablet_servers()) {
-        TSInfoPB server_pb;
-        server_pb.set_permanent_uuid(server_meta.uuid());
-        server_pb.set_location(server_meta.location());
-        for (const HostPortPB& host_port :server_meta.rpc_addresses()) {
-          *server_pb.add_rpc_addresses() = host_port;
-        }
-        *mock_resp.add_ts_infos() = std::move(server_pb);
-      }
-
-      client->data_->meta_cache_->ProcessGetTableLocationsResponse(
-          table.get(), partition.begin(), true, mock_resp, &entry, 1);
-    }
+    RETURN_NOT_OK(client->data_->meta_cache_->AddTabletMetadata(
+        table.get(), message.tablet_metadata()));
   }
 
   if (message.has_authz_token()) {
@@ -310,6 +278,14 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
     scan_builder->SetTimeoutMillis(message.scan_request_timeout_ms());
   }
 
+  if (message.has_resume_after_primary_key()) {
+    // Only fault-tolerant scans are ordered by primary key.
+    if (!message.fault_tolerant()) {
+      return Status::InvalidArgument("only fault-tolerant scans can be resumed");
+    }
+    scan_builder->data_->last_primary_key_ = message.resume_after_primary_key();
+  }
+
   *scanner = scan_builder.release();
   return Status::OK();
 }
@@ -319,17 +295,16 @@ KuduScanTokenBuilder::Data::Data(KuduTable* table)
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
-  KuduTable* table = configuration_.table_;
-  KuduClient* client = table->client();
-  configuration_.OptimizeScanSpec();
-
-  if (configuration_.spec().CanShortCircuit()) {
-    return Status::OK();
-  }
+  return Build(&configuration_, tokens);
+}
 
-  ScanTokenPB pb;
+Status KuduScanTokenBuilder::Data::ConfigurationToPB(const ScanConfiguration& configuration,
+                                                     bool include_table_metadata,
+                                                     ScanTokenPB* pb) {
+  const KuduTable* table = configuration.table_;
+  KuduClient* client = table->client();
 
-  if (include_table_metadata_) {
+  if (include_table_metadata) {
     // Set the table metadata so that a call to the master is not needed when
     // deserializing the token into a scanner.
     TableMetadataPB table_pb;
@@ -347,74 +322,74 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
     table_pb.mutable_partition_schema()->CopyFrom(partition_schema_pb);
     table_pb.mutable_extra_configs()->insert(table->extra_configs().begin(),
                                              table->extra_configs().end());
-    *pb.mutable_table_metadata() = std::move(table_pb);
+    *pb->mutable_table_metadata() = std::move(table_pb);
 
     // Only include the authz token if the table metadata is included.
     // It is returned in the required GetTableSchema request otherwise.
     SignedTokenPB authz_token;
     bool found_authz_token = client->data_->FetchCachedAuthzToken(table->id(), &authz_token);
     if (found_authz_token) {
-      *pb.mutable_authz_token() = std::move(authz_token);
+      *pb->mutable_authz_token() = std::move(authz_token);
     }
   } else {
     // If we add the table metadata, we don't need to set the old table id
     // and table name. It is expected that the creation and use of a scan token
     // will be on the same or compatible versions.
-    pb.set_table_id(table->id());
-    pb.set_table_name(table->name());
+    pb->set_table_id(table->id());
+    pb->set_table_name(table->name());
   }
 
-  if (include_table_metadata_) {
-    for (const ColumnSchema& col : configuration_.projection()->columns()) {
+  if (include_table_metadata) {
+    for (const ColumnSchema& col : configuration.projection()->columns()) {
       int column_idx;
       table->schema().schema_->FindColumn(col.name(), &column_idx);
-      pb.mutable_projected_column_idx()->Add(column_idx);
+      pb->mutable_projected_column_idx()->Add(column_idx);
     }
   } else {
-    RETURN_NOT_OK(SchemaToColumnPBs(*configuration_.projection(), pb.mutable_projected_columns(),
+    RETURN_NOT_OK(SchemaToColumnPBs(*configuration.projection(), pb->mutable_projected_columns(),
         SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
   }
 
-  if (configuration_.spec().lower_bound_key()) {
-    pb.mutable_lower_bound_primary_key()->assign(
-      reinterpret_cast<const char*>(configuration_.spec().lower_bound_key()->encoded_key().data()),
-      configuration_.spec().lower_bound_key()->encoded_key().size());
+  if (configuration.spec().lower_bound_key()) {
+    pb->mutable_lower_bound_primary_key()->assign(
+      reinterpret_cast<const char*>(configuration.spec().lower_bound_key()->encoded_key().data()),
+      configuration.spec().lower_bound_key()->encoded_key().size());
   } else {
-    pb.clear_lower_bound_primary_key();
+    pb->clear_lower_bound_primary_key();
   }
-  if (configuration_.spec().exclusive_upper_bound_key()) {
-    pb.mutable_upper_bound_primary_key()->assign(reinterpret_cast<const char*>(
-          configuration_.spec().exclusive_upper_bound_key()->encoded_key().data()),
-      configuration_.spec().exclusive_upper_bound_key()->encoded_key().size());
+  if (configuration.spec().exclusive_upper_bound_key()) {
+    pb->mutable_upper_bound_primary_key()->assign(reinterpret_cast<const char*>(
+          configuration.spec().exclusive_upper_bound_key()->encoded_key().data()),
+      configuration.spec().exclusive_upper_bound_key()->encoded_key().size());
   } else {
-    pb.clear_upper_bound_primary_key();
+    pb->clear_upper_bound_primary_key();
   }
 
-  for (const auto& predicate_pair : configuration_.spec().predicates()) {
-    ColumnPredicateToPB(predicate_pair.second, pb.add_column_predicates());
+  for (const auto& predicate_pair : configuration.spec().predicates()) {
+    ColumnPredicateToPB(predicate_pair.second, pb->add_column_predicates());
   }
 
-  const KuduScanner::ReadMode read_mode = configuration_.read_mode();
+  const KuduScanner::ReadMode read_mode = configuration.read_mode();
   switch (read_mode) {
     case KuduScanner::READ_LATEST:
-      pb.set_read_mode(kudu::READ_LATEST);
-      if (configuration_.has_snapshot_timestamp()) {
+      pb->set_read_mode(kudu::READ_LATEST);
+      if (configuration.has_snapshot_timestamp()) {
         return Status::InvalidArgument("Snapshot timestamp should only be configured "
                                        "for READ_AT_SNAPSHOT scan mode.");
       }
       break;
     case KuduScanner::READ_AT_SNAPSHOT:
-      pb.set_read_mode(kudu::READ_AT_SNAPSHOT);
-      if (configuration_.has_start_timestamp()) {
-        pb.set_snap_start_timestamp(configuration_.start_timestamp());
+      pb->set_read_mode(kudu::READ_AT_SNAPSHOT);
+      if (configuration.has_start_timestamp()) {
+        pb->set_snap_start_timestamp(configuration.start_timestamp());
       }
-      if (configuration_.has_snapshot_timestamp()) {
-        pb.set_snap_timestamp(configuration_.snapshot_timestamp());
+      if (configuration.has_snapshot_timestamp()) {
+        pb->set_snap_timestamp(configuration.snapshot_timestamp());
       }
       break;
     case KuduScanner::READ_YOUR_WRITES:
-      pb.set_read_mode(kudu::READ_YOUR_WRITES);
-      if (configuration_.has_snapshot_timestamp()) {
+      pb->set_read_mode(kudu::READ_YOUR_WRITES);
+      if (configuration.has_snapshot_timestamp()) {
         return Status::InvalidArgument("Snapshot timestamp should only be configured "
                                        "for READ_AT_SNAPSHOT scan mode.");
       }
@@ -423,19 +398,35 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       LOG(FATAL) << Substitute("$0: unexpected read mode", read_mode);
   }
 
-  pb.set_cache_blocks(configuration_.spec().cache_blocks());
-  pb.set_fault_tolerant(configuration_.is_fault_tolerant());
-  pb.set_propagated_timestamp(client->GetLatestObservedTimestamp());
-  pb.set_scan_request_timeout_ms(configuration_.timeout().ToMilliseconds());
+  pb->set_cache_blocks(configuration.spec().cache_blocks());
+  pb->set_fault_tolerant(configuration.is_fault_tolerant());
+  pb->set_propagated_timestamp(client->GetLatestObservedTimestamp());
+  pb->set_scan_request_timeout_ms(configuration.timeout().ToMilliseconds());
+
+  if (configuration.has_batch_size_bytes()) {
+    pb->set_batch_size_bytes(configuration.batch_size_bytes());
+  }
+  return Status::OK();
+}
+
+Status KuduScanTokenBuilder::Data::Build(ScanConfiguration* configuration,
+                                         vector<KuduScanToken*>* tokens) {
+  KuduTable* table = configuration->table_;
+  KuduClient* client = table->client();
+  configuration->OptimizeScanSpec();
 
-  if (configuration_.has_batch_size_bytes()) {
-    pb.set_batch_size_bytes(configuration_.batch_size_bytes());
+  if (configuration->spec().CanShortCircuit()) {
+    return Status::OK();
   }
 
+  ScanTokenPB pb;
+  RETURN_NOT_OK(ConfigurationToPB(*configuration, include_table_metadata_, &pb));
+
   MonoTime deadline = MonoTime::Now() + client->default_admin_operation_timeout();
 
+  vector<TabletTokens> tablets;
   PartitionPruner pruner;
-  pruner.Init(*table->schema().schema_, table->partition_schema(), configuration_.spec());
+  pruner.Init(*table->schema().schema_, table->partition_schema(), configuration->spec());
   while (pruner.HasMorePartitionKeyRanges()) {
     scoped_refptr<internal::RemoteTablet> tablet;
     Synchronizer sync;
@@ -463,103 +454,213 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       continue;
     }
 
-    vector<internal::RemoteReplica> replicas;
-    tablet->GetRemoteReplicas(&replicas);
-
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
-      }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0],
-                                                    r.ts->location());
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
-    }
-
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
-
-    // Create the scan token itself.
+    // Create the scan token's message.
     ScanTokenPB message;
     message.CopyFrom(pb);
     message.set_lower_bound_partition_key(tablet->partition().begin().ToString());
     message.set_upper_bound_partition_key(tablet->partition().end().ToString());
+    if (FLAGS_client_scan_trim_in_list_predicates) {
+      message.clear_column_predicates();
+      for (const auto& predicate_pair : configuration->spec().predicates()) {
+        ColumnPredicateToPB(PartitionPruner::TrimInListForPartition(*table->schema().schema_,
+                                                                    table->partition_schema(),
+                                                                    tablet->partition(),
+                                                                    configuration->spec(),
+                                                                    predicate_pair.second),
+                            message.add_column_predicates());
+      }
+    }
 
     // Set the tablet metadata so that a call to the master is not needed to
     // locate the tablet to scan when opening the scanner.
     if (include_tablet_metadata_) {
-      internal::MetaCacheEntry entry;
-      if (client->data_->meta_cache_->LookupEntryByKeyFastPath(table,
-          tablet->partition().begin(), &entry)) {
-        if (!entry.is_non_covered_range() && !entry.stale()) {
-          TabletMetadataPB tablet_pb;
-          tablet_pb.set_tablet_id(entry.tablet()->tablet_id());
-          PartitionPB partition_pb;
-          entry.tablet()->partition().ToPB(&partition_pb);
-          *tablet_pb.mutable_partition() = std::move(partition_pb);
-          MonoDelta ttl = entry.expiration_time() - MonoTime::Now();
-          tablet_pb.set_ttl_millis(ttl.ToMilliseconds());
-
-          // Build the list of server metadata.
-          vector<RemoteTabletServer*> servers;
-          map<string, int> server_index_map;
-          entry.tablet()->GetRemoteTabletServers(&servers);
-          for (int i = 0; i < servers.size(); i++) {
-            RemoteTabletServer* server = servers[i];
-            ServerMetadataPB server_pb;
-            server_pb.set_uuid(server->permanent_uuid());
-            server_pb.set_location(server->location());
-            vector<HostPort> host_ports;
-            server->GetHostPorts(&host_ports);
-            for (const HostPort& host_port : host_ports) {
-              *server_pb.add_rpc_addresses() = HostPortToPB(host_port);
-              server_index_map[host_port.ToString()] = i;
-            }
-            *tablet_pb.add_tablet_servers() = std::move(server_pb);
-          }
-
-          // Build the list of replica metadata.
-          vector<RemoteReplica> replicas;
-          entry.tablet()->GetRemoteReplicas(&replicas);
-          for (const RemoteReplica& replica : replicas) {
-            vector<HostPort> host_ports;
-            replica.ts->GetHostPorts(&host_ports);
-            int server_index = server_index_map[host_ports[0].ToString()];
-            TabletMetadataPB::ReplicaMetadataPB replica_pb;
-            replica_pb.set_role(replica.role);
-            replica_pb.set_ts_idx(server_index);
-            *tablet_pb.add_replicas() = std::move(replica_pb);
-          }
-
-          *message.mutable_tablet_metadata() = std::move(tablet_pb);
-        }
+      TabletMetadataPB tablet_pb;
+      if (client->data_->meta_cache_->GetTabletMetadata(
+              table, tablet->partition().begin(), &tablet_pb)) {
+        *message.mutable_tablet_metadata() = std::move(tablet_pb);
       }
     }
 
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+    tablets.emplace_back();
+    tablets.back().tablet = tablet;
+    tablets.back().message = std::move(message);
     pruner.RemovePartitionKeyRange(tablet->partition().end());
   }
+
+  if (split_size_bytes_ > 0) {
+    RETURN_NOT_OK(SplitKeyRanges(
+        client, *configuration, pb, split_size_bytes_, deadline, &tablets));
+  }
+
+  for (auto& t : tablets) {
+    if (t.key_ranges.empty()) {
+      RETURN_NOT_OK(AddToken(table, *t.tablet.get(), std::move(t.message), tokens));
+      continue;
+    }
+    for (const auto& range : t.key_ranges) {
+      ScanTokenPB message;
+      message.CopyFrom(t.message);
+      if (range.has_start_primary_key()) {
+        message.set_lower_bound_primary_key(range.start_primary_key());
+      }
+      if (range.has_stop_primary_key()) {
+        message.set_upper_bound_primary_key(range.stop_primary_key());
+      }
+      RETURN_NOT_OK(AddToken(table, *t.tablet.get(), std::move(message), tokens));
+    }
+  }
+  return Status::OK();
+}
+
+// The SplitKeyRange RPC splitting a tablet.
+struct KuduScanTokenBuilder::Data::SplitKeyRangeRpc {
+  SplitKeyRangeRequestPB req;
+  SplitKeyRangeResponsePB resp;
+  RpcController controller;
+  Synchronizer sync;
+
+  // The tablet server the RPC was last sent to, and the ones it failed on.
+  RemoteTabletServer* ts = nullptr;
+  set<string> blacklist;
+};
+
+Status KuduScanTokenBuilder::Data::SendSplitKeyRangeRpc(
+    KuduClient* client,
+    const scoped_refptr<internal::RemoteTablet>& tablet,
+    KuduClient::ReplicaSelection selection,
+    const MonoTime& deadline,
+    SplitKeyRangeRpc* rpc) {
+  vector<RemoteTabletServer*> candidates;
+  RETURN_NOT_OK(client->data_->GetTabletServer(
+      client, tablet, selection, rpc->blacklist, &candidates, &rpc->ts));
+  rpc->resp.Clear();
+  rpc->controller.Reset();
+  rpc->controller.set_deadline(deadline);
+  rpc->sync.Reset();
+  rpc->ts->proxy()->SplitKeyRangeAsync(rpc->req, &rpc->resp, &rpc->controller, [rpc]() {
+    Status s = rpc->controller.status();
+    if (s.ok() && rpc->resp.has_error()) {
+      s = StatusFromPB(rpc->resp.error().status());
+    }
+    rpc->sync.StatusCB(s);
+  });
+  return Status::OK();
+}
+
+Status KuduScanTokenBuilder::Data::SplitKeyRanges(KuduClient* client,
+                                                  const ScanConfiguration& configuration,
+                                                  const ScanTokenPB& pb,
+                                                  uint64_t split_size_bytes,
+                                                  const MonoTime& deadline,
+                                                  vector<TabletTokens>* tablets) {
+  const KuduTable* table = configuration.table_;
+  SplitKeyRangeRequestPB req;
+  if (pb.has_lower_bound_primary_key()) {
+    req.set_start_primary_key(pb.lower_bound_primary_key());
+  }
+  if (pb.has_upper_bound_primary_key()) {
+    req.set_stop_primary_key(pb.upper_bound_primary_key());
+  }
+  req.set_target_chunk_size_bytes(split_size_bytes);
+  RETURN_NOT_OK(SchemaToColumnPBs(*configuration.projection(), req.mutable_columns(),
+                                  SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+  SignedTokenPB authz_token;
+  if (client->data_->FetchCachedAuthzToken(table->id(), &authz_token) ||
+      (client->data_->RetrieveAuthzToken(table, deadline).ok() &&
+       client->data_->FetchCachedAuthzToken(table->id(), &authz_token))) {
+    *req.mutable_authz_token() = std::move(authz_token);
+  }
+
+  vector<unique_ptr<SplitKeyRangeRpc>> rpcs;
+  rpcs.reserve(tablets->size());
+  for (const auto& t : *tablets) {
+    unique_ptr<SplitKeyRangeRpc> rpc(new SplitKeyRangeRpc);
+    rpc->req.CopyFrom(req);
+    rpc->req.set_tablet_id(t.tablet->tablet_id());
+    const Status s = SendSplitKeyRangeRpc(
+        client, t.tablet, configuration.selection(), deadline, rpc.get());
+    if (!s.ok()) {
+      rpc->sync.StatusCB(s);
+    }
+    rpcs.emplace_back(std::move(rpc));
+  }
+
+  Status first_error;
+  for (size_t i = 0; i < rpcs.size(); i++) {
+    auto& rpc = rpcs[i];
+    const auto& tablet = (*tablets)[i].tablet;
+    Status s = rpc->sync.Wait();
+    // Retry on the other replicas one at a time: failures should be rare.
+    while (!s.ok() && rpc->ts != nullptr) {
+      VLOG(1) << Substitute("Failed to split tablet $0 on $1: $2",
+                            tablet->tablet_id(), rpc->ts->ToString(), s.ToString());
+      rpc->blacklist.insert(rpc->ts->permanent_uuid());
+      rpc->ts = nullptr;
+      const Status send_status = SendSplitKeyRangeRpc(
+          client, tablet, configuration.selection(), deadline, rpc.get());
+      if (!send_status.ok()) {
+        break;
+      }
+      s = rpc->sync.Wait();
+    }
+    if (!s.ok()) {
+      // Keep waiting for the other RPCs, which refer to 'rpcs'.
+      if (first_error.ok()) {
+        first_error = s.CloneAndPrepend(
+            Substitute("unable to split tablet $0", tablet->tablet_id()));
+      }
+      continue;
+    }
+    auto* ranges = rpc->resp.mutable_ranges();
+    (*tablets)[i].key_ranges.assign(std::make_move_iterator(ranges->begin()),
+                                    std::make_move_iterator(ranges->end()));
+  }
+  return first_error;
+}
+
+Status KuduScanTokenBuilder::Data::AddToken(KuduTable* table,
+                                            const internal::RemoteTablet& tablet,
+                                            ScanTokenPB message,
+                                            vector<KuduScanToken*>* tokens) {
+  vector<internal::RemoteReplica> replicas;
+  tablet.GetRemoteReplicas(&replicas);
+
+  vector<const KuduReplica*> client_replicas;
+  ElementDeleter deleter(&client_replicas);
+
+  // Convert the replicas from their internal format to something appropriate
+  // for clients.
+  for (const auto& r : replicas) {
+    vector<HostPort> host_ports;
+    r.ts->GetHostPorts(&host_ports);
+    if (host_ports.empty()) {
+      return Status::IllegalState(Substitute(
+          "No host found for tablet server $0", r.ts->ToString()));
+    }
+    unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+    client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                  host_ports[0],
+                                                  r.ts->location());
+    bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+    bool is_voter = is_leader || r.role == consensus::RaftPeerPB::FOLLOWER;
+    unique_ptr<KuduReplica> client_replica(new KuduReplica);
+    client_replica->data_ = new KuduReplica::Data(is_leader, is_voter,
+                                                  std::move(client_ts));
+    client_replicas.push_back(client_replica.release());
+  }
+
+  unique_ptr<KuduTablet> client_tablet(new KuduTablet);
+  client_tablet->data_ = new KuduTablet::Data(tablet.tablet_id(),
+                                              std::move(client_replicas));
+  client_replicas.clear();
+
+  // Create the scan token itself.
+  unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+  client_scan_token->data_ =
+      new KuduScanToken::Data(table,
+                              std::move(message),
+                              std::move(client_tablet));
+  tokens->push_back(client_scan_token.release());
   return Status::OK();
 }
 
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -24,11 +25,20 @@
 #include "kudu/client/client.h"
 #include "kudu/client/client.pb.h"
 #include "kudu/client/scan_configuration.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+class MonoTime;
+
 namespace client {
 
+namespace internal {
+class RemoteTablet;
+} // namespace internal
+
 class KuduScanToken::Data {
  public:
   explicit Data(KuduTable* table,
@@ -64,6 +74,17 @@ class KuduScanTokenBuilder::Data {
 
   Status Build(std::vector<KuduScanToken*>* tokens);
 
+  // Like above, but builds the tokens for the scan described by
+  // 'configuration' rather than the builder's own. This is used to split
+  // a KuduScanner's scan into its tablets.
+  Status Build(ScanConfiguration* configuration, std::vector<KuduScanToken*>* tokens);
+
+  // Sets the fields of 'pb' describing the scan of 'configuration', which
+  // aren't specific to a tablet.
+  static Status ConfigurationToPB(const ScanConfiguration& configuration,
+                                  bool include_table_metadata,
+                                  ScanTokenPB* pb);
+
   const ScanConfiguration& configuration() const {
     return configuration_;
   }
@@ -80,10 +101,59 @@ class KuduScanTokenBuilder::Data {
     include_tablet_metadata_ = include_metadata;
   }
 
+  void SetSplitSizeBytes(uint64_t split_size_bytes) {
+    split_size_bytes_ = split_size_bytes;
+  }
+
 private:
+  // A tablet to build scan tokens for.
+  struct TabletTokens {
+    scoped_refptr<internal::RemoteTablet> tablet;
+
+    // The message of the tablet's token, if it's not split.
+    ScanTokenPB message;
+
+    // The primary key ranges the tablet is split into, one token per range.
+    // Empty if the tablet isn't split.
+    std::vector<KeyRangePB> key_ranges;
+  };
+
+  // The SplitKeyRange RPC splitting a tablet.
+  struct SplitKeyRangeRpc;
+
+  // Splits the primary key ranges of 'tablets' into chunks of about
+  // 'split_size_bytes' of the projected columns' data, as estimated by their
+  // tablet servers from the size of the tablets' rowsets. 'pb' is the
+  // message of the scan's tokens.
+  //
+  // The RPCs for all the tablets are sent before waiting for any, so the
+  // tablets are split concurrently. Tablets with no data aren't split.
+  static Status SplitKeyRanges(KuduClient* client,
+                               const ScanConfiguration& configuration,
+                               const ScanTokenPB& pb,
+                               uint64_t split_size_bytes,
+                               const MonoTime& deadline,
+                               std::vector<TabletTokens>* tablets);
+
+  // Sends 'rpc' for 'tablet' to a replica picked with 'selection', among
+  // those it hasn't failed on yet. The outcome is reported to 'rpc->sync'.
+  static Status SendSplitKeyRangeRpc(KuduClient* client,
+                                     const scoped_refptr<internal::RemoteTablet>& tablet,
+                                     KuduClient::ReplicaSelection selection,
+                                     const MonoTime& deadline,
+                                     SplitKeyRangeRpc* rpc);
+
+  // Creates the scan token of 'tablet' with 'message', and appends it to
+  // 'tokens'.
+  static Status AddToken(KuduTable* table,
+                         const internal::RemoteTablet& tablet,
+                         ScanTokenPB message,
+                         std::vector<KuduScanToken*>* tokens);
+
   ScanConfiguration configuration_;
   bool include_table_metadata_ = true;
   bool include_tablet_metadata_ = true;
+  uint64_t split_size_bytes_ = 0;
 };
 
 } // namespace client
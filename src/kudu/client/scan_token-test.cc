@@ -43,6 +43,7 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -639,6 +640,88 @@ const kudu::ReadMode kReadModes[] = {
 INSTANTIATE_TEST_SUITE_P(Params, TimestampPropagationParamTest,
                          testing::ValuesIn(kReadModes));
 
+// Test splitting tablets into several scan tokens by size.
+TEST_F(ScanTokenTest, TestSplitSizeBytes) {
+  constexpr int kNumRowSets = 5;
+  constexpr int kRowsPerRowSet = 100;
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+              .schema(&schema)
+              .add_hash_partitions({ "col" }, 2)
+              .num_replicas(1)
+              .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+
+  vector<string> tablet_ids;
+  {
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    ASSERT_OK(KuduScanTokenBuilder(table.get()).Build(&tokens));
+    ASSERT_EQ(2, tokens.size());
+    for (const auto* token : tokens) {
+      tablet_ids.emplace_back(token->tablet().id());
+    }
+  }
+
+  // Write the rows so that each tablet has kNumRowSets rowsets with disjoint
+  // key ranges: those are the tablet servers' split points.
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  for (int r = 0; r < kNumRowSets; r++) {
+    for (int i = 0; i < kRowsPerRowSet; i++) {
+      unique_ptr<KuduInsert> insert(table->NewInsert());
+      ASSERT_OK(insert->mutable_row()->SetInt64("col", r * kRowsPerRowSet + i));
+      ASSERT_OK(session->Apply(insert.release()));
+    }
+    ASSERT_OK(session->Flush());
+    for (const auto& tablet_id : tablet_ids) {
+      ASSERT_OK(cluster_->FlushTablet(tablet_id));
+    }
+  }
+
+  {
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_EQ(2 * kNumRowSets, tokens.size());
+    ASSERT_EQ(kNumRowSets * kRowsPerRowSet, CountRows(tokens));
+    NO_FATALS(VerifyTabletInfo(tokens));
+  }
+
+  { // With a predicate on the primary key.
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.AddConjunctPredicate(table->NewComparisonPredicate(
+        "col", KuduPredicate::GREATER_EQUAL, KuduValue::FromInt(kRowsPerRowSet / 2))));
+    ASSERT_OK(builder.SetSplitSizeBytes(1));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_LE(2, tokens.size());
+    ASSERT_EQ(kNumRowSets * kRowsPerRowSet - kRowsPerRowSet / 2, CountRows(tokens));
+  }
+
+  { // With a split size larger than the tablets.
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetSplitSizeBytes(1024 * 1024 * 1024));
+    ASSERT_OK(builder.Build(&tokens));
+    ASSERT_EQ(2, tokens.size());
+    ASSERT_EQ(kNumRowSets * kRowsPerRowSet, CountRows(tokens));
+  }
+}
+
 // Tests the results of creating scan tokens, altering the columns being
 // scanned, and then executing the scan tokens.
 TEST_F(ScanTokenTest, TestConcurrentAlterTable) {
@@ -1090,5 +1173,86 @@ TEST_F(ScanTokenTest, ToggleFaultToleranceForScanConfiguration) {
   ASSERT_EQ(KuduScanner::READ_YOUR_WRITES, sc.read_mode());
 }
 
+// Test that a fault-tolerant scan resumed from a resume token returns the rest
+// of the rows of the scan, at the scan's snapshot.
+TEST_F(ScanTokenTest, TestResumeToken) {
+  constexpr const char* const kTableName = "resume_token";
+  constexpr int kNumRows = 1000;
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("key")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name(kTableName)
+              .schema(&schema)
+              .add_hash_partitions({ "key" }, 3)
+              .num_replicas(1)
+              .Create());
+    ASSERT_OK(client_->OpenTable(kTableName, &table));
+  }
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  const auto insert_rows = [&](int first, int num) {
+    for (int i = first; i < first + num; i++) {
+      unique_ptr<KuduInsert> insert(table->NewInsert());
+      ASSERT_OK(insert->mutable_row()->SetInt64("key", i));
+      ASSERT_OK(session->Apply(insert.release()));
+    }
+    ASSERT_OK(session->Flush());
+  };
+  NO_FATALS(insert_rows(0, kNumRows));
+
+  unordered_set<int64_t> keys;
+  const auto read_batch = [&](KuduScanner* scanner) {
+    KuduScanBatch batch;
+    ASSERT_OK(scanner->NextBatch(&batch));
+    for (const auto& row : batch) {
+      int64_t key;
+      ASSERT_OK(row.GetInt64(0, &key));
+      ASSERT_TRUE(keys.emplace(key).second) << key << " returned twice";
+    }
+  };
+
+  string token;
+  {
+    KuduScanner scanner(table.get());
+    ASSERT_OK(scanner.SetFaultTolerant());
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    // Only open fault-tolerant scans can be resumed.
+    KuduScanner non_ft_scanner(table.get());
+    ASSERT_OK(non_ft_scanner.Open());
+    ASSERT_TRUE(non_ft_scanner.GetResumeToken(&token).IsNotSupported());
+
+    ASSERT_OK(scanner.Open());
+    while (scanner.HasMoreRows() && keys.size() < kNumRows / 2) {
+      NO_FATALS(read_batch(&scanner));
+    }
+    ASSERT_GT(keys.size(), 0);
+    ASSERT_LT(keys.size(), kNumRows);
+    ASSERT_OK(scanner.GetResumeToken(&token));
+  }
+
+  // The rows inserted after the scan's snapshot aren't returned by the
+  // resumed scan.
+  NO_FATALS(insert_rows(kNumRows, 10));
+
+  KuduScanner* scanner_raw;
+  ASSERT_OK(KuduScanToken::DeserializeIntoScanner(client_.get(), token, &scanner_raw));
+  unique_ptr<KuduScanner> scanner(scanner_raw);
+  ASSERT_OK(scanner->Open());
+  while (scanner->HasMoreRows()) {
+    NO_FATALS(read_batch(scanner.get()));
+  }
+  ASSERT_EQ(kNumRows, keys.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_TRUE(ContainsKey(keys, i)) << i;
+  }
+}
+
 } // namespace client
 } // namespace kudu
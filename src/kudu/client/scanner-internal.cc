@@ -19,6 +19,9 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -26,13 +29,16 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
 
 #include "kudu/client/client-internal.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner-internal.h"
 #include "kudu/client/resource_metrics-internal.h"
 #include "kudu/client/schema.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partition.h"
@@ -52,9 +58,14 @@
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/stopwatch.h"
 
 using google::protobuf::FieldDescriptor;
@@ -65,20 +76,236 @@ using kudu::rpc::RpcController;
 using kudu::security::SignedTokenPB;
 using kudu::tserver::NewScanRequestPB;
 using kudu::tserver::RowFormatFlags;
+using kudu::tserver::ScanRequestPB;
 using kudu::tserver::ScanResponsePB;
 using kudu::tserver::TabletServerFeatures;
+using kudu::tserver::TabletServerServiceProxy;
 using std::set;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(client_scan_hedging, false,
+            "Whether to send a scan's request to open a scanner on a tablet to "
+            "a second replica of the tablet if the first replica takes unusually "
+            "long to respond, using whichever response comes first. What's "
+            "unusually long is estimated from the latency of the replica's "
+            "earlier scan RPCs. Scans using the LEADER_ONLY replica selection are "
+            "never hedged.");
+TAG_FLAG(client_scan_hedging, experimental);
+TAG_FLAG(client_scan_hedging, runtime);
+
+DEFINE_int32(client_scan_hedging_min_delay_ms, 10,
+             "The minimum time in milliseconds a request to open a scanner is "
+             "outstanding before it is also sent to a second replica. Only "
+             "relevant if --client_scan_hedging is set.");
+TAG_FLAG(client_scan_hedging_min_delay_ms, experimental);
+TAG_FLAG(client_scan_hedging_min_delay_ms, runtime);
+
+DEFINE_bool(client_scan_prefetch, false,
+            "Whether scanners send the request for a tablet's next batch as "
+            "soon as they return the current one, so that the round trip to "
+            "the tablet server overlaps with the caller processing the batch.");
+TAG_FLAG(client_scan_prefetch, experimental);
+TAG_FLAG(client_scan_prefetch, runtime);
+
+DEFINE_int32(client_scan_prefetch_max_batch_size_bytes, 8 * 1024 * 1024,
+             "The largest batch size requested by prefetching scanners which "
+             "don't set a batch size. Whenever the caller of such a scanner has "
+             "to wait for the prefetched batch, the scanner asks for batches "
+             "large enough to take as long to process as the next one takes to "
+             "fetch, up to this size. Tablet servers cap batch sizes at their "
+             "--scanner_max_batch_size_bytes. Only relevant if "
+             "--client_scan_prefetch is set.");
+TAG_FLAG(client_scan_prefetch_max_batch_size_bytes, experimental);
+TAG_FLAG(client_scan_prefetch_max_batch_size_bytes, runtime);
+
+DEFINE_int32(client_scan_prefetch_depth, 1,
+             "The number of continuation requests a prefetching scanner keeps in "
+             "flight for a tablet, if its tablet server lets it, so that the "
+             "throughput of the scan isn't capped at one batch per round trip. "
+             "Only relevant if --client_scan_prefetch is set.");
+TAG_FLAG(client_scan_prefetch_depth, experimental);
+TAG_FLAG(client_scan_prefetch_depth, runtime);
+
+DEFINE_uint32(client_scan_result_cache_capacity_mb, 32,
+              "The capacity of the client's cache of rows returned by scans "
+              "with result caching enabled, in MiB. A scan repeated while the "
+              "rows of a tablet are cached asks the tablet server whether the "
+              "tablet's data has changed, and only scans the tablet if it has. "
+              "Set to 0 to disable the cache.");
+TAG_FLAG(client_scan_result_cache_capacity_mb, advanced);
+
+DEFINE_uint32(client_scan_result_cache_ttl_sec, 300,
+              "How long the rows of a tablet stay in the client's scan result "
+              "cache, in seconds.");
+TAG_FLAG(client_scan_result_cache_ttl_sec, advanced);
+
+DEFINE_bool(client_scan_trim_in_list_predicates, false,
+            "Whether scans send each tablet only the values of their in-list "
+            "predicates which the tablet's rows may have, rather than the "
+            "whole lists: the values which don't hash to the tablet's bucket, "
+            "or fall outside of its range partition or of the scan's primary "
+            "key bounds are left out. Also applies to the scan tokens built "
+            "while the flag is enabled.");
+TAG_FLAG(client_scan_trim_in_list_predicates, experimental);
+TAG_FLAG(client_scan_trim_in_list_predicates, runtime);
+
 namespace kudu {
 
 namespace client {
 
 using internal::RemoteTabletServer;
 
+namespace {
+
+// A new scan request sent to up to two tablet servers. It's shared with the
+// RPCs' callbacks, which may run after the scanner took the other response.
+struct HedgedScan {
+  struct Attempt {
+    bool succeeded() const {
+      return controller.status().ok() && !resp.has_error();
+    }
+
+    RemoteTabletServer* ts = nullptr;
+    shared_ptr<TabletServerServiceProxy> proxy;
+    ScanResponsePB resp;
+    RpcController controller;
+    MonoTime start;
+    bool done = false;
+  };
+
+  explicit HedgedScan(const ScanRequestPB& r)
+      : cond(&lock),
+        req(r) {
+  }
+
+  Mutex lock;
+  ConditionVariable cond;
+  const ScanRequestPB req;
+  Attempt attempts[2];
+
+  // Set once the scanner took the response of one of the attempts.
+  bool decided = false;
+};
+
+// The size of the row data of 'resp', which is in the sidecars of 'controller'.
+int64_t ResponseDataBytes(const ScanResponsePB& resp, const RpcController& controller) {
+  int64_t bytes = 0;
+  const auto add = [&](int idx) {
+    Slice sidecar;
+    if (controller.GetInboundSidecar(idx, &sidecar).ok()) {
+      bytes += sidecar.size();
+    }
+  };
+  if (resp.has_data()) {
+    if (resp.data().has_rows_sidecar()) {
+      add(resp.data().rows_sidecar());
+    }
+    if (resp.data().has_indirect_data_sidecar()) {
+      add(resp.data().indirect_data_sidecar());
+    }
+  }
+  if (resp.has_columnar_data()) {
+    for (const auto& col : resp.columnar_data().columns()) {
+      if (col.has_data_sidecar()) {
+        add(col.data_sidecar());
+      }
+      if (col.has_varlen_data_sidecar()) {
+        add(col.varlen_data_sidecar());
+      }
+      if (col.has_non_null_bitmap_sidecar()) {
+        add(col.non_null_bitmap_sidecar());
+      }
+    }
+  }
+  return bytes;
+}
+
+// Closes the scanner that the given attempt, whose response wasn't used,
+// opened on its tablet server, if any. Doesn't wait for the close to finish.
+void CloseLosingScanAttempt(const HedgedScan::Attempt& attempt) {
+  if (!attempt.proxy || !attempt.succeeded() || !attempt.resp.has_more_results()) {
+    return;
+  }
+  struct Closer {
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController controller;
+  };
+  Closer* closer = new Closer;
+  closer->req.set_scanner_id(attempt.resp.scanner_id());
+  closer->req.set_call_seq_id(1);
+  closer->req.set_batch_size_bytes(0);
+  closer->req.set_close_scanner(true);
+  closer->controller.set_timeout(attempt.controller.timeout());
+  attempt.proxy->ScanAsync(closer->req, &closer->resp, &closer->controller, [closer]() {
+    if (!closer->controller.status().ok()) {
+      LOG(WARNING) << "Couldn't close scanner " << closer->req.scanner_id() << ": "
+                   << closer->controller.status().ToString();
+    }
+    delete closer;
+  });
+}
+
+// Returns the replica to hedge a scan sent to 'ts' with: the candidate with
+// the lowest smoothed scan latency apart from 'ts' and the blacklisted ones,
+// or nullptr if there's none.
+RemoteTabletServer* PickHedgeTabletServer(const vector<RemoteTabletServer*>& candidates,
+                                          const RemoteTabletServer* ts,
+                                          const set<string>& blacklist) {
+  RemoteTabletServer* best = nullptr;
+  MonoDelta best_latency;
+  for (RemoteTabletServer* candidate : candidates) {
+    if (candidate == ts || ContainsKey(blacklist, candidate->permanent_uuid())) {
+      continue;
+    }
+    MonoDelta latency = candidate->smoothed_scan_latency();
+    if (!latency.Initialized()) {
+      latency = MonoDelta::FromNanoseconds(0);
+    }
+    if (!best || latency < best_latency) {
+      best = candidate;
+      best_latency = latency;
+    }
+  }
+  return best;
+}
+
+// Returns the key of the rows returned by the scan opened by 'scan' in the
+// scan result cache: the request, less the fields which don't affect the rows.
+string ResultCacheKey(const NewScanRequestPB& scan) {
+  NewScanRequestPB key(scan);
+  key.clear_propagated_timestamp();
+  key.clear_authz_token();
+  key.clear_return_data_version();
+  key.clear_cached_data_version();
+  return key.SerializeAsString();
+}
+
+} // anonymous namespace
+
+// The response to a prefetched continuation request. It's shared with the
+// RPC's callback, which may run after the scanner is gone.
+struct KuduScanner::Data::Prefetch {
+  Prefetch() : done(1) {}
+
+  // The request is kept so that it can be sent again if one before it fails.
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController controller;
+  MonoTime rpc_deadline;
+  MonoTime sent;
+  MonoTime received;
+  CountDownLatch done;
+
+  // Run once the response is received, if set by then. Protected by 'lock'.
+  std::function<void(bool success)> on_received;
+  simple_spinlock lock;
+};
+
 KuduScanner::Data::Data(KuduTable* table)
   : configuration_(table),
     open_(false),
@@ -86,7 +313,8 @@ KuduScanner::Data::Data(KuduTable* table)
     short_circuit_(false),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
     scan_attempts_(0),
-    num_rows_returned_(0) {
+    num_rows_returned_(0),
+    adaptive_batch_size_bytes_(0) {
 }
 
 KuduScanner::Data::~Data() {
@@ -338,7 +566,8 @@ Status KuduScanner::Data::ReopenCurrentTablet(const MonoTime& deadline,
 }
 
 ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
-                                             bool allow_time_for_failover) {
+                                             bool allow_time_for_failover,
+                                             RemoteTabletServer* hedge_ts) {
   // The user has specified a timeout which should apply to the total time for each call
   // to NextBatch(). However, for fault-tolerant scans, or for when we are first opening
   // a scanner, it's preferable to set a shorter timeout (the "default RPC timeout") for
@@ -359,20 +588,10 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
 
   controller_.Reset();
   controller_.set_deadline(rpc_deadline);
-  if (!configuration_.spec().predicates().empty()) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
-    if (prev_bloom_filter_feature ||
-        (next_req_.has_new_scan_request() &&
-         configuration().spec().ContainsBloomFilterPredicate())) {
-      controller_.RequireServerFeature(TabletServerFeatures::BLOOM_FILTER_PREDICATE_V2);
-    }
-  }
-  if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
-    controller_.RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
-  }
-  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_LAYOUT) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE);
-  }
+  RequireServerFeatures(prev_bloom_filter_feature ||
+                            (next_req_.has_new_scan_request() &&
+                             configuration().spec().ContainsBloomFilterPredicate()),
+                        &controller_);
 
   if (next_req_.has_new_scan_request()) {
     // Only new scan requests require authz tokens. Scan continuations rely on
@@ -386,11 +605,17 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
       VLOG(1) << "no authz token for table " << table_->id();
     }
   }
-  ScanRpcStatus scan_status = AnalyzeResponse(
-      proxy_->Scan(next_req_,
-                   &last_response_,
-                   &controller_),
-      rpc_deadline, overall_deadline);
+  Status rpc_status;
+  if (hedge_ts) {
+    rpc_status = SendHedgedScanRpc(hedge_ts, rpc_deadline);
+  } else {
+    const MonoTime start = MonoTime::Now();
+    rpc_status = proxy_->Scan(next_req_, &last_response_, &controller_);
+    if (rpc_status.ok() && !last_response_.has_error()) {
+      ts_->RecordScanLatency(MonoTime::Now() - start);
+    }
+  }
+  ScanRpcStatus scan_status = AnalyzeResponse(rpc_status, rpc_deadline, overall_deadline);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
     num_rows_returned_ += last_response_.has_data() ? last_response_.data().num_rows() : 0;
@@ -400,6 +625,157 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
   return scan_status;
 }
 
+void KuduScanner::Data::RequireServerFeatures(bool bloom_filter_feature,
+                                              RpcController* controller) const {
+  if (!configuration_.spec().predicates().empty()) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+    if (bloom_filter_feature) {
+      controller->RequireServerFeature(TabletServerFeatures::BLOOM_FILTER_PREDICATE_V2);
+    }
+  }
+  if (configuration().row_format_flags() & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES) {
+    controller->RequireServerFeature(TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+  }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_LAYOUT) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE);
+  }
+  if (configuration().row_format_flags() & KuduScanner::COLUMNAR_DICTIONARY_ENCODING) {
+    controller->RequireServerFeature(
+        TabletServerFeatures::COLUMNAR_DICTIONARY_ENCODING_FEATURE);
+  }
+}
+
+internal::ScanResultCache* KuduScanner::Data::result_cache() const {
+  if (!configuration_.cache_results() ||
+      configuration_.read_mode() != KuduScanner::READ_LATEST ||
+      (configuration_.row_format_flags() & KuduScanner::COLUMNAR_LAYOUT)) {
+    return nullptr;
+  }
+  return table_->client()->data_->scan_result_cache_.get();
+}
+
+void KuduScanner::Data::CacheResult(internal::ScanResultCache* cache, const string& key) {
+  const RowwiseRowBlockPB& data = last_response_.data();
+  unique_ptr<internal::CachedScanResult> result(new internal::CachedScanResult);
+  result->data_version = last_response_.data_version();
+  result->data = data;
+  Slice rows;
+  if (!data.has_rows_sidecar() ||
+      !controller_.GetInboundSidecar(data.rows_sidecar(), &rows).ok()) {
+    // The response is invalid: leave it to KuduScanBatch::Data::Reset() to
+    // report it.
+    return;
+  }
+  result->rows = rows.ToString();
+  if (data.has_indirect_data_sidecar()) {
+    Slice indirect_data;
+    if (!controller_.GetInboundSidecar(data.indirect_data_sidecar(), &indirect_data).ok()) {
+      return;
+    }
+    result->indirect_data = indirect_data.ToString();
+  }
+  const int charge = key.size() + result->rows.size() + result->indirect_data.size() +
+      data.SpaceUsedLong();
+  cache->Put(key, std::move(result), charge);
+}
+
+Status KuduScanner::Data::SendHedgedScanRpc(RemoteTabletServer* hedge_ts,
+                                            const MonoTime& rpc_deadline) {
+  DCHECK(next_req_.has_new_scan_request());
+  DCHECK_NE(ts_, hedge_ts);
+  auto scan = std::make_shared<HedgedScan>(next_req_);
+  const auto send = [&](int idx,
+                        RemoteTabletServer* ts,
+                        shared_ptr<TabletServerServiceProxy> proxy) {
+    HedgedScan::Attempt* attempt = &scan->attempts[idx];
+    attempt->ts = ts;
+    attempt->proxy = std::move(proxy);
+    attempt->controller.set_deadline(rpc_deadline);
+    for (uint32_t feature : controller_.required_server_features()) {
+      attempt->controller.RequireServerFeature(feature);
+    }
+    attempt->start = MonoTime::Now();
+    attempt->proxy->ScanAsync(scan->req, &attempt->resp, &attempt->controller, [scan, idx]() {
+      MutexLock l(scan->lock);
+      HedgedScan::Attempt* attempt = &scan->attempts[idx];
+      attempt->done = true;
+      if (scan->decided) {
+        CloseLosingScanAttempt(*attempt);
+      } else {
+        scan->cond.Broadcast();
+      }
+    });
+  };
+
+  send(0, ts_, proxy_);
+  const MonoDelta hedge_delay = std::max(
+      ts_->scan_latency_threshold(),
+      MonoDelta::FromMilliseconds(FLAGS_client_scan_hedging_min_delay_ms));
+  const MonoTime hedge_time = scan->attempts[0].start + hedge_delay;
+  bool hedged;
+  {
+    MutexLock l(scan->lock);
+    while (!scan->attempts[0].done && MonoTime::Now() < hedge_time) {
+      scan->cond.WaitUntil(hedge_time);
+    }
+    hedged = !scan->attempts[0].done && hedge_time < rpc_deadline;
+  }
+  if (hedged) {
+    Synchronizer sync;
+    hedge_ts->InitProxy(table_->client(), sync.AsStatusCallback());
+    Status s = sync.Wait();
+    if (s.ok()) {
+      VLOG(1) << Substitute("Scan of tablet $0 on $1 outstanding for $2, also sending it to $3",
+                            remote_->tablet_id(), ts_->ToString(), hedge_delay.ToString(),
+                            hedge_ts->ToString());
+      send(1, hedge_ts, hedge_ts->proxy());
+    } else {
+      VLOG(1) << Substitute("Not hedging scan of tablet $0: $1",
+                            remote_->tablet_id(), s.ToString());
+      hedged = false;
+    }
+  }
+
+  // Take the first successful response. If both attempts fail, report the
+  // error of the original one.
+  MutexLock l(scan->lock);
+  int winner;
+  while (true) {
+    const HedgedScan::Attempt& primary = scan->attempts[0];
+    const HedgedScan::Attempt& hedge = scan->attempts[1];
+    if (hedged && hedge.done && hedge.succeeded()) {
+      winner = 1;
+      break;
+    }
+    if (primary.done && (primary.succeeded() || !hedged || hedge.done)) {
+      winner = 0;
+      break;
+    }
+    scan->cond.Wait();
+  }
+  scan->decided = true;
+
+  HedgedScan::Attempt* won = &scan->attempts[winner];
+  HedgedScan::Attempt* lost = &scan->attempts[1 - winner];
+  if (won->succeeded()) {
+    won->ts->RecordScanLatency(MonoTime::Now() - won->start);
+  }
+  if (lost->done) {
+    CloseLosingScanAttempt(*lost);
+  } else if (winner == 1) {
+    // The original attempt is at least this slow: account for it, so that
+    // its server isn't preferred on the basis of its earlier latency alone.
+    lost->ts->RecordScanLatency(MonoTime::Now() - lost->start);
+  }
+  controller_.Swap(&won->controller);
+  last_response_.Swap(&won->resp);
+  if (winner == 1) {
+    ts_ = won->ts;
+    proxy_ = won->proxy;
+  }
+  return controller_.status();
+}
+
 Status KuduScanner::Data::OpenTablet(const PartitionKey& partition_key,
                                      const MonoTime& deadline,
                                      set<string>* blacklist) {
@@ -498,6 +874,14 @@ Status KuduScanner::Data::OpenTablet(const PartitionKey& partition_key,
   RETURN_NOT_OK(SchemaToColumnPBs(*configuration_.projection(), scan->mutable_projected_columns(),
                                   SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
 
+  internal::ScanResultCache* cache = result_cache();
+  string cache_key;
+  internal::ScanResultCache::EntryHandle cached;
+  cached_result_ = internal::ScanResultCache::EntryHandle();
+  if (cache) {
+    scan->set_return_data_version(true);
+  }
+
   for (int attempt = 1;; attempt++) {
     Synchronizer sync;
     table_->client()->data_->meta_cache_->LookupTabletByKey(
@@ -524,17 +908,40 @@ Status KuduScanner::Data::OpenTablet(const PartitionKey& partition_key,
       return Status::OK();
     }
 
+    if (FLAGS_client_scan_trim_in_list_predicates) {
+      scan->clear_column_predicates();
+      for (const auto& col_pred : configuration_.spec().predicates()) {
+        ColumnPredicateToPB(PartitionPruner::TrimInListForPartition(*table_->schema().schema_,
+                                                                    table_->partition_schema(),
+                                                                    remote_->partition(),
+                                                                    configuration_.spec(),
+                                                                    col_pred.second),
+                            scan->add_column_predicates());
+      }
+    }
+
     scan->set_tablet_id(remote_->tablet_id());
+    if (cache && cache_key.empty()) {
+      cache_key = ResultCacheKey(*scan);
+      cached = cache->Get(cache_key);
+      if (cached) {
+        scan->set_cached_data_version(cached.value().data_version);
+      }
+    }
 
     RemoteTabletServer *ts;
     vector<RemoteTabletServer*> candidates;
+    // The non-voter replicas, e.g. the read replicas of the table, wait to
+    // catch up with the snapshot of the scan before serving it, but might serve
+    // arbitrarily stale data to READ_LATEST scans.
     Status lookup_status = table_->client()->data_->GetTabletServer(
         table_->client(),
         remote_,
         configuration_.selection(),
         *blacklist,
         &candidates,
-        &ts);
+        &ts,
+        /*allow_non_voters=*/configuration_.read_mode() != KuduScanner::READ_LATEST);
     // If we get ServiceUnavailable, this indicates that the tablet doesn't
     // currently have any known leader. We should sleep and retry, since
     // it's likely that the tablet is undergoing a leader election and will
@@ -557,8 +964,15 @@ Status KuduScanner::Data::OpenTablet(const PartitionKey& partition_key,
     ts_ = CHECK_NOTNULL(ts);
     proxy_ = ts_->proxy();
 
+    RemoteTabletServer* hedge_ts = nullptr;
+    if (FLAGS_client_scan_hedging &&
+        configuration_.selection() != KuduClient::LEADER_ONLY &&
+        ts_->scan_latency_threshold().Initialized()) {
+      hedge_ts = PickHedgeTabletServer(candidates, ts_, *blacklist);
+    }
+
     bool allow_time_for_failover = candidates.size() > blacklist->size() + 1;
-    ScanRpcStatus scan_status = SendScanRpc(deadline, allow_time_for_failover);
+    ScanRpcStatus scan_status = SendScanRpc(deadline, allow_time_for_failover, hedge_ts);
     if (scan_status.result == ScanRpcStatus::OK) {
       last_error_ = Status::OK();
       scan_attempts_ = 0;
@@ -570,9 +984,22 @@ Status KuduScanner::Data::OpenTablet(const PartitionKey& partition_key,
 
   partition_pruner_.RemovePartitionKeyRange(remote_->partition().end());
 
+  if (cache) {
+    if (last_response_.data_unchanged() && cached) {
+      VLOG(2) << "Using cached rows of tablet " << remote_->tablet_id();
+      num_rows_returned_ += cached.value().data.num_rows();
+      cached_result_ = std::move(cached);
+    } else if (!last_response_.has_more_results() &&
+               last_response_.has_data_version() &&
+               last_response_.has_data()) {
+      CacheResult(cache, cache_key);
+    }
+  }
+
   next_req_.clear_new_scan_request();
   data_in_open_ = (last_response_.has_data() && last_response_.data().num_rows() > 0) ||
-      (last_response_.has_columnar_data() && last_response_.columnar_data().num_rows() > 0);
+      (last_response_.has_columnar_data() && last_response_.columnar_data().num_rows() > 0) ||
+      (cached_result_ && cached_result_.value().data.num_rows() > 0);
   if (last_response_.has_more_results()) {
     next_req_.set_scanner_id(last_response_.scanner_id());
     VLOG(2) << "Opened tablet " << remote_->tablet_id()
@@ -648,6 +1075,8 @@ void KuduScanner::Data::PrepareRequest(RequestType state) {
     next_req_.set_batch_size_bytes(0);
   } else if (configuration_.has_batch_size_bytes()) {
     next_req_.set_batch_size_bytes(configuration_.batch_size_bytes());
+  } else if (adaptive_batch_size_bytes_ > 0) {
+    next_req_.set_batch_size_bytes(adaptive_batch_size_bytes_);
   } else {
     next_req_.clear_batch_size_bytes();
   }
@@ -657,6 +1086,152 @@ void KuduScanner::Data::PrepareRequest(RequestType state) {
   } else {
     next_req_.set_call_seq_id(next_req_.call_seq_id() + 1);
   }
+
+  // The server keeps the runtime filters of a scan once it has received
+  // them. Those added before a new scan are part of its predicates.
+  next_req_.clear_runtime_filters();
+  if (state == KuduScanner::Data::CONTINUE) {
+    for (auto& filter : pending_runtime_filters_) {
+      next_req_.add_runtime_filters()->Swap(&filter);
+    }
+  }
+  pending_runtime_filters_.clear();
+}
+
+void KuduScanner::Data::MaybePrefetch() {
+  if (!FLAGS_client_scan_prefetch ||
+      !last_response_.has_more_results() ||
+      next_req_.scanner_id().empty()) {
+    // The requests in flight, if any, are past the end of the scan.
+    prefetch_.reset();
+    pipelined_prefetches_.clear();
+    return;
+  }
+  // The server lets the continuations be up to max_pipelined_continuations
+  // calls ahead of the one it's up to.
+  const int depth = std::max<int64_t>(
+      1, std::min<int64_t>(FLAGS_client_scan_prefetch_depth,
+                           last_response_.max_pipelined_continuations() + 1));
+  while ((prefetch_ ? 1 : 0) + pipelined_prefetches_.size() < depth) {
+    PrepareRequest(CONTINUE);
+    SendPrefetch();
+  }
+}
+
+void KuduScanner::Data::SendPrefetch() {
+  auto prefetch = std::make_shared<Prefetch>();
+  prefetch->req = next_req_;
+  prefetch->sent = MonoTime::Now();
+  prefetch->rpc_deadline = prefetch->sent + configuration_.timeout();
+  prefetch->controller.set_deadline(prefetch->rpc_deadline);
+  RequireServerFeatures(configuration_.spec().ContainsBloomFilterPredicate(),
+                        &prefetch->controller);
+  VLOG(2) << "Prefetching " << DebugString();
+  proxy_->ScanAsync(next_req_, &prefetch->resp, &prefetch->controller,
+                    [prefetch]() {
+                      prefetch->received = MonoTime::Now();
+                      std::function<void(bool)> cb;
+                      {
+                        std::lock_guard<simple_spinlock> l(prefetch->lock);
+                        prefetch->done.CountDown();
+                        cb = std::move(prefetch->on_received);
+                      }
+                      if (cb) {
+                        cb(prefetch->controller.status().ok() && !prefetch->resp.has_error());
+                      }
+                    });
+  if (prefetch_) {
+    pipelined_prefetches_.emplace_back(std::move(prefetch));
+  } else {
+    prefetch_ = std::move(prefetch);
+  }
+}
+
+void KuduScanner::Data::DropPipelinedPrefetches() {
+  if (pipelined_prefetches_.empty()) {
+    return;
+  }
+  // The retries of the failed request are sent with its call sequence ID.
+  next_req_ = prefetch_->req;
+  vector<ColumnPredicatePB> filters;
+  for (const auto& prefetch : pipelined_prefetches_) {
+    for (const auto& filter : prefetch->req.runtime_filters()) {
+      filters.push_back(filter);
+    }
+  }
+  filters.insert(filters.end(), pending_runtime_filters_.begin(),
+                 pending_runtime_filters_.end());
+  pending_runtime_filters_ = std::move(filters);
+  pipelined_prefetches_.clear();
+}
+
+void KuduScanner::Data::WhenPrefetchReceived(std::function<void(bool success)> cb) {
+  DCHECK(prefetch_);
+  Prefetch* prefetch = prefetch_.get();
+  {
+    std::lock_guard<simple_spinlock> l(prefetch->lock);
+    if (prefetch->done.count() > 0) {
+      prefetch->on_received = std::move(cb);
+      return;
+    }
+  }
+  cb(prefetch->controller.status().ok() && !prefetch->resp.has_error());
+}
+
+ScanRpcStatus KuduScanner::Data::ReceivePrefetch(const MonoTime& overall_deadline) {
+  DCHECK(prefetch_);
+  const MonoTime wait_start = MonoTime::Now();
+  // The RPC's own deadline bounds the wait. There's none if the response was
+  // received already, e.g. when an async NextBatch() processes it on a
+  // reactor thread.
+  if (prefetch_->done.count() > 0) {
+    prefetch_->done.Wait();
+  }
+  if (!prefetch_->controller.status().ok() || prefetch_->resp.has_error()) {
+    DropPipelinedPrefetches();
+  }
+  shared_ptr<Prefetch> prefetch = std::move(prefetch_);
+  if (!pipelined_prefetches_.empty()) {
+    prefetch_ = std::move(pipelined_prefetches_.front());
+    pipelined_prefetches_.pop_front();
+  }
+
+  controller_.Swap(&prefetch->controller);
+  last_response_.Swap(&prefetch->resp);
+  ScanRpcStatus scan_status = AnalyzeResponse(controller_.status(),
+                                              prefetch->rpc_deadline,
+                                              overall_deadline);
+  if (scan_status.result == ScanRpcStatus::OK) {
+    const MonoDelta fetch_time = prefetch->received - prefetch->sent;
+    ts_->RecordScanLatency(fetch_time);
+    if (prefetch->received > wait_start && !configuration_.has_batch_size_bytes()) {
+      AdaptBatchSize(ResponseDataBytes(last_response_, controller_),
+                     wait_start - prefetch->sent, fetch_time);
+    }
+    UpdateResourceMetrics();
+    num_rows_returned_ += last_response_.has_data() ? last_response_.data().num_rows() : 0;
+    num_rows_returned_ += last_response_.has_columnar_data() ?
+        last_response_.columnar_data().num_rows() : 0;
+  }
+  return scan_status;
+}
+
+void KuduScanner::Data::AdaptBatchSize(int64_t bytes,
+                                       const MonoDelta& process_time,
+                                       const MonoDelta& fetch_time) {
+  const int64_t max_bytes = FLAGS_client_scan_prefetch_max_batch_size_bytes;
+  int64_t target = max_bytes;
+  if (process_time.ToMicroseconds() > 0) {
+    target = std::min<int64_t>(
+        max_bytes, bytes * fetch_time.ToMicroseconds() / process_time.ToMicroseconds());
+  }
+  // Only ever grow the batches: the caller waiting means the batches in
+  // flight don't cover the round trip.
+  target = std::max<int64_t>(target, bytes);
+  if (target > adaptive_batch_size_bytes_) {
+    VLOG(2) << Substitute("Growing batch size of $0 to $1 bytes", DebugString(), target);
+    adaptive_batch_size_bytes_ = std::min(target, max_bytes);
+  }
 }
 
 void KuduScanner::Data::UpdateLastError(const Status& error) {
@@ -761,6 +1336,30 @@ void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
   VLOG(2) << "Extracted " << rows->size() << " rows";
 }
 
+Status KuduScanBatch::Data::ResetFromCache(const Schema* projection,
+                                           const KuduSchema* client_projection,
+                                           uint64_t row_format_flags,
+                                           const internal::CachedScanResult& result) {
+  if (row_format_flags & RowFormatFlags::COLUMNAR_LAYOUT) {
+    return Status::InvalidArgument("columnar layout specified, must use KuduColumnarScanBatch");
+  }
+
+  controller_.Reset();
+  projection_ = projection;
+  projected_row_size_ = CalculateProjectedRowSize(*projection_);
+  client_projection_ = client_projection;
+  row_format_flags_ = row_format_flags;
+  resp_data_ = result.data;
+
+  // The pointers in the cached rows are relative: rewrite those of a copy.
+  cached_direct_data_ = result.rows;
+  cached_indirect_data_ = result.indirect_data;
+  direct_data_ = Slice(cached_direct_data_);
+  indirect_data_ = Slice(cached_indirect_data_);
+  return RewriteRowBlockPointers(*projection_, resp_data_, indirect_data_, &direct_data_,
+                                 row_format_flags_ & KuduScanner::PAD_UNIXTIME_MICROS_TO_16_BYTES);
+}
+
 void KuduScanBatch::Data::Clear() {
   resp_data_.Clear();
   controller_.Reset();
@@ -796,6 +1395,14 @@ Status KuduColumnarScanBatch::Data::Reset(
   return Status::OK();
 }
 
+Status KuduColumnarScanBatch::Data::ResetFromCache(
+    const Schema* /* projection */,
+    const KuduSchema* /* client_projection */,
+    uint64_t /* row_format_flags */,
+    const internal::CachedScanResult& /* result */) {
+  return Status::InvalidArgument("cached scan results are row-wise, must use KuduScanBatch");
+}
+
 void KuduColumnarScanBatch::Data::Clear() {
   resp_data_.Clear();
   controller_.Reset();
@@ -836,6 +1443,52 @@ Status KuduColumnarScanBatch::Data::GetFixedLengthColumn(int idx, Slice* data) c
 Status KuduColumnarScanBatch::Data::GetVariableLengthColumn(
     int idx, Slice* offsets, Slice* data) const {
   RETURN_NOT_OK(CheckColumnIndex(idx));
+  if (PREDICT_FALSE(resp_data_.columns(idx).has_dictionary_codes_sidecar())) {
+    return Status::InvalidArgument("column is dictionary-encoded",
+                                   projection_->column(idx).ToString());
+  }
+  return GetOffsetsAndVarlenData(idx, resp_data_.num_rows(), offsets, data);
+}
+
+Status KuduColumnarScanBatch::Data::GetDictionaryColumn(
+    int idx, Slice* codes, Slice* dictionary_offsets, Slice* dictionary_data) const {
+  RETURN_NOT_OK(CheckColumnIndex(idx));
+  const auto& col = projection_->column(idx);
+  const auto& resp_col = resp_data_.columns(idx);
+  if (!resp_col.has_dictionary_codes_sidecar()) {
+    return Status::NotFound("column is not dictionary-encoded", col.ToString());
+  }
+  Slice codes_tmp;
+  RETURN_NOT_OK(controller_.GetInboundSidecar(resp_col.dictionary_codes_sidecar(), &codes_tmp));
+  const size_t expected_size = resp_data_.num_rows() * sizeof(uint32_t);
+  if (PREDICT_FALSE(codes_tmp.size() != expected_size)) {
+    return Status::Corruption(Substitute("size $0 of codes buffer for column $1 did not "
+                                         "match expected size $2",
+                                         codes_tmp.size(), col.ToString(), expected_size));
+  }
+
+  Slice offsets_tmp;
+  Slice data_tmp;
+  RETURN_NOT_OK(GetOffsetsAndVarlenData(idx, -1, &offsets_tmp, &data_tmp));
+  const int64_t dictionary_size =
+      offsets_tmp.empty() ? 0 : offsets_tmp.size() / sizeof(uint32_t) - 1;
+  for (int i = 0; i < resp_data_.num_rows(); i++) {
+    uint32_t code = UnalignedLoad<uint32_t>(codes_tmp.data() + i * sizeof(uint32_t));
+    if (PREDICT_FALSE(code >= dictionary_size)) {
+      return Status::Corruption(Substitute(
+          "invalid code $0 returned for column $1 at index $2 (dictionary size is $3)",
+          code, col.ToString(), i, dictionary_size));
+    }
+  }
+
+  *codes = codes_tmp;
+  *dictionary_offsets = offsets_tmp;
+  *dictionary_data = data_tmp;
+  return Status::OK();
+}
+
+Status KuduColumnarScanBatch::Data::GetOffsetsAndVarlenData(
+    int idx, int64_t num_values, Slice* offsets, Slice* data) const {
   const auto& col = projection_->column(idx);
   if (PREDICT_FALSE(col.type_info()->physical_type() != BINARY)) {
     return Status::InvalidArgument("column is not variable-length", col.ToString());
@@ -861,14 +1514,22 @@ Status KuduColumnarScanBatch::Data::GetVariableLengthColumn(
       &data_tmp));
 
   // Validate the offsets.
-  auto expected_num_offsets = resp_data_.num_rows() == 0 ? 0 : (resp_data_.num_rows() + 1);
+  if (num_values == -1) {
+    if (PREDICT_FALSE(offsets_tmp.size() % sizeof(uint32_t) != 0 ||
+                      offsets_tmp.size() == sizeof(uint32_t))) {
+      return Status::Corruption(Substitute("invalid size $0 of offsets buffer for column $1",
+                                           offsets_tmp.size(), col.ToString()));
+    }
+    num_values = offsets_tmp.empty() ? 0 : offsets_tmp.size() / sizeof(uint32_t) - 1;
+  }
+  auto expected_num_offsets = num_values == 0 ? 0 : (num_values + 1);
   auto expected_size = expected_num_offsets * sizeof(uint32_t);
   if (PREDICT_FALSE(offsets_tmp.size() != expected_size)) {
     return Status::Corruption(Substitute("size $0 of offsets buffer for column $1 did not "
                                          "match expected size $2",
                                          offsets_tmp.size(), col.ToString(), expected_size));
   }
-  for (int i = 0; i < resp_data_.num_rows(); i++) {
+  for (int i = 0; i < expected_num_offsets; i++) {
     uint32_t offset = UnalignedLoad<uint32_t>(offsets_tmp.data() + i * sizeof(uint32_t));
     if (PREDICT_FALSE(offset > data_tmp.size())) {
       return Status::Corruption(Substitute(
@@ -19,6 +19,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <set>
@@ -42,6 +44,7 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/ttl_cache.h"
 
 namespace kudu {
 
@@ -58,8 +61,25 @@ namespace client {
 class KuduSchema;
 
 namespace internal {
+class ParallelScanner;
 class RemoteTablet;
 class RemoteTabletServer;
+
+// The rows returned by the complete scan of a tablet, as they were received
+// from the tablet server. Kept in the client's scan result cache, keyed by the
+// scan's request, to serve a repeat of the scan if the tablet's data version
+// is still the same. See KuduScanner::SetCacheResults().
+struct CachedScanResult {
+  // The tablet's data version the rows were scanned at.
+  uint64_t data_version;
+
+  // The row block's description, and the contents of its sidecars.
+  RowwiseRowBlockPB data;
+  std::string rows;
+  std::string indirect_data;
+};
+
+typedef TTLCache<std::string, CachedScanResult> ScanResultCache;
 } // namespace internal
 
 // The result of KuduScanner::Data::AnalyzeResponse.
@@ -132,7 +152,19 @@ class KuduScanner::Data {
   // will use 'overall_deadline' as its deadline.
   //
   // The RPC and TS proxy should already have been prepared in next_req_, proxy_, etc.
-  ScanRpcStatus SendScanRpc(const MonoTime& overall_deadline, bool allow_time_for_failover);
+  //
+  // If 'hedge_ts' is set, the RPC must be a new scan request. If it's still
+  // outstanding after the usual scan latency of 'ts_', it's also sent to
+  // 'hedge_ts', and the first successful response is used. If that's the
+  // response of 'hedge_ts', 'ts_' and 'proxy_' are switched to 'hedge_ts'.
+  ScanRpcStatus SendScanRpc(const MonoTime& overall_deadline,
+                            bool allow_time_for_failover,
+                            internal::RemoteTabletServer* hedge_ts = nullptr);
+
+  // Sends the new scan request in 'next_req_' to 'ts_' and, if it's slow to
+  // respond, to 'hedge_ts' as well. See SendScanRpc().
+  Status SendHedgedScanRpc(internal::RemoteTabletServer* hedge_ts,
+                           const MonoTime& rpc_deadline);
 
   // Called when KuduScanner::NextBatch or KuduScanner::Data::OpenTablet result in an RPC or
   // server error.
@@ -194,6 +226,33 @@ class KuduScanner::Data {
   // Modifies fields in 'next_req_' in preparation for a new request.
   void PrepareRequest(RequestType state);
 
+  // Sends the requests for the current tablet's next batches if prefetching
+  // is enabled and the tablet has more rows, up to as many as the tablet
+  // server lets be in flight and --client_scan_prefetch_depth. To be called
+  // once the batch in 'last_response_' has been handed to the caller.
+  void MaybePrefetch();
+
+  // Sends the continuation request in 'next_req_' ahead of the call to
+  // NextBatch() which will receive its response, after those of the requests
+  // prefetched already.
+  void SendPrefetch();
+
+  // Drops the prefetched requests after 'prefetch_', whose responses can't be
+  // used once that of 'prefetch_' isn't, and arranges for their runtime
+  // filters to be sent again.
+  void DropPipelinedPrefetches();
+
+  // Runs 'cb' once the response to the request sent by SendPrefetch() has
+  // been received, right away if it already has. 'cb' is passed whether the
+  // response is a successful one, which NextBatch() can process without
+  // blocking. 'cb' may be run on a reactor thread.
+  void WhenPrefetchReceived(std::function<void(bool success)> cb);
+
+  // Waits for the response to the request sent by SendPrefetch(), takes it
+  // into 'last_response_' and 'controller_', and analyzes it in the same way
+  // as SendScanRpc().
+  ScanRpcStatus ReceivePrefetch(const MonoTime& overall_deadline);
+
   // Update 'last_error_' if need be. Should be invoked whenever a
   // non-fatal (i.e. retriable) scan error is encountered.
   void UpdateLastError(const Status& error);
@@ -264,6 +323,34 @@ class KuduScanner::Data {
   // The scanner's cumulative resource metrics since the scan was started.
   ResourceMetrics resource_metrics_;
 
+  // The continuation request sent ahead of the caller's call to NextBatch(),
+  // if any. See MaybePrefetch().
+  struct Prefetch;
+  std::shared_ptr<Prefetch> prefetch_;
+
+  // The continuation requests sent after 'prefetch_', in call sequence ID
+  // order, if the tablet server lets several be in flight.
+  std::deque<std::shared_ptr<Prefetch>> pipelined_prefetches_;
+
+  // The batch size requested by a prefetching scan which didn't set one,
+  // based on how long the caller takes to process a batch compared to the
+  // time it takes to fetch one. 0 until the scan has waited for a batch.
+  uint32_t adaptive_batch_size_bytes_;
+
+  // Scans the tablets if the scan is parallel, in which case none of the
+  // members above describing a tablet's scan are used.
+  std::unique_ptr<internal::ParallelScanner> parallel_;
+
+  // The runtime filters added since the last continuation request was
+  // prepared, to be sent along with the next one. See
+  // KuduScanner::AddRuntimeFilter().
+  std::vector<ColumnPredicatePB> pending_runtime_filters_;
+
+  // The cached rows of the tablet just opened, if the tablet server found them
+  // still current. Returned in place of the response's data, and released
+  // once they have been.
+  internal::ScanResultCache::EntryHandle cached_result_;
+
   // Returns a text description of the scan suitable for debug printing.
   //
   // This method will not return sensitive predicate information, so it's
@@ -287,12 +374,30 @@ class KuduScanner::Data {
                                 const MonoTime& overall_deadline,
                                 const MonoTime& rpc_deadline);
 
+  // Requires the server features needed by the scan RPC using 'controller'.
+  // 'bloom_filter_feature' is whether the scan uses Bloom filter predicates.
+  void RequireServerFeatures(bool bloom_filter_feature,
+                             rpc::RpcController* controller) const;
+
+  // Grows 'adaptive_batch_size_bytes_' after the caller had to wait for the
+  // prefetched batch ('bytes' long): the next batch is sized so that the
+  // caller, processing it at the rate it processed the last one, takes about
+  // as long as fetching the following one.
+  void AdaptBatchSize(int64_t bytes, const MonoDelta& process_time,
+                      const MonoDelta& fetch_time);
+
   // Add additional details to the status message, such as number of retries,
   // original cause of the error, etc. Returns a cloned object.
   Status EnrichStatusMessage(Status s) const;
 
   void UpdateResourceMetrics();
 
+  // Returns the client's scan result cache if this scan uses it, or nullptr.
+  internal::ScanResultCache* result_cache() const;
+
+  // Puts the rows in 'last_response_' in the scan result cache under 'key'.
+  void CacheResult(internal::ScanResultCache* cache, const std::string& key);
+
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
 
@@ -305,6 +410,11 @@ class ScanBatchDataInterface {
                        const KuduSchema* client_projection,
                        uint64_t row_format_flags,
                        tserver::ScanResponsePB* response) = 0;
+  // Like Reset(), but takes the rows cached by an earlier scan.
+  virtual Status ResetFromCache(const Schema* projection,
+                                const KuduSchema* client_projection,
+                                uint64_t row_format_flags,
+                                const CachedScanResult& result) = 0;
   virtual void Clear() = 0;
 };
 } // namespace internal
@@ -319,6 +429,10 @@ class KuduScanBatch::Data : public internal::ScanBatchDataInterface {
                const KuduSchema* client_projection,
                uint64_t row_format_flags,
                tserver::ScanResponsePB* response) override;
+  Status ResetFromCache(const Schema* projection,
+                        const KuduSchema* client_projection,
+                        uint64_t row_format_flags,
+                        const internal::CachedScanResult& result) override;
 
   int num_rows() const {
     return resp_data_.num_rows();
@@ -352,6 +466,9 @@ class KuduScanBatch::Data : public internal::ScanBatchDataInterface {
   // The PB which contains the "direct data" slice.
   RowwiseRowBlockPB resp_data_;
 
+  // Copies of the row data of a batch taken from the scan result cache.
+  std::string cached_direct_data_, cached_indirect_data_;
+
   // Slices into the direct and indirect row data, whose lifetime is ensured
   // by the members above.
   Slice direct_data_, indirect_data_;
@@ -376,15 +493,27 @@ class KuduColumnarScanBatch::Data : public internal::ScanBatchDataInterface {
                const KuduSchema* client_projection,
                uint64_t row_format_flags,
                tserver::ScanResponsePB* response) override;
+  Status ResetFromCache(const Schema* projection,
+                        const KuduSchema* client_projection,
+                        uint64_t row_format_flags,
+                        const internal::CachedScanResult& result) override;
   void Clear() override;
 
   Status GetFixedLengthColumn(int idx, Slice* data) const;
   Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+  Status GetDictionaryColumn(int idx, Slice* codes, Slice* dictionary_offsets,
+                             Slice* dictionary_data) const;
   Status GetNonNullBitmapForColumn(int idx, Slice* data) const;
 
  private:
   Status CheckColumnIndex(int idx) const;
 
+  // Gets the offsets and the data of the variable-length values of column 'idx',
+  // checking that there are 'num_values' + 1 offsets (none if 'num_values' is 0)
+  // pointing into the data. If 'num_values' is -1, any number of values is valid.
+  Status GetOffsetsAndVarlenData(int idx, int64_t num_values,
+                                 Slice* offsets, Slice* data) const;
+
   friend class KuduColumnarScanBatch;
 
   // The RPC controller for the RPC which returned this batch.
@@ -396,9 +525,9 @@ class KuduColumnarScanBatch::Data : public internal::ScanBatchDataInterface {
   ColumnarRowBlockPB resp_data_;
 
   // The projection being scanned.
-  const Schema* projection_;
+  const Schema* projection_ = nullptr;
   // The KuduSchema version of 'projection_'
-  const KuduSchema* client_projection_;
+  const KuduSchema* client_projection_ = nullptr;
 };
 
 
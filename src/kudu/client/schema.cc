@@ -53,7 +53,7 @@ MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::EncodingType,
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::CompressionType,
                  kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION,
-                 kudu::client::KuduColumnStorageAttributes::ZLIB);
+                 kudu::client::KuduColumnStorageAttributes::ZSTD);
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnSchema::DataType,
                  kudu::client::KuduColumnSchema::INT8,
@@ -77,6 +77,8 @@ kudu::EncodingType ToInternalEncodingType(KuduColumnStorageAttributes::EncodingT
     case KuduColumnStorageAttributes::GROUP_VARINT: return kudu::GROUP_VARINT;
     case KuduColumnStorageAttributes::RLE: return kudu::RLE;
     case KuduColumnStorageAttributes::BIT_SHUFFLE: return kudu::BIT_SHUFFLE;
+    case KuduColumnStorageAttributes::FOR_DELTA: return kudu::FOR_DELTA;
+    case KuduColumnStorageAttributes::FSST_ENCODING: return kudu::FSST_ENCODING;
     default: LOG(FATAL) << "Unexpected encoding type: " << type;
   }
 }
@@ -90,6 +92,8 @@ KuduColumnStorageAttributes::EncodingType FromInternalEncodingType(kudu::Encodin
     case kudu::GROUP_VARINT: return KuduColumnStorageAttributes::GROUP_VARINT;
     case kudu::RLE: return KuduColumnStorageAttributes::RLE;
     case kudu::BIT_SHUFFLE: return KuduColumnStorageAttributes::BIT_SHUFFLE;
+    case kudu::FOR_DELTA: return KuduColumnStorageAttributes::FOR_DELTA;
+    case kudu::FSST_ENCODING: return KuduColumnStorageAttributes::FSST_ENCODING;
     default: LOG(FATAL) << "Unexpected internal encoding type: " << type;
   }
 }
@@ -101,6 +105,7 @@ kudu::CompressionType ToInternalCompressionType(KuduColumnStorageAttributes::Com
     case KuduColumnStorageAttributes::SNAPPY: return kudu::SNAPPY;
     case KuduColumnStorageAttributes::LZ4: return kudu::LZ4;
     case KuduColumnStorageAttributes::ZLIB: return kudu::ZLIB;
+    case KuduColumnStorageAttributes::ZSTD: return kudu::ZSTD;
     default: LOG(FATAL) << "Unexpected compression type" << type;
   }
 }
@@ -113,6 +118,7 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     case kudu::SNAPPY: return KuduColumnStorageAttributes::SNAPPY;
     case kudu::LZ4: return KuduColumnStorageAttributes::LZ4;
     case kudu::ZLIB: return KuduColumnStorageAttributes::ZLIB;
+    case kudu::ZSTD: return KuduColumnStorageAttributes::ZSTD;
     default: LOG(FATAL) << "Unexpected internal compression type: " << type;
   }
 }
@@ -239,6 +245,10 @@ Status KuduColumnStorageAttributes::StringToEncodingType(
     *type = KuduColumnStorageAttributes::DICT_ENCODING;
   } else if (encoding_uc == "BIT_SHUFFLE") {
     *type = KuduColumnStorageAttributes::BIT_SHUFFLE;
+  } else if (encoding_uc == "FOR_DELTA") {
+    *type = KuduColumnStorageAttributes::FOR_DELTA;
+  } else if (encoding_uc == "FSST_ENCODING") {
+    *type = KuduColumnStorageAttributes::FSST_ENCODING;
   } else if (encoding_uc == "GROUP_VARINT") {
     *type = KuduColumnStorageAttributes::GROUP_VARINT;
   } else {
@@ -264,6 +274,8 @@ Status KuduColumnStorageAttributes::StringToCompressionType(
     *type = KuduColumnStorageAttributes::LZ4;
   } else if (compression_uc == "ZLIB") {
     *type = KuduColumnStorageAttributes::ZLIB;
+  } else if (compression_uc == "ZSTD") {
+    *type = KuduColumnStorageAttributes::ZSTD;
   } else {
     s = Status::InvalidArgument(Substitute(
         "compression type $0 is not supported", compression));
@@ -303,6 +315,11 @@ KuduColumnSpec* KuduColumnSpec::Compression(
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::CompressionLevel(int32_t level) {
+  data_->compression_level = level;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::Encoding(
     KuduColumnStorageAttributes::EncodingType encoding) {
   data_->encoding = encoding;
@@ -478,6 +495,11 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
                           type_attrs,
                           data_->comment ? data_->comment.value() : "");
 #pragma GCC diagnostic pop
+  if (data_->compression_level) {
+    ColumnSchemaDelta delta(data_->name);
+    delta.compression_level = data_->compression_level;
+    RETURN_NOT_OK(col->col_->ApplyDelta(delta));
+  }
 
   return Status::OK();
 }
@@ -513,6 +535,8 @@ Status KuduColumnSpec::ToColumnSchemaDelta(ColumnSchemaDelta* col_delta) const {
     col_delta->compression = ToInternalCompressionType(data_->compression.value());
   }
 
+  col_delta->compression_level = data_->compression_level;
+
   col_delta->new_name = std::move(data_->rename_to);
   col_delta->cfile_block_size = std::move(data_->block_size);
   col_delta->new_comment = std::move(data_->comment);
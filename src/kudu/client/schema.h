@@ -61,6 +61,7 @@ class MetaCacheEntry;
 class WriteRpc;
 } // namespace internal
 
+class KuduColumnarInsertBatch;
 class KuduSchema;
 class KuduValue;
 
@@ -137,6 +138,8 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     RLE = 4,
     DICT_ENCODING = 5,
     BIT_SHUFFLE = 6,
+    FOR_DELTA = 7,
+    FSST_ENCODING = 8,
 
     /// @deprecated GROUP_VARINT is not supported for valid types, and
     /// will fall back to another encoding on the server side.
@@ -150,6 +153,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -385,6 +389,17 @@ class KUDU_EXPORT KuduColumnSpec {
   /// @return Pointer to the modified object.
   KuduColumnSpec* Compression(KuduColumnStorageAttributes::CompressionType compression);
 
+  /// Set the compression level for the column.
+  ///
+  /// Higher levels trade compression speed for better compression ratios.
+  /// Only applies to compression types which support levels, currently ZSTD,
+  /// whose levels range from 1 to 22.
+  ///
+  /// @param [in] level
+  ///   The compression level to use, or 0 for the server-side default.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* CompressionLevel(int32_t level);
+
   /// Set the preferred encoding for the column.
   ///
   /// @note Not all encodings are supported for all column types.
@@ -753,6 +768,8 @@ class KUDU_EXPORT KuduSchema {
  private:
   friend class ClientTest;
   friend class KuduClient;
+  friend class KuduColumnarInsertBatch;
+  friend class KuduPartitioner;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
@@ -88,11 +88,10 @@ void KuduSession::Data::FlushFinished(Batcher* batcher) {
     --batchers_num_;
     // The logic of KuduSession::ApplyWriteOp() needs to know
     // if total number of batchers or buffer byte count decreases.
-    // There can be a thread waiting on the corresponding condition
-    // variable: the thread which runs KuduSession::Apply(), and
-    // since KuduSession interface does not advertise thread-safety, it's
-    // the only thread to notify.
-    condition_.Signal();
+    // There can be several threads waiting on the corresponding condition
+    // variable: the threads running KuduSession::Apply(), which may be called
+    // concurrently, and the thread running KuduSession::Flush().
+    condition_.Broadcast();
   }
 }
 
@@ -401,14 +400,9 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
 
   const size_t max_size = buffer_bytes_limit_;
   // Thread-safety note: the flush_mode_ is accessed from the background
-  // time-based flush task for reading. Practically, it would be possible
-  // to get away with not protecting the flush_mode_ since it's read-only
-  // access here as well, but TSAN does not like that.
-  FlushMode flush_mode;
-  {
-    std::lock_guard<Mutex> l(mutex_);
-    flush_mode = flush_mode_;
-  }
+  // time-based flush task for reading, hence it's atomic: that way, it can
+  // be read without taking the mutex_.
+  const FlushMode flush_mode = flush_mode_;
 
   // A sanity check: before trying to validate against any of run-time metrics,
   // verify that the single operation can fit into an empty buffer
@@ -422,8 +416,17 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     return s;
   }
 
-  if (flush_mode == AUTO_FLUSH_BACKGROUND) {
-    if (PREDICT_TRUE(buffer_pre_flush_enabled_)) {
+  // The operation is added, and the current batcher flushed if need be, in a
+  // single critical section: the mutex_ is only taken once per operation
+  // unless Apply() has to wait for buffer space, which keeps the contention
+  // with concurrent Apply() calls and with the flushed batchers' callbacks low.
+  // Batchers are flushed outside of the critical section though, since the
+  // callback may itself try to take the lock, in the case that the batch fails
+  // "inline" on the same thread.
+  scoped_refptr<Batcher> batcher_to_flush;
+  {
+    std::unique_lock<Mutex> l(mutex_);
+    if (flush_mode == AUTO_FLUSH_BACKGROUND) {
       // NOTE: the buffer_pre_flush_enabled_ is set to false only in tests.
       //
       // In need of an extra flush in some cases like shown in the diagram
@@ -446,12 +449,17 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       //                   | Data of operations   |
       //                   | being flushed now.   |
       //                   +----------0-----------+
-      FlushCurrentBatcher(max_size - required_size + 1, nullptr);
-    }
-  }
-  {
-    std::lock_guard<Mutex> l(mutex_);
-    if (flush_mode == AUTO_FLUSH_BACKGROUND) {
+      const int64_t pre_flush_watermark = max_size - required_size + 1;
+      if (PREDICT_TRUE(buffer_pre_flush_enabled_) && batcher_ &&
+          batcher_->buffer_bytes_used() >= pre_flush_watermark) {
+        // The flush has to start before waiting for the space it frees.
+        batcher_to_flush.swap(batcher_);
+        l.unlock();
+        batcher_to_flush->FlushAsync(nullptr);
+        batcher_to_flush.reset();
+        l.lock();
+      }
+
       // In AUTO_FLUSH_BACKGROUND mode Apply() blocks if total would-be-used
       // buffer space is over the limit. Once amount of buffered data drops
       // below the limit, a blocking call to Apply() is unblocked.
@@ -470,14 +478,15 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
 
     // Add the operation to the current batcher. If the current batcher
     // is not there, allocate one and set it to be current.
+    //
+    // Wait until it's possible to add a new batcher given the limit on the
+    // maximum outstanding batchers per session, unless a concurrent Apply()
+    // call creates one in the meantime.
+    while (!batcher_ && batchers_num_limit_ != 0 &&
+           batchers_num_ >= batchers_num_limit_) {
+      condition_.Wait();
+    }
     if (!batcher_) {
-      while (batchers_num_limit_ != 0 &&
-             batchers_num_ >= batchers_num_limit_) {
-        // Wait until it's possible to add a new batcher given the limit
-        // on the maximum outstanding batchers per session.
-        condition_.Wait();
-      }
-      DCHECK(!batcher_);
       // Thread-safety note: the external_consistecy_mode_ and timeout_ms_
       // are not supposed to be accessed or modified from any other thread
       // no thread-safety is advertised for the kudu::KuduSession interface.
@@ -498,17 +507,22 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     }
     // Finally, update the buffer space usage.
     buffer_bytes_used_ += required_size;
-  }
 
-  if (flush_mode == AUTO_FLUSH_BACKGROUND) {
-    const size_t flush_watermark =
-        buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
-    // In AUTO_FLUSH_BACKGROUND mode it's necessary to flush the newly added
-    // operations if the flush watermark is reached. The current batcher is
-    // the exclusive and the only container for the newly added operations.
-    // All other batchers, if any, contain operations which are scheduled
-    // to be sent or already on their way to corresponding tablet servers.
-    FlushCurrentBatcher(flush_watermark, nullptr);
+    if (flush_mode == AUTO_FLUSH_BACKGROUND) {
+      const int64_t flush_watermark =
+          buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+      // In AUTO_FLUSH_BACKGROUND mode it's necessary to flush the newly added
+      // operations if the flush watermark is reached. The current batcher is
+      // the exclusive and the only container for the newly added operations.
+      // All other batchers, if any, contain operations which are scheduled
+      // to be sent or already on their way to corresponding tablet servers.
+      if (batcher_->buffer_bytes_used() >= flush_watermark) {
+        batcher_to_flush.swap(batcher_);
+      }
+    }
+  }
+  if (batcher_to_flush) {
+    batcher_to_flush->FlushAsync(nullptr);
   }
 
   return Status::OK();
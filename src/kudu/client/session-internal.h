@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -55,8 +56,8 @@ class KuduWriteOperation;
 // thread-safety in general, but it's thread-safe regarding the following
 // concurrent actions:
 //
-//  * calls to KuduSession::Apply():
-//    (there is at most one call at any moment, no concurrency is assumed here).
+//  * calls to KuduSession::Apply() in the AUTO_FLUSH_BACKGROUND and
+//    MANUAL_FLUSH modes (there can be multiple of those at any moment).
 //
 //  * activity of the time-based background flush task
 //    (there is at most one task running at any moment).
@@ -202,8 +203,9 @@ class KuduSession::Data {
   // Whether the flush task is active/scheduled.
   bool flush_task_active_; // protected by mutex_
 
-  // Current flush mode for the session's data.
-  FlushMode flush_mode_;  // protected by mutex_
+  // Current flush mode for the session's data. Modified under mutex_, but
+  // can be read without it.
+  std::atomic<FlushMode> flush_mode_;
 
   // Mutex for the condition_ member (the condition variable).
   // This lock protects variables from simultaneous access:
@@ -134,6 +134,7 @@ Status KuduTableAlterer::Data::ToRequest(AlterTableRequestPB* req) {
             !s.spec->data_->remove_default &&
             !s.spec->data_->encoding &&
             !s.spec->data_->compression &&
+            !s.spec->data_->compression_level &&
             !s.spec->data_->block_size &&
             !s.spec->data_->comment) {
           return Status::InvalidArgument("no alter operation specified",
@@ -146,6 +147,7 @@ Status KuduTableAlterer::Data::ToRequest(AlterTableRequestPB* req) {
             !s.spec->data_->remove_default &&
             !s.spec->data_->encoding &&
             !s.spec->data_->compression &&
+            !s.spec->data_->compression_level &&
             !s.spec->data_->block_size &&
             !s.spec->data_->comment) {
           pb_step->set_type(AlterTableRequestPB::RENAME_COLUMN);
@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 
 #include <boost/optional/optional.hpp>
 
@@ -63,6 +64,13 @@ class KuduTableStatistics::Data {
   const boost::optional<int64_t> on_disk_size_limit_;
   const boost::optional<int64_t> live_row_count_limit_;
 
+  struct ColumnStats {
+    int64_t num_distinct_values;
+    int64_t null_count;
+  };
+  // The statistics of the columns, keyed by column name.
+  std::unordered_map<string, ColumnStats> column_stats_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
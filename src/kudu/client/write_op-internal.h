@@ -17,15 +17,128 @@
 #ifndef KUDU_CLIENT_WRITE_OP_INTERNAL_H
 #define KUDU_CLIENT_WRITE_OP_INTERNAL_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/client/shared_ptr.h" // IWYU pragma: keep
 #include "kudu/client/write_op.h"
+#include "kudu/common/row_operations.pb.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 
+class KuduPartialRow;
+
 namespace client {
 
+class KuduTable;
+
+namespace internal {
+class ColumnarInsertOp;
+} // namespace internal
+
 RowOperationsPB_Type ToInternalWriteType(KuduWriteOperation::Type type);
 
+class KuduColumnarInsertBatch::Data {
+ public:
+  Data(sp::shared_ptr<KuduTable> table, int num_rows);
+
+  // Validates and sets the values of a column. 'is_varlen' is whether they
+  // were set with SetVarLenColumn().
+  Status SetColumn(int col_idx, bool is_varlen, const Slice& data,
+                   const Slice& varlen_data, const Slice& non_null_bitmap);
+
+  // Splits the rows into a write operation per tablet, or more if the rows
+  // of a tablet take more than 'max_op_bytes' of buffer space. Copies the
+  // data of the rows into the operations.
+  Status Split(size_t max_op_bytes,
+               std::vector<std::unique_ptr<internal::ColumnarInsertOp>>* ops) const;
+
+  struct Column {
+    bool is_set = false;
+    bool is_varlen = false;
+    Slice data;
+    Slice varlen_data;
+    Slice non_null_bitmap;
+  };
+
+  // Returns the values of the column at 'col_idx' of the table's schema.
+  const Column& column(int col_idx) const {
+    return columns_[col_idx];
+  }
+
+  const sp::shared_ptr<KuduTable> table_;
+  const int num_rows_;
+
+ private:
+  // Returns the number of bytes of buffer space taken by the row at 'row'.
+  int64_t RowSize(int row) const;
+
+  // Creates the operation inserting the rows at 'rows', copying their data.
+  std::unique_ptr<internal::ColumnarInsertOp> NewOp(const std::vector<int>& rows,
+                                                    int64_t size_in_buffer) const;
+
+  std::vector<Column> columns_;
+
+  // The buffer space taken by the fixed-length part of each row.
+  int64_t fixed_row_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+namespace internal {
+
+// The inserts of a block of rows of a columnar batch, all belonging to the
+// same tablet. Sent to the tablet server as a block in columnar form.
+//
+// The operation's row is its first row, to look up and validate the
+// operation as a whole.
+class ColumnarInsertOp : public KuduWriteOperation {
+ public:
+  ColumnarInsertOp(const sp::shared_ptr<KuduTable>& table,
+                   ColumnarRowOperationsPB block,
+                   int64_t size_in_buffer);
+  ~ColumnarInsertOp() override = default;
+
+  std::string ToString() const override;
+
+  const ColumnarRowOperationsPB& block() const { return block_; }
+  int num_rows() const { return block_.num_rows(); }
+
+  // Returns an insert of the block's row at 'idx', e.g. to report an error
+  // specific to that row.
+  std::unique_ptr<KuduInsert> NewRowInsert(int idx) const;
+
+  // Sets the column at 'col_idx' of 'row' to the value of the row at 'idx'
+  // of the column's data in columnar layout.
+  static Status SetFromColumn(int col_idx,
+                              const Slice& data,
+                              const Slice& varlen_data,
+                              const Slice& non_null_bitmap,
+                              int idx,
+                              KuduPartialRow* row);
+
+ protected:
+  Type type() const override {
+    return INSERT;
+  }
+
+ private:
+  // Sets all of the columns of 'row' to the values of the row at 'idx'.
+  Status SetRow(int idx, KuduPartialRow* row) const;
+
+  const ColumnarRowOperationsPB block_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarInsertOp);
+};
+
+} // namespace internal
 } // namespace client
 } // namespace kudu
 
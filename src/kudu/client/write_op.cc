@@ -17,22 +17,32 @@
 
 #include "kudu/client/write_op.h"
 
+#include <cstring>
 #include <ostream>
+#include <utility>
 
 #include <glog/logging.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/partitioner-internal.h"
 #include "kudu/client/schema.h"
+#include "kudu/client/write_op-internal.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/slice.h"
 
+using kudu::client::internal::ColumnarInsertOp;
 using kudu::client::sp::shared_ptr;
+using std::string;
 using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace client {
@@ -144,6 +154,269 @@ KuduUpsert::KuduUpsert(const shared_ptr<KuduTable>& table)
 
 KuduUpsert::~KuduUpsert() {}
 
+// ColumnarInsertBatch ----------------------------------------------------------
+
+KuduColumnarInsertBatch::KuduColumnarInsertBatch(const shared_ptr<KuduTable>& table,
+                                                 int num_rows)
+    : data_(new Data(table, num_rows)) {
+}
+
+KuduColumnarInsertBatch::~KuduColumnarInsertBatch() {
+  delete data_;
+}
+
+Status KuduColumnarInsertBatch::SetColumn(int col_idx, const Slice& data,
+                                          const Slice& non_null_bitmap) {
+  return data_->SetColumn(col_idx, false, data, Slice(), non_null_bitmap);
+}
+
+Status KuduColumnarInsertBatch::SetVarLenColumn(int col_idx, const Slice& offsets,
+                                                const Slice& varlen_data,
+                                                const Slice& non_null_bitmap) {
+  return data_->SetColumn(col_idx, true, offsets, varlen_data, non_null_bitmap);
+}
+
+int KuduColumnarInsertBatch::num_rows() const {
+  return data_->num_rows_;
+}
+
+KuduColumnarInsertBatch::Data::Data(shared_ptr<KuduTable> table, int num_rows)
+    : table_(std::move(table)),
+      num_rows_(num_rows),
+      fixed_row_size_(0) {
+  const Schema* schema = table_->schema().schema_;
+  columns_.resize(schema->num_columns());
+  int num_nullables = 0;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    const ColumnSchema& col = schema->column(i);
+    fixed_row_size_ += col.type_info()->physical_type() == BINARY ?
+        sizeof(uint32_t) : col.type_info()->size();
+    num_nullables += col.is_nullable() ? 1 : 0;
+  }
+  fixed_row_size_ += BitmapSize(num_nullables);
+}
+
+Status KuduColumnarInsertBatch::Data::SetColumn(int col_idx, bool is_varlen,
+                                                const Slice& data,
+                                                const Slice& varlen_data,
+                                                const Slice& non_null_bitmap) {
+  const Schema* schema = table_->schema().schema_;
+  if (PREDICT_FALSE(col_idx < 0 || col_idx >= schema->num_columns())) {
+    return Status::InvalidArgument(Substitute("invalid column index $0", col_idx));
+  }
+  const ColumnSchema& col = schema->column(col_idx);
+  if (PREDICT_FALSE(col.type_info()->type() == VARCHAR)) {
+    // The values would need to be truncated to the column's length, like
+    // KuduPartialRow::SetVarchar() does.
+    return Status::NotSupported("VARCHAR columns are not supported in columnar batches",
+                                col.name());
+  }
+  if (PREDICT_FALSE(is_varlen != (col.type_info()->physical_type() == BINARY))) {
+    return Status::InvalidArgument(Substitute(
+        "column '$0' of type $1 must be set with $2", col.name(), col.type_info()->name(),
+        is_varlen ? "SetColumn()" : "SetVarLenColumn()"));
+  }
+  if (is_varlen) {
+    if (PREDICT_FALSE(data.size() != (num_rows_ + 1) * sizeof(uint32_t))) {
+      return Status::InvalidArgument(Substitute(
+          "expected $0 offsets for column '$1', got $2 bytes",
+          num_rows_ + 1, col.name(), data.size()));
+    }
+    uint32_t prev = 0;
+    for (int i = 0; i <= num_rows_; i++) {
+      uint32_t offset = UnalignedLoad<uint32_t>(data.data() + i * sizeof(uint32_t));
+      if (PREDICT_FALSE(offset < prev || offset > varlen_data.size())) {
+        return Status::InvalidArgument(Substitute(
+            "bad offset $0 for row $1 of column '$2'", offset, i, col.name()));
+      }
+      prev = offset;
+    }
+  } else if (PREDICT_FALSE(data.size() != num_rows_ * col.type_info()->size())) {
+    return Status::InvalidArgument(Substitute(
+        "expected $0 bytes of data for column '$1', got $2",
+        num_rows_ * col.type_info()->size(), col.name(), data.size()));
+  }
+  if (!non_null_bitmap.empty()) {
+    if (PREDICT_FALSE(non_null_bitmap.size() < BitmapSize(num_rows_))) {
+      return Status::InvalidArgument(Substitute(
+          "non-null bitmap of column '$0' too small", col.name()));
+    }
+    if (PREDICT_FALSE(!col.is_nullable() &&
+                      !BitmapIsAllSet(non_null_bitmap.data(), 0, num_rows_))) {
+      return Status::InvalidArgument(Substitute(
+          "NULL value for non-nullable column '$0'", col.name()));
+    }
+  }
+
+  Column* column = &columns_[col_idx];
+  column->is_set = true;
+  column->is_varlen = is_varlen;
+  column->data = data;
+  column->varlen_data = varlen_data;
+  column->non_null_bitmap = non_null_bitmap;
+  return Status::OK();
+}
+
+int64_t KuduColumnarInsertBatch::Data::RowSize(int row) const {
+  int64_t size = fixed_row_size_;
+  for (const auto& column : columns_) {
+    if (column.is_varlen) {
+      size += UnalignedLoad<uint32_t>(column.data.data() + (row + 1) * sizeof(uint32_t)) -
+              UnalignedLoad<uint32_t>(column.data.data() + row * sizeof(uint32_t));
+    }
+  }
+  return size;
+}
+
+Status KuduColumnarInsertBatch::Data::Split(
+    size_t max_op_bytes, vector<unique_ptr<ColumnarInsertOp>>* ops) const {
+  const Schema* schema = table_->schema().schema_;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    if (PREDICT_FALSE(!columns_[i].is_set)) {
+      return Status::InvalidArgument(Substitute(
+          "column '$0' not set in columnar batch", schema->column(i).name()));
+    }
+  }
+
+  // Group the rows by the partition of their key.
+  KuduPartitioner* partitioner_raw;
+  RETURN_NOT_OK(KuduPartitionerBuilder(table_).Build(&partitioner_raw));
+  unique_ptr<KuduPartitioner> partitioner(partitioner_raw);
+  const int num_partitions = partitioner->NumPartitions();
+  // The rows not covered by any partition go last, as a group of their own:
+  // their operations fail to find a tablet.
+  vector<vector<int>> rows_by_partition(num_partitions + 1);
+  vector<int> partitions;
+  RETURN_NOT_OK(partitioner->data_->PartitionColumnarBatch(*this, &partitions));
+  for (int row = 0; row < num_rows_; row++) {
+    const int partition = partitions[row];
+    rows_by_partition[partition < 0 ? num_partitions : partition].push_back(row);
+  }
+
+  vector<unique_ptr<ColumnarInsertOp>> result;
+  for (const auto& partition_rows : rows_by_partition) {
+    vector<int> rows;
+    int64_t size = 0;
+    for (int row : partition_rows) {
+      int64_t row_size = RowSize(row);
+      if (!rows.empty() && size + row_size > max_op_bytes) {
+        result.emplace_back(NewOp(rows, size));
+        rows.clear();
+        size = 0;
+      }
+      rows.push_back(row);
+      size += row_size;
+    }
+    if (!rows.empty()) {
+      result.emplace_back(NewOp(rows, size));
+    }
+  }
+  *ops = std::move(result);
+  return Status::OK();
+}
+
+unique_ptr<ColumnarInsertOp> KuduColumnarInsertBatch::Data::NewOp(
+    const vector<int>& rows, int64_t size_in_buffer) const {
+  const Schema* schema = table_->schema().schema_;
+  const int num_rows = rows.size();
+  ColumnarRowOperationsPB block;
+  block.set_type(RowOperationsPB::INSERT);
+  block.set_num_rows(num_rows);
+  for (int i = 0; i < schema->num_columns(); i++) {
+    const Column& column = columns_[i];
+    auto* pb_col = block.add_columns();
+    string* data = pb_col->mutable_data();
+    if (schema->column(i).type_info()->physical_type() == BINARY) {
+      data->resize((num_rows + 1) * sizeof(uint32_t));
+      string* varlen_data = pb_col->mutable_varlen_data();
+      uint32_t offset = 0;
+      for (int j = 0; j < num_rows; j++) {
+        UnalignedStore(&(*data)[j * sizeof(uint32_t)], offset);
+        const uint8_t* src_offsets = column.data.data() + rows[j] * sizeof(uint32_t);
+        uint32_t start = UnalignedLoad<uint32_t>(src_offsets);
+        uint32_t end = UnalignedLoad<uint32_t>(src_offsets + sizeof(uint32_t));
+        varlen_data->append(reinterpret_cast<const char*>(column.varlen_data.data()) + start,
+                            end - start);
+        offset += end - start;
+      }
+      UnalignedStore(&(*data)[num_rows * sizeof(uint32_t)], offset);
+    } else {
+      const size_t size = schema->column(i).type_info()->size();
+      data->resize(num_rows * size);
+      for (int j = 0; j < num_rows; j++) {
+        memcpy(&(*data)[j * size], column.data.data() + rows[j] * size, size);
+      }
+    }
+    if (!column.non_null_bitmap.empty()) {
+      string* non_null_bitmap = pb_col->mutable_non_null_bitmap();
+      non_null_bitmap->assign(BitmapSize(num_rows), '\0');
+      auto* dst = reinterpret_cast<uint8_t*>(&(*non_null_bitmap)[0]);
+      for (int j = 0; j < num_rows; j++) {
+        BitmapChange(dst, j, BitmapTest(column.non_null_bitmap.data(), rows[j]));
+      }
+    }
+  }
+  return unique_ptr<ColumnarInsertOp>(
+      new ColumnarInsertOp(table_, std::move(block), size_in_buffer));
+}
+
+namespace internal {
+
+ColumnarInsertOp::ColumnarInsertOp(const shared_ptr<KuduTable>& table,
+                                   ColumnarRowOperationsPB block,
+                                   int64_t size_in_buffer)
+    : KuduWriteOperation(table),
+      block_(std::move(block)) {
+  DCHECK_GT(block_.num_rows(), 0);
+  size_in_buffer_ = size_in_buffer;
+  CHECK_OK(SetRow(0, &row_));
+}
+
+string ColumnarInsertOp::ToString() const {
+  return Substitute("INSERT of $0 rows in columnar form, starting with $1",
+                    num_rows(), row_.ToString());
+}
+
+unique_ptr<KuduInsert> ColumnarInsertOp::NewRowInsert(int idx) const {
+  unique_ptr<KuduInsert> insert(table_->NewInsert());
+  CHECK_OK(SetRow(idx, insert->mutable_row()));
+  return insert;
+}
+
+Status ColumnarInsertOp::SetRow(int idx, KuduPartialRow* row) const {
+  for (int i = 0; i < block_.columns_size(); i++) {
+    const auto& pb_col = block_.columns(i);
+    RETURN_NOT_OK(SetFromColumn(i, pb_col.data(), pb_col.varlen_data(),
+                                pb_col.non_null_bitmap(), idx, row));
+  }
+  return Status::OK();
+}
+
+Status ColumnarInsertOp::SetFromColumn(int col_idx,
+                                       const Slice& data,
+                                       const Slice& varlen_data,
+                                       const Slice& non_null_bitmap,
+                                       int idx,
+                                       KuduPartialRow* row) {
+  if (!non_null_bitmap.empty() && !BitmapTest(non_null_bitmap.data(), idx)) {
+    return row->SetNull(col_idx);
+  }
+  const TypeInfo* type_info = row->schema()->column(col_idx).type_info();
+  if (type_info->physical_type() == BINARY) {
+    const uint8_t* offsets = data.data() + idx * sizeof(uint32_t);
+    uint32_t start = UnalignedLoad<uint32_t>(offsets);
+    uint32_t end = UnalignedLoad<uint32_t>(offsets + sizeof(uint32_t));
+    Slice value(varlen_data.data() + start, end - start);
+    return row->Set(col_idx, reinterpret_cast<const uint8_t*>(&value));
+  }
+  // The cells of the column aren't necessarily aligned.
+  alignas(16) uint8_t cell[kLargestTypeSize];
+  memcpy(cell, data.data() + idx * type_info->size(), type_info->size());
+  return row->Set(col_idx, cell);
+}
+
+} // namespace internal
+
 
 } // namespace client
 } // namespace kudu
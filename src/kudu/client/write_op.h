@@ -41,10 +41,12 @@ namespace client {
 
 namespace internal {
 class Batcher;
+class ColumnarInsertOp;
 class ErrorCollector;
 class WriteRpc;
 } // namespace internal
 
+class KuduSession;
 class KuduTable;
 
 /// @brief A single-row write operation to be sent to a Kudu table.
@@ -120,6 +122,7 @@ class KUDU_EXPORT KuduWriteOperation {
 
  private:
   friend class internal::Batcher;
+  friend class internal::ColumnarInsertOp;
   friend class internal::WriteRpc;
   friend class internal::ErrorCollector;
   friend class KuduSession;
@@ -319,6 +322,84 @@ private:
   explicit KuduDeleteIgnore(const sp::shared_ptr<KuduTable>& table);
 };
 
+/// @brief A batch of rows to insert, specified column by column.
+///
+/// The values of each of the table's columns are set for all of the rows at
+/// once, in the same layout as the columnar scan batches returned by
+/// KuduColumnarScanBatch::GetFixedLengthColumn() and
+/// KuduColumnarScanBatch::GetVariableLengthColumn(). The batch is applied with
+/// KuduSession::ApplyColumnarBatch(), which splits its rows among the tablets
+/// of the table and sends them to the tablet servers in columnar form,
+/// without building a KuduPartialRow per row.
+///
+/// The batch doesn't copy the data it is given: the data must remain valid
+/// until the batch has been applied.
+///
+/// Typical usage example:
+/// @code
+///   KuduColumnarInsertBatch batch(table, num_rows);
+///   KUDU_CHECK_OK(batch.SetColumn(0, Slice(keys, num_rows * sizeof(int32_t))));
+///   KUDU_CHECK_OK(batch.SetVarLenColumn(1, Slice(offsets, (num_rows + 1) * sizeof(uint32_t)),
+///                                       Slice(strings, strings_size)));
+///   KUDU_CHECK_OK(session->ApplyColumnarBatch(batch));
+/// @endcode
+class KUDU_EXPORT KuduColumnarInsertBatch {
+ public:
+  /// Create a batch of rows to insert into a table.
+  ///
+  /// @param [in] table
+  ///   The table to insert the rows into.
+  /// @param [in] num_rows
+  ///   The number of rows in the batch.
+  KuduColumnarInsertBatch(const sp::shared_ptr<KuduTable>& table, int num_rows);
+  ~KuduColumnarInsertBatch();
+
+  /// Set the values of a fixed-length column.
+  ///
+  /// @param [in] col_idx
+  ///   The index of the column in the table's schema.
+  /// @param [in] data
+  ///   The values of the column, one cell per row in the canonical in-memory
+  ///   format of the column's type (e.g. an int32_t per row for an INT32
+  ///   column, a byte per row for a BOOL column). The cells of NULL values
+  ///   are ignored.
+  /// @param [in] non_null_bitmap
+  ///   For a nullable column, a bitmap with a set bit for each non-NULL
+  ///   value, with the first row's bit the least significant of the first
+  ///   byte. If empty, none of the values are NULL.
+  /// @return Operation result status.
+  Status SetColumn(int col_idx, const Slice& data,
+                   const Slice& non_null_bitmap = Slice()) WARN_UNUSED_RESULT;
+
+  /// Set the values of a STRING or BINARY column.
+  ///
+  /// @param [in] col_idx
+  ///   The index of the column in the table's schema.
+  /// @param [in] offsets
+  ///   The offsets of the values in @c varlen_data, as 'num_rows + 1'
+  ///   uint32_t: a row's value spans from its offset to the next row's.
+  /// @param [in] varlen_data
+  ///   The values of the column, concatenated.
+  /// @param [in] non_null_bitmap
+  ///   As with SetColumn().
+  /// @return Operation result status.
+  Status SetVarLenColumn(int col_idx, const Slice& offsets, const Slice& varlen_data,
+                         const Slice& non_null_bitmap = Slice()) WARN_UNUSED_RESULT;
+
+  /// @return The number of rows in the batch.
+  int num_rows() const;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  friend class KuduPartitioner;
+  friend class KuduSession;
+
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnarInsertBatch);
+};
+
 } // namespace client
 } // namespace kudu
 
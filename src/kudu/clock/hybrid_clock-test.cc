@@ -48,6 +48,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/scoped_cleanup.h"
@@ -57,6 +58,9 @@
 
 DECLARE_bool(inject_unsync_time_errors);
 DECLARE_string(builtin_ntp_servers);
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+DECLARE_string(ptp_device);
+#endif
 DECLARE_string(time_source);
 DECLARE_uint32(cloud_metadata_server_request_timeout_ms);
 METRIC_DECLARE_entity(server);
@@ -578,5 +582,18 @@ TEST_F(HybridClockTest, TestNtpDiagnostics) {
 }
 #endif // #if defined(KUDU_HAS_SYSTEM_TIME_SOURCE) ...
 
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+// The 'ptp' time source should fail to initialize, rather than fall back to
+// some other clock, if its PTP hardware clock can't be read.
+TEST_F(HybridClockTest, PtpTimeSourceWithoutDevice) {
+  FLAGS_time_source = "ptp";
+  FLAGS_ptp_device = JoinPathSegments(test_dir_, "ptp-nonexistent");
+  HybridClock clock(metric_entity_);
+  const auto s = clock.Init();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "unable to open PTP clock");
+}
+#endif // #if defined(KUDU_HAS_PTP_TIME_SOURCE) ...
+
 }  // namespace clock
 }  // namespace kudu
@@ -31,6 +31,9 @@
 
 #include "kudu/clock/builtin_ntp.h"
 #include "kudu/clock/mock_ntp.h"
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+#include "kudu/clock/ptp_time.h"
+#endif
 #include "kudu/clock/system_ntp.h"
 #include "kudu/clock/system_unsync_time.h"
 #include "kudu/gutil/macros.h"
@@ -66,6 +69,7 @@ using strings::Substitute;
 #define TIME_SOURCE_NTP_SYNC_SYSTEM "system"
 #define TIME_SOURCE_UNSYNC_SYSTEM "system_unsync"
 #define TIME_SOURCE_MOCK "mock"
+#define TIME_SOURCE_PTP "ptp"
 
 DEFINE_int32(max_clock_sync_error_usec, 10 * 1000 * 1000, // 10 secs
              "Maximum allowed clock synchronization error as reported by NTP "
@@ -103,6 +107,9 @@ DEFINE_string(time_source,
               TIME_SOURCE_NTP_SYNC_BUILTIN ", "
 #if defined(KUDU_HAS_SYSTEM_TIME_SOURCE)
               TIME_SOURCE_NTP_SYNC_SYSTEM ", "
+#endif
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+              TIME_SOURCE_PTP " (experimental), "
 #endif
               TIME_SOURCE_UNSYNC_SYSTEM " (toy clusters/testing only), "
               TIME_SOURCE_MOCK " (testing only). "
@@ -123,6 +130,9 @@ DEFINE_validator(time_source, [](const char* flag_name, const string& value) {
       iequals(value, TIME_SOURCE_NTP_SYNC_BUILTIN) ||
 #if defined(KUDU_HAS_SYSTEM_TIME_SOURCE)
       iequals(value, TIME_SOURCE_NTP_SYNC_SYSTEM) ||
+#endif
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+      iequals(value, TIME_SOURCE_PTP) ||
 #endif
       iequals(value, TIME_SOURCE_UNSYNC_SYSTEM) ||
       iequals(value, TIME_SOURCE_MOCK)) {
@@ -134,6 +144,9 @@ DEFINE_validator(time_source, [](const char* flag_name, const string& value) {
                            TIME_SOURCE_NTP_SYNC_BUILTIN ", "
 #if defined(KUDU_HAS_SYSTEM_TIME_SOURCE)
                            TIME_SOURCE_NTP_SYNC_SYSTEM ", "
+#endif
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+                           TIME_SOURCE_PTP ", "
 #endif
                            TIME_SOURCE_UNSYNC_SYSTEM ", "
                            TIME_SOURCE_MOCK ")",
@@ -520,6 +533,10 @@ Status HybridClock::SelectTimeSource(const string& time_source_str,
 #if defined(KUDU_HAS_SYSTEM_TIME_SOURCE)
   } else if (iequals(time_source_str, TIME_SOURCE_NTP_SYNC_SYSTEM)) {
     result_time_source = TimeSource::NTP_SYNC_SYSTEM;
+#endif
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+  } else if (iequals(time_source_str, TIME_SOURCE_PTP)) {
+    result_time_source = TimeSource::PTP;
 #endif
   } else if (iequals(time_source_str, TIME_SOURCE_UNSYNC_SYSTEM)) {
     result_time_source = TimeSource::UNSYNC_SYSTEM;
@@ -544,6 +561,11 @@ Status HybridClock::InitWithTimeSource(TimeSource time_source) {
     case TimeSource::NTP_SYNC_SYSTEM:
       time_service_.reset(new clock::SystemNtp);
       break;
+#endif
+#if defined(KUDU_HAS_PTP_TIME_SOURCE)
+    case TimeSource::PTP:
+      time_service_.reset(new clock::PtpTime);
+      break;
 #endif
     case TimeSource::UNSYNC_SYSTEM:
       time_service_.reset(new clock::SystemUnsyncTime);
@@ -770,6 +792,8 @@ const char* HybridClock::TimeSourceToString(TimeSource time_source) {
       return TIME_SOURCE_NTP_SYNC_BUILTIN;
     case TimeSource::NTP_SYNC_SYSTEM:
       return TIME_SOURCE_NTP_SYNC_SYSTEM;
+    case TimeSource::PTP:
+      return TIME_SOURCE_PTP;
     case TimeSource::UNSYNC_SYSTEM:
       return TIME_SOURCE_UNSYNC_SYSTEM;
     case TimeSource::MOCK:
@@ -175,6 +175,9 @@ class HybridClock : public Clock {
     // Local machine clock synchronized by NTP.
     NTP_SYNC_SYSTEM,
 
+    // PTP hardware clock, e.g. of a NIC synchronized by PTP.
+    PTP,
+
     // Local machine clock with no requirement of NTP synchronization.
     UNSYNC_SYSTEM,
 
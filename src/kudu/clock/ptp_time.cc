@@ -0,0 +1,179 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/clock/ptp_time.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/status.h"
+
+DEFINE_string(ptp_device, "/dev/ptp0",
+              "The PTP hardware clock device which the 'ptp' time source reads.");
+TAG_FLAG(ptp_device, experimental);
+
+DEFINE_uint32(ptp_max_error_usec, 100,
+              "The maximum error of the PTP hardware clock in --ptp_device "
+              "relative to true time, in microseconds, as guaranteed by the "
+              "PTP deployment which synchronizes it. The error bound of the "
+              "'ptp' time source is this plus the time it takes to read the "
+              "clock.");
+TAG_FLAG(ptp_max_error_usec, experimental);
+TAG_FLAG(ptp_max_error_usec, runtime);
+
+DEFINE_int32(ptp_utc_offset_sec, 0,
+             "The number of seconds by which the PTP hardware clock in "
+             "--ptp_device is ahead of UTC. Set it to the TAI-UTC offset "
+             "(37 seconds since 2017) if the clock keeps TAI, as it does when "
+             "synchronized by linuxptp with its default settings.");
+TAG_FLAG(ptp_utc_offset_sec, experimental);
+
+DEFINE_uint32(ptp_max_system_clock_offset_ms, 1000,
+              "The 'ptp' time source refuses to start if the PTP hardware "
+              "clock and the system clock differ by more than this number of "
+              "milliseconds, which suggests that --ptp_utc_offset_sec is wrong "
+              "or that one of the clocks isn't synchronized. 0 disables the "
+              "check.");
+TAG_FLAG(ptp_max_system_clock_offset_ms, advanced);
+TAG_FLAG(ptp_max_system_clock_offset_ms, experimental);
+
+DECLARE_bool(inject_unsync_time_errors);
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace clock {
+
+namespace {
+
+// The dynamic clock ID of the clock device open at 'fd'; see FD_TO_CLOCKID in
+// the kernel's Documentation/ptp/testptp.c.
+clockid_t FdToClockId(int fd) {
+  return static_cast<clockid_t>((~static_cast<unsigned int>(fd) << 3) | 3);
+}
+
+int64_t TimespecToNanos(const struct timespec& ts) {
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+} // anonymous namespace
+
+PtpTime::PtpTime()
+    : fd_(-1),
+      clock_id_(CLOCK_REALTIME) {
+}
+
+PtpTime::~PtpTime() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Status PtpTime::Init() {
+  RETRY_ON_EINTR(fd_, open(FLAGS_ptp_device.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd_ < 0) {
+    const int err = errno;
+    return Status::IOError(Substitute("unable to open PTP clock $0", FLAGS_ptp_device),
+                           ErrnoToString(err), err);
+  }
+  clock_id_ = FdToClockId(fd_);
+
+  uint64_t now_usec;
+  uint64_t read_usec;
+  RETURN_NOT_OK_PREPEND(ReadClock(&now_usec, &read_usec),
+                        Substitute("unable to read PTP clock $0", FLAGS_ptp_device));
+  if (FLAGS_ptp_max_system_clock_offset_ms > 0) {
+    const int64_t offset_usec =
+        static_cast<int64_t>(now_usec) - static_cast<int64_t>(GetCurrentTimeMicros());
+    if (std::abs(offset_usec) >
+        static_cast<int64_t>(FLAGS_ptp_max_system_clock_offset_ms) * 1000) {
+      return Status::IllegalState(Substitute(
+          "PTP clock $0 is $1us off the system clock: check --ptp_utc_offset_sec "
+          "and the synchronization of the clocks", FLAGS_ptp_device, offset_usec));
+    }
+  }
+  LOG(INFO) << Substitute("Using PTP clock $0 with a maximum error of $1us",
+                          FLAGS_ptp_device, FLAGS_ptp_max_error_usec);
+  return Status::OK();
+}
+
+Status PtpTime::ReadClock(uint64_t* now_usec, uint64_t* read_usec) const {
+  struct timespec before;
+  struct timespec phc;
+  struct timespec after;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &before);
+  if (PREDICT_FALSE(clock_gettime(clock_id_, &phc) != 0)) {
+    const int err = errno;
+    return Status::ServiceUnavailable(
+        Substitute("unable to read PTP clock $0", FLAGS_ptp_device),
+        ErrnoToString(err), err);
+  }
+  clock_gettime(CLOCK_MONOTONIC_RAW, &after);
+  *now_usec = TimespecToNanos(phc) / 1000 -
+      static_cast<int64_t>(FLAGS_ptp_utc_offset_sec) * 1000000;
+  // Round up: the reading was taken at some point between 'before' and 'after'.
+  *read_usec = (TimespecToNanos(after) - TimespecToNanos(before) + 999) / 1000;
+  return Status::OK();
+}
+
+Status PtpTime::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
+  if (PREDICT_FALSE(FLAGS_inject_unsync_time_errors)) {
+    return Status::ServiceUnavailable("Injected clock unsync error");
+  }
+  uint64_t read_usec;
+  RETURN_NOT_OK(ReadClock(now_usec, &read_usec));
+  *error_usec = FLAGS_ptp_max_error_usec + read_usec;
+  return Status::OK();
+}
+
+void PtpTime::DumpDiagnostics(vector<string>* log) const {
+  LOG_STRING(ERROR, log) << "Dumping PTP clock diagnostics";
+  uint64_t now_usec;
+  uint64_t read_usec;
+  const Status s = ReadClock(&now_usec, &read_usec);
+  if (!s.ok()) {
+    LOG_STRING(ERROR, log) << s.ToString();
+    return;
+  }
+  LOG_STRING(ERROR, log) << Substitute(
+      "PTP clock $0: $1us ahead of the system clock, read in $2us "
+      "(--ptp_utc_offset_sec=$3, --ptp_max_error_usec=$4)",
+      FLAGS_ptp_device,
+      static_cast<int64_t>(now_usec) - static_cast<int64_t>(GetCurrentTimeMicros()),
+      read_usec, FLAGS_ptp_utc_offset_sec, FLAGS_ptp_max_error_usec);
+}
+
+} // namespace clock
+} // namespace kudu
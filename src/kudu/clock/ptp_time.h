@@ -0,0 +1,70 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <time.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/clock/time_service.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace clock {
+
+// TimeService implementation which reads a PTP hardware clock (PHC), e.g. the
+// clock of a NIC synchronized by ptp4l with a PTP grandmaster, or the PHC some
+// cloud providers expose through the network adapters of their instances.
+//
+// The kernel doesn't track how well a PHC is synchronized, so the error bound
+// is the one configured with --ptp_max_error_usec, plus the time it takes to
+// read the clock. The bound must be one the PTP deployment guarantees: PTP
+// typically keeps clocks within microseconds of their reference, so this
+// time source makes for much tighter error bounds than NTP.
+class PtpTime : public TimeService {
+ public:
+  PtpTime();
+  ~PtpTime() override;
+
+  Status Init() override;
+
+  Status WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) override;
+
+  int64_t skew_ppm() const override {
+    return 500; // Reasonable default value.
+  }
+
+  void DumpDiagnostics(std::vector<std::string>* log) const override;
+
+ private:
+  // Reads the PHC, returning the UTC time it keeps in '*now_usec' and how long
+  // reading it took in '*read_usec'.
+  Status ReadClock(uint64_t* now_usec, uint64_t* read_usec) const;
+
+  // The file descriptor of the PHC device, and the dynamic clock ID derived
+  // from it.
+  int fd_;
+  clockid_t clock_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(PtpTime);
+};
+
+} // namespace clock
+} // namespace kudu
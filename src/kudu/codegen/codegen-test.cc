@@ -54,6 +54,8 @@ using std::vector;
 
 DECLARE_bool(codegen_dump_mc);
 DECLARE_int32(codegen_cache_capacity);
+DECLARE_int32(codegen_compile_time_budget_ms_per_min);
+DECLARE_int32(codegen_min_requests_to_compile);
 
 namespace kudu {
 
@@ -430,4 +432,39 @@ TEST_F(CodegenTest, TestCodeCache) {
   }
 }
 
+// Test that projections are only compiled once they've been requested
+// --codegen_min_requests_to_compile times, and not at all once the compilation
+// time budget is used up.
+TEST_F(CodegenTest, TestCompilationAdmission) {
+  Singleton<CompilationManager>::UnsafeReset();
+  FLAGS_codegen_min_requests_to_compile = 3;
+  CompilationManager* cm = CompilationManager::GetSingleton();
+
+  Schema projection;
+  ASSERT_OK(CreatePartialSchema({ 0, 1 }, &projection));
+  unique_ptr<CodegenRP> projector;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_FALSE(cm->RequestRowProjector(&base_, &projection, &projector));
+    cm->Wait();
+  }
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &projection, &projector));
+
+  // Compiling a projection takes well over a millisecond, so the first
+  // compilation uses up the whole budget.
+  FLAGS_codegen_min_requests_to_compile = 1;
+  FLAGS_codegen_compile_time_budget_ms_per_min = 1;
+  Schema second_projection;
+  ASSERT_OK(CreatePartialSchema({ 1, 2 }, &second_projection));
+  ASSERT_FALSE(cm->RequestRowProjector(&base_, &second_projection, &projector));
+  cm->Wait();
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &second_projection, &projector));
+
+  Schema third_projection;
+  ASSERT_OK(CreatePartialSchema({ 2, 3 }, &third_projection));
+  for (int i = 0; i < 3; i++) {
+    ASSERT_FALSE(cm->RequestRowProjector(&base_, &third_projection, &projector));
+    cm->Wait();
+  }
+}
+
 } // namespace kudu
@@ -20,8 +20,10 @@
 #include <cstdlib>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <utility>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -43,8 +45,10 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/threadpool.h"
 
+using std::function;
 using std::make_shared;
 using std::shared_ptr;
+using std::string;
 using std::unique_ptr;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
@@ -60,6 +64,23 @@ DEFINE_int32(codegen_queue_capacity, 100, "Number of tasks which may be put in t
              "generation task queue.");
 TAG_FLAG(codegen_queue_capacity, experimental);
 
+DEFINE_int32(codegen_min_requests_to_compile, 1,
+             "Number of times a row projection has to be requested without "
+             "being found in the code cache before it is compiled. Raising it "
+             "keeps the compiler from spending time on projections which are "
+             "only used by a few scans.");
+TAG_FLAG(codegen_min_requests_to_compile, experimental);
+TAG_FLAG(codegen_min_requests_to_compile, runtime);
+
+DEFINE_int32(codegen_compile_time_budget_ms_per_min, 0,
+             "Maximum time spent compiling row projections per minute, in "
+             "milliseconds. Once the compilations of the current minute have "
+             "used up the budget, further projections are not compiled until "
+             "the next minute, and the scans use the generic projector. If "
+             "set to 0, there is no limit.");
+TAG_FLAG(codegen_compile_time_budget_ms_per_min, experimental);
+TAG_FLAG(codegen_compile_time_budget_ms_per_min, runtime);
+
 METRIC_DEFINE_gauge_int64(server, code_cache_hits, "Codegen Cache Hits",
                           kudu::MetricUnit::kCacheHits,
                           "Number of codegen cache hits since start",
@@ -82,13 +103,15 @@ namespace {
 class CompilationTask {
  public:
   // Requires that the cache and generator are valid for the lifetime
-  // of this object.
+  // of this object. 'compiled_cb' is called with the time the compilation
+  // took, if the code was compiled.
   CompilationTask(const Schema& base, const Schema& proj, CodeCache* cache,
-                  CodeGenerator* generator)
+                  CodeGenerator* generator, function<void(MonoDelta)> compiled_cb)
     : base_(base),
       proj_(proj),
       cache_(cache),
-      generator_(generator) {}
+      generator_(generator),
+      compiled_cb_(std::move(compiled_cb)) {}
 
   // Can only be run once.
   void Run() {
@@ -112,9 +135,11 @@ class CompilationTask {
     if (cache_->Lookup(key)) return Status::OK();
 
     scoped_refptr<RowProjectorFunctions> functions;
+    const MonoTime start = MonoTime::Now();
     LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating row projector") {
       RETURN_NOT_OK(generator_->CompileRowProjector(base_, proj_, &functions));
     }
+    compiled_cb_(MonoTime::Now() - start);
 
     RETURN_NOT_OK(cache_->AddEntry(functions));
     return Status::OK();
@@ -124,6 +149,7 @@ class CompilationTask {
   Schema proj_;
   CodeCache* const cache_;
   CodeGenerator* const generator_;
+  const function<void(MonoDelta)> compiled_cb_;
 
   DISALLOW_COPY_AND_ASSIGN(CompilationTask);
 };
@@ -133,7 +159,9 @@ class CompilationTask {
 CompilationManager::CompilationManager()
   : cache_(FLAGS_codegen_cache_capacity),
     hit_counter_(0),
-    query_counter_(0) {
+    query_counter_(0),
+    budget_window_start_(MonoTime::Now()),
+    budget_window_compile_time_ms_(0) {
   CHECK_OK(ThreadPoolBuilder("compiler_manager_pool")
            .set_min_threads(0)
            .set_max_threads(1)
@@ -189,8 +217,12 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
 
   // If not cached, add a request to compilation pool
   if (!cached) {
+    if (!AdmitCompilation(key)) {
+      return false;
+    }
     shared_ptr<CompilationTask> task(make_shared<CompilationTask>(
-        *base_schema, *projection, &cache_, &generator_));
+        *base_schema, *projection, &cache_, &generator_,
+        [this](MonoDelta elapsed) { this->RecordCompilationTime(elapsed); }));
     WARN_NOT_OK_EVERY_N_SECS(pool_->Submit([task]() { task->Run(); }),
                     "RowProjector compilation request submit failed", 10);
     return false;
@@ -202,5 +234,42 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+bool CompilationManager::AdmitCompilation(const faststring& key) {
+  // Bounds the memory used to count the misses of projections which are
+  // requested too rarely to ever be compiled.
+  static constexpr size_t kMaxTrackedKeys = 10000;
+
+  const int min_requests = FLAGS_codegen_min_requests_to_compile;
+  const int budget_ms = FLAGS_codegen_compile_time_budget_ms_per_min;
+  std::lock_guard<simple_spinlock> l(admission_lock_);
+  if (budget_ms > 0) {
+    const MonoTime now = MonoTime::Now();
+    if (now - budget_window_start_ >= MonoDelta::FromSeconds(60)) {
+      budget_window_start_ = now;
+      budget_window_compile_time_ms_ = 0;
+    }
+    if (budget_window_compile_time_ms_ >= budget_ms) {
+      return false;
+    }
+  }
+  if (min_requests > 1) {
+    if (miss_counts_.size() >= kMaxTrackedKeys) {
+      miss_counts_.clear();
+    }
+    const string key_str = key.ToString();
+    int& misses = miss_counts_[key_str];
+    if (++misses < min_requests) {
+      return false;
+    }
+    miss_counts_.erase(key_str);
+  }
+  return true;
+}
+
+void CompilationManager::RecordCompilationTime(MonoDelta elapsed) {
+  std::lock_guard<simple_spinlock> l(admission_lock_);
+  budget_window_compile_time_ms_ += elapsed.ToMilliseconds();
+}
+
 } // namespace codegen
 } // namespace kudu
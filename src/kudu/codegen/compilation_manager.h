@@ -18,6 +18,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
@@ -25,11 +27,14 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
 class MetricEntity;
+class faststring;
 class Schema;
 class ThreadPool;
 
@@ -72,6 +77,11 @@ class CompilationManager {
   // schemas in the CompilationManager's thread pool and returns
   // false. Upon any failure, false is returned.
   // Does not write to 'out' if false is returned.
+  //
+  // The compilation task is only enqueued if the projection has been requested
+  // --codegen_min_requests_to_compile times without being cached, and the
+  // compilations of the last minute took less than
+  // --codegen_compile_time_budget_ms_per_min.
   bool RequestRowProjector(const Schema* base_schema,
                            const Schema* projection,
                            std::unique_ptr<RowProjector>* out);
@@ -91,6 +101,13 @@ class CompilationManager {
 
   static void Shutdown();
 
+  // Returns whether the code for 'key' should be compiled now, as per the
+  // admission flags (see RequestRowProjector()).
+  bool AdmitCompilation(const faststring& key);
+
+  // Accounts for a compilation which took 'elapsed' against the budget.
+  void RecordCompilationTime(MonoDelta elapsed);
+
   CodeGenerator generator_;
   CodeCache cache_;
   std::unique_ptr<ThreadPool> pool_;
@@ -98,6 +115,17 @@ class CompilationManager {
   AtomicInt<int64_t> hit_counter_;
   AtomicInt<int64_t> query_counter_;
 
+  simple_spinlock admission_lock_;
+
+  // The number of cache misses of each key not yet admitted for compilation.
+  // Protected by 'admission_lock_'.
+  std::unordered_map<std::string, int> miss_counts_;
+
+  // The start of the current one-minute window of the compilation time
+  // budget, and the time spent compiling in it. Protected by 'admission_lock_'.
+  MonoTime budget_window_start_;
+  int64_t budget_window_compile_time_ms_;
+
   static const int kThreadTimeoutMs = 100;
 
   DISALLOW_COPY_AND_ASSIGN(CompilationManager);
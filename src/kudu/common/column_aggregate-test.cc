@@ -0,0 +1,316 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_aggregate.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <boost/optional/optional.hpp>
+#include <gtest/gtest.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+
+class ColumnAggregateTest : public ::testing::Test {
+ public:
+  ColumnAggregateTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("int_val", INT64, /*is_nullable=*/true),
+                  ColumnSchema("double_val", DOUBLE),
+                  ColumnSchema("string_val", STRING, /*is_nullable=*/true) },
+                1),
+        block_(&schema_, kNumRows, &mem_) {
+  }
+
+  void SetUp() override {
+    // Row 'i' has key i, int_val i * 10 (NULL for every third row),
+    // double_val i / 2 and string_val "s<i>" (NULL for row 0).
+    for (int i = 0; i < kNumRows; i++) {
+      RowBlockRow row = block_.row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+
+      bool int_null = i % 3 == 0;
+      block_.column_block(1).SetCellIsNull(i, int_null);
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) = i * 10;
+
+      *reinterpret_cast<double*>(row.mutable_cell_ptr(2)) = i / 2.0;
+
+      strings_[i] = "s" + std::to_string(i);
+      block_.column_block(3).SetCellIsNull(i, i == 0);
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(3)) = Slice(strings_[i]);
+    }
+    block_.selection_vector()->SetAllTrue();
+  }
+
+ protected:
+  ColumnAggregateResultPB Aggregate(const ColumnAggregatePB& pb) {
+    boost::optional<ColumnAggregate> aggregate;
+    CHECK_OK(ColumnAggregateFromPB(schema_, pb, &aggregate));
+    unique_ptr<ColumnAggregator> aggregator;
+    CHECK_OK(ColumnAggregator::Create(*aggregate, schema_, &aggregator));
+    aggregator->AddRowBlock(block_);
+    ColumnAggregateResultPB result;
+    aggregator->ToPB(&result);
+    return result;
+  }
+
+  static ColumnAggregatePB MakePB(ColumnAggregatePB::Type type, const string& column) {
+    ColumnAggregatePB pb;
+    pb.set_type(type);
+    if (!column.empty()) {
+      pb.set_column(column);
+    }
+    return pb;
+  }
+
+  static constexpr int kNumRows = 10;
+
+  const Schema schema_;
+  RowBlockMemory mem_;
+  RowBlock block_;
+  string strings_[kNumRows];
+};
+
+TEST_F(ColumnAggregateTest, TestCount) {
+  ASSERT_EQ(kNumRows, Aggregate(MakePB(ColumnAggregatePB::COUNT, "")).count());
+  // Rows 0, 3, 6 and 9 have a NULL int_val.
+  ASSERT_EQ(6, Aggregate(MakePB(ColumnAggregatePB::COUNT, "int_val")).count());
+
+  // Unselected rows are not counted.
+  block_.selection_vector()->SetRowUnselected(1);
+  block_.selection_vector()->SetRowUnselected(3);
+  ASSERT_EQ(8, Aggregate(MakePB(ColumnAggregatePB::COUNT, "")).count());
+  ASSERT_EQ(5, Aggregate(MakePB(ColumnAggregatePB::COUNT, "int_val")).count());
+}
+
+TEST_F(ColumnAggregateTest, TestCountFromMetadata) {
+  boost::optional<ColumnAggregate> aggregate;
+  ASSERT_OK(ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::COUNT, ""), &aggregate));
+  unique_ptr<ColumnAggregator> aggregator;
+  ASSERT_OK(ColumnAggregator::Create(*aggregate, schema_, &aggregator));
+  ASSERT_TRUE(aggregator->counts_all_rows());
+  aggregator->AddRowCount(1000);
+  aggregator->AddRowBlock(block_);
+  ASSERT_EQ(1000 + kNumRows, aggregator->count());
+
+  ASSERT_OK(ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::COUNT, "int_val"),
+                                  &aggregate));
+  ASSERT_OK(ColumnAggregator::Create(*aggregate, schema_, &aggregator));
+  ASSERT_FALSE(aggregator->counts_all_rows());
+}
+
+TEST_F(ColumnAggregateTest, TestSum) {
+  auto result = Aggregate(MakePB(ColumnAggregatePB::SUM, "int_val"));
+  ASSERT_EQ(6, result.count());
+  ASSERT_EQ((1 + 2 + 4 + 5 + 7 + 8) * 10, result.int_sum());
+  ASSERT_FALSE(result.has_double_sum());
+
+  result = Aggregate(MakePB(ColumnAggregatePB::SUM, "double_val"));
+  ASSERT_EQ(kNumRows, result.count());
+  ASSERT_DOUBLE_EQ(45 / 2.0, result.double_sum());
+  ASSERT_FALSE(result.has_int_sum());
+}
+
+TEST_F(ColumnAggregateTest, TestMinMax) {
+  auto result = Aggregate(MakePB(ColumnAggregatePB::MIN, "int_val"));
+  ASSERT_EQ(6, result.count());
+  int64_t value;
+  ASSERT_EQ(sizeof(value), result.value().size());
+  memcpy(&value, result.value().data(), sizeof(value));
+  ASSERT_EQ(10, value);
+
+  result = Aggregate(MakePB(ColumnAggregatePB::MAX, "int_val"));
+  memcpy(&value, result.value().data(), sizeof(value));
+  ASSERT_EQ(80, value);
+
+  // Strings compare lexicographically; row 0 is NULL.
+  ASSERT_EQ("s1", Aggregate(MakePB(ColumnAggregatePB::MIN, "string_val")).value());
+  ASSERT_EQ("s9", Aggregate(MakePB(ColumnAggregatePB::MAX, "string_val")).value());
+
+  // An aggregate over no values has no result value.
+  block_.selection_vector()->SetAllFalse();
+  result = Aggregate(MakePB(ColumnAggregatePB::MAX, "string_val"));
+  ASSERT_EQ(0, result.count());
+  ASSERT_FALSE(result.has_value());
+}
+
+// Test that partial results accumulate across multiple blocks, and that
+// MIN/MAX values survive the reuse of the block's memory.
+TEST_F(ColumnAggregateTest, TestMultipleBlocks) {
+  boost::optional<ColumnAggregate> aggregate;
+  ASSERT_OK(ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::MAX, "string_val"),
+                                  &aggregate));
+  unique_ptr<ColumnAggregator> aggregator;
+  ASSERT_OK(ColumnAggregator::Create(*aggregate, schema_, &aggregator));
+  aggregator->AddRowBlock(block_);
+  for (int i = 0; i < kNumRows; i++) {
+    strings_[i] = "a";
+    *reinterpret_cast<Slice*>(block_.row(i).mutable_cell_ptr(3)) = Slice(strings_[i]);
+  }
+  aggregator->AddRowBlock(block_);
+  ColumnAggregateResultPB result;
+  aggregator->ToPB(&result);
+  ASSERT_EQ(18, result.count());
+  ASSERT_EQ("s9", result.value());
+}
+
+TEST_F(ColumnAggregateTest, TestInvalidAggregates) {
+  boost::optional<ColumnAggregate> aggregate;
+  Status s = ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::SUM, "string_val"),
+                                   &aggregate);
+  ASSERT_TRUE(s.IsNotSupported()) << s.ToString();
+
+  s = ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::MIN, ""), &aggregate);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::MIN, "missing"), &aggregate);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::UNKNOWN, "key"), &aggregate);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // The aggregated column must be part of the RowBlock schema.
+  ASSERT_OK(ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::MAX, "key"), &aggregate));
+  Schema projection({ ColumnSchema("int_val", INT64, /*is_nullable=*/true) }, 0);
+  unique_ptr<ColumnAggregator> aggregator;
+  s = ColumnAggregator::Create(*aggregate, projection, &aggregator);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ColumnAggregateTest, TestGroupBy) {
+  // Row 'i' has g "a", "b" or "c" for i % 3, h i % 2, and v i * 10 (NULL for
+  // row 0), so that each of the 6 groups of (g, h) has the rows i and i + 6.
+  const int kGroupedRows = 12;
+  const Schema schema({ ColumnSchema("g", STRING),
+                        ColumnSchema("h", INT32),
+                        ColumnSchema("v", INT64, /*is_nullable=*/true) },
+                      0);
+  RowBlock block(&schema, kGroupedRows, &mem_);
+  const string names[] = { "a", "b", "c" };
+  for (int i = 0; i < kGroupedRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(0)) = Slice(names[i % 3]);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(1)) = i % 2;
+    block.column_block(2).SetCellIsNull(i, i == 0);
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = i * 10;
+  }
+  block.selection_vector()->SetAllTrue();
+
+  boost::optional<ColumnAggregate> sum;
+  ASSERT_OK(ColumnAggregateFromPB(schema, MakePB(ColumnAggregatePB::SUM, "v"), &sum));
+  boost::optional<ColumnAggregate> max;
+  ASSERT_OK(ColumnAggregateFromPB(schema, MakePB(ColumnAggregatePB::MAX, "v"), &max));
+  unique_ptr<GroupedColumnAggregator> aggregator;
+  ASSERT_OK(GroupedColumnAggregator::Create({ ColumnAggregate::CountAll(), *sum, *max },
+                                            { schema.column(0), schema.column(1) },
+                                            schema, &aggregator));
+  aggregator->AddRowBlock(block);
+  // The second block only adds rows to the existing groups.
+  block.selection_vector()->SetRowUnselected(11);
+  aggregator->AddRowBlock(block);
+  ASSERT_EQ(6, aggregator->num_groups());
+
+  google::protobuf::RepeatedPtrField<ColumnAggregateGroupPB> groups;
+  aggregator->ToPB(&groups);
+  ASSERT_EQ(6, groups.size());
+  for (const auto& group : groups) {
+    ASSERT_EQ(2, group.keys_size());
+    ASSERT_EQ(3, group.results_size());
+    int32_t h;
+    ASSERT_EQ(sizeof(h), group.keys(1).value().size());
+    memcpy(&h, group.keys(1).value().data(), sizeof(h));
+    // The first row of the group.
+    int first = 0;
+    while (names[first % 3] != group.keys(0).value() || first % 2 != h) {
+      first++;
+      ASSERT_LT(first, 6);
+    }
+    const int last = first + 6;
+    const int num_rows = last == 11 ? 3 : 4;
+    ASSERT_EQ(num_rows, group.results(0).count());
+    if (first == 0) {
+      ASSERT_EQ(2, group.results(1).count());
+      ASSERT_EQ(2 * last * 10, group.results(1).int_sum());
+    } else {
+      ASSERT_EQ(num_rows, group.results(1).count());
+      ASSERT_EQ(2 * first * 10 + (num_rows - 2) * last * 10, group.results(1).int_sum());
+    }
+    int64_t value;
+    ASSERT_EQ(sizeof(value), group.results(2).value().size());
+    memcpy(&value, group.results(2).value().data(), sizeof(value));
+    ASSERT_EQ(last * 10, value);
+  }
+}
+
+// Test grouping by a nullable column with more groups than fit in the initial
+// hash table.
+TEST_F(ColumnAggregateTest, TestGroupByManyGroups) {
+  boost::optional<ColumnAggregate> min;
+  ASSERT_OK(ColumnAggregateFromPB(schema_, MakePB(ColumnAggregatePB::MIN, "key"), &min));
+  unique_ptr<GroupedColumnAggregator> aggregator;
+  ASSERT_OK(GroupedColumnAggregator::Create({ *min }, { schema_.column(3) }, schema_,
+                                            &aggregator));
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < kNumRows; j++) {
+      strings_[j] = "s" + std::to_string(i * kNumRows + j);
+      *reinterpret_cast<Slice*>(block_.row(j).mutable_cell_ptr(3)) = Slice(strings_[j]);
+    }
+    aggregator->AddRowBlock(block_);
+  }
+  // Row 0 is NULL in every block, and falls into a single group.
+  ASSERT_EQ(100 * (kNumRows - 1) + 1, aggregator->num_groups());
+  google::protobuf::RepeatedPtrField<ColumnAggregateGroupPB> groups;
+  aggregator->ToPB(&groups);
+  int num_null_groups = 0;
+  for (const auto& group : groups) {
+    ASSERT_EQ(1, group.keys_size());
+    int32_t key;
+    memcpy(&key, group.results(0).value().data(), sizeof(key));
+    if (!group.keys(0).has_value()) {
+      num_null_groups++;
+      ASSERT_EQ(100, group.results(0).count());
+      ASSERT_EQ(0, key);
+    } else {
+      ASSERT_EQ(1, group.results(0).count());
+      // The values of the whole scan, copied out of the reused block.
+      ASSERT_EQ(group.keys(0).value(), "s" + std::to_string(
+          std::stoi(group.keys(0).value().substr(1)) / kNumRows * kNumRows + key));
+    }
+  }
+  ASSERT_EQ(1, num_null_groups);
+
+  Status s = GroupedColumnAggregator::Create({ *min }, { ColumnSchema("missing", INT32) },
+                                             schema_, &aggregator);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+} // namespace kudu
@@ -0,0 +1,589 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_aggregate.h"
+
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/hash_util.h"
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// Calls 'func' with the index of each selected, non-null cell of column
+// 'col_idx' in 'block'.
+template<class F>
+void ForEachSelectedNonNullCell(const RowBlock& block, int col_idx, F func) {
+  const ColumnBlock cblock = block.column_block(col_idx);
+  const SelectedRows sel = block.selection_vector()->GetSelectedRows();
+  if (cblock.is_nullable()) {
+    sel.ForEachIndex([&](uint16_t i) {
+      if (!cblock.is_null(i)) {
+        func(cblock, i);
+      }
+    });
+  } else {
+    sel.ForEachIndex([&](uint16_t i) {
+      func(cblock, i);
+    });
+  }
+}
+
+} // anonymous namespace
+
+ColumnAggregate::ColumnAggregate(Type type, boost::optional<ColumnSchema> column)
+    : type_(type),
+      column_(std::move(column)) {
+}
+
+ColumnAggregate ColumnAggregate::CountAll() {
+  return ColumnAggregate(ColumnAggregatePB::COUNT, boost::none);
+}
+
+Status ColumnAggregate::Create(Type type,
+                               ColumnSchema column,
+                               boost::optional<ColumnAggregate>* aggregate) {
+  switch (type) {
+    case ColumnAggregatePB::COUNT:
+    case ColumnAggregatePB::MIN:
+    case ColumnAggregatePB::MAX:
+      break;
+    case ColumnAggregatePB::SUM:
+      if (!IsSummable(column.type_info())) {
+        return Status::NotSupported(
+            Substitute("SUM is not supported on column $0", column.ToString()));
+      }
+      break;
+    default:
+      return Status::InvalidArgument("unknown aggregate type", ColumnAggregatePB::Type_Name(type));
+  }
+  if (column.type_info()->is_virtual()) {
+    return Status::NotSupported(
+        Substitute("aggregates are not supported on virtual column $0", column.name()));
+  }
+  *aggregate = ColumnAggregate(type, std::move(column));
+  return Status::OK();
+}
+
+bool ColumnAggregate::IsSummable(const TypeInfo* type_info) {
+  switch (type_info->type()) {
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case DECIMAL32:
+    case DECIMAL64:
+    case FLOAT:
+    case DOUBLE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+string ColumnAggregate::ToString() const {
+  return Substitute("$0($1)", ColumnAggregatePB::Type_Name(type_),
+                    column_ ? column_->name() : "*");
+}
+
+ColumnAggregator::ColumnAggregator(Type type, int col_idx, const TypeInfo* type_info)
+    : type_(type),
+      col_idx_(col_idx),
+      type_info_(type_info),
+      count_(0),
+      int_sum_(0),
+      double_sum_(0) {
+}
+
+Status ColumnAggregator::Create(const ColumnAggregate& aggregate,
+                                const Schema& schema,
+                                unique_ptr<ColumnAggregator>* aggregator) {
+  if (!aggregate.column()) {
+    DCHECK_EQ(ColumnAggregatePB::COUNT, aggregate.type());
+    aggregator->reset(new ColumnAggregator(aggregate.type(), -1, nullptr));
+    return Status::OK();
+  }
+  int col_idx = schema.find_column(aggregate.column()->name());
+  if (col_idx == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("aggregated column not found in projection",
+                                   aggregate.column()->name());
+  }
+  aggregator->reset(new ColumnAggregator(aggregate.type(), col_idx,
+                                         schema.column(col_idx).type_info()));
+  return Status::OK();
+}
+
+void ColumnAggregator::AddRowBlock(const RowBlock& block) {
+  if (col_idx_ == -1) {
+    count_ += block.selection_vector()->CountSelected();
+    return;
+  }
+  switch (type_) {
+    case ColumnAggregatePB::COUNT:
+      ForEachSelectedNonNullCell(block, col_idx_, [&](const ColumnBlock& /*cblock*/,
+                                                      size_t /*idx*/) {
+        count_++;
+      });
+      return;
+    case ColumnAggregatePB::SUM:
+      switch (type_info_->physical_type()) {
+        case INT8: SumCells<int8_t, int64_t>(block); return;
+        case INT16: SumCells<int16_t, int64_t>(block); return;
+        case INT32: SumCells<int32_t, int64_t>(block); return;
+        case INT64: SumCells<int64_t, int64_t>(block); return;
+        case FLOAT: SumCells<float, double>(block); return;
+        case DOUBLE: SumCells<double, double>(block); return;
+        default: LOG(FATAL) << "unexpected type for SUM: " << type_info_->name();
+      }
+      return;
+    case ColumnAggregatePB::MIN:
+    case ColumnAggregatePB::MAX:
+      MinMaxCells(block);
+      return;
+    default:
+      LOG(FATAL) << "unknown aggregate type: " << type_;
+  }
+}
+
+void ColumnAggregator::AddRowCount(int64_t num_rows) {
+  DCHECK(counts_all_rows());
+  count_ += num_rows;
+}
+
+template<typename CppType, typename SumType>
+void ColumnAggregator::SumCells(const RowBlock& block) {
+  // Accumulate in unsigned arithmetic so that integer overflow wraps around
+  // rather than being undefined behavior.
+  typedef typename std::conditional<std::is_integral<SumType>::value,
+                                    uint64_t, SumType>::type AccType;
+  AccType sum = 0;
+  int64_t n = 0;
+  ForEachSelectedNonNullCell(block, col_idx_, [&](const ColumnBlock& cblock, size_t idx) {
+    sum += static_cast<AccType>(UnalignedLoad<CppType>(cblock.cell_ptr(idx)));
+    n++;
+  });
+  count_ += n;
+  if constexpr (std::is_integral<SumType>::value) {
+    int_sum_ = static_cast<int64_t>(static_cast<uint64_t>(int_sum_) + sum);
+  } else {
+    double_sum_ += sum;
+  }
+}
+
+void ColumnAggregator::MinMaxCells(const RowBlock& block) {
+  const bool is_binary = type_info_->physical_type() == BINARY;
+  const int sign = type_ == ColumnAggregatePB::MIN ? 1 : -1;
+  const void* best = count_ > 0 ? current_value() : nullptr;
+  ForEachSelectedNonNullCell(block, col_idx_, [&](const ColumnBlock& cblock, size_t idx) {
+    const void* cell = cblock.cell_ptr(idx);
+    count_++;
+    if (best == nullptr || sign * type_info_->Compare(cell, best) < 0) {
+      best = cell;
+    }
+  });
+  if (best == nullptr || best == current_value()) {
+    return;
+  }
+  // 'best' points into the block; copy it out since the block's memory is
+  // reused for the next batch.
+  if (is_binary) {
+    const Slice* s = reinterpret_cast<const Slice*>(best);
+    value_.assign(reinterpret_cast<const char*>(s->data()), s->size());
+    value_slice_ = Slice(value_);
+  } else {
+    value_.assign(reinterpret_cast<const char*>(best), type_info_->size());
+  }
+}
+
+const void* ColumnAggregator::current_value() const {
+  if (type_info_->physical_type() == BINARY) {
+    return &value_slice_;
+  }
+  return value_.data();
+}
+
+void ColumnAggregator::ToPB(ColumnAggregateResultPB* pb) const {
+  pb->set_count(count_);
+  if (col_idx_ == -1) {
+    return;
+  }
+  switch (type_) {
+    case ColumnAggregatePB::SUM:
+      if (type_info_->physical_type() == FLOAT ||
+          type_info_->physical_type() == DOUBLE) {
+        pb->set_double_sum(double_sum_);
+      } else {
+        pb->set_int_sum(int_sum_);
+      }
+      break;
+    case ColumnAggregatePB::MIN:
+    case ColumnAggregatePB::MAX:
+      if (count_ > 0) {
+        pb->set_value(value_);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+struct GroupedColumnAggregator::KeyColumn {
+  int col_idx;
+  const TypeInfo* type_info;
+  bool is_nullable;
+};
+
+struct GroupedColumnAggregator::GroupedAggregate {
+  ColumnAggregate::Type type;
+  // The index of the aggregated column in the RowBlock schema, or -1 for
+  // COUNT(*).
+  int col_idx;
+  const TypeInfo* type_info;
+
+  // The partial results of each group: the number of values folded, and the
+  // sum or the MIN/MAX cell of the values, if the aggregate has any.
+  vector<int64_t> counts;
+  vector<int64_t> int_sums;
+  vector<double> double_sums;
+  vector<uint8_t> cells;
+};
+
+GroupedColumnAggregator::GroupedColumnAggregator(vector<KeyColumn> key_columns,
+                                                 vector<GroupedAggregate> aggregates)
+    : key_columns_(std::move(key_columns)),
+      aggregates_(std::move(aggregates)),
+      slots_(16, Slot{0, kEmptySlot}),
+      arena_(1024) {
+}
+
+GroupedColumnAggregator::~GroupedColumnAggregator() {}
+
+Status GroupedColumnAggregator::Create(const vector<ColumnAggregate>& aggregates,
+                                       const vector<ColumnSchema>& group_by,
+                                       const Schema& schema,
+                                       unique_ptr<GroupedColumnAggregator>* aggregator) {
+  vector<KeyColumn> key_columns;
+  for (const auto& col : group_by) {
+    if (col.type_info()->is_virtual()) {
+      return Status::NotSupported(
+          Substitute("cannot group by virtual column $0", col.name()));
+    }
+    int col_idx = schema.find_column(col.name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("group-by column not found in projection", col.name());
+    }
+    key_columns.push_back({ col_idx, schema.column(col_idx).type_info(),
+                            schema.column(col_idx).is_nullable() });
+  }
+  vector<GroupedAggregate> aggs;
+  for (const auto& aggregate : aggregates) {
+    GroupedAggregate agg;
+    agg.type = aggregate.type();
+    agg.col_idx = -1;
+    agg.type_info = nullptr;
+    if (aggregate.column()) {
+      agg.col_idx = schema.find_column(aggregate.column()->name());
+      if (agg.col_idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("aggregated column not found in projection",
+                                       aggregate.column()->name());
+      }
+      agg.type_info = schema.column(agg.col_idx).type_info();
+    }
+    aggs.emplace_back(std::move(agg));
+  }
+  aggregator->reset(new GroupedColumnAggregator(std::move(key_columns), std::move(aggs)));
+  return Status::OK();
+}
+
+void GroupedColumnAggregator::EncodeKey(const RowBlock& block, size_t idx,
+                                        faststring* key) const {
+  // Each value is preceded by a NULL flag if the column is nullable. BINARY
+  // values are preceded by their length, other values are the bytes of their
+  // cells, so that equal values have equal encodings.
+  for (const auto& kc : key_columns_) {
+    const ColumnBlock cblock = block.column_block(kc.col_idx);
+    if (kc.is_nullable) {
+      const uint8_t is_null = cblock.is_null(idx);
+      key->push_back(is_null);
+      if (is_null) {
+        continue;
+      }
+    }
+    const void* cell = cblock.cell_ptr(idx);
+    switch (kc.type_info->physical_type()) {
+      case BINARY: {
+        const Slice* s = reinterpret_cast<const Slice*>(cell);
+        const uint32_t len = s->size();
+        key->append(&len, sizeof(len));
+        key->append(s->data(), s->size());
+        break;
+      }
+      case FLOAT: {
+        // -0 and 0 are the same group.
+        float f = UnalignedLoad<float>(cell);
+        f = f == 0 ? 0 : f;
+        key->append(&f, sizeof(f));
+        break;
+      }
+      case DOUBLE: {
+        double d = UnalignedLoad<double>(cell);
+        d = d == 0 ? 0 : d;
+        key->append(&d, sizeof(d));
+        break;
+      }
+      default:
+        key->append(cell, kc.type_info->size());
+        break;
+    }
+  }
+}
+
+uint32_t GroupedColumnAggregator::FindOrAddGroup(const Slice& key) {
+  const uint64_t hash = HashUtil::FastHash64(key.data(), key.size(), 0);
+  const size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  while (true) {
+    Slot* slot = &slots_[i];
+    if (slot->group == kEmptySlot) {
+      break;
+    }
+    if (slot->hash == hash && group_keys_[slot->group] == key) {
+      return slot->group;
+    }
+    i = (i + 1) & mask;
+  }
+
+  const uint32_t group = group_keys_.size();
+  Slice stored_key;
+  CHECK(arena_.RelocateSlice(key, &stored_key)) << "out of memory allocating group key";
+  group_keys_.push_back(stored_key);
+  for (auto& agg : aggregates_) {
+    agg.counts.push_back(0);
+    switch (agg.type) {
+      case ColumnAggregatePB::SUM:
+        agg.int_sums.push_back(0);
+        agg.double_sums.push_back(0);
+        break;
+      case ColumnAggregatePB::MIN:
+      case ColumnAggregatePB::MAX:
+        agg.cells.resize(agg.cells.size() + agg.type_info->size());
+        break;
+      default:
+        break;
+    }
+  }
+  slots_[i] = Slot{ hash, group };
+  // Keep the load factor at most 1/2 so that the probe sequences stay short.
+  if (group_keys_.size() * 2 > slots_.size()) {
+    Grow();
+  }
+  return group;
+}
+
+void GroupedColumnAggregator::Grow() {
+  vector<Slot> slots(slots_.size() * 2, Slot{0, kEmptySlot});
+  const size_t mask = slots.size() - 1;
+  for (const auto& slot : slots_) {
+    if (slot.group == kEmptySlot) {
+      continue;
+    }
+    size_t i = slot.hash & mask;
+    while (slots[i].group != kEmptySlot) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+  slots_ = std::move(slots);
+}
+
+void GroupedColumnAggregator::AddRowBlock(const RowBlock& block) {
+  const SelectedRows sel = block.selection_vector()->GetSelectedRows();
+  if (sel.num_selected() == 0) {
+    return;
+  }
+  row_groups_.resize(block.nrows());
+  sel.ForEachIndex([&](uint16_t i) {
+    key_buf_.clear();
+    EncodeKey(block, i, &key_buf_);
+    row_groups_[i] = FindOrAddGroup(Slice(key_buf_));
+  });
+
+  for (auto& agg : aggregates_) {
+    if (agg.col_idx == -1) {
+      sel.ForEachIndex([&](uint16_t i) {
+        agg.counts[row_groups_[i]]++;
+      });
+      continue;
+    }
+    switch (agg.type) {
+      case ColumnAggregatePB::COUNT:
+        ForEachSelectedNonNullCell(block, agg.col_idx, [&](const ColumnBlock& /*cblock*/,
+                                                           size_t idx) {
+          agg.counts[row_groups_[idx]]++;
+        });
+        break;
+      case ColumnAggregatePB::SUM:
+        switch (agg.type_info->physical_type()) {
+          case INT8: SumCells<int8_t, int64_t>(block, &agg); break;
+          case INT16: SumCells<int16_t, int64_t>(block, &agg); break;
+          case INT32: SumCells<int32_t, int64_t>(block, &agg); break;
+          case INT64: SumCells<int64_t, int64_t>(block, &agg); break;
+          case FLOAT: SumCells<float, double>(block, &agg); break;
+          case DOUBLE: SumCells<double, double>(block, &agg); break;
+          default: LOG(FATAL) << "unexpected type for SUM: " << agg.type_info->name();
+        }
+        break;
+      case ColumnAggregatePB::MIN:
+      case ColumnAggregatePB::MAX:
+        MinMaxCells(block, &agg);
+        break;
+      default:
+        LOG(FATAL) << "unknown aggregate type: " << agg.type;
+    }
+  }
+}
+
+template<typename CppType, typename SumType>
+void GroupedColumnAggregator::SumCells(const RowBlock& block, GroupedAggregate* agg) {
+  ForEachSelectedNonNullCell(block, agg->col_idx, [&](const ColumnBlock& cblock, size_t idx) {
+    const uint32_t group = row_groups_[idx];
+    const CppType value = UnalignedLoad<CppType>(cblock.cell_ptr(idx));
+    agg->counts[group]++;
+    if constexpr (std::is_integral<SumType>::value) {
+      // Overflow wraps around, as in ColumnAggregator.
+      agg->int_sums[group] = static_cast<int64_t>(static_cast<uint64_t>(agg->int_sums[group]) +
+                                                  static_cast<uint64_t>(value));
+    } else {
+      agg->double_sums[group] += value;
+    }
+  });
+}
+
+void GroupedColumnAggregator::MinMaxCells(const RowBlock& block, GroupedAggregate* agg) {
+  const bool is_binary = agg->type_info->physical_type() == BINARY;
+  const int sign = agg->type == ColumnAggregatePB::MIN ? 1 : -1;
+  const size_t size = agg->type_info->size();
+  ForEachSelectedNonNullCell(block, agg->col_idx, [&](const ColumnBlock& cblock, size_t idx) {
+    const uint32_t group = row_groups_[idx];
+    const void* cell = cblock.cell_ptr(idx);
+    uint8_t* best = &agg->cells[group * size];
+    if (agg->counts[group]++ > 0 && sign * agg->type_info->Compare(cell, best) >= 0) {
+      return;
+    }
+    if (is_binary) {
+      // The block's memory is reused for the next batch, so the string is
+      // copied to the arena.
+      CHECK(arena_.RelocateSlice(*reinterpret_cast<const Slice*>(cell),
+                                 reinterpret_cast<Slice*>(best)))
+          << "out of memory allocating aggregate value";
+    } else {
+      memcpy(best, cell, size);
+    }
+  });
+}
+
+void GroupedColumnAggregator::ToPB(RepeatedPtrField<ColumnAggregateGroupPB>* groups) const {
+  groups->Reserve(groups->size() + group_keys_.size());
+  for (uint32_t group = 0; group < group_keys_.size(); group++) {
+    ColumnAggregateGroupPB* group_pb = groups->Add();
+
+    // Decode the values of the group-by columns; see EncodeKey().
+    const uint8_t* p = group_keys_[group].data();
+    for (const auto& kc : key_columns_) {
+      ColumnAggregateGroupPB::KeyPB* key_pb = group_pb->add_keys();
+      if (kc.is_nullable && *p++) {
+        continue;
+      }
+      size_t len = kc.type_info->size();
+      if (kc.type_info->physical_type() == BINARY) {
+        uint32_t str_len;
+        memcpy(&str_len, p, sizeof(str_len));
+        p += sizeof(str_len);
+        len = str_len;
+      }
+      key_pb->set_value(p, len);
+      p += len;
+    }
+    DCHECK_EQ(group_keys_[group].data() + group_keys_[group].size(), p);
+
+    for (const auto& agg : aggregates_) {
+      ColumnAggregateResultPB* result = group_pb->add_results();
+      result->set_count(agg.counts[group]);
+      if (agg.col_idx == -1) {
+        continue;
+      }
+      switch (agg.type) {
+        case ColumnAggregatePB::SUM:
+          if (agg.type_info->physical_type() == FLOAT ||
+              agg.type_info->physical_type() == DOUBLE) {
+            result->set_double_sum(agg.double_sums[group]);
+          } else {
+            result->set_int_sum(agg.int_sums[group]);
+          }
+          break;
+        case ColumnAggregatePB::MIN:
+        case ColumnAggregatePB::MAX: {
+          if (agg.counts[group] == 0) {
+            break;
+          }
+          const uint8_t* cell = &agg.cells[group * agg.type_info->size()];
+          if (agg.type_info->physical_type() == BINARY) {
+            const Slice* s = reinterpret_cast<const Slice*>(cell);
+            result->set_value(s->data(), s->size());
+          } else {
+            result->set_value(cell, agg.type_info->size());
+          }
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+}
+
+size_t GroupedColumnAggregator::memory_footprint() const {
+  size_t size = arena_.memory_footprint() +
+      slots_.capacity() * sizeof(Slot) +
+      group_keys_.capacity() * sizeof(Slice);
+  for (const auto& agg : aggregates_) {
+    size += agg.counts.capacity() * sizeof(int64_t) +
+        agg.int_sums.capacity() * sizeof(int64_t) +
+        agg.double_sums.capacity() * sizeof(double) +
+        agg.cells.capacity();
+  }
+  return size;
+}
+
+} // namespace kudu
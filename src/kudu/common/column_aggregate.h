@@ -0,0 +1,230 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/optional/optional.hpp>
+#include <google/protobuf/repeated_field.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowBlock;
+class TypeInfo;
+
+// An aggregate function which is evaluated over the rows selected by a scan.
+//
+// Aggregates are pushed down to the tablet servers as part of the scan spec,
+// so that the rows selected by a scan are folded into a handful of partial
+// results in the tablet server instead of being shipped to the client.
+class ColumnAggregate {
+ public:
+  typedef ColumnAggregatePB::Type Type;
+
+  // Creates an aggregate counting all selected rows.
+  static ColumnAggregate CountAll();
+
+  // Creates an aggregate of the given type over the non-null values of
+  // 'column'.
+  //
+  // Returns NotSupported if the aggregate is not defined on the type of the
+  // column, e.g. SUM on a string column.
+  static Status Create(Type type,
+                       ColumnSchema column,
+                       boost::optional<ColumnAggregate>* aggregate);
+
+  // Returns true if SUM is supported on values of the given type.
+  static bool IsSummable(const TypeInfo* type_info);
+
+  Type type() const {
+    return type_;
+  }
+
+  // The aggregated column, or boost::none for COUNT(*).
+  const boost::optional<ColumnSchema>& column() const {
+    return column_;
+  }
+
+  std::string ToString() const;
+
+ private:
+  ColumnAggregate(Type type, boost::optional<ColumnSchema> column);
+
+  Type type_;
+  boost::optional<ColumnSchema> column_;
+};
+
+// Accumulates the partial result of a ColumnAggregate over a sequence of
+// RowBlocks.
+//
+// Not thread-safe.
+class ColumnAggregator {
+ public:
+  // Creates an aggregator for 'aggregate' over RowBlocks with the given
+  // schema. Returns InvalidArgument if the aggregated column is not part of
+  // 'schema'.
+  static Status Create(const ColumnAggregate& aggregate,
+                       const Schema& schema,
+                       std::unique_ptr<ColumnAggregator>* aggregator);
+
+  // Folds the selected rows of 'block' into the partial result.
+  void AddRowBlock(const RowBlock& block);
+
+  // Folds 'num_rows' rows which were counted without being materialized,
+  // e.g. from rowset metadata. Only valid if counts_all_rows() is true.
+  void AddRowCount(int64_t num_rows);
+
+  // Returns true if this aggregator is a COUNT(*), and thus doesn't need to
+  // inspect any column values.
+  bool counts_all_rows() const {
+    return col_idx_ == -1;
+  }
+
+  // Serializes the partial result accumulated so far.
+  void ToPB(ColumnAggregateResultPB* pb) const;
+
+  // The number of values folded so far.
+  int64_t count() const {
+    return count_;
+  }
+
+ private:
+  typedef ColumnAggregate::Type Type;
+
+  ColumnAggregator(Type type, int col_idx, const TypeInfo* type_info);
+
+  template<typename CppType, typename SumType>
+  void SumCells(const RowBlock& block);
+
+  void MinMaxCells(const RowBlock& block);
+
+  // Returns a pointer to the current MIN/MAX value in the in-memory cell
+  // format of the column.
+  const void* current_value() const;
+
+  const Type type_;
+
+  // The index of the aggregated column in the RowBlock schema, or -1 for
+  // COUNT(*).
+  const int col_idx_;
+
+  // The type of the aggregated column, or nullptr for COUNT(*).
+  const TypeInfo* const type_info_;
+
+  int64_t count_;
+  int64_t int_sum_;
+  double double_sum_;
+
+  // The current MIN/MAX value, and a slice pointing to it for BINARY columns.
+  std::string value_;
+  Slice value_slice_;
+};
+
+// Accumulates the partial results of a set of ColumnAggregates over each group
+// of rows with the same values of a set of group-by columns, over a sequence
+// of RowBlocks.
+//
+// The groups are found in an open-addressing hash table keyed by the encoded
+// values of the group-by columns. The keys, and the MIN/MAX values of BINARY
+// columns, are copied to an arena, and the partial results are kept in one
+// array per aggregate indexed by group, so that each aggregate is folded over
+// a block in a single pass.
+//
+// Not thread-safe.
+class GroupedColumnAggregator {
+ public:
+  // Creates an aggregator for 'aggregates' over the groups of 'group_by'
+  // columns of RowBlocks with the given schema. Returns InvalidArgument if
+  // an aggregated or group-by column is not part of 'schema', and
+  // NotSupported if a group-by column is virtual.
+  static Status Create(const std::vector<ColumnAggregate>& aggregates,
+                       const std::vector<ColumnSchema>& group_by,
+                       const Schema& schema,
+                       std::unique_ptr<GroupedColumnAggregator>* aggregator);
+
+  ~GroupedColumnAggregator();
+
+  // Folds the selected rows of 'block' into the partial results of their
+  // groups.
+  void AddRowBlock(const RowBlock& block);
+
+  // Serializes the partial results of each group, in no particular order.
+  void ToPB(google::protobuf::RepeatedPtrField<ColumnAggregateGroupPB>* groups) const;
+
+  // The number of groups seen so far.
+  size_t num_groups() const {
+    return group_keys_.size();
+  }
+
+  // The memory used by the groups, in bytes.
+  size_t memory_footprint() const;
+
+ private:
+  struct KeyColumn;
+  struct GroupedAggregate;
+
+  // A slot of the hash table: the index of a group and the hash of its key,
+  // or kEmptySlot.
+  struct Slot {
+    uint64_t hash;
+    uint32_t group;
+  };
+  static constexpr uint32_t kEmptySlot = static_cast<uint32_t>(-1);
+
+  GroupedColumnAggregator(std::vector<KeyColumn> key_columns,
+                          std::vector<GroupedAggregate> aggregates);
+
+  // Appends the encoded values of the group-by columns of row 'idx' of
+  // 'block' to 'key'.
+  void EncodeKey(const RowBlock& block, size_t idx, faststring* key) const;
+
+  // Returns the group of the encoded key 'key', adding it if it's new.
+  uint32_t FindOrAddGroup(const Slice& key);
+
+  // Doubles the number of slots of the hash table.
+  void Grow();
+
+  template<typename CppType, typename SumType>
+  void SumCells(const RowBlock& block, GroupedAggregate* agg);
+
+  void MinMaxCells(const RowBlock& block, GroupedAggregate* agg);
+
+  const std::vector<KeyColumn> key_columns_;
+  std::vector<GroupedAggregate> aggregates_;
+
+  std::vector<Slot> slots_;
+  // The encoded key of each group, allocated from 'arena_'.
+  std::vector<Slice> group_keys_;
+  Arena arena_;
+
+  // Scratch space for AddRowBlock(): the key of the current row, and the
+  // group of each row of the block.
+  faststring key_buf_;
+  std::vector<uint32_t> row_groups_;
+};
+
+} // namespace kudu
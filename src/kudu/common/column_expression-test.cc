@@ -0,0 +1,245 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_expression.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+typedef shared_ptr<const ColumnExpression> ExprPtr;
+
+class ColumnExpressionTest : public ::testing::Test {
+ public:
+  ColumnExpressionTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("int_val", INT64, /*is_nullable=*/true),
+                  ColumnSchema("double_val", DOUBLE),
+                  ColumnSchema("string_val", STRING, /*is_nullable=*/true) },
+                1),
+        block_(&schema_, kNumRows, &mem_) {
+  }
+
+  void SetUp() override {
+    // Row 'i' has key i, int_val i * 10 (NULL for every third row),
+    // double_val i / 2 and string_val "S<i>" (NULL for row 0).
+    for (int i = 0; i < kNumRows; i++) {
+      RowBlockRow row = block_.row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+
+      block_.column_block(1).SetCellIsNull(i, i % 3 == 0);
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) = i * 10;
+
+      *reinterpret_cast<double*>(row.mutable_cell_ptr(2)) = i / 2.0;
+
+      strings_[i] = "S" + std::to_string(i);
+      block_.column_block(3).SetCellIsNull(i, i == 0);
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(3)) = Slice(strings_[i]);
+    }
+    block_.selection_vector()->SetAllTrue();
+  }
+
+ protected:
+  ExprPtr Col(const string& name) {
+    ExprPtr expr;
+    CHECK_OK(ColumnExpression::Column(schema_.column(schema_.find_column(name)), &expr));
+    return expr;
+  }
+
+  static ExprPtr Make(ColumnExpression::Op op, vector<ExprPtr> args) {
+    ExprPtr expr;
+    CHECK_OK(ColumnExpression::Create(op, std::move(args), &expr));
+    return expr;
+  }
+
+  // Returns the keys of the rows of the block for which 'expr' is true.
+  vector<int> Matching(const ExprPtr& expr) {
+    block_.selection_vector()->SetAllTrue();
+    CHECK_OK(expr->Filter(&block_));
+    vector<int> keys;
+    for (int i = 0; i < kNumRows; i++) {
+      if (block_.selection_vector()->IsRowSelected(i)) {
+        keys.push_back(i);
+      }
+    }
+    return keys;
+  }
+
+  static constexpr int kNumRows = 10;
+
+  const Schema schema_;
+  RowBlockMemory mem_;
+  RowBlock block_;
+  string strings_[kNumRows];
+};
+
+TEST_F(ColumnExpressionTest, TestTypeErrors) {
+  ExprPtr expr;
+  Status s = ColumnExpression::Create(ColumnExpressionPB::ADD,
+                                      { Col("int_val"), Col("string_val") }, &expr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnExpression::Create(ColumnExpressionPB::EQUAL,
+                               { Col("string_val"), ColumnExpression::Int64Literal(1) }, &expr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnExpression::Create(ColumnExpressionPB::AND,
+                               { Col("int_val"), ColumnExpression::BoolLiteral(true) }, &expr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnExpression::Create(ColumnExpressionPB::LOWER, { Col("int_val") }, &expr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  s = ColumnExpression::Create(ColumnExpressionPB::NOT, {}, &expr);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // Integers and doubles compare with each other.
+  ASSERT_OK(ColumnExpression::Create(ColumnExpressionPB::LESS,
+                                     { Col("int_val"), Col("double_val") }, &expr));
+  ASSERT_EQ(ColumnExpression::BOOL, expr->type());
+}
+
+TEST_F(ColumnExpressionTest, TestArithmetic) {
+  // key + int_val > 50: rows 5 (55), 7 (77) and 8 (88); the NULL int_val of
+  // rows 3, 6 and 9 make the sum NULL.
+  ASSERT_EQ(vector<int>({ 5, 7, 8 }), Matching(Make(ColumnExpressionPB::GREATER, {
+      Make(ColumnExpressionPB::ADD, { Col("key"), Col("int_val") }),
+      ColumnExpression::Int64Literal(50) })));
+
+  // key % 4 = 1.
+  ASSERT_EQ(vector<int>({ 1, 5, 9 }), Matching(Make(ColumnExpressionPB::EQUAL, {
+      Make(ColumnExpressionPB::MODULO, { Col("key"), ColumnExpression::Int64Literal(4) }),
+      ColumnExpression::Int64Literal(1) })));
+
+  // Mixed arithmetic is done on doubles: key * 0.5 = double_val for all rows.
+  ASSERT_EQ(kNumRows, Matching(Make(ColumnExpressionPB::EQUAL, {
+      Make(ColumnExpressionPB::MULTIPLY, { Col("key"), ColumnExpression::DoubleLiteral(0.5) }),
+      Col("double_val") })).size());
+
+  // Dividing by zero yields NULL rather than failing the scan.
+  ASSERT_EQ(vector<int>({ 0 }), Matching(Make(ColumnExpressionPB::IS_NULL, {
+      Make(ColumnExpressionPB::DIVIDE, { ColumnExpression::Int64Literal(1), Col("key") }) })));
+}
+
+TEST_F(ColumnExpressionTest, TestThreeValuedLogic) {
+  const ExprPtr int_gt = Make(ColumnExpressionPB::GREATER, {
+      Col("int_val"), ColumnExpression::Int64Literal(40) });
+  const ExprPtr key_lt = Make(ColumnExpressionPB::LESS, {
+      Col("key"), ColumnExpression::Int64Literal(2) });
+
+  // NULL AND false is false, so NOT(...) is true for rows 0 and 1.
+  ASSERT_EQ(vector<int>({ 0, 1, 2, 4 }), Matching(Make(ColumnExpressionPB::NOT, {
+      Make(ColumnExpressionPB::AND, { int_gt, Make(ColumnExpressionPB::NOT, { key_lt }) }) })));
+
+  // NULL OR true is true, and NULL OR false is NULL.
+  ASSERT_EQ(vector<int>({ 0, 1, 5, 7, 8 }),
+            Matching(Make(ColumnExpressionPB::OR, { int_gt, key_lt })));
+
+  // NOT NULL is NULL.
+  ASSERT_EQ(vector<int>({ 1, 2, 4 }), Matching(Make(ColumnExpressionPB::NOT, { int_gt })));
+}
+
+TEST_F(ColumnExpressionTest, TestStrings) {
+  ASSERT_EQ(vector<int>({ 3 }), Matching(Make(ColumnExpressionPB::EQUAL, {
+      Make(ColumnExpressionPB::LOWER, { Col("string_val") }),
+      ColumnExpression::StringLiteral("s3") })));
+
+  // The casts of the keys compare as strings.
+  ASSERT_EQ(vector<int>({ 0, 1, 2, 3 }), Matching(Make(ColumnExpressionPB::LESS, {
+      Make(ColumnExpressionPB::CAST_STRING, { Col("key") }),
+      ColumnExpression::StringLiteral("4") })));
+
+  // Casts to strings and back are lossless, but strings which don't parse
+  // cast to NULL.
+  ASSERT_EQ(kNumRows, Matching(Make(ColumnExpressionPB::EQUAL, {
+      Make(ColumnExpressionPB::CAST_INT64, {
+          Make(ColumnExpressionPB::CAST_STRING, { Col("key") }) }),
+      Col("key") })).size());
+  ASSERT_TRUE(Matching(Make(ColumnExpressionPB::IS_NOT_NULL, {
+      Make(ColumnExpressionPB::CAST_INT64, { Col("string_val") }) })).empty());
+
+  ASSERT_EQ(vector<int>({ 1 }), Matching(Make(ColumnExpressionPB::GREATER, {
+      Make(ColumnExpressionPB::LENGTH, { Col("string_val") }),
+      Col("key") })));
+}
+
+TEST_F(ColumnExpressionTest, TestFilterSkipsUnselectedRows) {
+  const ExprPtr expr = Make(ColumnExpressionPB::LESS, {
+      Col("key"), ColumnExpression::Int64Literal(5) });
+  block_.selection_vector()->SetAllFalse();
+  block_.selection_vector()->SetRowSelected(2);
+  block_.selection_vector()->SetRowSelected(7);
+  ASSERT_OK(expr->Filter(&block_));
+  ASSERT_EQ(1, block_.selection_vector()->CountSelected());
+  ASSERT_TRUE(block_.selection_vector()->IsRowSelected(2));
+
+  // A column missing from the block is an error.
+  const Schema other({ ColumnSchema("other", INT32) }, 1);
+  ExprPtr other_col;
+  ASSERT_OK(ColumnExpression::Column(other.column(0), &other_col));
+  Status s = Make(ColumnExpressionPB::IS_NULL, { other_col })->Filter(&block_);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(ColumnExpressionTest, TestPBRoundTrip) {
+  const ExprPtr expr = Make(ColumnExpressionPB::OR, {
+      Make(ColumnExpressionPB::GREATER_EQUAL, {
+          Make(ColumnExpressionPB::SUBTRACT, { Col("double_val"), Col("key") }),
+          ColumnExpression::DoubleLiteral(-1.5) }),
+      Make(ColumnExpressionPB::EQUAL, {
+          Make(ColumnExpressionPB::UPPER, { Col("string_val") }),
+          ColumnExpression::StringLiteral("S1") }) });
+  ColumnExpressionPB pb;
+  ColumnExpressionToPB(*expr, &pb);
+  ExprPtr decoded;
+  ASSERT_OK(ColumnExpressionFromPB(schema_, pb, &decoded));
+  ASSERT_EQ(expr->ToString(), decoded->ToString());
+  ASSERT_EQ(Matching(expr), Matching(decoded));
+
+  vector<ColumnSchema> columns;
+  decoded->GetColumns(&columns);
+  ASSERT_EQ(3, columns.size());
+
+  // Unknown columns and operators are rejected.
+  pb.mutable_args(0)->mutable_args(0)->mutable_args(0)->set_column("missing");
+  Status s = ColumnExpressionFromPB(schema_, pb, &decoded);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  pb.Clear();
+  s = ColumnExpressionFromPB(schema_, pb, &decoded);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+} // namespace kudu
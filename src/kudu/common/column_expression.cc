@@ -0,0 +1,747 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_expression.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/ascii_ctype.h"
+#include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+// The values of an expression over the rows of a block. Only the values of
+// the selected rows are set.
+struct ColumnExpression::Values {
+  void Reset(ValueType type, size_t num_rows) {
+    is_null.assign(num_rows, 0);
+    switch (type) {
+      case BOOL:
+      case INT64:
+        ints.resize(num_rows);
+        break;
+      case DOUBLE:
+        doubles.resize(num_rows);
+        break;
+      case STRING:
+        strings.resize(num_rows);
+        break;
+    }
+  }
+
+  vector<uint8_t> is_null;
+  // The values of BOOL (as 0 or 1) and INT64 expressions.
+  vector<int64_t> ints;
+  vector<double> doubles;
+  vector<Slice> strings;
+};
+
+namespace {
+
+typedef ColumnExpression::ValueType ValueType;
+
+// Returns the type of the values of 'column' in expressions, if it can be
+// used in expressions.
+bool GetColumnValueType(const ColumnSchema& column, ValueType* type) {
+  if (column.type_info()->is_virtual()) {
+    return false;
+  }
+  switch (column.type_info()->type()) {
+    case BOOL:
+      *type = ColumnExpression::BOOL;
+      return true;
+    case INT8:
+    case INT16:
+    case INT32:
+    case INT64:
+    case UNIXTIME_MICROS:
+    case DATE:
+      *type = ColumnExpression::INT64;
+      return true;
+    case FLOAT:
+    case DOUBLE:
+      *type = ColumnExpression::DOUBLE;
+      return true;
+    case STRING:
+    case BINARY:
+    case VARCHAR:
+      *type = ColumnExpression::STRING;
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* ValueTypeName(ValueType type) {
+  switch (type) {
+    case ColumnExpression::BOOL: return "BOOL";
+    case ColumnExpression::INT64: return "INT64";
+    case ColumnExpression::DOUBLE: return "DOUBLE";
+    case ColumnExpression::STRING: return "STRING";
+  }
+  LOG(FATAL) << "unknown value type " << type;
+}
+
+bool IsNumeric(ValueType type) {
+  return type == ColumnExpression::INT64 || type == ColumnExpression::DOUBLE;
+}
+
+// The infix notation of the binary operators.
+const char* BinaryOpSymbol(ColumnExpression::Op op) {
+  switch (op) {
+    case ColumnExpressionPB::ADD: return "+";
+    case ColumnExpressionPB::SUBTRACT: return "-";
+    case ColumnExpressionPB::MULTIPLY: return "*";
+    case ColumnExpressionPB::DIVIDE: return "/";
+    case ColumnExpressionPB::MODULO: return "%";
+    case ColumnExpressionPB::EQUAL: return "=";
+    case ColumnExpressionPB::NOT_EQUAL: return "!=";
+    case ColumnExpressionPB::LESS: return "<";
+    case ColumnExpressionPB::LESS_EQUAL: return "<=";
+    case ColumnExpressionPB::GREATER: return ">";
+    case ColumnExpressionPB::GREATER_EQUAL: return ">=";
+    case ColumnExpressionPB::AND: return "AND";
+    case ColumnExpressionPB::OR: return "OR";
+    default: return nullptr;
+  }
+}
+
+// Reads the cells of the rows 'sel' of 'cblock' into 'out', converting them
+// from the physical type 'PT' to 'T'.
+template<DataType PT, typename T>
+void ReadCells(const ColumnBlock& cblock, const SelectedRows& sel, vector<T>* out) {
+  typedef typename DataTypeTraits<PT>::cpp_type CppType;
+  const CppType* data = reinterpret_cast<const CppType*>(cblock.data());
+  sel.ForEachIndex([&](uint16_t i) {
+    (*out)[i] = static_cast<T>(data[i]);
+  });
+}
+
+// Converts the INT64 values of the rows 'sel' to doubles, in place.
+void ConvertToDouble(const SelectedRows& sel, vector<int64_t>* ints, vector<double>* doubles) {
+  doubles->resize(ints->size());
+  sel.ForEachIndex([&](uint16_t i) {
+    (*doubles)[i] = static_cast<double>((*ints)[i]);
+  });
+}
+
+// Applies the arithmetic operator 'op' to 'a' and 'b'. Returns false if the
+// result is NULL.
+bool ApplyArithmetic(ColumnExpression::Op op, int64_t a, int64_t b, int64_t* result) {
+  // The arithmetic is done on unsigned integers so that overflow wraps around
+  // rather than being undefined.
+  const uint64_t ua = static_cast<uint64_t>(a);
+  const uint64_t ub = static_cast<uint64_t>(b);
+  switch (op) {
+    case ColumnExpressionPB::ADD:
+      *result = static_cast<int64_t>(ua + ub);
+      return true;
+    case ColumnExpressionPB::SUBTRACT:
+      *result = static_cast<int64_t>(ua - ub);
+      return true;
+    case ColumnExpressionPB::MULTIPLY:
+      *result = static_cast<int64_t>(ua * ub);
+      return true;
+    case ColumnExpressionPB::DIVIDE:
+      if (b == 0) {
+        return false;
+      }
+      // INT64_MIN / -1 overflows.
+      *result = b == -1 ? static_cast<int64_t>(0 - ua) : a / b;
+      return true;
+    case ColumnExpressionPB::MODULO:
+      if (b == 0) {
+        return false;
+      }
+      *result = b == -1 ? 0 : a % b;
+      return true;
+    default:
+      LOG(FATAL) << "not an arithmetic operator: " << ColumnExpressionPB::Op_Name(op);
+  }
+}
+
+bool ApplyArithmetic(ColumnExpression::Op op, double a, double b, double* result) {
+  switch (op) {
+    case ColumnExpressionPB::ADD:
+      *result = a + b;
+      return true;
+    case ColumnExpressionPB::SUBTRACT:
+      *result = a - b;
+      return true;
+    case ColumnExpressionPB::MULTIPLY:
+      *result = a * b;
+      return true;
+    case ColumnExpressionPB::DIVIDE:
+      if (b == 0) {
+        return false;
+      }
+      *result = a / b;
+      return true;
+    case ColumnExpressionPB::MODULO:
+      if (b == 0) {
+        return false;
+      }
+      *result = std::fmod(a, b);
+      return true;
+    default:
+      LOG(FATAL) << "not an arithmetic operator: " << ColumnExpressionPB::Op_Name(op);
+  }
+}
+
+// Returns whether 'cmp', the sign of the comparison of two values, satisfies
+// the comparison operator 'op'.
+bool ComparisonHolds(ColumnExpression::Op op, int cmp) {
+  switch (op) {
+    case ColumnExpressionPB::EQUAL: return cmp == 0;
+    case ColumnExpressionPB::NOT_EQUAL: return cmp != 0;
+    case ColumnExpressionPB::LESS: return cmp < 0;
+    case ColumnExpressionPB::LESS_EQUAL: return cmp <= 0;
+    case ColumnExpressionPB::GREATER: return cmp > 0;
+    case ColumnExpressionPB::GREATER_EQUAL: return cmp >= 0;
+    default:
+      LOG(FATAL) << "not a comparison operator: " << ColumnExpressionPB::Op_Name(op);
+  }
+}
+
+template<typename T>
+int Compare(const T& a, const T& b) {
+  return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+template<>
+int Compare(const Slice& a, const Slice& b) {
+  return a.compare(b);
+}
+
+// Copies 'str' to 'arena'. Returns false if the arena is out of memory.
+bool CopyToArena(const Slice& str, Arena* arena, Slice* out) {
+  return arena->RelocateSlice(str, out);
+}
+
+} // anonymous namespace
+
+ColumnExpression::ColumnExpression(Op op, ValueType type)
+    : op_(op),
+      type_(type),
+      int_value_(0),
+      double_value_(0) {
+}
+
+Status ColumnExpression::Column(ColumnSchema column, shared_ptr<const ColumnExpression>* expr) {
+  ValueType type;
+  if (!GetColumnValueType(column, &type)) {
+    return Status::NotSupported(
+        Substitute("column $0 can't be used in expressions", column.ToString()));
+  }
+  shared_ptr<ColumnExpression> e(new ColumnExpression(ColumnExpressionPB::COLUMN, type));
+  e->column_ = std::move(column);
+  *expr = std::move(e);
+  return Status::OK();
+}
+
+shared_ptr<const ColumnExpression> ColumnExpression::BoolLiteral(bool value) {
+  shared_ptr<ColumnExpression> e(new ColumnExpression(ColumnExpressionPB::LITERAL, BOOL));
+  e->int_value_ = value ? 1 : 0;
+  return e;
+}
+
+shared_ptr<const ColumnExpression> ColumnExpression::Int64Literal(int64_t value) {
+  shared_ptr<ColumnExpression> e(new ColumnExpression(ColumnExpressionPB::LITERAL, INT64));
+  e->int_value_ = value;
+  return e;
+}
+
+shared_ptr<const ColumnExpression> ColumnExpression::DoubleLiteral(double value) {
+  shared_ptr<ColumnExpression> e(new ColumnExpression(ColumnExpressionPB::LITERAL, DOUBLE));
+  e->double_value_ = value;
+  return e;
+}
+
+shared_ptr<const ColumnExpression> ColumnExpression::StringLiteral(string value) {
+  shared_ptr<ColumnExpression> e(new ColumnExpression(ColumnExpressionPB::LITERAL, STRING));
+  e->string_value_ = std::move(value);
+  return e;
+}
+
+Status ColumnExpression::Create(Op op,
+                                vector<shared_ptr<const ColumnExpression>> args,
+                                shared_ptr<const ColumnExpression>* expr) {
+  const auto check_num_args = [&](size_t num_args) {
+    if (args.size() != num_args) {
+      return Status::InvalidArgument(Substitute("$0 takes $1 arguments, not $2",
+                                                ColumnExpressionPB::Op_Name(op),
+                                                num_args, args.size()));
+    }
+    return Status::OK();
+  };
+  const auto type_error = [&]() {
+    return Status::InvalidArgument(Substitute(
+        "$0 is not defined on arguments of types $1", ColumnExpressionPB::Op_Name(op),
+        JoinMapped(args, [](const shared_ptr<const ColumnExpression>& arg) {
+          return string(ValueTypeName(arg->type()));
+        }, ", ")));
+  };
+
+  ValueType type;
+  switch (op) {
+    case ColumnExpressionPB::ADD:
+    case ColumnExpressionPB::SUBTRACT:
+    case ColumnExpressionPB::MULTIPLY:
+    case ColumnExpressionPB::DIVIDE:
+    case ColumnExpressionPB::MODULO:
+      RETURN_NOT_OK(check_num_args(2));
+      if (!IsNumeric(args[0]->type()) || !IsNumeric(args[1]->type())) {
+        return type_error();
+      }
+      type = args[0]->type() == DOUBLE || args[1]->type() == DOUBLE ? DOUBLE : INT64;
+      break;
+    case ColumnExpressionPB::EQUAL:
+    case ColumnExpressionPB::NOT_EQUAL:
+    case ColumnExpressionPB::LESS:
+    case ColumnExpressionPB::LESS_EQUAL:
+    case ColumnExpressionPB::GREATER:
+    case ColumnExpressionPB::GREATER_EQUAL:
+      RETURN_NOT_OK(check_num_args(2));
+      if (args[0]->type() != args[1]->type() &&
+          !(IsNumeric(args[0]->type()) && IsNumeric(args[1]->type()))) {
+        return type_error();
+      }
+      type = BOOL;
+      break;
+    case ColumnExpressionPB::AND:
+    case ColumnExpressionPB::OR:
+      RETURN_NOT_OK(check_num_args(2));
+      if (args[0]->type() != BOOL || args[1]->type() != BOOL) {
+        return type_error();
+      }
+      type = BOOL;
+      break;
+    case ColumnExpressionPB::NOT:
+      RETURN_NOT_OK(check_num_args(1));
+      if (args[0]->type() != BOOL) {
+        return type_error();
+      }
+      type = BOOL;
+      break;
+    case ColumnExpressionPB::IS_NULL:
+    case ColumnExpressionPB::IS_NOT_NULL:
+      RETURN_NOT_OK(check_num_args(1));
+      type = BOOL;
+      break;
+    case ColumnExpressionPB::LOWER:
+    case ColumnExpressionPB::UPPER:
+    case ColumnExpressionPB::LENGTH:
+      RETURN_NOT_OK(check_num_args(1));
+      if (args[0]->type() != STRING) {
+        return type_error();
+      }
+      type = op == ColumnExpressionPB::LENGTH ? INT64 : STRING;
+      break;
+    case ColumnExpressionPB::CAST_INT64:
+      RETURN_NOT_OK(check_num_args(1));
+      type = INT64;
+      break;
+    case ColumnExpressionPB::CAST_DOUBLE:
+      RETURN_NOT_OK(check_num_args(1));
+      type = DOUBLE;
+      break;
+    case ColumnExpressionPB::CAST_STRING:
+      RETURN_NOT_OK(check_num_args(1));
+      type = STRING;
+      break;
+    default:
+      return Status::InvalidArgument("invalid expression operator",
+                                     ColumnExpressionPB::Op_Name(op));
+  }
+  shared_ptr<ColumnExpression> e(new ColumnExpression(op, type));
+  e->args_ = std::move(args);
+  *expr = std::move(e);
+  return Status::OK();
+}
+
+void ColumnExpression::GetColumns(vector<ColumnSchema>* columns) const {
+  if (column_) {
+    columns->push_back(*column_);
+  }
+  for (const auto& arg : args_) {
+    arg->GetColumns(columns);
+  }
+}
+
+string ColumnExpression::ToString() const {
+  switch (op_) {
+    case ColumnExpressionPB::COLUMN:
+      return column_->name();
+    case ColumnExpressionPB::LITERAL:
+      switch (type_) {
+        case BOOL: return int_value_ ? "true" : "false";
+        case INT64: return KUDU_REDACT(SimpleItoa(int_value_));
+        case DOUBLE: return KUDU_REDACT(SimpleDtoa(double_value_));
+        case STRING: return KUDU_REDACT(Substitute("\"$0\"", strings::CHexEscape(string_value_)));
+      }
+      break;
+    case ColumnExpressionPB::NOT:
+      return Substitute("NOT $0", args_[0]->ToString());
+    case ColumnExpressionPB::IS_NULL:
+      return Substitute("($0 IS NULL)", args_[0]->ToString());
+    case ColumnExpressionPB::IS_NOT_NULL:
+      return Substitute("($0 IS NOT NULL)", args_[0]->ToString());
+    case ColumnExpressionPB::LOWER:
+      return Substitute("lower($0)", args_[0]->ToString());
+    case ColumnExpressionPB::UPPER:
+      return Substitute("upper($0)", args_[0]->ToString());
+    case ColumnExpressionPB::LENGTH:
+      return Substitute("length($0)", args_[0]->ToString());
+    case ColumnExpressionPB::CAST_INT64:
+    case ColumnExpressionPB::CAST_DOUBLE:
+    case ColumnExpressionPB::CAST_STRING:
+      return Substitute("cast($0 AS $1)", args_[0]->ToString(), ValueTypeName(type_));
+    default:
+      break;
+  }
+  DCHECK(BinaryOpSymbol(op_));
+  return Substitute("($0 $1 $2)", args_[0]->ToString(), BinaryOpSymbol(op_),
+                    args_[1]->ToString());
+}
+
+Status ColumnExpression::Filter(RowBlock* block) const {
+  DCHECK_EQ(BOOL, type_);
+  const SelectedRows sel = block->selection_vector()->GetSelectedRows();
+  if (sel.num_selected() == 0) {
+    return Status::OK();
+  }
+  Arena arena(1024);
+  Values values;
+  RETURN_NOT_OK(Evaluate(*block, sel, &arena, &values));
+  vector<uint16_t> unselected;
+  sel.ForEachIndex([&](uint16_t i) {
+    if (values.is_null[i] || !values.ints[i]) {
+      unselected.push_back(i);
+    }
+  });
+  for (uint16_t i : unselected) {
+    block->selection_vector()->SetRowUnselected(i);
+  }
+  return Status::OK();
+}
+
+Status ColumnExpression::Evaluate(const RowBlock& block, const SelectedRows& sel,
+                                  Arena* arena, Values* values) const {
+  const size_t num_rows = block.nrows();
+  values->Reset(type_, num_rows);
+
+  if (op_ == ColumnExpressionPB::COLUMN) {
+    const int col_idx = block.schema()->find_column(column_->name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("expression column not found in projection",
+                                     column_->name());
+    }
+    const ColumnBlock cblock = block.column_block(col_idx);
+    if (cblock.is_nullable()) {
+      sel.ForEachIndex([&](uint16_t i) {
+        values->is_null[i] = cblock.is_null(i);
+      });
+    }
+    // The value types shadow the data types of the same names.
+    switch (cblock.type_info()->physical_type()) {
+      case kudu::BOOL: ReadCells<kudu::BOOL>(cblock, sel, &values->ints); break;
+      case INT8: ReadCells<INT8>(cblock, sel, &values->ints); break;
+      case INT16: ReadCells<INT16>(cblock, sel, &values->ints); break;
+      case INT32: ReadCells<INT32>(cblock, sel, &values->ints); break;
+      case kudu::INT64: ReadCells<kudu::INT64>(cblock, sel, &values->ints); break;
+      case FLOAT: ReadCells<FLOAT>(cblock, sel, &values->doubles); break;
+      case kudu::DOUBLE: ReadCells<kudu::DOUBLE>(cblock, sel, &values->doubles); break;
+      case BINARY: {
+        // The cells of null strings may not point to valid data, but are
+        // never dereferenced.
+        const Slice* data = reinterpret_cast<const Slice*>(cblock.data());
+        sel.ForEachIndex([&](uint16_t i) {
+          values->strings[i] = data[i];
+        });
+        break;
+      }
+      default:
+        LOG(FATAL) << "unexpected physical type of column " << column_->ToString();
+    }
+    return Status::OK();
+  }
+
+  if (op_ == ColumnExpressionPB::LITERAL) {
+    sel.ForEachIndex([&](uint16_t i) {
+      switch (type_) {
+        case BOOL:
+        case INT64:
+          values->ints[i] = int_value_;
+          break;
+        case DOUBLE:
+          values->doubles[i] = double_value_;
+          break;
+        case STRING:
+          values->strings[i] = Slice(string_value_);
+          break;
+      }
+    });
+    return Status::OK();
+  }
+
+  vector<Values> args(args_.size());
+  for (int i = 0; i < args_.size(); i++) {
+    RETURN_NOT_OK(args_[i]->Evaluate(block, sel, arena, &args[i]));
+  }
+  Values& a = args[0];
+  // Unless stated otherwise, expressions are NULL if any of their arguments is.
+  const auto propagate_nulls = [&]() {
+    sel.ForEachIndex([&](uint16_t i) {
+      for (const auto& arg : args) {
+        values->is_null[i] |= arg.is_null[i];
+      }
+    });
+  };
+
+  switch (op_) {
+    case ColumnExpressionPB::ADD:
+    case ColumnExpressionPB::SUBTRACT:
+    case ColumnExpressionPB::MULTIPLY:
+    case ColumnExpressionPB::DIVIDE:
+    case ColumnExpressionPB::MODULO: {
+      propagate_nulls();
+      Values& b = args[1];
+      if (type_ == INT64) {
+        sel.ForEachIndex([&](uint16_t i) {
+          if (!values->is_null[i] &&
+              !ApplyArithmetic(op_, a.ints[i], b.ints[i], &values->ints[i])) {
+            values->is_null[i] = 1;
+          }
+        });
+      } else {
+        if (args_[0]->type() == INT64) {
+          ConvertToDouble(sel, &a.ints, &a.doubles);
+        }
+        if (args_[1]->type() == INT64) {
+          ConvertToDouble(sel, &b.ints, &b.doubles);
+        }
+        sel.ForEachIndex([&](uint16_t i) {
+          if (!values->is_null[i] &&
+              !ApplyArithmetic(op_, a.doubles[i], b.doubles[i], &values->doubles[i])) {
+            values->is_null[i] = 1;
+          }
+        });
+      }
+      break;
+    }
+    case ColumnExpressionPB::EQUAL:
+    case ColumnExpressionPB::NOT_EQUAL:
+    case ColumnExpressionPB::LESS:
+    case ColumnExpressionPB::LESS_EQUAL:
+    case ColumnExpressionPB::GREATER:
+    case ColumnExpressionPB::GREATER_EQUAL: {
+      propagate_nulls();
+      Values& b = args[1];
+      const ValueType a_type = args_[0]->type();
+      const ValueType b_type = args_[1]->type();
+      const auto compare_all = [&](const auto& av, const auto& bv) {
+        sel.ForEachIndex([&](uint16_t i) {
+          values->ints[i] = ComparisonHolds(op_, Compare(av[i], bv[i]));
+        });
+      };
+      if (a_type == STRING) {
+        compare_all(a.strings, b.strings);
+      } else if (a_type == b_type && a_type != DOUBLE) {
+        compare_all(a.ints, b.ints);
+      } else {
+        if (a_type == INT64) {
+          ConvertToDouble(sel, &a.ints, &a.doubles);
+        }
+        if (b_type == INT64) {
+          ConvertToDouble(sel, &b.ints, &b.doubles);
+        }
+        compare_all(a.doubles, b.doubles);
+      }
+      break;
+    }
+    case ColumnExpressionPB::AND:
+    case ColumnExpressionPB::OR: {
+      // A false argument makes AND false, and a true one makes OR true, even
+      // if the other argument is NULL.
+      const bool is_and = op_ == ColumnExpressionPB::AND;
+      Values& b = args[1];
+      sel.ForEachIndex([&](uint16_t i) {
+        const bool a_decides = !a.is_null[i] && a.ints[i] != is_and;
+        const bool b_decides = !b.is_null[i] && b.ints[i] != is_and;
+        if (a_decides || b_decides) {
+          values->ints[i] = !is_and;
+        } else if (a.is_null[i] || b.is_null[i]) {
+          values->is_null[i] = 1;
+        } else {
+          values->ints[i] = is_and;
+        }
+      });
+      break;
+    }
+    case ColumnExpressionPB::NOT:
+      propagate_nulls();
+      sel.ForEachIndex([&](uint16_t i) {
+        values->ints[i] = !a.ints[i];
+      });
+      break;
+    case ColumnExpressionPB::IS_NULL:
+    case ColumnExpressionPB::IS_NOT_NULL: {
+      const bool is_null = op_ == ColumnExpressionPB::IS_NULL;
+      sel.ForEachIndex([&](uint16_t i) {
+        values->ints[i] = (a.is_null[i] != 0) == is_null;
+      });
+      break;
+    }
+    case ColumnExpressionPB::LOWER:
+    case ColumnExpressionPB::UPPER: {
+      propagate_nulls();
+      const bool lower = op_ == ColumnExpressionPB::LOWER;
+      bool out_of_memory = false;
+      sel.ForEachIndex([&](uint16_t i) {
+        if (values->is_null[i] || out_of_memory) {
+          return;
+        }
+        const Slice& in = a.strings[i];
+        uint8_t* out = static_cast<uint8_t*>(arena->AllocateBytes(in.size()));
+        if (PREDICT_FALSE(!out && in.size() > 0)) {
+          out_of_memory = true;
+          return;
+        }
+        for (size_t j = 0; j < in.size(); j++) {
+          out[j] = lower ? ascii_tolower(in[j]) : ascii_toupper(in[j]);
+        }
+        values->strings[i] = Slice(out, in.size());
+      });
+      if (PREDICT_FALSE(out_of_memory)) {
+        return Status::RuntimeError("out of memory evaluating expression", ToString());
+      }
+      break;
+    }
+    case ColumnExpressionPB::LENGTH:
+      propagate_nulls();
+      sel.ForEachIndex([&](uint16_t i) {
+        values->ints[i] = a.strings[i].size();
+      });
+      break;
+    case ColumnExpressionPB::CAST_INT64:
+      propagate_nulls();
+      switch (args_[0]->type()) {
+        case BOOL:
+        case INT64:
+          values->ints = std::move(a.ints);
+          break;
+        case DOUBLE:
+          sel.ForEachIndex([&](uint16_t i) {
+            const double d = a.doubles[i];
+            // The range of INT64 is [-2^63, 2^63), and NaN is out of it.
+            if (d >= -9223372036854775808.0 && d < 9223372036854775808.0) {
+              values->ints[i] = static_cast<int64_t>(d);
+            } else {
+              values->is_null[i] = 1;
+            }
+          });
+          break;
+        case STRING:
+          sel.ForEachIndex([&](uint16_t i) {
+            const Slice& s = a.strings[i];
+            if (!values->is_null[i] &&
+                !safe_strto64(reinterpret_cast<const char*>(s.data()), s.size(),
+                              &values->ints[i])) {
+              values->is_null[i] = 1;
+            }
+          });
+          break;
+      }
+      break;
+    case ColumnExpressionPB::CAST_DOUBLE:
+      propagate_nulls();
+      switch (args_[0]->type()) {
+        case BOOL:
+        case INT64:
+          ConvertToDouble(sel, &a.ints, &values->doubles);
+          break;
+        case DOUBLE:
+          values->doubles = std::move(a.doubles);
+          break;
+        case STRING:
+          sel.ForEachIndex([&](uint16_t i) {
+            if (!values->is_null[i] &&
+                !safe_strtod(a.strings[i].ToString(), &values->doubles[i])) {
+              values->is_null[i] = 1;
+            }
+          });
+          break;
+      }
+      break;
+    case ColumnExpressionPB::CAST_STRING: {
+      propagate_nulls();
+      const ValueType arg_type = args_[0]->type();
+      if (arg_type == STRING) {
+        values->strings = std::move(a.strings);
+        break;
+      }
+      bool out_of_memory = false;
+      sel.ForEachIndex([&](uint16_t i) {
+        if (values->is_null[i] || out_of_memory) {
+          return;
+        }
+        char buf[kFastToBufferSize];
+        Slice str;
+        switch (arg_type) {
+          case BOOL:
+            str = a.ints[i] ? "true" : "false";
+            break;
+          case INT64:
+            str = Slice(buf, FastInt64ToBufferLeft(a.ints[i], buf) - buf);
+            break;
+          default:
+            str = Slice(DoubleToBuffer(a.doubles[i], buf));
+            break;
+        }
+        out_of_memory = !CopyToArena(str, arena, &values->strings[i]);
+      });
+      if (PREDICT_FALSE(out_of_memory)) {
+        return Status::RuntimeError("out of memory evaluating expression", ToString());
+      }
+      break;
+    }
+    default:
+      LOG(FATAL) << "unexpected expression operator " << ColumnExpressionPB::Op_Name(op_);
+  }
+  return Status::OK();
+}
+
+} // namespace kudu
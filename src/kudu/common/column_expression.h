@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/optional/optional.hpp>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Arena;
+class RowBlock;
+class SelectedRows;
+
+// An expression over the columns of a row, e.g. 'a + b > 10' or
+// 'lower(s) = "x"'. See ColumnExpressionPB for the operators and the types of
+// their values.
+//
+// Expressions are pushed down to the tablet servers as predicates of the
+// scan spec, so that the rows they rule out are filtered before being shipped
+// to the client, like those ruled out by column predicates.
+//
+// Expressions are evaluated over blocks of rows: each operator is applied to
+// all of the selected rows of a block before the next operator is, so that
+// the cost per row is that of a tight loop rather than of walking the tree.
+//
+// Immutable, and thus thread-safe.
+class ColumnExpression {
+ public:
+  typedef ColumnExpressionPB::Op Op;
+
+  // The types of the values of expressions.
+  enum ValueType {
+    BOOL,
+    INT64,
+    DOUBLE,
+    STRING,
+  };
+
+  // Creates an expression yielding the values of 'column'.
+  //
+  // Returns NotSupported if the column's type can't be used in expressions.
+  static Status Column(ColumnSchema column, std::shared_ptr<const ColumnExpression>* expr);
+
+  // Create expressions yielding constants.
+  static std::shared_ptr<const ColumnExpression> BoolLiteral(bool value);
+  static std::shared_ptr<const ColumnExpression> Int64Literal(int64_t value);
+  static std::shared_ptr<const ColumnExpression> DoubleLiteral(double value);
+  static std::shared_ptr<const ColumnExpression> StringLiteral(std::string value);
+
+  // Creates an expression applying the operator 'op' to 'args'.
+  //
+  // Returns InvalidArgument if the number or the types of the arguments don't
+  // suit the operator.
+  static Status Create(Op op,
+                       std::vector<std::shared_ptr<const ColumnExpression>> args,
+                       std::shared_ptr<const ColumnExpression>* expr);
+
+  Op op() const {
+    return op_;
+  }
+
+  ValueType type() const {
+    return type_;
+  }
+
+  const std::vector<std::shared_ptr<const ColumnExpression>>& args() const {
+    return args_;
+  }
+
+  // Set for COLUMN expressions.
+  const boost::optional<ColumnSchema>& column() const {
+    return column_;
+  }
+
+  // The constant of a LITERAL expression, in the member matching its type.
+  int64_t int_value() const {
+    return int_value_;
+  }
+  double double_value() const {
+    return double_value_;
+  }
+  const std::string& string_value() const {
+    return string_value_;
+  }
+
+  // Appends the columns the expression refers to to 'columns'.
+  void GetColumns(std::vector<ColumnSchema>* columns) const;
+
+  std::string ToString() const;
+
+  // Unselects the rows of 'block' for which the expression isn't true. The
+  // expression must be of type BOOL.
+  //
+  // Returns InvalidArgument if a column of the expression is missing from the
+  // schema of the block.
+  Status Filter(RowBlock* block) const;
+
+ private:
+  struct Values;
+
+  ColumnExpression(Op op, ValueType type);
+
+  // Evaluates the expression over the rows 'sel' of 'block', allocating any
+  // strings it yields from 'arena'.
+  Status Evaluate(const RowBlock& block, const SelectedRows& sel,
+                  Arena* arena, Values* values) const;
+
+  const Op op_;
+  const ValueType type_;
+  std::vector<std::shared_ptr<const ColumnExpression>> args_;
+  boost::optional<ColumnSchema> column_;
+
+  // BOOL constants are stored as 0 or 1.
+  int64_t int_value_;
+  double double_value_;
+  std::string string_value_;
+};
+
+} // namespace kudu
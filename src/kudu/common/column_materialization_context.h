@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <glog/logging.h>
+
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 
@@ -38,7 +40,8 @@ class ColumnMaterializationContext {
       pred_(pred),
       block_(block),
       sel_(sel),
-      decoder_eval_status_(kNotSet) {
+      decoder_eval_status_(kNotSet),
+      skip_unselected_rows_(false) {
       if (!pred_ || !sel || !block) {
         decoder_eval_status_ = kDecoderEvalNotSupported;
       }
@@ -110,6 +113,21 @@ class ColumnMaterializationContext {
     decoder_eval_status_ = kDecoderEvalNotSupported;
   }
 
+  // Whether the column iterator may skip decoding ranges of rows which are
+  // already deselected in sel(), leaving their cells in the block unset (and
+  // NULL, if the block is nullable).
+  //
+  // Only valid if sel() reflects the rows that will be returned, i.e. if it
+  // will not be re-initialized after this column is materialized.
+  bool skip_unselected_rows() const {
+    return skip_unselected_rows_;
+  }
+
+  void set_skip_unselected_rows(bool skip) {
+    DCHECK(sel_ != nullptr || !skip);
+    skip_unselected_rows_ = skip;
+  }
+
  private:
   enum DecoderEvalStatus {
     // During scan, will try to evaluate with the decoder, after which the
@@ -139,6 +157,8 @@ class ColumnMaterializationContext {
   SelectionVector* const sel_;
 
   DecoderEvalStatus decoder_eval_status_;
+
+  bool skip_unselected_rows_;
 };
 
 } // namespace kudu
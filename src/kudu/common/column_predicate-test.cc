@@ -24,6 +24,7 @@
 #include <initializer_list>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -52,6 +53,8 @@
 
 using std::vector;
 
+DECLARE_bool(disable_column_predicate_avx2);
+
 namespace kudu {
 
 class TestColumnPredicate : public KuduTest {
@@ -1303,6 +1306,46 @@ TEST_F(TestColumnPredicate, TestInList) {
   }
 }
 
+// Test that evaluating IN-lists on blocks selects the rows whose cells are in
+// the list, for both short and long lists.
+TEST_F(TestColumnPredicate, TestInListEvaluation) {
+  constexpr int kNumRows = 333;
+  Random rand(SeedRandom());
+  for (int num_values : { 3, 16, 17, 50 }) {
+    for (bool nullable : { false, true }) {
+      SCOPED_TRACE(strings::Substitute("$0 values, nullable: $1", num_values, nullable));
+      ColumnSchema cs("c", INT64, nullable);
+      vector<int64_t> value_storage;
+      for (int i = 0; i < num_values; i++) {
+        value_storage.push_back(static_cast<int64_t>(i) * 3 - 20);
+      }
+      vector<const void*> values;
+      for (const auto& v : value_storage) {
+        values.push_back(&v);
+      }
+      auto pred = ColumnPredicate::InList(cs, &values);
+      ASSERT_EQ(PredicateType::InList, pred.predicate_type());
+
+      ScopedColumnBlock<INT64> b(kNumRows, nullable);
+      for (int i = 0; i < kNumRows; i++) {
+        b[i] = static_cast<int64_t>(rand.Uniform(200)) - 50;
+        if (nullable) {
+          b.SetCellIsNull(i, rand.OneIn(10));
+        }
+      }
+      SelectionVector selvec(kNumRows);
+      selvec.SetAllTrue();
+      selvec.SetRowUnselected(7);
+      pred.Evaluate(b, &selvec);
+      for (int i = 0; i < kNumRows; i++) {
+        const bool expected = i != 7 && (!nullable || !b.is_null(i)) &&
+            pred.EvaluateCell<INT64>(&b[i]);
+        ASSERT_EQ(expected, selvec.IsRowSelected(i)) << "row " << i;
+      }
+    }
+  }
+}
+
 // Test that column predicate comparison works correctly: ordered by predicate
 // type first, then size of the column type.
 TEST_F(TestColumnPredicate, TestSelectivity) {
@@ -1494,6 +1537,92 @@ TEST_F(TestColumnPredicateDeathTest, TestMergeRequiresNameAndType) {
   }, "COMPARE_NAME_AND_TYPE");
 }
 
+// Test that the vectorized range and equality kernels select the same rows as
+// the scalar evaluation, for blocks which aren't a multiple of the kernels'
+// width and with pre-existing deselected and null rows.
+template<class T>
+class VectorizedPredicateTest : public KuduTest {};
+
+using vectorized_test_types = ::testing::Types<
+  DataTypeTraits<INT8>,
+  DataTypeTraits<INT16>,
+  DataTypeTraits<INT32>,
+  DataTypeTraits<INT64>,
+  DataTypeTraits<UINT8>,
+  DataTypeTraits<UINT16>,
+  DataTypeTraits<UINT32>,
+  DataTypeTraits<UINT64>,
+  DataTypeTraits<FLOAT>,
+  DataTypeTraits<DOUBLE>>;
+
+TYPED_TEST_SUITE(VectorizedPredicateTest, vectorized_test_types);
+
+TYPED_TEST(VectorizedPredicateTest, TestMatchesScalarEvaluation) {
+  constexpr auto kColType = TypeParam::physical_type;
+  using cpp_type = typename TypeParam::cpp_type;
+  Random rand(SeedRandom());
+
+  // Values are drawn from a small range around zero, so that the predicates
+  // select a mix of rows. Unsigned values wrap around, which also covers the
+  // upper end of their range.
+  const auto random_value = [&]() {
+    if (std::is_floating_point<cpp_type>::value && rand.OneIn(20)) {
+      return static_cast<cpp_type>(NAN);
+    }
+    return static_cast<cpp_type>(static_cast<int>(rand.Uniform(9)) - 4);
+  };
+
+  for (int nrows : { 1, 31, 32, 33, 100, 1024 }) {
+    for (bool nullable : { false, true }) {
+      ColumnSchema cs("c", kColType, nullable);
+      ScopedColumnBlock<kColType> b(nrows, nullable);
+      vector<int> unselected_rows;
+      for (int i = 0; i < nrows; i++) {
+        b[i] = random_value();
+        if (nullable) {
+          b.SetCellIsNull(i, rand.OneIn(10));
+        }
+        if (rand.OneIn(5)) {
+          unselected_rows.push_back(i);
+        }
+      }
+      const auto init_selvec = [&](SelectionVector* selvec) {
+        selvec->SetAllTrue();
+        for (int i : unselected_rows) {
+          selvec->SetRowUnselected(i);
+        }
+      };
+
+      const cpp_type lower = random_value();
+      const cpp_type upper = random_value();
+      vector<ColumnPredicate> preds = {
+        ColumnPredicate::Equality(cs, &lower),
+        ColumnPredicate::Range(cs, &lower, nullptr),
+        ColumnPredicate::Range(cs, nullptr, &upper),
+        ColumnPredicate::Range(cs, &lower, &upper),
+      };
+      for (const auto& pred : preds) {
+        if (pred.predicate_type() != PredicateType::Range &&
+            pred.predicate_type() != PredicateType::Equality) {
+          // E.g. an empty range is simplified to None.
+          continue;
+        }
+        SCOPED_TRACE(strings::Substitute("$0 rows, $1", nrows, pred.ToString()));
+        SelectionVector scalar(nrows);
+        SelectionVector vectorized(nrows);
+        init_selvec(&scalar);
+        init_selvec(&vectorized);
+        FLAGS_disable_column_predicate_avx2 = true;
+        pred.Evaluate(b, &scalar);
+        FLAGS_disable_column_predicate_avx2 = false;
+        pred.Evaluate(b, &vectorized);
+        ASSERT_TRUE(scalar == vectorized)
+            << scalar.ToString() << " vs. " << vectorized.ToString();
+      }
+    }
+  }
+}
+
 template<typename TypeParam>
 class ColumnPredicateBenchmark : public KuduTest {
   protected:
@@ -1550,6 +1679,7 @@ using test_types = ::testing::Types<
   DataTypeTraits<INT16>,
   DataTypeTraits<INT32>,
   DataTypeTraits<INT64>,
+  DataTypeTraits<UINT32>,
   DataTypeTraits<FLOAT>,
   DataTypeTraits<DOUBLE>>;
 
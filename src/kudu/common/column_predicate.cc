@@ -18,22 +18,28 @@
 #include "kudu/common/column_predicate.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstring>
 #include <iterator>
 #include <type_traits>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 
+#include "kudu/common/column_predicate_avx2.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/cpu.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
 
@@ -41,6 +47,12 @@ using std::move;
 using std::string;
 using std::vector;
 
+DEFINE_bool(disable_column_predicate_avx2, false,
+            "Disable the AVX2 kernels used to evaluate range and equality predicates on "
+            "numeric columns. This flag has no effect if the target CPU doesn't support AVX2 "
+            "at run-time or Kudu was built with a compiler that doesn't support AVX2.");
+TAG_FLAG(disable_column_predicate_avx2, hidden);
+
 namespace kudu {
 
 ColumnPredicate::ColumnPredicate(PredicateType predicate_type,
@@ -651,16 +663,21 @@ namespace {
 // This technique can't safely be applied to cells like BINARY since these
 // consist of pointers, and following a junk pointer might crash the process.
 //
+// Rows before 'start_idx', which must be a multiple of 8, are assumed to have
+// been evaluated already, e.g. by one of the vectorized kernels below.
+//
 // Returns the number of elements of 'cb' that were processed. This function
 // only processes multiples of 8, so if cb.nrows() is not a multiple of 8, the
 // last few elements may need to be processed by the caller.
 template <DataType PhysicalType, typename P>
 ATTRIBUTE_NOINLINE
-int ApplyPredicatePrimitive(const ColumnBlock& block, uint8_t* __restrict__ sel_bitmap, P p) {
+int ApplyPredicatePrimitive(const ColumnBlock& block, int start_idx,
+                            uint8_t* __restrict__ sel_bitmap, P p) {
   using cpp_type = typename DataTypeTraits<PhysicalType>::cpp_type;
-  const cpp_type* data = reinterpret_cast<const cpp_type*>(block.data());
+  DCHECK_EQ(0, start_idx % 8);
+  const cpp_type* data = reinterpret_cast<const cpp_type*>(block.data()) + start_idx;
   const int n_chunks = block.nrows() / 8;
-  for (int i = 0; i < n_chunks; i++) {
+  for (int i = start_idx / 8; i < n_chunks; i++) {
     uint8_t res_8 = 0;
     for (int j = 0; j < 8; j++) {
       res_8 |= p(data++) << j;
@@ -675,17 +692,20 @@ int ApplyPredicatePrimitive(const ColumnBlock& block, uint8_t* __restrict__ sel_
   return n_chunks * 8;
 }
 
-
+// Applies the predicate 'p' to the rows of 'block' starting at 'start_idx',
+// clearing the bits of the rows which don't match in 'sel'. Rows before
+// 'start_idx' must already have been evaluated by a vectorized kernel, and
+// 'start_idx' may only be non-zero for primitive types.
 template <DataType PhysicalType, typename P>
-void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
+void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p, int start_idx = 0) {
   using cpp_type = typename DataTypeTraits<PhysicalType>::cpp_type;
-  int start_idx = 0;
   if (std::is_fundamental<cpp_type>::value) {
-    start_idx = ApplyPredicatePrimitive<PhysicalType>(block, sel->mutable_bitmap(), p);
+    start_idx = ApplyPredicatePrimitive<PhysicalType>(block, start_idx, sel->mutable_bitmap(), p);
     if (PREDICT_TRUE(start_idx == block.nrows())) return;
     // If we couldn't process the whole block unrolled by 8, fall through to the
     // remainder.
   }
+  DCHECK(std::is_fundamental<cpp_type>::value || start_idx == 0);
 
   const cpp_type* data = reinterpret_cast<const cpp_type*>(block.data());
   if (block.is_nullable()) {
@@ -707,6 +727,41 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
   }
 }
 
+#ifdef USE_AVX2
+bool UseAVX2Kernels() {
+  static const bool kCpuHasAVX2 = base::CPU().has_avx2();
+  return kCpuHasAVX2 && !FLAGS_disable_column_predicate_avx2;
+}
+#endif
+
+// Evaluates 'op' with a vectorized kernel, if one is available for the type
+// and the CPU. Like ApplyPredicatePrimitive(), junk values of null cells are
+// compared too; the caller takes care of ANDing in the null bitmap.
+//
+// Returns the number of leading rows of 'block' which were evaluated, which is
+// always a multiple of 8. The remaining rows must be evaluated by the caller.
+template <DataType PhysicalType>
+int ApplyVectorizedPredicate(const ColumnBlock& block, SelectionVector* sel, SimdPredicateOp op,
+                             typename DataTypeTraits<PhysicalType>::cpp_type lower,
+                             typename DataTypeTraits<PhysicalType>::cpp_type upper) {
+#ifdef USE_AVX2
+  using cpp_type = typename DataTypeTraits<PhysicalType>::cpp_type;
+  if constexpr (std::is_arithmetic<cpp_type>::value &&
+                !std::is_same<cpp_type, bool>::value &&
+                sizeof(cpp_type) <= sizeof(int64_t)) {
+    if (UseAVX2Kernels()) {
+      return EvaluatePredicateAVX2<cpp_type>(op, reinterpret_cast<const cpp_type*>(block.data()),
+                                             block.nrows(), lower, upper, sel->mutable_bitmap());
+    }
+  }
+#endif
+  return 0;
+}
+
+// IN-lists of up to this many values are evaluated by comparing each cell to
+// all of the values, rather than by binary search.
+constexpr size_t kMaxInListLinearScanValues = 16;
+
 template<bool IS_NOT_NULL>
 void ApplyNullPredicate(const ColumnBlock& block, uint8_t* __restrict__ sel_vec) {
   int n_bytes = KUDU_ALIGN_UP(block.nrows(), 8) / 8;
@@ -730,26 +785,34 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       cpp_type local_upper = upper_ ? *static_cast<const cpp_type*>(upper_) : cpp_type();
 
       if (lower_ == nullptr) {
+        int start_idx = ApplyVectorizedPredicate<PhysicalType>(
+            block, sel, SimdPredicateOp::kLessThan, local_lower, local_upper);
         ApplyPredicate<PhysicalType>(block, sel, [local_upper] (const void* cell) {
             return traits::Compare(cell, &local_upper) < 0;
-        });
+        }, start_idx);
       } else if (upper_ == nullptr) {
+        int start_idx = ApplyVectorizedPredicate<PhysicalType>(
+            block, sel, SimdPredicateOp::kAtLeast, local_lower, local_upper);
         ApplyPredicate<PhysicalType>(block, sel, [local_lower] (const void* cell) {
             return traits::Compare(cell, &local_lower) >= 0;
-        });
+        }, start_idx);
       } else {
+        int start_idx = ApplyVectorizedPredicate<PhysicalType>(
+            block, sel, SimdPredicateOp::kRange, local_lower, local_upper);
         ApplyPredicate<PhysicalType>(block, sel, [local_lower, local_upper] (const void* cell) {
             return traits::Compare(cell, &local_upper) < 0 &&
                    traits::Compare(cell, &local_lower) >= 0;
-        });
+        }, start_idx);
       }
       return;
     };
     case PredicateType::Equality: {
       cpp_type local_lower = lower_ ? *static_cast<const cpp_type*>(lower_) : cpp_type();
+      int start_idx = ApplyVectorizedPredicate<PhysicalType>(
+          block, sel, SimdPredicateOp::kEqual, local_lower, local_lower);
       ApplyPredicate<PhysicalType>(block, sel, [local_lower] (const void* cell) {
             return traits::Compare(cell, &local_lower) == 0;
-      });
+      }, start_idx);
       return;
     };
     case PredicateType::IsNotNull: {
@@ -766,6 +829,34 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     }
     case PredicateType::InList: {
+      if constexpr (std::is_integral<cpp_type>::value) {
+        // Copy the (sorted) values next to each other, so they're compared
+        // without chasing pointers. Short lists are scanned without branching
+        // on the result of each comparison, which lets the loop be unrolled
+        // and vectorized. Floating point values are left to the generic path,
+        // since their comparison treats NaN differently from operator==.
+        vector<cpp_type> values;
+        values.reserve(values_.size());
+        for (const void* value : values_) {
+          values.push_back(*static_cast<const cpp_type*>(value));
+        }
+        if (values.size() <= kMaxInListLinearScanValues) {
+          ApplyPredicate<PhysicalType>(block, sel, [&values] (const void* cell) {
+            const cpp_type v = *static_cast<const cpp_type*>(cell);
+            bool found = false;
+            for (const cpp_type& value : values) {
+              found |= value == v;
+            }
+            return found;
+          });
+        } else {
+          ApplyPredicate<PhysicalType>(block, sel, [&values] (const void* cell) {
+            return std::binary_search(values.begin(), values.end(),
+                                      *static_cast<const cpp_type*>(cell));
+          });
+        }
+        return;
+      }
       ApplyPredicate<PhysicalType>(block, sel, [this] (const void* cell) {
         return std::binary_search(values_.begin(), values_.end(), cell,
                                   [] (const void* lhs, const void* rhs) {
@@ -0,0 +1,56 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+// Vectorized kernels used by ColumnPredicate::Evaluate() for range and
+// equality predicates on fixed-width numeric columns.
+//
+// The kernels are only compiled if the compiler supports AVX2 (in which case
+// USE_AVX2 is defined), and must only be called if the CPU supports AVX2 at
+// run-time.
+
+#include <cstdint>
+
+namespace kudu {
+
+// The comparison evaluated by a kernel.
+enum class SimdPredicateOp {
+  // value == lower
+  kEqual,
+  // value < upper
+  kLessThan,
+  // value >= lower
+  kAtLeast,
+  // lower <= value < upper
+  kRange,
+};
+
+#ifdef USE_AVX2
+// Evaluates 'op' against the first 'nrows' values of 'data', rounded down to
+// a multiple of 32, and ANDs the results into 'sel_bitmap'. Returns the number
+// of rows which were processed.
+//
+// Comparisons have the same semantics as DataTypeTraits<>::Compare(); in
+// particular, a NaN floating point value compares equal to any value.
+//
+// Instantiated for all signed and unsigned integer types, float and double.
+template<typename T>
+int EvaluatePredicateAVX2(SimdPredicateOp op, const T* data, int nrows,
+                          T lower, T upper, uint8_t* sel_bitmap);
+#endif
+
+} // namespace kudu
@@ -0,0 +1,172 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_statistics.h"
+
+#include <cstdint>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/columnblock-test-util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/common/types.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+
+namespace kudu {
+
+namespace {
+
+// Collects the statistics of 'num_rows' INT32 values, row i having the value
+// 'first_value + i % num_distinct', and every 'null_every'-th row being NULL.
+void CollectInt32Stats(int num_rows, int32_t first_value, int num_distinct,
+                       int null_every, ColumnStatisticsPB* pb) {
+  ColumnStatisticsCollector collector(/*column_id=*/5, GetTypeInfo(INT32));
+  ScopedColumnBlock<INT32> block(num_rows);
+  for (int i = 0; i < num_rows; i++) {
+    block[i] = first_value + i % num_distinct;
+    block.SetCellIsNull(i, i % null_every == 0);
+  }
+  collector.AddValues(block);
+  collector.ToPB(pb);
+}
+
+string EncodeInt32(int32_t v) {
+  faststring buf;
+  GetKeyEncoder<faststring>(GetTypeInfo(INT32)).Encode(&v, &buf);
+  return buf.ToString();
+}
+
+void CheckHistogram(const ColumnStatisticsPB& pb) {
+  ASSERT_EQ(pb.histogram_bounds_size(), pb.histogram_counts_size());
+  ASSERT_GT(pb.histogram_bounds_size(), 0);
+  uint64_t total = 0;
+  for (int i = 0; i < pb.histogram_bounds_size(); i++) {
+    if (i > 0) {
+      ASSERT_LT(pb.histogram_bounds(i - 1), pb.histogram_bounds(i));
+    }
+    total += pb.histogram_counts(i);
+  }
+  ASSERT_EQ(pb.value_count(), total);
+  ASSERT_EQ(pb.max_value(), pb.histogram_bounds(pb.histogram_bounds_size() - 1));
+}
+
+} // anonymous namespace
+
+TEST(ColumnStatisticsTest, TestCollect) {
+  ColumnStatisticsPB pb;
+  CollectInt32Stats(10000, -500, 1000, 10, &pb);
+  EXPECT_EQ(5, pb.column_id());
+  EXPECT_EQ(1000, pb.null_count());
+  EXPECT_EQ(9000, pb.value_count());
+  // Rows 0, 10, 20... are NULL, so values equal to -500 mod 10 never appear.
+  EXPECT_EQ(EncodeInt32(-499), pb.min_value());
+  EXPECT_EQ(EncodeInt32(499), pb.max_value());
+  const uint64_t ndv = EstimateDistinctValues(pb);
+  EXPECT_NEAR(900, ndv, 900 * 0.2);
+  NO_FATALS(CheckHistogram(pb));
+
+  // The values are uniformly distributed: the median is about 0.
+  uint64_t cumulative = 0;
+  for (int i = 0; i < pb.histogram_bounds_size(); i++) {
+    cumulative += pb.histogram_counts(i);
+    if (cumulative >= pb.value_count() / 2) {
+      EXPECT_GT(pb.histogram_bounds(i), EncodeInt32(-100));
+      EXPECT_LT(pb.histogram_bounds(i), EncodeInt32(100));
+      break;
+    }
+  }
+}
+
+TEST(ColumnStatisticsTest, TestFewValues) {
+  ColumnStatisticsPB pb;
+  CollectInt32Stats(6, 0, 3, 1000, &pb);
+  EXPECT_EQ(1, pb.null_count());
+  EXPECT_EQ(5, pb.value_count());
+  EXPECT_EQ(3, EstimateDistinctValues(pb));
+  NO_FATALS(CheckHistogram(pb));
+  EXPECT_EQ(3, pb.histogram_bounds_size());
+
+  // No values at all.
+  CollectInt32Stats(4, 0, 3, 1, &pb);
+  EXPECT_EQ(4, pb.null_count());
+  EXPECT_EQ(0, pb.value_count());
+  EXPECT_FALSE(pb.has_min_value());
+  EXPECT_EQ(0, pb.histogram_bounds_size());
+  EXPECT_EQ(0, EstimateDistinctValues(pb));
+}
+
+TEST(ColumnStatisticsTest, TestMerge) {
+  ColumnStatisticsPB a;
+  ColumnStatisticsPB b;
+  CollectInt32Stats(5000, 0, 1000, 1000, &a);
+  CollectInt32Stats(5000, 500, 1000, 1000, &b);
+  ColumnStatisticsPB merged = a;
+  MergeColumnStatistics(b, &merged);
+  EXPECT_EQ(10, merged.null_count());
+  EXPECT_EQ(9990, merged.value_count());
+  EXPECT_EQ(EncodeInt32(1), merged.min_value());
+  EXPECT_EQ(EncodeInt32(1499), merged.max_value());
+  // The values of the two sets overlap: there are about 1500 distinct ones.
+  EXPECT_NEAR(1500, EstimateDistinctValues(merged), 1500 * 0.2);
+  NO_FATALS(CheckHistogram(merged));
+
+  // Merging into empty statistics copies the statistics over.
+  ColumnStatisticsPB empty;
+  empty.set_column_id(5);
+  MergeColumnStatistics(a, &empty);
+  EXPECT_EQ(a.SerializeAsString(), empty.SerializeAsString());
+}
+
+TEST(ColumnStatisticsTest, TestStrings) {
+  ColumnStatisticsCollector collector(/*column_id=*/1, GetTypeInfo(STRING));
+  ScopedColumnBlock<STRING> block(3);
+  const string long_value(100, 'z');
+  block[0] = Slice("b");
+  block[1] = Slice(long_value);
+  block[2] = Slice("a");
+  for (int i = 0; i < 3; i++) {
+    block.SetCellIsNull(i, false);
+  }
+  collector.AddValues(block);
+  ColumnStatisticsPB pb;
+  collector.ToPB(&pb);
+  EXPECT_EQ("a", pb.min_value());
+  EXPECT_EQ(string(64, 'z'), pb.max_value());
+  EXPECT_EQ(3, EstimateDistinctValues(pb));
+  NO_FATALS(CheckHistogram(pb));
+
+  // The types with no key encoding only get counts and NDV estimates.
+  ColumnStatisticsCollector double_collector(/*column_id=*/2, GetTypeInfo(DOUBLE));
+  ScopedColumnBlock<DOUBLE> doubles(2, /*allow_nulls=*/false);
+  doubles[0] = 1.5;
+  doubles[1] = 1.5;
+  double_collector.AddValues(doubles);
+  double_collector.ToPB(&pb);
+  EXPECT_EQ(2, pb.value_count());
+  EXPECT_EQ(1, EstimateDistinctValues(pb));
+  EXPECT_FALSE(pb.has_min_value());
+  EXPECT_EQ(0, pb.histogram_bounds_size());
+}
+
+} // namespace kudu
@@ -0,0 +1,267 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/columnblock.h"
+#include "kudu/common/types.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/slice.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+namespace {
+
+// The HyperLogLog sketches have 2^kHllPrecision registers. With 256 registers,
+// the standard error of the estimates is about 6.5%: enough for planning, for
+// a sketch small enough to be kept in the metadata of every rowset.
+constexpr int kHllPrecision = 8;
+constexpr size_t kHllRegisters = 1 << kHllPrecision;
+
+// The seed of the hashes of the values, which must never change: the sketches
+// are persisted and merged.
+constexpr uint64_t kHllSeed = 0x6b75647563730a00;
+
+// The number of values sampled to build the histograms with, and the number of
+// buckets of the histograms.
+constexpr size_t kSampleSize = 512;
+constexpr size_t kHistogramBuckets = 16;
+
+// The encoded values recorded in the statistics are truncated to this length.
+constexpr size_t kMaxValueLength = 64;
+
+Slice ValueBytes(const TypeInfo* type_info, const void* cell) {
+  if (type_info->physical_type() == BINARY) {
+    return *reinterpret_cast<const Slice*>(cell);
+  }
+  return Slice(reinterpret_cast<const uint8_t*>(cell), type_info->size());
+}
+
+// Sets the histogram of 'pb' to kHistogramBuckets buckets of about the same
+// count, from the buckets 'buckets', sorted by bound.
+void SetHistogram(const vector<pair<string, uint64_t>>& buckets, ColumnStatisticsPB* pb) {
+  pb->clear_histogram_bounds();
+  pb->clear_histogram_counts();
+  uint64_t total = 0;
+  for (const auto& b : buckets) {
+    total += b.second;
+  }
+  if (total == 0) {
+    return;
+  }
+  uint64_t cumulative = 0;
+  uint64_t emitted = 0;
+  size_t next_bucket = 1;
+  for (int i = 0; i < buckets.size(); i++) {
+    cumulative += buckets[i].second;
+    // Buckets sharing a bound are merged, for the bounds to be distinct.
+    if (i + 1 < buckets.size() && buckets[i + 1].first == buckets[i].first) {
+      continue;
+    }
+    if (i + 1 < buckets.size() && cumulative < next_bucket * total / kHistogramBuckets) {
+      continue;
+    }
+    pb->add_histogram_bounds(buckets[i].first);
+    pb->add_histogram_counts(cumulative - emitted);
+    emitted = cumulative;
+    while (next_bucket * total / kHistogramBuckets <= cumulative &&
+           next_bucket < kHistogramBuckets) {
+      next_bucket++;
+    }
+  }
+}
+
+} // anonymous namespace
+
+ColumnStatisticsCollector::ColumnStatisticsCollector(int32_t column_id,
+                                                     const TypeInfo* type_info)
+    : column_id_(column_id),
+      type_info_(type_info),
+      key_encoder_(IsTypeAllowableInKey(type_info) ?
+                   &GetKeyEncoder<faststring>(type_info) : nullptr),
+      null_count_(0),
+      value_count_(0),
+      hll_registers_(kHllRegisters, '\0'),
+      rng_(column_id) {
+}
+
+void ColumnStatisticsCollector::AddValues(const ColumnBlock& block) {
+  DCHECK_EQ(type_info_->physical_type(), block.type_info()->physical_type());
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (block.is_nullable() && block.is_null(i)) {
+      null_count_++;
+      continue;
+    }
+    AddValue(block.cell_ptr(i));
+  }
+}
+
+void ColumnStatisticsCollector::AddValue(const void* cell) {
+  const Slice bytes = ValueBytes(type_info_, cell);
+  const uint64_t hash = HashUtil::FastHash64(bytes.data(), bytes.size(), kHllSeed);
+  // The leading bits of the hash pick the register, which keeps the longest
+  // run of leading zeros (plus one) seen in the remaining bits.
+  const size_t idx = hash >> (64 - kHllPrecision);
+  const uint64_t rest = hash << kHllPrecision;
+  const uint8_t rank = rest == 0 ? 64 - kHllPrecision + 1 : __builtin_clzll(rest) + 1;
+  if (rank > static_cast<uint8_t>(hll_registers_[idx])) {
+    hll_registers_[idx] = static_cast<char>(rank);
+  }
+
+  const uint64_t n = value_count_++;
+  if (!key_encoder_) {
+    return;
+  }
+  encoded_.clear();
+  key_encoder_->Encode(cell, /*is_last=*/true, &encoded_);
+  const Slice value(encoded_.data(), std::min(encoded_.size(), kMaxValueLength));
+  if (n == 0 || value.compare(Slice(min_value_)) < 0) {
+    min_value_ = value.ToString();
+  }
+  if (n == 0 || value.compare(Slice(max_value_)) > 0) {
+    max_value_ = value.ToString();
+  }
+
+  // Reservoir sampling: the n-th value replaces a random sampled value with
+  // probability kSampleSize / (n + 1).
+  if (n < kSampleSize) {
+    sample_.emplace_back(value.ToString());
+  } else {
+    const uint64_t j = rng_.Uniform64(n + 1);
+    if (j < kSampleSize) {
+      sample_[j] = value.ToString();
+    }
+  }
+}
+
+void ColumnStatisticsCollector::ToPB(ColumnStatisticsPB* pb) const {
+  pb->Clear();
+  pb->set_column_id(column_id_);
+  pb->set_null_count(null_count_);
+  pb->set_value_count(value_count_);
+  if (value_count_ == 0) {
+    return;
+  }
+  pb->set_hll_registers(hll_registers_);
+  if (!key_encoder_) {
+    return;
+  }
+  pb->set_min_value(min_value_);
+  pb->set_max_value(max_value_);
+
+  // Each sampled value stands for value_count_ / sample_.size() values.
+  vector<string> sorted(sample_);
+  std::sort(sorted.begin(), sorted.end());
+  vector<pair<string, uint64_t>> buckets;
+  buckets.reserve(sorted.size());
+  uint64_t assigned = 0;
+  for (size_t i = 0; i < sorted.size(); i++) {
+    const uint64_t cumulative = value_count_ * (i + 1) / sorted.size();
+    buckets.emplace_back(std::move(sorted[i]), cumulative - assigned);
+    assigned = cumulative;
+  }
+  // The sample may have missed the largest value.
+  buckets.back().first = max_value_;
+  SetHistogram(buckets, pb);
+}
+
+void MergeColumnStatistics(const ColumnStatisticsPB& src, ColumnStatisticsPB* dst) {
+  DCHECK_EQ(src.column_id(), dst->column_id());
+  const bool dst_has_values = dst->value_count() > 0;
+  dst->set_null_count(dst->null_count() + src.null_count());
+  dst->set_value_count(dst->value_count() + src.value_count());
+  if (src.value_count() == 0) {
+    return;
+  }
+  if (!dst_has_values) {
+    dst->set_hll_registers(src.hll_registers());
+    if (src.has_min_value()) {
+      dst->set_min_value(src.min_value());
+      dst->set_max_value(src.max_value());
+    }
+    *dst->mutable_histogram_bounds() = src.histogram_bounds();
+    *dst->mutable_histogram_counts() = src.histogram_counts();
+    return;
+  }
+
+  // The union of two sketches keeps the maximum of each register.
+  if (src.hll_registers().size() == dst->hll_registers().size()) {
+    string* registers = dst->mutable_hll_registers();
+    for (size_t i = 0; i < registers->size(); i++) {
+      (*registers)[i] = std::max<uint8_t>((*registers)[i], src.hll_registers()[i]);
+    }
+  } else {
+    dst->clear_hll_registers();
+  }
+
+  if (src.has_min_value() && dst->has_min_value()) {
+    dst->set_min_value(std::min(dst->min_value(), src.min_value()));
+    dst->set_max_value(std::max(dst->max_value(), src.max_value()));
+  }
+
+  // The buckets of both histograms are merged, and re-bucketed to the
+  // histogram's size.
+  vector<pair<string, uint64_t>> buckets;
+  for (const ColumnStatisticsPB* pb : { &src, static_cast<const ColumnStatisticsPB*>(dst) }) {
+    DCHECK_EQ(pb->histogram_bounds_size(), pb->histogram_counts_size());
+    for (int i = 0; i < pb->histogram_bounds_size(); i++) {
+      buckets.emplace_back(pb->histogram_bounds(i), pb->histogram_counts(i));
+    }
+  }
+  std::stable_sort(buckets.begin(), buckets.end(),
+                   [](const pair<string, uint64_t>& a, const pair<string, uint64_t>& b) {
+                     return a.first < b.first;
+                   });
+  SetHistogram(buckets, dst);
+}
+
+uint64_t EstimateDistinctValues(const ColumnStatisticsPB& stats) {
+  const string& registers = stats.hll_registers();
+  if (stats.value_count() == 0 || registers.empty()) {
+    return 0;
+  }
+  const double m = registers.size();
+  double sum = 0;
+  int zeros = 0;
+  for (char r : registers) {
+    const uint8_t rank = static_cast<uint8_t>(r);
+    sum += std::ldexp(1.0, -rank);
+    if (rank == 0) {
+      zeros++;
+    }
+  }
+  const double alpha = 0.7213 / (1 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+  if (estimate <= 2.5 * m && zeros > 0) {
+    // Linear counting is more accurate for small cardinalities.
+    estimate = m * std::log(m / zeros);
+  }
+  return std::min<uint64_t>(std::llround(estimate), stats.value_count());
+}
+
+} // namespace kudu
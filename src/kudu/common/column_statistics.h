@@ -0,0 +1,86 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/key_encoder.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/random.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class TypeInfo;
+
+// Collects the statistics of the values of a column as they're written, e.g.
+// by the DiskRowSetWriter of a flush or compaction. See ColumnStatisticsPB.
+//
+// The number of distinct values is estimated by a HyperLogLog sketch, and the
+// histogram is built from a fixed-size reservoir sample of the values, so the
+// memory used doesn't depend on the number of values.
+//
+// Not thread-safe.
+class ColumnStatisticsCollector {
+ public:
+  ColumnStatisticsCollector(int32_t column_id, const TypeInfo* type_info);
+
+  // Accounts for the values of 'block', selected or not, which must be of the
+  // collector's type.
+  void AddValues(const ColumnBlock& block);
+
+  // Sets 'pb' to the statistics of the values added so far.
+  void ToPB(ColumnStatisticsPB* pb) const;
+
+ private:
+  void AddValue(const void* cell);
+
+  const int32_t column_id_;
+  const TypeInfo* const type_info_;
+
+  // The key encoder of the column's type, or nullptr if it has none, in which
+  // case neither the bounds nor the histogram are collected.
+  const KeyEncoder<faststring>* const key_encoder_;
+
+  uint64_t null_count_;
+  uint64_t value_count_;
+  std::string hll_registers_;
+  std::string min_value_;
+  std::string max_value_;
+
+  // The key-encoded sample of the values.
+  std::vector<std::string> sample_;
+  Random rng_;
+
+  // Scratch buffer for key-encoding values.
+  faststring encoded_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnStatisticsCollector);
+};
+
+// Merges the statistics 'src' of values of a column into the statistics 'dst'
+// of other values of the same column.
+void MergeColumnStatistics(const ColumnStatisticsPB& src, ColumnStatisticsPB* dst);
+
+// Returns the estimated number of distinct non-NULL values of 'stats'.
+uint64_t EstimateDistinctValues(const ColumnStatisticsPB& stats);
+
+} // namespace kudu
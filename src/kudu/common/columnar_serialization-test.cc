@@ -27,12 +27,19 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
+#include "kudu/common/schema.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/random.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_util.h"
 
+using std::string;
 using std::vector;
 
 namespace kudu {
@@ -176,4 +183,108 @@ TEST_F(ColumnarSerializationTest, TestCopySelectedRows) {
   ASSERT_EQ(expected, ret);
 }
 
+// Test serializing string cells whose data is contiguous in memory, as well as
+// cells whose data is scattered, with all or some of the rows selected.
+TEST_F(ColumnarSerializationTest, TestCopyVarlenCells) {
+  const Schema schema({ ColumnSchema("s", STRING, /*is_nullable=*/true) }, 0);
+  const int num_rows = rng_.Uniform(1000) + 1;
+  vector<string> strs;
+  string all_data;
+  for (int i = 0; i < num_rows; i++) {
+    strs.emplace_back(rng_.Uniform(20), 'a' + i % 26);
+    all_data += strs.back();
+  }
+
+  for (bool contiguous : { true, false }) {
+    for (bool all_selected : { true, false }) {
+      SCOPED_TRACE(contiguous);
+      SCOPED_TRACE(all_selected);
+      RowBlockMemory mem;
+      RowBlock block(&schema, num_rows, &mem);
+      vector<string> expected;
+      size_t pos = 0;
+      for (int i = 0; i < num_rows; i++) {
+        Slice cell(all_data.data() + pos, strs[i].size());
+        pos += strs[i].size();
+        if (!contiguous) {
+          ASSERT_TRUE(mem.arena.RelocateSlice(strs[i], &cell));
+        }
+        const bool is_null = rng_.OneIn(10);
+        block.row(i).cell(0).set_null(is_null);
+        memcpy(block.row(i).mutable_cell_ptr(0), &cell, sizeof(Slice));
+        const bool selected = all_selected || rng_.OneIn(2);
+        if (selected) {
+          block.selection_vector()->SetRowSelected(i);
+          expected.emplace_back(is_null ? "" : strs[i]);
+        } else {
+          block.selection_vector()->SetRowUnselected(i);
+        }
+      }
+      if (expected.empty()) {
+        continue;
+      }
+
+      ColumnarSerializedBatch batch(schema, schema, 1024 * 1024);
+      ASSERT_EQ(expected.size(), batch.AddRowBlock(block));
+      const auto& col = batch.columns()[0];
+      ASSERT_EQ((expected.size() + 1) * sizeof(uint32_t), col.data.size());
+      const uint32_t* offsets = reinterpret_cast<const uint32_t*>(col.data.data());
+      ASSERT_EQ(0, offsets[0]);
+      for (int i = 0; i < expected.size(); i++) {
+        SCOPED_TRACE(i);
+        ASSERT_EQ(expected[i],
+                  string(reinterpret_cast<const char*>(col.varlen_data->data()) + offsets[i],
+                         offsets[i + 1] - offsets[i]));
+      }
+      ASSERT_EQ(offsets[expected.size()], col.varlen_data->size());
+    }
+  }
+}
+
+// Test serializing string cells as a dictionary and codes, where cells with the
+// same value may or may not point to the same data.
+TEST_F(ColumnarSerializationTest, TestCopyVarlenCellsToDictionary) {
+  const Schema schema({ ColumnSchema("s", STRING, /*is_nullable=*/true) }, 0);
+  const vector<string> values = { "", "a", "bb", "ccc" };
+  ColumnarSerializedBatch batch(schema, schema, 1024 * 1024, { true });
+  vector<string> expected;
+  for (int b = 0; b < 3; b++) {
+    const int num_rows = rng_.Uniform(1000) + 1;
+    RowBlockMemory mem;
+    RowBlock block(&schema, num_rows, &mem);
+    for (int i = 0; i < num_rows; i++) {
+      const string& value = values[rng_.Uniform(values.size())];
+      Slice cell(value);
+      if (rng_.OneIn(2)) {
+        ASSERT_TRUE(mem.arena.RelocateSlice(value, &cell));
+      }
+      const bool is_null = rng_.OneIn(10);
+      block.row(i).cell(0).set_null(is_null);
+      memcpy(block.row(i).mutable_cell_ptr(0), &cell, sizeof(Slice));
+      if (rng_.OneIn(3)) {
+        block.selection_vector()->SetRowUnselected(i);
+      } else {
+        block.selection_vector()->SetRowSelected(i);
+        expected.emplace_back(is_null ? "" : value);
+      }
+    }
+    batch.AddRowBlock(block);
+  }
+
+  const auto& col = batch.columns()[0];
+  ASSERT_TRUE(col.dictionary_codes);
+  ASSERT_EQ(expected.size() * sizeof(uint32_t), col.dictionary_codes->size());
+  const uint32_t* codes = reinterpret_cast<const uint32_t*>(col.dictionary_codes->data());
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(col.data.data());
+  const size_t dictionary_size = col.data.size() / sizeof(uint32_t) - 1;
+  ASSERT_LE(dictionary_size, values.size());
+  for (int i = 0; i < expected.size(); i++) {
+    SCOPED_TRACE(i);
+    ASSERT_LT(codes[i], dictionary_size);
+    ASSERT_EQ(expected[i],
+              string(reinterpret_cast<const char*>(col.varlen_data->data()) + offsets[codes[i]],
+                     offsets[codes[i] + 1] - offsets[codes[i]]));
+  }
+}
+
 } // namespace kudu
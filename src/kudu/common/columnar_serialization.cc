@@ -27,6 +27,7 @@
 #include <cstring>
 #include <ostream>
 #include <string> // IWYU pragma: keep
+#include <unordered_map>
 #include <vector>
 
 #include <glog/logging.h>
@@ -38,10 +39,14 @@
 #include "kudu/common/types.h"
 #include "kudu/common/zp7.h"
 #include "kudu/gutil/cpu.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/fastmem.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/hash_util.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/slice.h"
 
 using std::vector;
@@ -121,6 +126,62 @@ struct BitWriter {
 
 namespace internal {
 
+// The distinct values of a dictionary-encoded column of a ColumnarSerializedBatch.
+//
+// The cells of a column which is dictionary-encoded on disk point to the values
+// in the dictionary block they were decoded from, so most of them are found by
+// the address of their data, without hashing or comparing the values.
+class ColumnarDictionary {
+ public:
+  ColumnarDictionary() : arena_(1024) {}
+
+  // Returns the code of 'value', appending it to the dictionary held by 'dst'
+  // if it isn't part of it yet.
+  uint32_t CodeOf(const Slice& value, ColumnarSerializedBatch::Column* dst) {
+    const uint32_t* code = FindOrNull(codes_by_address_, value.data());
+    if (code && ValueSize(*code, *dst) == value.size()) {
+      return *code;
+    }
+    uint32_t new_code = codes_.size();
+    auto it = codes_.find(value);
+    if (it != codes_.end()) {
+      new_code = it->second;
+    } else {
+      Slice key;
+      CHECK(arena_.RelocateSlice(value, &key));
+      codes_.emplace(key, new_code);
+      dst->varlen_data->append(value.data(), value.size());
+      const uint32_t end_offset = dst->varlen_data->size();
+      dst->data.append(&end_offset, sizeof(end_offset));
+    }
+    codes_by_address_[value.data()] = new_code;
+    return new_code;
+  }
+
+  // Forgets the addresses of the values seen so far, since the memory of a row
+  // block may be reused by other values in the next one.
+  void ForgetAddresses() {
+    codes_by_address_.clear();
+  }
+
+ private:
+  struct SliceHash {
+    size_t operator()(const Slice& s) const {
+      return HashUtil::FastHash64(s.data(), s.size(), 0);
+    }
+  };
+
+  static uint32_t ValueSize(uint32_t code, const ColumnarSerializedBatch::Column& dst) {
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(dst.data.data());
+    return offsets[code + 1] - offsets[code];
+  }
+
+  // Holds the keys of 'codes_'.
+  Arena arena_;
+  std::unordered_map<Slice, uint32_t, SliceHash> codes_;
+  std::unordered_map<const uint8_t*, uint32_t> codes_by_address_;
+};
+
 namespace {
 // Implementation of ZeroNullValues, specialized for a particular type size.
 template<int sizeof_type>
@@ -508,39 +569,129 @@ void CopySelectedCellsFromColumn(const ColumnBlock& cblock,
 }
 
 
+// The number of cells ahead of the one being copied whose data is prefetched.
+constexpr int kVarlenPrefetchDistance = 8;
+
+// Copy the data of the cells 'cells[rows[0]]', 'cells[rows[1]]'... into 'dst',
+// prefetching the data of the cells which follow. 'rows' is null if all of the
+// 'n' first cells are copied.
+ATTRIBUTE_NOINLINE
+void GatherSlices(const Slice* __restrict__ cells,
+                  const uint16_t* __restrict__ rows,
+                  int n,
+                  uint8_t* __restrict__ dst) {
+  for (int i = 0; i < n; i++) {
+    if (PREDICT_TRUE(i + kVarlenPrefetchDistance < n)) {
+      const int ahead = i + kVarlenPrefetchDistance;
+      __builtin_prefetch(cells[rows ? rows[ahead] : ahead].data());
+    }
+    const Slice& s = cells[rows ? rows[i] : i];
+    if (!s.empty()) {
+      strings::memcpy_inlined(dst, s.data(), s.size());
+    }
+    dst += s.size();
+  }
+}
+
 // For each of the Slices in 'cells_buf', copy the pointed-to data into 'varlen' and
 // write the _end_ offset of the copied data into 'offsets_out'. This assumes (and
 // DCHECKs) that the _start_ offset of each cell was already previously written by a
 // previous invocation of this function.
+//
+// The offsets are written in a first pass over the cells, as the running sum of their
+// sizes, so that the data can then be copied without a dependency on the offsets. If
+// all of the rows are selected and their data is laid out back to back, as it is when
+// the decoder copied the cells of a block into the arena in order, the data is copied
+// at once.
 void CopySlicesAndWriteEndOffsets(const Slice* __restrict__ cells_buf,
                                   const SelectedRows& sel_rows,
                                   uint32_t* __restrict__ offsets_out,
                                   faststring* varlen) {
-  const Slice* cell_slices = reinterpret_cast<const Slice*>(cells_buf);
-  size_t total_added_size = 0;
-  sel_rows.ForEachIndex(
-      [&](uint16_t i) {
-        total_added_size += cell_slices[i].size();
-      });
-
   // The output array should already have an entry for the start offset
   // of our first cell.
   DCHECK_EQ(offsets_out[-1], varlen->size());
 
-  int old_size = varlen->size();
+  const size_t old_size = varlen->size();
+  const int n_sel = sel_rows.num_selected();
+  uint32_t end = old_size;
+  const uint8_t* contiguous_start = nullptr;
+  bool contiguous = sel_rows.all_selected();
+  if (contiguous) {
+    const uint8_t* contiguous_end = nullptr;
+    for (int i = 0; i < n_sel; i++) {
+      const Slice& s = cells_buf[i];
+      // Empty cells, including nulls, don't break the run of data.
+      if (!s.empty()) {
+        if (contiguous_start == nullptr) {
+          contiguous_start = s.data();
+        } else if (s.data() != contiguous_end) {
+          contiguous = false;
+        }
+        contiguous_end = s.data() + s.size();
+      }
+      end += s.size();
+      offsets_out[i] = end;
+    }
+  } else {
+    const uint16_t* rows = sel_rows.indexes().data();
+    for (int i = 0; i < n_sel; i++) {
+      end += cells_buf[rows[i]].size();
+      offsets_out[i] = end;
+    }
+  }
+
+  const size_t total_added_size = end - old_size;
   varlen->resize_with_extra_capacity(old_size + total_added_size);
+  uint8_t* dst = varlen->data() + old_size;
+  if (contiguous) {
+    if (total_added_size > 0) {
+      memcpy(dst, contiguous_start, total_added_size);
+    }
+    return;
+  }
+  GatherSlices(cells_buf, sel_rows.all_selected() ? nullptr : sel_rows.indexes().data(),
+               n_sel, dst);
+}
+
+// Copy the selected variable-length cells of 'cblock' into 'dst' as their codes in
+// 'dict', adding the values missing from the dictionary.
+void CopySelectedVarlenCellsToDictionary(const ColumnBlock& cblock,
+                                         const SelectedRows& sel_rows,
+                                         ColumnarDictionary* dict,
+                                         ColumnarSerializedBatch::Column* dst) {
+  DCHECK(cblock.type_info()->physical_type() == BINARY);
+  int n_sel = sel_rows.num_selected();
+  DCHECK_GT(n_sel, 0);
 
-  uint8_t* dst_base = varlen->data();
-  uint8_t* dst = dst_base + old_size;
+  // If this is the first call, append a '0' entry for the offset of the first value.
+  if (dst->data.size() == 0) {
+    CHECK_EQ(dst->varlen_data->size(), 0);
+    uint32_t zero_offset = 0;
+    dst->data.append(&zero_offset, sizeof(zero_offset));
+  }
 
+  faststring* codes_buf = boost::get_pointer(dst->dictionary_codes);
+  DCHECK_EQ(codes_buf->size() % sizeof(uint32_t), 0);
+  size_t initial_rows = codes_buf->size() / sizeof(uint32_t);
+  size_t new_num_rows = initial_rows + n_sel;
+
+  if (cblock.is_nullable()) {
+    DCHECK_EQ(dst->non_null_bitmap->size(), BitmapSize(initial_rows));
+    dst->non_null_bitmap->resize_with_extra_capacity(BitmapSize(new_num_rows));
+    CopyNonNullBitmap(cblock.non_null_bitmap(),
+                      sel_rows.bitmap(),
+                      initial_rows, cblock.nrows(),
+                      dst->non_null_bitmap->data());
+    ZeroNullValues(sizeof(Slice), 0, cblock.nrows(),
+                   const_cast<ColumnBlock&>(cblock).data(), cblock.non_null_bitmap());
+  }
+  codes_buf->resize_with_extra_capacity(sizeof(uint32_t) * new_num_rows);
+  uint32_t* codes = reinterpret_cast<uint32_t*>(codes_buf->data()) + initial_rows;
+  const Slice* cells = reinterpret_cast<const Slice*>(cblock.cell_ptr(0));
+  dict->ForgetAddresses();
   sel_rows.ForEachIndex(
       [&](uint16_t i) {
-        const Slice* s = &cell_slices[i];
-        if (!s->empty()) {
-          strings::memcpy_inlined(dst, s->data(), s->size());
-        }
-        dst += s->size();
-        *offsets_out++ = dst - dst_base;
+        *codes++ = dict->CodeOf(cells[i], dst);
       });
 }
 
@@ -593,7 +744,10 @@ void CopySelectedVarlenCellsFromColumn(const ColumnBlock& cblock,
 
 ColumnarSerializedBatch::ColumnarSerializedBatch(const Schema& rowblock_schema,
                                                  const Schema& client_schema,
-                                                 int expected_batch_size_bytes) {
+                                                 int expected_batch_size_bytes,
+                                                 const vector<bool>& dictionary_columns) {
+  DCHECK(dictionary_columns.empty() ||
+         dictionary_columns.size() == client_schema.num_columns());
   // Initialize buffers for the columns.
   int64_t row_bytes = client_schema.byte_size();
   columns_.reserve(client_schema.num_columns());
@@ -614,9 +768,19 @@ ColumnarSerializedBatch::ColumnarSerializedBatch(const Schema& rowblock_schema,
     if (schema_col.is_nullable()) {
       col.non_null_bitmap.emplace();
     }
+    const size_t col_idx = columns_.size() - 1;
+    if (!dictionary_columns.empty() && dictionary_columns[col_idx]) {
+      CHECK_EQ(BINARY, schema_col.type_info()->physical_type());
+      col.dictionary_codes.emplace();
+      dictionaries_.emplace_back(new internal::ColumnarDictionary);
+    } else {
+      dictionaries_.emplace_back();
+    }
   }
 }
 
+ColumnarSerializedBatch::~ColumnarSerializedBatch() {}
+
 int ColumnarSerializedBatch::AddRowBlock(const RowBlock& block) {
   DCHECK_GT(block.nrows(), 0);
 
@@ -628,7 +792,13 @@ int ColumnarSerializedBatch::AddRowBlock(const RowBlock& block) {
   int col_idx = 0;
   for (const auto& col : columns_) {
     const ColumnBlock& column_block = block.column_block(col.rowblock_schema_col_idx);
-    if (column_block.type_info()->physical_type() == BINARY) {
+    if (col.dictionary_codes) {
+      internal::CopySelectedVarlenCellsToDictionary(
+          column_block,
+          sel,
+          dictionaries_[col_idx].get(),
+          &columns_[col_idx]);
+    } else if (column_block.type_info()->physical_type() == BINARY) {
       internal::CopySelectedVarlenCellsFromColumn(
           column_block,
           sel,
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -29,6 +30,10 @@ namespace kudu {
 class RowBlock;
 class Schema;
 
+namespace internal {
+class ColumnarDictionary;
+} // namespace internal
+
 // A pending batch of serialized rows, suitable for easy conversion
 // into the protobuf representation and a set of sidecars.
 class ColumnarSerializedBatch {
@@ -42,9 +47,16 @@ class ColumnarSerializedBatch {
   // 'expected_batch_size_bytes':
   //      the batch size at which the caller expects to stop adding new rows to
   //      this batch. This is is only a hint and does not affect correctness.
+  //
+  // 'dictionary_columns': for each column of 'client_schema', whether to serialize
+  //                       it as a dictionary of its distinct values and a code per
+  //                       cell. Only columns with BINARY physical type may be. If
+  //                       empty, no column is.
   ColumnarSerializedBatch(const Schema& rowblock_schema,
                           const Schema& client_schema,
-                          int expected_batch_size_bytes);
+                          int expected_batch_size_bytes,
+                          const std::vector<bool>& dictionary_columns = {});
+  ~ColumnarSerializedBatch();
 
   // Append the data in 'block' into this columnar batch.
   //
@@ -63,6 +75,11 @@ class ColumnarSerializedBatch {
 
     // Each bit is set when a value is non-null
     boost::optional<faststring> non_null_bitmap;
+
+    // For dictionary-encoded columns, the int32 code of each cell: the index of its
+    // value in the dictionary, whose offsets and data are held in 'data' and
+    // 'varlen_data' like the cells of other varlen columns.
+    boost::optional<faststring> dictionary_codes;
   };
 
   const std::vector<Column>& columns() const {
@@ -76,6 +93,10 @@ class ColumnarSerializedBatch {
  private:
   friend class WireProtocolTest;
   std::vector<Column> columns_;
+
+  // The dictionary of each column, or null for the columns which aren't
+  // dictionary-encoded.
+  std::vector<std::unique_ptr<internal::ColumnarDictionary>> dictionaries_;
 };
 
 
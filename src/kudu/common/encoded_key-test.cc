@@ -20,11 +20,13 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
+#include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/strings/substitute.h" // IWYU pragma: keep
 #include "kudu/util/faststring.h"
@@ -39,6 +41,7 @@
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 class EncodedKeyTest;
@@ -250,6 +253,49 @@ TEST_F(EncodedKeyTest, TestDecodeCompoundKeys) {
   }
 }
 
+// Test that encoding a batch of compound keys at once gives the same keys
+// as encoding them one by one.
+TEST_F(EncodedKeyTest, TestEncodeBatchOfCompoundKeys) {
+  Schema schema({ ColumnSchema("key0", INT32),
+                  ColumnSchema("key1", STRING),
+                  ColumnSchema("key2", INT64) }, 3);
+  const int kNumRows = 100;
+  Random r(SeedRandom());
+  vector<string> strings(kNumRows);
+  vector<const uint8_t*> rows;
+  for (int i = 0; i < kNumRows; i++) {
+    // Include some zero bytes, which are escaped in the middle of a key.
+    strings[i] = RandomString(r.Uniform(40), &r);
+    if (!strings[i].empty() && r.OneIn(2)) {
+      strings[i][r.Uniform(strings[i].size())] = '\0';
+    }
+    uint8_t* row_data = static_cast<uint8_t*>(arena_.AllocateBytes(schema.key_byte_size()));
+    ContiguousRow row(&schema, row_data);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = static_cast<int32_t>(r.Next32());
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = Slice(strings[i]);
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = static_cast<int64_t>(r.Next64());
+    rows.push_back(row_data);
+  }
+
+  vector<EncodedKey*> keys;
+  EncodedKey::FromContiguousRows(schema, rows, &arena_, &keys);
+  ASSERT_EQ(kNumRows, keys.size());
+  for (int i = 0; i < kNumRows; i++) {
+    SCOPED_TRACE(i);
+    const ConstContiguousRow row(&schema, rows[i]);
+    const EncodedKey* expected = EncodedKey::FromContiguousRow(row, &arena_);
+    ASSERT_EQ(expected->encoded_key(), keys[i]->encoded_key());
+    ASSERT_EQ(3, keys[i]->num_key_columns());
+    ASSERT_EQ(3, keys[i]->raw_keys().size());
+    for (int c = 0; c < 3; c++) {
+      ASSERT_EQ(row.cell_ptr(c), keys[i]->raw_keys()[c]);
+    }
+  }
+
+  EncodedKey::FromContiguousRows(schema, {}, &arena_, &keys);
+  ASSERT_TRUE(keys.empty());
+}
+
 TEST_F(EncodedKeyTest, TestConstructFromEncodedString) {
   EncodedKey* key = nullptr;
 
@@ -53,6 +53,51 @@ EncodedKey* EncodedKey::FromContiguousRow(const ConstContiguousRow& row, Arena*
   return kb.BuildEncodedKey();
 }
 
+void EncodedKey::FromContiguousRows(const Schema& schema,
+                                    const vector<const uint8_t*>& rows,
+                                    Arena* arena,
+                                    vector<EncodedKey*>* keys) {
+  const size_t num_rows = rows.size();
+  const size_t num_key_cols = schema.num_key_columns();
+  keys->resize(num_rows);
+  if (num_rows == 0) {
+    return;
+  }
+
+  vector<const KeyEncoder<faststring>*> encoders(num_key_cols);
+  for (size_t c = 0; c < num_key_cols; c++) {
+    DCHECK(!schema.column(c).is_nullable());
+    encoders[c] = &GetKeyEncoder<faststring>(schema.column(c).type_info());
+  }
+
+  const void** raw_keys = static_cast<const void**>(arena->AllocateBytesAligned(
+      sizeof(void*) * num_key_cols * num_rows, alignof(void*)));
+  CHECK(raw_keys);
+  faststring encoded;
+  encoded.reserve(schema.key_byte_size() * num_rows);
+  vector<size_t> key_ends(num_rows);
+  for (size_t r = 0; r < num_rows; r++) {
+    const ConstContiguousRow row(&schema, rows[r]);
+    const void** row_raw_keys = raw_keys + r * num_key_cols;
+    for (size_t c = 0; c < num_key_cols; c++) {
+      row_raw_keys[c] = row.cell_ptr(c);
+      encoders[c]->Encode(row_raw_keys[c], c == num_key_cols - 1, &encoded);
+    }
+    key_ends[r] = encoded.size();
+  }
+
+  Slice all_keys;
+  CHECK(arena->RelocateSlice(encoded, &all_keys));
+  size_t key_start = 0;
+  for (size_t r = 0; r < num_rows; r++) {
+    (*keys)[r] = arena->NewObject<EncodedKey>(
+        Slice(all_keys.data() + key_start, key_ends[r] - key_start),
+        ArrayView<const void*>(raw_keys + r * num_key_cols, num_key_cols),
+        num_key_cols);
+    key_start = key_ends[r];
+  }
+}
+
 Status EncodedKey::DecodeEncodedString(const Schema& schema,
                                        Arena* arena,
                                        const Slice& encoded,
@@ -17,7 +17,9 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/util/array_view.h"
@@ -44,6 +46,17 @@ class EncodedKey {
   // EncodedKey object.
   static EncodedKey* FromContiguousRow(const ConstContiguousRow& row, Arena* arena);
 
+  // Like FromContiguousRow(), for each of the rows in 'rows', which are laid out
+  // according to 'schema'. Sets 'keys' to the corresponding EncodedKeys.
+  //
+  // This is cheaper than encoding the rows one by one: the key encoders are
+  // looked up once for the batch, and the keys are encoded into a single buffer
+  // which is copied into the arena at once.
+  static void FromContiguousRows(const Schema& schema,
+                                 const std::vector<const uint8_t*>& rows,
+                                 Arena* arena,
+                                 std::vector<EncodedKey*>* keys);
+
   // Decode the encoded key specified in 'encoded', which must correspond to the
   // provided schema.
   // The returned EncodedKey object and its referred-to row data is allocated
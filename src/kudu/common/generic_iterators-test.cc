@@ -22,6 +22,7 @@
 #include <cstdlib>
 #include <map>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <random>
 #include <string>
@@ -61,12 +62,15 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(num_lists, 3, "Number of lists to merge");
 DEFINE_int32(num_rows, 1000, "Number of entries per list");
 DEFINE_int32(num_iters, 1, "Number of times to run merge");
 DECLARE_bool(materializing_iterator_do_pushdown);
 DECLARE_int32(predicate_effectivess_num_skip_blocks);
+DECLARE_int32(predicate_reorder_num_blocks);
+DECLARE_bool(predicate_reorder_enabled);
 
 using std::map;
 using std::pair;
@@ -508,6 +512,117 @@ TEST(TestMergeIterator, TestDeDupGhostRows) {
                       /*include_deleted_rows=*/true));
 }
 
+// Test that the TopNIterator returns the top rows of its input in order, after
+// the predicates of the scan are applied.
+TEST(TestTopNIterator, TestTopN) {
+  vector<int64_t> ints(1000);
+  for (int i = 0; i < ints.size(); i++) {
+    ints[i] = (i * 37) % 1000;
+  }
+  for (bool descending : { false, true }) {
+    SCOPED_TRACE(descending);
+    ScanSpec spec;
+    TestIntRangePredicate pred(100, 900);
+    spec.AddPredicate(pred.pred_);
+    unique_ptr<RowwiseIterator> iter(NewTopNIterator(
+        TopNIteratorOptions("val", descending, 10),
+        NewMaterializingIterator(unique_ptr<ColumnwiseIterator>(new VectorIterator(ints)))));
+    ASSERT_OK(InitAndMaybeWrap(&iter, &spec));
+
+    vector<int64_t> vals;
+    RowBlockMemory mem(1024);
+    RowBlock dst(&kIntSchema, 4, &mem);
+    while (iter->HasNext()) {
+      ASSERT_OK(iter->NextBlock(&dst));
+      for (int i = 0; i < dst.nrows(); i++) {
+        ASSERT_TRUE(dst.selection_vector()->IsRowSelected(i));
+        vals.push_back(*reinterpret_cast<const int64_t*>(dst.row(i).cell_ptr(kValColIdx)));
+      }
+    }
+    ASSERT_EQ(10, vals.size());
+    for (int i = 0; i < vals.size(); i++) {
+      ASSERT_EQ(descending ? 899 - i : 100 + i, vals[i]);
+    }
+  }
+
+  // A limit beyond the number of rows returns all of them.
+  unique_ptr<RowwiseIterator> iter(NewTopNIterator(
+      TopNIteratorOptions("val", false, 10),
+      NewMaterializingIterator(unique_ptr<ColumnwiseIterator>(new VectorIterator({ 3, 1, 2 })))));
+  ASSERT_OK(iter->Init(nullptr));
+  RowBlockMemory mem(1024);
+  RowBlock dst(&kIntSchema, 100, &mem);
+  ASSERT_OK(iter->NextBlock(&dst));
+  ASSERT_EQ(3, dst.nrows());
+  ASSERT_EQ(1, *reinterpret_cast<const int64_t*>(dst.row(0).cell_ptr(kValColIdx)));
+  ASSERT_EQ(3, *reinterpret_cast<const int64_t*>(dst.row(2).cell_ptr(kValColIdx)));
+  ASSERT_FALSE(iter->HasNext());
+}
+
+// Test that the ParallelUnionIterator returns the rows of all of its
+// sub-iterators which match the predicates, whatever the number of threads.
+TEST(TestParallelUnionIterator, TestParallelUnion) {
+  unique_ptr<ThreadPool> pool;
+  ASSERT_OK(ThreadPoolBuilder("test").set_max_threads(4).Build(&pool));
+  for (int num_threads : { 1, 2, 4, 8 }) {
+    SCOPED_TRACE(num_threads);
+    vector<IterWithBounds> iters;
+    vector<int64_t> expected;
+    for (int i = 0; i < 5; i++) {
+      // Each sub-iterator returns more rows than fit in a block of the
+      // ParallelUnionIterator.
+      vector<int64_t> ints(3000);
+      std::iota(ints.begin(), ints.end(), i * 3000);
+      for (int64_t val : ints) {
+        if (val >= 1000 && val < 14000) {
+          expected.push_back(val);
+        }
+      }
+      unique_ptr<VectorIterator> vec_it(new VectorIterator(ints));
+      vec_it->set_block_size(1000);
+      IterWithBounds iwb;
+      iwb.iter = NewMaterializingIterator(std::move(vec_it));
+      iters.emplace_back(std::move(iwb));
+    }
+    ScanSpec spec;
+    TestIntRangePredicate pred(1000, 14000);
+    spec.AddPredicate(pred.pred_);
+    unique_ptr<RowwiseIterator> iter(
+        NewParallelUnionIterator(std::move(iters), pool.get(), num_threads));
+    ASSERT_OK(iter->Init(&spec));
+
+    vector<int64_t> vals;
+    RowBlockMemory mem(1024);
+    RowBlock dst(&kIntSchema, 100, &mem);
+    while (iter->HasNext()) {
+      ASSERT_OK(iter->NextBlock(&dst));
+      ASSERT_GT(dst.nrows(), 0);
+      for (int i = 0; i < dst.nrows(); i++) {
+        if (dst.selection_vector()->IsRowSelected(i)) {
+          vals.push_back(*reinterpret_cast<const int64_t*>(dst.row(i).cell_ptr(kValColIdx)));
+        }
+      }
+    }
+    std::sort(vals.begin(), vals.end());
+    ASSERT_EQ(expected, vals);
+  }
+
+  // Destroying the iterator before it's consumed stops its threads.
+  vector<IterWithBounds> iters;
+  for (int i = 0; i < 4; i++) {
+    vector<int64_t> ints(10000);
+    std::iota(ints.begin(), ints.end(), i * 10000);
+    IterWithBounds iwb;
+    iwb.iter = NewMaterializingIterator(
+        unique_ptr<ColumnwiseIterator>(new VectorIterator(ints)));
+    iters.emplace_back(std::move(iwb));
+  }
+  unique_ptr<RowwiseIterator> iter(NewParallelUnionIterator(std::move(iters), pool.get(), 4));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_TRUE(iter->HasNext());
+  iter.reset();
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
@@ -690,6 +805,62 @@ TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluationOrder) {
   }
 }
 
+// Test that the predicates are reordered once the statically preferred one turns
+// out not to filter anything.
+TEST(TestMaterializingIterator, TestAdaptivePredicateOrder) {
+  const int kNumRows = 1000;
+  const int kBatchSize = 100;
+  FLAGS_predicate_reorder_num_blocks = 4;
+
+  vector<int64_t> ints(kNumRows);
+  std::iota(ints.begin(), ints.end(), 0);
+  // None of the rows are deleted, so an equality predicate on IS_DELETED, which
+  // is evaluated before the range predicate to begin with, filters nothing.
+  bool is_deleted = false;
+  int64_t lower = 0;
+  int64_t upper = 50;
+  auto range_pred = ColumnPredicate::Range(kIntSchemaWithVCol.column(0), &lower, &upper);
+  auto is_deleted_pred = ColumnPredicate::Equality(kIntSchemaWithVCol.column(1), &is_deleted);
+
+  for (bool reorder : { true, false }) {
+    SCOPED_TRACE(reorder);
+    FLAGS_predicate_reorder_enabled = reorder;
+    ScanSpec spec;
+    spec.AddPredicate(range_pred);
+    spec.AddPredicate(is_deleted_pred);
+    unique_ptr<VectorIterator> colwise(new VectorIterator(
+        ints, vector<uint8_t>(kNumRows), kIntSchemaWithVCol));
+    colwise->set_block_size(kBatchSize);
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(colwise)));
+    ASSERT_OK(iter->Init(&spec));
+    NO_FATALS(CheckColumnPredicatesAreEqual(
+        vector<ColumnPredicate>({ is_deleted_pred, range_pred }),
+        GetIteratorPredicatesForTests(iter)));
+
+    RowBlockMemory mem;
+    RowBlock dst(&kIntSchemaWithVCol, kBatchSize, &mem);
+    int num_selected = 0;
+    while (iter->HasNext()) {
+      ASSERT_OK(iter->NextBlock(&dst));
+      num_selected += dst.selection_vector()->CountSelected();
+    }
+    ASSERT_EQ(upper - lower, num_selected);
+
+    vector<IteratorStats> stats;
+    iter->GetIteratorStats(&stats);
+    ASSERT_EQ(2, stats.size());
+    if (reorder) {
+      // The range predicate moved to the front after the first reordering.
+      ASSERT_EQ(FLAGS_predicate_reorder_num_blocks, stats[1].predicate_blocks_evaluated_first);
+      ASSERT_EQ(kNumRows / kBatchSize - FLAGS_predicate_reorder_num_blocks,
+                stats[0].predicate_blocks_evaluated_first);
+    } else {
+      ASSERT_EQ(0, stats[0].predicate_blocks_evaluated_first);
+      ASSERT_EQ(0, stats[1].predicate_blocks_evaluated_first);
+    }
+  }
+}
+
 // Class to test column predicate effectiveness.
 class PredicateEffectivenessTest :
     public KuduTest,
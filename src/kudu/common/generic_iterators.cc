@@ -40,6 +40,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/common/column_expression.h"
 #include "kudu/common/column_materialization_context.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
@@ -52,16 +53,23 @@
 #include "kudu/common/rowblock_memory.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/trace.h"
 
 namespace boost {
 namespace heap {
@@ -84,9 +92,60 @@ DEFINE_bool(materializing_iterator_decoder_eval, true,
             "Should MaterializingIterator do decoder-level evaluation");
 TAG_FLAG(materializing_iterator_decoder_eval, hidden);
 TAG_FLAG(materializing_iterator_decoder_eval, runtime);
+DEFINE_bool(materializing_iterator_late_materialization, true,
+            "Should MaterializingIterator skip decoding ranges of rows which were already "
+            "filtered out by deletions or by predicates on other columns");
+TAG_FLAG(materializing_iterator_late_materialization, hidden);
+TAG_FLAG(materializing_iterator_late_materialization, runtime);
 
 namespace kudu {
+
+// Trace metric of the time spent evaluating predicates on materialized cells.
+const char* SCAN_PREDICATE_EVAL_US_METRIC_NAME = "scan_predicate_eval_us";
+
 namespace {
+
+// Returns a prefix of the first key column of 'row' whose unsigned order
+// agrees with the order of the column's values: if the prefixes of two rows
+// differ, their keys compare the same way. Returns 0 for types without such a
+// prefix.
+//
+// This lets the MergeIterator order most rows without comparing them column by
+// column through the type's comparator.
+template<class RowType>
+uint64_t NormalizedKeyPrefix(const Schema& schema, const RowType& row) {
+  constexpr uint64_t kSignBit = 1ULL << 63;
+  const void* cell = row.cell_ptr(0);
+  switch (schema.column(0).type_info()->physical_type()) {
+    case INT8:
+      return static_cast<uint64_t>(static_cast<int64_t>(
+          *reinterpret_cast<const int8_t*>(cell))) ^ kSignBit;
+    case INT16:
+      return static_cast<uint64_t>(static_cast<int64_t>(
+          UnalignedLoad<int16_t>(cell))) ^ kSignBit;
+    case INT32:
+      return static_cast<uint64_t>(static_cast<int64_t>(
+          UnalignedLoad<int32_t>(cell))) ^ kSignBit;
+    case INT64:
+      return static_cast<uint64_t>(UnalignedLoad<int64_t>(cell)) ^ kSignBit;
+    case INT128:
+      return static_cast<uint64_t>(static_cast<int64_t>(
+          UnalignedLoad<int128_t>(cell) >> 64)) ^ kSignBit;
+    case BINARY: {
+      // The first 8 bytes, padded with zeros, in big-endian order.
+      const Slice* s = reinterpret_cast<const Slice*>(cell);
+      uint64_t prefix = 0;
+      const size_t n = std::min<size_t>(s->size(), sizeof(prefix));
+      for (size_t i = 0; i < n; i++) {
+        prefix |= static_cast<uint64_t>(s->data()[i]) << (56 - 8 * i);
+      }
+      return prefix;
+    }
+    default:
+      return 0;
+  }
+}
+
 void AddIterStats(const RowwiseIterator& iter,
                   vector<IteratorStats>* stats) {
   vector<IteratorStats> iter_stats;
@@ -117,7 +176,8 @@ class MergeIterState : public boost::intrusive::list_base_hook<> {
   explicit MergeIterState(IterWithBounds iwb)
       : iwb_(std::move(iwb)),
         memory_(1024),
-        next_row_idx_(0)
+        next_row_idx_(0),
+        next_key_prefix_(0)
   {}
 
   // Fetches the next row from the iterator's current block, or the iterator's
@@ -133,6 +193,11 @@ class MergeIterState : public boost::intrusive::list_base_hook<> {
     return decoded_bounds_->lower;
   }
 
+  // Returns the normalized key prefix of next_row().
+  uint64_t next_key_prefix() const {
+    return next_key_prefix_;
+  }
+
   // Fetches the last row from the iterator's current block, or the iterator's
   // absolute upper bound if a block has not yet been pulled.
   //
@@ -161,6 +226,7 @@ class MergeIterState : public boost::intrusive::list_base_hook<> {
           iwb_.encoded_bounds->first, &decoded_bounds_->lower, &decoded_bounds_memory->arena));
       RETURN_NOT_OK(schema().DecodeRowKey(
           iwb_.encoded_bounds->second, &decoded_bounds_->upper, &decoded_bounds_memory->arena));
+      next_key_prefix_ = NormalizedKeyPrefix(schema(), decoded_bounds_->lower);
     } else {
       RETURN_NOT_OK(PullNextBlock());
     }
@@ -199,10 +265,20 @@ class MergeIterState : public boost::intrusive::list_base_hook<> {
   Status PullNextBlock();
 
   // Copies as many rows as possible from the current block of buffered rows to
-  // 'dst' (starting at 'dst_offset').
+  // 'dst' (starting at 'dst_offset'), but no more than 'max_rows' rows.
   //
   // If successful, 'num_rows_copied' will be set to the number of rows copied.
-  Status CopyBlock(RowBlock* dst, size_t dst_offset, size_t* num_rows_copied);
+  Status CopyBlock(RowBlock* dst, size_t dst_offset, size_t max_rows,
+                   size_t* num_rows_copied);
+
+  // Returns the number of rows of the current block, starting at the next row,
+  // whose keys are smaller than that of 'bound'. Unselected rows which follow
+  // such rows are counted too.
+  //
+  // The keys are compared starting with the next row, so this is best used
+  // when another sub-iterator's next row has just been found to be larger
+  // than this one's.
+  size_t CountRowsBefore(const RowBlockRow& bound, uint64_t bound_prefix) const;
 
   // Returns true if the current block in the underlying iterator is exhausted.
   bool IsBlockExhausted() const {
@@ -254,6 +330,9 @@ class MergeIterState : public boost::intrusive::list_base_hook<> {
   // a selected row.
   size_t next_row_idx_;
 
+  // The normalized key prefix of next_row().
+  uint64_t next_key_prefix_;
+
   DISALLOW_COPY_AND_ASSIGN(MergeIterState);
 };
 
@@ -268,6 +347,7 @@ Status MergeIterState::Advance(size_t num_rows, bool* pulled_new_block) {
       read_block_->selection_vector()->FindFirstRowSelected(next_row_idx_, &idx)) {
     next_row_idx_ = idx;
     next_row_.Reset(read_block_.get(), next_row_idx_);
+    next_key_prefix_ = NormalizedKeyPrefix(schema(), next_row_);
     *pulled_new_block = false;
     return Status::OK();
   }
@@ -306,6 +386,7 @@ Status MergeIterState::PullNextBlock() {
 
     CHECK(selection->FindFirstRowSelected(0, &next_row_idx_));
     next_row_.Reset(read_block_.get(), next_row_idx_);
+    next_key_prefix_ = NormalizedKeyPrefix(schema(), next_row_);
 
     // We use a signed size_t type to avoid underflowing when finding last_row_.
     //
@@ -327,13 +408,14 @@ Status MergeIterState::PullNextBlock() {
   return Status::OK();
 }
 
-Status MergeIterState::CopyBlock(RowBlock* dst, size_t dst_offset,
+Status MergeIterState::CopyBlock(RowBlock* dst, size_t dst_offset, size_t max_rows,
                                  size_t* num_rows_copied) {
   DCHECK(read_block_);
   DCHECK(!IsBlockExhausted());
 
-  size_t num_rows_to_copy = std::min(remaining_in_block(),
-                                     dst->nrows() - dst_offset);
+  size_t num_rows_to_copy = std::min({ remaining_in_block(),
+                                       dst->nrows() - dst_offset,
+                                       max_rows });
   VLOG(3) << Substitute(
       "Copying $0 rows from RowBlock (s:$1,o:$2) to RowBlock (s:$3,o:$4): $5",
       num_rows_to_copy, read_block_->nrows(), next_row_idx_, dst->nrows(),
@@ -344,6 +426,43 @@ Status MergeIterState::CopyBlock(RowBlock* dst, size_t dst_offset,
   return Status::OK();
 }
 
+size_t MergeIterState::CountRowsBefore(const RowBlockRow& bound,
+                                       uint64_t bound_prefix) const {
+  DCHECK(read_block_);
+  DCHECK(!IsBlockExhausted());
+  const Schema& s = schema();
+  const auto is_before_bound = [&](const RowBlockRow& row) {
+    const uint64_t prefix = NormalizedKeyPrefix(s, row);
+    return prefix < bound_prefix || (prefix == bound_prefix && s.Compare(row, bound) < 0);
+  };
+
+  // Unselected rows may not have been materialized, so only the keys of the
+  // selected rows are compared. The next row is known to come first. When
+  // the sub-iterators interleave, the row after it usually doesn't, so check
+  // that one before anything else.
+  SelectionVector* selection = read_block_->selection_vector();
+  size_t idx;
+  if (remaining_in_block() == 1 ||
+      !selection->FindFirstRowSelected(next_row_idx_ + 1, &idx)) {
+    return remaining_in_block();
+  }
+  if (!is_before_bound(read_block_->row(idx))) {
+    return idx - next_row_idx_;
+  }
+  // If the last row is before 'bound', so are all the others.
+  if (is_before_bound(last_row_)) {
+    return remaining_in_block();
+  }
+  // Otherwise the loop stops at a selected row, at the latest the last one.
+  for (idx++; selection->FindFirstRowSelected(idx, &idx); idx++) {
+    if (!is_before_bound(read_block_->row(idx))) {
+      break;
+    }
+  }
+  DCHECK_LT(idx, read_block_->nrows());
+  return idx - next_row_idx_;
+}
+
 // An iterator which merges the results of other iterators, comparing
 // based on keys.
 //
@@ -494,6 +613,9 @@ class MergeIterator : public RowwiseIterator {
   Status MaterializeBlock(RowBlock* dst, size_t* dst_row_idx);
 
   // Finds the next row and materializes it into 'dst' at offset 'dst_row_idx'.
+  // If the rows which follow it in the same sub-iterator block come before
+  // the next rows of all other sub-iterators, they're materialized too, in a
+  // single columnar copy.
   //
   // On success, the selection vector in 'dst' and 'dst_row_idx' are both updated.
   Status MaterializeOneRow(RowBlock* dst, size_t* dst_row_idx);
@@ -556,6 +678,12 @@ class MergeIterator : public RowwiseIterator {
     bool operator()(const MergeIterState* a, const MergeIterState* b) const {
       // This is counter-intuitive, but it's because boost::heap defaults to
       // a max-heap; the comparator must be inverted to yield a min-heap.
+      //
+      // The key prefixes settle most comparisons without dispatching on the
+      // types of the key columns.
+      if (a->next_key_prefix() != b->next_key_prefix()) {
+        return a->next_key_prefix() > b->next_key_prefix();
+      }
       return a->schema().Compare(a->next_row(), b->next_row()) > 0;
     }
   };
@@ -667,6 +795,7 @@ Status MergeIterator::InitSubIterators(ScanSpec *spec) {
   // them here.
   if (spec != nullptr) {
     spec->RemovePredicates();
+    spec->RemoveExpressionPredicates();
   }
   return Status::OK();
 }
@@ -800,7 +929,8 @@ Status MergeIterator::MaterializeBlock(RowBlock* dst, size_t* dst_row_idx) {
 
   MergeIterState* state = hot_.top();
   size_t num_rows_copied;
-  RETURN_NOT_OK(state->CopyBlock(dst, *dst_row_idx, &num_rows_copied));
+  RETURN_NOT_OK(state->CopyBlock(dst, *dst_row_idx, state->remaining_in_block(),
+                                 &num_rows_copied));
   RETURN_NOT_OK(AdvanceAndReheap(state, num_rows_copied));
 
   // CopyBlock() already updated dst's SelectionVector.
@@ -818,6 +948,9 @@ Status MergeIterator::MaterializeOneRow(RowBlock* dst, size_t* dst_row_idx) {
   // to one live instance, that we have to deduplicate.
   vector<MergeIterState*> smallest;
   smallest.reserve(hot_.size());
+  // The sub-iterator with the smallest next row key larger than that of
+  // 'smallest', if any.
+  const MergeIterState* runner_up = nullptr;
 
   // Find the set of sub-iterators whose matching next row keys are the smallest
   // across all sub-iterators.
@@ -831,12 +964,34 @@ Status MergeIterator::MaterializeOneRow(RowBlock* dst, size_t* dst_row_idx) {
   for (auto iter = hot_.ordered_begin(); iter != hot_.ordered_end(); ++iter) {
     MergeIterState* state = *iter;
     if (!smallest.empty() &&
-        schema_->Compare(state->next_row(), smallest[0]->next_row()) != 0) {
+        (state->next_key_prefix() != smallest[0]->next_key_prefix() ||
+         schema_->Compare(state->next_row(), smallest[0]->next_row()) != 0)) {
+      runner_up = state;
       break;
     }
     smallest.emplace_back(state);
   }
 
+  // If the smallest row is unique, copy it along with the rows which follow it
+  // in its block and come before any row of the other sub-iterators: those of
+  // the hot heap start at 'runner_up', and those of the cold heap at the top
+  // of the cold heap.
+  if (smallest.size() == 1 && runner_up) {
+    const MergeIterState* bound = runner_up;
+    if (!cold_.empty() && MergeIterStateComparator()(bound, cold_.top())) {
+      bound = cold_.top();
+    }
+    MergeIterState* state = smallest[0];
+    const size_t run = state->CountRowsBefore(bound->next_row(), bound->next_key_prefix());
+    if (run > 1) {
+      size_t num_rows_copied;
+      RETURN_NOT_OK(state->CopyBlock(dst, *dst_row_idx, run, &num_rows_copied));
+      RETURN_NOT_OK(AdvanceAndReheap(state, num_rows_copied));
+      *dst_row_idx += num_rows_copied;
+      return Status::OK();
+    }
+  }
+
   MergeIterState* row_to_return_iter = nullptr;
   if (!opts_.include_deleted_rows) {
     // Since deleted rows are not included here, there can only be a single
@@ -1034,6 +1189,7 @@ Status UnionIterator::InitSubIterators(ScanSpec *spec) {
   // them here.
   if (spec != nullptr) {
     spec->RemovePredicates();
+    spec->RemoveExpressionPredicates();
   }
   return Status::OK();
 }
@@ -1104,6 +1260,518 @@ unique_ptr<RowwiseIterator> NewUnionIterator(vector<IterWithBounds> iters) {
   return unique_ptr<RowwiseIterator>(new UnionIterator(std::move(iters)));
 }
 
+////////////////////////////////////////////////////////////
+// ParallelUnionIterator
+////////////////////////////////////////////////////////////
+
+// An iterator which unions the results of other iterators like UnionIterator,
+// but reads up to 'num_threads' of them at a time on a thread pool.
+//
+// The sub-iterators are read one block at a time by tasks on the pool: each
+// task takes a free block and a sub-iterator nobody is reading, reads the
+// block, and queues it until NextBlock() copies it out. There are only two
+// blocks per thread, so the memory used by a scan is bounded. When there are
+// no free blocks, the tasks end rather than wait, so that a scan whose caller
+// stopped consuming doesn't hold threads of the pool; NextBlock() starts new
+// tasks as it frees blocks.
+//
+// The sub-iterators are all initialized on the calling thread, before any of
+// them is read, so they read the same snapshot as with a UnionIterator.
+class ParallelUnionIterator : public RowwiseIterator {
+ public:
+  ParallelUnionIterator(vector<IterWithBounds> iters, ThreadPool* pool, int num_threads);
+
+  // Waits for the running tasks to end.
+  ~ParallelUnionIterator();
+
+  Status Init(ScanSpec* spec) override;
+
+  // May wait for a task to read a block.
+  bool HasNext() const override;
+
+  string ToString() const override;
+
+  const Schema& schema() const override {
+    CHECK(initted_);
+    return *schema_;
+  }
+
+  // Only includes the statistics of the fully-consumed sub-iterators, since
+  // the others may be being read concurrently.
+  void GetIteratorStats(vector<IteratorStats>* stats) const override;
+
+  Status NextBlock(RowBlock* dst) override;
+
+ private:
+  // The number of rows of each block the tasks read into.
+  static constexpr size_t kBlockRows = 1024;
+
+  struct Block {
+    explicit Block(const Schema* schema)
+        : block(schema, kBlockRows, &memory) {
+    }
+    RowBlockMemory memory;
+    RowBlock block;
+  };
+
+  // Reads blocks until there are no free blocks or sub-iterators to read, an
+  // error occurs, or the iterator is being destroyed.
+  void RunTask();
+
+  // Starts tasks until 'num_threads_' are running or there's nothing for more
+  // tasks to read. Must be called with 'lock_' held.
+  void MaybeStartTasksUnlocked();
+
+  // Waits until a block is queued, a sub-iterator failed, or no task is
+  // running any longer. Must be called with 'lock_' held.
+  void WaitForBlockUnlocked() const;
+
+  vector<IterWithBounds> iters_;
+  ThreadPool* const pool_;
+  const int num_threads_;
+
+  unique_ptr<Schema> schema_;
+  bool initted_;
+
+  // The trace of the thread which initialized the iterator, adopted by the
+  // tasks.
+  scoped_refptr<Trace> trace_;
+
+  // See UnionIterator::scan_spec_copies_.
+  ObjectPool<ScanSpec> scan_spec_copies_;
+
+  // The block NextBlock() is copying rows from, and the index of the next row
+  // to copy. Only accessed by the caller's thread.
+  unique_ptr<Block> current_;
+  size_t current_offset_;
+
+  mutable Mutex lock_;
+  // Signaled when a block is queued or a task ends.
+  mutable ConditionVariable cond_;
+
+  // The remaining members are protected by 'lock_'.
+
+  // The index in 'iters_' of the next sub-iterator nobody started reading.
+  size_t next_iter_idx_;
+  // The sub-iterators which were partially read, and which no task is
+  // currently reading.
+  deque<RowwiseIterator*> paused_iters_;
+  // The number of tasks which were submitted and haven't ended.
+  int num_running_;
+  // Set when the tasks should end.
+  bool stopping_;
+  // The first error returned by a sub-iterator or the pool.
+  Status status_;
+
+  deque<unique_ptr<Block>> queued_blocks_;
+  vector<unique_ptr<Block>> free_blocks_;
+
+  // Statistics (keyed by projection column index) accumulated so far by any
+  // fully-consumed sub-iterators.
+  vector<IteratorStats> finished_iter_stats_by_col_;
+};
+
+ParallelUnionIterator::ParallelUnionIterator(vector<IterWithBounds> iters,
+                                             ThreadPool* pool,
+                                             int num_threads)
+    : iters_(std::move(iters)),
+      pool_(CHECK_NOTNULL(pool)),
+      num_threads_(num_threads),
+      initted_(false),
+      current_offset_(0),
+      cond_(&lock_),
+      next_iter_idx_(0),
+      num_running_(0),
+      stopping_(false) {
+  CHECK_GT(iters_.size(), 0);
+  CHECK_GT(num_threads_, 0);
+}
+
+ParallelUnionIterator::~ParallelUnionIterator() {
+  MutexLock l(lock_);
+  stopping_ = true;
+  while (num_running_ > 0) {
+    cond_.Wait();
+  }
+}
+
+Status ParallelUnionIterator::Init(ScanSpec* spec) {
+  CHECK(!initted_);
+  for (auto& i : iters_) {
+    ScanSpec* spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
+    RETURN_NOT_OK(InitAndMaybeWrap(&i.iter, spec_copy));
+    i.encoded_bounds.reset();
+  }
+  if (spec != nullptr) {
+    spec->RemovePredicates();
+    spec->RemoveExpressionPredicates();
+  }
+
+  schema_.reset(new Schema(iters_.front().iter->schema()));
+  finished_iter_stats_by_col_.resize(schema_->num_columns());
+#ifndef NDEBUG
+  for (const auto& i : iters_) {
+    if (i.iter->schema() != *schema_) {
+      return Status::InvalidArgument(
+          Substitute("Schemas do not match: $0 vs. $1",
+                     schema_->ToString(), i.iter->schema().ToString()));
+    }
+  }
+#endif
+
+  for (int i = 0; i < std::min<int>(num_threads_, iters_.size()) * 2; i++) {
+    free_blocks_.emplace_back(new Block(schema_.get()));
+  }
+  trace_ = Trace::CurrentTrace();
+  initted_ = true;
+
+  MutexLock l(lock_);
+  MaybeStartTasksUnlocked();
+  return status_;
+}
+
+void ParallelUnionIterator::MaybeStartTasksUnlocked() {
+  lock_.AssertAcquired();
+  const auto num_readable = [this]() {
+    return paused_iters_.size() + iters_.size() - next_iter_idx_;
+  };
+  while (!stopping_ && num_running_ < num_threads_ &&
+         static_cast<size_t>(num_running_) < std::min(free_blocks_.size(), num_readable())) {
+    Status s = pool_->Submit([this]() { this->RunTask(); });
+    if (PREDICT_FALSE(!s.ok())) {
+      // The running tasks read the remaining sub-iterators, if there are any.
+      if (num_running_ == 0) {
+        status_ = s.CloneAndPrepend("unable to read the sub-iterators");
+      }
+      return;
+    }
+    num_running_++;
+  }
+}
+
+void ParallelUnionIterator::RunTask() {
+  ADOPT_TRACE(trace_.get());
+  MutexLock l(lock_);
+  while (!stopping_ && !free_blocks_.empty()) {
+    RowwiseIterator* iter;
+    if (!paused_iters_.empty()) {
+      iter = paused_iters_.front();
+      paused_iters_.pop_front();
+    } else if (next_iter_idx_ < iters_.size()) {
+      iter = iters_[next_iter_idx_++].iter.get();
+    } else {
+      break;
+    }
+    unique_ptr<Block> block = std::move(free_blocks_.back());
+    free_blocks_.pop_back();
+    l.Unlock();
+    Status s;
+    if (iter->HasNext()) {
+      block->memory.Reset();
+      s = iter->NextBlock(&block->block);
+    } else {
+      block->block.Resize(0);
+    }
+    const bool has_next = s.ok() && iter->HasNext();
+    l.Lock();
+
+    if (PREDICT_FALSE(!s.ok())) {
+      free_blocks_.emplace_back(std::move(block));
+      if (status_.ok()) {
+        status_ = s;
+      }
+      stopping_ = true;
+      break;
+    }
+    if (has_next) {
+      paused_iters_.push_back(iter);
+    } else {
+      AddIterStats(*iter, &finished_iter_stats_by_col_);
+    }
+    if (block->block.nrows() == 0) {
+      free_blocks_.emplace_back(std::move(block));
+    } else {
+      queued_blocks_.emplace_back(std::move(block));
+      cond_.Broadcast();
+    }
+  }
+  num_running_--;
+  cond_.Broadcast();
+}
+
+void ParallelUnionIterator::WaitForBlockUnlocked() const {
+  lock_.AssertAcquired();
+  // A task only ends with sub-iterators left to read when there are queued
+  // blocks, or when it failed.
+  while (queued_blocks_.empty() && num_running_ > 0 && status_.ok()) {
+    cond_.Wait();
+  }
+}
+
+bool ParallelUnionIterator::HasNext() const {
+  CHECK(initted_);
+  if (current_) {
+    return true;
+  }
+  MutexLock l(lock_);
+  WaitForBlockUnlocked();
+  // An error is returned by the next call to NextBlock().
+  return !queued_blocks_.empty() || !status_.ok();
+}
+
+Status ParallelUnionIterator::NextBlock(RowBlock* dst) {
+  CHECK(initted_);
+  if (!current_) {
+    MutexLock l(lock_);
+    WaitForBlockUnlocked();
+    RETURN_NOT_OK(status_);
+    if (queued_blocks_.empty()) {
+      dst->Resize(0);
+      return Status::OK();
+    }
+    current_ = std::move(queued_blocks_.front());
+    queued_blocks_.pop_front();
+    current_offset_ = 0;
+  }
+
+  const RowBlock& src = current_->block;
+  const size_t num_rows = std::min(dst->row_capacity(), src.nrows() - current_offset_);
+  dst->Resize(num_rows);
+  // The indirect data is copied to the arena of 'dst', so the block can be
+  // reused right away.
+  RETURN_NOT_OK(src.CopyTo(dst, current_offset_, 0, num_rows));
+  current_offset_ += num_rows;
+  if (current_offset_ == src.nrows()) {
+    MutexLock l(lock_);
+    free_blocks_.emplace_back(std::move(current_));
+    MaybeStartTasksUnlocked();
+  }
+  return Status::OK();
+}
+
+string ParallelUnionIterator::ToString() const {
+  return Substitute("ParallelUnion($0 iters, $1 threads)", iters_.size(), num_threads_);
+}
+
+void ParallelUnionIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  CHECK(initted_);
+  MutexLock l(lock_);
+  *stats = finished_iter_stats_by_col_;
+}
+
+unique_ptr<RowwiseIterator> NewParallelUnionIterator(vector<IterWithBounds> iters,
+                                                     ThreadPool* pool,
+                                                     int num_threads) {
+  return unique_ptr<RowwiseIterator>(
+      new ParallelUnionIterator(std::move(iters), pool, num_threads));
+}
+
+////////////////////////////////////////////////////////////
+// TopNIterator
+////////////////////////////////////////////////////////////
+
+// An iterator which returns the top rows of another iterator in the order of
+// one of its columns.
+//
+// The wrapped iterator is exhausted in Init(), keeping the top rows seen so far
+// in a heap whose root is the last of the kept rows. The kept rows, including
+// their indirect data, are copied into an arena which is compacted when the
+// evicted rows account for most of its memory.
+class TopNIterator : public RowwiseIterator {
+ public:
+  TopNIterator(TopNIteratorOptions opts, unique_ptr<RowwiseIterator> base_iter)
+      : opts_(std::move(opts)),
+        base_iter_(std::move(base_iter)),
+        col_idx_(-1),
+        arena_(new Arena(32 * 1024)),
+        compact_threshold_bytes_(kMinCompactThresholdBytes),
+        next_row_idx_(0) {
+  }
+
+  Status Init(ScanSpec* spec) OVERRIDE;
+
+  bool HasNext() const OVERRIDE {
+    return next_row_idx_ < rows_.size();
+  }
+
+  Status NextBlock(RowBlock* dst) OVERRIDE;
+
+  string ToString() const OVERRIDE {
+    return Substitute("TopN($0 $1 LIMIT $2, $3)", opts_.column_name,
+                      opts_.descending ? "DESC" : "ASC", opts_.limit, base_iter_->ToString());
+  }
+
+  const Schema& schema() const OVERRIDE {
+    return base_iter_->schema();
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE {
+    base_iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  // The arena isn't compacted until it holds at least this many bytes.
+  static constexpr size_t kMinCompactThresholdBytes = 1024 * 1024;
+
+  // Returns a negative value if the cell of 'lhs' comes before that of 'rhs'
+  // in the order of the iterator, a positive value if it comes after, and 0
+  // if the cells are equal.
+  template<class RowType1, class RowType2>
+  int CompareRows(const RowType1& lhs, const RowType2& rhs) const {
+    if (nullable_) {
+      const bool lhs_null = lhs.is_null(col_idx_);
+      const bool rhs_null = rhs.is_null(col_idx_);
+      if (lhs_null || rhs_null) {
+        return static_cast<int>(lhs_null) - static_cast<int>(rhs_null);
+      }
+    }
+    const int cmp = type_info_->Compare(lhs.cell_ptr(col_idx_), rhs.cell_ptr(col_idx_));
+    return opts_.descending ? -cmp : cmp;
+  }
+
+  // Orders the kept rows for the heap functions.
+  struct RowBefore {
+    bool operator()(const uint8_t* lhs, const uint8_t* rhs) const {
+      const Schema* schema = &iter->schema();
+      return iter->CompareRows(ConstContiguousRow(schema, lhs),
+                               ConstContiguousRow(schema, rhs)) < 0;
+    }
+    const TopNIterator* iter;
+  };
+
+  // Copies 'src' into the arena, returning the copy.
+  template<class RowType>
+  Status CopyToArena(const RowType& src, uint8_t** dst) {
+    uint8_t* data = static_cast<uint8_t*>(
+        arena_->AllocateBytes(ContiguousRowHelper::row_size(schema())));
+    if (PREDICT_FALSE(!data)) {
+      return Status::RuntimeError("unable to allocate memory for the top rows");
+    }
+    ContiguousRow dst_row(&schema(), data);
+    RETURN_NOT_OK(CopyRow(src, &dst_row, arena_.get()));
+    *dst = data;
+    return Status::OK();
+  }
+
+  // Adds the selected rows of 'block' to the heap.
+  Status AddBlock(const RowBlock& block);
+
+  // Copies the kept rows into a new arena, releasing the memory of the rows
+  // which were evicted from the heap.
+  Status CompactArena();
+
+  const TopNIteratorOptions opts_;
+  unique_ptr<RowwiseIterator> base_iter_;
+
+  int col_idx_;
+  bool nullable_;
+  const TypeInfo* type_info_;
+
+  unique_ptr<Arena> arena_;
+  size_t compact_threshold_bytes_;
+
+  // The contiguous rows kept so far. While the base iterator is consumed,
+  // they're a max-heap in the order of the iterator. Afterwards, they're
+  // sorted in that order.
+  vector<uint8_t*> rows_;
+
+  // The index in 'rows_' of the next row to return.
+  size_t next_row_idx_;
+};
+
+Status TopNIterator::Init(ScanSpec* spec) {
+  // The predicates must be evaluated before the rows are ranked.
+  RETURN_NOT_OK(InitAndMaybeWrap(&base_iter_, spec));
+  col_idx_ = schema().find_column(opts_.column_name);
+  if (col_idx_ == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("No such column", opts_.column_name);
+  }
+  const ColumnSchema& col = schema().column(col_idx_);
+  nullable_ = col.is_nullable();
+  type_info_ = col.type_info();
+  if (opts_.limit == 0) {
+    return Status::OK();
+  }
+  rows_.reserve(opts_.limit);
+
+  RowBlockMemory memory;
+  RowBlock block(&schema(), kMergeRowBuffer, &memory);
+  while (base_iter_->HasNext()) {
+    memory.Reset();
+    RETURN_NOT_OK(base_iter_->NextBlock(&block));
+    RETURN_NOT_OK(AddBlock(block));
+  }
+
+  std::sort_heap(rows_.begin(), rows_.end(), RowBefore{ this });
+  TRACE("Kept $0 top rows", rows_.size());
+  return Status::OK();
+}
+
+Status TopNIterator::AddBlock(const RowBlock& block) {
+  const SelectionVector* sel = block.selection_vector();
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (!sel->IsRowSelected(i)) {
+      continue;
+    }
+    const RowBlockRow row = block.row(i);
+    if (rows_.size() < opts_.limit) {
+      uint8_t* copy;
+      RETURN_NOT_OK(CopyToArena(row, &copy));
+      rows_.push_back(copy);
+      std::push_heap(rows_.begin(), rows_.end(), RowBefore{ this });
+      continue;
+    }
+    // Only rows which come before the last kept row replace it.
+    if (CompareRows(row, ConstContiguousRow(&schema(), rows_.front())) >= 0) {
+      continue;
+    }
+    std::pop_heap(rows_.begin(), rows_.end(), RowBefore{ this });
+    RETURN_NOT_OK(CopyToArena(row, &rows_.back()));
+    std::push_heap(rows_.begin(), rows_.end(), RowBefore{ this });
+    if (arena_->memory_footprint() > compact_threshold_bytes_) {
+      RETURN_NOT_OK(CompactArena());
+    }
+  }
+  return Status::OK();
+}
+
+Status TopNIterator::CompactArena() {
+  unique_ptr<Arena> old_arena(std::move(arena_));
+  arena_.reset(new Arena(32 * 1024));
+  for (auto& row : rows_) {
+    RETURN_NOT_OK(CopyToArena(ConstContiguousRow(&schema(), row), &row));
+  }
+  // Let the arena grow to twice the size of the kept rows before compacting
+  // it again.
+  compact_threshold_bytes_ = std::max(kMinCompactThresholdBytes,
+                                      2 * arena_->memory_footprint());
+  return Status::OK();
+}
+
+Status TopNIterator::NextBlock(RowBlock* dst) {
+  DCHECK_SCHEMA_EQ(*dst->schema(), schema());
+  if (dst->arena()) {
+    dst->arena()->Reset();
+  }
+  const size_t num_rows = std::min(dst->nrows(), rows_.size() - next_row_idx_);
+  for (size_t i = 0; i < num_rows; i++) {
+    RowBlockRow dst_row = dst->row(i);
+    RETURN_NOT_OK(CopyRow(ConstContiguousRow(&schema(), rows_[next_row_idx_ + i]),
+                          &dst_row, dst->arena()));
+  }
+  next_row_idx_ += num_rows;
+  if (num_rows < dst->nrows()) {
+    dst->Resize(num_rows);
+  }
+  dst->selection_vector()->SetAllTrue();
+  return Status::OK();
+}
+
+unique_ptr<RowwiseIterator> NewTopNIterator(TopNIteratorOptions opts,
+                                            unique_ptr<RowwiseIterator> iter) {
+  return unique_ptr<RowwiseIterator>(new TopNIterator(std::move(opts), std::move(iter)));
+}
+
 ////////////////////////////////////////////////////////////
 // MaterializingIterator
 ////////////////////////////////////////////////////////////
@@ -1133,6 +1801,7 @@ class MaterializingIterator : public RowwiseIterator {
     iter_->GetIteratorStats(stats);
     predicates_effectiveness_ctx_.PopulateIteratorStatsWithDisabledPredicates(
         col_idx_predicates_, stats);
+    predicates_order_.PopulateIteratorStatsWithPredicateOrder(col_idx_predicates_, stats);
   }
 
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
@@ -1144,6 +1813,9 @@ class MaterializingIterator : public RowwiseIterator {
  private:
   Status MaterializeBlock(RowBlock *dst);
 
+  // Re-sorts the predicates if due, noting the new order in the trace.
+  void MaybeReorderPredicates();
+
   unique_ptr<ColumnwiseIterator> iter_;
 
   // List of (column index, predicate) in order of most to least selective, with
@@ -1156,6 +1828,10 @@ class MaterializingIterator : public RowwiseIterator {
   // Predicate effective contexts help disable ineffective column predicates.
   IteratorPredicateEffectivenessContext predicates_effectiveness_ctx_;
 
+  // The order in which to evaluate the predicates in 'col_idx_predicates_', adapted
+  // to their observed selectivity and cost.
+  PredicateEvaluationOrder predicates_order_;
+
   // Set only by test code to disallow pushdown.
   bool disallow_pushdown_for_tests_;
   bool disallow_decoder_eval_;
@@ -1220,9 +1896,16 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
       predicates_effectiveness_ctx_.AddDisableablePredicate(pred_idx, predicate);
     }
   }
+  predicates_order_.Init(col_idx_predicates_.size());
   return Status::OK();
 }
 
+void MaterializingIterator::MaybeReorderPredicates() {
+  if (predicates_order_.MaybeReorder()) {
+    TRACE("Reordered predicates: $0", predicates_order_.OrderToString(col_idx_predicates_));
+  }
+}
+
 bool MaterializingIterator::HasNext() const {
   return iter_->HasNext();
 }
@@ -1253,8 +1936,16 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     return Status::OK();
   }
 
+  // Columns are materialized in order, predicate columns first, so the
+  // selection vector only ever narrows down. Rows it has already ruled out
+  // don't need to be decoded by the remaining columns.
+  const bool late_materialization = FLAGS_materializing_iterator_late_materialization;
+
   predicates_effectiveness_ctx_.IncrementNextBlockCount();
-  for (int i = 0; i < col_idx_predicates_.size(); i++) {
+  predicates_order_.IncrementNextBlockCount();
+  const bool measure_predicates = predicates_order_.enabled();
+  int64_t num_rows_selected = measure_predicates ? dst->selection_vector()->CountSelected() : 0;
+  for (int i : predicates_order_.order()) {
     const auto& col_pred = col_idx_predicates_[i];
     const auto& col_idx = get<0>(col_pred);
     const auto& predicate = get<1>(col_pred);
@@ -1265,6 +1956,7 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
                                      &predicate,
                                      &dst_col,
                                      dst->selection_vector());
+    ctx.set_skip_unselected_rows(late_materialization);
     // None predicates should be short-circuited in scan spec.
     DCHECK(ctx.pred()->predicate_type() != PredicateType::None);
     auto* effectiveness_ctx = IsColumnPredicateDisableable(predicate.predicate_type()) ?
@@ -1295,10 +1987,21 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     auto num_rows_before = disableable_predicate_enabled ?
                            dst->selection_vector()->CountSelected() : 0;
 
+    MonoTime start;
+    if (measure_predicates) {
+      start = MonoTime::Now();
+    }
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
     if (ctx.DecoderEvalNotSupported() && !disableable_predicate_disabled) {
+      TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_PREDICATE_EVAL_US_METRIC_NAME);
       predicate.Evaluate(dst_col, dst->selection_vector());
     }
+    if (measure_predicates) {
+      int64_t num_rows_after = dst->selection_vector()->CountSelected();
+      predicates_order_.RecordEvaluation(i, num_rows_selected - num_rows_after,
+                                         (MonoTime::Now() - start).ToNanoseconds());
+      num_rows_selected = num_rows_after;
+    }
     if (disableable_predicate_enabled) {
       auto num_rows_rejected = num_rows_before - dst->selection_vector()->CountSelected();
       DCHECK_GE(num_rows_rejected, 0);
@@ -1311,10 +2014,12 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     // out, we don't need to materialize other columns at all.
     if (!dst->selection_vector()->AnySelected()) {
       DVLOG(1) << "0/" << dst->nrows() << " passed predicate";
+      MaybeReorderPredicates();
       return Status::OK();
     }
   }
   predicates_effectiveness_ctx_.DisableIneffectivePredicates();
+  MaybeReorderPredicates();
 
   for (size_t col_idx : non_predicate_column_indexes_) {
     // Materialize the column itself into the row block.
@@ -1323,6 +2028,7 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
                                      nullptr,
                                      &dst_col,
                                      dst->selection_vector());
+    ctx.set_skip_unselected_rows(late_materialization);
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
   }
 
@@ -1374,6 +2080,7 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
     base_iter_->GetIteratorStats(stats);
     predicates_effectiveness_ctx_.PopulateIteratorStatsWithDisabledPredicates(
         col_idx_predicates_, stats);
+    predicates_order_.PopulateIteratorStatsWithPredicateOrder(col_idx_predicates_, stats);
   }
 
   // Return the column predicates tracked by this iterator. Only valid for the lifetime of
@@ -1402,6 +2109,10 @@ class PredicateEvaluatingIterator : public RowwiseIterator {
 
   // Predicate effective contexts help disable ineffective column predicates.
   IteratorPredicateEffectivenessContext predicates_effectiveness_ctx_;
+
+  // The order in which to evaluate the predicates in 'col_idx_predicates_', adapted
+  // to their observed selectivity and cost.
+  PredicateEvaluationOrder predicates_order_;
 };
 
 PredicateEvaluatingIterator::PredicateEvaluatingIterator(unique_ptr<RowwiseIterator> base_iter)
@@ -1446,6 +2157,7 @@ Status PredicateEvaluatingIterator::Init(ScanSpec *spec) {
       predicates_effectiveness_ctx_.AddDisableablePredicate(pred_idx, predicate);
     }
   }
+  predicates_order_.Init(col_idx_predicates_.size());
 
   return Status::OK();
 }
@@ -1458,7 +2170,10 @@ Status PredicateEvaluatingIterator::NextBlock(RowBlock *dst) {
   RETURN_NOT_OK(base_iter_->NextBlock(dst));
 
   predicates_effectiveness_ctx_.IncrementNextBlockCount();
-  for (int i = 0; i < col_idx_predicates_.size(); i++) {
+  predicates_order_.IncrementNextBlockCount();
+  const bool measure_predicates = predicates_order_.enabled();
+  int64_t num_rows_selected = measure_predicates ? dst->selection_vector()->CountSelected() : 0;
+  for (int i : predicates_order_.order()) {
     const auto& col_idx = col_idx_predicates_[i].first;
     const auto& predicate = col_idx_predicates_[i].second;
     DCHECK_NE(col_idx, Schema::kColumnNotFound);
@@ -1480,7 +2195,17 @@ Status PredicateEvaluatingIterator::NextBlock(RowBlock *dst) {
     auto num_rows_before = effectiveness_ctx ?
                            dst->selection_vector()->CountSelected() : 0;
 
+    MonoTime start;
+    if (measure_predicates) {
+      start = MonoTime::Now();
+    }
     predicate.Evaluate(dst->column_block(col_idx), dst->selection_vector());
+    if (measure_predicates) {
+      int64_t num_rows_after = dst->selection_vector()->CountSelected();
+      predicates_order_.RecordEvaluation(i, num_rows_selected - num_rows_after,
+                                         (MonoTime::Now() - start).ToNanoseconds());
+      num_rows_selected = num_rows_after;
+    }
 
     if (effectiveness_ctx) {
       auto num_rows_rejected = num_rows_before - dst->selection_vector()->CountSelected();
@@ -1497,6 +2222,9 @@ Status PredicateEvaluatingIterator::NextBlock(RowBlock *dst) {
     }
   }
   predicates_effectiveness_ctx_.DisableIneffectivePredicates();
+  if (predicates_order_.MaybeReorder()) {
+    TRACE("Reordered predicates: $0", predicates_order_.OrderToString(col_idx_predicates_));
+  }
 
   return Status::OK();
 }
@@ -1505,6 +2233,60 @@ string PredicateEvaluatingIterator::ToString() const {
   return Substitute("PredicateEvaluating($0)", base_iter_->ToString());
 }
 
+////////////////////////////////////////////////////////////
+// ExpressionEvaluatingIterator
+////////////////////////////////////////////////////////////
+
+// An iterator which wraps another iterator and evaluates the expression
+// predicates of the scan spec over the rows it returns.
+class ExpressionEvaluatingIterator : public RowwiseIterator {
+ public:
+  // This is only called from ::InitAndMaybeWrap()
+  // REQUIRES: base_iter is already Init()ed.
+  explicit ExpressionEvaluatingIterator(unique_ptr<RowwiseIterator> base_iter)
+      : base_iter_(std::move(base_iter)) {
+  }
+
+  // POSTCONDITION: spec->expression_predicates().empty()
+  Status Init(ScanSpec* spec) override {
+    CHECK_NOTNULL(spec);
+    exprs_ = spec->expression_predicates();
+    spec->RemoveExpressionPredicates();
+    return Status::OK();
+  }
+
+  Status NextBlock(RowBlock* dst) override {
+    RETURN_NOT_OK(base_iter_->NextBlock(dst));
+    for (const auto& expr : exprs_) {
+      if (!dst->selection_vector()->AnySelected()) {
+        break;
+      }
+      RETURN_NOT_OK(expr->Filter(dst));
+    }
+    return Status::OK();
+  }
+
+  bool HasNext() const override {
+    return base_iter_->HasNext();
+  }
+
+  string ToString() const override {
+    return Substitute("ExpressionEvaluating($0)", base_iter_->ToString());
+  }
+
+  const Schema& schema() const override {
+    return base_iter_->schema();
+  }
+
+  void GetIteratorStats(vector<IteratorStats>* stats) const override {
+    base_iter_->GetIteratorStats(stats);
+  }
+
+ private:
+  unique_ptr<RowwiseIterator> base_iter_;
+  vector<std::shared_ptr<const ColumnExpression>> exprs_;
+};
+
 Status InitAndMaybeWrap(unique_ptr<RowwiseIterator>* base_iter,
                         ScanSpec *spec) {
   RETURN_NOT_OK((*base_iter)->Init(spec));
@@ -1515,6 +2297,13 @@ Status InitAndMaybeWrap(unique_ptr<RowwiseIterator>* base_iter,
     RETURN_NOT_OK(wrapper->Init(spec));
     *base_iter = std::move(wrapper);
   }
+  if (spec != nullptr && !spec->expression_predicates().empty()) {
+    // The expression predicates are evaluated after the column predicates,
+    // which are usually cheaper.
+    unique_ptr<RowwiseIterator> wrapper(new ExpressionEvaluatingIterator(std::move(*base_iter)));
+    RETURN_NOT_OK(wrapper->Init(spec));
+    *base_iter = std::move(wrapper);
+  }
   return Status::OK();
 }
 
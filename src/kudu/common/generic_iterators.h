@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <utility>
@@ -30,6 +31,7 @@ namespace kudu {
 
 class ColumnPredicate;
 class ScanSpec;
+class ThreadPool;
 
 // Encapsulates a rowwise-iterator along with the (encoded) lower and upper
 // bounds for the rowset that the iterator belongs to.
@@ -63,6 +65,45 @@ std::unique_ptr<RowwiseIterator> NewMergeIterator(
 // The iterators must have matching schemas and should not yet be initialized.
 std::unique_ptr<RowwiseIterator> NewUnionIterator(std::vector<IterWithBounds> iters);
 
+// Constructs an iterator which unions the given iterators like a
+// UnionIterator, but reads up to 'num_threads' of them at a time on 'pool'.
+// The rows of the iterators are interleaved in the output.
+//
+// The iterators must have matching schemas and should not yet be initialized.
+// 'pool' must outlive the returned iterator.
+std::unique_ptr<RowwiseIterator> NewParallelUnionIterator(std::vector<IterWithBounds> iters,
+                                                          ThreadPool* pool,
+                                                          int num_threads);
+
+// Options struct for the TopNIterator.
+struct TopNIteratorOptions {
+  TopNIteratorOptions(std::string column_name, bool descending, size_t limit)
+      : column_name(std::move(column_name)),
+        descending(descending),
+        limit(limit) {}
+
+  // The column to order the rows by, which must be part of the schema of the
+  // wrapped iterator.
+  const std::string column_name;
+
+  // Whether the rows with the largest values come first. Rows whose value is
+  // NULL come last in either order.
+  const bool descending;
+
+  // The maximum number of rows to return.
+  const size_t limit;
+};
+
+// Constructs a TopNIterator, which returns the first 'opts.limit' rows of the
+// given iterator in the order of 'opts.column_name'. The order of rows with
+// the same value is unspecified.
+//
+// The given iterator should not yet be initialized. It's exhausted when the
+// TopNIterator is initialized, keeping only the top rows in memory.
+std::unique_ptr<RowwiseIterator> NewTopNIterator(
+    TopNIteratorOptions opts,
+    std::unique_ptr<RowwiseIterator> iter);
+
 // Constructs a MaterializingIterator of the given ColumnwiseIterator.
 std::unique_ptr<RowwiseIterator> NewMaterializingIterator(
     std::unique_ptr<ColumnwiseIterator> iter);
@@ -71,9 +112,12 @@ std::unique_ptr<RowwiseIterator> NewMaterializingIterator(
 //
 // If the base_iter accepts all predicates, then simply returns. Otherwise,
 // swaps out *base_iter for a PredicateEvaluatingIterator which wraps the
-// original iterator and accepts all predicates on its behalf.
+// original iterator and accepts all predicates on its behalf. Likewise wraps
+// it in an ExpressionEvaluatingIterator if it doesn't accept the expression
+// predicates of the spec.
 //
 // POSTCONDITION: spec->predicates().empty()
+// POSTCONDITION: spec->expression_predicates().empty()
 // POSTCONDITION: base_iter and its wrapper are initialized
 Status InitAndMaybeWrap(std::unique_ptr<RowwiseIterator>* base_iter,
                         ScanSpec* spec);
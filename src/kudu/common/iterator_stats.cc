@@ -30,19 +30,25 @@ IteratorStats::IteratorStats()
     : cells_read(0),
       bytes_read(0),
       blocks_read(0),
-      predicates_disabled(0) {
+      blocks_read_from_disk(0),
+      predicates_disabled(0),
+      predicate_blocks_evaluated_first(0) {
 }
 
 string IteratorStats::ToString() const {
-  return Substitute("cells_read=$0 bytes_read=$1 blocks_read=$2 predicates_disabled=$3",
-                    cells_read, bytes_read, blocks_read, predicates_disabled);
+  return Substitute("cells_read=$0 bytes_read=$1 blocks_read=$2 blocks_read_from_disk=$3 "
+                    "predicates_disabled=$4 predicate_blocks_evaluated_first=$5",
+                    cells_read, bytes_read, blocks_read, blocks_read_from_disk,
+                    predicates_disabled, predicate_blocks_evaluated_first);
 }
 
 IteratorStats& IteratorStats::operator+=(const IteratorStats& other) {
   cells_read += other.cells_read;
   bytes_read += other.bytes_read;
   blocks_read += other.blocks_read;
+  blocks_read_from_disk += other.blocks_read_from_disk;
   predicates_disabled += other.predicates_disabled;
+  predicate_blocks_evaluated_first += other.predicate_blocks_evaluated_first;
   DCheckNonNegative();
   return *this;
 }
@@ -51,7 +57,9 @@ IteratorStats& IteratorStats::operator-=(const IteratorStats& other) {
   cells_read -= other.cells_read;
   bytes_read -= other.bytes_read;
   blocks_read -= other.blocks_read;
+  blocks_read_from_disk -= other.blocks_read_from_disk;
   predicates_disabled -= other.predicates_disabled;
+  predicate_blocks_evaluated_first -= other.predicate_blocks_evaluated_first;
   DCheckNonNegative();
   return *this;
 }
@@ -72,6 +80,8 @@ void IteratorStats::DCheckNonNegative() const {
   DCHECK_GE(cells_read, 0);
   DCHECK_GE(bytes_read, 0);
   DCHECK_GE(blocks_read, 0);
+  DCHECK_GE(blocks_read_from_disk, 0);
   DCHECK_GE(predicates_disabled, 0);
+  DCHECK_GE(predicate_blocks_evaluated_first, 0);
 }
 } // namespace kudu
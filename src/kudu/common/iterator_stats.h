@@ -37,12 +37,19 @@ struct IteratorStats {
   // The number of CFile data blocks read from disk (or cache) by the iterator.
   int64_t blocks_read;
 
+  // The number of those blocks which weren't in the block cache.
+  int64_t blocks_read_from_disk;
+
   // The number of column predicates disabled because they were determined to be
   // ineffective.
   // There is only one predicate per column (if any) so for a per column stat this would be 0 or 1.
   // Using an integer helps the stat work well when aggregating or computing delta.
   int64_t predicates_disabled;
 
+  // The number of blocks for which the column's predicate was the first one evaluated,
+  // as chosen by the adaptive predicate ordering.
+  int64_t predicate_blocks_evaluated_first;
+
   // Add statistics contained 'other' to this object (for each field
   // in this object, increment it by the value of the equivalent field
   // in 'other').
@@ -45,6 +45,7 @@ namespace client {
 class ClientTest_TestProjectionPredicatesFuzz_Test;
 class KuduWriteOperation;
 namespace internal {
+class ColumnarInsertOp;
 class WriteRpc;
 } // namespace internal
 template<typename KeyTypeWrapper> struct SliceKeysTestSetup;// IWYU pragma: keep
@@ -60,6 +61,10 @@ namespace tools {
 class TableScanner;
 } // namespace tools
 
+namespace tserver {
+class ChangeEncoder;
+} // namespace tserver
+
 /// @endcond
 
 class Schema;
@@ -641,6 +646,7 @@ class KUDU_EXPORT KuduPartialRow {
 
  private:
   friend class client::KuduWriteOperation;   // for row_data_.
+  friend class client::internal::ColumnarInsertOp; // for Set(int32_t, const uint8_t*)
   friend class client::internal::WriteRpc;   // for row_data_.
   friend class KeyUtilTest;
   friend class PartitionSchema;
@@ -648,6 +654,7 @@ class KUDU_EXPORT KuduPartialRow {
   friend class RowOperationsPBEncoder;
   friend class ScanSpec; // for Set(int32_t column_idx, const uint8_t* val)
   friend class tools::TableScanner;
+  friend class tserver::ChangeEncoder; // for Set(int32_t column_idx, const uint8_t* val)
   friend class TestScanSpec;
   template<typename KeyTypeWrapper> friend struct client::SliceKeysTestSetup;
   template<typename KeyTypeWrapper> friend struct client::IntKeysTestSetup;
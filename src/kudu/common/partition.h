@@ -452,6 +452,17 @@ class PartitionSchema {
     return !ranges_with_hash_schemas_.empty();
   }
 
+  // Find hash schema for the given encoded range key. Depending on the
+  // partition schema and the key, it might be either table-wide or a custom
+  // hash schema for a particular range.
+  const HashSchema& GetHashSchemaForRange(const std::string& range_key) const;
+
+  // Returns the hash value of the encoded hash columns. The encoded columns
+  // must match the columns of the hash dimension.
+  static uint32_t HashValueForEncodedColumns(
+      const std::string& encoded_hash_columns,
+      const HashDimension& hash_dimension);
+
   // Given the specified table schema, populate the 'range_column_indexes'
   // container with column indexes of the range partition keys.
   // If any of the columns is not in the key range columns then an
@@ -492,12 +503,6 @@ class PartitionSchema {
                             const std::vector<ColumnId>& column_ids,
                             std::string* buf);
 
-  // Returns the hash value of the encoded hash columns. The encoded columns
-  // must match the columns of the hash dimension.
-  static uint32_t HashValueForEncodedColumns(
-      const std::string& encoded_hash_columns,
-      const HashDimension& hash_dimension);
-
   // Assigns the row to a bucket according to the hash rules.
   template<typename Row>
   static uint32_t HashValueForRow(const Row& row,
@@ -608,11 +613,6 @@ class PartitionSchema {
   // maximum value. Unset columns will be incremented to increment(min_value).
   Status IncrementRangePartitionKey(KuduPartialRow* row, bool* increment) const;
 
-  // Find hash schema for the given encoded range key. Depending on the
-  // partition schema and the key, it might be either table-wide or a custom
-  // hash schema for a particular range.
-  const HashSchema& GetHashSchemaForRange(const std::string& range_key) const;
-
   RangeSchema range_schema_;
   HashSchema hash_schema_;
   RangesWithHashSchemas ranges_with_hash_schemas_;
@@ -822,6 +822,126 @@ TEST_F(PartitionPrunerTest, TestInListHashPruning) {
                   8, 8));
 }
 
+TEST_F(PartitionPrunerTest, TestTrimInListForPartition) {
+  // CREATE TABLE t
+  // (a INT8, b INT8)
+  // PRIMARY KEY (a, b)
+  // DISTRIBUTE BY HASH(a) INTO 3 BUCKETS;
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", INT8) },
+                { ColumnId(0), ColumnId(1) },
+                2);
+
+  PartitionSchemaPB pb;
+  CreatePartitionSchemaPB({}, { {{"a"}, 3, 0} }, &pb);
+  pb.mutable_range_schema()->clear_columns();
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(pb, schema, &partition_schema));
+
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions(vector<KuduPartialRow>(), {}, {},
+                                              schema, &partitions));
+  ASSERT_EQ(3, partitions.size());
+
+  // zero, one, eight are in different buckets when bucket number is 3 and seed is 0.
+  constexpr int8_t zero = 0;
+  constexpr int8_t one = 1;
+  constexpr int8_t eight = 8;
+  vector<const void*> values = { &zero, &one, &eight };
+  const auto a_pred = ColumnPredicate::InList(schema.column(0), &values);
+  values = { &zero, &one, &eight };
+  const auto b_pred = ColumnPredicate::InList(schema.column(1), &values);
+
+  const ScanSpec spec;
+  vector<int8_t> a_values;
+  for (const auto& partition : partitions) {
+    // Each partition is left with the only value hashing to its bucket.
+    const auto trimmed = PartitionPruner::TrimInListForPartition(
+        schema, partition_schema, partition, spec, a_pred);
+    ASSERT_EQ(PredicateType::Equality, trimmed.predicate_type());
+    const int8_t value = *static_cast<const int8_t*>(trimmed.raw_lower());
+    a_values.push_back(value);
+
+    KuduPartialRow row(&schema);
+    ASSERT_OK(row.SetInt8("a", value));
+    ASSERT_OK(row.SetInt8("b", 0));
+    ASSERT_TRUE(partition_schema.PartitionContainsRow(partition, row));
+
+    // The in-list on the column which isn't hashed is left as is.
+    ASSERT_EQ(b_pred, PartitionPruner::TrimInListForPartition(
+        schema, partition_schema, partition, spec, b_pred));
+  }
+  std::sort(a_values.begin(), a_values.end());
+  ASSERT_EQ(vector<int8_t>({ zero, one, eight }), a_values);
+}
+
+TEST_F(PartitionPrunerTest, TestTrimInListForRangePartitionAndKeyBounds) {
+  // CREATE TABLE t
+  // (a INT8, b INT8)
+  // PRIMARY KEY (a, b)
+  // DISTRIBUTE BY RANGE(a);
+  // SPLIT ROWS [(5)];
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", INT8) },
+                { ColumnId(0), ColumnId(1) },
+                2);
+
+  PartitionSchemaPB pb;
+  CreatePartitionSchemaPB({"a"}, {}, &pb);
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(pb, schema, &partition_schema));
+
+  KuduPartialRow split(&schema);
+  ASSERT_OK(split.SetInt8("a", 5));
+  vector<Partition> partitions;
+  ASSERT_OK(partition_schema.CreatePartitions({ split }, {}, {}, schema, &partitions));
+  ASSERT_EQ(2, partitions.size());
+
+  constexpr int8_t zero = 0;
+  constexpr int8_t one = 1;
+  constexpr int8_t eight = 8;
+  constexpr int8_t nine = 9;
+  vector<const void*> values = { &zero, &one, &eight, &nine };
+  const auto pred = ColumnPredicate::InList(schema.column(0), &values);
+
+  // Each range partition gets the values in its range.
+  ScanSpec spec;
+  auto trimmed = PartitionPruner::TrimInListForPartition(
+      schema, partition_schema, partitions[0], spec, pred);
+  ASSERT_EQ(PredicateType::InList, trimmed.predicate_type());
+  ASSERT_EQ(2, trimmed.raw_values().size());
+  ASSERT_EQ(zero, *static_cast<const int8_t*>(trimmed.raw_values()[0]));
+  ASSERT_EQ(one, *static_cast<const int8_t*>(trimmed.raw_values()[1]));
+  trimmed = PartitionPruner::TrimInListForPartition(
+      schema, partition_schema, partitions[1], spec, pred);
+  ASSERT_EQ(PredicateType::InList, trimmed.predicate_type());
+  ASSERT_EQ(2, trimmed.raw_values().size());
+  ASSERT_EQ(eight, *static_cast<const int8_t*>(trimmed.raw_values()[0]));
+  ASSERT_EQ(nine, *static_cast<const int8_t*>(trimmed.raw_values()[1]));
+
+  // With the primary key bounds [(1, 0), (9, 0)), the in-list loses 0, which
+  // is below the lower bound, but keeps 9: the rows (9, b) with b < 0 are
+  // below the upper bound.
+  Arena arena(1024);
+  const auto encode_key = [&](int8_t a, int8_t b) {
+    int8_t* row_data = static_cast<int8_t*>(arena.AllocateBytes(schema.key_byte_size()));
+    row_data[0] = a;
+    row_data[1] = b;
+    return EncodedKey::FromContiguousRow(
+        ConstContiguousRow(&schema, reinterpret_cast<uint8_t*>(row_data)), &arena);
+  };
+  spec.SetLowerBoundKey(encode_key(1, 0));
+  spec.SetExclusiveUpperBoundKey(encode_key(9, 0));
+  trimmed = PartitionPruner::TrimInListForPartition(
+      schema, partition_schema, partitions[0], spec, pred);
+  ASSERT_EQ(PredicateType::Equality, trimmed.predicate_type());
+  ASSERT_EQ(one, *static_cast<const int8_t*>(trimmed.raw_lower()));
+  trimmed = PartitionPruner::TrimInListForPartition(
+      schema, partition_schema, partitions[1], spec, pred);
+  ASSERT_EQ(PredicateType::InList, trimmed.predicate_type());
+  ASSERT_EQ(2, trimmed.raw_values().size());
+}
+
 TEST_F(PartitionPrunerTest, TestMultiColumnInListHashPruning) {
   // CREATE TABLE t
   // (a INT8, b INT8, c INT8)
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <numeric>
@@ -177,47 +178,76 @@ void EncodeRangeKeysFromPredicates(const Schema& schema,
     key_util::EncodeKey(col_idxs, row, range_key_end);
   }
 }
+// Returns whether a key whose leading column is encoded as 'prefix' may be in
+// the range of encoded keys ['lower', 'upper'), an empty bound being unbounded.
+// If 'is_whole_key' is true, 'prefix' is the whole key.
+bool EncodedPrefixMayBeInRange(const string& prefix,
+                               bool is_whole_key,
+                               const Slice& lower,
+                               const Slice& upper) {
+  const Slice key(prefix);
+  if (!upper.empty() && key.compare(upper) >= 0) {
+    return false;
+  }
+  if (lower.empty() || key.compare(lower) >= 0) {
+    return true;
+  }
+  // The longer keys starting with the prefix may still not be below 'lower'.
+  return !is_whole_key && lower.starts_with(key);
+}
+
 } // anonymous namespace
 
 vector<bool> PartitionPruner::PruneHashComponent(
     const PartitionSchema::HashDimension& hash_dimension,
     const Schema& schema,
     const ScanSpec& scan_spec) {
-  vector<bool> hash_bucket_bitset(hash_dimension.num_buckets, false);
-  vector<string> encoded_strings(1, "");
-  for (size_t col_offset = 0; col_offset < hash_dimension.column_ids.size(); ++col_offset) {
-    vector<string> new_encoded_strings;
-    const ColumnSchema& column = schema.column_by_id(hash_dimension.column_ids[col_offset]);
+  const size_t num_columns = hash_dimension.column_ids.size();
+  vector<const KeyEncoder<string>*> encoders;
+  vector<vector<const void*>> column_values;
+  encoders.reserve(num_columns);
+  column_values.reserve(num_columns);
+  for (const auto& column_id : hash_dimension.column_ids) {
+    const ColumnSchema& column = schema.column_by_id(column_id);
     const ColumnPredicate& predicate = FindOrDie(scan_spec.predicates(), column.name());
-    const KeyEncoder<string>& encoder = GetKeyEncoder<string>(column.type_info());
-
-    vector<const void*> predicate_values;
+    encoders.push_back(&GetKeyEncoder<string>(column.type_info()));
     if (predicate.predicate_type() == PredicateType::Equality) {
-      predicate_values.push_back(predicate.raw_lower());
+      column_values.push_back({ predicate.raw_lower() });
     } else {
       CHECK(predicate.predicate_type() == PredicateType::InList);
-      predicate_values.insert(predicate_values.end(),
-                              predicate.raw_values().begin(),
-                              predicate.raw_values().end());
+      column_values.push_back(predicate.raw_values());
     }
-    // For each of the encoded string, replicate it by the number of values in
-    // equality and in-list predicate.
-    for (const string& encoded_string : encoded_strings) {
-      for (const void* predicate_value : predicate_values) {
-        string new_encoded_string = encoded_string;
-        encoder.Encode(predicate_value,
-                       col_offset + 1 == hash_dimension.column_ids.size(),
-                       &new_encoded_string);
-        new_encoded_strings.emplace_back(new_encoded_string);
+  }
+
+  // Visit the combinations of the columns' values depth-first, encoding each
+  // value once per prefix of the combination instead of materializing all of
+  // the encoded combinations. Stop as soon as all the buckets are hit, which
+  // bounds the work done for large in-lists by the number of buckets.
+  vector<bool> hash_bucket_bitset(hash_dimension.num_buckets, false);
+  int32_t num_buckets_hit = 0;
+  string encoded;
+  std::function<bool(size_t)> visit = [&](size_t col_offset) {
+    const bool is_last = col_offset + 1 == num_columns;
+    const size_t prefix_len = encoded.size();
+    for (const void* value : column_values[col_offset]) {
+      encoders[col_offset]->Encode(value, is_last, &encoded);
+      if (is_last) {
+        uint32_t hash_value = PartitionSchema::HashValueForEncodedColumns(
+            encoded, hash_dimension);
+        if (!hash_bucket_bitset[hash_value]) {
+          hash_bucket_bitset[hash_value] = true;
+          if (++num_buckets_hit == hash_dimension.num_buckets) {
+            return false;
+          }
+        }
+      } else if (!visit(col_offset + 1)) {
+        return false;
       }
+      encoded.resize(prefix_len);
     }
-    encoded_strings.swap(new_encoded_strings);
-  }
-  for (const string& encoded_string : encoded_strings) {
-    uint32_t hash_value = PartitionSchema::HashValueForEncodedColumns(
-        encoded_string, hash_dimension);
-    hash_bucket_bitset[hash_value] = true;
-  }
+    return true;
+  };
+  visit(0);
   return hash_bucket_bitset;
 }
 
@@ -555,6 +585,77 @@ bool PartitionPruner::ShouldPrune(const Partition& partition) const {
   return true;
 }
 
+ColumnPredicate PartitionPruner::TrimInListForPartition(
+    const Schema& schema,
+    const PartitionSchema& partition_schema,
+    const Partition& partition,
+    const ScanSpec& scan_spec,
+    const ColumnPredicate& predicate) {
+  if (predicate.predicate_type() != PredicateType::InList) {
+    return predicate;
+  }
+  const int col_idx = schema.find_column(predicate.column().name());
+  if (col_idx == Schema::kColumnNotFound) {
+    return predicate;
+  }
+  const ColumnId column_id = schema.column_id(col_idx);
+  const KeyEncoder<string>& encoder = GetKeyEncoder<string>(predicate.column().type_info());
+  vector<const void*> values = predicate.raw_values();
+  string encoded;
+  const auto remove_values = [&](const std::function<bool(const string&)>& should_remove,
+                                 bool is_last) {
+    values.erase(std::remove_if(values.begin(), values.end(), [&](const void* value) {
+      encoded.clear();
+      encoder.Encode(value, is_last, &encoded);
+      return should_remove(encoded);
+    }), values.end());
+  };
+
+  // The hash buckets.
+  const auto& hash_schema =
+      partition_schema.GetHashSchemaForRange(partition.begin().range_key());
+  const auto& hash_buckets = partition.hash_buckets();
+  for (size_t i = 0; i < hash_schema.size() && i < hash_buckets.size(); i++) {
+    const auto& hash_dimension = hash_schema[i];
+    if (hash_dimension.column_ids.size() != 1 || hash_dimension.column_ids[0] != column_id) {
+      continue;
+    }
+    const uint32_t bucket = hash_buckets[i];
+    remove_values([&](const string& encoded_value) {
+      return PartitionSchema::HashValueForEncodedColumns(encoded_value, hash_dimension) != bucket;
+    }, /*is_last=*/true);
+  }
+
+  // The range bounds, if the column is the first range column.
+  const auto& range_column_ids = partition_schema.range_schema().column_ids;
+  if (!range_column_ids.empty() && range_column_ids[0] == column_id) {
+    const bool is_whole_key = range_column_ids.size() == 1;
+    const string& lower = partition.begin().range_key();
+    const string& upper = partition.end().range_key();
+    remove_values([&](const string& encoded_value) {
+      return !EncodedPrefixMayBeInRange(encoded_value, is_whole_key, lower, upper);
+    }, is_whole_key);
+  }
+
+  // The primary key bounds, if the column is the first primary key column.
+  if (col_idx == 0 &&
+      (scan_spec.lower_bound_key() || scan_spec.exclusive_upper_bound_key())) {
+    const bool is_whole_key = schema.num_key_columns() == 1;
+    const Slice lower = scan_spec.lower_bound_key() ?
+        scan_spec.lower_bound_key()->encoded_key() : Slice();
+    const Slice upper = scan_spec.exclusive_upper_bound_key() ?
+        scan_spec.exclusive_upper_bound_key()->encoded_key() : Slice();
+    remove_values([&](const string& encoded_value) {
+      return !EncodedPrefixMayBeInRange(encoded_value, is_whole_key, lower, upper);
+    }, is_whole_key);
+  }
+
+  if (values.empty() || values.size() == predicate.raw_values().size()) {
+    return predicate;
+  }
+  return ColumnPredicate::InList(predicate.column(), &values);
+}
+
 string PartitionPruner::ToString(const Schema& schema,
                                  const PartitionSchema& partition_schema) const {
   vector<string> strings;
@@ -26,6 +26,7 @@
 
 namespace kudu {
 
+class ColumnPredicate;
 class ScanSpec;
 class Schema;
 
@@ -58,6 +59,25 @@ class PartitionPruner {
   // Returns true if the provided partition should be pruned.
   bool ShouldPrune(const Partition& partition) const;
 
+  // Returns 'predicate', a predicate on a column of 'schema', with the values of
+  // its in-list which can't be in the rows of 'partition' scanned by 'scan_spec'
+  // removed. Those are the values which:
+  // - don't hash to the partition's bucket of a hash dimension, if the column
+  //   is the only column of the dimension;
+  // - are outside of the partition's range, if the column is the first range
+  //   partition column;
+  // - are outside of the primary key bounds of 'scan_spec', if the column is
+  //   the first primary key column.
+  //
+  // Predicates which aren't in-lists are returned as is, and so are in-lists
+  // which would be left without any values: the partition should have been
+  // pruned instead. The returned predicate refers to the values of 'predicate'.
+  static ColumnPredicate TrimInListForPartition(const Schema& schema,
+                                                const PartitionSchema& partition_schema,
+                                                const Partition& partition,
+                                                const ScanSpec& scan_spec,
+                                                const ColumnPredicate& predicate);
+
   // Returns the number of partition key ranges remaining in the scan.
   size_t NumRangesRemaining() const {
     size_t num_ranges = 0;
@@ -17,15 +17,20 @@
 
 #include "kudu/common/predicate_effectiveness.h"
 
+#include <algorithm>
+#include <numeric>
 #include <ostream>
+#include <string>
 
 #include <gflags/gflags.h>
 
 #include "kudu/common/iterator_stats.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/strings/join.h"
 #include "kudu/util/flag_tags.h"
 
 using std::pair;
+using std::string;
 using std::vector;
 
 DEFINE_bool(predicate_effectivess_enabled, true,
@@ -43,6 +48,17 @@ DEFINE_int32(predicate_effectivess_num_skip_blocks, 128,
 TAG_FLAG(predicate_effectivess_num_skip_blocks, advanced);
 TAG_FLAG(predicate_effectivess_num_skip_blocks, runtime);
 
+DEFINE_bool(predicate_reorder_enabled, true,
+            "Should scan iterators reorder the evaluation of column predicates based on "
+            "their observed selectivity and evaluation cost");
+TAG_FLAG(predicate_reorder_enabled, advanced);
+TAG_FLAG(predicate_reorder_enabled, runtime);
+
+DEFINE_int32(predicate_reorder_num_blocks, 16,
+             "Number of blocks to evaluate between reorderings of the column predicates");
+TAG_FLAG(predicate_reorder_num_blocks, advanced);
+TAG_FLAG(predicate_reorder_num_blocks, runtime);
+
 namespace kudu {
 
 bool IsColumnPredicateDisableable(PredicateType type) {
@@ -92,4 +108,81 @@ void IteratorPredicateEffectivenessContext::PopulateIteratorStatsWithDisabledPre
   }
 }
 
+void PredicateEvaluationOrder::Init(int num_predicates) {
+  next_block_count_ = 0;
+  order_.resize(num_predicates);
+  std::iota(order_.begin(), order_.end(), 0);
+  costs_.assign(num_predicates, PredicateCost());
+}
+
+bool PredicateEvaluationOrder::enabled() const {
+  // There's nothing to reorder with a single predicate.
+  return FLAGS_predicate_reorder_enabled && order_.size() > 1;
+}
+
+void PredicateEvaluationOrder::RecordEvaluation(int idx,
+                                                int64_t rows_rejected,
+                                                int64_t cost_nanos) {
+  DCHECK_GE(idx, 0);
+  DCHECK_LT(idx, costs_.size());
+  DCHECK_GE(rows_rejected, 0);
+  auto& cost = costs_[idx];
+  cost.rows_rejected += rows_rejected;
+  // Count at least a nanosecond, so that a predicate is never free.
+  cost.cost_nanos += std::max<int64_t>(cost_nanos, 1);
+  if (idx == order_[0]) {
+    cost.blocks_evaluated_first++;
+  }
+}
+
+bool PredicateEvaluationOrder::MaybeReorder() {
+  if (!enabled() || FLAGS_predicate_reorder_num_blocks <= 0 ||
+      (next_block_count_ % FLAGS_predicate_reorder_num_blocks) != 0) {
+    return false;
+  }
+
+  // Rank the predicates by the rows rejected per nanosecond. Predicates that weren't
+  // evaluated at all since the last reorder, because the earlier ones filtered out
+  // every row, rank last. The sort is stable so that ties keep the current order.
+  auto rank = [this](int idx) {
+    const auto& cost = costs_[idx];
+    return cost.cost_nanos == 0 ? 0.0 :
+        static_cast<double>(cost.rows_rejected) / cost.cost_nanos;
+  };
+  vector<int> new_order = order_;
+  std::stable_sort(new_order.begin(), new_order.end(),
+                   [&](int left, int right) { return rank(left) > rank(right); });
+  for (auto& cost : costs_) {
+    cost.rows_rejected /= 2;
+    cost.cost_nanos /= 2;
+  }
+  if (new_order == order_) {
+    return false;
+  }
+  order_ = std::move(new_order);
+  return true;
+}
+
+string PredicateEvaluationOrder::OrderToString(
+    const vector<pair<int32_t, ColumnPredicate>>& col_idx_predicates) const {
+  vector<string> preds;
+  preds.reserve(order_.size());
+  for (int idx : order_) {
+    preds.emplace_back(col_idx_predicates[idx].second.ToString());
+  }
+  return JoinStrings(preds, ", ");
+}
+
+void PredicateEvaluationOrder::PopulateIteratorStatsWithPredicateOrder(
+    const vector<pair<int32_t, ColumnPredicate>>& col_idx_predicates,
+    vector<IteratorStats>* stats) const {
+  DCHECK_EQ(costs_.size(), col_idx_predicates.size());
+  for (int pred_idx = 0; pred_idx < costs_.size(); pred_idx++) {
+    const auto& col_idx = col_idx_predicates[pred_idx].first;
+    DCHECK_LT(col_idx, stats->size());
+    (*stats)[col_idx].predicate_blocks_evaluated_first =
+        costs_[pred_idx].blocks_evaluated_first;
+  }
+}
+
 } // namespace kudu
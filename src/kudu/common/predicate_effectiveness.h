@@ -19,6 +19,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -107,6 +108,73 @@ class IteratorPredicateEffectivenessContext {
   std::unordered_map<int, PredicateEffectivenessContext> predicate_ctxs_;
 };
 
+// Per iterator context that adaptively orders the evaluation of the column predicates.
+//
+// Predicates start out in the static order chosen by the iterator (see
+// SelectivityComparator()). For every batch, the rows rejected by each predicate and
+// the time spent materializing and evaluating it are recorded. Every
+// FLAGS_predicate_reorder_num_blocks blocks the predicates are re-sorted by the number
+// of rows they reject per unit of time, so that cheap and selective predicates prune
+// the rows seen by expensive or unselective ones.
+//
+// Like with the effectiveness contexts, predicates are identified by their index in the
+// iterator's list of predicates.
+class PredicateEvaluationOrder {
+ public:
+  PredicateEvaluationOrder() : next_block_count_(0) {}
+
+  // Reset the order to evaluate predicates [0, num_predicates) in their index order.
+  void Init(int num_predicates);
+
+  // Whether the time spent on each predicate should be measured and recorded.
+  bool enabled() const;
+
+  // The indices of the predicates in the order they should be evaluated.
+  const std::vector<int>& order() const {
+    return order_;
+  }
+
+  void IncrementNextBlockCount() {
+    next_block_count_++;
+  }
+
+  // Record that predicate 'idx' rejected 'rows_rejected' rows of a batch, taking
+  // 'cost_nanos' to materialize (if applicable) and evaluate.
+  void RecordEvaluation(int idx, int64_t rows_rejected, int64_t cost_nanos);
+
+  // Re-sorts the predicates if enough blocks have been evaluated since the last time.
+  // Returns true if the order changed.
+  bool MaybeReorder();
+
+  // Returns a string listing the predicates in the order of evaluation, suitable for
+  // traces and logs.
+  std::string OrderToString(
+      const std::vector<std::pair<int32_t, ColumnPredicate>>& col_idx_predicates) const;
+
+  // Populate the output 'stats' vector with the number of blocks for which each
+  // column's predicate was evaluated first.
+  //
+  // Input 'col_idx_predicates' helps map predicate index to the table's column index.
+  void PopulateIteratorStatsWithPredicateOrder(
+      const std::vector<std::pair<int32_t, ColumnPredicate>>& col_idx_predicates,
+      std::vector<IteratorStats>* stats) const;
+
+ private:
+  struct PredicateCost {
+    // Rows rejected and nanoseconds spent since the last reorder, decayed by half on
+    // every reorder so that the order tracks changes in the data.
+    int64_t rows_rejected = 0;
+    int64_t cost_nanos = 0;
+    // Number of blocks for which the predicate was evaluated first.
+    int64_t blocks_evaluated_first = 0;
+  };
+
+  int next_block_count_;
+  std::vector<int> order_;
+  // Indexed by predicate index.
+  std::vector<PredicateCost> costs_;
+};
+
 // Gets the predicate effectiveness context associated with the iterator.
 //
 // Only for use by tests.
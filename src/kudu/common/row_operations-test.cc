@@ -1000,4 +1000,103 @@ TEST_F(RowOperationsTest, ExceedCellLimit) {
   }
 }
 
+// Test decoding columnar blocks, interleaved with row-wise operations.
+TEST_F(RowOperationsTest, TestColumnarBlocks) {
+  Schema client_schema({ ColumnSchema("key", INT32),
+                         ColumnSchema("int_val", INT32),
+                         ColumnSchema("string_val", STRING, true) },
+                       1);
+  auto set_offsets = [](const vector<uint32_t>& offsets, string* dst) {
+    dst->assign(reinterpret_cast<const char*>(offsets.data()),
+                offsets.size() * sizeof(uint32_t));
+  };
+  auto set_int32s = [](const vector<int32_t>& values, string* dst) {
+    dst->assign(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(int32_t));
+  };
+
+  RowOperationsPB pb;
+  RowOperationsPBEncoder enc(&pb);
+  KuduPartialRow row(&client_schema);
+  ASSERT_OK(row.SetInt32("key", 1));
+  ASSERT_OK(row.SetInt32("int_val", 10));
+  enc.Add(RowOperationsPB::INSERT, row);
+  ASSERT_OK(row.SetInt32("key", 3));
+  enc.Add(RowOperationsPB::UPSERT, row);
+
+  // Two rows, after the first row-wise operation. The second one's string
+  // is NULL.
+  ColumnarRowOperationsPB* block = pb.add_columnar_blocks();
+  block->set_type(RowOperationsPB::INSERT);
+  block->set_num_rows(2);
+  block->set_row_op_index(1);
+  set_int32s({ 2, 4 }, block->add_columns()->mutable_data());
+  set_int32s({ 20, 40 }, block->add_columns()->mutable_data());
+  auto* string_col = block->add_columns();
+  set_offsets({ 0, 5, 5 }, string_col->mutable_data());
+  string_col->set_varlen_data("hello");
+  string_col->set_non_null_bitmap(string(1, '\x01'));
+
+  vector<DecodedRowOperation> ops;
+  {
+    RowOperationsPBDecoder dec(&pb, &client_schema, &schema_, &arena_);
+    ASSERT_OK(dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops));
+  }
+  ASSERT_EQ(4, ops.size());
+  EXPECT_EQ("INSERT (int32 key=1, int32 int_val=10, string string_val=NULL)",
+            ops[0].ToString(schema_));
+  EXPECT_EQ(R"(INSERT (int32 key=2, int32 int_val=20, string string_val="hello"))",
+            ops[1].ToString(schema_));
+  EXPECT_EQ("INSERT (int32 key=4, int32 int_val=40, string string_val=NULL)",
+            ops[2].ToString(schema_));
+  EXPECT_EQ("UPSERT (int32 key=3, int32 int_val=10, string string_val=NULL)",
+            ops[3].ToString(schema_));
+
+  // A NULL value in a non-nullable column is an error for its row only.
+  block->mutable_columns(1)->set_non_null_bitmap(string(1, '\x02'));
+  ops.clear();
+  {
+    RowOperationsPBDecoder dec(&pb, &client_schema, &schema_, &arena_);
+    ASSERT_OK(dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops));
+  }
+  ASSERT_EQ(4, ops.size());
+  EXPECT_EQ("row error: Invalid argument: NULL values not allowed for non-nullable column: "
+            "int_val INT32 NOT NULL",
+            ops[1].ToString(schema_));
+  EXPECT_TRUE(ops[2].result.ok());
+
+  // Offsets past the end of the data are rejected.
+  set_offsets({ 0, 5, 6 }, string_col->mutable_data());
+  ops.clear();
+  {
+    RowOperationsPBDecoder dec(&pb, &client_schema, &schema_, &arena_);
+    Status s = dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+
+  // So are columnar blocks of split rows.
+  ops.clear();
+  {
+    RowOperationsPBDecoder dec(&pb, &client_schema, &schema_, &arena_);
+    Status s = dec.DecodeOperations<DecoderMode::SPLIT_ROWS>(&ops);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+
+  // So are numbers of rows for which the sizes of the columns overflow: here,
+  // they'd match the sizes of empty columns and of a single string offset.
+  RowOperationsPB overflow_pb;
+  block = overflow_pb.add_columnar_blocks();
+  block->set_type(RowOperationsPB::INSERT);
+  block->set_num_rows(1LL << 62);
+  block->add_columns();
+  block->add_columns();
+  set_offsets({ 0 }, block->add_columns()->mutable_data());
+  ops.clear();
+  {
+    RowOperationsPBDecoder dec(&overflow_pb, &client_schema, &schema_, &arena_);
+    Status s = dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+}
+
 } // namespace kudu
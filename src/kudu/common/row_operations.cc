@@ -18,6 +18,7 @@
 #include "kudu/common/row_operations.h"
 
 #include <cstring>
+#include <limits>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -76,6 +77,13 @@ string DecodedRowOperation::ToString(const Schema& schema) const {
       return Substitute("MUTATE $0 $1",
                         schema.DebugRowKey(ConstContiguousRow(&schema, row_data)),
                         changelist.ToString(schema));
+    case RowOperationsPB::DELETE_RANGE: {
+      const auto bound_to_string = [&](const uint8_t* key) -> string {
+        return key ? schema.DebugRowKey(ConstContiguousRow(&schema, key)) : "<unbounded>";
+      };
+      return Substitute("DELETE_RANGE [$0, $1)",
+                        bound_to_string(row_data), bound_to_string(range_upper_bound));
+    }
     case RowOperationsPB::SPLIT_ROW:
       return Substitute("SPLIT_ROW $0", KUDU_DISABLE_REDACTION(split_row->ToString()));
     case RowOperationsPB::RANGE_LOWER_BOUND:
@@ -492,6 +500,141 @@ Status RowOperationsPBDecoder::DecodeInsertOrUpsert(const uint8_t* prototype_row
   return Status::OK();
 }
 
+Status RowOperationsPBDecoder::DecodeColumnarBlock(const ColumnarRowOperationsPB& block,
+                                                   const uint8_t* prototype_row_storage,
+                                                   const ClientServerMapping& mapping,
+                                                   vector<DecodedRowOperation>* ops) {
+  switch (block.type()) {
+    case RowOperationsPB::INSERT:
+    case RowOperationsPB::INSERT_IGNORE:
+    case RowOperationsPB::UPSERT:
+      break;
+    default:
+      return Status::InvalidArgument(Substitute("Invalid columnar write operation type $0",
+                                                RowOperationsPB_Type_Name(block.type())));
+  }
+  const int64_t num_rows = block.num_rows();
+  if (PREDICT_FALSE(num_rows < 0)) {
+    return Status::Corruption("Bad number of rows in columnar block");
+  }
+  if (PREDICT_FALSE(block.columns_size() != client_schema_->num_columns())) {
+    return Status::InvalidArgument(Substitute(
+        "Columnar block has $0 columns, but the client schema has $1",
+        block.columns_size(), client_schema_->num_columns()));
+  }
+
+  // Validate all of the columns up front, so the cells can be copied without
+  // further checks.
+  for (size_t client_col_idx = 0;
+       client_col_idx < client_schema_->num_columns();
+       client_col_idx++) {
+    const ColumnSchema& col = client_schema_->column(client_col_idx);
+    const auto& pb_col = block.columns(client_col_idx);
+    // Every column has at least one byte of data per row. Bounding the number
+    // of rows by it first keeps the sizes computed below from overflowing.
+    if (PREDICT_FALSE(static_cast<size_t>(num_rows) > pb_col.data().size())) {
+      return Status::Corruption("Bad number of rows in columnar block", col.ToString());
+    }
+    if (PREDICT_FALSE(pb_col.has_non_null_bitmap() &&
+                      pb_col.non_null_bitmap().size() < BitmapSize(num_rows))) {
+      return Status::Corruption("Not enough data for non-null bitmap", col.ToString());
+    }
+    if (col.type_info()->physical_type() != BINARY) {
+      if (PREDICT_FALSE(pb_col.data().size() != num_rows * col.type_info()->size())) {
+        return Status::Corruption("Bad amount of data for column", col.ToString());
+      }
+      continue;
+    }
+    if (PREDICT_FALSE(pb_col.data().size() != (num_rows + 1) * sizeof(uint32_t))) {
+      return Status::Corruption("Bad number of offsets for column", col.ToString());
+    }
+    const char* offsets = pb_col.data().data();
+    uint32_t prev = 0;
+    for (int64_t i = 0; i <= num_rows; i++) {
+      uint32_t offset = UnalignedLoad<uint32_t>(offsets + i * sizeof(uint32_t));
+      if (PREDICT_FALSE(offset < prev || offset > pb_col.varlen_data().size())) {
+        return Status::Corruption("Bad offset for column", col.ToString());
+      }
+      prev = offset;
+    }
+  }
+
+  // Every row specifies all of the client's columns, so they share the isset
+  // bitmap.
+  auto tablet_isset_bitmap = reinterpret_cast<uint8_t*>(
+      dst_arena_->AllocateBytes(BitmapSize(tablet_schema_->num_columns())));
+  if (PREDICT_FALSE(!tablet_isset_bitmap)) {
+    return Status::RuntimeError("Out of memory");
+  }
+  BitmapChangeBits(tablet_isset_bitmap, 0, tablet_schema_->num_columns(), false);
+  for (size_t client_col_idx = 0;
+       client_col_idx < client_schema_->num_columns();
+       client_col_idx++) {
+    BitmapSet(tablet_isset_bitmap, GetTabletColIdx(mapping, client_col_idx));
+  }
+
+  const size_t first_op = ops->size();
+  ops->resize(first_op + num_rows);
+  for (int64_t i = 0; i < num_rows; i++) {
+    auto tablet_row_storage = reinterpret_cast<uint8_t*>(
+        dst_arena_->AllocateBytesAligned(tablet_row_size_, 8));
+    if (PREDICT_FALSE(!tablet_row_storage)) {
+      return Status::RuntimeError("Out of memory");
+    }
+    memcpy(tablet_row_storage, prototype_row_storage, tablet_row_size_);
+    DecodedRowOperation* op = &(*ops)[first_op + i];
+    op->type = block.type();
+    op->row_data = tablet_row_storage;
+    op->isset_bitmap = tablet_isset_bitmap;
+  }
+
+  // Copy the cells a column at a time.
+  for (size_t client_col_idx = 0;
+       client_col_idx < client_schema_->num_columns();
+       client_col_idx++) {
+    size_t tablet_col_idx = GetTabletColIdx(mapping, client_col_idx);
+    const ColumnSchema& col = tablet_schema_->column(tablet_col_idx);
+    const auto& pb_col = block.columns(client_col_idx);
+    const bool is_binary = col.type_info()->physical_type() == BINARY;
+    const size_t size = col.type_info()->size();
+    const auto* data = reinterpret_cast<const uint8_t*>(pb_col.data().data());
+    const auto* varlen_data = reinterpret_cast<const uint8_t*>(pb_col.varlen_data().data());
+    const auto* non_null_bitmap = pb_col.has_non_null_bitmap() ?
+        reinterpret_cast<const uint8_t*>(pb_col.non_null_bitmap().data()) : nullptr;
+
+    for (int64_t i = 0; i < num_rows; i++) {
+      DecodedRowOperation* op = &(*ops)[first_op + i];
+      ContiguousRow tablet_row(tablet_schema_, const_cast<uint8_t*>(op->row_data));
+      bool is_null = non_null_bitmap && !BitmapTest(non_null_bitmap, i);
+      if (col.is_nullable()) {
+        tablet_row.set_null(tablet_col_idx, is_null);
+      }
+      if (PREDICT_FALSE(is_null)) {
+        if (!col.is_nullable()) {
+          op->SetFailureStatusOnce(Status::InvalidArgument(
+              "NULL values not allowed for non-nullable column", col.ToString()));
+        }
+        continue;
+      }
+      uint8_t* dst = tablet_row.mutable_cell_ptr(tablet_col_idx);
+      if (!is_binary) {
+        memcpy(dst, data + i * size, size);
+        continue;
+      }
+      uint32_t start = UnalignedLoad<uint32_t>(data + i * sizeof(uint32_t));
+      uint32_t end = UnalignedLoad<uint32_t>(data + (i + 1) * sizeof(uint32_t));
+      Slice cell(varlen_data + start, end - start);
+      if (PREDICT_FALSE(cell.size() > FLAGS_max_cell_size_bytes)) {
+        op->SetFailureStatusOnce(Status::InvalidArgument(Substitute(
+            "value too large for column '$0' ($1 bytes, maximum is $2 bytes)",
+            col.name(), cell.size(), FLAGS_max_cell_size_bytes)));
+      }
+      memcpy(dst, &cell, sizeof(cell));
+    }
+  }
+  return Status::OK();
+}
+
 Status RowOperationsPBDecoder::DecodeUpdateOrDelete(const ClientServerMapping& mapping,
                                                     DecodedRowOperation* op) {
   size_t rowkey_size = tablet_schema_->key_byte_size();
@@ -624,6 +767,88 @@ Status RowOperationsPBDecoder::DecodeUpdateOrDelete(const ClientServerMapping& m
   return Status::OK();
 }
 
+Status RowOperationsPBDecoder::DecodeRangeDeleteBound(const ClientServerMapping& mapping,
+                                                      DecodedRowOperation* op,
+                                                      const uint8_t** key) {
+  const uint8_t* client_isset_map = nullptr;
+  const uint8_t* client_null_map = nullptr;
+  RETURN_NOT_OK(ReadIssetBitmap(&client_isset_map));
+  if (client_schema_->has_nullables()) {
+    RETURN_NOT_OK(ReadNullBitmap(&client_null_map));
+  }
+
+  size_t num_key_cols_set = 0;
+  for (size_t i = 0; i < client_schema_->num_key_columns(); i++) {
+    num_key_cols_set += BitmapTest(client_isset_map, i);
+  }
+  uint8_t* rowkey_storage = nullptr;
+  if (num_key_cols_set == client_schema_->num_key_columns()) {
+    rowkey_storage = reinterpret_cast<uint8_t*>(
+        dst_arena_->AllocateBytesAligned(tablet_schema_->key_byte_size(), 8));
+    if (PREDICT_FALSE(!rowkey_storage)) {
+      return Status::RuntimeError("Out of memory");
+    }
+  } else if (num_key_cols_set > 0) {
+    op->SetFailureStatusOnce(Status::InvalidArgument(
+        "range bounds must set either all of the key columns or none of them"));
+  }
+  ContiguousRow rowkey(tablet_schema_, rowkey_storage);
+
+  // Consume the data of all of the columns set, even if they're invalid, so
+  // that the following operations are decoded properly.
+  for (size_t client_col_idx = 0;
+       client_col_idx < client_schema_->num_columns();
+       client_col_idx++) {
+    if (!BitmapTest(client_isset_map, client_col_idx)) {
+      continue;
+    }
+    size_t tablet_col_idx = GetTabletColIdx(mapping, client_col_idx);
+    const ColumnSchema& col = tablet_schema_->column(tablet_col_idx);
+    bool is_key = client_col_idx < client_schema_->num_key_columns();
+    bool client_set_to_null = client_schema_->has_nullables() &&
+      BitmapTest(client_null_map, client_col_idx);
+    if (PREDICT_FALSE(!is_key)) {
+      op->SetFailureStatusOnce(Status::InvalidArgument(
+          "range bounds should not have a value for column", col.ToString()));
+    } else if (PREDICT_FALSE(client_set_to_null)) {
+      op->SetFailureStatusOnce(Status::InvalidArgument(
+          "NULL values not allowed for key column", col.ToString()));
+    }
+    if (client_set_to_null && col.is_nullable()) {
+      continue;
+    }
+    if (is_key && rowkey_storage && !client_set_to_null) {
+      RETURN_NOT_OK(ReadColumn(col, rowkey.mutable_cell_ptr(tablet_col_idx), nullptr));
+    } else {
+      RETURN_NOT_OK(ReadColumnAndDiscard(col));
+    }
+  }
+  *key = rowkey_storage;
+  return Status::OK();
+}
+
+Status RowOperationsPBDecoder::DecodeDeleteRange(const ClientServerMapping& mapping,
+                                                 DecodedRowOperation* op) {
+  const uint8_t* lower_bound = nullptr;
+  RETURN_NOT_OK(DecodeRangeDeleteBound(mapping, op, &lower_bound));
+
+  RowOperationsPB::Type type = RowOperationsPB::UNKNOWN;
+  if (PREDICT_TRUE(HasNext())) {
+    RETURN_NOT_OK(ReadOpType(&type));
+  }
+  if (PREDICT_FALSE(type != RowOperationsPB::RANGE_UPPER_BOUND)) {
+    return Status::InvalidArgument(Substitute(
+        "DELETE_RANGE must be followed by a RANGE_UPPER_BOUND, not $0",
+        RowOperationsPB_Type_Name(type)));
+  }
+  const uint8_t* upper_bound = nullptr;
+  RETURN_NOT_OK(DecodeRangeDeleteBound(mapping, op, &upper_bound));
+
+  op->row_data = lower_bound;
+  op->range_upper_bound = upper_bound;
+  return Status::OK();
+}
+
 Status RowOperationsPBDecoder::DecodeSplitRow(const ClientServerMapping& mapping,
                                               DecodedRowOperation* op) {
   op->split_row.reset(new KuduPartialRow(tablet_schema_));
@@ -688,7 +913,32 @@ Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops
   ContiguousRow prototype_row(tablet_schema_, prototype_row_storage);
   SetupPrototypeRow(*tablet_schema_, &prototype_row);
 
+  if (mode == DecoderMode::SPLIT_ROWS && pb_->columnar_blocks_size() > 0) {
+    return Status::InvalidArgument("Columnar blocks are only supported for write operations");
+  }
+
+  // The columnar blocks are interleaved with the row-wise operations, each
+  // block coming after the number of row-wise operations it specifies.
+  int next_block = 0;
+  int64_t num_row_ops = 0;
+  auto decode_blocks_up_to = [&](int64_t row_op_index) {
+    for (; next_block < pb_->columnar_blocks_size(); next_block++) {
+      const auto& block = pb_->columnar_blocks(next_block);
+      if (block.row_op_index() > row_op_index) {
+        break;
+      }
+      if (PREDICT_FALSE(next_block > 0 &&
+                        block.row_op_index() <
+                        pb_->columnar_blocks(next_block - 1).row_op_index())) {
+        return Status::Corruption("Columnar blocks out of order");
+      }
+      RETURN_NOT_OK(DecodeColumnarBlock(block, prototype_row_storage, mapping, ops));
+    }
+    return Status::OK();
+  };
+
   while (HasNext()) {
+    RETURN_NOT_OK(decode_blocks_up_to(num_row_ops));
     RowOperationsPB::Type type = RowOperationsPB::UNKNOWN;
     RETURN_NOT_OK(ReadOpType(&type));
     DecodedRowOperation op;
@@ -696,7 +946,9 @@ Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops
 
     RETURN_NOT_OK(DecodeOp<mode>(type, prototype_row_storage, mapping, &op));
     ops->push_back(op);
+    num_row_ops++;
   }
+  RETURN_NOT_OK(decode_blocks_up_to(std::numeric_limits<int64_t>::max()));
 
   return Status::OK();
 }
@@ -719,6 +971,9 @@ Status RowOperationsPBDecoder::DecodeOp<DecoderMode::WRITE_OPS>(
     case RowOperationsPB::DELETE_IGNORE:
       RETURN_NOT_OK(DecodeUpdateOrDelete(mapping, op));
       break;
+    case RowOperationsPB::DELETE_RANGE:
+      RETURN_NOT_OK(DecodeDeleteRange(mapping, op));
+      break;
     default:
       return Status::InvalidArgument(Substitute("Invalid write operation type $0",
                                                 RowOperationsPB_Type_Name(type)));
@@ -77,8 +77,14 @@ struct DecodedRowOperation {
 
   // For INSERT, INSERT_IGNORE, or UPSERT, the whole projected row.
   // For UPDATE, UPDATE_IGNORE, DELETE, or DELETE_IGNORE, the row key.
+  // For DELETE_RANGE, the row key of the inclusive lower bound of the range,
+  // or nullptr if unbounded.
   const uint8_t* row_data;
 
+  // For DELETE_RANGE, the row key of the exclusive upper bound of the range,
+  // or nullptr if unbounded.
+  const uint8_t* range_upper_bound = nullptr;
+
   // For INSERT or UPDATE, a bitmap indicating which of the cells were
   // explicitly set by the client, versus being filled-in defaults.
   // A set bit indicates that the client explicitly set the cell.
@@ -144,6 +150,14 @@ class RowOperationsPBDecoder {
   Status DecodeInsertOrUpsert(const uint8_t* prototype_row_storage,
                               const ClientServerMapping& mapping,
                               DecodedRowOperation* op);
+
+  // Decode the operations of a columnar block, appending them to 'ops'.
+  // Returns an error if the block is malformed; errors specific to a row
+  // (e.g. a NULL value in a non-nullable column) are set as its result.
+  Status DecodeColumnarBlock(const ColumnarRowOperationsPB& block,
+                             const uint8_t* prototype_row_storage,
+                             const ClientServerMapping& mapping,
+                             std::vector<DecodedRowOperation>* ops);
   //------------------------------------------------------------
   // Serialization/deserialization support
   //------------------------------------------------------------
@@ -152,6 +166,17 @@ class RowOperationsPBDecoder {
   Status DecodeUpdateOrDelete(const ClientServerMapping& mapping,
                               DecodedRowOperation* op);
 
+  // Decode the next encoded operation, which must be DELETE_RANGE, along with
+  // the RANGE_UPPER_BOUND which must follow it.
+  Status DecodeDeleteRange(const ClientServerMapping& mapping,
+                           DecodedRowOperation* op);
+
+  // Decode the key of a bound of a DELETE_RANGE operation into 'key', which
+  // is set to nullptr if the bound has no column set, i.e. is unbounded.
+  Status DecodeRangeDeleteBound(const ClientServerMapping& mapping,
+                                DecodedRowOperation* op,
+                                const uint8_t** key);
+
   // Decode the next encoded operation, which must be SPLIT_KEY.
   Status DecodeSplitRow(const ClientServerMapping& mapping,
                         DecodedRowOperation* op);
@@ -216,6 +216,13 @@ class SelectionVectorView {
     DCHECK_LE(row_idx, sel_vec_->nrows() - row_offset_);
     return BitmapTest(sel_vec_->bitmap(), row_offset_ + row_idx);
   }
+  // Returns true if any of the "nrows" rows from the supplied "offset" in the
+  // current view are selected.
+  bool AnySelected(size_t nrows, size_t offset = 0) const {
+    DCHECK_LE(offset + nrows, sel_vec_->nrows() - row_offset_);
+    return !BitmapIsAllZero(sel_vec_->bitmap(), row_offset_ + offset,
+                            row_offset_ + offset + nrows);
+  }
   // Clear "nrows" bits from the supplied "offset" in the current view.
   void ClearBits(size_t nrows, size_t offset = 0) {
     DCHECK_LE(offset + nrows, sel_vec_->nrows() - row_offset_);
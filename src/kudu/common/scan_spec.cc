@@ -29,6 +29,8 @@
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
+#include "kudu/common/column_aggregate.h"
+#include "kudu/common/column_expression.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/key_util.h"
@@ -143,9 +145,25 @@ string ScanSpec::ToString(const Schema& schema) const {
       preds.push_back(predicate->ToString());
     }
   }
+  for (const auto& expr : expression_predicates_) {
+    preds.push_back(expr->ToString());
+  }
 
+  string aggs;
+  if (!aggregates_.empty()) {
+    vector<string> agg_strs;
+    for (const auto& aggregate : aggregates_) {
+      agg_strs.push_back(aggregate.ToString());
+    }
+    aggs = Substitute(" AGGREGATE $0", JoinStrings(agg_strs, ", "));
+  }
+  if (!group_by_columns_.empty()) {
+    aggs += Substitute(" GROUP BY $0", JoinMapped(group_by_columns_, [](const ColumnSchema& col) {
+      return col.name();
+    }, ", "));
+  }
   const string limit = has_limit() ? Substitute(" LIMIT $0", *limit_) : "";
-  return JoinStrings(preds, " AND ") + limit;
+  return JoinStrings(preds, " AND ") + aggs + limit;
 }
 
 void ScanSpec::OptimizeScan(const Schema& schema,
@@ -222,6 +240,35 @@ vector<ColumnSchema> ScanSpec::GetMissingColumns(const Schema& projection) {
       InsertOrDie(&missing_col_names, column_name);
     }
   }
+  for (const auto& aggregate : aggregates_) {
+    if (!aggregate.column()) {
+      continue;
+    }
+    const auto& column_name = aggregate.column()->name();
+    if (projection.find_column(column_name) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, column_name)) {
+      missing_cols.push_back(*aggregate.column());
+      InsertOrDie(&missing_col_names, column_name);
+    }
+  }
+  for (const auto& col : group_by_columns_) {
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, col.name())) {
+      missing_cols.push_back(col);
+      InsertOrDie(&missing_col_names, col.name());
+    }
+  }
+  for (const auto& expr : expression_predicates_) {
+    vector<ColumnSchema> expr_cols;
+    expr->GetColumns(&expr_cols);
+    for (auto& col : expr_cols) {
+      if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+          !ContainsKey(missing_col_names, col.name())) {
+        InsertOrDie(&missing_col_names, col.name());
+        missing_cols.emplace_back(std::move(col));
+      }
+    }
+  }
   return missing_cols;
 }
 
@@ -17,13 +17,17 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
+#include "kudu/common/column_aggregate.h" // IWYU pragma: keep
+#include "kudu/common/column_expression.h" // IWYU pragma: keep
 #include "kudu/common/column_predicate.h" // IWYU pragma: keep
 #include "kudu/common/partition.h"
 
@@ -90,7 +94,55 @@ class ScanSpec {
                                    const Partition& partition,
                                    const PartitionSchema& partition_schema);
 
-  // Get columns that are present in the predicates but not in the projection
+  // Add an aggregate to be computed over the rows selected by the scan.
+  //
+  // Aggregates are reported in the order they were added.
+  void AddAggregate(ColumnAggregate aggregate) {
+    aggregates_.emplace_back(std::move(aggregate));
+  }
+
+  // Returns the scan aggregates.
+  const std::vector<ColumnAggregate>& aggregates() const {
+    return aggregates_;
+  }
+
+  bool has_aggregates() const {
+    return !aggregates_.empty();
+  }
+
+  // Add a column by which the rows are grouped before being aggregated.
+  // Only meaningful for scans with aggregates.
+  void AddGroupByColumn(ColumnSchema column) {
+    group_by_columns_.emplace_back(std::move(column));
+  }
+
+  // Returns the group-by columns, in the order they were added.
+  const std::vector<ColumnSchema>& group_by_columns() const {
+    return group_by_columns_;
+  }
+
+  // Add a predicate on an expression over the columns, which must be of type
+  // BOOL: only the rows for which it is true are selected.
+  //
+  // Unlike column predicates, expression predicates are neither merged nor
+  // pushed into the key bounds or the decoders; they are evaluated over the
+  // rows which match the column predicates.
+  void AddExpressionPredicate(std::shared_ptr<const ColumnExpression> expr) {
+    DCHECK_EQ(ColumnExpression::BOOL, expr->type());
+    expression_predicates_.emplace_back(std::move(expr));
+  }
+
+  // Removes all expression predicates.
+  void RemoveExpressionPredicates() {
+    expression_predicates_.clear();
+  }
+
+  const std::vector<std::shared_ptr<const ColumnExpression>>& expression_predicates() const {
+    return expression_predicates_;
+  }
+
+  // Get columns that are present in the predicates, aggregates or group-by
+  // columns but not in the projection
   std::vector<ColumnSchema> GetMissingColumns(const Schema& projection);
 
   // Set the lower bound (inclusive) primary key for the scan.
@@ -178,6 +230,9 @@ class ScanSpec {
                                           bool remove_pushed_predicates);
 
   std::unordered_map<std::string, ColumnPredicate> predicates_;
+  std::vector<ColumnAggregate> aggregates_;
+  std::vector<ColumnSchema> group_by_columns_;
+  std::vector<std::shared_ptr<const ColumnExpression>> expression_predicates_;
   const EncodedKey* lower_bound_key_;
   const EncodedKey* exclusive_upper_bound_key_;
   PartitionKey lower_bound_partition_key_;
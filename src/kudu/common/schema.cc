@@ -108,11 +108,14 @@ string ColumnTypeAttributes::ToStringForType(DataType type) const {
 }
 
 string ColumnStorageAttributes::ToString() const {
+  const string compression_level_str =
+      compression_level == 0 ? "" : Substitute("($0)", compression_level);
   const string cfile_block_size_str =
       cfile_block_size == 0 ? "" : Substitute(" $0", cfile_block_size);
-  return Substitute("$0 $1$2",
+  return Substitute("$0 $1$2$3",
                     EncodingType_Name(encoding),
                     CompressionType_Name(compression),
+                    compression_level_str,
                     cfile_block_size_str);
 }
 
@@ -147,6 +150,9 @@ Status ColumnSchema::ApplyDelta(const ColumnSchemaDelta& col_delta) {
   if (col_delta.compression) {
     attributes_.compression = *col_delta.compression;
   }
+  if (col_delta.compression_level) {
+    attributes_.compression_level = *col_delta.compression_level;
+  }
   if (col_delta.cfile_block_size) {
     attributes_.cfile_block_size = *col_delta.cfile_block_size;
   }
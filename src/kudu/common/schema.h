@@ -147,12 +147,14 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
+      compression_level(0),
       cfile_block_size(0) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
+      compression_level(0),
       cfile_block_size(0) {
   }
 
@@ -162,6 +164,10 @@ struct ColumnStorageAttributes {
   EncodingType encoding;
   CompressionType compression;
 
+  // The level at which to compress cfile blocks, for codecs which support
+  // levels. If 0, uses the codec's server-wide default.
+  int32_t compression_level;
+
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
@@ -195,6 +201,7 @@ public:
 
   boost::optional<EncodingType> encoding;
   boost::optional<CompressionType> compression;
+  boost::optional<int32_t> compression_level;
   boost::optional<int32_t> cfile_block_size;
 
   boost::optional<std::string> new_comment;
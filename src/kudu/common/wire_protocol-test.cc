@@ -757,6 +757,24 @@ TEST_F(WireProtocolTest, TestColumnDefaultValue) {
   ASSERT_EQ(write_default_u32, *static_cast<const uint32_t *>(col5fpb->write_default_value()));
 }
 
+TEST_F(WireProtocolTest, TestColumnCompressionLevel) {
+  ColumnStorageAttributes attrs(AUTO_ENCODING, ZSTD);
+  ColumnSchema col("col", STRING, false, nullptr, nullptr, attrs);
+  ColumnSchemaPB pb;
+  ColumnSchemaToPB(col, &pb);
+  // The default level isn't sent over the wire.
+  ASSERT_FALSE(pb.has_compression_level());
+
+  attrs.compression_level = 9;
+  col = ColumnSchema("col", STRING, false, nullptr, nullptr, attrs);
+  ColumnSchemaToPB(col, &pb);
+  ASSERT_EQ(9, pb.compression_level());
+  boost::optional<ColumnSchema> colfpb;
+  ASSERT_OK(ColumnSchemaFromPB(pb, &colfpb));
+  ASSERT_EQ(ZSTD, colfpb->attributes().compression);
+  ASSERT_EQ(9, colfpb->attributes().compression_level);
+}
+
 // Regression test for KUDU-2378; the call to ColumnSchemaFromPB yielded a crash.
 TEST_F(WireProtocolTest, TestCrashOnAlignedLoadOf128BitReadDefault) {
   ColumnSchemaPB pb;
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_set>
@@ -32,6 +33,8 @@
 #include <google/protobuf/map.h>
 #include <google/protobuf/stubs/common.h>
 
+#include "kudu/common/column_aggregate.h"
+#include "kudu/common/column_expression.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
@@ -69,6 +72,7 @@ using google::protobuf::RepeatedPtrField;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
 using std::map;
+using std::shared_ptr;
 using std::string;
 using std::unordered_set;
 using std::vector;
@@ -243,6 +247,9 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
   if (!(flags & SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES)) {
     pb->set_encoding(col_schema.attributes().encoding);
     pb->set_compression(col_schema.attributes().compression);
+    if (col_schema.attributes().compression_level != 0) {
+      pb->set_compression_level(col_schema.attributes().compression_level);
+    }
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
   }
   if (col_schema.has_read_default()) {
@@ -322,6 +329,9 @@ Status ColumnSchemaFromPB(const ColumnSchemaPB& pb, boost::optional<ColumnSchema
   if (pb.has_compression()) {
     attributes.compression = pb.compression();
   }
+  if (pb.has_compression_level()) {
+    attributes.compression_level = pb.compression_level();
+  }
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
@@ -355,6 +365,9 @@ void ColumnSchemaDeltaToPB(const ColumnSchemaDelta& col_delta, ColumnSchemaDelta
   if (col_delta.compression) {
     pb->set_compression(*col_delta.compression);
   }
+  if (col_delta.compression_level) {
+    pb->set_compression_level(*col_delta.compression_level);
+  }
   if (col_delta.cfile_block_size) {
     pb->set_block_size(*col_delta.cfile_block_size);
   }
@@ -380,6 +393,9 @@ ColumnSchemaDelta ColumnSchemaDeltaFromPB(const ColumnSchemaDeltaPB& pb) {
   if (pb.has_compression()) {
     col_delta.compression = boost::optional<CompressionType>(pb.compression());
   }
+  if (pb.has_compression_level()) {
+    col_delta.compression_level = boost::optional<int32_t>(pb.compression_level());
+  }
   if (pb.has_block_size()) {
     col_delta.cfile_block_size = boost::optional<int32_t>(pb.block_size());
   }
@@ -651,6 +667,108 @@ Status ColumnPredicateFromPB(const Schema& schema,
   return Status::OK();
 }
 
+void ColumnAggregateToPB(const ColumnAggregate& aggregate, ColumnAggregatePB* pb) {
+  pb->set_type(aggregate.type());
+  if (aggregate.column()) {
+    pb->set_column(aggregate.column()->name());
+  }
+}
+
+Status ColumnAggregateFromPB(const Schema& schema,
+                             const ColumnAggregatePB& pb,
+                             boost::optional<ColumnAggregate>* aggregate) {
+  if (!pb.has_type() || pb.type() == ColumnAggregatePB::UNKNOWN) {
+    return Status::InvalidArgument("Column aggregate must include a type", SecureDebugString(pb));
+  }
+  if (!pb.has_column()) {
+    if (pb.type() != ColumnAggregatePB::COUNT) {
+      return Status::InvalidArgument("Column aggregate must include a column",
+                                     SecureDebugString(pb));
+    }
+    *aggregate = ColumnAggregate::CountAll();
+    return Status::OK();
+  }
+  int32_t idx = schema.find_column(pb.column());
+  if (idx == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("unknown column in aggregate", SecureDebugString(pb));
+  }
+  return ColumnAggregate::Create(pb.type(), schema.column(idx), aggregate);
+}
+
+void ColumnExpressionToPB(const ColumnExpression& expr, ColumnExpressionPB* pb) {
+  pb->set_op(expr.op());
+  switch (expr.op()) {
+    case ColumnExpressionPB::COLUMN:
+      pb->set_column(expr.column()->name());
+      break;
+    case ColumnExpressionPB::LITERAL:
+      switch (expr.type()) {
+        case ColumnExpression::BOOL:
+          pb->set_bool_value(expr.int_value() != 0);
+          break;
+        case ColumnExpression::INT64:
+          pb->set_int64_value(expr.int_value());
+          break;
+        case ColumnExpression::DOUBLE:
+          pb->set_double_value(expr.double_value());
+          break;
+        case ColumnExpression::STRING:
+          pb->set_string_value(expr.string_value());
+          break;
+      }
+      break;
+    default:
+      for (const auto& arg : expr.args()) {
+        ColumnExpressionToPB(*arg, pb->add_args());
+      }
+      break;
+  }
+}
+
+Status ColumnExpressionFromPB(const Schema& schema,
+                              const ColumnExpressionPB& pb,
+                              shared_ptr<const ColumnExpression>* expr) {
+  switch (pb.op()) {
+    case ColumnExpressionPB::COLUMN: {
+      int32_t idx = schema.find_column(pb.column());
+      if (idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("unknown column in expression", SecureDebugString(pb));
+      }
+      return ColumnExpression::Column(schema.column(idx), expr);
+    }
+    case ColumnExpressionPB::LITERAL:
+      switch (pb.literal_case()) {
+        case ColumnExpressionPB::kBoolValue:
+          *expr = ColumnExpression::BoolLiteral(pb.bool_value());
+          return Status::OK();
+        case ColumnExpressionPB::kInt64Value:
+          *expr = ColumnExpression::Int64Literal(pb.int64_value());
+          return Status::OK();
+        case ColumnExpressionPB::kDoubleValue:
+          *expr = ColumnExpression::DoubleLiteral(pb.double_value());
+          return Status::OK();
+        case ColumnExpressionPB::kStringValue:
+          *expr = ColumnExpression::StringLiteral(pb.string_value());
+          return Status::OK();
+        default:
+          return Status::InvalidArgument("Literal expression must include a value",
+                                         SecureDebugString(pb));
+      }
+    case ColumnExpressionPB::UNKNOWN:
+      return Status::InvalidArgument("Column expression must include an operator",
+                                     SecureDebugString(pb));
+    default: {
+      vector<shared_ptr<const ColumnExpression>> args;
+      for (const auto& arg_pb : pb.args()) {
+        shared_ptr<const ColumnExpression> arg;
+        RETURN_NOT_OK(ColumnExpressionFromPB(schema, arg_pb, &arg));
+        args.emplace_back(std::move(arg));
+      }
+      return ColumnExpression::Create(pb.op(), std::move(args), expr);
+    }
+  }
+}
+
 Status ExtraConfigPBToMap(const TableExtraConfigPB& pb, map<string, string>* configs) {
   Map<string, string> tmp;
   RETURN_NOT_OK(ExtraConfigPBToPBMap(pb, &tmp));
@@ -681,11 +799,27 @@ Status ParseBoolConfig(const string& name, const string& value, bool* result) {
 static const std::string kTableHistoryMaxAgeSec = "kudu.table.history_max_age_sec";
 static const std::string kTableMaintenancePriority = "kudu.table.maintenance_priority";
 static const std::string kTableDisableCompaction = "kudu.table.disable_compaction";
+static const std::string kTableTtlColumn = "kudu.table.ttl_column";
+static const std::string kTableTtlSec = "kudu.table.ttl_sec";
+static const std::string kTableClusteringColumn = "kudu.table.clustering_column";
+static const std::string kTableClusteringBuckets = "kudu.table.clustering_buckets";
+static const std::string kTableWriteQuotaRpcsPerSec = "kudu.table.write_quota_rpcs_per_sec";
+static const std::string kTableWriteQuotaBytesPerSec = "kudu.table.write_quota_bytes_per_sec";
+static const std::string kTableScanQuotaRpcsPerSec = "kudu.table.scan_quota_rpcs_per_sec";
+static const std::string kTableNumReadReplicas = "kudu.table.num_read_replicas";
 
 Status ExtraConfigPBFromPBMap(const Map<string, string>& configs, TableExtraConfigPB* pb) {
   static const unordered_set<string> kSupportedConfigs({kTableHistoryMaxAgeSec,
                                                         kTableMaintenancePriority,
-                                                        kTableDisableCompaction});
+                                                        kTableDisableCompaction,
+                                                        kTableTtlColumn,
+                                                        kTableTtlSec,
+                                                        kTableClusteringColumn,
+                                                        kTableClusteringBuckets,
+                                                        kTableWriteQuotaRpcsPerSec,
+                                                        kTableWriteQuotaBytesPerSec,
+                                                        kTableScanQuotaRpcsPerSec,
+                                                        kTableNumReadReplicas});
   TableExtraConfigPB result;
   for (const auto& config : configs) {
     const string& name = config.first;
@@ -713,6 +847,57 @@ Status ExtraConfigPBFromPBMap(const Map<string, string>& configs, TableExtraConf
         RETURN_NOT_OK(ParseBoolConfig(name, value, &disable_compaction));
         result.set_disable_compaction(disable_compaction);
       }
+    } else if (name == kTableTtlColumn) {
+      if (!value.empty()) {
+        result.set_ttl_column(value);
+      }
+    } else if (name == kTableTtlSec) {
+      if (!value.empty()) {
+        int32_t ttl_sec;
+        RETURN_NOT_OK(ParseInt32Config(name, value, &ttl_sec));
+        if (ttl_sec <= 0) {
+          return Status::InvalidArgument(Substitute("$0 must be positive", name), value);
+        }
+        result.set_ttl_sec(ttl_sec);
+      }
+    } else if (name == kTableClusteringColumn) {
+      if (!value.empty()) {
+        result.set_clustering_column(value);
+      }
+    } else if (name == kTableClusteringBuckets) {
+      if (!value.empty()) {
+        int32_t clustering_buckets;
+        RETURN_NOT_OK(ParseInt32Config(name, value, &clustering_buckets));
+        if (clustering_buckets <= 0) {
+          return Status::InvalidArgument(Substitute("$0 must be positive", name), value);
+        }
+        result.set_clustering_buckets(clustering_buckets);
+      }
+    } else if (name == kTableWriteQuotaRpcsPerSec || name == kTableWriteQuotaBytesPerSec ||
+               name == kTableScanQuotaRpcsPerSec) {
+      if (!value.empty()) {
+        int32_t quota;
+        RETURN_NOT_OK(ParseInt32Config(name, value, &quota));
+        if (quota < 0) {
+          return Status::InvalidArgument(Substitute("$0 must not be negative", name), value);
+        }
+        if (name == kTableWriteQuotaRpcsPerSec) {
+          result.set_write_quota_rpcs_per_sec(quota);
+        } else if (name == kTableWriteQuotaBytesPerSec) {
+          result.set_write_quota_bytes_per_sec(quota);
+        } else {
+          result.set_scan_quota_rpcs_per_sec(quota);
+        }
+      }
+    } else if (name == kTableNumReadReplicas) {
+      if (!value.empty()) {
+        int32_t num_read_replicas;
+        RETURN_NOT_OK(ParseInt32Config(name, value, &num_read_replicas));
+        if (num_read_replicas < 0) {
+          return Status::InvalidArgument(Substitute("$0 must not be negative", name), value);
+        }
+        result.set_num_read_replicas(num_read_replicas);
+      }
     } else {
       LOG(FATAL) << "Unknown extra configuration property: " << name;
     }
@@ -732,6 +917,30 @@ Status ExtraConfigPBToPBMap(const TableExtraConfigPB& pb, Map<string, string>* c
   if (pb.has_disable_compaction()) {
     result[kTableDisableCompaction] = std::to_string(pb.disable_compaction());
   }
+  if (pb.has_ttl_column()) {
+    result[kTableTtlColumn] = pb.ttl_column();
+  }
+  if (pb.has_ttl_sec()) {
+    result[kTableTtlSec] = std::to_string(pb.ttl_sec());
+  }
+  if (pb.has_clustering_column()) {
+    result[kTableClusteringColumn] = pb.clustering_column();
+  }
+  if (pb.has_clustering_buckets()) {
+    result[kTableClusteringBuckets] = std::to_string(pb.clustering_buckets());
+  }
+  if (pb.has_write_quota_rpcs_per_sec()) {
+    result[kTableWriteQuotaRpcsPerSec] = std::to_string(pb.write_quota_rpcs_per_sec());
+  }
+  if (pb.has_write_quota_bytes_per_sec()) {
+    result[kTableWriteQuotaBytesPerSec] = std::to_string(pb.write_quota_bytes_per_sec());
+  }
+  if (pb.has_scan_quota_rpcs_per_sec()) {
+    result[kTableScanQuotaRpcsPerSec] = std::to_string(pb.scan_quota_rpcs_per_sec());
+  }
+  if (pb.has_num_read_replicas()) {
+    result[kTableNumReadReplicas] = std::to_string(pb.num_read_replicas());
+  }
   *configs = std::move(result);
   return Status::OK();
 }
@@ -21,6 +21,7 @@
 
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,8 @@ template <typename Key, typename T> class Map;
 namespace kudu {
 
 class Arena;
+class ColumnAggregate;
+class ColumnExpression;
 class ColumnPredicate;
 class ColumnSchema;
 class faststring;
@@ -52,6 +55,8 @@ class Sockaddr;
 struct ColumnSchemaDelta;
 
 class AppStatusPB;
+class ColumnAggregatePB;
+class ColumnExpressionPB;
 class ColumnPredicatePB;
 class ColumnSchemaDeltaPB;
 class ColumnSchemaPB;
@@ -143,6 +148,26 @@ Status ColumnPredicateFromPB(const Schema& schema,
                              const ColumnPredicatePB& pb,
                              boost::optional<ColumnPredicate>* predicate);
 
+// Convert the column aggregate to protobuf.
+void ColumnAggregateToPB(const ColumnAggregate& aggregate, ColumnAggregatePB* pb);
+
+// Convert a column aggregate protobuf to a column aggregate, resolving its
+// column against 'schema'. The resulting aggregate is stored in the
+// 'aggregate' out parameter, if the result is successful.
+Status ColumnAggregateFromPB(const Schema& schema,
+                             const ColumnAggregatePB& pb,
+                             boost::optional<ColumnAggregate>* aggregate);
+
+// Convert the column expression to protobuf.
+void ColumnExpressionToPB(const ColumnExpression& expr, ColumnExpressionPB* pb);
+
+// Convert a column expression protobuf to a column expression, resolving its
+// columns against 'schema'. The resulting expression is stored in the 'expr'
+// out parameter, if the result is successful.
+Status ColumnExpressionFromPB(const Schema& schema,
+                              const ColumnExpressionPB& pb,
+                              std::shared_ptr<const ColumnExpression>* expr);
+
 // Convert a extra configuration properties protobuf to map.
 Status ExtraConfigPBToMap(const TableExtraConfigPB& pb,
                           std::map<std::string, std::string>* configs);
@@ -36,6 +36,7 @@ class Status;
 
 namespace consensus {
 
+class ConsensusMetadataJournal;
 class ConsensusMetadataManager; // IWYU pragma: keep
 class ConsensusMetadataTest;    // IWYU pragma: keep
 
@@ -152,6 +153,9 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
   void MergeCommittedConsensusStatePB(const ConsensusStatePB& cstate);
 
   // Persist current state of the protobuf to disk.
+  //
+  // With --cmeta_journal, updates of only the term and the vote are appended
+  // to the journal of the server instead of rewriting the cmeta file.
   Status Flush(FlushMode flush_mode = OVERWRITE);
 
   int64_t flush_count_for_tests() const {
@@ -182,13 +186,16 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
   FRIEND_TEST(ConsensusMetadataTest, TestMergeCommittedConsensusStatePB);
 
   ConsensusMetadata(FsManager* fs_manager, std::string tablet_id,
-                    std::string peer_uuid);
+                    std::string peer_uuid, ConsensusMetadataJournal* journal);
 
   // Create a ConsensusMetadata object with provided initial state.
   // If 'create_mode' is set to FLUSH_ON_CREATE, the encoded PB is flushed to
   // disk before returning. Otherwise, if 'create_mode' is set to
   // NO_FLUSH_ON_CREATE, the caller must explicitly call Flush() on the
   // returned object to get the bytes onto disk.
+  //
+  // If set, 'journal' is the consensus metadata journal of the server, which
+  // must outlive the object.
   static Status Create(FsManager* fs_manager,
                        const std::string& tablet_id,
                        const std::string& peer_uuid,
@@ -196,15 +203,18 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
                        int64_t current_term,
                        ConsensusMetadataCreateMode create_mode =
                            ConsensusMetadataCreateMode::FLUSH_ON_CREATE,
-                       scoped_refptr<ConsensusMetadata>* cmeta_out = nullptr);
+                       scoped_refptr<ConsensusMetadata>* cmeta_out = nullptr,
+                       ConsensusMetadataJournal* journal = nullptr);
 
-  // Load a ConsensusMetadata object from disk.
+  // Load a ConsensusMetadata object from disk, along with its latest term and
+  // vote from 'journal', if set.
   // Returns Status::NotFound if the file could not be found. May return other
   // Status codes if unable to read the file.
   static Status Load(FsManager* fs_manager,
                      const std::string& tablet_id,
                      const std::string& peer_uuid,
-                     scoped_refptr<ConsensusMetadata>* cmeta_out = nullptr);
+                     scoped_refptr<ConsensusMetadata>* cmeta_out = nullptr,
+                     ConsensusMetadataJournal* journal = nullptr);
 
   // Delete the ConsensusMetadata file associated with the given tablet from
   // disk. Returns Status::NotFound if the on-disk data is not found.
@@ -227,6 +237,7 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
   FsManager* const fs_manager_;
   const std::string tablet_id_;
   const std::string peer_uuid_;
+  ConsensusMetadataJournal* const journal_;
 
   // This fake mutex helps ensure that this ConsensusMetadata object stays
   // externally synchronized.
@@ -241,6 +252,11 @@ class ConsensusMetadata : public RefCountedThreadSafe<ConsensusMetadata> {
   // The number of times the metadata has been flushed to disk.
   int64_t flush_count_for_tests_;
 
+  // Whether the cmeta file is known to reflect all the durable fields but the
+  // term and the vote, i.e. it was written or loaded and the committed config
+  // hasn't been changed since.
+  bool file_has_committed_config_;
+
   // Durable fields.
   ConsensusMetadataPB pb_;
 
@@ -0,0 +1,313 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/consensus_meta_journal.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
+
+DEFINE_int32(cmeta_journal_compaction_threshold_mb, 16,
+             "The size past which the consensus metadata journal is compacted, "
+             "keeping only the records not yet reflected in the consensus "
+             "metadata files. The journal is allowed to grow to twice its size "
+             "as of its last compaction if that's larger.");
+DEFINE_validator(cmeta_journal_compaction_threshold_mb,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(cmeta_journal_compaction_threshold_mb, advanced);
+TAG_FLAG(cmeta_journal_compaction_threshold_mb, experimental);
+TAG_FLAG(cmeta_journal_compaction_threshold_mb, runtime);
+
+using kudu::pb_util::ReadablePBContainerFile;
+using kudu::pb_util::WritablePBContainerFile;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace consensus {
+
+namespace {
+
+// The suffix of the journal being written by a compaction.
+const char* const kCompactionSuffix = ".compacting";
+
+} // anonymous namespace
+
+ConsensusMetadataJournal::ConsensusMetadataJournal(Env* env, string path, bool sync)
+    : env_(env),
+      path_(std::move(path)),
+      sync_(sync),
+      cond_(&lock_),
+      last_seqno_(0),
+      durable_seqno_(0),
+      write_in_progress_(false),
+      read_only_(true),
+      compacted_size_(0),
+      num_syncs_(0),
+      num_compactions_(0) {
+}
+
+ConsensusMetadataJournal::~ConsensusMetadataJournal() {
+  if (writer_) {
+    WARN_NOT_OK(writer_->Close(), "unable to close consensus metadata journal " + path_);
+  }
+}
+
+Status ConsensusMetadataJournal::Open(bool read_only) {
+  read_only_ = read_only;
+  // The journal an interrupted compaction was to replace is intact.
+  const string compaction_path = path_ + kCompactionSuffix;
+  if (!read_only && env_->FileExists(compaction_path)) {
+    RETURN_NOT_OK(env_->DeleteFile(compaction_path));
+  }
+  if (!env_->FileExists(path_)) {
+    return read_only ? Status::OK() : OpenWriter(/*create=*/true);
+  }
+
+  unique_ptr<RandomAccessFile> file;
+  RandomAccessFileOptions opts;
+  opts.is_sensitive = true;
+  RETURN_NOT_OK(env_->NewRandomAccessFile(opts, path_, &file));
+  ReadablePBContainerFile reader(std::move(file));
+  RETURN_NOT_OK(reader.Open());
+  Status s;
+  while (true) {
+    ConsensusMetadataJournalRecordPB record;
+    s = reader.ReadNextPB(&record);
+    if (!s.ok()) {
+      break;
+    }
+    last_seqno_ = std::max(last_seqno_, record.seqno());
+    // Records with no tablet only carry the sequence number over compactions.
+    if (record.tablet_id().empty()) {
+      continue;
+    }
+    auto& latest = latest_[record.tablet_id()];
+    if (!latest.has_seqno() || latest.seqno() < record.seqno()) {
+      latest = std::move(record);
+    }
+  }
+  // A partial trailing record is that of an append which never returned.
+  if (!s.IsEndOfFile() && !s.IsIncomplete()) {
+    return s.CloneAndPrepend(Substitute("unable to read consensus metadata journal $0", path_));
+  }
+  const uint64_t valid_size = reader.offset();
+  RETURN_NOT_OK(reader.Close());
+  durable_seqno_ = last_seqno_;
+  compacted_size_ = valid_size;
+  LOG(INFO) << Substitute("Replayed consensus metadata journal $0: $1 tablets, last seqno $2",
+                          path_, latest_.size(), last_seqno_);
+  if (read_only) {
+    return Status::OK();
+  }
+  if (s.IsIncomplete()) {
+    LOG(WARNING) << Substitute("Truncating partial record of consensus metadata journal $0 "
+                               "at offset $1", path_, valid_size);
+    unique_ptr<RWFile> rw_file;
+    RWFileOptions rw_opts;
+    rw_opts.mode = Env::MUST_EXIST;
+    rw_opts.is_sensitive = true;
+    RETURN_NOT_OK(env_->NewRWFile(rw_opts, path_, &rw_file));
+    RETURN_NOT_OK(rw_file->Truncate(valid_size));
+    RETURN_NOT_OK(rw_file->Close());
+  }
+  return OpenWriter(/*create=*/false);
+}
+
+Status ConsensusMetadataJournal::OpenWriter(bool create) {
+  unique_ptr<RWFile> file;
+  RWFileOptions opts;
+  opts.mode = create ? Env::MUST_CREATE : Env::MUST_EXIST;
+  opts.is_sensitive = true;
+  RETURN_NOT_OK(env_->NewRWFile(opts, path_, &file));
+  unique_ptr<WritablePBContainerFile> writer(new WritablePBContainerFile(std::move(file)));
+  if (create) {
+    RETURN_NOT_OK(writer->CreateNew(ConsensusMetadataJournalRecordPB()));
+    if (sync_) {
+      RETURN_NOT_OK(writer->Sync());
+      RETURN_NOT_OK(env_->SyncDir(DirName(path_)));
+    }
+  } else {
+    RETURN_NOT_OK(writer->OpenExisting());
+  }
+  writer_ = std::move(writer);
+  return Status::OK();
+}
+
+int64_t ConsensusMetadataJournal::last_seqno() const {
+  MutexLock l(lock_);
+  return last_seqno_;
+}
+
+Status ConsensusMetadataJournal::Append(const string& tablet_id, int64_t current_term,
+                                        const string& voted_for) {
+  MutexLock l(lock_);
+  if (PREDICT_FALSE(read_only_)) {
+    return Status::IllegalState("consensus metadata journal is read-only", path_);
+  }
+  RETURN_NOT_OK(error_);
+  ConsensusMetadataJournalRecordPB record;
+  record.set_tablet_id(tablet_id);
+  record.set_seqno(++last_seqno_);
+  record.set_current_term(current_term);
+  if (!voted_for.empty()) {
+    record.set_voted_for(voted_for);
+  }
+  const int64_t seqno = record.seqno();
+  latest_[tablet_id] = record;
+  pending_.emplace_back(std::move(record));
+
+  while (durable_seqno_ < seqno) {
+    RETURN_NOT_OK(error_);
+    if (write_in_progress_) {
+      // The write in progress may not cover our record: wait for it, then
+      // either we've been covered by a later one or we write.
+      cond_.Wait();
+      continue;
+    }
+    write_in_progress_ = true;
+    vector<ConsensusMetadataJournalRecordPB> records;
+    records.swap(pending_);
+    const int64_t covered_seqno = last_seqno_;
+    l.Unlock();
+    Status s = WriteRecords(records);
+    l.Lock();
+    write_in_progress_ = false;
+    if (s.ok()) {
+      durable_seqno_ = covered_seqno;
+    } else {
+      error_ = s.CloneAndPrepend(
+          Substitute("unable to write consensus metadata journal $0", path_));
+      LOG(ERROR) << error_.ToString();
+    }
+    cond_.Broadcast();
+  }
+  return Status::OK();
+}
+
+Status ConsensusMetadataJournal::WriteRecords(
+    const vector<ConsensusMetadataJournalRecordPB>& records) {
+  for (const auto& record : records) {
+    RETURN_NOT_OK(writer_->Append(record));
+  }
+  if (sync_) {
+    RETURN_NOT_OK(writer_->Sync());
+    MutexLock l(lock_);
+    num_syncs_++;
+  }
+  const uint64_t threshold = std::max<uint64_t>(
+      static_cast<uint64_t>(FLAGS_cmeta_journal_compaction_threshold_mb) * 1024 * 1024,
+      2 * compacted_size_);
+  if (writer_->Offset() > threshold) {
+    RETURN_NOT_OK(Compact());
+  }
+  return Status::OK();
+}
+
+Status ConsensusMetadataJournal::Compact() {
+  // The records not yet written are part of the snapshot: they're written
+  // again after the compaction, which is harmless.
+  vector<ConsensusMetadataJournalRecordPB> records;
+  ConsensusMetadataJournalRecordPB seqno_record;
+  {
+    MutexLock l(lock_);
+    records.reserve(latest_.size());
+    for (const auto& e : latest_) {
+      records.emplace_back(e.second);
+    }
+    // The sequence numbers must keep increasing even if no record is left,
+    // for those of the cmeta files to remain meaningful.
+    seqno_record.set_tablet_id("");
+    seqno_record.set_seqno(last_seqno_);
+    seqno_record.set_current_term(0);
+  }
+
+  const string compaction_path = path_ + kCompactionSuffix;
+  {
+    unique_ptr<RWFile> file;
+    RWFileOptions opts;
+    opts.mode = Env::CREATE_OR_OPEN_WITH_TRUNCATE;
+    opts.is_sensitive = true;
+    RETURN_NOT_OK(env_->NewRWFile(opts, compaction_path, &file));
+    WritablePBContainerFile writer(std::move(file));
+    RETURN_NOT_OK(writer.CreateNew(seqno_record));
+    RETURN_NOT_OK(writer.Append(seqno_record));
+    for (const auto& record : records) {
+      RETURN_NOT_OK(writer.Append(record));
+    }
+    if (sync_) {
+      RETURN_NOT_OK(writer.Sync());
+    }
+    RETURN_NOT_OK(writer.Close());
+  }
+  RETURN_NOT_OK(env_->RenameFile(compaction_path, path_));
+  if (sync_) {
+    RETURN_NOT_OK(env_->SyncDir(DirName(path_)));
+  }
+  RETURN_NOT_OK(writer_->Close());
+  writer_.reset();
+  RETURN_NOT_OK(OpenWriter(/*create=*/false));
+  compacted_size_ = writer_->Offset();
+  VLOG(1) << Substitute("Compacted consensus metadata journal $0 to $1 records",
+                        path_, records.size());
+  MutexLock l(lock_);
+  num_compactions_++;
+  return Status::OK();
+}
+
+bool ConsensusMetadataJournal::Lookup(const string& tablet_id, int64_t min_seqno,
+                                      ConsensusMetadataJournalRecordPB* record) const {
+  MutexLock l(lock_);
+  const auto* latest = FindOrNull(latest_, tablet_id);
+  if (!latest || latest->seqno() <= min_seqno) {
+    return false;
+  }
+  *record = *latest;
+  return true;
+}
+
+void ConsensusMetadataJournal::Forget(const string& tablet_id, int64_t seqno) {
+  MutexLock l(lock_);
+  auto it = latest_.find(tablet_id);
+  if (it != latest_.end() && it->second.seqno() <= seqno) {
+    latest_.erase(it);
+  }
+}
+
+int64_t ConsensusMetadataJournal::num_syncs() const {
+  MutexLock l(lock_);
+  return num_syncs_;
+}
+
+int64_t ConsensusMetadataJournal::num_compactions() const {
+  MutexLock l(lock_);
+  return num_compactions_;
+}
+
+} // namespace consensus
+} // namespace kudu
@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+
+namespace pb_util {
+class WritablePBContainerFile;
+} // namespace pb_util
+
+namespace consensus {
+
+// A journal of the term and vote updates of the consensus metadata of all the
+// tablets of a server, shared by their ConsensusMetadata instances.
+//
+// Rewriting its cmeta file, and fsync()ing it, whenever a tablet's term or
+// vote changes makes the many elections which follow the failure of a server,
+// or the restart of a server hosting many tablets, issue thousands of
+// serial fsyncs. Those updates are instead appended to this journal, and the
+// appends of concurrent callers are group-committed: while one caller writes
+// and syncs the journal, the others queue up behind it and are all covered by
+// the next write. The cmeta files are still rewritten when the committed
+// config changes, and then stamped with the journal's sequence number so that
+// the records which predate them are ignored.
+//
+// The journal is compacted, rewriting it with the latest record of each
+// tablet whose cmeta file doesn't reflect it, once it grows past
+// --cmeta_journal_compaction_threshold_mb.
+//
+// This class is thread-safe.
+class ConsensusMetadataJournal {
+ public:
+  // 'sync' tells whether the appends are made durable with fsync(), as the
+  // cmeta files are.
+  ConsensusMetadataJournal(Env* env, std::string path, bool sync);
+  ~ConsensusMetadataJournal();
+
+  // Opens the journal at 'path', replaying its records, or creates it if it
+  // doesn't exist and 'read_only' is false. Read-only journals may not be
+  // appended to.
+  Status Open(bool read_only);
+
+  // Returns the sequence number of the last record appended so far. Cmeta
+  // files are stamped with it when written.
+  int64_t last_seqno() const;
+
+  // Appends the term and vote of 'tablet_id', returning once the record is
+  // durable. 'voted_for' is empty if there's no vote in 'current_term'.
+  Status Append(const std::string& tablet_id, int64_t current_term,
+                const std::string& voted_for);
+
+  // Sets '*record' to the latest record of 'tablet_id' with a sequence number
+  // higher than 'min_seqno', returning false if there's none.
+  bool Lookup(const std::string& tablet_id, int64_t min_seqno,
+              ConsensusMetadataJournalRecordPB* record) const;
+
+  // Stops tracking the records of 'tablet_id' up to 'seqno', e.g. once they
+  // are reflected in the cmeta file of the tablet, or the tablet is deleted,
+  // so that compactions drop them.
+  void Forget(const std::string& tablet_id, int64_t seqno);
+
+  int64_t num_syncs() const;
+  int64_t num_compactions() const;
+
+ private:
+  // Writes 'records' to the journal, syncing it if needed, and compacts the
+  // journal if it grew too large.
+  Status WriteRecords(const std::vector<ConsensusMetadataJournalRecordPB>& records);
+
+  // Rewrites the journal with the latest records of 'latest_'.
+  Status Compact();
+
+  // Opens the writer of the journal at 'path_', creating it if 'create'.
+  Status OpenWriter(bool create);
+
+  Env* const env_;
+  const std::string path_;
+  const bool sync_;
+
+  // Only used by the caller writing records, the one with 'write_in_progress_'
+  // set.
+  std::unique_ptr<pb_util::WritablePBContainerFile> writer_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // The latest records of the tablets, by tablet id.
+  std::unordered_map<std::string, ConsensusMetadataJournalRecordPB> latest_;
+
+  // The records yet to be written.
+  std::vector<ConsensusMetadataJournalRecordPB> pending_;
+
+  int64_t last_seqno_;
+
+  // The records up to this one are durable.
+  int64_t durable_seqno_;
+
+  // Whether some caller is writing records.
+  bool write_in_progress_;
+
+  // Set once a write failed: the journal may have lost records, so no more
+  // appends are accepted.
+  Status error_;
+
+  bool read_only_;
+
+  // The size of the journal as of its last compaction, or when it was opened.
+  // Only used by the caller writing records.
+  uint64_t compacted_size_;
+
+  int64_t num_syncs_;
+  int64_t num_compactions_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConsensusMetadataJournal);
+};
+
+} // namespace consensus
+} // namespace kudu
@@ -20,7 +20,10 @@
 #include <cstdint>
 #include <initializer_list>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
@@ -30,11 +33,22 @@
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(cmeta_journal);
+DECLARE_int32(cmeta_journal_compaction_threshold_mb);
+
 using google::protobuf::util::MessageDifferencer;
+using std::string;
+using std::thread;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace consensus {
@@ -63,6 +77,25 @@ class ConsensusMetadataManagerTest : public KuduTest {
   }
 
  protected:
+  // Emulates a restart of the server. The instances handed out by the
+  // manager must have been released.
+  void Restart() {
+    cmeta_manager_ = new ConsensusMetadataManager(&fs_manager_);
+  }
+
+  // Returns the term of 'tablet_id' as of its cmeta file alone.
+  int64_t FileTerm(const string& tablet_id) {
+    ConsensusMetadataPB pb;
+    CHECK_OK(pb_util::ReadPBContainerFromPath(env_, fs_manager_.GetConsensusMetadataPath(tablet_id),
+                                              &pb, pb_util::SENSITIVE));
+    return pb.current_term();
+  }
+
+  string JournalPath() const {
+    return JoinPathSegments(DirName(fs_manager_.GetConsensusMetadataDir()),
+                            "consensus-meta-journal");
+  }
+
   FsManager fs_manager_;
   scoped_refptr<ConsensusMetadataManager> cmeta_manager_;
   RaftConfigPB config_;
@@ -158,5 +191,114 @@ TEST_F(ConsensusMetadataManagerTest, TestNoClobber) {
   }
 }
 
+// With the journal, term and vote updates are appended to it rather than
+// written to the cmeta files, and are replayed on restart.
+TEST_F(ConsensusMetadataManagerTest, TestJournal) {
+  FLAGS_cmeta_journal = true;
+  scoped_refptr<ConsensusMetadata> cmeta;
+  ASSERT_OK(cmeta_manager_->Create(kTabletId, config_, kInitialTerm,
+                                   ConsensusMetadataCreateMode::FLUSH_ON_CREATE, &cmeta));
+  cmeta->set_current_term(5);
+  cmeta->set_voted_for("a");
+  ASSERT_OK(cmeta->Flush());
+  ASSERT_EQ(kInitialTerm, FileTerm(kTabletId));
+
+  cmeta.reset();
+  Restart();
+  ASSERT_OK(cmeta_manager_->Load(kTabletId, &cmeta));
+  ASSERT_EQ(5, cmeta->current_term());
+  ASSERT_EQ("a", cmeta->voted_for());
+
+  // A config change rewrites the file, which supersedes the journal.
+  cmeta->set_current_term(6);
+  cmeta->clear_voted_for();
+  RaftConfigPB config = config_;
+  config.set_opid_index(10);
+  cmeta->set_committed_config(config);
+  ASSERT_OK(cmeta->Flush());
+  ASSERT_EQ(6, FileTerm(kTabletId));
+
+  // Journaled updates are replayed even once the journal is no longer in use.
+  cmeta->set_current_term(7);
+  ASSERT_OK(cmeta->Flush());
+  cmeta.reset();
+  FLAGS_cmeta_journal = false;
+  Restart();
+  ASSERT_OK(cmeta_manager_->Load(kTabletId, &cmeta));
+  ASSERT_EQ(7, cmeta->current_term());
+  ASSERT_FALSE(cmeta->has_voted_for());
+  ASSERT_EQ(10, cmeta->CommittedConfig().opid_index());
+
+  // Without the journal, the updates go to the file again.
+  cmeta->set_current_term(8);
+  ASSERT_OK(cmeta->Flush());
+  ASSERT_EQ(8, FileTerm(kTabletId));
+  cmeta.reset();
+  Restart();
+  ASSERT_OK(cmeta_manager_->Load(kTabletId, &cmeta));
+  ASSERT_EQ(8, cmeta->current_term());
+}
+
+// The records of deleted tablets don't apply to the tablets created anew with
+// the same id.
+TEST_F(ConsensusMetadataManagerTest, TestJournalDeleteRecreate) {
+  FLAGS_cmeta_journal = true;
+  scoped_refptr<ConsensusMetadata> cmeta;
+  ASSERT_OK(cmeta_manager_->Create(kTabletId, config_, kInitialTerm,
+                                   ConsensusMetadataCreateMode::FLUSH_ON_CREATE, &cmeta));
+  cmeta->set_current_term(5);
+  ASSERT_OK(cmeta->Flush());
+  cmeta.reset();
+  ASSERT_OK(cmeta_manager_->Delete(kTabletId));
+  ASSERT_OK(cmeta_manager_->Create(kTabletId, config_, kInitialTerm));
+
+  Restart();
+  ASSERT_OK(cmeta_manager_->Load(kTabletId, &cmeta));
+  ASSERT_EQ(kInitialTerm, cmeta->current_term());
+}
+
+// Concurrent updates of many tablets are all durable, and the journal is
+// compacted as it grows.
+TEST_F(ConsensusMetadataManagerTest, TestJournalConcurrentUpdates) {
+  FLAGS_cmeta_journal = true;
+  FLAGS_cmeta_journal_compaction_threshold_mb = 0;
+  constexpr int kNumTablets = 8;
+  constexpr int kNumUpdates = 500;
+  vector<scoped_refptr<ConsensusMetadata>> cmetas(kNumTablets);
+  for (int i = 0; i < kNumTablets; i++) {
+    ASSERT_OK(cmeta_manager_->Create(Substitute("tablet-$0", i), config_, kInitialTerm,
+                                     ConsensusMetadataCreateMode::FLUSH_ON_CREATE,
+                                     &cmetas[i]));
+  }
+  vector<thread> threads;
+  for (int i = 0; i < kNumTablets; i++) {
+    threads.emplace_back([&, i]() {
+      for (int term = kInitialTerm + 1; term <= kNumUpdates; term++) {
+        cmetas[i]->set_current_term(term);
+        CHECK_OK(cmetas[i]->Flush());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  cmetas.clear();
+
+  // Without compactions, the journal would have kNumTablets * kNumUpdates
+  // records of about 30 bytes.
+  uint64_t journal_size;
+  ASSERT_OK(env_->GetFileSize(JournalPath(), &journal_size));
+  ASSERT_LT(journal_size, kNumTablets * kNumUpdates * 10);
+
+  Restart();
+  for (int i = 0; i < kNumTablets; i++) {
+    const string tablet_id = Substitute("tablet-$0", i);
+    scoped_refptr<ConsensusMetadata> cmeta;
+    ASSERT_OK(cmeta_manager_->Load(tablet_id, &cmeta));
+    ASSERT_EQ(kNumUpdates, cmeta->current_term());
+    ASSERT_EQ(kInitialTerm, FileTerm(tablet_id));
+  }
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -19,34 +19,75 @@
 #include <mutex>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/consensus/consensus_meta.h"
+#include "kudu/consensus/consensus_meta_journal.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/status.h"
 
+DECLARE_bool(cmeta_force_fsync);
+DECLARE_bool(cmeta_fsync_override_on_xfs);
+DECLARE_bool(cmeta_journal);
+DECLARE_bool(log_force_fsync_all);
+
 namespace kudu {
 namespace consensus {
 
 using std::lock_guard;
 using std::string;
+using std::unique_ptr;
 using strings::Substitute;
 
+namespace {
+
+// The name of the journal, which lives next to the consensus metadata
+// directory rather than in it, since the latter only has the files of the
+// tablets.
+const char* const kJournalFileName = "consensus-meta-journal";
+
+} // anonymous namespace
+
 ConsensusMetadataManager::ConsensusMetadataManager(FsManager* fs_manager)
     : fs_manager_(DCHECK_NOTNULL(fs_manager)) {
 }
 
+ConsensusMetadataManager::~ConsensusMetadataManager() {}
+
+Status ConsensusMetadataManager::InitJournal() {
+  const string path = JoinPathSegments(DirName(fs_manager_->GetConsensusMetadataDir()),
+                                       kJournalFileName);
+  // The records of a journal may be more recent than the cmeta files even if
+  // it's no longer in use.
+  if (!FLAGS_cmeta_journal && !fs_manager_->env()->FileExists(path)) {
+    return Status::OK();
+  }
+  // The records are made as durable as the cmeta files would be.
+  const bool sync = FLAGS_log_force_fsync_all || FLAGS_cmeta_force_fsync ||
+                    (FLAGS_cmeta_fsync_override_on_xfs && fs_manager_->meta_on_xfs());
+  unique_ptr<ConsensusMetadataJournal> journal(
+      new ConsensusMetadataJournal(fs_manager_->env(), path, sync));
+  RETURN_NOT_OK_PREPEND(journal->Open(fs_manager_->read_only()),
+                        "Unable to open consensus metadata journal");
+  journal_ = std::move(journal);
+  return Status::OK();
+}
+
 Status ConsensusMetadataManager::Create(const string& tablet_id,
                                         const RaftConfigPB& config,
                                         int64_t initial_term,
                                         ConsensusMetadataCreateMode create_mode,
                                         scoped_refptr<ConsensusMetadata>* cmeta_out) {
+  RETURN_NOT_OK(journal_once_.Init(&ConsensusMetadataManager::InitJournal, this));
   scoped_refptr<ConsensusMetadata> cmeta;
   RETURN_NOT_OK_PREPEND(ConsensusMetadata::Create(fs_manager_, tablet_id, fs_manager_->uuid(),
                                                   config, initial_term, create_mode,
-                                                  &cmeta),
+                                                  &cmeta, journal_.get()),
                         Substitute("Unable to create consensus metadata for tablet $0", tablet_id));
 
   lock_guard<Mutex> l(lock_);
@@ -72,9 +113,10 @@ Status ConsensusMetadataManager::Load(const string& tablet_id,
   }
 
   // If it's not yet cached, drop the lock before we load it.
+  RETURN_NOT_OK(journal_once_.Init(&ConsensusMetadataManager::InitJournal, this));
   scoped_refptr<ConsensusMetadata> cmeta;
   RETURN_NOT_OK_PREPEND(ConsensusMetadata::Load(fs_manager_, tablet_id, fs_manager_->uuid(),
-                                                &cmeta),
+                                                &cmeta, journal_.get()),
                         Substitute("Unable to load consensus metadata for tablet $0", tablet_id));
 
   // Cache and return the loaded ConsensusMetadata.
@@ -108,6 +150,9 @@ Status ConsensusMetadataManager::Delete(const string& tablet_id) {
   }
   RETURN_NOT_OK_PREPEND(ConsensusMetadata::DeleteOnDiskData(fs_manager_, tablet_id),
                         Substitute("Unable to delete consensus metadata for tablet $0", tablet_id));
+  if (journal_once_.init_succeeded() && journal_) {
+    journal_->Forget(tablet_id, journal_->last_seqno());
+  }
   return Status::OK();
 }
 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -24,12 +25,14 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/mutex.h"
+#include "kudu/util/once.h"
 
 namespace kudu {
 class FsManager;
 class Status;
 
 namespace consensus {
+class ConsensusMetadataJournal;
 class RaftConfigPB;
 
 // API and implementation for a consensus metadata "manager" that controls
@@ -42,12 +45,17 @@ class RaftConfigPB;
 // provides flexibility to change the underlying implementation of
 // ConsensusMetadata in the future.
 //
+// The manager also owns the consensus metadata journal of the server, which
+// the ConsensusMetadata instances it hands out append their term and vote
+// updates to with --cmeta_journal. See ConsensusMetadataJournal.
+//
 // This class is ONLY thread-safe across different tablets. Concurrent access
 // to Create(), Load(), or Delete() for the same tablet id is thread-hostile
 // and must be externally synchronized. Failure to do so may result in a crash.
 class ConsensusMetadataManager : public RefCountedThreadSafe<ConsensusMetadataManager> {
  public:
   explicit ConsensusMetadataManager(FsManager* fs_manager);
+  ~ConsensusMetadataManager();
 
   // Create a ConsensusMetadata instance keyed by 'tablet_id'.
   // Returns an error if a ConsensusMetadata instance with that key already exists.
@@ -84,8 +92,16 @@ class ConsensusMetadataManager : public RefCountedThreadSafe<ConsensusMetadataMa
  private:
   friend class RefCountedThreadSafe<ConsensusMetadataManager>;
 
+  // Opens the journal, if --cmeta_journal is set or it exists.
+  Status InitJournal();
+
   FsManager* const fs_manager_;
 
+  // The journal, opened by the first call to Create() or Load(). Null if
+  // unused.
+  KuduOnceDynamic journal_once_;
+  std::unique_ptr<ConsensusMetadataJournal> journal_;
+
   // Lock protecting the map below.
   Mutex lock_;
 
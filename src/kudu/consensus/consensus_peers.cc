@@ -19,11 +19,15 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -37,12 +41,17 @@
 #include "kudu/consensus/consensus_queue.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/messenger.h"
 #include "kudu/rpc/periodic.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/rpc/transfer.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -80,6 +89,54 @@ DEFINE_bool(enable_tablet_copy, true,
             "replica. For testing purposes only.");
 TAG_FLAG(enable_tablet_copy, unsafe);
 
+DEFINE_bool(raft_batch_heartbeats, false,
+            "Whether the leader replicas of a server send the requests that carry "
+            "no ops, such as heartbeats, to the followers on the same remote "
+            "server as a single batched RPC, rather than one RPC per tablet. "
+            "Reduces the RPC load of servers hosting many tablets.");
+TAG_FLAG(raft_batch_heartbeats, advanced);
+TAG_FLAG(raft_batch_heartbeats, experimental);
+
+DEFINE_bool(raft_batch_vote_requests, false,
+            "Whether the candidate replicas of a server send their vote requests "
+            "to the voters on the same remote server as a single batched RPC, "
+            "rather than one RPC per tablet. Speeds up the elections of the "
+            "many tablets which lose their leader when a server fails.");
+TAG_FLAG(raft_batch_vote_requests, advanced);
+TAG_FLAG(raft_batch_vote_requests, experimental);
+
+DEFINE_int32(raft_update_batch_window_ms, 5,
+             "With --raft_batch_heartbeats or --raft_batch_vote_requests, for how "
+             "long requests are held back to be batched with requests of other "
+             "tablets to the same server.");
+DEFINE_validator(raft_update_batch_window_ms,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(raft_update_batch_window_ms, advanced);
+TAG_FLAG(raft_update_batch_window_ms, experimental);
+TAG_FLAG(raft_update_batch_window_ms, runtime);
+
+DEFINE_int32(raft_vote_batch_max_size, 16,
+             "With --raft_batch_vote_requests, the maximum number of vote requests "
+             "sent in one batched RPC. The remote server handles the requests of a "
+             "batch one after another on a single thread, each possibly flushing "
+             "the consensus metadata of its replica, so smaller batches are voted "
+             "on in parallel by more threads.");
+DEFINE_validator(raft_vote_batch_max_size,
+                 [](const char* /*n*/, int32_t v) { return v >= 1; });
+TAG_FLAG(raft_vote_batch_max_size, advanced);
+TAG_FLAG(raft_vote_batch_max_size, experimental);
+TAG_FLAG(raft_vote_batch_max_size, runtime);
+
+DEFINE_bool(consensus_send_ops_as_sidecars, false,
+            "Whether the leader sends the ops it replicates as RPC sidecars "
+            "rather than embedding them in the UpdateConsensus() requests. Each "
+            "op is then serialized once and shared by the requests to all the "
+            "followers, instead of being serialized again for each follower. "
+            "Followers that don't support this are sent embedded ops.");
+TAG_FLAG(consensus_send_ops_as_sidecars, advanced);
+TAG_FLAG(consensus_send_ops_as_sidecars, experimental);
+TAG_FLAG(consensus_send_ops_as_sidecars, runtime);
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::pb_util::SecureShortDebugString;
@@ -138,7 +195,8 @@ Peer::Peer(RaftPeerPB peer_pb,
       raft_pool_token_(raft_pool_token),
       request_pending_(false),
       closed_(false),
-      has_sent_first_request_(false) {
+      has_sent_first_request_(false),
+      ops_as_sidecars_unsupported_(false) {
   CreateProxyIfNeeded();
 }
 
@@ -224,6 +282,7 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
   bool needs_tablet_copy = false;
   int64_t commit_index_before = request_.has_committed_index() ?
       request_.committed_index() : kMinimumOpIdIndex;
+  request_.clear_ops_sidecar_idx();
   Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
                                     &replicate_msg_refs_, &needs_tablet_copy);
   int64_t commit_index_after = request_.has_committed_index() ?
@@ -288,6 +347,15 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
       << SecureShortDebugString(request_);
 
   controller_.Reset();
+  if (FLAGS_consensus_send_ops_as_sidecars && request_.ops_size() > 0 &&
+      !ops_as_sidecars_unsupported_ && proxy_->SupportsOpsAsSidecars()) {
+    Status s = AttachOpsAsSidecars();
+    if (PREDICT_FALSE(!s.ok())) {
+      VLOG_WITH_PREFIX_UNLOCKED(1) << "Sending ops embedded in the request: " << s.ToString();
+      controller_.Reset();
+      request_.clear_ops_sidecar_idx();
+    }
+  }
   request_pending_ = true;
   l.unlock();
 
@@ -300,6 +368,46 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
                       });
 }
 
+namespace {
+
+// A sidecar carrying the serialized form of a replicated op. It holds a
+// reference to the op, so that the serialized data outlives the RPC.
+class ReplicateSidecar : public rpc::RpcSidecar {
+ public:
+  explicit ReplicateSidecar(ReplicateRefPtr msg)
+      : msg_(std::move(msg)),
+        data_(msg_->serialized()) {
+  }
+
+  void AppendSlices(rpc::TransferPayload* payload) const override {
+    payload->push_back(data_);
+  }
+
+  size_t TotalSize() const override {
+    return data_.size();
+  }
+
+ private:
+  const ReplicateRefPtr msg_;
+  const Slice data_;
+};
+
+} // anonymous namespace
+
+Status Peer::AttachOpsAsSidecars() {
+  DCHECK_EQ(request_.ops_size(), replicate_msg_refs_.size());
+  for (const auto& msg : replicate_msg_refs_) {
+    int idx;
+    RETURN_NOT_OK(controller_.AddOutboundSidecar(
+        unique_ptr<rpc::RpcSidecar>(new ReplicateSidecar(msg)), &idx));
+    request_.add_ops_sidecar_idx(idx);
+  }
+  controller_.RequireServerFeature(OPS_AS_SIDECARS);
+  // The ops are owned by the queue.
+  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  return Status::OK();
+}
+
 void Peer::StartElection() {
   if (PREDICT_FALSE(!CreateProxyIfNeeded())) {
     return;
@@ -345,6 +453,12 @@ void Peer::ProcessResponse() {
   // Process RpcController errors.
   const auto controller_status = controller_.status();
   if (!controller_status.ok()) {
+    if (request_.ops_sidecar_idx_size() > 0 && controller_.error_response() &&
+        controller_.error_response()->unsupported_feature_flags_size() > 0) {
+      LOG_WITH_PREFIX_UNLOCKED(INFO) << "Peer doesn't support ops as sidecars, "
+                                     << "embedding them in the requests from now on";
+      ops_as_sidecars_unsupported_ = true;
+    }
     auto ps = controller_status.IsRemoteError() ?
         PeerStatus::REMOTE_ERROR : PeerStatus::RPC_LAYER_ERROR;
     queue_->UpdatePeerStatus(peer_pb_.permanent_uuid(), ps, controller_status);
@@ -539,16 +653,242 @@ Peer::~Peer() {
   request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
 }
 
+namespace {
+
+// Maximum number of updates sent in one MultiUpdateConsensus() RPC.
+constexpr size_t kMaxUpdatesPerBatch = 1024;
+
+Status CreateConsensusServiceProxyForHost(
+    const HostPort& hostport,
+    const shared_ptr<Messenger>& messenger,
+    DnsResolver* dns_resolver,
+    unique_ptr<ConsensusServiceProxy>* new_proxy) {
+  new_proxy->reset(new ConsensusServiceProxy(messenger, hostport, dns_resolver));
+  (*new_proxy)->Init();
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+shared_ptr<UpdateBatcher> UpdateBatcher::Get(const shared_ptr<Messenger>& messenger,
+                                             DnsResolver* dns_resolver,
+                                             const HostPort& hostport) {
+  static simple_spinlock batchers_lock;
+  static auto* batchers = new std::unordered_map<string, weak_ptr<UpdateBatcher>>();
+
+  const string key = Substitute("$0/$1", reinterpret_cast<uintptr_t>(messenger.get()),
+                                hostport.ToString());
+  std::lock_guard<simple_spinlock> l(batchers_lock);
+  shared_ptr<UpdateBatcher> batcher = (*batchers)[key].lock();
+  if (!batcher) {
+    // Drop the batchers no one uses anymore, e.g. of servers that went away.
+    for (auto it = batchers->begin(); it != batchers->end();) {
+      it = it->second.expired() ? batchers->erase(it) : std::next(it);
+    }
+    unique_ptr<ConsensusServiceProxy> proxy;
+    CHECK_OK(CreateConsensusServiceProxyForHost(hostport, messenger, dns_resolver, &proxy));
+    batcher = std::make_shared<UpdateBatcher>(messenger, std::move(proxy));
+    (*batchers)[key] = batcher;
+  }
+  return batcher;
+}
+
+UpdateBatcher::UpdateBatcher(shared_ptr<Messenger> messenger,
+                             unique_ptr<ConsensusServiceProxy> consensus_proxy)
+    : messenger_(std::move(messenger)),
+      consensus_proxy_(std::move(consensus_proxy)),
+      multi_update_unsupported_(false),
+      multi_vote_unsupported_(false) {
+}
+
+void UpdateBatcher::UpdateAsync(const ConsensusRequestPB& request,
+                                ConsensusResponsePB* response,
+                                rpc::RpcController* controller,
+                                rpc::ResponseCallback callback) {
+  if (multi_update_unsupported_) {
+    SendIndividually({ { &request, response, controller, std::move(callback) } });
+    return;
+  }
+  bool first;
+  bool full;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_.push_back({ &request, response, controller, std::move(callback) });
+    first = pending_.size() == 1;
+    full = pending_.size() >= kMaxUpdatesPerBatch;
+  }
+  if (full) {
+    Flush();
+  } else if (first) {
+    // Even if the messenger is shutting down and the task is aborted, the
+    // pending updates must be sent so that their callbacks are invoked.
+    shared_ptr<UpdateBatcher> self = shared_from_this();
+    messenger_->ScheduleOnReactor([self](const Status& /*s*/) { self->Flush(); },
+                                  MonoDelta::FromMilliseconds(FLAGS_raft_update_batch_window_ms));
+  }
+}
+
+void UpdateBatcher::Flush() {
+  auto batch = std::make_shared<Batch>();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    batch->updates.swap(pending_);
+  }
+  if (batch->updates.empty()) {
+    return;
+  }
+  if (batch->updates.size() == 1) {
+    SendIndividually(std::move(batch->updates));
+    return;
+  }
+  for (const auto& update : batch->updates) {
+    *batch->request.add_requests() = *update.request;
+  }
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<UpdateBatcher> self = shared_from_this();
+  consensus_proxy_->MultiUpdateConsensusAsync(batch->request, &batch->response,
+                                              &batch->controller,
+                                              [self, batch]() {
+                                                self->HandleBatchResponse(batch);
+                                              });
+}
+
+void UpdateBatcher::HandleBatchResponse(const shared_ptr<Batch>& batch) {
+  const Status& s = batch->controller.status();
+  if (PREDICT_FALSE(!s.ok() ||
+                    batch->response.responses_size() != batch->updates.size())) {
+    const rpc::ErrorStatusPB* err = batch->controller.error_response();
+    if (err && err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      LOG(INFO) << Substitute("$0 doesn't support batched consensus updates, "
+                              "sending them individually", consensus_proxy_->ToString());
+      multi_update_unsupported_ = true;
+    } else {
+      KLOG_EVERY_N_SECS(WARNING, 10)
+          << Substitute("Batched consensus update to $0 failed, sending updates "
+                        "individually: $1", consensus_proxy_->ToString(), s.ToString());
+    }
+    SendIndividually(std::move(batch->updates));
+    return;
+  }
+  for (int i = 0; i < batch->updates.size(); i++) {
+    auto& update = batch->updates[i];
+    update.response->Swap(batch->response.mutable_responses(i));
+    update.callback();
+  }
+}
+
+void UpdateBatcher::SendIndividually(vector<PendingUpdate> updates) {
+  for (auto& update : updates) {
+    update.controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+    consensus_proxy_->UpdateConsensusAsync(*update.request, update.response,
+                                           update.controller, update.callback);
+  }
+}
+
+void UpdateBatcher::RequestConsensusVoteAsync(const VoteRequestPB& request,
+                                              VoteResponsePB* response,
+                                              rpc::RpcController* controller,
+                                              rpc::ResponseCallback callback) {
+  if (multi_vote_unsupported_) {
+    SendVotesIndividually({ { &request, response, controller, std::move(callback) } });
+    return;
+  }
+  bool first;
+  bool full;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    pending_votes_.push_back({ &request, response, controller, std::move(callback) });
+    first = pending_votes_.size() == 1;
+    full = pending_votes_.size() >= static_cast<size_t>(FLAGS_raft_vote_batch_max_size);
+  }
+  if (full) {
+    FlushVotes();
+  } else if (first) {
+    shared_ptr<UpdateBatcher> self = shared_from_this();
+    messenger_->ScheduleOnReactor([self](const Status& /*s*/) { self->FlushVotes(); },
+                                  MonoDelta::FromMilliseconds(FLAGS_raft_update_batch_window_ms));
+  }
+}
+
+void UpdateBatcher::FlushVotes() {
+  auto batch = std::make_shared<VoteBatch>();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    batch->votes.swap(pending_votes_);
+  }
+  if (batch->votes.empty()) {
+    return;
+  }
+  if (batch->votes.size() == 1) {
+    SendVotesIndividually(std::move(batch->votes));
+    return;
+  }
+  MonoDelta timeout;
+  for (const auto& vote : batch->votes) {
+    *batch->request.add_requests() = *vote.request;
+    const MonoDelta vote_timeout = vote.controller->timeout();
+    if (vote_timeout.Initialized() && (!timeout.Initialized() || vote_timeout < timeout)) {
+      timeout = vote_timeout;
+    }
+  }
+  batch->controller.set_timeout(
+      timeout.Initialized() ? timeout : MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  shared_ptr<UpdateBatcher> self = shared_from_this();
+  consensus_proxy_->MultiRequestConsensusVoteAsync(batch->request, &batch->response,
+                                                   &batch->controller,
+                                                   [self, batch]() {
+                                                     self->HandleVoteBatchResponse(batch);
+                                                   });
+}
+
+void UpdateBatcher::HandleVoteBatchResponse(const shared_ptr<VoteBatch>& batch) {
+  const Status& s = batch->controller.status();
+  if (PREDICT_FALSE(!s.ok() ||
+                    batch->response.responses_size() != batch->votes.size())) {
+    const rpc::ErrorStatusPB* err = batch->controller.error_response();
+    if (err && err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+      LOG(INFO) << Substitute("$0 doesn't support batched vote requests, "
+                              "sending them individually", consensus_proxy_->ToString());
+      multi_vote_unsupported_ = true;
+    } else {
+      KLOG_EVERY_N_SECS(WARNING, 10)
+          << Substitute("Batched vote request to $0 failed, sending vote requests "
+                        "individually: $1", consensus_proxy_->ToString(), s.ToString());
+    }
+    SendVotesIndividually(std::move(batch->votes));
+    return;
+  }
+  for (int i = 0; i < batch->votes.size(); i++) {
+    auto& vote = batch->votes[i];
+    vote.response->Swap(batch->response.mutable_responses(i));
+    vote.callback();
+  }
+}
+
+void UpdateBatcher::SendVotesIndividually(vector<PendingVote> votes) {
+  for (auto& vote : votes) {
+    consensus_proxy_->RequestConsensusVoteAsync(*vote.request, vote.response,
+                                                vote.controller, vote.callback);
+  }
+}
+
 RpcPeerProxy::RpcPeerProxy(HostPort hostport,
-                           unique_ptr<ConsensusServiceProxy> consensus_proxy)
+                           unique_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<UpdateBatcher> update_batcher)
     : hostport_(std::move(hostport)),
-      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))) {
+      consensus_proxy_(std::move(DCHECK_NOTNULL(consensus_proxy))),
+      update_batcher_(std::move(update_batcher)) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB& request,
                                ConsensusResponsePB* response,
                                rpc::RpcController* controller,
                                const rpc::ResponseCallback& callback) {
+  if (update_batcher_ && FLAGS_raft_batch_heartbeats &&
+      request.ops_size() == 0 && request.ops_sidecar_idx_size() == 0) {
+    update_batcher_->UpdateAsync(request, response, controller, callback);
+    return;
+  }
   controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
   consensus_proxy_->UpdateConsensusAsync(request, response, controller, callback);
 }
@@ -565,6 +905,10 @@ void RpcPeerProxy::RequestConsensusVoteAsync(const VoteRequestPB& request,
                                              VoteResponsePB* response,
                                              rpc::RpcController* controller,
                                              const rpc::ResponseCallback& callback) {
+  if (update_batcher_ && FLAGS_raft_batch_vote_requests) {
+    update_batcher_->RequestConsensusVoteAsync(request, response, controller, callback);
+    return;
+  }
   consensus_proxy_->RequestConsensusVoteAsync(request, response, controller, callback);
 }
 
@@ -580,20 +924,6 @@ string RpcPeerProxy::PeerName() const {
   return hostport_.ToString();
 }
 
-namespace {
-
-Status CreateConsensusServiceProxyForHost(
-    const HostPort& hostport,
-    const shared_ptr<Messenger>& messenger,
-    DnsResolver* dns_resolver,
-    unique_ptr<ConsensusServiceProxy>* new_proxy) {
-  new_proxy->reset(new ConsensusServiceProxy(messenger, hostport, dns_resolver));
-  (*new_proxy)->Init();
-  return Status::OK();
-}
-
-} // anonymous namespace
-
 RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger,
                                          DnsResolver* dns_resolver)
     : messenger_(std::move(messenger)),
@@ -606,7 +936,12 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   unique_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(
       hostport, messenger_, dns_resolver_, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<UpdateBatcher> update_batcher;
+  if (FLAGS_raft_batch_heartbeats || FLAGS_raft_batch_vote_requests) {
+    update_batcher = UpdateBatcher::Get(messenger_, dns_resolver_, hostport);
+  }
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy),
+                                std::move(update_batcher)));
   return Status::OK();
 }
 
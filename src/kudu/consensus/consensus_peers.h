@@ -29,6 +29,7 @@
 #include "kudu/consensus/consensus.proxy.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/locks.h"
@@ -153,6 +154,11 @@ class Peer :
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
+  // Moves the ops of 'request_' to sidecars of 'controller_'. Each sidecar
+  // carries the serialized form of an op, shared with the requests to the
+  // other peers.
+  Status AttachOpsAsSidecars();
+
   // Signals there was an error sending the request to the peer.
   void ProcessResponseErrorUnlocked(const Status& status);
 
@@ -221,6 +227,11 @@ class Peer :
   std::atomic<bool> request_pending_;
   std::atomic<bool> closed_;
   bool has_sent_first_request_;
+
+  // Set once the peer has rejected a request carrying its ops as sidecars,
+  // after which ops are embedded in the requests again. Protected by
+  // 'peer_lock_'.
+  bool ops_as_sidecars_unsupported_;
 };
 
 // A proxy to another peer. Usually a thin wrapper around an rpc proxy but can
@@ -257,6 +268,12 @@ class PeerProxy {
 
   // Remote endpoint or description of the peer.
   virtual std::string PeerName() const = 0;
+
+  // Whether the ops of the requests passed to UpdateAsync() may be attached
+  // to the RPC controller as sidecars rather than embedded in the request.
+  virtual bool SupportsOpsAsSidecars() const {
+    return false;
+  }
 };
 
 // A peer proxy factory. Usually just obtains peers through the rpc implementation
@@ -272,11 +289,121 @@ class PeerProxyFactory {
   virtual const std::shared_ptr<rpc::Messenger>& messenger() const = 0;
 };
 
+// Coalesces the UpdateConsensus() requests that the leader replicas of this
+// server send to the same remote server into MultiUpdateConsensus() RPCs.
+// Requests are held for up to --raft_update_batch_window_ms so that the
+// heartbeats of many idle tablets go out as a single RPC, which the remote
+// server fans out to the individual replicas. The RequestConsensusVote()
+// requests of the candidates are likewise coalesced into
+// MultiRequestConsensusVote() RPCs, since the failure of a server makes the
+// replicas of many tablets run elections at about the same time. Those are
+// kept to --raft_vote_batch_max_size requests, since each vote may have to
+// be persisted.
+//
+// If a batch fails as a whole, or the remote server doesn't support the
+// batched RPC, its requests are sent individually instead, so that each
+// caller observes the outcome of its own RPC.
+//
+// This class is thread-safe.
+class UpdateBatcher : public std::enable_shared_from_this<UpdateBatcher> {
+ public:
+  // Returns the batcher for the requests sent through 'messenger' to the
+  // server at 'hostport', creating it if there is none. Batchers are shared by
+  // all the tablets of the server, and live as long as someone refers to them.
+  static std::shared_ptr<UpdateBatcher> Get(const std::shared_ptr<rpc::Messenger>& messenger,
+                                            DnsResolver* dns_resolver,
+                                            const HostPort& hostport);
+
+  UpdateBatcher(std::shared_ptr<rpc::Messenger> messenger,
+                std::unique_ptr<ConsensusServiceProxy> consensus_proxy);
+
+  // Sends 'request' as part of the next batch. As with PeerProxy::UpdateAsync(),
+  // 'request', 'response' and 'controller' must stay valid until 'callback'
+  // is invoked.
+  void UpdateAsync(const ConsensusRequestPB& request,
+                   ConsensusResponsePB* response,
+                   rpc::RpcController* controller,
+                   rpc::ResponseCallback callback);
+
+  // Sends 'request' as part of the next batch of vote requests, as with
+  // PeerProxy::RequestConsensusVoteAsync(). The batch is sent with the
+  // shortest timeout of the controllers of its requests.
+  void RequestConsensusVoteAsync(const VoteRequestPB& request,
+                                 VoteResponsePB* response,
+                                 rpc::RpcController* controller,
+                                 rpc::ResponseCallback callback);
+
+ private:
+  struct PendingUpdate {
+    const ConsensusRequestPB* request;
+    ConsensusResponsePB* response;
+    rpc::RpcController* controller;
+    rpc::ResponseCallback callback;
+  };
+
+  // An in-flight MultiUpdateConsensus() RPC.
+  struct Batch {
+    std::vector<PendingUpdate> updates;
+    MultiConsensusRequestPB request;
+    MultiConsensusResponsePB response;
+    rpc::RpcController controller;
+  };
+
+  // Sends the pending updates, if any.
+  void Flush();
+
+  // Hands the responses of 'batch' out to the callers, or falls back to
+  // sending the updates individually if the batch failed.
+  void HandleBatchResponse(const std::shared_ptr<Batch>& batch);
+
+  void SendIndividually(std::vector<PendingUpdate> updates);
+
+  struct PendingVote {
+    const VoteRequestPB* request;
+    VoteResponsePB* response;
+    rpc::RpcController* controller;
+    rpc::ResponseCallback callback;
+  };
+
+  // An in-flight MultiRequestConsensusVote() RPC.
+  struct VoteBatch {
+    std::vector<PendingVote> votes;
+    MultiVoteRequestPB request;
+    MultiVoteResponsePB response;
+    rpc::RpcController controller;
+  };
+
+  // Like Flush(), HandleBatchResponse() and SendIndividually(), for the
+  // vote requests.
+  void FlushVotes();
+  void HandleVoteBatchResponse(const std::shared_ptr<VoteBatch>& batch);
+  void SendVotesIndividually(std::vector<PendingVote> votes);
+
+  const std::shared_ptr<rpc::Messenger> messenger_;
+  const std::unique_ptr<ConsensusServiceProxy> consensus_proxy_;
+
+  // Set once the remote server turns out not to support batched updates, and
+  // batched vote requests, respectively.
+  std::atomic<bool> multi_update_unsupported_;
+  std::atomic<bool> multi_vote_unsupported_;
+
+  // Protects 'pending_' and 'pending_votes_'.
+  simple_spinlock lock_;
+  std::vector<PendingUpdate> pending_;
+  std::vector<PendingVote> pending_votes_;
+
+  DISALLOW_COPY_AND_ASSIGN(UpdateBatcher);
+};
+
 // PeerProxy implementation that does RPC calls
 class RpcPeerProxy : public PeerProxy {
  public:
+  // If 'update_batcher' is set, requests that carry no ops are sent through it
+  // with --raft_batch_heartbeats, and vote requests with
+  // --raft_batch_vote_requests.
   RpcPeerProxy(HostPort hostport,
-               std::unique_ptr<ConsensusServiceProxy> consensus_proxy);
+               std::unique_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<UpdateBatcher> update_batcher = nullptr);
 
   void UpdateAsync(const ConsensusRequestPB& request,
                    ConsensusResponsePB* response,
@@ -300,9 +427,14 @@ class RpcPeerProxy : public PeerProxy {
 
   std::string PeerName() const override;
 
+  bool SupportsOpsAsSidecars() const override {
+    return true;
+  }
+
  private:
   const HostPort hostport_;
   std::unique_ptr<ConsensusServiceProxy> consensus_proxy_;
+  const std::shared_ptr<UpdateBatcher> update_batcher_;
 };
 
 // PeerProxyFactory implementation that generates RPCPeerProxies
@@ -67,6 +67,8 @@
 DECLARE_int32(consensus_max_batch_size_bytes);
 DECLARE_int32(follower_unavailable_considered_failed_sec);
 DECLARE_double(consensus_fail_log_read_ops);
+DECLARE_bool(raft_enable_leader_leases);
+DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::consensus::HealthReportPB;
 using std::atomic;
@@ -1190,5 +1192,51 @@ TEST(ConsensusQueueUnitTest, PeerHealthStatus) {
   EXPECT_EQ(HealthReportPB::FAILED_UNRECOVERABLE, PeerMessageQueue::PeerHealthStatus(peer));
 }
 
+// Test that the leader holds a lease only while a majority of voters has
+// recently acknowledged its requests, and after committing an op in its term.
+TEST_F(ConsensusQueueTest, TestLeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  FLAGS_raft_heartbeat_interval_ms = 50;
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer(MakePeer("peer-1", RaftPeerPB::VOTER));
+  queue_->TrackPeer(MakePeer("peer-2", RaftPeerPB::VOTER));
+  AppendReplicateMessagesToQueue(queue_.get(), clock_.get(), 1, 5);
+  WaitForLocalPeerToAckIndex(5);
+
+  // The local peer alone isn't a majority.
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  ConsensusResponsePB response;
+  response.set_responder_term(kMinimumTerm);
+  response.set_responder_uuid("peer-1");
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(0, 5), MinimumOpId().index());
+
+  // A response only extends the lease as of the time its request was
+  // assembled, so acks for requests never sent don't count.
+  queue_->ResponseFromPeer(response.responder_uuid(), response);
+  ASSERT_EQ(5, queue_->GetCommittedIndex());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  ConsensusRequestPB request;
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer("peer-1", &request, &refs, &needs_tablet_copy));
+  ASSERT_EQ(0, request.ops_size());
+  queue_->ResponseFromPeer(response.responder_uuid(), response);
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+
+  // The lease expires if it isn't extended in time.
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  ASSERT_OK(queue_->RequestForPeer("peer-1", &request, &refs, &needs_tablet_copy));
+  queue_->ResponseFromPeer(response.responder_uuid(), response);
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+
+  // The lease is dropped along with leadership.
+  queue_->SetNonLeaderMode(BuildRaftConfigPBForTests(3));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+}
+
 }  // namespace consensus
 }  // namespace kudu
@@ -76,10 +76,22 @@ DEFINE_double(consensus_fail_log_read_ops, 0.0,
               "Fraction of the time when reading from the log cache will fail");
 TAG_FLAG(consensus_fail_log_read_ops, hidden);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether a leader holds a lease while a majority of voters has recently "
+            "acknowledged its requests, allowing it to serve snapshot scans of the "
+            "latest data at its safe time without waiting. The lease relies on the "
+            "rate of the monotonic clocks of the servers not diverging by more than "
+            "10%. Elections forced on a follower while the leader is alive, e.g. via "
+            "the RunLeaderElection RPC, aren't covered by the lease.");
+TAG_FLAG(raft_enable_leader_leases, experimental);
+TAG_FLAG(raft_enable_leader_leases, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_bool(safe_time_advancement_without_writes);
 DECLARE_int32(consensus_rpc_timeout_ms);
 DECLARE_int64(rpc_max_message_size);
+DECLARE_int32(raft_heartbeat_interval_ms);
+DECLARE_double(leader_failure_max_missed_heartbeat_periods);
 
 using kudu::log::Log;
 using kudu::pb_util::SecureDebugString;
@@ -148,6 +160,8 @@ PeerMessageQueue::TrackedPeer::TrackedPeer(RaftPeerPB peer_pb)
       last_known_committed_index(MinimumOpId().index()),
       last_exchange_status(PeerStatus::NEW),
       last_communication_time(MonoTime::Now()),
+      last_request_time(MonoTime::Min()),
+      lease_granted_time(MonoTime::Min()),
       wal_catchup_possible(true),
       remote_server_quiescing(false),
       last_overall_health_status(HealthReportPB::UNKNOWN),
@@ -205,6 +219,7 @@ PeerMessageQueue::PeerMessageQueue(const scoped_refptr<MetricEntity>& metric_ent
   queue_state_.last_idx_appended_to_leader = 0;
   queue_state_.mode = NON_LEADER;
   queue_state_.majority_size_ = -1;
+  queue_state_.leader_lease_revoked = false;
   queue_state_.last_appended = std::move(last_locally_replicated);
   queue_state_.committed_index = last_locally_committed.index();
   queue_state_.state = kQueueOpen;
@@ -216,10 +231,12 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
                                      int64_t current_term,
                                      const RaftConfigPB& active_config) {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
-  if (current_term != queue_state_.current_term) {
+  const bool term_changed = current_term != queue_state_.current_term;
+  if (term_changed) {
     CHECK_GT(current_term, queue_state_.current_term) << "Terms should only increase";
     queue_state_.first_index_in_current_term = boost::none;
     queue_state_.current_term = current_term;
+    queue_state_.leader_lease_revoked = false;
   }
 
   queue_state_.committed_index = committed_index;
@@ -239,8 +256,13 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
   const auto now = MonoTime::Now();
   for (const PeersMap::value_type& entry : peers_map_) {
     entry.second->last_communication_time = now;
+    // Requests acknowledged in a previous term don't count towards the lease.
+    if (term_changed) {
+      entry.second->lease_granted_time = MonoTime::Min();
+    }
   }
   time_manager_->SetLeaderMode();
+  UpdateLeaderLeaseUnlocked();
 }
 
 void PeerMessageQueue::SetNonLeaderMode(const RaftConfigPB& active_config) {
@@ -659,6 +681,7 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
       return Status::NotFound(Substitute("peer $0 is no longer tracked or "
                                          "queue is not in leader mode", uuid));
     }
+    peer->last_request_time = MonoTime::Now();
     peer_copy = *peer;
 
     // Clear the requests without deleting the entries, as they may be in use by other peers.
@@ -831,6 +854,11 @@ Status PeerMessageQueue::GetTabletCopyRequestForPeer(const string& uuid,
     if (PREDICT_FALSE(peer->last_exchange_status != PeerStatus::TABLET_NOT_FOUND)) {
       return Status::IllegalState("Peer does not need to initiate Tablet Copy", uuid);
     }
+    if (PREDICT_FALSE(queue_state_.active_config &&
+                      IsRaftConfigWitness(local_peer_pb_.permanent_uuid(),
+                                          *queue_state_.active_config))) {
+      return Status::NotSupported("witness replicas can't serve as a tablet copy source");
+    }
   }
   req->Clear();
   req->set_dest_uuid(uuid);
@@ -936,6 +964,47 @@ void PeerMessageQueue::EndWatchForSuccessor() {
   successor_watch_in_progress_ = false;
 }
 
+void PeerMessageQueue::UpdateLeaderLeaseUnlocked() {
+  DCHECK(queue_lock_.is_locked());
+  if (!FLAGS_raft_enable_leader_leases ||
+      queue_state_.mode != LEADER ||
+      queue_state_.leader_lease_revoked ||
+      queue_state_.first_index_in_current_term == boost::none ||
+      queue_state_.committed_index < *queue_state_.first_index_in_current_term) {
+    return;
+  }
+
+  const MonoTime now = MonoTime::Now();
+  vector<MonoTime> grant_times;
+  for (const auto& peer_pb : queue_state_.active_config->peers()) {
+    if (peer_pb.member_type() != RaftPeerPB::VOTER) {
+      continue;
+    }
+    if (peer_pb.permanent_uuid() == local_peer_pb_.permanent_uuid()) {
+      grant_times.emplace_back(now);
+      continue;
+    }
+    const TrackedPeer* peer = FindPtrOrNull(peers_map_, peer_pb.permanent_uuid());
+    grant_times.emplace_back(peer ? peer->lease_granted_time : MonoTime::Min());
+  }
+  const int majority_size = queue_state_.majority_size_;
+  if (majority_size <= 0 || static_cast<int>(grant_times.size()) < majority_size) {
+    return;
+  }
+  // Find the latest time by which a majority of voters granted the lease.
+  std::nth_element(grant_times.begin(), grant_times.begin() + majority_size - 1,
+                   grant_times.end(), std::greater<MonoTime>());
+  const MonoTime& granted = grant_times[majority_size - 1];
+  if (granted == MonoTime::Min()) {
+    return;
+  }
+  // Voters measure their vote-withholding period with their own clocks, so
+  // leave some slack for clock rate differences.
+  const MonoDelta lease_duration = MonoDelta::FromMilliseconds(static_cast<int64_t>(
+      0.9 * FLAGS_leader_failure_max_missed_heartbeat_periods * FLAGS_raft_heartbeat_interval_ms));
+  time_manager_->SetLeaderLeaseExpiration(granted + lease_duration);
+}
+
 void PeerMessageQueue::UpdateFollowerWatermarks(int64_t committed_index,
                                                 int64_t all_replicated_index) {
   std::lock_guard<simple_spinlock> l(queue_lock_);
@@ -1098,9 +1167,13 @@ void PeerMessageQueue::TransferLeadershipIfNeeded(const TrackedPeer& peer,
                                                   const ConsensusStatusPB& status) {
   DCHECK(queue_lock_.is_locked());
   bool server_quiescing = server_quiescing_ && *server_quiescing_;
+  // A witness leader can't serve clients, so it always looks for a successor,
+  // just like a leader on a quiescing server.
+  const bool local_is_witness = queue_state_.active_config &&
+      IsRaftConfigWitness(local_peer_pb_.permanent_uuid(), *queue_state_.active_config);
   // Only transfer leadership if the local peer has begun looking for a
   // successor, or if the server is quiescing. Otherwise, exit early.
-  if (!successor_watch_in_progress_ && !server_quiescing) {
+  if (!successor_watch_in_progress_ && !server_quiescing && !local_is_witness) {
     return;
   }
 
@@ -1122,7 +1195,8 @@ void PeerMessageQueue::TransferLeadershipIfNeeded(const TrackedPeer& peer,
   RaftPeerPB* peer_pb;
   Status s = GetRaftConfigMember(DCHECK_NOTNULL(queue_state_.active_config.get()),
                                  peer.uuid(), &peer_pb);
-  if (!s.ok() || peer_pb->member_type() != RaftPeerPB::VOTER) {
+  if (!s.ok() || peer_pb->member_type() != RaftPeerPB::VOTER ||
+      (peer_pb->has_attrs() && peer_pb->attrs().witness())) {
     return;
   }
 
@@ -1136,6 +1210,10 @@ void PeerMessageQueue::TransferLeadershipIfNeeded(const TrackedPeer& peer,
   VLOG(1) << "Successor watch: peer " << peer.uuid() << " is caught up to "
           << "the leader at OpId " << OpIdToString(status.last_received_current_leader());
   successor_watch_in_progress_ = false;
+  // The successor will ask for votes even though this leader is alive, so the
+  // lease can't be trusted from now on.
+  queue_state_.leader_lease_revoked = true;
+  time_manager_->SetLeaderLeaseExpiration(MonoTime::Min());
   NotifyObserversOfSuccessor(peer.uuid());
 }
 
@@ -1256,6 +1334,8 @@ bool PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
     // is just pending behind the lock we're holding), but any future leader will observe
     // the same watermarks and make the same advancement, so this is safe.
     if (mode_copy == LEADER) {
+      peer->lease_granted_time = peer->last_request_time;
+
       // Advance the majority replicated index.
       AdvanceQueueWatermark("majority_replicated",
                             &queue_state_.majority_replicated_index,
@@ -1307,6 +1387,8 @@ bool PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
                                      << commit_index_before << " to "
                                      << *updated_commit_index;
       }
+
+      UpdateLeaderLeaseUnlocked();
     }
 
     // If the peer's committed index is lower than our own, or if our log has
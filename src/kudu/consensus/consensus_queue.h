@@ -162,6 +162,16 @@ class PeerMessageQueue {
     // successful communication ever took place.
     MonoTime last_communication_time;
 
+    // The time at which the last request to the peer was assembled.
+    MonoTime last_request_time;
+
+    // The time at which the last request successfully processed by the peer
+    // in the current term was assembled, or MonoTime::Min() if there was none.
+    // The peer withholds its vote from other candidates for at least the
+    // minimum election timeout past this time, which is what the leader lease
+    // is based on.
+    MonoTime lease_granted_time;
+
     // Set to false if it is determined that the remote peer has fallen behind
     // the local peer's WAL.
     bool wal_catchup_possible;
@@ -433,6 +443,10 @@ class PeerMessageQueue {
     // The size of the majority for the queue.
     int majority_size_;
 
+    // Whether the leader lease may no longer be extended in the current term,
+    // because leadership is being transferred to another peer.
+    bool leader_lease_revoked;
+
     State state;
 
     // The current mode of the queue.
@@ -478,6 +492,13 @@ class PeerMessageQueue {
   void TransferLeadershipIfNeeded(const TrackedPeer& peer,
                                   const ConsensusStatusPB& status);
 
+  // Extends the leader lease held by the local peer in the TimeManager up to
+  // the minimum election timeout past the latest time by which a majority of
+  // voters have processed a request of the current term.
+  //
+  // No lease is held until an op of the current term has been committed.
+  void UpdateLeaderLeaseUnlocked();
+
   // Calculate a peer's up-to-date health status based on internal fields.
   static HealthReportPB::HealthStatus PeerHealthStatus(const TrackedPeer& peer);
 
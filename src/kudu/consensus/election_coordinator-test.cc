@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/election_coordinator.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(raft_max_concurrent_elections);
+
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace consensus {
+
+class ElectionCoordinatorTest : public KuduTest {
+ protected:
+  ElectionCoordinatorTest()
+      : coordinator_(make_shared<ElectionCoordinator>()) {
+  }
+
+  // Schedules an election named 'name', whose slot is kept in 'slots_'.
+  void Schedule(const string& name, bool urgent) {
+    coordinator_->Schedule(urgent, [this, name](shared_ptr<ElectionCoordinator::Slot> slot) {
+      started_.push_back(name);
+      slots_.push_back(std::move(slot));
+    });
+  }
+
+  // Releasing a slot may start other elections, which add their slots to
+  // 'slots_': the slots are taken out of it before being released.
+  void ReleaseFirst() {
+    shared_ptr<ElectionCoordinator::Slot> slot = std::move(slots_.front());
+    slots_.erase(slots_.begin());
+  }
+
+  void ReleaseAll() {
+    vector<shared_ptr<ElectionCoordinator::Slot>> slots;
+    slots.swap(slots_);
+  }
+
+  shared_ptr<ElectionCoordinator> coordinator_;
+  vector<string> started_;
+  vector<shared_ptr<ElectionCoordinator::Slot>> slots_;
+};
+
+TEST_F(ElectionCoordinatorTest, TestLiveness) {
+  const MonoDelta kLong = MonoDelta::FromSeconds(60);
+  ASSERT_FALSE(coordinator_->HeardFromRecently("a", kLong));
+  coordinator_->RecordContact("a");
+  ASSERT_TRUE(coordinator_->HeardFromRecently("a", kLong));
+  ASSERT_FALSE(coordinator_->HeardFromRecently("b", kLong));
+  SleepFor(MonoDelta::FromMilliseconds(10));
+  ASSERT_FALSE(coordinator_->HeardFromRecently("a", MonoDelta::FromMilliseconds(5)));
+  coordinator_->RecordContact("a");
+  ASSERT_TRUE(coordinator_->HeardFromRecently("a", MonoDelta::FromMilliseconds(5)));
+}
+
+TEST_F(ElectionCoordinatorTest, TestNoLimit) {
+  for (int i = 0; i < 10; i++) {
+    Schedule("e", /*urgent=*/false);
+  }
+  ASSERT_EQ(10, started_.size());
+  ASSERT_EQ(10, coordinator_->num_running());
+  ReleaseAll();
+  ASSERT_EQ(0, coordinator_->num_running());
+}
+
+// At most --raft_max_concurrent_elections elections run at once, the urgent
+// ones going first.
+TEST_F(ElectionCoordinatorTest, TestStaggering) {
+  FLAGS_raft_max_concurrent_elections = 2;
+  Schedule("a", /*urgent=*/false);
+  Schedule("b", /*urgent=*/false);
+  Schedule("c", /*urgent=*/false);
+  Schedule("d", /*urgent=*/true);
+  ASSERT_EQ(vector<string>({ "a", "b" }), started_);
+  ASSERT_EQ(2, coordinator_->num_waiting());
+
+  ReleaseFirst();
+  ASSERT_EQ(vector<string>({ "a", "b", "d" }), started_);
+  ReleaseFirst();
+  ASSERT_EQ(vector<string>({ "a", "b", "d", "c" }), started_);
+  ASSERT_EQ(0, coordinator_->num_waiting());
+  ASSERT_EQ(2, coordinator_->num_running());
+
+  // Lifting the limit lets the waiting elections start as slots are released.
+  Schedule("e", /*urgent=*/false);
+  FLAGS_raft_max_concurrent_elections = 0;
+  ReleaseAll();
+  ASSERT_EQ(5, started_.size());
+  ReleaseAll();
+  ASSERT_EQ(0, coordinator_->num_running());
+}
+
+// Elections which release their slot right away, e.g. those which fail to
+// start, let the others start without nesting.
+TEST_F(ElectionCoordinatorTest, TestImmediateRelease) {
+  FLAGS_raft_max_concurrent_elections = 1;
+  Schedule("first", /*urgent=*/false);
+  int started = 0;
+  for (int i = 0; i < 100000; i++) {
+    coordinator_->Schedule(false, [&](shared_ptr<ElectionCoordinator::Slot> /*slot*/) {
+      started++;
+    });
+  }
+  ReleaseAll();
+  ASSERT_EQ(100000, started);
+  ASSERT_EQ(0, coordinator_->num_waiting());
+  ASSERT_EQ(0, coordinator_->num_running());
+}
+
+} // namespace consensus
+} // namespace kudu
@@ -0,0 +1,148 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/election_coordinator.h"
+
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(raft_max_concurrent_elections, 0,
+             "The maximum number of leader elections the replicas of a server "
+             "run at once on failure of their leaders, the others waiting for "
+             "their turn. Elections of the tablets whose leader's server seems "
+             "to be down are started first. 0 means no limit.");
+DEFINE_validator(raft_max_concurrent_elections,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(raft_max_concurrent_elections, advanced);
+TAG_FLAG(raft_max_concurrent_elections, experimental);
+TAG_FLAG(raft_max_concurrent_elections, runtime);
+
+using std::shared_ptr;
+using std::string;
+
+namespace kudu {
+namespace consensus {
+
+ElectionCoordinator::Slot::Slot(shared_ptr<ElectionCoordinator> coordinator)
+    : coordinator_(std::move(coordinator)) {
+}
+
+ElectionCoordinator::Slot::~Slot() {
+  coordinator_->Release();
+}
+
+ElectionCoordinator::ElectionCoordinator()
+    : num_running_(0),
+      starting_(false) {
+}
+
+ElectionCoordinator::~ElectionCoordinator() {}
+
+void ElectionCoordinator::RecordContact(const string& uuid) {
+  const int64_t now = GetMonoTimeMicros();
+  {
+    shared_lock<rw_spinlock> l(contacts_lock_);
+    const auto* last = FindOrNull(last_contact_micros_, uuid);
+    if (last) {
+      (*last)->store(now, std::memory_order_relaxed);
+      return;
+    }
+  }
+  std::lock_guard<rw_spinlock> l(contacts_lock_);
+  auto& last = last_contact_micros_[uuid];
+  if (!last) {
+    last.reset(new std::atomic<int64_t>(0));
+  }
+  last->store(now, std::memory_order_relaxed);
+}
+
+bool ElectionCoordinator::HeardFromRecently(const string& uuid, const MonoDelta& timeout) const {
+  const int64_t now = GetMonoTimeMicros();
+  shared_lock<rw_spinlock> l(contacts_lock_);
+  const auto* last = FindOrNull(last_contact_micros_, uuid);
+  return last && now - (*last)->load(std::memory_order_relaxed) < timeout.ToMicroseconds();
+}
+
+void ElectionCoordinator::Schedule(bool urgent, StartCallback start) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (FLAGS_raft_max_concurrent_elections > 0 &&
+        (starting_ || num_running_ >= FLAGS_raft_max_concurrent_elections ||
+         !urgent_.empty() || !waiting_.empty())) {
+      (urgent ? urgent_ : waiting_).emplace_back(std::move(start));
+      return;
+    }
+    num_running_++;
+  }
+  start(shared_ptr<Slot>(new Slot(shared_from_this())));
+}
+
+void ElectionCoordinator::Release() {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    num_running_--;
+  }
+  StartWaiting();
+}
+
+void ElectionCoordinator::StartWaiting() {
+  while (true) {
+    StartCallback start;
+    {
+      std::lock_guard<simple_spinlock> l(lock_);
+      if (starting_) {
+        return;
+      }
+      // The limit may have been lifted at runtime.
+      const bool has_slot = FLAGS_raft_max_concurrent_elections == 0 ||
+                            num_running_ < FLAGS_raft_max_concurrent_elections;
+      auto& queue = urgent_.empty() ? waiting_ : urgent_;
+      if (!has_slot || queue.empty()) {
+        return;
+      }
+      start = std::move(queue.front());
+      queue.pop_front();
+      num_running_++;
+      starting_ = true;
+    }
+    // An election which fails to start releases its slot right away: the
+    // slots are handed out iteratively rather than recursively, the nested
+    // Release() leaving it to this loop.
+    start(shared_ptr<Slot>(new Slot(shared_from_this())));
+    std::lock_guard<simple_spinlock> l(lock_);
+    starting_ = false;
+  }
+}
+
+int ElectionCoordinator::num_waiting() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return urgent_.size() + waiting_.size();
+}
+
+int ElectionCoordinator::num_running() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return num_running_;
+}
+
+} // namespace consensus
+} // namespace kudu
@@ -0,0 +1,122 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace consensus {
+
+// Coordinates the leader elections of the Raft replicas of a server, which
+// would otherwise each detect the failure of their leader on their own.
+//
+// When a server dies, all the replicas it led time out at about the same
+// time, and their thousands of concurrent elections (pre-elections, vote
+// requests, and the flushes of the consensus metadata of the voters) slow each
+// other down to the point where leadership takes far longer to be restored
+// than a single election does. The coordinator instead:
+//
+// - tracks the liveness of the remote servers for the whole server: any
+//   request accepted from a leader replica is a sign of life of its server,
+//   whichever tablet it is for.
+//
+// - lets at most --raft_max_concurrent_elections elections run at once, the
+//   others waiting for their turn. The elections of the tablets whose leader
+//   is on a server no replica has heard from lately, which are unavailable
+//   for sure, go before the others. Replicas whose turn comes after their
+//   leader sent them a request again are expected not to run the election.
+//
+// This class is thread-safe.
+class ElectionCoordinator : public std::enable_shared_from_this<ElectionCoordinator> {
+ public:
+  // A slot for a running election, released when destroyed. Slots keep the
+  // coordinator alive.
+  class Slot {
+   public:
+    ~Slot();
+
+   private:
+    friend class ElectionCoordinator;
+    explicit Slot(std::shared_ptr<ElectionCoordinator> coordinator);
+
+    const std::shared_ptr<ElectionCoordinator> coordinator_;
+
+    DISALLOW_COPY_AND_ASSIGN(Slot);
+  };
+
+  typedef std::function<void(std::shared_ptr<Slot>)> StartCallback;
+
+  ElectionCoordinator();
+  ~ElectionCoordinator();
+
+  // Records that a request of the leader replica of some tablet on the server
+  // 'uuid' was just accepted.
+  void RecordContact(const std::string& uuid);
+
+  // Returns whether a request of the server 'uuid' was accepted within the
+  // last 'timeout'.
+  bool HeardFromRecently(const std::string& uuid, const MonoDelta& timeout) const;
+
+  // Calls 'start' with a slot once one is available: right away if there's
+  // one, and otherwise when a running election releases its slot, in which
+  // case 'start' runs on the thread releasing it and must not block. Urgent
+  // elections go before the non-urgent ones waiting.
+  //
+  // The slot must be held for as long as the election runs.
+  void Schedule(bool urgent, StartCallback start);
+
+  // Returns the number of elections waiting for a slot.
+  int num_waiting() const;
+
+  // Returns the number of slots held.
+  int num_running() const;
+
+ private:
+  // Releases a slot, and starts the waiting elections there are slots for.
+  void Release();
+  void StartWaiting();
+
+  // Protects 'last_contact_micros_'. The times themselves are atomics so that
+  // recording a contact with a known server only takes the lock in shared mode.
+  mutable rw_spinlock contacts_lock_;
+  std::unordered_map<std::string, std::unique_ptr<std::atomic<int64_t>>> last_contact_micros_;
+
+  // Protects the fields below.
+  mutable simple_spinlock lock_;
+  std::deque<StartCallback> urgent_;
+  std::deque<StartCallback> waiting_;
+  int num_running_;
+
+  // Whether a thread is starting waiting elections, in which case the others
+  // releasing their slots leave it to that thread.
+  bool starting_;
+
+  DISALLOW_COPY_AND_ASSIGN(ElectionCoordinator);
+};
+
+} // namespace consensus
+} // namespace kudu
@@ -64,11 +64,19 @@ DEFINE_int32(num_batches, 10000,
              "Number of batches to write to/read from the Log in TestWriteManyBatches");
 
 DECLARE_int32(log_min_segments_to_retain);
+DECLARE_int32(log_max_recycled_segments);
 DECLARE_int32(log_max_segments_to_retain);
 DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_string(log_compression_codec);
+DECLARE_bool(log_compress_before_append);
+DECLARE_bool(log_inject_latency);
+DECLARE_int32(log_group_commit_max_wait_us);
+DECLARE_int32(log_inject_latency_ms_mean);
+DECLARE_int32(log_inject_latency_ms_stddev);
+
+METRIC_DECLARE_histogram(log_group_commit_wait);
 
 namespace kudu {
 namespace log {
@@ -233,6 +241,59 @@ TEST_P(LogTestOptionalCompression, TestMultipleEntriesInABatch) {
   ASSERT_OK(log_->Close());
 }
 
+// Batches compressed before reaching the append thread must be readable like
+// those compressed by the append thread.
+TEST_P(LogTestOptionalCompression, TestCompressBeforeAppend) {
+  FLAGS_log_compress_before_append = true;
+  ASSERT_OK(BuildLog());
+
+  OpId opid;
+  opid.set_term(1);
+  opid.set_index(1);
+  const int kNumBatches = 10;
+  const int kOpsPerBatch = 5;
+  for (int i = 0; i < kNumBatches; i++) {
+    ASSERT_OK(AppendNoOpsToLogSync(clock_.get(), log_.get(), &opid, kOpsPerBatch));
+  }
+  ASSERT_OK(log_->AllocateSegmentAndRollOverForTests());
+
+  SegmentSequence segments;
+  log_->reader()->GetSegmentsSnapshot(&segments);
+  LogEntries entries;
+  ASSERT_OK(segments[0]->ReadEntries(&entries));
+  ASSERT_EQ(kNumBatches * kOpsPerBatch, entries.size());
+  for (int i = 0; i < entries.size(); i++) {
+    ASSERT_EQ(i + 1, entries[i]->replicate().id().index());
+  }
+  ASSERT_OK(log_->Close());
+}
+
+// With slow syncs and a steady stream of appends, the append thread should
+// wait for more batches before syncing a group, without losing any of them.
+TEST_P(LogTestOptionalCompression, TestAdaptiveGroupCommit) {
+  FLAGS_log_group_commit_max_wait_us = 500;
+  FLAGS_log_inject_latency = true;
+  FLAGS_log_inject_latency_ms_mean = 2;
+  FLAGS_log_inject_latency_ms_stddev = 0;
+  ASSERT_OK(BuildLog());
+
+  const int kNumBatches = 200;
+  for (int i = 1; i <= kNumBatches; i++) {
+    ASSERT_OK(AppendReplicateBatch(MakeOpId(1, i), APPEND_ASYNC));
+    SleepFor(MonoDelta::FromMicroseconds(50));
+  }
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  ASSERT_GT(METRIC_log_group_commit_wait.Instantiate(metric_entity_tablet_)->TotalCount(), 0);
+
+  ASSERT_OK(log_->AllocateSegmentAndRollOverForTests());
+  SegmentSequence segments;
+  log_->reader()->GetSegmentsSnapshot(&segments);
+  LogEntries entries;
+  ASSERT_OK(segments[0]->ReadEntries(&entries));
+  ASSERT_EQ(kNumBatches, entries.size());
+  ASSERT_OK(log_->Close());
+}
+
 // Tests that everything works properly with fsync enabled:
 // This also tests SyncDir() (see KUDU-261), which is called whenever
 // a new log segment is initialized.
@@ -607,6 +668,68 @@ TEST_P(LogTestOptionalCompression, TestGCWithLogRunning) {
   }
 }
 
+// Test that the files of GCed segments are reused for the next segments, with
+// nothing of their previous contents showing.
+TEST_P(LogTestOptionalCompression, TestRecycleSegments) {
+  FLAGS_log_min_segments_to_retain = 1;
+  FLAGS_log_max_recycled_segments = 1;
+  ASSERT_OK(BuildLog());
+
+  vector<LogAnchor*> anchors;
+  ElementDeleter deleter(&anchors);
+  const int kNumOpsPerSegment = 5;
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendMultiSegmentSequence(3, kNumOpsPerSegment, &op_id, &anchors));
+
+  const string wal_dir = JoinPathSegments(fs_manager_->GetWalsRootDir(), kTestTablet);
+  auto count_recycled_files = [&]() {
+    vector<string> files;
+    CHECK_OK(env_->GetChildren(wal_dir, &files));
+    return std::count_if(files.begin(), files.end(), [](const string& f) {
+      return f.find(".recycled.") != string::npos;
+    });
+  };
+
+  // Of the two segments GCed, only one is kept for recycling.
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[0]));
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[1]));
+  RetentionIndexes retention;
+  ASSERT_OK(log_anchor_registry_->GetEarliestRegisteredLogIndex(&retention.for_durability));
+  int num_gced_segments;
+  ASSERT_OK(log_->GC(retention, &num_gced_segments));
+  ASSERT_EQ(2, num_gced_segments);
+  NO_FATALS(CheckRightNumberOfSegmentFiles(1));
+  ASSERT_EQ(1, count_recycled_files());
+
+  // The next segment reuses the file. Though its previous contents are past
+  // the entries written since, the segment reads as those entries only, even
+  // before it's closed.
+  ASSERT_OK(RollLog());
+  ASSERT_EQ(0, count_recycled_files());
+  NO_FATALS(CheckRightNumberOfSegmentFiles(2));
+  ASSERT_OK(AppendNoOps(&op_id, 2));
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  scoped_refptr<ReadableLogSegment> segment;
+  ASSERT_OK(ReadableLogSegment::Open(env_, nullptr, log_->ActiveSegmentPathForTests(),
+                                     &segment));
+  LogEntries entries;
+  ASSERT_OK(segment->ReadEntries(&entries));
+  ASSERT_EQ(2, entries.size());
+
+  // Files kept for recycling don't outlive the log.
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[2]));
+  CreateAndRegisterNewAnchor(op_id.index(), &anchors);
+  ASSERT_OK(RollLog());
+  ASSERT_OK(log_anchor_registry_->GetEarliestRegisteredLogIndex(&retention.for_durability));
+  ASSERT_OK(log_->GC(retention, &num_gced_segments));
+  ASSERT_EQ(2, num_gced_segments);
+  ASSERT_EQ(1, count_recycled_files());
+  ASSERT_OK(log_->Close());
+  ASSERT_EQ(0, count_recycled_files());
+  NO_FATALS(CheckRightNumberOfSegmentFiles(1));
+  ASSERT_OK(log_anchor_registry_->Unregister(anchors[3]));
+}
+
 // Test that, when we are set to retain a given number of log segments,
 // we also retain any relevant log index chunks, even if those operations
 // are not necessary for recovery.
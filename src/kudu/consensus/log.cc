@@ -17,6 +17,7 @@
 
 #include "kudu/consensus/log.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdint>
 #include <functional>
@@ -34,6 +35,7 @@
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_reader.h"
+#include "kudu/consensus/log_sync_group.h"
 #include "kudu/consensus/log_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/atomicops.h"
@@ -95,9 +97,31 @@ TAG_FLAG(log_thread_idle_threshold_ms, hidden);
 // Compression configuration.
 // -----------------------------
 DEFINE_string(log_compression_codec, "LZ4",
-              "Codec to use for compressing WAL segments.");
+              "Codec to use for compressing WAL segments. One of no_compression, "
+              "snappy, lz4, zlib or zstd.");
 TAG_FLAG(log_compression_codec, experimental);
 
+DEFINE_bool(log_compress_before_append, false,
+            "Whether log entry batches are compressed by the threads submitting "
+            "them, before they are queued for the log append thread, rather than "
+            "by the append thread itself. Lets the compression of concurrently "
+            "submitted batches proceed in parallel instead of delaying the group "
+            "commit of every tablet write.");
+TAG_FLAG(log_compress_before_append, advanced);
+TAG_FLAG(log_compress_before_append, experimental);
+TAG_FLAG(log_compress_before_append, runtime);
+
+DEFINE_int32(log_group_commit_max_wait_us, 0,
+             "Maximum time in microseconds the log append thread may wait for more "
+             "entry batches to arrive before syncing a group, so that they share a "
+             "single fsync. The actual wait adapts to the observed sync latency and "
+             "batch arrival rate, and no wait happens if no more batches are expected "
+             "in time. A few hundred microseconds is a reasonable value when the WAL "
+             "is fsynced. If 0, groups are synced as soon as they are drained.");
+TAG_FLAG(log_group_commit_max_wait_us, advanced);
+TAG_FLAG(log_group_commit_max_wait_us, experimental);
+TAG_FLAG(log_group_commit_max_wait_us, runtime);
+
 // Fault/latency injection flags.
 // -----------------------------
 DEFINE_bool(log_inject_latency, false,
@@ -153,6 +177,30 @@ TAG_FLAG(log_segment_size_bytes_for_tests, unsafe);
 // -----------------------------
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 
+DEFINE_bool(log_group_commit_across_tablets, false,
+            "Whether the WALs of all the tablets on a tablet server make their "
+            "appends durable together with one syncfs() of the WAL filesystem, "
+            "rather than each with an fsync() of its own active segment. On "
+            "servers with many replicas, this turns many small fsyncs into few "
+            "and larger ones. Only effective with --log_force_fsync_all, on "
+            "Linux, and works best when the WAL directory is on its own "
+            "filesystem, since syncfs() also flushes any other dirty data of "
+            "the filesystem. On Linux before 5.8, whose syncfs() doesn't report "
+            "write errors, the logs fsync() their own segments instead.");
+TAG_FLAG(log_group_commit_across_tablets, advanced);
+TAG_FLAG(log_group_commit_across_tablets, experimental);
+
+DEFINE_int32(log_max_recycled_segments, 0,
+             "The number of the WAL segments removed by log GC that each "
+             "tablet's log keeps, to reuse their files as those of its next "
+             "segments rather than creating and preallocating new files. The "
+             "contents of the reused files are zeroed, lazily where the "
+             "filesystem supports it. The segments of encrypted WALs are never "
+             "recycled. 0 disables the recycling of segments.");
+TAG_FLAG(log_max_recycled_segments, advanced);
+TAG_FLAG(log_max_recycled_segments, experimental);
+TAG_FLAG(log_max_recycled_segments, runtime);
+
 DEFINE_bool(fs_wal_use_file_cache, true,
             "Whether to use the server-wide file cache for WAL segments and "
             "WAL index chunks.");
@@ -249,10 +297,26 @@ class Log::AppendThread {
   // Handle the actual appending of a group of entries.
   void HandleBatches(vector<unique_ptr<LogEntryBatch>> entry_batches);
 
+  // Updates the estimated batch arrival interval given that 'num_batches' were
+  // just drained from the queue.
+  void UpdateArrivalInterval(size_t num_batches);
+
+  // If the group in 'entry_batches' needs to be synced and more batches are
+  // expected to arrive shortly, waits a bit for them and adds them to the
+  // group, so that they share its fsync. See --log_group_commit_max_wait_us.
+  void WaitForMoreBatches(vector<unique_ptr<LogEntryBatch>>* entry_batches);
+
   string LogPrefix() const;
 
   Log* const log_;
 
+  // Exponentially-weighted moving averages of the log sync latency and of the
+  // interval between consecutive entry batches, in microseconds. Only accessed
+  // by the append task.
+  double sync_latency_ewma_us_ = 0;
+  double arrival_interval_ewma_us_ = 0;
+  MonoTime last_drain_time_;
+
   // Atomic state machine for whether there is any task currently queued or
   // running on append_pool_. See Wake() and GoIdle() for more details.
   enum ThreadState {
@@ -356,12 +420,68 @@ void Log::AppendThread::ProcessQueue() {
       if (GoIdle()) break;
       continue;
     }
+    UpdateArrivalInterval(entry_batches.size());
+    WaitForMoreBatches(&entry_batches);
     HandleBatches(std::move(entry_batches));
   }
   log_->SetActiveSegmentIdle();
   VLOG_WITH_PREFIX(2) << "WAL Appender going idle";
 }
 
+namespace {
+// Weight of the latest sample in the moving averages used for adaptive group
+// commit.
+constexpr double kGroupCommitEwmaWeight = 0.2;
+
+void UpdateEwma(double sample, double* ewma) {
+  *ewma = *ewma == 0 ? sample
+                     : kGroupCommitEwmaWeight * sample + (1 - kGroupCommitEwmaWeight) * *ewma;
+}
+} // anonymous namespace
+
+void Log::AppendThread::UpdateArrivalInterval(size_t num_batches) {
+  const MonoTime now = MonoTime::Now();
+  if (last_drain_time_.Initialized() && num_batches > 0) {
+    UpdateEwma((now - last_drain_time_).ToMicroseconds() / static_cast<double>(num_batches),
+               &arrival_interval_ewma_us_);
+  }
+  last_drain_time_ = now;
+}
+
+void Log::AppendThread::WaitForMoreBatches(vector<unique_ptr<LogEntryBatch>>* entry_batches) {
+  const int32_t max_wait_us = FLAGS_log_group_commit_max_wait_us;
+  if (max_wait_us <= 0 || sync_latency_ewma_us_ == 0 || arrival_interval_ewma_us_ == 0) {
+    return;
+  }
+  // Groups made only of commits aren't synced, so there's nothing to save.
+  if (std::all_of(entry_batches->begin(), entry_batches->end(),
+                  [](const unique_ptr<LogEntryBatch>& b) { return b->type_ == COMMIT; })) {
+    return;
+  }
+  // Delaying a group for longer than half a sync would cost more latency than
+  // coalescing saves, and waiting only pays off if another batch is expected
+  // to arrive in the meantime.
+  const double wait_us = std::min<double>(max_wait_us, sync_latency_ewma_us_ / 2);
+  if (arrival_interval_ewma_us_ > wait_us) {
+    return;
+  }
+
+  const MonoTime start = MonoTime::Now();
+  const MonoTime deadline = start + MonoDelta::FromMicroseconds(static_cast<int64_t>(wait_us));
+  while (MonoTime::Now() < deadline) {
+    if (!log_->entry_queue()->BlockingDrainTo(entry_batches, deadline).ok()) {
+      // Either the deadline passed or the queue is shutting down; in both
+      // cases the group collected so far is appended right away.
+      break;
+    }
+  }
+  const MonoTime now = MonoTime::Now();
+  last_drain_time_ = now;
+  if (log_->ctx_.metrics) {
+    log_->ctx_.metrics->group_commit_wait->Increment((now - start).ToMicroseconds());
+  }
+}
+
 void Log::AppendThread::HandleBatches(vector<unique_ptr<LogEntryBatch>> entry_batches) {
   if (log_->ctx_.metrics) {
     log_->ctx_.metrics->entry_batches_per_group->Increment(entry_batches.size());
@@ -389,7 +509,9 @@ void Log::AppendThread::HandleBatches(vector<unique_ptr<LogEntryBatch>> entry_ba
 
   Status s;
   if (!is_all_commits) {
+    const MonoTime sync_start = MonoTime::Now();
     s = log_->Sync();
+    UpdateEwma((MonoTime::Now() - sync_start).ToMicroseconds(), &sync_latency_ewma_us_);
   }
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX(ERROR) << "Error syncing log: " << s.ToString();
@@ -440,11 +562,16 @@ SegmentAllocator::SegmentAllocator(const LogOptions* opts,
               : opts_->segment_size_mb * 1024 * 1024),
       schema_(std::move(schema)),
       schema_version_(schema_version),
-      sync_disabled_(false) {}
+      sync_disabled_(false),
+      sync_group_(nullptr) {}
 
 Status SegmentAllocator::Init(
     uint64_t sequence_number,
     scoped_refptr<ReadableLogSegment>* new_readable_segment) {
+  if (FLAGS_log_group_commit_across_tablets) {
+    sync_group_ = LogSyncGroup::Get(ctx_->fs_manager->env(),
+                                    ctx_->fs_manager->GetWalsRootDir());
+  }
   // Init the compression codec.
   RETURN_NOT_OK_PREPEND(GetCompressionCodec(
       GetCompressionCodecType(FLAGS_log_compression_codec), &codec_),
@@ -509,7 +636,14 @@ Status SegmentAllocator::Sync() {
 
   if (opts_->force_fsync_all) {
     LOG_SLOW_EXECUTION(WARNING, 50, Substitute("$0Fsync log took a long time", LogPrefix())) {
-      RETURN_NOT_OK(active_segment_->Sync());
+      Status s = sync_group_ ? sync_group_->Sync() : active_segment_->Sync();
+      if (PREDICT_FALSE(s.IsNotSupported())) {
+        KLOG_FIRST_N(WARNING, 1) << LogPrefix() << "Can't group-commit WALs: "
+                                 << s.ToString() << ". Falling back to fsync()";
+        sync_group_ = nullptr;
+        s = active_segment_->Sync();
+      }
+      RETURN_NOT_OK(s);
       if (hooks_) {
         RETURN_NOT_OK_PREPEND(hooks_->PostSyncIfFsyncEnabled(),
                               "PostSyncIfFsyncEnabled hook failed");
@@ -590,6 +724,45 @@ void SegmentAllocator::StopAllocationThread() {
   allocation_pool_->Shutdown();
 }
 
+Status SegmentAllocator::RecycleSegment(const string& path, bool* recycled) {
+  *recycled = false;
+  Env* env = ctx_->fs_manager->env();
+  // Reusing the file of an encrypted segment would reuse its key.
+  if (env->IsEncryptionEnabled()) {
+    return Status::OK();
+  }
+  {
+    std::lock_guard<simple_spinlock> l(recycled_lock_);
+    if (FLAGS_log_max_recycled_segments <= 0 ||
+        recycled_segment_paths_.size() >= FLAGS_log_max_recycled_segments) {
+      return Status::OK();
+    }
+  }
+  // The file is renamed so that it's no longer mistaken for a segment, and is
+  // deleted at startup if it remains.
+  const string recycled_path = JoinPathSegments(
+      ctx_->log_dir, Substitute("$0.recycled.$1", kTmpInfix, BaseName(path)));
+  RETURN_NOT_OK_PREPEND(env->RenameFile(path, recycled_path),
+                        "could not rename WAL segment to recycle it");
+  VLOG_WITH_PREFIX(1) << "Recycled WAL segment " << path << " as " << recycled_path;
+  std::lock_guard<simple_spinlock> l(recycled_lock_);
+  recycled_segment_paths_.emplace_back(recycled_path);
+  *recycled = true;
+  return Status::OK();
+}
+
+void SegmentAllocator::DeleteRecycledSegments() {
+  std::deque<string> paths;
+  {
+    std::lock_guard<simple_spinlock> l(recycled_lock_);
+    paths.swap(recycled_segment_paths_);
+  }
+  for (const auto& path : paths) {
+    WARN_NOT_OK(ctx_->fs_manager->env()->DeleteFile(path),
+                Substitute("$0could not delete recycled WAL segment", LogPrefix()));
+  }
+}
+
 Status SegmentAllocator::AllocateSegmentAndRollOver(
     scoped_refptr<ReadableLogSegment>* finished_segment,
     scoped_refptr<ReadableLogSegment>* new_readable_segment) {
@@ -631,6 +804,14 @@ Status SegmentAllocator::AllocateNewSegment() {
     allocation_state_ = kAllocationFinished;
   });
 
+  bool reused = false;
+  Status s = ReuseRecycledSegment(&reused);
+  if (reused) {
+    VLOG_WITH_PREFIX(1) << "Reused recycled WAL segment " << next_segment_path_;
+    return Status::OK();
+  }
+  WARN_NOT_OK(s, Substitute("$0could not reuse recycled WAL segment", LogPrefix()));
+
   // We could create the new segment file through the cache, but that's tricky
   // because of the file rename that'll happen later. So instead, we'll create
   // it outside the cache now, then reopen via the cache when we switch to it.
@@ -664,6 +845,46 @@ Status SegmentAllocator::AllocateNewSegment() {
   return Status::OK();
 }
 
+Status SegmentAllocator::ReuseRecycledSegment(bool* reused) {
+  *reused = false;
+  string path;
+  {
+    std::lock_guard<simple_spinlock> l(recycled_lock_);
+    if (recycled_segment_paths_.empty()) {
+      return Status::OK();
+    }
+    path = std::move(recycled_segment_paths_.front());
+    recycled_segment_paths_.pop_front();
+  }
+  Env* env = ctx_->fs_manager->env();
+  auto delete_file = MakeScopedCleanup([&]() {
+    WARN_NOT_OK(env->DeleteFile(path),
+                Substitute("$0could not delete recycled WAL segment", LogPrefix()));
+  });
+  RWFileOptions opts;
+  opts.mode = Env::MUST_EXIST;
+  opts.is_sensitive = true;
+  unique_ptr<RWFile> segment_file;
+  RETURN_NOT_OK_PREPEND(env->NewRWFile(opts, path, &segment_file),
+                        "could not reopen recycled WAL segment");
+  uint64_t size;
+  RETURN_NOT_OK(segment_file->Size(&size));
+
+  // The end of a segment that wasn't closed is found by the zeros following
+  // its last entry, so nothing may be left of the previous contents. Zeroing
+  // the range keeps the file's extents allocated, which is what makes this
+  // cheaper than preallocating a new file.
+  const uint64_t zeroed_size = opts_->preallocate_segments ?
+      std::max<uint64_t>(size, max_segment_size_) : size;
+  RETURN_NOT_OK_PREPEND(segment_file->ZeroRange(0, zeroed_size),
+                        "could not zero recycled WAL segment");
+  delete_file.cancel();
+  next_segment_path_ = std::move(path);
+  next_segment_file_.reset(segment_file.release());
+  *reused = true;
+  return Status::OK();
+}
+
 Status SegmentAllocator::SwitchToAllocatedSegment(
     scoped_refptr<ReadableLogSegment>* new_readable_segment) {
   // Increment "next" log segment seqno.
@@ -845,6 +1066,16 @@ Status Log::AsyncAppend(unique_ptr<LogEntryBatch> entry_batch) {
   // address is stored, the pointer isn't de-referenced.
   const LogEntryBatch* entry_batch_trace_id = entry_batch.get();
   TRACE_EVENT_FLOW_BEGIN0("log", "Batch", entry_batch_trace_id);
+  if (FLAGS_log_compress_before_append && segment_allocator_.codec_ &&
+      entry_batch->total_size_bytes() > 0) {
+    Status s = entry_batch->Compress(segment_allocator_.codec_);
+    if (PREDICT_FALSE(!s.ok())) {
+      // The append thread retries the compression, and fails the batch if
+      // that fails too.
+      KLOG_EVERY_N_SECS(WARNING, 10) << LogPrefix() << "Unable to compress log entry batch: "
+                                     << s.ToString();
+    }
+  }
   if (PREDICT_FALSE(!entry_batch_queue_.BlockingPut(std::move(entry_batch)).ok())) {
     TRACE_EVENT_FLOW_END0("log", "Batch", entry_batch_trace_id);
     return kLogShutdownStatus;
@@ -921,7 +1152,12 @@ Status Log::WriteBatch(LogEntryBatch* entry_batch) {
     SCOPED_LATENCY_METRIC(ctx_.metrics, append_latency);
     SCOPED_WATCH_STACK(500);
 
-    RETURN_NOT_OK(active_segment->WriteEntryBatch(entry_batch_data, segment_allocator_.codec_));
+    if (entry_batch->is_compressed()) {
+      RETURN_NOT_OK(active_segment->WriteCompressedEntryBatch(
+          entry_batch_data, entry_batch->uncompressed_size()));
+    } else {
+      RETURN_NOT_OK(active_segment->WriteEntryBatch(entry_batch_data, segment_allocator_.codec_));
+    }
 
     // Update the reader on how far it can read the active segment.
     reader_->UpdateLastSegmentOffset(active_segment->written_offset());
@@ -1059,9 +1295,10 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
           segments_to_delete[segments_to_delete.size() - 1]->header().sequence_number());
     }
 
-    // Now that they are no longer referenced by the Log, delete the files.
+    // Now that they are no longer referenced by the Log, delete or recycle
+    // the files.
     *num_gced = 0;
-    for (const auto& segment : segments_to_delete) {
+    for (auto& segment : segments_to_delete) {
       string ops_str;
       if (segment->HasFooter() && segment->footer().has_min_replicate_index()) {
         DCHECK(segment->footer().has_max_replicate_index());
@@ -1069,13 +1306,28 @@ Status Log::GC(RetentionIndexes retention_indexes, int32_t* num_gced) {
                              segment->footer().min_replicate_index(),
                              segment->footer().max_replicate_index());
       }
-      LOG_WITH_PREFIX(INFO) << "Deleting log segment in path: " << segment->path() << ops_str;
-      if (PREDICT_TRUE(ctx_.file_cache)) {
-        // Note: the segment files will only be deleted from disk when
-        // segments_to_delete goes out of scope.
-        RETURN_NOT_OK(ctx_.file_cache->DeleteFile(segment->path()));
+      const string path = segment->path();
+      bool recycled = false;
+      if (FLAGS_log_max_recycled_segments > 0 && segment->HasOneRef()) {
+        // Nobody else is reading the segment, so its file may be reused.
+        segment.reset();
+        if (PREDICT_TRUE(ctx_.file_cache)) {
+          ctx_.file_cache->Invalidate(path);
+        }
+        WARN_NOT_OK(segment_allocator_.RecycleSegment(path, &recycled),
+                    Substitute("$0could not recycle log segment", LogPrefix()));
+      }
+      if (recycled) {
+        LOG_WITH_PREFIX(INFO) << "Recycled log segment in path: " << path << ops_str;
       } else {
-        RETURN_NOT_OK(ctx_.fs_manager->env()->DeleteFile(segment->path()));
+        LOG_WITH_PREFIX(INFO) << "Deleting log segment in path: " << path << ops_str;
+        if (PREDICT_TRUE(ctx_.file_cache)) {
+          // Note: the segment files will only be deleted from disk when
+          // segments_to_delete goes out of scope.
+          RETURN_NOT_OK(ctx_.file_cache->DeleteFile(path));
+        } else {
+          RETURN_NOT_OK(ctx_.fs_manager->env()->DeleteFile(path));
+        }
       }
       (*num_gced)++;
     }
@@ -1150,6 +1402,7 @@ void Log::SetSchemaForNextLogSegment(Schema schema,
 
 Status Log::Close() {
   segment_allocator_.StopAllocationThread();
+  segment_allocator_.DeleteRecycledSegments();
   append_thread_->Shutdown();
 
   {
@@ -1261,5 +1514,19 @@ LogEntryBatch::LogEntryBatch(LogEntryTypePB type,
 
 LogEntryBatch::~LogEntryBatch() {}
 
+Status LogEntryBatch::Compress(const CompressionCodec* codec) {
+  DCHECK(!is_compressed_);
+  TRACE_EVENT0("log", "LogEntryBatch::Compress");
+  faststring compressed;
+  compressed.resize(codec->MaxCompressedLength(buffer_.size()));
+  size_t compressed_len;
+  RETURN_NOT_OK(codec->Compress(Slice(buffer_), compressed.data(), &compressed_len));
+  compressed.resize(compressed_len);
+  uncompressed_size_ = buffer_.size();
+  buffer_ = std::move(compressed);
+  is_compressed_ = true;
+  return Status::OK();
+}
+
 }  // namespace log
 }  // namespace kudu
@@ -65,6 +65,7 @@ class LogEntryBatch;
 class LogFaultHooks;
 class LogIndex;
 class LogReader;
+class LogSyncGroup;
 struct LogEntryBatchLogicalSize;
 struct RetentionIndexes;
 
@@ -150,6 +151,17 @@ class SegmentAllocator {
   // current active segment.
   void StopAllocationThread();
 
+  // Takes the file of the segment at 'path', no longer in use, to be reused as
+  // the file of a later segment, if fewer than --log_max_recycled_segments
+  // files are already kept. Sets 'recycled' to whether it was taken; if not,
+  // the caller should delete the file.
+  Status RecycleSegment(const std::string& path, bool* recycled);
+
+  // Deletes the files of the recycled segments that weren't reused.
+  //
+  // Must be called once the allocation thread is stopped.
+  void DeleteRecycledSegments();
+
   std::string LogPrefix() const { return ctx_->LogPrefix(); }
 
   uint64_t active_segment_sequence_number() const {
@@ -190,8 +202,15 @@ class SegmentAllocator {
   // Creates a temporary file, populating 'next_segment_file_' and
   // 'next_segment_path_', and pre-allocating 'max_segment_size_' bytes if
   // pre-allocation is enabled.
+  //
+  // The file of a recycled segment is reused instead if there's one.
   Status AllocateNewSegment();
 
+  // Reopens the file of a recycled segment, if there's one, into
+  // 'next_segment_file_' and 'next_segment_path_', zeroing its contents. Sets
+  // 'reused' to whether there was one.
+  Status ReuseRecycledSegment(bool* reused);
+
   // Swaps in the next segment file as the new active segment.
   //
   // 'new_readable_segment' contains the newly active segment, reopened for reading.
@@ -235,6 +254,11 @@ class SegmentAllocator {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // If set, the active segment is made durable by group-committing with the
+  // other WALs on the same filesystem rather than with its own fsync.
+  // See --log_group_commit_across_tablets.
+  LogSyncGroup* sync_group_;
+
   // A footer being prepared for the current segment.
   // When the segment is finished, it will be written.
   LogSegmentFooterPB footer_;
@@ -252,6 +276,10 @@ class SegmentAllocator {
 
   // The sequence number of the 'active' log segment.
   uint64_t active_segment_sequence_number_ = 0;
+
+  // The paths of the files of recycled segments, ready to be reused.
+  simple_spinlock recycled_lock_;
+  std::deque<std::string> recycled_segment_paths_;
 };
 
 // Log interface, inspired by Raft's (logcabin) Log. Provides durability to
@@ -571,6 +599,18 @@ class LogEntryBatch {
   // Serializes contents of the entry to an internal buffer.
   void Serialize();
 
+  // Replaces the serialized contents of the entry with their compressed form,
+  // so that the append thread doesn't have to compress them.
+  Status Compress(const CompressionCodec* codec);
+
+  // Whether the serialized contents of the entry have been compressed.
+  bool is_compressed() const { return is_compressed_; }
+
+  // Returns the size of the serialized contents before any compression.
+  uint32_t uncompressed_size() const {
+    return is_compressed_ ? uncompressed_size_ : buffer_.size();
+  }
+
   // Returns a Slice representing the serialized contents of the
   // entry.
   Slice data() const {
@@ -616,6 +656,10 @@ class LogEntryBatch {
   // 'Serialize()'
   faststring buffer_;
 
+  // Set by Compress(), along with the size of 'buffer_' before compression.
+  bool is_compressed_ = false;
+  uint32_t uncompressed_size_ = 0;
+
   // Tracks whether this batch was successfully append to the log.
   Status append_status_;
 
@@ -23,6 +23,7 @@
 #include <functional>
 #include <initializer_list>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <thread>
@@ -45,16 +46,20 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/threadpool.h"
 
 using std::atomic;
 using std::shared_ptr;
@@ -65,6 +70,7 @@ using strings::Substitute;
 
 DECLARE_int32(log_cache_size_limit_mb);
 DECLARE_int32(global_log_cache_size_limit_mb);
+DECLARE_bool(log_cache_read_ahead);
 
 METRIC_DECLARE_entity(server);
 METRIC_DECLARE_entity(tablet);
@@ -187,6 +193,44 @@ TEST_F(LogCacheTest, TestAppendAndGetMessages) {
 }
 
 
+// Ensure that the ops of a peer lagging past the cache are read ahead, and
+// that the read-ahead ops are served in order and released.
+TEST_F(LogCacheTest, TestReadAhead) {
+  FLAGS_log_cache_read_ahead = true;
+  const int kPayloadSize = 1000;
+  const int kNumOps = 100;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, kNumOps, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(kNumOps);
+  ASSERT_EQ(0, cache_->metrics_.log_cache_num_ops->value());
+
+  // Read the ops in batches of about 10 ops, as a lagging peer would.
+  int64_t next_index = 1;
+  while (next_index <= kNumOps) {
+    vector<ReplicateRefPtr> messages;
+    OpId preceding;
+    ASSERT_OK(cache_->ReadOps(next_index - 1, 10 * kPayloadSize, &messages, &preceding));
+    ASSERT_FALSE(messages.empty());
+    ASSERT_EQ(next_index - 1, preceding.index());
+    for (const auto& msg : messages) {
+      ASSERT_EQ(next_index++, msg->get()->id().index());
+    }
+
+    // The next batch is read ahead, unless this was the last one.
+    cache_->read_ahead_pool_->Wait();
+    std::lock_guard<simple_spinlock> l(cache_->lock_);
+    if (next_index <= kNumOps) {
+      ASSERT_TRUE(ContainsKey(cache_->read_ahead_ops_, next_index));
+    }
+  }
+
+  // Once all the peers have caught up, nothing remains read ahead.
+  cache_->EvictThroughOp(kNumOps);
+  std::lock_guard<simple_spinlock> l(cache_->lock_);
+  ASSERT_TRUE(cache_->read_ahead_ops_.empty());
+  ASSERT_EQ(0, cache_->read_ahead_bytes_);
+}
+
 // Ensure that the cache always yields at least one message,
 // even if that message is larger than the batch size. This ensures
 // that we don't get "stuck" in the case that a large message enters
@@ -324,6 +368,30 @@ TEST_F(LogCacheTest, TestGlobalMemoryLimit) {
   ASSERT_LE(cache_->BytesUsed(), 1024 * 1024);
 }
 
+// The serialized copies of the cached ops are charged to the cache's tracker
+// for as long as the ops are cached.
+TEST_F(LogCacheTest, TestSerializedOpsAreCharged) {
+  const int kPayloadSize = 128 * 1024;
+  shared_ptr<MemTracker> tracker = cache_->tracker_;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, 1, kPayloadSize));
+  log_->WaitUntilAllFlushed();
+  const int64_t size_with_one_msg = tracker->consumption();
+
+  {
+    vector<ReplicateRefPtr> messages;
+    OpId preceding;
+    ASSERT_OK(cache_->ReadOps(0, 8 * 1024 * 1024, &messages, &preceding));
+    ASSERT_EQ(1, messages.size());
+    const Slice serialized = messages[0]->serialized();
+    ASSERT_GT(serialized.size(), kPayloadSize);
+    ASSERT_GE(tracker->consumption(), size_with_one_msg + serialized.size());
+  }
+
+  cache_->EvictThroughOp(1);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+  ASSERT_EQ(0, tracker->consumption());
+}
+
 // Test that the log cache properly replaces messages when an index
 // is reused. This is a regression test for a bug where the memtracker's
 // consumption wasn't properly managed when messages were replaced.
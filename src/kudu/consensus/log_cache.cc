@@ -17,6 +17,7 @@
 
 #include "kudu/consensus/log_cache.h"
 
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <mutex>
@@ -45,6 +46,7 @@
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(log_cache_size_limit_mb, 128,
              "The total per-tablet size of consensus entries which may be kept in memory. "
@@ -58,6 +60,24 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_bool(log_cache_read_ahead, false,
+            "Whether reading ops from the log for a lagging peer also starts "
+            "reading the ops that follow them in the background, so that the "
+            "peer's next batch is served from memory instead of blocking the "
+            "preparation of the requests to the tablet's other peers on disk IO.");
+TAG_FLAG(log_cache_read_ahead, advanced);
+TAG_FLAG(log_cache_read_ahead, experimental);
+TAG_FLAG(log_cache_read_ahead, runtime);
+
+DEFINE_int32(log_cache_read_ahead_buffer_mb, 16,
+             "With --log_cache_read_ahead, the maximum per-tablet size of the ops "
+             "read ahead of the lagging peers that need them.");
+DEFINE_validator(log_cache_read_ahead_buffer_mb,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(log_cache_read_ahead_buffer_mb, advanced);
+TAG_FLAG(log_cache_read_ahead_buffer_mb, experimental);
+TAG_FLAG(log_cache_read_ahead_buffer_mb, runtime);
+
 using kudu::pb_util::SecureShortDebugString;
 using std::string;
 using std::vector;
@@ -86,6 +106,9 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
       tablet_id_(std::move(tablet_id)),
       next_sequential_op_index_(0),
       min_pinned_op_index_(0),
+      read_ahead_bytes_(0),
+      read_ahead_pending_(false),
+      read_ahead_generation_(0),
       metrics_(metric_entity) {
 
   const int64_t max_ops_size_bytes = FLAGS_log_cache_size_limit_mb * 1024L * 1024L;
@@ -110,11 +133,22 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
   InsertOrDie(&cache_,
               kZeroOpIdx,
               { make_scoped_refptr_replicate(zero_op), zero_op->SpaceUsedLong() });
+
+  // No thread is started until a read-ahead is submitted.
+  CHECK_OK(ThreadPoolBuilder("log-cache-read-ahead")
+           .set_max_threads(1)
+           .Build(&read_ahead_pool_));
 }
 
 LogCache::~LogCache() {
+  read_ahead_pool_->Shutdown();
+  // The serialized ops may outlive the cache: release their charges now.
+  for (auto& e : cache_) {
+    e.second.msg->UntrackSerialized();
+  }
   tracker_->Release(tracker_->consumption());
   cache_.clear();
+  read_ahead_ops_.clear();
 }
 
 void LogCache::Init(const OpId& preceding_op) {
@@ -144,6 +178,10 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
     }
   }
   next_sequential_op_index_ = index + 1;
+
+  // Any ops read ahead past 'index' (or being read) may have been replaced.
+  EraseReadAheadOpsUnlocked(first_to_truncate, MathLimits<int64_t>::kMax);
+  read_ahead_generation_++;
 }
 
 Status LogCache::AppendOperations(vector<ReplicateRefPtr> msgs,
@@ -156,6 +194,9 @@ Status LogCache::AppendOperations(vector<ReplicateRefPtr> msgs,
   vector<CacheEntry> entries_to_insert;
   entries_to_insert.reserve(msgs.size());
   for (const auto& msg : msgs) {
+    // The ops may be serialized to be sent to the peers: that copy is charged
+    // to the cache as well, for as long as the op is cached.
+    msg->TrackSerialized(tracker_);
     CacheEntry e = { msg, msg->get()->SpaceUsedLong() };
     mem_required += e.mem_usage;
     entries_to_insert.emplace_back(std::move(e));
@@ -299,6 +340,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
   int64_t remaining_space = max_size_bytes;
   int64_t next_index = after_op_index + 1;
 
+  bool read_from_log = false;
   std::unique_lock<simple_spinlock> l(lock_);
   while (remaining_space > 0 && next_index < next_sequential_op_index_) {
     // If the messages the peer needs haven't been loaded into the queue yet,
@@ -314,6 +356,13 @@ Status LogCache::ReadOps(int64_t after_op_index,
         up_to = iter->first - 1;
       }
       l.unlock();
+      read_from_log = true;
+
+      if (FLAGS_log_cache_read_ahead &&
+          TakeReadAheadOps(up_to, &next_index, &remaining_space, messages)) {
+        l.lock();
+        continue;
+      }
 
       vector<ReplicateMsg*> raw_replicate_ptrs;
       RETURN_NOT_OK_PREPEND(
@@ -354,14 +403,121 @@ Status LogCache::ReadOps(int64_t after_op_index,
       }
     }
   }
+
+  // Prepare the peer's next batch while this one is being sent.
+  int64_t up_to;
+  int64_t max_bytes;
+  if (read_from_log && FLAGS_log_cache_read_ahead &&
+      PrepareReadAheadUnlocked(next_index, max_size_bytes, &up_to, &max_bytes)) {
+    const int64_t generation = read_ahead_generation_;
+    l.unlock();
+    Status s = read_ahead_pool_->Submit([this, next_index, up_to, max_bytes, generation]() {
+      this->ReadAhead(next_index, up_to, max_bytes, generation);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      std::lock_guard<simple_spinlock> guard(lock_);
+      read_ahead_pending_ = false;
+    }
+  }
   return Status::OK();
 }
 
+bool LogCache::TakeReadAheadOps(int64_t up_to,
+                                int64_t* next_index,
+                                int64_t* remaining_space,
+                                vector<ReplicateRefPtr>* messages) {
+  // The ops being read ahead are likely the ones needed here: wait for them
+  // rather than reading them again.
+  read_ahead_pool_->Wait();
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  // Ops preceding the requested ones aren't likely to be requested anymore.
+  EraseReadAheadOpsUnlocked(0, *next_index);
+  bool took_ops = false;
+  for (auto iter = read_ahead_ops_.begin();
+       iter != read_ahead_ops_.end() && iter->first == *next_index && *next_index <= up_to &&
+       *remaining_space > 0;
+       iter = read_ahead_ops_.begin()) {
+    const ReplicateRefPtr msg = iter->second.msg;
+    EraseReadAheadOpsUnlocked(*next_index, *next_index + 1);
+    messages->push_back(msg);
+    *remaining_space -= TotalByteSizeForMessage(*msg->get());
+    ++*next_index;
+    took_ops = true;
+  }
+  return took_ops;
+}
+
+bool LogCache::PrepareReadAheadUnlocked(int64_t next_index, int64_t max_size_bytes,
+                                        int64_t* up_to, int64_t* max_bytes) {
+  DCHECK(lock_.is_locked());
+  if (read_ahead_pending_ || next_index >= next_sequential_op_index_ ||
+      ContainsKey(read_ahead_ops_, next_index)) {
+    return false;
+  }
+  const auto iter = cache_.lower_bound(next_index);
+  if (iter != cache_.end() && iter->first == next_index) {
+    return false;
+  }
+  const int64_t buffer_space =
+      FLAGS_log_cache_read_ahead_buffer_mb * 1024L * 1024L - read_ahead_bytes_;
+  if (buffer_space <= 0) {
+    return false;
+  }
+  *up_to = iter == cache_.end() ? next_sequential_op_index_ - 1 : iter->first - 1;
+  *max_bytes = std::min(max_size_bytes, buffer_space);
+  read_ahead_pending_ = true;
+  return true;
+}
+
+void LogCache::ReadAhead(int64_t from, int64_t up_to, int64_t max_bytes, int64_t generation) {
+  vector<ReplicateMsg*> raw_replicate_ptrs;
+  Status s = log_->reader()->ReadReplicatesInRange(from, up_to, max_bytes, &raw_replicate_ptrs);
+  vector<CacheEntry> entries;
+  entries.reserve(raw_replicate_ptrs.size());
+  for (auto* msg : raw_replicate_ptrs) {
+    entries.push_back({ make_scoped_refptr_replicate(msg), msg->SpaceUsedLong() });
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    // The ops are read again by ReadOps(), which reports the error.
+    VLOG_WITH_PREFIX_UNLOCKED(1) << Substitute("failed to read ahead ops $0..$1: $2",
+                                               from, up_to, s.ToString());
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  read_ahead_pending_ = false;
+  if (generation != read_ahead_generation_) {
+    return;
+  }
+  for (auto& e : entries) {
+    const int64_t index = e.msg->get()->id().index();
+    if (ContainsKey(cache_, index)) {
+      continue;
+    }
+    tracker_->Consume(e.mem_usage);
+    read_ahead_bytes_ += e.mem_usage;
+    EmplaceOrDie(&read_ahead_ops_, index, std::move(e));
+  }
+  VLOG_WITH_PREFIX_UNLOCKED(2) << Substitute("read ahead $0 ops from log ($1..$2)",
+                                             entries.size(), from, from + entries.size() - 1);
+}
+
+void LogCache::EraseReadAheadOpsUnlocked(int64_t begin, int64_t end) {
+  DCHECK(lock_.is_locked());
+  auto iter = read_ahead_ops_.lower_bound(begin);
+  while (iter != read_ahead_ops_.end() && iter->first < end) {
+    tracker_->Release(iter->second.mem_usage);
+    read_ahead_bytes_ -= iter->second.mem_usage;
+    iter = read_ahead_ops_.erase(iter);
+  }
+}
+
 
 void LogCache::EvictThroughOp(int64_t index) {
   std::lock_guard<simple_spinlock> lock(lock_);
 
   EvictSomeUnlocked(index, MathLimits<int64_t>::kMax);
+  EraseReadAheadOpsUnlocked(0, index + 1);
 }
 
 void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evict) {
@@ -407,6 +563,7 @@ void LogCache::EvictSomeUnlocked(int64_t stop_after_index, int64_t bytes_to_evic
 }
 
 void LogCache::AccountForMessageRemovalUnlocked(const LogCache::CacheEntry& entry) {
+  entry.msg->UntrackSerialized();
   tracker_->Release(entry.mem_usage);
   metrics_.log_cache_size->DecrementBy(entry.mem_usage);
   metrics_.log_cache_num_ops->Decrement();
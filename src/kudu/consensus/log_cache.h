@@ -37,6 +37,7 @@
 namespace kudu {
 
 class MemTracker;
+class ThreadPool;
 
 namespace log {
 class Log;
@@ -82,6 +83,10 @@ class LogCache {
   // If the ops being requested are not available in the cache, this will synchronously
   // read these ops from disk. Therefore, this function may take a substantial amount
   // of time and should not be called with important locks held, etc.
+  //
+  // With --log_cache_read_ahead, reading ops from disk also starts reading the
+  // ops that follow them in the background, so that the next call for a
+  // lagging peer is likely served from memory.
   Status ReadOps(int64_t after_op_index,
                  int64_t max_size_bytes,
                  std::vector<ReplicateRefPtr>* messages,
@@ -142,7 +147,9 @@ class LogCache {
  private:
   FRIEND_TEST(LogCacheTest, TestAppendAndGetMessages);
   FRIEND_TEST(LogCacheTest, TestGlobalMemoryLimit);
+  FRIEND_TEST(LogCacheTest, TestReadAhead);
   FRIEND_TEST(LogCacheTest, TestReplaceMessages);
+  FRIEND_TEST(LogCacheTest, TestSerializedOpsAreCharged);
   FRIEND_TEST(LogCacheTest, TestTruncation);
   friend class LogCacheTest;
 
@@ -168,6 +175,31 @@ class LogCache {
 
   void TruncateOpsAfterUnlocked(int64_t index);
 
+  // Waits for any read-ahead in progress, then moves the read-ahead ops that
+  // directly follow '*next_index', up to 'up_to', to 'messages', as long as
+  // '*remaining_space' is positive. Advances '*next_index' and decreases
+  // '*remaining_space' accordingly. Returns whether any op was moved.
+  bool TakeReadAheadOps(int64_t up_to,
+                        int64_t* next_index,
+                        int64_t* remaining_space,
+                        std::vector<ReplicateRefPtr>* messages);
+
+  // Starts reading ops from 'next_index' in the background, unless they are
+  // already in memory, a read-ahead is in progress, or the read-ahead buffer
+  // is full. Returns whether a read-ahead must be submitted, in which case
+  // its arguments are written to 'up_to' and 'max_bytes'.
+  bool PrepareReadAheadUnlocked(int64_t next_index, int64_t max_size_bytes,
+                                int64_t* up_to, int64_t* max_bytes);
+
+  // Reads the ops in the range ['from', 'up_to'], up to 'max_bytes', into the
+  // read-ahead buffer. Runs on 'read_ahead_pool_'. The ops are dropped if the
+  // cache was truncated since the read-ahead was prepared, i.e. if
+  // 'read_ahead_generation_' no longer matches 'generation'.
+  void ReadAhead(int64_t from, int64_t up_to, int64_t max_bytes, int64_t generation);
+
+  // Removes the read-ahead ops in the range ['begin', 'end').
+  void EraseReadAheadOpsUnlocked(int64_t begin, int64_t end);
+
   // Return a string with stats
   std::string StatsStringUnlocked() const;
 
@@ -205,6 +237,22 @@ class LogCache {
   // Protected by lock_.
   int64_t min_pinned_op_index_;
 
+  // Ops read from the log ahead of the peers that need them, keyed by index.
+  // Kept apart from 'cache_' since they aren't contiguous with its entries.
+  // Charged to 'tracker_', and bounded by --log_cache_read_ahead_buffer_mb.
+  // Protected by lock_.
+  MessageCache read_ahead_ops_;
+  int64_t read_ahead_bytes_;
+
+  // Whether a read-ahead has been submitted and not completed yet, and the
+  // number of truncations of the cache, which invalidate read-aheads in
+  // progress. Protected by lock_.
+  bool read_ahead_pending_;
+  int64_t read_ahead_generation_;
+
+  // Single-threaded pool on which read-aheads run.
+  std::unique_ptr<ThreadPool> read_ahead_pool_;
+
   // Pointer to a parent memtracker for all log caches. This
   // exists to compute server-wide cache size and enforce a
   // server-wide memory limit.  When the first instance of a log
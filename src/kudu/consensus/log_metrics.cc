@@ -54,6 +54,13 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         kudu::MetricLevel::kDebug,
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_group_commit_wait, "Log Group Commit Wait Time",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent by the log append thread waiting for more "
+                        "entry batches to join a group commit group",
+                        kudu::MetricLevel::kDebug,
+                        60000000LU, 2);
+
 namespace kudu {
 namespace log {
 
@@ -64,7 +71,8 @@ LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(group_commit_wait) {
 }
 #undef MINIT
 
@@ -56,10 +56,12 @@ METRIC_DEFINE_histogram(tablet, log_reader_read_batch_latency, "Log Read Latency
                         kudu::MetricLevel::kInfo,
                         60000000LU, 2);
 
+using kudu::consensus::CommitMsg;
 using kudu::consensus::OpId;
 using kudu::consensus::ReplicateMsg;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using std::map;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -354,6 +356,49 @@ Status LogReader::ReadReplicatesInRange(int64_t starting_at,
   return Status::OK();
 }
 
+Status LogReader::ReadCommitsInRange(int64_t starting_at,
+                                     int64_t up_to,
+                                     map<int64_t, unique_ptr<CommitMsg>>* commits) const {
+  DCHECK_GT(starting_at, 0);
+  DCHECK_GE(up_to, starting_at);
+  DCHECK(log_index_) << "Require an index to random-read logs";
+
+  LogIndexEntry index_entry;
+  RETURN_NOT_OK_PREPEND(log_index_->GetEntry(starting_at, &index_entry),
+                        Substitute("Failed to read log index for op $0", starting_at));
+  SegmentSequence segments;
+  GetSegmentsSnapshot(&segments);
+
+  map<int64_t, unique_ptr<CommitMsg>> commits_tmp;
+  const size_t num_ops = up_to - starting_at + 1;
+  for (const auto& segment : segments) {
+    if (segment->header().sequence_number() < index_entry.segment_sequence_number) {
+      continue;
+    }
+    LogEntryReader reader(segment.get());
+    unique_ptr<LogEntryPB> entry;
+    while (commits_tmp.size() < num_ops) {
+      const Status s = reader.ReadNextEntry(&entry);
+      if (s.IsEndOfFile()) {
+        break;
+      }
+      RETURN_NOT_OK(s);
+      if (!entry->has_commit()) {
+        continue;
+      }
+      const int64_t index = entry->commit().commited_op_id().index();
+      if (index >= starting_at && index <= up_to) {
+        commits_tmp[index].reset(entry->release_commit());
+      }
+    }
+    if (commits_tmp.size() == num_ops) {
+      break;
+    }
+  }
+  commits->swap(commits_tmp);
+  return Status::OK();
+}
+
 Status LogReader::LookupOpId(int64_t op_index, OpId* op_id) const {
   LogIndexEntry index_entry;
   RETURN_NOT_OK_PREPEND(log_index_->GetEntry(op_index, &index_entry),
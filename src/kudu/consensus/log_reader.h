@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -41,6 +42,7 @@ class MetricEntity;
 class faststring;
 
 namespace consensus {
+class CommitMsg;
 class OpId;
 class ReplicateMsg;
 } // namespace consensus
@@ -113,6 +115,20 @@ class LogReader : public enable_make_shared<LogReader> {
       std::vector<consensus::ReplicateMsg*>* replicates) const;
   static const int64_t kNoSizeLimit;
 
+  // Reads the CommitMsgs of the ops from 'starting_at' to 'up_to' both
+  // inclusive, keyed by op index. The ops whose COMMIT isn't in the log yet,
+  // e.g. because they're still being applied, have no entry.
+  //
+  // The COMMITs follow their REPLICATEs, so the segments are read from the
+  // one with the REPLICATE of 'starting_at' on, until all of the COMMITs are
+  // found or the end of the log is reached.
+  //
+  // Requires that a LogIndex was passed into LogReader::Open().
+  Status ReadCommitsInRange(
+      int64_t starting_at,
+      int64_t up_to,
+      std::map<int64_t, std::unique_ptr<consensus::CommitMsg>>* commits) const;
+
   // Look up the OpId for the given operation index.
   // Returns a bad Status if the log index fails to load (eg. due to an IO error).
   Status LookupOpId(int64_t op_index, consensus::OpId* op_id) const;
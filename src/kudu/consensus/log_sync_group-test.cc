@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/log_sync_group.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace log {
+
+class LogSyncGroupTest : public KuduTest {
+};
+
+TEST_F(LogSyncGroupTest, TestGetReturnsSharedGroup) {
+  LogSyncGroup* group = LogSyncGroup::Get(env_, test_dir_);
+  ASSERT_EQ(group, LogSyncGroup::Get(env_, test_dir_));
+  ASSERT_NE(group, LogSyncGroup::Get(env_, JoinPathSegments(test_dir_, "other")));
+}
+
+// Concurrent syncs of many writers are coalesced, and all of them succeed.
+TEST_F(LogSyncGroupTest, TestConcurrentSyncs) {
+  LogSyncGroup group(env_, test_dir_);
+  Status s = group.Sync();
+  if (s.IsNotSupported()) {
+    LOG(WARNING) << "Skipping test: " << s.ToString();
+    GTEST_SKIP();
+  }
+  ASSERT_OK(s);
+  ASSERT_EQ(1, group.num_syncs());
+
+  constexpr int kNumWriters = 8;
+  constexpr int kNumSyncsPerWriter = 20;
+  vector<Status> statuses(kNumWriters);
+  vector<thread> writers;
+  for (int i = 0; i < kNumWriters; i++) {
+    writers.emplace_back([&, i]() {
+      unique_ptr<WritableFile> file;
+      Status s = env_->NewWritableFile(JoinPathSegments(test_dir_, Substitute("wal-$0", i)),
+                                       &file);
+      for (int j = 0; s.ok() && j < kNumSyncsPerWriter; j++) {
+        s = file->Append(Slice("entry"));
+        if (s.ok()) {
+          s = group.Sync();
+        }
+      }
+      statuses[i] = s;
+    });
+  }
+  for (auto& t : writers) {
+    t.join();
+  }
+  for (const auto& s : statuses) {
+    ASSERT_OK(s);
+  }
+  const int64_t num_syncs = group.num_syncs() - 1;
+  LOG(INFO) << Substitute("$0 syncs requested, $1 issued",
+                          kNumWriters * kNumSyncsPerWriter, num_syncs);
+  ASSERT_GT(num_syncs, 0);
+  ASSERT_LE(num_syncs, kNumWriters * kNumSyncsPerWriter);
+}
+
+TEST_F(LogSyncGroupTest, TestSyncErrorIsReturned) {
+  LogSyncGroup group(env_, JoinPathSegments(test_dir_, "does-not-exist"));
+  Status s = group.Sync();
+  ASSERT_FALSE(s.ok());
+  // The failed sync didn't cover anyone, so the next caller syncs again.
+  ASSERT_FALSE(group.Sync().ok());
+  ASSERT_EQ(2, group.num_syncs());
+}
+
+}  // namespace log
+}  // namespace kudu
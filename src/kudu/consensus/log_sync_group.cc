@@ -0,0 +1,97 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/log_sync_group.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "kudu/util/env.h"
+#include "kudu/util/locks.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace log {
+
+LogSyncGroup* LogSyncGroup::Get(Env* env, const string& dir) {
+  static simple_spinlock groups_lock;
+  static auto* groups = new std::unordered_map<string, unique_ptr<LogSyncGroup>>();
+  std::lock_guard<simple_spinlock> l(groups_lock);
+  auto& group = (*groups)[dir];
+  if (!group) {
+    group.reset(new LogSyncGroup(env, dir));
+  }
+  return group.get();
+}
+
+LogSyncGroup::LogSyncGroup(Env* env, string dir)
+    : env_(env),
+      dir_(std::move(dir)),
+      cond_(&lock_),
+      last_ticket_(0),
+      synced_ticket_(0),
+      sync_in_progress_(false),
+      num_syncs_(0) {
+}
+
+Status LogSyncGroup::Sync() {
+  int64_t covered_ticket;
+  {
+    MutexLock l(lock_);
+    const int64_t ticket = ++last_ticket_;
+    while (true) {
+      if (synced_ticket_ >= ticket) {
+        return Status::OK();
+      }
+      if (!sync_in_progress_) {
+        break;
+      }
+      // A sync that started before our writes may not cover them: wait for
+      // it, then either we've been covered by a later one or we sync.
+      cond_.Wait();
+    }
+    sync_in_progress_ = true;
+    covered_ticket = last_ticket_;
+  }
+
+  // Everyone who got a ticket so far issued their writes before asking for
+  // it, so this sync makes all of them durable.
+  Status s = env_->SyncFilesystem(dir_);
+
+  MutexLock l(lock_);
+  sync_in_progress_ = false;
+  num_syncs_++;
+  // On failure, callers that were waiting will retry the sync themselves and
+  // see the error, if it persists.
+  if (s.ok()) {
+    synced_ticket_ = covered_ticket;
+  }
+  cond_.Broadcast();
+  return s;
+}
+
+int64_t LogSyncGroup::num_syncs() const {
+  MutexLock l(lock_);
+  return num_syncs_;
+}
+
+}  // namespace log
+}  // namespace kudu
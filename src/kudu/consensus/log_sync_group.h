@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Env;
+
+namespace log {
+
+// Group-commits the WALs of many tablets that live on the same filesystem.
+//
+// Rather than each tablet's log fsync()ing its own active segment, logs that
+// share a group call Sync(), and a single syncfs() of the whole filesystem
+// makes the writes of all of them durable at once. While one sync is in
+// flight, callers queue up behind it and are all covered by the next one, so
+// the number of syncs issued per second is bounded by the disk's sync latency
+// rather than by the number of tablets.
+//
+// This class is thread-safe.
+class LogSyncGroup {
+ public:
+  // Returns the group for the WAL directory 'dir', creating it if necessary.
+  // Groups live for the lifetime of the process.
+  static LogSyncGroup* Get(Env* env, const std::string& dir);
+
+  LogSyncGroup(Env* env, std::string dir);
+
+  // Makes durable all writes that were issued to files on the group's
+  // filesystem before this call. Blocks until they are.
+  Status Sync();
+
+  // Returns the number of filesystem syncs issued so far.
+  int64_t num_syncs() const;
+
+ private:
+  Env* const env_;
+  const std::string dir_;
+
+  mutable Mutex lock_;
+  ConditionVariable cond_;
+
+  // Ticket handed to the last caller of Sync().
+  int64_t last_ticket_;
+
+  // All callers with a ticket up to this one have had their writes synced.
+  int64_t synced_ticket_;
+
+  // Whether some caller is currently syncing the filesystem.
+  bool sync_in_progress_;
+
+  int64_t num_syncs_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogSyncGroup);
+};
+
+}  // namespace log
+}  // namespace kudu
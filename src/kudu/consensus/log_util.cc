@@ -821,10 +821,6 @@ Status WritableLogSegment::WriteFooter(const LogSegmentFooterPB& footer) {
 
 Status WritableLogSegment::WriteEntryBatch(const Slice& data,
                                            const CompressionCodec* codec) {
-  DCHECK(is_header_written_);
-  DCHECK(!is_footer_written_);
-  uint8_t header_buf[kEntryHeaderSizeV2];
-
   const uint32_t uncompressed_len = data.size();
 
   // If necessary, compress the data.
@@ -839,6 +835,14 @@ Status WritableLogSegment::WriteEntryBatch(const Slice& data,
   } else {
     data_to_write = data;
   }
+  return WriteCompressedEntryBatch(data_to_write, uncompressed_len);
+}
+
+Status WritableLogSegment::WriteCompressedEntryBatch(const Slice& data_to_write,
+                                                     uint32_t uncompressed_len) {
+  DCHECK(is_header_written_);
+  DCHECK(!is_footer_written_);
+  uint8_t header_buf[kEntryHeaderSizeV2];
 
   // Fill in the header.
   InlineEncodeFixed32(&header_buf[0], data_to_write.size());
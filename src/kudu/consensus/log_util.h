@@ -428,6 +428,11 @@ class WritableLogSegment {
   // Write a compressed entry to the log.
   Status WriteEntryBatch(const Slice& data, const CompressionCodec* codec);
 
+  // Like WriteEntryBatch(), but for a batch already compressed with the codec
+  // of the segment. 'uncompressed_len' is the size of the batch before
+  // compression.
+  Status WriteCompressedEntryBatch(const Slice& data, uint32_t uncompressed_len);
+
   // Makes sure the I/O buffers belonging to the underlying file handle are flushed.
   Status Sync() {
     return file_->Sync();
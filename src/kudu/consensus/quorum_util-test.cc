@@ -94,6 +94,8 @@ static void AddPeer(RaftConfigPB* config,
         attrs_pb->set_promote(attr.second);
       } else if (attr.first == "REPLACE") {
         attrs_pb->set_replace(attr.second);
+      } else if (attr.first == "READ_REPLICA") {
+        attrs_pb->set_read_replica(attr.second);
       } else {
         FAIL() << attr.first << ": unexpected attribute to set";
       }
@@ -297,6 +299,24 @@ TEST(QuorumUtilTest, TestGetConsensusRole) {
   }
 }
 
+TEST(QuorumUtilTest, TestIsRaftConfigWitness) {
+  RaftConfigPB config;
+  AddPeer(&config, "A", V);
+  AddPeer(&config, "B", V);
+  AddPeer(&config, "C", N);
+  RaftPeerPB* peer_b;
+  ASSERT_OK(GetRaftConfigMember(&config, "B", &peer_b));
+  peer_b->mutable_attrs()->set_witness(true);
+
+  ASSERT_FALSE(IsRaftConfigWitness("A", config));
+  ASSERT_TRUE(IsRaftConfigWitness("B", config));
+  ASSERT_FALSE(IsRaftConfigWitness("C", config));
+  ASSERT_FALSE(IsRaftConfigWitness("D", config));
+
+  // A witness still counts as a voter.
+  ASSERT_TRUE(IsRaftConfigVoter("B", config));
+}
+
 TEST(QuorumUtilTest, TestIsRaftConfigVoter) {
   RaftConfigPB config;
   AddPeer(&config, "A", V);
@@ -1911,5 +1931,46 @@ TEST(QuorumUtilTest, ReplaceAllTabletReplicas) {
   EXPECT_FALSE(ShouldAddReplica(config, kReplicationFactor));
 }
 
+// Read replicas are kept as configured, regardless of the replication factor.
+TEST(QuorumUtilTest, ReadReplicas) {
+  constexpr auto kReplicationFactor = 3;
+  RaftConfigPB config;
+  AddPeer(&config, "A", V, '+');
+  AddPeer(&config, "B", V, '+');
+  AddPeer(&config, "C", V, '+');
+  EXPECT_TRUE(ShouldAddReadReplica(config, 1));
+  EXPECT_FALSE(ShouldAddReadReplica(config, 0));
+
+  AddPeer(&config, "D", N, '?', {{"READ_REPLICA", true}});
+  EXPECT_FALSE(ShouldAddReadReplica(config, 1));
+  EXPECT_TRUE(ShouldAddReadReplica(config, 2));
+  // Unlike other non-voters, a read replica isn't evicted because there are
+  // enough voters, nor does it count towards the replication factor.
+  EXPECT_FALSE(ShouldEvictReplica(config, "A", kReplicationFactor, nullptr, 1));
+  EXPECT_FALSE(ShouldAddReplica(config, kReplicationFactor));
+  // It's evicted if there are more read replicas than required.
+  string to_evict;
+  ASSERT_TRUE(ShouldEvictReplica(config, "A", kReplicationFactor, &to_evict, 0));
+  EXPECT_EQ("D", to_evict);
+
+  // A failed read replica is replaced, and evicted.
+  SetPeerHealth(&config, "D", '-');
+  EXPECT_TRUE(ShouldAddReadReplica(config, 1));
+  ASSERT_TRUE(ShouldEvictReplica(config, "A", kReplicationFactor, &to_evict, 1));
+  EXPECT_EQ("D", to_evict);
+
+  // Failed voters are evicted first.
+  AddPeer(&config, "E", V, 'x');
+  ASSERT_TRUE(ShouldEvictReplica(config, "A", kReplicationFactor, &to_evict, 1));
+  EXPECT_EQ("E", to_evict);
+  RemovePeer(&config, "E");
+
+  // Nothing is done without a healthy majority of voters.
+  SetPeerHealth(&config, "B", '-');
+  SetPeerHealth(&config, "C", '-');
+  EXPECT_FALSE(ShouldAddReadReplica(config, 2));
+  EXPECT_FALSE(ShouldEvictReplica(config, "A", kReplicationFactor, nullptr, 0));
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -68,6 +68,15 @@ bool IsRaftConfigVoter(const std::string& uuid, const RaftConfigPB& config) {
   return false;
 }
 
+bool IsRaftConfigWitness(const std::string& uuid, const RaftConfigPB& config) {
+  for (const RaftPeerPB& peer : config.peers()) {
+    if (peer.permanent_uuid() == uuid) {
+      return peer.has_attrs() && peer.attrs().witness();
+    }
+  }
+  return false;
+}
+
 bool IsVoterRole(RaftPeerPB::Role role) {
   return role == RaftPeerPB::LEADER || role == RaftPeerPB::FOLLOWER;
 }
@@ -512,11 +521,35 @@ bool ShouldAddReplica(const RaftConfigPB& config,
   return should_add_replica;
 }
 
+bool ShouldAddReadReplica(const RaftConfigPB& config, int num_read_replicas) {
+  int num_voters_total = 0;
+  int num_voters_healthy = 0;
+  int num_read_replicas_viable = 0;
+  for (const RaftPeerPB& peer : config.peers()) {
+    const auto overall_health = peer.health_report().overall_health();
+    if (peer.member_type() == RaftPeerPB::VOTER) {
+      ++num_voters_total;
+      if (overall_health == HealthReportPB::HEALTHY) {
+        ++num_voters_healthy;
+      }
+    } else if (peer.member_type() == RaftPeerPB::NON_VOTER && peer.attrs().read_replica() &&
+               overall_health != HealthReportPB::FAILED &&
+               overall_health != HealthReportPB::FAILED_UNRECOVERABLE) {
+      // As for the non-voters to promote, a new read replica is added with
+      // UNKNOWN health status, and counts as viable until it's reported failed.
+      ++num_read_replicas_viable;
+    }
+  }
+  return num_read_replicas_viable < num_read_replicas &&
+      num_voters_healthy >= MajoritySize(num_voters_total);
+}
+
 // Whether there is an excess replica to evict.
 bool ShouldEvictReplica(const RaftConfigPB& config,
                         const string& leader_uuid,
                         int replication_factor,
-                        string* uuid_to_evict) {
+                        string* uuid_to_evict,
+                        int num_read_replicas) {
   if (leader_uuid.empty()) {
     // If there is no leader, we can't evict anybody.
     return false;
@@ -531,6 +564,7 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
 
   PeerPriorityQueue pq_non_voters(kCmp);
   PeerPriorityQueue pq_voters(kCmp);
+  PeerPriorityQueue pq_read_replicas(kCmp);
 
   const auto peer_to_elem = [](const RaftPeerPB& peer) {
     const string& peer_uuid = peer.permanent_uuid();
@@ -574,6 +608,7 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
   };
 
   int num_non_voters_total = 0;
+  int num_read_replicas_total = 0;
 
   int num_voters_healthy = 0;
   int num_voters_total = 0;
@@ -584,6 +619,7 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
 
   bool has_non_voter_failed = false;
   bool has_non_voter_failed_unrecoverable = false;
+  bool has_read_replica_failed = false;
   bool has_voter_failed = false;
   bool has_voter_failed_unrecoverable = false;
   bool has_voter_unknown_health = false;
@@ -648,6 +684,14 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
       case RaftPeerPB::NON_VOTER:
         DCHECK_NE(peer_uuid, leader_uuid) << peer_uuid
             << ": non-voter as a leader; " << SecureShortDebugString(config);
+        // Read replicas are accounted for separately: they're not there to
+        // replace voters.
+        if (peer.attrs().read_replica()) {
+          pq_read_replicas.emplace(peer_to_elem(peer));
+          ++num_read_replicas_total;
+          has_read_replica_failed |= failed || failed_unrecoverable;
+          break;
+        }
         pq_non_voters.emplace(peer_to_elem(peer));
         ++num_non_voters_total;
         has_non_voter_failed |= failed;
@@ -792,7 +836,14 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
        has_voter_failed_unrecoverable) &&
       num_voters_healthy >= MajoritySize(num_voters_total - 1);
 
-  const bool should_evict = should_evict_non_voter || should_evict_voter;
+  // Read replicas are evicted if they've failed, to be replaced, or if there
+  // are more than required.
+  const bool should_evict_read_replica =
+      (has_read_replica_failed || num_read_replicas_total > num_read_replicas) &&
+      num_voters_healthy >= MajoritySize(num_voters_total);
+
+  const bool should_evict =
+      should_evict_non_voter || should_evict_voter || should_evict_read_replica;
   // When we have the same type of failures between voters and non-voters
   // we evict non-voters first, but if there is an irreversibly failed voter and
   // no irreversibly failed non-voters, then we evict such the voter first.
@@ -806,6 +857,7 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
   //   (2) unrecoverable voters
   //   (3) evictable non_voters
   //   (4) evictable voters
+  //   (5) evictable read replicas
   string to_evict;
   if (should_evict_non_voter && has_non_voter_failed_unrecoverable) {
     CHECK(!pq_non_voters.empty());
@@ -819,6 +871,9 @@ bool ShouldEvictReplica(const RaftConfigPB& config,
   } else if (should_evict_voter) {
     CHECK(!pq_voters.empty());
     to_evict = pq_voters.top().first;
+  } else if (should_evict_read_replica) {
+    CHECK(!pq_read_replicas.empty());
+    to_evict = pq_read_replicas.top().first;
   }
 
   DCHECK((!should_evict && to_evict.empty()) ||
@@ -34,6 +34,10 @@ enum RaftConfigState {
 bool IsRaftConfigMember(const std::string& uuid, const RaftConfigPB& config);
 bool IsRaftConfigVoter(const std::string& uuid, const RaftConfigPB& config);
 
+// Whether the specified peer is a witness (log-only) replica in the given
+// config. A peer that isn't a member of the config is not a witness.
+bool IsRaftConfigWitness(const std::string& uuid, const RaftConfigPB& config);
+
 // Whether the specified Raft role is attributed to a peer which can participate
 // in leader elections.
 bool IsVoterRole(RaftPeerPB::Role role);
@@ -114,15 +118,23 @@ bool ShouldAddReplica(const RaftConfigPB& config,
                       const std::unordered_set<std::string>& uuids_ignored_for_underreplication =
                           std::unordered_set<std::string>());
 
+// Return 'true' iff there is a quorum and the specified tablet configuration
+// has fewer than 'num_read_replicas' read replicas which haven't failed. Read
+// replicas are NON_VOTER replicas with the 'read_replica' attribute set, and
+// don't count towards the replication factor.
+bool ShouldAddReadReplica(const RaftConfigPB& config, int num_read_replicas);
+
 // Check if the given Raft configuration contains at least one extra replica
 // which should (and can) be removed in accordance with the specified
-// replication factor and current Raft leader. If so, and if a healthy majority
-// exists, then return 'true' and set the UUID of the best candidate for
-// eviction into the 'uuid_to_evict' out parameter. Otherwise, return 'false'.
+// replication factor, number of read replicas and current Raft leader. If so,
+// and if a healthy majority exists, then return 'true' and set the UUID of the
+// best candidate for eviction into the 'uuid_to_evict' out parameter.
+// Otherwise, return 'false'.
 bool ShouldEvictReplica(const RaftConfigPB& config,
                         const std::string& leader_uuid,
                         int replication_factor,
-                        std::string* uuid_to_evict = nullptr);
+                        std::string* uuid_to_evict = nullptr,
+                        int num_read_replicas = 0);
 
 }  // namespace consensus
 }  // namespace kudu
@@ -190,6 +190,7 @@ RaftConsensus::RaftConsensus(
       state_(kNew),
       rng_(GetRandomSeed32()),
       leader_is_ready_(false),
+      is_witness_(false),
       leader_transfer_in_progress_(false),
       withhold_votes_until_(MonoTime::Min()),
       last_received_cur_leader_(MinimumOpId()),
@@ -203,6 +204,7 @@ Status RaftConsensus::Init() {
   LockGuard l(lock_);
   DCHECK_EQ(kNew, state_) << State_Name(state_);
   RETURN_NOT_OK(cmeta_manager_->Load(options_.tablet_id, &cmeta_));
+  is_witness_ = IsRaftConfigWitness(peer_uuid(), cmeta_->CommittedConfig());
   SetStateUnlocked(kInitialized);
   return Status::OK();
 }
@@ -444,6 +446,11 @@ string ReasonString(RaftConsensus::ElectionReason reason, StringPiece leader_uui
 } // anonymous namespace
 
 Status RaftConsensus::StartElection(ElectionMode mode, ElectionReason reason) {
+  return DoStartElection(mode, reason, nullptr);
+}
+
+Status RaftConsensus::DoStartElection(ElectionMode mode, ElectionReason reason,
+                                      shared_ptr<ElectionCoordinator::Slot> slot) {
   if (server_ctx_.quiescing && server_ctx_.quiescing->load()) {
     return Status::IllegalState("leader elections are disabled");
   }
@@ -536,8 +543,8 @@ Status RaftConsensus::StartElection(ElectionMode mode, ElectionReason reason) {
         // remains safe to use for the entirety of LeaderElection's life.
         peer_proxy_factory_.get(),
         std::move(request), std::move(counter), timeout,
-        [self, reason](const ElectionResult& result) {
-          self->ElectionCallback(reason, result);
+        [self, reason, slot](const ElectionResult& result) {
+          self->ElectionCallback(reason, result, slot);
         }));
   }
 
@@ -650,8 +657,46 @@ scoped_refptr<ConsensusRound> RaftConsensus::NewRound(
 }
 
 void RaftConsensus::ReportFailureDetectedTask() {
-  Status s = StartElection(FLAGS_raft_enable_pre_election ?
-      PRE_ELECTION : NORMAL_ELECTION, ELECTION_TIMEOUT_EXPIRED);
+  const auto& coordinator = server_ctx_.election_coordinator;
+  if (coordinator) {
+    // The tablet is unavailable for sure if its leader's server isn't heard
+    // from by any replica of this server either, rather than the leader
+    // replica merely being slow to send its heartbeats.
+    string leader_uuid;
+    {
+      LockGuard l(lock_);
+      leader_uuid = GetLeaderUuidUnlocked();
+    }
+    const bool urgent = leader_uuid.empty() ||
+        !coordinator->HeardFromRecently(leader_uuid, MinimumElectionTimeout());
+    const int64_t detected_micros = GetMonoTimeMicros();
+    weak_ptr<RaftConsensus> w = shared_from_this();
+    coordinator->Schedule(urgent, [w, detected_micros](
+        shared_ptr<ElectionCoordinator::Slot> slot) {
+      auto self = w.lock();
+      if (!self) {
+        return;
+      }
+      // The slot may be handed out on a reactor thread.
+      Status s = self->raft_pool_token_->Submit([self, detected_micros, slot]() {
+        self->ScheduledElectionTask(detected_micros, slot);
+      });
+      WARN_NOT_OK(s, self->LogPrefixThreadSafe() + "failed to submit scheduled election task");
+    });
+    return;
+  }
+  ScheduledElectionTask(GetMonoTimeMicros(), nullptr);
+}
+
+void RaftConsensus::ScheduledElectionTask(int64_t detected_micros,
+                                          shared_ptr<ElectionCoordinator::Slot> slot) {
+  if (slot && last_leader_communication_time_micros_ > detected_micros) {
+    VLOG_WITH_PREFIX(1) << "Not starting scheduled election: heard from a leader since";
+    EnableFailureDetector();
+    return;
+  }
+  Status s = DoStartElection(FLAGS_raft_enable_pre_election ?
+      PRE_ELECTION : NORMAL_ELECTION, ELECTION_TIMEOUT_EXPIRED, std::move(slot));
   if (PREDICT_FALSE(!s.ok())) {
     WARN_NOT_OK_EVERY_N_SECS(
         s, LogPrefixThreadSafe() + "failed to trigger leader election", 10);
@@ -796,6 +841,11 @@ Status RaftConsensus::CheckLeadershipAndBindTerm(const scoped_refptr<ConsensusRo
       if (leader_transfer_in_progress_) {
         return Status::ServiceUnavailable("leader transfer in progress");
       }
+      if (PREDICT_FALSE(is_witness_)) {
+        // A witness leader has no tablet data to validate writes against;
+        // it only keeps leadership until a data-bearing replica catches up.
+        return Status::ServiceUnavailable("witness replicas don't accept writes");
+      }
       if (!leader_is_ready) {
         // Leader replica should not accept write operations before scheduling
         // the replication of a NO_OP to assert its leadership in the current
@@ -1483,6 +1533,9 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     WithholdVotes();
 
     last_leader_communication_time_micros_ = GetMonoTimeMicros();
+    if (server_ctx_.election_coordinator) {
+      server_ctx_.election_coordinator->RecordContact(request->caller_uuid());
+    }
 
     // Reset the 'failed_elections_since_stable_leader' metric now that we've
     // accepted an update from the established leader. This is done in addition
@@ -2655,13 +2708,14 @@ void RaftConsensus::DumpStatusHtml(std::ostream& out) const {
   }
 }
 
-void RaftConsensus::ElectionCallback(ElectionReason reason, const ElectionResult& result) {
+void RaftConsensus::ElectionCallback(ElectionReason reason, const ElectionResult& result,
+                                     shared_ptr<ElectionCoordinator::Slot> slot) {
   // We're running on a reactor thread; service the callback on another thread.
   //
   // There's no need to reenable the failure detector; if this fails, it's a
   // sign that RaftConsensus has stopped and we no longer need failure detection.
   auto self = shared_from_this();
-  Status s = raft_pool_token_->Submit([=]() { self->DoElectionCallback(reason, result); });
+  Status s = raft_pool_token_->Submit([=]() { self->DoElectionCallback(reason, result, slot); });
   if (!s.ok()) {
     static const char* const msg = "unable to run election callback";
     CHECK(s.IsServiceUnavailable()) << LogPrefixThreadSafe() << msg;
@@ -2669,7 +2723,8 @@ void RaftConsensus::ElectionCallback(ElectionReason reason, const ElectionResult
   }
 }
 
-void RaftConsensus::DoElectionCallback(ElectionReason reason, const ElectionResult& result) {
+void RaftConsensus::DoElectionCallback(ElectionReason reason, const ElectionResult& result,
+                                       shared_ptr<ElectionCoordinator::Slot> slot) {
   const int64_t election_term = result.vote_request.candidate_term();
   const bool was_pre_election = result.vote_request.is_pre_election();
   const char* election_type = was_pre_election ? "pre-election" : "election";
@@ -2779,9 +2834,10 @@ void RaftConsensus::DoElectionCallback(ElectionReason reason, const ElectionResu
   LOG_WITH_PREFIX_UNLOCKED(INFO) << "Leader " << election_type << " won for term " << election_term;
 
   if (was_pre_election) {
-    // We just won the pre-election. So, we need to call a real election.
+    // We just won the pre-election. So, we need to call a real election, which
+    // keeps the slot of the pre-election.
     l.unlock();
-    WARN_NOT_OK_EVERY_N_SECS(StartElection(NORMAL_ELECTION, reason),
+    WARN_NOT_OK_EVERY_N_SECS(DoStartElection(NORMAL_ELECTION, reason, std::move(slot)),
                              "Couldn't start leader election after successful pre-election", 10);
   } else {
     // We won a real election. Convert role to LEADER.
@@ -33,6 +33,7 @@
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus_meta.h"  // IWYU pragma: keep
 #include "kudu/consensus/consensus_queue.h"
+#include "kudu/consensus/election_coordinator.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
@@ -90,6 +91,15 @@ struct ServerContext {
   // Shared boolean indicating whether Raft consensus should continue sending request messages
   // even if a peer is considered as failed.
   const bool* allow_status_msg_for_failed_peer = nullptr;
+
+  // The server's metric entity, with the server-wide metrics of the ops of
+  // its replicas. May be null.
+  scoped_refptr<MetricEntity> server_metric_entity;
+
+  // Coordinates the elections the replicas start on failure of their
+  // leaders. May be null, in which case each replica starts its elections on
+  // its own.
+  std::shared_ptr<ElectionCoordinator> election_coordinator;
 };
 
 struct ConsensusOptions {
@@ -341,6 +351,11 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // Thread-safe.
   const std::string& tablet_id() const;
 
+  // Returns whether this replica is a witness (log-only) replica, i.e. it's
+  // marked as such in the committed config it was initialized with.
+  // Thread-safe.
+  bool IsWitness() const { return is_witness_; }
+
   TimeManager* time_manager() const { return time_manager_.get(); }
 
   // Returns a copy of the state of the consensus system.
@@ -643,10 +658,17 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   Status RequestVoteRespondVoteGranted(const VoteRequestPB* request,
                                        VoteResponsePB* response);
 
+  // Like StartElection(), 'slot' being the coordinator's slot for the
+  // election, if any, which is held until the election completes.
+  Status DoStartElection(ElectionMode mode, ElectionReason reason,
+                         std::shared_ptr<ElectionCoordinator::Slot> slot);
+
   // Callback for leader election driver. ElectionCallback is run on the
   // reactor thread, so it simply defers its work to DoElectionCallback.
-  void ElectionCallback(ElectionReason reason, const ElectionResult& result);
-  void DoElectionCallback(ElectionReason reason, const ElectionResult& result);
+  void ElectionCallback(ElectionReason reason, const ElectionResult& result,
+                        std::shared_ptr<ElectionCoordinator::Slot> slot);
+  void DoElectionCallback(ElectionReason reason, const ElectionResult& result,
+                          std::shared_ptr<ElectionCoordinator::Slot> slot);
 
   // Starts tracking the leader for failures. This occurs at startup, when a
   // local peer transitions from LEADER to FOLLOWER or from NON_VOTER to VOTER,
@@ -743,9 +765,16 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   void ReportFailureDetected();
 
   // Call StartElection(), log a warning if the call fails (usually due to
-  // being shut down).
+  // being shut down). With an election coordinator, the election is scheduled
+  // with it instead.
   void ReportFailureDetectedTask();
 
+  // Starts the election scheduled with the election coordinator when the
+  // failure detector expired at 'detected_micros', unless a leader has been
+  // heard from since.
+  void ScheduledElectionTask(int64_t detected_micros,
+                             std::shared_ptr<ElectionCoordinator::Slot> slot);
+
   // Handle the completion of replication of a config change operation.
   // If 'status' is OK, this takes care of persisting the new configuration
   // to disk as the committed configuration. A non-OK status indicates that
@@ -910,6 +939,10 @@ class RaftConsensus : public std::enable_shared_from_this<RaftConsensus>,
   // the term where it has just become a leader.
   std::atomic<bool> leader_is_ready_;
 
+  // Whether this replica is a witness. Witness status is fixed for the
+  // lifetime of a replica, so this is set once in Init().
+  std::atomic<bool> is_witness_;
+
   // A few fields used for the leadership transfer process.
   std::atomic<bool> leader_transfer_in_progress_;
   boost::optional<std::string> designated_successor_uuid_;
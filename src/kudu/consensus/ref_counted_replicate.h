@@ -16,8 +16,18 @@
 // under the License.
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 namespace consensus {
@@ -31,8 +41,50 @@ class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
     return msg_.get();
   }
 
+  // Returns the message in its serialized form. The message is serialized upon
+  // the first call only, so that the peers it is replicated to may share the
+  // result. The message must not be modified once this has been called.
+  Slice serialized() {
+    std::call_once(serialize_once_, [this]() {
+      pb_util::SerializeToString(*msg_, &serialized_);
+      std::lock_guard<simple_spinlock> l(tracker_lock_);
+      if (tracker_) {
+        tracked_bytes_ = serialized_.capacity();
+        tracker_->Consume(tracked_bytes_);
+      }
+    });
+    return Slice(serialized_);
+  }
+
+  // Charges the serialized form of the message to 'tracker', if and once it
+  // is created, until UntrackSerialized() is called.
+  void TrackSerialized(std::shared_ptr<MemTracker> tracker) {
+    std::lock_guard<simple_spinlock> l(tracker_lock_);
+    DCHECK(!tracker_);
+    tracker_ = std::move(tracker);
+  }
+
+  // Releases the charge of the serialized form of the message, if any. It
+  // isn't charged anymore if created later.
+  void UntrackSerialized() {
+    std::lock_guard<simple_spinlock> l(tracker_lock_);
+    if (tracker_) {
+      tracker_->Release(tracked_bytes_);
+      tracker_.reset();
+      tracked_bytes_ = 0;
+    }
+  }
+
  private:
   std::unique_ptr<ReplicateMsg> msg_;
+
+  std::once_flag serialize_once_;
+  faststring serialized_;
+
+  // Protects 'tracker_' and 'tracked_bytes_'.
+  simple_spinlock tracker_lock_;
+  std::shared_ptr<MemTracker> tracker_;
+  int64_t tracked_bytes_ = 0;
 };
 
 typedef scoped_refptr<RefCountedReplicate> ReplicateRefPtr;
@@ -289,5 +289,99 @@ TEST_F(TimeManagerTest, TestUpdateClockWithCommitTimestamp) {
   ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
 }
 
+// Tests picking timestamps for scans of the latest data on a leader holding
+// a lease and on a follower with bounded staleness.
+TEST_F(TimeManagerTest, TestTimestampForLatestRead) {
+  InitTimeManager();
+  Timestamp ts;
+
+  // A leader without a lease must wait for the clock.
+  time_manager_->SetLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  ASSERT_FALSE(time_manager_->GetTimestampForLatestRead(MonoDelta(), &ts));
+
+  time_manager_->SetLeaderLeaseExpiration(MonoTime::Now() + MonoDelta::FromSeconds(60));
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  ASSERT_TRUE(time_manager_->GetTimestampForLatestRead(MonoDelta(), &ts));
+  ASSERT_LE(ts, time_manager_->GetSafeTime());
+  ASSERT_LE(ts, clock_.Now());
+
+  // Expired leases aren't honored.
+  time_manager_->SetLeaderLeaseExpiration(MonoTime::Now() - MonoDelta::FromMilliseconds(1));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  ASSERT_FALSE(time_manager_->GetTimestampForLatestRead(MonoDelta(), &ts));
+
+  // Leases are dropped when losing leadership, and can't be set as a follower.
+  time_manager_->SetLeaderLeaseExpiration(MonoTime::Now() + MonoDelta::FromSeconds(60));
+  time_manager_->SetNonLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  time_manager_->SetLeaderLeaseExpiration(MonoTime::Now() + MonoDelta::FromSeconds(60));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  // A follower only serves such scans if allowed some staleness.
+  const Timestamp safe_time = clock_.Now();
+  time_manager_->AdvanceSafeTime(safe_time);
+  ASSERT_FALSE(time_manager_->GetTimestampForLatestRead(MonoDelta(), &ts));
+  ASSERT_TRUE(time_manager_->GetTimestampForLatestRead(MonoDelta::FromSeconds(60), &ts));
+  ASSERT_EQ(safe_time, ts);
+
+  // ... and only as long as safe time doesn't lag too far behind.
+  SleepFor(MonoDelta::FromMilliseconds(50));
+  ASSERT_FALSE(time_manager_->GetTimestampForLatestRead(MonoDelta::FromMilliseconds(10), &ts));
+}
+
+// Tests that callbacks registered with NotifyWhenSafe() are called once the
+// timestamp is safe, without any thread waiting meanwhile.
+TEST_F(TimeManagerTest, TestNotifyWhenSafe) {
+  InitTimeManager(clock_.Now());
+  int num_calls = 0;
+  const auto count_call = [&]() { num_calls++; };
+  const MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(60);
+
+  // Nothing to wait for if the timestamp is already safe.
+  ASSERT_FALSE(time_manager_->NotifyWhenSafe(time_manager_->GetSafeTime(), deadline, count_call));
+
+  const Timestamp first = clock_.Now();
+  const Timestamp second = clock_.Now();
+  ASSERT_TRUE(time_manager_->NotifyWhenSafe(first, deadline, count_call));
+  ASSERT_TRUE(time_manager_->NotifyWhenSafe(second, deadline, count_call));
+  ASSERT_EQ(0, num_calls);
+
+  time_manager_->AdvanceSafeTime(first);
+  ASSERT_EQ(1, num_calls);
+  time_manager_->AdvanceSafeTime(first);
+  ASSERT_EQ(1, num_calls);
+
+  // Becoming the leader releases all async waiters: the leader's safe time
+  // follows its clock.
+  ASSERT_TRUE(time_manager_->NotifyWhenSafe(
+      clock::HybridClock::AddPhysicalTimeToTimestamp(second, MonoDelta::FromSeconds(1)),
+      deadline, count_call));
+  time_manager_->SetLeaderMode();
+  ASSERT_EQ(3, num_calls);
+
+  // Leaders only wait for their clocks, which callers do in WaitUntilSafe().
+  ASSERT_FALSE(time_manager_->NotifyWhenSafe(clock_.Now(), deadline, count_call));
+  ASSERT_EQ(3, num_calls);
+}
+
+// Tests that callbacks registered with NotifyWhenSafe() are dropped once their
+// deadlines have passed, even if safe time never advances.
+TEST_F(TimeManagerTest, TestNotifyWhenSafeExpires) {
+  InitTimeManager(clock_.Now());
+  int num_calls = 0;
+  const auto count_call = [&]() { num_calls++; };
+  const Timestamp ts = clock_.Now();
+  ASSERT_TRUE(time_manager_->NotifyWhenSafe(ts, MonoTime::Now(), count_call));
+  ASSERT_EQ(1, time_manager_->async_waiters_.size());
+  SleepFor(MonoDelta::FromMilliseconds(1));
+  time_manager_->ExpireAsyncWaiters();
+  ASSERT_TRUE(time_manager_->async_waiters_.empty());
+
+  // Safe time advancing past the timestamp no longer calls the callback.
+  time_manager_->AdvanceSafeTime(ts);
+  ASSERT_EQ(0, num_calls);
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -19,8 +19,11 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -54,6 +57,7 @@ DECLARE_int32(raft_heartbeat_interval_ms);
 
 using kudu::clock::Clock;
 using std::string;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -77,17 +81,33 @@ TimeManager::TimeManager(Clock* clock, Timestamp initial_safe_time)
     last_safe_ts_(initial_safe_time),
     last_advanced_safe_time_(MonoTime::Now()),
     mode_(NON_LEADER),
+    leader_lease_expiration_(MonoTime::Min()),
     clock_(clock) {}
 
 void TimeManager::SetLeaderMode() {
-  Lock l(lock_);
-  mode_ = LEADER;
-  AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  vector<std::function<void()>> callbacks;
+  {
+    Lock l(lock_);
+    mode_ = LEADER;
+    leader_lease_expiration_ = MonoTime::Min();
+    AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now(), &callbacks);
+    // Safe time of a leader isn't advanced by the methods which notify the
+    // async waiters, so the remaining ones should rather wait in
+    // WaitUntilSafe() now.
+    for (auto& waiter : async_waiters_) {
+      callbacks.emplace_back(std::move(waiter.callback));
+    }
+    async_waiters_.clear();
+  }
+  for (const auto& cb : callbacks) {
+    cb();
+  }
 }
 
 void TimeManager::SetNonLeaderMode() {
   Lock l(lock_);
   mode_ = NON_LEADER;
+  leader_lease_expiration_ = MonoTime::Min();
 }
 
 Status TimeManager::AssignTimestamp(ReplicateMsg* message) {
@@ -152,16 +172,28 @@ Status TimeManager::UpdateClockAndLastAssignedTimestamp(const Timestamp& timesta
 }
 
 void TimeManager::AdvanceSafeTimeWithMessage(const ReplicateMsg& message) {
-  Lock l(lock_);
-  if (GetMessageConsistencyMode(message) == CLIENT_PROPAGATED) {
-    AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp(message.timestamp()));
+  vector<std::function<void()>> callbacks;
+  {
+    Lock l(lock_);
+    if (GetMessageConsistencyMode(message) == CLIENT_PROPAGATED) {
+      AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp(message.timestamp()), &callbacks);
+    }
+  }
+  for (const auto& cb : callbacks) {
+    cb();
   }
 }
 
 void TimeManager::AdvanceSafeTime(Timestamp safe_time) {
-  Lock l(lock_);
-  CHECK_EQ(mode_, NON_LEADER) << "Cannot advance safe time by timestamp in leader mode.";
-  AdvanceSafeTimeAndWakeUpWaitersUnlocked(safe_time);
+  vector<std::function<void()>> callbacks;
+  {
+    Lock l(lock_);
+    CHECK_EQ(mode_, NON_LEADER) << "Cannot advance safe time by timestamp in leader mode.";
+    AdvanceSafeTimeAndWakeUpWaitersUnlocked(safe_time, &callbacks);
+  }
+  for (const auto& cb : callbacks) {
+    cb();
+  }
 }
 
 bool TimeManager::HasAdvancedSafeTimeRecentlyUnlocked(string* error_message) {
@@ -271,7 +303,38 @@ Status TimeManager::WaitUntilSafe(Timestamp timestamp, const MonoTime& deadline)
   }
 }
 
-void TimeManager::AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp safe_time) {
+bool TimeManager::NotifyWhenSafe(Timestamp timestamp, const MonoTime& deadline,
+                                 std::function<void()> callback) {
+  Lock l(lock_);
+  ExpireAsyncWaitersUnlocked();
+  if (mode_ == LEADER || IsTimestampSafeUnlocked(timestamp)) {
+    return false;
+  }
+  string error_message;
+  if (IsSafeTimeLaggingUnlocked(timestamp, &error_message) ||
+      !HasAdvancedSafeTimeRecentlyUnlocked(&error_message)) {
+    return false;
+  }
+  async_waiters_.push_back({ timestamp, deadline, std::move(callback) });
+  return true;
+}
+
+void TimeManager::ExpireAsyncWaiters() {
+  Lock l(lock_);
+  ExpireAsyncWaitersUnlocked();
+}
+
+void TimeManager::ExpireAsyncWaitersUnlocked() {
+  DCHECK(lock_.is_locked());
+  const MonoTime now = MonoTime::Now();
+  async_waiters_.erase(
+      std::remove_if(async_waiters_.begin(), async_waiters_.end(),
+                     [&](const AsyncWaitingState& w) { return w.deadline < now; }),
+      async_waiters_.end());
+}
+
+void TimeManager::AdvanceSafeTimeAndWakeUpWaitersUnlocked(
+    Timestamp safe_time, vector<std::function<void()>>* callbacks) {
   DCHECK(lock_.is_locked());
 
   if (safe_time <= last_safe_ts_) {
@@ -290,6 +353,16 @@ void TimeManager::AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp safe_time) {
     }
     ++iter;
   }
+
+  auto async_iter = async_waiters_.begin();
+  while (async_iter != async_waiters_.end()) {
+    if (IsTimestampSafeUnlocked(async_iter->timestamp)) {
+      callbacks->emplace_back(std::move(async_iter->callback));
+      async_iter = async_waiters_.erase(async_iter);
+      continue;
+    }
+    ++async_iter;
+  }
 }
 
 bool TimeManager::IsTimestampSafe(Timestamp timestamp) {
@@ -364,6 +437,43 @@ Timestamp TimeManager::GetSerialTimestampPlusMaxError() {
   return clock_->NowLatest();
 }
 
+void TimeManager::SetLeaderLeaseExpiration(MonoTime expiration) {
+  Lock l(lock_);
+  if (mode_ == LEADER) {
+    leader_lease_expiration_ = expiration;
+  }
+}
+
+bool TimeManager::HasLeaderLease() {
+  Lock l(lock_);
+  return mode_ == LEADER && MonoTime::Now() < leader_lease_expiration_;
+}
+
+bool TimeManager::GetTimestampForLatestRead(const MonoDelta& max_staleness,
+                                            Timestamp* timestamp) {
+  Lock l(lock_);
+  if (mode_ == LEADER) {
+    if (MonoTime::Now() >= leader_lease_expiration_) {
+      return false;
+    }
+    // No other leader may have committed anything, so all ops acknowledged
+    // before this call are at or below the safe time.
+    *timestamp = GetSafeTimeUnlocked();
+    return true;
+  }
+
+  if (!max_staleness.Initialized() || PREDICT_FALSE(!clock_->HasPhysicalComponent())) {
+    return false;
+  }
+  string error_message;
+  if (!HasAdvancedSafeTimeRecentlyUnlocked(&error_message) ||
+      clock_->GetPhysicalComponentDifference(clock_->Now(), last_safe_ts_) > max_staleness) {
+    return false;
+  }
+  *timestamp = last_safe_ts_;
+  return true;
+}
+
 
 } // namespace consensus
 } // namespace kudu
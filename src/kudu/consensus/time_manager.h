@@ -16,6 +16,7 @@
 // under the License.
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -74,16 +75,22 @@ class ReplicateMsg;
 // message). In this case the TimeManager returns the last known safe time.
 //
 // This class's leadership status is meant to be in tune with the queue's as
-// the queue is responsible for broadcasting safe time from a leader (and will
-// eventually be responsible for calculating that leader's lease).
+// the queue is responsible for broadcasting safe time from a leader and for
+// calculating that leader's lease (see --raft_enable_leader_leases).
 //
-// NOTE: Until leader leases are implemented the cluster's safe time can
-// occasionally move back.  This does not mean, however, that the timestamp
-// returned by GetSafeTime() can move back.  GetSafeTime will still return
-// monotonically increasing timestamps, it's just that, in certain corner
-// cases, the timestamp returned by GetSafeTime() can't be trusted to mean that
-// all future messages will be assigned future timestamps.  This anomaly can
-// cause non-repeatable reads in certain conditions.
+// A leader holding a lease knows that no other leader can have been elected,
+// so its safe time reflects every op committed so far, and snapshot scans of
+// the latest data can be served at it without waiting for the clock or for
+// in-flight timestamp assignment. See GetTimestampForLatestRead().
+//
+// NOTE: The safe time heartbeated to followers isn't covered by leader leases,
+// so the cluster's safe time can occasionally move back.  This does not mean,
+// however, that the timestamp returned by GetSafeTime() can move back.
+// GetSafeTime will still return monotonically increasing timestamps, it's just
+// that, in certain corner cases, the timestamp returned by GetSafeTime() on a
+// follower can't be trusted to mean that all future messages will be assigned
+// future timestamps.  This anomaly can cause non-repeatable reads in certain
+// conditions.
 //
 // Multi-op transactions
 // ---------------------
@@ -181,6 +188,25 @@ class TimeManager {
   // Returns Status::ServiceUnavailable() is the request should be retried somewhere else.
   Status WaitUntilSafe(Timestamp timestamp, const MonoTime& deadline);
 
+  // Registers 'callback' to be called once 'timestamp' is safe, so the caller
+  // doesn't need to block a thread in WaitUntilSafe() meanwhile. The callback
+  // is called at most once, from the thread advancing safe time, and thus must
+  // be cheap, e.g. only hand the work over to a thread pool. It's never called
+  // if safe time doesn't advance past 'timestamp' by 'deadline', so callers
+  // must arrange for a timeout of their own; once 'deadline' has passed, the
+  // callback is dropped by ExpireAsyncWaiters() or the next registration.
+  //
+  // Returns false without registering 'callback' if the caller should call
+  // WaitUntilSafe() right away instead: in leader mode, where the wait is for
+  // the local clock, if 'timestamp' is already safe, or if WaitUntilSafe()
+  // would fail its pre-flight checks.
+  bool NotifyWhenSafe(Timestamp timestamp, const MonoTime& deadline,
+                      std::function<void()> callback);
+
+  // Drops the callbacks registered with NotifyWhenSafe() whose deadlines have
+  // passed, without calling them.
+  void ExpireAsyncWaiters();
+
   // Returns the current safe time.
   //
   // In leader mode returns clock_->Now() or some value close to it.
@@ -193,9 +219,28 @@ class TimeManager {
   // replica).
   Timestamp GetSerialTimestamp();
 
+  // Sets the time until which this replica holds a leader lease, i.e. until
+  // which a majority of voters is guaranteed not to vote for another leader.
+  //
+  // The lease is dropped whenever the leadership mode changes.
+  void SetLeaderLeaseExpiration(MonoTime expiration);
+
+  // Returns whether this replica is the leader and holds a valid lease.
+  bool HasLeaderLease();
+
+  // Picks a timestamp at which a snapshot scan of the latest data can be served
+  // without waiting for safe time to advance, returning false if there is none.
+  //
+  // On a leader holding a lease this is the current safe time, which is
+  // linearizable. On a non-leader this is the last safe time received from the
+  // leader, provided it lags the local clock by no more than 'max_staleness'
+  // (if initialized) and the leader was heard from recently.
+  bool GetTimestampForLatestRead(const MonoDelta& max_staleness, Timestamp* timestamp);
+
  private:
   FRIEND_TEST(TimeManagerTest, TestTimeManagerNonLeaderMode);
   FRIEND_TEST(TimeManagerTest, TestTimeManagerLeaderMode);
+  FRIEND_TEST(TimeManagerTest, TestNotifyWhenSafeExpires);
 
   // Returns whether we've advanced safe time recently.
   // If this returns false we might be partitioned or there might be election churn.
@@ -228,6 +273,13 @@ class TimeManager {
     CountDownLatch* latch;
   };
 
+  // State for waiters registered with NotifyWhenSafe().
+  struct AsyncWaitingState {
+    Timestamp timestamp;
+    MonoTime deadline;
+    std::function<void()> callback;
+  };
+
   // Returns whether 'timestamp' is safe.
   // Requires that we've waited for the local clock to move past 'timestamp'.
   bool IsTimestampSafe(Timestamp timestamp);
@@ -235,8 +287,14 @@ class TimeManager {
   // Internal, unlocked implementation of IsTimestampSafe().
   bool IsTimestampSafeUnlocked(Timestamp timestamp);
 
-  // Advances safe time and wakes up any waiters.
-  void AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp safe_time);
+  // Internal, unlocked implementation of ExpireAsyncWaiters().
+  void ExpireAsyncWaitersUnlocked();
+
+  // Advances safe time and wakes up any waiters. The callbacks of the async
+  // waiters that are done are appended to 'callbacks', to be called by the
+  // caller once the lock is released.
+  void AdvanceSafeTimeAndWakeUpWaitersUnlocked(Timestamp safe_time,
+                                               std::vector<std::function<void()>>* callbacks);
 
   // Internal, unlocked implementation of GetSerialTimestamp().
   Timestamp GetSerialTimestampUnlocked();
@@ -254,6 +312,9 @@ class TimeManager {
   // Vector of waiters to be notified when the safe time advances.
   std::vector<WaitingState*> waiters_;
 
+  // Callbacks to be called when the safe time advances.
+  std::vector<AsyncWaitingState> async_waiters_;
+
   // The last serial timestamp that was assigned.
   Timestamp last_serial_ts_assigned_;
 
@@ -268,6 +329,10 @@ class TimeManager {
   // The current mode of the TimeManager.
   Mode mode_;
 
+  // The time until which the leader lease is held. MonoTime::Min() if this
+  // replica doesn't hold a lease.
+  MonoTime leader_lease_expiration_;
+
   clock::Clock* clock_;
   const std::string local_peer_uuid_;
 };
@@ -46,6 +46,15 @@ TAG_FLAG(block_manager_preflush_control, experimental);
 namespace kudu {
 namespace fs {
 
+const char* StorageTierToString(StorageTier tier) {
+  switch (tier) {
+    case StorageTier::ANY: return "any";
+    case StorageTier::FAST: return "fast";
+    case StorageTier::CAPACITY: return "capacity";
+  }
+  return "unknown";
+}
+
 BlockManagerOptions::BlockManagerOptions()
   : read_only(false) {}
 
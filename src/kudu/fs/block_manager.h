@@ -167,12 +167,28 @@ class ReadableBlock : public Block {
   virtual size_t memory_footprint() const = 0;
 };
 
+// The storage tier of a data directory. See --fs_capacity_tier_data_dirs.
+enum class StorageTier {
+  // No preference; used as a placement hint only.
+  ANY,
+  // Fast storage (e.g. SSDs), for recently written or frequently scanned data.
+  FAST,
+  // Cheaper, larger storage (e.g. HDDs), for cold data.
+  CAPACITY,
+};
+
+const char* StorageTierToString(StorageTier tier);
+
 // Provides options and hints for block placement. This is used for identifying
-// the correct DataDirGroups to place blocks. In the future this may also be
-// used to specify directories based on block type (e.g. to prefer bloom block
-// placement into SSD-backed directories).
+// the correct DataDirGroups to place blocks, and the preferred storage tier
+// within them.
 struct CreateBlockOptions {
   const std::string tablet_id;
+
+  // The preferred storage tier for the block. If none of the usable data
+  // directories in the tablet's group are on this tier, the block is placed
+  // on any of them.
+  const StorageTier tier = StorageTier::ANY;
 };
 
 // Block manager creation options.
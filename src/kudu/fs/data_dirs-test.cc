@@ -65,6 +65,7 @@ DECLARE_int32(fs_data_dirs_available_space_cache_seconds);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_int64(fs_data_dirs_reserved_bytes);
+DECLARE_string(fs_capacity_tier_data_dirs);
 DECLARE_string(env_inject_eio_globs);
 DECLARE_string(env_inject_full_globs);
 
@@ -196,6 +197,41 @@ TEST_F(DataDirsTest, TestDeleteDataDirGroup) {
                                     "registered for tablet");
 }
 
+// Test that directory groups span both storage tiers and that blocks are
+// placed on the requested tier.
+TEST_F(DataDirsTest, TestStorageTiers) {
+  // Reopen the directories with all but two of them on the capacity tier.
+  const vector<string> dirs = GetDirNames(kNumDirs);
+  FLAGS_fs_capacity_tier_data_dirs =
+      JoinStrings(vector<string>(dirs.begin(), dirs.end() - 2), ",");
+  FLAGS_fs_target_data_dirs_per_tablet = 1;
+  dd_manager_.reset();
+  DataDirManagerOptions opts;
+  opts.metric_entity = entity_;
+  ASSERT_OK(DataDirManager::OpenExistingForTests(env_, dirs, opts, &dd_manager_));
+
+  for (int i = 0; i < 20; i++) {
+    const string tablet_id = Substitute("$0-$1", test_tablet_name_, i);
+    ASSERT_OK(dd_manager_->CreateDataDirGroup(tablet_id));
+    DataDirGroupPB group_pb;
+    ASSERT_OK(dd_manager_->GetDataDirGroupPB(tablet_id, &group_pb));
+    ASSERT_EQ(2, group_pb.uuids_size());
+    set<StorageTier> tiers;
+    for (const auto& uuid : group_pb.uuids()) {
+      int uuid_idx;
+      ASSERT_TRUE(dd_manager_->FindUuidIndexByUuid(uuid, &uuid_idx));
+      tiers.insert(dd_manager_->TierOfDir(uuid_idx));
+    }
+    ASSERT_EQ(2, tiers.size());
+
+    for (StorageTier tier : { StorageTier::FAST, StorageTier::CAPACITY }) {
+      Dir* dd = nullptr;
+      ASSERT_OK(dd_manager_->GetDirAddIfNecessary(CreateBlockOptions({ tablet_id, tier }), &dd));
+      ASSERT_EQ(tier, down_cast<DataDir*>(dd)->tier()) << StorageTierToString(tier);
+    }
+  }
+}
+
 // Inject full disk errors a couple different ways and make sure that we can't
 // create directory groups.
 TEST_F(DataDirsTest, TestFullDisk) {
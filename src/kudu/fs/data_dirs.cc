@@ -39,14 +39,18 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/dir_util.h"
 #include "kudu/fs/fs.pb.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
@@ -102,6 +106,18 @@ DEFINE_bool(fs_data_dirs_consider_available_space, true,
 TAG_FLAG(fs_data_dirs_consider_available_space, runtime);
 TAG_FLAG(fs_data_dirs_consider_available_space, evolving);
 
+DEFINE_string(fs_capacity_tier_data_dirs, "",
+              "Comma-separated list of the data directories, among those in "
+              "--fs_data_dirs, which are on the capacity storage tier (e.g. "
+              "backed by HDDs). The other data directories are on the fast tier "
+              "(e.g. backed by SSDs). If both tiers are present, the directory "
+              "group of every tablet includes directories of both tiers, "
+              "flushes are written to the fast tier, and compactions of cold "
+              "data are written to the capacity tier. See "
+              "--tablet_cold_data_threshold_secs.");
+TAG_FLAG(fs_capacity_tier_data_dirs, advanced);
+TAG_FLAG(fs_capacity_tier_data_dirs, experimental);
+
 DEFINE_uint64(fs_max_thread_count_per_data_dir, 8,
               "Maximum work thread per data directory.");
 TAG_FLAG(fs_max_thread_count_per_data_dir, advanced);
@@ -144,7 +160,8 @@ using strings::SubstituteAndAppend;
 ////////////////////////////////////////////////////////////
 
 #define GINIT(member, x) member = METRIC_##x.Instantiate(metric_entity, 0)
-DataDirMetrics::DataDirMetrics(const scoped_refptr<MetricEntity>& metric_entity) {
+DataDirMetrics::DataDirMetrics(const scoped_refptr<MetricEntity>& metric_entity)
+    : io_scheduler(metric_entity) {
   GINIT(dirs_failed, data_dirs_failed);
   GINIT(dirs_full, data_dirs_full);
 }
@@ -198,15 +215,36 @@ Status DataDirGroup::CopyToPB(const UuidByUuidIndexMap& uuid_by_uuid_idx,
 
 DataDir::DataDir(Env* env, DirMetrics* metrics, FsType fs_type, std::string dir,
                  std::unique_ptr<DirInstanceMetadataFile> metadata_file,
-                 std::unique_ptr<ThreadPool> pool)
-    : Dir(env, metrics, fs_type, std::move(dir), std::move(metadata_file), std::move(pool)) {}
+                 std::unique_ptr<ThreadPool> pool,
+                 StorageTier tier)
+    : Dir(env, metrics, fs_type, std::move(dir), std::move(metadata_file), std::move(pool)),
+      tier_(tier),
+      // Data directories are always created with DataDirMetrics.
+      io_scheduler_(metrics ? &static_cast<DataDirMetrics*>(metrics)->io_scheduler : nullptr) {
+  DCHECK(tier_ != StorageTier::ANY);
+}
 
 std::unique_ptr<Dir> DataDirManager::CreateNewDir(
     Env* env, DirMetrics* metrics, FsType fs_type,
     std::string dir, std::unique_ptr<DirInstanceMetadataFile> metadata_file,
     std::unique_ptr<ThreadPool> pool) {
+  // 'dir' is the data subdirectory of one of the canonicalized data roots.
+  StorageTier tier = StorageTier::FAST;
+  const string root = DirName(dir);
+  for (const auto& capacity_dir : strings::Split(FLAGS_fs_capacity_tier_data_dirs, ",",
+                                                 strings::SkipEmpty())) {
+    string canonicalized;
+    if (!env->Canonicalize(capacity_dir.ToString(), &canonicalized).ok()) {
+      canonicalized = capacity_dir.ToString();
+    }
+    if (canonicalized == root) {
+      tier = StorageTier::CAPACITY;
+      LOG(INFO) << Substitute("Data directory $0 is on the capacity storage tier", root);
+      break;
+    }
+  }
   return unique_ptr<Dir>(new DataDir(env, metrics, fs_type, std::move(dir),
-                                     std::move(metadata_file), std::move(pool)));
+                                     std::move(metadata_file), std::move(pool), tier));
 }
 
 int DataDir::available_space_cache_secs() const {
@@ -393,6 +431,7 @@ Status DataDirManager::CreateDataDirGroup(const string& tablet_id,
     if (PREDICT_FALSE(group_indices.empty())) {
       return Status::IOError("All healthy data directories are full", "", ENOSPC);
     }
+    AddMissingTiersToGroupUnlocked(&group_indices);
     if (PREDICT_FALSE(group_indices.size() < FLAGS_fs_target_data_dirs_per_tablet)) {
       string msg = Substitute("Could only allocate $0 dirs of requested $1 for tablet "
                               "$2. $3 dirs total", group_indices.size(),
@@ -472,6 +511,18 @@ Status DataDirManager::GetDirForBlock(const CreateBlockOptions& opts, Dir** dir,
                    opts.tablet_id, num_total, num_failed, num_full),
         "", ENOSPC);
   }
+  // Prefer the directories on the requested storage tier, if there are any.
+  if (opts.tier != StorageTier::ANY) {
+    vector<Dir*> tier_dirs;
+    for (auto* candidate : candidate_dirs) {
+      if (down_cast<DataDir*>(candidate)->tier() == opts.tier) {
+        tier_dirs.emplace_back(candidate);
+      }
+    }
+    if (!tier_dirs.empty()) {
+      candidate_dirs.swap(tier_dirs);
+    }
+  }
   if (candidate_dirs.size() == 1) {
     *dir = candidate_dirs[0];
     return Status::OK();
@@ -568,7 +619,8 @@ Status DataDirManager::GetDirAddIfNecessary(const CreateBlockOptions& opts, Dir*
 }
 
 void DataDirManager::GetDirsForGroupUnlocked(int target_size,
-                                             vector<int>* group_indices) {
+                                             vector<int>* group_indices,
+                                             StorageTier tier) {
   DCHECK(dir_group_lock_.is_locked());
   vector<int> candidate_indices;
   unordered_set<int> existing_group_indices(group_indices->begin(), group_indices->end());
@@ -579,6 +631,9 @@ void DataDirManager::GetDirsForGroupUnlocked(int target_size,
         ContainsKey(failed_dirs_, uuid_idx)) {
       continue;
     }
+    if (tier != StorageTier::ANY && TierOfDir(uuid_idx) != tier) {
+      continue;
+    }
     Dir* dd = e.second;
     Status s = dd->RefreshAvailableSpace(Dir::RefreshMode::ALWAYS);
     WARN_NOT_OK(s, Substitute("failed to refresh fullness of $0", dd->dir()));
@@ -614,6 +669,33 @@ void DataDirManager::GetDirsForGroupUnlocked(int target_size,
   }
 }
 
+void DataDirManager::AddMissingTiersToGroupUnlocked(vector<int>* group_indices) {
+  DCHECK(dir_group_lock_.is_locked());
+  set<StorageTier> all_tiers;
+  for (const auto& e : dir_by_uuid_idx_) {
+    all_tiers.insert(TierOfDir(e.first));
+  }
+  if (all_tiers.size() < 2) {
+    return;
+  }
+  for (StorageTier tier : all_tiers) {
+    bool in_group = false;
+    for (int uuid_idx : *group_indices) {
+      if (TierOfDir(uuid_idx) == tier) {
+        in_group = true;
+        break;
+      }
+    }
+    if (!in_group) {
+      GetDirsForGroupUnlocked(group_indices->size() + 1, group_indices, tier);
+    }
+  }
+}
+
+StorageTier DataDirManager::TierOfDir(int uuid_idx) const {
+  return down_cast<DataDir*>(FindOrDie(dir_by_uuid_idx_, uuid_idx))->tier();
+}
+
 Status DataDirManager::FindDataDirsByTabletId(const string& tablet_id,
                                               vector<string>* data_dirs) const {
   CHECK(data_dirs);
@@ -24,7 +24,9 @@
 
 #include <gtest/gtest_prod.h>
 
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/dir_manager.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/status.h"
@@ -39,13 +41,14 @@ class ThreadPool;
 namespace fs {
 
 class DirInstanceMetadataFile;
-struct CreateBlockOptions;
 
 const char kInstanceMetadataFileName[] = "block_manager_instance";
 const char kDataDirName[] = "data";
 
 struct DataDirMetrics : public DirMetrics {
   explicit DataDirMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  IOSchedulerMetrics io_scheduler;
 };
 
 namespace internal {
@@ -94,10 +97,23 @@ class DataDir : public Dir {
           FsType fs_type,
           std::string dir,
           std::unique_ptr<DirInstanceMetadataFile> metadata_file,
-          std::unique_ptr<ThreadPool> pool);
+          std::unique_ptr<ThreadPool> pool,
+          StorageTier tier = StorageTier::FAST);
 
   int available_space_cache_secs() const override;
   int reserved_bytes() const override;
+
+  // The storage tier of the directory, as configured with
+  // --fs_capacity_tier_data_dirs.
+  StorageTier tier() const { return tier_; }
+
+  // The scheduler of the block IO issued against the directory.
+  IOScheduler* io_scheduler() { return &io_scheduler_; }
+
+ private:
+  const StorageTier tier_;
+
+  IOScheduler io_scheduler_;
 };
 
 struct DataDirManagerOptions : public DirManagerOptions {
@@ -196,6 +212,7 @@ class DataDirManager : public DirManager {
   FRIEND_TEST(DataDirsTest, TestLoadBalancingBias);
   FRIEND_TEST(DataDirsTest, TestLoadBalancingDistribution);
   FRIEND_TEST(DataDirsTest, TestFailedDirNotAddedToGroup);
+  FRIEND_TEST(DataDirsTest, TestStorageTiers);
 
   // Populates the maps to index the given directories.
   Status PopulateDirectoryMaps(const std::vector<std::unique_ptr<Dir>>& dirs) override;
@@ -239,7 +256,20 @@ class DataDirManager : public DirManager {
   // not considered. Although this function does not itself change
   // DataDirManager state, its expected usage warrants that it is called within
   // the scope of a lock_guard of dir_group_lock_.
-  void GetDirsForGroupUnlocked(int target_size, std::vector<int>* group_indices);
+  //
+  // If 'tier' is not StorageTier::ANY, only directories on that tier are
+  // selected.
+  void GetDirsForGroupUnlocked(int target_size, std::vector<int>* group_indices,
+                               StorageTier tier = StorageTier::ANY);
+
+  // If the data directories are split into storage tiers, adds a directory of
+  // each tier missing from 'group_indices', so that every tablet can place
+  // blocks on every tier. Must be called within the scope of a lock_guard of
+  // dir_group_lock_.
+  void AddMissingTiersToGroupUnlocked(std::vector<int>* group_indices);
+
+  // Returns the storage tier of the directory with the given UUID index.
+  StorageTier TierOfDir(int uuid_idx) const;
 
   // Goes through the data dirs in 'uuid_indices' and populates
   // 'healthy_indices' with those that haven't failed.
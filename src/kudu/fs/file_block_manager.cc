@@ -37,6 +37,7 @@
 #include "kudu/fs/dir_manager.h"
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs_report.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/map-util.h"
@@ -340,16 +341,17 @@ Status FileWritableBlock::Append(const Slice& data) {
 
 Status FileWritableBlock::AppendV(ArrayView<const Slice> data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY) << "Invalid state: " << state_;
-  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
-  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshAvailableSpace(
-      Dir::RefreshMode::ALWAYS));
-  state_ = DIRTY;
 
   // Calculate the amount of data written
   size_t bytes_written = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
                                     [&](int sum, const Slice& curr) {
                                       return sum + curr.size();
                                     });
+  down_cast<DataDir*>(location_.data_dir())->io_scheduler()->Admit(bytes_written);
+  RETURN_NOT_OK_HANDLE_ERROR(writer_->AppendV(data));
+  RETURN_NOT_OK_HANDLE_ERROR(location_.data_dir()->RefreshAvailableSpace(
+      Dir::RefreshMode::ALWAYS));
+  state_ = DIRTY;
   bytes_appended_ += bytes_written;
   return Status::OK();
 }
@@ -530,14 +532,19 @@ Status FileReadableBlock::Read(uint64_t offset, Slice result) const {
 Status FileReadableBlock::ReadV(uint64_t offset, ArrayView<Slice> results) const {
   DCHECK(!closed_.Load());
 
+  // Calculate the read amount of data
+  size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                                 [&](int sum, const Slice& curr) {
+                                   return sum + curr.size();
+                                 });
+  Dir* dir = block_manager_->dd_manager_->FindDirByUuidIndex(
+      internal::FileBlockLocation::GetDirIdx(block_id_));
+  if (dir) {
+    down_cast<DataDir*>(dir)->io_scheduler()->Admit(bytes_read);
+  }
   RETURN_NOT_OK_HANDLE_ERROR(reader_->ReadV(offset + reader_->GetEncryptionHeaderSize(), results));
 
   if (block_manager_->metrics_) {
-    // Calculate the read amount of data
-    size_t bytes_read = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
-                                   [&](int sum, const Slice& curr) {
-                                     return sum + curr.size();
-                                   });
     block_manager_->metrics_->total_bytes_read->IncrementBy(bytes_read);
   }
 
@@ -163,10 +163,12 @@ namespace kudu {
 const char *FsManager::kWalDirName = "wals";
 const char *FsManager::kWalFileNamePrefix = "wal";
 const char *FsManager::kWalsRecoveryDirSuffix = ".recovery";
+const char *FsManager::kTabletMetadataUpdateLogSuffix = ".updates";
 const char *FsManager::kTabletMetadataDirName = "tablet-meta";
 const char *FsManager::kDataDirName = "data";
 const char *FsManager::kInstanceMetadataFileName = "instance";
 const char *FsManager::kConsensusMetadataDirName = "consensus-meta";
+const char *FsManager::kBlockCacheKeysFileName = "block-cache-keys";
 
 FsManagerOpts::FsManagerOpts()
   : wal_root(FLAGS_fs_wal_dir),
@@ -744,12 +746,20 @@ string FsManager::GetTabletMetadataPath(const string& tablet_id) const {
   return JoinPathSegments(GetTabletMetadataDir(), tablet_id);
 }
 
+string FsManager::GetTabletMetadataUpdateLogPath(const string& tablet_id) const {
+  return GetTabletMetadataPath(tablet_id) + kTabletMetadataUpdateLogSuffix;
+}
+
 bool FsManager::IsValidTabletId(const string& fname) {
   // Prevent warning logs for hidden files or ./..
   if (PREDICT_FALSE(HasPrefixString(fname, "."))) {
     VLOG(1) << "Ignoring hidden file in tablet metadata dir: " << fname;
     return false;
   }
+  // The metadata update logs are stored next to the superblocks.
+  if (HasSuffixString(fname, kTabletMetadataUpdateLogSuffix)) {
+    return false;
+  }
 
   string canonicalized_uuid;
   Status s = oid_generator_.Canonicalize(fname, &canonicalized_uuid);
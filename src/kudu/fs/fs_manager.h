@@ -159,6 +159,7 @@ class FsManager {
  public:
   static const char *kWalFileNamePrefix;
   static const char *kWalsRecoveryDirSuffix;
+  static const char *kTabletMetadataUpdateLogSuffix;
 
   FsManager(Env* env, FsManagerOpts opts);
   ~FsManager();
@@ -270,6 +271,10 @@ class FsManager {
   // Return the path for a specific tablet's superblock.
   std::string GetTabletMetadataPath(const std::string& tablet_id) const;
 
+  // Return the path for a specific tablet's metadata update log, which is
+  // stored next to its superblock.
+  std::string GetTabletMetadataUpdateLogPath(const std::string& tablet_id) const;
+
   // List the tablet IDs in the metadata directory.
   Status ListTabletIds(std::vector<std::string>* tablet_ids);
 
@@ -287,6 +292,13 @@ class FsManager {
     return JoinPathSegments(GetConsensusMetadataDir(), tablet_id);
   }
 
+  // Return the path where the keys of the blocks in the block cache are
+  // persisted, to warm up the cache after restarts.
+  std::string GetBlockCacheKeysPath() const {
+    DCHECK(initted_);
+    return JoinPathSegments(canonicalized_metadata_fs_root_.path, kBlockCacheKeysFileName);
+  }
+
   Env* env() { return env_; }
 
   bool read_only() const {
@@ -400,6 +412,7 @@ class FsManager {
   static const char *kWalDirName;
   static const char *kInstanceMetadataFileName;
   static const char *kConsensusMetadataDirName;
+  static const char *kBlockCacheKeysFileName;
 
   // The environment to be used for all filesystem operations.
   Env* env_;
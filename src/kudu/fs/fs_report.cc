@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/fs/fs_report.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <utility>
@@ -261,6 +262,9 @@ void FsReport::Stats::MergeFrom(const FsReport::Stats& other) {
   live_block_bytes_aligned += other.live_block_bytes_aligned;
   lbm_container_count += other.lbm_container_count;
   lbm_full_container_count += other.lbm_full_container_count;
+  // The phases of different reports run concurrently.
+  lbm_load_containers_ms = std::max(lbm_load_containers_ms, other.lbm_load_containers_ms);
+  lbm_repair_ms = std::max(lbm_repair_ms, other.lbm_repair_ms);
 }
 
 string FsReport::Stats::ToString() const {
@@ -268,9 +272,12 @@ string FsReport::Stats::ToString() const {
       "Total live blocks: $0\n"
       "Total live bytes: $1\n"
       "Total live bytes (after alignment): $2\n"
-      "Total number of LBM containers: $3 ($4 full)\n",
+      "Total number of LBM containers: $3 ($4 full)\n"
+      "Time spent loading LBM containers: $5 ms\n"
+      "Time spent repairing LBM containers: $6 ms\n",
       live_block_count, live_block_bytes, live_block_bytes_aligned,
-      lbm_container_count, lbm_full_container_count);
+      lbm_container_count, lbm_full_container_count,
+      lbm_load_containers_ms, lbm_repair_ms);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -247,6 +247,13 @@ struct FsReport {
 
     // Total number of full LBM containers.
     int64_t lbm_full_container_count = 0;
+
+    // Wall time spent opening LBM containers and replaying their metadata
+    // at startup, across all data directories.
+    int64_t lbm_load_containers_ms = 0;
+
+    // Wall time spent repairing LBM inconsistencies at startup.
+    int64_t lbm_repair_ms = 0;
   };
   Stats stats;
 
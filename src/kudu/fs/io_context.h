@@ -17,11 +17,29 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace kudu {
 namespace fs {
 
+// The class of a high-level operation doing IO, used by the IOScheduler to
+// share the bandwidth of each data directory among concurrent operations.
+enum class IOPriority : uint8_t {
+  // Foreground reads on behalf of clients, e.g. scans.
+  SCAN,
+  // Flushes of in-memory stores.
+  FLUSH,
+  // Rowset and delta compactions, and other background maintenance.
+  COMPACTION,
+  // Copies of tablet data to or from other servers.
+  TABLET_COPY,
+};
+
+constexpr int kNumIOPriorities = static_cast<int>(IOPriority::TABLET_COPY) + 1;
+
+const char* IOPriorityToString(IOPriority priority);
+
 // An IOContext provides a single interface to pass state around during IO. A
 // single IOContext should correspond to a single high-level operation that
 // does IO, e.g. a scan, a tablet bootstrap, etc.
@@ -43,6 +61,9 @@ namespace fs {
 struct IOContext {
   // The tablet id associated with this IO.
   std::string tablet_id;
+
+  // The class of the operation, used to schedule its IO.
+  IOPriority priority = IOPriority::SCAN;
 };
 
 }  // namespace fs
@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/io_scheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(fs_io_scheduler_iops_per_dir);
+DECLARE_int32(fs_io_scheduler_mb_per_dir);
+
+METRIC_DECLARE_entity(server);
+
+namespace kudu {
+namespace fs {
+
+class IOSchedulerTest : public KuduTest {
+ public:
+  IOSchedulerTest()
+      : entity_(METRIC_ENTITY_server.Instantiate(&registry_, "test")),
+        metrics_(entity_),
+        scheduler_(&metrics_) {}
+
+ protected:
+  int64_t BytesOf(IOPriority priority) const {
+    return metrics_.bytes[static_cast<int>(priority)]->value();
+  }
+
+  int64_t ThrottledOf(IOPriority priority) const {
+    return metrics_.throttle_wait_us[static_cast<int>(priority)]->TotalCount();
+  }
+
+  MetricRegistry registry_;
+  scoped_refptr<MetricEntity> entity_;
+  IOSchedulerMetrics metrics_;
+  IOScheduler scheduler_;
+};
+
+TEST_F(IOSchedulerTest, TestThreadPriority) {
+  ASSERT_EQ(IOPriority::SCAN, ScopedIOPriority::Current());
+  {
+    ScopedIOPriority p(IOPriority::COMPACTION);
+    ASSERT_EQ(IOPriority::COMPACTION, ScopedIOPriority::Current());
+    {
+      ScopedIOPriority p2(IOPriority::TABLET_COPY);
+      ASSERT_EQ(IOPriority::TABLET_COPY, ScopedIOPriority::Current());
+      scheduler_.Admit(100);
+    }
+    ASSERT_EQ(IOPriority::COMPACTION, ScopedIOPriority::Current());
+    scheduler_.Admit(10);
+  }
+  ASSERT_EQ(IOPriority::SCAN, ScopedIOPriority::Current());
+  scheduler_.Admit(1);
+
+  // Without a budget, IO is only accounted.
+  ASSERT_EQ(1, BytesOf(IOPriority::SCAN));
+  ASSERT_EQ(0, BytesOf(IOPriority::FLUSH));
+  ASSERT_EQ(10, BytesOf(IOPriority::COMPACTION));
+  ASSERT_EQ(100, BytesOf(IOPriority::TABLET_COPY));
+  ASSERT_EQ(0, ThrottledOf(IOPriority::SCAN));
+}
+
+// A class alone on the directory may use the whole budget, not just its share.
+TEST_F(IOSchedulerTest, TestIdleCapacityIsShared) {
+  FLAGS_fs_io_scheduler_mb_per_dir = 10;
+  constexpr int64_t kIOSize = 64 * 1024;
+  constexpr int kNumIOs = 32;  // 2 MiB, i.e. 0.2s worth of the whole budget.
+
+  MonoTime start = MonoTime::Now();
+  for (int i = 0; i < kNumIOs; i++) {
+    scheduler_.Admit(IOPriority::COMPACTION, kIOSize);
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+
+  // At its share (15%) of the budget, compaction would take more than a second.
+  LOG(INFO) << "Issued compaction IO in " << elapsed.ToString();
+  ASSERT_GT(elapsed.ToSeconds(), 0.05);
+  ASSERT_LT(elapsed.ToSeconds(), 1.0);
+  ASSERT_EQ(kIOSize * kNumIOs, BytesOf(IOPriority::COMPACTION));
+  ASSERT_GT(ThrottledOf(IOPriority::COMPACTION), 0);
+}
+
+// Under contention, background IO keeps progressing at roughly its share.
+TEST_F(IOSchedulerTest, TestSharesUnderContention) {
+  FLAGS_fs_io_scheduler_iops_per_dir = 1000;
+  std::atomic<bool> stop(false);
+  std::thread scanner([&]() {
+    while (!stop) {
+      scheduler_.Admit(IOPriority::SCAN, 4096);
+    }
+  });
+  std::thread compactor([&]() {
+    while (!stop) {
+      scheduler_.Admit(IOPriority::COMPACTION, 4096);
+    }
+  });
+  SleepFor(MonoDelta::FromSeconds(1));
+  stop = true;
+  scanner.join();
+  compactor.join();
+
+  const int64_t scan_ops = BytesOf(IOPriority::SCAN) / 4096;
+  const int64_t compaction_ops = BytesOf(IOPriority::COMPACTION) / 4096;
+  LOG(INFO) << "Scan IOs: " << scan_ops << ", compaction IOs: " << compaction_ops;
+
+  // Neither class is starved, and the directory's budget is respected.
+  ASSERT_GT(compaction_ops, 50);
+  ASSERT_GT(scan_ops, compaction_ops);
+  ASSERT_LT(scan_ops + compaction_ops, 1500);
+}
+
+}  // namespace fs
+}  // namespace kudu
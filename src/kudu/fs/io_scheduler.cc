@@ -0,0 +1,223 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/io_scheduler.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(fs_io_scheduler_mb_per_dir, 0,
+             "Block IO bandwidth budget of each data directory, in MiB/s, shared "
+             "among scans, flushes, compactions and tablet copies according to "
+             "--fs_io_scheduler_*_share. IO classes exceeding their share are "
+             "throttled only when the directory as a whole is over budget. "
+             "A value of 0 disables bandwidth-based scheduling.");
+DEFINE_validator(fs_io_scheduler_mb_per_dir,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(fs_io_scheduler_mb_per_dir, experimental);
+TAG_FLAG(fs_io_scheduler_mb_per_dir, runtime);
+
+DEFINE_int32(fs_io_scheduler_iops_per_dir, 0,
+             "Block IO operations per second budget of each data directory, "
+             "shared like --fs_io_scheduler_mb_per_dir. A value of 0 disables "
+             "IOPS-based scheduling.");
+DEFINE_validator(fs_io_scheduler_iops_per_dir,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(fs_io_scheduler_iops_per_dir, experimental);
+TAG_FLAG(fs_io_scheduler_iops_per_dir, runtime);
+
+static bool ValidateShare(const char* /*flagname*/, int32_t value) {
+  return value > 0;
+}
+
+DEFINE_int32(fs_io_scheduler_scan_share, 60,
+             "Relative share of the data directory IO budget reserved for scans.");
+DEFINE_validator(fs_io_scheduler_scan_share, &ValidateShare);
+TAG_FLAG(fs_io_scheduler_scan_share, experimental);
+TAG_FLAG(fs_io_scheduler_scan_share, runtime);
+
+DEFINE_int32(fs_io_scheduler_flush_share, 20,
+             "Relative share of the data directory IO budget reserved for flushes.");
+DEFINE_validator(fs_io_scheduler_flush_share, &ValidateShare);
+TAG_FLAG(fs_io_scheduler_flush_share, experimental);
+TAG_FLAG(fs_io_scheduler_flush_share, runtime);
+
+DEFINE_int32(fs_io_scheduler_compaction_share, 15,
+             "Relative share of the data directory IO budget reserved for "
+             "compactions and other background maintenance.");
+DEFINE_validator(fs_io_scheduler_compaction_share, &ValidateShare);
+TAG_FLAG(fs_io_scheduler_compaction_share, experimental);
+TAG_FLAG(fs_io_scheduler_compaction_share, runtime);
+
+DEFINE_int32(fs_io_scheduler_tablet_copy_share, 5,
+             "Relative share of the data directory IO budget reserved for "
+             "tablet copies.");
+DEFINE_validator(fs_io_scheduler_tablet_copy_share, &ValidateShare);
+TAG_FLAG(fs_io_scheduler_tablet_copy_share, experimental);
+TAG_FLAG(fs_io_scheduler_tablet_copy_share, runtime);
+
+#define IO_SCHEDULER_METRICS(class_name, class_label)                              \
+  METRIC_DEFINE_counter(server, io_scheduler_##class_name##_bytes,                 \
+                        "Block IO Bytes (" class_label ")",                        \
+                        kudu::MetricUnit::kBytes,                                  \
+                        "Number of bytes of block data read or written by "        \
+                        class_label " since service start",                        \
+                        kudu::MetricLevel::kDebug);                                \
+  METRIC_DEFINE_histogram(server, io_scheduler_##class_name##_throttle_wait_us,    \
+                          "Block IO Throttle Wait Time (" class_label ")",         \
+                          kudu::MetricUnit::kMicroseconds,                         \
+                          "Time spent by " class_label " waiting for the IO "      \
+                          "scheduler of a data directory, for each throttled IO",  \
+                          kudu::MetricLevel::kInfo,                                \
+                          60000000LU, 2)
+
+IO_SCHEDULER_METRICS(scan, "scans");
+IO_SCHEDULER_METRICS(flush, "flushes");
+IO_SCHEDULER_METRICS(compaction, "compactions");
+IO_SCHEDULER_METRICS(tablet_copy, "tablet copies");
+
+#undef IO_SCHEDULER_METRICS
+
+namespace kudu {
+namespace fs {
+
+namespace {
+
+// How long an idle class or directory may accrue budget for, which bounds the
+// burst of IO it may later issue without being throttled.
+constexpr double kBurstSecs = 0.1;
+
+double ShareOf(int priority_idx) {
+  const int32_t shares[kNumIOPriorities] = {
+    FLAGS_fs_io_scheduler_scan_share,
+    FLAGS_fs_io_scheduler_flush_share,
+    FLAGS_fs_io_scheduler_compaction_share,
+    FLAGS_fs_io_scheduler_tablet_copy_share,
+  };
+  double total = 0;
+  for (int32_t s : shares) {
+    total += s;
+  }
+  return shares[priority_idx] / total;
+}
+
+} // anonymous namespace
+
+const char* IOPriorityToString(IOPriority priority) {
+  switch (priority) {
+    case IOPriority::SCAN: return "scan";
+    case IOPriority::FLUSH: return "flush";
+    case IOPriority::COMPACTION: return "compaction";
+    case IOPriority::TABLET_COPY: return "tablet copy";
+  }
+  LOG(FATAL) << "unknown IO priority";
+  return nullptr;
+}
+
+#define MINIT(class_name, idx)                                                    \
+  bytes[idx] = METRIC_io_scheduler_##class_name##_bytes.Instantiate(metric_entity); \
+  throttle_wait_us[idx] =                                                         \
+      METRIC_io_scheduler_##class_name##_throttle_wait_us.Instantiate(metric_entity)
+IOSchedulerMetrics::IOSchedulerMetrics(const scoped_refptr<MetricEntity>& metric_entity) {
+  MINIT(scan, static_cast<int>(IOPriority::SCAN));
+  MINIT(flush, static_cast<int>(IOPriority::FLUSH));
+  MINIT(compaction, static_cast<int>(IOPriority::COMPACTION));
+  MINIT(tablet_copy, static_cast<int>(IOPriority::TABLET_COPY));
+}
+#undef MINIT
+
+__thread IOPriority ScopedIOPriority::threadlocal_priority_ = IOPriority::SCAN;
+
+IOScheduler::IOScheduler(const IOSchedulerMetrics* metrics)
+    : metrics_(metrics),
+      last_refill_(MonoTime::Now()) {
+}
+
+void IOScheduler::Admit(IOPriority priority, int64_t bytes) {
+  const int idx = static_cast<int>(priority);
+  if (metrics_) {
+    metrics_->bytes[idx]->IncrementBy(bytes);
+  }
+  const double bytes_per_sec = FLAGS_fs_io_scheduler_mb_per_dir * 1024.0 * 1024.0;
+  const double ops_per_sec = FLAGS_fs_io_scheduler_iops_per_dir;
+  if (bytes_per_sec == 0 && ops_per_sec == 0) {
+    return;
+  }
+
+  double wait_secs = 0;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    RefillUnlocked(MonoTime::Now(), bytes_per_sec, ops_per_sec);
+    Bucket* cls = &classes_[idx];
+    const auto has_budget = [&](const Bucket& b) {
+      return (bytes_per_sec == 0 || b.bytes >= 0) && (ops_per_sec == 0 || b.ops >= 0);
+    };
+    const bool within_share = has_budget(*cls);
+    const bool dir_has_budget = has_budget(dir_);
+
+    dir_.bytes -= bytes;
+    dir_.ops -= 1;
+    // IO that borrows idle capacity from other classes isn't charged to the
+    // class's own share.
+    if (within_share || !dir_has_budget) {
+      cls->bytes -= bytes;
+      cls->ops -= 1;
+    }
+    if (!within_share && !dir_has_budget) {
+      // Wait until the class's share has repaid its debt.
+      const double share = ShareOf(idx);
+      if (bytes_per_sec > 0) {
+        wait_secs = std::max(wait_secs, -cls->bytes / (bytes_per_sec * share));
+      }
+      if (ops_per_sec > 0) {
+        wait_secs = std::max(wait_secs, -cls->ops / (ops_per_sec * share));
+      }
+    }
+  }
+  if (wait_secs > 0) {
+    SleepFor(MonoDelta::FromSeconds(wait_secs));
+    if (metrics_) {
+      metrics_->throttle_wait_us[idx]->Increment(static_cast<int64_t>(wait_secs * 1e6));
+    }
+  }
+}
+
+void IOScheduler::RefillUnlocked(const MonoTime& now, double bytes_per_sec, double ops_per_sec) {
+  const double elapsed_secs = (now - last_refill_).ToSeconds();
+  if (elapsed_secs <= 0) {
+    return;
+  }
+  last_refill_ = now;
+  const auto refill = [&](Bucket* b, double share) {
+    const double bytes_rate = bytes_per_sec * share;
+    const double ops_rate = ops_per_sec * share;
+    b->bytes = std::min(b->bytes + elapsed_secs * bytes_rate, bytes_rate * kBurstSecs);
+    b->ops = std::min(b->ops + elapsed_secs * ops_rate, ops_rate * kBurstSecs);
+  };
+  refill(&dir_, 1.0);
+  for (int i = 0; i < kNumIOPriorities; i++) {
+    refill(&classes_[i], ShareOf(i));
+  }
+}
+
+}  // namespace fs
+}  // namespace kudu
@@ -0,0 +1,125 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+namespace fs {
+
+struct IOSchedulerMetrics {
+  explicit IOSchedulerMetrics(const scoped_refptr<MetricEntity>& metric_entity);
+
+  // Indexed by IOPriority.
+  scoped_refptr<Counter> bytes[kNumIOPriorities];
+  scoped_refptr<Histogram> throttle_wait_us[kNumIOPriorities];
+};
+
+// Sets the IO priority of the current thread for the lifetime of this object.
+// Block IO issued by the thread is scheduled according to this priority.
+// Threads that have not adopted a priority do IO with IOPriority::SCAN.
+//
+// Scopes may be nested; the innermost one wins.
+class ScopedIOPriority {
+ public:
+  explicit ScopedIOPriority(IOPriority priority)
+      : old_priority_(threadlocal_priority_) {
+    threadlocal_priority_ = priority;
+  }
+
+  ~ScopedIOPriority() {
+    threadlocal_priority_ = old_priority_;
+  }
+
+  // Returns the IO priority of the current thread.
+  static IOPriority Current() { return threadlocal_priority_; }
+
+ private:
+  static __thread IOPriority threadlocal_priority_;
+
+  const IOPriority old_priority_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedIOPriority);
+};
+
+// Schedules the block IO of a single data directory among the IO priority
+// classes.
+//
+// The directory's bandwidth and IOPS budgets (--fs_io_scheduler_mb_per_dir and
+// --fs_io_scheduler_iops_per_dir) are split among the classes according to
+// their shares (--fs_io_scheduler_*_share). Each class is entitled to its
+// share; a class that has exhausted its share may still use capacity left
+// idle by the other classes. Only when the directory as a whole is out of
+// budget is a class throttled, and then only until its own share has repaid
+// the IO it issued. As a result, background IO keeps progressing at its share
+// even under heavy foreground load, but can't starve foreground IO.
+//
+// If neither budget is configured, IO is only accounted in the metrics.
+//
+// This class is thread-safe.
+class IOScheduler {
+ public:
+  // 'metrics' may be null, in which case no metrics are recorded.
+  explicit IOScheduler(const IOSchedulerMetrics* metrics);
+
+  // Accounts an IO of 'bytes' bytes with the priority of the current thread,
+  // blocking the caller if the IO exceeds the priority's share of the budget.
+  void Admit(int64_t bytes) {
+    Admit(ScopedIOPriority::Current(), bytes);
+  }
+
+  // Like above, but with an explicit priority.
+  void Admit(IOPriority priority, int64_t bytes);
+
+ private:
+  // Budget available to a class or to the whole directory. May be negative
+  // when more IO has been issued than the budget allowed.
+  struct Bucket {
+    double bytes = 0;
+    double ops = 0;
+  };
+
+  // Adds the budget accrued since the last refill to all buckets, given the
+  // configured per-directory rates.
+  void RefillUnlocked(const MonoTime& now, double bytes_per_sec, double ops_per_sec);
+
+  const IOSchedulerMetrics* metrics_;
+
+  // Protects the fields below.
+  simple_spinlock lock_;
+
+  MonoTime last_refill_;
+
+  // Budget of the whole directory.
+  Bucket dir_;
+
+  // Budget of each class. Indexed by IOPriority.
+  Bucket classes_[kNumIOPriorities];
+
+  DISALLOW_COPY_AND_ASSIGN(IOScheduler);
+};
+
+}  // namespace fs
+}  // namespace kudu
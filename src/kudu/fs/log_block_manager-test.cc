@@ -29,6 +29,7 @@
 #include <random>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -60,6 +61,7 @@
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h" // IWYU pragma: keep
@@ -83,12 +85,15 @@ DECLARE_double(env_inject_eio);
 DECLARE_double(log_container_excess_space_before_cleanup_fraction);
 DECLARE_double(log_container_live_metadata_before_compact_ratio);
 DECLARE_int32(fs_target_data_dirs_per_tablet);
+DECLARE_int32(log_container_coalesced_syncfs_threshold);
 DECLARE_int64(log_container_max_blocks);
 DECLARE_string(block_manager_preflush_control);
 DECLARE_string(env_inject_eio_globs);
 DECLARE_uint64(log_container_preallocate_bytes);
 DECLARE_uint64(log_container_max_size);
 DECLARE_uint64(log_container_metadata_max_size);
+DECLARE_bool(log_container_coalesce_syncs);
+DECLARE_bool(log_container_direct_io);
 DECLARE_bool(log_container_metadata_runtime_compact);
 DECLARE_double(log_container_metadata_size_before_compact_ratio);
 DEFINE_int32(startup_benchmark_block_count_for_testing, 1000000,
@@ -105,6 +110,7 @@ DECLARE_bool(encrypt_data_at_rest);
 
 // Block manager metrics.
 METRIC_DECLARE_counter(block_manager_total_blocks_deleted);
+METRIC_DECLARE_counter(block_manager_total_disk_sync);
 
 // Log block manager metrics.
 METRIC_DECLARE_gauge_uint64(log_block_manager_bytes_under_management);
@@ -997,6 +1003,73 @@ TEST_P(LogBlockManagerTest, TestContainerWithManyHoles) {
   ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
 }
 
+// Test that blocks with sizes and appends which aren't aligned for direct I/O
+// are written and read correctly with --log_container_direct_io, alongside
+// hole punching of deleted blocks and the reopening of containers.
+TEST_P(LogBlockManagerTest, TestDirectIO) {
+  SetEncryptionFlags(GetParam());
+  FLAGS_log_container_direct_io = true;
+  ASSERT_OK(ReopenBlockManager());
+
+  const int kNumBlocks = 20;
+  Random rand(SeedRandom());
+  vector<BlockId> ids;
+  vector<string> contents;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    string data;
+    // A few appends of random sizes, some of which span several pages.
+    for (int j = 0; j < 3; j++) {
+      string chunk = RandomString(rand.Uniform(10000) + 1, &rand);
+      ASSERT_OK(block->Append(chunk));
+      data += chunk;
+    }
+    ASSERT_OK(block->Close());
+    ids.emplace_back(block->id());
+    contents.emplace_back(std::move(data));
+  }
+
+  auto verify_blocks = [&](int first_block, int step) {
+    for (int i = first_block; i < kNumBlocks; i += step) {
+      unique_ptr<ReadableBlock> block;
+      ASSERT_OK(bm_->OpenBlock(ids[i], &block));
+      uint64_t size;
+      ASSERT_OK(block->Size(&size));
+      ASSERT_EQ(contents[i].size(), size);
+      string buf(size, '\0');
+      ASSERT_OK(block->Read(0, Slice(reinterpret_cast<uint8_t*>(&buf[0]), size)));
+      ASSERT_EQ(contents[i], buf);
+
+      // Unaligned reads within the block.
+      const uint64_t offset = rand.Uniform(size);
+      const size_t length = rand.Uniform(size - offset) + 1;
+      ASSERT_OK(block->Read(offset, Slice(reinterpret_cast<uint8_t*>(&buf[0]), length)));
+      ASSERT_EQ(contents[i].substr(offset, length), buf.substr(0, length));
+    }
+  };
+  NO_FATALS(verify_blocks(0, 1));
+
+  // Delete every other block, punching holes into the containers.
+  {
+    shared_ptr<BlockDeletionTransaction> deletion_transaction =
+        bm_->NewDeletionTransaction();
+    for (int i = 0; i < kNumBlocks; i += 2) {
+      deletion_transaction->AddDeletedBlock(ids[i]);
+    }
+    vector<BlockId> deleted;
+    ASSERT_OK(deletion_transaction->CommitDeletedBlocks(&deleted));
+    ASSERT_EQ(kNumBlocks / 2, deleted.size());
+  }
+  NO_FATALS(verify_blocks(1, 2));
+
+  // The containers should be consistent after a restart.
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  ASSERT_FALSE(report.HasFatalErrors());
+  NO_FATALS(verify_blocks(1, 2));
+}
+
 TEST_P(LogBlockManagerTest, TestParseKernelRelease) {
   SetEncryptionFlags(GetParam());
   ASSERT_TRUE(LogBlockManager::IsBuggyEl6Kernel("1.7.0.0.el6.x86_64"));
@@ -1180,6 +1253,82 @@ TEST_P(LogBlockManagerTest, TestFailMultipleTransactionsPerContainer) {
   }
 }
 
+// Test that the container syncs of concurrent block creation transactions may
+// be coalesced, and that the blocks created are durable.
+TEST_P(LogBlockManagerTest, TestCoalescedContainerSyncs) {
+  SetEncryptionFlags(GetParam());
+  FLAGS_log_container_coalesce_syncs = true;
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(ReopenBlockManager(entity));
+  Counter* syncs = down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_manager_total_disk_sync).get());
+
+  // Commits a transaction of 'num_blocks' blocks written at the same time,
+  // hence each to its own container.
+  auto commit_blocks = [&](int num_blocks, vector<BlockId>* ids) {
+    unique_ptr<BlockCreationTransaction> transaction = bm_->NewCreationTransaction();
+    vector<unique_ptr<WritableBlock>> blocks(num_blocks);
+    for (auto& block : blocks) {
+      RETURN_NOT_OK(bm_->CreateBlock(test_block_opts_, &block));
+      RETURN_NOT_OK(block->Append("x"));
+    }
+    for (auto& block : blocks) {
+      ids->emplace_back(block->id());
+      RETURN_NOT_OK(block->Finalize());
+      transaction->AddCreatedBlock(std::move(block));
+    }
+    return transaction->CommitCreatedBlocks();
+  };
+
+  // Each data and metadata file is synced, and the data directory too since
+  // the containers are new.
+  vector<BlockId> created_ids;
+  int64_t syncs_before = syncs->value();
+  ASSERT_OK(commit_blocks(3, &created_ids));
+  ASSERT_EQ(syncs_before + 3 + 3 + 1, syncs->value());
+  NO_FATALS(AssertNumContainers(3));
+
+  // With syncfs(), each file is still synced: syncfs() may not report the
+  // writeback errors of the files.
+  FLAGS_log_container_coalesced_syncfs_threshold = 2;
+  syncs_before = syncs->value();
+  ASSERT_OK(commit_blocks(3, &created_ids));
+  ASSERT_EQ(syncs_before + 3 + 3, syncs->value());
+  NO_FATALS(AssertNumContainers(3));
+
+  // Transactions committing concurrently share the rounds of syncs.
+  const int kNumThreads = 8;
+  const int kNumTransactions = 10;
+  vector<vector<BlockId>> thread_ids(kNumThreads);
+  vector<Status> thread_statuses(kNumThreads);
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kNumTransactions && thread_statuses[i].ok(); j++) {
+        thread_statuses[i] = commit_blocks(2, &thread_ids[i]);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (int i = 0; i < kNumThreads; i++) {
+    ASSERT_OK(thread_statuses[i]);
+    created_ids.insert(created_ids.end(), thread_ids[i].begin(), thread_ids[i].end());
+  }
+
+  // Every block survives a restart.
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  ASSERT_FALSE(report.HasFatalErrors()) << report.ToString();
+  vector<BlockId> loaded_ids;
+  ASSERT_OK(bm_->GetAllBlockIds(&loaded_ids));
+  std::sort(created_ids.begin(), created_ids.end(), BlockIdCompare());
+  std::sort(loaded_ids.begin(), loaded_ids.end(), BlockIdCompare());
+  ASSERT_EQ(created_ids, loaded_ids);
+}
+
 TEST_P(LogBlockManagerTest, TestLookupBlockLimit) {
   SetEncryptionFlags(GetParam());
   int64_t limit_1024 = LogBlockManager::LookupBlockLimit(1024);
@@ -1233,6 +1382,42 @@ TEST_P(LogBlockManagerTest, TestContainerBlockLimitingByBlockNum) {
   NO_FATALS(AssertNumContainers(4));
 }
 
+// Test that the containers of a data directory, which are opened and loaded
+// in parallel, are all accounted for in the startup report.
+TEST_P(LogBlockManagerTest, TestParallelContainerLoading) {
+  SetEncryptionFlags(GetParam());
+  const int kNumBlocks = 200;
+  FLAGS_log_container_max_blocks = 10;
+  ASSERT_OK(ReopenBlockManager());
+
+  vector<BlockId> created_ids;
+  for (int i = 0; i < kNumBlocks; i++) {
+    unique_ptr<WritableBlock> block;
+    ASSERT_OK(bm_->CreateBlock(test_block_opts_, &block));
+    ASSERT_OK(block->Append("aaaa"));
+    ASSERT_OK(block->Close());
+    created_ids.push_back(block->id());
+  }
+  NO_FATALS(AssertNumContainers(kNumBlocks / 10));
+
+  FsReport report;
+  ASSERT_OK(ReopenBlockManager(nullptr, &report));
+  ASSERT_FALSE(report.HasFatalErrors()) << report.ToString();
+  ASSERT_EQ(kNumBlocks / 10, report.stats.lbm_container_count);
+  ASSERT_EQ(kNumBlocks / 10, report.stats.lbm_full_container_count);
+  ASSERT_EQ(kNumBlocks, report.stats.live_block_count);
+  ASSERT_GE(report.stats.lbm_load_containers_ms, 0);
+  ASSERT_GE(report.stats.lbm_repair_ms, 0);
+  ASSERT_STR_CONTAINS(report.ToString(), "Time spent loading LBM containers");
+
+  // Every block survived the reload.
+  vector<BlockId> loaded_ids;
+  ASSERT_OK(bm_->GetAllBlockIds(&loaded_ids));
+  std::sort(created_ids.begin(), created_ids.end(), BlockIdCompare());
+  std::sort(loaded_ids.begin(), loaded_ids.end(), BlockIdCompare());
+  ASSERT_EQ(created_ids, loaded_ids);
+}
+
 TEST_P(LogBlockManagerTest, TestContainerBlockLimitingByMetadataSize) {
   SetEncryptionFlags(GetParam());
   const int kNumBlocks = 1000;
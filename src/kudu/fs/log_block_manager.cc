@@ -46,6 +46,7 @@
 #include "kudu/fs/error_manager.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_report.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
@@ -57,6 +58,7 @@
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/alignment.h"
 #include "kudu/util/array_view.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/file_cache.h"
@@ -65,6 +67,8 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
@@ -135,6 +139,14 @@ DEFINE_double(log_container_metadata_size_before_compact_ratio, 0.80,
 TAG_FLAG(log_container_metadata_size_before_compact_ratio, advanced);
 TAG_FLAG(log_container_metadata_size_before_compact_ratio, experimental);
 
+DEFINE_bool(log_container_direct_io, false,
+            "Whether to read and write the data files of log containers with "
+            "direct I/O, bypassing the operating system's page cache. Flushes "
+            "and compactions then don't evict other data from the page cache, "
+            "and the block cache becomes the only cache of block data.");
+TAG_FLAG(log_container_direct_io, advanced);
+TAG_FLAG(log_container_direct_io, experimental);
+
 DEFINE_bool(log_block_manager_test_hole_punching, true,
             "Ensure hole punching is supported by the underlying filesystem");
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
@@ -152,6 +164,28 @@ DEFINE_int32(log_container_metadata_rewrite_inject_latency_ms, 0,
              "Only for testing.");
 TAG_FLAG(log_container_metadata_rewrite_inject_latency_ms, hidden);
 
+DEFINE_bool(log_container_coalesce_syncs, false,
+            "Whether to coalesce the syncs of the containers of block creation "
+            "transactions committing concurrently in the same data directory. "
+            "While a round of syncs is in progress, the containers of the "
+            "transactions committing in the meantime are queued, to be synced "
+            "together by the next round, each container once.");
+TAG_FLAG(log_container_coalesce_syncs, advanced);
+TAG_FLAG(log_container_coalesce_syncs, experimental);
+TAG_FLAG(log_container_coalesce_syncs, runtime);
+
+DEFINE_int32(log_container_coalesced_syncfs_threshold, 0,
+             "When coalescing container syncs, the number of files to sync in "
+             "a round from which a single syncfs() of the data directory's "
+             "filesystem is issued before the sync of each file, which then "
+             "has little left to write back. This may be cheaper on disks with "
+             "a high sync latency, but syncs the writes of everything else on "
+             "the filesystem too. The errors are those of the syncs of the "
+             "files. 0 disables the use of syncfs().");
+TAG_FLAG(log_container_coalesced_syncfs_threshold, advanced);
+TAG_FLAG(log_container_coalesced_syncfs_threshold, experimental);
+TAG_FLAG(log_container_coalesced_syncfs_threshold, runtime);
+
 METRIC_DEFINE_gauge_uint64(server, log_block_manager_bytes_under_management,
                            "Bytes Under Management",
                            kudu::MetricUnit::kBytes,
@@ -206,6 +240,7 @@ namespace kudu {
 
 namespace fs {
 
+using internal::ContainerSyncGroup;
 using internal::LogBlock;
 using internal::LogBlockContainer;
 using internal::LogBlockDeletionTransaction;
@@ -455,6 +490,15 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // If successful, adds all blocks to the block manager's in-memory maps.
   Status DoCloseBlocks(const vector<LogWritableBlock*>& blocks, SyncMode mode);
 
+  // The steps of DoCloseBlocks(), for callers that sync the container's files
+  // themselves: the metadata of 'blocks' must be appended once the data file
+  // is synced, and the blocks finished once the metadata file is.
+  //
+  // Unlike DoCloseBlocks(), these don't make the container read-only on
+  // failure.
+  Status AppendBlocksMetadata(const vector<LogWritableBlock*>& blocks);
+  Status FinishCloseBlocks(const vector<LogWritableBlock*>& blocks);
+
   // Frees the space associated with a block or a group of blocks at 'offset'
   // and 'length'. This is a physical operation, not a logical one; a separate
   // AppendMetadata() is required to record the deletion in container metadata.
@@ -563,6 +607,11 @@ class LogBlockContainer: public RefCountedThreadSafe<LogBlockContainer> {
   // truncates the container if full and marks the container as available.
   void FinalizeBlock(int64_t block_offset, int64_t block_length);
 
+  // Returns the sync group of this container's data directory.
+  ContainerSyncGroup* sync_group() const {
+    return block_manager_->SyncGroupFor(data_dir_);
+  }
+
   // Runs a task on this container's data directory thread pool.
   //
   // Normally the task is performed asynchronously. However, if submission to
@@ -961,7 +1010,7 @@ Status LogBlockContainer::Create(LogBlockManager* block_manager,
       metadata_status = block_manager->file_cache_->OpenFile<Env::MUST_CREATE>(
           metadata_path, &metadata_writer);
       data_status = block_manager->file_cache_->OpenFile<Env::MUST_CREATE>(
-          data_path, &data_file);
+          data_path, &data_file, FLAGS_log_container_direct_io);
     } else {
       if (metadata_writer) {
         WARN_NOT_OK(block_manager->env()->DeleteFile(metadata_path),
@@ -979,6 +1028,7 @@ Status LogBlockContainer::Create(LogBlockManager* block_manager,
       metadata_status = block_manager->env()->NewRWFile(
           rw_opts, metadata_path, &rwf);
       metadata_writer.reset(rwf.release());
+      rw_opts.direct_io = FLAGS_log_container_direct_io;
       data_status = block_manager->env()->NewRWFile(
           rw_opts, data_path, &rwf);
       data_file.reset(rwf.release());
@@ -1022,7 +1072,8 @@ Status LogBlockContainer::Open(LogBlockManager* block_manager,
     RETURN_NOT_OK_CONTAINER_DISK_FAILURE(
         block_manager->file_cache_->OpenFile<Env::MUST_EXIST>(metadata_path, &metadata_file));
     RETURN_NOT_OK_CONTAINER_DISK_FAILURE(
-        block_manager->file_cache_->OpenFile<Env::MUST_EXIST>(data_path, &data_file));
+        block_manager->file_cache_->OpenFile<Env::MUST_EXIST>(
+            data_path, &data_file, FLAGS_log_container_direct_io));
   } else {
     RWFileOptions opts;
     opts.mode = Env::MUST_EXIST;
@@ -1031,6 +1082,7 @@ Status LogBlockContainer::Open(LogBlockManager* block_manager,
     RETURN_NOT_OK_CONTAINER_DISK_FAILURE(block_manager->env()->NewRWFile(opts,
         metadata_path, &rwf));
     metadata_file.reset(rwf.release());
+    opts.direct_io = FLAGS_log_container_direct_io;
     RETURN_NOT_OK_CONTAINER_DISK_FAILURE(block_manager->env()->NewRWFile(opts,
         data_path, &rwf));
     data_file.reset(rwf.release());
@@ -1306,23 +1358,13 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
 
     // Append metadata only after data is synced so that there's
     // no chance of metadata landing on the disk before the data.
-    for (auto* block : blocks) {
-      RETURN_NOT_OK_PREPEND(block->AppendMetadata(),
-                            "unable to append block's metadata during close");
-    }
+    RETURN_NOT_OK(AppendBlocksMetadata(blocks));
 
     if (mode == SYNC) {
       VLOG(3) << "Syncing metadata file " << metadata_file_->filename();
       RETURN_NOT_OK(SyncMetadata());
     }
-
-    RETURN_NOT_OK(block_manager()->SyncContainer(*this));
-
-    for (LogWritableBlock* block : blocks) {
-      if (blocks.size() > 1) DCHECK_EQ(block->state(), WritableBlock::State::FINALIZED);
-      block->DoClose();
-    }
-    return Status::OK();
+    return FinishCloseBlocks(blocks);
   };
 
   Status s = sync_blocks();
@@ -1335,6 +1377,24 @@ Status LogBlockContainer::DoCloseBlocks(const vector<LogWritableBlock*>& blocks,
   return s;
 }
 
+Status LogBlockContainer::AppendBlocksMetadata(const vector<LogWritableBlock*>& blocks) {
+  for (auto* block : blocks) {
+    RETURN_NOT_OK_PREPEND(block->AppendMetadata(),
+                          "unable to append block's metadata during close");
+  }
+  return Status::OK();
+}
+
+Status LogBlockContainer::FinishCloseBlocks(const vector<LogWritableBlock*>& blocks) {
+  RETURN_NOT_OK(block_manager()->SyncContainer(*this));
+
+  for (LogWritableBlock* block : blocks) {
+    if (blocks.size() > 1) DCHECK_EQ(block->state(), WritableBlock::State::FINALIZED);
+    block->DoClose();
+  }
+  return Status::OK();
+}
+
 Status LogBlockContainer::PunchHole(int64_t offset, int64_t length) {
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   DCHECK_GE(offset, 0);
@@ -1357,15 +1417,16 @@ Status LogBlockContainer::WriteVData(int64_t offset, ArrayView<const Slice> data
   RETURN_NOT_OK_HANDLE_ERROR(read_only_status());
   DCHECK_GE(offset, next_block_offset());
 
+  size_t data_size = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
+                                [&](int sum, const Slice& curr) {
+                                  return sum + curr.size();
+                                });
+  down_cast<DataDir*>(data_dir_)->io_scheduler()->Admit(data_size);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->WriteV(offset, data));
 
   // This append may have changed the container size if:
   // 1. It was large enough that it blew out the preallocated space.
   // 2. Preallocation was disabled.
-  size_t data_size = accumulate(data.begin(), data.end(), static_cast<size_t>(0),
-                                [&](int sum, const Slice& curr) {
-                                  return sum + curr.size();
-                                });
   if (offset + data_size > preallocated_offset_) {
     RETURN_NOT_OK_HANDLE_ERROR(data_dir_->RefreshAvailableSpace(Dir::RefreshMode::ALWAYS));
   }
@@ -1379,6 +1440,11 @@ Status LogBlockContainer::ReadData(int64_t offset, Slice result) const {
 }
 Status LogBlockContainer::ReadVData(int64_t offset, ArrayView<Slice> results) const {
   DCHECK_GE(offset, 0);
+  size_t data_size = accumulate(results.begin(), results.end(), static_cast<size_t>(0),
+                                [&](int sum, const Slice& curr) {
+                                  return sum + curr.size();
+                                });
+  down_cast<DataDir*>(data_dir_)->io_scheduler()->Admit(data_size);
   RETURN_NOT_OK_HANDLE_ERROR(data_file_->ReadV(offset, results));
   return Status::OK();
 }
@@ -1606,6 +1672,136 @@ void LogBlockContainer::ContainerDeletionAsync(int64_t offset, int64_t length) {
                             data_dir()->dir()));
 }
 
+///////////////////////////////////////////////////////////
+// ContainerSyncGroup
+////////////////////////////////////////////////////////////
+
+// Coalesces the syncs of the container files of a data directory.
+//
+// Block creation transactions committing concurrently each sync the data and
+// then the metadata files of their containers. Instead, they may hand their
+// containers to the group of the data directory: while a round of syncs is in
+// progress, the containers handed in are queued, and the first caller to
+// notice the round is over syncs all of those queued, each file once, on
+// behalf of everyone. On disks with a high sync latency, that bounds the rate
+// of syncs by the latency rather than by the number of committing
+// transactions; with a round of syncs of many files, a single syncfs() of the
+// filesystem before them may also make them cheaper.
+//
+// This class is thread-safe.
+class ContainerSyncGroup {
+ public:
+  enum FileType {
+    DATA_FILE,
+    METADATA_FILE
+  };
+
+  ContainerSyncGroup(Env* env, Dir* dir)
+      : env_(env),
+        dir_(dir),
+        cond_(&lock_),
+        sync_in_progress_(false) {
+  }
+
+  // Syncs the files of type 'type' of 'containers', which must belong to the
+  // group's data directory, waiting for them to become durable. Sets
+  // '(*statuses)[i]' to the result of syncing the file of 'containers[i]'.
+  void Sync(FileType type,
+            const vector<LogBlockContainer*>& containers,
+            vector<Status>* statuses);
+
+ private:
+  typedef std::pair<LogBlockContainer*, FileType> SyncKey;
+
+  // The files to sync in one round, with the results of their syncs.
+  struct Round {
+    map<SyncKey, Status> files;
+    bool done = false;
+  };
+
+  // Syncs the files of 'round', setting their results.
+  void RunRound(Round* round) const;
+
+  Env* const env_;
+  Dir* const dir_;
+
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // The round of syncs that callers are queuing up in, or null if none is.
+  shared_ptr<Round> pending_;
+
+  // Whether some caller is currently running a round of syncs.
+  bool sync_in_progress_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContainerSyncGroup);
+};
+
+void ContainerSyncGroup::Sync(FileType type,
+                              const vector<LogBlockContainer*>& containers,
+                              vector<Status>* statuses) {
+  shared_ptr<Round> round;
+  {
+    MutexLock l(lock_);
+    if (!pending_) {
+      pending_ = std::make_shared<Round>();
+    }
+    round = pending_;
+    for (auto* container : containers) {
+      DCHECK_EQ(dir_, container->data_dir());
+      round->files.emplace(SyncKey(container, type), Status::OK());
+    }
+    while (!round->done) {
+      if (sync_in_progress_) {
+        cond_.Wait();
+        continue;
+      }
+      // Only the pending round can be neither done nor in progress: it's up
+      // to us to run it.
+      DCHECK_EQ(pending_.get(), round.get());
+      pending_.reset();
+      sync_in_progress_ = true;
+      l.Unlock();
+      RunRound(round.get());
+      l.Lock();
+      sync_in_progress_ = false;
+      round->done = true;
+      cond_.Broadcast();
+    }
+  }
+
+  // The results of a round don't change once it's done.
+  statuses->resize(containers.size());
+  for (int i = 0; i < containers.size(); i++) {
+    const auto it = round->files.find(SyncKey(containers[i], type));
+    DCHECK(it != round->files.end());
+    (*statuses)[i] = it->second;
+  }
+}
+
+void ContainerSyncGroup::RunRound(Round* round) const {
+  VLOG(3) << Substitute("Syncing $0 container files in $1",
+                        round->files.size(), dir_->dir());
+  const int syncfs_threshold = FLAGS_log_container_coalesced_syncfs_threshold;
+  if (FLAGS_enable_data_block_fsync &&
+      syncfs_threshold > 0 && round->files.size() >= static_cast<size_t>(syncfs_threshold)) {
+    // A single syncfs() writes the files back at once, so that their own
+    // syncs below have little left to do. Those remain the source of truth:
+    // syncfs() doesn't report writeback errors before Linux 5.8, and may
+    // report those of other files of the filesystem.
+    const Status s = env_->SyncFilesystem(dir_->dir());
+    if (PREDICT_FALSE(!s.ok() && !s.IsNotSupported())) {
+      LOG(WARNING) << Substitute(
+          "unable to sync the filesystem of container files in $0, syncing "
+          "each file: $1", dir_->dir(), s.ToString());
+    }
+  }
+  for (auto& f : round->files) {
+    LogBlockContainer* container = f.first.first;
+    f.second = f.first.second == DATA_FILE ? container->SyncData() : container->SyncMetadata();
+  }
+}
+
 ///////////////////////////////////////////////////////////
 // LogBlockCreationTransaction
 ////////////////////////////////////////////////////////////
@@ -1621,6 +1817,13 @@ class LogBlockCreationTransaction : public BlockCreationTransaction {
   Status CommitCreatedBlocks() override;
 
  private:
+  typedef unordered_map<LogBlockContainer*, vector<LogWritableBlock*>> BlocksByContainer;
+
+  // Like LogBlockContainer::DoCloseBlocks() on each container of
+  // 'blocks_by_container', but syncing the containers' files through the sync
+  // groups of their data directories.
+  static Status CloseBlocksCoalesced(const BlocksByContainer& blocks_by_container);
+
   vector<unique_ptr<LogWritableBlock>> created_blocks_;
 };
 
@@ -1636,7 +1839,7 @@ Status LogBlockCreationTransaction::CommitCreatedBlocks() {
   }
 
   VLOG(3) << "Closing " << created_blocks_.size() << " blocks";
-  unordered_map<LogBlockContainer*, vector<LogWritableBlock*>> created_block_map;
+  BlocksByContainer created_block_map;
   for (const auto& block : created_blocks_) {
     if (FLAGS_block_manager_preflush_control == "close") {
       // Ask the kernel to begin writing out each block's dirty data. This is
@@ -1650,14 +1853,67 @@ Status LogBlockCreationTransaction::CommitCreatedBlocks() {
   // Close all blocks and sync the blocks belonging to the same
   // container together to reduce fsync() usage, waiting for them
   // to become durable.
-  for (const auto& entry : created_block_map) {
-    RETURN_NOT_OK(entry.first->DoCloseBlocks(entry.second,
-                                             LogBlockContainer::SyncMode::SYNC));
+  if (FLAGS_log_container_coalesce_syncs) {
+    RETURN_NOT_OK(CloseBlocksCoalesced(created_block_map));
+  } else {
+    for (const auto& entry : created_block_map) {
+      RETURN_NOT_OK(entry.first->DoCloseBlocks(entry.second,
+                                               LogBlockContainer::SyncMode::SYNC));
+    }
   }
   created_blocks_.clear();
   return Status::OK();
 }
 
+Status LogBlockCreationTransaction::CloseBlocksCoalesced(
+    const BlocksByContainer& blocks_by_container) {
+  unordered_map<ContainerSyncGroup*, vector<LogBlockContainer*>> containers_by_group;
+  for (const auto& entry : blocks_by_container) {
+    containers_by_group[entry.first->sync_group()].emplace_back(entry.first);
+  }
+
+  // As in DoCloseBlocks(), a container whose files fail to be synced, or whose
+  // blocks' metadata fails to be appended, is made read-only.
+  auto sync_files = [&](ContainerSyncGroup::FileType type) {
+    Status first_error;
+    vector<Status> statuses;
+    for (const auto& entry : containers_by_group) {
+      entry.first->Sync(type, entry.second, &statuses);
+      for (int i = 0; i < statuses.size(); i++) {
+        if (!statuses[i].ok()) {
+          entry.second[i]->SetReadOnly(statuses[i]);
+          if (first_error.ok()) {
+            first_error = statuses[i];
+          }
+        }
+      }
+    }
+    return first_error;
+  };
+  auto for_each_container = [&](const std::function<Status(LogBlockContainer*,
+                                                           const vector<LogWritableBlock*>&)>& f) {
+    for (const auto& entry : blocks_by_container) {
+      Status s = f(entry.first, entry.second);
+      if (!s.ok()) {
+        entry.first->SetReadOnly(s);
+        return s;
+      }
+    }
+    return Status::OK();
+  };
+
+  RETURN_NOT_OK(sync_files(ContainerSyncGroup::DATA_FILE));
+  // Append metadata only after data is synced so that there's
+  // no chance of metadata landing on the disk before the data.
+  RETURN_NOT_OK(for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& b) {
+    return c->AppendBlocksMetadata(b);
+  }));
+  RETURN_NOT_OK(sync_files(ContainerSyncGroup::METADATA_FILE));
+  return for_each_container([](LogBlockContainer* c, const vector<LogWritableBlock*>& b) {
+    return c->FinishCloseBlocks(b);
+  });
+}
+
 ///////////////////////////////////////////////////////////
 // LogBlockDeletionTransaction
 ////////////////////////////////////////////////////////////
@@ -2302,6 +2558,7 @@ Status LogBlockManager::Open(FsReport* report, std::atomic<int>* containers_proc
   }
 
   // Open containers in each data dirs.
+  const MonoTime load_start = MonoTime::Now();
   vector<Status> statuses(dd_manager_->dirs().size());
   vector<vector<unique_ptr<internal::LogBlockContainerLoadResult>>> container_results(
       dd_manager_->dirs().size());
@@ -2329,6 +2586,7 @@ Status LogBlockManager::Open(FsReport* report, std::atomic<int>* containers_proc
 
   // Wait for the opens to complete.
   dd_manager_->WaitOnClosures();
+  const MonoTime repair_start = MonoTime::Now();
 
   // Check load errors and merge each data dir's container load results, then do repair tasks.
   unique_ptr<ThreadPool> repair_pool;
@@ -2352,7 +2610,7 @@ Status LogBlockManager::Open(FsReport* report, std::atomic<int>* containers_proc
     bool do_repair = true;
     for (const auto& container_result : container_results[i]) {
       RETURN_ON_NON_DISK_FAILURE(dd, container_result->status);
-      if (PREDICT_FALSE(!s.ok())) {
+      if (PREDICT_FALSE(!container_result->status.ok())) {
         // If open container error, do not try to repair.
         do_repair = false;
         break;
@@ -2385,8 +2643,11 @@ Status LogBlockManager::Open(FsReport* report, std::atomic<int>* containers_proc
   // Wait for the repair tasks to complete.
   repair_pool->Wait();
   repair_pool->Shutdown();
+  const MonoTime repair_end = MonoTime::Now();
 
   FsReport merged_report;
+  merged_report.stats.lbm_load_containers_ms = (repair_start - load_start).ToMilliseconds();
+  merged_report.stats.lbm_repair_ms = (repair_end - repair_start).ToMilliseconds();
   for (int i = 0; i < dd_manager_->dirs().size(); ++i) {
     if (PREDICT_FALSE(!dir_results[i])) {
       continue;
@@ -2568,6 +2829,15 @@ void LogBlockManager::MakeContainerAvailableUnlocked(LogBlockContainerRefPtr con
   available_containers_by_data_dir_[container->data_dir()].push_front(std::move(container));
 }
 
+ContainerSyncGroup* LogBlockManager::SyncGroupFor(Dir* dir) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  auto& group = sync_groups_[dir];
+  if (!group) {
+    group.reset(new ContainerSyncGroup(env_, dir));
+  }
+  return group.get();
+}
+
 Status LogBlockManager::SyncContainer(const LogBlockContainer& container) {
   Status s;
   bool to_sync = false;
@@ -2796,39 +3066,48 @@ void LogBlockManager::OpenDataDir(
     }
   }
 
+  // Open and load the containers asynchronously. Each container's metadata
+  // is read and replayed independently, so they needn't be opened one at a
+  // time.
   for (const string& container_name : containers_seen) {
     // Add a new result for the container.
     results->emplace_back(new internal::LogBlockContainerLoadResult());
-    LogBlockContainerRefPtr container;
-    s = LogBlockContainer::Open(
-        this, dir, &results->back()->report, container_name, &container);
-    if (containers_processed) {
-      ++*containers_processed;
-      if (metrics_) {
-        metrics()->processed_containers_startup->Increment();
-      }
+    auto* r = results->back().get();
+    dir->ExecClosure([this, dir, container_name, r, containers_processed]() {
+      this->OpenContainer(dir, container_name, r, containers_processed);
+    });
+  }
+}
+
+void LogBlockManager::OpenContainer(Dir* dir,
+                                    const string& container_name,
+                                    internal::LogBlockContainerLoadResult* result,
+                                    std::atomic<int>* containers_processed) {
+  LogBlockContainerRefPtr container;
+  Status s = LogBlockContainer::Open(
+      this, dir, &result->report, container_name, &container);
+  if (containers_processed) {
+    ++*containers_processed;
+    if (metrics_) {
+      metrics()->processed_containers_startup->Increment();
     }
-    if (!s.ok()) {
-      if (s.IsAborted()) {
-        // Skip the container. Open() added a record of it to 'results->back()->report' for us.
-        continue;
-      }
-      if (opts_.read_only && s.IsNotFound()) {
-        // Skip the container while the operation is read-only and the files are away,
-        // especially for the kudu cli tool.
-        continue;
-      }
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", container_name));
+  }
+  if (!s.ok()) {
+    if (s.IsAborted()) {
+      // Skip the container. Open() added a record of it to 'result->report' for us.
       return;
     }
-
-    // Load the container's records asynchronously.
-    auto* r = results->back().get();
-    dir->ExecClosure([this, dir, container, r]() {
-      this->LoadContainer(dir, container, r);
-    });
+    if (opts_.read_only && s.IsNotFound()) {
+      // Skip the container while the operation is read-only and the files are away,
+      // especially for the kudu cli tool.
+      return;
+    }
+    result->status = s.CloneAndPrepend(Substitute(
+        "Could not open container $0", container_name));
+    return;
   }
+
+  LoadContainer(dir, std::move(container), result);
 }
 
 void LogBlockManager::LoadContainer(Dir* dir,
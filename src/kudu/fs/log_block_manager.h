@@ -55,6 +55,7 @@ class FsErrorManager;
 struct FsReport;
 
 namespace internal {
+class ContainerSyncGroup;
 class LogBlock;
 class LogBlockContainer;
 class LogBlockDeletionTransaction;
@@ -292,6 +293,10 @@ class LogBlockManager : public BlockManager {
   // sync more than is necessary (using 'dirty_dirs_').
   Status SyncContainer(const internal::LogBlockContainer& container);
 
+  // Returns the group coalescing the syncs of the containers of 'dir',
+  // creating it if necessary.
+  internal::ContainerSyncGroup* SyncGroupFor(Dir* dir);
+
   // Attempts to claim 'block_id' for use in a new WritableBlock.
   //
   // Returns true if the given block ID was not in use (and marks it as in
@@ -380,6 +385,16 @@ class LogBlockManager : public BlockManager {
                    std::atomic<int>* containers_processed = nullptr,
                    std::atomic<int>* containers_total = nullptr);
 
+  // Opens the log block container named 'container_name' in the data
+  // directory and loads its records. Runs on the data directory's thread
+  // pool, so that the containers of a data directory are opened in parallel.
+  //
+  // The result details will be collected into 'result'.
+  void OpenContainer(Dir* dir,
+                     const std::string& container_name,
+                     internal::LogBlockContainerLoadResult* result,
+                     std::atomic<int>* containers_processed);
+
   // Reads records from one log block container in the data directory.
   // The result details will be collected into 'result'.
   void LoadContainer(Dir* dir,
@@ -441,7 +456,8 @@ class LogBlockManager : public BlockManager {
   // Sharding block IDs containers.
   std::vector<ManagedBlockShard> managed_block_shards_;
 
-  // Protects 'all_containers_by_name_', 'available_containers_by_data_dir_' and 'dirty_dirs'.
+  // Protects 'all_containers_by_name_', 'available_containers_by_data_dir_',
+  // 'dirty_dirs' and 'sync_groups_'.
   mutable simple_spinlock lock_;
 
   // Maps a data directory to an upper bound on the number of blocks that a
@@ -468,6 +484,10 @@ class LogBlockManager : public BlockManager {
   // Synced and cleared by SyncMetadata().
   std::unordered_set<std::string> dirty_dirs_;
 
+  // The groups coalescing the syncs of the containers of each data directory.
+  std::unordered_map<const Dir*,
+                     std::unique_ptr<internal::ContainerSyncGroup>> sync_groups_;
+
   // If true, the kernel is vulnerable to KUDU-1508.
   const bool buggy_el6_kernel_;
 
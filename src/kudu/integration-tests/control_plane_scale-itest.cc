@@ -0,0 +1,350 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Integration test measuring the control plane of a cluster at production
+// density: tens of thousands of tablet replicas over a handful of tablet
+// servers.
+//
+// The tablets hold no data, so that the cost of the replicas is that of their
+// metadata, Raft heartbeats, tablet reports and catalog entries. The test
+// measures:
+//
+//   create_tables_ms         Creating the tables, until the master considers
+//                            all of their tablets created.
+//   replicas_running_ms      From then, until all replicas are RUNNING.
+//   <server>_cpu_ms_per_sec  The CPU time used by each server per second of
+//                            an idle period, i.e. by heartbeats, tablet
+//                            reports and the like.
+//   master_failover_ms       Shutting down the leader master, until a new
+//                            leader serves the tables and tablet servers.
+//   election_recovery_ms     Shutting down a tablet server, until every
+//                            tablet has a leader elsewhere.
+//   tserver_restart_ms       Restarting that tablet server, until all of its
+//                            replicas are RUNNING again.
+//
+// The results are written as JSON, so that the results of two builds can be
+// compared. The test only runs with KUDU_ALLOW_SLOW_TESTS=1.
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/client/client.h"
+#include "kudu/client/schema.h"
+#include "kudu/client/shared_ptr.h" // IWYU pragma: keep
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/cluster_itest_util.h"
+#include "kudu/integration-tests/external_mini_cluster-itest-base.h"
+#include "kudu/mini-cluster/external_mini_cluster.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/version_info.h"
+
+METRIC_DECLARE_entity(server);
+METRIC_DECLARE_gauge_uint64(cpu_stime);
+METRIC_DECLARE_gauge_uint64(cpu_utime);
+
+DEFINE_int32(scale_test_num_tablets, 10000, "Number of tablets to create");
+DEFINE_int32(scale_test_tablets_per_table, 1000,
+             "Number of tablets of each of the tables created");
+DEFINE_int32(scale_test_num_tablet_servers, 3, "Number of tablet servers");
+DEFINE_int32(scale_test_num_replicas, 3, "Replication factor of the tables");
+DEFINE_int32(scale_test_idle_secs, 10,
+             "Number of seconds over which to measure the CPU used by the "
+             "servers of the idle cluster");
+DEFINE_int32(scale_test_timeout_secs, 1800,
+             "Timeout of each of the steps of the test");
+DEFINE_string(scale_test_output_file, "",
+              "File to which the JSON results are written. If empty, they are "
+              "only logged");
+
+namespace kudu {
+
+using client::KuduColumnSchema;
+using client::KuduSchema;
+using client::KuduSchemaBuilder;
+using client::KuduTableCreator;
+using client::KuduTabletServer;
+using cluster::ExternalDaemon;
+using cluster::ExternalMiniClusterOptions;
+using consensus::RaftPeerPB;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+using tserver::ListTabletsResponsePB;
+
+class ControlPlaneScaleITest : public ExternalMiniClusterITestBase {
+ protected:
+  // Returns the timeout of the steps of the test.
+  static MonoDelta Timeout() {
+    return MonoDelta::FromSeconds(FLAGS_scale_test_timeout_secs);
+  }
+
+  // Sets '*cpu_ms' to the user and system CPU time used so far by 'daemon'.
+  static Status GetCpuTimeMs(const ExternalDaemon* daemon, const char* entity_id,
+                             int64_t* cpu_ms) {
+    int64_t utime;
+    int64_t stime;
+    RETURN_NOT_OK(itest::GetInt64Metric(daemon->bound_http_hostport(), &METRIC_ENTITY_server,
+                                        entity_id, &METRIC_cpu_utime, "value", &utime));
+    RETURN_NOT_OK(itest::GetInt64Metric(daemon->bound_http_hostport(), &METRIC_ENTITY_server,
+                                        entity_id, &METRIC_cpu_stime, "value", &stime));
+    *cpu_ms = utime + stime;
+    return Status::OK();
+  }
+
+  // Sets '*num_replicas' to the number of replicas of the tablet server at
+  // 'ts_idx', and '*num_leaders' to the number of those which are RUNNING
+  // leaders.
+  Status CountReplicas(int ts_idx, int* num_replicas, int* num_leaders) {
+    vector<ListTabletsResponsePB::StatusAndSchemaPB> tablets;
+    RETURN_NOT_OK(itest::ListTablets(ts_map_[cluster_->tablet_server(ts_idx)->uuid()],
+                                     MonoDelta::FromSeconds(60), &tablets));
+    *num_replicas = tablets.size();
+    *num_leaders = 0;
+    for (const auto& t : tablets) {
+      if (t.tablet_status().state() == tablet::RUNNING && t.role() == RaftPeerPB::LEADER) {
+        (*num_leaders)++;
+      }
+    }
+    return Status::OK();
+  }
+
+  // Waits for 'ready' to return true, polling it every 'interval'. Sets
+  // '*elapsed_ms' to the time it took.
+  static Status WaitFor(const string& what, const std::function<bool()>& ready,
+                        const MonoDelta& interval, double* elapsed_ms) {
+    const MonoTime start = MonoTime::Now();
+    const MonoTime deadline = start + Timeout();
+    while (!ready()) {
+      if (MonoTime::Now() > deadline) {
+        return Status::TimedOut(Substitute("timed out waiting for $0", what));
+      }
+      SleepFor(interval);
+    }
+    *elapsed_ms = (MonoTime::Now() - start).ToMilliseconds();
+    return Status::OK();
+  }
+
+  // The measurements, in the order they're taken.
+  vector<pair<string, double>> results_;
+};
+
+TEST_F(ControlPlaneScaleITest, TestDenseCluster) {
+  SKIP_IF_SLOW_NOT_ALLOWED();
+  const int kNumTabletServers = FLAGS_scale_test_num_tablet_servers;
+  const int kNumTablets = FLAGS_scale_test_num_tablets;
+
+  ExternalMiniClusterOptions opts;
+  opts.num_masters = 3;
+  opts.num_tablet_servers = kNumTabletServers;
+  opts.extra_master_flags = {
+      // Allow the tablets of the tables to go to a few tablet servers.
+      Substitute("--max_create_tablets_per_ts=$0", FLAGS_scale_test_tablets_per_table),
+      Substitute("--tablet_creation_timeout_ms=$0", FLAGS_scale_test_timeout_secs * 1000),
+  };
+  opts.extra_tserver_flags = {
+      // Keep the replicas lightweight: they hold no data, and shouldn't take
+      // disk space beyond their metadata.
+      "--log_preallocate_segments=false",
+      "--log_async_preallocate_segments=false",
+      "--log_container_preallocate_bytes=0",
+      "--maintenance_manager_num_threads=1",
+
+      // Allow the tablet servers to service the RPCs of many replicas.
+      "--rpc_service_queue_length=1000",
+      "--metrics_log_interval_ms=0",
+  };
+  // The tablet servers are only ready when their replicas are bootstrapped.
+  opts.start_process_timeout = Timeout();
+  NO_FATALS(StartClusterWithOpts(std::move(opts)));
+
+  KuduSchema schema;
+  KuduSchemaBuilder b;
+  b.AddColumn("key")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+  b.AddColumn("val")->Type(KuduColumnSchema::INT32);
+  ASSERT_OK(b.Build(&schema));
+
+  // Create the tables.
+  const int num_tables =
+      (kNumTablets + FLAGS_scale_test_tablets_per_table - 1) / FLAGS_scale_test_tablets_per_table;
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < num_tables; i++) {
+    const int num_table_tablets = std::min(FLAGS_scale_test_tablets_per_table,
+                                           kNumTablets - i * FLAGS_scale_test_tablets_per_table);
+    unique_ptr<KuduTableCreator> creator(client_->NewTableCreator());
+    ASSERT_OK(creator->table_name(Substitute("scale_test_$0", i))
+              .schema(&schema)
+              .add_hash_partitions({ "key" }, num_table_tablets)
+              .set_range_partition_columns({})
+              .num_replicas(FLAGS_scale_test_num_replicas)
+              .timeout(Timeout())
+              .Create());
+  }
+  sw.stop();
+  results_.emplace_back("create_tables_ms", sw.elapsed().wall_millis());
+
+  // Wait for all of the replicas to run, and for every tablet to elect a
+  // leader.
+  double elapsed_ms;
+  const int num_replicas = kNumTablets * FLAGS_scale_test_num_replicas;
+  ASSERT_OK(WaitFor("replicas to run", [&]() {
+    int total_replicas = 0;
+    int total_leaders = 0;
+    for (int i = 0; i < kNumTabletServers; i++) {
+      int replicas;
+      int leaders;
+      if (!CountReplicas(i, &replicas, &leaders).ok()) {
+        return false;
+      }
+      total_replicas += replicas;
+      total_leaders += leaders;
+    }
+    return total_replicas == num_replicas && total_leaders == kNumTablets;
+  }, MonoDelta::FromSeconds(1), &elapsed_ms));
+  results_.emplace_back("replicas_running_ms", elapsed_ms);
+
+  // Measure the CPU used by the servers of the idle cluster.
+  {
+    vector<pair<string, pair<const ExternalDaemon*, const char*>>> daemons;
+    for (int i = 0; i < cluster_->num_masters(); i++) {
+      daemons.push_back({ Substitute("master$0", i), { cluster_->master(i), "kudu.master" } });
+    }
+    for (int i = 0; i < kNumTabletServers; i++) {
+      daemons.push_back({ Substitute("tserver$0", i),
+                          { cluster_->tablet_server(i), "kudu.tabletserver" } });
+    }
+    vector<int64_t> start_cpu_ms(daemons.size());
+    for (int i = 0; i < daemons.size(); i++) {
+      ASSERT_OK(GetCpuTimeMs(daemons[i].second.first, daemons[i].second.second,
+                             &start_cpu_ms[i]));
+    }
+    const MonoTime start = MonoTime::Now();
+    SleepFor(MonoDelta::FromSeconds(FLAGS_scale_test_idle_secs));
+    for (int i = 0; i < daemons.size(); i++) {
+      int64_t cpu_ms;
+      ASSERT_OK(GetCpuTimeMs(daemons[i].second.first, daemons[i].second.second, &cpu_ms));
+      results_.emplace_back(Substitute("$0_cpu_ms_per_sec", daemons[i].first),
+                            (cpu_ms - start_cpu_ms[i]) / (MonoTime::Now() - start).ToSeconds());
+    }
+  }
+
+  // Fail the leader master over, waiting for the new leader to load the
+  // catalog and to hear from all of the tablet servers.
+  int leader_idx;
+  ASSERT_OK(cluster_->GetLeaderMasterIndex(&leader_idx));
+  cluster_->master(leader_idx)->Shutdown();
+  ASSERT_OK(WaitFor("a new leader master", [&]() {
+    vector<string> tables;
+    vector<KuduTabletServer*> tservers;
+    ElementDeleter deleter(&tservers);
+    return client_->ListTables(&tables).ok() && tables.size() == num_tables &&
+        client_->ListTabletServers(&tservers).ok() && tservers.size() == kNumTabletServers;
+  }, MonoDelta::FromMilliseconds(10), &elapsed_ms));
+  results_.emplace_back("master_failover_ms", elapsed_ms);
+  ASSERT_OK(cluster_->master(leader_idx)->Restart());
+
+  if (FLAGS_scale_test_num_replicas >= 3) {
+    // Shut a tablet server down, waiting for the tablets it led to elect new
+    // leaders.
+    int ts0_replicas;
+    int ts0_leaders;
+    ASSERT_OK(CountReplicas(0, &ts0_replicas, &ts0_leaders));
+    cluster_->tablet_server(0)->Shutdown();
+    ASSERT_OK(WaitFor("new tablet leaders", [&]() {
+      int total_leaders = 0;
+      for (int i = 1; i < kNumTabletServers; i++) {
+        int replicas;
+        int leaders;
+        if (!CountReplicas(i, &replicas, &leaders).ok()) {
+          return false;
+        }
+        total_leaders += leaders;
+      }
+      return total_leaders == kNumTablets;
+    }, MonoDelta::FromMilliseconds(100), &elapsed_ms));
+    results_.emplace_back("election_recovery_ms", elapsed_ms);
+    results_.emplace_back("election_recovery_tablets", ts0_leaders);
+
+    // Restart it, waiting for its replicas to run again.
+    sw.start();
+    ASSERT_OK(cluster_->tablet_server(0)->Restart());
+    ASSERT_OK(cluster_->WaitForTabletsRunning(cluster_->tablet_server(0), ts0_replicas,
+                                              Timeout()));
+    sw.stop();
+    results_.emplace_back("tserver_restart_ms", sw.elapsed().wall_millis());
+  }
+
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::PRETTY);
+  jw.StartObject();
+  jw.String("version");
+  jw.String(VersionInfo::GetShortVersionInfo());
+  jw.String("config");
+  jw.StartObject();
+  jw.String("num_tablets");
+  jw.Int64(kNumTablets);
+  jw.String("num_tables");
+  jw.Int64(num_tables);
+  jw.String("num_tablet_servers");
+  jw.Int64(kNumTabletServers);
+  jw.String("num_replicas");
+  jw.Int64(FLAGS_scale_test_num_replicas);
+  jw.EndObject();
+  jw.String("results");
+  jw.StartObject();
+  for (const auto& r : results_) {
+    jw.String(r.first);
+    jw.Double(r.second);
+  }
+  jw.EndObject();
+  jw.EndObject();
+  LOG(INFO) << "Results: " << out.str();
+
+  if (!FLAGS_scale_test_output_file.empty()) {
+    std::ofstream f(FLAGS_scale_test_output_file);
+    f << out.str() << std::endl;
+    f.close();
+    ASSERT_TRUE(f) << "could not write results to " << FLAGS_scale_test_output_file;
+  }
+}
+
+} // namespace kudu
@@ -31,6 +31,7 @@
 #include "kudu/client/client.h"
 #include "kudu/client/schema.h"
 #include "kudu/client/shared_ptr.h" // IWYU pragma: keep
+#include "kudu/client/write_op.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol.pb.h"
@@ -60,15 +61,21 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(client_lookups_from_any_master);
+DECLARE_bool(master_follower_serve_lookups);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
+DECLARE_int32(master_follower_catalog_refresh_interval_ms);
 
 METRIC_DECLARE_counter(sys_catalog_oversized_write_requests);
 
 using kudu::client::KuduClient;
 using kudu::client::KuduClientBuilder;
 using kudu::client::KuduColumnSchema;
+using kudu::client::KuduInsert;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSchemaBuilder;
+using kudu::client::KuduSession;
+using kudu::client::KuduTable;
 using kudu::client::KuduTableAlterer;
 using kudu::client::KuduTableCreator;
 using kudu::client::sp::shared_ptr;
@@ -339,6 +346,48 @@ TEST_F(MasterReplicationTest, TestConnectToClusterReturnsAddresses) {
   }
 }
 
+// Test that follower masters serve tablet location lookups once they have
+// loaded the tables from their replica of the system catalog.
+TEST_F(MasterReplicationTest, TestFollowerMastersServeLookups) {
+  FLAGS_master_follower_serve_lookups = true;
+  FLAGS_master_follower_catalog_refresh_interval_ms = 100;
+  FLAGS_client_lookups_from_any_master = true;
+
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(CreateClient(&client));
+  ASSERT_OK(CreateTable(client, kTableId1));
+
+  ASSERT_EVENTUALLY([&] {
+    for (int i = 0; i < cluster_->num_masters(); i++) {
+      SCOPED_TRACE(Substitute("Looking up table locations on master $0", i));
+      rpc::RpcController rpc;
+      GetTableLocationsRequestPB req;
+      GetTableLocationsResponsePB resp;
+      req.mutable_table()->set_table_name(kTableId1);
+      ASSERT_OK(cluster_->master_proxy(i)->GetTableLocations(req, &resp, &rpc));
+      ASSERT_FALSE(resp.has_error()) << pb_util::SecureShortDebugString(resp);
+      ASSERT_EQ(1, resp.tablet_locations_size());
+      ASSERT_EQ(kNumTabletServerReplicas,
+                resp.tablet_locations(0).interned_replicas_size() +
+                resp.tablet_locations(0).deprecated_replicas_size());
+    }
+  });
+
+  // Lookups from a client get spread across the masters, and tables the
+  // followers don't know about yet are looked up on the leader.
+  ASSERT_OK(CreateTable(client, kTableId2));
+  for (const auto* table_name : { kTableId1, kTableId2 }) {
+    shared_ptr<KuduTable> table;
+    ASSERT_OK(client->OpenTable(table_name, &table));
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt32("key", 1));
+    ASSERT_OK(insert->mutable_row()->SetInt32("int_val", 1));
+    ASSERT_OK(insert->mutable_row()->SetStringCopy("string_val", "a"));
+    shared_ptr<KuduSession> session = client->NewSession();
+    ASSERT_OK(session->Apply(insert.release()));
+    ASSERT_OK(session->Flush());
+  }
+}
 
 // Test for KUDU-2200: if a user specifies just one of the masters, and that master is a
 // follower, we should give a status message that explains their mistake.
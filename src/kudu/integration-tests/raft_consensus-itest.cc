@@ -2181,6 +2181,38 @@ TEST_F(RaftConsensusITest, TestLargeBatches) {
   ASSERT_LE(num_wals, num_batches + 2);
 }
 
+// Ensure that ops sent to the followers as RPC sidecars are replicated like
+// ops embedded in the requests, including across leader changes.
+TEST_F(RaftConsensusITest, TestReplicateOpsAsSidecars) {
+  NO_FATALS(BuildAndStart({ "--consensus_send_ops_as_sidecars=true" }));
+
+  TestWorkload workload(cluster_.get());
+  workload.set_table_name(kTableId);
+  workload.set_num_write_threads(2);
+  workload.set_write_batch_size(20);
+  workload.Setup();
+  workload.Start();
+  while (workload.rows_inserted() < 1000) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+
+  // Make another replica the leader, so that it sends the ops too.
+  TServerDetails* leader;
+  ASSERT_OK(GetLeaderReplicaWithRetries(tablet_id_, &leader));
+  ASSERT_OK(LeaderStepDown(leader, tablet_id_, MonoDelta::FromSeconds(10)));
+  const int64_t rows_before = workload.rows_inserted();
+  while (workload.rows_inserted() < rows_before + 1000) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  workload.StopAndJoin();
+
+  ClusterVerifier v(cluster_.get());
+  NO_FATALS(v.CheckCluster());
+  NO_FATALS(v.CheckRowCount(workload.table_name(),
+                            ClusterVerifier::EXACTLY,
+                            workload.rows_inserted()));
+}
+
 
 // Regression test for KUDU-1469, a case in which a leader and follower could get "stuck"
 // in a tight RPC loop, in which the leader would repeatedly send a batch of ops that the
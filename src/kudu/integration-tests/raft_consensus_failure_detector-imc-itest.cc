@@ -38,17 +38,23 @@
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 DECLARE_bool(catalog_manager_evict_excess_replicas);
+DECLARE_bool(raft_batch_heartbeats);
+DECLARE_int32(raft_heartbeat_interval_ms);
+
+METRIC_DECLARE_histogram(handler_latency_kudu_consensus_ConsensusService_MultiUpdateConsensus);
 
 using kudu::consensus::RaftPeerPB;
 using kudu::itest::WaitForServersToAgree;
 using kudu::tablet::TabletReplica;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 namespace kudu {
@@ -145,4 +151,50 @@ TEST_F(RaftConsensusFailureDetectorIMCTest, TestFailureDetectorActivation) {
   NO_FATALS(validate_failure_detector_status(ts_map_));
 }
 
+// Ensure that with batched heartbeats, followers keep hearing from their
+// leaders, and so don't start elections.
+TEST_F(RaftConsensusFailureDetectorIMCTest, TestBatchedHeartbeats) {
+  SKIP_IF_SLOW_NOT_ALLOWED();
+
+  FLAGS_raft_batch_heartbeats = true;
+  FLAGS_raft_heartbeat_interval_ms = 100;
+  const int kNumReplicas = 3;
+  NO_FATALS(StartCluster(/*num_tablet_servers=*/ kNumReplicas));
+  TestWorkload workload(cluster_.get());
+  workload.set_num_tablets(8);
+  workload.Setup();
+  workload.Start();
+  while (workload.batches_completed() < 10) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  workload.StopAndJoin();
+
+  const auto get_terms = [&]() {
+    unordered_map<string, int64_t> terms;
+    for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+      auto* mini_ts = cluster_->mini_tablet_server(i);
+      vector<scoped_refptr<TabletReplica>> replicas;
+      mini_ts->server()->tablet_manager()->GetTabletReplicas(&replicas);
+      for (const auto& replica : replicas) {
+        terms[mini_ts->uuid() + replica->tablet_id()] = replica->consensus()->CurrentTerm();
+      }
+    }
+    return terms;
+  };
+  const auto terms_before = get_terms();
+
+  // Let the idle tablets heartbeat for many failure detection periods.
+  SleepFor(MonoDelta::FromMilliseconds(30 * FLAGS_raft_heartbeat_interval_ms));
+  ASSERT_EQ(terms_before, get_terms());
+
+  int64_t num_batches = 0;
+  for (int i = 0; i < cluster_->num_tablet_servers(); i++) {
+    scoped_refptr<Histogram> hist(
+        cluster_->mini_tablet_server(i)->server()->metric_entity()->FindOrCreateHistogram(
+            &METRIC_handler_latency_kudu_consensus_ConsensusService_MultiUpdateConsensus));
+    num_batches += hist->TotalCount();
+  }
+  ASSERT_GT(num_batches, 0);
+}
+
 } // namespace kudu
@@ -103,6 +103,8 @@ using kudu::tablet::TxnMetadataPB;
 using kudu::tablet::TxnParticipant;
 using kudu::tablet::TxnState;
 using kudu::transactions::TxnSystemClient;
+using kudu::tserver::ParticipantBatchRequestPB;
+using kudu::tserver::ParticipantBatchResponsePB;
 using kudu::tserver::ParticipantOpPB;
 using kudu::tserver::ParticipantRequestPB;
 using kudu::tserver::ParticipantResponsePB;
@@ -551,6 +553,32 @@ TEST_F(TxnParticipantITest, TestProxyBasicCalls) {
   }
 }
 
+// Test that the ops of a batch are applied independently: an op to a tablet
+// the server doesn't host fails without failing the others.
+TEST_F(TxnParticipantITest, TestProxyBatchCalls) {
+  constexpr const int kLeaderIdx = 0;
+  constexpr const int kTxnId = 0;
+  vector<TabletReplica*> replicas = SetUpLeaderGetReplicas(kLeaderIdx);
+  ASSERT_OK(replicas[kLeaderIdx]->consensus()->WaitUntilLeader(kDefaultTimeout));
+  auto admin_proxy = cluster_->tserver_admin_proxy(kLeaderIdx);
+  for (const auto& op : kCommitSequence) {
+    ParticipantBatchRequestPB req;
+    *req.add_requests() = ParticipantRequest(replicas[kLeaderIdx]->tablet_id(), kTxnId, op);
+    *req.add_requests() = ParticipantRequest("not-a-tablet", kTxnId, op);
+    ParticipantBatchResponsePB resp;
+    rpc::RpcController rpc;
+    ASSERT_OK(admin_proxy->ParticipateInTransactionBatch(req, &resp, &rpc));
+    ASSERT_EQ(2, resp.responses_size());
+    ASSERT_FALSE(resp.responses(0).has_error())
+        << StatusFromPB(resp.responses(0).error().status()).ToString();
+    if (op == ParticipantOpPB::BEGIN_COMMIT) {
+      ASSERT_TRUE(resp.responses(0).has_timestamp());
+    }
+    ASSERT_TRUE(resp.responses(1).has_error());
+    ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  }
+}
+
 TEST_F(TxnParticipantITest, TestBeginCommitAfterFinalize) {
   constexpr const int kLeaderIdx = 0;
   constexpr const int kTxnId = 0;
@@ -30,6 +30,7 @@
 
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/util/env.h"
@@ -56,6 +57,32 @@ static bool ValidateThreadPoolThreadLimit(const char* /*flagname*/, int32_t valu
 }
 DEFINE_validator(server_thread_pool_max_thread_count, &ValidateThreadPoolThreadLimit);
 
+DEFINE_int32(apply_pool_adaptive_target_queue_time_ms, 0,
+             "If positive, the maximum number of threads of the server-wide apply "
+             "pool adapts to its load: it's raised while ops wait in the pool's queue "
+             "for longer than this while the system has idle CPU cores, up to "
+             "--apply_pool_adaptive_max_threads, and lowered back to the number of "
+             "CPU cores once the queue times are well under it.");
+TAG_FLAG(apply_pool_adaptive_target_queue_time_ms, experimental);
+
+DEFINE_int32(apply_pool_adaptive_max_threads, 0,
+             "The limit of the maximum number of threads of the apply pool with "
+             "adaptive sizing. See --apply_pool_adaptive_target_queue_time_ms. "
+             "If 0 or less, four times the number of CPU cores.");
+TAG_FLAG(apply_pool_adaptive_max_threads, experimental);
+
+DEFINE_int32(raft_pool_num_shards, 1,
+             "The number of shards of the server-wide Raft pool. Each shard has "
+             "its own lock and queue, and the Raft consensus instances of the "
+             "replicas are spread over them, which reduces contention on hosts "
+             "with many replicas and cores. Idle threads of a shard run the tasks "
+             "queued in the other shards.");
+TAG_FLAG(raft_pool_num_shards, experimental);
+TAG_FLAG(raft_pool_num_shards, advanced);
+DEFINE_validator(raft_pool_num_shards, [](const char* /*flagname*/, int32_t value) {
+  return value > 0;
+});
+
 using std::string;
 using strings::Substitute;
 
@@ -89,6 +116,37 @@ METRIC_DEFINE_histogram(server, op_apply_run_time, "Operation Apply Run Time",
                         kudu::MetricLevel::kWarn,
                         10000000, 2);
 
+METRIC_DEFINE_gauge_int32(server, op_apply_active_threads,
+                          "Operation Apply Active Threads",
+                          kudu::MetricUnit::kThreads,
+                          "Number of threads of the apply pool currently applying "
+                          "operations. Compared to op_apply_max_threads, this is the "
+                          "utilization of the pool.",
+                          kudu::MetricLevel::kInfo);
+
+METRIC_DEFINE_gauge_int32(server, op_apply_max_threads,
+                          "Operation Apply Max Threads",
+                          kudu::MetricUnit::kThreads,
+                          "Maximum number of threads of the apply pool. Only changes "
+                          "with --apply_pool_adaptive_target_queue_time_ms.",
+                          kudu::MetricLevel::kInfo);
+
+METRIC_DEFINE_histogram(server, server_op_prepare_queue_time,
+                        "Operation Prepare Queue Time (Server)",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time that operations of the tablets of this server spent waiting "
+                        "in the prepare queue before being processed.",
+                        kudu::MetricLevel::kInfo,
+                        10000000, 2);
+
+METRIC_DEFINE_histogram(server, server_op_prepare_run_time,
+                        "Operation Prepare Run Time (Server)",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time that operations of the tablets of this server spent being "
+                        "prepared.",
+                        kudu::MetricLevel::kInfo,
+                        10000000, 2);
+
 namespace kudu {
 namespace kserver {
 
@@ -148,9 +206,18 @@ Status KuduServer::Init() {
         METRIC_op_apply_queue_length.Instantiate(metric_entity_),
         METRIC_op_apply_queue_time.Instantiate(metric_entity_),
         METRIC_op_apply_run_time.Instantiate(metric_entity_),
+        METRIC_op_apply_active_threads.Instantiate(metric_entity_, 0),
+        METRIC_op_apply_max_threads.Instantiate(metric_entity_, 0),
     };
     ThreadPoolBuilder builder("apply");
     builder.set_metrics(std::move(metrics));
+    if (FLAGS_apply_pool_adaptive_target_queue_time_ms > 0) {
+      const int max_threads_limit = FLAGS_apply_pool_adaptive_max_threads > 0 ?
+          FLAGS_apply_pool_adaptive_max_threads : 4 * base::NumCPUs();
+      builder.set_adaptive_sizing(
+          max_threads_limit,
+          MonoDelta::FromMilliseconds(FLAGS_apply_pool_adaptive_target_queue_time_ms));
+    }
     if (opts_.apply_queue_overload_threshold.Initialized()) {
       builder.set_queue_overload_threshold(opts_.apply_queue_overload_threshold);
     }
@@ -164,10 +231,16 @@ Status KuduServer::Init() {
                           server_wide_pool_limit);
   RETURN_NOT_OK(ThreadPoolBuilder("prepare")
                 .set_max_threads(server_wide_pool_limit)
+                .set_metrics({
+                    /*queue_length_histogram=*/nullptr,
+                    METRIC_server_op_prepare_queue_time.Instantiate(metric_entity_),
+                    METRIC_server_op_prepare_run_time.Instantiate(metric_entity_)
+                })
                 .Build(&tablet_prepare_pool_));
   RETURN_NOT_OK(ThreadPoolBuilder("raft")
                 .set_trace_metric_prefix("raft")
                 .set_max_threads(server_wide_pool_limit)
+                .set_num_shards(FLAGS_raft_pool_num_shards)
                 .Build(&raft_pool_));
 
   num_raft_leaders_ = metric_entity_->FindOrCreateGauge(&METRIC_num_raft_leaders, 0);
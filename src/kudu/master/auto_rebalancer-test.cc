@@ -23,6 +23,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -44,6 +45,8 @@
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/master/ts_manager.h"
 #include "kudu/mini-cluster/internal_mini_cluster.h"
+#include "kudu/rebalance/cluster_status.h"
+#include "kudu/rebalance/rebalancer.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/util/logging_test_util.h"
@@ -728,5 +731,121 @@ TEST_F(AutoRebalancerTest, TestDeletedTables) {
   }
 }
 
+// Three tablet servers with balanced replica counts, but with the tablets
+// hosted by 'ts-0' much more loaded than the ones hosted by 'ts-2'.
+TEST(AutoRebalancerLoadTest, FindLoadBalancingSwap) {
+  rebalance::ClusterRawInfo raw_info;
+  for (int i = 0; i < 3; i++) {
+    cluster_summary::ServerHealthSummary ts;
+    ts.uuid = Substitute("ts-$0", i);
+    raw_info.tserver_summaries.emplace_back(std::move(ts));
+  }
+  cluster_summary::TableSummary table;
+  table.id = "table";
+  table.replication_factor = 2;
+  raw_info.table_summaries.emplace_back(table);
+
+  const auto add_tablet = [&](const string& id, const vector<string>& ts_uuids) {
+    cluster_summary::TabletSummary tablet;
+    tablet.id = id;
+    tablet.table_id = table.id;
+    tablet.result = cluster_summary::HealthCheckResult::HEALTHY;
+    for (const auto& uuid : ts_uuids) {
+      cluster_summary::ReplicaSummary replica;
+      replica.ts_uuid = uuid;
+      tablet.replicas.emplace_back(std::move(replica));
+    }
+    raw_info.tablet_summaries.emplace_back(std::move(tablet));
+  };
+  add_tablet("hot", { "ts-0", "ts-1" });
+  add_tablet("warm", { "ts-0", "ts-2" });
+  add_tablet("cold", { "ts-1", "ts-2" });
+  unordered_map<string, double> load_by_tablet_id = {
+    { "hot", 10 }, { "warm", 4 }, { "cold", 1 },
+  };
+
+  // ts-0 has a load of 14, ts-1 of 11 and ts-2 of 5: swapping 'hot' on ts-0
+  // with 'cold' on ts-2 leaves ts-0 and ts-2 with loads of 5 and 14. Swapping
+  // 'warm' isn't possible, since ts-2 hosts it too. So the best swap would
+  // make things worse.
+  vector<rebalance::Rebalancer::ReplicaMove> moves;
+  ASSERT_FALSE(FindLoadBalancingSwap(raw_info, load_by_tablet_id, 0.5, &moves));
+  ASSERT_TRUE(moves.empty());
+
+  // With another tablet of load 5 on ts-0 and ts-1, ts-0 has a load of 19,
+  // ts-1 of 16 and ts-2 of 5. Swapping 'hot' with 'cold' leaves ts-0 and ts-2
+  // with loads of 10 and 14, and swapping the new tablet with 'cold' would
+  // leave them with 15 and 9.
+  add_tablet("medium", { "ts-0", "ts-1" });
+  load_by_tablet_id.emplace("medium", 5);
+  ASSERT_TRUE(FindLoadBalancingSwap(raw_info, load_by_tablet_id, 0.5, &moves));
+  ASSERT_EQ(2, moves.size());
+  ASSERT_EQ("hot", moves[0].tablet_uuid);
+  ASSERT_EQ("ts-0", moves[0].ts_uuid_from);
+  ASSERT_EQ("ts-2", moves[0].ts_uuid_to);
+  ASSERT_EQ("cold", moves[1].tablet_uuid);
+  ASSERT_EQ("ts-2", moves[1].ts_uuid_from);
+  ASSERT_EQ("ts-0", moves[1].ts_uuid_to);
+
+  // There are no swaps if the load is balanced enough: the difference of 14
+  // is less than 1.1 times the average load of 13.33.
+  moves.clear();
+  ASSERT_FALSE(FindLoadBalancingSwap(raw_info, load_by_tablet_id, 1.1, &moves));
+  ASSERT_TRUE(moves.empty());
+}
+
+// After a restart, 'ts-0' leads all the tablets. The leadership of tablets
+// moves to their followers until the leader loads are even.
+TEST(AutoRebalancerLoadTest, FindLeaderMoves) {
+  rebalance::ClusterRawInfo raw_info;
+  for (int i = 0; i < 3; i++) {
+    cluster_summary::ServerHealthSummary ts;
+    ts.uuid = Substitute("ts-$0", i);
+    raw_info.tserver_summaries.emplace_back(std::move(ts));
+  }
+  for (int i = 0; i < 6; i++) {
+    cluster_summary::TabletSummary tablet;
+    tablet.id = Substitute("tablet-$0", i);
+    tablet.result = cluster_summary::HealthCheckResult::HEALTHY;
+    for (int j = 0; j < 3; j++) {
+      cluster_summary::ReplicaSummary replica;
+      replica.ts_uuid = Substitute("ts-$0", j);
+      replica.is_voter = true;
+      replica.is_leader = j == 0;
+      tablet.replicas.emplace_back(std::move(replica));
+    }
+    raw_info.tablet_summaries.emplace_back(std::move(tablet));
+  }
+
+  // With the same load for all the tablets, each server ends up leading two.
+  vector<LeaderMove> moves;
+  FindLeaderMoves(raw_info, {}, 10, &moves);
+  ASSERT_EQ(4, moves.size());
+  unordered_map<string, int> moves_by_ts;
+  for (const auto& move : moves) {
+    ASSERT_EQ("ts-0", move.ts_uuid_from);
+    moves_by_ts[move.ts_uuid_to]++;
+  }
+  ASSERT_EQ(2, moves_by_ts["ts-1"]);
+  ASSERT_EQ(2, moves_by_ts["ts-2"]);
+
+  // The number of moves is limited.
+  moves.clear();
+  FindLeaderMoves(raw_info, {}, 1, &moves);
+  ASSERT_EQ(1, moves.size());
+
+  // The leadership of a tablet as loaded as all the others together moves
+  // first, and then two of the others move to the remaining server, which
+  // ends up with a load of 2, against 3 and 5 for the others.
+  moves.clear();
+  FindLeaderMoves(raw_info, { { "tablet-0", 5 } }, 10, &moves);
+  ASSERT_EQ(3, moves.size());
+  ASSERT_EQ("tablet-0", moves[0].tablet_uuid);
+  for (int i = 1; i < moves.size(); i++) {
+    ASSERT_EQ("ts-0", moves[i].ts_uuid_from);
+    ASSERT_NE(moves[0].ts_uuid_to, moves[i].ts_uuid_to);
+  }
+}
+
 } // namespace master
 } // namespace kudu
@@ -17,8 +17,11 @@
 
 #include "kudu/master/auto_rebalancer.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <ostream>
 #include <random>
@@ -51,8 +54,10 @@
 #include "kudu/rebalance/rebalancer.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/cow_object.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
@@ -92,8 +97,10 @@ using kudu::rebalance::TabletExtraInfo;
 using kudu::rebalance::TabletsPlacementInfo;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
+using kudu::tablet::ReportedTabletStatsPB;
 using strings::Substitute;
 
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unordered_map;
@@ -133,10 +140,252 @@ DEFINE_uint32(auto_rebalancing_wait_for_replica_moves_seconds, 1,
               "How long to wait before checking to see if the scheduled replica movement "
               "in this iteration of auto-rebalancing has completed.");
 
+DEFINE_bool(auto_rebalancing_load_aware, false,
+            "Whether the auto-rebalancer, once the replica counts are "
+            "balanced, also swaps replicas of the same table between the most "
+            "and the least loaded tablet servers of a location, to even out "
+            "their load. The load of a replica is the weighted sum of its "
+            "tablet's share of the on-disk size, the write rate and the scan "
+            "rate of all the tablets. The rates are only known if the tablet "
+            "servers run with --report_tablet_workload_rates.");
+TAG_FLAG(auto_rebalancing_load_aware, experimental);
+TAG_FLAG(auto_rebalancing_load_aware, runtime);
+
+DEFINE_double(auto_rebalancing_load_imbalance_ratio, 0.5,
+              "With --auto_rebalancing_load_aware, the difference between the "
+              "loads of the most and the least loaded tablet servers of a "
+              "location, as a ratio of the average load of the location's "
+              "tablet servers, above which replicas are swapped between them.");
+TAG_FLAG(auto_rebalancing_load_imbalance_ratio, experimental);
+TAG_FLAG(auto_rebalancing_load_imbalance_ratio, runtime);
+
+DEFINE_double(auto_rebalancing_load_size_weight, 1.0,
+              "The weight of the on-disk size in the load of a replica. See "
+              "--auto_rebalancing_load_aware.");
+TAG_FLAG(auto_rebalancing_load_size_weight, experimental);
+TAG_FLAG(auto_rebalancing_load_size_weight, runtime);
+
+DEFINE_double(auto_rebalancing_load_write_rate_weight, 1.0,
+              "The weight of the write rate in the load of a replica. See "
+              "--auto_rebalancing_load_aware.");
+TAG_FLAG(auto_rebalancing_load_write_rate_weight, experimental);
+TAG_FLAG(auto_rebalancing_load_write_rate_weight, runtime);
+
+DEFINE_double(auto_rebalancing_load_scan_rate_weight, 1.0,
+              "The weight of the scan rate in the load of a replica. See "
+              "--auto_rebalancing_load_aware.");
+TAG_FLAG(auto_rebalancing_load_scan_rate_weight, experimental);
+TAG_FLAG(auto_rebalancing_load_scan_rate_weight, runtime);
+
+DEFINE_bool(auto_leader_rebalancing_enabled, false,
+            "Whether the auto-rebalancer, once the replicas are balanced, also "
+            "transfers the leadership of tablets between the tablet servers of "
+            "each location to even out the load of the leader replicas they "
+            "host. The load of a leader replica grows with the write rate of "
+            "its tablet, if the tablet servers run with "
+            "--report_tablet_workload_rates.");
+TAG_FLAG(auto_leader_rebalancing_enabled, experimental);
+TAG_FLAG(auto_leader_rebalancing_enabled, runtime);
+
+DEFINE_uint32(auto_leader_rebalancing_max_moves_per_round, 10,
+              "The maximum number of leadership transfers the auto-rebalancer "
+              "requests per location in each rebalancing cycle.");
+TAG_FLAG(auto_leader_rebalancing_max_moves_per_round, experimental);
+TAG_FLAG(auto_leader_rebalancing_max_moves_per_round, runtime);
+
+DEFINE_double(auto_leader_rebalancing_write_rate_weight, 1.0,
+              "The load of a leader replica is 1, plus this weight times the "
+              "write rate of its tablet relative to the average write rate of "
+              "the tablets. A weight of 0 balances the leader counts.");
+TAG_FLAG(auto_leader_rebalancing_write_rate_weight, experimental);
+TAG_FLAG(auto_leader_rebalancing_write_rate_weight, runtime);
+
 namespace kudu {
 
 namespace master {
 
+void FindLeaderMoves(const ClusterRawInfo& raw_info,
+                     const unordered_map<string, double>& load_by_tablet_id,
+                     int max_moves,
+                     vector<LeaderMove>* leader_moves) {
+  unordered_map<string, double> load_by_ts;
+  for (const auto& ts : raw_info.tserver_summaries) {
+    load_by_ts.emplace(ts.uuid, 0);
+  }
+  // The healthy tablets led by each server, which are the ones whose
+  // leadership may be transferred.
+  unordered_map<string, vector<const TabletSummary*>> tablets_by_leader;
+  for (const auto& tablet : raw_info.tablet_summaries) {
+    for (const auto& replica : tablet.replicas) {
+      auto* ts_load = FindOrNull(load_by_ts, replica.ts_uuid);
+      if (replica.is_leader && ts_load) {
+        *ts_load += FindWithDefault(load_by_tablet_id, tablet.id, 1);
+        if (tablet.result == HealthCheckResult::HEALTHY) {
+          tablets_by_leader[replica.ts_uuid].emplace_back(&tablet);
+        }
+      }
+    }
+  }
+
+  // Greedily transfer the leadership of a tablet to one of its followers,
+  // picking the transfer that reduces the variance of the servers' loads the
+  // most. Transferring a load of 'w' from a server with a load of 'a' to one
+  // with a load of 'b' changes the sum of the squares of the loads by
+  // '2w(w - (a - b))'.
+  unordered_set<string> moved_tablets;
+  while (leader_moves->size() < max_moves) {
+    double best_change = 0;
+    const string* best_from = nullptr;
+    const TabletSummary* best_tablet = nullptr;
+    const string* best_to = nullptr;
+    for (const auto& elem : tablets_by_leader) {
+      const double from_load = FindOrDie(load_by_ts, elem.first);
+      for (const auto* tablet : elem.second) {
+        if (ContainsKey(moved_tablets, tablet->id)) {
+          continue;
+        }
+        const double w = FindWithDefault(load_by_tablet_id, tablet->id, 1);
+        for (const auto& replica : tablet->replicas) {
+          const auto* to_load = FindOrNull(load_by_ts, replica.ts_uuid);
+          if (replica.is_leader || !replica.is_voter || !to_load) {
+            continue;
+          }
+          const double change = 2 * w * (w - (from_load - *to_load));
+          if (change < best_change) {
+            best_change = change;
+            best_from = &elem.first;
+            best_tablet = tablet;
+            best_to = &replica.ts_uuid;
+          }
+        }
+      }
+    }
+    if (!best_tablet) {
+      break;
+    }
+    const double w = FindWithDefault(load_by_tablet_id, best_tablet->id, 1);
+    FindOrDie(load_by_ts, *best_from) -= w;
+    FindOrDie(load_by_ts, *best_to) += w;
+    moved_tablets.insert(best_tablet->id);
+    leader_moves->push_back({ best_tablet->id, *best_from, *best_to });
+  }
+}
+
+bool FindLoadBalancingSwap(const ClusterRawInfo& raw_info,
+                           const unordered_map<string, double>& load_by_tablet_id,
+                           double imbalance_ratio,
+                           vector<Rebalancer::ReplicaMove>* replica_moves) {
+  if (raw_info.tserver_summaries.size() < 2) {
+    return false;
+  }
+  unordered_map<string, int> replication_factor_by_table_id;
+  for (const auto& table : raw_info.table_summaries) {
+    replication_factor_by_table_id.emplace(table.id, table.replication_factor);
+  }
+
+  // The load of each server, and the replicas it hosts.
+  unordered_map<string, double> load_by_ts;
+  unordered_map<string, unordered_set<string>> tablets_by_ts;
+  for (const auto& ts : raw_info.tserver_summaries) {
+    load_by_ts.emplace(ts.uuid, 0);
+  }
+  for (const auto& tablet : raw_info.tablet_summaries) {
+    const double load = FindWithDefault(load_by_tablet_id, tablet.id, 0);
+    for (const auto& replica : tablet.replicas) {
+      auto* ts_load = FindOrNull(load_by_ts, replica.ts_uuid);
+      if (ts_load) {
+        *ts_load += load;
+        tablets_by_ts[replica.ts_uuid].insert(tablet.id);
+      }
+    }
+  }
+
+  double total_load = 0;
+  const pair<const string, double>* most_loaded = nullptr;
+  const pair<const string, double>* least_loaded = nullptr;
+  for (const auto& elem : load_by_ts) {
+    total_load += elem.second;
+    if (!most_loaded || elem.second > most_loaded->second) {
+      most_loaded = &elem;
+    }
+    if (!least_loaded || elem.second < least_loaded->second) {
+      least_loaded = &elem;
+    }
+  }
+  const double diff = most_loaded->second - least_loaded->second;
+  if (diff <= 0 || diff <= imbalance_ratio * total_load / load_by_ts.size()) {
+    return false;
+  }
+  const auto& from_tablets = tablets_by_ts[most_loaded->first];
+  const auto& to_tablets = tablets_by_ts[least_loaded->first];
+
+  // The candidates to move from each server, by table: healthy tablets with a
+  // replica on one of the servers but not the other, and with more than one
+  // replica. Swapping replicas of the same table keeps the replica counts,
+  // which the other phases of the rebalancing balance, the same.
+  typedef unordered_map<string, vector<pair<double, string>>> CandidatesByTable;
+  CandidatesByTable from_candidates;
+  CandidatesByTable to_candidates;
+  for (const auto& tablet : raw_info.tablet_summaries) {
+    if (tablet.result != HealthCheckResult::HEALTHY ||
+        FindWithDefault(replication_factor_by_table_id, tablet.table_id, 0) < 2) {
+      continue;
+    }
+    const bool on_from = ContainsKey(from_tablets, tablet.id);
+    const bool on_to = ContainsKey(to_tablets, tablet.id);
+    if (on_from == on_to) {
+      continue;
+    }
+    auto* candidates = on_from ? &from_candidates : &to_candidates;
+    (*candidates)[tablet.table_id].emplace_back(
+        FindWithDefault(load_by_tablet_id, tablet.id, 0), tablet.id);
+  }
+
+  // Swapping a replica with load 'x' from the most loaded server with one with
+  // load 'y' from the least loaded server changes the difference of their loads
+  // to 'diff - 2 * (x - y)'. So the best swap for 'x' is the one with 'y'
+  // closest to 'x - diff / 2', and it only improves the balance if 'y' is
+  // between 'x - diff' and 'x'.
+  double best_diff = diff;
+  const string* best_from = nullptr;
+  const string* best_to = nullptr;
+  for (auto& elem : to_candidates) {
+    const auto* from = FindOrNull(from_candidates, elem.first);
+    if (!from) {
+      continue;
+    }
+    auto& to = elem.second;
+    std::sort(to.begin(), to.end());
+    for (const auto& x : *from) {
+      const auto it = std::lower_bound(
+          to.begin(), to.end(), std::make_pair(x.first - diff / 2, string()));
+      for (auto y = it == to.begin() ? it : std::prev(it);
+           y != to.end() && y <= it; ++y) {
+        const double new_diff = std::abs(diff - 2 * (x.first - y->first));
+        if (new_diff < best_diff) {
+          best_diff = new_diff;
+          best_from = &x.second;
+          best_to = &y->second;
+        }
+      }
+    }
+  }
+  if (!best_from) {
+    return false;
+  }
+  Rebalancer::ReplicaMove move_from;
+  move_from.tablet_uuid = *best_from;
+  move_from.ts_uuid_from = most_loaded->first;
+  move_from.ts_uuid_to = least_loaded->first;
+  replica_moves->emplace_back(std::move(move_from));
+  Rebalancer::ReplicaMove move_to;
+  move_to.tablet_uuid = *best_to;
+  move_to.ts_uuid_from = least_loaded->first;
+  move_to.ts_uuid_to = most_loaded->first;
+  replica_moves->emplace_back(std::move(move_to));
+  return true;
+}
+
 AutoRebalancerTask::AutoRebalancerTask(CatalogManager* catalog_manager,
                                        TSManager* ts_manager)
     : catalog_manager_(catalog_manager),
@@ -235,6 +484,19 @@ void AutoRebalancerTask::RunLoop() {
                                  s.ToString());
       continue;
     }
+    if (replica_moves.empty() && FLAGS_auto_rebalancing_load_aware) {
+      s = GetLoadBalancingMoves(cluster_info.locality, &replica_moves);
+      if (!s.ok()) {
+        LOG(WARNING) << Substitute("could not retrieve load-balancing replica moves: $0",
+                                   s.ToString());
+        continue;
+      }
+    }
+    // Leadership is only worth balancing once the replicas are in place.
+    if (replica_moves.empty() && FLAGS_auto_leader_rebalancing_enabled) {
+      WARN_NOT_OK(RebalanceLeaders(cluster_info.locality),
+                  "could not rebalance tablet leadership");
+    }
     WARN_NOT_OK(ExecuteMoves(replica_moves),
                 "failed to send replica move request");
     moves_scheduled_this_round_for_test_ = replica_moves.size();
@@ -363,6 +625,128 @@ Status AutoRebalancerTask::GetMovesUsingRebalancingAlgo(
   return Status::OK();
 }
 
+Status AutoRebalancerTask::GetLoadBalancingMoves(
+    const ClusterLocalityInfo& locality,
+    vector<Rebalancer::ReplicaMove>* replica_moves) {
+  unordered_map<string, double> load_by_tablet_id;
+  RETURN_NOT_OK(GetTabletLoads(&load_by_tablet_id));
+  // Replicas are only swapped within a location, so that the placement
+  // policy holds. At most one swap per location is made per round, since the
+  // loads are only known again once the moved replicas report their stats,
+  // and so that copying the replicas doesn't overwhelm the servers.
+  for (const auto& elem : locality.servers_by_location) {
+    ClusterRawInfo location_raw_info;
+    RETURN_NOT_OK(BuildClusterRawInfo(elem.first, &location_raw_info));
+    FindLoadBalancingSwap(location_raw_info, load_by_tablet_id,
+                          FLAGS_auto_rebalancing_load_imbalance_ratio, replica_moves);
+  }
+  return Status::OK();
+}
+
+Status AutoRebalancerTask::GetTabletStats(
+    vector<pair<string, ReportedTabletStatsPB>>* stats) const {
+  vector<scoped_refptr<TableInfo>> tables;
+  {
+    CatalogManager::ScopedLeaderSharedLock l(catalog_manager_);
+    RETURN_NOT_OK(l.first_failed_status());
+    catalog_manager_->GetAllTables(&tables);
+  }
+  for (const auto& table : tables) {
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (const auto& tablet : tablets) {
+      stats->emplace_back(tablet->id(), tablet->GetStats());
+    }
+  }
+  return Status::OK();
+}
+
+Status AutoRebalancerTask::GetTabletLoads(
+    unordered_map<string, double>* load_by_tablet_id) const {
+  vector<pair<string, ReportedTabletStatsPB>> stats;
+  RETURN_NOT_OK(GetTabletStats(&stats));
+  double total_size = 0;
+  double total_write_rate = 0;
+  double total_scan_rate = 0;
+  for (const auto& elem : stats) {
+    total_size += elem.second.on_disk_size();
+    total_write_rate += elem.second.write_rate();
+    total_scan_rate += elem.second.scan_rate();
+  }
+
+  // Each dimension of the load is the tablet's share of the total, so that
+  // they're comparable.
+  const auto share = [](double value, double total) {
+    return total > 0 ? value / total : 0;
+  };
+  for (const auto& elem : stats) {
+    const auto& tablet_stats = elem.second;
+    const double load =
+        FLAGS_auto_rebalancing_load_size_weight *
+            share(tablet_stats.on_disk_size(), total_size) +
+        FLAGS_auto_rebalancing_load_write_rate_weight *
+            share(tablet_stats.write_rate(), total_write_rate) +
+        FLAGS_auto_rebalancing_load_scan_rate_weight *
+            share(tablet_stats.scan_rate(), total_scan_rate);
+    EmplaceOrDie(load_by_tablet_id, elem.first, load);
+  }
+  return Status::OK();
+}
+
+Status AutoRebalancerTask::RebalanceLeaders(const ClusterLocalityInfo& locality) {
+  vector<pair<string, ReportedTabletStatsPB>> stats;
+  RETURN_NOT_OK(GetTabletStats(&stats));
+  double total_write_rate = 0;
+  for (const auto& elem : stats) {
+    total_write_rate += elem.second.write_rate();
+  }
+  unordered_map<string, double> load_by_tablet_id;
+  for (const auto& elem : stats) {
+    const double relative_write_rate = total_write_rate > 0
+        ? elem.second.write_rate() * stats.size() / total_write_rate : 0;
+    EmplaceOrDie(&load_by_tablet_id, elem.first,
+                 1 + FLAGS_auto_leader_rebalancing_write_rate_weight * relative_write_rate);
+  }
+
+  // Leadership is only transferred between the servers of a location, so
+  // that a location's clients keep finding the same share of leaders there.
+  vector<LeaderMove> leader_moves;
+  for (const auto& elem : locality.servers_by_location) {
+    ClusterRawInfo location_raw_info;
+    RETURN_NOT_OK(BuildClusterRawInfo(elem.first, &location_raw_info));
+    vector<LeaderMove> location_moves;
+    FindLeaderMoves(location_raw_info, load_by_tablet_id,
+                    FLAGS_auto_leader_rebalancing_max_moves_per_round, &location_moves);
+    leader_moves.insert(leader_moves.end(), location_moves.begin(), location_moves.end());
+  }
+
+  for (const auto& move : leader_moves) {
+    shared_ptr<TSDescriptor> desc;
+    if (!ts_manager_->LookupTSByUUID(move.ts_uuid_from, &desc)) {
+      LOG(WARNING) << Substitute("Couldn't find leader replica's tserver $0",
+                                 move.ts_uuid_from);
+      continue;
+    }
+    shared_ptr<ConsensusServiceProxy> proxy;
+    RETURN_NOT_OK(desc->GetConsensusProxy(messenger_, &proxy));
+    LeaderStepDownRequestPB req;
+    LeaderStepDownResponsePB resp;
+    RpcController rpc;
+    req.set_dest_uuid(move.ts_uuid_from);
+    req.set_tablet_id(move.tablet_uuid);
+    req.set_mode(LeaderStepDownMode::GRACEFUL);
+    req.set_new_leader_uuid(move.ts_uuid_to);
+    rpc.set_timeout(MonoDelta::FromSeconds(FLAGS_auto_rebalancing_rpc_timeout_seconds));
+    Status s = proxy->LeaderStepDown(req, &resp, &rpc);
+    if (s.ok() && resp.has_error()) {
+      s = StatusFromPB(resp.error().status());
+    }
+    WARN_NOT_OK(s, Substitute("failed to transfer the leadership of tablet $0 from $1 to $2",
+                              move.tablet_uuid, move.ts_uuid_from, move.ts_uuid_to));
+  }
+  return Status::OK();
+}
+
 Status AutoRebalancerTask::GetTabletLeader(
     const string& tablet_id,
     string* leader_uuid,
@@ -21,6 +21,8 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -46,6 +48,10 @@ namespace rpc {
 class Messenger;
 } // namespace rpc
 
+namespace tablet {
+class ReportedTabletStatsPB;
+} // namespace tablet
+
 namespace master {
 
 class CatalogManager;
@@ -56,6 +62,35 @@ enum CrossLocations {
   NO
 };
 
+// Finds the swap of two replicas of the same table between the most and the
+// least loaded of the tablet servers in 'raw_info' that evens out their loads
+// the most, and appends the two replica moves to 'replica_moves'. The load of
+// a server is the sum of the loads of the tablets it hosts replicas of, as
+// found in 'load_by_tablet_id'. Returns false, leaving 'replica_moves' as is,
+// if the difference of the loads of the two servers is no more than
+// 'imbalance_ratio' times the average load, or if no swap would reduce it.
+// A transfer of a tablet's leadership from one tablet server to another.
+struct LeaderMove {
+  std::string tablet_uuid;
+  std::string ts_uuid_from;
+  std::string ts_uuid_to;
+};
+
+// Finds up to 'max_moves' transfers of leadership between the tablet servers
+// in 'raw_info' that even out the load of the leader replicas they host, and
+// appends them to 'leader_moves'. The load of a leader replica is the one of
+// its tablet in 'load_by_tablet_id', or 1 if it isn't there. The leadership
+// of a tablet is transferred at most once, and only to one of its voters.
+void FindLeaderMoves(const rebalance::ClusterRawInfo& raw_info,
+                     const std::unordered_map<std::string, double>& load_by_tablet_id,
+                     int max_moves,
+                     std::vector<LeaderMove>* leader_moves);
+
+bool FindLoadBalancingSwap(const rebalance::ClusterRawInfo& raw_info,
+                           const std::unordered_map<std::string, double>& load_by_tablet_id,
+                           double imbalance_ratio,
+                           std::vector<rebalance::Rebalancer::ReplicaMove>* replica_moves);
+
 // A CatalogManager background task which auto-rebalances tablet replica distribution.
 //
 // As a background task, the lifetime of an instance of this class must be less
@@ -122,6 +157,26 @@ class AutoRebalancerTask {
       const rebalance::TabletsPlacementInfo& placement_info,
       std::vector<rebalance::Rebalancer::ReplicaMove>* replica_moves);
 
+  // Once the replica counts are balanced, gets the replica moves that even
+  // out the load of the tablet servers of each location, if it's uneven
+  // enough. See --auto_rebalancing_load_aware.
+  Status GetLoadBalancingMoves(
+      const rebalance::ClusterLocalityInfo& locality,
+      std::vector<rebalance::Rebalancer::ReplicaMove>* replica_moves);
+
+  // Asks the leader replicas of tablets to step down in favor of a follower,
+  // to even out the leader loads of the tablet servers of each location. See
+  // --auto_leader_rebalancing_enabled.
+  Status RebalanceLeaders(const rebalance::ClusterLocalityInfo& locality);
+
+  // Gets the stats reported by the leader replica of each tablet.
+  Status GetTabletStats(
+      std::vector<std::pair<std::string, tablet::ReportedTabletStatsPB>>* stats) const;
+
+  // Computes the load of each tablet from the stats reported by its leader
+  // replica, weighted by the --auto_rebalancing_load_*_weight flags.
+  Status GetTabletLoads(std::unordered_map<std::string, double>* load_by_tablet_id) const;
+
   // Gets information on the current leader replica for the specified tablet and
   // populates the 'leader_uuid' and 'leader_hp' output parameters. The
   // function returns Status::NotFound() if no replica is a leader for the tablet.
@@ -17,9 +17,11 @@
 
 #include "kudu/master/catalog_manager.h"
 
+#include <cstdint>
 #include <numeric>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -32,6 +34,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/util/cow_object.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
@@ -250,5 +253,34 @@ TEST(TableInfoTest, MaxReturnedLocationsNotSpecified) {
   }
 }
 
+TEST(TableInfoTest, FindSplitCandidates) {
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  const vector<int64_t> kSizes = { 100, 120, 90, 1000, 110 };
+  vector<scoped_refptr<TabletInfo>> tablets;
+  for (int i = 0; i < kSizes.size(); i++) {
+    scoped_refptr<TabletInfo> tablet(new TabletInfo(table, Substitute("tablet-$0", i)));
+    tablet::ReportedTabletStatsPB stats;
+    stats.set_on_disk_size(kSizes[i]);
+    tablet->UpdateStats(std::move(stats));
+    tablets.emplace_back(std::move(tablet));
+  }
+  // A tablet without stats is ignored.
+  tablets.emplace_back(new TabletInfo(table, "tablet-no-stats"));
+
+  auto candidates = CatalogManager::FindSplitCandidates(tablets, 500, 4.0);
+  ASSERT_EQ(1, candidates.size());
+  ASSERT_EQ("tablet-3", candidates[0]->id());
+
+  // The largest tablet isn't large enough.
+  ASSERT_TRUE(CatalogManager::FindSplitCandidates(tablets, 2000, 4.0).empty());
+
+  // The largest tablet isn't large enough compared to the others.
+  ASSERT_TRUE(CatalogManager::FindSplitCandidates(tablets, 500, 20.0).empty());
+
+  // A single tablet only needs to be large enough.
+  candidates = CatalogManager::FindSplitCandidates({ tablets[3] }, 500, 4.0);
+  ASSERT_EQ(1, candidates.size());
+}
+
 } // namespace master
 } // namespace kudu
@@ -67,6 +67,7 @@
 #include <google/protobuf/stubs/common.h>
 
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/partial_row.h"
@@ -90,6 +91,7 @@
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
@@ -104,6 +106,7 @@
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master_cert_authority.h"
 #include "kudu/master/placement_policy.h"
+#include "kudu/master/quota_tracker.h"
 #include "kudu/master/ranger_authz_provider.h"
 #include "kudu/master/sys_catalog.h"
 #include "kudu/master/table_locations_cache.h"
@@ -352,6 +355,24 @@ DEFINE_uint32(table_locations_cache_capacity_mb, 0,
               "of 0 means table locations are not be cached");
 TAG_FLAG(table_locations_cache_capacity_mb, advanced);
 
+DEFINE_bool(master_follower_serve_lookups, false,
+            "Whether follower masters keep a copy of the table and tablet "
+            "metadata in memory, reloaded from their replica of the system "
+            "catalog, and serve tablet location lookups from it. The locations "
+            "returned by a follower may be out of date by up to twice "
+            "--master_follower_catalog_refresh_interval_ms, plus however far "
+            "behind the leader its replica of the system catalog is.");
+TAG_FLAG(master_follower_serve_lookups, experimental);
+TAG_FLAG(master_follower_serve_lookups, runtime);
+
+DEFINE_int32(master_follower_catalog_refresh_interval_ms, 5000,
+             "How often follower masters reload the table and tablet metadata "
+             "into memory when --master_follower_serve_lookups is set. A "
+             "follower stops serving lookups if its copy is older than twice "
+             "this interval.");
+TAG_FLAG(master_follower_catalog_refresh_interval_ms, experimental);
+TAG_FLAG(master_follower_catalog_refresh_interval_ms, runtime);
+
 DEFINE_bool(enable_per_range_hash_schemas, false,
             "Whether the ability to specify different hash schemas per range is enabled");
 TAG_FLAG(enable_per_range_hash_schemas, unsafe);
@@ -405,12 +426,46 @@ DEFINE_bool(require_new_spec_for_custom_hash_schema_range_bound, false,
 TAG_FLAG(require_new_spec_for_custom_hash_schema_range_bound, experimental);
 TAG_FLAG(require_new_spec_for_custom_hash_schema_range_bound, runtime);
 
+DEFINE_int64(tablet_split_candidate_min_size_mb, 0,
+             "The master's log reports the tablets whose on-disk size, as "
+             "reported by their leader replica, is at least this large (in MiB) "
+             "and at least --tablet_split_candidate_size_ratio times the median "
+             "size of the other tablets of their table, as candidates for "
+             "re-partitioning. A value of 0 disables this.");
+TAG_FLAG(tablet_split_candidate_min_size_mb, experimental);
+TAG_FLAG(tablet_split_candidate_min_size_mb, runtime);
+
+DEFINE_double(tablet_split_candidate_size_ratio, 4.0,
+              "See --tablet_split_candidate_min_size_mb.");
+TAG_FLAG(tablet_split_candidate_size_ratio, experimental);
+TAG_FLAG(tablet_split_candidate_size_ratio, runtime);
+
+DEFINE_int32(tablet_split_candidate_check_interval_secs, 300,
+             "How often the leader master looks for tablets that are "
+             "candidates for re-partitioning. See "
+             "--tablet_split_candidate_min_size_mb.");
+TAG_FLAG(tablet_split_candidate_check_interval_secs, experimental);
+TAG_FLAG(tablet_split_candidate_check_interval_secs, runtime);
+
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_int64(tsk_rotation_seconds);
 DECLARE_string(ranger_config_path);
 
 METRIC_DEFINE_entity(table);
 
+METRIC_DEFINE_gauge_int64(server, sys_catalog_tables_load_time,
+                          "Time Taken to Load the Tables",
+                          kudu::MetricUnit::kMilliseconds,
+                          "Time taken by the catalog manager to load the tables' "
+                          "metadata from the system catalog the last time it did so",
+                          kudu::MetricLevel::kInfo);
+METRIC_DEFINE_gauge_int64(server, sys_catalog_tablets_load_time,
+                          "Time Taken to Load the Tablets",
+                          kudu::MetricUnit::kMilliseconds,
+                          "Time taken by the catalog manager to load the tablets' "
+                          "metadata from the system catalog the last time it did so",
+                          kudu::MetricLevel::kInfo);
+
 using base::subtle::NoBarrier_CompareAndSwap;
 using base::subtle::NoBarrier_Load;
 using boost::none;
@@ -779,7 +834,9 @@ void CatalogManagerBgTasks::Shutdown() {
 
 void CatalogManagerBgTasks::Run() {
   MonoTime last_tspk_run;
+  MonoTime last_split_candidates_run;
   while (!NoBarrier_Load(&closing_)) {
+    bool is_follower = false;
     {
       CatalogManager::ScopedLeaderSharedLock l(catalog_manager_);
       if (!l.catalog_status().ok()) {
@@ -853,7 +910,15 @@ void CatalogManagerBgTasks::Run() {
             LOG(FATAL) << err_msg;
           }
         }
+
+        if (FLAGS_tablet_split_candidate_min_size_mb > 0) {
+          catalog_manager_->LogSplitCandidatesIfNecessary(&last_split_candidates_run);
+        }
+
+        // Split the quotas among the tablet servers for their next heartbeats.
+        catalog_manager_->master_->quota_tracker()->SplitQuotasIfNecessary();
       } else if (l.owns_lock()) {
+        is_follower = true;
         // This is the case of a follower catalog manager running as a part
         // of master process. To be able to authenticate connecting clients
         // using their authn tokens, a follower master needs:
@@ -867,6 +932,12 @@ void CatalogManagerBgTasks::Run() {
         }
       }
     }
+    // The follower's catalog is reloaded with the leader lock held for
+    // writing, so this is done once the shared lock above is released.
+    if (is_follower && FLAGS_master_follower_serve_lookups) {
+      WARN_NOT_OK(catalog_manager_->RefreshFollowerCatalogIfNecessary(),
+                  "failed to reload follower catalog, will retry");
+    }
     // Wait for a notification or a timeout expiration.
     //  - CreateTable will call Wake() to notify about the tablets to add
     //  - HandleReportedTablet/ProcessPendingAssignments will call WakeIfHasPendingUpdates()
@@ -1429,6 +1500,19 @@ void CatalogManager::PrepareForLeadershipTask() {
       }
     }
 
+    static const char* const kReportCheckpointsDescription =
+        "Loading tablet report checkpoints";
+    LOG(INFO) << kReportCheckpointsDescription << "...";
+    LOG_SLOW_EXECUTION(WARNING, 1000, LogPrefix() + kReportCheckpointsDescription) {
+      if (!check([this]() {
+            return this->master_->ts_manager()->ReloadTabletReportCheckpoints(
+                this->sys_catalog_.get());
+          },
+          *consensus, term, kReportCheckpointsDescription).ok()) {
+        return;
+      }
+    }
+
     if (hms_catalog_) {
       static const char* const kNotificationLogEventIdDescription =
           "Loading latest processed Hive Metastore notification log event ID";
@@ -1449,6 +1533,39 @@ void CatalogManager::PrepareForLeadershipTask() {
   leader_ready_term_ = term;
 }
 
+Status CatalogManager::RefreshFollowerCatalogIfNecessary() {
+  const MonoTime now = MonoTime::Now();
+  // Only the background task thread writes this, so there's no need for the
+  // leader lock to read it here.
+  if (follower_catalog_load_time_.Initialized() &&
+      now - follower_catalog_load_time_ < MonoDelta::FromMilliseconds(
+          FLAGS_master_follower_catalog_refresh_interval_ms)) {
+    return Status::OK();
+  }
+
+  std::lock_guard<RWMutex> leader_lock_guard(leader_lock_);
+  // This master may have been elected leader in the meantime, in which case
+  // its own leadership preparation loads the metadata.
+  if (Role() == RaftPeerPB::LEADER) {
+    return Status::OK();
+  }
+  follower_catalog_load_time_ = MonoTime();
+  LOG_SLOW_EXECUTION(WARNING, 1000, LogPrefix() + "Reloading follower catalog") {
+    RETURN_NOT_OK(VisitTablesAndTabletsUnlocked());
+  }
+  ResetTableLocationsCache();
+  follower_catalog_load_time_ = now;
+  return Status::OK();
+}
+
+bool CatalogManager::CanServeLookupsAsFollowerUnlocked() const {
+  leader_lock_.AssertAcquiredForReading();
+  return FLAGS_master_follower_serve_lookups &&
+      follower_catalog_load_time_.Initialized() &&
+      MonoTime::Now() - follower_catalog_load_time_ <= MonoDelta::FromMilliseconds(
+          2 * FLAGS_master_follower_catalog_refresh_interval_ms);
+}
+
 Status CatalogManager::PrepareFollowerClusterId() {
   static const char* const kDescription =
       "loading cluster ID for follower catalog manager";
@@ -1555,12 +1672,19 @@ Status CatalogManager::VisitTablesAndTabletsUnlocked() {
   tablet_map_.clear();
 
   // Visit tables and tablets, load them into memory.
+  MonoTime start = MonoTime::Now();
   TableLoader table_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
                         "Failed while visiting tables in sys catalog");
+  MonoTime tables_loaded = MonoTime::Now();
+  METRIC_sys_catalog_tables_load_time.Instantiate(master_->metric_entity(), 0)->set_value(
+      (tables_loaded - start).ToMilliseconds());
+
   TabletLoader tablet_loader(this);
   RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
                         "Failed while visiting tablets in sys catalog");
+  METRIC_sys_catalog_tablets_load_time.Instantiate(master_->metric_entity(), 0)->set_value(
+      (MonoTime::Now() - tables_loaded).ToMilliseconds());
   return Status::OK();
 }
 
@@ -1797,6 +1921,51 @@ Status ValidateClientSchema(const optional<string>& name,
   return Status::OK();
 }
 
+// Validate the TTL of a table against its schema.
+Status ValidateTtlConfig(const Schema& schema, const TableExtraConfigPB& extra_config) {
+  if (!extra_config.has_ttl_column()) {
+    if (extra_config.has_ttl_sec()) {
+      return Status::InvalidArgument("a table's TTL requires a TTL column");
+    }
+    return Status::OK();
+  }
+  const int col_idx = schema.find_column(extra_config.ttl_column());
+  if (col_idx == Schema::kColumnNotFound) {
+    return Status::InvalidArgument(Substitute(
+        "TTL column '$0' not found in the table's schema", extra_config.ttl_column()));
+  }
+  const ColumnSchema& col = schema.column(col_idx);
+  if (col.type_info()->type() != UNIXTIME_MICROS || col.is_nullable()) {
+    return Status::InvalidArgument(Substitute(
+        "TTL column '$0' must be a non-nullable UNIXTIME_MICROS column", col.name()));
+  }
+  return Status::OK();
+}
+
+// Validate the clustering of a table against its schema.
+Status ValidateClusteringConfig(const Schema& schema, const TableExtraConfigPB& extra_config) {
+  // Each cluster is written to rowsets of its own, so the number of clusters
+  // bounds the number of rowsets each compaction writes.
+  static constexpr int32_t kMaxClusteringBuckets = 256;
+  if (!extra_config.has_clustering_column()) {
+    if (extra_config.has_clustering_buckets()) {
+      return Status::InvalidArgument("a table's clustering buckets require a clustering column");
+    }
+    return Status::OK();
+  }
+  if (schema.find_column(extra_config.clustering_column()) == Schema::kColumnNotFound) {
+    return Status::InvalidArgument(Substitute(
+        "clustering column '$0' not found in the table's schema",
+        extra_config.clustering_column()));
+  }
+  if (extra_config.has_clustering_buckets() &&
+      extra_config.clustering_buckets() > kMaxClusteringBuckets) {
+    return Status::InvalidArgument(Substitute(
+        "a table may have at most $0 clustering buckets", kMaxClusteringBuckets));
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 // Create a new table.
@@ -1970,6 +2139,10 @@ Status CatalogManager::CreateTable(const CreateTableRequestPB* orig_req,
   // Verify the table's extra configuration properties.
   TableExtraConfigPB extra_config_pb;
   RETURN_NOT_OK(ExtraConfigPBFromPBMap(req.extra_configs(), &extra_config_pb));
+  RETURN_NOT_OK(SetupError(ValidateTtlConfig(schema, extra_config_pb),
+                           resp, MasterErrorPB::INVALID_SCHEMA));
+  RETURN_NOT_OK(SetupError(ValidateClusteringConfig(schema, extra_config_pb),
+                           resp, MasterErrorPB::INVALID_SCHEMA));
 
   scoped_refptr<TableInfo> table;
   {
@@ -2403,11 +2576,11 @@ Status CatalogManager::DeleteTableRpc(const DeleteTableRequestPB& req,
 
 Status CatalogManager::DeleteTableHms(const string& table_name,
                                       const string& table_id,
-                                      int64_t notification_log_event_id) {
+                                      optional<int64_t> notification_log_event_id) {
   LOG(INFO) << "Deleting table " << table_name
             << " [id=" << table_id
-            << "] in response to Hive Metastore notification log event "
-            << notification_log_event_id;
+            << "] in response to Hive Metastore notification log event"
+            << (notification_log_event_id ? Substitute(" $0", *notification_log_event_id) : "");
 
   DeleteTableRequestPB req;
   DeleteTableResponsePB resp;
@@ -2420,8 +2593,10 @@ Status CatalogManager::DeleteTableHms(const string& table_name,
   RETURN_NOT_OK(DeleteTable(req, &resp, notification_log_event_id, /*user=*/none));
 
   // Update the cached HMS notification log event ID, if it changed.
-  DCHECK_GT(notification_log_event_id, hms_notification_log_event_id_);
-  hms_notification_log_event_id_ = notification_log_event_id;
+  if (notification_log_event_id) {
+    DCHECK_GT(*notification_log_event_id, hms_notification_log_event_id_);
+    hms_notification_log_event_id_ = *notification_log_event_id;
+  }
 
   return Status::OK();
 }
@@ -2951,7 +3126,7 @@ Status CatalogManager::AlterTableHms(const string& table_id,
                                      const optional<string>& new_table_name,
                                      const optional<string>& new_table_owner,
                                      const optional<string>& new_table_comment,
-                                     int64_t notification_log_event_id) {
+                                     optional<int64_t> notification_log_event_id) {
   AlterTableRequestPB req;
   AlterTableResponsePB resp;
   req.mutable_table()->set_table_id(table_id);
@@ -2972,8 +3147,10 @@ Status CatalogManager::AlterTableHms(const string& table_id,
   RETURN_NOT_OK(AlterTable(req, &resp, notification_log_event_id, /*user=*/none));
 
   // Update the cached HMS notification log event ID.
-  DCHECK_GT(notification_log_event_id, hms_notification_log_event_id_);
-  hms_notification_log_event_id_ = notification_log_event_id;
+  if (notification_log_event_id) {
+    DCHECK_GT(*notification_log_event_id, hms_notification_log_event_id_);
+    hms_notification_log_event_id_ = *notification_log_event_id;
+  }
 
   return Status::OK();
 }
@@ -3234,6 +3411,13 @@ Status CatalogManager::AlterTable(const AlterTableRequestPB& req,
     RETURN_NOT_OK(ExtraConfigPBFromPBMap(new_extra_configs,
                                          l.mutable_data()->pb.mutable_extra_config()));
   }
+  // The TTL column may not be dropped, renamed or altered while the TTL is set,
+  // nor may the clustering column be dropped or renamed.
+  RETURN_NOT_OK(SetupError(ValidateTtlConfig(new_schema, l.mutable_data()->pb.extra_config()),
+                           resp, MasterErrorPB::INVALID_SCHEMA));
+  RETURN_NOT_OK(SetupError(ValidateClusteringConfig(new_schema,
+                                                    l.mutable_data()->pb.extra_config()),
+                           resp, MasterErrorPB::INVALID_SCHEMA));
 
   // Set to true if columns are altered, added or dropped.
   bool has_schema_changes = !alter_schema_steps.empty();
@@ -3627,6 +3811,29 @@ Status CatalogManager::GetTableStatistics(const GetTableStatisticsRequestPB* req
       resp->set_live_row_count(table->GetMetrics()->live_row_count->value());
     }
   }
+  if (req->include_column_stats()) {
+    std::unordered_map<int32_t, ColumnStatisticsPB> stats_by_col_id;
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (const auto& tablet : tablets) {
+      const ReportedTabletStatsPB tablet_stats = tablet->GetStats();
+      for (const ColumnStatisticsPB& col_stats : tablet_stats.column_stats()) {
+        ColumnStatisticsPB* stats = &stats_by_col_id[col_stats.column_id()];
+        stats->set_column_id(col_stats.column_id());
+        MergeColumnStatistics(col_stats, stats);
+      }
+    }
+    for (const ColumnSchemaPB& col : l.data().pb.schema().columns()) {
+      ColumnStatisticsPB* stats = FindOrNull(stats_by_col_id, col.id());
+      if (!stats) {
+        continue;
+      }
+      auto* entry = resp->add_column_stats();
+      entry->set_column_name(col.name());
+      entry->set_num_distinct_values(EstimateDistinctValues(*stats));
+      *entry->mutable_stats() = std::move(*stats);
+    }
+  }
   if (FLAGS_enable_table_write_limit) {
     if (l.data().pb.has_table_disk_size_limit()) {
       resp->set_disk_size_limit(l.data().pb.table_disk_size_limit());
@@ -4473,11 +4680,14 @@ bool AsyncChangeConfigTask::CheckOpIdIndex() {
 
 class AsyncAddReplicaTask : public AsyncChangeConfigTask {
  public:
+  // If 'read_replica' is true, the replica added is a read replica, which
+  // must be a NON_VOTER.
   AsyncAddReplicaTask(Master* master,
                       scoped_refptr<TabletInfo> tablet,
                       ConsensusStatePB cstate,
                       RaftPeerPB::MemberType member_type,
-                      ThreadSafeRandom* rng);
+                      ThreadSafeRandom* rng,
+                      bool read_replica = false);
 
   string type_name() const override;
 
@@ -4486,6 +4696,7 @@ class AsyncAddReplicaTask : public AsyncChangeConfigTask {
 
  private:
   const RaftPeerPB::MemberType member_type_;
+  const bool read_replica_;
 
   // Used to make random choices in replica selection.
   ThreadSafeRandom* rng_;
@@ -4495,17 +4706,21 @@ AsyncAddReplicaTask::AsyncAddReplicaTask(Master* master,
                                          scoped_refptr<TabletInfo> tablet,
                                          ConsensusStatePB cstate,
                                          RaftPeerPB::MemberType member_type,
-                                         ThreadSafeRandom* rng)
+                                         ThreadSafeRandom* rng,
+                                         bool read_replica)
     : AsyncChangeConfigTask(master, std::move(tablet), std::move(cstate),
                             consensus::ADD_PEER),
       member_type_(member_type),
+      read_replica_(read_replica),
       rng_(rng) {
+  DCHECK(!read_replica_ || member_type_ == RaftPeerPB::NON_VOTER);
 }
 
 string AsyncAddReplicaTask::type_name() const {
-  return Substitute("ChangeConfig:$0:$1",
+  return Substitute("ChangeConfig:$0:$1$2",
                     consensus::ChangeConfigType_Name(change_config_type_),
-                    RaftPeerPB::MemberType_Name(member_type_));
+                    RaftPeerPB::MemberType_Name(member_type_),
+                    read_replica_ ? ":READ_REPLICA" : "");
 }
 
 bool AsyncAddReplicaTask::SendRequest(int attempt) {
@@ -4518,14 +4733,21 @@ bool AsyncAddReplicaTask::SendRequest(int attempt) {
   shared_ptr<TSDescriptor> extra_replica;
   {
     // Select the replica we wish to add to the config.
-    // Do not include current members of the config.
+    // Do not include current members of the config. The read replicas are
+    // placed separately from the other replicas, so that they neither skew the
+    // placement of the voters nor cluster where the voters are.
     const auto& config = cstate_.committed_config();
     TSDescriptorVector existing;
+    TSDescriptorVector others;
     for (auto i = 0; i < config.peers_size(); ++i) {
       shared_ptr<TSDescriptor> desc;
       if (master_->ts_manager()->LookupTSByUUID(config.peers(i).permanent_uuid(),
                                                 &desc)) {
-        existing.emplace_back(std::move(desc));
+        if (config.peers(i).attrs().read_replica() == read_replica_) {
+          existing.emplace_back(std::move(desc));
+        } else {
+          others.emplace_back(std::move(desc));
+        }
       }
     }
 
@@ -4550,7 +4772,7 @@ bool AsyncAddReplicaTask::SendRequest(int attempt) {
     // to host the extra replica is 'ts_descs' after blacklisting all elements
     // common with 'existing'.
     PlacementPolicy policy(std::move(ts_descs), rng_);
-    s = policy.PlaceExtraTabletReplica(std::move(existing), dimension, &extra_replica);
+    s = policy.PlaceExtraTabletReplica(std::move(existing), others, dimension, &extra_replica);
   }
   if (PREDICT_FALSE(!s.ok())) {
     auto msg = Substitute("no extra replica candidate found for tablet $0: $1",
@@ -4591,8 +4813,10 @@ bool AsyncAddReplicaTask::SendRequest(int attempt) {
   req.set_cas_config_opid_index(cstate_.committed_config().opid_index());
   RaftPeerPB* peer = req.mutable_server();
   peer->set_permanent_uuid(extra_replica->permanent_uuid());
-  if (FLAGS_raft_prepare_replacement_before_eviction &&
-      member_type_ == RaftPeerPB::NON_VOTER) {
+  if (read_replica_) {
+    peer->mutable_attrs()->set_read_replica(true);
+  } else if (FLAGS_raft_prepare_replacement_before_eviction &&
+             member_type_ == RaftPeerPB::NON_VOTER) {
     peer->mutable_attrs()->set_promote(true);
   }
   ServerRegistrationPB peer_reg;
@@ -4820,6 +5044,8 @@ Status CatalogManager::ProcessTabletReport(
     }
 
     const auto replication_factor = table->metadata().state().pb.num_replicas();
+    const auto num_read_replicas =
+        table->metadata().state().pb.extra_config().num_read_replicas();
     bool consensus_state_updated = false;
     // 7. Process the report's consensus state. There may be one even when the
     // replica has been tombstoned.
@@ -4956,13 +5182,17 @@ Status CatalogManager::ProcessTabletReport(
       // health, we ignore reports from non-leaders in this case. Also, making
       // the changes recommended by Should{Add,Evict}Replica() assumes that the
       // leader replica has already committed the configuration it's working with.
+      //
+      // The read replicas of the table are only maintained in this mode, and
+      // only once its voters are: they don't need replacing as urgently.
       } else if (!cstate.has_pending_config() &&
                  !cstate.leader_uuid().empty() &&
                  cstate.leader_uuid() == ts_desc->permanent_uuid()) {
         const auto& config = cstate.committed_config();
         string to_evict;
         if (PREDICT_TRUE(FLAGS_catalog_manager_evict_excess_replicas) &&
-            ShouldEvictReplica(config, cstate.leader_uuid(), replication_factor, &to_evict)) {
+            ShouldEvictReplica(config, cstate.leader_uuid(), replication_factor, &to_evict,
+                               num_read_replicas)) {
           DCHECK(!to_evict.empty());
           rpcs.emplace_back(new AsyncEvictReplicaTask(
               master_, tablet, cstate, std::move(to_evict)));
@@ -4971,6 +5201,11 @@ Status CatalogManager::ProcessTabletReport(
                                     uuids_ignored_for_underreplication)) {
           rpcs.emplace_back(new AsyncAddReplicaTask(
               master_, tablet, cstate, RaftPeerPB::NON_VOTER, &rng_));
+        } else if (FLAGS_master_add_server_when_underreplicated &&
+                   ShouldAddReadReplica(config, num_read_replicas)) {
+          rpcs.emplace_back(new AsyncAddReplicaTask(
+              master_, tablet, cstate, RaftPeerPB::NON_VOTER, &rng_,
+              /*read_replica=*/true));
         }
       }
     }
@@ -5193,8 +5428,15 @@ void CatalogManager::SendDeleteTabletRequest(const scoped_refptr<TabletInfo>& ta
 
 void CatalogManager::ExtractTabletsToProcess(
     vector<scoped_refptr<TabletInfo>>* tablets_to_process) {
-
-  shared_lock<LockType> l(lock_);
+  // The tables are looked at without holding lock_: this runs every time the
+  // background task thread wakes up, and going through every table and tablet
+  // with lock_ held would stall the DDL operations (and so the lookups queued
+  // behind them) in the meantime.
+  vector<scoped_refptr<TableInfo>> tables;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(table_ids_map_, &tables);
+  }
 
   // TODO: At the moment we loop through all the tablets
   //       we can keep a set of tablets waiting for "assignment"
@@ -5203,8 +5445,7 @@ void CatalogManager::ExtractTabletsToProcess(
 
   // 'tablets_to_process' elements must be partially ordered in the same way as
   // table->GetAllTablets(); see the locking rules at the top of the file.
-  for (const auto& table_entry : table_ids_map_) {
-    scoped_refptr<TableInfo> table = table_entry.second;
+  for (const auto& table : tables) {
     TableMetadataLock table_lock(table.get(), LockMode::READ);
     if (table_lock.data().is_deleted()) {
       continue;
@@ -5226,16 +5467,22 @@ void CatalogManager::ExtractTabletsToProcess(
 void CatalogManager::ExtractDeletedTablesAndTablets(
     vector<scoped_refptr<TableInfo>>* deleted_tables,
     vector<scoped_refptr<TabletInfo>>* deleted_tablets) {
-  shared_lock<LockType> l(lock_);
-  for (const auto& table_entry : table_ids_map_) {
-    scoped_refptr<TableInfo> table = table_entry.second;
+  // As in ExtractTabletsToProcess(), lock_ is only held to take a snapshot of
+  // the maps.
+  vector<scoped_refptr<TableInfo>> tables;
+  vector<scoped_refptr<TabletInfo>> tablets;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(table_ids_map_, &tables);
+    AppendValuesFromMap(tablet_map_, &tablets);
+  }
+  for (const auto& table : tables) {
     TableMetadataLock table_lock(table.get(), LockMode::READ);
     if (table_lock.data().is_deleted()) {
       deleted_tables->emplace_back(table);
     }
   }
-  for (const auto& tablet_entry : tablet_map_) {
-    scoped_refptr<TabletInfo> tablet = tablet_entry.second;
+  for (const auto& tablet : tablets) {
     TableMetadataLock table_lock(tablet->table().get(), LockMode::READ);
     TabletMetadataLock tablet_lock(tablet.get(), LockMode::READ);
     if (tablet_lock.data().is_deleted() || table_lock.data().is_deleted()) {
@@ -5244,6 +5491,79 @@ void CatalogManager::ExtractDeletedTablesAndTablets(
   }
 }
 
+void CatalogManager::LogSplitCandidatesIfNecessary(MonoTime* last_run) {
+  const MonoTime now = MonoTime::Now();
+  if (last_run->Initialized() &&
+      now - *last_run < MonoDelta::FromSeconds(
+          FLAGS_tablet_split_candidate_check_interval_secs)) {
+    return;
+  }
+  *last_run = now;
+
+  vector<scoped_refptr<TableInfo>> tables;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(table_ids_map_, &tables);
+  }
+  const int64_t min_size = FLAGS_tablet_split_candidate_min_size_mb * 1024 * 1024;
+  for (const auto& table : tables) {
+    {
+      TableMetadataLock table_lock(table.get(), LockMode::READ);
+      if (!table_lock.data().is_running()) {
+        continue;
+      }
+    }
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (const auto& candidate : FindSplitCandidates(
+             tablets, min_size, FLAGS_tablet_split_candidate_size_ratio)) {
+      LOG(INFO) << Substitute(
+          "Tablet $0 ($1 on disk) is a candidate for re-partitioning: it is much "
+          "larger than the other tablets of its table",
+          candidate->ToString(),
+          HumanReadableNumBytes::ToString(candidate->GetStats().on_disk_size()));
+    }
+  }
+}
+
+vector<scoped_refptr<TabletInfo>> CatalogManager::FindSplitCandidates(
+    const vector<scoped_refptr<TabletInfo>>& tablets, int64_t min_size, double ratio) {
+  vector<pair<int64_t, scoped_refptr<TabletInfo>>> sizes;
+  for (const auto& tablet : tablets) {
+    // Only the leader replica reports the stats, so a tablet without a leader
+    // has none.
+    const auto stats = tablet->GetStats();
+    if (stats.has_on_disk_size()) {
+      sizes.emplace_back(stats.on_disk_size(), tablet);
+    }
+  }
+  std::sort(sizes.begin(), sizes.end(),
+            [](const pair<int64_t, scoped_refptr<TabletInfo>>& a,
+               const pair<int64_t, scoped_refptr<TabletInfo>>& b) {
+              return a.first < b.first;
+            });
+
+  vector<scoped_refptr<TabletInfo>> candidates;
+  const size_t n = sizes.size();
+  for (size_t i = 0; i < n; i++) {
+    const int64_t size = sizes[i].first;
+    if (size < min_size) {
+      continue;
+    }
+    // The (lower) median of the sizes of the other tablets: the median's index
+    // among them is shifted by one past the tablet itself.
+    if (n > 1) {
+      const size_t m = (n - 2) / 2;
+      const int64_t median = sizes[m < i ? m : m + 1].first;
+      if (size < ratio * median) {
+        continue;
+      }
+    }
+    candidates.emplace_back(sizes[i].second);
+  }
+  return candidates;
+}
+
 // Check if it's time to roll TokenSigner's key. There's a bit of subtlety here:
 // we shouldn't start exporting a key until it is properly persisted.
 // So, the protocol is:
@@ -6391,6 +6711,16 @@ bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrResp
   return false;
 }
 
+template<typename RespClass>
+bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeLookupsOrRespond(
+    RespClass* resp, RpcContext* rpc) {
+  if (PREDICT_TRUE(first_failed_status().ok()) ||
+      (catalog_status_.ok() && owns_lock() && catalog_->CanServeLookupsAsFollowerUnlocked())) {
+    return true;
+  }
+  return CheckIsInitializedAndIsLeaderOrRespond(resp, rpc);
+}
+
 // Explicit specialization for callers outside this compilation unit.
 #define INITTED_OR_RESPOND(RespClass) \
   template bool \
@@ -6420,6 +6750,13 @@ INITTED_AND_LEADER_OR_RESPOND(GetTabletLocationsResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(RemoveMasterResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(ReplaceTabletResponsePB);
 
+template bool
+CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeLookupsOrRespond(
+    GetTableLocationsResponsePB* resp, RpcContext* rpc);
+template bool
+CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeLookupsOrRespond(
+    GetTabletLocationsResponsePB* resp, RpcContext* rpc);
+
 #undef INITTED_OR_RESPOND
 #undef INITTED_AND_LEADER_OR_RESPOND
 
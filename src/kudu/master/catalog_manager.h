@@ -50,6 +50,7 @@
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/cow_object.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
@@ -560,6 +561,12 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
     template<typename RespClass>
     bool CheckIsInitializedAndIsLeaderOrRespond(RespClass* resp, rpc::RpcContext* rpc);
 
+    // Like CheckIsInitializedAndIsLeaderOrRespond(), but also lets through a
+    // follower with a recent enough copy of the catalog to serve tablet
+    // location lookups from (see --master_follower_serve_lookups).
+    template<typename RespClass>
+    bool CheckIsInitializedAndCanServeLookupsOrRespond(RespClass* resp, rpc::RpcContext* rpc);
+
    private:
     CatalogManager* catalog_;
     shared_lock<RWMutex> leader_shared_lock_;
@@ -623,10 +630,12 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                         rpc::RpcContext* rpc) WARN_UNUSED_RESULT;
 
   // Delete the specified table in response to a 'DROP TABLE' HMS notification
-  // log listener event.
+  // log listener event. If 'notification_log_event_id' is not provided, it's
+  // up to the caller to record the event as handled, e.g. when several events
+  // are applied concurrently.
   Status DeleteTableHms(const std::string& table_name,
                         const std::string& table_id,
-                        int64_t notification_log_event_id) WARN_UNUSED_RESULT;
+                        boost::optional<int64_t> notification_log_event_id) WARN_UNUSED_RESULT;
 
   // Alter the specified table in response to an AlterTableRequest RPC.
   //
@@ -637,13 +646,14 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                        rpc::RpcContext* rpc);
 
   // Alter the specified table in response to an 'ALTER TABLE' HMS
-  // notification log listener event.
+  // notification log listener event. See DeleteTableHms() regarding
+  // 'notification_log_event_id'.
   Status AlterTableHms(const std::string& table_id,
                         const std::string& table_name,
                         const boost::optional<std::string>& new_table_name,
                         const boost::optional<std::string>& new_table_owner,
                         const boost::optional<std::string>& new_table_comment,
-                        int64_t notification_log_event_id) WARN_UNUSED_RESULT;
+                        boost::optional<int64_t> notification_log_event_id) WARN_UNUSED_RESULT;
 
   // Get the information about an in-progress alter operation. If 'user' is
   // provided, checks that the user is authorized to get such information.
@@ -831,6 +841,12 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // name is returned.
   static std::string NormalizeTableName(const std::string& table_name);
 
+  // Returns the tablets among 'tablets' that are at least 'min_size' bytes on
+  // disk, and at least 'ratio' times the median on-disk size of the others.
+  // Tablets without reported stats are ignored.
+  static std::vector<scoped_refptr<TabletInfo>> FindSplitCandidates(
+      const std::vector<scoped_refptr<TabletInfo>>& tablets, int64_t min_size, double ratio);
+
   enum ChangeConfigOp {
     kAddMaster,
     kRemoveMaster
@@ -921,6 +937,16 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Currently, it's about having a means to authenticate clients by authn tokens.
   Status PrepareFollower(MonoTime* last_tspk_run);
 
+  // Reloads the table and tablet metadata into memory from the follower's
+  // replica of the system table, if it's time to, so that the follower can
+  // serve tablet location lookups. Takes 'leader_lock_' for writing.
+  Status RefreshFollowerCatalogIfNecessary();
+
+  // Whether this master, as a follower, can serve tablet location lookups
+  // from its copy of the table and tablet metadata. Must hold 'leader_lock_'
+  // for reading.
+  bool CanServeLookupsAsFollowerUnlocked() const;
+
   // Load the cluster ID for the follower catalog manager.
   Status PrepareFollowerClusterId();
 
@@ -1045,6 +1071,10 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
                                    scoped_refptr<TableInfo>* table_info,
                                    TableMetadataLock* table_lock) WARN_UNUSED_RESULT;
 
+  // Logs the tablets that are candidates for re-partitioning, if it's been
+  // --tablet_split_candidate_check_interval_secs since 'last_run'.
+  void LogSplitCandidatesIfNecessary(MonoTime* last_run);
+
   // Extract the set of tablets that must be processed because not running yet.
   void ExtractTabletsToProcess(std::vector<scoped_refptr<TabletInfo>>* tablets_to_process);
 
@@ -1185,6 +1215,7 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // Lock protecting the various maps and sets below.
   typedef rw_spinlock LockType;
   mutable LockType lock_;
+  ScopedLockSiteRegistration lock_site_{&lock_, LockSite::kCatalogManager};
 
   // Table maps: table-id -> TableInfo and normalized-table-name -> TableInfo
   TableInfoMap table_ids_map_;
@@ -1252,6 +1283,11 @@ class CatalogManager : public tserver::TabletReplicaLookupIf {
   // correctly.
   int64_t leader_ready_term_;
 
+  // When a follower last started loading the table and tablet metadata into
+  // memory, if it successfully did. Written with 'leader_lock_' held for
+  // writing by the background task thread.
+  MonoTime follower_catalog_load_time_;
+
   // This field is updated when a node becomes leader master, and the HMS
   // integration is enabled. It caches the latest processed Hive Metastore
   // notification log event ID so that every request does not need to hit the
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <thread>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
@@ -34,6 +36,7 @@ DECLARE_uint32(hive_metastore_notification_log_poll_period_seconds);
 DECLARE_uint32(hive_metastore_notification_log_poll_inject_latency_ms);
 
 using std::string;
+using std::vector;
 
 namespace kudu {
 namespace master {
@@ -42,9 +45,32 @@ class HmsNotificationLogListenerTest : public KuduTest {
  public:
   uint32_t poll_period_ = FLAGS_hive_metastore_notification_log_poll_period_seconds;
 
+  typedef HmsNotificationLogListenerTask::TableUpdate TableUpdate;
+
   static Status DecodeGzipMessage(const string& encoded, string* decoded) {
     return HmsNotificationLogListenerTask::DecodeGzipMessage(encoded, decoded);
   }
+
+  // Adds the rename of table 'table_id' from 'table_name' to 'new_table_name',
+  // or its deletion if 'new_table_name' is empty, to 'updates'.
+  static void AddUpdate(int64_t event_id, const string& table_id, const string& table_name,
+                        const string& new_table_name, vector<TableUpdate>* updates) {
+    TableUpdate update;
+    update.type = new_table_name.empty() ? TableUpdate::DROP : TableUpdate::ALTER;
+    update.event_id = event_id;
+    update.table_id = table_id;
+    update.table_name = table_name;
+    if (!new_table_name.empty()) {
+      update.new_table_name = new_table_name;
+    }
+    HmsNotificationLogListenerTask::AddUpdate(std::move(update), updates);
+  }
+
+  static void PartitionUpdates(vector<TableUpdate> updates,
+                               int max_wave_size,
+                               vector<vector<TableUpdate>>* waves) {
+    HmsNotificationLogListenerTask::PartitionUpdates(std::move(updates), max_wave_size, waves);
+  }
 };
 
 // Test that an immediate shutdown will short-circuit the poll period.
@@ -108,6 +134,43 @@ TEST_F(HmsNotificationLogListenerTest, TestWaitAndShutdown) {
   waiter.join();
 }
 
+// Test that consecutive alterations of a table are coalesced, and that only
+// the changes to unrelated tables are grouped in the same wave.
+TEST_F(HmsNotificationLogListenerTest, TestCoalesceAndPartitionUpdates) {
+  vector<TableUpdate> updates;
+  AddUpdate(1, "id1", "db.a", "db.b", &updates);
+  AddUpdate(2, "id1", "db.b", "db.c", &updates);
+  AddUpdate(3, "id2", "db.x", "db.y", &updates);
+  // Renaming back and forth cancels out.
+  AddUpdate(4, "id3", "db.m", "db.n", &updates);
+  AddUpdate(5, "id3", "db.n", "db.m", &updates);
+  // Takes the name 'id1' had before its renames.
+  AddUpdate(6, "id4", "db.p", "db.a", &updates);
+  // A deletion isn't merged with the renames preceding it.
+  AddUpdate(7, "id2", "db.y", "", &updates);
+  ASSERT_EQ(4, updates.size());
+  ASSERT_EQ(2, updates[0].event_id);
+  ASSERT_EQ("db.a", updates[0].table_name);
+  ASSERT_EQ("db.c", *updates[0].new_table_name);
+  ASSERT_EQ(3, updates[1].event_id);
+  ASSERT_EQ(6, updates[2].event_id);
+  ASSERT_EQ(7, updates[3].event_id);
+  ASSERT_EQ(TableUpdate::DROP, updates[3].type);
+
+  // 'id4' takes the old name of 'id1', and 'id2' is altered then deleted.
+  vector<vector<TableUpdate>> waves;
+  PartitionUpdates(updates, 10, &waves);
+  ASSERT_EQ(2, waves.size());
+  ASSERT_EQ(2, waves[0].size());
+  ASSERT_EQ(2, waves[1].size());
+  ASSERT_EQ(6, waves[1][0].event_id);
+  ASSERT_EQ(7, waves[1][1].event_id);
+
+  // The waves are no larger than requested.
+  PartitionUpdates(updates, 1, &waves);
+  ASSERT_EQ(4, waves.size());
+}
+
 TEST_F(HmsNotificationLogListenerTest, TestGzipEventDecoding) {
   // A message encoded via the following Hive code:
   //    JSONDropTableMessage message =
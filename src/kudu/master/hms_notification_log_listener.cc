@@ -17,12 +17,14 @@
 
 #include "kudu/master/hms_notification_log_listener.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <map>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -45,6 +47,7 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/status_callback.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/url-coding.h"
 #include "kudu/util/zlib.h"
 
@@ -60,6 +63,15 @@ DEFINE_int32(hive_metastore_notification_log_batch_size, 100,
 TAG_FLAG(hive_metastore_notification_log_batch_size, advanced);
 TAG_FLAG(hive_metastore_notification_log_batch_size, runtime);
 
+DEFINE_int32(hive_metastore_notification_log_apply_threads, 4,
+             "Maximum number of threads with which the notification log listener "
+             "concurrently applies the changes of a batch of notification log events "
+             "to unrelated tables. With 1, the changes are applied one at a time.");
+TAG_FLAG(hive_metastore_notification_log_apply_threads, advanced);
+TAG_FLAG(hive_metastore_notification_log_apply_threads, experimental);
+DEFINE_validator(hive_metastore_notification_log_apply_threads,
+                 [](const char* /*n*/, int32_t v) { return v > 0; });
+
 DEFINE_uint32(hive_metastore_notification_log_poll_inject_latency_ms, 0,
               "Inject latency into the inner polling loop of the Hive Metastore "
               "notification log listener. Only takes effect during unit tests.");
@@ -67,10 +79,12 @@ TAG_FLAG(hive_metastore_notification_log_poll_inject_latency_ms, hidden);
 TAG_FLAG(hive_metastore_notification_log_poll_inject_latency_ms, unsafe);
 TAG_FLAG(hive_metastore_notification_log_poll_inject_latency_ms, runtime);
 
+using boost::none;
 using boost::optional;
 using rapidjson::Document;
 using rapidjson::Value;
 using std::string;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -95,6 +109,10 @@ HmsNotificationLogListenerTask::~HmsNotificationLogListenerTask() {
 
 Status HmsNotificationLogListenerTask::Init() {
   CHECK(!thread_) << "HmsNotificationLogListenerTask is already initialized";
+  RETURN_NOT_OK(ThreadPoolBuilder("hms-notification-log-apply")
+                .set_min_threads(0)
+                .set_max_threads(FLAGS_hive_metastore_notification_log_apply_threads)
+                .Build(&apply_pool_));
   return kudu::Thread::Create("catalog manager", "hms-notification-log-listener",
                               [this]() { this->RunLoop(); }, &thread_);
 }
@@ -109,6 +127,7 @@ void HmsNotificationLogListenerTask::Shutdown() {
   }
   CHECK_OK(ThreadJoiner(thread_.get()).Join());
   thread_.reset();
+  apply_pool_->Shutdown();
 }
 
 Status HmsNotificationLogListenerTask::WaitForCatchUp(const MonoTime& deadline) {
@@ -214,6 +233,7 @@ Status HmsNotificationLogListenerTask::Poll() {
 
   // Cache the batch size, since it's a runtime flag.
   int32_t batch_size = FLAGS_hive_metastore_notification_log_batch_size;
+  const int max_wave_size = FLAGS_hive_metastore_notification_log_apply_threads;
 
   // Retrieve the last processed event ID from the catalog manager. The latest
   // event ID is requested for every call to Poll() because leadership may have
@@ -223,8 +243,11 @@ Status HmsNotificationLogListenerTask::Poll() {
   // Also keep track of the latest event ID which has been processed locally.
   int64_t processed_event_id = durable_event_id;
   vector<hive::NotificationEvent> events;
+  vector<TableUpdate> updates;
+  vector<vector<TableUpdate>> waves;
   while (true) {
     events.clear();
+    updates.clear();
 
     {
       std::lock_guard<Mutex> l(lock_);
@@ -253,9 +276,9 @@ Status HmsNotificationLogListenerTask::Poll() {
 
       Status s;
       if (event.eventType == "ALTER_TABLE") {
-        s = HandleAlterTableEvent(event, &durable_event_id);
+        s = ParseAlterTableEvent(event, &updates);
       } else if (event.eventType == "DROP_TABLE") {
-        s = HandleDropTableEvent(event, &durable_event_id);
+        s = ParseDropTableEvent(event, &updates);
       }
 
       // Failing to properly handle a notification is not a fatal error, instead
@@ -277,14 +300,31 @@ Status HmsNotificationLogListenerTask::Poll() {
       WARN_NOT_OK(s, Substitute("Failed to handle Hive Metastore notification: $0",
                                  EventDebugString(event)));
 
+      processed_event_id = event.eventId;
+    }
+
+    bool needs_event_id_store = false;
+    PartitionUpdates(std::move(updates), max_wave_size, &waves);
+    for (const auto& wave : waves) {
+      ApplyWave(wave, &durable_event_id, &needs_event_id_store);
+
       // Short-circuit when leadership is lost to prevent applying notification
       // events out of order.
       if (l.has_term_changed()) {
         return Status::ServiceUnavailable(
-            "lost leadership while handling Hive Metastore notification log events", s.message());
+            "lost leadership while handling Hive Metastore notification log events");
       }
+    }
 
-      processed_event_id = event.eventId;
+    // The changes applied concurrently didn't record their event IDs, so
+    // record the whole batch as handled to bound the events to replay if
+    // leadership changes.
+    if (needs_event_id_store && durable_event_id < processed_event_id) {
+      Status s = catalog_manager_->StoreLatestNotificationLogEventId(processed_event_id);
+      WARN_NOT_OK(s, "failed to record latest processed Hive Metastore notification log ID");
+      if (s.ok()) {
+        durable_event_id = processed_event_id;
+      }
     }
 
     // If the last set of events was smaller than the batch size then we can
@@ -307,8 +347,8 @@ Status HmsNotificationLogListenerTask::Poll() {
   return Status::OK();
 }
 
-Status HmsNotificationLogListenerTask::HandleAlterTableEvent(const hive::NotificationEvent& event,
-                                                             int64_t* durable_event_id) {
+Status HmsNotificationLogListenerTask::ParseAlterTableEvent(const hive::NotificationEvent& event,
+                                                            vector<TableUpdate>* updates) {
   Document message;
   RETURN_NOT_OK(ParseMessage(event, &message));
 
@@ -393,18 +433,20 @@ Status HmsNotificationLogListenerTask::HandleAlterTableEvent(const hive::Notific
     return Status::OK();
   }
 
-  RETURN_NOT_OK(catalog_manager_->AlterTableHms(*table_id,
-                                                before_table_name,
-                                                new_table_name,
-                                                new_table_owner,
-                                                new_table_comment,
-                                                event.eventId));
-  *durable_event_id = event.eventId;
+  TableUpdate update;
+  update.type = TableUpdate::ALTER;
+  update.event_id = event.eventId;
+  update.table_id = *table_id;
+  update.table_name = std::move(before_table_name);
+  update.new_table_name = std::move(new_table_name);
+  update.new_table_owner = std::move(new_table_owner);
+  update.new_table_comment = std::move(new_table_comment);
+  AddUpdate(std::move(update), updates);
   return Status::OK();
 }
 
-Status HmsNotificationLogListenerTask::HandleDropTableEvent(const hive::NotificationEvent& event,
-                                                            int64_t* durable_event_id) {
+Status HmsNotificationLogListenerTask::ParseDropTableEvent(const hive::NotificationEvent& event,
+                                                           vector<TableUpdate>* updates) {
   Document message;
   RETURN_NOT_OK(ParseMessage(event, &message));
 
@@ -441,17 +483,133 @@ Status HmsNotificationLogListenerTask::HandleDropTableEvent(const hive::Notifica
     return Status::IllegalState("missing Kudu table ID");
   }
 
-  // Require the table ID *and* table name from the HMS drop event to match the
-  // Kudu catalog's metadata for the table. Checking the name in addition to the
-  // ID prevents a table from being dropped while the HMS and Kudu catalogs are
-  // unsynchronized. If the catalogs are unsynchronized, it's better to return
-  // an error than liberally delete data.
-  string table_name = Substitute("$0.$1", event.dbName, event.tableName);
-  RETURN_NOT_OK(catalog_manager_->DeleteTableHms(table_name, *table_id, event.eventId));
-  *durable_event_id = event.eventId;
+  TableUpdate update;
+  update.type = TableUpdate::DROP;
+  update.event_id = event.eventId;
+  update.table_id = *table_id;
+  update.table_name = Substitute("$0.$1", event.dbName, event.tableName);
+  AddUpdate(std::move(update), updates);
   return Status::OK();
 }
 
+void HmsNotificationLogListenerTask::AddUpdate(TableUpdate update, vector<TableUpdate>* updates) {
+  if (updates->empty() || update.type != TableUpdate::ALTER ||
+      updates->back().type != TableUpdate::ALTER ||
+      updates->back().table_id != update.table_id) {
+    updates->emplace_back(std::move(update));
+    return;
+  }
+  // Only merge the changes if the table is altered under the name the
+  // previous change gave it; otherwise let each of them fail on its own.
+  TableUpdate* prev = &updates->back();
+  const string& prev_table_name = prev->new_table_name ? *prev->new_table_name
+                                                       : prev->table_name;
+  if (update.table_name != prev_table_name) {
+    updates->emplace_back(std::move(update));
+    return;
+  }
+  VLOG(2) << Substitute("Coalescing alter events $0 and $1 on table $2",
+                        prev->event_id, update.event_id, update.table_id);
+  prev->event_id = update.event_id;
+  if (update.new_table_name) {
+    prev->new_table_name = std::move(update.new_table_name);
+    if (*prev->new_table_name == prev->table_name) {
+      // The table was renamed back to its original name.
+      prev->new_table_name = none;
+    }
+  }
+  if (update.new_table_owner) {
+    prev->new_table_owner = std::move(update.new_table_owner);
+  }
+  if (update.new_table_comment) {
+    prev->new_table_comment = std::move(update.new_table_comment);
+  }
+  if (!prev->new_table_name && !prev->new_table_owner && !prev->new_table_comment) {
+    updates->pop_back();
+  }
+}
+
+void HmsNotificationLogListenerTask::PartitionUpdates(vector<TableUpdate> updates,
+                                                      int max_wave_size,
+                                                      vector<vector<TableUpdate>>* waves) {
+  DCHECK_GT(max_wave_size, 0);
+  waves->clear();
+  // The table IDs and the normalized table names touched by the last wave.
+  unordered_set<string> keys;
+  for (auto& update : updates) {
+    vector<string> update_keys = { update.table_id,
+                                   CatalogManager::NormalizeTableName(update.table_name) };
+    if (update.new_table_name) {
+      update_keys.emplace_back(CatalogManager::NormalizeTableName(*update.new_table_name));
+    }
+    bool conflicts = waves->empty() || waves->back().size() >= max_wave_size;
+    for (const auto& key : update_keys) {
+      conflicts |= ContainsKey(keys, key);
+    }
+    if (conflicts) {
+      waves->emplace_back();
+      keys.clear();
+    }
+    keys.insert(update_keys.begin(), update_keys.end());
+    waves->back().emplace_back(std::move(update));
+  }
+}
+
+Status HmsNotificationLogListenerTask::ApplyUpdate(const TableUpdate& update,
+                                                   optional<int64_t> event_id) {
+  if (update.type == TableUpdate::DROP) {
+    // Require the table ID *and* table name from the HMS drop event to match
+    // the Kudu catalog's metadata for the table. Checking the name in addition
+    // to the ID prevents a table from being dropped while the HMS and Kudu
+    // catalogs are unsynchronized. If the catalogs are unsynchronized, it's
+    // better to return an error than liberally delete data.
+    return catalog_manager_->DeleteTableHms(update.table_name, update.table_id, event_id);
+  }
+  return catalog_manager_->AlterTableHms(update.table_id,
+                                         update.table_name,
+                                         update.new_table_name,
+                                         update.new_table_owner,
+                                         update.new_table_comment,
+                                         event_id);
+}
+
+void HmsNotificationLogListenerTask::ApplyWave(const vector<TableUpdate>& wave,
+                                               int64_t* durable_event_id,
+                                               bool* needs_event_id_store) {
+  const auto warn_if_failed = [](const TableUpdate& update, const Status& s) {
+    WARN_NOT_OK(s, Substitute("Failed to apply Hive Metastore notification $0 to table $1",
+                              update.event_id, update.table_id));
+  };
+  if (wave.size() == 1) {
+    const auto& update = wave.front();
+    Status s = ApplyUpdate(update, update.event_id);
+    warn_if_failed(update, s);
+    if (s.ok()) {
+      *durable_event_id = update.event_id;
+    }
+    return;
+  }
+
+  // Each change is applied under its own leader lock, held by the thread
+  // applying it. Their event IDs are recorded by the caller.
+  vector<Status> results(wave.size());
+  for (size_t i = 0; i < wave.size(); i++) {
+    Status s = apply_pool_->Submit([this, &wave, &results, i]() {
+      CatalogManager::ScopedLeaderSharedLock l(catalog_manager_);
+      results[i] = l.first_failed_status().ok() ? ApplyUpdate(wave[i], none)
+                                                : l.first_failed_status();
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      results[i] = std::move(s);
+    }
+  }
+  apply_pool_->Wait();
+  for (size_t i = 0; i < wave.size(); i++) {
+    warn_if_failed(wave[i], results[i]);
+  }
+  *needs_event_id_store = true;
+}
+
 Status HmsNotificationLogListenerTask::ParseMessage(const hive::NotificationEvent& event,
                                                     Document* message) {
   string format = event.messageFormat;
@@ -18,9 +18,11 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <boost/optional/optional.hpp>
 #include <rapidjson/document.h>
 
 #include "kudu/gutil/port.h"
@@ -38,6 +40,7 @@ namespace kudu {
 
 class MonoTime;
 class Thread;
+class ThreadPool;
 
 namespace master {
 
@@ -78,6 +81,13 @@ class CatalogManager;
 // identified. For other changes made in ALTER TABLE statements, such as ALTER
 // TABLE DROP COLUMN, there is no way to identify with certainty which column
 // has been dropped, since we do not store column IDs in the HMS table entries.
+//
+// The events are retrieved in batches. Consecutive changes to the same table
+// are coalesced, and the changes to unrelated tables are applied to the Kudu
+// catalog concurrently (see --hive_metastore_notification_log_apply_threads),
+// in waves of changes which touch disjoint table IDs and names. Since the
+// changes within a wave are not ordered, their event IDs are recorded in the
+// sys catalog once per batch rather than along with each change.
 class HmsNotificationLogListenerTask {
  public:
 
@@ -106,22 +116,68 @@ class HmsNotificationLogListenerTask {
   // Runs the main loop of the listening thread.
   void RunLoop();
 
+  // A change to the Kudu catalog in response to notification log events.
+  struct TableUpdate {
+    enum Type {
+      ALTER,
+      DROP,
+    };
+    Type type;
+
+    // The ID of the latest event the change is in response to.
+    int64_t event_id;
+
+    std::string table_id;
+
+    // The name of the table before the change.
+    std::string table_name;
+
+    // Only set for ALTER changes.
+    boost::optional<std::string> new_table_name;
+    boost::optional<std::string> new_table_owner;
+    boost::optional<std::string> new_table_comment;
+  };
+
   // Polls the Hive Metastore for notification events, and handle them.
   Status Poll();
 
-  // Handles an ALTER TABLE event. Must only be called on the listening thread.
+  // Parses an ALTER TABLE event. Must only be called on the listening thread.
   //
-  // The event is parsed, and if it is a rename table event for a Kudu table,
-  // the table is renamed in the local catalog.  All other events are ignored.
-  Status HandleAlterTableEvent(const hive::NotificationEvent& event,
-                               int64_t* durable_event_id) WARN_UNUSED_RESULT;
+  // If it is a rename, or a change of owner or comment of a Kudu table, the
+  // change is added to 'updates'. All other events are ignored.
+  Status ParseAlterTableEvent(const hive::NotificationEvent& event,
+                              std::vector<TableUpdate>* updates) WARN_UNUSED_RESULT;
 
-  // Handles a DROP TABLE event. Must only be called on the listening thread.
+  // Parses a DROP TABLE event. Must only be called on the listening thread.
   //
-  // The event is parsed, and if it is a drop table event for a Kudu table, the
-  // table is deleted in the local catalog. All other events are ignored.
-  Status HandleDropTableEvent(const hive::NotificationEvent& event,
-                              int64_t* durable_event_id) WARN_UNUSED_RESULT;
+  // If it is a drop table event for a Kudu table, the deletion of the table is
+  // added to 'updates'. All other events are ignored.
+  Status ParseDropTableEvent(const hive::NotificationEvent& event,
+                             std::vector<TableUpdate>* updates) WARN_UNUSED_RESULT;
+
+  // Appends 'update' to 'updates', merging it into the last change of
+  // 'updates' if both alter the same table.
+  static void AddUpdate(TableUpdate update, std::vector<TableUpdate>* updates);
+
+  // Splits 'updates' into consecutive waves of at most 'max_wave_size'
+  // changes, so that the changes of a wave touch disjoint tables and table
+  // names, and may be applied in any order.
+  static void PartitionUpdates(std::vector<TableUpdate> updates,
+                               int max_wave_size,
+                               std::vector<std::vector<TableUpdate>>* waves);
+
+  // Applies 'update' to the Kudu catalog, recording 'event_id' as handled if
+  // it's provided.
+  Status ApplyUpdate(const TableUpdate& update,
+                     boost::optional<int64_t> event_id) WARN_UNUSED_RESULT;
+
+  // Applies the changes of 'wave', concurrently if there are several of them.
+  // Errors are logged rather than returned, see Poll(). Sets
+  // '*durable_event_id' if the event IDs were recorded with the changes, and
+  // '*needs_event_id_store' otherwise.
+  void ApplyWave(const std::vector<TableUpdate>& wave,
+                 int64_t* durable_event_id,
+                 bool* needs_event_id_store);
 
   // Parses the event message from a notification event. See
   // org.apache.hadoop.hive.metastore.messaging.MessageFactory and
@@ -153,6 +209,9 @@ class HmsNotificationLogListenerTask {
   // The listening thread.
   scoped_refptr<kudu::Thread> thread_;
 
+  // Applies the changes of a wave concurrently.
+  std::unique_ptr<ThreadPool> apply_pool_;
+
   // Protects access to fields below.
   mutable Mutex lock_;
 
@@ -124,6 +124,7 @@ DECLARE_bool(enable_metadata_cleanup_for_deleted_tables_and_tablets);
 DECLARE_bool(enable_per_range_hash_schemas);
 DECLARE_bool(master_client_location_assignment_enabled);
 DECLARE_bool(master_support_authz_tokens);
+DECLARE_bool(master_tablet_report_checkpoints);
 DECLARE_bool(mock_table_metrics_for_testing);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
 DECLARE_double(sys_catalog_fail_during_write);
@@ -135,6 +136,7 @@ DECLARE_int32(flush_threshold_mb);
 DECLARE_int32(flush_threshold_secs);
 DECLARE_int32(flush_upper_bound_ms);
 DECLARE_int32(master_inject_latency_on_tablet_lookups_ms);
+DECLARE_int32(master_tablet_report_checkpoint_interval_secs);
 DECLARE_int32(max_table_comment_length);
 DECLARE_int32(rpc_service_queue_length);
 DECLARE_int64(live_row_count_for_testing);
@@ -764,6 +766,102 @@ TEST_F(MasterTest, TestRegisterAndHeartbeat) {
   }
 }
 
+// Test that a new leader master lets a tablet server resync its tablets from
+// the checkpoint of its tablet reports persisted by the previous leader.
+TEST_F(MasterTest, TestTabletReportCheckpoints) {
+  FLAGS_master_tablet_report_checkpoints = true;
+  FLAGS_master_tablet_report_checkpoint_interval_secs = 0;
+  const char* const kTsUUID = "my-ts-uuid";
+
+  TSToMasterCommonPB common;
+  common.mutable_ts_instance()->set_permanent_uuid(kTsUUID);
+  common.mutable_ts_instance()->set_instance_seqno(1);
+  ServerRegistrationPB fake_reg;
+  MakeHostPortPB("localhost", 1000, fake_reg.add_rpc_addresses());
+  MakeHostPortPB("localhost", 2000, fake_reg.add_http_addresses());
+  fake_reg.set_software_version(VersionInfo::GetVersionInfo());
+  fake_reg.set_start_time(10000);
+  ReplicaManagementInfoPB rmi;
+  rmi.set_replacement_scheme(FLAGS_raft_prepare_replacement_before_eviction
+      ? ReplicaManagementInfoPB::PREPARE_REPLACEMENT_BEFORE_EVICTION
+      : ReplicaManagementInfoPB::EVICT_FIRST);
+
+  int32_t seqno = 0;
+  const auto heartbeat = [&] (bool full, int64_t version, optional<int64_t> resync_since,
+                              bool reg, TSHeartbeatResponsePB* resp) {
+    TSHeartbeatRequestPB req;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    if (reg) {
+      req.mutable_registration()->CopyFrom(fake_reg);
+      req.mutable_replica_management_info()->CopyFrom(rmi);
+    }
+    auto* report = req.mutable_tablet_report();
+    report->set_is_incremental(!full);
+    report->set_sequence_number(seqno++);
+    report->mutable_checkpoint()->set_report_epoch("epoch");
+    report->mutable_checkpoint()->set_version(version);
+    if (resync_since) {
+      report->set_resync_since_version(*resync_since);
+    }
+    return proxy_->TSHeartbeat(req, resp, &rpc);
+  };
+  const auto restart_master = [&] () {
+    mini_master_->Shutdown();
+    RETURN_NOT_OK(mini_master_->Restart());
+    return mini_master_->WaitForCatalogManagerInit();
+  };
+
+  // Register with a full report, then send an incremental one. This master
+  // has a complete view of the tablets, so it doesn't hand out a checkpoint.
+  {
+    TSHeartbeatResponsePB resp;
+    ASSERT_OK(heartbeat(true, 5, none, true, &resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.needs_full_tablet_report());
+    ASSERT_FALSE(resp.has_tablet_report_checkpoint());
+    resp.Clear();
+    ASSERT_OK(heartbeat(false, 7, none, false, &resp));
+    ASSERT_FALSE(resp.needs_full_tablet_report());
+    ASSERT_FALSE(resp.has_tablet_report_checkpoint());
+  }
+
+  // After a restart, the master asks for a full report, along with the
+  // persisted checkpoint to resync from in its place.
+  ASSERT_OK(restart_master());
+  {
+    TSHeartbeatResponsePB resp;
+    ASSERT_OK(heartbeat(false, 8, none, false, &resp));
+    ASSERT_TRUE(resp.needs_reregister());
+    ASSERT_TRUE(resp.needs_full_tablet_report());
+    ASSERT_TRUE(resp.has_tablet_report_checkpoint());
+    ASSERT_EQ("epoch", resp.tablet_report_checkpoint().report_epoch());
+    ASSERT_EQ(7, resp.tablet_report_checkpoint().version());
+
+    // The resync stands for a full report.
+    resp.Clear();
+    ASSERT_OK(heartbeat(false, 9, 7, true, &resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.needs_full_tablet_report());
+    ASSERT_FALSE(resp.has_tablet_report_checkpoint());
+  }
+
+  // A resync which leaves out changes the persisted checkpoint doesn't cover
+  // is rejected, and the master then asks for a real full report.
+  ASSERT_OK(restart_master());
+  {
+    TSHeartbeatResponsePB resp;
+    ASSERT_OK(heartbeat(false, 10, 10, true, &resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.needs_full_tablet_report());
+    ASSERT_FALSE(resp.has_tablet_report_checkpoint());
+    resp.Clear();
+    ASSERT_OK(heartbeat(true, 10, none, false, &resp));
+    ASSERT_FALSE(resp.needs_full_tablet_report());
+    ASSERT_FALSE(resp.has_tablet_report_checkpoint());
+  }
+}
+
 TEST_F(MasterTest, TestCatalog) {
   const char *kTableName = "testtb";
   const char *kOtherTableName = "tbtest";
@@ -45,6 +45,7 @@
 #include "kudu/master/master_cert_authority.h"
 #include "kudu/master/master_path_handlers.h"
 #include "kudu/master/master_service.h"
+#include "kudu/master/quota_tracker.h"
 #include "kudu/master/ts_manager.h"
 #include "kudu/master/txn_manager.h"
 #include "kudu/master/txn_manager_service.h"
@@ -184,6 +185,7 @@ Master::Master(const MasterOptions& opts)
     location_cache_.reset(new LocationCache(location_cmd, metric_entity_.get()));
   }
   ts_manager_.reset(new TSManager(location_cache_.get(), metric_entity_));
+  quota_tracker_.reset(new QuotaTracker(catalog_manager_.get(), ts_manager_.get()));
 }
 
 Master::~Master() {
@@ -59,6 +59,7 @@ namespace master {
 class CatalogManager;
 class MasterCertAuthority;
 class MasterPathHandlers;
+class QuotaTracker;
 class TSManager;
 
 class Master : public kserver::KuduServer {
@@ -99,6 +100,8 @@ class Master : public kserver::KuduServer {
 
   LocationCache* location_cache() { return location_cache_.get(); }
 
+  QuotaTracker* quota_tracker() { return quota_tracker_.get(); }
+
   // Get the RPC and HTTP addresses for this master instance.
   Status GetMasterRegistration(ServerRegistrationPB* registration) const;
 
@@ -205,6 +208,9 @@ class Master : public kserver::KuduServer {
 
   std::unique_ptr<TSManager> ts_manager_;
 
+  // Splits the table and user quotas among the tablet servers.
+  std::unique_ptr<QuotaTracker> quota_tracker_;
+
   DISALLOW_COPY_AND_ASSIGN(Master);
 };
 
@@ -43,6 +43,7 @@
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/master_cert_authority.h"
+#include "kudu/master/quota_tracker.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/master/ts_manager.h"
 #include "kudu/rpc/remote_user.h"
@@ -105,6 +106,16 @@ DEFINE_bool(master_support_ignore_operations, true,
 TAG_FLAG(master_support_ignore_operations, hidden);
 TAG_FLAG(master_support_ignore_operations, runtime);
 
+DEFINE_bool(master_tablet_report_checkpoints, false,
+            "Whether the leader master keeps checkpoints of the tablet servers' "
+            "tablet reports in the system catalog, so that a new leader master "
+            "can have the tablet servers send only the tablets that changed "
+            "since, rather than full tablet reports. The in-memory state the "
+            "master derives from tablet reports, such as tablet statistics, is "
+            "then only filled in as the tablets change.");
+TAG_FLAG(master_tablet_report_checkpoints, experimental);
+TAG_FLAG(master_tablet_report_checkpoints, runtime);
+
 
 using google::protobuf::Message;
 using kudu::consensus::ReplicaManagementInfoPB;
@@ -418,6 +429,11 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
       // Don't bother asking for a full tablet report if we're a follower;
       // it'll just get ignored anyway.
       resp->set_needs_full_tablet_report(is_leader_master);
+      if (is_leader_master && FLAGS_master_tablet_report_checkpoints) {
+        server_->ts_manager()->GetTabletReportCheckpoint(
+            req->common().ts_instance().permanent_uuid(),
+            resp->mutable_tablet_report_checkpoint());
+      }
 
       rpc->RespondSuccess();
       return;
@@ -437,6 +453,9 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
   ts_desc->set_num_live_replicas_by_dimension(
       TabletNumByDimensionMap(req->num_live_tablets_by_dimension().begin(),
                               req->num_live_tablets_by_dimension().end()));
+  if (req->has_data_dirs_capacity_bytes() && req->has_data_dirs_free_bytes()) {
+    ts_desc->set_data_dirs_space(req->data_dirs_capacity_bytes(), req->data_dirs_free_bytes());
+  }
 
   // 5. Only leaders handle tablet reports.
   if (is_leader_master && req->has_tablet_report()) {
@@ -453,6 +472,19 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
     if (!req->tablet_report().is_incremental()) {
       ts_desc->UpdateNeedsFullTabletReport(false);
     }
+    if (FLAGS_master_tablet_report_checkpoints &&
+        req->tablet_report().has_checkpoint()) {
+      bool needs_full_report = false;
+      s = server_->ts_manager()->ProcessTabletReportCheckpoint(
+          ts_desc->permanent_uuid(), req->tablet_report(),
+          server_->catalog_manager()->sys_catalog(), &needs_full_report);
+      // The report itself was processed: not persisting its checkpoint only
+      // means that a new leader master may need a full tablet report.
+      WARN_NOT_OK(s, "failed to process tablet report checkpoint");
+      if (needs_full_report) {
+        resp->set_needs_full_tablet_report(true);
+      }
+    }
   }
 
   // 6. Only leaders sign CSR from tablet servers (if present).
@@ -482,11 +514,27 @@ void MasterServiceImpl::TSHeartbeat(const TSHeartbeatRequestPB* req,
     }
   }
 
-  // 8. Check if we need a full tablet report (e.g. the tablet server just
+  // 8. Only leaders split the quotas among the tablet servers.
+  if (is_leader_master) {
+    const auto& ts_uuid = ts_desc->permanent_uuid();
+    server_->quota_tracker()->RecordUsage(ts_uuid, req->quota_usages());
+    server_->quota_tracker()->GetShares(ts_uuid, resp->mutable_quota_shares());
+  }
+
+  // 9. Check if we need a full tablet report (e.g. the tablet server just
   //    exited maintenance mode and needs to check whether any replicas need to
   //    be moved).
   if (is_leader_master && ts_desc->needs_full_report()) {
     resp->set_needs_full_tablet_report(true);
+  } else if (is_leader_master && FLAGS_master_tablet_report_checkpoints &&
+             !resp->needs_full_tablet_report()) {
+    // Until this master has a complete view of the tserver's tablets, tell it
+    // where it may resync from, should it be about to send a full report.
+    TabletReportCheckpointPB checkpoint;
+    if (server_->ts_manager()->GetTabletReportCheckpoint(ts_desc->permanent_uuid(),
+                                                         &checkpoint)) {
+      resp->mutable_tablet_report_checkpoint()->Swap(&checkpoint);
+    }
   }
 
   rpc->RespondSuccess();
@@ -496,7 +544,7 @@ void MasterServiceImpl::GetTabletLocations(const GetTabletLocationsRequestPB* re
                                            GetTabletLocationsResponsePB* resp,
                                            rpc::RpcContext* rpc) {
   CatalogManager::ScopedLeaderSharedLock l(server_->catalog_manager());
-  if (!l.CheckIsInitializedAndIsLeaderOrRespond(resp, rpc)) {
+  if (!l.CheckIsInitializedAndCanServeLookupsOrRespond(resp, rpc)) {
     return;
   }
 
@@ -632,7 +680,7 @@ void MasterServiceImpl::GetTableLocations(const GetTableLocationsRequestPB* req,
   Status s;
   {
     CatalogManager::ScopedLeaderSharedLock l(server_->catalog_manager());
-    if (!l.CheckIsInitializedAndIsLeaderOrRespond(resp, rpc)) {
+    if (!l.CheckIsInitializedAndCanServeLookupsOrRespond(resp, rpc)) {
       return;
     }
 
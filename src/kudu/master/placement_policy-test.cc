@@ -19,6 +19,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <map>
 #include <memory>
@@ -29,6 +30,7 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -49,6 +51,8 @@ using std::string;
 using std::vector;
 using strings::Substitute;
 
+DECLARE_bool(tablet_placement_consider_disk_space);
+
 namespace kudu {
 namespace master {
 
@@ -570,6 +574,32 @@ TEST_F(PlacementPolicyTest, PlaceExtraTabletReplicaViolatedPolicy) {
   }
 }
 
+// The replicas placed separately, e.g. the voters when placing a read replica,
+// only have their tablet servers excluded.
+TEST_F(PlacementPolicyTest, PlaceExtraTabletReplicaSeparately) {
+  const vector<LocationInfo> cluster_info = {
+    { "A", { { "A_ts0", 0 }, { "A_ts1", 0 }, { "A_ts2", 0 }, } },
+    { "B", { { "B_ts0", 0 }, { "B_ts1", 0 }, } },
+    { "C", { { "C_ts0", 0 }, { "C_ts1", 0 }, } },
+  };
+  ASSERT_OK(Prepare(cluster_info));
+
+  const auto& all = descriptors();
+  PlacementPolicy policy(all, rng());
+  const auto voters = GetDescriptors({ "A_ts0", "B_ts0", "C_ts0", });
+  for (auto i = 0; i < 10; ++i) {
+    const auto existing = GetDescriptors({ "A_ts1", });
+    shared_ptr<TSDescriptor> extra_ts;
+    ASSERT_OK(policy.PlaceExtraTabletReplica(existing, voters, none, &extra_ts));
+    ASSERT_TRUE(extra_ts);
+    // The second read replica goes to another location than the first one,
+    // and to a tablet server hosting no voter.
+    ASSERT_TRUE(extra_ts->permanent_uuid() == "B_ts1" ||
+                extra_ts->permanent_uuid() == "C_ts1")
+        << extra_ts->permanent_uuid();
+  }
+}
+
 // Test for randomness while selecting among locations of the same load.
 TEST_F(PlacementPolicyTest, SelectLocationRandomnessForExtraReplica) {
   const vector<LocationInfo> cluster_info = {
@@ -1026,5 +1056,55 @@ TEST_F(PlacementPolicyTest, PlaceTabletReplicasWithNewTabletServers) {
   }
 }
 
+// Verify that with --tablet_placement_consider_disk_space, replicas are placed
+// in proportion to the free space reported by the tablet servers.
+TEST_F(PlacementPolicyTest, PlaceExtraTabletReplicaConsideringDiskSpace) {
+  const vector<LocationInfo> cluster_info = {
+    {
+      "",
+      {
+        { "ts0", 0 },
+        { "ts1", 10 },
+      }
+    },
+  };
+  google::FlagSaver saver;
+  ASSERT_OK(Prepare(cluster_info));
+  constexpr int64_t kGiB = 1024 * 1024 * 1024;
+  const auto& all = descriptors();
+  all[0]->set_data_dirs_space(2 * kGiB, kGiB);
+  all[1]->set_data_dirs_space(200 * kGiB, 100 * kGiB);
+  PlacementPolicy policy(all, rng());
+
+  // By default, only the number of replicas counts.
+  {
+    shared_ptr<TSDescriptor> extra_ts;
+    ASSERT_OK(policy.PlaceExtraTabletReplica({}, none, &extra_ts));
+    ASSERT_TRUE(extra_ts);
+    ASSERT_EQ("ts0", extra_ts->permanent_uuid());
+  }
+
+  // ts1 has ten times as many replicas, but a hundred times as much free space.
+  FLAGS_tablet_placement_consider_disk_space = true;
+  {
+    shared_ptr<TSDescriptor> extra_ts;
+    ASSERT_OK(policy.PlaceExtraTabletReplica({}, none, &extra_ts));
+    ASSERT_TRUE(extra_ts);
+    ASSERT_EQ("ts1", extra_ts->permanent_uuid());
+  }
+
+  // The space isn't considered unless both servers report it.
+  {
+    ASSERT_OK(Prepare(cluster_info));
+    const auto& unreported = descriptors();
+    unreported[1]->set_data_dirs_space(200 * kGiB, 100 * kGiB);
+    PlacementPolicy unreported_policy(unreported, rng());
+    shared_ptr<TSDescriptor> extra_ts;
+    ASSERT_OK(unreported_policy.PlaceExtraTabletReplica({}, none, &extra_ts));
+    ASSERT_TRUE(extra_ts);
+    ASSERT_EQ("ts0", extra_ts->permanent_uuid());
+  }
+}
+
 } // namespace master
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/master/placement_policy.h"
 
+#include <cstdint>
 #include <iterator>
 #include <limits>
 #include <map>
@@ -30,11 +31,13 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/ts_descriptor.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 
@@ -47,6 +50,16 @@ using std::unordered_map;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(tablet_placement_consider_disk_space, false,
+            "Whether to take the free space of the tablet servers' data "
+            "directories into account when placing new tablet replicas. If "
+            "set, of two candidate tablet servers that both report their disk "
+            "space, the one with fewer replicas per byte of free space is "
+            "picked, so that servers with larger or emptier disks receive "
+            "proportionally more replicas.");
+TAG_FLAG(tablet_placement_consider_disk_space, experimental);
+TAG_FLAG(tablet_placement_consider_disk_space, runtime);
+
 namespace kudu {
 namespace master {
 
@@ -58,6 +71,16 @@ double GetTSLoad(const boost::optional<string>& dimension, TSDescriptor* desc) {
   return desc->RecentReplicaCreations() + desc->num_live_replicas(dimension);
 }
 
+// Weighs 'load' of a tablet server by the free space of its data directories,
+// reported as 'free_bytes'. The new replica is counted in, so that servers
+// with no replicas yet still compare by their free space.
+double GetLoadPerFreeByte(double load, int64_t free_bytes) {
+  if (free_bytes <= 0) {
+    return numeric_limits<double>::max();
+  }
+  return (load + 1) / static_cast<double>(free_bytes);
+}
+
 // Given exactly two choices in 'two_choices', pick the better tablet server on
 // which to place a tablet replica. Ties are broken using 'rng'.
 shared_ptr<TSDescriptor> PickBetterReplica(
@@ -84,10 +107,23 @@ shared_ptr<TSDescriptor> PickBetterReplica(
   // we batch the selection process before sending any creation commands to the
   // servers themselves.
   //
+  // With --tablet_placement_consider_disk_space, the load is further divided
+  // by the free space of the server's data directories, if both servers
+  // report it. Servers with more capacity, or less of it used, then take
+  // proportionally more replicas.
+  //
   // TODO(wdberkeley): in the future we may want to factor in other items such
-  // as available disk space, actual request load, etc.
+  // as actual request load, etc.
   double load_a = GetTSLoad(dimension, a.get());
   double load_b = GetTSLoad(dimension, b.get());
+  if (FLAGS_tablet_placement_consider_disk_space) {
+    const auto free_a = a->data_dirs_free_bytes();
+    const auto free_b = b->data_dirs_free_bytes();
+    if (free_a && free_b) {
+      load_a = GetLoadPerFreeByte(load_a, *free_a);
+      load_b = GetLoadPerFreeByte(load_b, *free_b);
+    }
+  }
   if (load_a < load_b) {
     return a;
   }
@@ -136,6 +172,14 @@ Status PlacementPolicy::PlaceExtraTabletReplica(
     TSDescriptorVector existing,
     const boost::optional<std::string>& dimension,
     shared_ptr<TSDescriptor>* ts_desc) const {
+  return PlaceExtraTabletReplica(std::move(existing), {}, dimension, ts_desc);
+}
+
+Status PlacementPolicy::PlaceExtraTabletReplica(
+    TSDescriptorVector existing,
+    const TSDescriptorVector& others,
+    const boost::optional<std::string>& dimension,
+    shared_ptr<TSDescriptor>* ts_desc) const {
   DCHECK(ts_desc);
 
   // Convert input vector into a set, filtering out replicas that are located
@@ -172,7 +216,9 @@ Status PlacementPolicy::PlaceExtraTabletReplica(
     return Status::IllegalState(
         Substitute("'$0': no info on tablet servers at location", location));
   }
-  auto replica = SelectReplica(*location_ts_descs_ptr, dimension, existing_set);
+  set<shared_ptr<TSDescriptor>> excluded(existing_set);
+  excluded.insert(others.begin(), others.end());
+  auto replica = SelectReplica(*location_ts_descs_ptr, dimension, excluded);
   if (!replica) {
     return Status::NotFound("could not find tablet server for extra replica");
   }
@@ -95,6 +95,16 @@ class PlacementPolicy {
                                  const boost::optional<std::string>& dimension,
                                  std::shared_ptr<TSDescriptor>* ts_desc) const;
 
+  // Same as above, but the members of the tablet's Raft configuration listed
+  // in 'others' are placed separately from those of 'existing', e.g. the read
+  // replicas from the voters: the tablet servers hosting them are excluded,
+  // but they don't count towards the distribution of the replicas among
+  // locations.
+  Status PlaceExtraTabletReplica(TSDescriptorVector existing,
+                                 const TSDescriptorVector& others,
+                                 const boost::optional<std::string>& dimension,
+                                 std::shared_ptr<TSDescriptor>* ts_desc) const;
+
  private:
   // Tablet server descriptors per location. This is the most comprehensive
   // information on how tablet servers are placed among locations. Inherently,
@@ -0,0 +1,96 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/quota_tracker.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/master/master.pb.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace master {
+
+TEST(QuotaTrackerTest, TestParseUserQuotas) {
+  vector<QuotaPB> quotas;
+  ASSERT_OK(ParseUserQuotas("", &quotas));
+  ASSERT_TRUE(quotas.empty());
+
+  ASSERT_OK(ParseUserQuotas("alice:100:1048576:0, bob:0:0:20.5", &quotas));
+  ASSERT_EQ(2, quotas.size());
+  EXPECT_EQ(QuotaPB::USER, quotas[0].kind());
+  EXPECT_EQ("alice", quotas[0].key());
+  EXPECT_EQ(100, quotas[0].write_rpcs_per_sec());
+  EXPECT_EQ(1048576, quotas[0].write_bytes_per_sec());
+  EXPECT_EQ(0, quotas[0].scan_rpcs_per_sec());
+  EXPECT_EQ("bob", quotas[1].key());
+  EXPECT_EQ(20.5, quotas[1].scan_rpcs_per_sec());
+
+  for (const string& bad : { "alice", "alice:1:2", ":1:2:3", "alice:1:2:x",
+                             "alice:-1:2:3", "alice:1:2:3,alice:4:5:6" }) {
+    SCOPED_TRACE(bad);
+    ASSERT_TRUE(ParseUserQuotas(bad, &quotas).IsInvalidArgument());
+  }
+}
+
+TEST(QuotaTrackerTest, TestSplitQuota) {
+  QuotaPB quota;
+  quota.set_kind(QuotaPB::TABLE);
+  quota.set_key("table");
+  quota.set_write_rpcs_per_sec(1000);
+  quota.set_scan_rpcs_per_sec(100);
+
+  // With no usage reported, the quota is split evenly.
+  vector<QuotaPB> shares;
+  SplitQuota(quota, { nullptr, nullptr, nullptr, nullptr }, &shares);
+  ASSERT_EQ(4, shares.size());
+  for (const auto& share : shares) {
+    EXPECT_EQ(QuotaPB::TABLE, share.kind());
+    EXPECT_EQ("table", share.key());
+    EXPECT_DOUBLE_EQ(250, share.write_rpcs_per_sec());
+    EXPECT_DOUBLE_EQ(25, share.scan_rpcs_per_sec());
+    EXPECT_FALSE(share.has_write_bytes_per_sec());
+  }
+
+  // The shares follow the usage, the throttled tablet servers' counting
+  // double, and no rate's shares exceed its quota.
+  QuotaUsagePB busy;
+  busy.mutable_usage()->set_write_rpcs_per_sec(600);
+  busy.set_throttled(true);
+  QuotaUsagePB idle;
+  idle.mutable_usage()->set_scan_rpcs_per_sec(50);
+  SplitQuota(quota, { &busy, &idle }, &shares);
+  ASSERT_EQ(2, shares.size());
+  EXPECT_GT(shares[0].write_rpcs_per_sec(), 900);
+  EXPECT_GT(shares[1].write_rpcs_per_sec(), 0);
+  EXPECT_DOUBLE_EQ(1000, shares[0].write_rpcs_per_sec() + shares[1].write_rpcs_per_sec());
+  EXPECT_LT(shares[0].scan_rpcs_per_sec(), shares[1].scan_rpcs_per_sec());
+  EXPECT_DOUBLE_EQ(100, shares[0].scan_rpcs_per_sec() + shares[1].scan_rpcs_per_sec());
+
+  SplitQuota(quota, {}, &shares);
+  EXPECT_TRUE(shares.empty());
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,289 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/master/quota_tracker.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <set>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/master/catalog_manager.h"
+#include "kudu/master/ts_descriptor.h"
+#include "kudu/master/ts_manager.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+
+DEFINE_string(user_quotas, "",
+              "The quotas of the rates of the writes and scans of users across the "
+              "cluster, as a comma-separated list of "
+              "'<user>:<write RPCs/s>:<write bytes/s>:<scan RPCs/s>' items. A rate "
+              "of 0 isn't limited. The quotas are split among the tablet servers "
+              "by the leader master, in proportion to their usage.");
+TAG_FLAG(user_quotas, experimental);
+TAG_FLAG(user_quotas, runtime);
+
+DEFINE_int32(quota_split_interval_ms, 1000,
+             "How often the leader master splits the table and user quotas among "
+             "the tablet servers anew, from the usage reported in their heartbeats.");
+TAG_FLAG(quota_split_interval_ms, experimental);
+TAG_FLAG(quota_split_interval_ms, advanced);
+TAG_FLAG(quota_split_interval_ms, runtime);
+
+static bool ValidateUserQuotas(const char* flagname, const std::string& value) {
+  std::vector<kudu::master::QuotaPB> quotas;
+  const kudu::Status s = kudu::master::ParseUserQuotas(value, &quotas);
+  if (!s.ok()) {
+    LOG(ERROR) << "invalid value for flag --" << flagname << ": " << s.ToString();
+    return false;
+  }
+  return true;
+}
+DEFINE_validator(user_quotas, &ValidateUserQuotas);
+
+using std::set;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace master {
+
+namespace {
+
+// The usage reported by a tablet server is forgotten after this long, e.g.
+// once it's dead, or not hosting the replicas of a table anymore.
+const MonoDelta kUsageTtl = MonoDelta::FromSeconds(10);
+
+void SplitRate(double total,
+               const std::function<double(const QuotaPB&)>& rate,
+               const std::function<void(QuotaPB*, double)>& set_rate,
+               const vector<const QuotaUsagePB*>& usages,
+               vector<QuotaPB>* shares) {
+  if (total <= 0) {
+    return;
+  }
+  const double floor = total / (10 * usages.size());
+  vector<double> weights;
+  weights.reserve(usages.size());
+  double sum = 0;
+  for (const auto* usage : usages) {
+    double w = floor;
+    if (usage) {
+      w += rate(usage->usage());
+      if (usage->throttled()) {
+        w *= 2;
+      }
+    }
+    weights.push_back(w);
+    sum += w;
+  }
+  for (int i = 0; i < usages.size(); i++) {
+    set_rate(&(*shares)[i], total * weights[i] / sum);
+  }
+}
+
+} // anonymous namespace
+
+Status ParseUserQuotas(const string& spec, vector<QuotaPB>* quotas) {
+  quotas->clear();
+  set<string> users;
+  for (const auto& item : strings::Split(spec, ",", strings::SkipWhitespace())) {
+    const vector<string> fields = strings::Split(item, ":");
+    double rates[3];
+    if (fields.size() != 4 || fields[0].empty() ||
+        !safe_strtod(fields[1], &rates[0]) ||
+        !safe_strtod(fields[2], &rates[1]) ||
+        !safe_strtod(fields[3], &rates[2]) ||
+        rates[0] < 0 || rates[1] < 0 || rates[2] < 0) {
+      return Status::InvalidArgument(Substitute("invalid user quota '$0'", item));
+    }
+    if (!users.insert(fields[0]).second) {
+      return Status::InvalidArgument(Substitute("duplicate quota for user '$0'", fields[0]));
+    }
+    QuotaPB quota;
+    quota.set_kind(QuotaPB::USER);
+    quota.set_key(fields[0]);
+    quota.set_write_rpcs_per_sec(rates[0]);
+    quota.set_write_bytes_per_sec(rates[1]);
+    quota.set_scan_rpcs_per_sec(rates[2]);
+    quotas->emplace_back(std::move(quota));
+  }
+  return Status::OK();
+}
+
+void SplitQuota(const QuotaPB& quota,
+                const vector<const QuotaUsagePB*>& usages,
+                vector<QuotaPB>* shares) {
+  shares->assign(usages.size(), QuotaPB());
+  if (usages.empty()) {
+    return;
+  }
+  for (auto& share : *shares) {
+    share.set_kind(quota.kind());
+    share.set_key(quota.key());
+  }
+  SplitRate(quota.write_rpcs_per_sec(),
+            [](const QuotaPB& q) { return q.write_rpcs_per_sec(); },
+            [](QuotaPB* q, double r) { q->set_write_rpcs_per_sec(r); },
+            usages, shares);
+  SplitRate(quota.write_bytes_per_sec(),
+            [](const QuotaPB& q) { return q.write_bytes_per_sec(); },
+            [](QuotaPB* q, double r) { q->set_write_bytes_per_sec(r); },
+            usages, shares);
+  SplitRate(quota.scan_rpcs_per_sec(),
+            [](const QuotaPB& q) { return q.scan_rpcs_per_sec(); },
+            [](QuotaPB* q, double r) { q->set_scan_rpcs_per_sec(r); },
+            usages, shares);
+}
+
+QuotaTracker::QuotaTracker(CatalogManager* catalog_manager, TSManager* ts_manager)
+    : catalog_manager_(catalog_manager),
+      ts_manager_(ts_manager) {
+}
+
+QuotaTracker::~QuotaTracker() {}
+
+void QuotaTracker::RecordUsage(const string& ts_uuid,
+                               const google::protobuf::RepeatedPtrField<QuotaUsagePB>& usages) {
+  Report report;
+  report.time = MonoTime::Now();
+  for (const auto& usage : usages) {
+    report.usages[{ usage.usage().kind(), usage.usage().key() }] = usage;
+  }
+  std::lock_guard<std::mutex> l(lock_);
+  reports_[ts_uuid] = std::move(report);
+}
+
+void QuotaTracker::GetShares(const string& ts_uuid, QuotaSharesPB* shares) {
+  std::lock_guard<std::mutex> l(lock_);
+  const auto* ts_shares = FindOrNull(shares_, ts_uuid);
+  if (ts_shares) {
+    *shares = *ts_shares;
+  } else {
+    shares->Clear();
+  }
+}
+
+void QuotaTracker::SplitQuotasIfNecessary() {
+  const MonoTime now = MonoTime::Now();
+  if (last_split_.Initialized() &&
+      now - last_split_ <= MonoDelta::FromMilliseconds(FLAGS_quota_split_interval_ms)) {
+    return;
+  }
+  last_split_ = now;
+  // The catalog is walked without 'lock_', which the heartbeats take.
+  QuotasToSplit quotas;
+  CollectQuotas(&quotas);
+  std::lock_guard<std::mutex> l(lock_);
+  SplitQuotasUnlocked(now, quotas);
+}
+
+void QuotaTracker::CollectQuotas(QuotasToSplit* quotas) const {
+  quotas->clear();
+  vector<scoped_refptr<TableInfo>> tables;
+  catalog_manager_->GetAllTables(&tables);
+  for (const auto& table : tables) {
+    TableMetadataLock table_l(table.get(), LockMode::READ);
+    const SysTablesEntryPB& table_data = table_l.data().pb;
+    if (table_data.state() == SysTablesEntryPB::REMOVED) {
+      continue;
+    }
+    const TableExtraConfigPB& config = table_data.extra_config();
+    if (config.write_quota_rpcs_per_sec() <= 0 &&
+        config.write_quota_bytes_per_sec() <= 0 &&
+        config.scan_quota_rpcs_per_sec() <= 0) {
+      continue;
+    }
+    QuotaPB quota;
+    quota.set_kind(QuotaPB::TABLE);
+    quota.set_key(table->id());
+    quota.set_write_rpcs_per_sec(config.write_quota_rpcs_per_sec());
+    quota.set_write_bytes_per_sec(config.write_quota_bytes_per_sec());
+    quota.set_scan_rpcs_per_sec(config.scan_quota_rpcs_per_sec());
+
+    set<string> ts_uuids;
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (const auto& tablet : tablets) {
+      TabletMetadataLock tablet_l(tablet.get(), LockMode::READ);
+      for (const auto& peer : tablet_l.data().pb.consensus_state().committed_config().peers()) {
+        ts_uuids.insert(peer.permanent_uuid());
+      }
+    }
+    quotas->emplace_back(std::move(quota), vector<string>(ts_uuids.begin(), ts_uuids.end()));
+  }
+
+  vector<QuotaPB> user_quotas;
+  WARN_NOT_OK(ParseUserQuotas(FLAGS_user_quotas, &user_quotas), "invalid user quotas");
+  if (!user_quotas.empty()) {
+    TSDescriptorVector descs;
+    ts_manager_->GetAllDescriptors(&descs);
+    vector<string> live_ts_uuids;
+    for (const auto& desc : descs) {
+      if (!desc->PresumedDead()) {
+        live_ts_uuids.emplace_back(desc->permanent_uuid());
+      }
+    }
+    for (auto& quota : user_quotas) {
+      quotas->emplace_back(std::move(quota), live_ts_uuids);
+    }
+  }
+}
+
+void QuotaTracker::SplitQuotasUnlocked(MonoTime now, const QuotasToSplit& quotas) {
+  shares_.clear();
+
+  // Forget the reports of the tablet servers which stopped heartbeating.
+  for (auto it = reports_.begin(); it != reports_.end();) {
+    if (now - it->second.time > kUsageTtl) {
+      it = reports_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  vector<const QuotaUsagePB*> usages;
+  vector<QuotaPB> shares;
+  for (const auto& quota_and_ts_uuids : quotas) {
+    const QuotaPB& quota = quota_and_ts_uuids.first;
+    const vector<string>& ts_uuids = quota_and_ts_uuids.second;
+    const QuotaKey key(quota.kind(), quota.key());
+    usages.clear();
+    for (const auto& ts_uuid : ts_uuids) {
+      const auto* report = FindOrNull(reports_, ts_uuid);
+      usages.push_back(report ? FindOrNull(report->usages, key) : nullptr);
+    }
+    SplitQuota(quota, usages, &shares);
+    for (int i = 0; i < ts_uuids.size(); i++) {
+      shares_[ts_uuids[i]].add_shares()->Swap(&shares[i]);
+    }
+  }
+}
+
+} // namespace master
+} // namespace kudu
@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <google/protobuf/repeated_field.h> // IWYU pragma: keep
+
+#include "kudu/gutil/macros.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace master {
+
+class CatalogManager;
+class TSManager;
+
+// Parses the user quotas of 'spec', a comma-separated list of
+// '<user>:<write RPCs/s>:<write bytes/s>:<scan RPCs/s>' items, into 'quotas'.
+// A rate of zero isn't limited.
+Status ParseUserQuotas(const std::string& spec, std::vector<QuotaPB>* quotas);
+
+// Splits the rates of 'quota' among the tablet servers whose usages of their
+// previous shares are 'usages', into 'shares', in the same order. A nullptr
+// usage is that of a tablet server with no share yet.
+//
+// Each tablet server's share is in proportion to its recent usage, plus a
+// tenth of an even split, so that tablet servers with little usage may grow
+// it. The usage of the tablet servers which were throttled counts double:
+// they'd have used more of the quota if they were allowed to.
+void SplitQuota(const QuotaPB& quota,
+                const std::vector<const QuotaUsagePB*>& usages,
+                std::vector<QuotaPB>* shares);
+
+// Splits the quotas of the tables and users among the tablet servers, from the
+// usage of their shares reported in their heartbeats to the leader master.
+//
+// The quotas of tables are set in their extra configuration; those of users
+// with --user_quotas. The quota of a table is split among the tablet servers
+// hosting its replicas, and that of a user among all the live tablet servers.
+//
+// Thread-safe.
+class QuotaTracker {
+ public:
+  QuotaTracker(CatalogManager* catalog_manager, TSManager* ts_manager);
+  ~QuotaTracker();
+
+  // Records the usage of its shares reported by the tablet server 'ts_uuid'.
+  void RecordUsage(const std::string& ts_uuid,
+                   const google::protobuf::RepeatedPtrField<QuotaUsagePB>& usages);
+
+  // Sets 'shares' to the shares of the quotas of the tablet server 'ts_uuid',
+  // as of the last SplitQuotasIfNecessary().
+  void GetShares(const std::string& ts_uuid, QuotaSharesPB* shares);
+
+  // Splits the quotas among the tablet servers anew if they were split long
+  // enough ago. Walks all of the tables and their tablets, so it's called by
+  // the catalog manager's background tasks rather than on heartbeats. Must be
+  // called with the catalog manager's leader lock held.
+  void SplitQuotasIfNecessary();
+
+ private:
+  typedef std::pair<QuotaPB::Kind, std::string> QuotaKey;
+
+  // The usage reported by a tablet server.
+  struct Report {
+    MonoTime time;
+    std::map<QuotaKey, QuotaUsagePB> usages;
+  };
+
+  // The quotas, each with the tablet servers to split it among.
+  typedef std::vector<std::pair<QuotaPB, std::vector<std::string>>> QuotasToSplit;
+
+  // Collects the quotas of the tables and users into 'quotas'.
+  void CollectQuotas(QuotasToSplit* quotas) const;
+
+  // Splits 'quotas' among the tablet servers into 'shares_'.
+  void SplitQuotasUnlocked(MonoTime now, const QuotasToSplit& quotas);
+
+  CatalogManager* const catalog_manager_;
+  TSManager* const ts_manager_;
+
+  std::mutex lock_;
+
+  // The latest usage report of each tablet server, by UUID.
+  std::unordered_map<std::string, Report> reports_;
+
+  // The shares of each tablet server, by UUID, as of the last split.
+  std::unordered_map<std::string, QuotaSharesPB> shares_;
+
+  // Only accessed by SplitQuotasIfNecessary().
+  MonoTime last_split_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuotaTracker);
+};
+
+} // namespace master
+} // namespace kudu
@@ -22,12 +22,14 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.pb.h"
@@ -55,6 +57,9 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
+
+DECLARE_int32(sys_catalog_load_threads);
 
 namespace google {
 namespace protobuf {
@@ -356,6 +361,44 @@ TEST_F(SysCatalogTest, TestSysCatalogTabletsOperations) {
   }
 }
 
+// Verify that the tablets are visited the same way when their entries are
+// deserialized on several threads.
+TEST_F(SysCatalogTest, TestVisitTabletsInParallel) {
+  constexpr int kNumTablets = 1000;
+  scoped_refptr<TableInfo> table(new TableInfo("abc"));
+  vector<scoped_refptr<TabletInfo>> tablets;
+  for (int i = 0; i < kNumTablets; ++i) {
+    tablets.emplace_back(CreateTablet(table, Substitute("tablet-$0", i),
+                                      Substitute("$0", i), Substitute("$0", i + 1)));
+  }
+  SysCatalogTable* sys_catalog = master_->catalog_manager()->sys_catalog();
+  {
+    vector<unique_ptr<TabletMetadataLock>> locks;
+    for (const auto& tablet : tablets) {
+      locks.emplace_back(new TabletMetadataLock(tablet.get(), LockMode::WRITE));
+    }
+    SysCatalogTable::Actions actions;
+    actions.tablets_to_add = tablets;
+    ASSERT_OK(sys_catalog->Write(std::move(actions)));
+    for (auto& l : locks) {
+      l->Commit();
+    }
+  }
+
+  TestTabletLoader serial_loader;
+  ASSERT_OK(sys_catalog->VisitTablets(&serial_loader));
+  ASSERT_EQ(kNumTablets, serial_loader.tablets.size());
+
+  FLAGS_sys_catalog_load_threads = 4;
+  TestTabletLoader parallel_loader;
+  ASSERT_OK(sys_catalog->VisitTablets(&parallel_loader));
+  ASSERT_EQ(kNumTablets, parallel_loader.tablets.size());
+  for (int i = 0; i < kNumTablets; ++i) {
+    ASSERT_EQ(serial_loader.tablets[i]->id(), parallel_loader.tablets[i]->id());
+    ASSERT_TRUE(MetadatasEqual(serial_loader.tablets[i], parallel_loader.tablets[i]));
+  }
+}
+
 // Verify that data mutations are not available from metadata() until commit.
 TEST_F(SysCatalogTest, TestTabletInfoCommit) {
   scoped_refptr<TabletInfo> tablet(new TabletInfo(nullptr, "123"));
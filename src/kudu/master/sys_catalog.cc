@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <memory>
@@ -83,6 +84,7 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_double(sys_catalog_fail_during_write, 0.0,
               "Fraction of the time when system table writes will fail");
@@ -94,6 +96,15 @@ DEFINE_string(master_address_add_new_master, "",
               "Address of master to add as a NON_VOTER on creating a distributed master config.");
 TAG_FLAG(master_address_add_new_master, hidden);
 
+DEFINE_int32(sys_catalog_load_threads, 1,
+             "Number of threads used to deserialize the tablet entries of the "
+             "system catalog when the catalog manager loads them, e.g. upon "
+             "becoming the leader master. Raising it shortens the time it takes "
+             "a master with many tablets to start serving.");
+TAG_FLAG(sys_catalog_load_threads, experimental);
+DEFINE_validator(sys_catalog_load_threads,
+                 [](const char* /*flagname*/, int32_t value) { return value >= 1; });
+
 DECLARE_bool(master_support_change_config);
 DECLARE_int64(rpc_max_message_size);
 
@@ -739,6 +750,16 @@ Status SysCatalogTable::VisitTServerStates(TServerStateVisitor* visitor) {
   return ProcessRows<SysTServerStateEntryPB, TSERVER_STATE>(processor);
 }
 
+Status SysCatalogTable::VisitTServerReportCheckpoints(
+    TServerReportCheckpointVisitor* visitor) {
+  TRACE_EVENT0("master", "SysCatalogTable::VisitTServerReportCheckpoints");
+  const auto processor = [&] (const string& entry_id,
+                              const TabletReportCheckpointPB& entry_data) {
+    return visitor->Visit(entry_id, entry_data);
+  };
+  return ProcessRows<TabletReportCheckpointPB, TSERVER_REPORT_CHECKPOINT>(processor);
+}
+
 Status SysCatalogTable::VisitTables(TableVisitor* visitor) {
   TRACE_EVENT0("master", "SysCatalogTable::VisitTables");
   auto processor = [&](
@@ -769,7 +790,7 @@ Status SysCatalogTable::GetEntryFromRow(
 // with each entry found.
 template<typename T, SysCatalogTable::CatalogEntryType entry_type>
 Status SysCatalogTable::ProcessRows(
-    function<Status(const string&, const T&)> processor) const {
+    function<Status(const string&, const T&)> processor, int num_threads) const {
   const int type_col_idx = schema_.find_column(kSysCatalogTableColType);
   CHECK(type_col_idx != Schema::kColumnNotFound)
       << "cannot find sys catalog table column " << kSysCatalogTableColType
@@ -787,6 +808,74 @@ Status SysCatalogTable::ProcessRows(
 
   RowBlockMemory mem(32 * 1024);
   RowBlock block(&iter->schema(), 512, &mem);
+  if (num_threads <= 1) {
+    while (iter->HasNext()) {
+      RETURN_NOT_OK(iter->NextBlock(&block));
+      const size_t nrows = block.nrows();
+      for (size_t i = 0; i < nrows; ++i) {
+        if (!block.selection_vector()->IsRowSelected(i)) {
+          continue;
+        }
+        string entry_id;
+        T entry_data;
+        RETURN_NOT_OK(GetEntryFromRow(block.row(i), &entry_id, &entry_data));
+        RETURN_NOT_OK(processor(entry_id, entry_data));
+      }
+    }
+    return Status::OK();
+  }
+
+  // Copy the rows' IDs and serialized entries out of the scan in chunks, and
+  // parse each chunk on the pool's threads, one slice of the chunk per thread.
+  // The parsed entries are then processed in order on this thread.
+  static constexpr size_t kChunkRows = 16 * 1024;
+  unique_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("sys-catalog-load")
+                .set_max_threads(num_threads)
+                .Build(&pool));
+  const int id_idx = schema_.find_column(kSysCatalogTableColId);
+  const int data_idx = schema_.find_column(kSysCatalogTableColMetadata);
+  vector<string> ids;
+  vector<string> datas;
+  vector<T> entries;
+  vector<Status> statuses(num_threads);
+  const auto process_chunk = [&]() -> Status {
+    entries.clear();
+    entries.resize(ids.size());
+    const size_t slice_size = (ids.size() + num_threads - 1) / num_threads;
+    std::fill(statuses.begin(), statuses.end(), Status::OK());
+    Status submit_status;
+    for (int t = 0; t < num_threads && submit_status.ok(); ++t) {
+      const size_t begin = t * slice_size;
+      const size_t end = std::min(ids.size(), begin + slice_size);
+      if (begin >= end) {
+        break;
+      }
+      submit_status = pool->Submit([&, t, begin, end]() {
+        for (size_t i = begin; i < end; ++i) {
+          const string& data = datas[i];
+          Status s = pb_util::ParseFromArray(
+              &entries[i], reinterpret_cast<const uint8_t*>(data.data()), data.size());
+          if (PREDICT_FALSE(!s.ok())) {
+            statuses[t] = s.CloneAndPrepend("unable to parse metadata field for row " + ids[i]);
+            return;
+          }
+        }
+      });
+    }
+    // The tasks refer to the chunk: wait for them even if a submission failed.
+    pool->Wait();
+    RETURN_NOT_OK(submit_status);
+    for (const auto& s : statuses) {
+      RETURN_NOT_OK(s);
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+      RETURN_NOT_OK(processor(ids[i], entries[i]));
+    }
+    ids.clear();
+    datas.clear();
+    return Status::OK();
+  };
   while (iter->HasNext()) {
     RETURN_NOT_OK(iter->NextBlock(&block));
     const size_t nrows = block.nrows();
@@ -794,12 +883,17 @@ Status SysCatalogTable::ProcessRows(
       if (!block.selection_vector()->IsRowSelected(i)) {
         continue;
       }
-      string entry_id;
-      T entry_data;
-      RETURN_NOT_OK(GetEntryFromRow(block.row(i), &entry_id, &entry_data));
-      RETURN_NOT_OK(processor(entry_id, entry_data));
+      const RowBlockRow row = block.row(i);
+      ids.emplace_back(schema_.ExtractColumnFromRow<STRING>(row, id_idx)->ToString());
+      datas.emplace_back(schema_.ExtractColumnFromRow<STRING>(row, data_idx)->ToString());
+    }
+    if (ids.size() >= kChunkRows) {
+      RETURN_NOT_OK(process_chunk());
     }
   }
+  if (!ids.empty()) {
+    RETURN_NOT_OK(process_chunk());
+  }
   return Status::OK();
 }
 
@@ -992,6 +1086,26 @@ Status SysCatalogTable::RemoveTServerState(const string& tserver_id) {
   return SyncWrite(req);
 }
 
+Status SysCatalogTable::WriteTServerReportCheckpoint(const string& tserver_id,
+                                                     const TabletReportCheckpointPB& entry) {
+  DCHECK(!tserver_id.empty());
+  WriteRequestPB req;
+  req.set_tablet_id(kSysCatalogTabletId);
+  RETURN_NOT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  KuduPartialRow row(&schema_);
+  RETURN_NOT_OK(row.SetInt8(kSysCatalogTableColType, TSERVER_REPORT_CHECKPOINT));
+  RETURN_NOT_OK(row.SetString(kSysCatalogTableColId, tserver_id));
+
+  faststring metadata_buf;
+  pb_util::SerializeToString(entry, &metadata_buf);
+  RETURN_NOT_OK(row.SetStringNoCopy(kSysCatalogTableColMetadata, metadata_buf));
+
+  RowOperationsPBEncoder enc(req.mutable_row_operations());
+  enc.Add(RowOperationsPB::UPSERT, row);
+
+  return SyncWrite(req);
+}
+
 // ------------------------------------------------------------------
 // Tablet related methods
 // ------------------------------------------------------------------
@@ -1136,7 +1250,8 @@ Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
     metadata.clear_deprecated_end_key();
     return visitor->VisitTablet(metadata.table_id(), entry_id, metadata);
   };
-  return ProcessRows<SysTabletsEntryPB, TABLETS_ENTRY>(processor);
+  return ProcessRows<SysTabletsEntryPB, TABLETS_ENTRY>(processor,
+                                                       FLAGS_sys_catalog_load_threads);
 }
 
 void SysCatalogTable::InitLocalRaftPeerPB() {
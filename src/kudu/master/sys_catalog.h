@@ -61,6 +61,7 @@ class Master;
 class SysCertAuthorityEntryPB;
 class SysClusterIdEntryPB;
 class SysTServerStateEntryPB;
+class TabletReportCheckpointPB;
 class SysTablesEntryPB;
 class SysTabletsEntryPB;
 class SysTskEntryPB;
@@ -101,6 +102,13 @@ class TServerStateVisitor {
                        const SysTServerStateEntryPB& metadata) = 0;
 };
 
+class TServerReportCheckpointVisitor {
+ public:
+  virtual ~TServerReportCheckpointVisitor() = default;
+  virtual Status Visit(const std::string& tserver_id,
+                       const TabletReportCheckpointPB& metadata) = 0;
+};
+
 // SysCatalogTable is a Kudu table that keeps track of the following
 // system information:
 //   * cluster id
@@ -154,7 +162,8 @@ class SysCatalogTable {
     TSK_ENTRY = 4,            // Token Signing Key entry.
     HMS_NOTIFICATION_LOG = 5, // HMS notification log latest event ID.
     TSERVER_STATE = 6,        // TServer state.
-    CLUSTER_ID = 7            // Unique Cluster ID.
+    CLUSTER_ID = 7,           // Unique Cluster ID.
+    TSERVER_REPORT_CHECKPOINT = 8, // TServer tablet report checkpoint.
   };
 
   // 'leader_cb_' is invoked whenever this node is elected as a leader
@@ -223,6 +232,9 @@ class SysCatalogTable {
   // Scan for tserver state entries in the system table.
   Status VisitTServerStates(TServerStateVisitor* visitor);
 
+  // Scan for tserver tablet report checkpoint entries.
+  Status VisitTServerReportCheckpoints(TServerReportCheckpointVisitor* visitor);
+
   // Get the latest processed HMS notification log event ID.
   Status GetLatestNotificationLogEventId(int64_t* event_id) WARN_UNUSED_RESULT;
 
@@ -255,6 +267,11 @@ class SysCatalogTable {
   // Remove a tserver state entry from the system table.
   Status RemoveTServerState(const std::string& tserver_id);
 
+  // Add or replace the tablet report checkpoint entry of a tserver in the
+  // system table.
+  Status WriteTServerReportCheckpoint(const std::string& tserver_id,
+                                      const TabletReportCheckpointPB& entry);
+
   // Return the underlying TabletReplica instance hosting the metadata.
   // This should be used with caution -- typically the various methods
   // above should be used rather than directly accessing the replica.
@@ -307,8 +324,12 @@ class SysCatalogTable {
   Status GetEntryFromRow(const RowBlockRow& row,
                          std::string* entry_id, T* entry_data) const;
 
+  // Scans for the entries of 'entry_type' and runs 'processor' with each of
+  // them, in the order of the scan. With 'num_threads' greater than 1, the
+  // entries are deserialized in chunks on that many threads.
   template<typename T, CatalogEntryType entry_type>
-  Status ProcessRows(std::function<Status(const std::string&, const T&)>) const;
+  Status ProcessRows(std::function<Status(const std::string&, const T&)> processor,
+                     int num_threads = 1) const;
 
   // Tablet related private methods.
 
@@ -140,6 +140,27 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
     num_live_tablets_by_dimension_ = std::move(num_live_tablets_by_dimension);
   }
 
+  // Set the capacity and free space of the filesystems of the server's data
+  // directories, from the last heartbeat.
+  void set_data_dirs_space(int64_t capacity_bytes, int64_t free_bytes) {
+    DCHECK_GE(capacity_bytes, 0);
+    DCHECK_GE(free_bytes, 0);
+    std::lock_guard<rw_spinlock> l(lock_);
+    data_dirs_capacity_bytes_ = capacity_bytes;
+    data_dirs_free_bytes_ = free_bytes;
+  }
+
+  // Return the capacity and free space of the server's data directories, or
+  // none if the server hasn't reported them.
+  boost::optional<int64_t> data_dirs_capacity_bytes() const {
+    shared_lock<rw_spinlock> l(lock_);
+    return data_dirs_capacity_bytes_;
+  }
+  boost::optional<int64_t> data_dirs_free_bytes() const {
+    shared_lock<rw_spinlock> l(lock_);
+    return data_dirs_free_bytes_;
+  }
+
   // Return the number of live replicas (i.e running or bootstrapping).
   // If dimension is none, return the total number of replicas in the tablet server.
   // Otherwise, return the number of replicas in the dimension.
@@ -208,6 +229,11 @@ class TSDescriptor : public enable_make_shared<TSDescriptor> {
   // The number of live replicas in each dimension, from the last heartbeat.
   boost::optional<TabletNumByDimensionMap> num_live_tablets_by_dimension_;
 
+  // The capacity and free space of the data directories, from the last
+  // heartbeat that reported them.
+  boost::optional<int64_t> data_dirs_capacity_bytes_;
+  boost::optional<int64_t> data_dirs_free_bytes_;
+
   // The tablet server's location, as determined by the master at registration.
   boost::optional<std::string> location_;
 
@@ -41,6 +41,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/trace.h"
 
@@ -50,6 +51,13 @@ DEFINE_bool(location_mapping_by_uuid, false,
 TAG_FLAG(location_mapping_by_uuid, hidden);
 TAG_FLAG(location_mapping_by_uuid, unsafe);
 
+DEFINE_int32(master_tablet_report_checkpoint_interval_secs, 60,
+             "How often, at most, the leader master persists the checkpoint of "
+             "each tablet server's tablet reports. A new leader master has the "
+             "tablet servers resync their tablets from the persisted checkpoints.");
+TAG_FLAG(master_tablet_report_checkpoint_interval_secs, experimental);
+TAG_FLAG(master_tablet_report_checkpoint_interval_secs, runtime);
+
 METRIC_DEFINE_gauge_int32(server, cluster_replica_skew,
                           "Cluster Replica Skew",
                           kudu::MetricUnit::kTablets,
@@ -92,6 +100,22 @@ class TServerStateLoader : public TServerStateVisitor {
   TSManager* ts_manager_;
 };
 
+class TabletReportCheckpointLoader : public TServerReportCheckpointVisitor {
+ public:
+  explicit TabletReportCheckpointLoader(TSManager* ts_manager)
+      : ts_manager_(ts_manager) {}
+
+  Status Visit(const std::string& tserver_id,
+               const TabletReportCheckpointPB& metadata) override {
+    DCHECK(ts_manager_->report_checkpoints_lock_.is_locked());
+    ts_manager_->report_checkpoints_[tserver_id].persisted = metadata;
+    return Status::OK();
+  }
+
+ private:
+  TSManager* ts_manager_;
+};
+
 TSManager::TSManager(LocationCache* location_cache,
                      const scoped_refptr<MetricEntity>& metric_entity)
     : ts_state_lock_(RWMutex::Priority::PREFER_READING),
@@ -309,6 +333,71 @@ Status TSManager::ReloadTServerStates(SysCatalogTable* sys_catalog) {
   return sys_catalog->VisitTServerStates(&loader);
 }
 
+Status TSManager::ReloadTabletReportCheckpoints(SysCatalogTable* sys_catalog) {
+  lock_guard<simple_spinlock> l(report_checkpoints_lock_);
+  report_checkpoints_ = {};
+  TabletReportCheckpointLoader loader(this);
+  return sys_catalog->VisitTServerReportCheckpoints(&loader);
+}
+
+bool TSManager::GetTabletReportCheckpoint(const string& ts_uuid,
+                                          TabletReportCheckpointPB* checkpoint) const {
+  lock_guard<simple_spinlock> l(report_checkpoints_lock_);
+  const auto* state = FindOrNull(report_checkpoints_, ts_uuid);
+  if (!state || state->current || !state->persisted) {
+    return false;
+  }
+  *checkpoint = *state->persisted;
+  return true;
+}
+
+Status TSManager::ProcessTabletReportCheckpoint(const string& ts_uuid,
+                                                const TabletReportPB& report,
+                                                SysCatalogTable* sys_catalog,
+                                                bool* needs_full_report) {
+  const auto& checkpoint = report.checkpoint();
+  {
+    lock_guard<simple_spinlock> l(report_checkpoints_lock_);
+    auto& state = report_checkpoints_[ts_uuid];
+    if (report.has_resync_since_version()) {
+      // The resync only covers what the persisted checkpoint doesn't.
+      if (!state.persisted ||
+          state.persisted->report_epoch() != checkpoint.report_epoch() ||
+          state.persisted->version() < report.resync_since_version()) {
+        LOG(INFO) << Substitute("Rejecting tablet report resync from tserver $0 "
+                                "since version $1", ts_uuid, report.resync_since_version());
+        state.persisted = boost::none;
+        state.current = boost::none;
+        *needs_full_report = true;
+        return Status::OK();
+      }
+    } else if (report.is_incremental() &&
+               (!state.current || state.current->report_epoch() != checkpoint.report_epoch())) {
+      // Without a complete view of the tablet server's tablets, there's
+      // nothing to checkpoint.
+      return Status::OK();
+    }
+    state.current = checkpoint;
+
+    const MonoTime now = MonoTime::Now();
+    if (state.persisted &&
+        state.persisted->report_epoch() == checkpoint.report_epoch() &&
+        (state.persisted->version() == checkpoint.version() ||
+         now - state.last_persisted < MonoDelta::FromSeconds(
+             FLAGS_master_tablet_report_checkpoint_interval_secs))) {
+      return Status::OK();
+    }
+    state.last_persisted = now;
+  }
+
+  RETURN_NOT_OK_PREPEND(sys_catalog->WriteTServerReportCheckpoint(ts_uuid, checkpoint),
+                        Substitute("failed to persist tablet report checkpoint of tserver $0",
+                                   ts_uuid));
+  lock_guard<simple_spinlock> l(report_checkpoints_lock_);
+  report_checkpoints_[ts_uuid].persisted = checkpoint;
+  return Status::OK();
+}
+
 void TSManager::SetAllTServersNeedFullTabletReports() {
   lock_guard<rw_spinlock> l(lock_);
   for (auto& id_and_desc : servers_by_id_) {
@@ -23,12 +23,15 @@
 #include <unordered_set>
 #include <utility>
 
+#include <boost/optional/optional.hpp>
+
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/master/ts_descriptor.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/status.h"
 
@@ -125,11 +128,45 @@ class TSManager {
   // Resets the tserver states and reloads them from disk.
   Status ReloadTServerStates(SysCatalogTable* sys_catalog);
 
+  // Resets the tablet report checkpoints and reloads them from disk. Until
+  // this master processes a full tablet report from a tablet server (or a
+  // resync in its place), it hands out the tablet server's checkpoint loaded
+  // from disk, if any.
+  Status ReloadTabletReportCheckpoints(SysCatalogTable* sys_catalog);
+
+  // Sets 'checkpoint' to the checkpoint the given tablet server may resync
+  // from in place of sending a full tablet report, and returns true, if there
+  // is one. See TSHeartbeatResponsePB.tablet_report_checkpoint.
+  bool GetTabletReportCheckpoint(const std::string& ts_uuid,
+                                 TabletReportCheckpointPB* checkpoint) const;
+
+  // Keeps track of the checkpoint of a tablet report processed from the given
+  // tablet server, persisting it every so often. Sets 'needs_full_report' if
+  // the report is a resync from a checkpoint other than the one handed out:
+  // the tablet server should then send a full tablet report.
+  Status ProcessTabletReportCheckpoint(const std::string& ts_uuid,
+                                       const TabletReportPB& report,
+                                       SysCatalogTable* sys_catalog,
+                                       bool* needs_full_report);
+
   // Remove the tserver from 'servers_by_id_'.
   Status UnregisterTServer(const std::string& ts_uuid, bool force_unregister_live_tserver);
 
  private:
   friend class TServerStateLoader;
+  friend class TabletReportCheckpointLoader;
+
+  struct TabletReportCheckpointState {
+    // The checkpoint persisted on disk, if any.
+    boost::optional<TabletReportCheckpointPB> persisted;
+
+    // The checkpoint of the latest tablet report, if this master has had a
+    // complete view of the tablet server's tablets since it was loaded.
+    boost::optional<TabletReportCheckpointPB> current;
+
+    // When 'persisted' was last written by this master.
+    MonoTime last_persisted;
+  };
 
   int ClusterSkew() const;
 
@@ -165,6 +202,12 @@ class TSManager {
   // necessarily belong to registered tablet servers.
   TServerStateMap ts_state_by_uuid_;
 
+  // Protects 'report_checkpoints_'. Not held while writing to disk.
+  mutable simple_spinlock report_checkpoints_lock_;
+
+  // Maps from the UUIDs of tablet servers to their tablet report checkpoints.
+  std::unordered_map<std::string, TabletReportCheckpointState> report_checkpoints_;
+
   LocationCache* location_cache_;
 
   // NOTE: it's important that this is the first member to be destructed. This
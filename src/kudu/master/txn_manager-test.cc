@@ -30,6 +30,8 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/clock/clock.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
@@ -547,5 +549,34 @@ TEST_F(TxnManagerTest, KeepTransactionAliveNonExistingTxnId) {
   ASSERT_STR_CONTAINS(s.ToString(), "transaction ID 123 not found");
 }
 
+// Verify that snapshot timestamps trail the master's clock, but never precede
+// the timestamp propagated by the client.
+TEST_F(TxnManagerTest, GetSnapshotTimestamp) {
+  uint64_t snapshot_ts;
+  {
+    RpcController ctx;
+    PrepareRpcController(&ctx);
+    GetSnapshotTimestampRequestPB req;
+    GetSnapshotTimestampResponsePB resp;
+    ASSERT_OK(proxy_->GetSnapshotTimestamp(req, &resp, &ctx));
+    ASSERT_FALSE(resp.has_error()) << StatusFromPB(resp.error().status()).ToString();
+    ASSERT_TRUE(resp.has_snapshot_timestamp());
+    snapshot_ts = resp.snapshot_timestamp();
+    ASSERT_LT(snapshot_ts, master_->clock()->Now().value());
+  }
+  {
+    const uint64_t propagated_ts = master_->clock()->Now().value();
+    RpcController ctx;
+    PrepareRpcController(&ctx);
+    GetSnapshotTimestampRequestPB req;
+    req.set_propagated_timestamp(propagated_ts);
+    GetSnapshotTimestampResponsePB resp;
+    ASSERT_OK(proxy_->GetSnapshotTimestamp(req, &resp, &ctx));
+    ASSERT_FALSE(resp.has_error()) << StatusFromPB(resp.error().status()).ToString();
+    ASSERT_EQ(propagated_ts, resp.snapshot_timestamp());
+    ASSERT_LT(snapshot_ts, resp.snapshot_timestamp());
+  }
+}
+
 } // namespace transactions
 } // namespace kudu
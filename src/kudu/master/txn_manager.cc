@@ -17,6 +17,7 @@
 
 #include "kudu/master/txn_manager.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <ostream>
@@ -25,6 +26,9 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/clock/clock.h"
+#include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/port.h"
 #include "kudu/master/master.h"
@@ -78,6 +82,16 @@ DEFINE_uint32(txn_manager_status_table_num_replicas, 3,
 TAG_FLAG(txn_manager_status_table_num_replicas, advanced);
 TAG_FLAG(txn_manager_status_table_num_replicas, experimental);
 
+DEFINE_uint32(txn_manager_snapshot_timestamp_lag_ms, 1000,
+              "How far behind the current time of the master the snapshot "
+              "timestamps of read-only transactions are chosen, in milliseconds. "
+              "The lag is meant to cover how far the safe time of tablet "
+              "replicas trails the current time, so that snapshot scans at these "
+              "timestamps don't have to wait for the safe time to catch up.");
+TAG_FLAG(txn_manager_snapshot_timestamp_lag_ms, advanced);
+TAG_FLAG(txn_manager_snapshot_timestamp_lag_ms, experimental);
+TAG_FLAG(txn_manager_snapshot_timestamp_lag_ms, runtime);
+
 namespace kudu {
 namespace transactions {
 
@@ -227,6 +241,24 @@ Status TxnManager::KeepTransactionAlive(int64_t txn_id,
   return txn_sys_client_->KeepTransactionAlive(txn_id, username, deadline);
 }
 
+Status TxnManager::GetSnapshotTimestamp(Timestamp propagated_timestamp,
+                                        Timestamp* snapshot_timestamp) {
+  clock::Clock* clock = server_->clock();
+  if (propagated_timestamp != Timestamp::kMin) {
+    RETURN_NOT_OK(clock->Update(propagated_timestamp));
+  }
+  Timestamp now = clock->Now();
+  if (clock->HasPhysicalComponent()) {
+    const uint64_t now_micros = clock::HybridClock::GetPhysicalValueMicros(now);
+    const uint64_t lag_micros =
+        static_cast<uint64_t>(FLAGS_txn_manager_snapshot_timestamp_lag_ms) * 1000;
+    now = clock::HybridClock::TimestampFromMicroseconds(
+        now_micros > lag_micros ? now_micros - lag_micros : 0);
+  }
+  *snapshot_timestamp = std::max(now, propagated_timestamp);
+  return Status::OK();
+}
+
 // This method isn't supposed to be called concurrently, so there isn't any
 // protection against concurrent calls.
 Status TxnManager::Init() {
@@ -24,6 +24,7 @@
 
 #include <gtest/gtest_prod.h>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
@@ -79,6 +80,16 @@ class TxnManager final {
                               const std::string& username,
                               const MonoTime& deadline);
 
+  // Choose the timestamp of a read-only transaction: a timestamp which is no
+  // earlier than 'propagated_timestamp' and which, by the time the scans at it
+  // reach the tablet servers, is most likely behind the safe time of every
+  // tablet replica, so that the scans don't have to wait for it.
+  //
+  // Unlike the methods above, this doesn't involve the transaction status
+  // table, so it doesn't require the TxnManager to be initialized.
+  Status GetSnapshotTimestamp(Timestamp propagated_timestamp,
+                              Timestamp* snapshot_timestamp);
+
  private:
   friend class master::Master;
   FRIEND_TEST(TxnManagerTest, LazyInitialization);
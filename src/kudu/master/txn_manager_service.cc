@@ -22,6 +22,7 @@
 
 #include <glog/logging.h>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/port.h"
 #include "kudu/master/master.h"
@@ -164,6 +165,22 @@ void TxnManagerServiceImpl::KeepTransactionAlive(
   return ctx->RespondSuccess();
 }
 
+void TxnManagerServiceImpl::GetSnapshotTimestamp(
+    const GetSnapshotTimestampRequestPB* req,
+    GetSnapshotTimestampResponsePB* resp,
+    rpc::RpcContext* ctx) {
+  Timestamp snapshot_timestamp;
+  const auto s = server_->txn_manager()->GetSnapshotTimestamp(
+      req->has_propagated_timestamp() ? Timestamp(req->propagated_timestamp())
+                                      : Timestamp::kMin,
+      &snapshot_timestamp);
+  if (PREDICT_TRUE(s.ok())) {
+    resp->set_snapshot_timestamp(snapshot_timestamp.value());
+  }
+  CheckRespErrorOrSetUnknown(s, resp);
+  return ctx->RespondSuccess();
+}
+
 bool TxnManagerServiceImpl::AuthorizeClient(
     const google::protobuf::Message* /* req */,
     google::protobuf::Message* /* resp */,
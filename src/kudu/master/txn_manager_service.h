@@ -37,6 +37,8 @@ class RpcContext;
 }
 
 namespace transactions {
+class GetSnapshotTimestampRequestPB;
+class GetSnapshotTimestampResponsePB;
 class GetTransactionStateRequestPB;
 class GetTransactionStateResponsePB;
 class KeepTransactionAliveRequestPB;
@@ -68,6 +70,10 @@ class TxnManagerServiceImpl : public TxnManagerServiceIf {
                             KeepTransactionAliveResponsePB* resp,
                             rpc::RpcContext* ctx) override;
 
+  void GetSnapshotTimestamp(const GetSnapshotTimestampRequestPB* req,
+                            GetSnapshotTimestampResponsePB* resp,
+                            rpc::RpcContext* ctx) override;
+
   // Authorize an RPC call which must be from a client.
   bool AuthorizeClient(const google::protobuf::Message* req,
                        google::protobuf::Message* resp,
@@ -50,6 +50,7 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_string(log_dir);
+DECLARE_uint32(ranger_authz_cache_capacity_mb);
 DECLARE_string(ranger_config_path);
 DECLARE_string(ranger_log_config_dir);
 DECLARE_string(ranger_log_level);
@@ -124,6 +125,9 @@ class MockSubprocessServer : public SubprocessServer {
     CHECK(req->request().UnpackTo(&req_list));
 
     RangerResponseListPB resp_list;
+    if (req_list.has_control_request()) {
+      resp_list.mutable_control_response()->set_success(true);
+    }
 
     for (const RangerRequestPB& req : req_list.requests()) {
       AuthorizedAction action;
@@ -336,6 +340,37 @@ TEST_F(RangerClientTest, TestAuthorizeActionsAllAuthorized) {
   ASSERT_EQ(3, actions.size());
 }
 
+// Verify that with the decision cache enabled, the decisions are reused until
+// the policies are refreshed.
+TEST_F(RangerClientTest, TestAuthorizeActionCached) {
+  FLAGS_ranger_authz_cache_capacity_mb = 1;
+  RangerClient client(env_, METRIC_ENTITY_server.Instantiate(&metric_registry_,
+                                                             "ranger_client-cached"));
+  std::unique_ptr<MockSubprocessServer> server(new MockSubprocessServer());
+  auto* responses = &server->next_response_;
+  client.ReplaceServerForTests(std::move(server));
+  responses->emplace(AuthorizedAction{ "jdoe", ActionPB::SELECT, "foo", "bar", "" });
+
+  bool authorized;
+  ASSERT_OK(client.AuthorizeAction("jdoe", ActionPB::SELECT, "foo", "bar", /*is_owner=*/false,
+                                   /*requires_delegate_admin=*/false, &authorized));
+  ASSERT_TRUE(authorized);
+
+  // The subprocess would now deny the action, but the decision is cached.
+  responses->clear();
+  ASSERT_OK(client.AuthorizeAction("jdoe", ActionPB::SELECT, "foo", "bar", /*is_owner=*/false,
+                                   /*requires_delegate_admin=*/false, &authorized));
+  ASSERT_TRUE(authorized);
+  ASSERT_OK(client.AuthorizeAction("jdoe", ActionPB::SELECT, "foo", "bar", /*is_owner=*/true,
+                                   /*requires_delegate_admin=*/false, &authorized));
+  ASSERT_FALSE(authorized);
+
+  ASSERT_OK(client.RefreshPolicies());
+  ASSERT_OK(client.AuthorizeAction("jdoe", ActionPB::SELECT, "foo", "bar", /*is_owner=*/false,
+                                   /*requires_delegate_admin=*/false, &authorized));
+  ASSERT_FALSE(authorized);
+}
+
 class RangerClientTestBase : public KuduTest {
  public:
   RangerClientTestBase()
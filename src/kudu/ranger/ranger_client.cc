@@ -18,8 +18,10 @@
 #include "kudu/ranger/ranger_client.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
@@ -40,6 +42,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flag_validators.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/scoped_cleanup.h"
@@ -98,6 +101,23 @@ DEFINE_bool(ranger_logtostdout, false,
 TAG_FLAG(ranger_logtostdout, advanced);
 TAG_FLAG(ranger_logtostdout, evolving);
 
+DEFINE_uint32(ranger_authz_cache_capacity_mb, 0,
+              "Capacity of the master's cache of the authorization decisions "
+              "made by the Ranger subprocess, in MiB. The cache saves a round "
+              "trip to the subprocess for repeated checks of the same privilege "
+              "of the same user, e.g. when planning queries. Set to 0 to disable "
+              "the cache. Note that with the cache enabled, policy changes may "
+              "take up to --ranger_authz_cache_ttl_sec longer to take effect, "
+              "unless the policies are refreshed via the master.");
+TAG_FLAG(ranger_authz_cache_capacity_mb, advanced);
+TAG_FLAG(ranger_authz_cache_capacity_mb, experimental);
+
+DEFINE_uint32(ranger_authz_cache_ttl_sec, 5,
+              "For how long an authorization decision is kept in the cache "
+              "enabled by --ranger_authz_cache_capacity_mb, in seconds.");
+TAG_FLAG(ranger_authz_cache_ttl_sec, advanced);
+TAG_FLAG(ranger_authz_cache_ttl_sec, experimental);
+
 DECLARE_int32(max_log_files);
 DECLARE_int32(max_log_size);
 DECLARE_string(log_dir);
@@ -171,6 +191,7 @@ using kudu::subprocess::SubprocessMetrics;
 using kudu::subprocess::SubprocessServer;
 using std::move;
 using std::pair;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
@@ -381,8 +402,17 @@ RangerSubprocessMetrics::RangerSubprocessMetrics(const scoped_refptr<MetricEntit
 #undef HISTINIT
 
 RangerClient::RangerClient(Env* env, const scoped_refptr<MetricEntity>& metric_entity)
-    : env_(env), metric_entity_(metric_entity) {
+    : env_(env),
+      metric_entity_(metric_entity),
+      policies_generation_(0) {
   DCHECK(metric_entity);
+  if (FLAGS_ranger_authz_cache_capacity_mb > 0 && FLAGS_ranger_authz_cache_ttl_sec > 0) {
+    decision_cache_.reset(new DecisionCache(
+        FLAGS_ranger_authz_cache_capacity_mb * 1024 * 1024,
+        MonoDelta::FromSeconds(FLAGS_ranger_authz_cache_ttl_sec),
+        MonoDelta::FromSeconds(FLAGS_ranger_authz_cache_ttl_sec),
+        /*max_scrubbed_entries_per_pass_num=*/0, "ranger-authz-cache"));
+  }
 }
 
 Status RangerClient::Start() {
@@ -404,7 +434,6 @@ Status RangerClient::AuthorizeAction(const string& user_name, const ActionPB& ac
                                      Scope scope) {
   DCHECK(subprocess_);
   RangerRequestListPB req_list;
-  RangerResponseListPB resp_list;
   req_list.set_user(user_name);
 
   RangerRequestPB* req = req_list.add_requests();
@@ -418,6 +447,15 @@ Status RangerClient::AuthorizeAction(const string& user_name, const ActionPB& ac
     req->set_table(table);
   }
 
+  if (decision_cache_) {
+    return ExecuteSingleRequestCached(req_list, authorized);
+  }
+  return ExecuteSingleRequest(req_list, authorized);
+}
+
+Status RangerClient::ExecuteSingleRequest(const RangerRequestListPB& req_list,
+                                          bool* authorized) {
+  RangerResponseListPB resp_list;
   RETURN_NOT_OK(subprocess_->Execute(req_list, &resp_list));
 
   CHECK_EQ(1, resp_list.responses_size());
@@ -425,6 +463,53 @@ Status RangerClient::AuthorizeAction(const string& user_name, const ActionPB& ac
   return Status::OK();
 }
 
+Status RangerClient::ExecuteSingleRequestCached(const RangerRequestListPB& req_list,
+                                                bool* authorized) {
+  const string key = Substitute("$0:$1", policies_generation_.load(),
+                                req_list.SerializeAsString());
+  {
+    auto handle = decision_cache_->Get(key);
+    if (handle) {
+      *authorized = handle.value();
+      return Status::OK();
+    }
+  }
+
+  shared_ptr<PendingDecision> pending;
+  bool is_first = false;
+  {
+    std::lock_guard<simple_spinlock> l(pending_lock_);
+    auto& entry = pending_decisions_[key];
+    if (!entry) {
+      entry = std::make_shared<PendingDecision>();
+      is_first = true;
+    }
+    pending = entry;
+  }
+  if (!is_first) {
+    pending->done.Wait();
+    RETURN_NOT_OK(pending->status);
+    *authorized = pending->authorized;
+    return Status::OK();
+  }
+
+  bool decision = false;
+  Status s = ExecuteSingleRequest(req_list, &decision);
+  if (s.ok()) {
+    decision_cache_->Put(key, unique_ptr<bool>(new bool(decision)));
+  }
+  pending->status = s;
+  pending->authorized = decision;
+  {
+    std::lock_guard<simple_spinlock> l(pending_lock_);
+    pending_decisions_.erase(key);
+  }
+  pending->done.CountDown();
+  RETURN_NOT_OK(s);
+  *authorized = decision;
+  return Status::OK();
+}
+
 Status RangerClient::AuthorizeActionMultipleColumns(const string& user_name, const ActionPB& action,
                                                     const string& database, const string& table,
                                                     bool is_owner,
@@ -557,6 +642,7 @@ Status RangerClient::RefreshPolicies() {
     return Status::RemoteError(err);
   }
 
+  policies_generation_++;
   return Status::OK();
 }
 
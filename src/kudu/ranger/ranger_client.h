@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -28,8 +30,11 @@
 #include "kudu/ranger/ranger.pb.h"
 #include "kudu/subprocess/server.h"
 #include "kudu/subprocess/subprocess_proxy.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
+#include "kudu/util/ttl_cache.h"
 
 namespace kudu {
 
@@ -84,6 +89,10 @@ class RangerClient {
 
   // Authorizes an action on the table. Sets 'authorized' to true if it's
   // authorized, false otherwise.
+  //
+  // With --ranger_authz_cache_capacity_mb set, the decision is cached for
+  // --ranger_authz_cache_ttl_sec, and concurrent calls with the same arguments
+  // share a single request to the subprocess.
   Status AuthorizeAction(const std::string& user_name, const ActionPB& action,
                          const std::string& database, const std::string& table, bool is_owner,
                          bool requires_delegate_admin, bool* authorized,
@@ -113,6 +122,8 @@ class RangerClient {
   // Refreshes policies in the Ranger subprocess. This does not invalidate the
   // existing cache and doesn't fail if Ranger service is unavailable, it simply
   // tries to refresh the policies from the server on a best effort basis.
+  // Decisions cached by this client before a successful refresh are no longer
+  // used.
   Status RefreshPolicies() WARN_UNUSED_RESULT;
 
   // Replaces the subprocess server in the subprocess proxy.
@@ -125,9 +136,45 @@ class RangerClient {
   }
 
  private:
+  // A request to the subprocess for an authorization decision, shared by the
+  // concurrent callers asking for the same decision.
+  struct PendingDecision {
+    PendingDecision()
+        : done(1),
+          authorized(false) {
+    }
+
+    // Counted down once 'status' and 'authorized' are set.
+    CountDownLatch done;
+    Status status;
+    bool authorized;
+  };
+
+  typedef TTLCache<std::string, bool> DecisionCache;
+
+  // Sends 'req_list', which has a single request, to the subprocess and sets
+  // 'authorized' to the decision.
+  Status ExecuteSingleRequest(const RangerRequestListPB& req_list, bool* authorized);
+
+  // Like ExecuteSingleRequest(), but uses and populates 'decision_cache_', and
+  // coalesces concurrent calls for the same request.
+  Status ExecuteSingleRequestCached(const RangerRequestListPB& req_list, bool* authorized);
+
   Env* env_;
   std::unique_ptr<RangerSubprocess> subprocess_;
   scoped_refptr<MetricEntity> metric_entity_;
+
+  // The cache of authorization decisions, keyed by the serialized request
+  // prefixed with 'policies_generation_'. Null if caching is disabled.
+  std::unique_ptr<DecisionCache> decision_cache_;
+
+  // Incremented with every successful policy refresh, so that the decisions
+  // cached before it are not used anymore.
+  std::atomic<uint64_t> policies_generation_;
+
+  // The requests in flight, by cache key.
+  simple_spinlock pending_lock_;
+  std::unordered_map<std::string, std::shared_ptr<PendingDecision>> pending_decisions_;
 };
 
 } // namespace ranger
@@ -0,0 +1,98 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/arena_block_pool.h"
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+#include <gtest/gtest.h>
+
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/util/test_util.h"
+
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
+using std::set;
+using std::string;
+using std::thread;
+using std::vector;
+
+namespace kudu {
+namespace rpc {
+
+class ArenaBlockPoolTest : public KuduTest {};
+
+TEST_F(ArenaBlockPoolTest, TestReuseBlocks) {
+  ArenaBlockPool pool(4096, 1);
+  ASSERT_EQ(0, pool.num_pooled_blocks());
+  char* a = pool.Acquire();
+  memset(a, 0xff, pool.block_size());
+  pool.Release(a);
+  ASSERT_EQ(1, pool.num_pooled_blocks());
+
+  // The blocks released beyond the maximum are freed.
+  ArenaBlockPool no_blocks_pool(4096, 0);
+  no_blocks_pool.Release(no_blocks_pool.Acquire());
+  ASSERT_EQ(0, no_blocks_pool.num_pooled_blocks());
+}
+
+// Test arenas allocating messages in pooled blocks, concurrently.
+TEST_F(ArenaBlockPoolTest, TestArenas) {
+  ArenaBlockPool pool(8192, 64);
+  vector<thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < 1000; i++) {
+        ScopedArenaBlock block(&pool);
+        ASSERT_NE(nullptr, block.block());
+        ArenaOptions opts;
+        opts.initial_block = block.block();
+        opts.initial_block_size = block.size();
+        Arena arena(opts);
+        RequestHeader* header = Arena::CreateMessage<RequestHeader>(&arena);
+        header->set_call_id(t * 1000 + i);
+        header->mutable_remote_method()->set_service_name(string(i % 100, 's'));
+        header->mutable_remote_method()->set_method_name("method");
+        // Some messages overflow the initial block.
+        if (i % 10 == 0) {
+          string* big = Arena::Create<string>(&arena, 10000, 'x');
+          ASSERT_EQ(10000, big->size());
+        }
+        ASSERT_EQ(t * 1000 + i, header->call_id());
+        ASSERT_EQ(i % 100, header->remote_method().service_name().size());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_GT(pool.num_pooled_blocks(), 0);
+}
+
+TEST_F(ArenaBlockPoolTest, TestNoPool) {
+  ScopedArenaBlock block(nullptr);
+  ASSERT_EQ(nullptr, block.block());
+  ASSERT_EQ(0, block.size());
+}
+
+} // namespace rpc
+} // namespace kudu
@@ -0,0 +1,128 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/arena_block_pool.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(rpc_pooled_arena_block_bytes, 8 * 1024,
+             "The size of the pooled blocks the protobuf arenas of the inbound "
+             "RPC calls start with, which the requests and responses of most "
+             "calls fit in. 0 disables pooling the blocks.");
+TAG_FLAG(rpc_pooled_arena_block_bytes, advanced);
+TAG_FLAG(rpc_pooled_arena_block_bytes, experimental);
+DEFINE_validator(rpc_pooled_arena_block_bytes, [](const char* /*n*/, int32_t v) {
+  // The arenas keep their bookkeeping in their first block.
+  return v == 0 || v >= 1024;
+});
+
+DEFINE_int32(rpc_max_pooled_arena_blocks, 1024,
+             "The maximum number of the blocks of --rpc_pooled_arena_block_bytes "
+             "kept pooled when not used by inbound RPC calls.");
+TAG_FLAG(rpc_max_pooled_arena_blocks, advanced);
+TAG_FLAG(rpc_max_pooled_arena_blocks, experimental);
+
+namespace kudu {
+namespace rpc {
+
+ArenaBlockPool::ArenaBlockPool(size_t block_size, size_t max_blocks)
+    : block_size_(block_size),
+#if defined(__APPLE__)
+      num_shards_(1),
+#else
+      num_shards_(base::MaxCPUIndex() + 1),
+#endif
+      max_blocks_per_shard_((max_blocks + num_shards_ - 1) / num_shards_),
+      shards_(new Shard[num_shards_]) {
+  CHECK_GT(block_size_, 0);
+}
+
+ArenaBlockPool::~ArenaBlockPool() {
+  for (int i = 0; i < num_shards_; i++) {
+    for (char* block : shards_[i].blocks) {
+      free(block);
+    }
+  }
+}
+
+ArenaBlockPool::Shard* ArenaBlockPool::CurrentShard() {
+#if defined(__APPLE__)
+  return &shards_[0];
+#else
+  const int cpu = sched_getcpu();
+  return &shards_[cpu >= 0 && cpu < num_shards_ ? cpu : 0];
+#endif
+}
+
+char* ArenaBlockPool::Acquire() {
+  Shard* shard = CurrentShard();
+  {
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    if (!shard->blocks.empty()) {
+      char* block = shard->blocks.back();
+      shard->blocks.pop_back();
+      return block;
+    }
+  }
+  return static_cast<char*>(CHECK_NOTNULL(malloc(block_size_)));
+}
+
+void ArenaBlockPool::Release(char* block) {
+  DCHECK(block);
+  Shard* shard = CurrentShard();
+  {
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    if (shard->blocks.size() < max_blocks_per_shard_) {
+      shard->blocks.push_back(block);
+      return;
+    }
+  }
+  free(block);
+}
+
+size_t ArenaBlockPool::num_pooled_blocks() const {
+  size_t num_blocks = 0;
+  for (int i = 0; i < num_shards_; i++) {
+    std::lock_guard<simple_spinlock> l(shards_[i].lock);
+    num_blocks += shards_[i].blocks.size();
+  }
+  return num_blocks;
+}
+
+ArenaBlockPool* ArenaBlockPool::Default() {
+  // The pool is never destroyed: the last calls may be destroyed as late as
+  // the static objects are.
+  static ArenaBlockPool* pool = FLAGS_rpc_pooled_arena_block_bytes > 0 ?
+      new ArenaBlockPool(FLAGS_rpc_pooled_arena_block_bytes,
+                         std::max(FLAGS_rpc_max_pooled_arena_blocks, 0)) :
+      nullptr;
+  return pool;
+}
+
+} // namespace rpc
+} // namespace kudu
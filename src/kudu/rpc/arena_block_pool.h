@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/locks.h"
+
+namespace kudu {
+namespace rpc {
+
+// A pool of fixed-size memory blocks for the protobuf arenas of the inbound
+// calls to start with.
+//
+// The request and response of each inbound call are allocated on the call's
+// arena, which would otherwise malloc its first block for every call and free
+// it as the call is destroyed. Most calls fit in a pooled block entirely, so
+// that their messages don't cost a trip to the allocator at all.
+//
+// The pool is sharded by CPU, each shard keeping at most its share of the
+// blocks: the blocks beyond that are freed when released.
+//
+// Thread-safe.
+class ArenaBlockPool {
+ public:
+  ArenaBlockPool(size_t block_size, size_t max_blocks);
+  ~ArenaBlockPool();
+
+  // Returns a block of block_size() bytes, a pooled one if there is any.
+  char* Acquire();
+
+  // Returns 'block', acquired from this pool, to the pool.
+  void Release(char* block);
+
+  size_t block_size() const { return block_size_; }
+
+  // Returns the number of blocks in the pool, which aren't acquired.
+  size_t num_pooled_blocks() const;
+
+  // Returns the pool of the inbound calls, or nullptr if the inbound calls
+  // don't use pooled blocks. See --rpc_pooled_arena_block_bytes.
+  static ArenaBlockPool* Default();
+
+ private:
+  struct Shard {
+    mutable simple_spinlock lock;
+    std::vector<char*> blocks;
+  } CACHELINE_ALIGNED;
+
+  Shard* CurrentShard();
+
+  const size_t block_size_;
+  const int num_shards_;
+  const size_t max_blocks_per_shard_;
+  std::unique_ptr<Shard[]> shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArenaBlockPool);
+};
+
+// A block acquired from an ArenaBlockPool for the lifetime of the object,
+// which must outlive the arena using the block.
+class ScopedArenaBlock {
+ public:
+  // Acquires a block from 'pool', unless it's nullptr.
+  explicit ScopedArenaBlock(ArenaBlockPool* pool)
+      : pool_(pool),
+        block_(pool ? pool->Acquire() : nullptr) {
+  }
+
+  ~ScopedArenaBlock() {
+    if (block_) {
+      pool_->Release(block_);
+    }
+  }
+
+  // Returns the block, or nullptr if there is no pool.
+  char* block() const { return block_; }
+
+  size_t size() const { return pool_ ? pool_->block_size() : 0; }
+
+ private:
+  ArenaBlockPool* const pool_;
+  char* const block_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedArenaBlock);
+};
+
+} // namespace rpc
+} // namespace kudu
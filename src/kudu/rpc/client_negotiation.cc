@@ -191,7 +191,16 @@ Status ClientNegotiation::Negotiate(unique_ptr<ErrorStatusPB>* rpc_error) {
   // TODO(KUDU-1921): allow the client to require TLS.
   if (encryption_ != RpcEncryption::DISABLED &&
       ContainsKey(server_features_, TLS)) {
-    RETURN_NOT_OK(tls_context_->InitiateHandshake(&tls_handshake_));
+    // If the server supports it, resume the TLS session last established
+    // with it, if any.
+    string session_key;
+    if (ContainsKey(server_features_, TLS_SESSION_RESUMPTION)) {
+      Sockaddr addr;
+      if (socket_->GetPeerAddress(&addr).ok()) {
+        session_key = addr.ToString();
+      }
+    }
+    RETURN_NOT_OK(tls_context_->InitiateHandshake(&tls_handshake_, session_key));
 
     if (negotiated_authn_ == AuthenticationType::SASL) {
       // When using SASL authentication, verifying the server's certificate is
@@ -507,6 +516,9 @@ Status ClientNegotiation::HandleTlsHandshake(const NegotiatePB& response) {
   RETURN_NOT_OK(s);
 
   // TLS handshake is finished.
+  if (tls_handshake_.session_reused()) {
+    TRACE("Resumed TLS session");
+  }
   if (ContainsKey(server_features_, TLS_AUTHENTICATION_ONLY) &&
       ContainsKey(client_features_, TLS_AUTHENTICATION_ONLY)) {
     TRACE("Negotiated auth-only $0 with cipher $1",
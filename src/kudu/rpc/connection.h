@@ -237,6 +237,11 @@ class Connection : public RefCountedThreadSafe<Connection> {
     remote_features_ = std::move(remote_features);
   }
 
+  // Whether the remote side advertised 'feature' during negotiation.
+  bool remote_supports_feature(RpcFeatureFlag feature) const {
+    return remote_features_.count(feature) > 0;
+  }
+
   void set_remote_user(RemoteUser user) {
     DCHECK_EQ(direction_, SERVER);
     remote_user_ = std::move(user);
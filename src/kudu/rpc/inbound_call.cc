@@ -23,12 +23,14 @@
 #include <ostream>
 
 #include <boost/container/vector.hpp>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/message.h>
 #include <google/protobuf/message_lite.h>
 
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
@@ -36,10 +38,15 @@
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/trace.h"
+#include "kudu/util/trace_context.h"
 
 namespace google {
 namespace protobuf {
@@ -55,12 +62,35 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+DEFINE_bool(rpc_compress_sidecars, false,
+            "Whether to compress the sidecars of responses to RPC methods which "
+            "opt into it, such as scans, when the client supports it. This "
+            "trades CPU on both sides for network bandwidth.");
+TAG_FLAG(rpc_compress_sidecars, experimental);
+TAG_FLAG(rpc_compress_sidecars, runtime);
+
+DEFINE_int32(rpc_compress_sidecars_min_bytes, 64 * 1024,
+             "Responses whose sidecars total fewer bytes than this are not "
+             "compressed. See --rpc_compress_sidecars.");
+TAG_FLAG(rpc_compress_sidecars_min_bytes, experimental);
+TAG_FLAG(rpc_compress_sidecars_min_bytes, runtime);
+
+DEFINE_string(rpc_sidecar_compression_codec, "lz4",
+              "The codec used to compress response sidecars if "
+              "--rpc_compress_sidecars is set. One of 'lz4', 'snappy', 'zlib' "
+              "or 'zstd'.");
+TAG_FLAG(rpc_sidecar_compression_codec, experimental);
+
 namespace kudu {
 namespace rpc {
 
-static ArenaOptions MakeArenaOptions() {
+static ArenaOptions MakeArenaOptions(const ScopedArenaBlock& initial_block) {
   ArenaOptions opts;
   opts.start_block_size = 4096;
+  if (initial_block.block()) {
+    opts.initial_block = initial_block.block();
+    opts.initial_block_size = initial_block.size();
+  }
   return opts;
 }
 
@@ -69,7 +99,8 @@ InboundCall::InboundCall(Connection* conn)
     trace_(new Trace),
     method_info_(nullptr),
     deadline_(MonoTime::Max()),
-    arena_(MakeArenaOptions()) {
+    arena_block_(ArenaBlockPool::Default()),
+    arena_(MakeArenaOptions(arena_block_)) {
   RecordCallReceived();
 }
 
@@ -90,6 +121,19 @@ Status InboundCall::ParseFrom(unique_ptr<InboundTransfer> transfer) {
   }
   remote_method_.FromPB(header_.remote_method());
 
+  // Calls made on behalf of a sampled distributed trace handle the call in a
+  // child span of the caller's.
+  if (PREDICT_FALSE(header_.has_trace_context())) {
+    TraceContext caller;
+    caller.trace_id_high = header_.trace_context().trace_id_high();
+    caller.trace_id_low = header_.trace_context().trace_id_low();
+    caller.span_id = header_.trace_context().span_id();
+    caller.sampled = true;
+    if (caller.IsValid()) {
+      trace_->set_trace_context(caller.NewChild());
+    }
+  }
+
   // Compute and cache the call deadline.
   if (header_.has_timeout_millis() && header_.timeout_millis() != 0) {
     deadline_ = timing_.time_received + MonoDelta::FromMilliseconds(header_.timeout_millis());
@@ -170,6 +214,20 @@ void InboundCall::Respond(const MessageLite& response,
                          "method", remote_method_.method_name());
   TRACE_TO(trace_, "Queueing $0 response", is_success ? "success" : "failure");
   RecordHandlingCompleted();
+  if (PREDICT_FALSE(trace_->trace_context().sampled)) {
+    TraceSpan span;
+    span.context = trace_->trace_context();
+    span.kind = TraceSpan::SERVER;
+    span.name = remote_method_.ToString();
+    span.peer = remote_address().ToString();
+    const MonoDelta duration = timing_.time_completed - timing_.time_received;
+    span.start_time_unix_micros = GetCurrentTimeMicros() - duration.ToMicroseconds();
+    span.duration_micros = duration.ToMicroseconds();
+    if (!is_success) {
+      span.error = "RPC failed";
+    }
+    ExportTraceSpan(span);
+  }
   conn_->rpcz_store()->AddCall(this);
   conn_->QueueResponseForCall(unique_ptr<InboundCall>(this));
 }
@@ -200,6 +258,16 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
     sidecar_byte_size += sidecar_bytes;
   }
 
+  if (is_success && ShouldCompressSidecars(sidecar_byte_size)) {
+    const int32_t compressed_size = CompressSidecars(sidecar_byte_size);
+    if (compressed_size > 0) {
+      resp_hdr.set_sidecars_compression(
+          GetCompressionCodecType(FLAGS_rpc_sidecar_compression_codec));
+      resp_hdr.set_uncompressed_sidecars_size(sidecar_byte_size);
+      sidecar_byte_size = compressed_size;
+    }
+  }
+
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   sidecar_byte_size, true);
   int64_t main_msg_size = sidecar_byte_size + response_msg_buf_.size();
@@ -213,11 +281,56 @@ void InboundCall::SerializeResponseTo(TransferPayload* slices) const {
   DCHECK_GT(response_msg_buf_.size(), 0);
   slices->push_back(Slice(response_hdr_buf_));
   slices->push_back(Slice(response_msg_buf_));
+  if (sidecars_compressed_) {
+    slices->push_back(Slice(compressed_sidecars_buf_));
+    return;
+  }
   for (auto& sidecar : outbound_sidecars_) {
     sidecar->AppendSlices(slices);
   }
 }
 
+bool InboundCall::ShouldCompressSidecars(int32_t sidecar_byte_size) const {
+  return FLAGS_rpc_compress_sidecars &&
+      sidecar_byte_size >= FLAGS_rpc_compress_sidecars_min_bytes &&
+      method_info_ && method_info_->compress_sidecars &&
+      conn_ && conn_->remote_supports_feature(RpcFeatureFlag::SIDECAR_COMPRESSION);
+}
+
+int32_t InboundCall::CompressSidecars(int32_t sidecar_byte_size) {
+  TRACE_EVENT0("rpc", "InboundCall::CompressSidecars");
+  const CompressionCodec* codec;
+  Status s = GetCompressionCodec(
+      GetCompressionCodecType(FLAGS_rpc_sidecar_compression_codec), &codec);
+  if (PREDICT_FALSE(!s.ok() || codec == nullptr)) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << "unable to get sidecar compression codec "
+                                   << FLAGS_rpc_sidecar_compression_codec << ": "
+                                   << s.ToString() << THROTTLE_MSG;
+    return 0;
+  }
+  TransferPayload payload;
+  for (const auto& sidecar : outbound_sidecars_) {
+    sidecar->AppendSlices(&payload);
+  }
+  const vector<Slice> input(payload.begin(), payload.end());
+  compressed_sidecars_buf_.resize(codec->MaxCompressedLength(sidecar_byte_size));
+  size_t compressed_size;
+  s = codec->Compress(input, compressed_sidecars_buf_.data(), &compressed_size);
+  if (PREDICT_FALSE(!s.ok())) {
+    KLOG_EVERY_N_SECS(WARNING, 60) << "unable to compress response sidecars: "
+                                   << s.ToString() << THROTTLE_MSG;
+    return 0;
+  }
+  // If the data doesn't compress, send it as is.
+  if (compressed_size >= static_cast<size_t>(sidecar_byte_size)) {
+    compressed_sidecars_buf_.clear();
+    return 0;
+  }
+  compressed_sidecars_buf_.resize(compressed_size);
+  sidecars_compressed_ = true;
+  return compressed_size;
+}
+
 Status InboundCall::AddOutboundSidecar(unique_ptr<RpcSidecar> car, int* idx) {
   // Check that the number of sidecars does not exceed the number of payload
   // slices that are free (two are used up by the header and main message
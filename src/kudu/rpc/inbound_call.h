@@ -29,6 +29,7 @@
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/rpc/arena_block_pool.h"
 #include "kudu/rpc/remote_method.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
@@ -234,6 +235,14 @@ class InboundCall {
   void SerializeResponseBuffer(const google::protobuf::MessageLite& response,
                                bool is_success);
 
+  // Whether the response sidecars, 'sidecar_byte_size' bytes in total, should
+  // be compressed (see --rpc_compress_sidecars).
+  bool ShouldCompressSidecars(int32_t sidecar_byte_size) const;
+
+  // Compresses the response sidecars into 'compressed_sidecars_buf_',
+  // returning the compressed size, or 0 if they are to be sent uncompressed.
+  int32_t CompressSidecars(int32_t sidecar_byte_size);
+
   // When RPC call Handle() completed execution on the server side.
   // Updates the Histogram with time elapsed since the call was started,
   // and should only be called once on a given instance.
@@ -259,6 +268,11 @@ class InboundCall {
   faststring response_hdr_buf_;
   faststring response_msg_buf_;
 
+  // If the response sidecars are compressed, the compressed block which is
+  // sent in place of them.
+  faststring compressed_sidecars_buf_;
+  bool sidecars_compressed_ = false;
+
   // Vector of additional sidecars that are tacked on to the call's response
   // after serialization of the protobuf. See rpc/rpc_sidecar.h for more info.
   std::vector<std::unique_ptr<RpcSidecar>> outbound_sidecars_;
@@ -290,6 +304,11 @@ class InboundCall {
   // client did not pass a timeout.
   MonoTime deadline_;
 
+  // The pooled block 'arena_' starts with, which is returned to the pool only
+  // once the arena is destroyed, after the response is sent.
+  ScopedArenaBlock arena_block_;
+
+  // The arena of the call's request and response.
   google::protobuf::Arena arena_;
 
   DISALLOW_COPY_AND_ASSIGN(InboundCall);
@@ -24,6 +24,7 @@
 #include <string>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
@@ -53,6 +54,8 @@
 #include "kudu/util/thread_restrictions.h"
 #include "kudu/util/threadpool.h"
 
+DECLARE_bool(rpc_reactor_cpu_affinity);
+
 using kudu::security::RpcAuthentication;
 using kudu::security::RpcEncryption;
 using std::string;
@@ -305,7 +308,19 @@ void Messenger::QueueCancellation(const shared_ptr<OutboundCall> &call) {
 }
 
 void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote) {
-  Reactor *reactor = RemoteToReactor(remote);
+  Reactor *reactor = nullptr;
+  if (FLAGS_rpc_reactor_cpu_affinity) {
+    // Reactor i runs on the CPUs whose index is i modulo the number of
+    // reactors: pick the one allowed to run where the connection's packets
+    // are processed.
+    int cpu = -1;
+    if (new_socket->GetIncomingCpu(&cpu).ok() && cpu >= 0) {
+      reactor = reactors_[cpu % reactors_.size()];
+    }
+  }
+  if (!reactor) {
+    reactor = RemoteToReactor(remote);
+  }
   reactor->RegisterInboundSocket(new_socket, remote);
 }
 
@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -43,9 +44,15 @@
 #include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/kernel_stack_watchdog.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/trace.h"
+#include "kudu/util/trace_context.h"
 
 // 100M cycles should be about 50ms on a 2Ghz box. This should be high
 // enough that involuntary context switches don't trigger it, but low enough
@@ -58,6 +65,15 @@ TAG_FLAG(rpc_callback_max_cycles, advanced);
 TAG_FLAG(rpc_callback_max_cycles, runtime);
 
 // Flag used in debug build for injecting cancellation at different code paths.
+DEFINE_double(rpc_trace_sample_rate, 0,
+              "The fraction of outbound RPCs which start a new sampled distributed "
+              "trace, when not already made on behalf of a sampled trace. The context "
+              "of sampled traces is propagated to the servers handling the calls, and "
+              "the spans of the calls are exported to the process's trace sink, which "
+              "logs them by default.");
+TAG_FLAG(rpc_trace_sample_rate, experimental);
+TAG_FLAG(rpc_trace_sample_rate, runtime);
+
 DEFINE_int32(rpc_inject_cancellation_state, -1,
              "If this flag is not -1, it is the state in which a cancellation request "
              "will be injected. Should use values in OutboundCall::State only");
@@ -75,6 +91,15 @@ using strings::Substitute;
 
 static const double kMicrosPerSecond = 1000000.0;
 
+namespace {
+
+ThreadSafeRandom* TraceSampler() {
+  static ThreadSafeRandom* rng = new ThreadSafeRandom(GetRandomSeed32());
+  return rng;
+}
+
+} // anonymous namespace
+
 ///
 /// OutboundCall
 ///
@@ -108,6 +133,24 @@ OutboundCall::OutboundCall(const ConnectionId& conn_id,
   if (controller_->request_id_) {
     payload_->header_.set_allocated_request_id(controller_->request_id_.release());
   }
+
+  // Calls made on behalf of a sampled trace are child spans of it. Otherwise,
+  // a fraction of the calls start new traces.
+  const Trace* trace = Trace::CurrentTrace();
+  if (trace && trace->trace_context().sampled) {
+    trace_context_ = trace->trace_context().NewChild();
+  } else if (PREDICT_FALSE(FLAGS_rpc_trace_sample_rate > 0) &&
+             TraceSampler()->Next() < FLAGS_rpc_trace_sample_rate *
+                 static_cast<double>(std::numeric_limits<uint32_t>::max())) {
+    trace_context_ = TraceContext::NewRoot();
+  }
+  if (PREDICT_FALSE(trace_context_.sampled)) {
+    start_time_unix_micros_ = GetCurrentTimeMicros();
+    TraceContextPB* pb = payload_->header_.mutable_trace_context();
+    pb->set_trace_id_high(trace_context_.trace_id_high);
+    pb->set_trace_id_low(trace_context_.trace_id_low);
+    pb->set_span_id(trace_context_.span_id);
+  }
 }
 
 
@@ -298,6 +341,21 @@ void OutboundCall::Cancel() {
 }
 
 void OutboundCall::CallCallback() {
+  if (PREDICT_FALSE(trace_context_.sampled)) {
+    TraceSpan span;
+    span.context = trace_context_;
+    span.kind = TraceSpan::CLIENT;
+    span.name = remote_method_.ToString();
+    span.peer = conn_id_.remote().ToString();
+    span.start_time_unix_micros = start_time_unix_micros_;
+    span.duration_micros = (MonoTime::Now() - start_time_).ToMicroseconds();
+    const Status s = status();
+    if (!s.ok()) {
+      span.error = s.ToString();
+    }
+    ExportTraceSpan(span);
+  }
+
   // Clear references to outbound sidecars before invoking callback.
   if (cb_behavior_ == CallbackBehavior::kFreeSidecars) {
     FreeSidecars();
@@ -551,6 +609,9 @@ Status CallResponse::ParseFrom(unique_ptr<InboundTransfer> transfer) {
   CHECK(!parsed_);
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &serialized_response_));
+  if (header_.has_sidecars_compression()) {
+    RETURN_NOT_OK(DecompressSidecars());
+  }
 
   // Use information from header to extract the payload slices.
   RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(),
@@ -566,5 +627,33 @@ Status CallResponse::ParseFrom(unique_ptr<InboundTransfer> transfer) {
   return Status::OK();
 }
 
+Status CallResponse::DecompressSidecars() {
+  if (PREDICT_FALSE(header_.sidecar_offsets_size() == 0 ||
+                    header_.sidecar_offsets(0) > serialized_response_.size())) {
+    return Status::Corruption("compressed sidecars without valid sidecar offsets");
+  }
+  const uint32_t msg_size = header_.sidecar_offsets(0);
+  const uint32_t uncompressed_size = header_.uncompressed_sidecars_size();
+  if (PREDICT_FALSE(uncompressed_size > FLAGS_rpc_max_message_size)) {
+    return Status::Corruption(Substitute(
+        "uncompressed sidecars of $0 bytes would exceed the maximum message size",
+        uncompressed_size));
+  }
+  const CompressionCodec* codec;
+  RETURN_NOT_OK(GetCompressionCodec(header_.sidecars_compression(), &codec));
+  if (PREDICT_FALSE(codec == nullptr)) {
+    return Status::Corruption("sidecars compressed without a codec");
+  }
+  decompressed_buf_.resize(msg_size + uncompressed_size);
+  memcpy(decompressed_buf_.data(), serialized_response_.data(), msg_size);
+  Slice compressed(serialized_response_.data() + msg_size,
+                   serialized_response_.size() - msg_size);
+  RETURN_NOT_OK_PREPEND(codec->Uncompress(compressed, decompressed_buf_.data() + msg_size,
+                                          uncompressed_size),
+                        "unable to decompress response sidecars");
+  serialized_response_ = Slice(decompressed_buf_);
+  return Status::OK();
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -40,6 +40,7 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace_context.h"
 
 DECLARE_int32(rpc_inject_cancellation_state);
 
@@ -280,6 +281,11 @@ class OutboundCall {
   // Time when the call was first initiatied.
   MonoTime start_time_;
 
+  // The context of the call's span, if the call is part of a sampled
+  // distributed trace.
+  TraceContext trace_context_;
+  int64_t start_time_unix_micros_ = 0;
+
   // Return the error protobuf, if a remote error occurred.
   // This will only be non-NULL if status().IsRemoteError().
   const ErrorStatusPB* error_pb() const;
@@ -367,6 +373,10 @@ class CallResponse {
   Status GetSidecar(int idx, Slice* sidecar) const;
 
  private:
+  // Decompresses the sidecars following the response message into
+  // 'decompressed_buf_', pointing 'serialized_response_' at it.
+  Status DecompressSidecars();
+
   // True once ParseFrom() is called.
   bool parsed_;
 
@@ -384,6 +394,11 @@ class CallResponse {
   // and sidecar_slices_ refer into its data.
   std::unique_ptr<InboundTransfer> transfer_;
 
+  // If the response sidecars were compressed, the response message followed
+  // by the decompressed sidecars. serialized_response_ and sidecar_slices_
+  // then refer into this buffer instead of transfer_.
+  faststring decompressed_buf_;
+
   DISALLOW_COPY_AND_ASSIGN(CallResponse);
 };
 
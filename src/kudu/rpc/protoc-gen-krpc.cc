@@ -173,6 +173,9 @@ class MethodSubstitutions : public Substituter {
     m["metric_enum_key"] = Substitute("kMetricIndex$0", method_->name());
     bool track_result = static_cast<bool>(method_->options().GetExtension(track_rpc_result));
     m["track_result"] = track_result ? " true" : "false";
+    m["queue_priority"] = std::to_string(method_->options().GetExtension(queue_priority));
+    m["compress_sidecars"] =
+        method_->options().GetExtension(compress_sidecars) ? "true" : "false";
     m["authz_method"] = GetAuthzMethod(*method_).get_value_or("AuthorizeAllowAll");
   }
 
@@ -504,6 +507,8 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
             "          ctx);\n"
             "    };\n"
             "    mi->track_result = $track_result$;\n"
+            "    mi->queue_priority = $queue_priority$;\n"
+            "    mi->compress_sidecars = $compress_sidecars$;\n"
             "    mi->handler_latency_histogram =\n"
             "        METRIC_handler_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
             "    mi->queue_overflow_rejections =\n"
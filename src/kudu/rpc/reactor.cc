@@ -19,6 +19,10 @@
 
 #include <openssl/crypto.h>
 #include <openssl/err.h> // IWYU pragma: keep
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 #include <sys/socket.h>
 
 #include <cerrno>
@@ -49,6 +53,7 @@
 #include "kudu/rpc/rpc_introspection.pb.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/sanitizer_scopes.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -101,6 +106,15 @@ TAG_FLAG(tcp_keepalive_probe_period_s, advanced);
 TAG_FLAG(tcp_keepalive_retry_period_s, advanced);
 TAG_FLAG(tcp_keepalive_retry_count, advanced);
 
+DEFINE_bool(rpc_reactor_cpu_affinity, false,
+            "Whether to pin each reactor thread to its own subset of the CPUs: "
+            "reactor i of N runs on the CPUs whose index is i modulo N. Inbound "
+            "connections are then handed to the reactor allowed to run on the "
+            "CPU which processes the connection's incoming packets, so that a "
+            "connection's network and RPC processing stays on the same core. "
+            "Only supported on Linux.");
+TAG_FLAG(rpc_reactor_cpu_affinity, experimental);
+
 METRIC_DEFINE_histogram(server, reactor_load_percent,
                         "Reactor Thread Load Percentage",
                         kudu::MetricUnit::kUnits,
@@ -156,6 +170,7 @@ ReactorThread::ReactorThread(Reactor* reactor, const MessengerBuilder& bld)
     reactor_(reactor),
     connection_keepalive_time_(bld.connection_keepalive_time_),
     coarse_timer_granularity_(bld.coarse_timer_granularity_),
+    num_reactors_(bld.num_reactors_),
     total_client_conns_cnt_(0),
     total_server_conns_cnt_(0),
     rng_(GetRandomSeed32()) {
@@ -499,6 +514,9 @@ bool ReactorThread::IsCurrentThread() const {
 void ReactorThread::RunThread() {
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
+  if (FLAGS_rpc_reactor_cpu_affinity) {
+    SetCpuAffinity();
+  }
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
   loop_.run(0);
   VLOG(1) << name() << " thread exiting.";
@@ -508,6 +526,23 @@ void ReactorThread::RunThread() {
   reactor_->messenger_.reset();
 }
 
+void ReactorThread::SetCpuAffinity() {
+#if defined(__linux__)
+  const int num_cpus = base::NumCPUs();
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (int cpu = reactor_->index_ % num_cpus; cpu < num_cpus; cpu += num_reactors_) {
+    CPU_SET(cpu, &cpus);
+  }
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (err != 0) {
+    LOG(WARNING) << name() << ": unable to set CPU affinity: " << ErrnoToString(err);
+  }
+#else
+  LOG(WARNING) << name() << ": CPU affinity of reactor threads is not supported";
+#endif
+}
+
 bool ReactorThread::FindConnection(const ConnectionId& conn_id,
                                    CredentialsPolicy cred_policy,
                                    scoped_refptr<Connection>* conn) {
@@ -762,6 +797,7 @@ Reactor::Reactor(shared_ptr<Messenger> messenger,
                  int index, const MessengerBuilder& bld)
     : messenger_(std::move(messenger)),
       name_(StringPrintf("%s_R%03d", messenger_->name().c_str(), index)),
+      index_(index),
       closing_(false),
       thread_(this, bld) {
   static std::once_flag libev_once;
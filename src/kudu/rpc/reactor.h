@@ -207,6 +207,10 @@ class ReactorThread {
   // Run the main event loop of the reactor.
   void RunThread();
 
+  // Pin the current thread to the CPUs assigned to this reactor
+  // (see --rpc_reactor_cpu_affinity).
+  void SetCpuAffinity();
+
   // When libev has noticed that it needs to wake up an application watcher,
   // it calls this callback. The callback simply calls back into libev's
   // ev_invoke_pending() to trigger all the watcher callbacks, but
@@ -310,6 +314,10 @@ class ReactorThread {
   // Scan for idle connections on this granularity.
   const MonoDelta coarse_timer_granularity_;
 
+  // The number of reactors of the messenger, used to compute this thread's
+  // CPU affinity.
+  const int num_reactors_;
+
   // Metrics.
   scoped_refptr<Histogram> invoke_us_histogram_;
   scoped_refptr<Histogram> load_percent_histogram_;
@@ -413,6 +421,9 @@ class Reactor {
 
   const std::string name_;
 
+  // The index of this reactor among the messenger's reactors.
+  const int index_;
+
   // Whether the reactor is shutting down.
   // Guarded by lock_.
   bool closing_;
@@ -268,7 +268,7 @@ bool RetriableRpc<Server, RequestPB, ResponsePB>::RetryIfNeeded(
   }
   resp_.Clear();
   current_ = nullptr;
-  mutable_retrier()->DelayedRetry(this, result.status);
+  mutable_retrier()->DelayedRetry(this, result.status, result.retry_after);
   return true;
 }
 
@@ -15,10 +15,12 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <memory>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <utility>
@@ -30,31 +32,49 @@
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/rpc/response_callback.h"
 #include "kudu/rpc/rpc-test-base.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rtest.pb.h"
 #include "kudu/rpc/rtest.proxy.h"
+#include "kudu/rpc/service_pool.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
 #include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonwriter.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/random.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+using kudu::rpc_test::EchoRequestPB;
+using kudu::rpc_test::EchoResponsePB;
+using kudu::rpc_test::SendRepeatedStringRequestPB;
+using kudu::rpc_test::SendRepeatedStringResponsePB;
+using std::ostringstream;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::thread;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 DEFINE_int32(client_threads, 16,
              "Number of client threads. For the synchronous benchmark, each thread has "
              "a single outstanding synchronous request at a time. For the async "
-             "benchmark, this determines the number of client reactors.");
+             "benchmark, this determines the number of client reactors. Each client "
+             "thread or reactor has its own messenger and thus its own connection to "
+             "the server, so this also determines the connection fan-in of the server.");
 
 DEFINE_int32(async_call_concurrency, 60,
              "Number of concurrent requests that will be outstanding at a time for the "
@@ -69,6 +89,30 @@ DEFINE_int32(server_reactors, 4,
 
 DEFINE_int32(run_seconds, 1, "Seconds to run the test");
 
+DEFINE_string(workload, "add",
+              "The calls to benchmark: 'add' sends tiny requests and responses, "
+              "'echo' sends requests echoed back in responses with payloads sized "
+              "per --payload_sizes, and 'sidecar' sends tiny requests answered with "
+              "a sidecar sized per --payload_sizes.");
+
+DEFINE_string(payload_sizes, "1024",
+              "The distribution of payload sizes of the 'echo' and 'sidecar' workloads, "
+              "as a comma-separated list of <bytes>:<weight> pairs, e.g. "
+              "'128:90,65536:9,4194304:1'. A size without a weight has weight 1.");
+
+DEFINE_string(results_file, "",
+              "If set, the results of each benchmark run are appended to this file as "
+              "a JSON object per line, including HDR histograms of the call latency as "
+              "seen by the clients and of the server reactors' load and latency.");
+
+DEFINE_string(scaling_server_reactors, "1,4",
+              "Comma-separated numbers of server reactor threads to run the "
+              "scaling benchmark with.");
+
+DEFINE_string(scaling_worker_threads, "1,4",
+              "Comma-separated numbers of server worker threads to run the "
+              "scaling benchmark with.");
+
 DECLARE_bool(rpc_encrypt_loopback_connections);
 DEFINE_bool(enable_encryption, false, "Whether to enable TLS encryption for rpc-bench");
 
@@ -78,6 +122,128 @@ METRIC_DECLARE_histogram(reactor_active_latency_us);
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+enum class Workload {
+  ADD,
+  ECHO,
+  SIDECAR,
+};
+
+Status ParseWorkload(const string& name, Workload* workload) {
+  if (name == "add") {
+    *workload = Workload::ADD;
+  } else if (name == "echo") {
+    *workload = Workload::ECHO;
+  } else if (name == "sidecar") {
+    *workload = Workload::SIDECAR;
+  } else {
+    return Status::InvalidArgument("unknown workload", name);
+  }
+  return Status::OK();
+}
+
+Status ParseIntList(const string& list, vector<int>* values) {
+  values->clear();
+  vector<string> elems = strings::Split(list, ",", strings::SkipEmpty());
+  for (const string& elem : elems) {
+    int32_t value;
+    if (!safe_strto32(elem, &value) || value <= 0) {
+      return Status::InvalidArgument("invalid positive integer", elem);
+    }
+    values->push_back(value);
+  }
+  if (values->empty()) {
+    return Status::InvalidArgument("empty list");
+  }
+  return Status::OK();
+}
+
+// A distribution of payload sizes, as specified by --payload_sizes.
+class PayloadSizes {
+ public:
+  Status Parse(const string& spec) {
+    cdf_.clear();
+    double total_weight = 0;
+    vector<string> elems = strings::Split(spec, ",", strings::SkipEmpty());
+    for (const string& elem : elems) {
+      vector<string> size_and_weight = strings::Split(elem, ":");
+      uint64_t size;
+      double weight = 1;
+      if (size_and_weight.size() > 2 ||
+          !safe_strtou64(size_and_weight[0], &size) ||
+          (size_and_weight.size() == 2 && !safe_strtod(size_and_weight[1], &weight)) ||
+          weight <= 0) {
+        return Status::InvalidArgument("invalid payload size", elem);
+      }
+      total_weight += weight;
+      cdf_.emplace_back(total_weight, size);
+      max_ = std::max<size_t>(max_, size);
+    }
+    if (cdf_.empty()) {
+      return Status::InvalidArgument("no payload sizes", spec);
+    }
+    for (auto& point : cdf_) {
+      point.first /= total_weight;
+    }
+    return Status::OK();
+  }
+
+  size_t Sample(Random* rng) const {
+    const double p = rng->NextDoubleFraction();
+    for (const auto& point : cdf_) {
+      if (p < point.first) {
+        return point.second;
+      }
+    }
+    return cdf_.back().second;
+  }
+
+  size_t max() const {
+    return max_;
+  }
+
+ private:
+  // Pairs of cumulative probability and payload size.
+  vector<pair<double, size_t>> cdf_;
+  size_t max_ = 0;
+};
+
+void HistogramToJson(const HdrHistogram& hist, JsonWriter* jw) {
+  jw->StartObject();
+  jw->String("count");
+  jw->Uint64(hist.TotalCount());
+  if (hist.TotalCount() > 0) {
+    jw->String("min");
+    jw->Uint64(hist.MinValue());
+    jw->String("mean");
+    jw->Double(hist.MeanValue());
+    for (const auto& p : vector<pair<const char*, double>>{
+        {"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99_9", 99.9}, {"p99_99", 99.99}}) {
+      jw->String(p.first);
+      jw->Uint64(hist.ValueAtPercentile(p.second));
+    }
+    jw->String("max");
+    jw->Uint64(hist.MaxValue());
+  }
+  // Every recorded value with its count, enough to rebuild the histogram.
+  jw->String("values");
+  jw->StartArray();
+  RecordedValuesIterator iter(&hist);
+  while (iter.HasNext()) {
+    HistogramIterationValue value;
+    CHECK_OK(iter.Next(&value));
+    jw->StartArray();
+    jw->Uint64(value.value_iterated_to);
+    jw->Uint64(value.count_at_value_iterated_to);
+    jw->EndArray();
+  }
+  jw->EndArray();
+  jw->EndObject();
+}
+
+} // anonymous namespace
+
 class RpcBench : public RpcTestBase {
  public:
   RpcBench()
@@ -89,6 +255,13 @@ class RpcBench : public RpcTestBase {
     RpcTestBase::SetUp();
     OverrideFlagForSlowTests("run_seconds", "10");
 
+    ASSERT_OK(ParseWorkload(FLAGS_workload, &workload_));
+    ASSERT_OK(payload_sizes_.Parse(FLAGS_payload_sizes));
+    if (workload_ == Workload::ECHO) {
+      payload_.assign(payload_sizes_.max(), 'x');
+    }
+    ResetLatencyHistogram();
+
     n_worker_threads_ = FLAGS_worker_threads;
     n_server_reactor_threads_ = FLAGS_server_reactors;
 
@@ -97,6 +270,24 @@ class RpcBench : public RpcTestBase {
     ASSERT_OK(StartTestServerWithGeneratedCode(&server_addr_, FLAGS_enable_encryption));
   }
 
+  // Restarts the server with the given numbers of reactor and worker threads,
+  // and with fresh metrics.
+  Status RestartServer(int server_reactors, int worker_threads) {
+    server_messenger_->UnregisterService(service_name_);
+    service_pool_->Shutdown();
+    service_pool_.reset();
+    server_messenger_->Shutdown();
+    server_messenger_.reset();
+
+    n_server_reactor_threads_ = server_reactors;
+    n_worker_threads_ = worker_threads;
+    metric_entity_ = METRIC_ENTITY_server.Instantiate(
+        &metric_registry_, Substitute("test.rpc_bench.$0-$1", server_reactors, worker_threads));
+    ResetLatencyHistogram();
+    server_addr_ = Sockaddr();
+    return StartTestServerWithGeneratedCode(&server_addr_, FLAGS_enable_encryption);
+  }
+
   void SummarizePerf(CpuTimes elapsed, int total_reqs, bool sync) {
     float reqs_per_second = static_cast<float>(total_reqs / elapsed.wall_seconds());
     float user_cpu_micros_per_req = static_cast<float>(elapsed.user / 1000.0 / total_reqs);
@@ -116,33 +307,206 @@ class RpcBench : public RpcTestBase {
       LOG(INFO) << "Call concurrency: " << FLAGS_async_call_concurrency;
     }
 
-    LOG(INFO) << "Worker threads:   " << FLAGS_worker_threads;
-    LOG(INFO) << "Server reactors:  " << FLAGS_server_reactors;
+    LOG(INFO) << "Worker threads:   " << n_worker_threads_;
+    LOG(INFO) << "Server reactors:  " << n_server_reactor_threads_;
     LOG(INFO) << "Encryption:       " << FLAGS_enable_encryption;
+    LOG(INFO) << "Workload:         " << FLAGS_workload;
+    if (workload_ != Workload::ADD) {
+      LOG(INFO) << "Payload sizes:    " << FLAGS_payload_sizes;
+    }
     LOG(INFO) << "----------------------------------";
     LOG(INFO) << "Reqs/sec:         " << reqs_per_second;
     LOG(INFO) << "User CPU per req: " << user_cpu_micros_per_req << "us";
     LOG(INFO) << "Sys CPU per req:  " << sys_cpu_micros_per_req << "us";
     LOG(INFO) << "Ctx Sw. per req:  " << csw_per_req;
+    LOG(INFO) << "Call latency histogram";
+    latency_us_->DumpHumanReadable(&LOG(INFO));
     LOG(INFO) << "Server reactor load histogram";
     reactor_load.DumpHumanReadable(&LOG(INFO));
     LOG(INFO) << "Server reactor latency histogram";
     reactor_latency.DumpHumanReadable(&LOG(INFO));
+
+    if (FLAGS_results_file.empty()) {
+      return;
+    }
+    ostringstream out;
+    {
+      JsonWriter jw(&out, JsonWriter::COMPACT);
+      jw.StartObject();
+      jw.String("test");
+      jw.String(::testing::UnitTest::GetInstance()->current_test_info()->name());
+      jw.String("mode");
+      jw.String(sync ? "sync" : "async");
+      jw.String("workload");
+      jw.String(FLAGS_workload);
+      if (workload_ != Workload::ADD) {
+        jw.String("payload_sizes");
+        jw.String(FLAGS_payload_sizes);
+      }
+      jw.String("encryption");
+      jw.Bool(FLAGS_enable_encryption);
+      jw.String("client_threads");
+      jw.Int(FLAGS_client_threads);
+      if (!sync) {
+        jw.String("call_concurrency");
+        jw.Int(FLAGS_async_call_concurrency);
+      }
+      jw.String("server_reactors");
+      jw.Int(n_server_reactor_threads_);
+      jw.String("worker_threads");
+      jw.Int(n_worker_threads_);
+      jw.String("reqs_per_sec");
+      jw.Double(reqs_per_second);
+      jw.String("user_cpu_us_per_req");
+      jw.Double(user_cpu_micros_per_req);
+      jw.String("sys_cpu_us_per_req");
+      jw.Double(sys_cpu_micros_per_req);
+      jw.String("ctx_switches_per_req");
+      jw.Double(csw_per_req);
+      jw.String("call_latency_us");
+      HistogramToJson(*latency_us_, &jw);
+      jw.String("reactor_load_percent");
+      HistogramToJson(reactor_load, &jw);
+      jw.String("reactor_active_latency_us");
+      HistogramToJson(reactor_latency, &jw);
+      jw.EndObject();
+    }
+    out << "\n";
+    CHECK_OK(AppendToResultsFile(out.str()));
   }
 
  protected:
+  friend class BenchCall;
   friend class ClientThread;
   friend class ClientAsyncWorkload;
 
+  // Runs the async benchmark against the server. Returns the number of calls
+  // made, and sets 'elapsed' to the time it took.
+  int RunAsyncBenchmark(CpuTimes* elapsed);
+
+  void ResetLatencyHistogram() {
+    // Calls time out after 10 seconds, so longer latencies aren't recorded.
+    latency_us_.reset(new HdrHistogram(MonoDelta::FromSeconds(10).ToMicroseconds(), 3));
+  }
+
+  static Status AppendToResultsFile(const string& results) {
+    WritableFileOptions opts;
+    opts.mode = Env::CREATE_OR_OPEN;
+    unique_ptr<WritableFile> file;
+    RETURN_NOT_OK(Env::Default()->NewWritableFile(opts, FLAGS_results_file, &file));
+    RETURN_NOT_OK(file->Append(results));
+    return file->Close();
+  }
+
+  Workload workload_;
+  PayloadSizes payload_sizes_;
+  // The payload of echo requests is a prefix of this.
+  string payload_;
+  unique_ptr<HdrHistogram> latency_us_;
+
   Sockaddr server_addr_;
   Atomic32 should_run_;
   CountDownLatch stop_;
 };
 
+// A call of the benchmarked workload, with its request and response.
+class BenchCall {
+ public:
+  BenchCall(RpcBench* bench, uint32_t seed)
+      : bench_(bench),
+        rng_(seed),
+        payload_size_(0) {
+  }
+
+  // Prepares the request of the next call.
+  void Prepare(int request_count) {
+    switch (bench_->workload_) {
+      case Workload::ADD:
+        add_req_.set_x(request_count);
+        add_req_.set_y(request_count);
+        break;
+      case Workload::ECHO:
+        payload_size_ = bench_->payload_sizes_.Sample(&rng_);
+        echo_req_.mutable_data()->assign(bench_->payload_, 0, payload_size_);
+        break;
+      case Workload::SIDECAR:
+        payload_size_ = bench_->payload_sizes_.Sample(&rng_);
+        sidecar_req_.set_size(payload_size_);
+        sidecar_req_.set_fill("x");
+        break;
+    }
+    start_ = MonoTime::Now();
+  }
+
+  Status Call(CalculatorServiceProxy* proxy, RpcController* controller) {
+    switch (bench_->workload_) {
+      case Workload::ADD:
+        return proxy->Add(add_req_, &add_resp_, controller);
+      case Workload::ECHO:
+        return proxy->Echo(echo_req_, &echo_resp_, controller);
+      case Workload::SIDECAR:
+        return proxy->SendRepeatedString(sidecar_req_, &sidecar_resp_, controller);
+    }
+    LOG(FATAL) << "unknown workload";
+  }
+
+  void CallAsync(CalculatorServiceProxy* proxy,
+                 RpcController* controller,
+                 ResponseCallback callback) {
+    switch (bench_->workload_) {
+      case Workload::ADD:
+        proxy->AddAsync(add_req_, &add_resp_, controller, std::move(callback));
+        return;
+      case Workload::ECHO:
+        proxy->EchoAsync(echo_req_, &echo_resp_, controller, std::move(callback));
+        return;
+      case Workload::SIDECAR:
+        proxy->SendRepeatedStringAsync(
+            sidecar_req_, &sidecar_resp_, controller, std::move(callback));
+        return;
+    }
+    LOG(FATAL) << "unknown workload";
+  }
+
+  // Records the latency of the call, and checks its response.
+  void Finish(const RpcController& controller) {
+    bench_->latency_us_->Increment((MonoTime::Now() - start_).ToMicroseconds());
+    CHECK_OK(controller.status());
+    switch (bench_->workload_) {
+      case Workload::ADD:
+        CHECK_EQ(add_req_.x() + add_req_.y(), add_resp_.result());
+        break;
+      case Workload::ECHO:
+        CHECK_EQ(payload_size_, echo_resp_.data().size());
+        break;
+      case Workload::SIDECAR: {
+        Slice sidecar;
+        CHECK_OK(controller.GetInboundSidecar(sidecar_resp_.sidecar(), &sidecar));
+        CHECK_EQ(payload_size_, sidecar.size());
+        break;
+      }
+    }
+  }
+
+ private:
+  RpcBench* bench_;
+  Random rng_;
+  size_t payload_size_;
+  MonoTime start_;
+
+  AddRequestPB add_req_;
+  AddResponsePB add_resp_;
+  EchoRequestPB echo_req_;
+  EchoResponsePB echo_resp_;
+  SendRepeatedStringRequestPB sidecar_req_;
+  SendRepeatedStringResponsePB sidecar_resp_;
+};
+
 class ClientThread {
  public:
-  explicit ClientThread(RpcBench *bench)
+  ClientThread(RpcBench *bench, uint32_t seed)
     : bench_(bench),
+      call_(bench, seed),
       request_count_(0) {
   }
 
@@ -160,21 +524,19 @@ class ClientThread {
 
     CalculatorServiceProxy p(client_messenger, bench_->server_addr_, "localhost");
 
-    AddRequestPB req;
-    AddResponsePB resp;
     while (Acquire_Load(&bench_->should_run_)) {
-      req.set_x(request_count_);
-      req.set_y(request_count_);
+      call_.Prepare(request_count_);
       RpcController controller;
       controller.set_timeout(MonoDelta::FromSeconds(10));
-      CHECK_OK(p.Add(req, &resp, &controller));
-      CHECK_EQ(req.x() + req.y(), resp.result());
+      CHECK_OK(call_.Call(&p, &controller));
+      call_.Finish(controller);
       request_count_++;
     }
   }
 
   unique_ptr<thread> thread_;
   RpcBench *bench_;
+  BenchCall call_;
   int request_count_;
 };
 
@@ -186,7 +548,7 @@ TEST_F(RpcBench, BenchmarkCalls) {
 
   vector<unique_ptr<ClientThread>> threads;
   for (int i = 0; i < FLAGS_client_threads; i++) {
-    threads.emplace_back(new ClientThread(this));
+    threads.emplace_back(new ClientThread(this, i));
     threads.back()->Start();
   }
 
@@ -206,9 +568,10 @@ TEST_F(RpcBench, BenchmarkCalls) {
 
 class ClientAsyncWorkload {
  public:
-  ClientAsyncWorkload(RpcBench *bench, shared_ptr<Messenger> messenger)
+  ClientAsyncWorkload(RpcBench *bench, shared_ptr<Messenger> messenger, uint32_t seed)
     : bench_(bench),
       messenger_(std::move(messenger)),
+      call_(bench, seed),
       request_count_(0) {
     controller_.set_timeout(MonoDelta::FromSeconds(10));
     proxy_.reset(new CalculatorServiceProxy(messenger_, bench_->server_addr_, "localhost"));
@@ -216,21 +579,18 @@ class ClientAsyncWorkload {
 
   void CallOneRpc() {
     if (request_count_ > 0) {
-      CHECK_OK(controller_.status());
-      CHECK_EQ(req_.x() + req_.y(), resp_.result());
+      call_.Finish(controller_);
     }
     if (!Acquire_Load(&bench_->should_run_)) {
       bench_->stop_.CountDown();
       return;
     }
     controller_.Reset();
-    req_.set_x(request_count_);
-    req_.set_y(request_count_);
+    call_.Prepare(request_count_);
     request_count_++;
-    proxy_->AddAsync(req_,
-                     &resp_,
-                     &controller_,
-                     [this]() { this->CallOneRpc(); });
+    call_.CallAsync(proxy_.get(),
+                    &controller_,
+                    [this]() { this->CallOneRpc(); });
   }
 
   void Start() {
@@ -240,30 +600,30 @@ class ClientAsyncWorkload {
   RpcBench *bench_;
   shared_ptr<Messenger> messenger_;
   unique_ptr<CalculatorServiceProxy> proxy_;
+  BenchCall call_;
   uint32_t request_count_;
   RpcController controller_;
-  AddRequestPB req_;
-  AddResponsePB resp_;
 };
 
-TEST_F(RpcBench, BenchmarkCallsAsync) {
+int RpcBench::RunAsyncBenchmark(CpuTimes* elapsed) {
   int threads = FLAGS_client_threads;
   int concurrency = FLAGS_async_call_concurrency;
 
   vector<shared_ptr<Messenger>> messengers;
   for (int i = 0; i < threads; i++) {
     shared_ptr<Messenger> m;
-    ASSERT_OK(CreateMessenger("Client", &m));
+    CHECK_OK(CreateMessenger("Client", &m));
     messengers.emplace_back(std::move(m));
   }
 
   vector<unique_ptr<ClientAsyncWorkload>> workloads;
   for (int i = 0; i < concurrency; i++) {
     workloads.emplace_back(
-        new ClientAsyncWorkload(this, messengers[i % threads]));
+        new ClientAsyncWorkload(this, messengers[i % threads], i));
   }
 
   stop_.Reset(concurrency);
+  Release_Store(&should_run_, true);
 
   Stopwatch sw(Stopwatch::ALL_THREADS);
   sw.start();
@@ -278,14 +638,39 @@ TEST_F(RpcBench, BenchmarkCallsAsync) {
   sw.stop();
 
   stop_.Wait();
+  *elapsed = sw.elapsed();
   int total_reqs = 0;
   for (int i = 0; i < concurrency; i++) {
     total_reqs += workloads[i]->request_count_;
   }
+  return total_reqs;
+}
 
-  SummarizePerf(sw.elapsed(), total_reqs, false);
+TEST_F(RpcBench, BenchmarkCallsAsync) {
+  CpuTimes elapsed;
+  int total_reqs = RunAsyncBenchmark(&elapsed);
+  SummarizePerf(elapsed, total_reqs, false);
+}
+
+// Runs the async benchmark for each combination of the numbers of server
+// reactor and worker threads in --scaling_server_reactors and
+// --scaling_worker_threads, to chart how the server scales.
+TEST_F(RpcBench, BenchmarkScaling) {
+  vector<int> server_reactors;
+  vector<int> worker_threads;
+  ASSERT_OK(ParseIntList(FLAGS_scaling_server_reactors, &server_reactors));
+  ASSERT_OK(ParseIntList(FLAGS_scaling_worker_threads, &worker_threads));
+
+  for (int reactors : server_reactors) {
+    for (int workers : worker_threads) {
+      SCOPED_TRACE(Substitute("$0 server reactors, $1 worker threads", reactors, workers));
+      ASSERT_OK(RestartServer(reactors, workers));
+      CpuTimes elapsed;
+      int total_reqs = RunAsyncBenchmark(&elapsed);
+      SummarizePerf(elapsed, total_reqs, false);
+    }
+  }
 }
 
 } // namespace rpc
 } // namespace kudu
-
@@ -68,6 +68,8 @@ using kudu::rpc_test::ExactlyOnceResponsePB;
 using kudu::rpc_test::FeatureFlags;
 using kudu::rpc_test::PanicRequestPB;
 using kudu::rpc_test::PanicResponsePB;
+using kudu::rpc_test::SendRepeatedStringRequestPB;
+using kudu::rpc_test::SendRepeatedStringResponsePB;
 using kudu::rpc_test::PushStringsRequestPB;
 using kudu::rpc_test::PushStringsResponsePB;
 using kudu::rpc_test::SendTwoStringsRequestPB;
@@ -301,6 +303,20 @@ class CalculatorService : public CalculatorServiceIf {
     context->RespondSuccess();
   }
 
+  void SendRepeatedString(const SendRepeatedStringRequestPB* req,
+                          SendRepeatedStringResponsePB* resp,
+                          RpcContext* context) override {
+    faststring data;
+    while (data.size() < req->size()) {
+      data.append(req->fill().data(),
+                  std::min<size_t>(req->fill().size(), req->size() - data.size()));
+    }
+    int idx;
+    CHECK_OK(context->AddOutboundSidecar(RpcSidecar::FromFaststring(std::move(data)), &idx));
+    resp->set_sidecar(idx);
+    context->RespondSuccess();
+  }
+
   void WhoAmI(const WhoAmIRequestPB* /*req*/,
               WhoAmIResponsePB* resp,
               RpcContext* context) override {
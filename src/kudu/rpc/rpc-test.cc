@@ -24,6 +24,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <set>
 #include <string>
@@ -60,6 +61,7 @@
 #include "kudu/security/test/test_certs.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/env.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
@@ -72,12 +74,16 @@
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/trace_context.h"
 
 METRIC_DECLARE_counter(queue_overflow_rejections_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
 
+DECLARE_bool(rpc_reactor_cpu_affinity);
 DECLARE_bool(rpc_reopen_outbound_connections);
+DECLARE_double(rpc_trace_sample_rate);
+DECLARE_int64(rpc_inbound_buffer_pool_capacity_mb);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
 DECLARE_int32(tcp_keepalive_probe_period_s);
 DECLARE_int32(tcp_keepalive_retry_period_s);
@@ -232,6 +238,85 @@ TEST_P(TestRpc, TestCall) {
   }
 }
 
+// Collects the spans exported to it.
+class CollectingTraceSink : public TraceSink {
+ public:
+  void Export(const TraceSpan& span) override {
+    std::lock_guard<simple_spinlock> l(lock_);
+    spans_.push_back(span);
+  }
+
+  vector<TraceSpan> spans() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return spans_;
+  }
+
+ private:
+  mutable simple_spinlock lock_;
+  vector<TraceSpan> spans_;
+};
+
+// Test that sampled calls propagate their trace context to the server, and
+// that both ends of the call export a span of the same trace.
+TEST_P(TestRpc, TestTracePropagation) {
+  auto sink = std::make_shared<CollectingTraceSink>();
+  SetTraceSink(sink);
+  SCOPED_CLEANUP({ SetTraceSink(nullptr); });
+  FLAGS_rpc_trace_sample_rate = 1;
+
+  Sockaddr server_addr = bind_addr();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl()));
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl()));
+  Proxy p(client_messenger, server_addr, kRemoteHostName,
+          GenericCalculatorService::static_service_name());
+  ASSERT_OK(DoTestSyncCall(&p, GenericCalculatorService::kAddMethodName));
+
+  // The server exports its span after queueing the response, so it may
+  // arrive after the client's.
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_EQ(2, sink->spans().size());
+  });
+  const vector<TraceSpan> spans = sink->spans();
+  const TraceSpan& client = spans[0].kind == TraceSpan::CLIENT ? spans[0] : spans[1];
+  const TraceSpan& server = spans[0].kind == TraceSpan::CLIENT ? spans[1] : spans[0];
+  ASSERT_EQ(TraceSpan::CLIENT, client.kind);
+  ASSERT_EQ(TraceSpan::SERVER, server.kind);
+  ASSERT_EQ(client.context.trace_id_high, server.context.trace_id_high);
+  ASSERT_EQ(client.context.trace_id_low, server.context.trace_id_low);
+  ASSERT_EQ(client.context.span_id, server.context.parent_span_id);
+  ASSERT_EQ(0, client.context.parent_span_id);
+  ASSERT_EQ(client.name, server.name);
+  ASSERT_TRUE(client.error.empty());
+  ASSERT_TRUE(server.error.empty());
+
+  // Unsampled calls carry no trace context.
+  FLAGS_rpc_trace_sample_rate = 0;
+  ASSERT_OK(DoTestSyncCall(&p, GenericCalculatorService::kAddMethodName));
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  ASSERT_EQ(2, sink->spans().size());
+}
+
+// Test making RPC calls with reactor threads pinned to CPUs, with inbound
+// connections assigned to reactors by the CPU processing their packets.
+TEST_P(TestRpc, TestCallWithReactorCpuAffinity) {
+  FLAGS_rpc_reactor_cpu_affinity = true;
+  Sockaddr server_addr = bind_addr();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl()));
+
+  // Use several client messengers so that several inbound connections
+  // are registered.
+  for (int i = 0; i < 4; i++) {
+    shared_ptr<Messenger> client_messenger;
+    ASSERT_OK(CreateMessenger(Substitute("Client$0", i), &client_messenger, 1, enable_ssl()));
+    Proxy p(client_messenger, server_addr, kRemoteHostName,
+            GenericCalculatorService::static_service_name());
+    for (int j = 0; j < 10; j++) {
+      ASSERT_OK(DoTestSyncCall(&p, GenericCalculatorService::kAddMethodName));
+    }
+  }
+}
+
 // Test for KUDU-2091 and KUDU-2220.
 TEST_P(TestRpc, TestCallWithChainCertAndChainCA) {
   // We're only interested in running this test with TLS enabled.
@@ -885,6 +970,31 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestOutgoingSidecarExpectOK(&p, 3000 * 1024, 2000 * 1024);
 }
 
+// Large messages are received into pooled buffers which are reused once the
+// call is done with them.
+TEST_P(TestRpc, TestRpcSidecarWithInboundBufferPool) {
+  FLAGS_rpc_inbound_buffer_pool_capacity_mb = 64;
+
+  // Set up server.
+  Sockaddr server_addr = bind_addr();
+  ASSERT_OK(StartTestServer(&server_addr, enable_ssl()));
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(CreateMessenger("Client", &client_messenger, 1, enable_ssl()));
+  Proxy p(client_messenger, server_addr, kRemoteHostName,
+          GenericCalculatorService::static_service_name());
+
+  for (int i = 0; i < 5; i++) {
+    DoTestOutgoingSidecarExpectOK(&p, 3000 * 1024, 2000 * 1024);
+    DoTestSidecar(&p, 3000 * 1024, 2000 * 1024);
+  }
+  // The buffers of finished transfers have been returned to the pool, and
+  // the pool doesn't grow with the number of calls.
+  ASSERT_GT(InboundTransfer::GetPooledBytesForTests(), 0);
+  ASSERT_LE(InboundTransfer::GetPooledBytesForTests(), 64 * 1024 * 1024);
+}
+
 // Test sending the maximum number of sidecars, each of them being a single
 // character. This makes sure we handle the limit of IOV_MAX iovecs per sendmsg
 // call.
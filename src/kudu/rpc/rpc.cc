@@ -42,13 +42,17 @@ MonoDelta ComputeExponentialBackoff(int num_attempts) {
           std::pow(2.0, std::min(8, num_attempts - 1))));
 }
 
-void RpcRetrier::DelayedRetry(Rpc* rpc, const Status& why_status) {
+void RpcRetrier::DelayedRetry(Rpc* rpc, const Status& why_status,
+                              const MonoDelta& min_delay) {
   if (!why_status.ok() && (last_error_.ok() || last_error_.IsTimedOut())) {
     last_error_ = why_status;
   }
   // If the delay causes us to miss our deadline, RetryCb will fail the
   // RPC on our behalf.
   MonoDelta backoff = ComputeBackoff(attempt_num_++);
+  if (min_delay.Initialized() && min_delay > backoff) {
+    backoff = min_delay;
+  }
   messenger_->ScheduleOnReactor(
       [this, rpc](const Status& s) { this->DelayedRetryCb(rpc, s); }, backoff);
 }
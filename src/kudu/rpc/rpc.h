@@ -79,6 +79,11 @@ struct RetriableRpcStatus {
 
   Result result;
   Status status;
+
+  // If initialized, the server asked for the request not to be retried any
+  // sooner than this, e.g. because it's pushing back on writes while short of
+  // memory.
+  MonoDelta retry_after;
 };
 
 // This class picks a server among a possible set of servers serving a given resource.
@@ -149,8 +154,11 @@ class RpcRetrier {
   // error when the RPC comes up for retrying. This is true even if the
   // deadline has already expired at the time that Retry() was called.
   //
+  // If 'min_delay' is initialized, the RPC isn't retried any sooner than that.
+  //
   // Callers should ensure that 'rpc' remains alive.
-  void DelayedRetry(Rpc* rpc, const Status& why_status);
+  void DelayedRetry(Rpc* rpc, const Status& why_status,
+                    const MonoDelta& min_delay = MonoDelta());
 
   RpcController* mutable_controller() { return &controller_; }
   const RpcController& controller() const { return controller_; }
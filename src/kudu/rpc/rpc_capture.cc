@@ -0,0 +1,255 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/rpc_capture.h"
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/singleton.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/remote_method.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/rolling_log.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/thread.h"
+#include "kudu/util/threadlocal.h"
+#include "kudu/util/url-coding.h"
+
+DEFINE_double(rpc_capture_sample_rate, 0,
+              "The fraction of the calls of the methods in --rpc_capture_methods "
+              "to capture in the RPC capture log in --rpc_capture_dir, so that "
+              "they can be replayed with 'kudu perf replay'. 0 disables capturing.");
+TAG_FLAG(rpc_capture_sample_rate, experimental);
+TAG_FLAG(rpc_capture_sample_rate, runtime);
+
+DEFINE_string(rpc_capture_dir, "",
+              "The directory in which to write the RPC capture log. No calls are "
+              "captured unless it's set.");
+TAG_FLAG(rpc_capture_dir, experimental);
+
+DEFINE_string(rpc_capture_methods,
+              "kudu.tserver.TabletServerService.Write,"
+              "kudu.tserver.TabletServerService.Scan",
+              "Comma-separated list of the fully qualified names of the RPC methods "
+              "whose calls may be captured in the RPC capture log.");
+TAG_FLAG(rpc_capture_methods, experimental);
+
+DEFINE_int32(rpc_capture_segment_size_mb, 64,
+             "The size of each segment of the RPC capture log, in MiB.");
+TAG_FLAG(rpc_capture_segment_size_mb, experimental);
+
+DEFINE_int32(rpc_capture_max_segments, 10,
+             "The maximum number of segments of the RPC capture log to retain.");
+TAG_FLAG(rpc_capture_max_segments, experimental);
+
+using std::deque;
+using std::string;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace rpc {
+
+namespace {
+
+// The maximum size of the captured calls waiting to be written to the log.
+constexpr size_t kMaxBufferedBytes = 64 * 1024 * 1024;
+
+// Writes the captured calls to the rolling log from a background thread.
+class RpcCaptureLog {
+ public:
+  static RpcCaptureLog* GetInstance() {
+    return Singleton<RpcCaptureLog>::get();
+  }
+
+  // Returns true if the calls of 'method' may be captured.
+  bool CapturesMethod(const RemoteMethod& method) const {
+    return log_ && methods_.count(Substitute("$0.$1",
+                                             method.service_name(),
+                                             method.method_name())) > 0;
+  }
+
+  // Queues 'line' to be written to the log, unless too many lines are already
+  // waiting to be written.
+  void Append(string line) {
+    MutexLock l(lock_);
+    if (buffered_bytes_ + line.size() > kMaxBufferedBytes) {
+      num_dropped_++;
+      return;
+    }
+    buffered_bytes_ += line.size();
+    pending_.emplace_back(std::move(line));
+    wake_.Signal();
+  }
+
+ private:
+  friend class Singleton<RpcCaptureLog>;
+
+  RpcCaptureLog()
+      : wake_(&lock_) {
+    if (FLAGS_rpc_capture_dir.empty()) {
+      LOG(WARNING) << "--rpc_capture_sample_rate is set but --rpc_capture_dir is not: "
+                   << "no RPC calls will be captured";
+      return;
+    }
+    vector<string> methods = strings::Split(FLAGS_rpc_capture_methods, ",",
+                                            strings::SkipEmpty());
+    methods_.insert(methods.begin(), methods.end());
+
+    unique_ptr<RollingLog> log(new RollingLog(Env::Default(), FLAGS_rpc_capture_dir,
+                                              /*program_name=*/"", "rpc_capture"));
+    log->SetRollThresholdBytes(static_cast<int64_t>(FLAGS_rpc_capture_segment_size_mb) *
+                               1024 * 1024);
+    log->SetMaxNumSegments(FLAGS_rpc_capture_max_segments);
+    Status s = log->Open();
+    if (s.ok()) {
+      log_ = std::move(log);
+      s = Thread::Create("rpc", "rpc-capture", [this]() { this->RunThread(); }, &thread_);
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to start the RPC capture log; no RPC calls will be captured: "
+                   << s.ToString();
+      log_.reset();
+      return;
+    }
+    LOG(INFO) << "Capturing calls of " << FLAGS_rpc_capture_methods << " in "
+              << FLAGS_rpc_capture_dir;
+  }
+
+  void RunThread() {
+    while (true) {
+      deque<string> lines;
+      int64_t num_dropped;
+      {
+        MutexLock l(lock_);
+        while (pending_.empty()) {
+          wake_.Wait();
+        }
+        lines.swap(pending_);
+        buffered_bytes_ = 0;
+        num_dropped = num_dropped_;
+        num_dropped_ = 0;
+      }
+      if (num_dropped > 0) {
+        KLOG_EVERY_N_SECS(WARNING, 60) << "Dropped " << num_dropped
+            << " captured RPC calls since the capture log fell behind";
+      }
+      for (const auto& line : lines) {
+        Status s = log_->Append(line);
+        if (PREDICT_FALSE(!s.ok())) {
+          KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to write to the RPC capture log: "
+                                         << s.ToString();
+        }
+      }
+    }
+  }
+
+  // Null if the calls can't be captured.
+  unique_ptr<RollingLog> log_;
+  unordered_set<string> methods_;
+  scoped_refptr<Thread> thread_;
+
+  Mutex lock_;
+  ConditionVariable wake_;
+
+  // Protected by 'lock_'.
+  deque<string> pending_;
+  size_t buffered_bytes_ = 0;
+  int64_t num_dropped_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(RpcCaptureLog);
+};
+
+} // anonymous namespace
+
+string FormatCapturedCall(const CapturedCall& call) {
+  string request;
+  Base64Encode(call.serialized_request, &request);
+  return Substitute("$0 $1 $2 $3\n", call.received_unix_micros, call.service_name,
+                    call.method_name, request);
+}
+
+Status ParseCapturedCall(const string& line, CapturedCall* call) {
+  vector<string> fields = strings::Split(line, " ");
+  if (fields.size() != 4) {
+    return Status::Corruption("invalid captured call", line);
+  }
+  if (!fields[3].empty() && fields[3].back() == '\n') {
+    fields[3].pop_back();
+  }
+  CapturedCall parsed;
+  if (!safe_strto64(fields[0], &parsed.received_unix_micros)) {
+    return Status::Corruption("invalid captured call time", fields[0]);
+  }
+  parsed.service_name = std::move(fields[1]);
+  parsed.method_name = std::move(fields[2]);
+  if (!Base64Decode(fields[3], &parsed.serialized_request)) {
+    return Status::Corruption("invalid captured call request", line);
+  }
+  *call = std::move(parsed);
+  return Status::OK();
+}
+
+void MaybeCaptureCall(const InboundCall& call) {
+  const double sample_rate = FLAGS_rpc_capture_sample_rate;
+  if (PREDICT_TRUE(sample_rate <= 0)) {
+    return;
+  }
+  RpcCaptureLog* log = RpcCaptureLog::GetInstance();
+  if (!log->CapturesMethod(call.remote_method())) {
+    return;
+  }
+  BLOCK_STATIC_THREAD_LOCAL(Random, rng, GetRandomSeed32());
+  if (sample_rate < 1 && rng->NextDoubleFraction() >= sample_rate) {
+    return;
+  }
+
+  CapturedCall captured;
+  captured.received_unix_micros =
+      GetCurrentTimeMicros() - (MonoTime::Now() - call.GetTimeReceived()).ToMicroseconds();
+  captured.service_name = call.remote_method().service_name();
+  captured.method_name = call.remote_method().method_name();
+  captured.serialized_request = call.serialized_request().ToString();
+  log->Append(FormatCapturedCall(captured));
+}
+
+} // namespace rpc
+} // namespace kudu
@@ -0,0 +1,60 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/util/status.h"
+
+namespace kudu {
+namespace rpc {
+
+class InboundCall;
+
+// An RPC call captured by a server so that it can later be replayed, e.g. by
+// 'kudu perf replay'.
+//
+// While --rpc_capture_sample_rate is positive, a sample of the calls of the
+// methods in --rpc_capture_methods is written to a rolling log named
+// "rpc_capture" in --rpc_capture_dir, one call per line:
+//
+//   <received time, in microseconds since the Unix epoch> <service> <method> <base64 request>
+//
+// Sidecars are not captured.
+struct CapturedCall {
+  int64_t received_unix_micros = 0;
+  std::string service_name;
+  std::string method_name;
+  std::string serialized_request;
+};
+
+// Returns the line of the capture log for 'call', including the newline.
+std::string FormatCapturedCall(const CapturedCall& call);
+
+// Parses a line of the capture log, with or without the newline.
+Status ParseCapturedCall(const std::string& line, CapturedCall* call);
+
+// Captures 'call' if it's sampled. Called by the service pools before
+// handling each call.
+//
+// The capture log is written by a background thread. If it falls behind,
+// sampled calls are dropped rather than delaying the service threads.
+void MaybeCaptureCall(const InboundCall& call);
+
+} // namespace rpc
+} // namespace kudu
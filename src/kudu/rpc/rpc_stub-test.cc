@@ -62,6 +62,7 @@
 #include "kudu/util/user.h"
 
 DEFINE_bool(is_panic_test_child, false, "Used by TestRpcPanic");
+DECLARE_bool(rpc_compress_sidecars);
 DECLARE_bool(socket_inject_short_recvs);
 
 using kudu::pb_util::SecureDebugString;
@@ -105,6 +106,30 @@ TEST_F(RpcStubTest, TestSimpleCall) {
   SendSimpleCall();
 }
 
+// Test that compressed response sidecars are transparently decompressed by
+// the client, for payloads both above and below the compression threshold.
+TEST_F(RpcStubTest, TestCompressedSidecars) {
+  FLAGS_rpc_compress_sidecars = true;
+  CalculatorServiceProxy p(client_messenger_, server_addr_, server_addr_.host());
+
+  for (uint32_t size : { 100, 1024 * 1024 }) {
+    SCOPED_TRACE(size);
+    RpcController controller;
+    SendRepeatedStringRequestPB req;
+    req.set_size(size);
+    req.set_fill("kudu");
+    SendRepeatedStringResponsePB resp;
+    ASSERT_OK(p.SendRepeatedString(req, &resp, &controller));
+
+    Slice sidecar;
+    ASSERT_OK(controller.GetInboundSidecar(resp.sidecar(), &sidecar));
+    ASSERT_EQ(size, sidecar.size());
+    for (uint32_t i = 0; i < size; i += 4) {
+      ASSERT_EQ(0, memcmp(sidecar.data() + i, "kudu", std::min<uint32_t>(4, size - i)));
+    }
+  }
+}
+
 // Regression test for a bug in which we would not properly parse a call
 // response when recv() returned a 'short read'. This injects such short
 // reads and then makes a number of calls.
@@ -95,6 +95,7 @@ TAG_FLAG(rpc_send_channel_bindings, runtime);
 TAG_FLAG(rpc_send_channel_bindings, unsafe);
 
 DECLARE_bool(rpc_encrypt_loopback_connections);
+DECLARE_bool(rpc_tls_session_resumption);
 
 DEFINE_string(trusted_subnets,
               "127.0.0.0/8,10.0.0.0/8,172.16.0.0/12,192.168.0.0/16,169.254.0.0/16",
@@ -547,6 +548,9 @@ Status ServerNegotiation::HandleNegotiate(const NegotiatePB& request) {
     if (socket_->IsLoopbackConnection() && !encrypt_loopback_) {
       server_features_.insert(TLS_AUTHENTICATION_ONLY);
     }
+    if (FLAGS_rpc_tls_session_resumption) {
+      server_features_.insert(TLS_SESSION_RESUMPTION);
+    }
   }
 
   for (RpcFeatureFlag feature : server_features_) {
@@ -52,6 +52,13 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // The priority class of this method's calls in the service queue, if fair
+  // scheduling is enabled. Calls of a higher class are served first.
+  int32_t queue_priority = 0;
+
+  // Whether the sidecars of this method's responses may be compressed.
+  bool compress_sidecars = false;
+
   // The authorization function for this RPC. If this function
   // returns false, the RPC has already been handled (i.e. rejected)
   // by the authorization function.
@@ -21,6 +21,7 @@
 #include <ostream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -30,10 +31,13 @@
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/rpc/inbound_call.h"
+#include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
 using std::shared_ptr;
@@ -50,6 +54,8 @@ DEFINE_int32(num_consumers, 20,
 DEFINE_int32(max_queue_size, 50,
              "Max queue length");
 
+DECLARE_bool(rpc_service_queue_fair_scheduling);
+
 namespace kudu {
 namespace rpc {
 
@@ -147,5 +153,108 @@ TEST(TestServiceQueue, LifoServiceQueuePerf) {
   LOG(INFO) << "Avg idle workers:     " << total_idle_workers / static_cast<double>(total_sample);
 }
 
+class FairServiceQueueTest : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    FLAGS_rpc_service_queue_fair_scheduling = true;
+    queue_.reset(new LifoServiceQueue(kMaxQueueSize));
+    queue_->SetTenantFuncForTests([this](InboundCall* call) {
+      return tenants_[call];
+    });
+    low_.reset(new RpcMethodInfo);
+    high_.reset(new RpcMethodInfo);
+    high_->queue_priority = 1;
+  }
+
+  void TearDown() override {
+    queue_->Shutdown();
+    // Drain from a separate thread, since a consumer thread stays bound to
+    // the first queue it reads from.
+    std::thread drainer([this]() {
+      unique_ptr<InboundCall> call;
+      while (queue_->BlockingGet(&call)) {
+        call.reset();
+      }
+    });
+    drainer.join();
+    KuduTest::TearDown();
+  }
+
+ protected:
+  static constexpr int kMaxQueueSize = 6;
+
+  InboundCall* NewCall(const string& tenant, bool high_priority) {
+    InboundCall* call = new InboundCall(nullptr);
+    call->set_method_info(high_priority ? high_ : low_);
+    tenants_[call] = tenant;
+    return call;
+  }
+
+  // Puts the call, expecting nothing to be evicted.
+  void Put(InboundCall* call) {
+    boost::optional<InboundCall*> evicted;
+    ASSERT_EQ(QUEUE_SUCCESS, queue_->Put(call, &evicted));
+    ASSERT_TRUE(evicted == boost::none);
+  }
+
+  // Dequeues every queued call, returning their tenants in order.
+  vector<string> DrainTenants() {
+    vector<string> ret;
+    std::thread drainer([&]() {
+      unique_ptr<InboundCall> call;
+      while (!queue_->empty() && queue_->BlockingGet(&call)) {
+        ret.emplace_back(tenants_[call.get()]);
+        call.reset();
+      }
+    });
+    drainer.join();
+    return ret;
+  }
+
+  std::unordered_map<InboundCall*, string> tenants_;
+  scoped_refptr<RpcMethodInfo> low_;
+  scoped_refptr<RpcMethodInfo> high_;
+  unique_ptr<LifoServiceQueue> queue_;
+};
+
+// Calls of a higher priority class are served before any lower class call,
+// and calls within a class are shared fairly across tenants.
+TEST_F(FairServiceQueueTest, TestPriorityAndFairShare) {
+  for (int i = 0; i < 3; i++) {
+    NO_FATALS(Put(NewCall("noisy", false)));
+  }
+  NO_FATALS(Put(NewCall("quiet", false)));
+  NO_FATALS(Put(NewCall("writer", true)));
+
+  const vector<string> expected = { "writer", "noisy", "quiet", "noisy", "noisy" };
+  ASSERT_EQ(expected, DrainTenants());
+}
+
+// On overflow, the lowest-priority call of the tenant furthest ahead is
+// evicted, and that tenant's own new calls are rejected.
+TEST_F(FairServiceQueueTest, TestNoisyTenantIsEvicted) {
+  InboundCall* last_noisy = nullptr;
+  for (int i = 0; i < kMaxQueueSize; i++) {
+    last_noisy = NewCall("noisy", false);
+    NO_FATALS(Put(last_noisy));
+  }
+
+  // A new call from the noisy tenant would be the first to go, so it's rejected.
+  InboundCall* rejected = NewCall("noisy", false);
+  boost::optional<InboundCall*> evicted;
+  ASSERT_EQ(QUEUE_FULL, queue_->Put(rejected, &evicted));
+  delete rejected;
+
+  // A call from another tenant bumps the noisy tenant's last call instead.
+  ASSERT_EQ(QUEUE_SUCCESS, queue_->Put(NewCall("quiet", false), &evicted));
+  ASSERT_TRUE(evicted != boost::none);
+  ASSERT_EQ(last_noisy, evicted.get());
+  delete evicted.get();
+
+  const vector<string> expected = { "noisy", "quiet", "noisy", "noisy", "noisy", "noisy" };
+  ASSERT_EQ(expected, DrainTenants());
+}
+
 } // namespace rpc
 } // namespace kudu
@@ -17,21 +17,47 @@
 
 #include "kudu/rpc/service_queue.h"
 
+#include <algorithm>
 #include <mutex>
 #include <ostream>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags.h>
 
 #include "kudu/gutil/port.h"
+#include "kudu/rpc/remote_user.h"
+#include "kudu/rpc/service_if.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_bool(rpc_service_queue_fair_scheduling, false,
+            "Whether to order the calls waiting in an RPC service queue by the "
+            "priority class of their method and, within a class, to share the "
+            "service fairly across the remote users issuing the calls, instead "
+            "of ordering them by deadline. When the queue overflows, the calls "
+            "of the heaviest user are evicted first.");
+TAG_FLAG(rpc_service_queue_fair_scheduling, experimental);
 
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+// Beyond this many tracked tenants, stale entries are pruned on insertion.
+constexpr size_t kMaxTrackedTenants = 1024;
+
+} // anonymous namespace
+
 __thread LifoServiceQueue::ConsumerState* LifoServiceQueue::tl_consumer_ = nullptr;
 
 LifoServiceQueue::LifoServiceQueue(int max_size)
    : shutdown_(false),
-     max_queue_size_(max_size) {
+     max_queue_size_(max_size),
+     fair_scheduling_(FLAGS_rpc_service_queue_fair_scheduling),
+     tenant_func_([](InboundCall* call) {
+       return call->connection() ? call->remote_user().username() : std::string();
+     }),
+     virtual_time_(0),
+     queue_(QueueOrder{ fair_scheduling_ }) {
   CHECK_GT(max_queue_size_, 0);
 }
 
@@ -53,7 +79,8 @@ bool LifoServiceQueue::BlockingGet(std::unique_ptr<InboundCall>* out) {
       std::lock_guard<simple_spinlock> l(lock_);
       if (!queue_.empty()) {
         auto it = queue_.begin();
-        out->reset(*it);
+        out->reset(it->call);
+        virtual_time_ = std::max(virtual_time_, it->tag);
         queue_.erase(it);
         return true;
       }
@@ -93,23 +120,52 @@ QueueStatus LifoServiceQueue::Put(InboundCall* call,
     return QUEUE_SUCCESS;
   }
 
+  const std::string tenant = fair_scheduling_ ? tenant_func_(call) : std::string();
+  const QueuedCall queued = MakeQueuedCall(call, tenant);
   if (PREDICT_FALSE(queue_.size() >= max_queue_size_)) {
     // eviction
     DCHECK_EQ(queue_.size(), max_queue_size_);
     auto it = queue_.end();
     --it;
-    if (DeadlineLess(*it, call)) {
+    if (queue_.key_comp()(*it, queued)) {
       return QUEUE_FULL;
     }
 
-    *evicted = *it;
+    *evicted = it->call;
     queue_.erase(it);
   }
 
-  queue_.insert(call);
+  if (fair_scheduling_) {
+    if (tenant_tags_.size() > kMaxTrackedTenants) {
+      for (auto it = tenant_tags_.begin(); it != tenant_tags_.end();) {
+        if (it->second <= virtual_time_) {
+          it = tenant_tags_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    tenant_tags_[tenant] = queued.tag;
+  }
+  queue_.insert(queued);
   return QUEUE_SUCCESS;
 }
 
+LifoServiceQueue::QueuedCall LifoServiceQueue::MakeQueuedCall(InboundCall* call,
+                                                              const std::string& tenant) {
+  if (!fair_scheduling_) {
+    return { call, 0, 0 };
+  }
+  const auto* minfo = call->method_info();
+  const int32_t priority = minfo ? minfo->queue_priority : 0;
+  uint64_t prev_tag = 0;
+  const auto it = tenant_tags_.find(tenant);
+  if (it != tenant_tags_.end()) {
+    prev_tag = it->second;
+  }
+  return { call, priority, std::max(virtual_time_, prev_tag) + 1 };
+}
+
 void LifoServiceQueue::Shutdown() {
   std::lock_guard<simple_spinlock> l(lock_);
   shutdown_ = true;
@@ -134,8 +190,8 @@ std::string LifoServiceQueue::ToString() const {
   std::string ret;
 
   std::lock_guard<simple_spinlock> l(lock_);
-  for (const auto* t : queue_) {
-    ret.append(t->ToString());
+  for (const auto& t : queue_) {
+    ret.append(t.call->ToString());
     ret.append("\n");
   }
   return ret;
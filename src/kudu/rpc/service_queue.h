@@ -16,9 +16,12 @@
 // under the License.
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include <glog/logging.h>
@@ -27,6 +30,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
@@ -71,11 +75,24 @@ enum QueueStatus {
 //   work rate, the queue implementation itself is never used. Thus, we can
 //   have a priority queue without paying extra for it in the common case.
 //
+// If --rpc_service_queue_fair_scheduling is set when the queue is created,
+// queued calls are instead ordered by the priority class of their RPC method
+// (see the 'queue_priority' RPC method option), and within a class by
+// start-time fair queueing across tenants (the calls' remote users): each
+// call is tagged with max(virtual time, tenant's previous tag) + 1, and the
+// smallest tag is served first. A tenant flooding the queue therefore runs
+// its tags ahead of everyone else's and is served at an equal share, and
+// when the queue overflows the evicted call is the lowest-priority call of
+// whichever tenant is furthest ahead.
+//
 // NOTE: because of the use of thread-local consumer records, once a consumer
 // thread accesses one LifoServiceQueue, it becomes "bound" to that queue and
 // must never access any other instance.
 class LifoServiceQueue {
  public:
+  // Returns the tenant a call is accounted to for fair scheduling.
+  typedef std::function<std::string(InboundCall* call)> TenantFunc;
+
   explicit LifoServiceQueue(int max_size);
 
   ~LifoServiceQueue();
@@ -107,6 +124,12 @@ class LifoServiceQueue {
 
   int max_size() const;
 
+  // Override how calls are mapped to tenants. Must be called before any
+  // calls are queued.
+  void SetTenantFuncForTests(TenantFunc func) {
+    tenant_func_ = std::move(func);
+  }
+
   std::string ToString() const;
 
   // Return an estimate of the current queue length.
@@ -145,13 +168,37 @@ class LifoServiceQueue {
     return time_a < time_b;
   }
 
-  // Struct functor wrapper for DeadlineLess.
-  struct DeadlineLessStruct {
-    bool operator()(const InboundCall* a, const InboundCall* b) const {
-      return DeadlineLess(a, b);
+  // A call waiting in the queue, along with its fair scheduling attributes.
+  // The attributes are only meaningful if fair scheduling is enabled.
+  struct QueuedCall {
+    InboundCall* call;
+    int32_t priority;
+    uint64_t tag;
+  };
+
+  // Orders queued calls: by deadline by default, or by priority class and
+  // then fair queueing tag if fair scheduling is enabled.
+  struct QueueOrder {
+    bool fair_scheduling;
+
+    bool operator()(const QueuedCall& a, const QueuedCall& b) const {
+      if (fair_scheduling) {
+        if (a.priority != b.priority) {
+          return a.priority > b.priority;
+        }
+        if (a.tag != b.tag) {
+          return a.tag < b.tag;
+        }
+        return a.call->GetTimeReceived() < b.call->GetTimeReceived();
+      }
+      return DeadlineLess(a.call, b.call);
     }
   };
 
+  // Builds the queue entry for 'call' issued by 'tenant', computing its fair
+  // queueing tag.
+  QueuedCall MakeQueuedCall(InboundCall* call, const std::string& tenant);
+
   // The thread-local record corresponding to a single consumer thread.
   // Threads push this record onto the waiting_consumers_ stack when
   // they are awaiting work. Producers pop the top waiting consumer and
@@ -202,15 +249,31 @@ class LifoServiceQueue {
   static __thread ConsumerState* tl_consumer_;
 
   mutable simple_spinlock lock_;
+  ScopedLockSiteRegistration lock_site_{&lock_, LockSite::kServiceQueue};
   bool shutdown_;
   int max_queue_size_;
 
+  // Whether calls are ordered by priority class and tenant fair share rather
+  // than by deadline. Fixed at construction since it determines the queue's
+  // ordering.
+  const bool fair_scheduling_;
+
+  TenantFunc tenant_func_;
+
+  // The fair queueing virtual time: the tag of the most recently dequeued call.
+  uint64_t virtual_time_;
+
+  // The tag of the most recently queued call of each tenant. Tenants whose
+  // tag is behind the virtual time are equivalent to absent ones, and are
+  // pruned when the map grows large.
+  std::unordered_map<std::string, uint64_t> tenant_tags_;
+
   // Stack of consumer threads which are currently waiting for work.
   std::vector<ConsumerState*> waiting_consumers_;
 
   // The actual queue. Work is only added to the queue when there were no
   // consumers available for a "direct hand-off".
-  std::multiset<InboundCall*, DeadlineLessStruct> queue_;
+  std::multiset<QueuedCall, QueueOrder> queue_;
 
   // The total set of consumers who have ever accessed this queue.
   std::vector<std::unique_ptr<ConsumerState>> consumers_;
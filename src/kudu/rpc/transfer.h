@@ -70,6 +70,9 @@ class InboundTransfer {
   InboundTransfer();
   explicit InboundTransfer(faststring initial_buf);
 
+  // Returns the buffer to the inbound buffer pool, if it's pooled.
+  ~InboundTransfer();
+
   // Read from the socket into our buffer.
   //
   // If this is the last read of the transfer (i.e. if TransferFinished() is true
@@ -92,7 +95,15 @@ class InboundTransfer {
   // suitable for logging.
   std::string StatusAsString() const;
 
+  // Returns the number of bytes of buffer capacity currently held in the
+  // process-wide inbound buffer pool.
+  static int64_t GetPooledBytesForTests();
+
  private:
+  // If the inbound buffer pool is enabled and the message is large enough,
+  // moves the bytes received so far into a buffer from the pool which can
+  // hold 'size' bytes.
+  void MaybeUsePooledBuffer(size_t size);
 
   faststring buf_;
 
@@ -39,6 +39,7 @@
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/security/ca/cert_management.h"
 #include "kudu/security/cert.h"
@@ -101,6 +102,28 @@ DEFINE_int32(openssl_security_level_override, -1,
 TAG_FLAG(openssl_security_level_override, hidden);
 TAG_FLAG(openssl_security_level_override, unsafe);
 
+DEFINE_bool(rpc_tls_kernel_tx_offload, false,
+            "Whether to hand the transmit side of TLSv1.3 AES-GCM connections "
+            "over to the kernel (kTLS) once negotiation completes. Outbound "
+            "RPC payloads are then written to the socket in plaintext and "
+            "encrypted by the kernel, avoiding the per-buffer SSL_write() "
+            "calls and the copy into a coalescing buffer. Connections for "
+            "which the kernel doesn't support the negotiated cipher keep "
+            "using OpenSSL for encryption.");
+TAG_FLAG(rpc_tls_kernel_tx_offload, experimental);
+TAG_FLAG(rpc_tls_kernel_tx_offload, advanced);
+
+DEFINE_bool(rpc_tls_session_resumption, false,
+            "Whether to resume the TLS sessions previously established with a "
+            "server when reconnecting to it, skipping the certificate exchange "
+            "and the public key operations of a full TLS handshake. Servers "
+            "advertise the support for resumption during connection "
+            "negotiation, so sessions are resumed only if both sides of a "
+            "connection have this flag set. Only the sessions of handshakes "
+            "which verified the server's certificate are resumed.");
+TAG_FLAG(rpc_tls_session_resumption, experimental);
+TAG_FLAG(rpc_tls_session_resumption, advanced);
+
 namespace kudu {
 namespace security {
 
@@ -110,6 +133,9 @@ template<> struct SslTypeTraits<SSL> {
 template<> struct SslTypeTraits<X509_STORE_CTX> {
   static constexpr auto kFreeFunc = &X509_STORE_CTX_free;
 };
+template<> struct SslTypeTraits<SSL_SESSION> {
+  static constexpr auto kFreeFunc = &SSL_SESSION_free;
+};
 
 namespace {
 
@@ -134,6 +160,21 @@ Status CheckMaxSupportedTlsVersion(int tls_version, const char* tls_version_str)
   return Status::OK();
 }
 
+// The maximum number of client TLS sessions cached by a TlsContext.
+constexpr size_t kMaxCachedSessions = 1024;
+
+// Index of the SSL ex-data slot holding the key of the session cached by a
+// client handshake.
+int SessionKeyExIndex() {
+  static const int kIndex = SSL_get_ex_new_index(
+      0, nullptr, nullptr, nullptr,
+      [](void* /*parent*/, void* ptr, CRYPTO_EX_DATA* /*ad*/, int /*idx*/,
+         long /*argl*/, void* /*argp*/) {
+        delete static_cast<string*>(ptr);
+      });
+  return kIndex;
+}
+
 } // anonymous namespace
 
 TlsContext::TlsContext()
@@ -248,7 +289,32 @@ Status TlsContext::Init() {
   // resources to store TLS session information and running the automatic check
   // for expired sessions every 255 connections, as mentioned at
   // https://www.openssl.org/docs/manmaster/man3/SSL_CTX_set_session_cache_mode.html
-  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+  //
+  // The exception is --rpc_tls_session_resumption: the client side then keeps
+  // the sessions in the TlsContext's own cache, keyed by the remote server,
+  // rather than in the session cache of OpenSSL. On the server side, sessions
+  // are resumed from the session tickets presented by clients, which doesn't
+  // need the session cache either.
+  if (FLAGS_rpc_tls_session_resumption) {
+    SSL_CTX_set_session_cache_mode(ctx,
+                                   SSL_SESS_CACHE_CLIENT |
+                                   SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_set_app_data(ctx, this);
+    SSL_CTX_sess_set_new_cb(ctx, &TlsContext::NewSessionCallback);
+  } else {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+  }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  if (FLAGS_rpc_tls_kernel_tx_offload) {
+    // Once the kernel owns the transmit side, OpenSSL must not write any more
+    // records of its own: its sequence numbers would be out of sync with the
+    // kernel's. Disable TLSv1.3 session tickets sent by the server after the
+    // handshake, and record the application traffic secret for the kernel.
+    SSL_CTX_set_num_tickets(ctx, 0);
+    SSL_CTX_set_keylog_callback(ctx, &TlsHandshake::CaptureTrafficSecret);
+  }
+#endif
 
   // The sequence of SSL_CTX_set_ciphersuites() and SSL_CTX_set_cipher_list()
   // calls below is essential to make sure the TLS engine ends up with usable,
@@ -376,6 +442,7 @@ Status TlsContext::UseCertificateAndKey(const Cert& cert, const PrivateKey& key)
   OPENSSL_RET_NOT_OK(SSL_CTX_use_certificate(ctx_.get(), cert.GetTopOfChainX509()),
                      "failed to use certificate");
   has_cert_ = true;
+  ClearSessions();
   return Status::OK();
 }
 
@@ -578,6 +645,7 @@ Status TlsContext::AdoptSignedCert(const Cert& cert) {
     << "certificate does not match the private key";
 
   csr_ = boost::none;
+  ClearSessions();
 
   return Status::OK();
 }
@@ -616,7 +684,36 @@ Status TlsContext::LoadCertificateAuthority(const string& certificate_path) {
   return AddTrustedCertificate(c);
 }
 
-Status TlsContext::InitiateHandshake(TlsHandshake* handshake) const {
+int TlsContext::NewSessionCallback(SSL* ssl, SSL_SESSION* session) {
+  const auto* key = static_cast<const string*>(SSL_get_ex_data(ssl, SessionKeyExIndex()));
+  if (SSL_is_server(ssl) || !key) {
+    return 0;
+  }
+  // OpenSSL doesn't verify the server's certificate again when resuming a
+  // session, so a session established without verifying it must not be
+  // resumed by a handshake which is supposed to.
+  if (!(SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER) ||
+      SSL_get_verify_result(ssl) != X509_V_OK) {
+    return 0;
+  }
+  auto* context = static_cast<TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  DCHECK(context);
+  std::lock_guard<simple_spinlock> l(context->sessions_lock_);
+  auto& sessions = context->sessions_;
+  if (sessions.size() >= kMaxCachedSessions && !ContainsKey(sessions, *key)) {
+    sessions.erase(sessions.begin());
+  }
+  sessions[*key] = ssl_make_unique(session);
+  // Returning 1 takes over the reference to 'session'.
+  return 1;
+}
+
+void TlsContext::ClearSessions() {
+  std::lock_guard<simple_spinlock> l(sessions_lock_);
+  sessions_.clear();
+}
+
+Status TlsContext::InitiateHandshake(TlsHandshake* handshake, const string& session_key) const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   DCHECK(handshake);
   CHECK(ctx_);
@@ -639,6 +736,16 @@ Status TlsContext::InitiateHandshake(TlsHandshake* handshake) const {
   // $OPENSSL_ROOT/CHANGES and https://github.com/openssl/openssl/issues/4739.
   ssl->s3->flags |= SSL3_FLAGS_NO_RENEGOTIATE_CIPHERS;
 #endif
+
+  if (FLAGS_rpc_tls_session_resumption && !session_key.empty()) {
+    SSL_set_ex_data(ssl.get(), SessionKeyExIndex(), new string(session_key));
+    std::lock_guard<simple_spinlock> l(sessions_lock_);
+    const auto* session = FindOrNull(sessions_, session_key);
+    if (session) {
+      OPENSSL_RET_NOT_OK(SSL_set_session(ssl.get(), session->get()),
+                         "failed to set TLS session to resume");
+    }
+  }
   return handshake->Init(std::move(ssl));
 }
 
@@ -17,10 +17,13 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/optional/optional.hpp>
@@ -172,7 +175,13 @@ class TlsContext {
   Status LoadCertificateAuthority(const std::string& certificate_path) WARN_UNUSED_RESULT;
 
   // Initiates a new TlsHandshake instance.
-  Status InitiateHandshake(TlsHandshake* handshake) const WARN_UNUSED_RESULT;
+  //
+  // If 'session_key' is not empty and --rpc_tls_session_resumption is set, the
+  // client handshake offers to resume the TLS session last established by a
+  // handshake with the same key, e.g. to the same server, and the session it
+  // establishes is cached for the next handshake with that key.
+  Status InitiateHandshake(TlsHandshake* handshake,
+                           const std::string& session_key = "") const WARN_UNUSED_RESULT;
 
   // Return the number of certs that have been marked as trusted.
   // Used by tests.
@@ -183,8 +192,23 @@ class TlsContext {
 
   bool is_external_cert() const { return is_external_cert_; }
 
+  // Return the number of cached client TLS sessions.
+  // Used by tests.
+  size_t cached_session_count_for_tests() const {
+    std::lock_guard<simple_spinlock> l(sessions_lock_);
+    return sessions_.size();
+  }
+
  private:
 
+  // Called by OpenSSL once a client handshake establishes a new TLS session:
+  // caches the session if the handshake verified the server's certificate.
+  static int NewSessionCallback(SSL* ssl, SSL_SESSION* session);
+
+  // Drops the cached client TLS sessions, e.g. since they were established
+  // with a certificate which is no longer used.
+  void ClearSessions();
+
   Status VerifyCertChainUnlocked(const Cert& cert) WARN_UNUSED_RESULT;
 
   // The cipher suite preferences to use for RPC connections secured with
@@ -219,6 +243,11 @@ class TlsContext {
   bool has_cert_;
   bool is_external_cert_;
   boost::optional<CertSignRequest> csr_;
+
+  // The client TLS sessions to resume, keyed by the 'session_key' of the
+  // handshakes which established them.
+  mutable simple_spinlock sessions_lock_;
+  std::unordered_map<std::string, c_unique_ptr<SSL_SESSION>> sessions_;
 };
 
 } // namespace security
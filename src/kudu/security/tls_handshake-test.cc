@@ -49,6 +49,7 @@ using kudu::security::ca::CertSigner;
 using std::string;
 using std::vector;
 
+DECLARE_bool(rpc_tls_session_resumption);
 DECLARE_int32(ipki_server_key_size);
 
 namespace kudu {
@@ -95,10 +96,22 @@ class TestTlsHandshakeBase : public KuduTest {
   // verification modes are set to 'client_verify' and 'server_verify' respectively.
   Status RunHandshake(TlsVerificationMode client_verify,
                       TlsVerificationMode server_verify) {
+    return RunHandshake(&client_tls_, &server_tls_, client_verify, server_verify);
+  }
+
+  // Same as above, but using 'client_tls' and 'server_tls'. The client's session
+  // key is set to 'session_key', and whether the handshake resumed a session is
+  // stored in 'session_reused', if not null.
+  static Status RunHandshake(TlsContext* client_tls,
+                             TlsContext* server_tls,
+                             TlsVerificationMode client_verify,
+                             TlsVerificationMode server_verify,
+                             const string& session_key = "",
+                             bool* session_reused = nullptr) {
     TlsHandshake client(TlsHandshakeType::CLIENT);
-    RETURN_NOT_OK(client_tls_.InitiateHandshake(&client));
+    RETURN_NOT_OK(client_tls->InitiateHandshake(&client, session_key));
     TlsHandshake server(TlsHandshakeType::SERVER);
-    RETURN_NOT_OK(server_tls_.InitiateHandshake(&server));
+    RETURN_NOT_OK(server_tls->InitiateHandshake(&server));
 
     client.set_verification_mode(client_verify);
     server.set_verification_mode(server_verify);
@@ -128,6 +141,10 @@ class TestTlsHandshakeBase : public KuduTest {
         }
       }
     }
+    if (session_reused) {
+      *session_reused = client.session_reused();
+      CHECK_EQ(*session_reused, server.session_reused());
+    }
     return Status::OK();
   }
 
@@ -487,6 +504,63 @@ TEST_F(TestTlsHandshake, TestTlsContextCertTransition) {
                          TlsVerificationMode::VERIFY_NONE));
 }
 
+// Tests that a client resumes the TLS session established by its previous
+// handshake with the same session key, provided that the handshake verified
+// the server's certificate.
+TEST_F(TestTlsHandshake, TestSessionResumption) {
+  FLAGS_rpc_tls_session_resumption = true;
+
+  // TLSv1.3 session tickets are sent after the handshake, along with the
+  // application data, so TLSv1.2 is used to get the sessions established by
+  // the handshakes themselves.
+  TlsContext client_tls(SecurityDefaults::kDefaultTlsCiphers,
+                        SecurityDefaults::kDefaultTlsCipherSuites,
+                        "TLSv1.2", { "TLSv1.3" });
+  TlsContext server_tls(SecurityDefaults::kDefaultTlsCiphers,
+                        SecurityDefaults::kDefaultTlsCipherSuites,
+                        "TLSv1.2", { "TLSv1.3" });
+  ASSERT_OK(client_tls.Init());
+  ASSERT_OK(server_tls.Init());
+
+  PrivateKey ca_key;
+  Cert ca_cert;
+  ASSERT_OK(GenerateSelfSignedCAForTests(&ca_key, &ca_cert));
+  ASSERT_OK(ConfigureTlsContext(PkiConfig::SIGNED, ca_cert, ca_key, &client_tls));
+  ASSERT_OK(ConfigureTlsContext(PkiConfig::SIGNED, ca_cert, ca_key, &server_tls));
+
+  const auto kVerify = TlsVerificationMode::VERIFY_REMOTE_CERT_AND_HOST;
+  const auto kNoVerify = TlsVerificationMode::VERIFY_NONE;
+  bool reused = true;
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kNoVerify, "server", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(1, client_tls.cached_session_count_for_tests());
+
+  // The session is resumed by any number of later handshakes with the same key.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kNoVerify, "server", &reused));
+    ASSERT_TRUE(reused);
+  }
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kNoVerify, "other", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(2, client_tls.cached_session_count_for_tests());
+
+  // A session established without verifying the server's certificate isn't cached.
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kNoVerify, kNoVerify, "unverified", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(2, client_tls.cached_session_count_for_tests());
+
+  // A session established without verifying the client's certificate isn't
+  // resumed by a server which verifies it.
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kVerify, "server", &reused));
+  ASSERT_FALSE(reused);
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kVerify, "server", &reused));
+  ASSERT_TRUE(reused);
+
+  // Without a session key, no session is resumed.
+  ASSERT_OK(RunHandshake(&client_tls, &server_tls, kVerify, kNoVerify, "", &reused));
+  ASSERT_FALSE(reused);
+}
+
 TEST_P(TestTlsHandshake, TestHandshake) {
   Case test_case = GetParam();
 
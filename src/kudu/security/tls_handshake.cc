@@ -22,13 +22,19 @@
 #include <openssl/x509.h>
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <ostream>
 #include <utility>
 
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/escaping.h"
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/security/cert.h"
 #include "kudu/security/tls_socket.h"
 #include "kudu/util/net/socket.h"
@@ -44,6 +50,8 @@
 #define TLS1_3_VERSION 0x0304
 #endif
 
+DECLARE_bool(rpc_tls_kernel_tx_offload);
+
 using std::string;
 using std::unique_ptr;
 using strings::Substitute;
@@ -51,6 +59,49 @@ using strings::Substitute;
 namespace kudu {
 namespace security {
 
+namespace {
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+// Index of the SSL ex-data slot holding the traffic secret captured by
+// TlsHandshake::CaptureTrafficSecret().
+int TrafficSecretExIndex() {
+  static const int kIndex = SSL_get_ex_new_index(
+      0, nullptr, nullptr, nullptr,
+      [](void* /*parent*/, void* ptr, CRYPTO_EX_DATA* /*ad*/, int /*idx*/,
+         long /*argl*/, void* /*argp*/) {
+        auto* secret = static_cast<string*>(ptr);
+        if (secret) {
+          OPENSSL_cleanse(&(*secret)[0], secret->size());
+          delete secret;
+        }
+      });
+  return kIndex;
+}
+#endif
+
+} // anonymous namespace
+
+void TlsHandshake::CaptureTrafficSecret(const SSL* ssl, const char* line) {
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  // The line has the NSS key log format: '<label> <client random> <secret>',
+  // all in hex. Only the secret protecting the records sent by this side of
+  // the connection is of interest.
+  const char* label = SSL_is_server(ssl) ? "SERVER_TRAFFIC_SECRET_0 "
+                                         : "CLIENT_TRAFFIC_SECRET_0 ";
+  if (!HasPrefixString(line, label)) {
+    return;
+  }
+  const char* hex_secret = strrchr(line, ' ');
+  DCHECK(hex_secret);
+  auto* secret = new string(strings::a2b_hex(string(hex_secret + 1)));
+
+  SSL* mutable_ssl = const_cast<SSL*>(ssl);
+  const int index = TrafficSecretExIndex();
+  delete static_cast<string*>(SSL_get_ex_data(mutable_ssl, index));
+  SSL_set_ex_data(mutable_ssl, index, secret);
+#endif
+}
+
 void TlsHandshake::SetSSLVerify() {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(ssl_);
@@ -85,6 +136,19 @@ void TlsHandshake::SetSSLVerify() {
   }
 
   SSL_set_verify(ssl_.get(), ssl_mode, /* callback = */nullptr);
+
+  if (type_ == TlsHandshakeType::SERVER) {
+    // The session ID context is embedded in the session tickets, and a session
+    // is resumed only by a handshake with the same context. A session which
+    // didn't verify the client's certificate must not be resumed by a
+    // handshake which is supposed to, so each verification mode has its own.
+    static const char* const kVerifyCtx = "kudu-verify";
+    static const char* const kNoVerifyCtx = "kudu-noverify";
+    const char* sid_ctx = (ssl_mode & SSL_VERIFY_PEER) ? kVerifyCtx : kNoVerifyCtx;
+    SSL_set_session_id_context(ssl_.get(),
+                               reinterpret_cast<const unsigned char*>(sid_ctx),
+                               strlen(sid_ctx));
+  }
 }
 
 TlsHandshake::TlsHandshake(TlsHandshakeType type)
@@ -327,7 +391,24 @@ Status TlsHandshake::Finish(unique_ptr<Socket>* socket) {
   }
 
   // Transfer the SSL instance to the socket.
-  socket->reset(new TlsSocket(fd, std::move(ssl_)));
+  unique_ptr<TlsSocket> tls_socket(new TlsSocket(fd, std::move(ssl_)));
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+  // The kernel starts encrypting at record sequence number 0, so the offload
+  // is possible only if OpenSSL hasn't sent any records protected with the
+  // application traffic keys yet.
+  const auto* secret = static_cast<const string*>(
+      SSL_get_ex_data(ssl, TrafficSecretExIndex()));
+  if (FLAGS_rpc_tls_kernel_tx_offload && secret &&
+      data_size == 0 && SSL_version(ssl) == TLS1_3_VERSION) {
+    Status s = tls_socket->EnableKernelTx(*secret);
+    if (!s.ok()) {
+      VLOG(1) << "not offloading TLS encryption to the kernel: " << s.ToString();
+    }
+  }
+#endif
+
+  *socket = std::move(tls_socket);
 
   return Status::OK();
 }
@@ -362,6 +443,11 @@ string TlsHandshake::GetCipherSuite() const {
   return SSL_get_cipher_name(ssl_.get());
 }
 
+bool TlsHandshake::session_reused() const {
+  CHECK(has_started_);
+  return SSL_session_reused(ssl_.get()) == 1;
+}
+
 string TlsHandshake::GetProtocol() const {
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(has_started_);
@@ -146,6 +146,11 @@ class TlsHandshake {
   // handshake is complete and before 'Finish()'.
   std::string GetCipherSuite() const;
 
+  // Whether the handshake resumed a previously established TLS session rather
+  // than running the full handshake. Only valid to call after the handshake is
+  // complete and before 'Finish()'.
+  bool session_reused() const;
+
   // Retrieve the negotiated TLS protocol version. Only valid to call after the
   // handshake is complete and before 'Finish()'.
   std::string GetProtocol() const;
@@ -154,6 +159,11 @@ class TlsHandshake {
   // Only valid to call after the handshake is complete and before 'Finish()'.
   std::string GetCipherDescription() const;
 
+  // Keylog callback installed by TlsContext when --rpc_tls_kernel_tx_offload
+  // is set: remembers the local side's TLSv1.3 application traffic secret in
+  // the SSL handle, so Finish() can hand the transmit path to the kernel.
+  static void CaptureTrafficSecret(const SSL* ssl, const char* line);
+
  private:
   FRIEND_TEST(TestTlsHandshake, HandshakeSequenceNoTLSv1dot3);
   FRIEND_TEST(TestTlsHandshake, HandshakeSequenceTLSv1dot3);
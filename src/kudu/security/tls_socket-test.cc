@@ -31,13 +31,18 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/security/tls_context.h"
 #include "kudu/security/tls_handshake.h"
+#include "kudu/security/tls_socket.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
@@ -49,6 +54,8 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(rpc_tls_kernel_tx_offload);
+
 using std::string;
 using std::thread;
 using std::unique_ptr;
@@ -309,6 +316,35 @@ vector<struct iovec> ChunkIOVec(Random* rng, uint8_t* buf, int len, int max_chun
   return ret;
 }
 
+// Loop calling Writev() until the iov of 'size' bytes is exhausted.
+void WritevFully(Socket* sock, size_t size, vector<struct iovec>* iov_vec) {
+  auto& iov = *iov_vec;
+  int rem = size;
+  while (rem > 0) {
+    CHECK(!iov.empty()) << rem;
+    int64_t n;
+    Status s = sock->Writev(&iov[0], iov.size(), &n);
+    if (Socket::IsTemporarySocketError(s.posix_code())) {
+      sched_yield();
+      continue;
+    }
+    ASSERT_OK(s);
+    ASSERT_LE(n, rem);
+    rem -= n;
+    ASSERT_GE(n, 0);
+    while (n > 0) {
+      if (n < iov[0].iov_len) {
+        iov[0].iov_len -= n;
+        iov[0].iov_base = reinterpret_cast<uint8_t*>(iov[0].iov_base) + n;
+        n = 0;
+      } else {
+        n -= iov[0].iov_len;
+        iov.erase(iov.begin());
+      }
+    }
+  }
+}
+
 // Regression test for KUDU-2218, a bug in which Writev would improperly handle
 // partial writes in non-blocking mode.
 TEST_F(TlsSocketTest, TestNonBlockingWritev) {
@@ -331,32 +367,7 @@ TEST_F(TlsSocketTest, TestNonBlockingWritev) {
     // Prepare an IOV with the input data split into a bunch of randomly-sized
     // chunks.
     vector<struct iovec> iov = ChunkIOVec(&rng, buf.get(), kEchoChunkSize, 1024 * 1024);
-
-    // Loop calling writev until the iov is exhausted
-    int rem = kEchoChunkSize;
-    while (rem > 0) {
-      CHECK(!iov.empty()) << rem;
-      int64_t n;
-      Status s = client_sock->Writev(&iov[0], iov.size(), &n);
-      if (Socket::IsTemporarySocketError(s.posix_code())) {
-        sched_yield();
-        continue;
-      }
-      ASSERT_OK(s);
-      ASSERT_LE(n, rem);
-      rem -= n;
-      ASSERT_GE(n, 0);
-      while (n > 0) {
-        if (n < iov[0].iov_len) {
-          iov[0].iov_len -= n;
-          iov[0].iov_base = reinterpret_cast<uint8_t*>(iov[0].iov_base) + n;
-          n = 0;
-        } else {
-          n -= iov[0].iov_len;
-          iov.erase(iov.begin());
-        }
-      }
-    }
+    NO_FATALS(WritevFully(client_sock.get(), kEchoChunkSize, &iov));
     LOG(INFO) << "client waiting";
 
     size_t n;
@@ -372,5 +383,54 @@ TEST_F(TlsSocketTest, TestNonBlockingWritev) {
   ASSERT_OK(client_sock->Close());
 }
 
+class KernelTlsSocketTest : public TlsSocketTest {
+ public:
+  void SetUp() override {
+    FLAGS_rpc_tls_kernel_tx_offload = true;
+    TlsSocketTest::SetUp();
+  }
+};
+
+// Plaintext written to a socket whose transmit path is offloaded to the kernel
+// must arrive intact at a peer decrypting with OpenSSL, and vice versa.
+TEST_F(KernelTlsSocketTest, TestEcho) {
+  Random rng(GetRandomSeed32());
+
+  EchoServer server;
+  NO_FATALS(server.Start());
+
+  unique_ptr<Socket> client_sock;
+  NO_FATALS(ConnectClient(server.listen_addr(), &client_sock));
+  const auto* tls_sock = down_cast<TlsSocket*>(client_sock.get());
+  const string cipher = tls_sock->GetCipherDescription();
+  if (cipher.find("TLSv1.3") == string::npos || cipher.find("GCM") == string::npos) {
+    GTEST_SKIP() << "kernel TLS offload isn't supported for cipher " << cipher;
+  }
+  // The kernel lists the TLS upper layer protocol once its module is loaded,
+  // which enabling the offload does if needed.
+  faststring ulps;
+  if (!ReadFileToString(env_, "/proc/sys/net/ipv4/tcp_available_ulp", &ulps).ok() ||
+      ulps.ToString().find("tls") == string::npos) {
+    GTEST_SKIP() << "kernel TLS isn't supported by this kernel";
+  }
+  ASSERT_TRUE(tls_sock->kernel_tx());
+
+  unique_ptr<uint8_t[]> buf(new uint8_t[kEchoChunkSize]);
+  unique_ptr<uint8_t[]> rbuf(new uint8_t[kEchoChunkSize]);
+  for (int i = 0; i < 2; i++) {
+    RandomString(buf.get(), kEchoChunkSize, &rng);
+    vector<struct iovec> iov = ChunkIOVec(&rng, buf.get(), kEchoChunkSize, 64 * 1024);
+    NO_FATALS(WritevFully(client_sock.get(), kEchoChunkSize, &iov));
+
+    size_t n;
+    ASSERT_OK(client_sock->BlockingRecv(rbuf.get(), kEchoChunkSize, &n,
+        MonoTime::Now() + kTimeout));
+    ASSERT_EQ(0, memcmp(buf.get(), rbuf.get(), kEchoChunkSize));
+  }
+
+  server.Stop();
+  ASSERT_OK(client_sock->Close());
+}
+
 } // namespace security
 } // namespace kudu
@@ -18,11 +18,21 @@
 #include "kudu/security/tls_socket.h"
 
 #include <openssl/err.h>
+#include <openssl/evp.h>
 #include <openssl/ssl.h>
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+#include <openssl/kdf.h>
+#endif
 #include <sys/socket.h>
+#if defined(__linux__)
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 #include <cerrno>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <string>
 #include <utility>
@@ -35,6 +45,16 @@
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/net/socket.h"
 #include "kudu/util/openssl_util.h"
+#include "kudu/util/scoped_cleanup.h"
+
+#if defined(__linux__)
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
 
 using std::string;
 using strings::Substitute;
@@ -42,9 +62,53 @@ using strings::Substitute;
 namespace kudu {
 namespace security {
 
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+template<> struct SslTypeTraits<EVP_PKEY_CTX> {
+  static constexpr auto kFreeFunc = &EVP_PKEY_CTX_free;
+};
+
+namespace {
+
+// HKDF-Expand-Label() as defined by RFC 8446, section 7.1, with an empty
+// context: derives 'out_len' bytes of keying material from 'secret'.
+Status HkdfExpandLabel(const EVP_MD* md,
+                       const string& secret,
+                       const string& label,
+                       uint8_t* out,
+                       size_t out_len) {
+  const string full_label = "tls13 " + label;
+  string info;
+  info.push_back(static_cast<char>(out_len >> 8));
+  info.push_back(static_cast<char>(out_len & 0xff));
+  info.push_back(static_cast<char>(full_label.size()));
+  info.append(full_label);
+  info.push_back(0);
+
+  auto ctx = ssl_make_unique(EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr));
+  OPENSSL_RET_IF_NULL(ctx, "failed to create HKDF context");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_derive_init(ctx.get()), "failed to initialize HKDF");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_hkdf_mode(ctx.get(), EVP_PKEY_HKDEF_MODE_EXPAND_ONLY),
+                     "failed to set HKDF mode");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_set_hkdf_md(ctx.get(), md), "failed to set HKDF digest");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_set1_hkdf_key(
+      ctx.get(), reinterpret_cast<const unsigned char*>(secret.data()), secret.size()),
+                     "failed to set HKDF key");
+  OPENSSL_RET_NOT_OK(EVP_PKEY_CTX_add1_hkdf_info(
+      ctx.get(), reinterpret_cast<const unsigned char*>(info.data()), info.size()),
+                     "failed to set HKDF info");
+  size_t len = out_len;
+  OPENSSL_RET_NOT_OK(EVP_PKEY_derive(ctx.get(), out, &len), "failed to derive key");
+  DCHECK_EQ(out_len, len);
+  return Status::OK();
+}
+
+} // anonymous namespace
+#endif
+
 TlsSocket::TlsSocket(int fd, c_unique_ptr<SSL> ssl)
     : Socket(fd),
-      ssl_(std::move(ssl)) {
+      ssl_(std::move(ssl)),
+      kernel_tx_(false) {
   use_cork_ = true;
 
 #ifndef __APPLE__
@@ -65,7 +129,92 @@ TlsSocket::~TlsSocket() {
   ignore_result(Close());
 }
 
+Status TlsSocket::EnableKernelTx(const string& traffic_secret) {
+#if defined(__linux__) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+  SCOPED_OPENSSL_NO_PENDING_ERRORS;
+  CHECK(ssl_);
+  DCHECK(!kernel_tx_);
+  const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl_.get());
+  if (!cipher) {
+    return Status::IllegalState("no TLS cipher negotiated");
+  }
+
+  union {
+    tls12_crypto_info_aes_gcm_128 aes_128;
+    tls12_crypto_info_aes_gcm_256 aes_256;
+  } crypto_info;
+  memset(&crypto_info, 0, sizeof(crypto_info));
+  SCOPED_CLEANUP({ OPENSSL_cleanse(&crypto_info, sizeof(crypto_info)); });
+
+  // The salt and the IV have the same size for both ciphers: together they
+  // form the 12-byte TLSv1.3 per-connection write IV. The record sequence
+  // number stays zero since no application data has been sent yet.
+  static_assert(TLS_CIPHER_AES_GCM_128_SALT_SIZE == TLS_CIPHER_AES_GCM_256_SALT_SIZE &&
+                TLS_CIPHER_AES_GCM_128_IV_SIZE == TLS_CIPHER_AES_GCM_256_IV_SIZE,
+                "unexpected AES-GCM IV layout");
+  uint8_t* key;
+  size_t key_size;
+  uint8_t* salt;
+  uint8_t* iv;
+  size_t crypto_info_size;
+  switch (SSL_CIPHER_get_id(cipher)) {
+    case TLS1_3_CK_AES_128_GCM_SHA256:
+      crypto_info.aes_128.info.version = TLS_1_3_VERSION;
+      crypto_info.aes_128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+      key = crypto_info.aes_128.key;
+      key_size = sizeof(crypto_info.aes_128.key);
+      salt = crypto_info.aes_128.salt;
+      iv = crypto_info.aes_128.iv;
+      crypto_info_size = sizeof(crypto_info.aes_128);
+      break;
+    case TLS1_3_CK_AES_256_GCM_SHA384:
+      crypto_info.aes_256.info.version = TLS_1_3_VERSION;
+      crypto_info.aes_256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+      key = crypto_info.aes_256.key;
+      key_size = sizeof(crypto_info.aes_256.key);
+      salt = crypto_info.aes_256.salt;
+      iv = crypto_info.aes_256.iv;
+      crypto_info_size = sizeof(crypto_info.aes_256);
+      break;
+    default:
+      return Status::NotSupported("cipher is not supported by kernel TLS",
+                                  SSL_CIPHER_get_name(cipher));
+  }
+
+  const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+  uint8_t write_iv[TLS_CIPHER_AES_GCM_128_SALT_SIZE + TLS_CIPHER_AES_GCM_128_IV_SIZE];
+  RETURN_NOT_OK(HkdfExpandLabel(md, traffic_secret, "key", key, key_size));
+  RETURN_NOT_OK(HkdfExpandLabel(md, traffic_secret, "iv", write_iv, sizeof(write_iv)));
+  memcpy(salt, write_iv, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+  memcpy(iv, write_iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+  OPENSSL_cleanse(write_iv, sizeof(write_iv));
+
+  // Attaching the TLS upper layer protocol alone doesn't change what goes
+  // over the wire, so a failure to configure the transmit keys below leaves
+  // the socket usable with encryption done by OpenSSL.
+  const int fd = GetFd();
+  static const char kTlsUlp[] = "tls";
+  if (setsockopt(fd, SOL_TCP, TCP_ULP, kTlsUlp, sizeof(kTlsUlp)) != 0) {
+    int err = errno;
+    return Status::NotSupported("failed to attach kernel TLS to socket",
+                                ErrnoToString(err), err);
+  }
+  if (setsockopt(fd, SOL_TLS, TLS_TX, &crypto_info, crypto_info_size) != 0) {
+    int err = errno;
+    return Status::NotSupported("failed to set kernel TLS transmit keys",
+                                ErrnoToString(err), err);
+  }
+  kernel_tx_ = true;
+  return Status::OK();
+#else
+  return Status::NotSupported("kernel TLS is not supported on this platform");
+#endif
+}
+
 Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
+  if (kernel_tx_) {
+    return Socket::Write(buf, amt, nwritten);
+  }
   CHECK(ssl_);
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
 
@@ -98,6 +247,11 @@ Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
 }
 
 Status TlsSocket::Writev(const struct ::iovec *iov, int iov_len, int64_t *nwritten) {
+  if (kernel_tx_) {
+    // The kernel frames and encrypts the plaintext into records itself, so
+    // there is no need to coalesce or cork the buffers.
+    return Socket::Writev(iov, iov_len, nwritten);
+  }
   SCOPED_OPENSSL_NO_PENDING_ERRORS;
   CHECK(ssl_);
 
@@ -240,7 +394,11 @@ Status TlsSocket::Close() {
   }
 
   // Start the TLS shutdown processes. We don't care about waiting for the
-  // response, since the underlying socket will not be reused.
+  // response, since the underlying socket will not be reused. If the kernel
+  // encrypts outbound records, OpenSSL can't send the close_notify alert.
+  if (kernel_tx_) {
+    SSL_set_quiet_shutdown(ssl_.get(), 1);
+  }
   int32_t ret = SSL_shutdown(ssl_.get());
   Status ssl_shutdown;
   if (ret >= 0) {
@@ -57,17 +57,29 @@ class TlsSocket : public Socket {
   // Get the description of the negotiated TLS cipher suite for the connection.
   std::string GetCipherDescription() const;
 
+  // Whether records sent over the connection are encrypted by the kernel.
+  bool kernel_tx() const { return kernel_tx_; }
+
  private:
 
   friend class TlsHandshake;
 
   TlsSocket(int fd, c_unique_ptr<SSL> ssl);
 
+  // Configure the kernel TLS (kTLS) transmit path of the socket with the keys
+  // derived from the given TLSv1.3 application traffic secret. On success,
+  // Write() and Writev() send plaintext directly to the socket. Must be called
+  // before any application data is written.
+  Status EnableKernelTx(const std::string& traffic_secret) WARN_UNUSED_RESULT;
+
   // Owned SSL handle.
   c_unique_ptr<SSL> ssl_;
 
   bool use_cork_;
 
+  // Whether the kernel encrypts the outbound records: see EnableKernelTx().
+  bool kernel_tx_;
+
   // Socket-local buffer used by Writev().
   faststring buf_;
 };
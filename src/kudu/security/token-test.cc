@@ -622,6 +622,49 @@ TEST_F(TokenTest, TestEndToEnd_Valid) {
   ASSERT_EQ(TokenVerificationResult::VALID, verifier.VerifyTokenSignature(signed_token, &token));
 }
 
+// Test that tokens verified from the cache of verified tokens are verified
+// just the same: the cache mustn't vouch for a token whose data or signature
+// doesn't match those of the verified one.
+TEST_F(TokenTest, TestEndToEnd_VerifiedTokenCache) {
+  TokenSigner signer(kTokenValiditySeconds, kTokenValiditySeconds, 10);
+  {
+    unique_ptr<TokenSigningPrivateKey> key;
+    ASSERT_OK(signer.CheckNeedKey(&key));
+    ASSERT_NE(nullptr, key.get());
+    ASSERT_OK(signer.AddKey(std::move(key)));
+  }
+  TokenVerifier verifier;
+  ASSERT_OK(verifier.ImportKeys(signer.verifier().ExportKeys()));
+
+  SignedTokenPB signed_token = MakeUnsignedToken(WallTime_Now() + 600);
+  ASSERT_OK(signer.SignToken(&signed_token));
+  for (int i = 0; i < 2; i++) {
+    TokenPB token;
+    ASSERT_EQ(TokenVerificationResult::VALID,
+              verifier.VerifyTokenSignature(signed_token, &token));
+  }
+
+  // The same signature with other token data.
+  {
+    SignedTokenPB other_token = MakeUnsignedToken(WallTime_Now() + 1200);
+    other_token.set_signature(signed_token.signature());
+    other_token.set_signing_key_seq_num(signed_token.signing_key_seq_num());
+    TokenPB token;
+    ASSERT_EQ(TokenVerificationResult::INVALID_SIGNATURE,
+              verifier.VerifyTokenSignature(other_token, &token));
+  }
+  // The same token data with another signature.
+  {
+    SignedTokenPB other_token = signed_token;
+    string signature = other_token.signature();
+    signature[0] ^= 1;
+    other_token.set_signature(signature);
+    TokenPB token;
+    ASSERT_EQ(TokenVerificationResult::INVALID_SIGNATURE,
+              verifier.VerifyTokenSignature(other_token, &token));
+  }
+}
+
 // Test all of the possible cases covered by token verification.
 // See TokenVerificationResult.
 TEST_F(TokenTest, TestEndToEnd_InvalidCases) {
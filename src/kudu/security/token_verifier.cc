@@ -25,16 +25,36 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/security/token_signing_key.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
+DEFINE_uint32(token_verification_cache_capacity_mb, 16,
+              "Capacity of the cache of the tokens whose signature has been "
+              "verified, in MiB. With the cache, the signature of the tokens "
+              "presented again, e.g. by reconnecting clients, isn't verified "
+              "again. 0 disables the cache.");
+TAG_FLAG(token_verification_cache_capacity_mb, advanced);
+TAG_FLAG(token_verification_cache_capacity_mb, experimental);
+
+DEFINE_uint32(token_verification_cache_ttl_sec, 60,
+              "How long the tokens whose signature has been verified stay in "
+              "the cache enabled by --token_verification_cache_capacity_mb, in "
+              "seconds. The expiration of the tokens and of their signing keys "
+              "is checked regardless.");
+TAG_FLAG(token_verification_cache_ttl_sec, advanced);
+TAG_FLAG(token_verification_cache_ttl_sec, experimental);
+
 using std::lock_guard;
 using std::string;
 using std::transform;
@@ -45,6 +65,14 @@ namespace kudu {
 namespace security {
 
 TokenVerifier::TokenVerifier() {
+  if (FLAGS_token_verification_cache_capacity_mb > 0 &&
+      FLAGS_token_verification_cache_ttl_sec > 0) {
+    const auto ttl = MonoDelta::FromSeconds(FLAGS_token_verification_cache_ttl_sec);
+    verified_tokens_.reset(new VerifiedTokenCache(
+        static_cast<size_t>(FLAGS_token_verification_cache_capacity_mb) * 1024 * 1024,
+        ttl, /*scrubbing_period=*/ttl, /*max_scrubbed_entries_per_pass_num=*/0,
+        "token-verification-cache"));
+  }
 }
 
 TokenVerifier::~TokenVerifier() {
@@ -138,9 +166,24 @@ TokenVerificationResult TokenVerifier::VerifyTokenSignature(
     if (tsk->pb().expire_unix_epoch_seconds() < now) {
       return TokenVerificationResult::EXPIRED_SIGNING_KEY;
     }
+    // The keys are never replaced once imported, so a signature verified with
+    // the key of a given sequence number stays valid.
+    string cache_key;
+    if (verified_tokens_) {
+      cache_key = strings::Substitute("$0:$1:", signed_token.signing_key_seq_num(),
+                                      signed_token.signature().size());
+      cache_key.append(signed_token.signature());
+      cache_key.append(signed_token.token_data());
+      if (verified_tokens_->Get(cache_key)) {
+        return TokenVerificationResult::VALID;
+      }
+    }
     if (!tsk->VerifySignature(signed_token)) {
       return TokenVerificationResult::INVALID_SIGNATURE;
     }
+    if (verified_tokens_) {
+      verified_tokens_->Put(cache_key, unique_ptr<bool>(new bool(true)));
+    }
   }
 
   return TokenVerificationResult::VALID;
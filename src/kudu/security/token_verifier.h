@@ -19,11 +19,13 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/util/rw_mutex.h"
+#include "kudu/util/ttl_cache.h"
 
 namespace kudu {
 
@@ -54,6 +56,11 @@ enum class TokenVerificationResult;
 // and is not yet expired. Any business rules around authorization or
 // authentication are left up to callers.
 //
+// Verifying a signature is expensive, and reconnecting clients present the
+// same tokens over and over again, so the tokens whose signature has been
+// verified are cached for a while (see --token_verification_cache_ttl_sec):
+// verifying them again takes only the cheap checks, e.g. for expiration.
+//
 // NOTE: old tokens are never removed from the underlying storage of this
 // class. The assumption is that tokens rotate so infreqeuently that this
 // slow leak is not worrisome. If this class is adopted for any use cases
@@ -91,10 +98,17 @@ class TokenVerifier {
  private:
   typedef std::map<int64_t, std::unique_ptr<TokenSigningPublicKey>> KeysMap;
 
+  // Keyed by the signing key sequence number, the signature, and the data of
+  // the tokens with a valid signature. The values are unused.
+  typedef TTLCache<std::string, bool> VerifiedTokenCache;
+
   // Lock protecting keys_by_seq_
   mutable RWMutex lock_;
   KeysMap keys_by_seq_;
 
+  // Null if --token_verification_cache_capacity_mb is 0.
+  std::unique_ptr<VerifiedTokenCache> verified_tokens_;
+
   DISALLOW_COPY_AND_ASSIGN(TokenVerifier);
 };
 
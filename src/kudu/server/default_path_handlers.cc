@@ -24,8 +24,10 @@
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -47,6 +49,7 @@
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/pprof_path_handlers.h"
+#include "kudu/server/stack_profiler.h"
 #include "kudu/server/webserver.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/debug-util.h"
@@ -54,6 +57,7 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flags.h"
 #include "kudu/util/jsonwriter.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -103,6 +107,15 @@ DEFINE_validator(metrics_default_level, [](const char* flag_name, const string&
   return false;
 });
 
+DEFINE_int32(metrics_rendering_cache_ttl_ms, 0,
+             "The number of milliseconds for which the output rendered by the '/metrics' "
+             "and '/metrics_prometheus' endpoints is served again to the requests with the "
+             "same query string, saving the frequent scrapes of servers with many tablets "
+             "re-rendering all their metrics. 0 disables the caching.");
+TAG_FLAG(metrics_rendering_cache_ttl_ms, advanced);
+TAG_FLAG(metrics_rendering_cache_ttl_ms, experimental);
+TAG_FLAG(metrics_rendering_cache_ttl_ms, runtime);
+
 // For configuration dashboard
 DECLARE_bool(webserver_require_spnego);
 DECLARE_string(redact);
@@ -249,6 +262,14 @@ static void MemUsageHandler(const Webserver::WebRequest& req,
 #endif
 }
 
+// Registered to handle "/contention", and prints out the contention of the
+// hot-path locks. Prints plain text if "raw" is set, e.g. "/contention?raw".
+static void ContentionHandler(const Webserver::WebRequest& req,
+                              Webserver::PrerenderedWebResponse* resp) {
+  bool as_text = (req.parsed_args.find("raw") != req.parsed_args.end());
+  DumpLockContention(&resp->output, !as_text);
+}
+
 // Registered to handle "/mem-trackers", and prints out memory tracker information.
 static void MemTrackersHandler(const Webserver::WebRequest& /*req*/,
                                Webserver::PrerenderedWebResponse* resp) {
@@ -454,12 +475,16 @@ void AddPostInitializedDefaultPathHandlers(Webserver* webserver) {
   webserver->RegisterPrerenderedPathHandler("/healthz", "Health", HealthHandler,
                                             /*is_styled=*/false,
                                             /*is_on_nav_bar=*/true);
+  webserver->RegisterPrerenderedPathHandler("/contention", "Lock Contention", ContentionHandler,
+                                            /*is_styled=*/true,
+                                            /*is_on_nav_bar=*/false);
   AddPprofPathHandlers(webserver);
 }
 
-static bool ParseBool(const Webserver::ArgumentMap& args, const string& key) {
-  string arg = FindWithDefault(args, key, "false");
-  return ParseLeadingBoolValue(arg.c_str(), false);
+static bool ParseBool(const Webserver::ArgumentMap& args, const string& key,
+                      bool default_value = false) {
+  const string* arg = FindOrNull(args, key);
+  return arg ? ParseLeadingBoolValue(arg->c_str(), default_value) : default_value;
 }
 
 static vector<string> ParseArray(const Webserver::ArgumentMap& args, const string& key) {
@@ -471,14 +496,79 @@ static vector<string> ParseArray(const Webserver::ArgumentMap& args, const strin
   return value;
 }
 
-static void WriteMetricsAsJson(const MetricRegistry* const metrics,
-                               const Webserver::WebRequest& req,
-                               Webserver::PrerenderedWebResponse* resp) {
-  MetricJsonOptions opts;
-  opts.include_raw_histograms = ParseBool(req.parsed_args, "include_raw_histograms");
-  opts.include_schema_info = ParseBool(req.parsed_args, "include_schema");
+namespace {
+
+// The output of the metrics endpoints, cached by endpoint and query string.
+// See --metrics_rendering_cache_ttl_ms.
+class RenderedMetricsCache {
+ public:
+  // Renders the response to 'req' of the endpoint 'path' into 'resp' with
+  // 'render', or copies it from the cache if it was rendered recently enough.
+  void Render(const string& path,
+              const Webserver::WebRequest& req,
+              Webserver::PrerenderedWebResponse* resp,
+              const std::function<void(Webserver::PrerenderedWebResponse*)>& render) {
+    const int32_t ttl_ms = FLAGS_metrics_rendering_cache_ttl_ms;
+    if (ttl_ms <= 0) {
+      render(resp);
+      return;
+    }
+    const string key = Substitute("$0?$1", path, req.query_string);
+    const MonoTime now = MonoTime::Now();
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      const Entry* entry = FindOrNull(entries_, key);
+      if (entry && now - entry->rendered < MonoDelta::FromMilliseconds(ttl_ms)) {
+        resp->status_code = entry->status_code;
+        resp->output << entry->output;
+        return;
+      }
+    }
 
-  MetricFilters& filters = opts.filters;
+    render(resp);
+    Entry entry;
+    entry.rendered = now;
+    entry.status_code = resp->status_code;
+    entry.output = resp->output.str();
+    std::lock_guard<std::mutex> l(lock_);
+    // Only a few query strings are expected to be scraped: forget the stale
+    // entries, and all of them if there are too many anyway.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (now - it->second.rendered >= MonoDelta::FromMilliseconds(ttl_ms)) {
+        it = entries_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (entries_.size() >= kMaxEntries) {
+      entries_.clear();
+    }
+    entries_[key] = std::move(entry);
+  }
+
+ private:
+  static constexpr size_t kMaxEntries = 64;
+
+  struct Entry {
+    MonoTime rendered;
+    HttpStatusCode status_code;
+    string output;
+  };
+
+  std::mutex lock_;
+  std::unordered_map<string, Entry> entries_;
+};
+
+} // anonymous namespace
+
+// Sets 'opts' to the options of the metrics requested by 'req'.
+static Status ParseMetricOptions(const Webserver::WebRequest& req, MetricJsonOptions* opts) {
+  opts->include_raw_histograms = ParseBool(req.parsed_args, "include_raw_histograms");
+  opts->include_schema_info = ParseBool(req.parsed_args, "include_schema");
+  opts->include_untouched_metrics =
+      ParseBool(req.parsed_args, "include_untouched_metrics", true);
+
+  MetricFilters& filters = opts->filters;
   filters.entity_types = ParseArray(req.parsed_args, "types");
   filters.entity_ids = ParseArray(req.parsed_args, "ids");
   filters.entity_attrs = ParseArray(req.parsed_args, "attributes");
@@ -492,28 +582,56 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
       // Index 0: entity type needed to be merged.
       // Index 1: 'merge_to' field of MergeAttributes.
       // Index 2: 'attribute_to_merge_by' field of MergeAttributes.
-      EmplaceIfNotPresent(&opts.merge_rules, values[0], MergeAttributes(values[1], values[2]));
+      EmplaceIfNotPresent(&opts->merge_rules, values[0], MergeAttributes(values[1], values[2]));
     }
   }
 
-  JsonWriter::Mode json_mode = ParseBool(req.parsed_args, "compact") ?
-      JsonWriter::COMPACT : JsonWriter::PRETTY;
-
   // The number of entity_attrs should always be even because
   // each pair represents a key and a value.
   if (filters.entity_attrs.size() % 2 != 0) {
+    return Status::InvalidArgument("The parameter of 'attributes' is wrong");
+  }
+  return Status::OK();
+}
+
+static void WriteMetricsAsJson(const MetricRegistry* const metrics,
+                               const Webserver::WebRequest& req,
+                               Webserver::PrerenderedWebResponse* resp) {
+  MetricJsonOptions opts;
+  Status s = ParseMetricOptions(req, &opts);
+  if (!s.ok()) {
     resp->status_code = HttpStatusCode::BadRequest;
-    WARN_NOT_OK(Status::InvalidArgument(""), "The parameter of 'attributes' is wrong");
-  } else {
-    JsonWriter writer(&resp->output, json_mode);
-    WARN_NOT_OK(metrics->WriteAsJson(&writer, opts), "Couldn't write JSON metrics over HTTP");
+    WARN_NOT_OK(s, "Couldn't parse the metrics request");
+    return;
   }
+
+  JsonWriter::Mode json_mode = ParseBool(req.parsed_args, "compact") ?
+      JsonWriter::COMPACT : JsonWriter::PRETTY;
+  JsonWriter writer(&resp->output, json_mode);
+  WARN_NOT_OK(metrics->WriteAsJson(&writer, opts), "Couldn't write JSON metrics over HTTP");
+}
+
+static void WriteMetricsAsPrometheus(const MetricRegistry* const metrics,
+                                     const Webserver::WebRequest& req,
+                                     Webserver::PrerenderedWebResponse* resp) {
+  MetricJsonOptions opts;
+  Status s = ParseMetricOptions(req, &opts);
+  if (!s.ok()) {
+    resp->status_code = HttpStatusCode::BadRequest;
+    WARN_NOT_OK(s, "Couldn't parse the metrics request");
+    return;
+  }
+  WARN_NOT_OK(metrics->WriteAsPrometheus(&resp->output, opts),
+              "Couldn't write Prometheus metrics over HTTP");
 }
 
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics) {
-  auto callback = [metrics](const Webserver::WebRequest& req,
-                            Webserver::PrerenderedWebResponse* resp) {
-    WriteMetricsAsJson(metrics, req, resp);
+  auto cache = std::make_shared<RenderedMetricsCache>();
+  auto callback = [metrics, cache](const Webserver::WebRequest& req,
+                                   Webserver::PrerenderedWebResponse* resp) {
+    cache->Render("/metrics", req, resp, [&](Webserver::PrerenderedWebResponse* rendered) {
+      WriteMetricsAsJson(metrics, req, rendered);
+    });
   };
   bool not_styled = false;
   bool not_on_nav_bar = false;
@@ -527,4 +645,42 @@ void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* cons
                                             not_styled, not_on_nav_bar);
 }
 
+void RegisterMetricsPrometheusHandler(Webserver* webserver, const MetricRegistry* const metrics) {
+  auto cache = std::make_shared<RenderedMetricsCache>();
+  auto callback = [metrics, cache](const Webserver::WebRequest& req,
+                                   Webserver::PrerenderedWebResponse* resp) {
+    cache->Render("/metrics_prometheus", req, resp,
+                  [&](Webserver::PrerenderedWebResponse* rendered) {
+      WriteMetricsAsPrometheus(metrics, req, rendered);
+    });
+  };
+  bool not_styled = false;
+  bool not_on_nav_bar = false;
+  webserver->RegisterPrerenderedPathHandler("/metrics_prometheus", "Prometheus Metrics", callback,
+                                            not_styled, not_on_nav_bar);
+}
+
+// Registered to handle "/stacks/profile".
+//
+// Prints out the stacks sampled by the stack profiler, and optionally
+// discards them afterwards.
+static void StackProfileHandler(server::StackProfiler* profiler,
+                                const Webserver::WebRequest& req,
+                                Webserver::PrerenderedWebResponse* resp) {
+  profiler->DumpFolded(&resp->output);
+  if (ParseBool(req.parsed_args, "reset")) {
+    profiler->Reset();
+  }
+}
+
+void RegisterStackProfileHandler(Webserver* webserver, server::StackProfiler* profiler) {
+  auto callback = [profiler](const Webserver::WebRequest& req,
+                             Webserver::PrerenderedWebResponse* resp) {
+    StackProfileHandler(profiler, req, resp);
+  };
+  webserver->RegisterPrerenderedPathHandler("/stacks/profile", "Stack Profile", callback,
+                                            /*is_styled=*/false,
+                                            /*is_on_nav_bar=*/false);
+}
+
 } // namespace kudu
@@ -23,6 +23,10 @@ namespace kudu {
 class MetricRegistry;
 class Webserver;
 
+namespace server {
+class StackProfiler;
+} // namespace server
+
 // Adds a set of default path handlers to the webserver to display
 // logs and configuration flags before the server is initialized.
 void AddPreInitializedDefaultPathHandlers(Webserver* webserver);
@@ -34,6 +38,14 @@ void AddPostInitializedDefaultPathHandlers(Webserver* webserver);
 // Adds an endpoint to get metrics in JSON format.
 void RegisterMetricsJsonHandler(Webserver* webserver, const MetricRegistry* const metrics);
 
+// Adds an endpoint to get metrics in the Prometheus text format, which takes
+// the filtering and merging parameters of the JSON endpoint.
+void RegisterMetricsPrometheusHandler(Webserver* webserver, const MetricRegistry* const metrics);
+
+// Adds an endpoint to get the stack profile aggregated by 'profiler' in the
+// folded format read by flame graph tools.
+void RegisterStackProfileHandler(Webserver* webserver, server::StackProfiler* profiler);
+
 } // namespace kudu
 
 #endif // KUDU_SERVER_DEFAULT_PATH_HANDLERS_H
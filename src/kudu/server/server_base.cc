@@ -64,6 +64,7 @@
 #include "kudu/server/rpcz-path-handler.h"
 #include "kudu/server/server_base.pb.h"
 #include "kudu/server/server_base_options.h"
+#include "kudu/server/stack_profiler.h"
 #include "kudu/server/startup_path_handler.h"
 #include "kudu/server/tcmalloc_metrics.h"
 #include "kudu/server/tracing_path_handlers.h"
@@ -76,6 +77,7 @@
 #include "kudu/util/flag_validators.h"
 #include "kudu/util/flags.h"
 #include "kudu/util/jsonwriter.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -573,6 +575,7 @@ Status ServerBase::Init() {
   glog_metrics_.reset(new ScopedGLogMetrics(metric_entity_));
   tcmalloc::RegisterMetrics(metric_entity_);
   RegisterSpinLockContentionMetrics(metric_entity_);
+  RegisterLockContentionMetrics(metric_entity_);
 
   InitSpinLockContentionProfiling();
 
@@ -865,6 +868,9 @@ void ServerBase::ShutdownImpl() {
   if (diag_log_) {
     diag_log_->Stop();
   }
+  if (stack_profiler_) {
+    stack_profiler_->Stop();
+  }
   if (excess_log_deleter_thread_) {
     excess_log_deleter_thread_->Join();
   }
@@ -952,6 +958,8 @@ Status ServerBase::Start() {
 
 
   RETURN_NOT_OK_PREPEND(StartMetricsLogging(), "Could not enable metrics logging");
+  stack_profiler_.reset(new StackProfiler);
+  RETURN_NOT_OK_PREPEND(stack_profiler_->Start(), "Could not start the stack profiler");
 
   result_tracker_->StartGCThread();
   RETURN_NOT_OK(StartExcessLogFileDeleterThread());
@@ -966,6 +974,8 @@ Status ServerBase::Start() {
     AddPostInitializedDefaultPathHandlers(web_server_.get());
     AddRpczPathHandlers(messenger_, web_server_.get());
     RegisterMetricsJsonHandler(web_server_.get(), metric_registry_.get());
+    RegisterMetricsPrometheusHandler(web_server_.get(), metric_registry_.get());
+    RegisterStackProfileHandler(web_server_.get(), stack_profiler_.get());
     TracingPathHandlers::RegisterHandlers(web_server_.get());
     web_server_->set_footer_html(FooterHtml());
     web_server_->SetStartupComplete(true);
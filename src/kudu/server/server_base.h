@@ -66,6 +66,7 @@ class TokenVerifier;
 namespace server {
 class DiagnosticsLog;
 class ServerStatusPB;
+class StackProfiler;
 class StartupPathHandler;
 
 // Base class for tablet server and master.
@@ -269,6 +270,7 @@ class ServerBase {
   ServerBaseOptions options_;
 
   std::unique_ptr<DiagnosticsLog> diag_log_;
+  std::unique_ptr<StackProfiler> stack_profiler_;
   scoped_refptr<Thread> excess_log_deleter_thread_;
 #ifdef TCMALLOC_ENABLED
   scoped_refptr<Thread> tcmalloc_memory_gc_thread_;
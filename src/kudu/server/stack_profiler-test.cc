@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/server/stack_profiler.h"
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+
+namespace kudu {
+namespace server {
+
+class StackProfilerTest : public KuduTest {};
+
+TEST_F(StackProfilerTest, TestThreadGroup) {
+  ASSERT_EQ("sleeper", StackProfiler::ThreadGroup("sleeper-1234"));
+  ASSERT_EQ("rpc worker", StackProfiler::ThreadGroup("rpc worker-56"));
+  ASSERT_EQ("apply [worker]", StackProfiler::ThreadGroup("apply [worker]"));
+  ASSERT_EQ("thread-", StackProfiler::ThreadGroup("thread-"));
+  ASSERT_EQ("12", StackProfiler::ThreadGroup("12"));
+}
+
+TEST_F(StackProfilerTest, TestSampleStacks) {
+  // Start a thread which waits off of the CPU until the end of the test.
+  CountDownLatch latch(1);
+  scoped_refptr<Thread> thread;
+  ASSERT_OK(Thread::Create("test", "sleeper",
+                           [&latch]() { latch.Wait(); },
+                           &thread));
+  SCOPED_CLEANUP({
+    latch.CountDown();
+    thread->Join();
+  });
+  // Give the thread some time to block.
+  SleepFor(MonoDelta::FromMilliseconds(100));
+
+  StackProfiler profiler;
+  ASSERT_OK(profiler.SampleNow());
+  ASSERT_OK(profiler.SampleNow());
+  ASSERT_GT(profiler.num_samples(), 0);
+
+  std::ostringstream out;
+  profiler.DumpFolded(&out);
+  const string dump = out.str();
+  // The two samples of the sleeping thread have the same stack.
+  ASSERT_STR_MATCHES(dump, "\nsleeper;off-cpu;[^\n]* 2\n");
+
+  profiler.Reset();
+  ASSERT_EQ(0, profiler.num_samples());
+  std::ostringstream reset_out;
+  profiler.DumpFolded(&reset_out);
+  ASSERT_EQ("# 0 samples, 0 dropped\n", reset_out.str());
+}
+
+} // namespace server
+} // namespace kudu
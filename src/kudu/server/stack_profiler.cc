@@ -0,0 +1,235 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/server/stack_profiler.h"
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(stack_profiler_sample_interval_ms, 0,
+             "The mean interval at which the stacks of all of the server's threads "
+             "are sampled for the stack profile served at /stacks/profile. The samples "
+             "are taken at random intervals between zero and twice this value. "
+             "If 0 or less, no samples are taken.");
+TAG_FLAG(stack_profiler_sample_interval_ms, experimental);
+TAG_FLAG(stack_profiler_sample_interval_ms, runtime);
+
+DEFINE_int32(stack_profiler_max_stacks, 10000,
+             "The maximum number of distinct stacks kept by the stack profile. "
+             "Samples of further stacks are dropped until the profile is reset.");
+TAG_FLAG(stack_profiler_max_stacks, experimental);
+TAG_FLAG(stack_profiler_max_stacks, runtime);
+
+// GLog already implements symbolization. Just import their hidden symbol.
+namespace google {
+// Symbolizes a program counter.  On success, returns true and write the
+// symbol name to "out".  The symbol name is demangled if possible
+// (supports symbols generated by GCC 3.x or newer).  Otherwise,
+// returns false.
+bool Symbolize(void *pc, char *out, int out_size);
+}
+
+using std::lock_guard;
+using std::string;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace server {
+
+namespace {
+
+// Returns whether the thread 'tid' of this process is running or runnable,
+// according to its state in /proc.
+bool IsThreadOnCpu(pid_t tid) {
+  faststring buf;
+  if (!ReadFileToString(Env::Default(), Substitute("/proc/self/task/$0/stat", tid), &buf).ok()) {
+    return false;
+  }
+  // The state follows the parenthesized command name, which may itself
+  // contain parentheses.
+  const string stat = buf.ToString();
+  const auto pos = stat.rfind(')');
+  return pos != string::npos && pos + 2 < stat.size() && stat[pos + 2] == 'R';
+}
+
+} // anonymous namespace
+
+size_t StackProfiler::StackKeyHash::operator()(const StackKey& k) const {
+  return std::hash<string>()(k.thread_group) ^ (k.stack.HashCode() * 31 + k.on_cpu);
+}
+
+bool StackProfiler::StackKeyEqual::operator()(const StackKey& a, const StackKey& b) const {
+  return a.on_cpu == b.on_cpu && a.thread_group == b.thread_group && a.stack.Equals(b.stack);
+}
+
+StackProfiler::StackProfiler()
+    : num_samples_(0),
+      num_dropped_(0),
+      stop_latch_(1) {
+}
+
+StackProfiler::~StackProfiler() {
+  Stop();
+}
+
+Status StackProfiler::Start() {
+  return Thread::Create("server", "stack-profiler",
+                        [this]() { this->RunThread(); },
+                        &thread_);
+}
+
+void StackProfiler::Stop() {
+  stop_latch_.CountDown();
+  if (thread_) {
+    thread_->Join();
+    thread_.reset();
+  }
+}
+
+void StackProfiler::RunThread() {
+  Random rng(GetRandomSeed32());
+  while (true) {
+    // As with the stack samples of the diagnostics log, the interval is
+    // randomized to avoid correlations with periodic activity. The flag is
+    // runtime-modifiable, so wake up periodically even when sampling is
+    // disabled.
+    const int32_t interval_ms = FLAGS_stack_profiler_sample_interval_ms;
+    const MonoDelta wait = interval_ms > 0 ?
+        MonoDelta::FromMilliseconds(rng.Uniform(interval_ms * 2)) :
+        MonoDelta::FromSeconds(1);
+    if (stop_latch_.WaitFor(wait)) {
+      return;
+    }
+    if (interval_ms > 0) {
+      WARN_NOT_OK(SampleNow(), "Unable to sample the stacks of the server's threads");
+    }
+  }
+}
+
+Status StackProfiler::SampleNow() {
+  // Collecting the stacks interrupts the threads, so check which threads
+  // are running beforehand.
+  vector<pid_t> tids;
+  RETURN_NOT_OK(ListThreads(&tids));
+  unordered_set<int64_t> on_cpu_tids;
+  for (const auto tid : tids) {
+    if (IsThreadOnCpu(tid)) {
+      on_cpu_tids.insert(tid);
+    }
+  }
+
+  StackTraceSnapshot snap;
+  snap.set_capture_thread_names(true);
+  RETURN_NOT_OK(snap.SnapshotAllStacks());
+
+  const int64_t self_tid = Thread::CurrentThreadId();
+  const size_t max_stacks = std::max(FLAGS_stack_profiler_max_stacks, 0);
+  lock_guard<std::mutex> l(lock_);
+  snap.VisitGroups([&](ArrayView<StackTraceSnapshot::ThreadInfo> threads) {
+    for (const auto& info : threads) {
+      if (!info.status.ok() || info.tid == self_tid) {
+        continue;
+      }
+      num_samples_++;
+      StackKey key = { ThreadGroup(info.thread_name),
+                       on_cpu_tids.count(info.tid) > 0,
+                       info.stack };
+      auto it = counts_.find(key);
+      if (it != counts_.end()) {
+        it->second++;
+      } else if (counts_.size() < max_stacks) {
+        counts_.emplace(std::move(key), 1);
+      } else {
+        num_dropped_++;
+      }
+    }
+  });
+  return Status::OK();
+}
+
+void StackProfiler::DumpFolded(std::ostream* out) const {
+  lock_guard<std::mutex> l(lock_);
+  *out << "# " << num_samples_ << " samples, " << num_dropped_ << " dropped\n";
+  for (const auto& e : counts_) {
+    const StackKey& key = e.first;
+    *out << (key.thread_group.empty() ? "(unknown)" : key.thread_group)
+         << (key.on_cpu ? ";on-cpu" : ";off-cpu");
+    // The innermost frame is the first one.
+    for (int i = key.stack.num_frames() - 1; i >= 0; i--) {
+      void* pc = key.stack.frame(i);
+      auto it = symbols_.find(pc);
+      if (it == symbols_.end()) {
+        char buf[1024];
+        // Subtract 1 from the address before symbolizing, because the
+        // address on the stack is actually the return address of the function
+        // call rather than the address of the call instruction itself.
+        string symbol = google::Symbolize(static_cast<char*>(pc) - 1, buf, sizeof(buf)) ?
+            string(buf) : StringPrintf("%p", pc);
+        // Semicolons separate the frames of folded stacks.
+        std::replace(symbol.begin(), symbol.end(), ';', ',');
+        it = symbols_.emplace(pc, std::move(symbol)).first;
+      }
+      *out << ";" << it->second;
+    }
+    *out << " " << e.second << "\n";
+  }
+}
+
+void StackProfiler::Reset() {
+  lock_guard<std::mutex> l(lock_);
+  counts_.clear();
+  num_samples_ = 0;
+  num_dropped_ = 0;
+}
+
+int64_t StackProfiler::num_samples() const {
+  lock_guard<std::mutex> l(lock_);
+  return num_samples_;
+}
+
+string StackProfiler::ThreadGroup(const string& thread_name) {
+  const auto pos = thread_name.find_last_not_of("0123456789");
+  if (pos != string::npos && pos + 1 < thread_name.size() && thread_name[pos] == '-') {
+    return thread_name.substr(0, pos);
+  }
+  return thread_name;
+}
+
+} // namespace server
+} // namespace kudu
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/debug-util.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace server {
+
+// Periodically samples the stacks of all of the threads of the process, and
+// aggregates the samples into a profile of where the threads spend their
+// time, both running on a CPU and waiting off of it.
+//
+// The stacks are sampled at random intervals with a mean of
+// --stack_profiler_sample_interval_ms, using the same signal-based stack
+// collection as the /stacks page, so the overhead is proportional to the
+// sampling rate and the number of threads.
+//
+// The profile is dumped in the "folded" format read by flame graph tools, with
+// each stack prefixed by the name of its thread's group (the thread's name
+// without its TID suffix, e.g. the name of its thread pool) and whether the
+// thread was on or off of a CPU.
+//
+// This class is thread-safe.
+class StackProfiler {
+ public:
+  StackProfiler();
+  ~StackProfiler();
+
+  // Starts the sampling thread.
+  Status Start();
+
+  // Stops the sampling thread. The samples taken so far are kept.
+  void Stop();
+
+  // Samples the stacks of all threads other than the calling one.
+  Status SampleNow();
+
+  // Writes the aggregated samples to 'out', one line per distinct stack:
+  //
+  //   <thread group>;<on-cpu|off-cpu>;<outermost frame>;...;<innermost frame> <count>
+  void DumpFolded(std::ostream* out) const;
+
+  // Discards the samples taken so far.
+  void Reset();
+
+  // The number of thread stacks sampled since the last reset.
+  int64_t num_samples() const;
+
+  // Returns the group of the thread named 'thread_name': its name without
+  // the "-<tid>" suffix Thread appends to it.
+  static std::string ThreadGroup(const std::string& thread_name);
+
+ private:
+  struct StackKey {
+    std::string thread_group;
+    bool on_cpu;
+    StackTrace stack;
+  };
+  struct StackKeyHash {
+    size_t operator()(const StackKey& k) const;
+  };
+  struct StackKeyEqual {
+    bool operator()(const StackKey& a, const StackKey& b) const;
+  };
+  typedef std::unordered_map<StackKey, int64_t, StackKeyHash, StackKeyEqual> StackCounts;
+
+  // Samples the stacks until stopped.
+  void RunThread();
+
+  mutable std::mutex lock_;
+  StackCounts counts_;
+  int64_t num_samples_;
+  // The number of samples dropped because --stack_profiler_max_stacks
+  // distinct stacks were already kept.
+  int64_t num_dropped_;
+
+  // Cache of the symbols of the frames seen in the samples.
+  mutable std::unordered_map<void*, std::string> symbols_;
+
+  CountDownLatch stop_latch_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(StackProfiler);
+};
+
+} // namespace server
+} // namespace kudu
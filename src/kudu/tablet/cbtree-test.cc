@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <set>
 #include <string>
 #include <thread>
 #include <unordered_set>
@@ -39,8 +40,10 @@
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+using std::set;
 using std::string;
 using std::thread;
 using std::unique_ptr;
@@ -158,6 +161,47 @@ TEST_F(TestCBTree, TestLeafNode) {
   ASSERT_LT(i, 1000) << "should have filled up node before 1000 entries";
 }
 
+// Test a leaf node whose keys share prefixes of different lengths with that
+// of the node, including keys which are prefixes of it.
+TEST_F(TestCBTree, TestLeafNodePrefixedKeys) {
+  LeafNode<BTreeTraits> lnode(false);
+  ThreadSafeArena arena(1024);
+
+  // The first key becomes the prefix of the node.
+  const vector<string> keys = { "tenant_0001/2024-01-02/00000005",
+                                "tenant_0001/2024-01-02/00000001",
+                                "tenant_0001/2024-01-01/00000009",
+                                "tenant_0002/2024-01-01/00000000",
+                                "tenant_0001/2024-01-02",
+                                "tenant_",
+                                "",
+                                "tenant_0001/2024-01-02/000000050" };
+  for (const auto& k : keys) {
+    ASSERT_EQ(INSERT_SUCCESS, InsertInLeaf(&lnode, &arena, Slice(k), Slice("v")));
+  }
+  for (const auto& k : keys) {
+    ASSERT_EQ(INSERT_DUPLICATE, InsertInLeaf(&lnode, &arena, Slice(k), Slice("x")));
+  }
+  ASSERT_EQ("[=v], [tenant_=v], [tenant_0001/2024-01-01/00000009=v], "
+            "[tenant_0001/2024-01-02=v], [tenant_0001/2024-01-02/00000001=v], "
+            "[tenant_0001/2024-01-02/00000005=v], [tenant_0001/2024-01-02/000000050=v], "
+            "[tenant_0002/2024-01-01/00000000=v]",
+            lnode.ToString());
+
+  // Keys which aren't in the node are found where they'd be inserted.
+  bool exact;
+  ASSERT_EQ(1, lnode.Find(Slice("tenant"), &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(3, lnode.Find(Slice("tenant_0001/2024-01-01/00000010"), &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(4, lnode.Find(Slice("tenant_0001/2024-01-02/"), &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(8, lnode.Find(Slice("u"), &exact));
+  ASSERT_FALSE(exact);
+  ASSERT_EQ(5, lnode.Find(Slice("tenant_0001/2024-01-02/00000005"), &exact));
+  ASSERT_TRUE(exact);
+}
+
 // Directly test leaf node with keys and values which are large (such that
 // only zero or one would fit in the actual allocated space)
 TEST_F(TestCBTree, TestLeafNodeBigKVs) {
@@ -351,6 +395,63 @@ TEST_F(TestCBTree, TestInsertAndVerifyRandom) {
   }
 }
 
+// Insert keys with long common prefixes in random order, so that the leaves
+// get prefixes from splits, and verify them with lookups and a scan.
+template<class Traits>
+static void DoTestPrefixedKeys(int n_keys) {
+  CBTree<Traits> t;
+  set<string> inserted;
+  char kbuf[64];
+  while (inserted.size() < n_keys) {
+    int r = rand();
+    snprintf(kbuf, sizeof(kbuf), "tenant_%04d/2024-01-%02d/%08d",
+             r % 3, (r / 3) % 28 + 1, (r / 84) % 100000);
+    // Also insert keys which are prefixes of others.
+    int len = strlen(kbuf);
+    if (r % 10 == 0) {
+      len = r % len;
+    }
+    string key(kbuf, len);
+    ASSERT_EQ(inserted.insert(key).second, t.Insert(Slice(key), Slice(key)));
+  }
+
+  for (const string& key : inserted) {
+    NO_FATALS(VerifyGet(t, Slice(key), Slice(key)));
+  }
+
+  unique_ptr<CBTreeIterator<Traits>> iter(t.NewIterator());
+  ASSERT_TRUE(iter->SeekToStart());
+  for (const string& key : inserted) {
+    ASSERT_TRUE(iter->IsValid());
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    ASSERT_EQ(key, k.ToString());
+    ASSERT_EQ(key, v.ToString());
+    ASSERT_EQ(key, iter->GetCurrentKey().ToString());
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->IsValid());
+
+  // Seek to keys which weren't inserted.
+  for (int i = 0; i < 100; i++) {
+    snprintf(kbuf, sizeof(kbuf), "tenant_%04d/2024-01-%02d/%08d!",
+             i % 3, i % 28 + 1, rand() % 100000);
+    const auto next = inserted.upper_bound(kbuf);
+    bool exact;
+    ASSERT_EQ(next != inserted.end(), iter->SeekAtOrAfter(Slice(kbuf), &exact));
+    ASSERT_FALSE(exact);
+    if (next != inserted.end()) {
+      ASSERT_EQ(*next, iter->GetCurrentKey().ToString());
+    }
+  }
+}
+
+TEST_F(TestCBTree, TestPrefixedKeys) {
+  const int n_keys = AllowSlowTests() ? 100000 : 10000;
+  NO_FATALS(DoTestPrefixedKeys<SmallFanoutTraits>(n_keys));
+  NO_FATALS(DoTestPrefixedKeys<BTreeTraits>(n_keys));
+}
+
 // Thread which cycles through doing the following:
 // - lock the node
 // - either mark it splitting or inserting (alternatingly)
@@ -59,7 +59,15 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(consult_secondary_indexes);
+DECLARE_bool(consult_sorted_columns);
+DECLARE_bool(consult_zone_maps);
+DECLARE_bool(materializing_iterator_late_materialization);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_string(rowset_bitmap_index_columns);
+DECLARE_string(rowset_bloom_filter_columns);
+DECLARE_string(rowset_secondary_index_columns);
+DECLARE_string(rowset_sorted_columns);
 
 using std::shared_ptr;
 using std::string;
@@ -474,6 +482,344 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
   DoTestRangeScan(fileset, kNumRows * 10, kNoBound);
 }
 
+// Test that a range predicate on a non-key column skips the blocks whose
+// zone maps rule them out, without reading them from any column.
+TEST_F(TestCFileSet, TestZoneMapPredicates) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+
+  // The third column contains the row index * 100.
+  int32_t lower = 5000 * 100;
+  int32_t upper = 5005 * 100;
+  auto pred = ColumnPredicate::Range(schema_.column(2), &lower, &upper);
+  auto scan = [&](vector<string>* results, vector<IteratorStats>* stats) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    ASSERT_OK(IterateToStringList(iter.get(), results));
+    iter->GetIteratorStats(stats);
+  };
+
+  vector<string> results;
+  vector<IteratorStats> stats;
+  NO_FATALS(scan(&results, &stats));
+  ASSERT_EQ(5, results.size());
+  EXPECT_EQ("(int32 c0=10000, int32 c1=50000, int32 c2=500000)", results[0]);
+  EXPECT_EQ("(int32 c0=10008, int32 c1=50040, int32 c2=500400)", results[4]);
+  ASSERT_EQ(3, stats.size());
+  const int64_t blocks_read_with_zone_maps = stats[2].blocks_read;
+  EXPECT_LE(blocks_read_with_zone_maps, 2);
+  EXPECT_LE(stats[0].blocks_read, 2);
+
+  // Without zone maps, every block of the predicate column is read.
+  FLAGS_consult_zone_maps = false;
+  results.clear();
+  NO_FATALS(scan(&results, &stats));
+  ASSERT_EQ(5, results.size());
+  EXPECT_GT(stats[2].blocks_read, blocks_read_with_zone_maps * 10);
+}
+
+// Test that the secondary index of a non-key column is used to skip the
+// batches of rows which can't match an IN-list predicate on the column.
+TEST_F(TestCFileSet, TestSecondaryIndexPredicates) {
+  FLAGS_rowset_secondary_index_columns = "c2";
+  // The values of the third column increase with the key, so disable the zone
+  // maps, which would otherwise skip the same batches.
+  FLAGS_consult_zone_maps = false;
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+  ASSERT_EQ(1, rowset_meta_->GetSecondaryIndexBlocksById().size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+  ASSERT_TRUE(fileset->has_secondary_index_for_column_id(schema_.column_id(2)));
+  ASSERT_FALSE(fileset->has_secondary_index_for_column_id(schema_.column_id(1)));
+
+  // The third column contains the row index * 100. One of the values isn't
+  // in the rowset.
+  vector<int32_t> values = { 100 * 17, 100 * 5000, 100 * 9999, 100 * 12345 };
+  vector<const void*> value_ptrs;
+  for (const auto& v : values) {
+    value_ptrs.push_back(&v);
+  }
+  auto pred = ColumnPredicate::InList(schema_.column(2), &value_ptrs);
+  auto scan = [&](vector<string>* results, vector<IteratorStats>* stats) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    ASSERT_OK(IterateToStringList(iter.get(), results));
+    iter->GetIteratorStats(stats);
+  };
+
+  vector<string> results;
+  vector<IteratorStats> stats;
+  NO_FATALS(scan(&results, &stats));
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ("(int32 c0=34, int32 c1=170, int32 c2=1700)", results[0]);
+  EXPECT_EQ("(int32 c0=10000, int32 c1=50000, int32 c2=500000)", results[1]);
+  EXPECT_EQ("(int32 c0=19998, int32 c1=99990, int32 c2=999900)", results[2]);
+  ASSERT_EQ(3, stats.size());
+  const int64_t blocks_read_with_index = stats[2].blocks_read;
+
+  // Without the index, every block of the predicate column is read.
+  FLAGS_consult_secondary_indexes = false;
+  results.clear();
+  NO_FATALS(scan(&results, &stats));
+  ASSERT_EQ(3, results.size());
+  EXPECT_GT(stats[2].blocks_read, blocks_read_with_index * 5);
+}
+
+// Test that the bitmaps of the predicates on columns with bitmap indexes are
+// intersected to skip the batches of rows which can't match all of them.
+TEST_F(TestCFileSet, TestBitmapIndexPredicates) {
+  FLAGS_rowset_bitmap_index_columns = "c1,c2";
+  FLAGS_consult_zone_maps = false;
+  const int kNumRows = 10000;
+  // The second column has 10 distinct values, each in a range of rows. The
+  // third column has 7 distinct values, spread across the rowset.
+  {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+    RowBuilder rb(&schema_);
+    for (int i = 0; i < kNumRows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      rb.AddInt32(i / 1000);
+      rb.AddInt32(i % 7);
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+  ASSERT_EQ(2, rowset_meta_->GetBitmapIndexBlocksById().size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+
+  const int32_t c1_value = 3;
+  vector<int32_t> c2_values = { 2, 4 };
+  vector<const void*> c2_value_ptrs;
+  for (const auto& v : c2_values) {
+    c2_value_ptrs.push_back(&v);
+  }
+  auto c1_pred = ColumnPredicate::Equality(schema_.column(1), &c1_value);
+  auto c2_pred = ColumnPredicate::InList(schema_.column(2), &c2_value_ptrs);
+  auto scan = [&](vector<string>* results, vector<IteratorStats>* stats) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(c1_pred);
+    spec.AddPredicate(c2_pred);
+    ASSERT_OK(iter->Init(&spec));
+    ASSERT_OK(IterateToStringList(iter.get(), results));
+    iter->GetIteratorStats(stats);
+  };
+
+  int expected_rows = 0;
+  for (int i = 3000; i < 4000; i++) {
+    if (i % 7 == 2 || i % 7 == 4) {
+      expected_rows++;
+    }
+  }
+  vector<string> results;
+  vector<IteratorStats> stats;
+  NO_FATALS(scan(&results, &stats));
+  ASSERT_EQ(expected_rows, results.size());
+  EXPECT_EQ("(int32 c0=3000, int32 c1=3, int32 c2=4)", results[0]);
+  ASSERT_EQ(3, stats.size());
+  const int64_t blocks_read_with_index = stats[1].blocks_read + stats[2].blocks_read;
+
+  // Without the indexes, every block of the predicate columns is read.
+  FLAGS_consult_secondary_indexes = false;
+  vector<string> results_without_index;
+  NO_FATALS(scan(&results_without_index, &stats));
+  ASSERT_EQ(results, results_without_index);
+  EXPECT_GT(stats[1].blocks_read + stats[2].blocks_read, blocks_read_with_index * 3);
+}
+
+TEST_F(TestCFileSet, TestSortedColumnPredicates) {
+  FLAGS_rowset_sorted_columns = "c1,c2";
+  const int kNumRows = 10000;
+  // The second column is sorted, with duplicates. The third one isn't.
+  {
+    DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
+                         BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
+    ASSERT_OK(rsw.Open());
+    RowBuilder rb(&schema_);
+    for (int i = 0; i < kNumRows; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      rb.AddInt32(i / 3);
+      rb.AddInt32(i % 7);
+      ASSERT_OK_FAST(WriteRow(rb.data(), &rsw));
+    }
+    ASSERT_OK(rsw.Finish());
+  }
+  ASSERT_TRUE(rowset_meta_->is_column_sorted(schema_.column_id(1)));
+  ASSERT_FALSE(rowset_meta_->is_column_sorted(schema_.column_id(2)));
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+
+  // Scans the rows matching 'pred', checking that the iterator's range covers
+  // 'expected_rows' and returning the number of rows in the range.
+  auto scan = [&](const ColumnPredicate& pred, int expected_rows, int* range_rows) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    cfile_iter->set_base_data_unchanged();
+    CFileSet::Iterator* base_iter = cfile_iter.get();
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    *range_rows = base_iter->upper_bound_idx_ - base_iter->lower_bound_idx_;
+    vector<string> results;
+    ASSERT_OK(IterateToStringList(iter.get(), &results));
+    ASSERT_EQ(expected_rows, results.size());
+  };
+
+  // The rows of c1 in [1000, 1100) are 3000 to 3299.
+  const int32_t lower = 1000;
+  const int32_t upper = 1100;
+  auto range_pred = ColumnPredicate::Range(schema_.column(1), &lower, &upper);
+  int range_rows;
+  NO_FATALS(scan(range_pred, 300, &range_rows));
+  EXPECT_LT(range_rows, kNumRows / 2);
+
+  const int32_t value = 1000;
+  auto eq_pred = ColumnPredicate::Equality(schema_.column(1), &value);
+  NO_FATALS(scan(eq_pred, 3, &range_rows));
+  EXPECT_LT(range_rows, kNumRows / 2);
+
+  // No row has a value past the last one.
+  const int32_t past_end = kNumRows;
+  auto past_end_pred = ColumnPredicate::Equality(schema_.column(1), &past_end);
+  NO_FATALS(scan(past_end_pred, 0, &range_rows));
+  EXPECT_EQ(0, range_rows);
+
+  // Predicates on unsorted columns don't bound the range.
+  const int32_t c2_value = 3;
+  auto c2_pred = ColumnPredicate::Equality(schema_.column(2), &c2_value);
+  NO_FATALS(scan(c2_pred, kNumRows / 7, &range_rows));
+  EXPECT_EQ(kNumRows, range_rows);
+
+  FLAGS_consult_sorted_columns = false;
+  NO_FATALS(scan(range_pred, 300, &range_rows));
+  EXPECT_EQ(kNumRows, range_rows);
+}
+
+TEST_F(TestCFileSet, TestColumnBloomFilterPredicates) {
+  FLAGS_rowset_bloom_filter_columns = "c1";
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+  ASSERT_EQ(1, rowset_meta_->GetColumnBloomBlocksById().size());
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+
+  // Scans the rows matching 'pred', returning whether the rowset was pruned.
+  auto scan = [&](const ColumnPredicate& pred, int expected_rows, bool* pruned) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    cfile_iter->set_base_data_unchanged();
+    CFileSet::Iterator* base_iter = cfile_iter.get();
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    *pruned = base_iter->lower_bound_idx_ == base_iter->upper_bound_idx_;
+    vector<string> results;
+    ASSERT_OK(IterateToStringList(iter.get(), &results));
+    ASSERT_EQ(expected_rows, results.size());
+  };
+
+  // The second column contains the row index * 10, so the values which
+  // aren't multiples of 10 are absent. Allow for false positives.
+  int num_pruned = 0;
+  for (int32_t i = 0; i < 20; i++) {
+    const int32_t value = i * 10 + 5;
+    bool pruned;
+    NO_FATALS(scan(ColumnPredicate::Equality(schema_.column(1), &value), 0, &pruned));
+    num_pruned += pruned;
+  }
+  EXPECT_GE(num_pruned, 15);
+
+  const int32_t present_value = 10 * 1234;
+  bool pruned;
+  NO_FATALS(scan(ColumnPredicate::Equality(schema_.column(1), &present_value), 1, &pruned));
+  EXPECT_FALSE(pruned);
+
+  // An IN-list is only ruled out if all its values are.
+  vector<int32_t> values = { 15, 10 * 42 };
+  vector<const void*> value_ptrs;
+  for (const auto& v : values) {
+    value_ptrs.push_back(&v);
+  }
+  NO_FATALS(scan(ColumnPredicate::InList(schema_.column(1), &value_ptrs), 1, &pruned));
+  EXPECT_FALSE(pruned);
+}
+
+// Test that the columns materialized after a selective predicate column
+// return the same rows whether or not they skip decoding the unselected ones.
+TEST_F(TestCFileSet, TestLateMaterialization) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), MemTracker::GetRootTracker(),
+                           nullptr, &fileset));
+
+  // Select a handful of rows spread across the rowset, so that most of the
+  // cfile blocks covered by each batch contain no selected rows. The second
+  // column contains the row index * 10.
+  vector<int32_t> values = { 0, 10 * 1, 10 * 1500, 10 * 1501, 10 * 4999, 10 * 9999 };
+  vector<const void*> value_ptrs;
+  for (const auto& v : values) {
+    value_ptrs.push_back(&v);
+  }
+  auto pred = ColumnPredicate::InList(schema_.column(1), &value_ptrs);
+  auto scan = [&](vector<string>* results) {
+    unique_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_, nullptr));
+    unique_ptr<RowwiseIterator> iter(NewMaterializingIterator(std::move(cfile_iter)));
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    ASSERT_OK(iter->Init(&spec));
+    RowBlockMemory mem(1024);
+    RowBlock block(&schema_, 2000, &mem);
+    while (iter->HasNext()) {
+      mem.Reset();
+      ASSERT_OK_FAST(iter->NextBlock(&block));
+      for (size_t i = 0; i < block.nrows(); i++) {
+        if (block.selection_vector()->IsRowSelected(i)) {
+          results->push_back(schema_.DebugRow(block.row(i)));
+        }
+      }
+    }
+  };
+
+  vector<string> results;
+  NO_FATALS(scan(&results));
+  ASSERT_EQ(values.size(), results.size());
+  EXPECT_EQ("(int32 c0=0, int32 c1=0, int32 c2=0)", results[0]);
+  EXPECT_EQ("(int32 c0=3002, int32 c1=15010, int32 c2=150100)", results[3]);
+  EXPECT_EQ("(int32 c0=19998, int32 c1=99990, int32 c2=999900)", results[5]);
+
+  FLAGS_materializing_iterator_late_materialization = false;
+  vector<string> results_without_skipping;
+  NO_FATALS(scan(&results_without_skipping));
+  ASSERT_EQ(results, results_without_skipping);
+}
+
 TEST_F(TestCFileSet, TestBloomFilterPredicates) {
   const int kNumRows = 100;
   Arena arena(1024);
@@ -29,21 +29,27 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/cfile/block_export.h"
 #include "kudu/cfile/bloomfile.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/dynamic_annotations.h"
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
@@ -52,14 +58,41 @@
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/array_view.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/rle-encoding.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_bool(consult_zone_maps, true,
+            "Whether to consult the per-block min/max values of column cfiles to skip "
+            "batches of rows which can't match a scan's predicates");
+TAG_FLAG(consult_zone_maps, advanced);
+TAG_FLAG(consult_zone_maps, runtime);
+
+DEFINE_bool(consult_secondary_indexes, true,
+            "Whether to consult the secondary and bitmap indexes and the column "
+            "bloom filters of rowsets to skip the rows which can't match a scan's "
+            "equality or IN-list predicates");
+TAG_FLAG(consult_secondary_indexes, advanced);
+TAG_FLAG(consult_secondary_indexes, runtime);
+
+DEFINE_bool(consult_sorted_columns, true,
+            "Whether to bound the range of rows scanned in rowsets to the rows which "
+            "may match the scan's equality and range predicates on the columns whose "
+            "values are sorted in the rowset, when none of the rowset's deltas apply "
+            "to the scan. See --rowset_sorted_columns.");
+TAG_FLAG(consult_sorted_columns, advanced);
+TAG_FLAG(consult_sorted_columns, runtime);
+
 DECLARE_bool(rowset_metadata_store_keys);
 
 namespace kudu {
@@ -68,6 +101,11 @@ class MemTracker;
 
 namespace tablet {
 
+// Trace metrics of the time spent reading the columns' data blocks, including
+// seeks, and decoding their cells.
+const char* SCAN_CFILE_READ_US_METRIC_NAME = "scan_cfile_read_us";
+const char* SCAN_CFILE_DECODE_US_METRIC_NAME = "scan_cfile_decode_us";
+
 using cfile::BloomFileReader;
 using cfile::CFileIterator;
 using cfile::CFileReader;
@@ -162,6 +200,40 @@ Status CFileSet::DoOpen(const IOContext* io_context) {
                              &ad_hoc_idx_reader_));
   }
 
+  // Lazily open the secondary and bitmap indexes too; they're only fully
+  // opened when first consulted by a scan.
+  for (const auto& e : rowset_metadata_->GetSecondaryIndexBlocksById()) {
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
+                             cfile_reader_tracker_,
+                             e.second,
+                             io_context,
+                             &reader));
+    secondary_index_readers_[e.first] = std::move(reader);
+  }
+  secondary_index_readers_.shrink_to_fit();
+  for (const auto& e : rowset_metadata_->GetBitmapIndexBlocksById()) {
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
+                             cfile_reader_tracker_,
+                             e.second,
+                             io_context,
+                             &reader));
+    bitmap_index_readers_[e.first] = std::move(reader);
+  }
+  bitmap_index_readers_.shrink_to_fit();
+  for (const auto& e : rowset_metadata_->GetColumnBloomBlocksById()) {
+    unique_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(rowset_metadata_->fs_manager()->OpenBlock(e.second, &block));
+    ReaderOptions opts;
+    opts.io_context = io_context;
+    opts.parent_mem_tracker = bloomfile_tracker_;
+    unique_ptr<BloomFileReader> reader;
+    RETURN_NOT_OK(BloomFileReader::OpenNoInit(std::move(block), std::move(opts), &reader));
+    column_bloom_readers_[e.first] = std::move(reader);
+  }
+  column_bloom_readers_.shrink_to_fit();
+
   // If the user specified to store the min/max keys in the rowset metadata,
   // fetch them. Otherwise, load the min and max keys from the key reader.
   if (FLAGS_rowset_metadata_store_keys && rowset_metadata_->has_encoded_keys()) {
@@ -259,7 +331,11 @@ uint64_t CFileSet::AdhocIndexOnDiskSize() const {
 }
 
 uint64_t CFileSet::BloomFileOnDiskSize() const {
-  return bloom_reader_->FileSize();
+  uint64_t ret = bloom_reader_->FileSize();
+  for (const auto& e : column_bloom_readers_) {
+    ret += e.second->FileSize();
+  }
+  return ret;
 }
 
 uint64_t CFileSet::OnDiskDataSize() const {
@@ -267,6 +343,12 @@ uint64_t CFileSet::OnDiskDataSize() const {
   for (const auto& e : readers_by_col_id_) {
     ret += e.second->file_size();
   }
+  for (const auto& e : secondary_index_readers_) {
+    ret += e.second->file_size();
+  }
+  for (const auto& e : bitmap_index_readers_) {
+    ret += e.second->file_size();
+  }
   return ret;
 }
 
@@ -319,6 +401,29 @@ Status CFileSet::FindRow(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status CFileSet::FindFirstRowAtOrAfter(const EncodedKey& key,
+                                       const IOContext* io_context,
+                                       rowid_t* idx) const {
+  if (key.encoded_key() <= min_encoded_key_) {
+    *idx = 0;
+    return Status::OK();
+  }
+  if (key.encoded_key() > max_encoded_key_) {
+    return CountRows(io_context, idx);
+  }
+
+  unique_ptr<CFileIterator> key_iter;
+  RETURN_NOT_OK(NewKeyIterator(io_context, &key_iter));
+  bool exact;
+  Status s = key_iter->SeekAtOrAfter(key, &exact);
+  if (s.IsNotFound()) {
+    return CountRows(io_context, idx);
+  }
+  RETURN_NOT_OK(s);
+  *idx = key_iter->GetCurrentOrdinal();
+  return Status::OK();
+}
+
 Status CFileSet::CheckRowPresent(const RowSetKeyProbe& probe, const IOContext* io_context,
                                  bool* present, rowid_t* rowid, ProbeStats* stats) const {
   boost::optional<rowid_t> opt_rowid;
@@ -334,6 +439,226 @@ Status CFileSet::CheckRowPresent(const RowSetKeyProbe& probe, const IOContext* i
   return Status::OK();
 }
 
+Status CFileSet::CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                                  const IOContext* io_context,
+                                  bool* present, rowid_t* rowids,
+                                  ProbeStats* const* stats) const {
+  std::fill(present, present + probes.size(), true);
+  if (FLAGS_consult_bloom_filters) {
+    // Fully open the BloomFileReader if it was lazily opened earlier.
+    //
+    // If it's already initialized, this is a no-op.
+    RETURN_NOT_OK(bloom_reader_->Init(io_context));
+
+    vector<const BloomKeyProbe*> bloom_probes;
+    bloom_probes.reserve(probes.size());
+    for (size_t i = 0; i < probes.size(); i++) {
+      bloom_probes.emplace_back(&probes[i]->bloom_probe());
+      stats[i]->blooms_consulted++;
+    }
+    Status s = bloom_reader_->CheckKeysPresent(bloom_probes, io_context, present);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 1) << Substitute("Unable to query bloom in $0: $1",
+          rowset_metadata_->bloom_block().ToString(), s.ToString());
+      if (PREDICT_FALSE(s.IsDiskFailure())) {
+        // If the bloom lookup failed because of a disk failure, return early
+        // since I/O to the tablet should be stopped.
+        return s;
+      }
+      // Continue with the slow path for all of the probes.
+      std::fill(present, present + probes.size(), true);
+    }
+  }
+
+  unique_ptr<CFileIterator> key_iter;
+  for (size_t i = 0; i < probes.size(); i++) {
+    if (!present[i]) {
+      continue;
+    }
+    if (!key_iter) {
+      RETURN_NOT_OK(NewKeyIterator(io_context, &key_iter));
+    }
+    stats[i]->keys_consulted++;
+    bool exact;
+    Status s = key_iter->SeekAtOrAfter(probes[i]->encoded_key(), &exact);
+    if (s.IsNotFound() || (s.ok() && !exact)) {
+      present[i] = false;
+      continue;
+    }
+    RETURN_NOT_OK(s);
+    rowids[i] = key_iter->GetCurrentOrdinal();
+  }
+  return Status::OK();
+}
+
+Status CFileSet::ColumnMayContainValues(ColumnId col_id,
+                                        const TypeInfo* type_info,
+                                        const vector<const void*>& values,
+                                        const IOContext* io_context,
+                                        bool* may_contain) const {
+  BloomFileReader* reader = FindOrDie(column_bloom_readers_, col_id).get();
+  RETURN_NOT_OK(reader->Init(io_context));
+
+  // The bloom filter holds the key encodings of the values.
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info);
+  vector<faststring> encoded(values.size());
+  vector<BloomKeyProbe> probes;
+  probes.reserve(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    encoder.Encode(values[i], /*is_last=*/false, &encoded[i]);
+    probes.emplace_back(Slice(encoded[i]));
+  }
+  vector<const BloomKeyProbe*> probe_ptrs;
+  probe_ptrs.reserve(probes.size());
+  for (const auto& probe : probes) {
+    probe_ptrs.emplace_back(&probe);
+  }
+  unique_ptr<bool[]> present(new bool[values.size()]);
+  RETURN_NOT_OK(reader->CheckKeysPresent(probe_ptrs, io_context, present.get()));
+  *may_contain = std::any_of(present.get(), present.get() + values.size(),
+                             [](bool p) { return p; });
+  return Status::OK();
+}
+
+Status CFileSet::GetColumnMaxValue(ColumnId col_id,
+                                   const IOContext* io_context,
+                                   string* max,
+                                   bool* has_max) const {
+  return FindOrDie(readers_by_col_id_, col_id)->GetMaxValue(io_context, max, has_max);
+}
+
+Status CFileSet::ListExportableBlocks(ColumnId col_id,
+                                      const IOContext* io_context,
+                                      vector<cfile::ExportedCFile::Block>* blocks,
+                                      uint64_t* dictionary_size) const {
+  CFileReader* reader = FindOrDie(readers_by_col_id_, col_id).get();
+  RETURN_NOT_OK(reader->Init(io_context));
+  return cfile::ListExportableBlocks(io_context, *reader, blocks, dictionary_size);
+}
+
+Status CFileSet::ExportColumn(ColumnId col_id,
+                              rowid_t start_row,
+                              rowid_t end_row,
+                              const IOContext* io_context,
+                              cfile::ExportedCFile* out) const {
+  CFileReader* reader = FindOrDie(readers_by_col_id_, col_id).get();
+  RETURN_NOT_OK(reader->Init(io_context));
+  return cfile::ExportCFile(io_context, *reader, start_row, end_row, out);
+}
+
+Status CFileSet::FindRowsWithValues(ColumnId col_id,
+                                    const TypeInfo* type_info,
+                                    const vector<const void*>& values,
+                                    const IOContext* io_context,
+                                    vector<rowid_t>* rowids) const {
+  CFileReader* reader = FindOrDie(secondary_index_readers_, col_id).get();
+  RETURN_NOT_OK(reader->Init(io_context));
+  unique_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, io_context));
+
+  // Each entry of the index is the key-encoded value of a cell followed by
+  // the big-endian rowid of the cell, so the entries of the cells equal to a
+  // value are the consecutive entries which start with its encoding.
+  static constexpr size_t kBatchSize = 256;
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info);
+  RowBlockMemory mem;
+  Slice entries[kBatchSize];
+  ColumnBlock block(GetTypeInfo(BINARY), nullptr, entries, kBatchSize, &mem);
+  SelectionVector sel(kBatchSize);
+  faststring prefix;
+  for (const void* value : values) {
+    prefix.clear();
+    encoder.Encode(value, /*is_last=*/false, &prefix);
+    Slice prefix_slice(prefix);
+    const void* raw_keys[] = { &prefix_slice };
+    EncodedKey key(prefix_slice, raw_keys, 1);
+    bool exact;
+    Status s = iter->SeekAtOrAfter(key, &exact);
+    if (s.IsNotFound()) {
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    bool done = false;
+    while (!done && iter->HasNext()) {
+      size_t n = kBatchSize;
+      mem.Reset();
+      ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+      ctx.SetDecoderEvalNotSupported();
+      RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+      for (size_t i = 0; i < n; i++) {
+        const Slice& entry = entries[i];
+        if (!entry.starts_with(prefix_slice)) {
+          done = true;
+          break;
+        }
+        if (PREDICT_FALSE(entry.size() != prefix_slice.size() + sizeof(uint32_t))) {
+          return Status::Corruption("invalid secondary index entry",
+                                    KUDU_REDACT(entry.ToDebugString()));
+        }
+        rowids->push_back(BigEndian::Load32(entry.data() + prefix_slice.size()));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileSet::GetRowsWithValuesBitmap(ColumnId col_id,
+                                         const TypeInfo* type_info,
+                                         const vector<const void*>& values,
+                                         rowid_t num_rows,
+                                         const IOContext* io_context,
+                                         uint8_t* bitmap) const {
+  CFileReader* reader = FindOrDie(bitmap_index_readers_, col_id).get();
+  RETURN_NOT_OK(reader->Init(io_context));
+  unique_ptr<CFileIterator> iter;
+  RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK, io_context));
+
+  // Each entry of the index is the key-encoded value followed by the
+  // RLE-encoded bitmap of the rows with the value.
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info);
+  RowBlockMemory mem;
+  Slice entry;
+  ColumnBlock block(GetTypeInfo(BINARY), nullptr, &entry, 1, &mem);
+  SelectionVector sel(1);
+  faststring prefix;
+  for (const void* value : values) {
+    prefix.clear();
+    encoder.Encode(value, /*is_last=*/false, &prefix);
+    Slice prefix_slice(prefix);
+    const void* raw_keys[] = { &prefix_slice };
+    EncodedKey key(prefix_slice, raw_keys, 1);
+    bool exact;
+    Status s = iter->SeekAtOrAfter(key, &exact);
+    if (s.IsNotFound()) {
+      continue;
+    }
+    RETURN_NOT_OK(s);
+
+    size_t n = 1;
+    mem.Reset();
+    ColumnMaterializationContext ctx(0, nullptr, &block, &sel);
+    ctx.SetDecoderEvalNotSupported();
+    RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+    if (n == 0 || !entry.starts_with(prefix_slice)) {
+      // The value isn't in the rowset.
+      continue;
+    }
+    RleDecoder<bool> decoder(entry.data() + prefix_slice.size(),
+                             entry.size() - prefix_slice.size(), 1);
+    rowid_t pos = 0;
+    bool set;
+    size_t run;
+    while (pos < num_rows && (run = decoder.GetNextRun(&set, num_rows - pos)) > 0) {
+      if (set) {
+        BitmapChangeBits(bitmap, pos, run, true);
+      }
+      pos += run;
+    }
+  }
+  return Status::OK();
+}
+
 Status CFileSet::NewKeyIterator(const IOContext* io_context,
                                 unique_ptr<CFileIterator>* key_iter) const {
   RETURN_NOT_OK(key_index_reader()->Init(io_context));
@@ -400,6 +725,10 @@ Status CFileSet::Iterator::Init(ScanSpec *spec) {
   // If there is a range predicate on the key column, push that down into an
   // ordinal range.
   RETURN_NOT_OK(PushdownRangeScanPredicate(spec));
+  RETURN_NOT_OK(PushdownSortedColumnPredicates(spec));
+  RETURN_NOT_OK(PruneWithColumnBloomFilters(spec));
+
+  RETURN_NOT_OK(LookupColumnIndexes(spec));
 
   initted_ = true;
 
@@ -469,6 +798,174 @@ Status CFileSet::Iterator::PushdownRangeScanPredicate(ScanSpec *spec) {
   return Status::OK();
 }
 
+Status CFileSet::Iterator::PushdownSortedColumnPredicates(const ScanSpec* spec) {
+  if (spec == nullptr || !base_data_unchanged_ || !FLAGS_consult_sorted_columns) {
+    return Status::OK();
+  }
+  for (const auto& e : spec->predicates()) {
+    if (lower_bound_idx_ >= upper_bound_idx_) {
+      break;
+    }
+    const ColumnPredicate& pred = e.second;
+    if (pred.predicate_type() != PredicateType::Equality &&
+        pred.predicate_type() != PredicateType::Range) {
+      continue;
+    }
+    const int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    const ColumnId col_id = projection_->column_id(col_idx);
+    if (!base_data_->has_data_for_column_id(col_id) ||
+        !base_data_->rowset_metadata_->is_column_sorted(col_id)) {
+      continue;
+    }
+    CFileReader* reader = FindOrDie(base_data_->readers_by_col_id_, col_id).get();
+    RETURN_NOT_OK(reader->NarrowSortedOrdinalRange(pred, io_context_,
+                                                   &lower_bound_idx_, &upper_bound_idx_));
+    VLOG(1) << "Pushed predicate " << pred.ToString() << " on sorted column as "
+            << lower_bound_idx_ << " <= row_idx < " << upper_bound_idx_;
+  }
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::PruneWithColumnBloomFilters(const ScanSpec* spec) {
+  if (spec == nullptr || !base_data_unchanged_ || !FLAGS_consult_secondary_indexes) {
+    return Status::OK();
+  }
+  for (const auto& e : spec->predicates()) {
+    if (lower_bound_idx_ >= upper_bound_idx_) {
+      break;
+    }
+    const ColumnPredicate& pred = e.second;
+    vector<const void*> values;
+    if (pred.predicate_type() == PredicateType::Equality) {
+      values.push_back(pred.raw_lower());
+    } else if (pred.predicate_type() == PredicateType::InList) {
+      values = pred.raw_values();
+    } else {
+      continue;
+    }
+    const int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    const ColumnId col_id = projection_->column_id(col_idx);
+    if (!base_data_->has_bloom_filter_for_column_id(col_id)) {
+      continue;
+    }
+    bool may_contain;
+    RETURN_NOT_OK(base_data_->ColumnMayContainValues(
+        col_id, projection_->column(col_idx).type_info(), values, io_context_, &may_contain));
+    if (!may_contain) {
+      VLOG(1) << "Bloom filter of column " << pred.column().name() << " rules out "
+              << pred.ToString();
+      lower_bound_idx_ = upper_bound_idx_;
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::LookupColumnIndexes(const ScanSpec* spec) {
+  index_matches_.clear();
+  bitmap_index_cols_.clear();
+  bitmap_index_selection_.clear();
+  if (spec == nullptr || !FLAGS_consult_secondary_indexes) {
+    return Status::OK();
+  }
+  vector<uint8_t> bitmap;
+  for (const auto& e : spec->predicates()) {
+    const ColumnPredicate& pred = e.second;
+    if (pred.predicate_type() != PredicateType::Equality &&
+        pred.predicate_type() != PredicateType::InList) {
+      continue;
+    }
+    const int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    const ColumnId col_id = projection_->column_id(col_idx);
+    const bool has_secondary_index = base_data_->has_secondary_index_for_column_id(col_id);
+    const bool has_bitmap_index = base_data_->has_bitmap_index_for_column_id(col_id);
+    if (!has_secondary_index && !has_bitmap_index) {
+      continue;
+    }
+    vector<const void*> values;
+    if (pred.predicate_type() == PredicateType::Equality) {
+      values.push_back(pred.raw_lower());
+    } else {
+      values = pred.raw_values();
+    }
+
+    if (has_bitmap_index) {
+      // Intersect the rows of the values of each predicate.
+      bitmap.assign(BitmapSize(row_count_), 0);
+      RETURN_NOT_OK(base_data_->GetRowsWithValuesBitmap(col_id, pred.column().type_info(),
+                                                        values, row_count_, io_context_,
+                                                        bitmap.data()));
+      if (bitmap_index_selection_.empty()) {
+        bitmap_index_selection_.swap(bitmap);
+      } else {
+        for (size_t i = 0; i < bitmap.size(); i++) {
+          bitmap_index_selection_[i] &= bitmap[i];
+        }
+      }
+      bitmap_index_cols_.push_back(col_idx);
+      VLOG(1) << "Bitmap index of column " << pred.column().name() << " consulted in "
+              << base_data_->ToString();
+      continue;
+    }
+
+    vector<rowid_t> rowids;
+    RETURN_NOT_OK(base_data_->FindRowsWithValues(col_id, pred.column().type_info(), values,
+                                                 io_context_, &rowids));
+    std::sort(rowids.begin(), rowids.end());
+    VLOG(1) << "Secondary index of column " << pred.column().name() << " matched "
+            << rowids.size() << " rows of " << base_data_->ToString();
+    index_matches_.emplace(col_idx, std::move(rowids));
+  }
+  return Status::OK();
+}
+
+bool CFileSet::Iterator::SelectIndexMatches(ColumnMaterializationContext* ctx) {
+  bool consulted = false;
+  const vector<rowid_t>* matches = FindOrNull(index_matches_, ctx->col_idx());
+  if (matches) {
+    // Deselect the rows which the index ruled out, so that the columns
+    // materialized next can skip them.
+    const auto begin = std::lower_bound(matches->begin(), matches->end(), cur_idx_);
+    const auto end = std::lower_bound(begin, matches->end(), cur_idx_ + prepared_count_);
+    SelectionVectorView sel(ctx->sel());
+    size_t next = 0;
+    for (auto it = begin; it != end; ++it) {
+      const size_t idx = *it - cur_idx_;
+      sel.ClearBits(idx - next, next);
+      next = idx + 1;
+    }
+    sel.ClearBits(prepared_count_ - next, next);
+    consulted = true;
+  }
+  // The bitmap combines the predicates of all the columns with bitmap
+  // indexes, so it selects the same rows whichever of them is materialized.
+  if (!bitmap_index_selection_.empty() &&
+      std::find(bitmap_index_cols_.begin(), bitmap_index_cols_.end(), ctx->col_idx()) !=
+      bitmap_index_cols_.end()) {
+    const uint8_t* bits = bitmap_index_selection_.data();
+    SelectionVector* sel = ctx->sel();
+    if (BitmapIsAllZero(bits, cur_idx_, cur_idx_ + prepared_count_)) {
+      sel->SetAllFalse();
+    } else {
+      for (size_t i = 0; i < prepared_count_; i++) {
+        if (!BitmapTest(bits, cur_idx_ + i)) {
+          sel->SetRowUnselected(i);
+        }
+      }
+    }
+    consulted = true;
+  }
+  return consulted;
+}
+
 void CFileSet::Iterator::Unprepare() {
   prepared_count_ = 0;
   prepared_iters_.clear();
@@ -528,10 +1025,38 @@ Status CFileSet::Iterator::InitializeSelectionVector(SelectionVector *sel_vec) {
 Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx) {
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
-
-  RETURN_NOT_OK(PrepareColumn(ctx));
   ColumnIterator* iter = col_iters_[ctx->col_idx()].get();
 
+  // If the column's predicate was looked up in its secondary or bitmap index
+  // and there are no updates to this batch, only the rows found in the index
+  // can match. If none of them are in this batch, the column doesn't need to
+  // be read.
+  if (ctx->pred() && ctx->DecoderEvalNotDisabled() && SelectIndexMatches(ctx)) {
+    if (!ctx->sel()->AnySelected()) {
+      ctx->SetDecoderEvalSupported();
+      return Status::OK();
+    }
+  }
+
+  // If the predicate can be evaluated on the base data (i.e. there are no
+  // updates to this batch), check whether the zone maps rule out the whole
+  // batch, in which case the column doesn't need to be read at all.
+  if (ctx->pred() && ctx->DecoderEvalNotDisabled() && FLAGS_consult_zone_maps) {
+    bool may_match;
+    RETURN_NOT_OK(iter->MayMatch(*ctx->pred(), cur_idx_, prepared_count_, &may_match));
+    if (!may_match) {
+      ctx->SetDecoderEvalSupported();
+      ctx->sel()->SetAllFalse();
+      return Status::OK();
+    }
+  }
+
+  {
+    TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_CFILE_READ_US_METRIC_NAME);
+    RETURN_NOT_OK(PrepareColumn(ctx));
+  }
+
+  TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_CFILE_DECODE_US_METRIC_NAME);
   RETURN_NOT_OK(iter->Scan(ctx));
 
   return Status::OK();
@@ -29,6 +29,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
+#include "kudu/cfile/block_export.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/rowid.h"
@@ -37,6 +38,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/array_view.h"
 #include "kudu/util/make_shared.h"
 #include "kudu/util/status.h"
 
@@ -48,9 +50,11 @@ class optional;
 namespace kudu {
 
 class ColumnMaterializationContext;
+class EncodedKey;
 class MemTracker;
 class ScanSpec;
 class SelectionVector;
+class TypeInfo;
 struct IteratorStats;
 
 namespace cfile {
@@ -97,12 +101,13 @@ class CFileSet :
   // Returns 0 if there is no ad hoc index.
   uint64_t AdhocIndexOnDiskSize() const;
 
-  // The on-disk size, in bytes, of this cfile set's bloomfiles.
+  // The on-disk size, in bytes, of this cfile set's bloomfiles, including the
+  // column bloom filters.
   // Returns 0 if there are no bloomfiles.
   uint64_t BloomFileOnDiskSize() const;
 
-  // The size on-disk of this cfile set's data, in bytes.
-  // Excludes the ad hoc index and bloomfiles.
+  // The size on-disk of this cfile set's data, in bytes, including the
+  // secondary indexes. Excludes the ad hoc index and bloomfiles.
   uint64_t OnDiskDataSize() const;
 
   // The size on-disk of column cfile's data, in bytes.
@@ -115,6 +120,12 @@ class CFileSet :
                  boost::optional<rowid_t>* idx,
                  ProbeStats* stats) const;
 
+  // Sets '*idx' to the index of the first row whose key is at or after 'key',
+  // or to the number of rows if there's none.
+  Status FindFirstRowAtOrAfter(const EncodedKey& key,
+                               const fs::IOContext* io_context,
+                               rowid_t* idx) const;
+
   std::string ToString() const {
     return std::string("CFile base data in ") + rowset_metadata_->ToString();
   }
@@ -124,11 +135,96 @@ class CFileSet :
   Status CheckRowPresent(const RowSetKeyProbe& probe, const fs::IOContext* io_context,
                          bool* present, rowid_t* rowid, ProbeStats* stats) const;
 
+  // Like CheckRowPresent(), but for a batch of probes. The i-th entries of
+  // 'present', 'rowids' and 'stats' correspond to the i-th probe.
+  //
+  // The bloom filter is consulted for all probes first. The probes which pass
+  // it are then looked up with a single key index iterator, so when 'probes'
+  // are sorted by key, every index and data block of the key index is read
+  // and decoded at most once per batch.
+  Status CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                          const fs::IOContext* io_context,
+                          bool* present, rowid_t* rowids,
+                          ProbeStats* const* stats) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
   }
 
+  // Return true if the given column has a secondary index.
+  bool has_secondary_index_for_column_id(ColumnId col_id) const {
+    return ContainsKey(secondary_index_readers_, col_id);
+  }
+
+  // Looks up the cells of the base data of column 'col_id' which are equal to
+  // any of 'values' in the column's secondary index. Appends the ordinal
+  // indexes of their rows to 'rowids', in no particular order.
+  //
+  // The column must have a secondary index. Updates to the base data are not
+  // taken into account.
+  Status FindRowsWithValues(ColumnId col_id,
+                            const TypeInfo* type_info,
+                            const std::vector<const void*>& values,
+                            const fs::IOContext* io_context,
+                            std::vector<rowid_t>* rowids) const;
+
+  // Return true if the given column has a bitmap index.
+  bool has_bitmap_index_for_column_id(ColumnId col_id) const {
+    return ContainsKey(bitmap_index_readers_, col_id);
+  }
+
+  // Sets the bits of 'bitmap', which has a bit for each of the 'num_rows'
+  // rows of the rowset, of the rows whose cell of column 'col_id' is equal to
+  // any of 'values' in the base data, according to the column's bitmap index.
+  //
+  // The column must have a bitmap index. Updates to the base data are not
+  // taken into account.
+  Status GetRowsWithValuesBitmap(ColumnId col_id,
+                                 const TypeInfo* type_info,
+                                 const std::vector<const void*>& values,
+                                 rowid_t num_rows,
+                                 const fs::IOContext* io_context,
+                                 uint8_t* bitmap) const;
+
+  // Return true if the given column has a bloom filter.
+  bool has_bloom_filter_for_column_id(ColumnId col_id) const {
+    return ContainsKey(column_bloom_readers_, col_id);
+  }
+
+  // Sets '*may_contain' to false if the bloom filter of column 'col_id' rules
+  // out all of 'values' in the base data of the column.
+  //
+  // The column must have a bloom filter. Updates to the base data are not
+  // taken into account.
+  Status ColumnMayContainValues(ColumnId col_id,
+                                const TypeInfo* type_info,
+                                const std::vector<const void*>& values,
+                                const fs::IOContext* io_context,
+                                bool* may_contain) const;
+
+  // Sets '*max' to the largest value of column 'col_id' in the base data,
+  // according to the column's zone maps. See CFileReader::GetMaxValue().
+  Status GetColumnMaxValue(ColumnId col_id,
+                           const fs::IOContext* io_context,
+                           std::string* max,
+                           bool* has_max) const;
+
+  // Lists the data blocks of column 'col_id' which may be exported. See
+  // cfile::ListExportableBlocks().
+  Status ListExportableBlocks(ColumnId col_id,
+                              const fs::IOContext* io_context,
+                              std::vector<cfile::ExportedCFile::Block>* blocks,
+                              uint64_t* dictionary_size) const;
+
+  // Exports the base data of column 'col_id' for the rows
+  // [start_row, end_row) as it's stored. See cfile::ExportCFile().
+  Status ExportColumn(ColumnId col_id,
+                      rowid_t start_row,
+                      rowid_t end_row,
+                      const fs::IOContext* io_context,
+                      cfile::ExportedCFile* out) const;
+
   virtual ~CFileSet();
 
  protected:
@@ -176,6 +272,14 @@ class CFileSet :
   // index pertains to more than one column, as in the case of composite keys.
   std::unique_ptr<cfile::CFileReader> ad_hoc_idx_reader_;
   std::unique_ptr<cfile::BloomFileReader> bloom_reader_;
+
+  // Map of column ID to the reader of the column's secondary index.
+  ReaderMap secondary_index_readers_;
+  // Map of column ID to the reader of the column's bitmap index.
+  ReaderMap bitmap_index_readers_;
+  // Map of column ID to the reader of the column's bloom filter.
+  boost::container::flat_map<int, std::unique_ptr<cfile::BloomFileReader>>
+      column_bloom_readers_;
 };
 
 
@@ -217,6 +321,14 @@ class CFileSet::Iterator : public ColumnwiseIterator {
     return cur_idx_;
   }
 
+  // Declares that no delta relevant to the scan updates or deletes the rows of
+  // the base data, so that the rows whose base data can't match the scan's
+  // predicates may be skipped altogether. Must be called before Init().
+  void set_base_data_unchanged() {
+    DCHECK(!initted_);
+    base_data_unchanged_ = true;
+  }
+
   // Collect the IO statistics for each of the underlying columns.
   virtual void GetIteratorStats(std::vector<IteratorStats> *stats) const OVERRIDE;
 
@@ -224,6 +336,8 @@ class CFileSet::Iterator : public ColumnwiseIterator {
  private:
   DISALLOW_COPY_AND_ASSIGN(Iterator);
   FRIEND_TEST(TestCFileSet, TestRangeScan);
+  FRIEND_TEST(TestCFileSet, TestSortedColumnPredicates);
+  FRIEND_TEST(TestCFileSet, TestColumnBloomFilterPredicates);
   friend class CFileSet;
 
   // 'projection' must remain valid for the lifetime of this object.
@@ -232,6 +346,7 @@ class CFileSet::Iterator : public ColumnwiseIterator {
       : base_data_(std::move(base_data)),
         projection_(projection),
         initted_(false),
+        base_data_unchanged_(false),
         cur_idx_(0),
         prepared_count_(0),
         io_context_(io_context) {}
@@ -244,6 +359,26 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // store it in member fields.
   Status PushdownRangeScanPredicate(ScanSpec *spec);
 
+  // Narrow the ordinal range of the iterator to the rows which may match the
+  // equality and range predicates on the sorted columns of the rowset. The
+  // predicates are kept in the scan spec. Only done if the base data is
+  // unchanged, since updates may move the rows out of order.
+  Status PushdownSortedColumnPredicates(const ScanSpec* spec);
+
+  // Empty the ordinal range of the iterator if the bloom filter of a column
+  // rules out all the values of its equality or IN-list predicate. Only done
+  // if the base data is unchanged.
+  Status PruneWithColumnBloomFilters(const ScanSpec* spec);
+
+  // Look up the rows which match the equality and IN-list predicates on the
+  // columns with secondary or bitmap indexes, filling in 'index_matches_' and
+  // 'bitmap_index_selection_'. The predicates are kept in the scan spec.
+  Status LookupColumnIndexes(const ScanSpec* spec);
+
+  // If the column of 'ctx' has a predicate looked up in an index, deselects
+  // the rows of the batch ruled out by the index and returns true.
+  bool SelectIndexMatches(ColumnMaterializationContext* ctx);
+
   void Unprepare();
 
   // Prepare the given column. The column must not have been prepared yet.
@@ -258,6 +393,9 @@ class CFileSet::Iterator : public ColumnwiseIterator {
 
   bool initted_;
 
+  // See set_base_data_unchanged().
+  bool base_data_unchanged_;
+
   size_t cur_idx_;
   size_t prepared_count_;
 
@@ -273,6 +411,18 @@ class CFileSet::Iterator : public ColumnwiseIterator {
 
   const fs::IOContext* io_context_;
 
+  // For each projected column with a predicate evaluated with its secondary
+  // index, the sorted ordinal indexes of the rows whose base data matches the
+  // predicate. Keyed by the column's index in the projection.
+  boost::container::flat_map<size_t, std::vector<rowid_t>> index_matches_;
+
+  // The intersection of the rows of the base data which match the predicates
+  // looked up in bitmap indexes, with a bit for each row of the rowset, and
+  // the indexes in the projection of the predicates' columns. Empty if no
+  // predicate was looked up in a bitmap index.
+  std::vector<uint8_t> bitmap_index_selection_;
+  std::vector<size_t> bitmap_index_cols_;
+
   // The underlying columns are prepared lazily, so that if a column is never
   // materialized, it doesn't need to be read off disk.
   //
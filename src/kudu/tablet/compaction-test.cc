@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <ostream>
 #include <random>
@@ -36,6 +37,7 @@
 
 #include "kudu/clock/logical_clock.h"
 #include "kudu/common/common.pb.h"
+#include "kudu/common/iterator.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
@@ -54,6 +56,7 @@
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/local_tablet_writer.h"
@@ -91,6 +94,8 @@ DEFINE_int32(merge_benchmark_num_rows_per_rowset, 500000,
              "Number of rowsets as input to the merge");
 
 DECLARE_string(block_manager);
+DECLARE_bool(compaction_concatenate_disjoint_rowsets);
+DECLARE_int32(tablet_compaction_num_key_ranges);
 
 using std::shared_ptr;
 using std::string;
@@ -1053,6 +1058,56 @@ TEST_F(TestCompaction, TestMerge) {
   DoMerge(schemas.back(), schemas);
 }
 
+// Test that concatenating rowsets with disjoint key ranges yields the same rows
+// and histories as merging them.
+TEST_F(TestCompaction, TestConcatDisjointRowSets) {
+  vector<shared_ptr<DiskRowSet>> rowsets;
+  for (int i = 0; i < 3; i++) {
+    shared_ptr<MemRowSet> mrs;
+    ASSERT_OK(MemRowSet::Create(i, schema_, log_anchor_registry_.get(),
+                                mem_trackers_.tablet_tracker, &mrs));
+    for (int j = 0; j < 100; j++) {
+      InsertRow(mrs.get(), i * 1000 + j, j);
+    }
+    shared_ptr<DiskRowSet> rs;
+    NO_FATALS(FlushMRSAndReopenNoRoll(*mrs, schema_, &rs));
+    // Leave some updates in the DMS.
+    for (int j = 0; j < 100; j += 7) {
+      UpdateRow(rs.get(), i * 1000 + j, -j);
+    }
+    rowsets.push_back(rs);
+  }
+  // The inputs need not be in key order.
+  std::swap(rowsets[0], rowsets[2]);
+
+  MvccSnapshot snap(mvcc_);
+  vector<shared_ptr<CompactionInput>> inputs;
+  for (const auto& rs : rowsets) {
+    unique_ptr<CompactionInput> input;
+    ASSERT_OK(CompactionInput::Create(*rs, &schema_, snap, nullptr, &input));
+    inputs.emplace_back(input.release());
+  }
+  unique_ptr<CompactionInput> merge(CompactionInput::Merge(inputs, &schema_));
+  vector<string> merged_rows;
+  NO_FATALS(IterateInput(merge.get(), &merged_rows));
+
+  FLAGS_compaction_concatenate_disjoint_rowsets = true;
+  RowSetsInCompaction compaction;
+  vector<std::unique_lock<std::mutex>> locks;
+  for (const auto& rs : rowsets) {
+    std::unique_lock<std::mutex> lock(*rs->compact_flush_lock(), std::try_to_lock);
+    ASSERT_TRUE(lock.owns_lock());
+    compaction.AddRowSet(rs, std::move(lock));
+  }
+  shared_ptr<CompactionInput> concat;
+  ASSERT_OK(compaction.CreateCompactionInput(snap, &schema_, nullptr, &concat));
+  vector<string> concatenated_rows;
+  NO_FATALS(IterateInput(concat.get(), &concatenated_rows));
+
+  ASSERT_EQ(300, concatenated_rows.size());
+  ASSERT_EQ(merged_rows, concatenated_rows);
+}
+
 // test compacting when the inputs have different base schemas
 TEST_F(TestCompaction, TestMergeMultipleSchemas) {
   vector<Schema> schemas;
@@ -1370,6 +1425,112 @@ TEST_F(TestCompaction, TestCompactionFreesDiskSpace) {
   }
 }
 
+// Test that a compaction split into key ranges writes a rowset per range and
+// preserves the tablet's rows, including their updates.
+TEST_F(TestCompaction, TestCompactionSplitIntoKeyRanges) {
+  FLAGS_tablet_compaction_num_key_ranges = 4;
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    KuduPartialRow row(&client_schema());
+
+    // Three partially overlapping rowsets: the i-th one holds the keys in
+    // [i * 100, i * 100 + 150) that are equal to i modulo 3.
+    for (int i = 0; i < 3; i++) {
+      for (int key = i * 100; key < i * 100 + 150; key++) {
+        if (key % 3 != i) continue;
+        ASSERT_OK(row.SetStringCopy("key", StringPrintf("hello %05d", key)));
+        ASSERT_OK(row.SetInt32("val", key));
+        ASSERT_OK(writer.Insert(row));
+      }
+      ASSERT_OK(tablet()->Flush());
+    }
+
+    // Update some of the flushed rows so the compaction carries REDOs over.
+    for (int key = 0; key < 300; key += 9) {
+      ASSERT_OK(row.SetStringCopy("key", StringPrintf("hello %05d", key)));
+      ASSERT_OK(row.SetInt32("val", -key));
+      ASSERT_OK(writer.Update(row));
+    }
+  }
+  ASSERT_EQ(3, tablet()->num_rowsets());
+
+  vector<string> rows_before;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_before));
+
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_GT(tablet()->num_rowsets(), 1);
+
+  vector<string> rows_after;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+}
+
+TEST_F(TestCompaction, TestCompactionClustersRows) {
+  constexpr int kNumClusters = 4;
+  TableExtraConfigPB extra_config;
+  extra_config.set_clustering_column("val");
+  extra_config.set_clustering_buckets(kNumClusters);
+  tablet()->metadata()->SetExtraConfig(std::move(extra_config));
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema());
+    KuduPartialRow row(&client_schema());
+    for (int i = 0; i < 3; i++) {
+      for (int key = i * 100; key < i * 100 + 100; key++) {
+        ASSERT_OK(row.SetStringCopy("key", StringPrintf("hello %05d", key)));
+        ASSERT_OK(row.SetInt32("val", key % 10));
+        ASSERT_OK(writer.Insert(row));
+      }
+      ASSERT_OK(tablet()->Flush());
+    }
+
+    // Move some of the rows to other clusters.
+    for (int key = 0; key < 300; key += 7) {
+      ASSERT_OK(row.SetStringCopy("key", StringPrintf("hello %05d", key)));
+      ASSERT_OK(row.SetInt32("val", 10 + key % 3));
+      ASSERT_OK(writer.Update(row));
+    }
+  }
+  vector<string> rows_before;
+  ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_before));
+
+  // The first compaction clusters the rows by their flushed values, and the
+  // second one by their updated values.
+  for (int i = 0; i < 2; i++) {
+    ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+    vector<string> rows_after;
+    ASSERT_OK(DumpTablet(*tablet(), client_schema(), &rows_after));
+    ASSERT_EQ(rows_before, rows_after);
+  }
+
+  // Each rowset holds the rows of its cluster only.
+  const RowSetClustering clustering(tablet()->schema()->find_column("val"), kNumClusters);
+  vector<shared_ptr<RowSet>> rowsets;
+  tablet()->GetRowSetsForTests(&rowsets);
+  ASSERT_GT(rowsets.size(), 1);
+  for (const auto& rs : rowsets) {
+    const int32_t cluster_id = rs->metadata()->cluster_id();
+    ASSERT_GE(cluster_id, 0);
+    ASSERT_LT(cluster_id, kNumClusters);
+
+    RowIteratorOptions opts;
+    opts.projection = tablet()->schema().get();
+    unique_ptr<RowwiseIterator> iter;
+    ASSERT_OK(rs->NewRowIterator(opts, &iter));
+    ASSERT_OK(iter->Init(nullptr));
+    RowBlockMemory mem;
+    RowBlock block(opts.projection, 100, &mem);
+    while (iter->HasNext()) {
+      mem.Reset();
+      ASSERT_OK(iter->NextBlock(&block));
+      for (int j = 0; j < block.nrows(); j++) {
+        if (block.selection_vector()->IsRowSelected(j)) {
+          ASSERT_EQ(cluster_id, clustering.ClusterOf(block.row(j)));
+        }
+      }
+    }
+  }
+}
+
 // Regression test for KUDU-1237, a bug in which empty flushes or compactions
 // would result in orphaning near-empty cfile blocks on the disk.
 TEST_F(TestCompaction, TestEmptyFlushDoesntLeakBlocks) {
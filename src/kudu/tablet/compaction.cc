@@ -21,9 +21,11 @@
 #include <cstdint>
 #include <deque>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <gflags/gflags.h>
@@ -38,6 +40,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/types.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/fs/error_manager.h"
@@ -59,7 +62,9 @@
 #include "kudu/util/faststring.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/hash_util.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 using kudu::clock::HybridClock;
 using kudu::fault_injection::MaybeTrue;
@@ -82,6 +87,13 @@ TAG_FLAG(dcheck_on_kudu_2233_invariants, unsafe);
 TAG_FLAG(dcheck_on_kudu_2233_invariants, hidden);
 #endif
 
+DEFINE_bool(compaction_concatenate_disjoint_rowsets, false,
+            "Whether compactions of rowsets whose key ranges don't interleave "
+            "concatenate the rows of the rowsets in key order, rather than "
+            "merging them row by row.");
+TAG_FLAG(compaction_concatenate_disjoint_rowsets, experimental);
+TAG_FLAG(compaction_concatenate_disjoint_rowsets, runtime);
+
 DEFINE_double(tablet_inject_kudu_2233, 0,
               "Fraction of the time that compactions that merge the history "
               "of a single row spread across multiple rowsets will return "
@@ -226,25 +238,42 @@ class MemRowSetCompactionInput : public CompactionInput {
 // CompactionInput yielding rows and mutations from an on-disk DiskRowSet.
 class DiskRowSetCompactionInput : public CompactionInput {
  public:
-  DiskRowSetCompactionInput(unique_ptr<RowwiseIterator> base_iter,
+  DiskRowSetCompactionInput(const CFileSet::Iterator* base_cfile_iter,
+                            unique_ptr<RowwiseIterator> base_iter,
                             unique_ptr<DeltaIterator> redo_delta_iter,
                             unique_ptr<DeltaIterator> undo_delta_iter)
-      : base_iter_(std::move(base_iter)),
+      : base_cfile_iter_(base_cfile_iter),
+        base_iter_(std::move(base_iter)),
         redo_delta_iter_(std::move(redo_delta_iter)),
         undo_delta_iter_(std::move(undo_delta_iter)),
+        key_range_spec_(nullptr),
         mem_(32 * 1024),
         block_(&base_iter_->schema(), kRowsPerBlock, &mem_),
         redo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)),
         undo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)) {}
 
+  Status RestrictToKeyRange(const ScanSpec* spec) override {
+    key_range_spec_ = spec;
+    return Status::OK();
+  }
+
   Status Init() override {
     ScanSpec spec;
     spec.set_cache_blocks(false);
+    if (key_range_spec_ && key_range_spec_->lower_bound_key()) {
+      spec.SetLowerBoundKey(key_range_spec_->lower_bound_key());
+    }
+    if (key_range_spec_ && key_range_spec_->exclusive_upper_bound_key()) {
+      spec.SetExclusiveUpperBoundKey(key_range_spec_->exclusive_upper_bound_key());
+    }
     RETURN_NOT_OK(base_iter_->Init(&spec));
+    // The base data iterator pushes the key bounds down into a range of row
+    // ordinals, which is where the deltas start too.
+    const rowid_t start_row = base_cfile_iter_->cur_ordinal_idx();
     RETURN_NOT_OK(redo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(start_row));
     RETURN_NOT_OK(undo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(0));
+    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(start_row));
     return Status::OK();
   }
 
@@ -290,10 +319,15 @@ class DiskRowSetCompactionInput : public CompactionInput {
 
  private:
   DISALLOW_COPY_AND_ASSIGN(DiskRowSetCompactionInput);
+  // The iterator over the rowset's base data, owned by 'base_iter_'.
+  const CFileSet::Iterator* base_cfile_iter_;
   unique_ptr<RowwiseIterator> base_iter_;
   unique_ptr<DeltaIterator> redo_delta_iter_;
   unique_ptr<DeltaIterator> undo_delta_iter_;
 
+  // If set, the key bounds this input is restricted to.
+  const ScanSpec* key_range_spec_;
+
   RowBlockMemory mem_;
 
   // The current block of data which has come from the input iterator
@@ -306,6 +340,71 @@ class DiskRowSetCompactionInput : public CompactionInput {
   };
 };
 
+// CompactionInput yielding the rows of several inputs with disjoint key ranges,
+// one input after the other.
+class ConcatCompactionInput : public CompactionInput {
+ public:
+  ConcatCompactionInput(vector<shared_ptr<CompactionInput>> inputs,
+                        const Schema* schema)
+      : inputs_(std::move(inputs)),
+        schema_(schema),
+        cur_idx_(0) {}
+
+  Status RestrictToKeyRange(const ScanSpec* spec) override {
+    for (const auto& input : inputs_) {
+      RETURN_NOT_OK(input->RestrictToKeyRange(spec));
+    }
+    return Status::OK();
+  }
+
+  Status Init() override {
+    for (const auto& input : inputs_) {
+      RETURN_NOT_OK(input->Init());
+    }
+    SkipExhaustedInputs();
+    return Status::OK();
+  }
+
+  bool HasMoreBlocks() override {
+    return cur_idx_ < inputs_.size();
+  }
+
+  Status PrepareBlock(vector<CompactionInputRow> *block) override {
+    DCHECK(HasMoreBlocks());
+    return inputs_[cur_idx_]->PrepareBlock(block);
+  }
+
+  Arena* PreparedBlockArena() override {
+    return inputs_[cur_idx_]->PreparedBlockArena();
+  }
+
+  Status FinishBlock() override {
+    RETURN_NOT_OK(inputs_[cur_idx_]->FinishBlock());
+    SkipExhaustedInputs();
+    return Status::OK();
+  }
+
+  const Schema &schema() const override {
+    return *schema_;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ConcatCompactionInput);
+
+  // Moves 'cur_idx_' to the next input that has blocks left, if any.
+  void SkipExhaustedInputs() {
+    while (cur_idx_ < inputs_.size() && !inputs_[cur_idx_]->HasMoreBlocks()) {
+      cur_idx_++;
+    }
+  }
+
+  const vector<shared_ptr<CompactionInput>> inputs_;
+  const Schema* schema_;
+
+  // The input whose blocks are currently being returned.
+  size_t cur_idx_;
+};
+
 // Compares two duplicate rows before compaction (and before the REDO->UNDO
 // transformation). Returns 1 if 'left' is more recent than 'right', -1
 // otherwise. Never returns 0.
@@ -588,6 +687,13 @@ class MergeCompactionInput : public CompactionInput {
     STLDeleteElements(&states_);
   }
 
+  Status RestrictToKeyRange(const ScanSpec* spec) override {
+    for (MergeState *state : states_) {
+      RETURN_NOT_OK(state->input->RestrictToKeyRange(spec));
+    }
+    return Status::OK();
+  }
+
   Status Init() override {
     for (MergeState *state : states_) {
       RETURN_NOT_OK(state->input->Init());
@@ -1055,8 +1161,10 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
                                unique_ptr<CompactionInput>* out) {
   CHECK(projection->has_column_ids());
 
-  unique_ptr<ColumnwiseIterator> base_cwise(rowset.base_data_->NewIterator(projection, io_context));
-  unique_ptr<RowwiseIterator> base_iter(NewMaterializingIterator(std::move(base_cwise)));
+  unique_ptr<CFileSet::Iterator> base_cfile_iter(
+      rowset.base_data_->NewIterator(projection, io_context));
+  const CFileSet::Iterator* base_cfile_iter_ptr = base_cfile_iter.get();
+  unique_ptr<RowwiseIterator> base_iter(NewMaterializingIterator(std::move(base_cfile_iter)));
 
   // Creates a DeltaIteratorMerger that will only include the relevant REDO deltas.
   RowIteratorOptions redo_opts;
@@ -1076,7 +1184,8 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
   RETURN_NOT_OK_PREPEND(rowset.delta_tracker_->NewDeltaIterator(
       undo_opts, DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
 
-  out->reset(new DiskRowSetCompactionInput(std::move(base_iter),
+  out->reset(new DiskRowSetCompactionInput(base_cfile_iter_ptr,
+                                           std::move(base_iter),
                                            std::move(redo_deltas),
                                            std::move(undo_deltas)));
   return Status::OK();
@@ -1095,6 +1204,40 @@ CompactionInput *CompactionInput::Merge(const vector<shared_ptr<CompactionInput>
   return new MergeCompactionInput(inputs, schema);
 }
 
+CompactionInput *CompactionInput::Concat(const vector<shared_ptr<CompactionInput> > &inputs,
+                                         const Schema* schema) {
+  CHECK(schema->has_column_ids());
+  return new ConcatCompactionInput(inputs, schema);
+}
+
+namespace {
+
+// If the key ranges of 'rowsets' don't interleave, returns true and sets
+// 'order' to the indexes of the rowsets in ascending key order.
+bool OrderDisjointRowSets(const RowSetVector& rowsets, vector<size_t>* order) {
+  vector<std::pair<string, string>> bounds(rowsets.size());
+  for (size_t i = 0; i < rowsets.size(); i++) {
+    if (!rowsets[i]->GetBounds(&bounds[i].first, &bounds[i].second).ok()) {
+      return false;
+    }
+  }
+  order->resize(rowsets.size());
+  std::iota(order->begin(), order->end(), 0);
+  std::sort(order->begin(), order->end(), [&](size_t a, size_t b) {
+    return bounds[a].first < bounds[b].first;
+  });
+  // Rowsets sharing a key could hold duplicate rows, which must be merged, so
+  // the ranges must be strictly disjoint.
+  for (size_t i = 1; i < order->size(); i++) {
+    if (bounds[(*order)[i - 1]].second >= bounds[(*order)[i]].first) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
 
 Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
                                                   const Schema* schema,
@@ -1111,8 +1254,17 @@ Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
     inputs.push_back(shared_ptr<CompactionInput>(input.release()));
   }
 
+  vector<size_t> order;
   if (inputs.size() == 1) {
     *out = std::move(inputs[0]);
+  } else if (FLAGS_compaction_concatenate_disjoint_rowsets &&
+             OrderDisjointRowSets(rowsets_, &order)) {
+    vector<shared_ptr<CompactionInput>> ordered_inputs;
+    ordered_inputs.reserve(inputs.size());
+    for (size_t idx : order) {
+      ordered_inputs.emplace_back(std::move(inputs[idx]));
+    }
+    out->reset(CompactionInput::Concat(ordered_inputs, schema));
   } else {
     out->reset(CompactionInput::Merge(inputs, schema));
   }
@@ -1301,26 +1453,71 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
   #undef ERROR_LOG_CONTEXT
 }
 
+int RowSetClustering::ClusterOf(const RowBlockRow& row) const {
+  const ColumnSchema& col = row.schema()->column(col_idx_);
+  if (col.is_nullable() && row.is_null(col_idx_)) {
+    return 0;
+  }
+  const void* cell = row.cell_ptr(col_idx_);
+  uint64_t hash;
+  if (col.type_info()->physical_type() == BINARY) {
+    const Slice* s = reinterpret_cast<const Slice*>(cell);
+    hash = HashUtil::MurmurHash2_64(s->data(), s->size(), /*seed=*/0);
+  } else {
+    hash = HashUtil::MurmurHash2_64(cell, col.type_info()->size(), /*seed=*/0);
+  }
+  return static_cast<int>(hash % num_clusters_);
+}
+
 Status FlushCompactionInput(const string& tablet_id,
                             const FsErrorManager* error_manager,
                             CompactionInput* input,
                             const MvccSnapshot& snap,
                             const HistoryGcOpts& history_gc_opts,
                             RollingDiskRowSetWriter* out) {
+  return FlushCompactionInput(tablet_id, error_manager, input, snap, history_gc_opts,
+                              /*clustering=*/nullptr, { out });
+}
+
+Status FlushCompactionInput(const string& tablet_id,
+                            const FsErrorManager* error_manager,
+                            CompactionInput* input,
+                            const MvccSnapshot& snap,
+                            const HistoryGcOpts& history_gc_opts,
+                            const RowSetClustering* clustering,
+                            const vector<RollingDiskRowSetWriter*>& outs) {
+  DCHECK_EQ(clustering ? clustering->num_clusters() : 1, outs.size());
   RETURN_NOT_OK(input->Init());
   vector<CompactionInputRow> rows;
 
-  DCHECK(out->schema().has_column_ids());
-
-  RowBlock block(&out->schema(), kCompactionOutputBlockNumRows, nullptr);
+  // The block of rows being accumulated for each writer.
+  struct OutputBlock {
+    explicit OutputBlock(const Schema* schema)
+        : block(schema, kCompactionOutputBlockNumRows, nullptr),
+          n(0),
+          live_row_count(0) {
+    }
+    RowBlock block;
+    int n;
+    int live_row_count;
+  };
+  vector<unique_ptr<OutputBlock>> blocks;
+  blocks.reserve(outs.size());
+  for (RollingDiskRowSetWriter* out : outs) {
+    DCHECK(out->schema().has_column_ids());
+    blocks.emplace_back(new OutputBlock(&out->schema()));
+  }
 
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
 
-    int n = 0;
-    int live_row_count = 0;
     for (int i = 0; i < rows.size(); i++) {
       CompactionInputRow* input_row = &rows[i];
+      const int out_idx = clustering ? clustering->ClusterOf(input_row->row) : 0;
+      RollingDiskRowSetWriter* out = outs[out_idx];
+      RowBlock& block = blocks[out_idx]->block;
+      int& n = blocks[out_idx]->n;
+      int& live_row_count = blocks[out_idx]->live_row_count;
       RETURN_NOT_OK(out->RollIfNecessary());
 
       const Schema* schema = input_row->row.schema();
@@ -1414,10 +1611,17 @@ Status FlushCompactionInput(const string& tablet_id,
       }
     }
 
-    if (n > 0) {
-      block.Resize(n);
-      RETURN_NOT_OK(out->AppendBlock(block, live_row_count));
-      block.Resize(block.row_capacity());
+    // The rows of the blocks point into the input block's arena, so they must
+    // be appended before the next input block is prepared.
+    for (int i = 0; i < blocks.size(); i++) {
+      OutputBlock* b = blocks[i].get();
+      if (b->n > 0) {
+        b->block.Resize(b->n);
+        RETURN_NOT_OK(outs[i]->AppendBlock(b->block, b->live_row_count));
+        b->block.Resize(b->block.row_capacity());
+        b->n = 0;
+        b->live_row_count = 0;
+      }
     }
 
     RETURN_NOT_OK(input->FinishBlock());
@@ -1431,16 +1635,38 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
                             const MvccSnapshot &snap_to_exclude,
                             const MvccSnapshot &snap_to_include,
                             const RowSetVector &output_rowsets) {
+  return ReupdateMissedDeltas(io_context, input, history_gc_opts, snap_to_exclude,
+                              snap_to_include, /*clustering=*/nullptr, { output_rowsets });
+}
+
+Status ReupdateMissedDeltas(const IOContext* io_context,
+                            CompactionInput* input,
+                            const HistoryGcOpts& history_gc_opts,
+                            const MvccSnapshot& snap_to_exclude,
+                            const MvccSnapshot& snap_to_include,
+                            const RowSetClustering* clustering,
+                            const vector<RowSetVector>& output_rowsets) {
   TRACE_EVENT0("tablet", "ReupdateMissedDeltas");
+  DCHECK_EQ(clustering ? clustering->num_clusters() : 1, output_rowsets.size());
   RETURN_NOT_OK(input->Init());
 
   VLOG(1) << "Reupdating missed deltas between snapshot " <<
     snap_to_exclude.ToString() << " and " << snap_to_include.ToString();
 
-  // Collect the disk rowsets that we'll push the updates into.
-  deque<DiskRowSet *> diskrowsets;
-  for (const shared_ptr<RowSet> &rs : output_rowsets) {
-    diskrowsets.push_back(down_cast<DiskRowSet *>(rs.get()));
+  // The position in the rowsets written for each cluster, or for all of the
+  // rows if they aren't clustered.
+  struct OutputCursor {
+    // The disk rowsets that we'll push the updates into.
+    deque<DiskRowSet*> diskrowsets;
+    // The rowid where the current (front) delta tracker starts.
+    int64_t delta_tracker_base_row = 0;
+    rowid_t output_row_offset = 0;
+  };
+  vector<OutputCursor> cursors(output_rowsets.size());
+  for (int i = 0; i < output_rowsets.size(); i++) {
+    for (const shared_ptr<RowSet>& rs : output_rowsets[i]) {
+      cursors[i].diskrowsets.push_back(down_cast<DiskRowSet*>(rs.get()));
+    }
   }
 
   // The set of updated delta trackers.
@@ -1450,20 +1676,20 @@ Status ReupdateMissedDeltas(const IOContext* io_context,
   // since these stores are not yet part of the tablet.
   const consensus::OpId max_op_id = consensus::MaximumOpId();
 
-  // The rowid where the current (front) delta tracker starts.
-  int64_t delta_tracker_base_row = 0;
-
   // TODO: on this pass, we don't actually need the row data, just the
   // updates. So, this can be made much faster.
   vector<CompactionInputRow> rows;
   const Schema* schema = &input->schema();
 
-  rowid_t output_row_offset = 0;
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
 
     for (const CompactionInputRow &row : rows) {
       DVLOG(4) << "Revisiting row: " << CompactionInputRowToString(row);
+      OutputCursor& cursor = cursors[clustering ? clustering->ClusterOf(row.row) : 0];
+      deque<DiskRowSet*>& diskrowsets = cursor.diskrowsets;
+      int64_t& delta_tracker_base_row = cursor.delta_tracker_base_row;
+      rowid_t& output_row_offset = cursor.output_row_offset;
 
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
@@ -33,6 +33,7 @@
 namespace kudu {
 
 class Arena;
+class ScanSpec;
 class Schema;
 
 namespace fs {
@@ -121,6 +122,23 @@ class CompactionInput {
   static CompactionInput *Merge(const std::vector<std::shared_ptr<CompactionInput> > &inputs,
                                 const Schema *schema);
 
+  // Create an input which yields the rows of each of the given inputs in turn,
+  // without merging them. The inputs must cover disjoint key ranges and be in
+  // ascending key order, so that their concatenation is in key order and has
+  // no duplicate rows. All inputs must have matching schemas.
+  static CompactionInput *Concat(const std::vector<std::shared_ptr<CompactionInput> > &inputs,
+                                 const Schema *schema);
+
+  // Restricts this input to the rows whose keys fall within the primary key
+  // bounds of 'spec', so that disjoint key ranges of a compaction may be
+  // processed independently. Must be called before Init(). Only the bounds of
+  // 'spec' are used, and they are consumed by Init().
+  //
+  // Returns NotSupported if the input can't be restricted.
+  virtual Status RestrictToKeyRange(const ScanSpec* /*spec*/) {
+    return Status::NotSupported("compaction input can't be restricted to a key range");
+  }
+
   virtual Status Init() = 0;
   virtual Status PrepareBlock(std::vector<CompactionInputRow> *block) = 0;
 
@@ -149,7 +167,9 @@ class RowSetsInCompaction {
   }
 
   // Create the appropriate compaction input for this compaction -- either a merge
-  // of all the inputs, or the single input if there was only one.
+  // of all the inputs, or the single input if there was only one. If
+  // --compaction_concatenate_disjoint_rowsets is set and the key ranges of the
+  // rowsets don't interleave, the inputs are concatenated rather than merged.
   //
   // 'schema' is the schema for the output of the compaction, and must remain valid
   // for the lifetime of the returned CompactionInput.
@@ -222,6 +242,32 @@ Status ApplyMutationsAndGenerateUndos(const MvccSnapshot& snap,
                                       Arena* arena,
                                       RowBlockRow* dst_row);
 
+// Assigns the rows of a compaction to clusters by the hash of their value in
+// a column. See TableExtraConfigPB.clustering_column.
+//
+// The cluster of a row is that of its base value in the compaction input, so
+// both phases of a compaction assign each row to the same cluster. A row whose
+// value was updated moves to the cluster of its new value in the compaction
+// after the one which applied the update to its base data.
+class RowSetClustering {
+ public:
+  RowSetClustering(int col_idx, int num_clusters)
+      : col_idx_(col_idx),
+        num_clusters_(num_clusters) {
+    DCHECK_GT(num_clusters, 0);
+  }
+
+  // Returns the cluster of 'row', in [0, num_clusters()). Null values belong
+  // to the first cluster.
+  int ClusterOf(const RowBlockRow& row) const;
+
+  int num_clusters() const { return num_clusters_; }
+
+ private:
+  const int col_idx_;
+  const int num_clusters_;
+};
+
 // Iterate through this compaction input, flushing all rows to the given RollingDiskRowSetWriter.
 // The 'snap' argument should match the MvccSnapshot used to create the compaction input.
 //
@@ -234,6 +280,17 @@ Status FlushCompactionInput(const std::string& tablet_id,
                             const HistoryGcOpts& history_gc_opts,
                             RollingDiskRowSetWriter *out);
 
+// As above, but if 'clustering' is non-null, the rows of each cluster are
+// flushed to the writer at the cluster's index in 'outs'. Otherwise 'outs'
+// must hold a single writer.
+Status FlushCompactionInput(const std::string& tablet_id,
+                            const fs::FsErrorManager* error_manager,
+                            CompactionInput* input,
+                            const MvccSnapshot& snap,
+                            const HistoryGcOpts& history_gc_opts,
+                            const RowSetClustering* clustering,
+                            const std::vector<RollingDiskRowSetWriter*>& outs);
+
 // Iterate through this compaction input, finding any mutations which came
 // between snap_to_exclude and snap_to_include (ie those ops that were not yet
 // committed in 'snap_to_exclude' but _are_ committed in 'snap_to_include').
@@ -251,6 +308,18 @@ Status ReupdateMissedDeltas(const fs::IOContext* io_context,
                             const MvccSnapshot &snap_to_include,
                             const RowSetVector &output_rowsets);
 
+// As above, for the output of a FlushCompactionInput() call with the given
+// 'clustering': each element of 'output_rowsets' holds the rowsets written for
+// the cluster at its index, non-overlapping and in ascending key order. If
+// 'clustering' is null, 'output_rowsets' must hold a single element.
+Status ReupdateMissedDeltas(const fs::IOContext* io_context,
+                            CompactionInput* input,
+                            const HistoryGcOpts& history_gc_opts,
+                            const MvccSnapshot& snap_to_exclude,
+                            const MvccSnapshot& snap_to_include,
+                            const RowSetClustering* clustering,
+                            const std::vector<RowSetVector>& output_rowsets);
+
 // Dump the given compaction input to 'lines' or LOG(INFO) if it is NULL.
 // This consumes all of the input in the compaction input.
 Status DebugDumpCompactionInput(CompactionInput *input, std::vector<std::string> *lines);
@@ -51,6 +51,7 @@ using std::string;
 using std::vector;
 
 DECLARE_double(compaction_minimum_improvement);
+DECLARE_double(compaction_read_cost_weight);
 DECLARE_double(compaction_small_rowset_tradeoff);
 DECLARE_int64(budgeted_compaction_target_rowset_size);
 
@@ -102,6 +103,70 @@ TEST_F(TestCompactionPolicy, TestBudgetedSelection) {
   ASSERT_LE(quality, 2.0);
 }
 
+// With a read cost weight, overlapping rowsets that serve the reads should be
+// compacted ahead of more overlapping but cold ones.
+TEST_F(TestCompactionPolicy, TestReadCostWeightedSelection) {
+  FLAGS_compaction_small_rowset_tradeoff = 0.0;
+
+  /*
+   *                  [D -- e] hot
+   *                  [D -- e] hot
+   * [A -- b] cold
+   * [A -- b] cold
+   * [A -- b] cold
+   */
+  const auto cold1 = std::make_shared<MockDiskRowSet>("A", "b");
+  const auto cold2 = std::make_shared<MockDiskRowSet>("A", "b");
+  const auto cold3 = std::make_shared<MockDiskRowSet>("A", "b");
+  const auto hot1 = std::make_shared<MockDiskRowSet>("D", "e", 500000);
+  const auto hot2 = std::make_shared<MockDiskRowSet>("D", "e", 500000);
+  hot1->set_read_access_rate(100);
+  hot2->set_read_access_rate(100);
+  const RowSetVector rowsets = { cold1, cold2, cold3, hot1, hot2 };
+
+  // Enough to select only two of the rowsets.
+  constexpr auto kBudgetMb = 2;
+
+  // The cold rowsets are bigger, so compacting them reduces the average height
+  // more.
+  {
+    CompactionSelection picked;
+    double quality = 0.0;
+    NO_FATALS(RunTestCase(rowsets, kBudgetMb, &picked, &quality));
+    ASSERT_EQ(2, picked.size());
+    ASSERT_EQ(0, picked.count(hot1.get()));
+    ASSERT_EQ(0, picked.count(hot2.get()));
+  }
+
+  // Weighted by read traffic, the hot rowsets win.
+  FLAGS_compaction_read_cost_weight = 1.0;
+  {
+    CompactionSelection picked;
+    double quality = 0.0;
+    NO_FATALS(RunTestCase(rowsets, kBudgetMb, &picked, &quality));
+    ASSERT_EQ(2, picked.size());
+    ASSERT_EQ(1, picked.count(hot1.get()));
+    ASSERT_EQ(1, picked.count(hot2.get()));
+  }
+}
+
+// Read traffic only weighs the height reduction of a compaction: a hot rowset
+// which overlaps no other rowset isn't worth compacting on its own.
+TEST_F(TestCompactionPolicy, TestReadCostWeightedLoneRowSet) {
+  FLAGS_compaction_small_rowset_tradeoff = 0.0;
+  FLAGS_compaction_read_cost_weight = 1.0;
+  const auto hot = std::make_shared<MockDiskRowSet>("A", "B");
+  const auto cold = std::make_shared<MockDiskRowSet>("C", "D");
+  hot->set_read_access_rate(100);
+  const RowSetVector rowsets = { hot, cold };
+
+  CompactionSelection picked;
+  double quality = 0.0;
+  NO_FATALS(RunTestCase(rowsets, /*size_budget_mb=*/100, &picked, &quality));
+  ASSERT_TRUE(picked.empty());
+  ASSERT_EQ(0.0, quality);
+}
+
 // Test for the case when we have many rowsets, but none of them
 // overlap at all. This is likely to occur in workloads where the
 // primary key is always increasing (such as a timestamp).
@@ -294,13 +294,17 @@ void BudgetedCompactionPolicy::RunApproximation(
     bound_calc.clear();
     double union_min = rowset_a.cdf_min_key();
     double union_max = rowset_a.cdf_max_key();
+    double union_read_weight = 0.0;
     double best_upper = 0.0;
     for (const RowSetInfo& rowset_b : asc_max_key) {
       if (rowset_b.cdf_min_key() < union_min) {
         continue;
       }
       union_max = std::max(union_max, rowset_b.cdf_max_key());
-      double union_width = union_max - union_min;
+      // The union width is weighted like the widths of the rowsets, with the
+      // read weight of the hottest of the candidates.
+      union_read_weight = std::max(union_read_weight, rowset_b.read_weight());
+      double union_width = (union_max - union_min) * union_read_weight;
 
       bound_calc.Add(rowset_b);
       auto bounds = bound_calc.ComputeLowerAndUpperBound();
@@ -364,6 +368,7 @@ void BudgetedCompactionPolicy::RunExact(
 
     vector<int> chosen_indexes;
     int j = 0;
+    double union_read_weight = 0.0;
     while (solver.ProcessNext()) {
       const RowSetInfo* item = candidates[j++];
       std::pair<int, double> best_with_this_item = solver.GetSolution();
@@ -371,8 +376,10 @@ void BudgetedCompactionPolicy::RunExact(
 
       union_max = std::max(item->cdf_max_key(), union_max);
       DCHECK_GE(union_max, union_min);
-      double solution = MaybePenalizeWideSolution(best_value,
-                                                  union_max - union_min);
+      // Weighted as in RunApproximation(), for the bounds to hold.
+      union_read_weight = std::max(union_read_weight, item->read_weight());
+      double solution = MaybePenalizeWideSolution(
+          best_value, (union_max - union_min) * union_read_weight);
       if (solution > best_solution->value) {
         solver.TracePath(best_with_this_item, &chosen_indexes);
         best_solution->value = solution;
@@ -35,6 +35,11 @@
 // - The leaf nodes are linked together with a "next" pointer. This makes
 //   scanning simpler (the Masstree implementation avoids this because it
 //   complicates the removal operation)
+// - The keys of leaf nodes are prefix-compressed: each leaf has a prefix key,
+//   and only stores the part of each key after the bytes it shares with that
+//   prefix. Keys with long common prefixes (e.g. composite keys starting with
+//   a tenant and a date) are thus mostly short enough to be stored inline in
+//   the leaves, rather than copied into the arena.
 //
 // NOTE: this code disables TSAN for the most part. This is because it uses
 // some "clever" concurrency mechanisms which are difficult to model in TSAN.
@@ -52,6 +57,7 @@
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/util/debug/sanitizer_scopes.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/inline_slice.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/memory/arena.h"
@@ -722,10 +728,22 @@ class LeafNode : public NodeBase<Traits> {
 
     this->SetInserting();
 
+    // The first key of the tree is the prefix of its first leaf. The leaves
+    // split from it get theirs in SplitLeafNode().
+    if (num_entries_ == 0 && prefix_.as_slice().empty()) {
+      SetPrefix(key, arena);
+    }
+    const size_t shared = SharedPrefixLength(prefix_.as_slice(), key);
+
     // The following inserts should always succeed because we
     // verified that there is space available above.
     num_entries_++;
-    InsertInSliceArray(keys_, num_entries_, key, idx, arena);
+    InsertInSliceArray(keys_, num_entries_, Slice(key.data() + shared, key.size() - shared),
+                       idx, arena);
+    for (size_t i = num_entries_ - 1; i > idx; i--) {
+      prefix_lens_[i] = prefix_lens_[i - 1];
+    }
+    prefix_lens_[idx] = shared;
     DebugRacyPoint<Traits>();
     InsertInSliceArray(vals_, num_entries_, val, idx, arena);
 
@@ -741,16 +759,57 @@ class LeafNode : public NodeBase<Traits> {
   // Note that, if the lock is not held, this may return
   // bogus results, in which case OCC must be used to verify.
   size_t Find(const Slice &key, bool *exact) const {
-    return FindInSliceArray(keys_, num_entries_, key, exact);
+    const size_t num_entries = num_entries_;
+    if (PREDICT_FALSE(num_entries == 0)) {
+      *exact = false;
+      return 0;
+    }
+
+    // The bytes the search key shares with the prefix are compared once,
+    // rather than with every key.
+    const Slice prefix = prefix_.as_slice();
+    const size_t key_shared = SharedPrefixLength(prefix, key);
+
+    size_t left = 0;
+    size_t right = num_entries - 1;
+    while (left < right) {
+      int mid = (left + right + 1) / 2;
+      int compare = CompareKey(mid, prefix, key, key_shared);
+      if (compare < 0) { // mid < key
+        left = mid;
+      } else if (compare > 0) { // mid > search
+        right = mid - 1;
+      } else { // mid == search
+        *exact = true;
+        return mid;
+      }
+    }
+
+    int compare = CompareKey(left, prefix, key, key_shared);
+    *exact = compare == 0;
+    if (compare < 0) { // key > left
+      left++;
+    }
+    return left;
   }
 
-  // Get the slice corresponding to the nth key.
+  // Get the slice corresponding to the nth key. If the key shares bytes with
+  // the prefix of the node, it's assembled into 'buf', which the returned
+  // slice then points to.
   //
-  // If the caller does not hold the lock, then this Slice
-  // may point to arbitrary data, and the result should be only
-  // trusted when verified by checking for conflicts.
-  Slice GetKey(size_t idx) const {
-    return keys_[idx].as_slice();
+  // The caller must hold the lock, or work on a consistent copy of the node.
+  Slice GetKey(size_t idx, faststring* buf) const {
+    const Slice suffix = keys_[idx].as_slice();
+    const Slice prefix = prefix_.as_slice();
+    const size_t shared = std::min<size_t>(prefix_lens_[idx], prefix.size());
+    if (shared == 0) {
+      return suffix;
+    }
+    buf->clear();
+    buf->reserve(shared + suffix.size());
+    buf->append(prefix.data(), shared);
+    buf->append(suffix.data(), suffix.size());
+    return Slice(*buf);
   }
 
   ValueSlice GetValue(size_t idx) const {
@@ -768,8 +827,8 @@ class LeafNode : public NodeBase<Traits> {
   // before accessing the value slice.
   // The key, on the other hand, will always be a valid pointer, but
   // may be invalid data.
-  void Get(size_t idx, Slice *k, ValueSlice *v) const {
-    *k = GetKey(idx);
+  void Get(size_t idx, Slice *k, ValueSlice *v, faststring* key_buf) const {
+    *k = GetKey(idx, key_buf);
     *v = GetValue(idx);
   }
 
@@ -786,11 +845,12 @@ class LeafNode : public NodeBase<Traits> {
 
   std::string ToString() const {
     std::string ret;
+    faststring key_buf;
     for (int i = 0; i < num_entries_; i++) {
       if (i > 0) {
         ret.append(", ");
       }
-      Slice k = keys_[i].as_slice();
+      Slice k = GetKey(i, &key_buf);
       Slice v = vals_[i].as_slice();
       ret.append("[");
       ret.append(KUDU_REDACT(k.ToDebugString()));
@@ -814,15 +874,60 @@ class LeafNode : public NodeBase<Traits> {
   enum SpaceConstants {
     constant_overhead = sizeof(NodeBase<Traits>) // base class
                         + sizeof(LeafNode<Traits>*) // next_
+                        + sizeof(KeyInlineSlice) // prefix_
                         + sizeof(uint8_t), // num_entries_
     kv_space = Traits::kLeafNodeSize - constant_overhead,
-    kMaxEntries = kv_space / (sizeof(KeyInlineSlice) + sizeof(ValueSlice))
+    kMaxEntries = kv_space / (sizeof(KeyInlineSlice) + sizeof(ValueSlice) + sizeof(uint8_t)),
+    // The longest prefix a key may share with that of its node.
+    kMaxPrefixLength = MathLimits<uint8_t>::kMax
   };
 
+  // Returns the number of leading bytes 'key' shares with 'prefix'.
+  static size_t SharedPrefixLength(const Slice& prefix, const Slice& key) {
+    const size_t max_len = std::min(prefix.size(), key.size());
+    size_t len = 0;
+    while (len < max_len && prefix[len] == key[len]) {
+      len++;
+    }
+    return len;
+  }
+
+  // Compares the key at 'idx' with 'key', which shares 'key_shared' bytes
+  // with 'prefix', the prefix of the node.
+  //
+  // If the lock isn't held, the result may be bogus, but the data read is
+  // always valid memory.
+  int CompareKey(size_t idx, const Slice& prefix, const Slice& key, size_t key_shared) const {
+    const size_t shared = std::min<size_t>(prefix_lens_[idx], prefix.size());
+    if (shared <= key_shared) {
+      // Both keys start with the same 'shared' bytes of the prefix.
+      return keys_[idx].as_slice().compare(
+          Slice(key.data() + shared, key.size() - shared));
+    }
+    // The stored key starts with more of the prefix than 'key' does: they
+    // differ at the first byte of the prefix which 'key' doesn't share.
+    if (key_shared == key.size()) {
+      return 1;
+    }
+    return prefix[key_shared] < key[key_shared] ? -1 : 1;
+  }
+
+  // Sets the prefix of the node to (at most kMaxPrefixLength bytes of) 'key'.
+  // Only valid while no stored key shares bytes with the current prefix.
+  void SetPrefix(const Slice& key, typename Traits::ArenaType* arena) {
+    prefix_.set(key.data(), std::min<size_t>(key.size(), kMaxPrefixLength), arena);
+  }
+
   // This ordering of members keeps KeyInlineSlices so pointers are aligned
   LeafNode<Traits>* next_;
+  // The prefix the keys are compressed against. It's immutable once the node
+  // has keys, but for SplitLeafNode() setting the prefix of a new node.
+  KeyInlineSlice prefix_;
+  // The parts of the keys after the bytes they share with prefix_, and the
+  // numbers of such bytes.
   KeyInlineSlice keys_[kMaxEntries];
   ValueSlice vals_[kMaxEntries];
+  uint8_t prefix_lens_[kMaxEntries];
   uint8_t num_entries_;
 } PACKED;
 
@@ -882,9 +987,7 @@ class PreparedMutation {
   // has the same size as the original data.
   Slice current_mutable_value() {
     CHECK(prepared());
-    Slice k;
-    ValueSlice v;
-    leaf_->Get(idx_, &k, &v);
+    ValueSlice v = leaf_->GetValue(idx_);
     leaf_->SetInserting();
     return v.as_slice();
   }
@@ -1017,7 +1120,6 @@ class CBTree {
       retry_in_leaf:
       {
         GetResult ret;
-        Slice key_in_node;
         ValueSlice val_in_node;
         bool exact;
         size_t idx = leaf->Find(key, &exact);
@@ -1026,7 +1128,7 @@ class CBTree {
         if (!exact) {
           ret = GET_NOT_FOUND;
         } else {
-          leaf->Get(idx, &key_in_node, &val_in_node);
+          val_in_node = leaf->GetValue(idx);
           ret = GET_SUCCESS;
         }
 
@@ -1428,9 +1530,11 @@ class CBTree {
 #ifdef DEBUG_DUMP_SPLIT_STATS
     do {
       size_t key_size = 0, val_size = 0;
+      faststring key_buf;
       for (size_t i = 0; i < node->num_entries(); i++) {
-        Slice k, v;
-        node->Get(i, &k, &v);
+        Slice k;
+        ValueSlice v;
+        node->Get(i, &k, &v, &key_buf);
         key_size += k.size();
         val_size += v.size();
       }
@@ -1452,8 +1556,29 @@ class CBTree {
               new_leaf->keys_);
     std::copy(node->vals_ + copy_start, node->vals_ + node->num_entries(),
               new_leaf->vals_);
+    std::copy(node->prefix_lens_ + copy_start, node->prefix_lens_ + node->num_entries(),
+              new_leaf->prefix_lens_);
     new_leaf->num_entries_ = node->num_entries() - copy_start;
 
+    // The copied keys are compressed against the prefix of the old node, which
+    // the new one inherits, unless its first key also is a prefix of those:
+    // that is, unless none of them shares more bytes with the old prefix than
+    // the first key does. The keys then are compressed against the first key
+    // with the same shared lengths, and the next keys inserted into the new
+    // node likely share more bytes with it.
+    faststring first_key_buf;
+    const Slice first_key = node->GetKey(copy_start, &first_key_buf);
+    const size_t first_shared = node->prefix_lens_[copy_start];
+    bool first_key_is_prefix = first_key.size() > first_shared;
+    for (size_t i = 0; first_key_is_prefix && i < new_leaf->num_entries_; i++) {
+      first_key_is_prefix = new_leaf->prefix_lens_[i] <= first_shared;
+    }
+    if (first_key_is_prefix) {
+      new_leaf->SetPrefix(first_key, arena_.get());
+    } else {
+      new_leaf->prefix_ = node->prefix_;
+    }
+
     // Truncate the left node to remove the keys which have been
     // moved to the right node.
     node->SetSplitting();
@@ -1486,7 +1611,8 @@ class CBTree {
 
     // Insert the key that we were originally trying to insert in the
     // correct side post-split.
-    Slice split_key = new_leaf->GetKey(0);
+    faststring split_key_buf;
+    Slice split_key = new_leaf->GetKey(0, &split_key_buf);
     LeafNode<Traits> *dst_leaf = (key.compare(split_key) < 0) ? node : new_leaf;
     // Re-prepare the mutation after the split.
     dst_leaf->PrepareMutation(mutation);
@@ -1649,13 +1775,14 @@ class CBTreeIterator {
   void GetCurrentEntry(Slice *key, Slice *val) const {
     DCHECK(seeked_);
     ValueSlice val_slice;
-    leaf_to_scan_->Get(idx_in_leaf_, key, &val_slice);
+    leaf_to_scan_->Get(idx_in_leaf_, key, &val_slice, &key_buf_);
     *val = val_slice.as_slice();
   }
 
+  // The keys returned by the iterator are valid until it's next asked for one.
   Slice GetCurrentKey() const {
     DCHECK(seeked_);
-    return leaf_to_scan_->GetKey(idx_in_leaf_);
+    return leaf_to_scan_->GetKey(idx_in_leaf_, &key_buf_);
   }
 
 
@@ -1706,14 +1833,16 @@ class CBTreeIterator {
   // Get the key at a specific leaf node
   Slice GetKeyInLeaf(size_t idx) const {
     DCHECK(seeked_);
-    return leaf_to_scan_->GetKey(idx);
+    return leaf_to_scan_->GetKey(idx, &key_buf_);
   }
 
   // Get the given indexed entry in the current leaf node.
   void GetEntryInLeaf(size_t idx, Slice *key, Slice *val) {
     DCHECK(seeked_);
     DCHECK_LT(idx, leaf_to_scan_->num_entries());
-    leaf_to_scan_->Get(idx, key, val);
+    ValueSlice val_slice;
+    leaf_to_scan_->Get(idx, key, &val_slice, &key_buf_);
+    *val = val_slice.as_slice();
   }
 
  private:
@@ -1855,6 +1984,9 @@ class CBTreeIterator {
 
   LeafNode<Traits> leaf_copy_;
   LeafNode<Traits> *leaf_to_scan_;
+
+  // Where the keys sharing bytes with the prefix of their leaf are assembled.
+  mutable faststring key_buf_;
 };
 
 } // namespace btree
@@ -30,6 +30,7 @@
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace.h"
 
 using std::shared_ptr;
 using std::string;
@@ -43,6 +44,10 @@ struct IteratorStats;
 
 namespace tablet {
 
+// Trace metric of the time spent selecting and applying the deltas of the
+// base data's rows.
+const char* SCAN_DELTA_APPLY_US_METRIC_NAME = "scan_delta_apply_us";
+
   // Construct. The base_iter and delta_iter should not be Initted.
 DeltaApplier::DeltaApplier(RowIteratorOptions opts,
                            shared_ptr<CFileSet::Iterator> base_iter,
@@ -89,6 +94,7 @@ Status DeltaApplier::PrepareBatch(size_t *nrows) {
   // because it requires a loaded delta file, and we don't want to require
   // that at Init() time.
   if (first_prepare_) {
+    TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_DELTA_APPLY_US_METRIC_NAME);
     RETURN_NOT_OK(delta_iter_->SeekToOrdinal(base_iter_->cur_ordinal_idx()));
     first_prepare_ = false;
   }
@@ -98,6 +104,7 @@ Status DeltaApplier::PrepareBatch(size_t *nrows) {
     // See InitializeSelectionVector() below.
     prepare_flags |= DeltaIterator::PREPARE_FOR_SELECT;
   }
+  TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_DELTA_APPLY_US_METRIC_NAME);
   RETURN_NOT_OK(delta_iter_->PrepareBatch(*nrows, prepare_flags));
   return Status::OK();
 }
@@ -116,6 +123,7 @@ Status DeltaApplier::InitializeSelectionVector(SelectionVector *sel_vec) {
   //
   // See delta_relevancy.h for more details.
   if (opts_.snap_to_exclude) {
+    TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_DELTA_APPLY_US_METRIC_NAME);
     SelectedDeltas deltas(sel_vec->nrows());
     RETURN_NOT_OK(delta_iter_->SelectDeltas(&deltas));
     VLOG(4) << "Final deltas:\n" << deltas.ToString();
@@ -124,6 +132,7 @@ Status DeltaApplier::InitializeSelectionVector(SelectionVector *sel_vec) {
     RETURN_NOT_OK(base_iter_->InitializeSelectionVector(sel_vec));
   }
   if (!opts_.include_deleted_rows) {
+    TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_DELTA_APPLY_US_METRIC_NAME);
     RETURN_NOT_OK(delta_iter_->ApplyDeletes(sel_vec));
   }
   return Status::OK();
@@ -135,6 +144,7 @@ Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   if (delta_iter_->MayHaveDeltas()) {
     ctx->SetDecoderEvalNotSupported();
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
+    TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_DELTA_APPLY_US_METRIC_NAME);
     RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block(), *ctx->sel()));
   } else {
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
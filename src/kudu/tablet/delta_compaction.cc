@@ -17,15 +17,19 @@
 
 #include "kudu/tablet/delta_compaction.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <iterator>
 #include <map>
 #include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
@@ -36,12 +40,15 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/compaction.h"
+#include "kudu/tablet/delta_iterator_merger.h"
 #include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/delta_tracker.h"
@@ -50,9 +57,21 @@
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(tablet_major_delta_compaction_num_column_groups, 1,
+             "Number of groups into which the columns rewritten by a major delta "
+             "compaction are split. The groups, of about the same size of base "
+             "data, are rewritten concurrently, each with its own UNDO delta "
+             "file, and the result is committed once.");
+DEFINE_validator(tablet_major_delta_compaction_num_column_groups,
+                 [](const char* /*n*/, int32_t v) { return v >= 1; });
+TAG_FLAG(tablet_major_delta_compaction_num_column_groups, experimental);
+TAG_FLAG(tablet_major_delta_compaction_num_column_groups, runtime);
+
 using kudu::fs::BlockCreationTransaction;
 using kudu::fs::BlockManager;
 using kudu::fs::CreateBlockOptions;
@@ -91,6 +110,7 @@ MajorDeltaCompaction::MajorDeltaCompaction(
       tablet_id_(std::move(tablet_id)),
       redo_delta_mutations_written_(0),
       undo_delta_mutations_written_(0),
+      write_redos_(true),
       state_(kInitialized) {
   CHECK(!column_ids_.empty());
 }
@@ -204,6 +224,11 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
     // 4) Write the new base data.
     RETURN_NOT_OK(base_data_writer_->AppendBlock(block));
 
+    nrows += n;
+    if (!write_redos_) {
+      continue;
+    }
+
     // 5) Remove the columns that we've done our major REDO delta compaction on
     //    from this delta flush, except keep all the delete and reinsert
     //    mutations.
@@ -228,7 +253,6 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas(const IOContext* io_context) {
                   "Failed to update stats");
     }
     redo_delta_mutations_written_ += out.size();
-    nrows += n;
   }
 
   BlockManager* bm = fs_manager_->block_manager();
@@ -319,11 +343,88 @@ DeltaStoreStats ComputeDeltaStoreStats(const SharedDeltaStoreVector& stores) {
 }
 } // anonymous namespace
 
+vector<vector<ColumnId>> MajorDeltaCompaction::SplitIntoColumnGroups(int max_groups) const {
+  // Only the columns of the schema are rewritten: the deleted ones, whose
+  // base data is only removed, stay with the first group.
+  vector<ColumnId> deleted_ids;
+  vector<std::pair<uint64_t, ColumnId>> columns_by_size;
+  for (ColumnId col_id : column_ids_) {
+    if (base_schema_.find_column_by_id(col_id) == Schema::kColumnNotFound) {
+      deleted_ids.push_back(col_id);
+      continue;
+    }
+    const uint64_t size = base_data_->has_data_for_column_id(col_id) ?
+        base_data_->OnDiskColumnDataSize(col_id) : 0;
+    columns_by_size.emplace_back(size, col_id);
+  }
+  const int num_groups = std::min<int>(max_groups, columns_by_size.size());
+  if (num_groups <= 1) {
+    return { column_ids_ };
+  }
+
+  // Each column, largest first, goes to the group with the least data so far.
+  std::sort(columns_by_size.begin(), columns_by_size.end(),
+            [](const std::pair<uint64_t, ColumnId>& a, const std::pair<uint64_t, ColumnId>& b) {
+              return a.first > b.first;
+            });
+  vector<vector<ColumnId>> groups(num_groups);
+  vector<uint64_t> group_sizes(num_groups, 0);
+  for (const auto& column : columns_by_size) {
+    const int group = std::min_element(group_sizes.begin(), group_sizes.end()) -
+                      group_sizes.begin();
+    groups[group].push_back(column.second);
+    group_sizes[group] += column.first;
+  }
+  groups[0].insert(groups[0].end(), deleted_ids.begin(), deleted_ids.end());
+  return groups;
+}
+
+Status MajorDeltaCompaction::FlushColumnGroups(const IOContext* io_context) {
+  // Each other column group is compacted by its own thread, with the IO
+  // priority of the compaction.
+  unique_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("delta-compact-cols")
+                .set_max_threads(column_groups_.size())
+                .Build(&pool));
+  vector<Status> statuses(column_groups_.size());
+  const fs::IOPriority io_priority = fs::ScopedIOPriority::Current();
+  for (size_t i = 0; i < column_groups_.size(); i++) {
+    Status s = pool->Submit([&, i]() {
+      fs::ScopedIOPriority scoped_io_priority(io_priority);
+      statuses[i] = column_groups_[i]->FlushRowSetAndDeltas(io_context);
+    });
+    if (!s.ok()) {
+      pool->Wait();
+      return s;
+    }
+  }
+  Status s = FlushRowSetAndDeltas(io_context);
+  pool->Wait();
+  RETURN_NOT_OK(s);
+  for (const auto& group_status : statuses) {
+    RETURN_NOT_OK(group_status);
+  }
+  return Status::OK();
+}
+
 Status MajorDeltaCompaction::Compact(const IOContext* io_context) {
   CHECK_EQ(state_, kInitialized);
 
   VLOG(1) << "Starting major delta compaction for columns " << ColumnNamesToString();
-  RETURN_NOT_OK(base_schema_.CreateProjectionByIdsIgnoreMissing(column_ids_, &partial_schema_));
+  // The UNDOs of the deletes and reinserts of a row would be written once per
+  // column group, so the deltas to compact must have none for the columns to
+  // be split.
+  bool may_split = true;
+  for (const auto& store : included_stores_) {
+    if (!store->has_delta_stats() || store->delta_stats().delete_count() > 0 ||
+        store->delta_stats().reinsert_count() > 0) {
+      may_split = false;
+      break;
+    }
+  }
+  vector<vector<ColumnId>> groups = SplitIntoColumnGroups(
+      may_split ? FLAGS_tablet_major_delta_compaction_num_column_groups : 1);
+  RETURN_NOT_OK(base_schema_.CreateProjectionByIdsIgnoreMissing(groups[0], &partial_schema_));
 
   if (VLOG_IS_ON(1)) {
     for (const auto& ds : included_stores_) {
@@ -331,9 +432,33 @@ Status MajorDeltaCompaction::Compact(const IOContext* io_context) {
     }
   }
 
+  // The other column groups are compacted by compactions of their own, with
+  // their own view of the deltas, which write no REDO deltas: this one writes
+  // back those of the columns of none of the groups.
+  for (int i = 1; i < groups.size(); i++) {
+    RowIteratorOptions opts;
+    opts.projection = &base_schema_;
+    opts.io_context = io_context;
+    unique_ptr<DeltaIterator> delta_iter;
+    RETURN_NOT_OK(DeltaIteratorMerger::Create(included_stores_, opts, &delta_iter));
+    unique_ptr<MajorDeltaCompaction> group(new MajorDeltaCompaction(
+        fs_manager_, base_schema_, base_data_, std::move(delta_iter), {}, groups[i],
+        history_gc_opts_, tablet_id_));
+    group->write_redos_ = false;
+    RETURN_NOT_OK(base_schema_.CreateProjectionByIdsIgnoreMissing(
+        group->column_ids_, &group->partial_schema_));
+    RETURN_NOT_OK(group->OpenBaseDataWriter());
+    column_groups_.emplace_back(std::move(group));
+  }
+
   // We defer calling OpenRedoDeltaFileWriter() since we might not need to flush.
   RETURN_NOT_OK(OpenBaseDataWriter());
-  RETURN_NOT_OK(FlushRowSetAndDeltas(io_context));
+  if (column_groups_.empty()) {
+    RETURN_NOT_OK(FlushRowSetAndDeltas(io_context));
+  } else {
+    VLOG(1) << Substitute("Compacting $0 column groups concurrently", groups.size());
+    RETURN_NOT_OK(FlushColumnGroups(io_context));
+  }
 
   TRACE_COUNTER_INCREMENT("delta_blocks_compacted", included_stores_.size());
   const auto stats = ComputeDeltaStoreStats(included_stores_);
@@ -368,18 +493,44 @@ void MajorDeltaCompaction::CreateMetadataUpdate(
                                  new_delta_blocks);
 
   if (undo_delta_mutations_written_ > 0) {
-    update->SetNewUndoBlock(new_undo_delta_block_);
+    update->AddNewUndoBlock(new_undo_delta_block_);
+  }
+  for (const auto& group : column_groups_) {
+    CHECK_EQ(group->state_, kFinished);
+    if (group->undo_delta_mutations_written_ > 0) {
+      update->AddNewUndoBlock(group->new_undo_delta_block_);
+    }
   }
 
   // Replace old column blocks with new ones
   std::map<ColumnId, BlockId> new_column_blocks;
   base_data_writer_->GetFlushedBlocksByColumnId(&new_column_blocks);
+  for (const auto& group : column_groups_) {
+    std::map<ColumnId, BlockId> group_column_blocks;
+    group->base_data_writer_->GetFlushedBlocksByColumnId(&group_column_blocks);
+    new_column_blocks.insert(group_column_blocks.begin(), group_column_blocks.end());
+  }
 
   // NOTE: in the case that one of the columns being compacted is deleted,
   // we may have fewer elements in new_column_blocks compared to 'column_ids'.
   // For those deleted columns, we just remove the old column data.
   CHECK_LE(new_column_blocks.size(), column_ids_.size());
 
+  // The statistics of the rewritten columns are replaced along with them.
+  vector<ColumnStatisticsPB> new_column_stats;
+  base_data_writer_->GetColumnStatistics(&new_column_stats);
+  for (const auto& group : column_groups_) {
+    vector<ColumnStatisticsPB> group_column_stats;
+    group->base_data_writer_->GetColumnStatistics(&group_column_stats);
+    std::move(group_column_stats.begin(), group_column_stats.end(),
+              std::back_inserter(new_column_stats));
+  }
+  for (ColumnStatisticsPB& stats : new_column_stats) {
+    if (ContainsKey(new_column_blocks, ColumnId(stats.column_id()))) {
+      update->SetColumnStatistics(std::move(stats));
+    }
+  }
+
   for (ColumnId col_id : column_ids_) {
     BlockId new_block;
     if (FindCopy(new_column_blocks, col_id, &new_block)) {
@@ -423,12 +574,21 @@ Status MajorDeltaCompaction::UpdateDeltaTracker(DeltaTracker* tracker,
   RETURN_NOT_OK(tracker->OpenDeltaReaders(std::move(new_redo_blocks), io_context,
                                           &new_redo_stores, REDO));
 
-  // Create blocks for the new undo deltas.
+  // Create blocks for the new undo deltas, in the order of the metadata
+  // update.
   SharedDeltaStoreVector new_undo_stores;
+  vector<DeltaBlockIdAndStats> new_undo_blocks;
   if (undo_delta_mutations_written_ > 0) {
-    vector<DeltaBlockIdAndStats> new_undo_blocks;
     new_undo_blocks.emplace_back(std::make_pair(new_undo_delta_block_,
         new_undo_delta_writer_->release_delta_stats()));
+  }
+  for (const auto& group : column_groups_) {
+    if (group->undo_delta_mutations_written_ > 0) {
+      new_undo_blocks.emplace_back(std::make_pair(group->new_undo_delta_block_,
+          group->new_undo_delta_writer_->release_delta_stats()));
+    }
+  }
+  if (!new_undo_blocks.empty()) {
     RETURN_NOT_OK(tracker->OpenDeltaReaders(std::move(new_undo_blocks), io_context,
                                             &new_undo_stores, UNDO));
   }
@@ -47,6 +47,11 @@ class RowSetMetadataUpdate;
 // of a DiskRowSet, writing out an updated DiskRowSet without re-writing the
 // unchanged columns (see RowSetColumnUpdater), and writing out a new
 // deltafile which does not contain the deltas applied to the specific rows.
+//
+// The columns may be split into groups (see
+// --tablet_major_delta_compaction_num_column_groups) rewritten concurrently,
+// each with its own UNDO delta file. The REDO deltas which aren't compacted
+// are written back once, along with the first group.
 class MajorDeltaCompaction {
  public:
   // Creates a new major delta compaction. The given 'base_data' should already
@@ -97,6 +102,14 @@ class MajorDeltaCompaction {
   // deltas need to be written back into a delta file.
   Status FlushRowSetAndDeltas(const fs::IOContext* io_context);
 
+  // Splits the columns to compact into at most 'max_groups' groups of about
+  // the same size of base data.
+  std::vector<std::vector<ColumnId>> SplitIntoColumnGroups(int max_groups) const;
+
+  // Runs FlushRowSetAndDeltas() for this compaction and those of
+  // 'column_groups_' concurrently.
+  Status FlushColumnGroups(const fs::IOContext* io_context);
+
   FsManager* const fs_manager_;
 
   // TODO: doc me
@@ -106,9 +119,13 @@ class MajorDeltaCompaction {
   // compacted.
   Schema partial_schema_;
 
-  // The column ids to compact.
+  // The column ids to compact, of all the column groups.
   const std::vector<ColumnId> column_ids_;
 
+  // The compactions of the column groups other than this one's, which write
+  // no REDO deltas.
+  std::vector<std::unique_ptr<MajorDeltaCompaction>> column_groups_;
+
   const HistoryGcOpts history_gc_opts_;
 
   // Inputs:
@@ -138,6 +155,9 @@ class MajorDeltaCompaction {
   size_t redo_delta_mutations_written_;
   size_t undo_delta_mutations_written_;
 
+  // Whether the REDO deltas which aren't compacted are written back.
+  bool write_redos_;
+
   enum State {
     kInitialized = 1,
     kFinished = 2,
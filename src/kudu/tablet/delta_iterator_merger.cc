@@ -158,7 +158,8 @@ string DeltaIteratorMerger::ToString() const {
 Status DeltaIteratorMerger::Create(
     const vector<shared_ptr<DeltaStore> > &stores,
     const RowIteratorOptions& opts,
-    unique_ptr<DeltaIterator>* out) {
+    unique_ptr<DeltaIterator>* out,
+    int* num_relevant_stores) {
   vector<unique_ptr<DeltaIterator> > delta_iters;
 
   for (const shared_ptr<DeltaStore> &store : stores) {
@@ -173,6 +174,9 @@ Status DeltaIteratorMerger::Create(
     delta_iters.emplace_back(std::move(iter));
   }
 
+  if (num_relevant_stores) {
+    *num_relevant_stores = delta_iters.size();
+  }
   if (delta_iters.size() == 1) {
     // If we only have one input to the "merge", we can just directly
     // return that iterator.
@@ -54,10 +54,14 @@ class DeltaIteratorMerger : public DeltaIterator {
   //
   // If only one store is input, this will automatically return an unwrapped
   // iterator for greater efficiency.
+  //
+  // If 'num_relevant_stores' isn't null, it's set to the number of stores
+  // which may have deltas relevant to 'opts'.
   static Status Create(
       const std::vector<std::shared_ptr<DeltaStore>> &stores,
       const RowIteratorOptions& opts,
-      std::unique_ptr<DeltaIterator>* out);
+      std::unique_ptr<DeltaIterator>* out,
+      int* num_relevant_stores = nullptr);
 
   ////////////////////////////////////////////////////////////
   // Implementations of DeltaIterator
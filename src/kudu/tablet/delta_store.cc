@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <ostream>
 
 #include <glog/logging.h>
@@ -34,6 +35,7 @@
 #include "kudu/common/types.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/fastmem.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -42,6 +44,7 @@
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
@@ -147,6 +150,13 @@ void SelectedDeltas::ProcessDelta(rowid_t row_idx, Delta new_delta) {
   existing->same_delta = false;
 }
 
+void SelectedDeltas::ProcessRangeDelete(rowid_t row_idx, Timestamp ts,
+                                        int64_t disambiguator) {
+  // The tombstones come after any REDO of the same timestamp.
+  ProcessDelta(row_idx, { ts, REDO, std::numeric_limits<int64_t>::max() / 2 + disambiguator,
+                          RowChangeList::kDelete });
+}
+
 string SelectedDeltas::ToString() const {
   rowid_t idx = 0;
   return JoinMapped(rows_, [&idx](const boost::optional<DeltaPair>& dp) {
@@ -202,22 +212,22 @@ void DeltaPreparer<Traits>::Start(size_t nrows, int prepare_flags) {
     updates_by_col_.resize(opts_.projection->num_columns());
   }
 
-  // Lazy initialization.
+  // Lazy initialization. Deletes don't necessarily set 'may_have_deltas_', so
+  // 'deleted_' is always cleared.
   if (may_have_deltas_) {
     for (UpdatesForColumn &ufc : updates_by_col_) {
       ufc.clear();
     }
-    deleted_.clear();
     reinserted_.clear();
   } else {
 #ifndef NDEBUG
-    CHECK(deleted_.empty());
     CHECK(reinserted_.empty());
     for (const UpdatesForColumn& ufc : updates_by_col_) {
       CHECK(ufc.empty());
     }
 #endif
   }
+  deleted_.clear();
   prepared_deltas_.clear();
   deletion_state_ = UNKNOWN;
   may_have_deltas_ = false;
@@ -320,13 +330,9 @@ Status DeltaPreparer<Traits>::AddDelta(const DeltaKey& key, Slice val, bool* fin
 
         ColumnUpdate& cu = updates_by_col_[col_idx].back();
         cu.row_id = key.row_idx();
-        if (col_val == nullptr) {
-          cu.new_val_ptr = nullptr;
-        } else {
+        cu.is_null = col_val == nullptr;
+        if (!cu.is_null) {
           memcpy(cu.new_val_buf, col_val, col_size);
-          // NOTE: we're constructing a pointer here to an element inside the deque.
-          // This is safe because deques never invalidate pointers to their elements.
-          cu.new_val_ptr = cu.new_val_buf;
         }
         may_have_deltas_ = true;
       }
@@ -381,16 +387,45 @@ Status DeltaPreparer<Traits>::ApplyUpdates(size_t col_to_apply, ColumnBlock* dst
     return Status::OK();
   }
 
+  const UpdatesForColumn& updates = updates_by_col_[col_to_apply];
+  if (updates.empty()) {
+    return Status::OK();
+  }
   const ColumnSchema* col_schema = &opts_.projection->column(col_to_apply);
-  for (const ColumnUpdate& cu : updates_by_col_[col_to_apply]) {
+
+  // BINARY values must be relocated into the block's arena, cell by cell.
+  if (col_schema->type_info()->physical_type() == BINARY) {
+    for (const ColumnUpdate& cu : updates) {
+      int32_t idx_in_block = cu.row_id - prev_prepared_idx_;
+      DCHECK_GE(idx_in_block, 0);
+      if (!filter.IsRowSelected(idx_in_block)) {
+        continue;
+      }
+      SimpleConstCell src(col_schema, cu.is_null ? nullptr : cu.new_val_buf);
+      ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
+      RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+    }
+    return Status::OK();
+  }
+
+  // Fixed-size values are patched straight into the block's data and null
+  // bitmap, without dispatching on the type of each cell.
+  const size_t size = col_schema->type_info()->size();
+  uint8_t* data = dst->data();
+  uint8_t* non_null_bitmap = dst->non_null_bitmap();
+  for (const ColumnUpdate& cu : updates) {
     int32_t idx_in_block = cu.row_id - prev_prepared_idx_;
     DCHECK_GE(idx_in_block, 0);
+    DCHECK_LT(idx_in_block, dst->nrows());
     if (!filter.IsRowSelected(idx_in_block)) {
       continue;
     }
-    SimpleConstCell src(col_schema, cu.new_val_ptr);
-    ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
-    RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
+    if (non_null_bitmap) {
+      BitmapChange(non_null_bitmap, idx_in_block, !cu.is_null);
+    }
+    if (!cu.is_null) {
+      strings::memcpy_inlined(data + idx_in_block * size, cu.new_val_buf, size);
+    }
   }
 
   return Status::OK();
@@ -407,17 +442,29 @@ Status DeltaPreparer<Traits>::ApplyDeletes(SelectionVector* sel_vec) {
   // delete a row and for the next to reinsert it. Given that ApplyDeletes is
   // called on each DeltaPreparer in order, we must "twiddle" sel_vec in either
   // direction in order for the row's bit to hold the correct state at the end.
-  for (const auto& row_id : deleted_) {
-    uint32_t idx_in_block = row_id - prev_prepared_idx_;
-    sel_vec->SetRowUnselected(idx_in_block);
-  }
+  ChangeSelectedRows(deleted_, false, sel_vec);
+  ChangeSelectedRows(reinserted_, true, sel_vec);
+  return Status::OK();
+}
 
-  for (const auto& row_id : reinserted_) {
-    uint32_t idx_in_block = row_id - prev_prepared_idx_;
-    sel_vec->SetRowSelected(idx_in_block);
+template<class Traits>
+void DeltaPreparer<Traits>::ChangeSelectedRows(const vector<rowid_t>& row_ids,
+                                               bool selected,
+                                               SelectionVector* sel_vec) const {
+  // The row IDs are in ascending order, and bulk deletes produce long runs of
+  // consecutive rows, which are changed a word at a time.
+  uint8_t* bitmap = sel_vec->mutable_bitmap();
+  size_t i = 0;
+  while (i < row_ids.size()) {
+    size_t run_end = i + 1;
+    while (run_end < row_ids.size() && row_ids[run_end] == row_ids[run_end - 1] + 1) {
+      run_end++;
+    }
+    const uint32_t idx_in_block = row_ids[i] - prev_prepared_idx_;
+    DCHECK_LE(idx_in_block + run_end - i, sel_vec->nrows());
+    BitmapChangeBits(bitmap, idx_in_block, run_end - i, selected);
+    i = run_end;
   }
-
-  return Status::OK();
 }
 
 template<class Traits>
@@ -515,7 +562,14 @@ void DeltaPreparer<Traits>::MaybeProcessPreviousRowChange(boost::optional<rowid_
       case DELETED:
         deleted_.emplace_back(*last_added_idx_);
         deletion_state_ = UNKNOWN;
-        may_have_deltas_ = true;
+        // Deletes are applied to the selection vector before any column is
+        // materialized, so they only need to be applied to the column data
+        // if the IS_DELETED virtual column is projected. Otherwise, the
+        // predicates may still be evaluated by the column decoders.
+        if (opts_.projection->first_is_deleted_virtual_column_idx() !=
+            Schema::kColumnNotFound) {
+          may_have_deltas_ = true;
+        }
         break;
       case REINSERTED:
         reinserted_.emplace_back(*last_added_idx_);
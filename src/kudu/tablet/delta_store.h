@@ -18,7 +18,6 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -78,6 +77,11 @@ class SelectedDeltas {
   // Returns a textual representation suitable for debugging.
   std::string ToString() const;
 
+  // Considers a DELETE of the row 'row_idx' at 'ts' by a range tombstone,
+  // which comes after the REDOs of the row. 'disambiguator' orders the
+  // tombstones of the same timestamp.
+  void ProcessRangeDelete(rowid_t row_idx, Timestamp ts, int64_t disambiguator);
+
  private:
   template<class Traits>
   friend class DeltaPreparer;
@@ -308,6 +312,9 @@ class PreparedDeltas {
   // conservatively return true, but this would force a skip over decoder-level
   // evaluation.
   //
+  // DELETEs don't count unless the IS_DELETED virtual column is projected:
+  // they are applied by ApplyDeletes() instead.
+  //
   // Deltas must have been prepared with the flag PREPARE_FOR_APPLY.
   virtual bool MayHaveDeltas() const = 0;
 };
@@ -497,6 +504,11 @@ class DeltaPreparer : public PreparedDeltas {
   // Update the deletion state of the current row being processed based on 'op'.
   void UpdateDeletionState(RowChangeList::ChangeType op);
 
+  // Sets the bits of the rows in 'row_ids' in 'sel_vec' to 'selected'.
+  void ChangeSelectedRows(const std::vector<rowid_t>& row_ids,
+                          bool selected,
+                          SelectionVector* sel_vec) const;
+
   // Options with which the DeltaPreparer's iterator was constructed.
   const RowIteratorOptions opts_;
 
@@ -514,12 +526,23 @@ class DeltaPreparer : public PreparedDeltas {
 
   // State when prepared_flags_ & PREPARED_FOR_APPLY
   // ------------------------------------------------------------
+  //
+  // The updates of each column form a contiguous run of (row, value) pairs
+  // sorted by row, which ApplyUpdates() patches into a ColumnBlock in a single
+  // pass.
+  //
+  // NOTE: the runs are only columnar in memory. The delta stores hold
+  // RowChangeLists, each of which AddDelta() still decodes on every scan, so
+  // scans of rowsets with many updates keep paying for them until a major
+  // delta compaction.
   struct ColumnUpdate {
     rowid_t row_id;
-    void* new_val_ptr;
+    bool is_null;
+    // The new value in its in-memory format. For BINARY columns, this is a
+    // Slice pointing into the delta's encoded changes.
     uint8_t new_val_buf[16];
   };
-  typedef std::deque<ColumnUpdate> UpdatesForColumn;
+  typedef std::vector<ColumnUpdate> UpdatesForColumn;
   std::vector<UpdatesForColumn> updates_by_col_;
 
   // A row whose last relevant mutation was DELETE (or REINSERT).
@@ -30,7 +30,10 @@
 #include <glog/logging.h>
 
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/row_changelist.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
@@ -47,11 +50,15 @@
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/deltamemstore.h"
+#include "kudu/tablet/mutation.h"
+#include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
@@ -75,6 +82,174 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+typedef RowSetMetadata::RangeTombstone RangeTombstone;
+
+namespace {
+
+// Applies range tombstones on top of the deltas of another iterator: the rows
+// of the tombstones are deleted, as if each had a DELETE delta at the
+// timestamp of its tombstone.
+//
+// Range deletes only ever come last in the history of their rows, since the
+// rows can't be mutated once deleted.
+class RangeTombstoneIterator : public DeltaIterator {
+ public:
+  // 'tombstones' are those applied in the snapshot of the scan, and must not
+  // be empty. 'selectable' are those which diff scans select, i.e. which
+  // aren't applied in the snapshot they exclude.
+  RangeTombstoneIterator(unique_ptr<DeltaIterator> inner,
+                         vector<RangeTombstone> tombstones,
+                         vector<RangeTombstone> selectable,
+                         int is_deleted_col_idx)
+      : inner_(std::move(inner)),
+        tombstones_(std::move(tombstones)),
+        selectable_(std::move(selectable)),
+        is_deleted_col_idx_(is_deleted_col_idx),
+        prev_prepared_idx_(0),
+        cur_prepared_idx_(0) {
+    DCHECK(!tombstones_.empty());
+    // Oldest first, so that rows deleted by several ranges get the DELETE of
+    // the first one.
+    for (auto* v : { &tombstones_, &selectable_ }) {
+      std::sort(v->begin(), v->end(),
+                [](const RangeTombstone& a, const RangeTombstone& b) {
+                  return a.timestamp < b.timestamp;
+                });
+    }
+  }
+
+  Status Init(ScanSpec* spec) override {
+    return inner_->Init(spec);
+  }
+
+  Status SeekToOrdinal(rowid_t idx) override {
+    prev_prepared_idx_ = idx;
+    cur_prepared_idx_ = idx;
+    return inner_->SeekToOrdinal(idx);
+  }
+
+  Status PrepareBatch(size_t nrows, int prepare_flags) override {
+    RETURN_NOT_OK(inner_->PrepareBatch(nrows, prepare_flags));
+    prev_prepared_idx_ = cur_prepared_idx_;
+    cur_prepared_idx_ += nrows;
+    return Status::OK();
+  }
+
+  Status ApplyUpdates(size_t col_to_apply, ColumnBlock* dst,
+                      const SelectionVector& filter) override {
+    RETURN_NOT_OK(inner_->ApplyUpdates(col_to_apply, dst, filter));
+    if (col_to_apply == is_deleted_col_idx_) {
+      ForEachMaskedRange([&](const RangeTombstone& /*t*/, size_t offset, size_t nrows) {
+        for (size_t i = offset; i < offset + nrows; i++) {
+          if (filter.IsRowSelected(i)) {
+            UnalignedStore(dst->cell(i).mutable_ptr(), true);
+          }
+        }
+      });
+    }
+    return Status::OK();
+  }
+
+  Status ApplyDeletes(SelectionVector* sel_vec) override {
+    RETURN_NOT_OK(inner_->ApplyDeletes(sel_vec));
+    ForEachMaskedRange([&](const RangeTombstone& /*t*/, size_t offset, size_t nrows) {
+      BitmapChangeBits(sel_vec->mutable_bitmap(), offset, nrows, false);
+    });
+    return Status::OK();
+  }
+
+  // The rows of the tombstones are selected as if they had a REDO DELETE, so
+  // that diff scans report them as deleted.
+  Status SelectDeltas(SelectedDeltas* deltas) override {
+    RETURN_NOT_OK(inner_->SelectDeltas(deltas));
+    for (size_t i = 0; i < selectable_.size(); i++) {
+      const auto& t = selectable_[i];
+      const rowid_t first = std::max(t.first_row, prev_prepared_idx_);
+      const rowid_t last = std::min(t.last_row, cur_prepared_idx_);
+      for (rowid_t row = first; row < last; row++) {
+        deltas->ProcessRangeDelete(row - prev_prepared_idx_, t.timestamp, i);
+      }
+    }
+    return Status::OK();
+  }
+
+  Status CollectMutations(vector<Mutation*>* dst, Arena* arena) override {
+    RETURN_NOT_OK(inner_->CollectMutations(dst, arena));
+    const RowChangeList delete_rcl = RowChangeList::CreateDelete();
+    ForEachMaskedRange([&](const RangeTombstone& t, size_t offset, size_t nrows) {
+      for (size_t i = offset; i < offset + nrows; i++) {
+        // The lists are newest first.
+        Mutation** head = &(*dst)[i];
+        if (*head && (*head)->changelist().is_delete()) {
+          continue;
+        }
+        Mutation::CreateInArena(arena, t.timestamp, delete_rcl)->PrependToList(head);
+      }
+    });
+    return Status::OK();
+  }
+
+  Status FilterColumnIdsAndCollectDeltas(const vector<ColumnId>& col_ids,
+                                         vector<DeltaKeyAndUpdate>* out,
+                                         Arena* arena) override {
+    return inner_->FilterColumnIdsAndCollectDeltas(col_ids, out, arena);
+  }
+
+  bool MayHaveDeltas() const override {
+    if (inner_->MayHaveDeltas()) {
+      return true;
+    }
+    // The deletes are applied by ApplyDeletes(), unless IS_DELETED is projected.
+    if (is_deleted_col_idx_ == Schema::kColumnNotFound) {
+      return false;
+    }
+    bool may_have = false;
+    ForEachMaskedRange([&](const RangeTombstone& /*t*/, size_t /*offset*/, size_t /*nrows*/) {
+      may_have = true;
+    });
+    return may_have;
+  }
+
+  bool HasNext() override {
+    return inner_->HasNext();
+  }
+
+  string ToString() const override {
+    return Substitute("RangeTombstoneIterator($0)", inner_->ToString());
+  }
+
+  int64_t deltas_selected() const override {
+    return inner_->deltas_selected();
+  }
+
+  void set_deltas_selected(int64_t deltas_selected) override {
+    inner_->set_deltas_selected(deltas_selected);
+  }
+
+ private:
+  // Calls 'f' with each tombstone intersecting the prepared batch, along with
+  // the offset and the number of the rows of the batch it deletes.
+  template<class F>
+  void ForEachMaskedRange(const F& f) const {
+    for (const auto& t : tombstones_) {
+      const rowid_t first = std::max(t.first_row, prev_prepared_idx_);
+      const rowid_t last = std::min(t.last_row, cur_prepared_idx_);
+      if (first < last) {
+        f(t, first - prev_prepared_idx_, last - first);
+      }
+    }
+  }
+
+  const unique_ptr<DeltaIterator> inner_;
+  vector<RangeTombstone> tombstones_;
+  vector<RangeTombstone> selectable_;
+  const int is_deleted_col_idx_;
+  rowid_t prev_prepared_idx_;
+  rowid_t cur_prepared_idx_;
+};
+
+} // anonymous namespace
+
 Status DeltaTracker::Open(const shared_ptr<RowSetMetadata>& rowset_metadata,
                           LogAnchorRegistry* log_anchor_registry,
                           const TabletMemTrackers& mem_trackers,
@@ -164,6 +339,7 @@ Status DeltaTracker::DoOpen(const IOContext* io_context) {
                                  io_context,
                                  &undo_delta_stores_,
                                  UNDO));
+  range_tombstones_ = rowset_metadata_->range_tombstones();
 
   open_ = true;
   return Status::OK();
@@ -481,6 +657,88 @@ bool DeltaTracker::EstimateAllRedosAreAncient(Timestamp ancient_history_mark) {
       newest_redo->delta_stats().max_timestamp() < ancient_history_mark;
 }
 
+bool DeltaTracker::MayHaveRedosChangingColumn(ColumnId col_id) const {
+  std::lock_guard<rw_spinlock> lock(component_lock_);
+  for (const auto& store : redo_delta_stores_) {
+    if (!store->has_delta_stats() ||
+        store->delta_stats().update_count_for_col_id(col_id) > 0 ||
+        store->delta_stats().reinsert_count() > 0) {
+      return true;
+    }
+  }
+  // The DMS doesn't keep stats: any mutation other than a delete may change
+  // the column.
+  return dms_ && dms_->Count() > dms_->deleted_row_count();
+}
+
+bool DeltaTracker::MayHaveDeltasBetween(const MvccSnapshot& snap_to_exclude,
+                                        const MvccSnapshot& snap_to_include) const {
+  const auto may_be_between = [&](Timestamp min_ts, Timestamp max_ts) {
+    return snap_to_include.MayHaveAppliedOpsAtOrAfter(min_ts) &&
+        snap_to_exclude.MayHaveNonAppliedOpsAtOrBefore(max_ts);
+  };
+  std::lock_guard<rw_spinlock> lock(component_lock_);
+  for (const auto& t : range_tombstones_) {
+    if (snap_to_include.IsApplied(t.timestamp) && !snap_to_exclude.IsApplied(t.timestamp)) {
+      return true;
+    }
+  }
+  for (const auto* stores : { &undo_delta_stores_, &redo_delta_stores_ }) {
+    for (const auto& store : *stores) {
+      if (!store->has_delta_stats() ||
+          may_be_between(store->delta_stats().min_timestamp(),
+                         store->delta_stats().max_timestamp())) {
+        return true;
+      }
+    }
+  }
+  // The DMS doesn't keep track of its lowest timestamp.
+  const boost::optional<Timestamp> dms_highest_timestamp =
+      dms_ ? dms_->highest_timestamp() : boost::none;
+  return dms_highest_timestamp &&
+      may_be_between(Timestamp::kMin, *dms_highest_timestamp);
+}
+
+Status DeltaTracker::MayHaveDeltasVisibleAt(const MvccSnapshot& snap,
+                                            const IOContext* io_context,
+                                            bool* may_have) const {
+  SharedDeltaStoreVector undos;
+  SharedDeltaStoreVector redos;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    // The DMS doesn't keep track of its lowest timestamp.
+    if (dms_ && !dms_->Empty()) {
+      *may_have = true;
+      return Status::OK();
+    }
+    for (const auto& t : range_tombstones_) {
+      if (snap.IsApplied(t.timestamp)) {
+        *may_have = true;
+        return Status::OK();
+      }
+    }
+    undos = undo_delta_stores_;
+    redos = redo_delta_stores_;
+  }
+  *may_have = true;
+  for (const auto& store : undos) {
+    RETURN_NOT_OK(store->Init(io_context));
+    if (!store->has_delta_stats() ||
+        snap.MayHaveNonAppliedOpsAtOrBefore(store->delta_stats().max_timestamp())) {
+      return Status::OK();
+    }
+  }
+  for (const auto& store : redos) {
+    RETURN_NOT_OK(store->Init(io_context));
+    if (!store->has_delta_stats() ||
+        snap.MayHaveAppliedOpsAtOrAfter(store->delta_stats().min_timestamp())) {
+      return Status::OK();
+    }
+  }
+  *may_have = false;
+  return Status::OK();
+}
+
 Status DeltaTracker::EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancient_history_mark,
                                                                  int64_t* bytes) {
   DCHECK_NE(Timestamp::kInvalidTimestamp, ancient_history_mark);
@@ -637,7 +895,45 @@ Status DeltaTracker::NewDeltaIterator(const RowIteratorOptions& opts,
                                       unique_ptr<DeltaIterator>* out) const {
   std::vector<shared_ptr<DeltaStore>> stores;
   CollectStores(&stores, which);
-  return DeltaIteratorMerger::Create(stores, opts, out);
+  RETURN_NOT_OK(DeltaIteratorMerger::Create(stores, opts, out));
+  // Range tombstones come after the UNDOs, like the REDOs.
+  if (which != UNDOS_ONLY) {
+    MaybeApplyRangeTombstones(opts, out);
+  }
+  return Status::OK();
+}
+
+bool DeltaTracker::MaybeApplyRangeTombstones(const RowIteratorOptions& opts,
+                                             unique_ptr<DeltaIterator>* iter) const {
+  vector<RangeTombstone> tombstones;
+  vector<RangeTombstone> selectable;
+  {
+    shared_lock<rw_spinlock> lock(component_lock_);
+    for (const auto& t : range_tombstones_) {
+      if (opts.snap_to_include.IsApplied(t.timestamp)) {
+        tombstones.push_back(t);
+        if (opts.snap_to_exclude && !opts.snap_to_exclude->IsApplied(t.timestamp)) {
+          selectable.push_back(t);
+        }
+      }
+    }
+  }
+  if (tombstones.empty()) {
+    return false;
+  }
+  iter->reset(new RangeTombstoneIterator(std::move(*iter), std::move(tombstones),
+                                         std::move(selectable),
+                                         opts.projection->first_is_deleted_virtual_column_idx()));
+  return true;
+}
+
+void DeltaTracker::AddRangeTombstone(const RangeTombstone& tombstone) {
+  rowset_metadata_->AddRangeTombstone(tombstone);
+  std::lock_guard<rw_spinlock> lock(component_lock_);
+  if (std::find(range_tombstones_.begin(), range_tombstones_.end(), tombstone) ==
+      range_tombstones_.end()) {
+    range_tombstones_.push_back(tombstone);
+  }
 }
 
 Status DeltaTracker::NewDeltaFileIterator(
@@ -672,9 +968,18 @@ Status DeltaTracker::NewDeltaFileIterator(
 Status DeltaTracker::WrapIterator(const shared_ptr<CFileSet::Iterator> &base,
                                   const RowIteratorOptions& opts,
                                   unique_ptr<ColumnwiseIterator>* out) const {
+  vector<shared_ptr<DeltaStore>> stores;
+  CollectStores(&stores, UNDOS_AND_REDOS);
   unique_ptr<DeltaIterator> iter;
-  RETURN_NOT_OK(NewDeltaIterator(opts, &iter));
-
+  int num_relevant_stores;
+  RETURN_NOT_OK(DeltaIteratorMerger::Create(stores, opts, &iter, &num_relevant_stores));
+  const bool has_tombstones = MaybeApplyRangeTombstones(opts, &iter);
+
+  // If no deltas apply to the scan, it sees exactly the base data, which the
+  // base iterator may then prune by itself.
+  if (num_relevant_stores == 0 && !has_tombstones) {
+    base->set_base_data_unchanged();
+  }
   out->reset(new DeltaApplier(opts, base, std::move(iter)));
   return Status::OK();
 }
@@ -717,6 +1022,13 @@ Status DeltaTracker::CheckRowDeleted(rowid_t row_idx, const IOContext* io_contex
                                      bool *deleted, ProbeStats* stats) const {
   shared_lock<rw_spinlock> lock(component_lock_);
 
+  for (const auto& t : range_tombstones_) {
+    if (row_idx >= t.first_row && row_idx < t.last_row) {
+      *deleted = true;
+      return Status::OK();
+    }
+  }
+
   *deleted = false;
   // Check if the row has a deletion in DeltaMemStore.
   if (dms_exists_.Load()) {
@@ -32,6 +32,7 @@
 #include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/delta_store.h"
+#include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
@@ -64,6 +65,7 @@ namespace tablet {
 
 class DeltaFileReader;
 class DeltaMemStore;
+class MvccSnapshot;
 class OperationResultPB;
 class RowSetMetadata;
 class RowSetMetadataUpdate;
@@ -146,8 +148,15 @@ class DeltaTracker {
                 const consensus::OpId& op_id,
                 OperationResultPB* result);
 
+  // Records the range delete of the rows [first_row, last_row) in the rowset
+  // metadata. The rows are deleted as far as CheckRowDeleted() and the delta
+  // iterators are concerned, though no delta is stored for them.
+  //
+  // The metadata isn't flushed.
+  void AddRangeTombstone(const RowSetMetadata::RangeTombstone& tombstone);
+
   // Check if the given row has been deleted -- i.e if the most recent
-  // delta for this row is a deletion.
+  // delta for this row is a deletion, or if it's in a range tombstone.
   //
   // Sets *deleted to true if so; otherwise sets it to false.
   Status CheckRowDeleted(rowid_t row_idx, const fs::IOContext* io_context,
@@ -185,6 +194,27 @@ class DeltaTracker {
   // initted, this will return a false negative.
   bool EstimateAllRedosAreAncient(Timestamp ancient_history_mark);
 
+  // Returns whether any of the UNDO or REDO deltas may be of ops applied in
+  // 'snap_to_include' but not in 'snap_to_exclude'. This is an estimate,
+  // based on the delta stores' timestamp ranges: stores whose stats haven't
+  // been read yet are assumed to have such deltas.
+  bool MayHaveDeltasBetween(const MvccSnapshot& snap_to_exclude,
+                            const MvccSnapshot& snap_to_include) const;
+
+  // Returns whether any of the REDO deltas may change the value of column
+  // 'col_id', by updating it or by reinserting a row. Deletes don't count.
+  // Stores whose stats haven't been read yet are assumed to change it.
+  bool MayHaveRedosChangingColumn(ColumnId col_id) const;
+
+  // Sets '*may_have' to whether a scan at 'snap' may have to apply any of the
+  // deltas to the base data, i.e. whether an UNDO delta may be of an op not
+  // applied in 'snap' or a REDO delta of an op applied in it. The delta stores
+  // are initialized to read their stats. Like MayHaveDeltasBetween(), this is
+  // an estimate; a non-empty DMS is always assumed to have such deltas.
+  Status MayHaveDeltasVisibleAt(const MvccSnapshot& snap,
+                                const fs::IOContext* io_context,
+                                bool* may_have) const;
+
   // See RowSet::InitUndoDeltas().
   Status InitUndoDeltas(Timestamp ancient_history_mark,
                         MonoTime deadline,
@@ -342,6 +372,11 @@ class DeltaTracker {
 
   Status CreateAndInitDMSUnlocked(const fs::IOContext* io_context);
 
+  // Wraps '*iter' into an iterator masking the rows of the range tombstones
+  // applied in the snapshot of 'opts', if any. Returns whether it did.
+  bool MaybeApplyRangeTombstones(const RowIteratorOptions& opts,
+                                 std::unique_ptr<DeltaIterator>* iter) const;
+
   std::shared_ptr<RowSetMetadata> rowset_metadata_;
 
   bool open_;
@@ -365,13 +400,16 @@ class DeltaTracker {
   SharedDeltaStoreVector redo_delta_stores_;
   // The set of tracked UNDO delta stores, in decreasing timestamp order.
   SharedDeltaStoreVector undo_delta_stores_;
+  // The range tombstones of the rowset, as in its metadata.
+  std::vector<RowSetMetadata::RangeTombstone> range_tombstones_;
 
   // The maintenance scheduler calls DeltaMemStoreEmpty() a lot.
   // We use an atomic variable to indicate whether DMS exists or not and
   // to avoid having to take component_lock_ in order to satisfy this call.
   AtomicBool dms_exists_;
 
-  // read-write lock protecting dms_ and {redo,undo}_delta_stores_.
+  // read-write lock protecting dms_, {redo,undo}_delta_stores_ and
+  // range_tombstones_.
   // - Readers take this lock in shared mode.
   // - Mutators take this lock in exclusive mode if they need to create
   //   a new DMS, and shared mode otherwise.
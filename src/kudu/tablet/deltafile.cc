@@ -63,7 +63,8 @@ DEFINE_int32(deltafile_default_block_size, 32*1024,
 TAG_FLAG(deltafile_default_block_size, experimental);
 
 DEFINE_string(deltafile_default_compression_codec, "lz4",
-              "The compression codec used when writing deltafiles.");
+              "The compression codec used when writing deltafiles. One of "
+              "no_compression, snappy, lz4, zlib or zstd.");
 TAG_FLAG(deltafile_default_compression_codec, experimental);
 
 using std::shared_ptr;
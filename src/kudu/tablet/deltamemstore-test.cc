@@ -668,6 +668,93 @@ TEST_F(TestDeltaMemStore, TestFuzz) {
       /*test_filter_column_ids_and_collect_deltas=*/false));
 }
 
+// Test that the DMS tracks which rows and columns its deltas touch, and that
+// iterators skip the batches that the deltas can't affect.
+TEST_F(TestDeltaMemStore, TestSkipUnaffectedRows) {
+  vector<uint32_t> to_update;
+  for (uint32_t i = 100; i < 200; i++) {
+    to_update.push_back(i);
+  }
+  UpdateIntsAtIndexes(to_update);
+
+  rowid_t first_row;
+  rowid_t last_row;
+  ASSERT_TRUE(dms_->RowRangeAffectingProjection(schema_, &first_row, &last_row));
+  ASSERT_EQ(100, first_row);
+  ASSERT_EQ(199, last_row);
+  Schema string_projection;
+  ASSERT_OK(schema_.CreateProjectionByNames({ "col1", "col2" }, &string_projection));
+  ASSERT_FALSE(dms_->RowRangeAffectingProjection(string_projection, &first_row, &last_row));
+
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot(mvcc_);
+  unique_ptr<DeltaIterator> iter;
+  ASSERT_OK(dms_->NewDeltaIterator(opts, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  ScopedColumnBlock<UINT32> block(100);
+  SelectionVector sv(block.nrows());
+  sv.SetAllTrue();
+  for (rowid_t block_start_row = 0; block_start_row < 300; block_start_row += 100) {
+    for (int i = 0; i < block.nrows(); i++) {
+      block[i] = 0;
+    }
+    ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+    ASSERT_EQ(block_start_row == 100, iter->MayHaveDeltas());
+    ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, sv));
+    for (int i = 0; i < block.nrows(); i++) {
+      rowid_t row = block_start_row + i;
+      ASSERT_EQ(block_start_row == 100 ? row * 10 : 0, block[i]) << "at row " << row;
+    }
+  }
+
+  // Deletes affect every projection, and are the only deltas point lookups
+  // have to find.
+  faststring buf;
+  RowChangeListEncoder update(&buf);
+  update.SetToDelete();
+  ASSERT_OK(dms_->Update(clock_.Now(), 500, RowChangeList(buf), op_id_));
+  ASSERT_TRUE(dms_->RowRangeAffectingProjection(string_projection, &first_row, &last_row));
+  ASSERT_EQ(500, first_row);
+  ASSERT_EQ(500, last_row);
+  bool deleted;
+  ASSERT_OK(dms_->CheckRowDeleted(500, nullptr, &deleted));
+  ASSERT_TRUE(deleted);
+  ASSERT_OK(dms_->CheckRowDeleted(150, nullptr, &deleted));
+  ASSERT_FALSE(deleted);
+}
+
+// Test that bulk deletes are applied to the selection vector, without forcing
+// the column decoders to skip evaluating predicates.
+TEST_F(TestDeltaMemStore, TestApplyBulkDeletes) {
+  faststring buf;
+  RowChangeListEncoder update(&buf);
+  update.SetToDelete();
+  for (rowid_t row_idx = 10; row_idx < 90; row_idx++) {
+    ASSERT_OK(dms_->Update(clock_.Now(), row_idx, RowChangeList(buf), op_id_));
+  }
+  ASSERT_OK(dms_->Update(clock_.Now(), 95, RowChangeList(buf), op_id_));
+
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllOps();
+  unique_ptr<DeltaIterator> iter;
+  ASSERT_OK(dms_->NewDeltaIterator(opts, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  ASSERT_OK(iter->PrepareBatch(100, DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_FALSE(iter->MayHaveDeltas());
+  SelectionVector sv(100);
+  sv.SetAllTrue();
+  ASSERT_OK(iter->ApplyDeletes(&sv));
+  ASSERT_EQ(19, sv.CountSelected());
+  for (rowid_t row_idx = 0; row_idx < 100; row_idx++) {
+    ASSERT_EQ(row_idx < 10 || (row_idx >= 90 && row_idx != 95), sv.IsRowSelected(row_idx))
+        << "at row " << row_idx;
+  }
+}
+
 TEST_F(TestDeltaMemStore, TestDeletedRowCount) {
   const int kNumUpdates = 10000;
 
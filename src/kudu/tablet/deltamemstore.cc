@@ -25,12 +25,14 @@
 #include <glog/logging.h>
 
 #include "kudu/common/row_changelist.h"
+#include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/delta_key.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/tablet/memrowset.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memcmpable_varint.h"
@@ -75,13 +77,14 @@ DeltaMemStore::DeltaMemStore(int64_t id,
     creation_time_(MonoTime::Now()),
     highest_timestamp_(Timestamp::kMin),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(), std::move(parent_tracker))),
+        MemStoreBufferAllocator(), std::move(parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
     tree_(arena_),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
     disambiguator_sequence_number_(0),
     deleted_row_count_(0) {
+  SetMemStoreArenaMaxBufferSize(arena_.get());
 }
 
 Status DeltaMemStore::Init(const IOContext* /*io_context*/) {
@@ -125,6 +128,24 @@ Status DeltaMemStore::Update(Timestamp timestamp,
 
   std::lock_guard<simple_spinlock> l(ts_lock_);
   highest_timestamp_ = std::max(highest_timestamp_, timestamp);
+  RowChangeListDecoder decoder(update);
+  decoder.InitNoSafetyChecks();
+  if (!decoder.is_update()) {
+    deleted_or_reinserted_rows_.Extend(row_idx);
+    return Status::OK();
+  }
+  while (decoder.HasNext()) {
+    RowChangeListDecoder::DecodedUpdate dec;
+    if (PREDICT_FALSE(!decoder.DecodeNext(&dec).ok())) {
+      deleted_or_reinserted_rows_.Extend(row_idx);
+      break;
+    }
+    const size_t col_id = static_cast<int32_t>(dec.col_id);
+    if (col_id >= updated_rows_by_col_id_.size()) {
+      updated_rows_by_col_id_.resize(col_id + 1);
+    }
+    updated_rows_by_col_id_[col_id].Extend(row_idx);
+  }
   return Status::OK();
 }
 
@@ -154,10 +175,43 @@ Status DeltaMemStore::NewDeltaIterator(const RowIteratorOptions& opts,
   return Status::OK();
 }
 
+bool DeltaMemStore::RowRangeAffectingProjection(const Schema& projection,
+                                                rowid_t* first_row,
+                                                rowid_t* last_row) const {
+  std::lock_guard<simple_spinlock> l(ts_lock_);
+  RowIdRange range = deleted_or_reinserted_rows_;
+  for (int i = 0; i < projection.num_columns(); i++) {
+    const size_t col_id = static_cast<int32_t>(projection.column_id(i));
+    if (col_id < updated_rows_by_col_id_.size()) {
+      const RowIdRange& updated = updated_rows_by_col_id_[col_id];
+      if (!updated.empty()) {
+        range.Extend(updated.first);
+        range.Extend(updated.last);
+      }
+    }
+  }
+  if (range.empty()) {
+    return false;
+  }
+  *first_row = range.first;
+  *last_row = range.last;
+  return true;
+}
+
 Status DeltaMemStore::CheckRowDeleted(rowid_t row_idx,
                                       const IOContext* /*io_context*/,
                                       bool *deleted) const {
   *deleted = false;
+  // Only the rows that were ever deleted need to be looked up.
+  if (deleted_row_count_.Load() == 0) {
+    return Status::OK();
+  }
+  {
+    std::lock_guard<simple_spinlock> l(ts_lock_);
+    if (!deleted_or_reinserted_rows_.Contains(row_idx)) {
+      return Status::OK();
+    }
+  }
   DeltaKey key(row_idx, Timestamp(Timestamp::kMax));
   faststring buf;
   key.EncodeTo(&buf);
@@ -203,7 +257,13 @@ DMSIterator::DMSIterator(const shared_ptr<const DeltaMemStore>& dms,
     : dms_(dms),
       preparer_(std::move(opts)),
       iter_(dms->tree_.NewIterator()),
-      seeked_(false) {}
+      seeked_(false),
+      first_affected_row_(0),
+      last_affected_row_(0),
+      iter_stale_(false) {
+  may_affect_projection_ = dms->RowRangeAffectingProjection(
+      *preparer_.opts().projection, &first_affected_row_, &last_affected_row_);
+}
 
 Status DMSIterator::Init(ScanSpec* /*spec*/) {
   initted_ = true;
@@ -219,6 +279,7 @@ Status DMSIterator::SeekToOrdinal(rowid_t row_idx) {
   iter_->SeekAtOrAfter(Slice(buf), &exact);
   preparer_.Seek(row_idx);
   seeked_ = true;
+  iter_stale_ = false;
   return Status::OK();
 }
 
@@ -239,6 +300,24 @@ Status DMSIterator::PrepareBatch(size_t nrows, int prepare_flags) {
   rowid_t start_row = preparer_.cur_prepared_idx();
   rowid_t stop_row = start_row + nrows - 1;
 
+  if (prepare_flags == PREPARE_FOR_APPLY &&
+      (!may_affect_projection_ ||
+       stop_row < first_affected_row_ || start_row > last_affected_row_)) {
+    // None of the deltas may change the projected rows of this batch.
+    preparer_.Start(nrows, prepare_flags);
+    preparer_.Finish(nrows);
+    iter_stale_ = true;
+    return Status::OK();
+  }
+  if (iter_stale_) {
+    faststring buf;
+    DeltaKey key(start_row, Timestamp(0));
+    key.EncodeTo(&buf);
+    bool exact; /* unused */
+    iter_->SeekAtOrAfter(Slice(buf), &exact);
+    iter_stale_ = false;
+  }
+
   preparer_.Start(nrows, prepare_flags);
   bool finished_row = false;
   while (iter_->IsValid()) {
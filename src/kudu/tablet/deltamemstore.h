@@ -16,8 +16,10 @@
 // under the License.
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -49,6 +51,7 @@ class MemTracker;
 class MemoryTrackingBufferAllocator;
 class RowChangeList;
 class ScanSpec;
+class Schema;
 class SelectionVector;
 struct ColumnId;
 
@@ -128,6 +131,14 @@ class DeltaMemStore : public DeltaStore,
   virtual Status CheckRowDeleted(rowid_t row_idx, const fs::IOContext* io_context,
                                  bool* deleted) const OVERRIDE;
 
+  // Returns the range of rows whose scan with 'projection' may be changed by
+  // applying the updates and deletes of this DMS, regardless of MVCC: the
+  // rows where one of the projected columns was updated, and those which
+  // were deleted or reinserted. Returns false if there are no such rows.
+  bool RowRangeAffectingProjection(const Schema& projection,
+                                   rowid_t* first_row,
+                                   rowid_t* last_row) const;
+
   virtual uint64_t EstimateSize() const OVERRIDE {
     return arena_->memory_footprint();
   }
@@ -181,9 +192,30 @@ class DeltaMemStore : public DeltaStore,
 
   const MonoTime creation_time_;
 
+  // An inclusive range of row indexes. Empty while 'first' > 'last'.
+  struct RowIdRange {
+    rowid_t first = std::numeric_limits<rowid_t>::max();
+    rowid_t last = 0;
+
+    bool empty() const { return first > last; }
+    bool Contains(rowid_t row_idx) const { return first <= row_idx && row_idx <= last; }
+    void Extend(rowid_t row_idx) {
+      first = std::min(first, row_idx);
+      last = std::max(last, row_idx);
+    }
+  };
+
+  // Protects the fields below, which summarize the mutations in the DMS.
   mutable simple_spinlock ts_lock_;
   Timestamp highest_timestamp_;
 
+  // Rows updated in each column, indexed by column ID.
+  std::vector<RowIdRange> updated_rows_by_col_id_;
+
+  // Rows deleted or reinserted. Also covers any update that couldn't be
+  // decoded, so as to never skip it.
+  RowIdRange deleted_or_reinserted_rows_;
+
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
 
   std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
@@ -274,6 +306,21 @@ class DMSIterator : public DeltaIterator {
 
   // True if SeekToOrdinal() been called at least once.
   bool seeked_;
+
+  // The rows that the DMS's deltas may change under the iterator's projection,
+  // if any; see DeltaMemStore::RowRangeAffectingProjection(). Batches which
+  // only apply deltas and fall outside this range are prepared without
+  // walking the tree.
+  //
+  // Computing this once at construction is safe because the mutations of any
+  // op in the iterator's snapshot are already in the DMS by then.
+  bool may_affect_projection_;
+  rowid_t first_affected_row_;
+  rowid_t last_affected_row_;
+
+  // True if batches were prepared without advancing 'iter_', which then has
+  // to be repositioned before walking the tree again.
+  bool iter_stale_;
 };
 
 } // namespace tablet
@@ -26,12 +26,14 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
@@ -40,11 +42,15 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(tablet_diff_scan_skip_unchanged_rowsets);
+
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -265,5 +271,86 @@ TEST_F(OrderedDiffScanWithDeletesTest, TestDiffScanAfterDeltaFlushRacesWithBatch
   ASSERT_STR_CONTAINS(rows[0], "val=9999");
 }
 
+class DiffScanSkipRowSetsTest : public TabletTestBase<IntKeyTestSetup<INT64>> {
+ public:
+  DiffScanSkipRowSetsTest()
+      : Superclass(TabletHarness::Options::ClockType::HYBRID_CLOCK) {}
+
+ private:
+  using Superclass = TabletTestBase<IntKeyTestSetup<INT64>>;
+};
+
+// Test that diff scans skip the disk rowsets without changes in their time
+// range, yet return the same rows.
+TEST_F(DiffScanSkipRowSetsTest, TestSkipUnchangedRowSets) {
+  FLAGS_tablet_diff_scan_skip_unchanged_rowsets = true;
+  auto tablet = this->tablet();
+  LocalTabletWriter writer(tablet.get(), &client_schema_);
+
+  // Write two disk rowsets, and make sure the stats of their UNDO deltas,
+  // which have their rows' insertions, are loaded.
+  for (int64_t i = 0; i < 10; i++) {
+    ASSERT_OK(InsertTestRow(&writer, i, 0));
+  }
+  ASSERT_OK(tablet->Flush());
+  for (int64_t i = 10; i < 20; i++) {
+    ASSERT_OK(InsertTestRow(&writer, i, 0));
+  }
+  ASSERT_OK(tablet->Flush());
+  vector<std::shared_ptr<RowSet>> rowsets;
+  tablet->GetRowSetsForTests(&rowsets);
+  ASSERT_EQ(2, rowsets.size());
+  for (const auto& rs : rowsets) {
+    ASSERT_OK(rs->InitUndoDeltas(Timestamp::kInvalidTimestamp, MonoTime(),
+                                 nullptr, nullptr, nullptr));
+  }
+  ASSERT_OK(tablet->mvcc_manager()->WaitForApplyingOpsToApply());
+  MvccSnapshot snap1(*tablet->mvcc_manager());
+
+  // Change a row of one of them, and insert a row into the MRS.
+  ASSERT_OK(UpdateTestRow(&writer, 15, 1));
+  ASSERT_OK(InsertTestRow(&writer, 21, 0));
+  ASSERT_OK(tablet->mvcc_manager()->WaitForApplyingOpsToApply());
+  MvccSnapshot snap2(*tablet->mvcc_manager());
+
+  const auto diff_scan = [&](vector<string>* rows) {
+    RowIteratorOptions opts;
+    opts.snap_to_exclude = snap1;
+    opts.snap_to_include = snap2;
+    opts.order = ORDERED;
+    Schema projection = tablet->schema()->CopyWithoutColumnIds();
+    opts.projection = &projection;
+    unique_ptr<RowwiseIterator> row_iterator;
+    RETURN_NOT_OK(tablet->NewRowIterator(std::move(opts), &row_iterator));
+    ScanSpec spec;
+    RETURN_NOT_OK(row_iterator->Init(&spec));
+    return tablet::IterateToStringList(row_iterator.get(), rows);
+  };
+  const vector<string> kExpectedRows = {
+    setup_.FormatDebugRow(15, 1, /*updated=*/ true),
+    setup_.FormatDebugRow(21, 0, /*updated=*/ false),
+  };
+
+  // Only the rowset without changes is skipped.
+  vector<string> rows;
+  ASSERT_OK(diff_scan(&rows));
+  ASSERT_EQ(kExpectedRows, rows);
+  ASSERT_EQ(1, tablet->metrics()->diff_scan_rowsets_skipped->value());
+
+  // Same once the update is in a REDO delta file.
+  ASSERT_OK(tablet->FlushAllDMSForTests());
+  rows.clear();
+  ASSERT_OK(diff_scan(&rows));
+  ASSERT_EQ(kExpectedRows, rows);
+  ASSERT_EQ(2, tablet->metrics()->diff_scan_rowsets_skipped->value());
+
+  // Without the skipping, the same rows are returned.
+  FLAGS_tablet_diff_scan_skip_unchanged_rowsets = false;
+  rows.clear();
+  ASSERT_OK(diff_scan(&rows));
+  ASSERT_EQ(kExpectedRows, rows);
+  ASSERT_EQ(2, tablet->metrics()->diff_scan_rowsets_skipped->value());
+}
+
 } // namespace tablet
 } // namespace kudu
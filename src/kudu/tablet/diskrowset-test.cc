@@ -79,6 +79,7 @@ DECLARE_bool(crash_on_eio);
 DECLARE_int32(cfile_default_block_size);
 DECLARE_double(env_inject_eio);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
+DECLARE_int32(rowset_writer_column_encoding_threads);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
 
 using std::is_sorted;
@@ -179,6 +180,90 @@ TEST_F(TestRowSet, TestRowSetRoundTrip) {
   }
 }
 
+// Test round-trip writing and reading back a rowset whose columns are
+// encoded in parallel.
+TEST_F(TestRowSet, TestRowSetRoundTripParallelColumnEncoding) {
+  FLAGS_rowset_writer_column_encoding_threads = 2;
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  IterateProjection(*rs, schema_, n_rows_);
+
+  // The key bounds were recorded, so present keys are found.
+  char buf[256];
+  FormatKey(n_rows_ - 1, buf, sizeof(buf));
+  Schema pk = schema_.CreateKeyProjection();
+  RowBuilder rb(&pk);
+  rb.AddString(Slice(buf));
+  Arena arena(64);
+  RowSetKeyProbe probe(rb.row(), &arena);
+  ProbeStats stats;
+  bool present;
+  ASSERT_OK(rs->CheckRowPresent(probe, nullptr, &present, &stats));
+  ASSERT_TRUE(present);
+}
+
+// Test that checking the presence of a sorted batch of keys returns the same
+// results as checking each key on its own.
+TEST_F(TestRowSet, TestCheckRowsPresent) {
+  WriteTestRowSet();
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  // Delete some of the rows, so that the batch also consults the deltas.
+  for (int i = 0; i < n_rows_; i += 7) {
+    OperationResultPB result;
+    ASSERT_OK(DeleteRow(rs.get(), i, &result));
+  }
+
+  // Probe every third row, and a missing key right after each of them. The
+  // probes reference the keys and rows, which must outlive them.
+  Arena arena(1024);
+  Schema pk = schema_.CreateKeyProjection();
+  vector<string> keys;
+  for (int i = 0; i < n_rows_; i += 3) {
+    char buf[256];
+    FormatKey(i, buf, sizeof(buf));
+    keys.emplace_back(buf);
+    keys.emplace_back(string(buf) + "x");
+  }
+  vector<unique_ptr<RowBuilder>> rows;
+  vector<unique_ptr<RowSetKeyProbe>> probes;
+  for (const auto& key : keys) {
+    rows.emplace_back(new RowBuilder(&pk));
+    rows.back()->AddString(Slice(key));
+    probes.emplace_back(new RowSetKeyProbe(rows.back()->row(), &arena));
+  }
+  vector<const RowSetKeyProbe*> probe_ptrs;
+  for (const auto& p : probes) {
+    probe_ptrs.emplace_back(p.get());
+  }
+
+  vector<ProbeStats> batch_stats(probes.size());
+  vector<ProbeStats*> batch_stats_ptrs;
+  for (auto& stats : batch_stats) {
+    batch_stats_ptrs.emplace_back(&stats);
+  }
+  unique_ptr<bool[]> batch_present(new bool[probes.size()]);
+  ASSERT_OK(rs->CheckRowsPresent(probe_ptrs, nullptr, batch_present.get(),
+                                 batch_stats_ptrs.data()));
+
+  for (int i = 0; i < probes.size(); i++) {
+    bool present;
+    ProbeStats stats;
+    ASSERT_OK(rs->CheckRowPresent(*probes[i], nullptr, &present, &stats));
+    ASSERT_EQ(present, batch_present[i]) << probes[i]->encoded_key_slice().ToDebugString();
+    ASSERT_EQ(stats.blooms_consulted, batch_stats[i].blooms_consulted);
+    ASSERT_EQ(stats.keys_consulted, batch_stats[i].keys_consulted);
+    ASSERT_EQ(stats.deltas_consulted, batch_stats[i].deltas_consulted);
+
+    const int row_idx = (i / 2) * 3;
+    const bool expected = i % 2 == 0 && row_idx % 7 != 0;
+    ASSERT_EQ(expected, present) << row_idx;
+  }
+}
+
 // Test writing a rowset, and then updating some rows in it.
 TEST_F(TestRowSet, TestRowSetUpdate) {
   Arena arena(64);
@@ -18,6 +18,7 @@
 #include "kudu/tablet/diskrowset.h"
 
 #include <algorithm>
+#include <cstring>
 #include <map>
 #include <ostream>
 #include <vector>
@@ -27,19 +28,25 @@
 #include <glog/logging.h>
 #include <glog/stl_logging.h>
 
+#include "kudu/cfile/block_export.h"
 #include "kudu/cfile/bloomfile.h"
+#include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/types.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/delta_compaction.h"
@@ -50,12 +57,15 @@
 #include "kudu/tablet/multi_column_writer.h"
 #include "kudu/tablet/mutation.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/util/array_view.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/rle-encoding.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
@@ -79,6 +89,72 @@ DEFINE_bool(rowset_metadata_store_keys, false,
             "metadata. If false, keys will be read from the data blocks.");
 TAG_FLAG(rowset_metadata_store_keys, experimental);
 
+DEFINE_bool(rowset_split_block_bloom_filters, false,
+            "Whether to write the key bloom filters of new rowsets as "
+            "split-block bloom filters, which probe a single cache line per "
+            "key, rather than as classic bloom filters. Rowsets with either "
+            "kind of bloom filters can be read regardless of this setting, and "
+            "existing rowsets are converted as they are compacted. Servers of "
+            "versions which don't support split-block bloom filters can't read "
+            "rowsets written with them.");
+TAG_FLAG(rowset_split_block_bloom_filters, experimental);
+TAG_FLAG(rowset_split_block_bloom_filters, runtime);
+
+DEFINE_string(rowset_secondary_index_columns, "",
+              "Comma-separated list of the names of non-key columns for which new "
+              "rowsets maintain a secondary index, a cfile of the sorted values of "
+              "the column with their rowids. Scans with equality or IN-list "
+              "predicates on an indexed column use the index to skip the batches "
+              "of rows which can't match. Columns of types which can't be part "
+              "of a primary key aren't indexed. Servers of versions which don't "
+              "support secondary indexes ignore them.");
+TAG_FLAG(rowset_secondary_index_columns, experimental);
+TAG_FLAG(rowset_secondary_index_columns, runtime);
+
+DEFINE_string(rowset_bitmap_index_columns, "",
+              "Comma-separated list of the names of low-cardinality non-key columns "
+              "for which new rowsets maintain a bitmap index: the RLE-encoded bitmap "
+              "of the rows of each distinct value of the column. Scans with equality "
+              "or IN-list predicates on indexed columns combine the bitmaps of all "
+              "such predicates to skip the batches of rows which can't match. "
+              "Columns of types which can't be part of a primary key aren't indexed. "
+              "Servers of versions which don't support bitmap indexes ignore them.");
+TAG_FLAG(rowset_bitmap_index_columns, experimental);
+TAG_FLAG(rowset_bitmap_index_columns, runtime);
+
+DEFINE_int32(rowset_bitmap_index_max_cardinality, 256,
+             "The maximum number of distinct values of a column in a rowset for the "
+             "rowset to have a bitmap index of the column. See "
+             "--rowset_bitmap_index_columns.");
+TAG_FLAG(rowset_bitmap_index_max_cardinality, experimental);
+TAG_FLAG(rowset_bitmap_index_max_cardinality, runtime);
+
+DEFINE_string(rowset_bloom_filter_columns, "",
+              "Comma-separated list of the names of high-cardinality non-key columns "
+              "for which new rowsets maintain a bloom filter of the column's values. "
+              "Scans with equality or IN-list predicates on such a column skip the "
+              "rowsets whose bloom filter rules out all the predicate's values. "
+              "Columns of types which can't be part of a primary key aren't indexed. "
+              "Servers of versions which don't support column bloom filters ignore "
+              "them.");
+TAG_FLAG(rowset_bloom_filter_columns, experimental);
+TAG_FLAG(rowset_bloom_filter_columns, runtime);
+
+DEFINE_string(rowset_sorted_columns, "",
+              "Comma-separated list of the names of non-key columns whose values are "
+              "expected to increase with the primary key, e.g. the insertion times "
+              "of insert-ordered rows. New rowsets record which of these columns "
+              "are non-null and sorted in the rowset, so that scans of the rowset "
+              "with range or equality predicates on them may skip straight to the "
+              "matching rows. Servers of versions which don't support sorted "
+              "columns ignore the record.");
+TAG_FLAG(rowset_sorted_columns, experimental);
+TAG_FLAG(rowset_sorted_columns, runtime);
+
+DEFINE_int32(rowset_secondary_index_block_size_bytes, 4096,
+             "Block size used for the secondary and bitmap indexes of rowsets.");
+TAG_FLAG(rowset_secondary_index_block_size_bytes, experimental);
+
 namespace kudu {
 
 class Mutex;
@@ -101,15 +177,43 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+namespace {
+
+// Returns the indexes in 'schema' of the distinct non-key columns named in the
+// comma-separated 'col_names' which can be indexed.
+vector<int> ResolveIndexedColumns(const Schema& schema, const string& col_names) {
+  vector<int> col_idxs;
+  const vector<string> names = strings::Split(col_names, ",", strings::SkipWhitespace());
+  for (const auto& name : names) {
+    const int col_idx = schema.find_column(name);
+    if (col_idx == Schema::kColumnNotFound || col_idx < schema.num_key_columns() ||
+        std::find(col_idxs.begin(), col_idxs.end(), col_idx) != col_idxs.end()) {
+      continue;
+    }
+    // The indexed values are key-encoded, so they sort like the values.
+    if (!IsTypeAllowableInKey(schema.column(col_idx).type_info())) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << "Not indexing column " << name
+                                     << ": its type can't be indexed";
+      continue;
+    }
+    col_idxs.push_back(col_idx);
+  }
+  return col_idxs;
+}
+
+} // anonymous namespace
+
 const char *DiskRowSet::kMinKeyMetaEntryName = "min_key";
 const char *DiskRowSet::kMaxKeyMetaEntryName = "max_key";
 
 DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
                                    const Schema* schema,
-                                   BloomFilterSizing bloom_sizing)
+                                   BloomFilterSizing bloom_sizing,
+                                   fs::StorageTier tier)
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
+      tier_(tier),
       finished_(false),
       written_count_(0) {
   CHECK(schema->has_column_ids());
@@ -120,7 +224,7 @@ Status DiskRowSetWriter::Open() {
 
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id));
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, tablet_id, tier_));
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -131,6 +235,32 @@ Status DiskRowSetWriter::Open() {
     RETURN_NOT_OK(InitAdHocIndexWriter());
   }
 
+  // Resolve the columns to maintain secondary and bitmap indexes for.
+  for (int col_idx : ResolveIndexedColumns(*schema_, FLAGS_rowset_secondary_index_columns)) {
+    const TypeInfo* type_info = schema_->column(col_idx).type_info();
+    secondary_indexes_.push_back({ col_idx, &GetKeyEncoder<faststring>(type_info), {} });
+  }
+  if (!secondary_indexes_.empty()) {
+    secondary_index_arena_.reset(new Arena(32 * 1024));
+  }
+  for (int col_idx : ResolveIndexedColumns(*schema_, FLAGS_rowset_bitmap_index_columns)) {
+    const TypeInfo* type_info = schema_->column(col_idx).type_info();
+    bitmap_indexes_.emplace_back();
+    bitmap_indexes_.back().col_idx = col_idx;
+    bitmap_indexes_.back().encoder = &GetKeyEncoder<faststring>(type_info);
+  }
+  for (int col_idx : ResolveIndexedColumns(*schema_, FLAGS_rowset_bloom_filter_columns)) {
+    const TypeInfo* type_info = schema_->column(col_idx).type_info();
+    column_blooms_.push_back({ col_idx, &GetKeyEncoder<faststring>(type_info), {} });
+  }
+  if (!column_blooms_.empty()) {
+    column_bloom_arena_.reset(new Arena(32 * 1024));
+  }
+  for (int col_idx : ResolveIndexedColumns(*schema_, FLAGS_rowset_sorted_columns)) {
+    sorted_columns_.emplace_back();
+    sorted_columns_.back().col_idx = col_idx;
+  }
+
   return Status::OK();
 }
 
@@ -139,12 +269,15 @@ Status DiskRowSetWriter::InitBloomFileWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, tier_ }),
                                            &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
 
-  bloom_writer_.reset(new cfile::BloomFileWriter(std::move(block), bloom_sizing_));
+  bloom_writer_.reset(new cfile::BloomFileWriter(
+      std::move(block), bloom_sizing_,
+      FLAGS_rowset_split_block_bloom_filters ? cfile::BloomBlockHeaderPB::SPLIT_BLOCK
+                                             : cfile::BloomBlockHeaderPB::CLASSIC));
   RETURN_NOT_OK(bloom_writer_->Start());
   return Status::OK();
 }
@@ -154,7 +287,7 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   unique_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
   const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id }),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, tier_ }),
                                            &block),
                         "Couldn't allocate a block for compoound index");
 
@@ -232,6 +365,94 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block, int live_row_count)
 #endif
   }
 
+  // Buffer the entries of the secondary indexes.
+  faststring entry;
+  for (auto& index : secondary_indexes_) {
+    const ColumnBlock col = block.column_block(index.col_idx);
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (col.is_nullable() && col.is_null(i)) {
+        continue;
+      }
+      entry.clear();
+      index.encoder->Encode(col.cell_ptr(i), /*is_last=*/false, &entry);
+      const uint32_t rowid = BigEndian::FromHost32(written_count_ + i);
+      entry.append(&rowid, sizeof(rowid));
+      Slice s;
+      CHECK(secondary_index_arena_->RelocateSlice(Slice(entry), &s));
+      index.entries.emplace_back(s);
+    }
+  }
+
+  // Buffer the values of the columns with bloom filters.
+  for (auto& bloom : column_blooms_) {
+    const ColumnBlock col = block.column_block(bloom.col_idx);
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (col.is_nullable() && col.is_null(i)) {
+        continue;
+      }
+      entry.clear();
+      bloom.encoder->Encode(col.cell_ptr(i), /*is_last=*/false, &entry);
+      Slice s;
+      CHECK(column_bloom_arena_->RelocateSlice(Slice(entry), &s));
+      bloom.values.emplace_back(s);
+    }
+  }
+
+  // Add the rows to the bitmaps of their values, unless their column already
+  // has too many distinct values.
+  const int max_cardinality = FLAGS_rowset_bitmap_index_max_cardinality;
+  for (auto& index : bitmap_indexes_) {
+    if (index.too_many_values) {
+      continue;
+    }
+    const ColumnBlock col = block.column_block(index.col_idx);
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (col.is_nullable() && col.is_null(i)) {
+        continue;
+      }
+      entry.clear();
+      index.encoder->Encode(col.cell_ptr(i), /*is_last=*/false, &entry);
+      auto& rowids = index.rowids_by_value[entry.ToString()];
+      rowids.push_back(written_count_ + i);
+      if (index.rowids_by_value.size() > max_cardinality) {
+        index.too_many_values = true;
+        index.rowids_by_value.clear();
+        break;
+      }
+    }
+  }
+
+  // Check whether the columns expected to be sorted still are.
+  for (auto& sorted_col : sorted_columns_) {
+    if (!sorted_col.sorted) {
+      continue;
+    }
+    const ColumnBlock col = block.column_block(sorted_col.col_idx);
+    const TypeInfo* type_info = col.type_info();
+    const void* prev = written_count_ == 0 ? nullptr : sorted_col.last_cell;
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if ((col.is_nullable() && col.is_null(i)) ||
+          (prev && type_info->Compare(prev, col.cell_ptr(i)) > 0)) {
+        sorted_col.sorted = false;
+        break;
+      }
+      prev = col.cell_ptr(i);
+    }
+    if (sorted_col.sorted) {
+      // Copy the last value, since the block's cells don't outlive it.
+      if (type_info->physical_type() == BINARY) {
+        const Slice* s = reinterpret_cast<const Slice*>(prev);
+        sorted_col.last_value.assign_copy(s->data(), s->size());
+        sorted_col.last_slice = Slice(sorted_col.last_value);
+        sorted_col.last_cell = &sorted_col.last_slice;
+      } else {
+        sorted_col.last_value.assign_copy(reinterpret_cast<const uint8_t*>(prev),
+                                          type_info->size());
+        sorted_col.last_cell = sorted_col.last_value.data();
+      }
+    }
+  }
+
   written_count_ += block.nrows();
 
   return Status::OK();
@@ -276,6 +497,9 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
   std::map<ColumnId, BlockId> flushed_blocks;
   col_writer_->GetFlushedBlocksByColumnId(&flushed_blocks);
   rowset_metadata_->SetColumnDataBlocks(flushed_blocks);
+  vector<ColumnStatisticsPB> col_stats;
+  col_writer_->GetColumnStatistics(&col_stats);
+  rowset_metadata_->SetColumnStatistics(std::move(col_stats));
 
   if (ad_hoc_index_writer_ != nullptr) {
     Status s = ad_hoc_index_writer_->FinishAndReleaseBlock(transaction);
@@ -292,10 +516,164 @@ Status DiskRowSetWriter::FinishAndReleaseBlocks(BlockCreationTransaction* transa
     return s;
   }
 
+  RETURN_NOT_OK(FinishSecondaryIndexes(transaction));
+  RETURN_NOT_OK(FinishBitmapIndexes(transaction));
+  RETURN_NOT_OK(FinishColumnBlooms(transaction));
+
+  vector<ColumnId> sorted_col_ids;
+  for (const auto& sorted_col : sorted_columns_) {
+    if (sorted_col.sorted) {
+      sorted_col_ids.emplace_back(schema_->column_id(sorted_col.col_idx));
+    }
+  }
+  rowset_metadata_->SetSortedColumnIds(std::move(sorted_col_ids));
+
   finished_ = true;
   return Status::OK();
 }
 
+Status DiskRowSetWriter::WriteIndexFile(const vector<Slice>& entries,
+                                        BlockCreationTransaction* transaction,
+                                        BlockId* block_id) {
+  FsManager* fs = rowset_metadata_->fs_manager();
+  const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  unique_ptr<WritableBlock> block;
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, tier_ }),
+                                           &block),
+                        "Couldn't allocate a block for column index");
+  *block_id = block->id();
+
+  cfile::WriterOptions opts;
+  opts.write_validx = true;
+  opts.write_posidx = false;
+  opts.storage_attributes.encoding = PREFIX_ENCODING;
+  opts.storage_attributes.compression = LZ4;
+  opts.storage_attributes.cfile_block_size = FLAGS_rowset_secondary_index_block_size_bytes;
+  cfile::CFileWriter writer(std::move(opts), GetTypeInfo(BINARY), false, std::move(block));
+  RETURN_NOT_OK(writer.Start());
+  RETURN_NOT_OK(writer.AppendEntries(entries.data(), entries.size()));
+  RETURN_NOT_OK_PREPEND(writer.FinishAndReleaseBlock(transaction),
+                        "Unable to finish column index writer");
+  return Status::OK();
+}
+
+Status DiskRowSetWriter::FinishSecondaryIndexes(BlockCreationTransaction* transaction) {
+  if (secondary_indexes_.empty()) {
+    return Status::OK();
+  }
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::FinishSecondaryIndexes");
+  std::map<ColumnId, BlockId> index_blocks;
+  for (auto& index : secondary_indexes_) {
+    // A column without any non-null cells doesn't need an index.
+    if (index.entries.empty()) {
+      continue;
+    }
+    std::sort(index.entries.begin(), index.entries.end(),
+              [](const Slice& a, const Slice& b) { return a.compare(b) < 0; });
+    BlockId block_id;
+    RETURN_NOT_OK(WriteIndexFile(index.entries, transaction, &block_id));
+    index_blocks.emplace(schema_->column_id(index.col_idx), block_id);
+  }
+  rowset_metadata_->SetSecondaryIndexBlocks(index_blocks);
+
+  // The buffered entries are no longer needed.
+  secondary_indexes_.clear();
+  secondary_index_arena_.reset();
+  return Status::OK();
+}
+
+Status DiskRowSetWriter::FinishColumnBlooms(BlockCreationTransaction* transaction) {
+  if (column_blooms_.empty()) {
+    return Status::OK();
+  }
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::FinishColumnBlooms");
+  FsManager* fs = rowset_metadata_->fs_manager();
+  const string& tablet_id = rowset_metadata_->tablet_metadata()->tablet_id();
+  std::map<ColumnId, BlockId> bloom_blocks;
+  for (auto& bloom : column_blooms_) {
+    // A column without any non-null cells doesn't need a bloom filter.
+    if (bloom.values.empty()) {
+      continue;
+    }
+    // Like the keys of the rowset's bloom file, the values must be appended
+    // in order, since each bloom block covers a range of values.
+    auto& values = bloom.values;
+    std::sort(values.begin(), values.end(),
+              [](const Slice& a, const Slice& b) { return a.compare(b) < 0; });
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    unique_ptr<WritableBlock> block;
+    RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(CreateBlockOptions({ tablet_id, tier_ }),
+                                             &block),
+                          "Couldn't allocate a block for a column bloom filter");
+    const BlockId block_id = block->id();
+    BloomFileWriter writer(
+        std::move(block), bloom_sizing_,
+        FLAGS_rowset_split_block_bloom_filters ? cfile::BloomBlockHeaderPB::SPLIT_BLOCK
+                                               : cfile::BloomBlockHeaderPB::CLASSIC);
+    RETURN_NOT_OK(writer.Start());
+    RETURN_NOT_OK(writer.AppendKeys(values.data(), values.size()));
+    RETURN_NOT_OK(writer.FinishAndReleaseBlock(transaction));
+    bloom_blocks.emplace(schema_->column_id(bloom.col_idx), block_id);
+  }
+  rowset_metadata_->SetColumnBloomBlocks(bloom_blocks);
+
+  // The buffered values are no longer needed.
+  column_blooms_.clear();
+  column_bloom_arena_.reset();
+  return Status::OK();
+}
+
+Status DiskRowSetWriter::FinishBitmapIndexes(BlockCreationTransaction* transaction) {
+  if (bitmap_indexes_.empty()) {
+    return Status::OK();
+  }
+  TRACE_EVENT0("tablet", "DiskRowSetWriter::FinishBitmapIndexes");
+  std::map<ColumnId, BlockId> index_blocks;
+  faststring bitmap;
+  for (auto& index : bitmap_indexes_) {
+    if (index.too_many_values || index.rowids_by_value.empty()) {
+      VLOG(1) << "Not writing a bitmap index of column "
+              << schema_->column(index.col_idx).name() << " in "
+              << rowset_metadata_->ToString();
+      continue;
+    }
+    // Each entry is the value's encoding followed by the RLE-encoded bitmap
+    // of the rowset's rows, with a bit set for each row of the value. Since
+    // the encodings of the values are prefix-free, the entries sort like the
+    // values.
+    vector<string> entry_data;
+    entry_data.reserve(index.rowids_by_value.size());
+    for (const auto& e : index.rowids_by_value) {
+      bitmap.clear();
+      RleEncoder<bool> encoder(&bitmap, 1);
+      rowid_t next = 0;
+      for (rowid_t rowid : e.second) {
+        if (rowid > next) {
+          encoder.Put(false, rowid - next);
+        }
+        encoder.Put(true);
+        next = rowid + 1;
+      }
+      if (written_count_ > next) {
+        encoder.Put(false, written_count_ - next);
+      }
+      encoder.Flush();
+      entry_data.emplace_back(e.first);
+      entry_data.back().append(reinterpret_cast<const char*>(bitmap.data()), bitmap.size());
+    }
+    std::sort(entry_data.begin(), entry_data.end());
+    vector<Slice> entries(entry_data.begin(), entry_data.end());
+    BlockId block_id;
+    RETURN_NOT_OK(WriteIndexFile(entries, transaction, &block_id));
+    index_blocks.emplace(schema_->column_id(index.col_idx), block_id);
+  }
+  rowset_metadata_->SetBitmapIndexBlocks(index_blocks);
+
+  bitmap_indexes_.clear();
+  return Status::OK();
+}
+
 cfile::CFileWriter *DiskRowSetWriter::key_index_writer() {
   return ad_hoc_index_writer_ ? ad_hoc_index_writer_.get() : col_writer_->writer_for_col_idx(0);
 }
@@ -323,12 +701,15 @@ DiskRowSetWriter::~DiskRowSetWriter() {
 
 RollingDiskRowSetWriter::RollingDiskRowSetWriter(
     TabletMetadata* tablet_metadata, const Schema& schema,
-    BloomFilterSizing bloom_sizing, size_t target_rowset_size)
+    BloomFilterSizing bloom_sizing, size_t target_rowset_size,
+    fs::StorageTier tier)
     : state_(kInitialized),
       tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       schema_(schema),
       bloom_sizing_(bloom_sizing),
       target_rowset_size_(target_rowset_size),
+      tier_(tier),
+      cluster_id_(RowSetMetadata::kNoClusterId),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
@@ -353,17 +734,20 @@ Status RollingDiskRowSetWriter::RollWriter() {
   RETURN_NOT_OK(FinishCurrentWriter());
 
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_));
+  if (cluster_id_ != RowSetMetadata::kNoClusterId) {
+    cur_drs_metadata_->SetClusterId(cluster_id_);
+  }
 
-  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_,
+                                         tier_));
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
   unique_ptr<WritableBlock> undo_data_block;
   unique_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(CreateBlockOptions({ tablet_metadata_->tablet_id() }),
-                                   &redo_data_block));
+  const CreateBlockOptions block_opts({ tablet_metadata_->tablet_id(), tier_ });
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &undo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
   cur_undo_writer_.reset(new DeltaFileWriter(std::move(undo_data_block)));
@@ -523,7 +907,9 @@ DiskRowSet::DiskRowSet(shared_ptr<RowSetMetadata> rowset_metadata,
       log_anchor_registry_(log_anchor_registry),
       mem_trackers_(std::move(mem_trackers)),
       num_rows_(-1),
-      has_been_compacted_(false) {}
+      has_been_compacted_(false),
+      num_read_accesses_(0),
+      creation_time_(MonoTime::Now()) {}
 
 Status DiskRowSet::Open(const IOContext* io_context) {
   TRACE_EVENT0("tablet", "DiskRowSet::Open");
@@ -654,6 +1040,7 @@ Status DiskRowSet::NewMajorDeltaCompaction(const vector<ColumnId>& col_ids,
 Status DiskRowSet::NewRowIterator(const RowIteratorOptions& opts,
                                   unique_ptr<RowwiseIterator>* out) const {
   DCHECK(open_);
+  num_read_accesses_.fetch_add(1, std::memory_order_relaxed);
   shared_lock<rw_spinlock> l(component_lock_);
 
   shared_ptr<CFileSet::Iterator> base_iter(base_data_->NewIterator(opts.projection,
@@ -680,6 +1067,7 @@ Status DiskRowSet::MutateRow(Timestamp timestamp,
                              ProbeStats* stats,
                              OperationResultPB* result) {
   DCHECK(open_);
+  num_read_accesses_.fetch_add(1, std::memory_order_relaxed);
 #ifndef NDEBUG
   rowid_t num_rows;
   RETURN_NOT_OK(CountRows(io_context, &num_rows));
@@ -708,11 +1096,35 @@ Status DiskRowSet::MutateRow(Timestamp timestamp,
   return Status::OK();
 }
 
+Status DiskRowSet::DeleteRange(const EncodedKey* lower_bound,
+                               const EncodedKey* upper_bound,
+                               Timestamp timestamp,
+                               const IOContext* io_context) {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_);
+
+  rowid_t first_row = 0;
+  if (lower_bound) {
+    RETURN_NOT_OK(base_data_->FindFirstRowAtOrAfter(*lower_bound, io_context, &first_row));
+  }
+  rowid_t last_row;
+  if (upper_bound) {
+    RETURN_NOT_OK(base_data_->FindFirstRowAtOrAfter(*upper_bound, io_context, &last_row));
+  } else {
+    RETURN_NOT_OK(base_data_->CountRows(io_context, &last_row));
+  }
+  if (first_row < last_row) {
+    delta_tracker_->AddRangeTombstone({ timestamp, first_row, last_row });
+  }
+  return Status::OK();
+}
+
 Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
                                    const IOContext* io_context,
                                    bool* present,
                                    ProbeStats* stats) const {
   DCHECK(open_);
+  num_read_accesses_.fetch_add(1, std::memory_order_relaxed);
 #ifndef NDEBUG
   rowid_t num_rows;
   RETURN_NOT_OK(CountRows(io_context, &num_rows));
@@ -736,6 +1148,29 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                                    const IOContext* io_context,
+                                    bool* present,
+                                    ProbeStats* const* stats) const {
+  DCHECK(open_);
+  num_read_accesses_.fetch_add(probes.size(), std::memory_order_relaxed);
+  shared_lock<rw_spinlock> l(component_lock_);
+
+  vector<rowid_t> row_idxs(probes.size());
+  RETURN_NOT_OK(base_data_->CheckRowsPresent(probes, io_context, present,
+                                             row_idxs.data(), stats));
+  // The rows in the base data might have been deleted since.
+  for (size_t i = 0; i < probes.size(); i++) {
+    if (!present[i]) {
+      continue;
+    }
+    bool deleted = false;
+    RETURN_NOT_OK(delta_tracker_->CheckRowDeleted(row_idxs[i], io_context, &deleted, stats[i]));
+    present[i] = !deleted;
+  }
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(const IOContext* io_context, rowid_t *count) const {
   DCHECK(open_);
   rowid_t num_rows = num_rows_.load();
@@ -749,12 +1184,24 @@ Status DiskRowSet::CountRows(const IOContext* io_context, rowid_t *count) const
   return Status::OK();
 }
 
+double DiskRowSet::ReadAccessRate() const {
+  // Rowsets younger than a second are rated as if they were a second old, so
+  // that a handful of accesses to a fresh rowset doesn't dominate the rates of
+  // long-lived ones.
+  const double age_secs = std::max(1.0, (MonoTime::Now() - creation_time_).ToSeconds());
+  return num_read_accesses_.load(std::memory_order_relaxed) / age_secs;
+}
+
 Status DiskRowSet::CountLiveRows(uint64_t* count) const {
   DCHECK_GE(rowset_metadata_->live_row_count(), delta_tracker_->CountDeletedRows());
   *count = rowset_metadata_->live_row_count() - delta_tracker_->CountDeletedRows();
   return Status::OK();
 }
 
+bool DiskRowSet::HasRangeTombstones() const {
+  return rowset_metadata_->has_range_tombstones();
+}
+
 Status DiskRowSet::GetBounds(std::string* min_encoded_key,
                              std::string* max_encoded_key) const {
   DCHECK(open_);
@@ -874,6 +1321,16 @@ Status DiskRowSet::EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancient
 
 Status DiskRowSet::IsDeletedAndFullyAncient(Timestamp ancient_history_mark,
                                             bool* deleted_and_ancient) {
+  // Nothing can happen to the rows of a range delete after it: if an ancient
+  // one spans all of the rows, the whole history of the rowset is ancient.
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(nullptr, &num_rows));
+  for (const auto& t : rowset_metadata_->range_tombstones()) {
+    if (t.timestamp < ancient_history_mark && t.first_row == 0 && t.last_row >= num_rows) {
+      *deleted_and_ancient = true;
+      return Status::OK();
+    }
+  }
   uint64_t live_row_count = 0;
   RETURN_NOT_OK(CountLiveRows(&live_row_count));
   if (live_row_count > 0) {
@@ -888,6 +1345,131 @@ Status DiskRowSet::IsDeletedAndFullyAncient(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+Status DiskRowSet::IsExpired(const ColumnId& ttl_col_id,
+                             int64_t cutoff_micros,
+                             const IOContext* io_context,
+                             bool* expired) {
+  DCHECK(open_);
+  *expired = false;
+  // The base data has the latest values of the TTL column, unless they were
+  // changed by the REDO deltas.
+  if (delta_tracker_->MayHaveRedosChangingColumn(ttl_col_id)) {
+    return Status::OK();
+  }
+  shared_ptr<CFileSet> base_data;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    base_data = base_data_;
+  }
+  if (!base_data->has_data_for_column_id(ttl_col_id)) {
+    return Status::OK();
+  }
+  string max;
+  bool has_max;
+  RETURN_NOT_OK(base_data->GetColumnMaxValue(ttl_col_id, io_context, &max, &has_max));
+  if (!has_max || max.size() != sizeof(int64_t)) {
+    return Status::OK();
+  }
+  int64_t max_micros;
+  memcpy(&max_micros, max.data(), sizeof(max_micros));
+  *expired = max_micros < cutoff_micros;
+  return Status::OK();
+}
+
+Status DiskRowSet::ExportBaseData(const MvccSnapshot& snap,
+                                  const vector<ColumnId>& col_ids,
+                                  rowid_t start_row,
+                                  int64_t max_bytes,
+                                  const IOContext* io_context,
+                                  vector<cfile::ExportedCFile>* columns,
+                                  rowid_t* end_row) {
+  DCHECK(open_);
+  bool may_have_deltas;
+  RETURN_NOT_OK(delta_tracker_->MayHaveDeltasVisibleAt(snap, io_context, &may_have_deltas));
+  if (may_have_deltas) {
+    return Status::IllegalState("rowset has deltas visible at the snapshot", ToString());
+  }
+  shared_ptr<CFileSet> base_data;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    base_data = base_data_;
+  }
+  rowid_t num_rows;
+  RETURN_NOT_OK(base_data->CountRows(io_context, &num_rows));
+  if (PREDICT_FALSE(start_row > num_rows)) {
+    return Status::InvalidArgument(
+        strings::Substitute("rowset has only $0 rows, can't export from row $1",
+                            num_rows, start_row), ToString());
+  }
+
+  // Pick the end of the range from the blocks of the columns, without reading
+  // them. Each column is exported from its block with 'start_row' on, and
+  // 'next_blocks' are the first blocks of the columns past the range so far.
+  vector<vector<cfile::ExportedCFile::Block>> blocks(col_ids.size());
+  vector<size_t> next_blocks(col_ids.size(), 0);
+  int64_t num_bytes = 0;
+  for (int i = 0; i < col_ids.size(); i++) {
+    if (!base_data->has_data_for_column_id(col_ids[i])) {
+      return Status::IllegalState(
+          strings::Substitute("rowset has no data for column $0", col_ids[i]), ToString());
+    }
+    uint64_t dictionary_size;
+    RETURN_NOT_OK(base_data->ListExportableBlocks(col_ids[i], io_context, &blocks[i],
+                                                  &dictionary_size));
+    num_bytes += dictionary_size;
+    while (next_blocks[i] < blocks[i].size() &&
+           blocks[i][next_blocks[i]].first_row + blocks[i][next_blocks[i]].num_rows <=
+               start_row) {
+      next_blocks[i]++;
+    }
+  }
+  rowid_t end = start_row;
+  while (end < num_rows) {
+    // The range is extended to the end of the first of the blocks with row
+    // 'end', which takes the blocks of the columns which start there.
+    rowid_t boundary = num_rows;
+    int64_t bytes = 0;
+    for (int i = 0; i < col_ids.size(); i++) {
+      if (next_blocks[i] == blocks[i].size()) {
+        continue;
+      }
+      const auto& block = blocks[i][next_blocks[i]];
+      boundary = std::min<rowid_t>(boundary, block.first_row + block.num_rows);
+      if (end == start_row || block.first_row >= end) {
+        bytes += block.size;
+      }
+    }
+    if (end > start_row && num_bytes + bytes > max_bytes) {
+      break;
+    }
+    num_bytes += bytes;
+    end = boundary;
+    for (int i = 0; i < col_ids.size(); i++) {
+      if (next_blocks[i] < blocks[i].size() &&
+          blocks[i][next_blocks[i]].first_row + blocks[i][next_blocks[i]].num_rows <= end) {
+        next_blocks[i]++;
+      }
+    }
+  }
+
+  columns->clear();
+  columns->resize(col_ids.size());
+  for (int i = 0; i < col_ids.size(); i++) {
+    RETURN_NOT_OK(base_data->ExportColumn(col_ids[i], start_row, end, io_context,
+                                          &(*columns)[i]));
+  }
+  *end_row = end;
+  return Status::OK();
+}
+
+bool DiskRowSet::MayHaveChangesBetween(const MvccSnapshot& snap_to_exclude,
+                                       const MvccSnapshot& snap_to_include) const {
+  // The insertions of the base data's rows are recorded by the UNDO deltas,
+  // unless they're older than the ancient history mark, and so older than
+  // any diff scan's start.
+  return delta_tracker_->MayHaveDeltasBetween(snap_to_exclude, snap_to_include);
+}
+
 Status DiskRowSet::InitUndoDeltas(Timestamp ancient_history_mark,
                                   MonoTime deadline,
                                   const IOContext* io_context,
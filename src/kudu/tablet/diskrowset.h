@@ -26,6 +26,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <glog/logging.h>
@@ -34,6 +35,7 @@
 #include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -43,14 +45,18 @@
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet_mem_trackers.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/util/array_view.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/make_shared.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class Arena;
 class MonoTime;
 class RowBlock;
 class RowChangeList;
@@ -60,6 +66,7 @@ class Timestamp;
 namespace cfile {
 class BloomFileWriter;
 class CFileWriter;
+struct ExportedCFile;
 }
 
 namespace consensus {
@@ -90,8 +97,12 @@ class OperationResultPB;
 class DiskRowSetWriter {
  public:
   // TODO: document ownership of rowset_metadata
+  //
+  // The rowset's blocks are placed on 'tier', if the tablet's data directories
+  // have it.
   DiskRowSetWriter(RowSetMetadata* rowset_metadata, const Schema* schema,
-                   BloomFilterSizing bloom_sizing);
+                   BloomFilterSizing bloom_sizing,
+                   fs::StorageTier tier = fs::StorageTier::ANY);
 
   ~DiskRowSetWriter();
 
@@ -140,11 +151,29 @@ class DiskRowSetWriter {
   // (the ad-hoc writer for composite keys, otherwise the key column writer)
   cfile::CFileWriter *key_index_writer();
 
+  // Writes the sorted 'entries' of a column index to a new cfile, releasing
+  // its block to 'transaction'.
+  Status WriteIndexFile(const std::vector<Slice>& entries,
+                        fs::BlockCreationTransaction* transaction,
+                        BlockId* block_id);
+
+  // Sorts the entries of each secondary index and writes them to a new cfile.
+  Status FinishSecondaryIndexes(fs::BlockCreationTransaction* transaction);
+
+  // Encodes the bitmaps of each bitmap index and writes them to a new cfile.
+  Status FinishBitmapIndexes(fs::BlockCreationTransaction* transaction);
+
+  // Writes the distinct values of each column with a bloom filter to a new
+  // bloom file.
+  Status FinishColumnBlooms(fs::BlockCreationTransaction* transaction);
+
   RowSetMetadata* rowset_metadata_;
   const Schema* const schema_;
 
   BloomFilterSizing bloom_sizing_;
 
+  const fs::StorageTier tier_;
+
   bool finished_;
   rowid_t written_count_;
   std::unique_ptr<MultiColumnWriter> col_writer_;
@@ -153,6 +182,60 @@ class DiskRowSetWriter {
 
   // The last encoded key written.
   faststring last_encoded_key_;
+
+  // A secondary index of a non-key column, see --rowset_secondary_index_columns.
+  //
+  // Its entries are buffered until the rowset is finished, since they are
+  // written in value order rather than in row order.
+  struct SecondaryIndex {
+    int col_idx;
+    const KeyEncoder<faststring>* encoder;
+    // The key-encoded value of each non-null cell of the column, followed by
+    // the big-endian rowid of the cell. Allocated from 'secondary_index_arena_'.
+    std::vector<Slice> entries;
+  };
+  std::vector<SecondaryIndex> secondary_indexes_;
+  std::unique_ptr<Arena> secondary_index_arena_;
+
+  // A bitmap index of a low-cardinality non-key column, see
+  // --rowset_bitmap_index_columns.
+  struct BitmapIndex {
+    int col_idx;
+    const KeyEncoder<faststring>* encoder;
+    // The rowids of the rows of each distinct non-null value of the column,
+    // keyed by the key encoding of the value.
+    std::unordered_map<std::string, std::vector<rowid_t>> rowids_by_value;
+    // Whether the column has more distinct values than
+    // --rowset_bitmap_index_max_cardinality, in which case it isn't indexed
+    // and 'rowids_by_value' is empty.
+    bool too_many_values = false;
+  };
+  std::vector<BitmapIndex> bitmap_indexes_;
+
+  // A bloom filter of a high-cardinality non-key column, see
+  // --rowset_bloom_filter_columns.
+  struct ColumnBloom {
+    int col_idx;
+    const KeyEncoder<faststring>* encoder;
+    // The key-encoded value of each non-null cell of the column. Allocated
+    // from 'column_bloom_arena_'.
+    std::vector<Slice> values;
+  };
+  std::vector<ColumnBloom> column_blooms_;
+  std::unique_ptr<Arena> column_bloom_arena_;
+
+  // A non-key column expected to be sorted, see --rowset_sorted_columns.
+  struct SortedColumn {
+    int col_idx;
+    // Whether the cells written so far are non-null and non-decreasing.
+    bool sorted = true;
+    // The last cell written, in the format of the column's cells, backed by
+    // 'last_value'. Only valid while 'sorted' after the first block.
+    faststring last_value;
+    Slice last_slice;
+    const void* last_cell = nullptr;
+  };
+  std::vector<SortedColumn> sorted_columns_;
 };
 
 
@@ -165,12 +248,21 @@ class RollingDiskRowSetWriter {
  public:
   // Create a new rolling writer. The given 'tablet_metadata' must stay valid
   // for the lifetime of this writer, and is used to construct the new rowsets
-  // that this RollingDiskRowSetWriter creates.
+  // that this RollingDiskRowSetWriter creates. The blocks of the new rowsets
+  // are placed on 'tier', if the tablet's data directories have it.
   RollingDiskRowSetWriter(TabletMetadata* tablet_metadata, const Schema& schema,
                           BloomFilterSizing bloom_sizing,
-                          size_t target_rowset_size);
+                          size_t target_rowset_size,
+                          fs::StorageTier tier = fs::StorageTier::ANY);
   ~RollingDiskRowSetWriter();
 
+  // Marks the rowsets written by this writer as holding the rows of the
+  // cluster 'cluster_id'. Must be called before Open().
+  void set_cluster_id(int32_t cluster_id) {
+    DCHECK_EQ(state_, kInitialized);
+    cluster_id_ = cluster_id;
+  }
+
   Status Open();
 
   // The block is written to all column writers as well as the bloom filter,
@@ -247,6 +339,8 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  const fs::StorageTier tier_;
+  int32_t cluster_id_;
 
   std::unique_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -353,9 +447,18 @@ class DiskRowSet :
                    ProbeStats* stats,
                    OperationResultPB* result) override;
 
+  Status DeleteRange(const EncodedKey* lower_bound,
+                     const EncodedKey* upper_bound,
+                     Timestamp timestamp,
+                     const fs::IOContext* io_context) override;
+
   Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                          bool *present, ProbeStats* stats) const override;
 
+  Status CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                          const fs::IOContext* io_context,
+                          bool* present, ProbeStats* const* stats) const override;
+
   ////////////////////
   // Read functions.
   ////////////////////
@@ -374,6 +477,8 @@ class DiskRowSet :
   // Count the number of live rows in this DRS.
   virtual Status CountLiveRows(uint64_t* count) const override;
 
+  bool HasRangeTombstones() const override;
+
   // See RowSet::GetBounds(...)
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const override;
@@ -406,6 +511,28 @@ class DiskRowSet :
   Status IsDeletedAndFullyAncient(Timestamp ancient_history_mark,
                                   bool* deleted_and_ancient) override;
 
+  Status IsExpired(const ColumnId& ttl_col_id,
+                   int64_t cutoff_micros,
+                   const fs::IOContext* io_context,
+                   bool* expired) override;
+
+  // Exports the base data of the columns 'col_ids' as it's stored into
+  // 'columns', in the same order, if it's the state of the rowset at 'snap'.
+  // Returns IllegalState if a scan at 'snap' may have to apply deltas to the
+  // base data, or if a column has no base data, e.g. because it was added
+  // after the rowset was written.
+  //
+  // The rows from 'start_row' on are exported, up to '*end_row': the range is
+  // extended one block boundary at a time for as long as the blocks with its
+  // values fit in 'max_bytes', but always up to the first boundary.
+  Status ExportBaseData(const MvccSnapshot& snap,
+                        const std::vector<ColumnId>& col_ids,
+                        rowid_t start_row,
+                        int64_t max_bytes,
+                        const fs::IOContext* io_context,
+                        std::vector<cfile::ExportedCFile>* columns,
+                        rowid_t* end_row);
+
   Status InitUndoDeltas(Timestamp ancient_history_mark,
                         MonoTime deadline,
                         const fs::IOContext* io_context,
@@ -422,6 +549,11 @@ class DiskRowSet :
     return &compact_flush_lock_;
   }
 
+  double ReadAccessRate() const override;
+
+  bool MayHaveChangesBetween(const MvccSnapshot& snap_to_exclude,
+                             const MvccSnapshot& snap_to_include) const override;
+
   bool has_been_compacted() const override {
     return has_been_compacted_.load();
   }
@@ -503,6 +635,11 @@ class DiskRowSet :
   // and thus should not be scheduled for further compactions.
   std::atomic<bool> has_been_compacted_;
 
+  // Number of scans and key probes served by this rowset, and the time at which
+  // it started counting them. See ReadAccessRate().
+  mutable std::atomic<uint64_t> num_read_accesses_;
+  const MonoTime creation_time_;
+
   DISALLOW_COPY_AND_ASSIGN(DiskRowSet);
 };
 
@@ -91,6 +91,16 @@ class LocalTabletWriter {
     return Write(RowOperationsPB::UPDATE_IGNORE, row);
   }
 
+  // Deletes the rows whose keys are in [lower_bound, upper_bound). Bounds with
+  // no key column set are unbounded.
+  Status DeleteRange(const KuduPartialRow& lower_bound,
+                     const KuduPartialRow& upper_bound) {
+    std::vector<RowOp> ops;
+    ops.emplace_back(RowOperationsPB::DELETE_RANGE, &lower_bound);
+    ops.emplace_back(RowOperationsPB::RANGE_UPPER_BOUND, &upper_bound);
+    return WriteBatch(ops);
+  }
+
   // Perform a write against the local tablet.
   // Returns a bad Status if the applied operation had a per-row error.
   Status Write(RowOperationsPB::Type type,
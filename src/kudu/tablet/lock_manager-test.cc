@@ -50,6 +50,8 @@ using std::string;
 using std::thread;
 using std::vector;
 
+DECLARE_int32(lock_manager_max_free_entries);
+
 DEFINE_int32(num_test_threads, 10, "number of stress test client threads");
 DEFINE_int32(num_iterations, 1000, "number of iterations per client thread");
 
@@ -117,6 +119,29 @@ TEST_F(LockManagerTest, TestLockBatch) {
   }
 }
 
+// Test that the entries of released locks are reused correctly, including
+// in batches with duplicate keys and keys too long for their entries to be
+// reused.
+TEST_F(LockManagerTest, TestLockBatchReusingEntries) {
+  FLAGS_lock_manager_max_free_entries = 4;
+  const string long_key(100, 'x');
+  for (int i = 0; i < 3; i++) {
+    const string other_key = StringPrintf("k%d", i);
+    vector<Slice> keys = { "a", "b", "a", long_key, other_key, "c" };
+    {
+      ScopedRowLock l(&lock_manager_, kFakeTransaction, keys, LockManager::LOCK_EXCLUSIVE);
+      for (const auto& k : keys) {
+        VerifyAlreadyLocked(k);
+      }
+    }
+    for (const auto& k : keys) {
+      Slice key[] = { k };
+      ScopedRowLock l(&lock_manager_, kFakeTransaction, key, LockManager::LOCK_EXCLUSIVE);
+      ASSERT_TRUE(l.acquired());
+    }
+  }
+}
+
 TEST_F(LockManagerTest, TestRelockSameRow) {
   Slice key_a[] = {"a"};
   ScopedRowLock row_lock(&lock_manager_, kFakeTransaction, key_a, LockManager::LOCK_EXCLUSIVE);
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/lock_manager.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <limits>
 #include <memory>
@@ -26,6 +27,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 
 #include "kudu/common/txn_id.h"
@@ -39,12 +41,22 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(lock_manager_max_free_entries, 0,
+             "Maximum number of released row lock entries each tablet's lock "
+             "manager keeps for reuse, so that taking the locks of a large "
+             "write batch doesn't allocate an entry per row. Only entries of "
+             "short keys are reused. 0 disables the reuse.");
+TAG_FLAG(lock_manager_max_free_entries, experimental);
+TAG_FLAG(lock_manager_max_free_entries, runtime);
+
 using kudu::tserver::TabletServerErrorPB;
 using std::string;
 using std::unique_lock;
@@ -66,6 +78,11 @@ class LockEntry {
   explicit LockEntry(const Slice& key)
   : sem(1),
     recursion_(0) {
+    Reset(key);
+  }
+
+  // Sets the key of an unlocked entry which isn't in the table.
+  void Reset(const Slice& key) {
     key_hash_ = util_hash::CityHash64(reinterpret_cast<const char *>(key.data()), key.size());
     key_ = key;
     refs_ = 1;
@@ -113,6 +130,12 @@ class LockEntry {
   // buffer of the key, allocated on insertion by CopyKey()
   faststring key_buf_;
 
+  // Whether the entry may be kept for reuse once released: only if its key
+  // buffer didn't have to be allocated.
+  bool reusable() const {
+    return key_buf_.capacity() == faststring::kInitialCapacity;
+  }
+
   // The op currently holding the lock
   const OpState* holder_;
 };
@@ -126,7 +149,7 @@ class LockTable {
   };
 
  public:
-  LockTable() : mask_(0), size_(0), item_count_(0) {
+  LockTable() : mask_(0), size_(0), item_count_(0), free_head_(nullptr), free_count_(0) {
     Resize();
   }
 
@@ -138,6 +161,11 @@ class LockTable {
         DCHECK(p == nullptr) << "The entry " << p->ToString() << " was not released";
       }
     }
+    while (free_head_) {
+      auto* tmp = free_head_;
+      free_head_ = free_head_->ht_next_;
+      delete tmp;
+    }
   }
 
   vector<LockEntry*> GetLockEntries(ArrayView<Slice> keys);
@@ -175,8 +203,41 @@ class LockTable {
 
   void Resize();
 
+  // Keeps 'entry', which was removed from the table or never inserted, for
+  // reuse if there's room for it. Returns false if the caller must delete it.
+  // Must be called with 'lock_' held.
+  bool MaybeAddFreeEntry(LockEntry* entry, int64_t max_free_entries) {
+    if (free_count_ >= max_free_entries || !entry->reusable()) {
+      return false;
+    }
+    entry->ht_next_ = free_head_;
+    free_head_ = entry;
+    free_count_++;
+    return true;
+  }
+
+  // Blocks the loop over 'n' items into constant-sized batches, calling
+  // 'prepare' for each item of a batch and then 'process' for each, so that
+  // the memory accesses of a batch's items can overlap.
+  //
+  // The batch size was experimentally determined.
+  static constexpr int kBatchSize = 16;
+  template<class PrepareFunc, class ProcessFunc>
+  static void ForEachInBatches(int n, const PrepareFunc& prepare, const ProcessFunc& process) {
+    for (int start = 0; start < n; start += kBatchSize) {
+      const int end = std::min(n, start + kBatchSize);
+      for (int i = start; i < end; i++) {
+        prepare(i);
+      }
+      for (int i = start; i < end; i++) {
+        process(i);
+      }
+    }
+  }
+
  private:
   simple_spinlock lock_;
+  ScopedLockSiteRegistration lock_site_{&lock_, LockSite::kLockManager};
   // size - 1 used to lookup the bucket (hash & mask_)
   uint64_t mask_;
   // number of buckets in the table
@@ -185,28 +246,52 @@ class LockTable {
   int64_t item_count_;
   // table buckets
   unique_ptr<Bucket[]> buckets_;
+  // released entries kept for reuse, chained through their ht_next_ pointers
+  LockEntry* free_head_;
+  // number of entries chained from free_head_
+  int64_t free_count_;
 };
 
 vector<LockEntry*> LockTable::GetLockEntries(ArrayView<Slice> keys) {
   vector<LockEntry*> entries;
   entries.resize(keys.size());
+  const int64_t max_free_entries = FLAGS_lock_manager_max_free_entries;
+  int num_reused = 0;
+  if (max_free_entries > 0) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (; free_head_ && num_reused < keys.size(); num_reused++) {
+      entries[num_reused] = free_head_;
+      free_head_ = free_head_->ht_next_;
+      free_count_--;
+    }
+  }
   for (int i = 0; i < keys.size(); i++) {
-    entries[i] = new LockEntry(keys[i]);
+    if (i < num_reused) {
+      entries[i]->Reset(keys[i]);
+    } else {
+      entries[i] = new LockEntry(keys[i]);
+    }
   }
 
   vector<LockEntry*> to_delete;
 
-  // TODO(todd) prefetch the hash buckets
   {
     unique_lock<simple_spinlock> l(lock_);
-    for (int i = 0; i < entries.size(); i++) {
+    // The buckets are looked up again after the prefetch, since the table
+    // may have been resized in between.
+    ForEachInBatches(entries.size(), [&](int i) {
+      prefetch(reinterpret_cast<const char*>(FindBucket(entries[i]->key_hash_)),
+               PREFETCH_HINT_T0);
+    }, [&](int i) {
       LockEntry* new_entry = entries[i];
       Bucket* bucket = FindBucket(new_entry->key_hash_);
       LockEntry **node = FindSlot(bucket, new_entry->key_, new_entry->key_hash_);
       LockEntry* old_entry = *node;
       if (PREDICT_FALSE(old_entry != nullptr)) {
         old_entry->refs_++;
-        to_delete.push_back(entries[i]);
+        if (!MaybeAddFreeEntry(new_entry, max_free_entries)) {
+          to_delete.push_back(new_entry);
+        }
         entries[i] = old_entry;
       } else {
         new_entry->ht_next_ = nullptr;
@@ -218,7 +303,7 @@ vector<LockEntry*> LockTable::GetLockEntries(ArrayView<Slice> keys) {
           Resize();
         }
       }
-    }
+    });
   }
 
   for (auto* e : to_delete) delete e;
@@ -235,6 +320,7 @@ void LockTable::ReleaseLockEntries(ArrayView<LockEntry*> entries) {
   // Construct a linked list co-opting the ht_next pointers of the entries
   // to keep track of which objects need to be deleted.
   LockEntry* removed_head = nullptr;
+  const int64_t max_free_entries = FLAGS_lock_manager_max_free_entries;
 
   const auto& RemoveEntryFromBucket = [&](Bucket* bucket, LockEntry* entry) {
     LockEntry** node = FindEntry(bucket, entry);
@@ -242,9 +328,11 @@ void LockTable::ReleaseLockEntries(ArrayView<LockEntry*> entries) {
       if (--entry->refs_ > 0) return;
 
       *node = entry->ht_next_;
-      entry->ht_next_ = removed_head;
-      removed_head = entry;
       item_count_--;
+      if (!MaybeAddFreeEntry(entry, max_free_entries)) {
+        entry->ht_next_ = removed_head;
+        removed_head = entry;
+      }
     } else {
       LOG(DFATAL) << "Unable to find LockEntry on release";
     }
@@ -252,33 +340,13 @@ void LockTable::ReleaseLockEntries(ArrayView<LockEntry*> entries) {
 
   {
     unique_lock<simple_spinlock> l(lock_);
-
-    auto it = entries.begin();
-    int rem = entries.size();
-
-    // Manually block the loop into a series of constant-sized batches
-    // followed by one last variable-sized batch for the remainder.
-    //
-    // The batch size was experimentally determined.
-    static constexpr int kBatchSize = 16;
-    LockEntry* batch[kBatchSize];
     Bucket* buckets[kBatchSize];
-    const auto& ProcessBatch = [&](int n) {
-      for (int i = 0; i < n; i++) {
-        batch[i] = *it++;
-        buckets[i] = FindBucket(batch[i]->key_hash_);
-        prefetch(reinterpret_cast<const char*>(buckets[i]), PREFETCH_HINT_T0);
-      }
-      for (int i = 0; i < n; i++) {
-        RemoveEntryFromBucket(buckets[i], batch[i]);
-      }
-    };
-
-    while (rem >= kBatchSize) {
-      ProcessBatch(kBatchSize);
-      rem -= kBatchSize;
-    }
-    ProcessBatch(rem);
+    ForEachInBatches(entries.size(), [&](int i) {
+      buckets[i % kBatchSize] = FindBucket(entries[i]->key_hash_);
+      prefetch(reinterpret_cast<const char*>(buckets[i % kBatchSize]), PREFETCH_HINT_T0);
+    }, [&](int i) {
+      RemoveEntryFromBucket(buckets[i % kBatchSize], entries[i]);
+    });
   }
 
   // Actually free the memory outside the lock.
@@ -23,6 +23,7 @@
 #include "kudu/common/txn_id.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/semaphore.h"
@@ -115,6 +116,7 @@ class LockManager {
 
   // Lock to protect 'partition_lock_' and 'partition_lock_refs_'.
   simple_spinlock p_lock_;
+  ScopedLockSiteRegistration p_lock_site_{&p_lock_, LockSite::kLockManager};
 
   // If 'partition_lock_' has been held by a transaction,
   // 'partition_lock_refs_' keeps track of the number of times that the
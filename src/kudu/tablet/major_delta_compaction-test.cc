@@ -37,12 +37,14 @@
 #include "kudu/tablet/local_tablet_writer.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/rowset.h"
+#include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
 DECLARE_double(cfile_inject_corruption);
+DECLARE_int32(tablet_major_delta_compaction_num_column_groups);
 
 using std::shared_ptr;
 using std::string;
@@ -299,6 +301,54 @@ TEST_F(TestMajorDeltaCompaction, TestUndos) {
 }
 
 // Test that the delete REDO mutations are written back and not filtered out.
+// Test major compacting the columns split into groups, each group with its own
+// UNDO file.
+TEST_F(TestMajorDeltaCompaction, TestColumnGroups) {
+  FLAGS_tablet_major_delta_compaction_num_column_groups = 3;
+  const int kNumRows = 100;
+  NO_FATALS(WriteTestTablet(kNumRows));
+  ASSERT_OK(tablet()->Flush());
+
+  vector<shared_ptr<RowSet> > all_rowsets;
+  tablet()->GetRowSetsForTests(&all_rowsets);
+  shared_ptr<RowSet> rs = all_rowsets.front();
+
+  MvccSnapshot snap(*tablet()->mvcc_manager());
+  vector<ExpectedRow> old_state(expected_state_.begin(), expected_state_.end());
+  for (int i = 0; i < 2; i++) {
+    NO_FATALS(UpdateRows(kNumRows, i % 2 == 0));
+    ASSERT_OK(tablet()->FlushBiggestDMS());
+  }
+  ASSERT_EQ(0, rs->metadata()->undo_delta_blocks().size());
+
+  const vector<ColumnId> col_ids_to_compact = { schema_.column_id(1),
+                                                schema_.column_id(3),
+                                                schema_.column_id(4) };
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids_to_compact, rs));
+  ASSERT_EQ(0, rs->metadata()->redo_delta_blocks().size());
+  ASSERT_EQ(3, rs->metadata()->undo_delta_blocks().size());
+  NO_FATALS(VerifyData());
+  NO_FATALS(VerifyDataWithMvccAndExpectedState(snap, old_state));
+
+  // More groups than columns: there's a group per column.
+  FLAGS_tablet_major_delta_compaction_num_column_groups = 10;
+  NO_FATALS(UpdateRows(kNumRows, false));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids_to_compact, rs));
+  ASSERT_EQ(6, rs->metadata()->undo_delta_blocks().size());
+  NO_FATALS(VerifyData());
+  NO_FATALS(VerifyDataWithMvccAndExpectedState(snap, old_state));
+
+  // The deltas of deletes are compacted as a single group.
+  NO_FATALS(DeleteRows(kNumRows));
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  ASSERT_OK(tablet()->DoMajorDeltaCompaction(col_ids_to_compact, rs));
+  ASSERT_EQ(7, rs->metadata()->undo_delta_blocks().size());
+  ASSERT_EQ(1, rs->metadata()->redo_delta_blocks().size());
+  NO_FATALS(VerifyData());
+  NO_FATALS(VerifyDataWithMvccAndExpectedState(snap, old_state));
+}
+
 TEST_F(TestMajorDeltaCompaction, TestCarryDeletesOver) {
   const int kNumRows = 100;
 
@@ -61,6 +61,9 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_bool(memrowset_use_sparse_rows);
+DECLARE_int32(memrowset_num_shards);
+
 DEFINE_int32(roundtrip_num_rows, 10000,
              "Number of rows to use for the round-trip test");
 DEFINE_int32(num_scan_passes, 1,
@@ -396,6 +399,155 @@ TEST_F(TestMemRowSet, TestInsertAndIterateCompoundKey) {
   ASSERT_FALSE(iter->HasNext());
 }
 
+// Test that a MemRowSet spread over several shards behaves like a single tree.
+TEST_F(TestMemRowSet, TestShardedInsertAndIterate) {
+  FLAGS_memrowset_num_shards = 4;
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+
+  // Insert the rows out of order.
+  constexpr int kNumRows = 1000;
+  for (int i = 0; i < kNumRows; i++) {
+    int idx = (i * 37) % kNumRows;
+    ASSERT_OK(InsertRow(mrs.get(), StringPrintf("key %04d", idx), idx));
+  }
+  ASSERT_EQ(kNumRows, mrs->entry_count());
+  ASSERT_TRUE(InsertRow(mrs.get(), "key 0123", 0).IsAlreadyPresent());
+
+  // The shards are merged back into key order.
+  {
+    unique_ptr<MemRowSet::Iterator> iter(mrs->NewIterator());
+    ASSERT_OK(iter->Init(nullptr));
+    for (int i = 0; i < kNumRows; i++) {
+      ASSERT_TRUE(iter->HasNext());
+      EXPECT_EQ(StringPrintf(R"((string key="key %04d", uint32 val=%d))", i, i),
+                schema_.DebugRow(iter->GetCurrentRow()));
+      iter->Next();
+    }
+    ASSERT_FALSE(iter->HasNext());
+  }
+
+  // Point lookups, seeks and mutations find the right shard.
+  bool present;
+  ASSERT_OK(CheckRowPresent(*mrs, "key 0500", &present));
+  ASSERT_TRUE(present);
+  ASSERT_OK(CheckRowPresent(*mrs, "key 05000", &present));
+  ASSERT_FALSE(present);
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(mrs.get(), "key 0500", 12345, &result));
+  NO_FATALS(CheckValue(mrs, "key 0500", R"((string key="key 0500", uint32 val=12345))"));
+  NO_FATALS(CheckValue(mrs, "key 0999", R"((string key="key 0999", uint32 val=999))"));
+
+  RowIteratorOptions opts;
+  opts.projection = &schema_;
+  opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllOps();
+  ASSERT_EQ(kNumRows, ScanAndCount(mrs.get(), opts));
+}
+
+// A MemRowSet storing its rows sparsely returns the same rows as one storing
+// them as ContiguousRows, in less memory when most of their cells are null.
+TEST_F(TestMemRowSet, TestSparseRows) {
+  constexpr int kNumValueCols = 50;
+  constexpr int kNumRows = 500;
+  SchemaBuilder sb;
+  ASSERT_OK(sb.AddKeyColumn("key", INT32));
+  for (int i = 0; i < kNumValueCols; i++) {
+    ASSERT_OK(sb.AddNullableColumn(StringPrintf("c%d", i), i % 2 == 0 ? INT64 : STRING));
+  }
+  const Schema schema = sb.Build();
+  const Schema key_schema = schema.CreateKeyProjection();
+  Schema projection;
+  ASSERT_OK(schema.CreateProjectionByNames({ "c1", "key", "c30" }, &projection));
+
+  const auto fill_mrs = [&](shared_ptr<MemRowSet>* mrs) {
+    ASSERT_OK(MemRowSet::Create(0, schema, log_anchor_registry_.get(),
+                                MemTracker::GetRootTracker(), mrs));
+    // Each row has a single non-null value column.
+    for (int i = 0; i < kNumRows; i++) {
+      ScopedOp op(&mvcc_, clock_.Now());
+      RowBuilder rb(&schema);
+      rb.AddInt32(i);
+      const string str_val = StringPrintf("hello %d", i);
+      for (int col = 0; col < kNumValueCols; col++) {
+        if (col != i % kNumValueCols) {
+          rb.AddNull();
+        } else if (col % 2 == 0) {
+          rb.AddInt64(i);
+        } else {
+          rb.AddString(str_val);
+        }
+      }
+      op.StartApplying();
+      ASSERT_OK((*mrs)->Insert(op.timestamp(), rb.row(), op_id_));
+      op.FinishApplying();
+    }
+
+    // Set a null cell of the first row.
+    ScopedOp op(&mvcc_, clock_.Now());
+    op.StartApplying();
+    mutation_buf_.clear();
+    RowChangeListEncoder update(&mutation_buf_);
+    Slice new_val("updated");
+    update.AddColumnUpdate(schema.column(31), schema.column_id(31), &new_val);
+    RowBuilder rb(&key_schema);
+    rb.AddInt32(0);
+    Arena arena(64);
+    RowSetKeyProbe probe(rb.row(), &arena);
+    ProbeStats stats;
+    OperationResultPB result;
+    ASSERT_OK((*mrs)->MutateRow(op.timestamp(), probe, RowChangeList(mutation_buf_),
+                                op_id_, nullptr, &stats, &result));
+    op.FinishApplying();
+  };
+  const auto scan_mrs = [&](const shared_ptr<MemRowSet>& mrs,
+                            const Schema* projection, vector<string>* rows) {
+    RowIteratorOptions opts;
+    opts.projection = projection;
+    opts.snap_to_include = MvccSnapshot::CreateSnapshotIncludingAllOps();
+    unique_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(opts));
+    ASSERT_OK(iter->Init(nullptr));
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+  };
+
+  shared_ptr<MemRowSet> dense_mrs;
+  NO_FATALS(fill_mrs(&dense_mrs));
+  ASSERT_EQ(nullptr, dense_mrs->sparse_layout());
+  FLAGS_memrowset_use_sparse_rows = true;
+  shared_ptr<MemRowSet> sparse_mrs;
+  NO_FATALS(fill_mrs(&sparse_mrs));
+  ASSERT_NE(nullptr, sparse_mrs->sparse_layout());
+  ASSERT_LT(sparse_mrs->memory_footprint() * 2, dense_mrs->memory_footprint());
+
+  for (const Schema* proj : vector<const Schema*>{ &schema, &projection }) {
+    SCOPED_TRACE(proj->ToString());
+    vector<string> dense_rows;
+    NO_FATALS(scan_mrs(dense_mrs, proj, &dense_rows));
+    vector<string> sparse_rows;
+    NO_FATALS(scan_mrs(sparse_mrs, proj, &sparse_rows));
+    ASSERT_EQ(kNumRows, sparse_rows.size());
+    ASSERT_EQ(dense_rows, sparse_rows);
+  }
+  vector<string> rows;
+  NO_FATALS(scan_mrs(sparse_mrs, &projection, &rows));
+  EXPECT_EQ(R"((string c1=NULL, int32 key=0, int64 c30=NULL))", rows[0]);
+  EXPECT_EQ(R"((string c1="hello 1", int32 key=1, int64 c30=NULL))", rows[1]);
+  EXPECT_EQ(R"((string c1=NULL, int32 key=30, int64 c30=30))", rows[30]);
+
+  // The rows can also be read cell by cell.
+  unique_ptr<MemRowSet::Iterator> dense_iter(dense_mrs->NewIterator());
+  unique_ptr<MemRowSet::Iterator> sparse_iter(sparse_mrs->NewIterator());
+  ASSERT_OK(dense_iter->Init(nullptr));
+  ASSERT_OK(sparse_iter->Init(nullptr));
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_TRUE(sparse_iter->HasNext());
+    ASSERT_EQ(schema.DebugRow(dense_iter->GetCurrentRow()),
+              schema.DebugRow(sparse_iter->GetCurrentRow()));
+    dense_iter->Next();
+    sparse_iter->Next();
+  }
+}
+
 // Test that inserting duplicate key data fails with Status::AlreadyPresent
 TEST_F(TestMemRowSet, TestInsertDuplicate) {
   shared_ptr<MemRowSet> mrs;
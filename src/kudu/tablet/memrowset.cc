@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -44,7 +45,9 @@
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/txn_metadata.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/hash_util.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/memory.h"
 
@@ -52,6 +55,38 @@ DEFINE_bool(mrs_use_codegen, true, "whether the memrowset should use code "
             "generation for iteration");
 TAG_FLAG(mrs_use_codegen, hidden);
 
+DEFINE_int32(memrowset_num_shards, 1,
+             "Number of CBTree shards each MemRowSet spreads its rows over, by "
+             "the hash of their keys. With more shards, concurrent writers to a "
+             "tablet contend less on the upper nodes of the tree, at the cost "
+             "of merging the shards when scanning or flushing the MemRowSet. "
+             "Applies to MemRowSets created after the value is changed.");
+DEFINE_validator(memrowset_num_shards,
+                 [](const char* /*n*/, int32_t v) { return v >= 1 && v <= 64; });
+TAG_FLAG(memrowset_num_shards, experimental);
+TAG_FLAG(memrowset_num_shards, runtime);
+
+DEFINE_bool(memstore_arena_use_huge_pages, false,
+            "Whether the arenas of the MemRowSets and DeltaMemStores allocate "
+            "their memory in huge page sized chunks, and advise the kernel to "
+            "back them with transparent huge pages. This reduces TLB misses "
+            "when traversing large in-memory stores, at the cost of rounding "
+            "up their footprint to a multiple of the huge page size. Applies "
+            "to stores created after the value is changed.");
+TAG_FLAG(memstore_arena_use_huge_pages, experimental);
+TAG_FLAG(memstore_arena_use_huge_pages, runtime);
+
+DEFINE_bool(memrowset_use_sparse_rows, false,
+            "Whether MemRowSets store their rows sparsely, with only the cells "
+            "of the non-null columns, rather than with a cell for every column. "
+            "This saves memory for wide tables whose nullable columns are mostly "
+            "null, so their MemRowSets are flushed less often, at the cost of "
+            "locating the cells when scanning the rows. Only applies to tables "
+            "with nullable columns, and to MemRowSets created after the value "
+            "is changed.");
+TAG_FLAG(memrowset_use_sparse_rows, experimental);
+TAG_FLAG(memrowset_use_sparse_rows, runtime);
+
 using kudu::consensus::OpId;
 using kudu::fs::IOContext;
 using kudu::log::LogAnchorRegistry;
@@ -66,6 +101,71 @@ namespace tablet {
 
 static const int kInitialArenaSize = 16;
 
+SparseRowLayout::SparseRowLayout(const Schema& schema)
+    : bitmap_size_(BitmapSize(schema.num_columns())) {
+  cell_sizes_.reserve(schema.num_columns());
+  nullable_.reserve(schema.num_columns());
+  binary_.reserve(schema.num_columns());
+  for (const auto& col : schema.columns()) {
+    cell_sizes_.push_back(col.type_info()->size());
+    nullable_.push_back(col.is_nullable());
+    binary_.push_back(col.type_info()->physical_type() == BINARY);
+  }
+}
+
+size_t SparseRowLayout::RowSize(const ConstContiguousRow& row) const {
+  size_t size = bitmap_size_;
+  for (size_t i = 0; i < cell_sizes_.size(); i++) {
+    if (!(nullable_[i] && row.is_null(i))) {
+      size += cell_sizes_[i];
+    }
+  }
+  return size;
+}
+
+namespace {
+
+// A row of a MemRowSet in the sparse layout whose cells have been located
+// up front, so that a RowProjector can read them without walking the row for
+// each cell.
+class SparseMRSRow {
+ public:
+  typedef ContiguousRowCell<SparseMRSRow> Cell;
+
+  // 'offsets' holds the offsets of the cells of the row's columns, at least
+  // up to the last one read.
+  SparseMRSRow(const MRSRow& row, const uint32_t* offsets)
+      : row_(row),
+        offsets_(offsets) {
+  }
+
+  const Schema* schema() const {
+    return row_.schema();
+  }
+
+  bool is_null(size_t col_idx) const {
+    return row_.is_null(col_idx);
+  }
+
+  const uint8_t* cell_ptr(size_t col_idx) const {
+    return row_.row_data() + offsets_[col_idx];
+  }
+
+  const uint8_t* nullable_cell_ptr(size_t col_idx) const {
+    return is_null(col_idx) ? nullptr : cell_ptr(col_idx);
+  }
+
+  Cell cell(size_t col_idx) const {
+    return Cell(this, col_idx);
+  }
+
+ private:
+  const MRSRow& row_;
+  const uint32_t* offsets_;
+};
+
+} // anonymous namespace
+
 bool MRSRow::IsGhost() const {
   const Mutation *mut_tail = header_->redo_tail;
   if (mut_tail == nullptr) {
@@ -91,6 +191,19 @@ shared_ptr<MemTracker> CreateMemTrackerForMemRowSet(
 
 } // anonymous namespace
 
+BufferAllocator* MemStoreBufferAllocator() {
+  if (FLAGS_memstore_arena_use_huge_pages) {
+    return HugePageBufferAllocator::Get();
+  }
+  return HeapBufferAllocator::Get();
+}
+
+void SetMemStoreArenaMaxBufferSize(ThreadSafeMemoryTrackingArena* arena) {
+  if (FLAGS_memstore_arena_use_huge_pages) {
+    arena->SetMaxBufferSize(HugePageBufferAllocator::kHugePageSize);
+  }
+}
+
 Status MemRowSet::Create(int64_t id,
                          const Schema &schema,
                          LogAnchorRegistry* log_anchor_registry,
@@ -126,13 +239,14 @@ MemRowSet::MemRowSet(int64_t id,
                      shared_ptr<MemTracker> parent_tracker)
   : id_(id),
     schema_(schema),
+    sparse_layout_(FLAGS_memrowset_use_sparse_rows && schema.has_nullables() ?
+                   new SparseRowLayout(schema) : nullptr),
     txn_id_(txn_id),
     txn_metadata_(std::move(txn_metadata)),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(),
+        MemStoreBufferAllocator(),
         CreateMemTrackerForMemRowSet(id, std::move(parent_tracker)))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, allocator_)),
-    tree_(arena_),
     debug_insert_count_(0),
     debug_update_count_(0),
     anchorer_(log_anchor_registry, Substitute("MemRowSet-$0$1", id_, txn_id_ ?
@@ -140,6 +254,12 @@ MemRowSet::MemRowSet(int64_t id,
     has_been_compacted_(false),
     live_row_count_(0) {
   CHECK(schema.has_column_ids());
+  SetMemStoreArenaMaxBufferSize(arena_.get());
+  const int num_shards = FLAGS_memrowset_num_shards;
+  trees_.reserve(num_shards);
+  for (int i = 0; i < num_shards; i++) {
+    trees_.emplace_back(new MSBTree(arena_));
+  }
   ANNOTATE_BENIGN_RACE(&debug_insert_count_, "insert count isnt accurate");
   ANNOTATE_BENIGN_RACE(&debug_update_count_, "update count isnt accurate");
 }
@@ -147,6 +267,14 @@ MemRowSet::MemRowSet(int64_t id,
 MemRowSet::~MemRowSet() {
 }
 
+MemRowSet::MSBTree* MemRowSet::TreeForKey(const Slice& encoded_key) const {
+  if (PREDICT_TRUE(trees_.size() == 1)) {
+    return trees_[0].get();
+  }
+  uint64_t h = HashUtil::FastHash64(encoded_key.data(), encoded_key.size(), 0);
+  return trees_[h % trees_.size()].get();
+}
+
 Status MemRowSet::DebugDump(vector<string> *lines) {
   unique_ptr<Iterator> iter(NewIterator());
   RETURN_NOT_OK(iter->Init(nullptr));
@@ -181,7 +309,7 @@ Status MemRowSet::Insert(Timestamp timestamp,
     Slice enc_key(enc_key_buf);
 
     btree::PreparedMutation<MSBTreeTraits> mutation(enc_key);
-    mutation.Prepare(&tree_);
+    mutation.Prepare(TreeForKey(enc_key));
 
     // TODO: for now, the key ends up stored doubly --
     // once encoded in the btree key, and again in the value
@@ -202,7 +330,7 @@ Status MemRowSet::Insert(Timestamp timestamp,
 
     // Copy the non-encoded key onto the stack since we need
     // to mutate it when we relocate its Slices into our arena.
-    DEFINE_MRSROW_ON_STACK(this, mrsrow, mrsrow_slice);
+    DEFINE_MRSROW_ON_STACK(this, row, mrsrow, mrsrow_slice);
     mrsrow.header_->insertion_timestamp = timestamp;
     mrsrow.header_->redo_head = nullptr;
     mrsrow.header_->redo_tail = nullptr;
@@ -250,7 +378,7 @@ Status MemRowSet::MutateRow(Timestamp timestamp,
                             OperationResultPB *result) {
   {
     btree::PreparedMutation<MSBTreeTraits> mutation(probe.encoded_key_slice());
-    mutation.Prepare(&tree_);
+    mutation.Prepare(TreeForKey(probe.encoded_key_slice()));
 
     if (!mutation.exists()) {
       return Status::NotFound("not in memrowset");
@@ -299,7 +427,7 @@ Status MemRowSet::CheckRowPresent(const RowSetKeyProbe &probe, const IOContext*
   stats->mrs_consulted++;
 
   btree::PreparedMutation<MSBTreeTraits> mutation(probe.encoded_key_slice());
-  mutation.Prepare(const_cast<MSBTree *>(&tree_));
+  mutation.Prepare(TreeForKey(probe.encoded_key_slice()));
 
   if (!mutation.exists()) {
     *present = false;
@@ -320,7 +448,14 @@ Status MemRowSet::CheckRowPresent(const RowSetKeyProbe &probe, const IOContext*
 }
 
 MemRowSet::Iterator *MemRowSet::NewIterator(const RowIteratorOptions& opts) const {
-  return new MemRowSet::Iterator(shared_from_this(), tree_.NewIterator(), opts);
+  vector<unique_ptr<MSBTIter>> iters;
+  iters.reserve(trees_.size());
+  for (const auto& tree : trees_) {
+    iters.emplace_back(tree->NewIterator());
+  }
+  return new MemRowSet::Iterator(shared_from_this(),
+                                 new ShardMergeIterator(std::move(iters)),
+                                 opts);
 }
 
 MemRowSet::Iterator *MemRowSet::NewIterator() const {
@@ -349,6 +484,42 @@ Status MemRowSet::GetBounds(string *min_encoded_key,
   return Status::NotSupported("");
 }
 
+MemRowSet::ShardMergeIterator::ShardMergeIterator(vector<unique_ptr<MSBTIter>> iters)
+    : iters_(std::move(iters)),
+      cur_(nullptr) {
+  DCHECK(!iters_.empty());
+}
+
+bool MemRowSet::ShardMergeIterator::SeekToStart() {
+  for (const auto& iter : iters_) {
+    iter->SeekToStart();
+  }
+  PickCurrent();
+  return IsValid();
+}
+
+bool MemRowSet::ShardMergeIterator::SeekAtOrAfter(const Slice& key, bool* exact) {
+  *exact = false;
+  for (const auto& iter : iters_) {
+    bool shard_exact = false;
+    if (iter->SeekAtOrAfter(key, &shard_exact)) {
+      *exact |= shard_exact;
+    }
+  }
+  PickCurrent();
+  return IsValid();
+}
+
+void MemRowSet::ShardMergeIterator::PickCurrent() {
+  cur_ = nullptr;
+  for (const auto& iter : iters_) {
+    if (iter->IsValid() &&
+        (cur_ == nullptr || iter->GetCurrentKey() < cur_->GetCurrentKey())) {
+      cur_ = iter.get();
+    }
+  }
+}
+
 // Virtual interface allows two possible row projector implementations
 class MemRowSet::Iterator::MRSRowProjector {
  public:
@@ -394,12 +565,12 @@ class MRSRowProjectorImpl : public MRSRowProjector {
   unique_ptr<ActualProjector> actual_;
 };
 
-// If codegen is enabled, then generates a codegen::RowProjector;
-// otherwise makes a regular one.
+// If codegen is enabled and the rows are ContiguousRows, then generates a
+// codegen::RowProjector; otherwise makes a regular one.
 unique_ptr<MRSRowProjector> GenerateAppropriateProjector(
-  const Schema* base, const Schema* projection) {
+  const Schema* base, const Schema* projection, bool sparse_rows) {
   // Attempt code-generated implementation
-  if (FLAGS_mrs_use_codegen) {
+  if (FLAGS_mrs_use_codegen && !sparse_rows) {
     unique_ptr<codegen::RowProjector> actual;
     if (codegen::CompilationManager::GetSingleton()->RequestRowProjector(
           base, projection, &actual)) {
@@ -417,15 +588,20 @@ unique_ptr<MRSRowProjector> GenerateAppropriateProjector(
 } // anonymous namespace
 
 MemRowSet::Iterator::Iterator(const std::shared_ptr<const MemRowSet>& mrs,
-                              MemRowSet::MSBTIter* iter,
+                              MemRowSet::ShardMergeIterator* iter,
                               RowIteratorOptions opts)
     : memrowset_(mrs),
       iter_(iter),
       opts_(std::move(opts)),
-      projector_(
-          GenerateAppropriateProjector(&mrs->schema_nonvirtual(), opts_.projection)),
+      projector_(GenerateAppropriateProjector(&mrs->schema_nonvirtual(), opts_.projection,
+                                              mrs->sparse_layout() != nullptr)),
       delta_projector_(&mrs->schema_nonvirtual(), opts_.projection),
+      sparse_projector_(mrs->sparse_layout() ?
+                        new RowProjector(&mrs->schema_nonvirtual(), opts_.projection) :
+                        nullptr),
       projection_vc_is_deleted_idx_(opts_.projection->first_is_deleted_virtual_column_idx()),
+      txn_insert_excluded_(false),
+      txn_insert_included_(false),
       state_(kUninitialized) {
   // TODO(todd): various code assumes that a newly constructed iterator
   // is pointed at the beginning of the dataset. This causes a redundant
@@ -441,6 +617,30 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
 
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
+  if (sparse_projector_) {
+    RETURN_NOT_OK(sparse_projector_->Init());
+    size_t num_cols = 0;
+    for (const auto& mapping : sparse_projector_->base_cols_mapping()) {
+      num_cols = std::max(num_cols, mapping.second + 1);
+    }
+    sparse_offsets_.resize(num_cols);
+  }
+
+  // The rows of a transaction's MemRowSet are visible or not as a whole, and
+  // whether they are can't change over the iterator's lifetime: a commit
+  // which isn't in the snapshots yet never will be. Evaluate this once rather
+  // than for every row, and skip the scan entirely if none of the rows can be
+  // returned.
+  const auto& txn_meta = memrowset_->txn_metadata();
+  if (txn_meta) {
+    txn_insert_excluded_ = opts_.snap_to_exclude &&
+        opts_.snap_to_exclude->IsCommitted(*txn_meta.get());
+    txn_insert_included_ = opts_.snap_to_include.IsCommitted(*txn_meta.get());
+    if (!txn_insert_excluded_ && !txn_insert_included_) {
+      state_ = kFinished;
+      return Status::OK();
+    }
+  }
 
   if (spec && spec->lower_bound_key()) {
     bool exact;
@@ -520,6 +720,7 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
 
 Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
   *fetched = 0;
+  const bool is_txn = memrowset_->txn_metadata() != nullptr;
   do {
     RowBlockRow dst_row = dst->row(*fetched);
 
@@ -550,18 +751,14 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
     // range (i.e. the insert was "excluded").  However, subsequent mutations
     // may be inside the time range, so we must still project the row and walk
     // its mutation list.
-    const auto& txn_meta = memrowset_->txn_metadata();
-    bool insert_excluded = opts_.snap_to_exclude &&
-        // TODO(awong): if we find this to be too slow, we should be able to
-        // compute IsCommitted() once per iterator at construction time.
-        (txn_meta ? opts_.snap_to_exclude->IsCommitted(*txn_meta.get()) :
-                    opts_.snap_to_exclude->IsApplied(row.insertion_timestamp()));
+    bool insert_excluded = is_txn ? txn_insert_excluded_ :
+        (opts_.snap_to_exclude && opts_.snap_to_exclude->IsApplied(row.insertion_timestamp()));
     bool unset_in_sel_vector;
     ApplyStatus apply_status;
     if (insert_excluded ||
-        (txn_meta ? opts_.snap_to_include.IsCommitted(*txn_meta.get()) :
-                    opts_.snap_to_include.IsApplied(row.insertion_timestamp()))) {
-      RETURN_NOT_OK(projector_->ProjectRowForRead(row, &dst_row, dst->arena()));
+        (is_txn ? txn_insert_included_ :
+                  opts_.snap_to_include.IsApplied(row.insertion_timestamp()))) {
+      RETURN_NOT_OK(ProjectRowForRead(row, &dst_row, dst->arena()));
 
       // Roll-forward MVCC for committed updates.
       Mutation* redo_head = reinterpret_cast<Mutation*>(
@@ -697,6 +894,19 @@ Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
   return Status::OK();
 }
 
+Status MemRowSet::Iterator::ProjectRowForRead(const MRSRow& src_row,
+                                              RowBlockRow* dst_row,
+                                              Arena* dst_arena) {
+  const SparseRowLayout* sparse_layout = memrowset_->sparse_layout();
+  if (PREDICT_TRUE(!sparse_layout)) {
+    return projector_->ProjectRowForRead(src_row, dst_row, dst_arena);
+  }
+  // Locate the cells of the projected columns in a single walk of the row.
+  sparse_layout->CellOffsets(src_row.row_data(), sparse_offsets_.size(), sparse_offsets_.data());
+  return sparse_projector_->ProjectRowForRead(SparseMRSRow(src_row, sparse_offsets_.data()),
+                                              dst_row, dst_arena);
+}
+
 // Copy the current MRSRow to the 'dst_row' provided using the iterator projection schema.
 Status MemRowSet::Iterator::GetCurrentRow(RowBlockRow* dst_row,
                                           Arena* row_arena,
@@ -752,7 +962,7 @@ Status MemRowSet::Iterator::GetCurrentRow(RowBlockRow* dst_row,
   }
 
   // Project the Row
-  return projector_->ProjectRowForRead(src_row, dst_row, row_arena);
+  return ProjectRowForRead(src_row, dst_row, row_arena);
 }
 
 } // namespace tablet
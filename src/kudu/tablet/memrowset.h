@@ -43,6 +43,7 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/make_shared.h"
 #include "kudu/util/memory/arena.h"
@@ -93,6 +94,105 @@ class Mutation;
 class OperationResultPB;
 class TxnMetadata;
 
+// The layout of the rows of a MemRowSet created with
+// --memrowset_use_sparse_rows: the null bitmap of the row comes first,
+// followed by the cells of its non-null columns only, packed in column order.
+// The rows of wide schemas whose nullable columns are mostly null take a
+// fraction of the space of their ContiguousRow layout, at the cost of walking
+// the preceding columns to find a cell.
+//
+// The sizes and nullability of the schema's cells are precomputed, so the
+// walk doesn't need to go through the column schemas.
+class SparseRowLayout {
+ public:
+  explicit SparseRowLayout(const Schema& schema);
+
+  // Returns the number of bytes 'row', which has the layout's schema, takes
+  // in this layout.
+  size_t RowSize(const ConstContiguousRow& row) const;
+
+  // Copies 'row' to 'dst', of RowSize(row) bytes, in this layout. The data
+  // its cells refer to is copied to 'arena'.
+  template<class ArenaType>
+  Status EncodeRow(const ConstContiguousRow& row, uint8_t* dst, ArenaType* arena) const;
+
+  bool is_null(const uint8_t* row_data, size_t col_idx) const {
+    return nullable_[col_idx] && BitmapTest(row_data, col_idx);
+  }
+
+  // Returns the offset of the cell of column 'col_idx' in 'row_data', by
+  // walking the preceding columns. Use CellOffsets() to locate many cells.
+  size_t cell_offset(const uint8_t* row_data, size_t col_idx) const {
+    size_t offset = bitmap_size_;
+    for (size_t i = 0; i < col_idx; i++) {
+      if (!is_null(row_data, i)) {
+        offset += cell_sizes_[i];
+      }
+    }
+    return offset;
+  }
+
+  // Sets the first 'num_cols' entries of 'offsets' to the offsets of the cells
+  // of the first 'num_cols' columns of 'row_data', in a single walk.
+  void CellOffsets(const uint8_t* row_data, size_t num_cols, uint32_t* offsets) const {
+    uint32_t offset = bitmap_size_;
+    for (size_t i = 0; i < num_cols; i++) {
+      offsets[i] = offset;
+      if (!is_null(row_data, i)) {
+        offset += cell_sizes_[i];
+      }
+    }
+  }
+
+ private:
+  const uint32_t bitmap_size_;
+  std::vector<uint32_t> cell_sizes_;
+  std::vector<uint8_t> nullable_;
+  std::vector<uint8_t> binary_;
+};
+
+template<class ArenaType>
+Status SparseRowLayout::EncodeRow(const ConstContiguousRow& row,
+                                  uint8_t* dst,
+                                  ArenaType* arena) const {
+  const size_t num_cols = cell_sizes_.size();
+  // As in RelocateIndirectDataToArena(), allocate the indirect data of all
+  // the cells at once.
+  size_t indirect_size = 0;
+  for (size_t i = 0; i < num_cols; i++) {
+    if (binary_[i] && !(nullable_[i] && row.is_null(i))) {
+      indirect_size += reinterpret_cast<const Slice*>(row.cell_ptr(i))->size();
+    }
+  }
+  uint8_t* indirect = nullptr;
+  if (indirect_size > 0) {
+    indirect = static_cast<uint8_t*>(arena->AllocateBytes(indirect_size));
+    if (PREDICT_FALSE(indirect == nullptr)) {
+      return Status::IOError("unable to copy the row's data to the arena");
+    }
+  }
+
+  memset(dst, 0, bitmap_size_);
+  uint8_t* cell = dst + bitmap_size_;
+  for (size_t i = 0; i < num_cols; i++) {
+    if (nullable_[i] && row.is_null(i)) {
+      BitmapSet(dst, i);
+      continue;
+    }
+    if (binary_[i]) {
+      const Slice* src = reinterpret_cast<const Slice*>(row.cell_ptr(i));
+      memcpy(indirect, src->data(), src->size());
+      Slice relocated(indirect, src->size());
+      memcpy(cell, &relocated, sizeof(relocated));
+      indirect += src->size();
+    } else {
+      memcpy(cell, row.cell_ptr(i), cell_sizes_[i]);
+    }
+    cell += cell_sizes_[i];
+  }
+  return Status::OK();
+}
+
 // The value stored in the CBTree for a single row.
 class MRSRow {
  public:
@@ -123,27 +223,28 @@ class MRSRow {
 
   const uint8_t* row_data() const { return row_slice_.data(); }
 
-  bool is_null(size_t col_idx) const {
-    return ContiguousRowHelper::is_null(*schema(), row_slice_.data(), col_idx);
+  // The accessors below work with either layout of the MemRowSet's rows.
+  // Finding a cell of a row in the sparse layout walks the row's preceding
+  // columns: see SparseRowLayout::CellOffsets() to locate many of its cells.
+  bool is_null(size_t col_idx) const;
+
+  const uint8_t *cell_ptr(size_t col_idx) const;
+
+  const uint8_t *nullable_cell_ptr(size_t col_idx) const {
+    return is_null(col_idx) ? nullptr : cell_ptr(col_idx);
   }
 
+  // Rows are only modified in place before they're inserted, when copied
+  // in the ContiguousRow layout.
   void set_null(size_t col_idx, bool is_null) const {
     ContiguousRowHelper::SetCellIsNull(*schema(),
       const_cast<uint8_t*>(row_slice_.data()), col_idx, is_null);
   }
 
-  const uint8_t *cell_ptr(size_t col_idx) const {
-    return ContiguousRowHelper::cell_ptr(*schema(), row_slice_.data(), col_idx);
-  }
-
   uint8_t *mutable_cell_ptr(size_t col_idx) const {
     return const_cast<uint8_t*>(cell_ptr(col_idx));
   }
 
-  const uint8_t *nullable_cell_ptr(size_t col_idx) const {
-    return ContiguousRowHelper::nullable_cell_ptr(*schema(), row_slice_.data(), col_idx);
-  }
-
   Cell cell(size_t col_idx) const {
     return Cell(this, col_idx);
   }
@@ -156,13 +257,7 @@ class MRSRow {
   friend class MemRowSet;
 
   template <class ArenaType>
-  Status CopyRow(const ConstContiguousRow& row, ArenaType *arena) {
-    // the representation of the MRSRow and ConstContiguousRow is the same.
-    // so, instead of using CopyRow we can just do a memcpy.
-    memcpy(row_slice_.mutable_data(), row.row_data(), row_slice_.size());
-    // Copy any referred-to memory to arena.
-    return kudu::RelocateIndirectDataToArena(this, arena);
-  }
+  Status CopyRow(const ConstContiguousRow& row, ArenaType *arena);
 
   struct Header {
       // Timestamp for the op which inserted this row. If a scanner with an
@@ -190,22 +285,37 @@ struct MSBTreeTraits : public btree::BTreeTraits {
 
 // Define an MRSRow instance using on-stack storage.
 // This defines an array on the stack which is sized correctly for an MRSRow::Header
-// plus a single row of the given schema, then constructs an MRSRow object which
-// points into that stack storage.
-#define DEFINE_MRSROW_ON_STACK(memrowset, varname, slice_name) \
-  size_t varname##_size = sizeof(MRSRow::Header) + \
-                           ContiguousRowHelper::row_size((memrowset)->schema_nonvirtual()); \
+// plus the copy of 'row' the memrowset stores, then constructs an MRSRow object
+// which points into that stack storage.
+#define DEFINE_MRSROW_ON_STACK(memrowset, row, varname, slice_name) \
+  size_t varname##_size = sizeof(MRSRow::Header) + (memrowset)->StoredRowSize(row); \
   uint8_t varname##_storage[varname##_size]; \
   Slice slice_name(varname##_storage, varname##_size); \
-  ContiguousRowHelper::InitNullsBitmap((memrowset)->schema_nonvirtual(), slice_name); \
+  if (!(memrowset)->sparse_layout()) { \
+    ContiguousRowHelper::InitNullsBitmap((memrowset)->schema_nonvirtual(), slice_name); \
+  } \
   MRSRow varname(memrowset, slice_name);
 
+// Returns the allocator which the arenas of the in-memory stores (MemRowSets
+// and DeltaMemStores) allocate from, as configured by
+// --memstore_arena_use_huge_pages.
+BufferAllocator* MemStoreBufferAllocator();
+
+// Sets the max buffer size of 'arena', an in-memory store's arena allocating
+// from MemStoreBufferAllocator(), so that its large components fill whole
+// huge pages if they're in use.
+void SetMemStoreArenaMaxBufferSize(ThreadSafeMemoryTrackingArena* arena);
+
 
 // In-memory storage for data currently being written to the tablet.
 // This is a holding area for inserts, currently held in row form
 // (i.e not columnar)
 //
 // The data is kept sorted.
+//
+// To reduce contention between concurrent writers, the rows may be spread
+// over several CBTree shards by the hash of their encoded key (see
+// --memrowset_num_shards). Iterators merge the shards back into key order.
 class MemRowSet : public RowSet,
                   public std::enable_shared_from_this<MemRowSet>,
                   public enable_make_shared<MemRowSet> {
@@ -258,7 +368,11 @@ class MemRowSet : public RowSet,
   // NOTE: this requires iterating all data, and is thus
   // not very fast.
   uint64_t entry_count() const {
-    return tree_.count();
+    uint64_t count = 0;
+    for (const auto& tree : trees_) {
+      count += tree->count();
+    }
+    return count;
   }
 
   // Conform entry_count to RowSet
@@ -310,7 +424,12 @@ class MemRowSet : public RowSet,
 
   // Return true if there are no entries in the memrowset.
   bool empty() const {
-    return tree_.empty();
+    for (const auto& tree : trees_) {
+      if (!tree->empty()) {
+        return false;
+      }
+    }
+    return true;
   }
 
   // TODO(todd): unit test me
@@ -355,6 +474,18 @@ class MemRowSet : public RowSet,
     return schema_;
   }
 
+  // The layout of the rows if they're stored sparsely, or null if they're
+  // stored as ContiguousRows.
+  const SparseRowLayout* sparse_layout() const {
+    return sparse_layout_.get();
+  }
+
+  // Returns the number of bytes taken by the copy of 'row' stored in the
+  // MemRowSet, excluding its MRSRow header.
+  size_t StoredRowSize(const ConstContiguousRow& row) const {
+    return sparse_layout_ ? sparse_layout_->RowSize(row) : ContiguousRowHelper::row_size(schema_);
+  }
+
   int64_t mrs_id() const {
     return id_;
   }
@@ -390,7 +521,9 @@ class MemRowSet : public RowSet,
 
   // Mark the memrowset as frozen. See CBTree::Freeze()
   void Freeze() {
-    tree_.Freeze();
+    for (auto& tree : trees_) {
+      tree->Freeze();
+    }
   }
 
   uint64_t debug_insert_count() const {
@@ -431,6 +564,16 @@ class MemRowSet : public RowSet,
     return Status::OK();
   }
 
+  // The MRS is flushed rather than dropped, even if its rows have expired.
+  Status IsExpired(const ColumnId& /*ttl_col_id*/,
+                   int64_t /*cutoff_micros*/,
+                   const fs::IOContext* /*io_context*/,
+                   bool* expired) override {
+    DCHECK(expired);
+    *expired = false;
+    return Status::OK();
+  }
+
   Status InitUndoDeltas(Timestamp /*ancient_history_mark*/,
                         MonoTime /*deadline*/,
                         const fs::IOContext* /*io_context*/,
@@ -472,10 +615,21 @@ class MemRowSet : public RowSet,
                   MRSRow *ms_row);
 
   typedef btree::CBTree<MSBTreeTraits> MSBTree;
+  typedef btree::CBTreeIterator<MSBTreeTraits> MSBTIter;
+
+  class ShardMergeIterator;
+
+  // Return the shard which holds, or would hold, the row with the given
+  // encoded key.
+  MSBTree* TreeForKey(const Slice& encoded_key) const;
 
   int64_t id_;
   const Schema schema_;
 
+  // Set if the MemRowSet stores its rows sparsely, see
+  // --memrowset_use_sparse_rows.
+  const std::unique_ptr<SparseRowLayout> sparse_layout_;
+
   // The transaction ID that inserted into this MemRowSet, and its corresponding metadata.
   boost::optional<int64_t> txn_id_;
   scoped_refptr<TxnMetadata> txn_metadata_;
@@ -483,9 +637,9 @@ class MemRowSet : public RowSet,
   std::shared_ptr<MemoryTrackingBufferAllocator> allocator_;
   std::shared_ptr<ThreadSafeMemoryTrackingArena> arena_;
 
-  typedef btree::CBTreeIterator<MSBTreeTraits> MSBTIter;
-
-  MSBTree tree_;
+  // The shards holding the rows, all allocating from 'arena_'. Their number
+  // is fixed when the MemRowSet is created.
+  std::vector<std::unique_ptr<MSBTree>> trees_;
 
   // Approximate counts of mutations. This variable is updated non-atomically,
   // so it cannot be relied upon to be in any way accurate. It's only used
@@ -507,6 +661,61 @@ class MemRowSet : public RowSet,
   DISALLOW_COPY_AND_ASSIGN(MemRowSet);
 };
 
+// Iterates over the entries of all the shards of a MemRowSet in key order.
+// Each key lives in a single shard, so this is a plain k-way merge; with a
+// single shard, it simply forwards to the shard's iterator.
+//
+// Like CBTreeIterator, entries are consistent within a leaf of each shard.
+class MemRowSet::ShardMergeIterator {
+ public:
+  explicit ShardMergeIterator(std::vector<std::unique_ptr<MSBTIter>> iters);
+
+  bool SeekToStart();
+
+  bool SeekAtOrAfter(const Slice& key, bool* exact);
+
+  bool IsValid() const {
+    return cur_ != nullptr;
+  }
+
+  bool Next() {
+    DCHECK(cur_);
+    cur_->Next();
+    PickCurrent();
+    return IsValid();
+  }
+
+  Slice GetCurrentKey() const {
+    DCHECK(cur_);
+    return cur_->GetCurrentKey();
+  }
+
+  Slice GetCurrentValue() const {
+    DCHECK(cur_);
+    return cur_->GetCurrentValue();
+  }
+
+  // Return a lower bound on the number of entries, including the current
+  // one, that remain in the iteration: those left in the current leaf of the
+  // shard holding the current entry.
+  size_t remaining_in_leaf() const {
+    DCHECK(cur_);
+    return cur_->remaining_in_leaf();
+  }
+
+ private:
+  // Point 'cur_' at the valid shard iterator with the smallest key, or at
+  // null if all of them are exhausted.
+  void PickCurrent();
+
+  const std::vector<std::unique_ptr<MSBTIter>> iters_;
+
+  // The shard iterator holding the current entry, or null if exhausted.
+  MSBTIter* cur_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardMergeIterator);
+};
+
 // An iterator through in-memory data stored in a MemRowSet.
 // This holds a reference to the MemRowSet, and so the memrowset
 // must not be freed while this iterator is outstanding.
@@ -600,7 +809,7 @@ class MemRowSet::Iterator : public RowwiseIterator {
   DISALLOW_COPY_AND_ASSIGN(Iterator);
 
   Iterator(const std::shared_ptr<const MemRowSet> &mrs,
-           MemRowSet::MSBTIter *iter, RowIteratorOptions opts);
+           MemRowSet::ShardMergeIterator* iter, RowIteratorOptions opts);
 
   // Retrieves a block of dst->nrows() rows from the MemRowSet.
   //
@@ -635,8 +844,12 @@ class MemRowSet::Iterator : public RowwiseIterator {
                                       bool insert_excluded,
                                       ApplyStatus* apply_status);
 
+  // Projects 'src_row' into 'dst_row', in either layout of the MemRowSet's
+  // rows.
+  Status ProjectRowForRead(const MRSRow& src_row, RowBlockRow* dst_row, Arena* dst_arena);
+
   const std::shared_ptr<const MemRowSet> memrowset_;
-  std::unique_ptr<MemRowSet::MSBTIter> iter_;
+  std::unique_ptr<MemRowSet::ShardMergeIterator> iter_;
 
   const RowIteratorOptions opts_;
 
@@ -647,10 +860,22 @@ class MemRowSet::Iterator : public RowwiseIterator {
   const std::unique_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // If the MemRowSet stores its rows sparsely, the projector reading them,
+  // and the offsets of the cells of the current row, resolved up to its last
+  // projected column.
+  std::unique_ptr<RowProjector> sparse_projector_;
+  std::vector<uint32_t> sparse_offsets_;
+
   // The index of the first IS_DELETED virtual column in the projection schema,
   // or kColumnNotFound if one doesn't exist.
   const int projection_vc_is_deleted_idx_;
 
+  // For the MemRowSet of a transaction, whose rows all share the
+  // transaction's commit status: whether the commit is in 'opts_.snap_to_exclude'
+  // and 'opts_.snap_to_include' respectively. Set by Init().
+  bool txn_insert_excluded_;
+  bool txn_insert_included_;
+
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
@@ -671,5 +896,35 @@ inline const Schema* MRSRow::schema() const {
   return &memrowset_->schema_nonvirtual();
 }
 
+inline bool MRSRow::is_null(size_t col_idx) const {
+  const SparseRowLayout* sparse_layout = memrowset_->sparse_layout();
+  if (sparse_layout) {
+    return sparse_layout->is_null(row_slice_.data(), col_idx);
+  }
+  return ContiguousRowHelper::is_null(*schema(), row_slice_.data(), col_idx);
+}
+
+inline const uint8_t* MRSRow::cell_ptr(size_t col_idx) const {
+  const SparseRowLayout* sparse_layout = memrowset_->sparse_layout();
+  if (sparse_layout) {
+    return row_slice_.data() + sparse_layout->cell_offset(row_slice_.data(), col_idx);
+  }
+  return ContiguousRowHelper::cell_ptr(*schema(), row_slice_.data(), col_idx);
+}
+
+template <class ArenaType>
+inline Status MRSRow::CopyRow(const ConstContiguousRow& row, ArenaType *arena) {
+  const SparseRowLayout* sparse_layout = memrowset_->sparse_layout();
+  if (sparse_layout) {
+    DCHECK_EQ(sparse_layout->RowSize(row), row_slice_.size());
+    return sparse_layout->EncodeRow(row, row_slice_.mutable_data(), arena);
+  }
+  // the representation of the MRSRow and ConstContiguousRow is the same.
+  // so, instead of using CopyRow we can just do a memcpy.
+  memcpy(row_slice_.mutable_data(), row.row_data(), row_slice_.size());
+  // Copy any referred-to memory to arena.
+  return kudu::RelocateIndirectDataToArena(this, arena);
+}
+
 } // namespace tablet
 } // namespace kudu
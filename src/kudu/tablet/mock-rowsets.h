@@ -153,6 +153,14 @@ class MockRowSet : public RowSet {
     return Status::OK();
   }
 
+  Status IsExpired(const ColumnId& /*ttl_col_id*/,
+                   int64_t /*cutoff_micros*/,
+                   const fs::IOContext* /*io_context*/,
+                   bool* /*expired*/) override {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
+
   Status EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp /*ancient_history_mark*/,
                                                      int64_t* /*bytes*/) override {
     LOG(FATAL) << "Unimplemented";
@@ -189,7 +197,8 @@ class MockDiskRowSet : public MockRowSet {
       : first_key_(std::move(first_key)),
         last_key_(std::move(last_key)),
         size_(size),
-        column_size_(column_size) {}
+        column_size_(column_size),
+        read_rate_(0) {}
 
   Status GetBounds(std::string* min_encoded_key,
                    std::string* max_encoded_key) const override {
@@ -214,6 +223,14 @@ class MockDiskRowSet : public MockRowSet {
     return size_;
   }
 
+  double ReadAccessRate() const override {
+    return read_rate_;
+  }
+
+  void set_read_access_rate(double rate) {
+    read_rate_ = rate;
+  }
+
   std::string ToString() const override {
     return strings::Substitute("mock[$0, $1]",
                                Slice(first_key_).ToDebugString(),
@@ -225,6 +242,7 @@ class MockDiskRowSet : public MockRowSet {
   const std::string last_key_;
   const uint64_t size_;
   const uint64_t column_size_;
+  double read_rate_;
 };
 
 // Mock which acts like a MemRowSet and has no known bounds.
@@ -17,21 +17,53 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <utility>
 
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
 #include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(rowset_writer_column_encoding_threads, 1,
+             "Number of threads with which each rowset writer encodes and "
+             "compresses its columns during flushes and compactions. With more "
+             "than one thread, columns are encoded concurrently, from batches "
+             "of rows copied off the rows being written. With 1, columns are "
+             "encoded one after another on the flushing or compacting thread.");
+DEFINE_validator(rowset_writer_column_encoding_threads,
+                 [](const char* /*n*/, int32_t v) { return v >= 1; });
+TAG_FLAG(rowset_writer_column_encoding_threads, experimental);
+TAG_FLAG(rowset_writer_column_encoding_threads, runtime);
+
+DEFINE_bool(rowset_column_statistics, true,
+            "Whether flushes and compactions collect statistics of the values "
+            "of the columns of the rowsets they write: null counts, bounds, "
+            "sketches of the number of distinct values and histograms. These "
+            "are merged per tablet and per table for query engines to plan "
+            "their scans and joins with.");
+TAG_FLAG(rowset_column_statistics, experimental);
+TAG_FLAG(rowset_column_statistics, runtime);
 
 namespace kudu {
 namespace tablet {
@@ -39,19 +71,59 @@ namespace tablet {
 using cfile::CFileWriter;
 using fs::BlockCreationTransaction;
 using fs::CreateBlockOptions;
+using fs::IOPriority;
+using fs::ScopedIOPriority;
 using fs::WritableBlock;
+using std::shared_ptr;
 using std::unique_ptr;
 
+namespace {
+
+// Number of rows in each batch encoded in parallel. Large enough to amortize
+// the cost of handing the batch over to the columns.
+constexpr size_t kRowsPerBatch = 1024;
+
+// Maximum number of batches in flight, bounding the memory used to copy rows.
+constexpr size_t kMaxBatchesInFlight = 4;
+
+} // anonymous namespace
+
+struct MultiColumnWriter::RowBatch {
+  RowBatch(const Schema* schema, int num_columns)
+      : mem(32 * 1024),
+        block(schema, kRowsPerBatch, &mem),
+        encoded(num_columns) {
+    block.Resize(0);
+  }
+
+  RowBlockMemory mem;
+  RowBlock block;
+
+  // Counted down by each column once it has encoded the batch.
+  CountDownLatch encoded;
+};
+
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
                                      const Schema* schema,
-                                     std::string tablet_id)
+                                     std::string tablet_id,
+                                     fs::StorageTier tier)
   : fs_(fs),
     schema_(schema),
     finished_(false),
-    tablet_id_(std::move(tablet_id)) {
+    tablet_id_(std::move(tablet_id)),
+    tier_(tier),
+    failed_(false) {
 }
 
 MultiColumnWriter::~MultiColumnWriter() {
+  // Stop the column encoding tasks before destroying their writers.
+  for (auto& token : col_tokens_) {
+    token->Shutdown();
+  }
+  col_tokens_.clear();
+  if (pool_) {
+    pool_->Shutdown();
+  }
   STLDeleteElements(&cfile_writers_);
 }
 
@@ -59,7 +131,7 @@ Status MultiColumnWriter::Open() {
   CHECK(cfile_writers_.empty());
 
   // Open columns.
-  const CreateBlockOptions block_opts({ tablet_id_ });
+  const CreateBlockOptions block_opts({ tablet_id_, tier_ });
   for (int i = 0; i < schema_->num_columns(); i++) {
     const ColumnSchema &col = schema_->column(i);
 
@@ -69,6 +141,10 @@ Status MultiColumnWriter::Open() {
     // the corresponding rows.
     opts.write_posidx = true;
 
+    // Track per-block min/max values so that scans can skip blocks which
+    // can't match their predicates.
+    opts.write_zone_maps = true;
+
     /// Set the column storage attributes.
     opts.storage_attributes = col.attributes();
 
@@ -94,29 +170,147 @@ Status MultiColumnWriter::Open() {
 
     cfile_writers_.push_back(writer.release());
     block_ids_.push_back(block_id);
+    if (FLAGS_rowset_column_statistics) {
+      col_stats_.emplace_back(new ColumnStatisticsCollector(schema_->column_id(i),
+                                                            col.type_info()));
+    }
   }
   VLOG(1) << strings::Substitute("Opened CFile writers for $0 column(s)",
                                  cfile_writers_.size());
 
+  const int num_threads = std::min<int>(FLAGS_rowset_writer_column_encoding_threads,
+                                        schema_->num_columns());
+  if (num_threads > 1) {
+    RETURN_NOT_OK(ThreadPoolBuilder("col-encode")
+                  .set_max_threads(num_threads)
+                  .Build(&pool_));
+    for (int i = 0; i < schema_->num_columns(); i++) {
+      col_tokens_.emplace_back(pool_->NewToken(ThreadPool::ExecutionMode::SERIAL));
+    }
+    col_written_sizes_.reset(new std::atomic<size_t>[schema_->num_columns()]());
+  }
+
+  return Status::OK();
+}
+
+Status MultiColumnWriter::AppendColumn(int i, const RowBlock& block) {
+  ColumnBlock column = block.column_block(i);
+  if (column.is_nullable()) {
+    RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.non_null_bitmap(),
+        column.data(), column.nrows()));
+  } else {
+    RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+  }
+  if (!col_stats_.empty()) {
+    col_stats_[i]->AddValues(column);
+  }
   return Status::OK();
 }
 
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
-    ColumnBlock column = block.column_block(i);
-    if (column.is_nullable()) {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.non_null_bitmap(),
-          column.data(), column.nrows()));
-    } else {
-      RETURN_NOT_OK(cfile_writers_[i]->AppendEntries(column.data(), column.nrows()));
+  if (!pool_) {
+    for (int i = 0; i < schema_->num_columns(); i++) {
+      RETURN_NOT_OK(AppendColumn(i, block));
+    }
+    return Status::OK();
+  }
+
+  // The selection vector is ignored: copy every row.
+  SelectionVector all_rows(block.nrows());
+  all_rows.SetAllTrue();
+  size_t src_off = 0;
+  while (src_off < block.nrows()) {
+    if (!cur_batch_) {
+      cur_batch_ = std::make_shared<RowBatch>(schema_, schema_->num_columns());
+    }
+    RowBlock* dst = &cur_batch_->block;
+    const size_t dst_off = dst->nrows();
+    const size_t n = std::min(block.nrows() - src_off, dst->row_capacity() - dst_off);
+    dst->Resize(dst_off + n);
+    for (int i = 0; i < schema_->num_columns(); i++) {
+      ColumnBlock dst_cb(dst->column_block(i));
+      RETURN_NOT_OK(block.column_block(i).CopyTo(all_rows, &dst_cb, src_off, dst_off, n));
+    }
+    src_off += n;
+    if (dst->nrows() == dst->row_capacity()) {
+      RETURN_NOT_OK(DispatchBatch());
     }
   }
+  return first_error();
+}
+
+Status MultiColumnWriter::DispatchBatch() {
+  DCHECK(cur_batch_);
+  shared_ptr<RowBatch> batch = std::move(cur_batch_);
+  while (in_flight_.size() >= kMaxBatchesInFlight) {
+    in_flight_.front()->encoded.Wait();
+    in_flight_.pop_front();
+  }
+
+  // Encode with the priority of the thread writing the rows.
+  const IOPriority priority = ScopedIOPriority::Current();
+  const int num_columns = schema_->num_columns();
+  for (int i = 0; i < num_columns; i++) {
+    Status submit_status = col_tokens_[i]->Submit([this, i, batch, priority]() {
+      ScopedIOPriority p(priority);
+      if (!failed_) {
+        Status s = AppendColumn(i, batch->block);
+        if (PREDICT_FALSE(!s.ok())) {
+          std::lock_guard<simple_spinlock> l(lock_);
+          if (first_error_.ok()) {
+            first_error_ = s.CloneAndPrepend(
+                "Unable to append to column " + schema_->column(i).ToString());
+          }
+          failed_ = true;
+        }
+        col_written_sizes_[i] = cfile_writers_[i]->written_size();
+      }
+      batch->encoded.CountDown();
+    });
+    if (PREDICT_FALSE(!submit_status.ok())) {
+      // Nobody will encode the batch for the remaining columns.
+      batch->encoded.CountDown(num_columns - i);
+      return submit_status;
+    }
+  }
+  in_flight_.emplace_back(std::move(batch));
   return Status::OK();
 }
 
+Status MultiColumnWriter::WaitForColumns() {
+  if (cur_batch_ && cur_batch_->block.nrows() > 0) {
+    RETURN_NOT_OK(DispatchBatch());
+  }
+  cur_batch_.reset();
+  for (auto& token : col_tokens_) {
+    token->Wait();
+  }
+  in_flight_.clear();
+  return first_error();
+}
+
+Status MultiColumnWriter::first_error() const {
+  if (PREDICT_TRUE(!failed_)) {
+    return Status::OK();
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  return first_error_;
+}
+
+CFileWriter* MultiColumnWriter::writer_for_col_idx(int i) {
+  DCHECK_LT(i, cfile_writers_.size());
+  if (pool_) {
+    col_tokens_[i]->Wait();
+  }
+  return cfile_writers_[i];
+}
+
 Status MultiColumnWriter::FinishAndReleaseBlocks(
     BlockCreationTransaction* transaction) {
   CHECK(!finished_);
+  if (pool_) {
+    RETURN_NOT_OK(WaitForColumns());
+  }
   for (int i = 0; i < schema_->num_columns(); i++) {
     CFileWriter *writer = cfile_writers_[i];
     Status s = writer->FinishAndReleaseBlock(transaction);
@@ -138,8 +332,23 @@ void MultiColumnWriter::GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>*
   }
 }
 
+void MultiColumnWriter::GetColumnStatistics(std::vector<ColumnStatisticsPB>* stats) const {
+  CHECK(finished_);
+  stats->clear();
+  stats->resize(col_stats_.size());
+  for (int i = 0; i < col_stats_.size(); i++) {
+    col_stats_[i]->ToPB(&(*stats)[i]);
+  }
+}
+
 size_t MultiColumnWriter::written_size() const {
   size_t size = 0;
+  if (pool_) {
+    for (int i = 0; i < cfile_writers_.size(); i++) {
+      size += col_written_sizes_[i];
+    }
+    return size;
+  }
   for (const CFileWriter *writer : cfile_writers_) {
     size += writer->written_size();
   }
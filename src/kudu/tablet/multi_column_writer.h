@@ -17,22 +17,31 @@
 #ifndef KUDU_TABLET_MULTI_COLUMN_WRITER_H
 #define KUDU_TABLET_MULTI_COLUMN_WRITER_H
 
+#include <atomic>
 #include <cstddef>
+#include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glog/logging.h>
 
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+class ColumnStatisticsCollector;
+class ColumnStatisticsPB;
 class FsManager;
 class RowBlock;
 class Schema;
+class ThreadPool;
+class ThreadPoolToken;
 struct ColumnId;
 
 namespace cfile {
@@ -47,11 +56,18 @@ namespace tablet {
 
 // Wrapper which writes several columns in parallel corresponding to some
 // Schema. Written blocks will fall in the tablet_id's data dir group.
+//
+// If --rowset_writer_column_encoding_threads is greater than 1, appended rows
+// are copied into batches which the columns encode and compress concurrently
+// on a private thread pool, each column's writer consuming the batches in
+// order. Otherwise the columns are written on the calling thread.
 class MultiColumnWriter {
  public:
+  // The columns are placed on 'tier', if the tablet's data directories have it.
   MultiColumnWriter(FsManager* fs,
                     const Schema* schema,
-                    std::string tablet_id);
+                    std::string tablet_id,
+                    fs::StorageTier tier = fs::StorageTier::ANY);
 
   virtual ~MultiColumnWriter();
 
@@ -61,26 +77,51 @@ class MultiColumnWriter {
   // Append the given block to the output columns.
   //
   // Note that the selection vector here is ignored.
+  //
+  // When encoding in parallel, an error may be returned by a later call (for
+  // instance, FinishAndReleaseBlocks()) than the one that appended the rows.
   Status AppendBlock(const RowBlock& block);
 
   // Close the in-progress CFiles, finalizing the underlying writable
   // blocks and releasing them to 'transaction'.
   Status FinishAndReleaseBlocks(fs::BlockCreationTransaction* transaction);
 
-  // Return the number of bytes written so far.
+  // Return the number of bytes written so far. When encoding in parallel,
+  // this doesn't account for the rows whose encoding is still pending.
   size_t written_size() const;
 
-  cfile::CFileWriter* writer_for_col_idx(int i) {
-    DCHECK_LT(i, cfile_writers_.size());
-    return cfile_writers_[i];
-  }
+  // Return the writer of the i-th column, once it has encoded the rows
+  // dispatched to it so far.
+  cfile::CFileWriter* writer_for_col_idx(int i);
 
   // Return the block IDs of the written columns, keyed by column ID.
   //
   // REQUIRES: Finish() already called.
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
+  // Return the statistics of the values of the written columns, one per
+  // column, or none if --rowset_column_statistics was off when opened.
+  //
+  // REQUIRES: Finish() already called.
+  void GetColumnStatistics(std::vector<ColumnStatisticsPB>* stats) const;
+
  private:
+  struct RowBatch;
+
+  // Append the rows of 'block' to the i-th column's writer.
+  Status AppendColumn(int i, const RowBlock& block);
+
+  // Hand the current batch over to the column encoding tasks, first waiting
+  // for older batches if too many are in flight.
+  Status DispatchBatch();
+
+  // Dispatch the current batch, if any, and wait for all columns to encode
+  // every batch. Returns the first encoding error.
+  Status WaitForColumns();
+
+  // Return the first error encountered by a column encoding task.
+  Status first_error() const;
+
   FsManager* const fs_;
   const Schema* const schema_;
 
@@ -88,9 +129,38 @@ class MultiColumnWriter {
 
   const std::string tablet_id_;
 
+  const fs::StorageTier tier_;
+
   std::vector<cfile::CFileWriter *> cfile_writers_;
   std::vector<BlockId> block_ids_;
 
+  // The collectors of the statistics of the columns, if any. Each is only
+  // touched by the writer of its column.
+  std::vector<std::unique_ptr<ColumnStatisticsCollector>> col_stats_;
+
+  // The following are only used when encoding in parallel.
+
+  std::unique_ptr<ThreadPool> pool_;
+
+  // A serial token per column, so that each writer consumes batches in order.
+  std::vector<std::unique_ptr<ThreadPoolToken>> col_tokens_;
+
+  // The batch rows are currently appended to, if any.
+  std::shared_ptr<RowBatch> cur_batch_;
+
+  // The dispatched batches, oldest first, which may still be being encoded.
+  std::deque<std::shared_ptr<RowBatch>> in_flight_;
+
+  // Number of bytes written by each column as of its last encoded batch.
+  std::unique_ptr<std::atomic<size_t>[]> col_written_sizes_;
+
+  // Set once any column encoding task fails; further tasks do nothing.
+  std::atomic<bool> failed_;
+
+  // Protects 'first_error_'.
+  mutable simple_spinlock lock_;
+  Status first_error_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiColumnWriter);
 };
 
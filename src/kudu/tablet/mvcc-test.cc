@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/mvcc.h"
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <ostream>
@@ -24,6 +25,7 @@
 #include <thread>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -44,6 +46,8 @@ using std::thread;
 using std::unique_ptr;
 using std::vector;
 
+DECLARE_bool(mvcc_lock_free_snapshots);
+
 METRIC_DECLARE_entity(server);
 
 namespace kudu {
@@ -642,6 +646,58 @@ TEST_F(MvccTest, TestOpAbort) {
   ASSERT_EQ(ts3, mgr.GetCleanTimestamp());
 }
 
+// Snapshots taken without the lock are the same as those taken with it,
+// including when the applied timestamps don't fit in the published snapshot.
+TEST_F(MvccTest, TestLockFreeSnapshots) {
+  MvccManager mgr;
+  const auto check_snapshots = [&]() {
+    FLAGS_mvcc_lock_free_snapshots = false;
+    MvccSnapshot locked_snap(mgr);
+    Timestamp locked_clean_time = mgr.GetCleanTimestamp();
+    FLAGS_mvcc_lock_free_snapshots = true;
+    MvccSnapshot lock_free_snap(mgr);
+    ASSERT_TRUE(locked_snap.Equals(lock_free_snap))
+        << locked_snap.ToString() << " vs " << lock_free_snap.ToString();
+    ASSERT_EQ(locked_clean_time, mgr.GetCleanTimestamp());
+  };
+  NO_FATALS(check_snapshots());
+
+  // Apply the ops in reverse order, so that the applied timestamps pile up
+  // above the clean time.
+  constexpr int kNumOps = 40;
+  vector<unique_ptr<ScopedOp>> ops;
+  for (int i = 0; i < kNumOps; i++) {
+    ops.emplace_back(new ScopedOp(&mgr, Timestamp(10 + i)));
+  }
+  mgr.AdjustNewOpLowerBound(Timestamp(10 + kNumOps));
+  NO_FATALS(check_snapshots());
+  for (int i = kNumOps - 1; i >= 0; i--) {
+    ops[i]->StartApplying();
+    ops[i]->FinishApplying();
+    NO_FATALS(check_snapshots());
+  }
+  ASSERT_EQ(Timestamp(10 + kNumOps), mgr.GetCleanTimestamp());
+
+  // Snapshots taken while ops are applied include the ops applied before
+  // they're taken.
+  std::atomic<bool> done(false);
+  thread reader([&]() {
+    while (!done) {
+      Timestamp clean_time = mgr.GetCleanTimestamp();
+      MvccSnapshot snap(mgr);
+      CHECK(snap.IsApplied(Timestamp(clean_time.value() - 1))) << snap.ToString();
+    }
+  });
+  for (int i = 0; i < 1000; i++) {
+    ScopedOp op(&mgr, Timestamp(100 + i));
+    mgr.AdjustNewOpLowerBound(Timestamp(100 + i));
+    op.StartApplying();
+    op.FinishApplying();
+  }
+  done = true;
+  reader.join();
+}
+
 // This tests for a bug we were observing, where a clean snapshot would not
 // coalesce to the latest timestamp.
 TEST_F(MvccTest, TestAutomaticCleanTimeMoveToSafeTimeOnApply) {
@@ -25,6 +25,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
+#include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
@@ -42,6 +43,17 @@ DEFINE_int32(inject_latency_ms_before_starting_op, 0,
 TAG_FLAG(inject_latency_ms_before_starting_op, advanced);
 TAG_FLAG(inject_latency_ms_before_starting_op, hidden);
 
+DEFINE_bool(mvcc_lock_free_snapshots, false,
+            "Whether taking an MVCC snapshot of the latest applied ops reads a "
+            "copy of the tablet's MVCC state published by the writers, rather "
+            "than taking the lock the writers take to start and apply ops. "
+            "Reduces the contention between high rates of short scans and of "
+            "writes on a tablet. Falls back to taking the lock when many ops "
+            "above the clean time are applied, or while the state changes "
+            "too quickly to be read.");
+TAG_FLAG(mvcc_lock_free_snapshots, experimental);
+TAG_FLAG(mvcc_lock_free_snapshots, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -54,6 +66,8 @@ MvccManager::MvccManager()
   cur_snap_.type_ = MvccSnapshot::kLatest;
   cur_snap_.all_applied_before_ = Timestamp::kInitialTimestamp;
   cur_snap_.none_applied_at_or_after_ = Timestamp::kInitialTimestamp;
+  std::lock_guard<LockType> l(lock_);
+  PublishSnapshotUnlocked();
 }
 
 Status MvccManager::CheckIsCleanTimeInitialized() const {
@@ -146,6 +160,7 @@ void MvccManager::FinishApplyingOp(Timestamp timestamp) {
     // the "clean" timestamp.
     AdjustCleanTimeUnlocked();
   }
+  PublishSnapshotUnlocked();
 }
 
 MvccManager::OpState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
@@ -210,6 +225,7 @@ void MvccManager::AdjustNewOpLowerBound(Timestamp timestamp) {
   }
 
   AdjustCleanTimeUnlocked();
+  PublishSnapshotUnlocked();
 }
 
 // Remove any elements from 'v' which are < the given watermark.
@@ -368,10 +384,74 @@ bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
 }
 
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
+  if (FLAGS_mvcc_lock_free_snapshots && TryReadPublishedSnapshot(snap)) {
+    return;
+  }
   std::lock_guard<LockType> l(lock_);
   *snap = cur_snap_;
 }
 
+void MvccManager::PublishSnapshotUnlocked() {
+  DCHECK(lock_.is_locked());
+  PublishedSnapshot* pub = &published_snap_;
+  const uint64_t seq = pub->seq.load(std::memory_order_relaxed);
+  pub->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  pub->all_applied_before.store(cur_snap_.all_applied_before_.value(),
+                                std::memory_order_relaxed);
+  pub->none_applied_at_or_after.store(cur_snap_.none_applied_at_or_after_.value(),
+                                      std::memory_order_relaxed);
+  const auto& applied = cur_snap_.applied_timestamps_;
+  if (applied.size() > PublishedSnapshot::kMaxAppliedTimestamps) {
+    pub->num_applied_timestamps.store(-1, std::memory_order_relaxed);
+  } else {
+    for (size_t i = 0; i < applied.size(); i++) {
+      pub->applied_timestamps[i].store(applied[i], std::memory_order_relaxed);
+    }
+    pub->num_applied_timestamps.store(applied.size(), std::memory_order_relaxed);
+  }
+
+  pub->seq.store(seq + 2, std::memory_order_release);
+}
+
+bool MvccManager::TryReadPublishedSnapshot(MvccSnapshot* snap) const {
+  // Beyond this many attempts, the writers are better off being waited for
+  // on the lock.
+  constexpr int kMaxAttempts = 16;
+  const PublishedSnapshot& pub = published_snap_;
+  Timestamp::val_type applied[PublishedSnapshot::kMaxAppliedTimestamps];
+  for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+    const uint64_t seq = pub.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      base::subtle::PauseCPU();
+      continue;
+    }
+    const Timestamp::val_type all_applied_before =
+        pub.all_applied_before.load(std::memory_order_relaxed);
+    const Timestamp::val_type none_applied_at_or_after =
+        pub.none_applied_at_or_after.load(std::memory_order_relaxed);
+    const int num_applied = pub.num_applied_timestamps.load(std::memory_order_relaxed);
+    for (int i = 0; i < num_applied; i++) {
+      applied[i] = pub.applied_timestamps[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (pub.seq.load(std::memory_order_relaxed) != seq) {
+      continue;
+    }
+    if (num_applied < 0) {
+      return false;
+    }
+
+    snap->type_ = MvccSnapshot::kLatest;
+    snap->all_applied_before_ = Timestamp(all_applied_before);
+    snap->none_applied_at_or_after_ = Timestamp(none_applied_at_or_after);
+    snap->applied_timestamps_.assign(applied, applied + num_applied);
+    return true;
+  }
+  return false;
+}
+
 Status MvccManager::WaitForSnapshotWithAllApplied(Timestamp timestamp,
                                                   MvccSnapshot* snapshot,
                                                   const MonoTime& deadline) const {
@@ -408,6 +488,10 @@ Status MvccManager::WaitForApplyingOpsToApply() const {
 }
 
 Timestamp MvccManager::GetCleanTimestamp() const {
+  if (FLAGS_mvcc_lock_free_snapshots) {
+    // The clean time is a single value: no need to retry.
+    return Timestamp(published_snap_.all_applied_before.load(std::memory_order_acquire));
+  }
   std::lock_guard<LockType> l(lock_);
   return cur_snap_.all_applied_before_;
 }
@@ -31,6 +31,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/txn_metadata.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
@@ -368,6 +369,15 @@ class MvccManager {
   // been applied at the time of this call.
   void TakeSnapshot(MvccSnapshot *snapshot) const;
 
+  // Copies 'cur_snap_' into 'published_snap_'. Must be called with lock_ held,
+  // whenever 'cur_snap_' changes.
+  void PublishSnapshotUnlocked();
+
+  // Reads 'published_snap_' into 'snapshot' without taking 'lock_'. Returns
+  // false if the published snapshot holds too many applied timestamps, or
+  // if it kept changing while being read.
+  bool TryReadPublishedSnapshot(MvccSnapshot* snapshot) const;
+
   bool InitOpUnlocked(const Timestamp& timestamp);
 
   // TODO(awong) ponder merging these since the new ALL_APPLIED path no longer
@@ -429,6 +439,7 @@ class MvccManager {
 
   typedef simple_spinlock LockType;
   mutable LockType lock_;
+  ScopedLockSiteRegistration lock_site_{&lock_, LockSite::kMvcc};
 
   // The kLatest snapshot that gets updated with op timestamps as MVCC ops
   // start and complete through the lifespan of this MvccManager.
@@ -455,6 +466,26 @@ class MvccManager {
 
   std::atomic<bool> open_;
 
+  // A copy of 'cur_snap_' which readers can take without 'lock_', so that
+  // taking snapshots doesn't contend with the writers starting and applying
+  // ops, nor with other readers. It's protected by a sequence lock: the
+  // writers of 'cur_snap_', already serialized by 'lock_', make 'seq' odd
+  // while updating the copy, and readers retry if 'seq' changed while they
+  // read it. Only snapshots with few applied timestamps above the clean
+  // time are published this way; see --mvcc_lock_free_snapshots.
+  struct PublishedSnapshot {
+    static constexpr int kMaxAppliedTimestamps = 16;
+
+    std::atomic<uint64_t> seq { 0 };
+    std::atomic<Timestamp::val_type> all_applied_before { 0 };
+    std::atomic<Timestamp::val_type> none_applied_at_or_after { 0 };
+    // The number of entries of 'applied_timestamps', or -1 if the applied
+    // timestamps of 'cur_snap_' don't fit in it.
+    std::atomic<int> num_applied_timestamps { 0 };
+    std::atomic<Timestamp::val_type> applied_timestamps[kMaxAppliedTimestamps];
+  } CACHELINE_ALIGNED;  // Apart from 'lock_' and the state it protects.
+  PublishedSnapshot published_snap_;
+
   DISALLOW_COPY_AND_ASSIGN(MvccManager);
 };
 
@@ -39,6 +39,7 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace google {
@@ -67,6 +68,7 @@ struct OpMetrics {
   int update_ignore_errors;
   int successful_deletes;
   int delete_ignore_errors;
+  int successful_range_deletes;
   uint64_t commit_wait_duration_usec;
 };
 
@@ -268,6 +270,18 @@ class OpState {
     return request_id_;
   }
 
+  // Sets the deadline of the client that submitted this op. Past it, the
+  // client no longer waits for the result of the op.
+  void set_client_deadline(const MonoTime& deadline) {
+    client_deadline_ = deadline;
+  }
+
+  // Returns the deadline of the client that submitted this op, or
+  // MonoTime::Max() if there is none, e.g. for ops replicated from a leader.
+  const MonoTime& client_deadline() const {
+    return client_deadline_;
+  }
+
  protected:
   explicit OpState(TabletReplica* tablet_replica);
   virtual ~OpState();
@@ -303,6 +317,8 @@ class OpState {
   // The client's id for this op, if there is one.
   rpc::RequestIdPB request_id_;
 
+  MonoTime client_deadline_ = MonoTime::Max();
+
   scoped_refptr<consensus::ConsensusRound> consensus_round_;
 
   // The defined consistency mode for this op.
@@ -23,6 +23,7 @@
 #include <ostream>
 #include <utility>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/message.h>
@@ -40,11 +41,14 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tablet/op_order_verifier.h"
 #include "kudu/tablet/ops/op_tracker.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status_callback.h"
 #include "kudu/util/threadpool.h"
@@ -62,6 +66,15 @@ using std::string;
 using std::unique_ptr;
 using strings::Substitute;
 
+DEFINE_bool(abort_work_past_client_deadline, false,
+            "Whether tablet servers abort work whose result can no longer reach "
+            "the client in time: writes not yet prepared when the client's deadline "
+            "passes are failed instead of being replicated, and scan requests stop "
+            "reading data once the client's deadline passes. Shedding such work "
+            "keeps it from adding to an overload that made clients time out.");
+TAG_FLAG(abort_work_past_client_deadline, experimental);
+TAG_FLAG(abort_work_past_client_deadline, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -232,6 +245,24 @@ void OpDriver::ExecuteAsync() {
 
 void OpDriver::PrepareTask() {
   TRACE_EVENT_FLOW_END0("op", "PrepareTask", this);
+  if (PREDICT_FALSE(FLAGS_abort_work_past_client_deadline) &&
+      MonoTime::Now() > state()->client_deadline()) {
+    ReplicationState repl_state_copy;
+    {
+      std::lock_guard<simple_spinlock> lock(lock_);
+      repl_state_copy = replication_state_;
+    }
+    // Only leader ops not replicated yet may be aborted.
+    if (repl_state_copy == NOT_REPLICATING) {
+      TRACE("Client deadline passed while queued for prepare: aborting");
+      TabletMetrics* metrics = state()->tablet_replica()->tablet()->metrics();
+      if (metrics) {
+        metrics->ops_aborted_past_deadline->Increment();
+      }
+      HandleFailure(Status::TimedOut("client deadline passed before the op was prepared"));
+      return;
+    }
+  }
   Status prepare_status = Prepare();
   if (PREDICT_FALSE(!prepare_status.ok())) {
     HandleFailure(prepare_status);
@@ -427,6 +458,15 @@ void OpDriver::ReplicationFinished(const Status& status) {
   }
 
   TRACE_COUNTER_INCREMENT("replication_time_us", replication_duration.ToMicroseconds());
+  if (status.ok() && op_->op_type() == Op::WRITE_OP) {
+    TabletReplica* replica = state()->tablet_replica();
+    if (TabletMetrics* metrics = replica->tablet()->metrics()) {
+      metrics->write_op_replication_time->Increment(replication_duration.ToMicroseconds());
+    }
+    if (const auto* server_metrics = replica->server_write_op_metrics()) {
+      server_metrics->replication_time->Increment(replication_duration.ToMicroseconds());
+    }
+  }
   TRACE("REPLICATION: Finished.");
 
   // If we have prepared and replicated, we're ready
@@ -484,13 +524,16 @@ Status OpDriver::ApplyAsync() {
   }
 
   TRACE_EVENT_FLOW_BEGIN0("op", "ApplyTask", this);
+  apply_submit_time_ = MonoTime::Now();
   return apply_pool_->Submit([this]() { this->ApplyTask(); });
 }
 
 void OpDriver::ApplyTask() {
   TRACE_EVENT_FLOW_END0("op", "ApplyTask", this);
   ADOPT_TRACE(trace());
-  Tablet* tablet = state()->tablet_replica()->tablet();
+  const MonoTime apply_start_time = MonoTime::Now();
+  TabletReplica* replica = state()->tablet_replica();
+  Tablet* tablet = replica->tablet();
   if (tablet->HasBeenStopped()) {
     HandleFailure(Status::IllegalState("Not Applying op; the tablet is stopped"));
     return;
@@ -504,6 +547,12 @@ void OpDriver::ApplyTask() {
   }
 #endif // #if DCHECK_IS_ON() ...
 
+  // A replicated op must be applied, even if its client is no longer waiting
+  // for it: just account for the wasted work.
+  if (PREDICT_FALSE(MonoTime::Now() > state()->client_deadline()) && tablet->metrics()) {
+    tablet->metrics()->ops_applied_past_deadline->Increment();
+  }
+
   // We need to ref-count ourself, since FinishApplying() may run very quickly
   // and end up calling Finalize() while we're still in this code.
   scoped_refptr<OpDriver> ref(this);
@@ -541,6 +590,19 @@ void OpDriver::ApplyTask() {
       CHECK_OK(CommitWait());
     }
 
+    if (op_->op_type() == Op::WRITE_OP) {
+      const int64_t queue_time_us = (apply_start_time - apply_submit_time_).ToMicroseconds();
+      const int64_t run_time_us = (MonoTime::Now() - apply_start_time).ToMicroseconds();
+      if (TabletMetrics* metrics = tablet->metrics()) {
+        metrics->write_op_apply_queue_time->Increment(queue_time_us);
+        metrics->write_op_apply_run_time->Increment(run_time_us);
+      }
+      if (const auto* server_metrics = replica->server_write_op_metrics()) {
+        server_metrics->apply_queue_time->Increment(queue_time_us);
+        server_metrics->apply_run_time->Increment(run_time_us);
+      }
+    }
+
     Finalize();
   }
 }
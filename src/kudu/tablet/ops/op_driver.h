@@ -87,6 +87,13 @@ class OpTracker;
 //  5 - ApplyAsync() submits ApplyTask() to the apply_pool_.
 //      ApplyTask() calls op_->Apply().
 //
+//      The ops are submitted in index order (see OpOrderVerifier), but the
+//      apply pool is shared by all of the tablets, with no per-tablet token,
+//      so the ops of a tablet are applied concurrently. That's safe because
+//      ops which write the same rows are serialized by the row locks, which
+//      they hold until they are finalized, and their changes only become
+//      visible when their MVCC ops are committed.
+//
 //      When Apply() is called, changes are made to the in-memory data structures. These
 //      changes are not visible to clients yet. After Apply() completes, a CommitMsg
 //      is enqueued to the WAL in order to store information about the operation result
@@ -380,6 +387,8 @@ class OpDriver : public RefCountedThreadSafe<OpDriver> {
 
   const MonoTime start_time_;
   MonoTime replication_start_time_;
+  // When the op was submitted to the apply pool.
+  MonoTime apply_submit_time_;
 
   ReplicationState replication_state_;
   PrepareState prepare_state_;
@@ -239,6 +239,8 @@ Status ParticipantOpState::PerformOp(const consensus::OpId& op_id, Tablet* table
       if (txn_->commit_op()) {
         txn_->commit_op()->FinishApplying();
       }
+      // The transaction's rows are visible to new scans now.
+      tablet->AdvanceDataVersion();
       txn_->ReleasePartitionLock();
       break;
     }
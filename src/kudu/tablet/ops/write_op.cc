@@ -49,7 +49,9 @@
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tablet/lock_manager.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/tablet/row_cache.h"
 #include "kudu/tablet/row_op.h"
+#include "kudu/tablet/rowset.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -121,6 +123,7 @@ void AddWritePrivilegesForRowOperations(const RowOperationsPB::Type& op_type,
       break;
     case RowOperationsPB::DELETE:
     case RowOperationsPB::DELETE_IGNORE:
+    case RowOperationsPB::DELETE_RANGE:
       InsertIfNotPresent(privileges, WritePrivilegeType::DELETE);
       break;
     default:
@@ -188,8 +191,11 @@ Status WriteOp::Prepare() {
 
   s = tablet->DecodeWriteOperations(&client_schema, state());
   if (!s.ok()) {
+    // Range deletes excluded by compactions are retried.
     // TODO(unknown): is MISMATCHED_SCHEMA always right here? probably not.
-    state()->completion_callback()->set_error(s, TabletServerErrorPB::MISMATCHED_SCHEMA);
+    state()->completion_callback()->set_error(
+        s, s.IsServiceUnavailable() ? TabletServerErrorPB::THROTTLED
+                                    : TabletServerErrorPB::MISMATCHED_SCHEMA);
     return s;
   }
   // Only after decoding rows, check that only supported operations make it
@@ -219,11 +225,19 @@ Status WriteOp::Prepare() {
   // everything for apply. For followers, we wait until the partition lock is
   // held, since we know the op will not be replicated if the leader cannot
   // take the partition lock.
+  const MonoTime lock_start_time = MonoTime::Now();
   if (PREDICT_TRUE(FLAGS_enable_txn_partition_lock)) {
     RETURN_NOT_OK(tablet->AcquirePartitionLock(state(),
         type() == consensus::LEADER ? LockManager::TRY_LOCK : LockManager::WAIT_FOR_LOCK));
   }
   RETURN_NOT_OK(tablet->AcquireRowLocks(state()));
+  const int64_t lock_wait_us = (MonoTime::Now() - lock_start_time).ToMicroseconds();
+  if (auto* metrics = tablet->metrics(); PREDICT_TRUE(metrics != nullptr)) {
+    metrics->write_op_lock_wait_time->Increment(lock_wait_us);
+  }
+  if (const auto* server_metrics = state()->tablet_replica()->server_write_op_metrics()) {
+    server_metrics->lock_wait_time->Increment(lock_wait_us);
+  }
 
   TRACE("PREPARE: Finished");
   return Status::OK();
@@ -305,6 +319,9 @@ void WriteOp::Finish(OpResult result) {
 
   DCHECK_EQ(result, Op::APPLIED);
 
+  // The rows written are visible to new scans now.
+  state_->tablet_replica()->tablet()->AdvanceDataVersion();
+
   TRACE("FINISH: Updating metrics");
 
   if (auto* metrics = state_->tablet_replica()->tablet()->metrics();
@@ -319,6 +336,7 @@ void WriteOp::Finish(OpResult result) {
     metrics->update_ignore_errors->IncrementBy(op_m.update_ignore_errors);
     metrics->rows_deleted->IncrementBy(op_m.successful_deletes);
     metrics->delete_ignore_errors->IncrementBy(op_m.delete_ignore_errors);
+    metrics->ranges_deleted->IncrementBy(op_m.successful_range_deletes);
 
     if (type() == consensus::LEADER) {
       if (state()->external_consistency_mode() == COMMIT_WAIT) {
@@ -407,9 +425,28 @@ Status WriteOpState::AcquireTxnLockCheckOpen(scoped_refptr<Txn> txn) {
   return Status::OK();
 }
 
+Status WriteOpState::AcquireRangeDeleteLocks(rw_semaphore* schema_lock,
+                                             rw_semaphore* range_delete_lock) {
+  DCHECK(!schema_lock_.owns_lock());
+  TRACE("Acquiring range delete and schema locks in exclusive mode");
+  if (!range_delete_lock->try_lock_if_unlocked()) {
+    return Status::ServiceUnavailable("range deletes are excluded while rowsets are compacted");
+  }
+  range_delete_lock_ = std::unique_lock<rw_semaphore>(*range_delete_lock, std::adopt_lock);
+  exclusive_schema_lock_ = std::unique_lock<rw_semaphore>(*schema_lock);
+  TRACE("Acquired range delete and schema locks");
+  return Status::OK();
+}
+
 void WriteOpState::ReleaseSchemaLock() {
   shared_lock<rw_semaphore> temp;
   schema_lock_.swap(temp);
+  if (exclusive_schema_lock_.owns_lock()) {
+    exclusive_schema_lock_.unlock();
+  }
+  if (range_delete_lock_.owns_lock()) {
+    range_delete_lock_.unlock();
+  }
   TRACE("Released schema lock");
 }
 
@@ -438,6 +475,11 @@ void WriteOpState::SetRowOps(vector<DecodedRowOperation> decoded_ops) {
   }
 }
 
+bool WriteOpState::is_range_delete() const {
+  return !row_ops_.empty() &&
+      row_ops_[0]->decoded_op.type == RowOperationsPB::DELETE_RANGE;
+}
+
 void WriteOpState::StartApplying() {
   CHECK_NOTNULL(mvcc_op_.get())->StartApplying();
 }
@@ -445,6 +487,20 @@ void WriteOpState::StartApplying() {
 void WriteOpState::FinishApplyingOrAbort(Op::OpResult result) {
   ReleaseMvccTxn(result);
 
+  // The writes are visible or aborted: their rows may be cached again.
+  if (row_cache_) {
+    if (is_range_delete()) {
+      row_cache_->FinishInvalidating();
+    } else {
+      for (const RowOp* op : row_ops_) {
+        if (op->key_probe) {
+          row_cache_->FinishWriting(op->key_probe->encoded_key_slice());
+        }
+      }
+    }
+    row_cache_ = nullptr;
+  }
+
   TRACE("Releasing partition, row and schema locks");
   ReleaseRowLocks();
   if (result == Op::APPLIED) {
@@ -524,6 +580,9 @@ void WriteOpState::UpdateMetricsForOp(const RowOp& op) {
         op_metrics_.successful_deletes++;
       }
       break;
+    case RowOperationsPB::DELETE_RANGE:
+      op_metrics_.successful_range_deletes++;
+      break;
     case RowOperationsPB::UNKNOWN:
     case RowOperationsPB::SPLIT_ROW:
     case RowOperationsPB::RANGE_LOWER_BOUND:
@@ -53,6 +53,7 @@ class RequestIdPB;
 
 namespace tablet {
 
+class RowCache;
 class ScopedOp;
 class TabletReplica;
 class TxResultPB;
@@ -173,6 +174,15 @@ class WriteOpState : public OpState {
   // the writes.
   void AcquireSchemaLock(rw_semaphore* schema_lock);
 
+  // Take exclusive locks on the given range delete lock and schema lock, in
+  // that order, in place of the shared schema lock. Range deletes require
+  // that no other write happens until they're applied.
+  //
+  // The range delete lock isn't waited for, since it's held for whole
+  // compactions: returns ServiceUnavailable if it's held, so that the write
+  // is retried.
+  Status AcquireRangeDeleteLocks(rw_semaphore* schema_lock, rw_semaphore* range_delete_lock);
+
   // Acquire row locks for all of the rows in this Write.
   void AcquireRowLocks(LockManager* lock_manager);
 
@@ -188,7 +198,8 @@ class WriteOpState : public OpState {
   // transaction is available to be written to, returning an error if not.
   Status AcquireTxnLockCheckOpen(scoped_refptr<Txn> txn);
 
-  // Release the already-acquired schema lock.
+  // Release the already-acquired schema lock, and the range delete locks if
+  // any.
   void ReleaseSchemaLock();
 
   void ReleaseMvccTxn(Op::OpResult result);
@@ -235,6 +246,19 @@ class WriteOpState : public OpState {
     return row_ops_;
   }
 
+  // Whether the row operations are range deletes, which are only ever batched
+  // together.
+  bool is_range_delete() const;
+
+  // Records that RowCache::StartWriting() was called on 'row_cache' for the
+  // keys of the row operations, or RowCache::StartInvalidating() for range
+  // deletes, so that FinishApplyingOrAbort() calls RowCache::FinishWriting()
+  // for them, or RowCache::FinishInvalidating().
+  void set_writing_to_row_cache(RowCache* row_cache) {
+    DCHECK(!row_cache_);
+    row_cache_ = row_cache;
+  }
+
   // Return the ProbeStats object collecting statistics for op index 'i'.
   ProbeStats* mutable_op_stats(int i) {
     DCHECK_LT(i, row_ops_.size());
@@ -298,6 +322,9 @@ class WriteOpState : public OpState {
   // Holds the row locks acquired for this operation.
   ScopedRowLock rows_lock_;
 
+  // See set_writing_to_row_cache().
+  RowCache* row_cache_ = nullptr;
+
   // Holds the partition lock acquired for this operation.
   ScopedPartitionLock partition_lock_;
 
@@ -321,6 +348,10 @@ class WriteOpState : public OpState {
   // from racing with a write.
   shared_lock<rw_semaphore> schema_lock_;
 
+  // The locks held by range deletes instead of 'schema_lock_'.
+  std::unique_lock<rw_semaphore> exclusive_schema_lock_;
+  std::unique_lock<rw_semaphore> range_delete_lock_;
+
   // The Schema of the tablet when the op was first decoded. This is verified
   // at APPLY time to ensure we don't have races against schema change.
   // Protected by op_state_lock_.
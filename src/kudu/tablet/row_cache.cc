@@ -0,0 +1,159 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/row_cache.h"
+
+#include <cstring>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/hash/string_hash.h"
+
+using std::string;
+
+namespace kudu {
+namespace tablet {
+
+RowCache::RowCache(size_t capacity_bytes)
+    : cache_(NewCache<Cache::EvictionPolicy::LRU>(capacity_bytes, "tablet-row-cache")),
+      epoch_(0),
+      invalidations_in_flight_(0) {
+  for (size_t i = 0; i < kNumStripes; i++) {
+    generations_[i].store(0);
+    writes_in_flight_[i].store(0);
+  }
+}
+
+size_t RowCache::StripeIdx(const Slice& encoded_key) const {
+  return HashStringThoroughly(reinterpret_cast<const char*>(encoded_key.data()),
+                              encoded_key.size()) & (kNumStripes - 1);
+}
+
+string RowCache::CacheKey(uint64_t epoch, const Slice& encoded_key) {
+  string key(reinterpret_cast<const char*>(&epoch), sizeof(epoch));
+  key.append(reinterpret_cast<const char*>(encoded_key.data()), encoded_key.size());
+  return key;
+}
+
+RowCache::Token RowCache::GetToken(const Slice& encoded_key) const {
+  // The generation is loaded before the writes in flight: a write which
+  // started after it was loaded changes it, so the token doesn't allow
+  // caching a row which might predate the write.
+  const size_t idx = StripeIdx(encoded_key);
+  Token token;
+  token.generation = generations_[idx].load();
+  token.may_cache = writes_in_flight_[idx].load() == 0;
+  // Likewise, the epoch is loaded before the invalidations in flight.
+  token.epoch = epoch_.load();
+  token.may_cache &= invalidations_in_flight_.load() == 0;
+  return token;
+}
+
+Cache::UniqueHandle RowCache::Lookup(const Token& token, const Slice& encoded_key) {
+  return cache_->Lookup(CacheKey(token.epoch, encoded_key), Cache::EXPECT_IN_CACHE);
+}
+
+const uint8_t* RowCache::Row(const Cache::UniqueHandle& handle) const {
+  return cache_->Value(handle).data();
+}
+
+void RowCache::Insert(const Token& token, const Slice& encoded_key,
+                      const Schema& schema, const RowBlockRow& row) {
+  if (!token.may_cache) {
+    return;
+  }
+  // The row's indirect data is copied into the entry, after the row.
+  size_t indirect_size = 0;
+  for (size_t i = 0; i < schema.num_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (col.type_info()->physical_type() == BINARY &&
+        !(col.is_nullable() && row.is_null(i))) {
+      indirect_size += reinterpret_cast<const Slice*>(row.cell_ptr(i))->size();
+    }
+  }
+  const string key = CacheKey(token.epoch, encoded_key);
+  const size_t row_size = schema.byte_size();
+  auto pending(cache_->Allocate(key, row_size + indirect_size));
+  if (!pending) {
+    return;
+  }
+  uint8_t* value = cache_->MutableValue(&pending);
+  memset(value, 0, row_size);
+  ContiguousRow dst(&schema, value);
+  uint8_t* indirect = value + row_size;
+  for (size_t i = 0; i < schema.num_columns(); i++) {
+    const ColumnSchema& col = schema.column(i);
+    if (col.is_nullable()) {
+      const bool is_null = row.is_null(i);
+      dst.set_null(i, is_null);
+      if (is_null) {
+        continue;
+      }
+    }
+    if (col.type_info()->physical_type() == BINARY) {
+      const Slice* src = reinterpret_cast<const Slice*>(row.cell_ptr(i));
+      memcpy(indirect, src->data(), src->size());
+      *reinterpret_cast<Slice*>(dst.mutable_cell_ptr(i)) = Slice(indirect, src->size());
+      indirect += src->size();
+    } else {
+      memcpy(dst.mutable_cell_ptr(i), row.cell_ptr(i), col.type_info()->size());
+    }
+  }
+  cache_->Insert(std::move(pending), nullptr);
+
+  // A StartWriting() for the key racing with this call either sees the entry
+  // and erases it, or changes the generation before the check below.
+  const Token current = GetToken(encoded_key);
+  if (current.epoch != token.epoch || current.generation != token.generation) {
+    cache_->Erase(key);
+  }
+}
+
+void RowCache::StartWriting(const Slice& encoded_key) {
+  const size_t idx = StripeIdx(encoded_key);
+  writes_in_flight_[idx].fetch_add(1);
+  generations_[idx].fetch_add(1);
+  cache_->Erase(CacheKey(epoch_.load(), encoded_key));
+}
+
+void RowCache::FinishWriting(const Slice& encoded_key) {
+  const int64_t prev = writes_in_flight_[StripeIdx(encoded_key)].fetch_sub(1);
+  DCHECK_GT(prev, 0);
+}
+
+void RowCache::InvalidateAll() {
+  epoch_.fetch_add(1);
+}
+
+void RowCache::StartInvalidating() {
+  invalidations_in_flight_.fetch_add(1);
+  InvalidateAll();
+}
+
+void RowCache::FinishInvalidating() {
+  const int64_t prev = invalidations_in_flight_.fetch_sub(1);
+  DCHECK_GT(prev, 0);
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,129 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+class RowBlockRow;
+class Schema;
+
+namespace tablet {
+
+// A cache of the latest versions of a tablet's rows, keyed by their encoded
+// primary keys, for point lookups of hot keys which then don't have to go
+// through the tablet's rowsets.
+//
+// The rows are cached with all of the columns of the tablet's schema. The
+// tablet must call StartWriting() for the keys of a write before applying
+// it, and FinishWriting() once it's visible or aborted. A schema change must
+// exclude concurrent uses of the cache, and call InvalidateAll(). A write
+// which may change rows of any key, like a range delete, calls
+// StartInvalidating() before applying it, and FinishInvalidating() once it's
+// visible or aborted.
+//
+// A row may only be cached with a Token taken before the MVCC snapshot it
+// was read at, while none of the writes to keys of its stripe of the keys'
+// hashes were in flight, and stays cached only if none started since. So a
+// row can't be cached with a version older than the latest visible one, and
+// its entry is dropped before any write to its key becomes visible.
+//
+// The memory used by the cached rows is tracked by a MemTracker shared by the
+// row caches of all of the tablets, and bounded by each cache's capacity.
+//
+// This class is thread-safe.
+class RowCache {
+ public:
+  explicit RowCache(size_t capacity_bytes);
+
+  // The state of the writes to a key at some point.
+  struct Token {
+    uint64_t epoch;
+    uint64_t generation;
+    // Whether no write to a key of the stripe was in flight.
+    bool may_cache;
+  };
+
+  // Returns the current state of the writes to 'encoded_key'.
+  Token GetToken(const Slice& encoded_key) const;
+
+  // Looks up the cached row of 'encoded_key'. Returns a null handle if it
+  // isn't cached. Otherwise, the row, laid out according to the schema it
+  // was cached with, is at Row(handle) until the handle is destroyed.
+  Cache::UniqueHandle Lookup(const Token& token, const Slice& encoded_key);
+
+  // The row of an entry returned by Lookup().
+  const uint8_t* Row(const Cache::UniqueHandle& handle) const;
+
+  // Caches 'row', laid out according to 'schema', as the row of
+  // 'encoded_key', unless 'token' doesn't allow it or a write to the key
+  // started since it was taken.
+  void Insert(const Token& token, const Slice& encoded_key,
+              const Schema& schema, const RowBlockRow& row);
+
+  // Drops the cached row of 'encoded_key', if any, and keeps rows of the
+  // keys of its stripe from being cached until the matching FinishWriting().
+  void StartWriting(const Slice& encoded_key);
+  void FinishWriting(const Slice& encoded_key);
+
+  // Drops all of the cached rows.
+  void InvalidateAll();
+
+  // Drops all of the cached rows, and keeps any row from being cached until
+  // the matching FinishInvalidating().
+  void StartInvalidating();
+  void FinishInvalidating();
+
+ private:
+  // Must be a power of 2.
+  static constexpr size_t kNumStripes = 64;
+
+  size_t StripeIdx(const Slice& encoded_key) const;
+
+  // The key of the entry of 'encoded_key' in 'epoch'.
+  static std::string CacheKey(uint64_t epoch, const Slice& encoded_key);
+
+  const std::unique_ptr<Cache> cache_;
+
+  // Incremented by InvalidateAll(). Entries are keyed by the epoch too, so
+  // that the earlier epochs' entries are unreachable, and eventually evicted.
+  std::atomic<uint64_t> epoch_;
+
+  // Incremented by StartWriting() for the keys of each stripe.
+  std::array<std::atomic<uint64_t>, kNumStripes> generations_;
+
+  // The number of writes in flight to the keys of each stripe.
+  std::array<std::atomic<int64_t>, kNumStripes> writes_in_flight_;
+
+  // The number of writes in flight which may change rows of any key.
+  std::atomic<int64_t> invalidations_in_flight_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowCache);
+};
+
+} // namespace tablet
+} // namespace kudu
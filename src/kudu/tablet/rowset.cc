@@ -17,6 +17,8 @@
 
 #include "kudu/tablet/rowset.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <memory>
 #include <string>
@@ -30,6 +32,7 @@
 #include "kudu/common/timestamp.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset_metadata.h"
+#include "kudu/util/array_view.h"
 
 using std::shared_ptr;
 using std::string;
@@ -47,7 +50,18 @@ RowIteratorOptions::RowIteratorOptions()
     : projection(nullptr),
       snap_to_include(MvccSnapshot::CreateSnapshotIncludingAllOps()),
       order(OrderMode::UNORDERED),
-      include_deleted_rows(false) {}
+      include_deleted_rows(false),
+      parallel_scan_pool(nullptr),
+      parallel_scan_threads(1) {}
+
+Status RowSet::CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                                const IOContext* io_context,
+                                bool* present, ProbeStats* const* stats) const {
+  for (size_t i = 0; i < probes.size(); i++) {
+    RETURN_NOT_OK(CheckRowPresent(*probes[i], io_context, &present[i], stats[i]));
+  }
+  return Status::OK();
+}
 
 Status RowSet::NewRowIteratorWithBounds(const RowIteratorOptions& opts,
                                         IterWithBounds* out) const {
@@ -239,6 +253,11 @@ Status DuplicatingRowSet::CountLiveRows(uint64_t* count) const {
   return Status::OK();
 }
 
+bool DuplicatingRowSet::HasRangeTombstones() const {
+  return std::any_of(old_rowsets_.begin(), old_rowsets_.end(),
+                     [](const shared_ptr<RowSet>& rs) { return rs->HasRangeTombstones(); });
+}
+
 Status DuplicatingRowSet::GetBounds(string* min_encoded_key,
                                     string* max_encoded_key) const {
   // The range out of the output rowset always spans the full range
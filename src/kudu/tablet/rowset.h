@@ -35,17 +35,20 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/util/array_view.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/status.h"
 // IWYU pragma: no_include "kudu/util/monotime.h"
 
 namespace kudu {
 
+class EncodedKey;
 class MonoTime; // IWYU pragma: keep
 class RowChangeList;
 class RowwiseIterator;
 class Schema;
 class Slice;
+class ThreadPool;
 struct ColumnId;
 struct IterWithBounds;
 
@@ -101,6 +104,15 @@ struct RowIteratorOptions {
   //
   // Defaults to false.
   bool include_deleted_rows;
+
+  // If set, an UNORDERED iteration over several rowsets reads up to
+  // 'parallel_scan_threads' of them at a time on this pool.
+  //
+  // Defaults to nullptr.
+  ThreadPool* parallel_scan_pool;
+
+  // Defaults to 1.
+  int parallel_scan_threads;
 };
 
 class RowSet {
@@ -120,6 +132,15 @@ class RowSet {
   virtual Status CheckRowPresent(const RowSetKeyProbe &probe, const fs::IOContext* io_context,
                                  bool *present, ProbeStats* stats) const = 0;
 
+  // Like CheckRowPresent(), but for a batch of probes, which should be sorted
+  // by key. The i-th entries of 'present' and 'stats' correspond to the i-th
+  // probe.
+  //
+  // The default implementation checks each probe in turn.
+  virtual Status CheckRowsPresent(ArrayView<const RowSetKeyProbe* const> probes,
+                                  const fs::IOContext* io_context,
+                                  bool* present, ProbeStats* const* stats) const;
+
   // Update/delete a row in this rowset.
   // The 'update_schema' is the client schema used to encode the 'update' RowChangeList.
   //
@@ -133,6 +154,20 @@ class RowSet {
                            ProbeStats* stats,
                            OperationResultPB* result) = 0;
 
+  // Deletes the rows whose keys are in [lower_bound, upper_bound) as of
+  // 'timestamp', by recording a range tombstone rather than a delta per row.
+  // A null bound leaves the range unbounded on its side. The rows must have
+  // no mutations in memory.
+  //
+  // The metadata isn't flushed. Returns NotSupported if the rowset can't store
+  // range tombstones.
+  virtual Status DeleteRange(const EncodedKey* /*lower_bound*/,
+                             const EncodedKey* /*upper_bound*/,
+                             Timestamp /*timestamp*/,
+                             const fs::IOContext* /*io_context*/) {
+    return Status::NotSupported("range tombstones not supported", ToString());
+  }
+
   // Return a new iterator for this rowset, with the given options.
   //
   // Pointers in 'opts' must remain valid for the lifetime of the iterator.
@@ -164,6 +199,10 @@ class RowSet {
   // Count the number of live rows in this rowset.
   virtual Status CountLiveRows(uint64_t* count) const = 0;
 
+  // Returns true if rows of this rowset were deleted by range tombstones,
+  // which CountLiveRows() doesn't account for until they're compacted.
+  virtual bool HasRangeTombstones() const { return false; }
+
   // Return the bounds for this RowSet. 'min_encoded_key' and 'max_encoded_key'
   // are set to the first and last encoded keys for this RowSet.
   //
@@ -229,6 +268,16 @@ class RowSet {
   virtual Status IsDeletedAndFullyAncient(Timestamp ancient_history_mark,
                                           bool* deleted_and_ancient) = 0;
 
+  // Returns whether every row of the rowset has a value of the TTL column
+  // 'ttl_col_id' below 'cutoff_micros', i.e. every row outlived the table's
+  // TTL.
+  //
+  // This may return false negatives, but should not return false positives.
+  virtual Status IsExpired(const ColumnId& ttl_col_id,
+                           int64_t cutoff_micros,
+                           const fs::IOContext* io_context,
+                           bool* expired) = 0;
+
   // Estimate the number of bytes in ancient undo delta stores. This may be an
   // overestimate. The argument 'ancient_history_mark' must be valid (it may
   // not be equal to Timestamp::kInvalidTimestamp).
@@ -281,6 +330,21 @@ class RowSet {
                                          int64_t* blocks_deleted,
                                          int64_t* bytes_deleted) = 0;
 
+  // Estimate the rate, in accesses per second, at which this rowset has served
+  // scans and key probes since it was opened. Used by the compaction policy to
+  // favor compacting the rowsets that reads actually touch.
+  virtual double ReadAccessRate() const { return 0; }
+
+  // Returns whether the rowset may have rows inserted, updated, or deleted by
+  // ops applied in 'snap_to_include' but not in 'snap_to_exclude', i.e.
+  // whether a diff scan between the two snapshots may return any of its rows.
+  //
+  // This may return false positives, but should not return false negatives.
+  virtual bool MayHaveChangesBetween(const MvccSnapshot& /*snap_to_exclude*/,
+                                     const MvccSnapshot& /*snap_to_include*/) const {
+    return true;
+  }
+
   virtual ~RowSet() {}
 
   // Return true if this RowSet is available for compaction, based on
@@ -325,6 +389,13 @@ class RowSetKeyProbe {
         encoded_key_(EncodedKey::FromContiguousRow(row_key_, arena)),
         bloom_probe_(BloomKeyProbe(encoded_key_slice())) {}
 
+  // Like above, with 'encoded_key' the key of 'row_key' encoded beforehand,
+  // e.g. with EncodedKey::FromContiguousRows().
+  RowSetKeyProbe(ConstContiguousRow row_key, EncodedKey* encoded_key)
+      : row_key_(row_key),
+        encoded_key_(encoded_key),
+        bloom_probe_(BloomKeyProbe(encoded_key_slice())) {}
+
   const ConstContiguousRow& row_key() const { return row_key_; }
 
   // Pointer to the key which has been encoded to be contiguous
@@ -409,6 +480,8 @@ class DuplicatingRowSet : public RowSet {
 
   virtual Status CountLiveRows(uint64_t* count) const override;
 
+  bool HasRangeTombstones() const override;
+
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const override;
 
@@ -485,6 +558,15 @@ class DuplicatingRowSet : public RowSet {
     return Status::OK();
   }
 
+  Status IsExpired(const ColumnId& /*ttl_col_id*/,
+                   int64_t /*cutoff_micros*/,
+                   const fs::IOContext* /*io_context*/,
+                   bool* expired) override {
+    DCHECK(expired);
+    *expired = false;
+    return Status::OK();
+  }
+
   Status InitUndoDeltas(Timestamp /*ancient_history_mark*/,
                         MonoTime /*deadline*/,
                         const fs::IOContext* /*io_context*/,
@@ -71,6 +71,20 @@ TAG_FLAG(compaction_small_rowset_tradeoff, advanced);
 TAG_FLAG(compaction_small_rowset_tradeoff, experimental);
 TAG_FLAG(compaction_small_rowset_tradeoff, runtime);
 
+DEFINE_double(compaction_read_cost_weight, 0,
+              "How much the observed read traffic of a rowset weighs in its "
+              "value as a compaction candidate. The height reduction of a "
+              "compaction is weighted by 1 + weight * (the rate of scans and "
+              "key probes of its hottest rowset / the mean rate of the "
+              "tablet's rowsets), so that compactions favor the key ranges "
+              "reads actually touch over cold ones. A value of 0 ignores read "
+              "traffic.");
+DEFINE_validator(compaction_read_cost_weight,
+                 [](const char* /*n*/, double v) { return v >= 0; });
+TAG_FLAG(compaction_read_cost_weight, advanced);
+TAG_FLAG(compaction_read_cost_weight, experimental);
+TAG_FLAG(compaction_read_cost_weight, runtime);
+
 // Enforce a minimum size of 1MB, since otherwise the knapsack algorithm
 // will always pick up small rowsets no matter what.
 static const int kMinSizeMb = 1;
@@ -349,8 +363,17 @@ void RowSetInfo::ComputeCdfAndCollectOrdered(const RowSetTree& tree,
   CheckCollectOrderedCorrectness(info_by_min_key_tmp,
                                  info_by_max_key_tmp,
                                  total_width);
-  FinalizeCDFVector(total_width, &info_by_min_key_tmp);
-  FinalizeCDFVector(total_width, &info_by_max_key_tmp);
+  // Both vectors hold the same rowsets, so either may be used to compute the
+  // tablet-wide mean read rate.
+  double mean_read_rate = 0;
+  if (FLAGS_compaction_read_cost_weight > 0 && !info_by_min_key_tmp.empty()) {
+    for (const auto& rsi : info_by_min_key_tmp) {
+      mean_read_rate += rsi.extra_->read_rate;
+    }
+    mean_read_rate /= info_by_min_key_tmp.size();
+  }
+  FinalizeCDFVector(total_width, mean_read_rate, &info_by_min_key_tmp);
+  FinalizeCDFVector(total_width, mean_read_rate, &info_by_max_key_tmp);
 
   if (rowset_total_height && rowset_total_width) {
     *rowset_total_height = weighted_height_sum;
@@ -451,11 +474,13 @@ void RowSetInfo::SplitKeyRange(const RowSetTree& tree,
 RowSetInfo::RowSetInfo(RowSet* rs, double init_cdf)
     : cdf_min_key_(init_cdf),
       cdf_max_key_(init_cdf),
+      read_weight_(1),
       extra_(new ExtraData()) {
   extra_->rowset = rs;
   extra_->base_and_redos_size_bytes = rs->OnDiskBaseDataSizeWithRedos();
   extra_->size_bytes = rs->OnDiskSize();
   extra_->has_bounds = rs->GetBounds(&extra_->min_key, &extra_->max_key).ok();
+  extra_->read_rate = rs->ReadAccessRate();
   base_and_redos_size_mb_ =
       std::max(implicit_cast<int>(extra_->base_and_redos_size_bytes / 1024 / 1024),
                                   kMinSizeMb);
@@ -465,7 +490,8 @@ uint64_t RowSetInfo::size_bytes(const ColumnId& col_id) const {
   return extra_->rowset->OnDiskBaseDataColumnSize(col_id);
 }
 
-void RowSetInfo::FinalizeCDFVector(double quot, vector<RowSetInfo>* vec) {
+void RowSetInfo::FinalizeCDFVector(double quot, double mean_read_rate,
+                                   vector<RowSetInfo>* vec) {
   if (quot == 0) return;
   for (RowSetInfo& cdf_rs : *vec) {
     CHECK_GT(cdf_rs.base_and_redos_size_mb_, 0)
@@ -475,7 +501,13 @@ void RowSetInfo::FinalizeCDFVector(double quot, vector<RowSetInfo>* vec) {
         << " bytes.";
     cdf_rs.cdf_min_key_ /= quot;
     cdf_rs.cdf_max_key_ /= quot;
-    cdf_rs.value_ = ComputeRowsetValue(cdf_rs.width(), cdf_rs.extra_->size_bytes);
+    cdf_rs.read_weight_ = 1;
+    if (mean_read_rate > 0) {
+      cdf_rs.read_weight_ +=
+          FLAGS_compaction_read_cost_weight * cdf_rs.extra_->read_rate / mean_read_rate;
+    }
+    cdf_rs.value_ = ComputeRowsetValue(cdf_rs.width() * cdf_rs.read_weight_,
+                                       cdf_rs.extra_->size_bytes);
     cdf_rs.density_ = cdf_rs.value_ / cdf_rs.base_and_redos_size_mb_;
   }
 }
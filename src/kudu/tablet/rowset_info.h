@@ -104,6 +104,10 @@ class RowSetInfo {
 
   double density() const { return density_; }
 
+  // The weight of the rowset's read traffic: 1 if it isn't taken into account,
+  // or for rowsets as read as the average. See --compaction_read_cost_weight.
+  double read_weight() const { return read_weight_; }
+
   RowSet* rowset() const { return extra_->rowset; }
 
   std::string ToString() const;
@@ -118,7 +122,11 @@ class RowSetInfo {
  private:
   explicit RowSetInfo(RowSet* rs, double init_cdf);
 
-  static void FinalizeCDFVector(double quot, std::vector<RowSetInfo>* vec);
+  // Normalizes the cdf values of the rowsets in 'vec' by 'quot' and computes
+  // their values and densities. If 'mean_read_rate' is positive, the width of
+  // each rowset is weighted by its read rate relative to 'mean_read_rate'.
+  static void FinalizeCDFVector(double quot, double mean_read_rate,
+                                std::vector<RowSetInfo>* vec);
 
   // The size of the base data and redos in MB, already clamped so that all
   // rowsets have size at least 1MB. This is cached to avoid the branch during
@@ -129,7 +137,11 @@ class RowSetInfo {
 
   // The value of the rowset is its value as an item in the compaction knapsack
   // problem:
-  // value = width + tradeoff * (1 - size in bytes / target size in bytes).
+  // value = width * read weight + tradeoff * (1 - size in bytes / target size in bytes).
+  //
+  // The union width of a compaction is weighted by the read weight of its
+  // hottest rowset, so that only the height reduction is weighted: a rowset
+  // alone still reduces no height.
   double value_;
 
   // The density is the density of the rowset as an item in compaction knapsack
@@ -139,6 +151,8 @@ class RowSetInfo {
   // used to compare rowsets.
   double density_;
 
+  double read_weight_;
+
   // We move these out of the RowSetInfo object because the std::strings are relatively
   // large objects, and we'd like the RowSetInfos to be as small as possible so that
   // the algorithm can fit mostly in CPU cache. The string bounds themselves are rarely
@@ -157,6 +171,9 @@ class RowSetInfo {
     bool has_bounds;
     std::string min_key, max_key;
 
+    // Cached version of rowset_->ReadAccessRate().
+    double read_rate;
+
     // The original RowSet that this RowSetInfo was constructed from.
     RowSet* rowset;
   };
@@ -105,6 +105,40 @@ void RowSetMetadata::LoadFromPB(const RowSetDataPB& pb) {
     blocks_by_col_id_[col_id] = BlockId::FromPB(col_pb.block());
   }
 
+  // Load Secondary Index Files.
+  secondary_index_blocks_.clear();
+  for (const ColumnDataPB& index_pb : pb.secondary_indexes()) {
+    secondary_index_blocks_[ColumnId(index_pb.column_id())] = BlockId::FromPB(index_pb.block());
+  }
+
+  // Load Bitmap Index Files.
+  bitmap_index_blocks_.clear();
+  for (const ColumnDataPB& index_pb : pb.bitmap_indexes()) {
+    bitmap_index_blocks_[ColumnId(index_pb.column_id())] = BlockId::FromPB(index_pb.block());
+  }
+
+  // Load Column Bloom Files.
+  column_bloom_blocks_.clear();
+  for (const ColumnDataPB& bloom_pb : pb.column_bloom_filters()) {
+    column_bloom_blocks_[ColumnId(bloom_pb.column_id())] = BlockId::FromPB(bloom_pb.block());
+  }
+
+  sorted_column_ids_.clear();
+  for (int32_t col_id : pb.sorted_column_ids()) {
+    sorted_column_ids_.emplace_back(col_id);
+  }
+
+  cluster_id_ = pb.has_cluster_id() ? pb.cluster_id() : kNoClusterId;
+
+  range_tombstones_.clear();
+  for (const RangeTombstonePB& tombstone_pb : pb.range_tombstones()) {
+    range_tombstones_.push_back({ Timestamp(tombstone_pb.timestamp()),
+                                  tombstone_pb.first_row(),
+                                  tombstone_pb.last_row() });
+  }
+
+  column_stats_.assign(pb.column_stats().begin(), pb.column_stats().end());
+
   // Load redo delta files.
   redo_delta_blocks_.clear();
   for (const DeltaDataPB& redo_delta_pb : pb.redo_deltas()) {
@@ -140,6 +174,46 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
     col_data->set_column_id(col_id);
   }
 
+  // Write Secondary Index Files
+  for (const ColumnIdToBlockIdMap::value_type& e : secondary_index_blocks_) {
+    ColumnDataPB* index_data = pb->add_secondary_indexes();
+    e.second.CopyToPB(index_data->mutable_block());
+    index_data->set_column_id(e.first);
+  }
+
+  // Write Bitmap Index Files
+  for (const ColumnIdToBlockIdMap::value_type& e : bitmap_index_blocks_) {
+    ColumnDataPB* index_data = pb->add_bitmap_indexes();
+    e.second.CopyToPB(index_data->mutable_block());
+    index_data->set_column_id(e.first);
+  }
+
+  // Write Column Bloom Files
+  for (const ColumnIdToBlockIdMap::value_type& e : column_bloom_blocks_) {
+    ColumnDataPB* bloom_data = pb->add_column_bloom_filters();
+    e.second.CopyToPB(bloom_data->mutable_block());
+    bloom_data->set_column_id(e.first);
+  }
+
+  for (ColumnId col_id : sorted_column_ids_) {
+    pb->add_sorted_column_ids(col_id);
+  }
+
+  if (cluster_id_ != kNoClusterId) {
+    pb->set_cluster_id(cluster_id_);
+  }
+
+  for (const RangeTombstone& tombstone : range_tombstones_) {
+    RangeTombstonePB* tombstone_pb = pb->add_range_tombstones();
+    tombstone_pb->set_timestamp(tombstone.timestamp.value());
+    tombstone_pb->set_first_row(tombstone.first_row);
+    tombstone_pb->set_last_row(tombstone.last_row);
+  }
+
+  for (const ColumnStatisticsPB& stats : column_stats_) {
+    *pb->add_column_stats() = stats;
+  }
+
   // Write Delta Files
   pb->set_last_durable_dms_id(last_durable_redo_dms_id_);
 
@@ -186,6 +260,69 @@ void RowSetMetadata::SetColumnDataBlocks(const std::map<ColumnId, BlockId>& bloc
   blocks_by_col_id_ = std::move(new_map);
 }
 
+void RowSetMetadata::SetSecondaryIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(blocks_by_col_id.begin(), blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  secondary_index_blocks_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetBitmapIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(blocks_by_col_id.begin(), blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  bitmap_index_blocks_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetColumnBloomBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id) {
+  ColumnIdToBlockIdMap new_map(blocks_by_col_id.begin(), blocks_by_col_id.end());
+  new_map.shrink_to_fit();
+  std::lock_guard<LockType> l(lock_);
+  column_bloom_blocks_ = std::move(new_map);
+}
+
+void RowSetMetadata::SetSortedColumnIds(vector<ColumnId> col_ids) {
+  std::lock_guard<LockType> l(lock_);
+  sorted_column_ids_ = std::move(col_ids);
+}
+
+void RowSetMetadata::SetClusterId(int32_t cluster_id) {
+  std::lock_guard<LockType> l(lock_);
+  cluster_id_ = cluster_id;
+}
+
+void RowSetMetadata::SetColumnStatistics(vector<ColumnStatisticsPB> stats) {
+  std::lock_guard<LockType> l(lock_);
+  column_stats_ = std::move(stats);
+}
+
+void RowSetMetadata::AddRangeTombstone(const RangeTombstone& tombstone) {
+  DCHECK_LT(tombstone.first_row, tombstone.last_row);
+  std::lock_guard<LockType> l(lock_);
+  if (std::find(range_tombstones_.begin(), range_tombstones_.end(), tombstone) ==
+      range_tombstones_.end()) {
+    range_tombstones_.push_back(tombstone);
+  }
+}
+
+void RowSetMetadata::RemoveColumnIndexesUnlocked(ColumnId col_id, BlockIdContainer* removed) {
+  sorted_column_ids_.erase(
+      std::remove(sorted_column_ids_.begin(), sorted_column_ids_.end(), col_id),
+      sorted_column_ids_.end());
+  column_stats_.erase(
+      std::remove_if(column_stats_.begin(), column_stats_.end(),
+                     [&](const ColumnStatisticsPB& stats) { return stats.column_id() == col_id; }),
+      column_stats_.end());
+  for (auto* indexes : { &secondary_index_blocks_, &bitmap_index_blocks_,
+                         &column_bloom_blocks_ }) {
+    BlockId block_id;
+    if (FindCopy(*indexes, col_id, &block_id)) {
+      indexes->erase(col_id);
+      removed->push_back(block_id);
+    }
+  }
+}
+
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
                                                 int64_t num_deleted_rows,
                                                 const BlockId& block_id) {
@@ -255,10 +392,9 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
         << vector<BlockId>(undos_to_remove.begin(), undos_to_remove.end())
         << " }";
 
-    if (!update.new_undo_block_.IsNull()) {
-      // Front-loading to keep the UNDO files in their natural order.
-      undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
-    }
+    // Front-loading to keep the UNDO files in their natural order.
+    undo_delta_blocks_.insert(undo_delta_blocks_.begin(),
+                              update.new_undo_blocks_.begin(), update.new_undo_blocks_.end());
 
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
       // If we are major-compacting deltas into a column which previously had no
@@ -268,13 +404,19 @@ void RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update,
       if (UpdateReturnCopy(&blocks_by_col_id_, e.first, e.second, &old_block_id)) {
         removed->push_back(old_block_id);
       }
+      // The column's indexes no longer match its new base data.
+      RemoveColumnIndexesUnlocked(e.first, removed);
     }
 
     for (const ColumnId& col_id : update.col_ids_to_remove_) {
       BlockId old = FindOrDie(blocks_by_col_id_, col_id);
       CHECK_EQ(1, blocks_by_col_id_.erase(col_id));
       removed->push_back(old);
+      RemoveColumnIndexesUnlocked(col_id, removed);
     }
+
+    column_stats_.insert(column_stats_.end(), update.new_column_stats_.begin(),
+                         update.new_column_stats_.end());
   }
 
   blocks_by_col_id_.shrink_to_fit();
@@ -308,6 +450,9 @@ BlockIdContainer RowSetMetadata::GetAllBlocks() {
     blocks.push_back(bloom_block_);
   }
   AppendValuesFromMap(blocks_by_col_id_, &blocks);
+  AppendValuesFromMap(secondary_index_blocks_, &blocks);
+  AppendValuesFromMap(bitmap_index_blocks_, &blocks);
+  AppendValuesFromMap(column_bloom_blocks_, &blocks);
 
   blocks.insert(blocks.end(),
                 undo_delta_blocks_.begin(), undo_delta_blocks_.end());
@@ -348,8 +493,13 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
   return *this;
 }
 
-RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block) {
-  new_undo_block_ = undo_block;
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetColumnStatistics(ColumnStatisticsPB stats) {
+  new_column_stats_.emplace_back(std::move(stats));
+  return *this;
+}
+
+RowSetMetadataUpdate& RowSetMetadataUpdate::AddNewUndoBlock(const BlockId& undo_block) {
+  new_undo_blocks_.push_back(undo_block);
   return *this;
 }
 
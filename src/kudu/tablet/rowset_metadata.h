@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -30,7 +31,10 @@
 #include <boost/optional/optional.hpp>
 #include <glog/logging.h>
 
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
@@ -74,6 +78,23 @@ class RowSetMetadata {
   // objects.
   typedef boost::container::flat_map<ColumnId, BlockId> ColumnIdToBlockIdMap;
 
+  // The rows [first_row, last_row) of the rowset, deleted by a range delete
+  // at 'timestamp'. See RangeTombstonePB.
+  struct RangeTombstone {
+    Timestamp timestamp;
+    rowid_t first_row;
+    rowid_t last_row;
+
+    bool operator==(const RangeTombstone& other) const {
+      return timestamp == other.timestamp &&
+          first_row == other.first_row &&
+          last_row == other.last_row;
+    }
+  };
+
+  // The cluster id of a rowset whose rows aren't clustered.
+  static constexpr int32_t kNoClusterId = -1;
+
   // Create a new RowSetMetadata
   static Status CreateNew(TabletMetadata* tablet_metadata,
                           int64_t id,
@@ -117,6 +138,23 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
 
+  void SetSecondaryIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
+
+  void SetBitmapIndexBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
+
+  void SetColumnBloomBlocks(const std::map<ColumnId, BlockId>& blocks_by_col_id);
+
+  void SetSortedColumnIds(std::vector<ColumnId> col_ids);
+
+  void SetClusterId(int32_t cluster_id);
+
+  // Sets the statistics of the values of the columns of the base data.
+  void SetColumnStatistics(std::vector<ColumnStatisticsPB> stats);
+
+  // Records a range delete of rows of the rowset. Adding a tombstone which is
+  // already recorded, e.g. when replaying the range delete, is a no-op.
+  void AddRangeTombstone(const RangeTombstone& tombstone);
+
   // Atomically commit the new redo delta block to RowSetMetadata.
   // This atomic operation includes updates to last_durable_redo_dms_id_ and live_row_count_.
   Status CommitRedoDeltaDataBlock(int64_t dms_id,
@@ -181,6 +219,59 @@ class RowSetMetadata {
     return blocks_by_col_id_;
   }
 
+  // The blocks of the columns' secondary indexes. Columns without a secondary
+  // index are absent.
+  ColumnIdToBlockIdMap GetSecondaryIndexBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return secondary_index_blocks_;
+  }
+
+  // The blocks of the columns' bitmap indexes. Columns without a bitmap index
+  // are absent.
+  ColumnIdToBlockIdMap GetBitmapIndexBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return bitmap_index_blocks_;
+  }
+
+  // The blocks of the columns' bloom filters. Columns without a bloom filter
+  // are absent.
+  ColumnIdToBlockIdMap GetColumnBloomBlocksById() const {
+    std::lock_guard<LockType> l(lock_);
+    return column_bloom_blocks_;
+  }
+
+  // Whether the base data of the column is non-null and non-decreasing in
+  // rowid order. See RowSetDataPB.sorted_column_ids.
+  bool is_column_sorted(ColumnId col_id) const {
+    std::lock_guard<LockType> l(lock_);
+    return std::find(sorted_column_ids_.begin(), sorted_column_ids_.end(), col_id) !=
+        sorted_column_ids_.end();
+  }
+
+  // The cluster of the rows of the rowset, or kNoClusterId if its rows aren't
+  // clustered. See RowSetDataPB.cluster_id.
+  int32_t cluster_id() const {
+    std::lock_guard<LockType> l(lock_);
+    return cluster_id_;
+  }
+
+  std::vector<RangeTombstone> range_tombstones() const {
+    std::lock_guard<LockType> l(lock_);
+    return range_tombstones_;
+  }
+
+  bool has_range_tombstones() const {
+    std::lock_guard<LockType> l(lock_);
+    return !range_tombstones_.empty();
+  }
+
+  // The statistics of the values of the columns of the base data, if collected
+  // when written. See RowSetDataPB.column_stats.
+  std::vector<ColumnStatisticsPB> column_stats() const {
+    std::lock_guard<LockType> l(lock_);
+    return column_stats_;
+  }
+
   std::vector<BlockId> redo_delta_blocks() const {
     std::lock_guard<LockType> l(lock_);
     return redo_delta_blocks_;
@@ -245,6 +336,7 @@ class RowSetMetadata {
   explicit RowSetMetadata(TabletMetadata *tablet_metadata)
     : tablet_metadata_(tablet_metadata),
       initted_(false),
+      cluster_id_(kNoClusterId),
       last_durable_redo_dms_id_(kNoDurableMemStore),
       live_row_count_(0) {
   }
@@ -254,6 +346,7 @@ class RowSetMetadata {
     : tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       initted_(true),
       id_(id),
+      cluster_id_(kNoClusterId),
       last_durable_redo_dms_id_(kNoDurableMemStore),
       live_row_count_(0) {
   }
@@ -262,6 +355,11 @@ class RowSetMetadata {
 
   void IncrementLiveRowsUnlocked(int64_t row_count);
 
+  // Removes the indexes and the bloom filter of the given column, if any,
+  // appending their blocks to 'removed'. The column is no longer considered
+  // sorted either, and its statistics are dropped.
+  void RemoveColumnIndexesUnlocked(ColumnId col_id, BlockIdContainer* removed);
+
   TabletMetadata* const tablet_metadata_;
   bool initted_;
   int64_t id_;
@@ -278,6 +376,16 @@ class RowSetMetadata {
 
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
+  // Map of column ID to the block ID of the column's secondary index.
+  ColumnIdToBlockIdMap secondary_index_blocks_;
+  // Map of column ID to the block ID of the column's bitmap index.
+  ColumnIdToBlockIdMap bitmap_index_blocks_;
+  // Map of column ID to the block ID of the column's bloom filter.
+  ColumnIdToBlockIdMap column_bloom_blocks_;
+  std::vector<ColumnId> sorted_column_ids_;
+  int32_t cluster_id_;
+  std::vector<RangeTombstone> range_tombstones_;
+  std::vector<ColumnStatisticsPB> column_stats_;
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
@@ -314,14 +422,18 @@ class RowSetMetadataUpdate {
   // Remove the CFile for the given column ID.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
+  // Set the statistics of the values of a column whose CFile is replaced.
+  RowSetMetadataUpdate& SetColumnStatistics(ColumnStatisticsPB stats);
+
   // Add a new UNDO delta block to the list of UNDO files.
   // We'll need to replace them instead when we start GCing.
-  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block);
+  RowSetMetadataUpdate& AddNewUndoBlock(const BlockId& undo_block);
 
  private:
   friend class RowSetMetadata;
   RowSetMetadata::ColumnIdToBlockIdMap cols_to_replace_;
   std::vector<ColumnId> col_ids_to_remove_;
+  std::vector<ColumnStatisticsPB> new_column_stats_;
   std::vector<BlockId> new_redo_blocks_;
 
   struct ReplaceDeltaBlocks {
@@ -331,7 +443,7 @@ class RowSetMetadataUpdate {
   std::vector<ReplaceDeltaBlocks> replace_redo_blocks_;
 
   std::vector<BlockId> remove_undo_blocks_;
-  BlockId new_undo_block_;
+  std::vector<BlockId> new_undo_blocks_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadataUpdate);
 };
@@ -44,6 +44,7 @@
 #include "kudu/util/test_util.h"
 
 using std::make_shared;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unordered_set;
@@ -213,6 +214,104 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+// A tree reset incrementally from another one is the same as one built from
+// scratch with the same rowsets.
+TEST_F(TestRowSetTree, TestIncrementalReset) {
+  RowSetVector vec;
+  vec.push_back(make_shared<MockDiskRowSet>("0", "5"));
+  vec.push_back(make_shared<MockDiskRowSet>("3", "5"));
+  vec.push_back(make_shared<MockDiskRowSet>("5", "9"));
+  vec.push_back(make_shared<MockMemRowSet>());
+  RowSetTree old_tree;
+  ASSERT_OK(old_tree.Reset(vec));
+
+  // Compact the first two rowsets into two new ones, and flush the MemRowSet.
+  RowSetVector to_remove = { vec[0], vec[1], vec[3] };
+  RowSetVector to_add = {
+    make_shared<MockDiskRowSet>("0", "2"),
+    make_shared<MockDiskRowSet>("3", "8"),
+    make_shared<MockMemRowSet>(),
+  };
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(old_tree, to_remove, to_add));
+
+  RowSetVector expected_rowsets = { vec[2], to_add[0], to_add[1], to_add[2] };
+  RowSetTree expected;
+  ASSERT_OK(expected.Reset(expected_rowsets));
+  ASSERT_EQ(expected.all_rowsets(), tree.all_rowsets());
+  ASSERT_EQ(expected.key_endpoints().size(), tree.key_endpoints().size());
+  for (int i = 0; i < tree.key_endpoints().size(); i++) {
+    const auto& a = expected.key_endpoints()[i];
+    const auto& b = tree.key_endpoints()[i];
+    ASSERT_EQ(a.rowset_, b.rowset_);
+    ASSERT_EQ(a.endpoint_, b.endpoint_);
+    ASSERT_EQ(a.slice_, b.slice_);
+  }
+  for (const char* key : { "1", "3", "5", "8", "9" }) {
+    SCOPED_TRACE(key);
+    vector<RowSet*> expected_out;
+    vector<RowSet*> out;
+    expected.FindRowSetsWithKeyInRange(key, &expected_out);
+    tree.FindRowSetsWithKeyInRange(key, &out);
+    std::sort(expected_out.begin(), expected_out.end());
+    std::sort(out.begin(), out.end());
+    ASSERT_EQ(expected_out, out);
+  }
+
+  // The old tree is still usable.
+  vector<RowSet*> out;
+  old_tree.FindRowSetsWithKeyInRange("4", &out);
+  ASSERT_EQ(3, out.size());
+
+  // Removing a rowset which isn't in the tree fails.
+  RowSetTree bad_tree;
+  ASSERT_TRUE(bad_tree.Reset(tree, { vec[0] }, {}).IsInvalidArgument());
+}
+
+// Keys beyond the bounds of every DiskRowSet only go to the MemRowSet.
+TEST_F(TestRowSetTree, TestKeysBeyondBounds) {
+  RowSetVector vec;
+  vec.push_back(make_shared<MockDiskRowSet>("0", "5"));
+  vec.push_back(make_shared<MockDiskRowSet>("3", "7"));
+  vec.push_back(make_shared<MockMemRowSet>());
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  ASSERT_EQ("7", tree.max_bounded_key()->ToString());
+
+  vector<RowSet*> out;
+  tree.FindRowSetsWithKeyInRange("8", &out);
+  ASSERT_EQ(1, out.size());
+  ASSERT_EQ(vec[2].get(), out[0]);
+
+  vector<pair<RowSet*, int>> matches;
+  const vector<Slice> keys = { "4", "7", "8", "9" };
+  tree.ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int i) {
+    matches.emplace_back(rs, i);
+  });
+  std::sort(matches.begin(), matches.end());
+  vector<pair<RowSet*, int>> expected = {
+    { vec[0].get(), 0 },
+    { vec[1].get(), 0 },
+    { vec[1].get(), 1 },
+    { vec[2].get(), 0 },
+    { vec[2].get(), 1 },
+    { vec[2].get(), 2 },
+    { vec[2].get(), 3 },
+  };
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(expected, matches);
+
+  // Without DiskRowSets, the keys only go to the MemRowSet.
+  RowSetTree mrs_only;
+  ASSERT_OK(mrs_only.Reset({ vec[2] }));
+  ASSERT_FALSE(mrs_only.max_bounded_key());
+  matches.clear();
+  mrs_only.ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int i) {
+    matches.emplace_back(rs, i);
+  });
+  ASSERT_EQ(keys.size(), matches.size());
+}
+
 TEST_F(TestRowSetTree, TestTreeRandomized) {
   enum BoundOperator {
     BOUND_LESS_THAN,
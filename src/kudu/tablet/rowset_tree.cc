@@ -20,14 +20,18 @@
 #include <algorithm>
 #include <cstddef>
 #include <functional>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <ostream>
 
 #include <glog/logging.h>
 
-#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/port.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/util/interval_tree.h"
@@ -36,7 +40,7 @@
 
 using std::shared_ptr;
 using std::string;
-using std::unique_ptr;
+using std::unordered_set;
 using std::vector;
 
 namespace kudu {
@@ -126,19 +130,14 @@ RowSetTree::RowSetTree()
   : initted_(false) {
 }
 
-Status RowSetTree::Reset(const RowSetVector &rowsets) {
-  CHECK(!initted_);
-  std::vector<RowSetWithBounds *> entries;
-  RowSetVector unbounded;
-  ElementDeleter deleter(&entries);
-  entries.reserve(rowsets.size());
-  std::vector<RSEndpoint> endpoints;
-  endpoints.reserve(rowsets.size()*2);
-
+Status RowSetTree::AddRowSets(const RowSetVector& rowsets,
+                              EntryVector* entries,
+                              RowSetVector* unbounded,
+                              vector<RSEndpoint>* endpoints) {
   // Iterate over each of the provided RowSets, fetching their
   // bounds and adding them to the local vectors.
   for (const shared_ptr<RowSet> &rs : rowsets) {
-    unique_ptr<RowSetWithBounds> rsit(new RowSetWithBounds());
+    auto rsit = std::make_shared<RowSetWithBounds>();
     rsit->rowset = rs.get();
     string min_key;
     string max_key;
@@ -148,7 +147,7 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
       // data gets inserted. Therefore we can't put it in the static
       // interval tree -- instead put it on the list which is consulted
       // on every access.
-      unbounded.push_back(rs);
+      unbounded->push_back(rs);
       continue;
     } else if (!s.ok()) {
       LOG(WARNING) << "Unable to construct RowSetTree: "
@@ -164,24 +163,35 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
     rsit->max_key = std::move(max_key);
 
     // Load into key endpoints.
-    endpoints.emplace_back(rsit->rowset, START, rsit->min_key);
-    endpoints.emplace_back(rsit->rowset, STOP, rsit->max_key);
+    endpoints->emplace_back(rsit->rowset, START, rsit->min_key);
+    endpoints->emplace_back(rsit->rowset, STOP, rsit->max_key);
 
-    entries.push_back(rsit.release());
+    entries->emplace_back(std::move(rsit));
   }
+  return Status::OK();
+}
 
-  // Sort endpoints
-  std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
+void RowSetTree::Install(RowSetVector rowsets,
+                         EntryVector entries,
+                         RowSetVector unbounded,
+                         vector<RSEndpoint> endpoints) {
+  DCHECK(std::is_sorted(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare));
+  vector<RowSetWithBounds*> intervals;
+  intervals.reserve(entries.size());
+  for (const auto& e : entries) {
+    intervals.push_back(e.get());
+  }
 
   // Install the vectors into the object.
-  entries_.swap(entries);
-  unbounded_rowsets_.swap(unbounded);
-  tree_.reset(new IntervalTree<RowSetIntervalTraits>(entries_));
-  key_endpoints_.swap(endpoints);
-  all_rowsets_.assign(rowsets.begin(), rowsets.end());
+  entries_ = std::move(entries);
+  unbounded_rowsets_ = std::move(unbounded);
+  tree_.reset(new IntervalTree<RowSetIntervalTraits>(intervals));
+  key_endpoints_ = std::move(endpoints);
+  all_rowsets_ = std::move(rowsets);
 
   // Build the mapping from DRS ID to DRS.
   drs_by_id_.clear();
+  drs_by_id_.reserve(all_rowsets_.size());
   for (auto& rs : all_rowsets_) {
     if (rs->metadata()) {
       InsertOrDie(&drs_by_id_, rs->metadata()->id(), rs.get());
@@ -189,7 +199,82 @@ Status RowSetTree::Reset(const RowSetVector &rowsets) {
   }
 
   initted_ = true;
+}
+
+Status RowSetTree::Reset(const RowSetVector &rowsets) {
+  CHECK(!initted_);
+  EntryVector entries;
+  RowSetVector unbounded;
+  entries.reserve(rowsets.size());
+  std::vector<RSEndpoint> endpoints;
+  endpoints.reserve(rowsets.size()*2);
+  RETURN_NOT_OK(AddRowSets(rowsets, &entries, &unbounded, &endpoints));
+
+  // Sort endpoints
+  std::sort(endpoints.begin(), endpoints.end(), RSEndpointBySliceCompare);
+
+  Install(RowSetVector(rowsets.begin(), rowsets.end()), std::move(entries),
+          std::move(unbounded), std::move(endpoints));
+  return Status::OK();
+}
+
+Status RowSetTree::Reset(const RowSetTree& old_tree,
+                         const RowSetVector& to_remove,
+                         const RowSetVector& to_add) {
+  CHECK(!initted_);
+  DCHECK(old_tree.initted_);
+  unordered_set<const RowSet*> removed;
+  for (const auto& rs : to_remove) {
+    removed.insert(rs.get());
+  }
+  const auto is_removed = [&](const RowSet* rs) {
+    return ContainsKey(removed, rs);
+  };
+
+  RowSetVector rowsets;
+  rowsets.reserve(old_tree.all_rowsets_.size() + to_add.size());
+  for (const auto& rs : old_tree.all_rowsets_) {
+    if (!is_removed(rs.get())) {
+      rowsets.push_back(rs);
+    }
+  }
+  if (PREDICT_FALSE(rowsets.size() + removed.size() != old_tree.all_rowsets_.size())) {
+    return Status::InvalidArgument("some of the rowsets to remove aren't in the tree");
+  }
 
+  EntryVector entries;
+  entries.reserve(old_tree.entries_.size() + to_add.size());
+  for (const auto& e : old_tree.entries_) {
+    if (!is_removed(e->rowset)) {
+      entries.push_back(e);
+    }
+  }
+  RowSetVector unbounded;
+  for (const auto& rs : old_tree.unbounded_rowsets_) {
+    if (!is_removed(rs.get())) {
+      unbounded.push_back(rs);
+    }
+  }
+
+  // Only the endpoints of the rowsets added need sorting: the others are
+  // sorted already.
+  vector<RSEndpoint> added_endpoints;
+  added_endpoints.reserve(to_add.size() * 2);
+  RETURN_NOT_OK(AddRowSets(to_add, &entries, &unbounded, &added_endpoints));
+  std::sort(added_endpoints.begin(), added_endpoints.end(), RSEndpointBySliceCompare);
+  vector<RSEndpoint> kept_endpoints;
+  kept_endpoints.reserve(old_tree.key_endpoints_.size());
+  std::copy_if(old_tree.key_endpoints_.begin(), old_tree.key_endpoints_.end(),
+               std::back_inserter(kept_endpoints),
+               [&](const RSEndpoint& e) { return !is_removed(e.rowset_); });
+  vector<RSEndpoint> endpoints;
+  endpoints.reserve(kept_endpoints.size() + added_endpoints.size());
+  std::merge(kept_endpoints.begin(), kept_endpoints.end(),
+             added_endpoints.begin(), added_endpoints.end(),
+             std::back_inserter(endpoints), RSEndpointBySliceCompare);
+
+  rowsets.insert(rowsets.end(), to_add.begin(), to_add.end());
+  Install(std::move(rowsets), std::move(entries), std::move(unbounded), std::move(endpoints));
   return Status::OK();
 }
 
@@ -223,6 +308,10 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
 
   // Query the interval tree to efficiently find rowsets with known bounds
   // whose ranges overlap the probe key.
+  const auto max_key = max_bounded_key();
+  if (!max_key || encoded_key.compare(*max_key) > 0) {
+    return;
+  }
   vector<RowSetWithBounds *> from_tree;
   from_tree.reserve(all_rowsets_.size());
   tree_->FindContainingPoint(encoded_key, &from_tree);
@@ -245,13 +334,26 @@ void RowSetTree::ForEachRowSetContainingKeys(
     }
   }
 
+  // Only the keys up to the greatest key of the rowsets with known bounds may
+  // be in any of them: appends of increasing keys skip the tree altogether.
+  const auto max_key = max_bounded_key();
+  if (!max_key) {
+    return;
+  }
+  const size_t num_queries = std::upper_bound(encoded_keys.cbegin(), encoded_keys.cend(),
+                                              *max_key, Slice::Comparator()) -
+      encoded_keys.cbegin();
+  if (num_queries == 0) {
+    return;
+  }
+
   // The interval tree batch query callback would naturally just give us back
   // the matching Slices, but that won't allow us to easily tell the caller
   // which specific operation _index_ matched the RowSet. So, we make a vector
   // of QueryStructs to pair the Slice with its original index.
   vector<QueryStruct> queries;
-  queries.resize(encoded_keys.size());
-  for (int i = 0; i < encoded_keys.size(); i++) {
+  queries.resize(num_queries);
+  for (int i = 0; i < num_queries; i++) {
     queries[i] = {encoded_keys[i], i};
   }
 
@@ -264,7 +366,6 @@ void RowSetTree::ForEachRowSetContainingKeys(
 
 
 RowSetTree::~RowSetTree() {
-  STLDeleteElements(&entries_);
 }
 
 } // namespace tablet
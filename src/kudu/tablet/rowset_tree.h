@@ -67,6 +67,19 @@ class RowSetTree {
 
   RowSetTree();
   Status Reset(const RowSetVector &rowsets);
+
+  // Resets the tree to the rowsets of 'old_tree' but 'to_remove', followed by
+  // 'to_add', as after a flush or a compaction.
+  //
+  // This is cheaper than Reset() with those rowsets: the bounds of the
+  // rowsets kept are shared with 'old_tree' rather than fetched again, and
+  // their endpoints are merged with those of the rowsets added rather than
+  // sorted again. Only the interval tree is built from scratch.
+  //
+  // Returns InvalidArgument if some of 'to_remove' aren't in 'old_tree'.
+  Status Reset(const RowSetTree& old_tree,
+               const RowSetVector& to_remove,
+               const RowSetVector& to_add);
   ~RowSetTree();
 
   // Return all RowSets whose range may contain the given encoded key.
@@ -82,6 +95,10 @@ class RowSetTree {
   // See IntervalTree::ForEachIntervalContainingPoints for additional
   // information on the particular order in which the callback will be called.
   //
+  // Keys beyond max_bounded_key(), e.g. those of appends of increasing keys,
+  // are only matched against the unbounded rowsets, without querying the
+  // interval tree.
+  //
   // REQUIRES: 'encoded_keys' must be in sorted order.
   void ForEachRowSetContainingKeys(const std::vector<Slice>& encoded_keys,
                                    const std::function<void(RowSet*, int)>& cb) const;
@@ -99,6 +116,15 @@ class RowSetTree {
 
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
+  // Returns the greatest key of the rowsets with known bounds, or none if
+  // there are none. Greater keys may only be in the unbounded rowsets.
+  boost::optional<Slice> max_bounded_key() const {
+    if (key_endpoints_.empty()) {
+      return boost::none;
+    }
+    return key_endpoints_.back().slice_;
+  }
+
   RowSet* drs_by_id(int64_t drs_id) const {
     return FindPtrOrNull(drs_by_id_, drs_id);
   }
@@ -109,6 +135,22 @@ class RowSetTree {
   const std::vector<RSEndpoint>& key_endpoints() const { return key_endpoints_; }
 
  private:
+  typedef std::vector<std::shared_ptr<RowSetWithBounds>> EntryVector;
+
+  // Fetches the bounds of 'rowsets', appending those with known bounds to
+  // 'entries' and 'endpoints', and the others to 'unbounded'.
+  static Status AddRowSets(const RowSetVector& rowsets,
+                           EntryVector* entries,
+                           RowSetVector* unbounded,
+                           std::vector<RSEndpoint>* endpoints);
+
+  // Installs the given state, building the interval tree of 'entries'.
+  // 'endpoints' must be sorted.
+  void Install(RowSetVector rowsets,
+               EntryVector entries,
+               RowSetVector unbounded,
+               std::vector<RSEndpoint> endpoints);
+
   // Interval tree of the rowsets. Used to efficiently find rowsets which might contain
   // a probe row.
   std::unique_ptr<IntervalTree<RowSetIntervalTraits>> tree_;
@@ -120,8 +162,10 @@ class RowSetTree {
 
   // Container for all of the entries in tree_. IntervalTree does
   // not itself manage memory, so this provides a simple way to enumerate
-  // all the entry structs and free them in the destructor.
-  std::vector<RowSetWithBounds *> entries_;
+  // all the entry structs and free them once no tree uses them. The entries
+  // are immutable, so those of the rowsets a flush or a compaction doesn't
+  // touch are shared with the trees after it.
+  EntryVector entries_;
 
   // All of the rowsets which were put in this RowSetTree.
   RowSetVector all_rowsets_;
@@ -23,6 +23,7 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -57,6 +58,7 @@ DEFINE_int32(decoder_eval_test_strlen, 10, "Number of strings per cell");
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -159,18 +161,21 @@ public:
 
   void TestTimedScanWithBounds(size_t strlen, size_t lower_val,
                                size_t upper_val, int* fetched) {
-    Arena arena(128);
-    ScanSpec spec;
-
     // Generate the predicate.
     const string lower_string = LeftZeroPadded(lower_val, strlen);
     const string upper_string = LeftZeroPadded(upper_val, strlen);
     Slice lower(lower_string);
     Slice upper(upper_string);
-    auto string_pred = ColumnPredicate::Range(schema_.column(2), &lower, &upper);
+    TestTimedScanWithPredicate(ColumnPredicate::Range(schema_.column(2), &lower, &upper),
+                               fetched);
+  }
+
+  void TestTimedScanWithPredicate(const ColumnPredicate& pred, int* fetched) {
+    Arena arena(128);
+    ScanSpec spec;
 
     // Prepare the scan.
-    spec.AddPredicate(string_pred);
+    spec.AddPredicate(pred);
     spec.OptimizeScan(schema_, &arena, true);
     ScanSpec orig_spec = spec;
     unique_ptr<RowwiseIterator> iter;
@@ -181,11 +186,55 @@ public:
 
     // Execute and time the scan. Argument fetched is an output and will be set
     // to the number of rows returned in the result set.
-    LOG_TIMING(INFO, "Filtering by string value") {
+    LOG_TIMING(INFO, Substitute("Filtering by $0", pred.ToString())) {
       ASSERT_OK(SilentIterateToStringList(iter.get(), fetched));
     }
   }
 
+  // Fills a tablet with the values [0, cardinality) and scans it with
+  // equality or IN-list predicates on 'values', each of which is resolved
+  // against the dictionary once and then applied to the codewords.
+  void TestScanWithValues(size_t cardinality, const vector<size_t>& values) {
+    if (GetParam() == LARGE && !AllowSlowTests()) {
+      LOG(INFO) << "Skipped large test case";
+      return;
+    }
+    size_t nrows = static_cast<size_t>(GetParam());
+    size_t strlen = std::max(static_cast<size_t>(FLAGS_decoder_eval_test_strlen),
+                             Substitute("$0", cardinality).length());
+    FillTestTablet(nrows, cardinality, strlen, -1);
+
+    vector<string> value_strings;
+    vector<const void*> value_slices;
+    size_t expected_count = 0;
+    value_strings.reserve(values.size());
+    for (size_t v : values) {
+      value_strings.emplace_back(LeftZeroPadded(v, strlen));
+      expected_count += ExpectedCount(nrows, cardinality, v, v + 1);
+    }
+    vector<Slice> slices(value_strings.begin(), value_strings.end());
+    for (const auto& slice : slices) {
+      value_slices.push_back(&slice);
+    }
+
+    for (int i = 0; i < FLAGS_decoder_eval_test_nrepeats; i++) {
+      int fetched = 0;
+      if (values.size() == 1) {
+        NO_FATALS(TestTimedScanWithPredicate(
+            ColumnPredicate::Equality(schema_.column(2), value_slices[0]), &fetched));
+      } else {
+        vector<const void*> in_list = value_slices;
+        NO_FATALS(TestTimedScanWithPredicate(
+            ColumnPredicate::InList(schema_.column(2), &in_list), &fetched));
+      }
+      ASSERT_EQ(expected_count, fetched);
+      LOG(INFO) << "Nrows: " << nrows
+                << ", Cardinality: " << cardinality
+                << ", Expected: " << expected_count
+                << ", Actual: " << fetched;
+    }
+  }
+
   size_t ExpectedCount(size_t nrows, size_t cardinality, size_t lower, size_t upper) {
     if (lower >= upper || lower >= cardinality) {
       return 0;
@@ -291,6 +340,24 @@ TEST_P(TabletDecoderEvalTest, HighCardinality) {
   TestScanAndFilter(50000, FLAGS_decoder_eval_test_lower, FLAGS_decoder_eval_test_upper);
 }
 
+TEST_P(TabletDecoderEvalTest, LowCardinalityEquality) {
+  TestScanWithValues(50, { 7 });
+}
+
+TEST_P(TabletDecoderEvalTest, LowCardinalityInList) {
+  TestScanWithValues(50, { 3, 10, 20, 49 });
+}
+
+TEST_P(TabletDecoderEvalTest, HighCardinalityInList) {
+  TestScanWithValues(50000, { 3, 100, 20000, 49999 });
+}
+
+TEST_P(TabletDecoderEvalTest, EvaluateAllMatching) {
+  // Predicate [0, k) matches every word of the dictionary, so the decoders
+  // skip evaluating it altogether.
+  TestScanAndFilter(50, 0, 50);
+}
+
 TEST_P(TabletDecoderEvalTest, EvaluateEmpty) {
   // Predicate [k, k+5) will not evaluate to None, but will return no rows.
   TestScanAndFilter(50, 50, 55);
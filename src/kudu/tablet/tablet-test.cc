@@ -33,6 +33,7 @@
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
@@ -58,6 +59,7 @@
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/rowset_tree.h"
+#include "kudu/tablet/tablet-harness.h"
 #include "kudu/tablet/tablet-test-base.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.pb.h"
@@ -285,6 +287,53 @@ TYPED_TEST(TestTablet, TestInsertDuplicateKey) {
   NO_FATALS(this->CheckLiveRowsCount(1));
 }
 
+// Test that rows read from another tablet can be bulk loaded into an empty
+// tablet, and that they are then treated as if they had been inserted.
+TYPED_TEST(TestTablet, TestBulkLoad) {
+  const int64_t kNumRows = this->ClampRowCount(1000);
+  TabletHarness source(this->schema_, TabletHarness::Options(this->GetTestPath("source")));
+  ASSERT_OK(source.Create(true));
+  ASSERT_OK(source.Open());
+  {
+    LocalTabletWriter writer(source.tablet().get(), &this->client_schema_);
+    for (int64_t i = 0; i < kNumRows; i++) {
+      ASSERT_OK(this->InsertTestRow(&writer, i, 0));
+    }
+  }
+  MvccSnapshot before_load(*this->tablet()->mvcc_manager());
+
+  unique_ptr<RowwiseIterator> iter;
+  ASSERT_OK(source.tablet()->NewOrderedRowIterator(this->schema_, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  int64_t rows_loaded = 0;
+  ASSERT_OK(this->tablet()->BulkLoad(iter.get(), &rows_loaded));
+  ASSERT_EQ(kNumRows, rows_loaded);
+  ASSERT_EQ(1, this->tablet()->num_rowsets());
+  NO_FATALS(this->VerifyTestRows(0, kNumRows));
+  NO_FATALS(this->CheckLiveRowsCount(kNumRows));
+
+  // The rows are invisible to snapshots taken before the load.
+  RowIteratorOptions opts;
+  opts.projection = &this->client_schema_;
+  opts.snap_to_include = before_load;
+  ASSERT_OK(this->tablet()->NewRowIterator(std::move(opts), &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> rows;
+  ASSERT_OK(IterateToStringList(iter.get(), &rows));
+  ASSERT_TRUE(rows.empty());
+
+  // The loaded keys are found by inserts.
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  Status s = this->InsertTestRow(&writer, 0, 0);
+  ASSERT_STR_CONTAINS(s.ToString(), "key already present");
+
+  // Only empty tablets may be loaded.
+  ASSERT_OK(source.tablet()->NewOrderedRowIterator(this->schema_, &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  s = this->tablet()->BulkLoad(iter.get(), &rows_loaded);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+}
+
 // Tests that we are able to handle reinserts properly.
 //
 // Namely tests that:
@@ -1253,6 +1302,153 @@ TYPED_TEST(TestTablet, TestCompactionWithConcurrentMutation) {
   }
 }
 
+// Test that range deletes delete the rows of their ranges, whether they're
+// stored in DRSs or in the MRS.
+TYPED_TEST(TestTablet, TestDeleteRange) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  // Rows 0-4 are flushed, with an update of row 3 in the DMS, and rows 5-9
+  // are in the MRS. Single digit keys sort the same for all the setups.
+  this->InsertTestRows(0, 5, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(5, 5, 0);
+  ASSERT_OK(this->UpdateTestRow(&writer, 3, 1));
+
+  const auto check_rows = [&](const vector<string>& expected) {
+    vector<string> rows;
+    ASSERT_OK(this->IterateToStringList(&rows));
+    std::sort(rows.begin(), rows.end());
+    ASSERT_EQ(expected, rows);
+  };
+
+  // Delete [2, 7), which spans both.
+  KuduPartialRow lower(&this->client_schema_);
+  KuduPartialRow upper(&this->client_schema_);
+  this->setup_.BuildRowKey(&lower, 2);
+  this->setup_.BuildRowKey(&upper, 7);
+  ASSERT_OK(writer.DeleteRange(lower, upper));
+  NO_FATALS(check_rows({ this->setup_.FormatDebugRow(0, 0, false),
+                         this->setup_.FormatDebugRow(1, 0, false),
+                         this->setup_.FormatDebugRow(7, 0, false),
+                         this->setup_.FormatDebugRow(8, 0, false),
+                         this->setup_.FormatDebugRow(9, 0, false) }));
+
+  // The deleted rows can't be mutated anymore, but they may be reinserted.
+  ASSERT_TRUE(this->UpdateTestRow(&writer, 4, 2).IsNotFound());
+  ASSERT_OK(this->InsertTestRow(&writer, 3, 2));
+
+  // Delete [8, +inf).
+  KuduPartialRow unbounded(&this->client_schema_);
+  this->setup_.BuildRowKey(&lower, 8);
+  ASSERT_OK(writer.DeleteRange(lower, unbounded));
+  const vector<string> expected = { this->setup_.FormatDebugRow(0, 0, false),
+                                    this->setup_.FormatDebugRow(1, 0, false),
+                                    this->setup_.FormatDebugRow(3, 2, false),
+                                    this->setup_.FormatDebugRow(7, 0, false) };
+  NO_FATALS(check_rows(expected));
+  ASSERT_EQ(2, this->tablet()->metrics()->ranges_deleted->value());
+
+  // Compactions drop the deleted rows for good.
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  NO_FATALS(check_rows(expected));
+}
+
+// Test that diff scans report the rows deleted by range deletes.
+TYPED_TEST(TestTablet, TestDiffScanWithRangeDelete) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  this->InsertTestRows(0, 5, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  const Timestamp before_delete = this->tablet()->clock()->Now();
+
+  KuduPartialRow lower(&this->client_schema_);
+  KuduPartialRow upper(&this->client_schema_);
+  this->setup_.BuildRowKey(&lower, 1);
+  this->setup_.BuildRowKey(&upper, 3);
+  ASSERT_OK(writer.DeleteRange(lower, upper));
+
+  vector<ColumnSchema> col_schemas(this->client_schema().columns());
+  bool read_default = false;
+  col_schemas.emplace_back("is_deleted", IS_DELETED, /*is_nullable=*/ false,
+                           &read_default);
+  Schema projection(col_schemas, this->client_schema().num_key_columns());
+  RowIteratorOptions opts;
+  opts.projection = &projection;
+  opts.snap_to_exclude = MvccSnapshot(before_delete);
+  opts.snap_to_include = MvccSnapshot(this->tablet()->clock()->Now());
+  opts.include_deleted_rows = true;
+  unique_ptr<RowwiseIterator> iter;
+  ASSERT_OK(this->tablet()->NewRowIterator(std::move(opts), &iter));
+  ASSERT_OK(iter->Init(nullptr));
+  vector<string> lines;
+  ASSERT_OK(IterateToStringList(iter.get(), &lines));
+
+  SCOPED_TRACE(JoinStrings(lines, "\n"));
+  ASSERT_EQ(2, lines.size());
+  for (const auto& line : lines) {
+    ASSERT_STR_CONTAINS(line, "is_deleted=true");
+  }
+}
+
+// Test that the live row counts of tablets with range deleted rows aren't used
+// as the row counts of scans until the rows are compacted.
+TYPED_TEST(TestTablet, TestNoRowCountForScansWithRangeTombstones) {
+  if (!this->tablet()->metadata()->supports_live_row_count()) {
+    GTEST_SKIP() << "live row counting not supported";
+  }
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  this->InsertTestRows(0, 5, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  uint64_t count;
+  ASSERT_OK(this->tablet()->CountLiveRowsForScan(&count));
+  ASSERT_EQ(5, count);
+
+  KuduPartialRow lower(&this->client_schema_);
+  KuduPartialRow upper(&this->client_schema_);
+  this->setup_.BuildRowKey(&lower, 1);
+  this->setup_.BuildRowKey(&upper, 3);
+  ASSERT_OK(writer.DeleteRange(lower, upper));
+  Status s = this->tablet()->CountLiveRowsForScan(&count);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_OK(this->tablet()->CountLiveRowsForScan(&count));
+  ASSERT_EQ(3, count);
+}
+
+TYPED_TEST(TestTablet, TestColumnStatistics) {
+  // Only the flushed rows are accounted for.
+  this->InsertTestRows(0, 50, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(50, 50, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(100, 10, 0);
+
+  vector<ColumnStatisticsPB> stats;
+  ASSERT_OK(this->tablet()->GetColumnStatistics(&stats));
+  ASSERT_EQ(this->schema_.num_columns(), stats.size());
+  for (int i = 0; i < stats.size(); i++) {
+    SCOPED_TRACE(this->schema_.column(i).ToString());
+    EXPECT_EQ(this->schema_.column_id(i), stats[i].column_id());
+    EXPECT_EQ(100, stats[i].null_count() + stats[i].value_count());
+  }
+  // The key columns have as many distinct values as rows.
+  EXPECT_NEAR(100, EstimateDistinctValues(stats[0]), 100 * 0.2);
+}
+
+// Range deletes can't share a batch with other operations.
+TYPED_TEST(TestTablet, TestDeleteRangeInMixedBatch) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  KuduPartialRow row(&this->client_schema_);
+  this->setup_.BuildRow(&row, 0, 0);
+  KuduPartialRow unbounded(&this->client_schema_);
+  vector<LocalTabletWriter::RowOp> ops;
+  ops.emplace_back(RowOperationsPB::INSERT, &row);
+  ops.emplace_back(RowOperationsPB::DELETE_RANGE, &unbounded);
+  ops.emplace_back(RowOperationsPB::RANGE_UPPER_BOUND, &unbounded);
+  Status s = writer.WriteBatch(ops);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "range deletes can't be batched");
+}
+
 // Test that metrics behave properly during tablet initialization
 TYPED_TEST(TestTablet, TestMetricsInit) {
   // Create a tablet, but do not open it
@@ -36,15 +36,19 @@
 
 #include "kudu/clock/clock.h"
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/key_range.h"
 #include "kudu/common/partition.h"
 #include "kudu/common/row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/row_operations.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
 #include "kudu/common/rowid.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
@@ -54,21 +58,26 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/fs/io_context.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/threading/thread_collision_warner.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/compaction_policy.h"
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/memrowset.h"
+#include "kudu/tablet/mutation.h"
 #include "kudu/tablet/ops/alter_schema_op.h"
 #include "kudu/tablet/ops/participant_op.h"
 #include "kudu/tablet/ops/write_op.h"
+#include "kudu/tablet/row_cache.h"
 #include "kudu/tablet/row_op.h"
+#include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/rowset_tree.h"
@@ -91,8 +100,11 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/process_memory.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/throttler.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
@@ -105,6 +117,17 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_int32(tablet_compaction_num_key_ranges, 1,
+             "Number of disjoint primary key ranges into which a rowset "
+             "compaction is split. The ranges are computed from the key bounds "
+             "and sizes of the input rowsets and are written concurrently, each "
+             "into its own output rowsets, which are committed together. Only "
+             "applies to compactions of on-disk rowsets, not to flushes.");
+DEFINE_validator(tablet_compaction_num_key_ranges,
+                 [](const char* /*n*/, int32_t v) { return v >= 1; });
+TAG_FLAG(tablet_compaction_num_key_ranges, experimental);
+TAG_FLAG(tablet_compaction_num_key_ranges, runtime);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -188,6 +211,32 @@ DEFINE_int32(rows_writed_per_sec_for_hot_tablets, 1000,
 TAG_FLAG(rows_writed_per_sec_for_hot_tablets, experimental);
 TAG_FLAG(rows_writed_per_sec_for_hot_tablets, runtime);
 
+DEFINE_int32(tablet_cold_data_threshold_secs, 7 * 24 * 60 * 60,
+             "Number of seconds without writes or scans after which the data of "
+             "a tablet is considered cold. Compactions of cold tablets write "
+             "their output to the capacity storage tier, if any data "
+             "directories are on it. See --fs_capacity_tier_data_dirs. "
+             "A value of 0 disables the placement of compaction output on "
+             "the capacity tier.");
+DEFINE_validator(tablet_cold_data_threshold_secs,
+                 [](const char* /*n*/, int32_t v) { return v >= 0; });
+TAG_FLAG(tablet_cold_data_threshold_secs, experimental);
+TAG_FLAG(tablet_cold_data_threshold_secs, runtime);
+
+DEFINE_int32(tablet_row_cache_capacity_mb, 0,
+             "Capacity of the cache of each tablet's latest rows for point "
+             "lookups (e.g. those of the MultiGet RPC). The rows found by "
+             "lookups are cached with all of their columns, and dropped when "
+             "written. 0 disables the cache.");
+TAG_FLAG(tablet_row_cache_capacity_mb, experimental);
+
+DEFINE_bool(tablet_diff_scan_skip_unchanged_rowsets, false,
+            "Whether diff scans skip the disk rowsets which, according to the "
+            "timestamp ranges of their delta stores, have no rows inserted, "
+            "updated, or deleted between the scans' start and end timestamps.");
+TAG_FLAG(tablet_diff_scan_skip_unchanged_rowsets, experimental);
+TAG_FLAG(tablet_diff_scan_skip_unchanged_rowsets, runtime);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -238,10 +287,43 @@ struct IteratorStats;
 
 namespace tablet {
 
+// The number of rows in each block written by a bulk load.
+static constexpr size_t kBulkLoadBlockNumRows = 1000;
+
 static CompactionPolicy *CreateCompactionPolicy() {
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
+// Splits the key space of the rowsets in a compaction into at most
+// --tablet_compaction_num_key_ranges ranges of roughly equal data size.
+// Leaves 'ranges' empty if the compaction shouldn't be split.
+static void ComputeCompactionKeyRanges(const RowSetVector& rowsets,
+                                       vector<KeyRange>* ranges) {
+  const int num_ranges = FLAGS_tablet_compaction_num_key_ranges;
+  if (num_ranges <= 1) {
+    return;
+  }
+  uint64_t total_size = 0;
+  for (const auto& rs : rowsets) {
+    string min_key, max_key;
+    if (!rs->GetBounds(&min_key, &max_key).ok()) {
+      // Without bounds (e.g. for a MemRowSet), the key space can't be split.
+      return;
+    }
+    total_size += rs->OnDiskBaseDataSizeWithRedos();
+  }
+  RowSetTree tree;
+  if (!tree.Reset(rowsets).ok()) {
+    return;
+  }
+  vector<KeyRange> split;
+  RowSetInfo::SplitKeyRange(tree, Slice(), Slice(), {},
+                            std::max<uint64_t>(1, total_size / num_ranges), &split);
+  if (split.size() > 1) {
+    *ranges = std::move(split);
+  }
+}
+
 ////////////////////////////////////////////////////////////
 // TabletComponents
 ////////////////////////////////////////////////////////////
@@ -271,6 +353,7 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
     txn_participant_(metadata_),
     rowsets_flush_sem_(1),
     state_(kInitialized),
+    data_version_(Random(GetRandomSeed32()).Next64()),
     last_write_time_(MonoTime::Now()),
     last_read_time_(MonoTime::Now()),
     last_update_workload_stats_time_(MonoTime::Now()),
@@ -280,6 +363,9 @@ Tablet::Tablet(scoped_refptr<TabletMetadata> metadata,
     last_write_score_(0.0) {
       CHECK(schema()->has_column_ids());
   compaction_policy_.reset(CreateCompactionPolicy());
+  if (FLAGS_tablet_row_cache_capacity_mb > 0) {
+    row_cache_.reset(new RowCache(FLAGS_tablet_row_cache_capacity_mb * 1024L * 1024L));
+  }
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -527,6 +613,158 @@ Status Tablet::NewRowIterator(RowIteratorOptions opts,
   return Status::OK();
 }
 
+Status Tablet::LookupRows(const Schema& projection,
+                          const vector<Slice>& encoded_keys,
+                          RowBlock* dst,
+                          vector<int>* key_indexes) const {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  DCHECK_GE(dst->row_capacity(), encoded_keys.size());
+  TRACE_EVENT1("tablet", "Tablet::LookupRows",
+               "num_keys", encoded_keys.size());
+
+  // The row cache only has rows of the tablet's columns, with all of them:
+  // rows read to be cached are read with all of the columns, and projected.
+  // Schema changes are excluded while it's used.
+  bool use_cache = row_cache_ != nullptr;
+  for (const auto& col : projection.columns()) {
+    if (col.type_info()->is_virtual()) {
+      use_cache = false;
+    }
+  }
+  shared_lock<rw_semaphore> schema_lock;
+  if (use_cache) {
+    shared_lock<rw_semaphore> l(schema_lock_);
+    schema_lock.swap(l);
+  }
+
+  Schema mapped_projection;
+  RETURN_NOT_OK(GetMappedReadProjection(projection, &mapped_projection));
+  const SchemaPtr schema_ptr = schema();
+  vector<RowCache::Token> tokens;
+  vector<int> cached_col_idxs;
+  if (use_cache) {
+    // The tokens must be taken before the snapshot.
+    tokens.reserve(encoded_keys.size());
+    for (const auto& key : encoded_keys) {
+      tokens.emplace_back(row_cache_->GetToken(key));
+    }
+    for (const auto& col : projection.columns()) {
+      cached_col_idxs.push_back(schema_ptr->find_column(col.name()));
+    }
+  }
+  const auto project_row = [&](const auto& src_row, RowBlockRow* dst_row) {
+    for (int col = 0; col < cached_col_idxs.size(); col++) {
+      auto dst_cell = dst_row->cell(col);
+      RETURN_NOT_OK(CopyCell(src_row.cell(cached_col_idxs[col]), &dst_cell, dst->arena()));
+    }
+    return Status::OK();
+  };
+
+  IOContext io_context({ tablet_id() });
+  RowIteratorOptions opts;
+  opts.projection = use_cache ? schema_ptr.get() : &mapped_projection;
+  opts.io_context = &io_context;
+  // As with NewRowIterator(), the snapshot is taken before the components are
+  // captured, so that the rows it includes can't have been flushed or
+  // compacted out of them.
+  opts.snap_to_include = MvccSnapshot(mvcc_);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  // Each key's rowsets are read into 'scratch' one at a time. The key ranges
+  // are a single key, so a row is all they can return.
+  RowBlockMemory scratch_mem;
+  RowBlock scratch(opts.projection, 1, &scratch_mem);
+  Arena key_arena(1024);
+  vector<RowSet*> rowsets;
+  key_indexes->clear();
+  size_t num_found = 0;
+  int64_t num_cache_hits = 0;
+  for (int i = 0; i < encoded_keys.size(); i++) {
+    if (use_cache) {
+      auto handle = row_cache_->Lookup(tokens[i], encoded_keys[i]);
+      if (handle) {
+        RowBlockRow dst_row = dst->row(num_found++);
+        RETURN_NOT_OK(project_row(
+            ConstContiguousRow(schema_ptr.get(), row_cache_->Row(handle)), &dst_row));
+        key_indexes->push_back(i);
+        num_cache_hits++;
+        continue;
+      }
+    }
+    key_arena.Reset();
+    EncodedKey* lower;
+    RETURN_NOT_OK_PREPEND(EncodedKey::DecodeEncodedString(
+        *schema_ptr, &key_arena, encoded_keys[i], &lower),
+        Substitute("invalid encoded key at index $0", i));
+    // The largest possible key has no successor: its range is unbounded.
+    EncodedKey* upper = lower;
+    if (!EncodedKey::IncrementEncodedKey(*schema_ptr, &upper, &key_arena).ok()) {
+      upper = nullptr;
+    }
+    uint8_t* key_row_data = static_cast<uint8_t*>(
+        key_arena.AllocateBytes(key_schema_.byte_size()));
+    ContiguousRow key_row(&key_schema_, key_row_data);
+    for (int col = 0; col < key_schema_.num_key_columns(); col++) {
+      memcpy(key_row.mutable_cell_ptr(col), lower->raw_keys()[col],
+             key_schema_.column(col).type_info()->size());
+    }
+    RowSetKeyProbe probe(ConstContiguousRow(key_row), lower);
+
+    rowsets.clear();
+    rowsets.push_back(comps->memrowset.get());
+    for (const auto& txn_mrs : comps->txn_memrowsets) {
+      rowsets.push_back(txn_mrs.get());
+    }
+    comps->rowsets->FindRowSetsWithKeyInRange(probe.encoded_key_slice(), &rowsets);
+
+    // At most one of the rowsets has a live version of the row.
+    bool found = false;
+    for (const RowSet* rs : rowsets) {
+      bool present;
+      ProbeStats stats;
+      RETURN_NOT_OK(rs->CheckRowPresent(probe, &io_context, &present, &stats));
+      if (!present) {
+        continue;
+      }
+      unique_ptr<RowwiseIterator> iter;
+      RETURN_NOT_OK(rs->NewRowIterator(opts, &iter));
+      ScanSpec spec;
+      spec.SetLowerBoundKey(lower);
+      if (upper) {
+        spec.SetExclusiveUpperBoundKey(upper);
+      }
+      RETURN_NOT_OK(iter->Init(&spec));
+      while (!found && iter->HasNext()) {
+        scratch_mem.Reset();
+        RETURN_NOT_OK(iter->NextBlock(&scratch));
+        if (scratch.nrows() == 0 || !scratch.selection_vector()->IsRowSelected(0)) {
+          continue;
+        }
+        RowBlockRow dst_row = dst->row(num_found++);
+        if (use_cache) {
+          RETURN_NOT_OK(project_row(scratch.row(0), &dst_row));
+          row_cache_->Insert(tokens[i], encoded_keys[i], *schema_ptr, scratch.row(0));
+        } else {
+          RETURN_NOT_OK(CopyRow(scratch.row(0), &dst_row, dst->arena()));
+        }
+        key_indexes->push_back(i);
+        found = true;
+      }
+      if (found) {
+        break;
+      }
+    }
+  }
+  dst->Resize(num_found);
+  dst->selection_vector()->SetAllTrue();
+  if (use_cache && metrics_) {
+    metrics_->row_cache_hits->IncrementBy(num_cache_hits);
+    metrics_->row_cache_misses->IncrementBy(encoded_keys.size() - num_cache_hits);
+  }
+  return Status::OK();
+}
+
 Status Tablet::DecodeWriteOperations(const Schema* client_schema,
                                      WriteOpState* op_state) {
   TRACE_EVENT0("tablet", "Tablet::DecodeWriteOperations");
@@ -544,11 +782,32 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
 
   SchemaPtr schema_ptr = schema();
   // Decode the ops
-  RowOperationsPBDecoder dec(&op_state->request()->row_operations(),
-                             client_schema,
-                             schema_ptr.get(),
-                             op_state->arena());
-  RETURN_NOT_OK(dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops));
+  const auto decode = [&]() {
+    RowOperationsPBDecoder dec(&op_state->request()->row_operations(),
+                               client_schema,
+                               schema_ptr.get(),
+                               op_state->arena());
+    return dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops);
+  };
+  RETURN_NOT_OK(decode());
+
+  const auto num_range_deletes = std::count_if(
+      ops.begin(), ops.end(), [](const DecodedRowOperation& op) {
+        return op.type == RowOperationsPB::DELETE_RANGE;
+      });
+  if (num_range_deletes > 0) {
+    if (PREDICT_FALSE(num_range_deletes != ops.size())) {
+      return Status::InvalidArgument("range deletes can't be batched with other operations");
+    }
+    // Range deletes keep any other write out until they're applied, like
+    // schema changes do. Trade the shared schema lock for exclusive locks,
+    // and decode again since the schema may have changed in between.
+    op_state->ReleaseSchemaLock();
+    RETURN_NOT_OK(op_state->AcquireRangeDeleteLocks(&schema_lock_, &range_delete_lock_));
+    schema_ptr = schema();
+    ops.clear();
+    RETURN_NOT_OK(decode());
+  }
   TRACE_COUNTER_INCREMENT("num_ops", ops.size());
 
   // Important to set the schema before the ops -- we need the
@@ -564,12 +823,30 @@ Status Tablet::AcquireRowLocks(WriteOpState* op_state) {
                "num_locks", op_state->row_ops().size());
   TRACE("Acquiring locks for $0 operations", op_state->row_ops().size());
 
+  // Range deletes are only ever batched together, and need no row locks.
+  if (op_state->is_range_delete()) {
+    return PrepareRangeDeletes(op_state);
+  }
+
+  // Encode the keys of all the ops at once, which is cheaper than building
+  // each op's key probe from scratch.
+  vector<RowOp*> ops;
+  vector<const uint8_t*> row_keys;
+  ops.reserve(op_state->row_ops().size());
+  row_keys.reserve(op_state->row_ops().size());
   for (RowOp* op : op_state->row_ops()) {
     if (op->has_result()) continue;
+    ops.push_back(op);
+    row_keys.push_back(op->decoded_op.row_data);
+  }
+  Arena* arena = op_state->arena();
+  vector<EncodedKey*> encoded_keys;
+  EncodedKey::FromContiguousRows(key_schema_, row_keys, arena, &encoded_keys);
 
+  for (size_t i = 0; i < ops.size(); i++) {
+    RowOp* op = ops[i];
     ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
-    Arena* arena = op_state->arena();
-    op->key_probe = arena->NewObject<RowSetKeyProbe>(row_key, arena);
+    op->key_probe = arena->NewObject<RowSetKeyProbe>(row_key, encoded_keys[i]);
     if (PREDICT_FALSE(!ValidateOpOrMarkFailed(op))) {
       continue;
     }
@@ -582,6 +859,75 @@ Status Tablet::AcquireRowLocks(WriteOpState* op_state) {
   return Status::OK();
 }
 
+Status Tablet::PrepareRangeDeletes(WriteOpState* op_state) {
+  TRACE_EVENT0("tablet", "Tablet::PrepareRangeDeletes");
+  // Keep other flushes from racing with those below.
+  std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  Arena* arena = op_state->arena();
+  vector<RowSet*> to_flush;
+  for (RowOp* op : op_state->row_ops()) {
+    if (op->has_result()) continue;
+    DCHECK_EQ(RowOperationsPB::DELETE_RANGE, op->decoded_op.type);
+    // There are no rows to look up: the range tombstones are recorded in
+    // whatever DRSs intersect the range.
+    op->valid = true;
+    op->checked_present = true;
+
+    EncodedKey* lower_bound;
+    EncodedKey* upper_bound;
+    vector<RowSet*> rowsets;
+    FindRangeDeleteRowSets(*op, *comps.get(), arena, &lower_bound, &upper_bound, &rowsets);
+    for (RowSet* rs : rowsets) {
+      if (!rs->DeltaMemStoreEmpty()) {
+        to_flush.push_back(rs);
+      }
+    }
+  }
+  std::sort(to_flush.begin(), to_flush.end());
+  to_flush.erase(std::unique(to_flush.begin(), to_flush.end()), to_flush.end());
+
+  // The tombstones apply to the rows regardless of the timestamps of their
+  // mutations, so all of the mutations so far must be durable in the stores
+  // the tombstones go to, rather than in memory or in the WAL.
+  IOContext io_context({ tablet_id() });
+  for (RowSet* rs : to_flush) {
+    RETURN_NOT_OK_PREPEND(rs->FlushDeltas(&io_context),
+                          "failed to flush deltas before a range delete");
+  }
+  bool mrs_empty = comps->memrowset->empty();
+  for (const auto& mrs : comps->txn_memrowsets) {
+    mrs_empty &= mrs->empty();
+  }
+  if (!mrs_empty) {
+    RETURN_NOT_OK_PREPEND(FlushUnlocked(), "failed to flush before a range delete");
+  }
+  TRACE("Prepared range deletes: flushed $0 DMSs$1",
+        to_flush.size(), mrs_empty ? "" : " and the MRS");
+  return Status::OK();
+}
+
+void Tablet::FindRangeDeleteRowSets(const RowOp& op,
+                                    const TabletComponents& comps,
+                                    Arena* arena,
+                                    EncodedKey** lower_bound,
+                                    EncodedKey** upper_bound,
+                                    vector<RowSet*>* rowsets) const {
+  const auto encode = [&](const uint8_t* key) -> EncodedKey* {
+    return key ? EncodedKey::FromContiguousRow(ConstContiguousRow(&key_schema_, key), arena)
+               : nullptr;
+  };
+  const auto slice = [](const EncodedKey* key) -> boost::optional<Slice> {
+    return key ? boost::make_optional(key->encoded_key()) : boost::none;
+  };
+  *lower_bound = encode(op.decoded_op.row_data);
+  *upper_bound = encode(op.decoded_op.range_upper_bound);
+  comps.rowsets->FindRowSetsIntersectingInterval(slice(*lower_bound), slice(*upper_bound),
+                                                 rowsets);
+}
+
 Status Tablet::AcquirePartitionLock(WriteOpState* op_state,
                                     LockManager::LockWaitMode wait_mode) {
   return op_state->AcquirePartitionLock(&lock_manager_, wait_mode);
@@ -678,6 +1024,9 @@ Status Tablet::ValidateOp(const RowOp& op) {
     case RowOperationsPB::DELETE_IGNORE:
       return ValidateMutateUnlocked(op);
 
+    case RowOperationsPB::DELETE_RANGE:
+      return Status::OK();
+
     default:
       LOG(FATAL) << RowOperationsPB::Type_Name(op.decoded_op.type);
   }
@@ -874,8 +1223,6 @@ vector<RowSet*> Tablet::FindRowSetsToCheck(const RowOp* op,
   vector<RowSet*> to_check;
   for (const auto& txn_mrs : comps->txn_memrowsets) {
     to_check.emplace_back(txn_mrs.get());
-    uint64_t rows;
-    txn_mrs->CountLiveRows(&rows);
   }
   if (PREDICT_TRUE(!op->orig_result_from_log)) {
     // TODO(yingchun): could iterate the rowsets in a smart order
@@ -966,6 +1313,32 @@ Status Tablet::MutateRowUnlocked(const IOContext* io_context,
   return s;
 }
 
+Status Tablet::DeleteRangeUnlocked(const IOContext* io_context,
+                                  WriteOpState* op_state,
+                                  RowOp* op) {
+  DCHECK(op->valid);
+  const TabletComponents* comps = DCHECK_NOTNULL(op_state->tablet_components());
+  // Nothing may have been written since the MRS was flushed in Prepare().
+  // NOTE: rows of transactions committed in between aren't deleted.
+  DCHECK(comps->memrowset->empty());
+
+  EncodedKey* lower_bound;
+  EncodedKey* upper_bound;
+  vector<RowSet*> rowsets;
+  FindRangeDeleteRowSets(*op, *comps, op_state->arena(), &lower_bound, &upper_bound, &rowsets);
+  for (RowSet* rs : rowsets) {
+    RETURN_NOT_OK(rs->DeleteRange(lower_bound, upper_bound, op_state->timestamp(), io_context));
+  }
+  // Unlike the deltas of DMSs, the tombstones aren't anchored in the WAL: they
+  // must be durable before the op is committed, which makes bootstrap skip it.
+  if (!rowsets.empty()) {
+    RETURN_NOT_OK(metadata_->Flush());
+  }
+  op->SetMutateSucceeded(
+      google::protobuf::Arena::CreateMessage<OperationResultPB>(op_state->pb_arena()));
+  return Status::OK();
+}
+
 void Tablet::StartApplying(WriteOpState* op_state) {
   shared_lock<rw_spinlock> l(component_lock_);
 
@@ -1029,7 +1402,7 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteOpState* op_s
     RowOp* op = row_ops_base[i];
     // If the op already failed in validation, or if we've got the original result
     // filled in already during replay, then we don't need to consult the RowSetTree.
-    if (op->has_result() || op->orig_result_from_log) continue;
+    if (op->has_result() || op->orig_result_from_log || !op->key_probe) continue;
     keys_and_indexes.emplace_back(op->key_probe->encoded_key_slice(), i);
   }
 
@@ -1100,6 +1473,11 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteOpState* op_s
   // 'pending_group' and then calls 'ProcessPendingGroup' when the next group
   // begins.
   vector<pair<RowSet*, int>> pending_group;
+  vector<const RowSetKeyProbe*> group_probes;
+  vector<ProbeStats*> group_stats;
+  vector<int> group_op_idxs;
+  // A group never has more keys than the whole batch.
+  unique_ptr<bool[]> group_present(new bool[keys.size()]);
   Status s;
   const auto& ProcessPendingGroup = [&]() {
     if (pending_group.empty() || !s.ok()) return;
@@ -1111,6 +1489,9 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteOpState* op_s
                             return keys[a.second] < keys[b.second];
                           }));
     RowSet* rs = pending_group[0].first;
+    group_probes.clear();
+    group_stats.clear();
+    group_op_idxs.clear();
     for (auto it = pending_group.begin(); it != pending_group.end(); ++it) {
       DCHECK_EQ(it->first, rs) << "All results within a group should be for the same RowSet";
       int op_idx = keys_and_indexes[it->second].second;
@@ -1119,17 +1500,24 @@ Status Tablet::BulkCheckPresence(const IOContext* io_context, WriteOpState* op_s
         // Already found this op present somewhere.
         continue;
       }
-
-      bool present = false;
-      s = rs->CheckRowPresent(*op->key_probe, io_context,
-                              &present, op_state->mutable_op_stats(op_idx));
+      group_probes.emplace_back(op->key_probe);
+      group_stats.emplace_back(op_state->mutable_op_stats(op_idx));
+      group_op_idxs.emplace_back(op_idx);
+    }
+    if (!group_probes.empty()) {
+      // Check all of the group's keys at once, so that the rowset can walk its
+      // bloom filter and key index in key order.
+      s = rs->CheckRowsPresent(group_probes, io_context, group_present.get(),
+                               group_stats.data());
       if (PREDICT_FALSE(!s.ok())) {
-        LOG(WARNING) << Substitute("Tablet $0 failed to check row presence for op $1: $2",
-            tablet_id(), op->ToString(key_schema_), s.ToString());
+        LOG(WARNING) << Substitute("Tablet $0 failed to check row presence in $1: $2",
+            tablet_id(), rs->ToString(), s.ToString());
         return;
       }
-      if (present) {
-        op->present_in_rowset = rs;
+      for (size_t i = 0; i < group_probes.size(); i++) {
+        if (group_present[i]) {
+          row_ops_base[group_op_idxs[i]]->present_in_rowset = rs;
+        }
       }
     }
     pending_group.clear();
@@ -1205,6 +1593,15 @@ void Tablet::CommitTxnRowSets(int64_t txn_id) {
   std::lock_guard<rw_spinlock> lock(component_lock_);
   auto txn_rowsets = EraseKeyReturnValuePtr(&uncommitted_rowsets_by_txn_id_, txn_id);
   CHECK(txn_rowsets);
+  const auto& txn_mrs = txn_rowsets->memrowset;
+  if (txn_mrs->empty()) {
+    // Participants often commit without having written anything to this
+    // tablet. Rather than keeping an empty MRS around until the next flush,
+    // where it would add to the rowsets every write and scan has to visit,
+    // drop it and record it as flushed so bootstrap doesn't recreate it.
+    txn_mrs->txn_metadata()->set_flushed_committed_mrs();
+    return;
+  }
   auto committed_mrss = components_->txn_memrowsets;
   committed_mrss.emplace_back(txn_rowsets->memrowset);
   components_ = new TabletComponents(components_->memrowset,
@@ -1230,6 +1627,22 @@ Status Tablet::ApplyRowOperations(WriteOpState* op_state) {
 
   StartApplying(op_state);
 
+  // The cached rows of the keys written are dropped before the writes are
+  // visible, and aren't cached again until they are. Range deletes may
+  // delete the rows of any key.
+  if (row_cache_) {
+    if (op_state->is_range_delete()) {
+      row_cache_->StartInvalidating();
+    } else {
+      for (const RowOp* row_op : op_state->row_ops()) {
+        if (row_op->key_probe) {
+          row_cache_->StartWriting(row_op->key_probe->encoded_key_slice());
+        }
+      }
+    }
+    op_state->set_writing_to_row_cache(row_cache_.get());
+  }
+
   IOContext io_context({ tablet_id() });
   RETURN_NOT_OK(BulkCheckPresence(&io_context, op_state));
 
@@ -1310,6 +1723,9 @@ Status Tablet::ApplyRowOperation(const IOContext* io_context,
       }
       return s;
 
+    case RowOperationsPB::DELETE_RANGE:
+      return DeleteRangeUnlocked(io_context, op_state, row_op);
+
     default:
       LOG_WITH_PREFIX(FATAL) << RowOperationsPB::Type_Name(row_op->decoded_op.type);
   }
@@ -1320,50 +1736,41 @@ void Tablet::ModifyRowSetTree(const RowSetTree& old_tree,
                               const RowSetVector& rowsets_to_remove,
                               const RowSetVector& rowsets_to_add,
                               RowSetTree* new_tree) {
-  RowSetVector post_swap;
-
-  // O(n^2) diff algorithm to collect the set of rowsets excluding
-  // the rowsets that were included in the compaction
-  int num_removed = 0;
-
-  for (const shared_ptr<RowSet> &rs : old_tree.all_rowsets()) {
-    // Determine if it should be removed
-    bool should_remove = false;
-    for (const shared_ptr<RowSet> &to_remove : rowsets_to_remove) {
-      if (to_remove == rs) {
-        should_remove = true;
-        num_removed++;
-        break;
-      }
-    }
-    if (!should_remove) {
-      post_swap.push_back(rs);
-    }
-  }
-
-  CHECK_EQ(num_removed, rowsets_to_remove.size());
-
-  // Then push the new rowsets on the end of the new list
-  std::copy(rowsets_to_add.begin(),
-            rowsets_to_add.end(),
-            std::back_inserter(post_swap));
-
+  CHECK_OK(new_tree->Reset(old_tree, rowsets_to_remove, rowsets_to_add));
+}
 
-  CHECK_OK(new_tree->Reset(post_swap));
+Tablet::PreparedRowSetSwap Tablet::PrepareRowSetSwap(const RowSetVector& to_remove,
+                                                     const RowSetVector& to_add) const {
+  PreparedRowSetSwap prepared;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    prepared.base = components_->rowsets;
+  }
+  prepared.tree = make_shared<RowSetTree>();
+  ModifyRowSetTree(*prepared.base, to_remove, to_add, prepared.tree.get());
+  return prepared;
 }
 
 void Tablet::AtomicSwapRowSets(const RowSetVector &to_remove,
                                const RowSetVector &to_add) {
+  auto prepared = PrepareRowSetSwap(to_remove, to_add);
   std::lock_guard<rw_spinlock> lock(component_lock_);
-  AtomicSwapRowSetsUnlocked(to_remove, to_add);
+  AtomicSwapRowSetsUnlocked(to_remove, to_add, std::move(prepared));
 }
 
 void Tablet::AtomicSwapRowSetsUnlocked(const RowSetVector &to_remove,
-                                       const RowSetVector &to_add) {
+                                       const RowSetVector &to_add,
+                                       PreparedRowSetSwap prepared) {
   DCHECK(component_lock_.is_locked());
 
-  auto new_tree(make_shared<RowSetTree>());
-  ModifyRowSetTree(*components_->rowsets, to_remove, to_add, new_tree.get());
+  shared_ptr<RowSetTree> new_tree;
+  if (prepared.tree && prepared.base == components_->rowsets) {
+    new_tree = std::move(prepared.tree);
+  } else {
+    // The rowsets changed since the tree was prepared, if it was.
+    new_tree = make_shared<RowSetTree>();
+    ModifyRowSetTree(*components_->rowsets, to_remove, to_add, new_tree.get());
+  }
 
   components_ = new TabletComponents(components_->memrowset,
                                      components_->txn_memrowsets,
@@ -1406,6 +1813,18 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
   return true;
 }
 
+bool Tablet::GetTtlCutoff(ColumnId* ttl_col_id, int64_t* cutoff_micros) const {
+  // The TTL column holds wall clock times, so the cutoff is based on the wall
+  // clock rather than on the tablet's clock.
+  const SchemaPtr schema = metadata_->schema();
+  int ttl_col_idx;
+  if (!metadata_->GetTtlCutoff(*schema, GetCurrentTimeMicros(), &ttl_col_idx, cutoff_micros)) {
+    return false;
+  }
+  *ttl_col_id = schema->column_id(ttl_col_idx);
+  return true;
+}
+
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
   if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
@@ -1511,6 +1930,138 @@ Status Tablet::FlushUnlocked() {
   return Status::OK();
 }
 
+bool Tablet::IsEmptyForBulkLoadUnlocked() const {
+  return components_->memrowset->empty() &&
+      components_->rowsets->all_rowsets().empty() &&
+      uncommitted_rowsets_by_txn_id_.empty();
+}
+
+Status Tablet::BulkLoad(RowwiseIterator* rows, int64_t* rows_loaded) {
+  TRACE_EVENT1("tablet", "Tablet::BulkLoad", "id", tablet_id());
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  // Serialize with flushes and compactions, which swap rowsets too.
+  std::lock_guard<Semaphore> lock(rowsets_flush_sem_);
+  const SchemaPtr schema_ptr = schema();
+  const Schema& schema = *schema_ptr;
+  if (rows->schema() != schema) {
+    return Status::InvalidArgument("the rows to load must have the tablet's schema",
+                                   rows->schema().ToString());
+  }
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    if (!IsEmptyForBulkLoadUnlocked()) {
+      return Status::IllegalState("only empty tablets may be bulk loaded");
+    }
+  }
+
+  const IOContext io_context({ tablet_id(), fs::IOPriority::FLUSH });
+  fs::ScopedIOPriority scoped_io_priority(fs::IOPriority::FLUSH);
+
+  // The rows are loaded as if by a single op, so that they are invisible to
+  // snapshots before its timestamp, and snapshots after it wait for the load.
+  ScopedOp op(&mvcc_, clock_->Now());
+  faststring delete_buf;
+  RowChangeListEncoder undo_encoder(&delete_buf);
+  undo_encoder.SetToDelete();
+
+  RollingDiskRowSetWriter drsw(metadata_.get(), schema, DefaultBloomSizing(),
+                               compaction_policy_->target_rowset_size());
+  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for bulk load");
+
+  RowBlockMemory mem(32 * 1024);
+  RowBlock block(&schema, kBulkLoadBlockNumRows, &mem);
+  RowBlock selected(&schema, kBulkLoadBlockNumRows, &mem);
+  Arena undo_arena(32 * 1024);
+  faststring key_buf;
+  faststring prev_key;
+  bool has_prev_key = false;
+  while (rows->HasNext()) {
+    mem.Reset();
+    undo_arena.Reset();
+    RETURN_NOT_OK(rows->NextBlock(&block));
+    RETURN_NOT_OK(drsw.RollIfNecessary());
+
+    // Only the selected rows are loaded. Their indirect data stays in 'mem'.
+    selected.Resize(selected.row_capacity());
+    size_t n = 0;
+    for (size_t i = 0; i < block.nrows(); i++) {
+      if (!block.selection_vector()->IsRowSelected(i)) {
+        continue;
+      }
+      RowBlockRow dst_row = selected.row(n);
+      RETURN_NOT_OK(CopyRow(block.row(i), &dst_row, static_cast<Arena*>(nullptr)));
+      const Slice key = schema.EncodeComparableKey(dst_row, &key_buf);
+      if (has_prev_key && key.compare(Slice(prev_key)) <= 0) {
+        return Status::InvalidArgument("the rows to load must be in strictly ascending "
+                                       "primary key order", schema.DebugRowKey(dst_row));
+      }
+      prev_key.assign_copy(key.data(), key.size());
+      has_prev_key = true;
+
+      Mutation* undo = Mutation::CreateInArena(&undo_arena, op.timestamp(),
+                                               undo_encoder.as_changelist());
+      rowid_t row_idx_in_drs;
+      RETURN_NOT_OK(drsw.AppendUndoDeltas(n, undo, &row_idx_in_drs));
+      n++;
+    }
+    if (n > 0) {
+      selected.Resize(n);
+      RETURN_NOT_OK(drsw.AppendBlock(selected, n));
+    }
+  }
+  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+
+  RowSetMetadataVector new_drs_metas;
+  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  // If the rows can't be loaded after all, the blocks written for them are
+  // orphaned, to be deleted by the next metadata flush.
+  const auto orphan_written_blocks = [&]() {
+    for (const auto& meta : new_drs_metas) {
+      metadata_->AddOrphanedBlocks(meta->GetAllBlocks());
+    }
+  };
+  vector<shared_ptr<RowSet>> new_disk_rowsets;
+  for (const auto& meta : new_drs_metas) {
+    shared_ptr<DiskRowSet> new_rowset;
+    Status s = DiskRowSet::Open(meta, log_anchor_registry_.get(), mem_trackers_,
+                                &io_context, &new_rowset);
+    if (!s.ok()) {
+      orphan_written_blocks();
+      return s.CloneAndPrepend("Unable to open bulk loaded rowset");
+    }
+    new_disk_rowsets.emplace_back(std::move(new_rowset));
+  }
+
+  {
+    // Taking component_lock_ in write mode ensures that no new ops can
+    // StartApplying() while the rowsets are swapped in. Since the tablet is
+    // still empty and no other op is applying, no op may insert a row whose
+    // key was loaded without finding it in the new rowsets.
+    std::lock_guard<rw_spinlock> l(component_lock_);
+    vector<Timestamp> applying;
+    mvcc_.GetApplyingOpsTimestamps(&applying);
+    if (!IsEmptyForBulkLoadUnlocked() || !applying.empty()) {
+      orphan_written_blocks();
+      return Status::IllegalState("the tablet was written to during the bulk load");
+    }
+    op.StartApplying();
+    AtomicSwapRowSetsUnlocked({}, new_disk_rowsets);
+  }
+  RETURN_NOT_OK_PREPEND(FlushMetadata({}, new_drs_metas, TabletMetadata::kNoMrsFlushed, {}),
+                        "Failed to flush new tablet metadata");
+  op.FinishApplying();
+  UpdateAverageRowsetHeight();
+
+  if (metrics_) {
+    metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  }
+  *rows_loaded = drsw.rows_written_count();
+  LOG_WITH_PREFIX(INFO) << Substitute("Bulk loaded $0 rows ($1 rowsets, $2)",
+                                      *rows_loaded, new_drs_metas.size(),
+                                      HumanReadableNumBytes::ToString(drsw.written_size()));
+  return Status::OK();
+}
+
 Status Tablet::ReplaceMemRowSetsUnlocked(RowSetsInCompaction* compaction,
                                          vector<shared_ptr<MemRowSet>>* old_mrss) {
   DCHECK(old_mrss->empty());
@@ -1594,6 +2145,11 @@ Status Tablet::AlterSchema(AlterSchemaOpState* op_state) {
   if (op_state->has_new_extra_config()) {
     metadata_->SetExtraConfig(op_state->new_extra_config());
   }
+  // New scans use the new schema.
+  AdvanceDataVersion();
+  if (row_cache_) {
+    row_cache_->InvalidateAll();
+  }
 
   // If the current schema and the new one are equal, there is nothing to do.
   if (same_schema) {
@@ -1658,6 +2214,54 @@ bool Tablet::ShouldThrottleAllow(int64_t bytes) {
   return throttler_->Take(MonoTime::Now(), 1, bytes);
 }
 
+Status Tablet::PickRowSetsByCluster(const RowSetTree& tree,
+                                    CompactionSelection* picked,
+                                    double* quality,
+                                    vector<string>* log) const {
+  int clustering_col_idx;
+  int num_clusters;
+  if (!metadata_->GetClustering(*schema(), &clustering_col_idx, &num_clusters)) {
+    return compaction_policy_->PickRowSets(tree, picked, quality, log);
+  }
+
+  // The rowsets which aren't clustered, e.g. those written by flushes or
+  // before the rows were clustered, are candidates in every cluster.
+  vector<RowSetVector> rowsets_by_cluster(num_clusters);
+  for (const shared_ptr<RowSet>& rs : tree.all_rowsets()) {
+    const shared_ptr<RowSetMetadata> meta = rs->metadata();
+    const int32_t cluster_id = meta ? meta->cluster_id() : RowSetMetadata::kNoClusterId;
+    if (cluster_id >= 0 && cluster_id < num_clusters) {
+      rowsets_by_cluster[cluster_id].push_back(rs);
+    } else {
+      for (auto& rowsets : rowsets_by_cluster) {
+        rowsets.push_back(rs);
+      }
+    }
+  }
+
+  *quality = 0;
+  picked->clear();
+  for (int i = 0; i < num_clusters; i++) {
+    if (rowsets_by_cluster[i].empty()) {
+      continue;
+    }
+    RowSetTree cluster_tree;
+    RETURN_NOT_OK(cluster_tree.Reset(rowsets_by_cluster[i]));
+    CompactionSelection cluster_picked;
+    double cluster_quality = 0;
+    if (log) {
+      log->emplace_back(Substitute("Cluster $0:", i));
+    }
+    RETURN_NOT_OK(compaction_policy_->PickRowSets(cluster_tree, &cluster_picked,
+                                                  &cluster_quality, log));
+    if (!cluster_picked.empty() && (picked->empty() || cluster_quality > *quality)) {
+      *picked = std::move(cluster_picked);
+      *quality = cluster_quality;
+    }
+  }
+  return Status::OK();
+}
+
 Status Tablet::PickRowSetsToCompact(RowSetsInCompaction *picked,
                                     CompactFlags flags) const {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
@@ -1685,11 +2289,29 @@ Status Tablet::PickRowSetsToCompact(RowSetsInCompaction *picked,
   } else {
     // Let the policy decide which rowsets to compact.
     double quality = 0.0;
-    RETURN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy,
-                                                  &picked_set,
-                                                  &quality,
-                                                  /*log=*/nullptr));
+    RETURN_NOT_OK(PickRowSetsByCluster(*rowsets_copy,
+                                       &picked_set,
+                                       &quality,
+                                       /*log=*/nullptr));
     VLOG_WITH_PREFIX(2) << "Compaction quality: " << quality;
+
+    // Rather than rewriting the rowsets whose rows have all expired, leave
+    // them to be dropped by the ExpiredRowsetGCOp.
+    ColumnId ttl_col_id;
+    int64_t cutoff_micros;
+    if (!picked_set.empty() && GetTtlCutoff(&ttl_col_id, &cutoff_micros)) {
+      IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
+      for (const shared_ptr<RowSet>& rs : rowsets_copy->all_rowsets()) {
+        if (!ContainsKey(picked_set, rs.get())) {
+          continue;
+        }
+        bool expired = false;
+        RETURN_NOT_OK(rs->IsExpired(ttl_col_id, cutoff_micros, &io_context, &expired));
+        if (expired) {
+          picked_set.erase(rs.get());
+        }
+      }
+    }
   }
 
   shared_lock<rw_spinlock> l(component_lock_);
@@ -1805,6 +2427,10 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
     maintenance_ops.push_back(deleted_rowset_gc_op.release());
   }
 
+  unique_ptr<MaintenanceOp> expired_rowset_gc_op(new ExpiredRowsetGCOp(this));
+  maint_mgr->RegisterOp(expired_rowset_gc_op.get());
+  maintenance_ops.push_back(expired_rowset_gc_op.release());
+
   std::lock_guard<simple_spinlock> l(state_lock_);
   maintenance_ops_.swap(maintenance_ops);
 }
@@ -1864,7 +2490,11 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                "op", op_name);
 
   const auto& tid = tablet_id();
-  const IOContext io_context({ tid });
+  const fs::IOPriority io_priority = mrs_being_flushed == TabletMetadata::kNoMrsFlushed ?
+      fs::IOPriority::COMPACTION : fs::IOPriority::FLUSH;
+  const IOContext io_context({ tid, io_priority });
+  // The blocks written by this thread are scheduled with the same priority.
+  fs::ScopedIOPriority scoped_io_priority(io_priority);
 
   MvccSnapshot flush_snap(mvcc_);
   VLOG_WITH_PREFIX(1) << Substitute("$0: entering phase 1 (flushing snapshot). "
@@ -1876,31 +2506,57 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                           "PostTakeMvccSnapshot hook failed");
   }
 
-  shared_ptr<CompactionInput> merge;
   const SchemaPtr schema_ptr = schema();
-  RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema_ptr.get(), &io_context, &merge));
 
-  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), DefaultBloomSizing(),
-                               compaction_policy_->target_rowset_size());
-  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
+  // Flushes write recent data, which belongs on the fast storage tier.
+  const fs::StorageTier tier = mrs_being_flushed == TabletMetadata::kNoMrsFlushed ?
+      CompactionStorageTier() : fs::StorageTier::FAST;
+  VLOG_WITH_PREFIX(1) << Substitute("$0: writing to the $1 storage tier",
+                                    op_name, fs::StorageTierToString(tier));
+
+  // Compactions of a table whose rows are clustered write the rows of each
+  // cluster into rowsets of their own. Flushes aren't clustered: their rowsets
+  // are split into clusters when they're compacted.
+  unique_ptr<RowSetClustering> clustering;
+  int clustering_col_idx;
+  int num_clusters;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed &&
+      metadata_->GetClustering(*schema_ptr, &clustering_col_idx, &num_clusters)) {
+    clustering.reset(new RowSetClustering(clustering_col_idx, num_clusters));
+    VLOG_WITH_PREFIX(1) << Substitute("$0: splitting into $1 clusters", op_name, num_clusters);
+  }
+
+  vector<KeyRange> key_ranges;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed && !clustering) {
+    ComputeCompactionKeyRanges(input.rowsets(), &key_ranges);
+  }
+  if (!key_ranges.empty()) {
+    VLOG_WITH_PREFIX(1) << Substitute("$0: splitting into $1 key ranges",
+                                      op_name, key_ranges.size());
+  }
 
   HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(
-      FlushCompactionInput(
-          tid, metadata_->fs_manager()->block_manager()->error_manager(),
-          merge.get(), flush_snap, history_gc_opts, &drsw),
-      "Flush to disk failed");
-  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+  vector<unique_ptr<RollingDiskRowSetWriter>> drsws;
+  RETURN_NOT_OK(WriteCompactionOutput(input, flush_snap, schema_ptr.get(), key_ranges,
+                                      clustering.get(), tier, history_gc_opts, &io_context,
+                                      &drsws));
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostWriteSnapshot(),
                           "PostWriteSnapshot hook failed");
   }
 
+  int64_t rows_written_count = 0;
+  uint64_t written_size = 0;
+  for (const auto& drsw : drsws) {
+    rows_written_count += drsw->rows_written_count();
+    written_size += drsw->written_size();
+  }
+
   // Though unlikely, it's possible that no rows were written because all of
   // the input rows were GCed in this compaction. In that case, we don't
   // actually want to reopen.
-  if (drsw.rows_written_count() == 0) {
+  if (rows_written_count == 0) {
     LOG_WITH_PREFIX(INFO) << op_name << " resulted in no output rows (all input rows "
                           << "were GCed!)  Removing all input rowsets.";
     return HandleEmptyCompactionOrFlush(input.rowsets(), mrs_being_flushed,
@@ -1909,11 +2565,19 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
 
   // The RollingDiskRowSet writer wrote out one or more RowSets as the
   // output. Open these into 'new_rowsets'.
+  // The writers are in key order, or in cluster order if the rows are
+  // clustered, and the rowsets each one wrote are in key order.
   vector<shared_ptr<RowSet> > new_disk_rowsets;
   RowSetMetadataVector new_drs_metas;
-  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  vector<size_t> num_drs_per_writer;
+  for (const auto& drsw : drsws) {
+    RowSetMetadataVector metas;
+    drsw->GetWrittenRowSetMetadata(&metas);
+    new_drs_metas.insert(new_drs_metas.end(), metas.begin(), metas.end());
+    num_drs_per_writer.push_back(metas.size());
+  }
 
-  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(written_size);
   CHECK(!new_drs_metas.empty());
   {
     TRACE_EVENT0("tablet", "Opening compaction results");
@@ -1974,10 +2638,11 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   vector<Timestamp> applying_during_swap;
   {
     TRACE_EVENT0("tablet", "Swapping DuplicatingRowSet");
+    auto prepared = PrepareRowSetSwap(input.rowsets(), { inprogress_rowset });
     // Taking component_lock_ in write mode ensures that no new ops can
     // StartApplying() (or snapshot components_) during this block.
     std::lock_guard<rw_spinlock> lock(component_lock_);
-    AtomicSwapRowSetsUnlocked(input.rowsets(), { inprogress_rowset });
+    AtomicSwapRowSetsUnlocked(input.rowsets(), { inprogress_rowset }, std::move(prepared));
 
     // NOTE: ops may *commit* in between these two lines.
     // We need to make sure all such ops end up in the 'applying_during_swap'
@@ -2021,6 +2686,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                     "which arrived during Phase 1. Snapshot: $1",
                                     op_name, non_duplicated_ops_snap.ToString());
   const SchemaPtr schema_ptr2 = schema();
+  shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK_PREPEND(
       input.CreateCompactionInput(non_duplicated_ops_snap, schema_ptr2.get(), &io_context, &merge),
           Substitute("Failed to create $0 inputs", op_name).c_str());
@@ -2029,12 +2695,33 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // in the DuplicatingRowSets. This will perform a flush of the updated DeltaTrackers
   // in the end so that the data that is reported in the log as belonging to the input
   // rowsets is flushed.
+  //
+  // If the rows are clustered, the rows must be assigned to the same clusters
+  // as in phase 1, even if the schema was altered in between.
+  unique_ptr<RowSetClustering> clustering2;
+  vector<RowSetVector> new_disk_rowsets_by_cluster;
+  if (clustering) {
+    const int col_idx2 = schema_ptr2->find_column_by_id(
+        schema_ptr->column_id(clustering_col_idx));
+    if (col_idx2 == Schema::kColumnNotFound) {
+      return Status::Aborted(Substitute("$0: clustering column was dropped", op_name));
+    }
+    clustering2.reset(new RowSetClustering(col_idx2, clustering->num_clusters()));
+    auto it = new_disk_rowsets.begin();
+    for (size_t num_drs : num_drs_per_writer) {
+      new_disk_rowsets_by_cluster.emplace_back(it, it + num_drs);
+      it += num_drs;
+    }
+  } else {
+    new_disk_rowsets_by_cluster.emplace_back(new_disk_rowsets);
+  }
   RETURN_NOT_OK_PREPEND(ReupdateMissedDeltas(&io_context,
                                              merge.get(),
                                              history_gc_opts,
                                              flush_snap,
                                              non_duplicated_ops_snap,
-                                             new_disk_rowsets),
+                                             clustering2.get(),
+                                             new_disk_rowsets_by_cluster),
         Substitute("Failed to re-update deltas missed during $0 phase 1",
                      op_name).c_str());
 
@@ -2070,9 +2757,9 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   AtomicSwapRowSets({ inprogress_rowset }, new_disk_rowsets);
   UpdateAverageRowsetHeight();
 
-  const auto rows_written = drsw.rows_written_count();
-  const auto drs_written = drsw.drs_written_count();
-  const auto bytes_written = drsw.written_size();
+  const auto rows_written = rows_written_count;
+  const auto drs_written = new_drs_metas.size();
+  const auto bytes_written = written_size;
   TRACE_COUNTER_INCREMENT("rows_written", rows_written);
   TRACE_COUNTER_INCREMENT("drs_written", drs_written);
   TRACE_COUNTER_INCREMENT("bytes_written", bytes_written);
@@ -2090,6 +2777,114 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   return Status::OK();
 }
 
+Status Tablet::WriteCompactionOutput(const RowSetsInCompaction& input,
+                                     const MvccSnapshot& snap,
+                                     const Schema* schema,
+                                     const vector<KeyRange>& key_ranges,
+                                     const RowSetClustering* clustering,
+                                     fs::StorageTier tier,
+                                     const HistoryGcOpts& history_gc_opts,
+                                     const IOContext* io_context,
+                                     vector<unique_ptr<RollingDiskRowSetWriter>>* writers) {
+  DCHECK(!clustering || key_ranges.empty());
+  writers->clear();
+  if (clustering) {
+    // A single pass over the input writes the rows of all of the clusters,
+    // each into its own writer.
+    shared_ptr<CompactionInput> compaction_input;
+    RETURN_NOT_OK(input.CreateCompactionInput(snap, schema, io_context, &compaction_input));
+    vector<RollingDiskRowSetWriter*> outs;
+    for (int i = 0; i < clustering->num_clusters(); i++) {
+      writers->emplace_back(new RollingDiskRowSetWriter(
+          metadata_.get(), compaction_input->schema(), DefaultBloomSizing(),
+          compaction_policy_->target_rowset_size(), tier));
+      RollingDiskRowSetWriter* drsw = writers->back().get();
+      drsw->set_cluster_id(i);
+      RETURN_NOT_OK_PREPEND(drsw->Open(), "Failed to open DiskRowSet for flush");
+      outs.push_back(drsw);
+    }
+    RETURN_NOT_OK_PREPEND(
+        FlushCompactionInput(
+            tablet_id(), metadata_->fs_manager()->block_manager()->error_manager(),
+            compaction_input.get(), snap, history_gc_opts, clustering, outs),
+        "Flush to disk failed");
+    for (RollingDiskRowSetWriter* drsw : outs) {
+      RETURN_NOT_OK_PREPEND(drsw->Finish(), "Failed to finish DRS writer");
+    }
+    return Status::OK();
+  }
+
+  const size_t num_ranges = std::max<size_t>(1, key_ranges.size());
+  writers->resize(num_ranges);
+
+  // Writes the rows of the 'idx'-th key range into the 'idx'-th writer. If
+  // there is a single range, it spans the whole input.
+  const auto write_range = [&](size_t idx) -> Status {
+    shared_ptr<CompactionInput> range_input;
+    RETURN_NOT_OK(input.CreateCompactionInput(snap, schema, io_context, &range_input));
+
+    Arena arena(256);
+    ScanSpec spec;
+    if (!key_ranges.empty()) {
+      const KeyRange& range = key_ranges[idx];
+      EncodedKey* lower_bound = nullptr;
+      EncodedKey* upper_bound = nullptr;
+      if (!range.start_primary_key().empty()) {
+        RETURN_NOT_OK(EncodedKey::DecodeEncodedString(
+            *schema, &arena, range.start_primary_key(), &lower_bound));
+        spec.SetLowerBoundKey(lower_bound);
+      }
+      if (!range.stop_primary_key().empty()) {
+        RETURN_NOT_OK(EncodedKey::DecodeEncodedString(
+            *schema, &arena, range.stop_primary_key(), &upper_bound));
+        spec.SetExclusiveUpperBoundKey(upper_bound);
+      }
+      RETURN_NOT_OK(range_input->RestrictToKeyRange(&spec));
+    }
+
+    (*writers)[idx].reset(new RollingDiskRowSetWriter(
+        metadata_.get(), range_input->schema(), DefaultBloomSizing(),
+        compaction_policy_->target_rowset_size(), tier));
+    RollingDiskRowSetWriter* drsw = (*writers)[idx].get();
+    RETURN_NOT_OK_PREPEND(drsw->Open(), "Failed to open DiskRowSet for flush");
+    RETURN_NOT_OK_PREPEND(
+        FlushCompactionInput(
+            tablet_id(), metadata_->fs_manager()->block_manager()->error_manager(),
+            range_input.get(), snap, history_gc_opts, drsw),
+        "Flush to disk failed");
+    RETURN_NOT_OK_PREPEND(drsw->Finish(), "Failed to finish DRS writer");
+    return Status::OK();
+  };
+
+  if (num_ranges == 1) {
+    return write_range(0);
+  }
+
+  // Each range is written by its own thread, with the IO priority of the
+  // compaction.
+  unique_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("compact-range")
+                .set_max_threads(num_ranges)
+                .Build(&pool));
+  vector<Status> statuses(num_ranges);
+  const fs::IOPriority io_priority = io_context->priority;
+  for (size_t i = 0; i < num_ranges; i++) {
+    Status s = pool->Submit([&, i]() {
+      fs::ScopedIOPriority scoped_io_priority(io_priority);
+      statuses[i] = write_range(i);
+    });
+    if (!s.ok()) {
+      pool->Wait();
+      return s;
+    }
+  }
+  pool->Wait();
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
 Status Tablet::HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
                                             int mrs_being_flushed,
                                             const vector<TxnInfoBeingFlushed>& txns_being_flushed) {
@@ -2126,6 +2921,8 @@ void Tablet::UpdateAverageRowsetHeight() {
 
 Status Tablet::Compact(CompactFlags flags) {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  // Range deletes can't be recorded in the rowsets being compacted.
+  shared_lock<rw_semaphore> range_delete_lock(range_delete_lock_);
 
   RowSetsInCompaction input;
   // Step 1. Capture the rowsets to be merged
@@ -2159,7 +2956,7 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
   }
 
   double quality = 0;
-  unordered_set<const RowSet*> picked_set_ignored;
+  unordered_set<const RowSet*> picked_set;
 
   shared_ptr<RowSetTree> rowsets_copy;
   {
@@ -2169,14 +2966,21 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
 
   {
     std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
-    WARN_NOT_OK(compaction_policy_->PickRowSets(*rowsets_copy, &picked_set_ignored, &quality, NULL),
+    WARN_NOT_OK(PickRowSetsByCluster(*rowsets_copy, &picked_set, &quality, NULL),
                 Substitute("Couldn't determine compaction quality for $0", tablet_id()));
   }
 
+  // The compaction reads and rewrites all of its inputs.
+  int64_t io_cost_bytes = 0;
+  for (const RowSet* rs : picked_set) {
+    io_cost_bytes += rs->OnDiskSize();
+  }
+
   VLOG_WITH_PREFIX(1) << "Best compaction for " << tablet_id() << ": " << quality;
 
   stats->set_runnable(quality >= 0);
   stats->set_perf_improvement(quality);
+  stats->set_io_cost_bytes(io_cost_bytes);
 }
 
 
@@ -2228,6 +3032,21 @@ Status Tablet::CaptureConsistentIterators(
     ret.emplace_back(std::move(txn_mrs_iwb));
   }
 
+  // A diff scan only returns rows changed between its snapshots, so it can
+  // skip the rowsets which have none.
+  const bool skip_unchanged = opts.snap_to_exclude &&
+      FLAGS_tablet_diff_scan_skip_unchanged_rowsets;
+  const auto is_skipped = [&](const RowSet& rs) {
+    if (skip_unchanged &&
+        !rs.MayHaveChangesBetween(*opts.snap_to_exclude, opts.snap_to_include)) {
+      if (metrics_) {
+        metrics_->diff_scan_rowsets_skipped->Increment();
+      }
+      return true;
+    }
+    return false;
+  };
+
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && (spec->lower_bound_key() || spec->exclusive_upper_bound_key())) {
     boost::optional<Slice> lower_bound = spec->lower_bound_key() ? \
@@ -2237,6 +3056,9 @@ Status Tablet::CaptureConsistentIterators(
     vector<RowSet*> interval_sets;
     components_->rowsets->FindRowSetsIntersectingInterval(lower_bound, upper_bound, &interval_sets);
     for (const auto* rs : interval_sets) {
+      if (is_skipped(*rs)) {
+        continue;
+      }
       IterWithBounds iwb;
       RETURN_NOT_OK_PREPEND(rs->NewRowIteratorWithBounds(opts, &iwb),
                             Substitute("Could not create iterator for rowset $0",
@@ -2250,6 +3072,9 @@ Status Tablet::CaptureConsistentIterators(
   // If there are no encoded predicates of the primary keys, then
   // fall back to grabbing all rowset iterators.
   for (const shared_ptr<RowSet>& rs : components_->rowsets->all_rowsets()) {
+    if (is_skipped(*rs)) {
+      continue;
+    }
     IterWithBounds iwb;
     RETURN_NOT_OK_PREPEND(rs->NewRowIteratorWithBounds(opts, &iwb),
                           Substitute("Could not create iterator for rowset $0",
@@ -2279,6 +3104,42 @@ Status Tablet::CountRows(uint64_t *count) const {
   return Status::OK();
 }
 
+Status Tablet::GetColumnStatistics(vector<ColumnStatisticsPB>* stats) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponentsOrNull(&comps);
+  if (!comps) {
+    return Status::RuntimeError("The tablet has been shut down");
+  }
+
+  // The statistics of the columns which were dropped are left out.
+  const SchemaPtr schema_ptr = schema();
+  std::unordered_map<int32_t, ColumnStatisticsPB> stats_by_col_id;
+  for (int i = 0; i < schema_ptr->num_columns(); i++) {
+    stats_by_col_id[schema_ptr->column_id(i)].set_column_id(schema_ptr->column_id(i));
+  }
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    const shared_ptr<RowSetMetadata> rowset_metadata = rowset->metadata();
+    if (!rowset_metadata) {
+      continue;
+    }
+    for (const ColumnStatisticsPB& rowset_stats : rowset_metadata->column_stats()) {
+      ColumnStatisticsPB* col_stats = FindOrNull(stats_by_col_id, rowset_stats.column_id());
+      if (col_stats) {
+        MergeColumnStatistics(rowset_stats, col_stats);
+      }
+    }
+  }
+
+  stats->clear();
+  for (int i = 0; i < schema_ptr->num_columns(); i++) {
+    ColumnStatisticsPB& col_stats = FindOrDie(stats_by_col_id, schema_ptr->column_id(i));
+    if (col_stats.has_null_count()) {
+      stats->emplace_back(std::move(col_stats));
+    }
+  }
+  return Status::OK();
+}
+
 Status Tablet::CountLiveRows(uint64_t* count) const {
   if (!metadata_->supports_live_row_count()) {
     return Status::NotSupported("This tablet doesn't support live row counting");
@@ -2305,6 +3166,126 @@ Status Tablet::CountLiveRows(uint64_t* count) const {
   return Status::OK();
 }
 
+Status Tablet::CountLiveRowsForScan(uint64_t* count) const {
+  if (!metadata_->supports_live_row_count()) {
+    return Status::NotSupported("This tablet doesn't support live row counting");
+  }
+  scoped_refptr<TabletComponents> comps;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    if (!components_) {
+      return Status::RuntimeError("The tablet has been shut down");
+    }
+    if (!uncommitted_rowsets_by_txn_id_.empty() || !components_->txn_memrowsets.empty()) {
+      return Status::IllegalState("the tablet has unflushed transactional rows");
+    }
+    comps = components_;
+  }
+  uint64_t ret = 0;
+  uint64_t tmp = 0;
+  RETURN_NOT_OK(comps->memrowset->CountLiveRows(&ret));
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    if (rowset->HasRangeTombstones()) {
+      return Status::IllegalState("the tablet has range deleted rows to compact",
+                                  rowset->ToString());
+    }
+    RETURN_NOT_OK(rowset->CountLiveRows(&tmp));
+    ret += tmp;
+  }
+  *count = ret;
+  return Status::OK();
+}
+
+Status Tablet::ExportBaseData(const Schema& projection,
+                              const MvccSnapshot& snap,
+                              const vector<int64_t>& rowset_ids,
+                              rowid_t start_row,
+                              int64_t max_bytes,
+                              int max_rowsets,
+                              vector<ExportedRowSet>* rowsets,
+                              vector<int64_t>* remaining_rowset_ids,
+                              rowid_t* next_row) const {
+  DCHECK_GT(max_rowsets, 0);
+  scoped_refptr<TabletComponents> comps;
+  GetComponentsOrNull(&comps);
+  if (!comps) {
+    return Status::RuntimeError("The tablet has been shut down");
+  }
+  // Unflushed rows have no base data. Which of them are visible at the
+  // snapshot isn't checked: any of them makes the tablet ineligible.
+  if (!comps->memrowset->empty()) {
+    return Status::IllegalState("tablet has unflushed rows");
+  }
+  for (const auto& mrs : comps->txn_memrowsets) {
+    if (!mrs->empty()) {
+      return Status::IllegalState("tablet has unflushed transactional rows");
+    }
+  }
+
+  vector<ColumnId> col_ids;
+  col_ids.reserve(projection.num_columns());
+  for (int i = 0; i < projection.num_columns(); i++) {
+    const int idx = schema()->find_column(projection.column(i).name());
+    if (idx == Schema::kColumnNotFound) {
+      return Status::NotFound("column not found", projection.column(i).name());
+    }
+    col_ids.push_back(schema()->column_id(idx));
+  }
+
+  std::map<int64_t, DiskRowSet*> drss_by_id;
+  for (const auto& rs : comps->rowsets->all_rowsets()) {
+    const auto rs_metadata = rs->metadata();
+    if (!rs_metadata) {
+      return Status::IllegalState("tablet is being flushed or compacted");
+    }
+    drss_by_id.emplace(rs_metadata->id(), down_cast<DiskRowSet*>(rs.get()));
+  }
+  vector<DiskRowSet*> drss;
+  if (rowset_ids.empty()) {
+    for (const auto& e : drss_by_id) {
+      drss.push_back(e.second);
+    }
+  } else {
+    for (int64_t id : rowset_ids) {
+      DiskRowSet* drs = FindPtrOrNull(drss_by_id, id);
+      if (!drs) {
+        return Status::IllegalState(Substitute("rowset $0 no longer exists", id));
+      }
+      drss.push_back(drs);
+    }
+  }
+
+  IOContext io_context({ tablet_id() });
+  rowsets->clear();
+  remaining_rowset_ids->clear();
+  *next_row = 0;
+  int64_t num_bytes = 0;
+  for (DiskRowSet* drs : drss) {
+    if (!remaining_rowset_ids->empty() ||
+        (!rowsets->empty() && (num_bytes >= max_bytes || rowsets->size() >= static_cast<size_t>(max_rowsets)))) {
+      remaining_rowset_ids->push_back(drs->metadata()->id());
+      continue;
+    }
+    ExportedRowSet exported;
+    exported.id = drs->metadata()->id();
+    exported.first_row = rowsets->empty() ? start_row : 0;
+    RETURN_NOT_OK(drs->CountRows(&io_context, &exported.num_rows));
+    RETURN_NOT_OK(drs->ExportBaseData(snap, col_ids, exported.first_row,
+                                      std::max<int64_t>(max_bytes - num_bytes, 0),
+                                      &io_context, &exported.columns, &exported.end_row));
+    for (const auto& column : exported.columns) {
+      num_bytes += column.data.size() + column.dictionary.size();
+    }
+    // The rest of the rowset is left to the next call.
+    if (exported.end_row < exported.num_rows) {
+      *next_row = exported.end_row;
+      remaining_rowset_ids->push_back(exported.id);
+    }
+    rowsets->emplace_back(std::move(exported));
+  }
+  return Status::OK();
+}
+
 size_t Tablet::MemRowSetSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponentsOrNull(&comps);
@@ -2393,6 +3374,15 @@ uint64_t Tablet::LastWriteElapsedSeconds() const {
   return static_cast<uint64_t>((MonoTime::Now() - last_write_time_).ToSeconds());
 }
 
+fs::StorageTier Tablet::CompactionStorageTier() const {
+  const int32_t threshold_secs = FLAGS_tablet_cold_data_threshold_secs;
+  if (threshold_secs > 0 &&
+      std::min(LastWriteElapsedSeconds(), LastReadElapsedSeconds()) >= threshold_secs) {
+    return fs::StorageTier::CAPACITY;
+  }
+  return fs::StorageTier::FAST;
+}
+
 double Tablet::CollectAndUpdateWorkloadStats(MaintenanceOp::PerfImprovementOpType type) {
   DCHECK(last_update_workload_stats_time_.Initialized());
   double workload_score = 0;
@@ -2464,7 +3454,8 @@ Status Tablet::FlushBestDMS(const ReplaySizeMap &replay_size_map) const {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   shared_ptr<RowSet> rowset = FindBestDMSToFlush(replay_size_map);
   if (rowset) {
-    IOContext io_context({ tablet_id() });
+    IOContext io_context({ tablet_id(), fs::IOPriority::FLUSH });
+    fs::ScopedIOPriority scoped_io_priority(fs::IOPriority::FLUSH);
     return rowset->FlushDeltas(&io_context);
   }
   return Status::OK();
@@ -2562,6 +3553,17 @@ Status Tablet::FlushAllDMSForTests() {
   return Status::OK();
 }
 
+Status Tablet::FlushAllDMS() {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  IOContext io_context({ tablet_id() });
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    RETURN_NOT_OK(rowset->FlushDeltas(&io_context));
+  }
+  return Status::OK();
+}
+
 Status Tablet::MajorCompactAllDeltaStoresForTests() {
   LOG_WITH_PREFIX(INFO) << "Major compacting all delta stores, for tests";
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
@@ -2601,7 +3603,8 @@ Status Tablet::CompactWorstDeltas(RowSet::DeltaCompactionType type) {
   // We just released compact_select_lock_ so other compactions can select and run, but the
   // rowset is ours.
   DCHECK(perf_improv != 0);
-  IOContext io_context({ tablet_id() });
+  IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
+  fs::ScopedIOPriority scoped_io_priority(fs::IOPriority::COMPACTION);
   if (type == RowSet::MINOR_DELTA_COMPACTION) {
     RETURN_NOT_OK_PREPEND(rs->MinorCompactDeltaStores(&io_context),
                           "Failed minor delta compaction on " + rs->ToString());
@@ -2672,7 +3675,7 @@ Status Tablet::EstimateBytesInPotentiallyAncientUndoDeltas(int64_t* bytes) {
 Status Tablet::InitAncientUndoDeltas(MonoDelta time_budget, int64_t* bytes_in_ancient_undos) {
   MonoTime tablet_init_start = MonoTime::Now();
 
-  IOContext io_context({ tablet_id() });
+  IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
   Timestamp ancient_history_mark;
   if (!Tablet::GetTabletAncientHistoryMark(&ancient_history_mark)) {
     VLOG_WITH_PREFIX(1) << "Cannot get ancient history mark. "
@@ -2812,6 +3815,102 @@ Status Tablet::DeleteAncientDeletedRowsets() {
   return Status::OK();
 }
 
+Status Tablet::GetBytesInExpiredRowsets(int64_t* bytes_in_expired_rowsets) {
+  ColumnId ttl_col_id;
+  int64_t cutoff_micros;
+  if (!GetTtlCutoff(&ttl_col_id, &cutoff_micros)) {
+    *bytes_in_expired_rowsets = 0;
+    return Status::OK();
+  }
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
+  int64_t bytes = 0;
+  {
+    std::lock_guard<std::mutex> csl(compact_select_lock_);
+    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      bool expired = false;
+      RETURN_NOT_OK(rowset->IsExpired(ttl_col_id, cutoff_micros, &io_context, &expired));
+      if (expired) {
+        bytes += rowset->OnDiskSize();
+      }
+    }
+  }
+  metrics_->expired_rowset_estimated_retained_bytes->set_value(bytes);
+  *bytes_in_expired_rowsets = bytes;
+  return Status::OK();
+}
+
+Status Tablet::DeleteExpiredRowsets() {
+  RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
+  const MonoTime start_time = MonoTime::Now();
+  ColumnId ttl_col_id;
+  int64_t cutoff_micros;
+  if (!GetTtlCutoff(&ttl_col_id, &cutoff_micros)) {
+    return Status::OK();
+  }
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
+
+  // As in DeleteAncientDeletedRowsets(), take the rowsets' locks so that they
+  // aren't dropped while they're being compacted.
+  RowSetVector candidates;
+  vector<std::unique_lock<std::mutex>> rowset_locks;
+  {
+    std::lock_guard<std::mutex> csl(compact_select_lock_);
+    for (const auto& rowset : comps->rowsets->all_rowsets()) {
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      bool expired = false;
+      RETURN_NOT_OK(rowset->IsExpired(ttl_col_id, cutoff_micros, &io_context, &expired));
+      if (expired) {
+        std::unique_lock<std::mutex> l(*rowset->compact_flush_lock(), std::try_to_lock);
+        CHECK(l.owns_lock());
+        candidates.emplace_back(rowset);
+        rowset_locks.emplace_back(std::move(l));
+      }
+    }
+  }
+  if (candidates.empty()) {
+    return Status::OK();
+  }
+
+  // Writes which captured the components before the rowsets were checked may
+  // still update their rows, e.g. refreshing their TTL, and such updates would
+  // be lost with the rowsets. Keep any write out while checking the rowsets
+  // again and dropping them, like schema changes do: every write holds the
+  // schema lock in shared mode from its prepare to its apply.
+  std::unique_lock<rw_semaphore> schema_lock(schema_lock_);
+  RowSetVector to_delete;
+  int64_t bytes_deleted = 0;
+  for (const auto& rowset : candidates) {
+    bool expired = false;
+    RETURN_NOT_OK(rowset->IsExpired(ttl_col_id, cutoff_micros, &io_context, &expired));
+    if (expired) {
+      to_delete.emplace_back(rowset);
+      bytes_deleted += rowset->OnDiskSize();
+    }
+  }
+  if (to_delete.empty()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK(HandleEmptyCompactionOrFlush(
+      to_delete, TabletMetadata::kNoMrsFlushed, {}));
+  schema_lock.unlock();
+  LOG_WITH_PREFIX(INFO) << Substitute("Dropped $0 expired rowsets ($1)", to_delete.size(),
+                                      HumanReadableNumBytes::ToString(bytes_deleted));
+  metrics_->expired_rowset_gc_bytes_deleted->IncrementBy(bytes_deleted);
+  metrics_->expired_rowset_gc_duration->Increment((MonoTime::Now() - start_time).ToMilliseconds());
+  return Status::OK();
+}
+
 Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_deleted) {
   RETURN_IF_STOPPED_OR_CHECK_STATE(kOpen);
   MonoTime tablet_delete_start = MonoTime::Now();
@@ -2842,7 +3941,8 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
 
   int64_t tablet_blocks_deleted = 0;
   int64_t tablet_bytes_deleted = 0;
-  fs::IOContext io_context({ tablet_id() });
+  fs::IOContext io_context({ tablet_id(), fs::IOPriority::COMPACTION });
+  fs::ScopedIOPriority scoped_io_priority(fs::IOPriority::COMPACTION);
   for (const auto& rowset : rowsets_to_gc_undos) {
     int64_t rowset_blocks_deleted;
     int64_t rowset_bytes_deleted;
@@ -2898,6 +3998,11 @@ size_t Tablet::num_rowsets() const {
   return components_ ? components_->rowsets->all_rowsets().size() : 0;
 }
 
+size_t Tablet::num_committed_txn_memrowsets() const {
+  shared_lock<rw_spinlock> l(component_lock_);
+  return components_ ? components_->txn_memrowsets.size() : 0;
+}
+
 void Tablet::PrintRSLayout(ostream* o) {
   DCHECK(o);
   auto& out = *o;
@@ -2913,7 +4018,7 @@ void Tablet::PrintRSLayout(ostream* o) {
   vector<string> log;
   unordered_set<const RowSet*> picked;
   double quality;
-  Status s = compaction_policy_->PickRowSets(*rowsets_copy, &picked, &quality, &log);
+  Status s = PickRowSetsByCluster(*rowsets_copy, &picked, &quality, &log);
   if (!s.ok()) {
     out << "<b>Error:</b> " << EscapeForHtmlToString(s.ToString());
     return;
@@ -3048,7 +4153,12 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
       break;
     case UNORDERED:
     default:
-      iter_ = NewUnionIterator(std::move(iters));
+      if (opts_.parallel_scan_pool && opts_.parallel_scan_threads > 1 && iters.size() > 1) {
+        iter_ = NewParallelUnionIterator(std::move(iters), opts_.parallel_scan_pool,
+                                         opts_.parallel_scan_threads);
+      } else {
+        iter_ = NewUnionIterator(std::move(iters));
+      }
       break;
   }
 
@@ -33,8 +33,11 @@
 #include <glog/logging.h>
 #include <gtest/gtest_prod.h>
 
+#include "kudu/cfile/block_export.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/rowid.h"
 #include "kudu/common/schema.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/io_context.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/macros.h"
@@ -59,12 +62,15 @@
 namespace kudu {
 
 class AlterTableTest;
+class Arena;
+class ColumnStatisticsPB;
 class ConstContiguousRow;
 class EncodedKey;
 class KeyRange;
 class MemTracker;
 class RowBlock;
 class ScanSpec;
+class Slice;
 class Throttler;
 class Timestamp;
 struct IterWithBounds;
@@ -89,6 +95,9 @@ class CompactionPolicy;
 class HistoryGcOpts;
 class MemRowSet;
 class ParticipantOpState;
+class RollingDiskRowSetWriter;
+class RowCache;
+class RowSetClustering;
 class RowSetTree;
 class RowSetsInCompaction;
 class TxnMetadata;
@@ -98,6 +107,18 @@ struct TabletComponents;
 struct TabletMetrics;
 struct TxnRowSets;
 
+// The base data of a disk rowset, as stored. See Tablet::ExportBaseData().
+struct ExportedRowSet {
+  int64_t id;
+  rowid_t num_rows;
+  // The rows [first_row, end_row) of the rowset are exported. The blocks of
+  // the columns may have the values of rows out of the range too.
+  rowid_t first_row;
+  rowid_t end_row;
+  // The columns of the projection, in the same order.
+  std::vector<cfile::ExportedCFile> columns;
+};
+
 class Tablet {
  public:
   typedef std::map<int64_t, int64_t> ReplaySizeMap;
@@ -250,6 +271,27 @@ class Tablet {
   Status NewRowIterator(RowIteratorOptions opts,
                         std::unique_ptr<RowwiseIterator>* iter) const;
 
+  // Looks up the rows with the primary keys 'encoded_keys', as encoded by
+  // EncodedKey, as of the current MVCC state of this tablet. The rows are
+  // projected onto 'projection', which is mapped onto the tablet's schema
+  // as for NewRowIterator().
+  //
+  // Unlike a scan of the keys, this doesn't merge the iterators of all of the
+  // rowsets which may contain them: each key's presence is checked in the
+  // rowsets whose key bounds include it, using their bloom filters and key
+  // indexes, and only the rowsets it's present in are read.
+  //
+  // With --tablet_row_cache_capacity_mb, the rows are looked up in the
+  // tablet's row cache first, and the rows read are cached.
+  //
+  // The rows found are copied into 'dst', which must have room for a row per
+  // key and is resized to the number of rows found. 'key_indexes' is set to
+  // the index of the key of each row of 'dst'.
+  Status LookupRows(const Schema& projection,
+                    const std::vector<Slice>& encoded_keys,
+                    RowBlock* dst,
+                    std::vector<int>* key_indexes) const;
+
   // Flush the current MemRowSet for this tablet to disk. This swaps
   // in a new (initially empty) MemRowSet in its place.
   //
@@ -257,6 +299,18 @@ class Tablet {
   // To do that, call FlushBiggestDMS() for example.
   Status Flush();
 
+  // Loads the rows of 'rows' straight into new DiskRowSets, bypassing the
+  // MemRowSet, and sets 'rows_loaded' to the number of rows loaded. The rows
+  // become visible atomically, as if inserted by a single op.
+  //
+  // 'rows' must be initialized, have the tablet's schema, and yield its rows
+  // in strictly ascending primary key order. The tablet must be empty, and
+  // may not be written to during the load.
+  //
+  // NOTE: the load is local to this replica: it isn't written to the WAL,
+  // so replicas are only consistent if the same rows are loaded into each.
+  Status BulkLoad(RowwiseIterator* rows, int64_t* rows_loaded);
+
   // Prepares the op context for the alter schema operation.
   // An error will be returned if the specified schema is invalid (e.g.
   // key mismatch, or missing IDs)
@@ -334,6 +388,9 @@ class Tablet {
   // Flush all delta memstores. Only used for tests.
   Status FlushAllDMSForTests();
 
+  // Flush all delta memstores.
+  Status FlushAllDMS();
+
   // Run a major compaction on all delta stores. Initializes any un-initialized
   // redo delta stores. Only used for tests.
   Status MajorCompactAllDeltaStoresForTests();
@@ -391,6 +448,17 @@ class Tablet {
   // state is change.
   Status DeleteAncientDeletedRowsets();
 
+  // Returns the number of bytes used by rowsets whose rows have all outlived
+  // the table's TTL. 0 if the table has no TTL.
+  Status GetBytesInExpiredRowsets(int64_t* bytes_in_expired_rowsets);
+
+  // Drops the rowsets whose rows have all outlived the table's TTL (see
+  // RowSet::IsExpired()), without rewriting any data.
+  //
+  // Returns an error if the metadata update fails. Upon failure, no in-memory
+  // state is change.
+  Status DeleteExpiredRowsets();
+
   // Counts the number of deltas in the tablet. Only used for tests.
   int64_t CountUndoDeltasForTests() const;
   int64_t CountRedoDeltasForTests() const;
@@ -398,6 +466,10 @@ class Tablet {
   // Return the current number of rowsets in the tablet.
   size_t num_rowsets() const;
 
+  // Return the current number of MemRowSets of committed transactions which
+  // are waiting to be flushed.
+  size_t num_committed_txn_memrowsets() const;
+
   // Attempt to count the total number of rows in the tablet.
   // This is not super-efficient since it must iterate over the
   // memrowset in the current implementation.
@@ -406,6 +478,44 @@ class Tablet {
   // Count the number of live rows in this tablet.
   Status CountLiveRows(uint64_t* count) const;
 
+  // Counts the live rows of the tablet like CountLiveRows(), as the row count
+  // of a READ_LATEST scan. Returns IllegalState if the count may differ from
+  // what the scan would see: while transactions have written to the tablet
+  // and their rows aren't flushed yet, including committed ones whose commit
+  // may not be visible yet, or while range deleted rows remain to be
+  // compacted.
+  Status CountLiveRowsForScan(uint64_t* count) const;
+
+  // Sets 'stats' to the statistics of the columns of the tablet's schema,
+  // merged over the DiskRowSets which have them. The rows of the MemRowSets,
+  // and those of rowsets being compacted, aren't accounted for.
+  Status GetColumnStatistics(std::vector<ColumnStatisticsPB>* stats) const;
+
+  // Exports the base data of the columns of 'projection' as it's stored, for
+  // the disk rowsets with the ids 'rowset_ids' or, if it's empty, for all of
+  // them, in order of id, from row 'start_row' of the first one on.
+  //
+  // Rowsets are exported by row ranges, so that the blocks of data exported
+  // fit in 'max_bytes', though the first range has at least one block of each
+  // column. Once 'max_bytes' of data or 'max_rowsets' rowsets were exported,
+  // the ids of the rowsets left are set in 'remaining_rowset_ids', and the
+  // row of the first of them to resume from in '*next_row', to be exported by
+  // the next call.
+  //
+  // The base data is only exported if it's the state of the tablet at 'snap':
+  // returns IllegalState if the MemRowSets aren't empty, if a scan at 'snap'
+  // may have to apply deltas to a rowset, or if one of 'rowset_ids' no longer
+  // exists, e.g. because it was compacted. The tablet must then be scanned.
+  Status ExportBaseData(const Schema& projection,
+                        const MvccSnapshot& snap,
+                        const std::vector<int64_t>& rowset_ids,
+                        rowid_t start_row,
+                        int64_t max_bytes,
+                        int max_rowsets,
+                        std::vector<ExportedRowSet>* rowsets,
+                        std::vector<int64_t>* remaining_rowset_ids,
+                        rowid_t* next_row) const;
+
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
   // has a very small number of rows.
@@ -455,6 +565,11 @@ class Tablet {
   // Otherwise, returns false.
   bool GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const WARN_UNUSED_RESULT;
 
+  // Returns true iff the table has a TTL, setting '*ttl_col_id' to its TTL
+  // column and '*cutoff_micros' to the time before which the values of the
+  // TTL column are expired as of now.
+  bool GetTtlCutoff(ColumnId* ttl_col_id, int64_t* cutoff_micros) const WARN_UNUSED_RESULT;
+
   // Calculates history GC options based on properties of the Clock implementation.
   HistoryGcOpts GetHistoryGcOpts() const;
 
@@ -485,6 +600,23 @@ class Tablet {
   // May be NULL in unit tests, etc.
   TabletMetrics* metrics() { return metrics_.get(); }
 
+  // A version of the tablet's data, which changes whenever rows are written
+  // to the tablet, or its schema is altered. Clients use it to tell whether
+  // the results of a scan they've cached are still current: if the version
+  // is the same as when a scan started, no scan started later can see other
+  // rows. It starts at a random value, so that two Tablet objects (e.g.
+  // before and after a restart, or on different servers) are very unlikely
+  // to have versions in common.
+  uint64_t data_version() const {
+    return data_version_.load(std::memory_order_acquire);
+  }
+
+  // Moves to a new data version. Must be called after changes to the
+  // tablet's data are visible to new scans.
+  void AdvanceDataVersion() {
+    data_version_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
   // Return handle to the metric entity of this tablet.
   const scoped_refptr<MetricEntity>& GetMetricEntity() const {
     return metric_entity_;
@@ -532,6 +664,12 @@ class Tablet {
   // This method is not thread safe and should only be called from a single thread at once.
   double CollectAndUpdateWorkloadStats(MaintenanceOp::PerfImprovementOpType type);
 
+  // Returns the storage tier which compactions of this tablet write their
+  // output to: the capacity tier if the tablet has been neither written to
+  // nor scanned for --tablet_cold_data_threshold_secs, and the fast tier
+  // otherwise. Flushes always write to the fast tier.
+  fs::StorageTier CompactionStorageTier() const;
+
   // Returns the best DMS to flush, based on its memory size and retained
   // bytes. Also returns the earliest creation time of a DMS seen. Note that
   // 'mem_size' and 'replay_size' correspond to the same DMS but
@@ -604,6 +742,11 @@ class Tablet {
 
   Status FlushUnlocked();
 
+  // Returns true if the tablet has no rows, as required by BulkLoad().
+  //
+  // REQUIRES: component_lock_ is held.
+  bool IsEmptyForBulkLoadUnlocked() const;
+
   // Validate the contents of 'op' and return a bad Status if it is invalid.
   static Status ValidateOp(const RowOp& op);
 
@@ -633,6 +776,31 @@ class Tablet {
                            RowOp* op,
                            ProbeStats* stats);
 
+  // Prepares the DELETE_RANGE operations of 'op_state', in place of acquiring
+  // row locks: flushes the MRSs and the DMSs of the rowsets intersecting any
+  // of the ranges, so that the rows to delete are all in the base data of DRSs
+  // and no earlier mutation of theirs remains to be replayed on bootstrap.
+  //
+  // REQUIRES: the schema and range delete locks are held exclusively.
+  Status PrepareRangeDeletes(WriteOpState* op_state);
+
+  // Performs a DELETE_RANGE operation prepared by PrepareRangeDeletes(), by
+  // recording a range tombstone in each DRS intersecting the range and
+  // flushing the tablet metadata.
+  Status DeleteRangeUnlocked(const fs::IOContext* io_context,
+                             WriteOpState* op_state,
+                             RowOp* op);
+
+  // Sets '*lower_bound' and '*upper_bound' to the encoded bounds of the
+  // DELETE_RANGE operation 'op', or to null if unbounded, allocated from
+  // 'arena', and 'rowsets' to the rowsets of 'comps' intersecting the range.
+  void FindRangeDeleteRowSets(const RowOp& op,
+                              const TabletComponents& comps,
+                              Arena* arena,
+                              EncodedKey** lower_bound,
+                              EncodedKey** upper_bound,
+                              std::vector<RowSet*>* rowsets) const;
+
   // In the case of an UPSERT against a duplicate row, converts the UPSERT
   // into an internal UPDATE operation and performs it.
   Status ApplyUpsertAsUpdate(const fs::IOContext* io_context,
@@ -668,11 +836,40 @@ class Tablet {
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
 
+  // Runs the compaction policy over the rowsets of 'tree'. If the rows are
+  // clustered, the rowsets of different clusters overlap by design, so the
+  // policy runs over the rowsets of each cluster, together with the rowsets
+  // which aren't clustered, and the best selection wins. See PickRowSets() in
+  // CompactionPolicy.
+  //
+  // compact_select_lock_ must be held.
+  Status PickRowSetsByCluster(const RowSetTree& tree,
+                              std::unordered_set<const RowSet*>* picked,
+                              double* quality,
+                              std::vector<std::string>* log) const;
+
   // Performs a merge compaction or a flush.
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                   int64_t mrs_being_flushed,
                                   const std::vector<TxnInfoBeingFlushed>& txns_being_flushed);
 
+  // Writes the rows of 'input' as of 'snap' into new rowsets: phase 1 of a
+  // merge compaction or flush. If 'key_ranges' is non-empty, the rows of each
+  // key range are written concurrently, each by its own writer. If
+  // 'clustering' is non-null, the rows of each cluster are written by its own
+  // writer, and 'key_ranges' must be empty. Otherwise a single writer writes
+  // all of them. On success, 'writers' holds the finished writers, in key
+  // order or in cluster order.
+  Status WriteCompactionOutput(const RowSetsInCompaction& input,
+                               const MvccSnapshot& snap,
+                               const Schema* schema,
+                               const std::vector<KeyRange>& key_ranges,
+                               const RowSetClustering* clustering,
+                               fs::StorageTier tier,
+                               const HistoryGcOpts& history_gc_opts,
+                               const fs::IOContext* io_context,
+                               std::vector<std::unique_ptr<RollingDiskRowSetWriter>>* writers);
+
   // Handle the case in which a compaction or flush yielded no output rows.
   // In this case, we just need to remove the rowsets in 'rowsets' from the
   // metadata and flush it.
@@ -694,15 +891,31 @@ class Tablet {
                                const RowSetVector& rowsets_to_add,
                                RowSetTree* new_tree);
 
+  // A RowSetTree built ahead of a swap of rowsets, and the tree it was built
+  // from.
+  struct PreparedRowSetSwap {
+    std::shared_ptr<RowSetTree> base;
+    std::shared_ptr<RowSetTree> tree;
+  };
+
+  // Builds the tree of the current rowsets with 'to_remove' replaced by
+  // 'to_add', holding component_lock_ only to read the current tree, so that
+  // the swap itself takes the lock in write mode for as little as possible.
+  PreparedRowSetSwap PrepareRowSetSwap(const RowSetVector& to_remove,
+                                       const RowSetVector& to_add) const;
+
   // Swap out a set of rowsets, atomically replacing them with the new rowset
   // under the lock.
   void AtomicSwapRowSets(const RowSetVector &to_remove,
                          const RowSetVector &to_add);
 
   // Same as the above, but without taking the lock. This should only be used
-  // in cases where the lock is already held.
+  // in cases where the lock is already held. The tree of 'prepared', if any,
+  // is swapped in if it was built from the current rowsets: otherwise the
+  // tree is built again.
   void AtomicSwapRowSetsUnlocked(const RowSetVector &to_remove,
-                                 const RowSetVector &to_add);
+                                 const RowSetVector &to_add,
+                                 PreparedRowSetSwap prepared = {});
 
   void GetComponents(scoped_refptr<TabletComponents>* comps) const {
     shared_lock<rw_spinlock> l(component_lock_);
@@ -795,6 +1008,9 @@ class Tablet {
   scoped_refptr<MetricEntity> metric_entity_;
   std::unique_ptr<TabletMetrics> metrics_;
 
+  // The cache of rows for LookupRows(), or null if disabled.
+  std::unique_ptr<RowCache> row_cache_;
+
   std::unique_ptr<Throttler> throttler_;
 
   int64_t next_mrs_id_;
@@ -820,6 +1036,13 @@ class Tablet {
   // so that they don't both try to select the same rowset.
   mutable std::mutex compact_select_lock_;
 
+  // Lock keeping range deletes and merge compactions apart, since a range
+  // tombstone recorded in the input rowsets of a compaction once it has
+  // started wouldn't be carried over to its output. Range deletes take it
+  // in exclusive mode from Prepare() until they're applied, before the schema
+  // lock and without waiting for it; compactions take it in shared mode.
+  mutable rw_semaphore range_delete_lock_;
+
   // We take this lock when flushing the tablet's rowsets in Tablet::Flush.  We
   // don't want to have two flushes in progress at once, in case the one which
   // started earlier completes after the one started later.
@@ -833,6 +1056,9 @@ class Tablet {
   // Protected by state_lock_ for transitions, but may be read without holding a lock.
   std::atomic<State> state_;
 
+  // See data_version().
+  std::atomic<uint64_t> data_version_;
+
   // Fake lock used to ensure calls to RegisterMaintenanceOps and
   // UnregisterMaintenanceOps don't overlap. This serves to ensure that only
   // one thread is updating the maintenance op list at a time.
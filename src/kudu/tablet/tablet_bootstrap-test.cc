@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <boost/optional/optional.hpp>
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -75,6 +76,8 @@
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(tablet_bootstrap_prefetch_log_entries);
+
 using kudu::consensus::ConsensusBootstrapInfo;
 using kudu::consensus::ConsensusMetadata;
 using kudu::consensus::ConsensusMetadataManager;
@@ -128,12 +131,16 @@ class BootstrapTest : public LogTestBase {
     return (*meta)->Flush();
   }
 
-  Status CreateConsensusMetadata(const scoped_refptr<TabletMetadata>& meta) {
+  Status CreateConsensusMetadata(const scoped_refptr<TabletMetadata>& meta,
+                                 bool witness = false) {
     consensus::RaftConfigPB config;
     config.set_opid_index(consensus::kInvalidOpIdIndex);
     consensus::RaftPeerPB* peer = config.add_peers();
     peer->set_permanent_uuid(meta->fs_manager()->uuid());
     peer->set_member_type(consensus::RaftPeerPB::VOTER);
+    if (witness) {
+      peer->mutable_attrs()->set_witness(true);
+    }
 
     RETURN_NOT_OK_PREPEND(cmeta_manager_->Create(meta->tablet_id(), config, kMinimumTerm),
                           "Unable to create consensus metadata");
@@ -238,6 +245,63 @@ TEST_F(BootstrapTest, TestBootstrap) {
   ASSERT_EQ(1, results.size());
 }
 
+// Bootstrap with the log entries read ahead on a separate thread, across
+// several segments.
+TEST_F(BootstrapTest, TestBootstrapWithPrefetch) {
+  FLAGS_tablet_bootstrap_prefetch_log_entries = true;
+  ASSERT_OK(BuildLog());
+  const int kOpsPerSegment = 50;
+  ASSERT_OK(AppendReplicateBatchAndCommitEntryPairsToLog(kOpsPerSegment));
+  ASSERT_OK(RollLog());
+  ASSERT_OK(AppendReplicateBatchAndCommitEntryPairsToLog(kOpsPerSegment));
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_EQ(2 * kOpsPerSegment, results.size());
+}
+
+// A witness doesn't replay writes, but its rebuilt log still has the COMMIT of
+// each REPLICATE.
+TEST_F(BootstrapTest, TestBootstrapWitness) {
+  ASSERT_OK(BuildLog());
+  const int kNumOps = 10;
+  ASSERT_OK(AppendReplicateBatchAndCommitEntryPairsToLog(kNumOps));
+
+  scoped_refptr<TabletMetadata> meta;
+  ASSERT_OK(LoadTestTabletMetadata(/*mrs_id=*/ -1, /*delta_id=*/ -1, &meta));
+  ASSERT_OK(CreateConsensusMetadata(meta, /*witness=*/ true));
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(RunBootstrapOnTestTablet(meta, &tablet, &boot_info));
+  ASSERT_TRUE(boot_info.orphaned_replicates.empty());
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_TRUE(results.empty());
+
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+  log::SegmentSequence segments;
+  log_->reader()->GetSegmentsSnapshot(&segments);
+  int num_replicates = 0;
+  int num_commits = 0;
+  for (const auto& segment : segments) {
+    log::LogEntries entries;
+    ASSERT_OK(segment->ReadEntries(&entries));
+    for (const auto& entry : entries) {
+      if (entry->type() == log::REPLICATE) {
+        num_replicates++;
+      } else if (entry->type() == log::COMMIT) {
+        ASSERT_EQ(consensus::WRITE_OP, entry->commit().op_type());
+        num_commits++;
+      }
+    }
+  }
+  ASSERT_EQ(kNumOps, num_replicates);
+  ASSERT_EQ(kNumOps, num_commits);
+}
+
 // Test that we don't overflow opids. Regression test for KUDU-1933.
 TEST_F(BootstrapTest, TestBootstrapHighOpIdIndex) {
   // Start appending with a log index 3 under the int32 max value.
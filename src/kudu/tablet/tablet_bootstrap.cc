@@ -53,6 +53,7 @@
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/quorum_util.h"
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
@@ -82,6 +83,7 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/util/blocking_queue.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
@@ -94,6 +96,7 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
 
 DECLARE_bool(prevent_kudu_2233_corruption);
 DECLARE_int32(group_commit_queue_size_bytes);
@@ -104,12 +107,21 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_bool(tablet_bootstrap_prefetch_log_entries, false,
+            "Whether tablet bootstrap reads, decompresses and decodes the entries "
+            "of the log on a separate thread, ahead of their replay, so that the "
+            "replay of an entry overlaps with the reading of the next ones.");
+TAG_FLAG(tablet_bootstrap_prefetch_log_entries, advanced);
+TAG_FLAG(tablet_bootstrap_prefetch_log_entries, experimental);
+TAG_FLAG(tablet_bootstrap_prefetch_log_entries, runtime);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
 using kudu::clock::Clock;
 using kudu::consensus::ALTER_SCHEMA_OP;
 using kudu::consensus::CHANGE_CONFIG_OP;
 using kudu::consensus::CommitMsg;
+using kudu::consensus::IsRaftConfigWitness;
 using kudu::consensus::ConsensusBootstrapInfo;
 using kudu::consensus::MinimumOpId;
 using kudu::consensus::NO_OP;
@@ -314,6 +326,10 @@ class TabletBootstrap {
   Status PlayNoOpRequest(const IOContext* io_context, ReplicateMsg* replicate_msg,
                          const CommitMsg& commit_msg);
 
+  // Plays a data op on a witness, which only appends its commit message.
+  Status PlayWitnessDataOpRequest(const IOContext* io_context, ReplicateMsg* replicate_msg,
+                                  const CommitMsg& commit_msg);
+
   // Plays operations, skipping those that have already been flushed or have previously failed.
   // See ApplyRowOperations() for more details on how the decision of whether an operation
   // is applied or skipped is made.
@@ -416,6 +432,9 @@ class TabletBootstrap {
   const scoped_refptr<TabletMetadata> tablet_meta_;
   const string log_prefix_;
   const RaftConfigPB committed_raft_config_;
+  // Whether the local replica is a witness, in which case ops that only
+  // modify tablet data aren't replayed.
+  const bool is_witness_;
   Clock* clock_;
   shared_ptr<MemTracker> mem_tracker_;
   scoped_refptr<rpc::ResultTracker> result_tracker_;
@@ -560,6 +579,8 @@ TabletBootstrap::TabletBootstrap(
                              tablet_meta_->tablet_id(),
                              tablet_meta_->fs_manager()->uuid())),
       committed_raft_config_(std::move(committed_raft_config)),
+      is_witness_(IsRaftConfigWitness(tablet_meta_->fs_manager()->uuid(),
+                                      committed_raft_config_)),
       clock_(clock),
       mem_tracker_(std::move(mem_tracker)),
       result_tracker_(std::move(result_tracker)),
@@ -1124,30 +1145,37 @@ Status TabletBootstrap::HandleEntryPair(const IOContext* io_context, LogEntryPB*
   const CommitMsg& commit = commit_entry->commit();
   OperationType op_type = commit.op_type();
 
-  switch (op_type) {
-    case WRITE_OP:
-      RETURN_NOT_OK_REPLAY(PlayWriteRequest, io_context, replicate, commit);
-      break;
+  if (is_witness_ && (op_type == WRITE_OP || op_type == ALTER_SCHEMA_OP ||
+                      op_type == PARTICIPANT_OP)) {
+    // A witness never applies data ops, but it keeps their commit records, so
+    // that each REPLICATE in the rebuilt log has its COMMIT.
+    RETURN_NOT_OK_REPLAY(PlayWitnessDataOpRequest, io_context, replicate, commit);
+  } else {
+    switch (op_type) {
+      case WRITE_OP:
+        RETURN_NOT_OK_REPLAY(PlayWriteRequest, io_context, replicate, commit);
+        break;
 
-    case ALTER_SCHEMA_OP:
-      RETURN_NOT_OK_REPLAY(PlayAlterSchemaRequest, io_context, replicate, commit);
-      break;
+      case ALTER_SCHEMA_OP:
+        RETURN_NOT_OK_REPLAY(PlayAlterSchemaRequest, io_context, replicate, commit);
+        break;
 
-    case CHANGE_CONFIG_OP:
-      RETURN_NOT_OK_REPLAY(PlayChangeConfigRequest, io_context, replicate, commit);
-      break;
+      case CHANGE_CONFIG_OP:
+        RETURN_NOT_OK_REPLAY(PlayChangeConfigRequest, io_context, replicate, commit);
+        break;
 
-    case PARTICIPANT_OP:
-      RETURN_NOT_OK_REPLAY(PlayTxnParticipantOpRequest, io_context, replicate, commit);
-      break;
+      case PARTICIPANT_OP:
+        RETURN_NOT_OK_REPLAY(PlayTxnParticipantOpRequest, io_context, replicate, commit);
+        break;
 
-    case NO_OP:
-      RETURN_NOT_OK_REPLAY(PlayNoOpRequest, io_context, replicate, commit);
-      break;
+      case NO_OP:
+        RETURN_NOT_OK_REPLAY(PlayNoOpRequest, io_context, replicate, commit);
+        break;
 
-    default:
-      return Status::IllegalState(Substitute("Unsupported commit entry type: $0",
-                                             commit.op_type()));
+      default:
+        return Status::IllegalState(Substitute("Unsupported commit entry type: $0",
+                                               commit.op_type()));
+    }
   }
 
 #undef RETURN_NOT_OK_REPLAY
@@ -1215,6 +1243,95 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+namespace {
+
+// Reads the entries of a sequence of log segments on a separate thread, ahead
+// of their replay. Entries are read in order, and handed out in that order.
+class LogEntryPrefetcher {
+ public:
+  explicit LogEntryPrefetcher(log::SegmentSequence segments)
+      : segments_(std::move(segments)),
+        queue_(kBufferBytes) {
+  }
+
+  ~LogEntryPrefetcher() {
+    queue_.Shutdown();
+    if (thread_) {
+      thread_->Join();
+    }
+  }
+
+  Status Start() {
+    return Thread::Create("tablet", "bootstrap-log-prefetch",
+                          [this]() { this->Run(); }, &thread_);
+  }
+
+  // Like log::LogEntryReader::ReadNextEntry() for the segment at index
+  // 'segment_idx', which must be the segment being read. Also returns the
+  // offset of the entry following 'entry' in the segment.
+  Status ReadNextEntry(int segment_idx, unique_ptr<LogEntryPB>* entry, int64_t* offset) {
+    Item item;
+    RETURN_NOT_OK(queue_.BlockingGet(&item));
+    DCHECK_EQ(segment_idx, item.segment_idx);
+    *entry = std::move(item.entry);
+    *offset = item.offset;
+    return item.status;
+  }
+
+ private:
+  // The upper bound on the size of the entries read ahead.
+  static constexpr size_t kBufferBytes = 64 * 1024 * 1024;
+
+  struct Item {
+    int segment_idx = 0;
+    unique_ptr<LogEntryPB> entry;
+    Status status;
+    int64_t offset = 0;
+    size_t size_bytes = 0;
+  };
+
+  struct ItemLogicalSize {
+    static size_t logical_size(const Item& item) {
+      return item.size_bytes;
+    }
+  };
+
+  void Run() {
+    for (int i = 0; i < segments_.size(); i++) {
+      log::LogEntryReader reader(segments_[i].get());
+      while (true) {
+        Item item;
+        item.segment_idx = i;
+        item.status = reader.ReadNextEntry(&item.entry);
+        item.offset = reader.offset();
+        if (item.entry) {
+          item.size_bytes = item.entry->ByteSizeLong();
+        }
+        const Status s = item.status;
+        if (!queue_.BlockingPut(std::move(item)).ok()) {
+          return;
+        }
+        if (!s.ok()) {
+          // Past the end of a segment, go on with the next one. An error ends
+          // the replay, so there is nothing more to read.
+          if (s.IsEndOfFile()) {
+            break;
+          }
+          return;
+        }
+      }
+    }
+  }
+
+  const log::SegmentSequence segments_;
+  BlockingQueue<Item, ItemLogicalSize> queue_;
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(LogEntryPrefetcher);
+};
+
+} // anonymous namespace
+
 Status TabletBootstrap::PlaySegments(const IOContext* io_context,
                                      ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
@@ -1244,14 +1361,27 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
 
+  unique_ptr<LogEntryPrefetcher> prefetcher;
+  if (FLAGS_tablet_bootstrap_prefetch_log_entries) {
+    prefetcher.reset(new LogEntryPrefetcher(segments));
+    RETURN_NOT_OK_PREPEND(prefetcher->Start(), "could not start log prefetching thread");
+  }
+
   for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
     log::LogEntryReader reader(segment.get());
 
     int entry_count = 0;
+    int64_t offset = 0;
     while (true) {
       {
         unique_ptr<LogEntryPB> entry;
-        Status s = reader.ReadNextEntry(&entry);
+        Status s;
+        if (prefetcher) {
+          s = prefetcher->ReadNextEntry(segment_count, &entry, &offset);
+        } else {
+          s = reader.ReadNextEntry(&entry);
+          offset = reader.offset();
+        }
         if (PREDICT_FALSE(!s.ok())) {
           if (s.IsEndOfFile()) {
             break;
@@ -1283,7 +1413,7 @@ Status TabletBootstrap::PlaySegments(const IOContext* io_context,
         SetStatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
                                     "($2/$3 this segment, stats: $4)",
                                     segment_count + 1, log_reader_->num_segments(),
-                                    HumanReadableNumBytes::ToString(reader.offset()),
+                                    HumanReadableNumBytes::ToString(offset),
                                     HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
                                     stats_.ToString()));
         last_status_update = now;
@@ -1634,6 +1764,12 @@ Status TabletBootstrap::PlayNoOpRequest(const IOContext* /*io_context*/,
   return AppendCommitMsg(commit_msg);
 }
 
+Status TabletBootstrap::PlayWitnessDataOpRequest(const IOContext* /*io_context*/,
+                                                 ReplicateMsg* /*replicate_msg*/,
+                                                 const CommitMsg& commit_msg) {
+  return AppendCommitMsg(commit_msg);
+}
+
 Status TabletBootstrap::PlayRowOperations(const IOContext* io_context,
                                           WriteOpState* op_state,
                                           const TxResultPB& orig_result,
@@ -1692,7 +1828,8 @@ Status TabletBootstrap::ApplyOperations(const IOContext* io_context,
       case RowOperationsPB::UPDATE:
       case RowOperationsPB::UPDATE_IGNORE:
       case RowOperationsPB::DELETE:
-      case RowOperationsPB::DELETE_IGNORE: {
+      case RowOperationsPB::DELETE_IGNORE:
+      case RowOperationsPB::DELETE_RANGE: {
         stats_.mutations_seen++;
         if (op->has_result()) {
           stats_.mutations_ignored++;
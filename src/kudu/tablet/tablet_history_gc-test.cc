@@ -745,5 +745,79 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestGCDeletedRowsetsAfterMajorCompaction)
   NO_FATALS(TryRunningDeletedRowsetGC());
 }
 
+class TabletTtlGcTest : public KuduTabletTest {
+ public:
+  TabletTtlGcTest()
+      : KuduTabletTest(Schema({ ColumnSchema("key", INT32),
+                                ColumnSchema("ts", UNIXTIME_MICROS) }, 1)) {
+    FLAGS_enable_maintenance_manager = false;
+  }
+
+  // Inserts a rowset of 'num_rows' rows, starting at key 'first_key', whose
+  // timestamps are 'age_sec' seconds old.
+  void InsertRowSet(int first_key, int num_rows, int age_sec) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    const int64_t ts = GetCurrentTimeMicros() - age_sec * 1000000LL;
+    for (int i = first_key; i < first_key + num_rows; i++) {
+      ASSERT_OK(row.SetInt32(0, i));
+      ASSERT_OK(row.SetUnixTimeMicros(1, ts));
+      ASSERT_OK(writer.Insert(row));
+    }
+    ASSERT_OK(tablet()->Flush());
+  }
+
+  void SetTtl(int ttl_sec) {
+    TableExtraConfigPB extra_config;
+    extra_config.set_ttl_column("ts");
+    extra_config.set_ttl_sec(ttl_sec);
+    NO_FATALS(AlterSchema(*tablet()->schema(), extra_config));
+  }
+};
+
+// Test that the rowsets whose rows have all expired are dropped, and that the
+// others are kept.
+TEST_F(TabletTtlGcTest, TestDeleteExpiredRowsets) {
+  NO_FATALS(InsertRowSet(0, 100, 3600));
+  NO_FATALS(InsertRowSet(100, 100, 0));
+  ASSERT_EQ(2, tablet()->num_rowsets());
+
+  // Without a TTL, nothing has expired.
+  int64_t bytes = 0;
+  ASSERT_OK(tablet()->GetBytesInExpiredRowsets(&bytes));
+  ASSERT_EQ(0, bytes);
+
+  NO_FATALS(SetTtl(60));
+  ASSERT_OK(tablet()->GetBytesInExpiredRowsets(&bytes));
+  ASSERT_GT(bytes, 0);
+  ASSERT_OK(tablet()->DeleteExpiredRowsets());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  ASSERT_EQ(bytes, tablet()->metrics()->expired_rowset_gc_bytes_deleted->value());
+
+  ASSERT_OK(tablet()->GetBytesInExpiredRowsets(&bytes));
+  ASSERT_EQ(0, bytes);
+  ASSERT_OK(tablet()->DeleteExpiredRowsets());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+}
+
+// Test that a rowset isn't dropped if an update may have changed the TTL
+// column of one of its rows.
+TEST_F(TabletTtlGcTest, TestUpdatedRowsetsNotDeleted) {
+  NO_FATALS(InsertRowSet(0, 100, 3600));
+  NO_FATALS(SetTtl(60));
+  {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    ASSERT_OK(row.SetInt32(0, 0));
+    ASSERT_OK(row.SetUnixTimeMicros(1, GetCurrentTimeMicros()));
+    ASSERT_OK(writer.Update(row));
+  }
+  int64_t bytes = 0;
+  ASSERT_OK(tablet()->GetBytesInExpiredRowsets(&bytes));
+  ASSERT_EQ(0, bytes);
+  ASSERT_OK(tablet()->DeleteExpiredRowsets());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -37,6 +37,7 @@
 #include "kudu/common/wire_protocol-test-util.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -47,6 +48,7 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/txn_metadata.h"
+#include "kudu/util/env.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -54,11 +56,13 @@
 
 DEFINE_int64(test_row_set_count, 1000, "");
 DEFINE_int64(test_block_count_per_rs, 1000, "");
+DECLARE_bool(tablet_metadata_update_log);
 
 using kudu::log::LogAnchorRegistry;
 using kudu::log::MinLogIndexAnchorer;
 using std::map;
 using std::shared_ptr;
+using std::string;
 using std::unique_ptr;
 using std::unordered_set;
 
@@ -204,6 +208,61 @@ TEST_F(TestTabletMetadata, TestOnDiskSize) {
   ASSERT_GE(final_size, superblock_pb.ByteSizeLong());
 }
 
+// Test that the metadata flushes which only change rowsets are appended to the
+// update log, and that the metadata loaded from disk reflects them.
+TEST_F(TestTabletMetadata, TestUpdateLog) {
+  FLAGS_tablet_metadata_update_log = true;
+  TabletMetadata* meta = harness_->tablet()->metadata();
+  FsManager* fs_manager = harness_->fs_manager();
+  const string& tablet_id = harness_->tablet()->tablet_id();
+  const string meta_path = fs_manager->GetTabletMetadataPath(tablet_id);
+  const string log_path = fs_manager->GetTabletMetadataUpdateLogPath(tablet_id);
+  const auto assert_loaded_metadata_matches = [&]() {
+    TabletSuperBlockPB expected;
+    ASSERT_OK(meta->ToSuperBlock(&expected));
+    scoped_refptr<TabletMetadata> loaded;
+    ASSERT_OK(TabletMetadata::Load(fs_manager, tablet_id, &loaded));
+    TabletSuperBlockPB actual;
+    ASSERT_OK(loaded->ToSuperBlock(&actual));
+    ASSERT_EQ(pb_util::SecureDebugString(expected), pb_util::SecureDebugString(actual));
+  };
+
+  // The first flush rewrites the superblock, and starts the update log.
+  unique_ptr<KuduPartialRow> row;
+  BuildPartialRow(0, 0, "foo", &row);
+  ASSERT_OK(writer_->Insert(*row));
+  ASSERT_OK(harness_->tablet()->Flush());
+  ASSERT_TRUE(env_->FileExists(log_path));
+  uint64_t meta_size;
+  ASSERT_OK(env_->GetFileSize(meta_path, &meta_size));
+  uint64_t log_size;
+  ASSERT_OK(env_->GetFileSize(log_path, &log_size));
+  NO_FATALS(assert_loaded_metadata_matches());
+
+  // The next one only appends the new rowset to the update log.
+  BuildPartialRow(1, 1, "bar", &row);
+  ASSERT_OK(writer_->Insert(*row));
+  ASSERT_OK(harness_->tablet()->Flush());
+  uint64_t new_meta_size;
+  ASSERT_OK(env_->GetFileSize(meta_path, &new_meta_size));
+  ASSERT_EQ(meta_size, new_meta_size);
+  uint64_t new_log_size;
+  ASSERT_OK(env_->GetFileSize(log_path, &new_log_size));
+  ASSERT_GT(new_log_size, log_size);
+  ASSERT_EQ(meta_size + new_log_size, meta->on_disk_size());
+  NO_FATALS(assert_loaded_metadata_matches());
+
+  // Compacting removes rowsets.
+  ASSERT_OK(harness_->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  NO_FATALS(assert_loaded_metadata_matches());
+
+  // Once disabled, the superblock is rewritten and the update log deleted.
+  FLAGS_tablet_metadata_update_log = false;
+  ASSERT_OK(meta->Flush());
+  ASSERT_FALSE(env_->FileExists(log_path));
+  NO_FATALS(assert_loaded_metadata_matches());
+}
+
 TEST_F(TestTabletMetadata, BenchmarkCollectBlockIds) {
   auto tablet_meta = harness_->tablet()->metadata();
   RowSetMetadataVector rs_metas;
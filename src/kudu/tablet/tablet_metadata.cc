@@ -28,11 +28,16 @@
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/message_lite.h>
+#include <google/protobuf/repeated_field.h>
 #include <google/protobuf/stubs/port.h>
 
 #include "kudu/common/common.pb.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
+#include "kudu/common/types.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid.pb.h"
@@ -71,14 +76,27 @@ DEFINE_int32(tablet_metadata_load_inject_latency_ms, 0,
              "Only for testing.");
 TAG_FLAG(tablet_metadata_load_inject_latency_ms, hidden);
 
+DEFINE_bool(tablet_metadata_update_log, false,
+            "Whether the tablet metadata flushes which only change the rowsets of "
+            "a tablet, e.g. after flushes and compactions, only append the changed "
+            "rowsets to an update log next to the superblock rather than rewrite "
+            "the whole superblock. The superblock is rewritten once the log grows "
+            "larger than it. Versions of Kudu which don't support the update log "
+            "must not be run on data written with this enabled.");
+TAG_FLAG(tablet_metadata_update_log, experimental);
+TAG_FLAG(tablet_metadata_update_log, runtime);
+
 using base::subtle::Barrier_AtomicIncrement;
 using kudu::consensus::MinimumOpId;
 using kudu::consensus::OpId;
 using kudu::fs::BlockDeletionTransaction;
 using kudu::fs::BlockManager;
 using kudu::log::MinLogIndexAnchorer;
+using kudu::pb_util::ReadablePBContainerFile;
 using kudu::pb_util::SecureDebugString;
 using kudu::pb_util::SecureShortDebugString;
+using kudu::pb_util::WritablePBContainerFile;
+using google::protobuf::RepeatedPtrField;
 using std::memory_order_relaxed;
 using std::shared_ptr;
 using std::string;
@@ -91,6 +109,113 @@ using strings::Substitute;
 namespace kudu {
 namespace tablet {
 
+namespace {
+
+// Serializes 'msg' so that equal messages are serialized to equal strings.
+string SerializeDeterministically(const google::protobuf::MessageLite& msg) {
+  string ret;
+  msg.ByteSizeLong();
+  {
+    google::protobuf::io::StringOutputStream out(&ret);
+    google::protobuf::io::CodedOutputStream coded(&out);
+    coded.SetSerializationDeterministic(true);
+    msg.SerializeWithCachedSizes(&coded);
+  }
+  return ret;
+}
+
+// Serializes the fields of 'superblock' which a TabletMetadataUpdatePB can't
+// update. 'superblock' is left unchanged.
+string SerializeStaticFields(TabletSuperBlockPB* superblock) {
+  RepeatedPtrField<RowSetDataPB> rowsets;
+  RepeatedPtrField<BlockIdPB> orphaned_blocks;
+  rowsets.Swap(superblock->mutable_rowsets());
+  orphaned_blocks.Swap(superblock->mutable_orphaned_blocks());
+  const int64_t last_durable_mrs_id = superblock->last_durable_mrs_id();
+  const boost::optional<int64_t> checkpoint_id = superblock->has_checkpoint_id() ?
+      boost::make_optional(superblock->checkpoint_id()) : boost::none;
+  superblock->set_last_durable_mrs_id(0);
+  superblock->clear_checkpoint_id();
+
+  string ret = SerializeDeterministically(*superblock);
+
+  rowsets.Swap(superblock->mutable_rowsets());
+  orphaned_blocks.Swap(superblock->mutable_orphaned_blocks());
+  superblock->set_last_durable_mrs_id(last_durable_mrs_id);
+  if (checkpoint_id) {
+    superblock->set_checkpoint_id(*checkpoint_id);
+  }
+  return ret;
+}
+
+// Applies the records of the metadata update log at 'path', if any, which
+// apply to 'superblock'.
+Status ApplyUpdateLog(Env* env, const string& path, TabletSuperBlockPB* superblock) {
+  if (!env->FileExists(path)) {
+    return Status::OK();
+  }
+  RandomAccessFileOptions opts;
+  opts.is_sensitive = true;
+  unique_ptr<RandomAccessFile> file;
+  RETURN_NOT_OK_PREPEND(env->NewRandomAccessFile(opts, path, &file),
+                        "Could not open tablet metadata update log");
+  ReadablePBContainerFile reader(std::move(file));
+  Status s = reader.Open();
+  if (s.IsIncomplete()) {
+    // The log is created right after the superblock it applies to is written,
+    // so if its header is incomplete, it has no records for that superblock.
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, Substitute("Could not open tablet metadata update log $0", path));
+
+  // The position of each rowset in the superblock, by id.
+  unordered_map<int64_t, int> rowset_idx;
+  for (int i = 0; i < superblock->rowsets_size(); i++) {
+    rowset_idx.emplace(superblock->rowsets(i).id(), i);
+  }
+  while (true) {
+    TabletMetadataUpdatePB update;
+    s = reader.ReadNextPB(&update);
+    if (s.IsEndOfFile() || s.IsIncomplete()) {
+      // An incomplete record is a write which wasn't acknowledged.
+      break;
+    }
+    RETURN_NOT_OK_PREPEND(s, Substitute("Could not read tablet metadata update log $0", path));
+    if (update.checkpoint_id() != superblock->checkpoint_id()) {
+      // The superblock was rewritten after this log was written, but before
+      // the log was replaced.
+      break;
+    }
+    if (update.removed_rowset_ids_size() > 0) {
+      const unordered_set<int64_t> removed(update.removed_rowset_ids().begin(),
+                                           update.removed_rowset_ids().end());
+      RepeatedPtrField<RowSetDataPB> rowsets;
+      rowsets.Swap(superblock->mutable_rowsets());
+      rowset_idx.clear();
+      for (auto& rs : rowsets) {
+        if (!ContainsKey(removed, rs.id())) {
+          rowset_idx.emplace(rs.id(), superblock->rowsets_size());
+          superblock->add_rowsets()->Swap(&rs);
+        }
+      }
+    }
+    for (auto& rs : *update.mutable_upserted_rowsets()) {
+      const int* idx = FindOrNull(rowset_idx, rs.id());
+      if (idx) {
+        superblock->mutable_rowsets(*idx)->Swap(&rs);
+      } else {
+        rowset_idx.emplace(rs.id(), superblock->rowsets_size());
+        superblock->add_rowsets()->Swap(&rs);
+      }
+    }
+    superblock->set_last_durable_mrs_id(update.last_durable_mrs_id());
+    superblock->mutable_orphaned_blocks()->Swap(update.mutable_orphaned_blocks());
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
 // ============================================================================
 //  Tablet Metadata
 // ============================================================================
@@ -206,6 +331,15 @@ vector<BlockIdPB> TabletMetadata::CollectBlockIdPBs(const TabletSuperBlockPB& su
     if (rowset.has_adhoc_index_block()) {
       block_ids.push_back(rowset.adhoc_index_block());
     }
+    for (const ColumnDataPB& index : rowset.secondary_indexes()) {
+      block_ids.push_back(index.block());
+    }
+    for (const ColumnDataPB& index : rowset.bitmap_indexes()) {
+      block_ids.push_back(index.block());
+    }
+    for (const ColumnDataPB& bloom : rowset.column_bloom_filters()) {
+      block_ids.push_back(bloom.block());
+    }
   }
   return block_ids;
 }
@@ -289,8 +423,16 @@ Status TabletMetadata::DeleteSuperBlock() {
                    tablet_data_state_));
   }
 
+  // The update log is deleted first, so that it can't be applied to the
+  // superblock of a new replica of the tablet.
+  Env* env = fs_manager_->env();
+  const string log_path = fs_manager_->GetTabletMetadataUpdateLogPath(tablet_id_);
+  if (env->FileExists(log_path)) {
+    RETURN_NOT_OK_PREPEND(env->DeleteFile(log_path),
+                          "Unable to delete metadata update log for tablet " + tablet_id_);
+  }
   string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
-  RETURN_NOT_OK_PREPEND(fs_manager_->env()->DeleteFile(path),
+  RETURN_NOT_OK_PREPEND(env->DeleteFile(path),
                         "Unable to delete superblock for tablet " + tablet_id_);
   return Status::OK();
 }
@@ -326,6 +468,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       needs_flush_(false),
       flush_count_for_tests_(0),
       pre_flush_callback_(&DoNothingStatusClosure),
+      checkpoint_id_(0),
+      checkpoint_size_(0),
       supports_live_row_count_(supports_live_row_count) {
   CHECK(schema_->has_column_ids());
   CHECK_GT(schema_->num_key_columns(), 0);
@@ -343,6 +487,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
       needs_flush_(false),
       flush_count_for_tests_(0),
       pre_flush_callback_(&DoNothingStatusClosure),
+      checkpoint_id_(0),
+      checkpoint_size_(0),
       supports_live_row_count_(false) {}
 
 Status TabletMetadata::LoadFromDisk() {
@@ -352,9 +498,15 @@ Status TabletMetadata::LoadFromDisk() {
   CHECK_EQ(state_, kNotLoadedYet);
 
   TabletSuperBlockPB superblock;
-  RETURN_NOT_OK(ReadSuperBlockFromDisk(&superblock));
+  RETURN_NOT_OK(ReadSuperBlockFromDisk(fs_manager_, tablet_id_, &superblock));
   RETURN_NOT_OK_PREPEND(LoadFromSuperBlock(superblock),
                         "Failed to load data from superblock protobuf");
+  {
+    MutexLock l_flush(flush_lock_);
+    // The first flush rewrites the superblock: it's not known where the
+    // update log, if any, was cut off.
+    checkpoint_id_ = superblock.checkpoint_id();
+  }
   RETURN_NOT_OK(UpdateOnDiskSize());
   state_ = kInitialized;
   return Status::OK();
@@ -364,6 +516,11 @@ Status TabletMetadata::UpdateOnDiskSize() {
   string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
   uint64_t on_disk_size;
   RETURN_NOT_OK(fs_manager()->env()->GetFileSize(path, &on_disk_size));
+  const string log_path = fs_manager_->GetTabletMetadataUpdateLogPath(tablet_id_);
+  uint64_t log_size;
+  if (fs_manager()->env()->GetFileSize(log_path, &log_size).ok()) {
+    on_disk_size += log_size;
+  }
   on_disk_size_.store(on_disk_size, memory_order_relaxed);
   return Status::OK();
 }
@@ -630,7 +787,13 @@ Status TabletMetadata::Flush() {
     anchors_needing_flush = std::move(anchors_needing_flush_);
   }
   pre_flush_callback_();
-  RETURN_NOT_OK(ReplaceSuperBlockUnlocked(pb));
+  bool appended = false;
+  if (FLAGS_tablet_metadata_update_log) {
+    RETURN_NOT_OK(AppendUpdateUnlocked(&pb, &appended));
+  }
+  if (!appended) {
+    RETURN_NOT_OK(ReplaceSuperBlockUnlocked(&pb));
+  }
   TRACE("Metadata flushed");
   l_flush.Unlock();
 
@@ -686,7 +849,8 @@ Status TabletMetadata::UpdateUnlocked(
 Status TabletMetadata::ReplaceSuperBlock(const TabletSuperBlockPB &pb) {
   {
     MutexLock l(flush_lock_);
-    RETURN_NOT_OK_PREPEND(ReplaceSuperBlockUnlocked(pb), "Unable to replace superblock");
+    TabletSuperBlockPB to_write(pb);
+    RETURN_NOT_OK_PREPEND(ReplaceSuperBlockUnlocked(&to_write), "Unable to replace superblock");
     fs_manager_->dd_manager()->DeleteDataDirGroup(tablet_id_);
   }
 
@@ -696,21 +860,111 @@ Status TabletMetadata::ReplaceSuperBlock(const TabletSuperBlockPB &pb) {
   return Status::OK();
 }
 
-Status TabletMetadata::ReplaceSuperBlockUnlocked(const TabletSuperBlockPB &pb) {
+Status TabletMetadata::ReplaceSuperBlockUnlocked(TabletSuperBlockPB* pb) {
   flush_lock_.AssertAcquired();
 
+  // The records of the update log on disk, if any, don't apply to the new
+  // superblock, which is told apart by its checkpoint id.
+  update_log_.reset();
+  flushed_rowsets_.clear();
+  flushed_static_fields_.clear();
+  pb->set_checkpoint_id(std::max(checkpoint_id_, pb->checkpoint_id()) + 1);
+
   string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
   RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(
-                            fs_manager_->env(), path, pb,
+                            fs_manager_->env(), path, *pb,
                             pb_util::OVERWRITE, pb_util::SYNC,
                             pb_util::SENSITIVE),
                         Substitute("Failed to write tablet metadata $0", tablet_id_));
+  checkpoint_id_ = pb->checkpoint_id();
+  // The superblock is durable, so failing to replace the update log only
+  // means that the next flush rewrites the superblock again.
+  WARN_NOT_OK(ResetUpdateLogUnlocked(pb), Substitute(
+      "$0Could not replace the metadata update log", LogPrefix()));
   flush_count_for_tests_++;
   RETURN_NOT_OK(UpdateOnDiskSize());
 
   return Status::OK();
 }
 
+Status TabletMetadata::ResetUpdateLogUnlocked(TabletSuperBlockPB* pb) {
+  flush_lock_.AssertAcquired();
+  Env* env = fs_manager_->env();
+  const string path = fs_manager_->GetTabletMetadataUpdateLogPath(tablet_id_);
+  if (!FLAGS_tablet_metadata_update_log) {
+    if (env->FileExists(path)) {
+      RETURN_NOT_OK(env->DeleteFile(path));
+    }
+    return Status::OK();
+  }
+
+  RWFileOptions opts;
+  opts.mode = Env::CREATE_OR_OPEN_WITH_TRUNCATE;
+  opts.is_sensitive = true;
+  unique_ptr<RWFile> file;
+  RETURN_NOT_OK(env->NewRWFile(opts, path, &file));
+  unique_ptr<WritablePBContainerFile> log(new WritablePBContainerFile(std::move(file)));
+  RETURN_NOT_OK(log->CreateNew(TabletMetadataUpdatePB()));
+  RETURN_NOT_OK(log->Sync());
+  RETURN_NOT_OK(env->SyncDir(fs_manager_->GetTabletMetadataDir()));
+
+  for (const auto& rs : pb->rowsets()) {
+    flushed_rowsets_.emplace(rs.id(), SerializeDeterministically(rs));
+  }
+  flushed_static_fields_ = SerializeStaticFields(pb);
+  checkpoint_size_ = log->Offset() + pb->ByteSizeLong();
+  update_log_ = std::move(log);
+  return Status::OK();
+}
+
+Status TabletMetadata::AppendUpdateUnlocked(TabletSuperBlockPB* pb, bool* appended) {
+  flush_lock_.AssertAcquired();
+  *appended = false;
+  if (!update_log_ || SerializeStaticFields(pb) != flushed_static_fields_) {
+    return Status::OK();
+  }
+
+  TabletMetadataUpdatePB update;
+  update.set_checkpoint_id(checkpoint_id_);
+  update.set_last_durable_mrs_id(pb->last_durable_mrs_id());
+  *update.mutable_orphaned_blocks() = pb->orphaned_blocks();
+  unordered_map<int64_t, string> rowsets;
+  for (const auto& rs : pb->rowsets()) {
+    string serialized = SerializeDeterministically(rs);
+    const string* flushed = FindOrNull(flushed_rowsets_, rs.id());
+    if (!flushed || *flushed != serialized) {
+      *update.add_upserted_rowsets() = rs;
+    }
+    rowsets.emplace(rs.id(), std::move(serialized));
+  }
+  for (const auto& e : flushed_rowsets_) {
+    if (!ContainsKey(rowsets, e.first)) {
+      update.add_removed_rowset_ids(e.first);
+    }
+  }
+  // Once the records of the log are larger than the superblock itself, it's
+  // time to rewrite the superblock.
+  if (update_log_->Offset() + update.ByteSizeLong() > checkpoint_size_) {
+    return Status::OK();
+  }
+
+  Status s = update_log_->Append(update);
+  if (s.ok()) {
+    s = update_log_->Sync();
+  }
+  if (!s.ok()) {
+    // The log may end with a partial record, so it's not appended to again.
+    update_log_.reset();
+    return s.CloneAndPrepend(Substitute("Failed to append to the metadata update log $0",
+                                        fs_manager_->GetTabletMetadataUpdateLogPath(tablet_id_)));
+  }
+  flushed_rowsets_ = std::move(rowsets);
+  *appended = true;
+  flush_count_for_tests_++;
+  RETURN_NOT_OK(UpdateOnDiskSize());
+  return Status::OK();
+}
+
 void TabletMetadata::SetPreFlushCallback(StatusClosure callback) {
   MutexLock l_flush(flush_lock_);
   pre_flush_callback_ = std::move(callback);
@@ -722,10 +976,21 @@ boost::optional<consensus::OpId> TabletMetadata::tombstone_last_logged_opid() co
 }
 
 Status TabletMetadata::ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const {
-  string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
+  // Don't read the superblock and its update log while they're replaced.
+  MutexLock l_flush(flush_lock_);
+  return ReadSuperBlockFromDisk(fs_manager_, tablet_id_, superblock);
+}
+
+Status TabletMetadata::ReadSuperBlockFromDisk(FsManager* fs_manager,
+                                              const string& tablet_id,
+                                              TabletSuperBlockPB* superblock) {
+  string path = fs_manager->GetTabletMetadataPath(tablet_id);
   RETURN_NOT_OK_PREPEND(
-      pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, superblock, pb_util::SENSITIVE),
+      pb_util::ReadPBContainerFromPath(fs_manager->env(), path, superblock, pb_util::SENSITIVE),
       Substitute("Could not load tablet metadata from $0", path));
+  RETURN_NOT_OK(ApplyUpdateLog(fs_manager->env(),
+                               fs_manager->GetTabletMetadataUpdateLogPath(tablet_id),
+                               superblock));
   return Status::OK();
 }
 
@@ -997,6 +1262,41 @@ boost::optional<TableExtraConfigPB> TabletMetadata::extra_config() const {
   return extra_config_;
 }
 
+bool TabletMetadata::GetTtlCutoff(const Schema& schema, int64_t now_micros,
+                                  int* ttl_col_idx, int64_t* cutoff_micros) const {
+  const auto config = extra_config();
+  if (!config || !config->has_ttl_column() || !config->has_ttl_sec()) {
+    return false;
+  }
+  const int col_idx = schema.find_column(config->ttl_column());
+  if (col_idx == Schema::kColumnNotFound) {
+    return false;
+  }
+  const ColumnSchema& col = schema.column(col_idx);
+  if (col.type_info()->type() != UNIXTIME_MICROS || col.is_nullable()) {
+    return false;
+  }
+  *ttl_col_idx = col_idx;
+  *cutoff_micros = now_micros - static_cast<int64_t>(config->ttl_sec()) * 1000000;
+  return true;
+}
+
+bool TabletMetadata::GetClustering(const Schema& schema, int* col_idx,
+                                   int* num_clusters) const {
+  const auto config = extra_config();
+  if (!config || !config->has_clustering_column() || !config->has_clustering_buckets() ||
+      config->clustering_buckets() <= 1) {
+    return false;
+  }
+  const int idx = schema.find_column(config->clustering_column());
+  if (idx == Schema::kColumnNotFound) {
+    return false;
+  }
+  *col_idx = idx;
+  *num_clusters = config->clustering_buckets();
+  return true;
+}
+
 boost::optional<string> TabletMetadata::dimension_label() const {
   std::lock_guard<LockType> l(data_lock_);
   return dimension_label_;
@@ -55,6 +55,10 @@ namespace log {
 class MinLogIndexAnchorer;
 } // namespace log
 
+namespace pb_util {
+class WritablePBContainerFile;
+} // namespace pb_util
+
 namespace tablet {
 
 class RowSetMetadata;
@@ -306,12 +310,33 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Returns the table's extra configuration properties.
   boost::optional<TableExtraConfigPB> extra_config() const;
 
+  // If the table has a TTL (see TableExtraConfigPB), sets '*ttl_col_idx' to the
+  // index of its TTL column in 'schema' and '*cutoff_micros' to the time before
+  // which the values of the TTL column are expired as of 'now_micros', and
+  // returns true. Returns false if the table has no TTL, or if 'schema' has no
+  // suitable TTL column.
+  bool GetTtlCutoff(const Schema& schema, int64_t now_micros,
+                    int* ttl_col_idx, int64_t* cutoff_micros) const;
+
+  // If the table's rows are clustered (see TableExtraConfigPB), sets
+  // '*col_idx' to the index of its clustering column in 'schema' and
+  // '*num_clusters' to the number of clusters, and returns true. Returns false
+  // if the rows aren't clustered, or if 'schema' has no clustering column.
+  bool GetClustering(const Schema& schema, int* col_idx, int* num_clusters) const;
+
   // Returns the table's dimension label.
   boost::optional<std::string> dimension_label() const;
 
   // Loads the currently-flushed superblock from disk into the given protobuf.
   Status ReadSuperBlockFromDisk(TabletSuperBlockPB* superblock) const;
 
+  // Loads the flushed superblock of tablet 'tablet_id' from disk into the
+  // given protobuf, applying its metadata update log, if any. The metadata
+  // must not be flushed concurrently.
+  static Status ReadSuperBlockFromDisk(FsManager* fs_manager,
+                                       const std::string& tablet_id,
+                                       TabletSuperBlockPB* superblock);
+
   // Sets *super_block to the serialized form of the current metadata.
   Status ToSuperBlock(TabletSuperBlockPB* super_block) const;
 
@@ -383,9 +408,20 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // Updates the cached on-disk size of the tablet superblock.
   Status UpdateOnDiskSize();
 
-  // Fully replace superblock.
+  // Fully replace superblock, setting its new checkpoint id in 'pb', and
+  // start a new update log for it.
   // Requires 'flush_lock_'.
-  Status ReplaceSuperBlockUnlocked(const TabletSuperBlockPB& pb);
+  Status ReplaceSuperBlockUnlocked(TabletSuperBlockPB* pb);
+
+  // Replaces the update log with an empty one for the just written superblock
+  // 'pb', or deletes it if --tablet_metadata_update_log is disabled.
+  // Requires 'flush_lock_'.
+  Status ResetUpdateLogUnlocked(TabletSuperBlockPB* pb);
+
+  // Appends the changes of 'pb' since the last flush to the update log,
+  // setting 'appended' to false if the superblock must be rewritten instead.
+  // Requires 'flush_lock_'.
+  Status AppendUpdateUnlocked(TabletSuperBlockPB* pb, bool* appended);
 
   // Requires 'data_lock_'.
   Status UpdateUnlocked(const RowSetMetadataIds& to_remove,
@@ -489,6 +525,21 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // call to Flush() or LoadFromDisk().
   std::atomic<int64_t> on_disk_size_;
 
+  // The checkpoint id of the superblock on disk. Protected by 'flush_lock_'.
+  int64_t checkpoint_id_;
+
+  // The update log of the superblock on disk, or null if the next flush
+  // must rewrite the superblock. The members below describe the state of the
+  // metadata as of the last flush, and are only set along with the log.
+  // Protected by 'flush_lock_'.
+  std::unique_ptr<pb_util::WritablePBContainerFile> update_log_;
+  // The serialized fields of the superblock which the log can't update.
+  std::string flushed_static_fields_;
+  // The serialized rowsets, by id.
+  std::unordered_map<int64_t, std::string> flushed_rowsets_;
+  // The size of the superblock on disk plus that of the header of the log.
+  uint64_t checkpoint_size_;
+
   // The tablet supports live row counting if true.
   bool supports_live_row_count_;
 
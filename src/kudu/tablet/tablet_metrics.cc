@@ -53,6 +53,10 @@ METRIC_DEFINE_counter(tablet, rows_deleted, "Rows Deleted",
     kudu::MetricUnit::kRows,
     "Number of row delete operations performed on this tablet since service start",
     kudu::MetricLevel::kInfo);
+METRIC_DEFINE_counter(tablet, ranges_deleted, "Ranges Deleted",
+    kudu::MetricUnit::kOperations,
+    "Number of range delete operations performed on this tablet since service start",
+    kudu::MetricLevel::kInfo);
 METRIC_DEFINE_counter(tablet, delete_ignore_errors, "Delete Ignore Errors",
                       kudu::MetricUnit::kRows,
                       "Number of delete ignore operations for this tablet which were "
@@ -134,6 +138,28 @@ METRIC_DEFINE_counter(tablet, scans_started, "Scans Started",
                       kudu::MetricUnit::kScanners,
                       "Number of scanners which have been started on this tablet",
                       kudu::MetricLevel::kDebug);
+METRIC_DEFINE_counter(tablet, row_cache_hits, "Row Cache Hits",
+                      kudu::MetricUnit::kRows,
+                      "Number of rows of point lookups found in the tablet's row cache. "
+                      "See --tablet_row_cache_capacity_mb.",
+                      kudu::MetricLevel::kDebug);
+METRIC_DEFINE_counter(tablet, row_cache_misses, "Row Cache Misses",
+                      kudu::MetricUnit::kRows,
+                      "Number of keys of point lookups not found in the tablet's row "
+                      "cache. See --tablet_row_cache_capacity_mb.",
+                      kudu::MetricLevel::kDebug);
+METRIC_DEFINE_counter(tablet, diff_scan_rowsets_skipped, "Diff Scan Rowsets Skipped",
+                      kudu::MetricUnit::kUnits,
+                      "Number of disk rowsets skipped by diff scans because they had "
+                      "no changes between the scans' start and end timestamps. See "
+                      "--tablet_diff_scan_skip_unchanged_rowsets.",
+                      kudu::MetricLevel::kDebug);
+METRIC_DEFINE_counter(tablet, scans_aborted_past_deadline,
+                      "Scans Aborted Past Client Deadline",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan requests aborted while reading data because the "
+                      "client's deadline passed. The data read for them was wasted.",
+                      kudu::MetricLevel::kInfo);
 METRIC_DEFINE_gauge_size(tablet, tablet_active_scanners, "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active on this tablet",
@@ -174,6 +200,13 @@ METRIC_DEFINE_counter(tablet, deleted_rowset_gc_bytes_deleted,
                       "Number of bytes deleted by garbage-collecting deleted rowsets.",
                       kudu::MetricLevel::kDebug);
 
+METRIC_DEFINE_counter(tablet, expired_rowset_gc_bytes_deleted,
+                      "Expired Rowsets GC Bytes Deleted",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes deleted by garbage-collecting rowsets whose rows "
+                      "have all outlived the table's TTL.",
+                      kudu::MetricLevel::kDebug);
+
 METRIC_DEFINE_histogram(tablet, bloom_lookups_per_op, "Bloom Lookups per Operation",
                         kudu::MetricUnit::kProbes,
                         "Tracks the number of bloom filter lookups performed by each "
@@ -215,6 +248,40 @@ METRIC_DEFINE_histogram(tablet, write_op_duration_commit_wait_consistency,
   kudu::MetricLevel::kDebug,
   60000000LU, 2);
 
+METRIC_DEFINE_histogram(tablet, write_op_lock_wait_time,
+  "Write Op Lock Wait Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to this tablet spent acquiring their partition and row locks "
+  "while being prepared. High values indicate contention between writes to the "
+  "same rows.",
+  kudu::MetricLevel::kDebug,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_replication_time,
+  "Write Op Replication Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time between the start of the replication of writes to this tablet and their "
+  "majority-replication, including writing them to the local WAL. High values "
+  "indicate slow peers or network, or a slow WAL.",
+  kudu::MetricLevel::kDebug,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_apply_queue_time,
+  "Write Op Apply Queue Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to this tablet spent waiting in the apply queue after being "
+  "prepared and replicated.",
+  kudu::MetricLevel::kDebug,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(tablet, write_op_apply_run_time,
+  "Write Op Apply Run Time",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to this tablet spent being applied, including waiting for "
+  "COMMIT_WAIT external consistency.",
+  kudu::MetricLevel::kDebug,
+  60000000LU, 2);
+
 METRIC_DEFINE_histogram(tablet, commit_wait_duration,
   "Commit-Wait Duration",
   kudu::MetricUnit::kMicroseconds,
@@ -284,6 +351,19 @@ METRIC_DEFINE_gauge_int64(tablet, deleted_rowset_estimated_retained_bytes,
   "Estimated bytes of deletable data in deleted rowsets for this tablet.",
   kudu::MetricLevel::kDebug);
 
+METRIC_DEFINE_gauge_uint32(tablet, expired_rowset_gc_running,
+  "Expired Rowset GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of expired rowset GC operations currently running.",
+  kudu::MetricLevel::kDebug);
+
+METRIC_DEFINE_gauge_int64(tablet, expired_rowset_estimated_retained_bytes,
+  "Estimated Deletable Bytes Retained in Expired Rowsets",
+  kudu::MetricUnit::kBytes,
+  "Estimated bytes of deletable data in rowsets whose rows have all outlived "
+  "the table's TTL, for this tablet.",
+  kudu::MetricLevel::kDebug);
+
 METRIC_DEFINE_histogram(tablet, flush_dms_duration,
   "DeltaMemStore Flush Duration",
   kudu::MetricUnit::kMilliseconds,
@@ -347,12 +427,34 @@ METRIC_DEFINE_histogram(tablet, deleted_rowset_gc_duration,
   kudu::MetricLevel::kInfo,
   60000LU, 1);
 
+METRIC_DEFINE_histogram(tablet, expired_rowset_gc_duration,
+  "Expired Rowset GC Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent running the maintenance operation to GC expired rowsets.",
+  kudu::MetricLevel::kInfo,
+  60000LU, 1);
+
 METRIC_DEFINE_counter(tablet, leader_memory_pressure_rejections,
   "Leader Memory Pressure Rejections",
   kudu::MetricUnit::kRequests,
   "Number of RPC requests rejected due to memory pressure while LEADER.",
   kudu::MetricLevel::kWarn);
 
+METRIC_DEFINE_counter(tablet, ops_aborted_past_deadline,
+  "Ops Aborted Past Client Deadline",
+  kudu::MetricUnit::kOperations,
+  "Number of operations aborted before being prepared because the deadline "
+  "of the client that submitted them had passed.",
+  kudu::MetricLevel::kInfo);
+
+METRIC_DEFINE_counter(tablet, ops_applied_past_deadline,
+  "Ops Applied Past Client Deadline",
+  kudu::MetricUnit::kOperations,
+  "Number of operations applied after the deadline of the client that "
+  "submitted them had passed. Replicated operations can't be aborted, so "
+  "this counts work whose result the client no longer waited for.",
+  kudu::MetricLevel::kInfo);
+
 METRIC_DEFINE_gauge_double(tablet, average_diskrowset_height, "Average DiskRowSet Height",
                            kudu::MetricUnit::kUnits,
                            "Average height of the diskrowsets in this tablet "
@@ -361,6 +463,38 @@ METRIC_DEFINE_gauge_double(tablet, average_diskrowset_height, "Average DiskRowSe
                            kudu::MetricLevel::kInfo);
 METRIC_DECLARE_gauge_size(merged_entities_count_of_tablet);
 
+METRIC_DEFINE_histogram(server, server_write_op_lock_wait_time,
+  "Write Op Lock Wait Time (Server)",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to the tablets of this server spent acquiring their "
+  "partition and row locks while being prepared.",
+  kudu::MetricLevel::kInfo,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, server_write_op_replication_time,
+  "Write Op Replication Time (Server)",
+  kudu::MetricUnit::kMicroseconds,
+  "Time between the start of the replication of writes to the tablets of this "
+  "server and their majority-replication, including writing them to the local WAL.",
+  kudu::MetricLevel::kInfo,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, server_write_op_apply_queue_time,
+  "Write Op Apply Queue Time (Server)",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to the tablets of this server spent waiting in the apply "
+  "queue after being prepared and replicated.",
+  kudu::MetricLevel::kInfo,
+  60000000LU, 2);
+
+METRIC_DEFINE_histogram(server, server_write_op_apply_run_time,
+  "Write Op Apply Run Time (Server)",
+  kudu::MetricUnit::kMicroseconds,
+  "Time that writes to the tablets of this server spent being applied, "
+  "including waiting for COMMIT_WAIT external consistency.",
+  kudu::MetricLevel::kInfo,
+  60000000LU, 2);
+
 namespace kudu {
 namespace tablet {
 
@@ -373,6 +507,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(rows_upserted),
     MINIT(rows_updated),
     MINIT(rows_deleted),
+    MINIT(ranges_deleted),
     MINIT(insert_ignore_errors),
     MINIT(update_ignore_errors),
     MINIT(delete_ignore_errors),
@@ -386,6 +521,10 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(scanner_bytes_scanned_from_disk),
     MINIT(scanner_predicates_disabled),
     MINIT(scans_started),
+    MINIT(scans_aborted_past_deadline),
+    MINIT(row_cache_hits),
+    MINIT(row_cache_misses),
+    MINIT(diff_scan_rowsets_skipped),
     GINIT(tablet_active_scanners),
     MINIT(bloom_lookups),
     MINIT(key_file_lookups),
@@ -393,6 +532,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
     MINIT(deleted_rowset_gc_bytes_deleted),
+    MINIT(expired_rowset_gc_bytes_deleted),
     MINIT(undo_delta_block_gc_bytes_deleted),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
@@ -401,11 +541,17 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(snapshot_read_inflight_wait_duration),
     MINIT(write_op_duration_client_propagated_consistency),
     MINIT(write_op_duration_commit_wait_consistency),
+    MINIT(write_op_lock_wait_time),
+    MINIT(write_op_replication_time),
+    MINIT(write_op_apply_queue_time),
+    MINIT(write_op_apply_run_time),
     GINIT(flush_dms_running),
     GINIT(flush_mrs_running),
     GINIT(compact_rs_running),
     GINIT(deleted_rowset_estimated_retained_bytes),
     GINIT(deleted_rowset_gc_running),
+    GINIT(expired_rowset_estimated_retained_bytes),
+    GINIT(expired_rowset_gc_running),
     GINIT(delta_minor_compact_rs_running),
     GINIT(delta_major_compact_rs_running),
     GINIT(undo_delta_block_gc_running),
@@ -414,12 +560,15 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(flush_mrs_duration),
     MINIT(compact_rs_duration),
     MINIT(deleted_rowset_gc_duration),
+    MINIT(expired_rowset_gc_duration),
     MINIT(delta_minor_compact_rs_duration),
     MINIT(delta_major_compact_rs_duration),
     MINIT(undo_delta_block_gc_init_duration),
     MINIT(undo_delta_block_gc_delete_duration),
     MINIT(undo_delta_block_gc_perform_duration),
     MINIT(leader_memory_pressure_rejections),
+    MINIT(ops_aborted_past_deadline),
+    MINIT(ops_applied_past_deadline),
     MEANINIT(average_diskrowset_height),
     HIDEINIT(merged_entities_count_of_tablet, 1) {
 }
@@ -428,6 +577,13 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
 #undef MEANINIT
 #undef HIDEINIT
 
+ServerWriteOpMetrics::ServerWriteOpMetrics(const scoped_refptr<MetricEntity>& server_entity)
+  : lock_wait_time(METRIC_server_write_op_lock_wait_time.Instantiate(server_entity)),
+    replication_time(METRIC_server_write_op_replication_time.Instantiate(server_entity)),
+    apply_queue_time(METRIC_server_write_op_apply_queue_time.Instantiate(server_entity)),
+    apply_run_time(METRIC_server_write_op_apply_run_time.Instantiate(server_entity)) {
+}
+
 void TabletMetrics::AddProbeStats(const ProbeStats* stats_array, int len,
                                   Arena* work_arena) {
   // In most cases, different operations within a batch will have the same
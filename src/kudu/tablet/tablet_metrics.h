@@ -48,6 +48,7 @@ struct TabletMetrics {
   scoped_refptr<Counter> rows_upserted;
   scoped_refptr<Counter> rows_updated;
   scoped_refptr<Counter> rows_deleted;
+  scoped_refptr<Counter> ranges_deleted;
   scoped_refptr<Counter> insert_ignore_errors;
   scoped_refptr<Counter> update_ignore_errors;
   scoped_refptr<Counter> delete_ignore_errors;
@@ -63,6 +64,10 @@ struct TabletMetrics {
   scoped_refptr<Counter> scanner_bytes_scanned_from_disk;
   scoped_refptr<Counter> scanner_predicates_disabled;
   scoped_refptr<Counter> scans_started;
+  scoped_refptr<Counter> scans_aborted_past_deadline;
+  scoped_refptr<Counter> row_cache_hits;
+  scoped_refptr<Counter> row_cache_misses;
+  scoped_refptr<Counter> diff_scan_rowsets_skipped;
   scoped_refptr<AtomicGauge<size_t>> tablet_active_scanners;
 
   // Probe stats.
@@ -74,6 +79,7 @@ struct TabletMetrics {
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
   scoped_refptr<Counter> deleted_rowset_gc_bytes_deleted;
+  scoped_refptr<Counter> expired_rowset_gc_bytes_deleted;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
@@ -84,12 +90,18 @@ struct TabletMetrics {
   scoped_refptr<Histogram> snapshot_read_inflight_wait_duration;
   scoped_refptr<Histogram> write_op_duration_client_propagated_consistency;
   scoped_refptr<Histogram> write_op_duration_commit_wait_consistency;
+  scoped_refptr<Histogram> write_op_lock_wait_time;
+  scoped_refptr<Histogram> write_op_replication_time;
+  scoped_refptr<Histogram> write_op_apply_queue_time;
+  scoped_refptr<Histogram> write_op_apply_run_time;
 
   scoped_refptr<AtomicGauge<uint32_t> > flush_dms_running;
   scoped_refptr<AtomicGauge<uint32_t> > flush_mrs_running;
   scoped_refptr<AtomicGauge<uint32_t> > compact_rs_running;
   scoped_refptr<AtomicGauge<int64_t> > deleted_rowset_estimated_retained_bytes;
   scoped_refptr<AtomicGauge<uint32_t> > deleted_rowset_gc_running;
+  scoped_refptr<AtomicGauge<int64_t> > expired_rowset_estimated_retained_bytes;
+  scoped_refptr<AtomicGauge<uint32_t> > expired_rowset_gc_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_minor_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_major_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > undo_delta_block_gc_running;
@@ -99,6 +111,7 @@ struct TabletMetrics {
   scoped_refptr<Histogram> flush_mrs_duration;
   scoped_refptr<Histogram> compact_rs_duration;
   scoped_refptr<Histogram> deleted_rowset_gc_duration;
+  scoped_refptr<Histogram> expired_rowset_gc_duration;
   scoped_refptr<Histogram> delta_minor_compact_rs_duration;
   scoped_refptr<Histogram> delta_major_compact_rs_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_init_duration;
@@ -106,6 +119,8 @@ struct TabletMetrics {
   scoped_refptr<Histogram> undo_delta_block_gc_perform_duration;
 
   scoped_refptr<Counter> leader_memory_pressure_rejections;
+  scoped_refptr<Counter> ops_aborted_past_deadline;
+  scoped_refptr<Counter> ops_applied_past_deadline;
 
   // Compaction metrics.
   scoped_refptr<MeanGauge> average_diskrowset_height;
@@ -114,6 +129,17 @@ struct TabletMetrics {
   scoped_refptr<AtomicGauge<size_t>> merged_entities_count_of_tablet;
 };
 
+// Server-wide counterparts of the write op phase histograms of TabletMetrics,
+// aggregated across all of the tablet replicas hosted by a server.
+struct ServerWriteOpMetrics {
+  explicit ServerWriteOpMetrics(const scoped_refptr<MetricEntity>& server_entity);
+
+  scoped_refptr<Histogram> lock_wait_time;
+  scoped_refptr<Histogram> replication_time;
+  scoped_refptr<Histogram> apply_queue_time;
+  scoped_refptr<Histogram> apply_run_time;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif /* KUDU_TABLET_TABLET_METRICS_H */
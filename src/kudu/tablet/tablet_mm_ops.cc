@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_mm_ops.h"
 
+#include <memory>
 #include <mutex>
 #include <ostream>
 #include <utility>
@@ -26,6 +27,9 @@
 #include <glog/logging.h>
 
 #include "kudu/common/common.pb.h"
+#include "kudu/fs/data_dirs.h"
+#include "kudu/fs/fs.pb.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset.h"
@@ -33,6 +37,7 @@
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/hash_util.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
@@ -83,6 +88,13 @@ DEFINE_bool(enable_deleted_rowset_gc, true,
     "considered ancient history (see --tablet_history_max_age_sec) are deleted.");
 TAG_FLAG(enable_deleted_rowset_gc, runtime);
 
+DEFINE_bool(enable_expired_rowset_gc, true,
+    "Whether to enable garbage collection of rowsets whose rows have all expired "
+    "according to the TTL of their table (see the 'kudu.table.ttl_sec' table "
+    "property). If disabled, the expired rows are still hidden from scans, but "
+    "are only removed from disk by compactions.");
+TAG_FLAG(enable_expired_rowset_gc, runtime);
+
 DEFINE_bool(enable_workload_score_for_perf_improvement_ops, false,
             "Whether to enable prioritization of maintenance operations based on "
             "whether there are on-going workloads, favoring ops of 'hot' tablets.");
@@ -117,6 +129,23 @@ bool TabletOpBase::DisableCompaction() const {
   return tablet_->disable_compaction();
 }
 
+int64_t TabletOpBase::DiskKey() const {
+  const FsManager* fs_manager = tablet_->metadata()->fs_manager();
+  if (!fs_manager || !fs_manager->dd_manager()) {
+    return 0;
+  }
+  DataDirGroupPB group;
+  if (!fs_manager->dd_manager()->GetDataDirGroupPB(tablet_->tablet_id(), &group).ok()) {
+    return 0;
+  }
+  uint64_t key = 0;
+  for (const auto& uuid : group.uuids()) {
+    key = HashUtil::FastHash64(uuid.data(), uuid.size(), key);
+  }
+  // 0 is reserved for ops with unknown disks.
+  return key == 0 ? 1 : static_cast<int64_t>(key);
+}
+
 ////////////////////////////////////////////////////////////
 // CompactRowSetsOp
 ////////////////////////////////////////////////////////////
@@ -160,6 +189,7 @@ void CompactRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
   }
 
   tablet_->UpdateCompactionStats(&prev_stats_);
+  prev_stats_.set_disk_key(DiskKey());
   prev_stats_.set_workload_score(workload_score);
   *stats = prev_stats_;
 }
@@ -242,10 +272,15 @@ void MinorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     last_num_rs_minor_delta_compacted_ = new_num_rs_minor_delta_compacted;
   }
 
+  std::shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MINOR_DELTA_COMPACTION, nullptr);
+      RowSet::MINOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
   prev_stats_.set_runnable(perf_improv > 0);
+  // A minor delta compaction rewrites the REDO deltas of the rowset.
+  prev_stats_.set_io_cost_bytes(
+      rs ? rs->OnDiskBaseDataSizeWithRedos() - rs->OnDiskBaseDataSize() : 0);
+  prev_stats_.set_disk_key(DiskKey());
   prev_stats_.set_workload_score(workload_score);
   *stats = prev_stats_;
 }
@@ -330,10 +365,15 @@ void MajorDeltaCompactionOp::UpdateStats(MaintenanceOpStats* stats) {
     last_num_rs_major_delta_compacted_ = new_num_rs_major_delta_compacted;
   }
 
+  std::shared_ptr<RowSet> rs;
   double perf_improv = tablet_->GetPerfImprovementForBestDeltaCompact(
-      RowSet::MAJOR_DELTA_COMPACTION, nullptr);
+      RowSet::MAJOR_DELTA_COMPACTION, &rs);
   prev_stats_.set_perf_improvement(perf_improv);
   prev_stats_.set_runnable(perf_improv > 0);
+  // A major delta compaction reads the REDO deltas and rewrites the base data
+  // they apply to; the whole base data is a good upper bound.
+  prev_stats_.set_io_cost_bytes(rs ? rs->OnDiskBaseDataSizeWithRedos() : 0);
+  prev_stats_.set_disk_key(DiskKey());
   prev_stats_.set_workload_score(workload_score);
   *stats = prev_stats_;
 }
@@ -460,5 +500,46 @@ std::string DeletedRowsetGCOp::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+ExpiredRowsetGCOp::ExpiredRowsetGCOp(Tablet* tablet)
+    : TabletOpBase(Substitute("ExpiredRowSetGCOp($0)", tablet->tablet_id()),
+                   MaintenanceOp::HIGH_IO_USAGE, tablet),
+      running_(false) {
+}
+
+void ExpiredRowsetGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  if (!FLAGS_enable_expired_rowset_gc) {
+    stats->set_runnable(false);
+    return;
+  }
+  if (running_.load()) {
+    VLOG(1) << LogPrefix() << " not updating stats: already running";
+    stats->set_runnable(false);
+    return;
+  }
+  int64_t estimated_retained_bytes = 0;
+  WARN_NOT_OK(tablet_->GetBytesInExpiredRowsets(&estimated_retained_bytes),
+              "Unable to count bytes in expired rowsets");
+  stats->set_data_retained_bytes(estimated_retained_bytes);
+  stats->set_runnable(estimated_retained_bytes > 0);
+}
+
+void ExpiredRowsetGCOp::Perform() {
+  WARN_NOT_OK(tablet_->DeleteExpiredRowsets(),
+      Substitute("$0GC of expired rowsets failed", LogPrefix()));
+  running_.store(false);
+}
+
+scoped_refptr<Histogram> ExpiredRowsetGCOp::DurationHistogram() const {
+  return tablet_->metrics()->expired_rowset_gc_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> ExpiredRowsetGCOp::RunningGauge() const {
+  return tablet_->metrics()->expired_rowset_gc_running;
+}
+
+std::string ExpiredRowsetGCOp::LogPrefix() const {
+  return tablet_->LogPrefix();
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -44,6 +44,10 @@ class TabletOpBase : public MaintenanceOp {
   // otherwise return true.
   bool DisableCompaction() const;
 
+  // Returns a key identifying the tablet's data directory group, suitable for
+  // MaintenanceOpStats::set_disk_key(), or 0 if the group is unknown.
+  int64_t DiskKey() const;
+
  protected:
   int32_t priority() const override;
 
@@ -195,6 +199,37 @@ class DeletedRowsetGCOp : public TabletOpBase {
   DISALLOW_COPY_AND_ASSIGN(DeletedRowsetGCOp);
 };
 
+// MaintenanceOp to garbage-collect entire rowsets whose rows have all expired
+// according to the TTL of the table.
+class ExpiredRowsetGCOp : public TabletOpBase {
+ public:
+  explicit ExpiredRowsetGCOp(Tablet* tablet);
+
+  // Estimate the number of bytes from rowsets whose rows have all expired.
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  // If this op is already running, we shouldn't run it again.
+  bool Prepare() override {
+    bool false_ref = false;
+    return running_.compare_exchange_strong(false_ref, true);
+  }
+
+  // Deletes expired rowsets from disk.
+  void Perform() override;
+
+  // Metrics for this op.
+  scoped_refptr<Histogram> DurationHistogram() const override;
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+ private:
+  std::string LogPrefix() const;
+
+  // Used to ensure only a single instance of this op is scheduled per tablet
+  // at a time.
+  std::atomic<bool> running_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExpiredRowsetGCOp);
+};
+
 } // namespace tablet
 } // namespace kudu
 
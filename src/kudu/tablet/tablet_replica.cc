@@ -18,6 +18,8 @@
 #include "kudu/tablet/tablet_replica.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -59,6 +61,7 @@
 #include "kudu/tablet/ops/participant_op.h"
 #include "kudu/tablet/ops/write_op.h"
 #include "kudu/tablet/tablet.pb.h"
+#include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica_mm_ops.h"
 #include "kudu/tablet/txn_coordinator.h"
 #include "kudu/tserver/tserver.pb.h"
@@ -71,6 +74,7 @@
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/status_callback.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
@@ -82,6 +86,20 @@ DEFINE_uint32(tablet_max_pending_txn_write_ops, 2,
 TAG_FLAG(tablet_max_pending_txn_write_ops, experimental);
 TAG_FLAG(tablet_max_pending_txn_write_ops, runtime);
 
+DEFINE_bool(report_tablet_workload_rates, false,
+            "Whether the leader replicas of tablets include their write and "
+            "scan rates in the tablet stats reported to the masters, for the "
+            "masters to take the load of the tablets into account.");
+TAG_FLAG(report_tablet_workload_rates, experimental);
+TAG_FLAG(report_tablet_workload_rates, runtime);
+
+DEFINE_bool(report_tablet_column_statistics, false,
+            "Whether the leader replicas of tablets include the statistics of "
+            "the values of their columns in the tablet stats reported to the "
+            "masters, for the masters to serve them merged per table.");
+TAG_FLAG(report_tablet_column_statistics, experimental);
+TAG_FLAG(report_tablet_column_statistics, runtime);
+
 METRIC_DEFINE_histogram(tablet, op_prepare_queue_length, "Operation Prepare Queue Length",
                         kudu::MetricUnit::kTasks,
                         "Number of operations waiting to be prepared within this tablet. "
@@ -107,6 +125,13 @@ METRIC_DEFINE_histogram(tablet, op_prepare_run_time, "Operation Prepare Run Time
                         kudu::MetricLevel::kInfo,
                         10000000, 2);
 
+METRIC_DEFINE_gauge_int32(tablet, op_prepare_active_threads, "Operation Prepare Active Threads",
+                          kudu::MetricUnit::kThreads,
+                          "Whether an operation of this tablet is currently being prepared. "
+                          "Operations of a tablet are prepared one at a time, so over time "
+                          "this is the utilization of the tablet's prepare queue.",
+                          kudu::MetricLevel::kInfo);
+
 METRIC_DEFINE_gauge_size(tablet, on_disk_size, "Tablet Size On Disk",
                          kudu::MetricUnit::kBytes,
                          "Space used by this tablet on disk, including metadata.",
@@ -206,6 +231,9 @@ Status TabletReplica::Init(ServerContext server_ctx) {
   SetStatusMessage("Initializing consensus...");
   ConsensusOptions options;
   options.tablet_id = meta_->tablet_id();
+  if (server_ctx.server_metric_entity) {
+    server_write_op_metrics_.reset(new ServerWriteOpMetrics(server_ctx.server_metric_entity));
+  }
   shared_ptr<RaftConsensus> consensus;
   RETURN_NOT_OK(RaftConsensus::Create(std::move(options),
                                       local_peer_pb_,
@@ -252,7 +280,8 @@ Status TabletReplica::Start(
           {
               METRIC_op_prepare_queue_length.Instantiate(metric_entity),
               METRIC_op_prepare_queue_time.Instantiate(metric_entity),
-              METRIC_op_prepare_run_time.Instantiate(metric_entity)
+              METRIC_op_prepare_run_time.Instantiate(metric_entity),
+              METRIC_op_prepare_active_threads.Instantiate(metric_entity, 0)
           });
 
       if (tablet_->metrics() != nullptr) {
@@ -799,6 +828,27 @@ Status TabletReplica::StartFollowerOp(const scoped_refptr<ConsensusRound>& round
 
   consensus::ReplicateMsg* replicate_msg = round->replicate_msg();
   DCHECK(replicate_msg->has_timestamp());
+
+  // A witness only needs the op to be durable in its WAL: once it's committed,
+  // write the matching commit record without applying anything to the tablet.
+  if (consensus_->IsWitness()) {
+    scoped_refptr<log::Log> log = log_;
+    const auto op_type = replicate_msg->op_type();
+    round->SetConsensusReplicatedCallback(
+        [log, op_type, round_raw = round.get()](const Status& s) {
+          if (!s.ok()) {
+            return;
+          }
+          consensus::CommitMsg commit_msg;
+          commit_msg.set_op_type(op_type);
+          *commit_msg.mutable_commited_op_id() = round_raw->id();
+          CHECK_OK(log->AsyncAppendCommit(commit_msg, [](const Status& s) {
+            CrashIfNotOkStatusCB("Enqueued commit operation failed to write to WAL", s);
+          }));
+        });
+    return Status::OK();
+  }
+
   unique_ptr<Op> op;
   switch (replicate_msg->op_type()) {
     case WRITE_OP:
@@ -1038,6 +1088,12 @@ void TabletReplica::UpdateTabletStats(vector<string>* dirty_tablets) {
   if (s.ok()) {
     pb.set_live_row_count(live_row_count);
   }
+  if (FLAGS_report_tablet_workload_rates) {
+    UpdateWorkloadRates(&pb);
+  }
+  if (FLAGS_report_tablet_column_statistics) {
+    UpdateColumnStatistics(&pb);
+  }
 
   // We cannot hold 'lock_' while calling RaftConsensus::role() because
   // it may invoke TabletReplica::StartFollowerOp() and lead to
@@ -1046,7 +1102,10 @@ void TabletReplica::UpdateTabletStats(vector<string>* dirty_tablets) {
 
   std::lock_guard<simple_spinlock> l(lock_);
   if (stats_pb_.on_disk_size() != pb.on_disk_size() ||
-      stats_pb_.live_row_count() != pb.live_row_count()) {
+      stats_pb_.live_row_count() != pb.live_row_count() ||
+      RateChanged(stats_pb_.write_rate(), pb.write_rate()) ||
+      RateChanged(stats_pb_.scan_rate(), pb.scan_rate()) ||
+      !ColumnStatisticsEqual(stats_pb_, pb)) {
     if (consensus::RaftPeerPB_Role_LEADER == role) {
       dirty_tablets->emplace_back(tablet_id());
     }
@@ -1054,6 +1113,71 @@ void TabletReplica::UpdateTabletStats(vector<string>* dirty_tablets) {
   }
 }
 
+void TabletReplica::UpdateWorkloadRates(ReportedTabletStatsPB* pb) {
+  shared_ptr<Tablet> tablet;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    tablet = tablet_;
+  }
+  if (!tablet || !tablet->metrics()) {
+    return;
+  }
+  const TabletMetrics* metrics = tablet->metrics();
+  const int64_t scans_started = metrics->scans_started->value();
+  const int64_t rows_mutated = metrics->rows_inserted->value() +
+                               metrics->rows_upserted->value() +
+                               metrics->rows_updated->value() +
+                               metrics->rows_deleted->value();
+  const MonoTime now = MonoTime::Now();
+  if (last_workload_rates_time_.Initialized()) {
+    const double elapsed_secs = (now - last_workload_rates_time_).ToSeconds();
+    if (elapsed_secs > 0) {
+      pb->set_write_rate(static_cast<double>(rows_mutated - last_rows_mutated_) / elapsed_secs);
+      pb->set_scan_rate(static_cast<double>(scans_started - last_scans_started_) / elapsed_secs);
+    }
+  }
+  last_workload_rates_time_ = now;
+  last_rows_mutated_ = rows_mutated;
+  last_scans_started_ = scans_started;
+}
+
+void TabletReplica::UpdateColumnStatistics(ReportedTabletStatsPB* pb) {
+  shared_ptr<Tablet> tablet;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    tablet = tablet_;
+  }
+  if (!tablet) {
+    return;
+  }
+  vector<ColumnStatisticsPB> col_stats;
+  if (tablet->GetColumnStatistics(&col_stats).ok()) {
+    for (auto& stats : col_stats) {
+      *pb->add_column_stats() = std::move(stats);
+    }
+  }
+}
+
+bool TabletReplica::ColumnStatisticsEqual(const ReportedTabletStatsPB& a,
+                                          const ReportedTabletStatsPB& b) {
+  if (a.column_stats_size() != b.column_stats_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.column_stats_size(); i++) {
+    if (a.column_stats(i).SerializeAsString() != b.column_stats(i).SerializeAsString()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TabletReplica::RateChanged(double old_rate, double new_rate) {
+  // Rates fluctuate all the time: only a change of more than 10% is worth
+  // sending a tablet report for.
+  static constexpr double kChangeRatio = 0.1;
+  return std::abs(new_rate - old_rate) > kChangeRatio * std::max(old_rate, new_rate);
+}
+
 ReportedTabletStatsPB TabletReplica::GetTabletStats() const {
   std::lock_guard<simple_spinlock> l(lock_);
   return stats_pb_;
@@ -45,6 +45,7 @@
 #include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -92,6 +93,7 @@ class AlterSchemaOpState;
 class OpDriver;
 class ParticipantOpState;
 class TabletStatusPB;
+struct ServerWriteOpMetrics;
 class TxnCoordinator;
 class TxnCoordinatorFactory;
 
@@ -220,6 +222,13 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
     return consensus_;
   }
 
+  // Returns whether this is a witness replica, which stores the WAL but never
+  // applies operations to its tablet.
+  bool IsWitness() const {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    return consensus_ && consensus_->IsWitness();
+  }
+
   Tablet* tablet() const {
     std::lock_guard<simple_spinlock> lock(lock_);
     return tablet_.get();
@@ -299,6 +308,12 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
 
   clock::Clock* clock() const { return clock_; }
 
+  // The server-wide histograms of the phases of write ops, or null if the
+  // server context this replica was initialized with had no metric entity.
+  const ServerWriteOpMetrics* server_write_op_metrics() const {
+    return server_write_op_metrics_.get();
+  }
+
   const scoped_refptr<log::LogAnchorRegistry>& log_anchor_registry() const {
     return log_anchor_registry_;
   }
@@ -409,6 +424,21 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // Only for CLI tools and tests.
   TabletReplica();
 
+  // Sets the write and scan rates of 'pb' from the tablet's metrics, if the
+  // rates were last updated long enough ago. Only called from
+  // UpdateTabletStats(), which isn't called concurrently.
+  void UpdateWorkloadRates(ReportedTabletStatsPB* pb);
+
+  // Whether a change of a reported rate from 'old_rate' to 'new_rate' is
+  // worth reporting.
+  static bool RateChanged(double old_rate, double new_rate);
+
+  // Sets the column statistics of 'pb' from those of the tablet's rowsets.
+  void UpdateColumnStatistics(ReportedTabletStatsPB* pb);
+
+  static bool ColumnStatisticsEqual(const ReportedTabletStatsPB& a,
+                                    const ReportedTabletStatsPB& b);
+
   // A class to properly dispatch transactional write operations arriving
   // with TabletServerService::Write() RPC for the specified tablet replica.
   // Before submitting the operations via TabletReplica::SubmitWrite(), it's
@@ -603,6 +633,8 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
 
   clock::Clock* clock_;
 
+  std::unique_ptr<ServerWriteOpMetrics> server_write_op_metrics_;
+
   // List of maintenance operations for the tablet that need information that only the peer
   // can provide.
   std::vector<MaintenanceOp*> maintenance_ops_;
@@ -613,6 +645,12 @@ class TabletReplica : public RefCountedThreadSafe<TabletReplica>,
   // Cached stats for the tablet replica.
   ReportedTabletStatsPB stats_pb_;
 
+  // The tablet's metrics when the workload rates were last updated. Only
+  // used by UpdateWorkloadRates().
+  MonoTime last_workload_rates_time_;
+  int64_t last_rows_mutated_ = 0;
+  int64_t last_scans_started_ = 0;
+
   // NOTE: it's important that this is the first member to be destructed. This
   // ensures we do not attempt to collect metrics while calling the destructor.
   FunctionGaugeDetacher metric_detacher_;
@@ -82,6 +82,16 @@ DEFINE_int32(flush_upper_bound_ms, 60 * 60 * 1000,
 TAG_FLAG(flush_upper_bound_ms, experimental);
 TAG_FLAG(flush_upper_bound_ms, runtime);
 
+DEFINE_int32(flush_committed_txn_memrowsets_threshold, 16,
+             "Number of MemRowSets of committed transactions waiting to be flushed "
+             "above which a MRS flush is prioritized, even if the MemRowSets are small. "
+             "A MRS flush writes the main MRS and the MemRowSets of all committed "
+             "transactions to a single set of rowsets, so this bounds the number of "
+             "MemRowSets each write and scan has to visit under high transaction rates. "
+             "0 disables the prioritization.");
+TAG_FLAG(flush_committed_txn_memrowsets_threshold, experimental);
+TAG_FLAG(flush_committed_txn_memrowsets_threshold, runtime);
+
 DECLARE_bool(enable_workload_score_for_perf_improvement_ops);
 
 METRIC_DEFINE_gauge_uint32(tablet, log_gc_running,
@@ -191,6 +201,15 @@ void FlushMRSOp::UpdateStats(MaintenanceOpStats* stats) {
   FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(
       stats,
       time_since_flush_.elapsed().wall_millis());
+
+  // Like for a large MRS, score a flush by the MemRowSets in excess of the
+  // threshold.
+  const int threshold = FLAGS_flush_committed_txn_memrowsets_threshold;
+  const int num_txn_mrss = tablet_replica_->tablet()->num_committed_txn_memrowsets();
+  if (threshold > 0 && num_txn_mrss > threshold) {
+    stats->set_perf_improvement(std::max(stats->perf_improvement(),
+                                         1.0 + num_txn_mrss - threshold));
+  }
 }
 
 bool FlushMRSOp::Prepare() {
@@ -659,7 +659,9 @@ TEST_F(TxnParticipantTest, TestGetCommittedTxnMetadata) {
   ASSERT_LT(0, pb.commit_mvcc_op_timestamp());
   ASSERT_TRUE(pb.has_commit_timestamp());
   ASSERT_EQ(kDummyCommitTimestamp, pb.commit_timestamp());
-  ASSERT_FALSE(pb.has_flushed_committed_mrs());
+  // Nothing was written in the transaction, so its MRS is dropped rather than
+  // left to be flushed.
+  ASSERT_TRUE(pb.has_flushed_committed_mrs());
 }
 
 // Test that participant ops result in tablet metadata updates that can survive
@@ -1290,6 +1292,23 @@ TEST_F(TxnParticipantTest, TestFlushMultipleMRSs) {
   ASSERT_TRUE(comps->txn_memrowsets.empty());
 }
 
+// Test that committing a transaction which wrote nothing to the tablet doesn't
+// leave an MRS behind, even after restarting.
+TEST_F(TxnParticipantTest, TestCommitEmptyTxnDropsMRS) {
+  Tablet* tablet = tablet_replica_->tablet();
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::BEGIN_TXN,
+                                       kDummyCommitTimestamp));
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::BEGIN_COMMIT,
+                                       kDummyCommitTimestamp));
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::FINALIZE_COMMIT,
+                                       kDummyCommitTimestamp));
+  ASSERT_EQ(0, tablet->num_committed_txn_memrowsets());
+  ASSERT_TRUE(tablet->MemRowSetEmpty());
+
+  ASSERT_OK(RestartReplica(/*reset_tablet*/true));
+  ASSERT_EQ(0, tablet_replica_->tablet()->num_committed_txn_memrowsets());
+}
+
 // Test that INSERT_IGNORE ops work when the row exists in the transactional
 // MRS.
 TEST_F(TxnParticipantTest, TestInsertIgnoreInTransactionMRS) {
@@ -1367,6 +1386,32 @@ TEST_F(TxnParticipantTest, TestLiveRowCountAccountsForTransactionalMRSs) {
   ASSERT_EQ(1, tablet_replica_->CountLiveRowsNoFail());
 }
 
+// Test that the live row counts of tablets with transactional rows aren't used
+// as the row counts of scans, which may not see those rows.
+TEST_F(TxnParticipantTest, TestNoRowCountForScansWithTransactionalMRSs) {
+  Tablet* tablet = tablet_replica_->tablet();
+  ASSERT_OK(Write(0));
+  uint64_t count;
+  ASSERT_OK(tablet->CountLiveRowsForScan(&count));
+  ASSERT_EQ(1, count);
+
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::BEGIN_TXN, -1));
+  ASSERT_OK(Write(1, kTxnId));
+  Status s = tablet->CountLiveRowsForScan(&count);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  // Nor while the rows of the committed transaction aren't flushed.
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::BEGIN_COMMIT, -1));
+  ASSERT_OK(CallParticipantOpCheckResp(kTxnId, ParticipantOpPB::FINALIZE_COMMIT,
+                                       clock()->Now().value()));
+  s = tablet->CountLiveRowsForScan(&count);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  ASSERT_OK(tablet->Flush());
+  ASSERT_OK(tablet->CountLiveRowsForScan(&count));
+  ASSERT_EQ(2, count);
+}
+
 // Test that the MRS size metrics account for transactional MRSs.
 TEST_F(TxnParticipantTest, TestSizeAccountsForTransactionalMRS) {
   // Disable the partition lock as there are concurrent transactions.
@@ -0,0 +1,393 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/cfile_bench.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_materialization_context.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tools/tool_action_common.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/env.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/slice.h"
+
+using kudu::cfile::CFileIterator;
+using kudu::cfile::CFileReader;
+using kudu::cfile::CFileWriter;
+using kudu::cfile::ReaderOptions;
+using kudu::cfile::TypeEncodingInfo;
+using kudu::cfile::WriterOptions;
+using kudu::fs::ReadableBlock;
+using kudu::fs::WritableBlock;
+using kudu::tablet::RowSetMetadata;
+using kudu::tablet::TabletMetadata;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+
+// The number of values read from or written to a CFile at a time, as in the
+// compaction and scan paths of tablets.
+constexpr size_t kBatchSize = 1024;
+
+const CompressionType kCompressions[] = {
+  NO_COMPRESSION, SNAPPY, LZ4, ZLIB
+};
+
+double MBps(int64_t bytes, const MonoDelta& elapsed) {
+  return bytes / 1048576.0 / std::max(elapsed.ToSeconds(), 1e-9);
+}
+
+} // anonymous namespace
+
+struct CFileBench::ColumnData {
+  explicit ColumnData(const TypeInfo* type)
+      : type(type),
+        num_values(0),
+        raw_bytes(0),
+        memory(1024 * 1024) {
+  }
+
+  const TypeInfo* type;
+  int64_t num_values;
+  // The size of the values: the size of the non-null cells, or the length of
+  // the non-null strings.
+  int64_t raw_bytes;
+  std::vector<uint8_t> values;
+  std::vector<uint8_t> non_null_bitmap;
+  // Holds the contents of the string cells.
+  RowBlockMemory memory;
+};
+
+CFileBench::CFileBench(FsManager* source_fs, string scratch_dir, Options opts)
+    : source_fs_(source_fs),
+      scratch_dir_(std::move(scratch_dir)),
+      opts_(std::move(opts)) {
+}
+
+CFileBench::~CFileBench() {
+  scratch_fs_.reset();
+  WARN_NOT_OK(Env::Default()->DeleteRecursively(scratch_dir_),
+              "could not delete the scratch file system");
+}
+
+Status CFileBench::Run(const string& tablet_id) {
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK_PREPEND(TabletMetadata::Load(source_fs_, tablet_id, &meta),
+                        Substitute("could not load tablet metadata for $0", tablet_id));
+
+  // The scratch file system uses the file block manager, so the size of each
+  // re-written CFile is the size of its own file.
+  FsManagerOpts fs_opts(scratch_dir_);
+  fs_opts.block_manager_type = "file";
+  scratch_fs_.reset(new FsManager(Env::Default(), std::move(fs_opts)));
+  RETURN_NOT_OK(scratch_fs_->CreateInitialFileSystemLayout());
+  RETURN_NOT_OK(scratch_fs_->Open());
+
+  const auto schema = meta->schema();
+  for (int i = 0; i < schema->num_columns(); i++) {
+    const ColumnSchema& col = schema->column(i);
+    if (!opts_.columns.empty() &&
+        std::find(opts_.columns.begin(), opts_.columns.end(), col.name()) == opts_.columns.end()) {
+      continue;
+    }
+    current_attrs_.emplace_back(col.name(), col.attributes());
+    ColumnData data(col.type_info());
+    RETURN_NOT_OK(ReadColumn(*meta.get(), col, schema->column_id(i), &data));
+    if (data.num_values == 0) {
+      LOG(INFO) << "column " << col.name() << " has no base data, skipping it";
+      continue;
+    }
+    for (int e = EncodingType_MIN; e <= EncodingType_MAX; e++) {
+      const auto encoding = static_cast<EncodingType>(e);
+      const TypeEncodingInfo* unused;
+      if (!EncodingType_IsValid(e) || encoding == AUTO_ENCODING ||
+          !TypeEncodingInfo::Get(col.type_info(), encoding, &unused).ok()) {
+        continue;
+      }
+      for (const auto compression : kCompressions) {
+        RETURN_NOT_OK_PREPEND(BenchColumn(col, data, encoding, compression),
+                              Substitute("could not benchmark column $0 with $1 and $2",
+                                         col.name(), EncodingType_Name(encoding),
+                                         CompressionType_Name(compression)));
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileBench::ReadColumn(const TabletMetadata& meta, const ColumnSchema& col,
+                              ColumnId col_id, ColumnData* data) {
+  const size_t cell_size = data->type->size();
+  RowBlockMemory batch_mem;
+  vector<uint8_t> batch_values(kBatchSize * cell_size);
+  vector<uint8_t> batch_bitmap(BitmapSize(kBatchSize));
+  ColumnBlock batch(data->type, col.is_nullable() ? batch_bitmap.data() : nullptr,
+                    batch_values.data(), kBatchSize, &batch_mem);
+  SelectionVector sel(kBatchSize);
+
+  for (const shared_ptr<RowSetMetadata>& rs_meta : meta.rowsets()) {
+    const auto blocks = rs_meta->GetColumnBlocksById();
+    const BlockId* block_id = FindOrNull(blocks, col_id);
+    if (!block_id) {
+      // The column was added after the rowset was written.
+      continue;
+    }
+    unique_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(source_fs_->OpenBlock(*block_id, &block));
+    unique_ptr<CFileReader> reader;
+    RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    unique_ptr<CFileIterator> iter;
+    RETURN_NOT_OK(reader->NewIterator(&iter, CFileReader::DONT_CACHE_BLOCK, nullptr));
+    RETURN_NOT_OK(iter->SeekToFirst());
+    while (iter->HasNext() && data->num_values < opts_.max_values_per_column) {
+      size_t n = std::min<int64_t>(kBatchSize,
+                                   opts_.max_values_per_column - data->num_values);
+      ColumnMaterializationContext ctx(0, nullptr, &batch, &sel);
+      ctx.SetDecoderEvalNotSupported();
+      batch_mem.Reset();
+      RETURN_NOT_OK(iter->CopyNextValues(&n, &ctx));
+
+      const size_t offset = data->num_values;
+      data->values.resize((offset + n) * cell_size);
+      if (col.is_nullable()) {
+        data->non_null_bitmap.resize(BitmapSize(offset + n));
+        BitmapCopy(data->non_null_bitmap.data(), offset, batch_bitmap.data(), 0, n);
+      }
+      for (size_t i = 0; i < n; i++) {
+        if (col.is_nullable() && batch.is_null(i)) {
+          continue;
+        }
+        uint8_t* dst = &data->values[(offset + i) * cell_size];
+        if (data->type->physical_type() == BINARY) {
+          // Copy the strings out of the batch's memory, which is reset
+          // between batches.
+          Slice s = *reinterpret_cast<const Slice*>(batch.cell_ptr(i));
+          CHECK(data->memory.arena.RelocateSlice(s, &s));
+          memcpy(dst, &s, sizeof(s));
+          data->raw_bytes += s.size();
+        } else {
+          memcpy(dst, batch.cell_ptr(i), cell_size);
+          data->raw_bytes += cell_size;
+        }
+      }
+      data->num_values += n;
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileBench::BenchColumn(const ColumnSchema& col, const ColumnData& data,
+                               EncodingType encoding, CompressionType compression) {
+  Result result;
+  result.column = col.name();
+  result.encoding = encoding;
+  result.compression = compression;
+  result.num_values = data.num_values;
+  result.raw_bytes = data.raw_bytes;
+
+  const size_t cell_size = data.type->size();
+  const uint8_t* bitmap = col.is_nullable() ? data.non_null_bitmap.data() : nullptr;
+
+  // Write the values, in batches as in flushes and compactions. Each
+  // iteration writes a new CFile, and the one written by the fastest
+  // iteration is read back.
+  MonoDelta best_encode = MonoDelta::FromSeconds(1e9);
+  BlockId block_id;
+  for (int iter = 0; iter < opts_.num_iters; iter++) {
+    unique_ptr<WritableBlock> sink;
+    RETURN_NOT_OK(scratch_fs_->CreateNewBlock({}, &sink));
+    const BlockId id = sink->id();
+    WriterOptions wopts;
+    wopts.storage_attributes.encoding = encoding;
+    wopts.storage_attributes.compression = compression;
+    wopts.storage_attributes.cfile_block_size = col.attributes().cfile_block_size;
+    CFileWriter writer(std::move(wopts), data.type, col.is_nullable(), std::move(sink));
+
+    const MonoTime start = MonoTime::Now();
+    RETURN_NOT_OK(writer.Start());
+    for (int64_t i = 0; i < data.num_values; i += kBatchSize) {
+      const size_t n = std::min<int64_t>(kBatchSize, data.num_values - i);
+      const uint8_t* values = &data.values[i * cell_size];
+      if (bitmap) {
+        // AppendNullableEntries() requires a bitmap starting at a byte boundary.
+        RETURN_NOT_OK(writer.AppendNullableEntries(bitmap + i / 8, values, n));
+      } else {
+        RETURN_NOT_OK(writer.AppendEntries(values, n));
+      }
+    }
+    RETURN_NOT_OK(writer.Finish());
+    const MonoDelta elapsed = MonoTime::Now() - start;
+    if (elapsed < best_encode) {
+      best_encode = elapsed;
+      block_id = id;
+    }
+  }
+  result.encode_mbps = MBps(data.raw_bytes, best_encode);
+
+  unique_ptr<ReadableBlock> block;
+  RETURN_NOT_OK(scratch_fs_->OpenBlock(block_id, &block));
+  uint64_t size;
+  RETURN_NOT_OK(block->Size(&size));
+  result.cfile_bytes = size;
+  unique_ptr<CFileReader> reader;
+  RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  // A range predicate over values of the column itself, so that it selects
+  // a realistic fraction of the rows.
+  const void* lower = nullptr;
+  const void* upper = nullptr;
+  for (int64_t i = 0; i < data.num_values && !(lower && upper); i++) {
+    if (bitmap && !BitmapTest(bitmap, i)) {
+      continue;
+    }
+    const void* v = &data.values[i * cell_size];
+    if (!lower) {
+      lower = v;
+    } else if (data.type->Compare(lower, v) != 0) {
+      upper = v;
+    }
+  }
+  if (upper && data.type->Compare(lower, upper) > 0) {
+    std::swap(lower, upper);
+  }
+  const ColumnPredicate pred = upper ?
+      ColumnPredicate::Range(col, lower, upper) : ColumnPredicate::IsNotNull(col);
+
+  RowBlockMemory mem;
+  vector<uint8_t> batch_values(kBatchSize * cell_size);
+  vector<uint8_t> batch_bitmap(BitmapSize(kBatchSize));
+  ColumnBlock batch(data.type, col.is_nullable() ? batch_bitmap.data() : nullptr,
+                    batch_values.data(), kBatchSize, &mem);
+  SelectionVector sel(kBatchSize);
+
+  // Decoding and predicate evaluation are both measured by scanning the
+  // CFile, as the tablet's iterators do.
+  MonoDelta best_decode = MonoDelta::FromSeconds(1e9);
+  MonoDelta best_eval = MonoDelta::FromSeconds(1e9);
+  for (int iter = 0; iter < opts_.num_iters; iter++) {
+    for (const bool eval : { false, true }) {
+      unique_ptr<CFileIterator> it;
+      RETURN_NOT_OK(reader->NewIterator(&it, CFileReader::DONT_CACHE_BLOCK, nullptr));
+      RETURN_NOT_OK(it->SeekToFirst());
+      const MonoTime start = MonoTime::Now();
+      while (it->HasNext()) {
+        size_t n = kBatchSize;
+        RETURN_NOT_OK(it->PrepareBatch(&n));
+        mem.Reset();
+        sel.Resize(n);
+        sel.SetAllTrue();
+        ColumnBlock view(data.type, batch.non_null_bitmap(), batch.data(), n, &mem);
+        ColumnMaterializationContext ctx(0, eval ? &pred : nullptr, &view, &sel);
+        RETURN_NOT_OK(it->Scan(&ctx));
+        if (eval && ctx.DecoderEvalNotSupported()) {
+          pred.Evaluate(view, &sel);
+        }
+        RETURN_NOT_OK(it->FinishBatch());
+      }
+      const MonoDelta elapsed = MonoTime::Now() - start;
+      MonoDelta* best = eval ? &best_eval : &best_decode;
+      *best = std::min(*best, elapsed);
+    }
+  }
+  result.decode_mbps = MBps(data.raw_bytes, best_decode);
+  result.eval_mbps = MBps(data.raw_bytes, best_eval);
+  results_.emplace_back(std::move(result));
+  return Status::OK();
+}
+
+Status CFileBench::PrintResults(std::ostream* out) const {
+  DataTable table({ "column", "encoding", "compression", "values", "raw size",
+                    "cfile size", "ratio", "encode MB/s", "decode MB/s", "eval MB/s" });
+  std::map<string, const Result*> recommended;
+  std::map<string, double> best_decode;
+  for (const auto& r : results_) {
+    double& best = best_decode[r.column];
+    best = std::max(best, r.decode_mbps);
+  }
+  for (const auto& r : results_) {
+    table.AddRow({ r.column,
+                   EncodingType_Name(r.encoding),
+                   CompressionType_Name(r.compression),
+                   std::to_string(r.num_values),
+                   std::to_string(r.raw_bytes),
+                   std::to_string(r.cfile_bytes),
+                   Substitute("$0", static_cast<double>(r.raw_bytes) /
+                                    std::max<int64_t>(r.cfile_bytes, 1)),
+                   Substitute("$0", r.encode_mbps),
+                   Substitute("$0", r.decode_mbps),
+                   Substitute("$0", r.eval_mbps) });
+    // Recommend the smallest combination which isn't much slower to decode
+    // than the fastest one.
+    if (r.decode_mbps < best_decode[r.column] * opts_.min_decode_ratio) {
+      continue;
+    }
+    const Result*& rec = recommended[r.column];
+    if (!rec || r.cfile_bytes < rec->cfile_bytes) {
+      rec = &r;
+    }
+  }
+  RETURN_NOT_OK(table.PrintTo(*out));
+
+  *out << std::endl << "Recommendations:" << std::endl;
+  for (const auto& e : current_attrs_) {
+    const Result* rec = FindPtrOrNull(recommended, e.first);
+    if (!rec) {
+      continue;
+    }
+    *out << "  " << e.first << ": " << EncodingType_Name(rec->encoding) << " "
+         << CompressionType_Name(rec->compression)
+         << " (currently " << EncodingType_Name(e.second.encoding) << " "
+         << CompressionType_Name(e.second.compression) << ")" << std::endl;
+  }
+  return Status::OK();
+}
+
+} // namespace tools
+} // namespace kudu
@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class FsManager;
+
+namespace tablet {
+class TabletMetadata;
+} // namespace tablet
+
+namespace tools {
+
+// Benchmarks the CFile encodings and compression codecs applicable to the
+// columns of an existing tablet, using the tablet's own data.
+//
+// The base data of each column is read from the tablet's DiskRowSets, then
+// re-written into a scratch file system with each combination of encoding
+// and codec. For each combination, the size of the resulting CFile and the
+// throughput of encoding, decoding and evaluating a range predicate are
+// measured, and the smallest combination which decodes about as fast as the
+// fastest one is recommended.
+//
+// This class is not thread-safe.
+class CFileBench {
+ public:
+  struct Options {
+    // The maximum number of values read from each column.
+    int64_t max_values_per_column = 1000000;
+    // The number of times each measurement is repeated. The fastest time is kept.
+    int num_iters = 1;
+    // A combination is only recommended if it decodes at least this fraction
+    // as fast as the fastest-decoding combination.
+    double min_decode_ratio = 0.5;
+    // The names of the columns to benchmark. All of them if empty.
+    std::vector<std::string> columns;
+  };
+
+  // The measurements of a column re-written with an encoding and codec.
+  struct Result {
+    std::string column;
+    EncodingType encoding;
+    CompressionType compression;
+    int64_t num_values;
+    int64_t raw_bytes;
+    int64_t cfile_bytes;
+    double encode_mbps;
+    double decode_mbps;
+    double eval_mbps;
+  };
+
+  // 'source_fs' is the file system of the tablet, and 'scratch_dir' is a
+  // directory in which to create the scratch file system. Both must outlive
+  // this object.
+  CFileBench(FsManager* source_fs, std::string scratch_dir, Options opts);
+  ~CFileBench();
+
+  // Runs the benchmark against the tablet 'tablet_id'.
+  Status Run(const std::string& tablet_id);
+
+  // Writes the results, and the recommended encoding and codec of each
+  // column, to 'out'.
+  Status PrintResults(std::ostream* out) const;
+
+  const std::vector<Result>& results() const {
+    return results_;
+  }
+
+ private:
+  // The values of a column read from the tablet.
+  struct ColumnData;
+
+  Status ReadColumn(const tablet::TabletMetadata& meta, const ColumnSchema& col,
+                    ColumnId col_id, ColumnData* data);
+
+  Status BenchColumn(const ColumnSchema& col, const ColumnData& data,
+                     EncodingType encoding, CompressionType compression);
+
+  FsManager* const source_fs_;
+  const std::string scratch_dir_;
+  const Options opts_;
+  std::unique_ptr<FsManager> scratch_fs_;
+
+  // The current storage attributes of each column, by column name.
+  std::vector<std::pair<std::string, ColumnStorageAttributes>> current_attrs_;
+  std::vector<Result> results_;
+
+  DISALLOW_COPY_AND_ASSIGN(CFileBench);
+};
+
+} // namespace tools
+} // namespace kudu
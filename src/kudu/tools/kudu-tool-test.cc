@@ -123,6 +123,7 @@
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
@@ -1235,6 +1236,8 @@ TEST_F(ToolTest, TestModeHelp) {
         "loadgen.*Run load generation with optional scan afterwards",
         "table_scan.*Show row count and scanning time cost of tablets in a table",
         "tablet_scan.*Show row count of a local tablet",
+        "cfile_bench.*Benchmark the encodings and compression codecs of the columns",
+        "replay.*Replay the write and scan calls captured by tablet servers",
     };
     NO_FATALS(RunTestHelp(kCmd, kPerfRegexes));
     NO_FATALS(RunTestHelpRpcFlags(kCmd, {"loadgen", "table_scan"}));
@@ -2984,6 +2987,21 @@ TEST_F(ToolTest, TestLoadgenAutoFlushBackgroundSequential) {
       "bench_auto_flush_background_sequential"));
 }
 
+// Run the loadgen benchmark in AUTO_FLUSH_BACKGROUND mode, with all the
+// threads applying rows to the same session.
+TEST_F(ToolTest, TestLoadgenAutoFlushBackgroundSharedSession) {
+  NO_FATALS(RunLoadgen(3,
+      {
+        "--buffer_size_bytes=65536",
+        "--buffers_num=4",
+        "--num_rows_per_thread=2048",
+        "--num_threads=8",
+        "--run_scan",
+        "--use_shared_session",
+      },
+      "bench_auto_flush_background_shared_session"));
+}
+
 // Run loadgen benchmark in AUTO_FLUSH_BACKGROUND mode with randomized keys and values
 // using the deprecated --use_random option.
 TEST_F(ToolTest, TestLoadgenAutoFlushBackgroundRandomKeysValuesDeprecated) {
@@ -3595,6 +3613,72 @@ TEST_F(ToolTest, TestPerfTabletScan) {
   }
 }
 
+TEST_F(ToolTest, TestPerfCFileBench) {
+  // Create a table, and flush its rows so the tablets have base data.
+  constexpr const char* const kTableName = "perf.cfile_bench";
+  NO_FATALS(RunLoadgen(1, {}, kTableName));
+  ASSERT_OK(cluster_->SetFlag(cluster_->tablet_server(0), "flush_threshold_secs", "1"));
+  ASSERT_OK(cluster_->SetFlag(cluster_->tablet_server(0), "flush_threshold_mb", "0"));
+
+  vector<string> tablet_ids;
+  TServerDetails* ts = ts_map_[cluster_->tablet_server(0)->uuid()];
+  ASSERT_OK(ListRunningTabletIds(ts, MonoDelta::FromSeconds(30), &tablet_ids));
+  ASSERT_FALSE(tablet_ids.empty());
+  SleepFor(MonoDelta::FromSeconds(5));
+
+  cluster_->Shutdown();
+  string stdout;
+  NO_FATALS(RunActionStdoutString(
+      Substitute("perf cfile_bench $0 --fs_wal_dir=$1 --fs_data_dirs=$2 "
+                 "--cfile_bench_max_values_per_column=1000 --cfile_bench_scratch_dir=$3 $4",
+                 tablet_ids[0], cluster_->tablet_server(0)->wal_dir(),
+                 JoinStrings(cluster_->tablet_server(0)->data_dirs(), ","),
+                 GetTestPath("scratch"),
+                 env_->IsEncryptionEnabled() ? GetEncryptionArgs() : ""),
+      &stdout));
+  ASSERT_STR_CONTAINS(stdout, "Recommendations:");
+  // The scratch file system is removed afterwards.
+  ASSERT_FALSE(env_->FileExists(GetTestPath("scratch")));
+}
+
+TEST_F(ToolTest, TestPerfReplay) {
+  const string capture_dir = GetTestPath("rpc_capture");
+  ASSERT_OK(env_->CreateDir(capture_dir));
+  ExternalMiniClusterOptions opts;
+  opts.extra_tserver_flags = {
+    "--rpc_capture_sample_rate=1",
+    Substitute("--rpc_capture_dir=$0", capture_dir),
+  };
+  NO_FATALS(StartExternalMiniCluster(std::move(opts)));
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf loadgen $0 --num_rows_per_thread=100 --num_threads=2 "
+      "--run_scan=true --keep_auto_table=true",
+      cluster_->master()->bound_rpc_addr().ToString()), &stdout));
+
+  // The calls are captured asynchronously.
+  vector<string> capture_files;
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_OK(env_->Glob(JoinPathSegments(capture_dir, "*rpc_capture*"), &capture_files));
+    ASSERT_EQ(1, capture_files.size());
+    faststring contents;
+    ASSERT_OK(ReadFileToString(env_, capture_files[0], &contents));
+    ASSERT_STR_CONTAINS(contents.ToString(), "kudu.tserver.TabletServerService Write ");
+    ASSERT_STR_CONTAINS(contents.ToString(), "kudu.tserver.TabletServerService Scan ");
+  });
+
+  // Replay the calls against the same cluster: the replayed inserts fail as
+  // duplicates, but the scans return the rows.
+  NO_FATALS(RunActionStdoutString(
+      Substitute("perf replay $0 $1 --replay_speedup=10 --format=csv",
+                 cluster_->tablet_server(0)->bound_rpc_addr().ToString(),
+                 capture_files[0]),
+      &stdout));
+  ASSERT_STR_MATCHES(stdout, "Write,[1-9]");
+  ASSERT_STR_MATCHES(stdout, "Scan,[1-9]");
+  ASSERT_STR_CONTAINS(stdout, "Skipped calls:");
+}
+
 // Test 'kudu remote_replica copy' tool when the destination tablet server is online.
 // 1. Test the copy tool when the destination replica is healthy
 // 2. Test the copy tool when the destination replica is tombstoned
@@ -806,6 +806,21 @@ Status List(const RunnerContext& /*context*/) {
         RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
                                       rowset, "adhoc-index", boost::none,
                                       rowset.adhoc_index_block()));
+        for (const auto& index_block : rowset.GetSecondaryIndexBlocksById()) {
+          RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
+                                        rowset, "secondary-index", index_block.first,
+                                        index_block.second));
+        }
+        for (const auto& index_block : rowset.GetBitmapIndexBlocksById()) {
+          RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
+                                        rowset, "bitmap-index", index_block.first,
+                                        index_block.second));
+        }
+        for (const auto& bloom_block : rowset.GetColumnBloomBlocksById()) {
+          RETURN_NOT_OK(AddBlockInfoRow(&table, group, fields, &fs_manager, tablet,
+                                        rowset, "column-bloom", bloom_block.first,
+                                        bloom_block.second));
+        }
 
       }
     }
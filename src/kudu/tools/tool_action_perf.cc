@@ -84,6 +84,19 @@
 //     --run_scan=true
 //
 //
+// Run in AUTO_FLUSH_BACKGROUND mode, 32 threads inserting 1M rows each into
+// auto-created table, all of them applying their rows to the same session
+// with its 8 buffers max 64MB in size total; compare with runs using
+// fewer threads to see how a single session scales:
+//
+//   kudu perf loadgen 127.0.0.1 \
+//     --num_threads=32 \
+//     --num_rows_per_thread=1000000 \
+//     --use_shared_session=true \
+//     --buffer_size_bytes=67108864 \
+//     --buffers_num=8
+//
+//
 // If running the tool against already existing table multiple times,
 // use the '--seq_start' flag to avoid errors on duplicate values in subsequent
 // runs. For example: an already existing table 't3' has 5 columns.
@@ -199,10 +212,12 @@
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/raft_consensus.h"
+#include "kudu/fs/dir_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/result_tracker.h"
@@ -211,15 +226,18 @@
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tools/cfile_bench.h"
 #include "kudu/tools/table_scanner.h"
 #include "kudu/tools/tool_action.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/tools/workload_replay.h"
 #include "kudu/util/decimal_util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_validators.h"
 #include "kudu/util/int128.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/oid_generator.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -296,6 +314,12 @@ DEFINE_bool(use_client_per_thread,
             "Use a separate KuduClient instance for each load-generating thread. "
             "This increases throughput by reducing contention on various Client "
             "internals.");
+DEFINE_bool(use_shared_session, false,
+            "Whether all the load-generating threads apply their rows to the "
+            "same session, sharing its mutation buffers, rather than each "
+            "thread using a session of its own. This shows how a single "
+            "session scales with the number of threads applying rows to it. "
+            "If set, '--use_client_per_thread' has no effect.");
 DEFINE_bool(ordered_scan, false,
             "Whether to run an ordered or unordered scan.");
 DEFINE_bool(run_scan, false,
@@ -380,11 +404,34 @@ DEFINE_bool(txn_rollback, false,
             "the inserted rows. Setting --txn_rollback=true implies setting "
             "--txn_start=true as well.");
 
+DEFINE_string(cfile_bench_columns, "",
+              "Comma-separated list of the columns benchmarked by 'perf cfile_bench'. "
+              "If empty, all of the columns are benchmarked.");
+DEFINE_int64(cfile_bench_max_values_per_column, 1000000,
+             "Maximum number of values of each column read from the tablet and "
+             "re-written by 'perf cfile_bench'");
+DEFINE_double(cfile_bench_min_decode_ratio, 0.5,
+              "'perf cfile_bench' recommends the smallest encoding and compression "
+              "of each column which decodes at least this fraction as fast as "
+              "the fastest-decoding one");
+DEFINE_string(cfile_bench_scratch_dir, "",
+              "Directory in which 'perf cfile_bench' creates the scratch file system "
+              "to which the columns are re-written. It is deleted afterwards. "
+              "If empty, a subdirectory of the system's temporary directory is used.");
+
+DEFINE_double(replay_speedup, 1,
+              "'perf replay' issues the captured calls this many times faster "
+              "than they were captured");
+DEFINE_int32(replay_max_concurrency, 64,
+             "Maximum number of calls in flight while running 'perf replay'. "
+             "Calls which were more concurrent when captured are delayed.");
+
 DECLARE_bool(show_values);
 DECLARE_int32(num_threads);
 DECLARE_int32(scan_batch_size);
 DECLARE_string(replica_selection);
 DECLARE_string(table_name);
+DECLARE_int64(timeout_ms);
 
 namespace kudu {
 namespace tools {
@@ -610,6 +657,19 @@ struct WriteResults {
   uint64_t latest_observed_timestamp = 0;
 };
 
+// Sets the mutation buffer settings and the flush mode of 'session'.
+Status SetupSession(KuduSession* session) {
+  RETURN_NOT_OK(session->SetMutationBufferFlushWatermark(
+                   FLAGS_buffer_flush_watermark_pct));
+  RETURN_NOT_OK(session->SetMutationBufferSpace(
+                   FLAGS_buffer_size_bytes));
+  RETURN_NOT_OK(session->SetMutationBufferMaxNum(FLAGS_buffers_num));
+  RETURN_NOT_OK(session->SetErrorBufferSpace(FLAGS_error_buffer_size_bytes));
+  return session->SetFlushMode(
+      FLAGS_flush_per_n_rows == 0 ? KuduSession::AUTO_FLUSH_BACKGROUND
+                                  : KuduSession::MANUAL_FLUSH);
+}
+
 WriteResults GeneratorThread(const shared_ptr<KuduSession>& session,
                              const string& table_name,
                              size_t gen_idx,
@@ -640,15 +700,11 @@ WriteResults GeneratorThread(const shared_ptr<KuduSession>& session,
     if (num_rows_per_gen == 0) {
       return Status::OK();
     }
-    RETURN_NOT_OK(session->SetMutationBufferFlushWatermark(
-                     FLAGS_buffer_flush_watermark_pct));
-    RETURN_NOT_OK(session->SetMutationBufferSpace(
-                     FLAGS_buffer_size_bytes));
-    RETURN_NOT_OK(session->SetMutationBufferMaxNum(FLAGS_buffers_num));
-    RETURN_NOT_OK(session->SetErrorBufferSpace(FLAGS_error_buffer_size_bytes));
-    RETURN_NOT_OK(session->SetFlushMode(
-        flush_per_n_rows == 0 ? KuduSession::AUTO_FLUSH_BACKGROUND
-                              : KuduSession::MANUAL_FLUSH));
+    // A shared session is set up before the threads start applying rows to
+    // it: its settings can't be changed once rows are buffered.
+    if (!FLAGS_use_shared_session) {
+      RETURN_NOT_OK(SetupSession(session.get()));
+    }
 
     shared_ptr<KuduTable> table;
     RETURN_NOT_OK(client->OpenTable(table_name, &table));
@@ -854,12 +910,23 @@ Status TestLoadGenerator(const RunnerContext& context) {
     RETURN_NOT_OK(client->NewTransaction(&txn));
   }
 
-  // Create a session per generator thread. A KuduSession object keeps a
-  // reference to its client handle, so there is no need to keep references
-  // to the newly created client objects themselves.
+  // Create a session per generator thread, or a single one shared by all of
+  // them. A KuduSession object keeps a reference to its client handle, so
+  // there is no need to keep references to the newly created client objects
+  // themselves.
   vector<shared_ptr<KuduSession>> sessions;
   sessions.reserve(gen_num);
-  for (size_t i = 0; i < gen_num; ++i) {
+  if (FLAGS_use_shared_session) {
+    shared_ptr<KuduSession> session;
+    if (is_transactional) {
+      RETURN_NOT_OK(txn->CreateSession(&session));
+    } else {
+      session = client->NewSession();
+    }
+    RETURN_NOT_OK(SetupSession(session.get()));
+    sessions.assign(gen_num, session);
+  }
+  for (size_t i = sessions.size(); i < gen_num; ++i) {
     shared_ptr<KuduClient> c;
     if (FLAGS_use_client_per_thread) {
       RETURN_NOT_OK(CreateKuduClient(context, &c));
@@ -1008,6 +1075,52 @@ Status TabletScan(const RunnerContext& context) {
   return Status::OK();
 }
 
+Status CFileBenchmark(const RunnerContext& context) {
+  const string& tablet_id = FindOrDie(context.required_args, kTabletIdArg);
+
+  FsManagerOpts fs_opts;
+  fs_opts.read_only = true;
+  fs_opts.update_instances = fs::UpdateInstanceBehavior::DONT_UPDATE;
+  FsManager fs(Env::Default(), std::move(fs_opts));
+  RETURN_NOT_OK(fs.Open());
+
+  string scratch_dir = FLAGS_cfile_bench_scratch_dir;
+  if (scratch_dir.empty()) {
+    RETURN_NOT_OK(Env::Default()->GetTestDirectory(&scratch_dir));
+    scratch_dir = JoinPathSegments(scratch_dir,
+                                   Substitute("cfile_bench-$0", ObjectIdGenerator().Next()));
+  }
+  CFileBench::Options opts;
+  opts.max_values_per_column = FLAGS_cfile_bench_max_values_per_column;
+  opts.num_iters = std::max(FLAGS_num_iters, 1);
+  opts.min_decode_ratio = FLAGS_cfile_bench_min_decode_ratio;
+  opts.columns = strings::Split(FLAGS_cfile_bench_columns, ",", strings::SkipEmpty());
+  CFileBench bench(&fs, std::move(scratch_dir), std::move(opts));
+  RETURN_NOT_OK(bench.Run(tablet_id));
+  return bench.PrintResults(&cout);
+}
+
+constexpr const char* const kTServerAddressesArg = "tserver_addresses";
+constexpr const char* const kTServerAddressesArgDesc =
+    "Comma-separated list of the addresses of the Kudu Tablet Servers to replay "
+    "the calls against, formatted as <hostname>:<port>";
+
+Status Replay(const RunnerContext& context) {
+  const string& tserver_addresses = FindOrDie(context.required_args, kTServerAddressesArg);
+  if (FLAGS_replay_speedup <= 0) {
+    return Status::InvalidArgument("--replay_speedup must be positive");
+  }
+  WorkloadReplayer::Options opts;
+  opts.speedup = FLAGS_replay_speedup;
+  opts.max_concurrency = std::max(FLAGS_replay_max_concurrency, 1);
+  opts.timeout_ms = FLAGS_timeout_ms;
+  WorkloadReplayer replayer(strings::Split(tserver_addresses, ",", strings::SkipEmpty()),
+                            opts);
+  RETURN_NOT_OK(replayer.Load(context.variadic_args));
+  RETURN_NOT_OK(replayer.Run());
+  return replayer.PrintResults(&cout);
+}
+
 } // anonymous namespace
 
 unique_ptr<Mode> BuildPerfMode() {
@@ -1059,6 +1172,7 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("use_random")
       .AddOptionalParameter("use_random_pk")
       .AddOptionalParameter("use_random_non_pk")
+      .AddOptionalParameter("use_shared_session")
       .AddOptionalParameter("use_upsert")
       .Build();
 
@@ -1091,11 +1205,51 @@ unique_ptr<Mode> BuildPerfMode() {
       .AddOptionalParameter("num_iters")
       .AddOptionalParameter("ordered_scan")
       .Build();
+  unique_ptr<Action> cfile_bench =
+      ActionBuilder("cfile_bench", &CFileBenchmark)
+      .Description("Benchmark the encodings and compression codecs of the "
+                   "columns of a local tablet")
+      .ExtraDescription("Re-write the base data of each of the columns of a local "
+          "tablet with each applicable encoding and compression codec, and show "
+          "the resulting size and the throughput of encoding, decoding and "
+          "evaluating a range predicate, along with the recommended encoding and "
+          "codec of each column. The tablet's data is not modified.")
+      .AddRequiredParameter({ kTabletIdArg, kTabletIdArgDesc })
+      .AddOptionalParameter("cfile_bench_columns")
+      .AddOptionalParameter("cfile_bench_max_values_per_column")
+      .AddOptionalParameter("cfile_bench_min_decode_ratio")
+      .AddOptionalParameter("cfile_bench_scratch_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .AddOptionalParameter("fs_metadata_dir")
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("num_iters")
+      .Build();
+  unique_ptr<Action> replay =
+      ActionBuilder("replay", &Replay)
+      .Description("Replay the write and scan calls captured by tablet servers")
+      .ExtraDescription("Replay the calls captured by tablet servers run with "
+          "--rpc_capture_sample_rate and --rpc_capture_dir against the given "
+          "tablet servers, with the original pacing and concurrency, and show "
+          "the latency distributions of the replayed calls. Each call is sent to "
+          "the tablet server hosting the leader replica of its tablet, so the "
+          "given tablet servers must host the captured tablets. Scans are "
+          "replayed from their first call until exhausted.")
+      .AddRequiredParameter({ kTServerAddressesArg, kTServerAddressesArgDesc })
+      .AddRequiredVariadicParameter({ "capture_files",
+          "Paths of the segments of the RPC capture logs to replay" })
+      .AddOptionalParameter("format")
+      .AddOptionalParameter("replay_max_concurrency")
+      .AddOptionalParameter("replay_speedup")
+      .AddOptionalParameter("timeout_ms")
+      .Build();
+
   return ModeBuilder("perf")
       .Description("Measure the performance of a Kudu cluster")
       .AddAction(std::move(loadgen))
       .AddAction(std::move(table_scan))
       .AddAction(std::move(tablet_scan))
+      .AddAction(std::move(cfile_bench))
+      .AddAction(std::move(replay))
       .Build();
 }
 
@@ -138,10 +138,11 @@ DECLARE_bool(show_scanner_stats);
 
 DEFINE_string(encoding_type, "AUTO_ENCODING",
               "Type of encoding for the column including AUTO_ENCODING, PLAIN_ENCODING, "
-              "PREFIX_ENCODING, RLE, DICT_ENCODING, BIT_SHUFFLE, GROUP_VARINT");
+              "PREFIX_ENCODING, RLE, DICT_ENCODING, BIT_SHUFFLE, FOR_DELTA, FSST_ENCODING, "
+              "GROUP_VARINT");
 DEFINE_string(compression_type, "DEFAULT_COMPRESSION",
               "Type of compression for the column including DEFAULT_COMPRESSION, "
-              "NO_COMPRESSION, SNAPPY, LZ4, ZLIB");
+              "NO_COMPRESSION, SNAPPY, LZ4, ZLIB, ZSTD");
 DEFINE_string(default_value, "", "Default value for this column.");
 DEFINE_string(comment, "", "Comment for this column.");
 
@@ -1255,6 +1256,12 @@ Status ToClientEncodingType(
     case ColumnPB::BIT_SHUFFLE :
       *type = KuduColumnStorageAttributes::BIT_SHUFFLE;
       break;
+    case ColumnPB::FOR_DELTA :
+      *type = KuduColumnStorageAttributes::FOR_DELTA;
+      break;
+    case ColumnPB::FSST_ENCODING :
+      *type = KuduColumnStorageAttributes::FSST_ENCODING;
+      break;
     default :
       s = Status::InvalidArgument(Substitute("Unexpected encoding type: $0", type_pb));
   }
@@ -1281,6 +1288,9 @@ Status ToClientCompressionType(
     case ColumnPB::ZLIB :
       *type = KuduColumnStorageAttributes::ZLIB;
       break;
+    case ColumnPB::ZSTD :
+      *type = KuduColumnStorageAttributes::ZSTD;
+      break;
     default :
       s = Status::InvalidArgument(Substitute("Unexpected compression type: $0", type_pb));
   }
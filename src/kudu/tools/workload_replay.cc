@@ -0,0 +1,299 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/workload_replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/strings/util.h"
+#include "kudu/rpc/rpc_capture.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tablet/metadata.pb.h"
+#include "kudu/tools/tool_action_common.h"
+#include "kudu/tserver/tablet_server.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/threadpool.h"
+
+using kudu::consensus::RaftPeerPB;
+using kudu::rpc::CapturedCall;
+using kudu::rpc::ParseCapturedCall;
+using kudu::rpc::RpcController;
+using kudu::tserver::ListTabletsRequestPB;
+using kudu::tserver::ListTabletsResponsePB;
+using kudu::tserver::ScanRequestPB;
+using kudu::tserver::ScanResponsePB;
+using kudu::tserver::TabletServerServiceProxy;
+using kudu::tserver::WriteRequestPB;
+using kudu::tserver::WriteResponsePB;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tools {
+
+namespace {
+constexpr const char* const kTServerServiceName = "kudu.tserver.TabletServerService";
+constexpr const char* const kWriteMethodName = "Write";
+constexpr const char* const kScanMethodName = "Scan";
+
+// The latencies are tracked with microsecond precision, up to 10 minutes.
+constexpr int64_t kMaxLatencyMicros = 10LL * 60 * 1000 * 1000;
+} // anonymous namespace
+
+struct WorkloadReplayer::Call {
+  int64_t received_unix_micros;
+  string method_name;
+  string tablet_id;
+  string serialized_request;
+};
+
+struct WorkloadReplayer::MethodStats {
+  MethodStats() : latency(kMaxLatencyMicros, 2) {}
+
+  HdrHistogram latency;
+  std::atomic<int64_t> num_errors { 0 };
+  // The number of rows of the writes which failed.
+  std::atomic<int64_t> num_row_errors { 0 };
+  // The number of rows returned by the scans.
+  std::atomic<int64_t> num_rows_scanned { 0 };
+};
+
+WorkloadReplayer::WorkloadReplayer(vector<string> tserver_addresses, Options opts)
+    : tserver_addresses_(std::move(tserver_addresses)),
+      opts_(opts),
+      schedule_lag_(new HdrHistogram(kMaxLatencyMicros, 2)) {
+  stats_.emplace(kWriteMethodName, unique_ptr<MethodStats>(new MethodStats));
+  stats_.emplace(kScanMethodName, unique_ptr<MethodStats>(new MethodStats));
+}
+
+WorkloadReplayer::~WorkloadReplayer() {}
+
+Status WorkloadReplayer::Load(const vector<string>& paths) {
+  for (const auto& path : paths) {
+    if (HasSuffixString(path, ".gz")) {
+      return Status::NotSupported("compressed capture logs must be decompressed first", path);
+    }
+    faststring data;
+    RETURN_NOT_OK_PREPEND(ReadFileToString(Env::Default(), path, &data),
+                          "unable to read capture log");
+    vector<string> lines = strings::Split(data.ToString(), "\n", strings::SkipEmpty());
+    for (const auto& line : lines) {
+      CapturedCall captured;
+      RETURN_NOT_OK_PREPEND(ParseCapturedCall(line, &captured),
+                            Substitute("unable to parse capture log $0", path));
+      unique_ptr<Call> call(new Call);
+      call->received_unix_micros = captured.received_unix_micros;
+      call->method_name = captured.method_name;
+      if (captured.service_name != kTServerServiceName) {
+        num_skipped_++;
+        continue;
+      }
+      if (captured.method_name == kWriteMethodName) {
+        WriteRequestPB req;
+        if (!req.ParseFromString(captured.serialized_request)) {
+          return Status::Corruption("unable to parse captured write request", path);
+        }
+        call->tablet_id = req.tablet_id();
+      } else if (captured.method_name == kScanMethodName) {
+        ScanRequestPB req;
+        if (!req.ParseFromString(captured.serialized_request)) {
+          return Status::Corruption("unable to parse captured scan request", path);
+        }
+        if (!req.has_new_scan_request()) {
+          // The continuations of the replayed scans are issued by Replay().
+          num_skipped_++;
+          continue;
+        }
+        call->tablet_id = req.new_scan_request().tablet_id();
+      } else {
+        num_skipped_++;
+        continue;
+      }
+      call->serialized_request = std::move(captured.serialized_request);
+      calls_.emplace_back(std::move(call));
+    }
+  }
+  std::stable_sort(calls_.begin(), calls_.end(),
+                   [](const unique_ptr<Call>& a, const unique_ptr<Call>& b) {
+                     return a->received_unix_micros < b->received_unix_micros;
+                   });
+  return Status::OK();
+}
+
+Status WorkloadReplayer::FindTabletServers() {
+  for (int i = 0; i < tserver_addresses_.size(); i++) {
+    unique_ptr<TabletServerServiceProxy> proxy;
+    RETURN_NOT_OK(BuildProxy(tserver_addresses_[i], tserver::TabletServer::kDefaultPort,
+                             &proxy));
+    ListTabletsRequestPB req;
+    req.set_need_schema_info(false);
+    ListTabletsResponsePB resp;
+    RpcController rpc;
+    rpc.set_timeout(MonoDelta::FromMilliseconds(opts_.timeout_ms));
+    RETURN_NOT_OK_PREPEND(proxy->ListTablets(req, &resp, &rpc),
+                          Substitute("unable to list the tablets of $0", tserver_addresses_[i]));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+    for (const auto& replica : resp.status_and_schema()) {
+      const string& tablet_id = replica.tablet_status().tablet_id();
+      // Prefer the leader replica, but fall back to any replica.
+      if (replica.role() == RaftPeerPB::LEADER) {
+        leaders_[tablet_id] = i;
+      } else {
+        leaders_.emplace(tablet_id, i);
+      }
+    }
+    proxies_.emplace_back(std::move(proxy));
+  }
+  return Status::OK();
+}
+
+void WorkloadReplayer::Replay(const Call& call, int64_t lag_micros) {
+  schedule_lag_->Increment(std::max<int64_t>(lag_micros, 0));
+  MethodStats* stats = FindOrDie(stats_, call.method_name).get();
+  TabletServerServiceProxy* proxy = proxies_[FindOrDie(leaders_, call.tablet_id)].get();
+  RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromMilliseconds(opts_.timeout_ms));
+  Status s;
+  MonoTime start;
+  if (call.method_name == kWriteMethodName) {
+    WriteRequestPB req;
+    CHECK(req.ParseFromString(call.serialized_request));
+    WriteResponsePB resp;
+    start = MonoTime::Now();
+    s = proxy->Write(req, &resp, &rpc);
+    if (s.ok() && resp.has_error()) {
+      s = StatusFromPB(resp.error().status());
+    }
+    stats->num_row_errors += resp.per_row_errors_size();
+  } else {
+    ScanRequestPB req;
+    CHECK(req.ParseFromString(call.serialized_request));
+    ScanResponsePB resp;
+    start = MonoTime::Now();
+    s = proxy->Scan(req, &resp, &rpc);
+    uint32_t call_seq_id = 0;
+    while (true) {
+      if (s.ok() && resp.has_error()) {
+        s = StatusFromPB(resp.error().status());
+      }
+      if (!s.ok()) {
+        break;
+      }
+      stats->num_rows_scanned += resp.data().num_rows();
+      if (!resp.has_more_results()) {
+        break;
+      }
+      ScanRequestPB next;
+      next.set_scanner_id(resp.scanner_id());
+      next.set_call_seq_id(++call_seq_id);
+      if (req.has_batch_size_bytes()) {
+        next.set_batch_size_bytes(req.batch_size_bytes());
+      }
+      resp.Clear();
+      rpc.Reset();
+      rpc.set_timeout(MonoDelta::FromMilliseconds(opts_.timeout_ms));
+      s = proxy->Scan(next, &resp, &rpc);
+    }
+  }
+  stats->latency.Increment(std::min((MonoTime::Now() - start).ToMicroseconds(),
+                                    kMaxLatencyMicros));
+  if (!s.ok()) {
+    stats->num_errors++;
+    VLOG(1) << Substitute("replayed $0 to tablet $1 failed: $2",
+                          call.method_name, call.tablet_id, s.ToString());
+  }
+}
+
+Status WorkloadReplayer::Run() {
+  if (calls_.empty()) {
+    return Status::InvalidArgument("no captured calls to replay");
+  }
+  RETURN_NOT_OK(FindTabletServers());
+
+  unique_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("replay")
+                .set_min_threads(0)
+                .set_max_threads(opts_.max_concurrency)
+                .Build(&pool));
+  const int64_t first_call_micros = calls_.front()->received_unix_micros;
+  const MonoTime start = MonoTime::Now();
+  for (const auto& call : calls_) {
+    if (!ContainsKey(leaders_, call->tablet_id)) {
+      num_skipped_++;
+      continue;
+    }
+    const MonoTime due = start + MonoDelta::FromMicroseconds(static_cast<int64_t>(
+        (call->received_unix_micros - first_call_micros) / opts_.speedup));
+    const MonoTime now = MonoTime::Now();
+    if (due > now) {
+      SleepFor(due - now);
+    }
+    const Call* c = call.get();
+    RETURN_NOT_OK(pool->Submit([this, c, due]() {
+      Replay(*c, (MonoTime::Now() - due).ToMicroseconds());
+    }));
+  }
+  pool->Wait();
+  pool->Shutdown();
+  return Status::OK();
+}
+
+Status WorkloadReplayer::PrintResults(std::ostream* out) const {
+  DataTable table({ "Method", "Calls", "Errors", "Row errors", "Rows scanned",
+                    "p50 (ms)", "p95 (ms)", "p99 (ms)", "p99.9 (ms)", "Max (ms)" });
+  const auto to_ms = [](int64_t micros) {
+    return Substitute("$0", static_cast<double>(micros) / 1000);
+  };
+  for (const auto& e : stats_) {
+    const HdrHistogram& h = e.second->latency;
+    table.AddRow({ e.first, Substitute("$0", h.TotalCount()),
+                   Substitute("$0", e.second->num_errors.load()),
+                   Substitute("$0", e.second->num_row_errors.load()),
+                   Substitute("$0", e.second->num_rows_scanned.load()),
+                   to_ms(h.ValueAtPercentile(50)), to_ms(h.ValueAtPercentile(95)),
+                   to_ms(h.ValueAtPercentile(99)), to_ms(h.ValueAtPercentile(99.9)),
+                   to_ms(h.MaxValue()) });
+  }
+  RETURN_NOT_OK(table.PrintTo(*out));
+  *out << "Skipped calls: " << num_skipped_ << std::endl;
+  *out << "Schedule lag p99 (ms): " << to_ms(schedule_lag_->ValueAtPercentile(99))
+       << ", max (ms): " << to_ms(schedule_lag_->MaxValue()) << std::endl;
+  return Status::OK();
+}
+
+} // namespace tools
+} // namespace kudu
@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class HdrHistogram;
+
+namespace tserver {
+class TabletServerServiceProxy;
+} // namespace tserver
+
+namespace tools {
+
+// Replays the write and scan calls captured by tablet servers (see
+// rpc/rpc_capture.h) against the tablet servers of a cluster, and measures
+// their latency.
+//
+// The calls are issued with their original pacing, optionally sped up, each
+// from a thread of a pool so that concurrent calls are replayed concurrently.
+// Each call is sent to the tablet server which hosts the leader replica of its
+// tablet, so the replicas of the captured tablets must exist in the cluster,
+// e.g. because it is the captured cluster itself, or a copy of it.
+//
+// The scans are replayed from their first call: the continuations of each
+// scan are issued until the scanner is exhausted, rather than replayed.
+//
+// This class is not thread-safe.
+class WorkloadReplayer {
+ public:
+  struct Options {
+    // The calls are issued 'speedup' times faster than they were captured.
+    double speedup = 1;
+    // The maximum number of calls in flight. If more calls were concurrent in
+    // the captured workload, the calls are delayed; see 'schedule_lag' below.
+    int max_concurrency = 64;
+    // The timeout of each RPC.
+    int64_t timeout_ms = 60000;
+  };
+
+  WorkloadReplayer(std::vector<std::string> tserver_addresses, Options opts);
+  ~WorkloadReplayer();
+
+  // Loads the calls captured in the capture log segments at 'paths'.
+  Status Load(const std::vector<std::string>& paths);
+
+  // Replays the calls loaded so far.
+  Status Run();
+
+  // Writes the latency distributions of the replayed calls to 'out'.
+  Status PrintResults(std::ostream* out) const;
+
+ private:
+  struct Call;
+  struct MethodStats;
+
+  // Fills 'leaders_' with the tablet server of each tablet.
+  Status FindTabletServers();
+
+  // Replays 'call', updating the stats of its method.
+  void Replay(const Call& call, int64_t lag_micros);
+
+  const std::vector<std::string> tserver_addresses_;
+  const Options opts_;
+
+  std::vector<std::unique_ptr<tserver::TabletServerServiceProxy>> proxies_;
+  // The index in 'proxies_' of the tablet server of each tablet.
+  std::unordered_map<std::string, int> leaders_;
+
+  // Ordered by the time they were received.
+  std::vector<std::unique_ptr<Call>> calls_;
+  // The number of captured calls which can't be replayed.
+  int64_t num_skipped_ = 0;
+
+  // Keyed by method name.
+  std::map<std::string, std::unique_ptr<MethodStats>> stats_;
+  // How late the calls were issued relative to their schedule, in
+  // microseconds. Calls are late if the pool has no idle threads.
+  std::unique_ptr<HdrHistogram> schedule_lag_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkloadReplayer);
+};
+
+} // namespace tools
+} // namespace kudu
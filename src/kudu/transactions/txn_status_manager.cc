@@ -121,6 +121,13 @@ DEFINE_uint32(txn_background_rpc_timeout_ms, 5000,
 TAG_FLAG(txn_background_rpc_timeout_ms, experimental);
 TAG_FLAG(txn_background_rpc_timeout_ms, runtime);
 
+DEFINE_bool(txn_participant_op_batching, true,
+            "Whether the BEGIN_COMMIT, FINALIZE_COMMIT, and ABORT_TXN ops sent to the "
+            "participants of a transaction are batched into one RPC per tablet "
+            "server, rather than sent in one RPC per participant");
+TAG_FLAG(txn_participant_op_batching, experimental);
+TAG_FLAG(txn_participant_op_batching, runtime);
+
 DEFINE_uint32(txn_client_initialization_timeout_ms, 10000,
               "Amount of time Kudu will try to initialize a client with "
               "which to perform transaction commit tasks.");
@@ -215,16 +222,73 @@ bool CommitTasks::ScheduleAbortIfNecessary() {
   return false;
 }
 
+void CommitTasks::ParticipateInTransactionAsync(
+    ParticipantOpPB op_pb, const std::function<StatusCallback(int)>& make_cb) {
+  // NOTE: the final callback may destruct this CommitTask and its members, so
+  // cache the participant ID size.
+  const auto participant_ids_size = participant_ids_.size();
+  const MonoTime deadline =
+      MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms);
+  Timestamp* begin_commit_timestamps = op_pb.type() == ParticipantOpPB::BEGIN_COMMIT ?
+      begin_commit_timestamps_.data() : nullptr;
+  if (FLAGS_txn_participant_op_batching && participant_ids_size > 1) {
+    vector<StatusCallback> cbs;
+    cbs.reserve(participant_ids_size);
+    for (int i = 0; i < participant_ids_size; i++) {
+      cbs.emplace_back(make_cb(i));
+    }
+    txn_client_->ParticipateInTransactionsAsync(
+        participant_ids_, op_pb, deadline, std::move(cbs), begin_commit_timestamps);
+    return;
+  }
+  for (int i = 0; i < participant_ids_size; i++) {
+    txn_client_->ParticipateInTransactionAsync(
+        participant_ids_[i], op_pb, deadline, make_cb(i),
+        begin_commit_timestamps ? &begin_commit_timestamps[i] : nullptr);
+  }
+}
+
+ParticipantOpPB CommitTasks::BeginCommitOp() const {
+  ParticipantOpPB op_pb;
+  op_pb.set_txn_id(txn_id_.value());
+  op_pb.set_type(ParticipantOpPB::BEGIN_COMMIT);
+  return op_pb;
+}
+
+ParticipantOpPB CommitTasks::FinalizeCommitOp() const {
+  ParticipantOpPB op_pb;
+  op_pb.set_txn_id(txn_id_.value());
+  op_pb.set_type(ParticipantOpPB::FINALIZE_COMMIT);
+  op_pb.set_finalized_commit_timestamp(commit_timestamp_.value());
+  return op_pb;
+}
+
+ParticipantOpPB CommitTasks::AbortTxnOp() const {
+  ParticipantOpPB op_pb;
+  op_pb.set_txn_id(txn_id_.value());
+  op_pb.set_type(ParticipantOpPB::ABORT_TXN);
+  return op_pb;
+}
+
 void CommitTasks::BeginCommitAsyncTask(int participant_idx) {
   DCHECK_LT(participant_idx, participant_ids_.size());
+  txn_client_->ParticipateInTransactionAsync(
+      participant_ids_[participant_idx],
+      BeginCommitOp(),
+      MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms),
+      BeginCommitCallback(participant_idx),
+      &begin_commit_timestamps_[participant_idx]);
+}
+
+StatusCallback CommitTasks::BeginCommitCallback(int participant_idx) {
   // Status callback called with the result from the participant op. This is
   // used to collect the participants' highest timestamps, with which we can
   // schedule the finalize commit task.
   //
   // The Status is the result returned from ParticipantRpc::AnalyzeResponse.
   scoped_refptr<CommitTasks> scoped_this(this);
-  auto participated_cb = [this, scoped_this = std::move(scoped_this),
-                          participant_idx] (const Status& s) {
+  return [this, scoped_this = std::move(scoped_this),
+          participant_idx] (const Status& s) {
     if (IsShuttingDownCleanupIfLastOp()) {
       return;
     }
@@ -262,24 +326,23 @@ void CommitTasks::BeginCommitAsyncTask(int participant_idx) {
       ScheduleFinalizeCommitWrite();
     }
   };
-  ParticipantOpPB op_pb;
-  op_pb.set_txn_id(txn_id_.value());
-  op_pb.set_type(ParticipantOpPB::BEGIN_COMMIT);
-  txn_client_->ParticipateInTransactionAsync(
-      participant_ids_[participant_idx],
-      std::move(op_pb),
-      MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms),
-      std::move(participated_cb),
-      &begin_commit_timestamps_[participant_idx]);
 }
 
 void CommitTasks::FinalizeCommitAsyncTask(int participant_idx) {
   DCHECK_EQ(TxnStatePB::UNKNOWN, abort_txn_);
   DCHECK_LT(participant_idx, participant_ids_.size());
+  txn_client_->ParticipateInTransactionAsync(
+      participant_ids_[participant_idx],
+      FinalizeCommitOp(),
+      MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms),
+      FinalizeCommitCallback(participant_idx));
+}
+
+StatusCallback CommitTasks::FinalizeCommitCallback(int participant_idx) {
   // Status callback called with the result from the participant op.
   scoped_refptr<CommitTasks> scoped_this(this);
-  auto participated_cb = [this, scoped_this = std::move(scoped_this),
-                          participant_idx] (const Status& s) {
+  return [this, scoped_this = std::move(scoped_this),
+          participant_idx] (const Status& s) {
     if (IsShuttingDownCleanupIfLastOp()) {
       return;
     }
@@ -305,20 +368,19 @@ void CommitTasks::FinalizeCommitAsyncTask(int participant_idx) {
       ScheduleCompleteCommitWrite();
     }
   };
-  ParticipantOpPB op_pb;
-  op_pb.set_txn_id(txn_id_.value());
-  op_pb.set_type(ParticipantOpPB::FINALIZE_COMMIT);
-  op_pb.set_finalized_commit_timestamp(commit_timestamp_.value());
+}
+
+void CommitTasks::AbortTxnAsyncTask(int participant_idx) {
   txn_client_->ParticipateInTransactionAsync(
       participant_ids_[participant_idx],
-      std::move(op_pb),
+      AbortTxnOp(),
       MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms),
-      std::move(participated_cb));
+      AbortTxnCallback(participant_idx));
 }
 
-void CommitTasks::AbortTxnAsyncTask(int participant_idx) {
+StatusCallback CommitTasks::AbortTxnCallback(int participant_idx) {
   // Status callback called with the result from the participant op.
-  auto participated_cb = [this, participant_idx] (const Status& s) {
+  return [this, participant_idx] (const Status& s) {
     if (IsShuttingDownCleanupIfLastOp()) {
       return;
     }
@@ -348,14 +410,6 @@ void CommitTasks::AbortTxnAsyncTask(int participant_idx) {
       ScheduleFinalizeAbortTxnWrite();
     }
   };
-  ParticipantOpPB op_pb;
-  op_pb.set_txn_id(txn_id_.value());
-  op_pb.set_type(ParticipantOpPB::ABORT_TXN);
-  txn_client_->ParticipateInTransactionAsync(
-      participant_ids_[participant_idx],
-      std::move(op_pb),
-      MonoTime::Now() + MonoDelta::FromMilliseconds(FLAGS_txn_background_rpc_timeout_ms),
-      std::move(participated_cb));
 }
 
 void CommitTasks::AbortTxnAsync() {
@@ -364,13 +418,9 @@ void CommitTasks::AbortTxnAsync() {
   if (participant_ids_.empty()) {
     ScheduleFinalizeAbortTxnWrite();
   } else {
-    // NOTE: the final AbortTxnAsyncTask() call may destruct this CommitTask
-    // and its members, so cache the participant ID size.
-    const auto participant_ids_size = participant_ids_.size();
-    ops_in_flight_ = participant_ids_size;
-    for (int i = 0; i < participant_ids_size; i++) {
-      AbortTxnAsyncTask(i);
-    }
+    ops_in_flight_ = participant_ids_.size();
+    ParticipateInTransactionAsync(AbortTxnOp(),
+                                  [this] (int i) { return AbortTxnCallback(i); });
   }
 }
 
@@ -440,13 +490,8 @@ void CommitTasks::FinalizeCommitAsync() {
   // tasks to complete.
   auto old_val = ops_in_flight_.exchange(participant_ids_.size());
   DCHECK_EQ(0, old_val);
-  // NOTE: the final FinalizeCommitAsyncTask() call may destruct this
-  // CommitTask and its members, so cache the participant ID size.
-  const auto participant_ids_size = participant_ids_.size();
-  ops_in_flight_ = participant_ids_size;
-  for (int i = 0; i < participant_ids_size; i++) {
-    FinalizeCommitAsyncTask(i);
-  }
+  ParticipateInTransactionAsync(FinalizeCommitOp(),
+                                [this] (int i) { return FinalizeCommitCallback(i); });
 }
 
 void CommitTasks::ScheduleCompleteCommitWrite() {
@@ -1022,16 +1067,11 @@ void CommitTasks::BeginCommitAsync() {
     // If there are some participants, schedule beginning commit tasks so
     // we can determine a finalized commit timestamp.
     //
-    // NOTE: the final BeginCommitAsyncTask() call may destruct this CommitTask
-    // and its members, so cache the participant ID size.
-    //
     // TODO(awong): consider an approach in which clients propagate
     // timestamps in such a way that the client's call to begin commit
     // includes the expected finalized commit timestamp.
-    const auto participant_ids_size = participant_ids_.size();
-    for (int i = 0; i < participant_ids_size; i++) {
-      BeginCommitAsyncTask(i);
-    }
+    ParticipateInTransactionAsync(BeginCommitOp(),
+                                  [this] (int i) { return BeginCommitCallback(i); });
   }
 }
 
@@ -18,6 +18,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -40,6 +41,7 @@
 #include "kudu/util/locks.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/status.h"
+#include "kudu/util/status_callback.h"
 
 namespace kudu {
 class MonoDelta;
@@ -54,6 +56,7 @@ class TabletReplica;
 } // namespace tablet
 
 namespace tserver {
+class ParticipantOpPB;
 class TabletServerErrorPB;
 } // namespace tserver
 
@@ -128,6 +131,26 @@ class CommitTasks : public RefCountedThreadSafe<CommitTasks> {
   // record to be written to the tablet.
   void AbortTxnAsyncTask(int participant_idx);
 
+  // Sends 'op_pb' to every participant, calling the callback returned by
+  // 'make_cb' for each participant's index with the result of its op. Unless
+  // --txn_participant_op_batching is false, the ops to participants led by
+  // the same tablet server are sent in a single RPC.
+  //
+  // The results of BEGIN_COMMIT ops are collected in 'begin_commit_timestamps_'.
+  void ParticipateInTransactionAsync(tserver::ParticipantOpPB op_pb,
+                                     const std::function<StatusCallback(int)>& make_cb);
+
+  // The participant ops of each phase of the commit or abort.
+  tserver::ParticipantOpPB BeginCommitOp() const;
+  tserver::ParticipantOpPB FinalizeCommitOp() const;
+  tserver::ParticipantOpPB AbortTxnOp() const;
+
+  // Returns the callback to call with the result of the corresponding op to
+  // the participant at the given index. Timed out ops are retried.
+  StatusCallback BeginCommitCallback(int participant_idx);
+  StatusCallback FinalizeCommitCallback(int participant_idx);
+  StatusCallback AbortTxnCallback(int participant_idx);
+
   // Schedule calls to the TxnStatusManager to be made on the commit pool.
   // NOTE: these may be called on reactor threads and thus must not
   // synchronously do any IO.
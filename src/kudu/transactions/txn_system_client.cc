@@ -17,11 +17,14 @@
 
 #include "kudu/transactions/txn_system_client.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -35,6 +38,7 @@
 #include "kudu/common/common.pb.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -47,7 +51,9 @@
 #include "kudu/transactions/participant_rpc.h"
 #include "kudu/transactions/transactions.pb.h"
 #include "kudu/transactions/txn_status_tablet.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/tserver/tserver_admin.pb.h"
+#include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/async_util.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -77,6 +83,8 @@ using kudu::client::KuduTable;
 using kudu::client::KuduTableAlterer;
 using kudu::client::KuduTableCreator;
 using kudu::client::internal::MetaCache;
+using kudu::client::internal::RemoteTablet;
+using kudu::client::internal::RemoteTabletServer;
 using kudu::master::MasterServiceProxy;
 using kudu::master::PingRequestPB;
 using kudu::master::PingResponsePB;
@@ -85,16 +93,202 @@ using kudu::rpc::RpcController;
 using kudu::tablet::TxnMetadataPB;
 using kudu::tserver::CoordinatorOpPB;
 using kudu::tserver::CoordinatorOpResultPB;
+using kudu::tserver::ParticipantBatchRequestPB;
+using kudu::tserver::ParticipantBatchResponsePB;
 using kudu::tserver::ParticipantOpPB;
+using kudu::tserver::ParticipantRequestPB;
+using kudu::tserver::ParticipantResponsePB;
+using kudu::tserver::TabletServerErrorPB;
+using kudu::tserver::TabletServerFeatures;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
 using std::vector;
 using strings::Substitute;
 
 namespace kudu {
 namespace transactions {
 
+namespace {
+
+// Sends the same participant op to a set of participants, with a single
+// ParticipateInTransactionBatch RPC to each tablet server which leads more
+// than one of them.
+//
+// The batched RPCs aren't retried: the ops which couldn't be batched, or
+// whose batched op failed for any reason, are sent with a ParticipantRpc of
+// their own, which retries and fails over to new leaders as appropriate.
+class ParticipantOpBatcher : public std::enable_shared_from_this<ParticipantOpBatcher> {
+ public:
+  ParticipantOpBatcher(KuduClient* client,
+                       MetaCache* meta_cache,
+                       vector<string> tablet_ids,
+                       ParticipantOpPB participant_op,
+                       MonoTime deadline,
+                       vector<StatusCallback> cbs,
+                       Timestamp* begin_commit_timestamps)
+      : client_(client),
+        meta_cache_(meta_cache),
+        tablet_ids_(std::move(tablet_ids)),
+        participant_op_(std::move(participant_op)),
+        deadline_(deadline),
+        cbs_(std::move(cbs)),
+        begin_commit_timestamps_(begin_commit_timestamps),
+        tablets_(tablet_ids_.size()),
+        num_lookups_pending_(tablet_ids_.size()) {
+    DCHECK_EQ(tablet_ids_.size(), cbs_.size());
+  }
+
+  void Run() {
+    const auto self = shared_from_this();
+    for (int i = 0; i < tablet_ids_.size(); i++) {
+      meta_cache_->LookupTabletById(
+          client_, tablet_ids_[i], deadline_, &tablets_[i],
+          [self, i] (const Status& s) {
+            if (PREDICT_FALSE(!s.ok())) {
+              self->tablets_[i].reset();
+              self->cbs_[i](s);
+            }
+            if (--self->num_lookups_pending_ == 0) {
+              self->SendOps();
+            }
+          });
+    }
+  }
+
+ private:
+  // An in-flight ParticipateInTransactionBatch RPC.
+  struct BatchCall {
+    // The indexes of the participants of the RPC's ops, in the order of the ops.
+    vector<int> idxs;
+    ParticipantBatchRequestPB req;
+    ParticipantBatchResponsePB resp;
+    RpcController controller;
+  };
+
+  // Groups the participants whose lookup succeeded by leader, and sends their
+  // ops.
+  void SendOps() {
+    unordered_map<RemoteTabletServer*, vector<int>> idxs_by_leader;
+    for (int i = 0; i < tablets_.size(); i++) {
+      if (!tablets_[i]) {
+        continue;
+      }
+      RemoteTabletServer* leader = tablets_[i]->LeaderTServer();
+      if (!leader) {
+        SendOp(i);
+        continue;
+      }
+      idxs_by_leader[leader].emplace_back(i);
+    }
+    for (auto& leader_and_idxs : idxs_by_leader) {
+      if (leader_and_idxs.second.size() == 1) {
+        SendOp(leader_and_idxs.second[0]);
+      } else {
+        SendBatch(leader_and_idxs.first, std::move(leader_and_idxs.second));
+      }
+    }
+  }
+
+  // Sends the op of the participant at 'idx' in a ParticipantRpc of its own.
+  void SendOp(int idx) {
+    unique_ptr<TxnParticipantContext> ctx(
+        new TxnParticipantContext({
+            client_,
+            participant_op_,
+            tablets_[idx],
+        }));
+    ParticipantRpc* rpc = ParticipantRpc::NewRpc(
+        std::move(ctx),
+        deadline_,
+        cbs_[idx],
+        begin_commit_timestamps_ ? &begin_commit_timestamps_[idx] : nullptr);
+    rpc->SendRpc();
+  }
+
+  void SendBatch(RemoteTabletServer* ts, vector<int> idxs) {
+    const auto self = shared_from_this();
+    ts->InitProxy(client_, [self, ts, idxs] (const Status& s) {
+      if (PREDICT_FALSE(!s.ok())) {
+        for (int idx : idxs) {
+          self->SendOp(idx);
+        }
+        return;
+      }
+      self->SendBatchRpc(ts, idxs);
+    });
+  }
+
+  void SendBatchRpc(RemoteTabletServer* ts, vector<int> idxs) {
+    unique_ptr<BatchCall> call(new BatchCall);
+    for (int idx : idxs) {
+      ParticipantRequestPB* req = call->req.add_requests();
+      req->set_tablet_id(tablet_ids_[idx]);
+      *req->mutable_op() = participant_op_;
+    }
+    call->idxs = std::move(idxs);
+    call->controller.set_deadline(deadline_);
+    call->controller.RequireServerFeature(TabletServerFeatures::PARTICIPANT_OP_BATCH);
+    // The controller holds on to the callback until the RPC completes, so the
+    // callback can't own the call it belongs to: it deletes it instead.
+    BatchCall* call_raw = call.release();
+    const auto self = shared_from_this();
+    ts->admin_proxy()->ParticipateInTransactionBatchAsync(
+        call_raw->req, &call_raw->resp, &call_raw->controller,
+        [self, call_raw] () { self->BatchDone(unique_ptr<BatchCall>(call_raw)); });
+  }
+
+  void BatchDone(unique_ptr<BatchCall> call) {
+    Status s = call->controller.status();
+    if (PREDICT_TRUE(s.ok()) && call->resp.responses_size() != call->idxs.size()) {
+      s = Status::IllegalState(Substitute("expected $0 participant responses, got $1",
+                                          call->idxs.size(), call->resp.responses_size()));
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      // Servers which don't support batching end up here too.
+      VLOG(1) << Substitute("Batched $0 op failed, sending the ops one by one: $1",
+                            ParticipantOpPB::ParticipantOpType_Name(participant_op_.type()),
+                            s.ToString());
+    }
+    for (int i = 0; i < call->idxs.size(); i++) {
+      const int idx = call->idxs[i];
+      if (PREDICT_FALSE(!s.ok())) {
+        SendOp(idx);
+        continue;
+      }
+      const ParticipantResponsePB& resp = call->resp.responses(i);
+      if (resp.has_error() &&
+          resp.error().code() != TabletServerErrorPB::TXN_OP_ALREADY_APPLIED) {
+        // Whether and where to retry is up to ParticipantRpc, which remains
+        // the sole interpreter of participant errors.
+        SendOp(idx);
+        continue;
+      }
+      if (begin_commit_timestamps_ && resp.has_timestamp()) {
+        begin_commit_timestamps_[idx] = Timestamp(resp.timestamp());
+      }
+      cbs_[idx](Status::OK());
+    }
+  }
+
+  KuduClient* client_;
+  MetaCache* meta_cache_;
+  const vector<string> tablet_ids_;
+  const ParticipantOpPB participant_op_;
+  const MonoTime deadline_;
+  const vector<StatusCallback> cbs_;
+  Timestamp* begin_commit_timestamps_;
+
+  // Set by the tablet lookups; null for the tablets whose lookup failed.
+  vector<scoped_refptr<RemoteTablet>> tablets_;
+  std::atomic<int> num_lookups_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParticipantOpBatcher);
+};
+
+} // anonymous namespace
+
 Status TxnSystemClient::Create(const vector<HostPort>& master_addrs,
                                const string& sasl_protocol_name,
                                unique_ptr<TxnSystemClient>* sys_client) {
@@ -416,6 +610,16 @@ void TxnSystemClient::ParticipateInTransactionAsync(const string& tablet_id,
       });
 }
 
+void TxnSystemClient::ParticipateInTransactionsAsync(vector<string> tablet_ids,
+                                                     const ParticipantOpPB& participant_op,
+                                                     MonoTime deadline,
+                                                     vector<StatusCallback> cbs,
+                                                     Timestamp* begin_commit_timestamps) {
+  std::make_shared<ParticipantOpBatcher>(
+      client_.get(), client_->data_->meta_cache_.get(), std::move(tablet_ids),
+      participant_op, deadline, std::move(cbs), begin_commit_timestamps)->Run();
+}
+
 TxnSystemClientInitializer::TxnSystemClientInitializer()
     : init_complete_(false),
       shutting_down_(false) {}
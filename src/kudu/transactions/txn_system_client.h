@@ -160,6 +160,20 @@ class TxnSystemClient {
                                      StatusCallback cb,
                                      Timestamp* begin_commit_timestamp = nullptr,
                                      tablet::TxnMetadataPB* metadata_pb = nullptr);
+
+  // Sends 'participant_op' to the leader of each of the given tablets, calling
+  // 'cbs[i]' with the result of the op on 'tablet_ids[i]'. The ops to tablets
+  // led by the same tablet server are sent in a single RPC, if the server
+  // supports it.
+  //
+  // If this is a BEGIN_COMMIT op and 'begin_commit_timestamps' is non-null,
+  // it must point to one timestamp per tablet, each of which is populated
+  // before the tablet's callback is called with success.
+  void ParticipateInTransactionsAsync(std::vector<std::string> tablet_ids,
+                                      const tserver::ParticipantOpPB& participant_op,
+                                      MonoTime deadline,
+                                      std::vector<StatusCallback> cbs,
+                                      Timestamp* begin_commit_timestamps = nullptr);
  private:
 
   friend class itest::TxnStatusTableITest;
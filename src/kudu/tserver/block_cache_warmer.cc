@@ -0,0 +1,232 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/block_cache_warmer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_context.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(block_cache_keys_persist_interval_sec, 0,
+             "How often, in seconds, the tablet server persists the keys of the blocks "
+             "in the block cache, so that the blocks can be read back into the cache "
+             "after the tablet server restarts. The keys are also persisted upon "
+             "shutdown. If 0, the keys are neither persisted nor read back.");
+TAG_FLAG(block_cache_keys_persist_interval_sec, experimental);
+
+DEFINE_int32(block_cache_warmup_max_blocks_per_sec, 500,
+             "The maximum rate at which blocks are read back into the block cache "
+             "after the tablet server restarts. If 0, the rate is not limited.");
+TAG_FLAG(block_cache_warmup_max_blocks_per_sec, experimental);
+TAG_FLAG(block_cache_warmup_max_blocks_per_sec, runtime);
+
+METRIC_DEFINE_gauge_uint64(server, block_cache_warmup_blocks_total,
+                           "Block Cache Warm-up Blocks Total",
+                           kudu::MetricUnit::kBlocks,
+                           "Number of blocks persisted before the last restart to be "
+                           "read back into the block cache",
+                           kudu::MetricLevel::kInfo);
+METRIC_DEFINE_counter(server, block_cache_warmup_blocks_loaded,
+                      "Block Cache Warm-up Blocks Loaded",
+                      kudu::MetricUnit::kBlocks,
+                      "Number of blocks read back into the block cache since the "
+                      "last restart",
+                      kudu::MetricLevel::kInfo);
+
+using kudu::cfile::BlockCache;
+using kudu::cfile::BlockCacheKeysPB;
+using kudu::cfile::CFileReader;
+using kudu::cfile::ReaderOptions;
+using kudu::fs::IOContext;
+using kudu::fs::ReadableBlock;
+using std::string;
+using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+BlockCacheWarmer::BlockCacheWarmer(FsManager* fs_manager,
+                                   std::function<bool()> tablets_opened,
+                                   const scoped_refptr<MetricEntity>& metric_entity)
+    : fs_manager_(fs_manager),
+      tablets_opened_(std::move(tablets_opened)),
+      shutdown_latch_(1),
+      warm_up_done_(false),
+      blocks_total_(METRIC_block_cache_warmup_blocks_total.Instantiate(metric_entity, 0)),
+      blocks_loaded_(METRIC_block_cache_warmup_blocks_loaded.Instantiate(metric_entity)) {
+}
+
+BlockCacheWarmer::~BlockCacheWarmer() {
+  Shutdown();
+}
+
+Status BlockCacheWarmer::Start() {
+  if (FLAGS_block_cache_keys_persist_interval_sec <= 0 || fs_manager_->read_only()) {
+    return Status::OK();
+  }
+  return Thread::Create("tserver", "block-cache-warmer",
+                        [this]() { this->Run(); }, &thread_);
+}
+
+void BlockCacheWarmer::Shutdown() {
+  if (!thread_) {
+    return;
+  }
+  shutdown_latch_.CountDown();
+  thread_->Join();
+  thread_.reset();
+  // Until warming up completes, the previously persisted keys better reflect
+  // the blocks worth caching.
+  if (warm_up_done_) {
+    WARN_NOT_OK(PersistKeys(), "could not persist the block cache keys");
+  }
+}
+
+void BlockCacheWarmer::Run() {
+  MonoTime start = MonoTime::Now();
+  Status s = WarmUp();
+  if (s.ok()) {
+    LOG(INFO) << Substitute("Read $0 blocks back into the block cache in $1",
+                            blocks_loaded_->value(),
+                            (MonoTime::Now() - start).ToString());
+  } else if (!s.IsAborted()) {
+    LOG(WARNING) << "Could not warm up the block cache: " << s.ToString();
+  }
+  if (s.IsAborted()) {
+    return;
+  }
+  warm_up_done_ = true;
+
+  const MonoDelta interval = MonoDelta::FromSeconds(FLAGS_block_cache_keys_persist_interval_sec);
+  while (!shutdown_latch_.WaitFor(interval)) {
+    WARN_NOT_OK(PersistKeys(), "could not persist the block cache keys");
+  }
+}
+
+Status BlockCacheWarmer::PersistKeys() {
+  vector<BlockCache::CacheKey> keys;
+  BlockCache::GetSingleton()->GetKeys(&keys);
+  unordered_map<uint64_t, vector<uint64_t>> offsets_by_file;
+  for (const auto& key : keys) {
+    offsets_by_file[key.file_id_].push_back(key.offset_);
+  }
+  BlockCacheKeysPB pb;
+  for (const auto& e : offsets_by_file) {
+    auto* file = pb.add_files();
+    file->set_file_id(e.first);
+    file->mutable_offsets()->Reserve(e.second.size());
+    for (auto offset : e.second) {
+      file->add_offsets(offset);
+    }
+  }
+  // The keys are only a hint, so there's no need to sync them.
+  return pb_util::WritePBToPath(fs_manager_->env(), fs_manager_->GetBlockCacheKeysPath(),
+                                pb, pb_util::NO_SYNC);
+}
+
+Status BlockCacheWarmer::WarmUp() {
+  BlockCacheKeysPB pb;
+  Status s = pb_util::ReadPBFromPath(fs_manager_->env(), fs_manager_->GetBlockCacheKeysPath(),
+                                     &pb);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, "could not read the block cache keys");
+  uint64_t total = 0;
+  for (const auto& file : pb.files()) {
+    total += file.offsets_size();
+  }
+  blocks_total_->set_value(total);
+
+  // Don't compete with the I/O of bootstrapping the tablets.
+  while (!tablets_opened_()) {
+    if (shutdown_latch_.WaitFor(MonoDelta::FromMilliseconds(100))) {
+      return Status::Aborted("shutting down");
+    }
+  }
+
+  MonoTime next_read = MonoTime::Now();
+  const auto before_read = [&]() {
+    if (shutdown_latch_.WaitUntil(next_read)) {
+      return false;
+    }
+    const int32_t max_rate = FLAGS_block_cache_warmup_max_blocks_per_sec;
+    if (max_rate > 0) {
+      next_read = std::max(next_read, MonoTime::Now() - MonoDelta::FromSeconds(1)) +
+          MonoDelta::FromSeconds(1.0 / max_rate);
+    }
+    return true;
+  };
+  // The blocks aren't associated with any tablet here: errors are left for
+  // the tablets to handle once they read the blocks themselves.
+  const IOContext io_context;
+  for (const auto& file : pb.files()) {
+    unique_ptr<ReadableBlock> block;
+    s = fs_manager_->OpenBlock(BlockId(file.file_id()), &block);
+    if (s.IsNotFound()) {
+      // The block was deleted since, e.g. by a compaction.
+      continue;
+    }
+    unique_ptr<CFileReader> reader;
+    if (s.ok()) {
+      s = CFileReader::Open(std::move(block), ReaderOptions(), &reader);
+    }
+    int num_loaded = 0;
+    if (s.ok()) {
+      unordered_set<uint64_t> offsets(file.offsets().begin(), file.offsets().end());
+      s = reader->LoadBlocksIntoCache(&io_context, offsets, before_read, &num_loaded);
+    }
+    blocks_loaded_->IncrementBy(num_loaded);
+    if (s.IsAborted()) {
+      return s;
+    }
+    WARN_NOT_OK(s, Substitute("could not read block $0 back into the block cache",
+                              BlockId(file.file_id()).ToString()));
+  }
+  return Status::OK();
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class FsManager;
+class Thread;
+
+namespace tserver {
+
+// Component of the Tablet Server which keeps the block cache warm across
+// restarts.
+//
+// While the server runs, the keys of the blocks in the block cache are
+// periodically persisted to FsManager::GetBlockCacheKeysPath(), and once more
+// upon shutdown. Upon startup, once all the tablets have been opened, the
+// persisted blocks are read back into the block cache in the background, at
+// a limited rate so as not to compete with the I/O of other operations.
+class BlockCacheWarmer {
+ public:
+  // 'tablets_opened' returns whether the tablets of the server were opened,
+  // at which point warming up the block cache starts.
+  BlockCacheWarmer(FsManager* fs_manager,
+                   std::function<bool()> tablets_opened,
+                   const scoped_refptr<MetricEntity>& metric_entity);
+  ~BlockCacheWarmer();
+
+  // Starts the background thread, unless disabled by the flags.
+  Status Start();
+
+  // Stops the background thread, persisting the keys of the blocks in the
+  // block cache if they were persisted since startup.
+  void Shutdown();
+
+  // Persists the keys of the blocks in the block cache.
+  Status PersistKeys();
+
+  // Reads the blocks whose keys were persisted back into the block cache.
+  // Returns Status::Aborted if Shutdown() was called meanwhile.
+  Status WarmUp();
+
+ private:
+  void Run();
+
+  FsManager* const fs_manager_;
+  const std::function<bool()> tablets_opened_;
+
+  // Counted down by Shutdown().
+  CountDownLatch shutdown_latch_;
+
+  scoped_refptr<Thread> thread_;
+
+  // Whether WarmUp() completed, even if unsuccessfully.
+  std::atomic<bool> warm_up_done_;
+
+  // The number of blocks to warm up, and the number of them read so far.
+  scoped_refptr<AtomicGauge<uint64_t>> blocks_total_;
+  scoped_refptr<Counter> blocks_loaded_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCacheWarmer);
+};
+
+} // namespace tserver
+} // namespace kudu
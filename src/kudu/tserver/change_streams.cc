@@ -0,0 +1,317 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/change_streams.h"
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/partial_row.h"
+#include "kudu/common/row.h"
+#include "kudu/common/row_changelist.h"
+#include "kudu/common/row_operations.h"
+#include "kudu/common/row_operations.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/opid_util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/tablet.pb.h"
+#include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(change_stream_subscriber_idle_timeout_ms, 10 * 60 * 1000,
+             "Amount of time after which the WAL anchor of a change stream "
+             "subscriber which hasn't read any changes of a tablet is released, "
+             "allowing the WAL segments it retained to be garbage collected.");
+TAG_FLAG(change_stream_subscriber_idle_timeout_ms, experimental);
+TAG_FLAG(change_stream_subscriber_idle_timeout_ms, runtime);
+
+DEFINE_int32(change_stream_anchor_release_period_ms, 10 * 1000,
+             "How often to release the WAL anchors of idle change stream "
+             "subscribers. See --change_stream_subscriber_idle_timeout_ms.");
+TAG_FLAG(change_stream_anchor_release_period_ms, experimental);
+TAG_FLAG(change_stream_anchor_release_period_ms, runtime);
+
+using kudu::consensus::ReplicateMsg;
+using kudu::log::LogAnchor;
+using kudu::tablet::TabletReplica;
+using kudu::tablet::TxResultPB;
+using std::lock_guard;
+using std::make_pair;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+ChangeEncoder::ChangeEncoder(const Schema* tablet_schema,
+                             const Schema* projection,
+                             string lower_bound_key,
+                             string exclusive_upper_bound_key)
+    : tablet_schema_(tablet_schema),
+      projection_(projection),
+      lower_bound_key_(std::move(lower_bound_key)),
+      exclusive_upper_bound_key_(std::move(exclusive_upper_bound_key)) {
+  DCHECK_EQ(tablet_schema_->num_key_columns(), projection_->num_key_columns());
+}
+
+bool ChangeEncoder::KeyInBounds(const Slice& key) const {
+  return (lower_bound_key_.empty() || key.compare(lower_bound_key_) >= 0) &&
+      (exclusive_upper_bound_key_.empty() || key.compare(exclusive_upper_bound_key_) < 0);
+}
+
+Status ChangeEncoder::EncodeRangeDelete(const DecodedRowOperation& op,
+                                        RowOperationsPBEncoder* enc) const {
+  faststring encoded_lower;
+  faststring encoded_upper;
+  // The range [lower, upper) overlaps the bounds if it starts before the
+  // upper bound and ends after the lower bound.
+  if (op.row_data && !exclusive_upper_bound_key_.empty() &&
+      tablet_schema_->EncodeComparableKey(ConstContiguousRow(tablet_schema_, op.row_data),
+                                          &encoded_lower).compare(
+                                              exclusive_upper_bound_key_) >= 0) {
+    return Status::OK();
+  }
+  if (op.range_upper_bound && !lower_bound_key_.empty() &&
+      tablet_schema_->EncodeComparableKey(ConstContiguousRow(tablet_schema_, op.range_upper_bound),
+                                          &encoded_upper).compare(lower_bound_key_) <= 0) {
+    return Status::OK();
+  }
+  KuduPartialRow lower_row(projection_);
+  KuduPartialRow upper_row(projection_);
+  for (int i = 0; i < projection_->num_key_columns(); i++) {
+    if (op.row_data) {
+      RETURN_NOT_OK(lower_row.Set(
+          i, ConstContiguousRow(tablet_schema_, op.row_data).cell_ptr(i)));
+    }
+    if (op.range_upper_bound) {
+      RETURN_NOT_OK(upper_row.Set(
+          i, ConstContiguousRow(tablet_schema_, op.range_upper_bound).cell_ptr(i)));
+    }
+  }
+  enc->Add(RowOperationsPB::DELETE_RANGE, lower_row);
+  enc->Add(RowOperationsPB::RANGE_UPPER_BOUND, upper_row);
+  return Status::OK();
+}
+
+Status ChangeEncoder::EncodeChanges(const ReplicateMsg& replicate,
+                                    const TxResultPB& result,
+                                    RowOperationsPB* row_ops) const {
+  DCHECK_EQ(consensus::WRITE_OP, replicate.op_type());
+  const auto& write = replicate.write_request();
+  Schema client_schema;
+  RETURN_NOT_OK(SchemaFromPB(write.schema(), &client_schema));
+
+  Arena arena(32 * 1024);
+  RowOperationsPBDecoder dec(&write.row_operations(), &client_schema, tablet_schema_, &arena);
+  vector<DecodedRowOperation> ops;
+  RETURN_NOT_OK_PREPEND(dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops),
+                        Substitute("could not decode the row operations of op $0",
+                                   consensus::OpIdToString(replicate.id())));
+  if (PREDICT_FALSE(ops.size() != static_cast<size_t>(result.ops_size()))) {
+    return Status::Corruption(Substitute("op $0 has $1 row operations but $2 results",
+                                         consensus::OpIdToString(replicate.id()),
+                                         ops.size(), result.ops_size()));
+  }
+
+  RowOperationsPBEncoder enc(row_ops);
+  faststring encoded_key;
+  for (int op_idx = 0; op_idx < result.ops_size(); op_idx++) {
+    const auto& op = ops[op_idx];
+    const auto& op_result = result.ops(op_idx);
+    // The op failed, as it was prepared or applied, e.g. a duplicate insert
+    // or an update of a missing row.
+    if (!op.result.ok() || op_result.has_failed_status()) {
+      continue;
+    }
+    if (op.type == RowOperationsPB::DELETE_RANGE) {
+      RETURN_NOT_OK(EncodeRangeDelete(op, &enc));
+      continue;
+    }
+    // The error of the op was ignored, so it changed no row.
+    if ((op.type == RowOperationsPB::INSERT_IGNORE ||
+         op.type == RowOperationsPB::UPDATE_IGNORE ||
+         op.type == RowOperationsPB::DELETE_IGNORE) &&
+        op_result.mutated_stores_size() == 0) {
+      continue;
+    }
+    // For updates and deletes, only the key cells of the row are set.
+    ConstContiguousRow row(tablet_schema_, op.row_data);
+    if (!KeyInBounds(tablet_schema_->EncodeComparableKey(row, &encoded_key))) {
+      continue;
+    }
+
+    KuduPartialRow projected_row(projection_);
+    for (int i = 0; i < projection_->num_key_columns(); i++) {
+      RETURN_NOT_OK(projected_row.Set(i, row.cell_ptr(i)));
+    }
+    switch (op.type) {
+      case RowOperationsPB::INSERT:
+      case RowOperationsPB::INSERT_IGNORE:
+      case RowOperationsPB::UPSERT:
+        for (int i = projection_->num_key_columns(); i < projection_->num_columns(); i++) {
+          const int tablet_col_idx = tablet_schema_->find_column(projection_->column(i).name());
+          DCHECK_NE(Schema::kColumnNotFound, tablet_col_idx);
+          // The cells of an UPSERT which weren't set keep their values if the
+          // row exists, rather than taking their defaults.
+          if (op.type == RowOperationsPB::UPSERT &&
+              !BitmapTest(op.isset_bitmap, tablet_col_idx)) {
+            continue;
+          }
+          if (tablet_schema_->column(tablet_col_idx).is_nullable() &&
+              row.is_null(tablet_col_idx)) {
+            RETURN_NOT_OK(projected_row.SetNull(i));
+          } else {
+            RETURN_NOT_OK(projected_row.Set(i, row.cell_ptr(tablet_col_idx)));
+          }
+        }
+        break;
+      case RowOperationsPB::UPDATE:
+      case RowOperationsPB::UPDATE_IGNORE: {
+        RowChangeListDecoder decoder(op.changelist);
+        RETURN_NOT_OK(decoder.Init());
+        bool updated_projected_column = false;
+        while (decoder.HasNext()) {
+          RowChangeListDecoder::DecodedUpdate update;
+          RETURN_NOT_OK(decoder.DecodeNext(&update));
+          int tablet_col_idx;
+          const void* value;
+          RETURN_NOT_OK(update.Validate(*tablet_schema_, &tablet_col_idx, &value));
+          if (tablet_col_idx == Schema::kColumnNotFound) {
+            continue;
+          }
+          const int col_idx = projection_->find_column(
+              tablet_schema_->column(tablet_col_idx).name());
+          if (col_idx == Schema::kColumnNotFound) {
+            continue;
+          }
+          updated_projected_column = true;
+          if (update.null) {
+            RETURN_NOT_OK(projected_row.SetNull(col_idx));
+          } else {
+            RETURN_NOT_OK(projected_row.Set(col_idx, static_cast<const uint8_t*>(value)));
+          }
+        }
+        // The update doesn't change the projected columns.
+        if (!updated_projected_column) {
+          continue;
+        }
+        break;
+      }
+      case RowOperationsPB::DELETE:
+      case RowOperationsPB::DELETE_IGNORE:
+        break;
+      default:
+        return Status::Corruption(Substitute("unexpected row operation in op $0: $1",
+                                             consensus::OpIdToString(replicate.id()),
+                                             RowOperationsPB::Type_Name(op.type)));
+    }
+    enc.Add(op.type, projected_row);
+  }
+  return Status::OK();
+}
+
+ChangeStreamManager::ChangeStreamManager()
+    : shutdown_latch_(1) {
+}
+
+ChangeStreamManager::~ChangeStreamManager() {
+  Shutdown();
+}
+
+Status ChangeStreamManager::Start() {
+  return Thread::Create("change-streams", "anchor-release",
+                        [this]() { this->RunReleaseThread(); },
+                        &release_thread_);
+}
+
+void ChangeStreamManager::Shutdown() {
+  shutdown_latch_.CountDown();
+  if (release_thread_) {
+    release_thread_->Join();
+    release_thread_.reset();
+  }
+  SubscriptionMap subscriptions;
+  {
+    lock_guard<std::mutex> l(lock_);
+    subscriptions.swap(subscriptions_);
+  }
+  for (auto& e : subscriptions) {
+    WARN_NOT_OK(e.second.registry->UnregisterIfAnchored(e.second.anchor.get()),
+                "could not release the WAL anchor of a change stream subscriber");
+  }
+}
+
+Status ChangeStreamManager::AnchorLog(const TabletReplica& replica,
+                                      const string& subscriber_id,
+                                      int64_t log_index) {
+  const string owner = Substitute("ChangeStream-$0", subscriber_id);
+  lock_guard<std::mutex> l(lock_);
+  auto& subscription = subscriptions_[make_pair(replica.tablet_id(), subscriber_id)];
+  // The tablet's replica may have been replaced, e.g. by a tablet copy.
+  if (subscription.registry != replica.log_anchor_registry()) {
+    if (subscription.registry) {
+      RETURN_NOT_OK(subscription.registry->UnregisterIfAnchored(subscription.anchor.get()));
+    }
+    subscription.registry = replica.log_anchor_registry();
+    subscription.anchor.reset(new LogAnchor);
+  }
+  subscription.last_access = MonoTime::Now();
+  return subscription.registry->RegisterOrUpdate(log_index, owner, subscription.anchor.get());
+}
+
+void ChangeStreamManager::ReleaseIdleAnchors() {
+  const MonoTime deadline =
+      MonoTime::Now() - MonoDelta::FromMilliseconds(FLAGS_change_stream_subscriber_idle_timeout_ms);
+  lock_guard<std::mutex> l(lock_);
+  for (auto it = subscriptions_.begin(); it != subscriptions_.end();) {
+    if (it->second.last_access < deadline) {
+      VLOG(1) << Substitute("Releasing the WAL anchor of idle change stream subscriber $0 "
+                            "of tablet $1", it->first.second, it->first.first);
+      WARN_NOT_OK(it->second.registry->UnregisterIfAnchored(it->second.anchor.get()),
+                  "could not release the WAL anchor of a change stream subscriber");
+      it = subscriptions_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ChangeStreamManager::RunReleaseThread() {
+  while (!shutdown_latch_.WaitFor(MonoDelta::FromMilliseconds(
+             FLAGS_change_stream_anchor_release_period_ms))) {
+    ReleaseIdleAnchors();
+  }
+}
+
+size_t ChangeStreamManager::num_anchors() const {
+  lock_guard<std::mutex> l(lock_);
+  return subscriptions_.size();
+}
+
+} // namespace tserver
+} // namespace kudu
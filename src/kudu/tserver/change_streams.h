@@ -0,0 +1,152 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "kudu/consensus/log_anchor_registry.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class RowOperationsPB;
+class RowOperationsPBEncoder;
+class Schema;
+class Slice;
+struct DecodedRowOperation;
+
+namespace consensus {
+class ReplicateMsg;
+} // namespace consensus
+
+class Thread;
+
+namespace tablet {
+class TabletReplica;
+class TxResultPB;
+} // namespace tablet
+
+namespace tserver {
+
+// Converts the row operations of write ops read from a tablet's WAL into the
+// changes returned by the GetChanges RPC.
+class ChangeEncoder {
+ public:
+  // 'projection' must have the key columns of 'tablet_schema' followed by
+  // some of its other columns, without column IDs. Both must outlive this
+  // object. The key bounds are encoded keys, and empty if unbounded.
+  ChangeEncoder(const Schema* tablet_schema,
+                const Schema* projection,
+                std::string lower_bound_key,
+                std::string exclusive_upper_bound_key);
+
+  // Encodes the row operations of the write op 'replicate' of the rows whose
+  // keys are in the bounds into 'row_ops', with the cells of the projected
+  // columns. 'result' is the result of the op from its COMMIT: the row
+  // operations which failed or were ignored when applied are skipped.
+  //
+  // A DELETE_RANGE whose range overlaps the bounds is encoded with its own
+  // bounds, followed by their RANGE_UPPER_BOUND, regardless of the bounds.
+  //
+  // The row operations are decoded according to the current schema of the
+  // tablet, so this fails for a write to a column which was since dropped.
+  Status EncodeChanges(const consensus::ReplicateMsg& replicate,
+                       const tablet::TxResultPB& result,
+                       RowOperationsPB* row_ops) const;
+
+ private:
+  // Returns whether the key 'key' is in the bounds.
+  bool KeyInBounds(const Slice& key) const;
+
+  // Encodes the range delete 'op' into 'enc' if its range overlaps the
+  // bounds.
+  Status EncodeRangeDelete(const DecodedRowOperation& op, RowOperationsPBEncoder* enc) const;
+
+  const Schema* const tablet_schema_;
+  const Schema* const projection_;
+  const std::string lower_bound_key_;
+  const std::string exclusive_upper_bound_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeEncoder);
+};
+
+// Keeps the WALs of tablet replicas from being garbage collected past the
+// positions their change stream subscribers read from next.
+//
+// The anchors of the subscribers which haven't read any changes for longer
+// than --change_stream_subscriber_idle_timeout_ms are released periodically.
+//
+// This class is thread-safe.
+class ChangeStreamManager {
+ public:
+  ChangeStreamManager();
+  ~ChangeStreamManager();
+
+  // Starts the thread which releases the anchors of idle subscribers.
+  Status Start();
+
+  // Stops releasing the anchors of idle subscribers, and releases all of
+  // them.
+  void Shutdown();
+
+  // Anchors the WAL of 'replica' at 'log_index', the next index the
+  // subscriber 'subscriber_id' reads from.
+  Status AnchorLog(const tablet::TabletReplica& replica,
+                   const std::string& subscriber_id,
+                   int64_t log_index);
+
+  // Releases the anchors of the subscribers idle for longer than
+  // --change_stream_subscriber_idle_timeout_ms.
+  void ReleaseIdleAnchors();
+
+  size_t num_anchors() const;
+
+ private:
+  // Calls ReleaseIdleAnchors() periodically, until shut down.
+  void RunReleaseThread();
+
+  struct Subscription {
+    scoped_refptr<log::LogAnchorRegistry> registry;
+    // Registered with 'registry', so it must not move.
+    std::unique_ptr<log::LogAnchor> anchor;
+    MonoTime last_access;
+  };
+
+  // Subscriptions keyed by tablet ID and subscriber ID.
+  typedef std::map<std::pair<std::string, std::string>, Subscription> SubscriptionMap;
+
+  mutable std::mutex lock_;
+  SubscriptionMap subscriptions_;
+
+  CountDownLatch shutdown_latch_;
+  scoped_refptr<Thread> release_thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeStreamManager);
+};
+
+} // namespace tserver
+} // namespace kudu
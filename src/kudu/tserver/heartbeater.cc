@@ -26,6 +26,7 @@
 #include <ostream>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -39,6 +40,7 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/replica_management.pb.h"
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -53,9 +55,11 @@
 #include "kudu/security/token_verifier.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/webserver.h"
+#include "kudu/tserver/quota_manager.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
@@ -64,6 +68,7 @@
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
+#include "kudu/util/oid_generator.h"
 #include "kudu/util/openssl_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
@@ -109,12 +114,14 @@ using kudu::consensus::ReplicaManagementInfoPB;
 using kudu::master::MasterErrorPB;
 using kudu::master::MasterFeatures;
 using kudu::master::MasterServiceProxy;
+using kudu::master::TabletReportCheckpointPB;
 using kudu::master::TabletReportPB;
 using kudu::pb_util::SecureDebugString;
 using kudu::rpc::ErrorStatusPB;
 using kudu::rpc::RpcController;
 using std::string;
 using std::unique_ptr;
+using std::unordered_set;
 using std::vector;
 using strings::Substitute;
 
@@ -122,13 +129,84 @@ namespace kudu {
 
 namespace tserver {
 
+// The versions of the changes to the tablets hosted by this server, shared by
+// all the heartbeat threads. A master which has a checkpoint of this server's
+// tablet reports (i.e. knows about all the changes older than the version in
+// the checkpoint) can be sent the tablets that changed since instead of a
+// full tablet report.
+class Heartbeater::ChangeLog {
+ public:
+  ChangeLog()
+      : epoch_(ObjectIdGenerator().Next()),
+        next_version_(0) {
+  }
+
+  // Stamps a change to the given tablets with a new version, and calls
+  // 'mark_dirty' before any checkpoint can cover the change.
+  void RecordChange(const vector<string>& tablet_ids,
+                    const std::function<void()>& mark_dirty) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    const int64_t version = next_version_++;
+    for (const auto& tablet_id : tablet_ids) {
+      versions_[tablet_id] = version;
+    }
+    mark_dirty();
+  }
+
+  // Returns a checkpoint which covers every change recorded so far. Any
+  // tablet marked dirty by then has been marked dirty before this returns.
+  TabletReportCheckpointPB Checkpoint() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return CheckpointUnlocked();
+  }
+
+  // If 'since' is a checkpoint of this server's current epoch, appends the
+  // tablets that changed since it to 'tablet_ids', sets 'checkpoint' to one
+  // which covers every change recorded so far, and returns true.
+  bool ChangesSince(const TabletReportCheckpointPB& since,
+                    vector<string>* tablet_ids,
+                    TabletReportCheckpointPB* checkpoint) const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (since.report_epoch() != epoch_ || since.version() > next_version_) {
+      return false;
+    }
+    for (const auto& tablet_and_version : versions_) {
+      if (tablet_and_version.second >= since.version()) {
+        tablet_ids->emplace_back(tablet_and_version.first);
+      }
+    }
+    *checkpoint = CheckpointUnlocked();
+    return true;
+  }
+
+ private:
+  TabletReportCheckpointPB CheckpointUnlocked() const {
+    DCHECK(lock_.is_locked());
+    TabletReportCheckpointPB checkpoint;
+    checkpoint.set_report_epoch(epoch_);
+    checkpoint.set_version(next_version_);
+    return checkpoint;
+  }
+
+  // A new epoch is picked every time the server starts.
+  const string epoch_;
+
+  mutable simple_spinlock lock_;
+
+  // Protected by 'lock_'.
+  int64_t next_version_;
+  std::unordered_map<string, int64_t> versions_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeLog);
+};
+
 // Most of the actual logic of the heartbeater is inside this inner class,
 // to avoid having too many dependencies from the header itself.
 //
 // This is basically the "PIMPL" pattern.
 class Heartbeater::Thread {
  public:
-  Thread(HostPort master_address, TabletServer* server);
+  Thread(HostPort master_address, TabletServer* server, ChangeLog* changes);
 
   Status Start();
   Status Stop();
@@ -137,6 +215,12 @@ class Heartbeater::Thread {
   void GenerateIncrementalTabletReport(TabletReportPB* report);
   void GenerateFullTabletReport(TabletReportPB* report);
 
+  // Generates a report of the tablets that changed since 'since', to be sent
+  // in place of a full tablet report. Returns false if 'since' isn't a
+  // checkpoint of this server's current epoch.
+  bool GenerateResyncTabletReport(const TabletReportCheckpointPB& since,
+                                  TabletReportPB* report);
+
   // Mark that the master successfully received and processed the given
   // tablet report. This uses the report sequence number to "un-dirty" any
   // tablets which have not changed since the acknowledged report.
@@ -146,6 +230,10 @@ class Heartbeater::Thread {
   void RunThread();
   Status ConnectToMaster();
   int GetMinimumHeartbeatMillis() const;
+
+  // Sets the capacity and free space of the filesystems of the server's data
+  // directories in 'req', counting each filesystem once.
+  void PopulateDiskSpace(master::TSHeartbeatRequestPB* req) const;
   int GetMillisUntilNextHeartbeat() const;
   Status DoHeartbeat(MasterErrorPB* error, ErrorStatusPB* error_status);
   Status SetupRegistration(ServerRegistrationPB* reg);
@@ -164,6 +252,9 @@ class Heartbeater::Thread {
   // The server for which we are heartbeating.
   TabletServer* const server_;
 
+  // The versions of the changes to the server's tablets.
+  ChangeLog* const changes_;
+
   // The actual running thread (NULL before it is started)
   scoped_refptr<kudu::Thread> thread_;
 
@@ -219,10 +310,11 @@ class Heartbeater::Thread {
 // Heartbeater
 ////////////////////////////////////////////////////////////
 
-Heartbeater::Heartbeater(UnorderedHostPortSet master_addrs, TabletServer* server) {
+Heartbeater::Heartbeater(UnorderedHostPortSet master_addrs, TabletServer* server)
+    : changes_(new ChangeLog) {
   DCHECK_GT(master_addrs.size(), 0);
   for (auto addr : master_addrs) {
-    threads_.emplace_back(new Thread(std::move(addr), server));
+    threads_.emplace_back(new Thread(std::move(addr), server, changes_.get()));
   }
 }
 Heartbeater::~Heartbeater() {
@@ -265,9 +357,11 @@ void Heartbeater::TriggerASAP() {
 }
 
 void Heartbeater::MarkTabletsDirty(const vector<string>& tablet_ids, const string& reason) {
-  for (const auto& thread : threads_) {
-    thread->MarkTabletsDirty(tablet_ids, reason);
-  }
+  changes_->RecordChange(tablet_ids, [&]() {
+    for (const auto& thread : threads_) {
+      thread->MarkTabletsDirty(tablet_ids, reason);
+    }
+  });
 }
 
 vector<TabletReportPB> Heartbeater::GenerateIncrementalTabletReportsForTests() {
@@ -303,9 +397,11 @@ void Heartbeater::MarkTabletReportsAcknowledgedForTests(
 // Heartbeater::Thread
 ////////////////////////////////////////////////////////////
 
-Heartbeater::Thread::Thread(HostPort master_address, TabletServer* server)
+Heartbeater::Thread::Thread(HostPort master_address, TabletServer* server,
+                            ChangeLog* changes)
   : master_address_(std::move(master_address)),
     server_(server),
+    changes_(changes),
     consecutive_failed_heartbeats_(0),
     next_report_seq_(0),
     cond_(&mutex_),
@@ -380,6 +476,30 @@ int Heartbeater::Thread::GetMinimumHeartbeatMillis() const {
     FLAGS_heartbeat_interval_ms : 0;
 }
 
+void Heartbeater::Thread::PopulateDiskSpace(master::TSHeartbeatRequestPB* req) const {
+  FsManager* fs_manager = server_->fs_manager();
+  unordered_set<uint64_t> filesystem_ids;
+  int64_t capacity_bytes = 0;
+  int64_t free_bytes = 0;
+  for (const auto& dir : fs_manager->GetDataRootDirs()) {
+    SpaceInfo space_info;
+    Status s = fs_manager->env()->GetSpaceInfo(dir, &space_info);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << Substitute(
+          "could not get space info of data directory $0: $1", dir, s.ToString());
+      continue;
+    }
+    if (InsertIfNotPresent(&filesystem_ids, space_info.filesystem_id)) {
+      capacity_bytes += space_info.capacity_bytes;
+      free_bytes += space_info.free_bytes;
+    }
+  }
+  if (capacity_bytes > 0) {
+    req->set_data_dirs_capacity_bytes(capacity_bytes);
+    req->set_data_dirs_free_bytes(free_bytes);
+  }
+}
+
 int Heartbeater::Thread::GetMillisUntilNextHeartbeat() const {
   // If the master needs something from us, we should immediately
   // send another heartbeat with that info, rather than waiting for the interval.
@@ -461,7 +581,17 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
   // send us knew ones if they exist.
   req.set_latest_tsk_seq_num(server_->token_verifier().GetMaxKnownKeySequenceNumber());
 
-  if (send_full_tablet_report_) {
+  const bool needs_full_report =
+      send_full_tablet_report_ || last_hb_response_.needs_full_tablet_report();
+  if (needs_full_report && last_hb_response_.has_tablet_report_checkpoint() &&
+      GenerateResyncTabletReport(last_hb_response_.tablet_report_checkpoint(),
+                                 req.mutable_tablet_report())) {
+    LOG(INFO) << Substitute(
+        "Master $0 has a checkpoint of our tablet reports, sending the $1 tablets "
+        "changed since it in place of a full tablet report...",
+        master_address_.ToString(), req.tablet_report().updated_tablets_size() +
+        req.tablet_report().removed_tablet_ids_size());
+  } else if (send_full_tablet_report_) {
     LOG(INFO) << Substitute(
         "Master $0 was elected leader, sending a full tablet report...",
         master_address_.ToString());
@@ -481,9 +611,15 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
   }
 
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
+  PopulateDiskSpace(&req);
   auto num_live_tablets_by_dimension = server_->tablet_manager()->GetNumLiveTabletsByDimension();
   req.mutable_num_live_tablets_by_dimension()->insert(num_live_tablets_by_dimension.begin(),
                                                       num_live_tablets_by_dimension.end());
+  // Only the leader master splits the quotas: the usage is reported to it
+  // alone, and is lost if it isn't the leader anymore.
+  if (last_hb_response_.leader_master()) {
+    server_->quota_manager()->TakeUsage(req.mutable_quota_usages());
+  }
 
   VLOG(2) << "Sending heartbeat:\n" << SecureDebugString(req);
   master::TSHeartbeatResponsePB resp;
@@ -510,6 +646,10 @@ Status Heartbeater::Thread::DoHeartbeat(MasterErrorPB* error,
     send_full_tablet_report_ = false;
   }
 
+  if (resp.leader_master() && resp.has_quota_shares()) {
+    server_->quota_manager()->SetShares(resp.quota_shares());
+  }
+
   last_hb_response_.Swap(&resp);
 
   for (const auto& ca_cert_der : last_hb_response_.ca_cert_der()) {
@@ -716,6 +856,9 @@ void Heartbeater::Thread::GenerateIncrementalTabletReport(TabletReportPB* report
   report->Clear();
   report->set_sequence_number(next_report_seq_.fetch_add(1));
   report->set_is_incremental(true);
+  // Taken before looking at the dirty tablets, so that the report includes
+  // every change the checkpoint covers and this master hasn't acknowledged.
+  *report->mutable_checkpoint() = changes_->Checkpoint();
   vector<string> dirty_tablet_ids;
   {
     std::lock_guard<simple_spinlock> l(dirty_tablets_lock_);
@@ -729,9 +872,33 @@ void Heartbeater::Thread::GenerateFullTabletReport(TabletReportPB* report) {
   report->Clear();
   report->set_sequence_number(next_report_seq_.fetch_add(1));
   report->set_is_incremental(false);
+  *report->mutable_checkpoint() = changes_->Checkpoint();
   server_->tablet_manager()->PopulateFullTabletReport(report);
 }
 
+bool Heartbeater::Thread::GenerateResyncTabletReport(const TabletReportCheckpointPB& since,
+                                                     TabletReportPB* report) {
+  report->Clear();
+  // As in an incremental report, the sequence number is taken before looking
+  // at the dirty tablets.
+  report->set_sequence_number(next_report_seq_.fetch_add(1));
+  report->set_is_incremental(true);
+  vector<string> tablet_ids;
+  if (!changes_->ChangesSince(since, &tablet_ids, report->mutable_checkpoint())) {
+    return false;
+  }
+  {
+    std::lock_guard<simple_spinlock> l(dirty_tablets_lock_);
+    AppendKeysFromMap(dirty_tablets_, &tablet_ids);
+  }
+  const unordered_set<string> unique_ids(tablet_ids.begin(), tablet_ids.end());
+  tablet_ids.assign(unique_ids.begin(), unique_ids.end());
+
+  report->set_resync_since_version(since.version());
+  server_->tablet_manager()->PopulateIncrementalTabletReport(report, tablet_ids);
+  return true;
+}
+
 Status Heartbeater::Thread::MasterServiceProxyForHostPort(
     unique_ptr<MasterServiceProxy>* proxy) {
   vector<Sockaddr> addrs;
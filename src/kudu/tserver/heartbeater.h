@@ -27,10 +27,10 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
-
-namespace master {
-class TabletReportPB;
-}
+
+namespace master {
+class TabletReportPB;
+}
 
 namespace tserver {
 
@@ -56,7 +56,9 @@ class Heartbeater {
   //
   // Tablet dirtiness is tracked separately for each master. Dirty tablets are
   // included in the heartbeat's tablet report, and only marked not dirty once
-  // the report has been acknowledged by the master.
+  // the report has been acknowledged by the master. The change is also
+  // stamped with a new version, so that a master with a checkpoint of this
+  // server's reports can be sent just the tablets that changed since.
   void MarkTabletsDirty(const std::vector<std::string>& tablet_ids, const std::string& reason);
 
   ~Heartbeater();
@@ -69,10 +71,13 @@ class Heartbeater {
       const std::vector<master::TabletReportPB>& reports);
 
  private:
+  class ChangeLog;
   class Thread;
 
   FRIEND_TEST(TsTabletManagerITest, TestDeduplicateMasterAddrsForHeartbeaters);
 
+  // Shared by the threads, so must outlive them.
+  std::unique_ptr<ChangeLog> changes_;
   std::vector<std::unique_ptr<Thread>> threads_;
   DISALLOW_COPY_AND_ASSIGN(Heartbeater);
 };
@@ -0,0 +1,124 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/quota_manager.h"
+
+#include <string>
+
+#include <google/protobuf/repeated_field.h>
+#include <gtest/gtest.h>
+
+#include "kudu/master/master.pb.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using kudu::master::QuotaPB;
+using kudu::master::QuotaSharesPB;
+using kudu::master::QuotaUsagePB;
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+void AddShare(QuotaPB::Kind kind, const string& key, double write_rpcs,
+              double write_bytes, double scan_rpcs, QuotaSharesPB* shares) {
+  QuotaPB* share = shares->add_shares();
+  share->set_kind(kind);
+  share->set_key(key);
+  share->set_write_rpcs_per_sec(write_rpcs);
+  share->set_write_bytes_per_sec(write_bytes);
+  share->set_scan_rpcs_per_sec(scan_rpcs);
+}
+
+} // anonymous namespace
+
+TEST(QuotaManagerTest, TestAdmit) {
+  QuotaManager manager;
+  // With no shares, nothing is limited.
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(manager.AdmitWrite("table", "alice", 1000));
+    ASSERT_TRUE(manager.AdmitScan("table", "alice"));
+  }
+
+  // Shares which allow no more than a few operations before their token
+  // buckets are refilled.
+  QuotaSharesPB shares;
+  AddShare(QuotaPB::TABLE, "table", 10, 0, 0, &shares);
+  AddShare(QuotaPB::USER, "alice", 0, 100, 10, &shares);
+  manager.SetShares(shares);
+  int writes = 0;
+  int scans = 0;
+  for (int i = 0; i < 100; i++) {
+    writes += manager.AdmitWrite("table", "bob", 1);
+    scans += manager.AdmitScan("other_table", "alice");
+  }
+  EXPECT_LT(writes, 100);
+  EXPECT_LT(scans, 100);
+  EXPECT_FALSE(manager.AdmitWrite("other_table", "alice", 1000));
+
+  // The usage is that of the operations admitted, accounted for by both
+  // shares, and the shares which rejected operations are throttled.
+  google::protobuf::RepeatedPtrField<QuotaUsagePB> usages;
+  manager.TakeUsage(&usages);
+  ASSERT_EQ(2, usages.size());
+  for (const auto& usage : usages) {
+    EXPECT_TRUE(usage.throttled());
+    if (usage.usage().kind() == QuotaPB::TABLE) {
+      EXPECT_EQ("table", usage.usage().key());
+      EXPECT_GT(usage.usage().write_rpcs_per_sec(), 0);
+      EXPECT_EQ(0, usage.usage().scan_rpcs_per_sec());
+    } else {
+      EXPECT_EQ("alice", usage.usage().key());
+      EXPECT_GT(usage.usage().scan_rpcs_per_sec(), 0);
+      EXPECT_EQ(0, usage.usage().write_rpcs_per_sec());
+    }
+  }
+
+  // The usage was reset.
+  manager.TakeUsage(&usages);
+  ASSERT_EQ(2, usages.size());
+  for (const auto& usage : usages) {
+    EXPECT_FALSE(usage.throttled());
+    EXPECT_EQ(0, usage.usage().write_rpcs_per_sec());
+    EXPECT_EQ(0, usage.usage().scan_rpcs_per_sec());
+  }
+
+  // Without shares, nothing is limited anymore.
+  manager.SetShares(QuotaSharesPB());
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(manager.AdmitWrite("table", "alice", 1000));
+  }
+  manager.TakeUsage(&usages);
+  EXPECT_TRUE(usages.empty());
+}
+
+// Writes larger than what a share's rate refills within its burst are still
+// admitted, once the bytes they need were refilled.
+TEST(QuotaManagerTest, TestAdmitLargeWrite) {
+  QuotaManager manager;
+  QuotaSharesPB shares;
+  AddShare(QuotaPB::TABLE, "table", 0, 1000 * 1000, 0, &shares);
+  manager.SetShares(shares);
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_TRUE(manager.AdmitWrite("table", "alice", 200 * 1000));
+  });
+}
+
+} // namespace tserver
+} // namespace kudu
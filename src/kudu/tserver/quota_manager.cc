@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/quota_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/map-util.h"
+#include "kudu/master/master.pb.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/throttler.h"
+
+DEFINE_double(quota_burst_factor, 1.0,
+              "The burst factor of the token buckets enforcing the shares of the "
+              "table and user quotas: how many times the share's rate may be used "
+              "within a 100ms period after a quieter one.");
+TAG_FLAG(quota_burst_factor, experimental);
+TAG_FLAG(quota_burst_factor, advanced);
+
+DECLARE_int64(rpc_max_message_size);
+
+using kudu::master::QuotaPB;
+using kudu::master::QuotaSharesPB;
+using kudu::master::QuotaUsagePB;
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// A Throttler rate of 0 isn't limited, so the shares are at least 1/s.
+uint64_t ShareRate(double rate) {
+  if (rate <= 0) {
+    return 0;
+  }
+  return std::max<uint64_t>(1, std::llround(rate));
+}
+
+} // anonymous namespace
+
+struct QuotaManager::Share {
+  Share(const QuotaPB& quota, MonoTime now) {
+    const uint64_t write_rpcs = ShareRate(quota.write_rpcs_per_sec());
+    if (write_rpcs > 0) {
+      write_throttler.reset(new Throttler(now, write_rpcs, 0, FLAGS_quota_burst_factor));
+    }
+    // The byte bucket must hold the largest write RPCs, or they'd never be
+    // admitted, however long they're retried.
+    const uint64_t write_bytes = ShareRate(quota.write_bytes_per_sec());
+    if (write_bytes > 0) {
+      const double burst_factor = std::max(
+          FLAGS_quota_burst_factor,
+          static_cast<double>(FLAGS_rpc_max_message_size) * Throttler::kRefillsPerSecond /
+              write_bytes);
+      write_bytes_throttler.reset(new Throttler(now, 0, write_bytes, burst_factor));
+    }
+    const uint64_t scan_rpcs = ShareRate(quota.scan_rpcs_per_sec());
+    if (scan_rpcs > 0) {
+      scan_throttler.reset(new Throttler(now, scan_rpcs, 0, FLAGS_quota_burst_factor));
+    }
+  }
+
+  // Moves the usage accounted for by 'other' to this share.
+  void TakeUsageFrom(Share* other) {
+    write_rpcs += other->write_rpcs.exchange(0);
+    write_bytes += other->write_bytes.exchange(0);
+    scan_rpcs += other->scan_rpcs.exchange(0);
+    if (other->throttled.exchange(false)) {
+      throttled = true;
+    }
+  }
+
+  // nullptr if the quota doesn't limit the write RPCs, the write bytes, or
+  // the scans.
+  unique_ptr<Throttler> write_throttler;
+  unique_ptr<Throttler> write_bytes_throttler;
+  unique_ptr<Throttler> scan_throttler;
+
+  // The usage of the share since the last TakeUsage(), and whether any
+  // operation was rejected.
+  std::atomic<int64_t> write_rpcs { 0 };
+  std::atomic<int64_t> write_bytes { 0 };
+  std::atomic<int64_t> scan_rpcs { 0 };
+  std::atomic<bool> throttled { false };
+};
+
+QuotaManager::QuotaManager()
+    : usage_start_(MonoTime::Now()) {
+}
+
+QuotaManager::~QuotaManager() {}
+
+void QuotaManager::SetShares(const QuotaSharesPB& shares) {
+  const MonoTime now = MonoTime::Now();
+  ShareMap table_shares;
+  ShareMap user_shares;
+  for (const auto& quota : shares.shares()) {
+    ShareMap* map;
+    switch (quota.kind()) {
+      case QuotaPB::TABLE:
+        map = &table_shares;
+        break;
+      case QuotaPB::USER:
+        map = &user_shares;
+        break;
+      default:
+        LOG(DFATAL) << "unknown kind of quota: " << quota.kind();
+        continue;
+    }
+    (*map)[quota.key()] = std::make_shared<Share>(quota, now);
+  }
+
+  std::lock_guard<rw_spinlock> l(lock_);
+  for (const auto& maps : { std::make_pair(&table_shares, &table_shares_),
+                            std::make_pair(&user_shares, &user_shares_) }) {
+    for (auto& e : *maps.first) {
+      const auto* old_share = FindOrNull(*maps.second, e.first);
+      if (old_share) {
+        e.second->TakeUsageFrom(old_share->get());
+      }
+    }
+    maps.second->swap(*maps.first);
+  }
+}
+
+bool QuotaManager::Admit(const ShareMap& shares, const string& key,
+                         Operation op, int64_t bytes) {
+  const auto* share_ptr = FindOrNull(shares, key);
+  if (!share_ptr) {
+    return true;
+  }
+  Share* share = share_ptr->get();
+  const MonoTime now = MonoTime::Now();
+  Throttler* throttler = op == WRITE ? share->write_throttler.get() :
+                                       share->scan_throttler.get();
+  // Like with the table and user shares, the RPC token isn't given back if
+  // the bytes are throttled.
+  if ((throttler && !throttler->Take(now, 1, 0)) ||
+      (op == WRITE && share->write_bytes_throttler &&
+       !share->write_bytes_throttler->Take(now, 0, bytes))) {
+    share->throttled = true;
+    return false;
+  }
+  if (op == WRITE) {
+    share->write_rpcs++;
+    share->write_bytes += bytes;
+  } else {
+    share->scan_rpcs++;
+  }
+  return true;
+}
+
+bool QuotaManager::AdmitWrite(const string& table_id, const string& user, int64_t bytes) {
+  // The tokens taken from the table's share aren't given back if the user's
+  // share rejects the write: the table's quota is used up a bit early, only
+  // while the user's quota is exceeded anyway.
+  shared_lock<rw_spinlock> l(lock_);
+  return Admit(table_shares_, table_id, WRITE, bytes) &&
+         Admit(user_shares_, user, WRITE, bytes);
+}
+
+bool QuotaManager::AdmitScan(const string& table_id, const string& user) {
+  shared_lock<rw_spinlock> l(lock_);
+  return Admit(table_shares_, table_id, SCAN, 0) &&
+         Admit(user_shares_, user, SCAN, 0);
+}
+
+void QuotaManager::TakeUsage(google::protobuf::RepeatedPtrField<QuotaUsagePB>* usages) {
+  usages->Clear();
+  const MonoTime now = MonoTime::Now();
+  std::lock_guard<rw_spinlock> l(lock_);
+  const double secs = std::max((now - usage_start_).ToSeconds(), 0.001);
+  usage_start_ = now;
+  for (const auto& kind_and_map : { std::make_pair(QuotaPB::TABLE, &table_shares_),
+                                    std::make_pair(QuotaPB::USER, &user_shares_) }) {
+    for (const auto& e : *kind_and_map.second) {
+      Share* share = e.second.get();
+      QuotaUsagePB* usage = usages->Add();
+      QuotaPB* rates = usage->mutable_usage();
+      rates->set_kind(kind_and_map.first);
+      rates->set_key(e.first);
+      rates->set_write_rpcs_per_sec(share->write_rpcs.exchange(0) / secs);
+      rates->set_write_bytes_per_sec(share->write_bytes.exchange(0) / secs);
+      rates->set_scan_rpcs_per_sec(share->scan_rpcs.exchange(0) / secs);
+      usage->set_throttled(share->throttled.exchange(false));
+    }
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,99 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <google/protobuf/repeated_field.h> // IWYU pragma: keep
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+namespace master {
+class QuotaSharesPB;
+class QuotaUsagePB;
+} // namespace master
+
+namespace tserver {
+
+// Enforces this tablet server's shares of the quotas of tables and users.
+//
+// A quota limits the rates of the writes and of the scans of a table, or of
+// a user, across the cluster. The leader master splits each quota into shares,
+// one per tablet server, in proportion to the usage reported in the tablet
+// servers' heartbeats: see master::QuotaTracker. Here, the shares are enforced
+// by token buckets, and their usage is accounted for, to be reported in the
+// next heartbeat to the leader master.
+//
+// The tables and users with no share aren't limited, e.g. before the first
+// heartbeat response from the leader master.
+//
+// Thread-safe.
+class QuotaManager {
+ public:
+  QuotaManager();
+  ~QuotaManager();
+
+  // Replaces the shares enforced with 'shares'. The usage accounted for the
+  // tables and users with a share before and after is kept.
+  void SetShares(const master::QuotaSharesPB& shares);
+
+  // Returns whether a write of 'bytes' bytes to the table 'table_id' by the
+  // user 'user' fits in the shares of the quotas of both, accounting for it if
+  // it does.
+  bool AdmitWrite(const std::string& table_id, const std::string& user, int64_t bytes);
+
+  // Same for a new scan of the table 'table_id' by the user 'user'.
+  bool AdmitScan(const std::string& table_id, const std::string& user);
+
+  // Sets 'usages' to the rates at which the shares were used since the last
+  // call, and starts accounting anew.
+  void TakeUsage(google::protobuf::RepeatedPtrField<master::QuotaUsagePB>* usages);
+
+ private:
+  struct Share;
+  typedef std::unordered_map<std::string, std::shared_ptr<Share>> ShareMap;
+
+  enum Operation {
+    WRITE,
+    SCAN,
+  };
+
+  // Returns whether an operation of 'bytes' bytes fits in the share of
+  // 'shares' for 'key', if any, accounting for it if it does.
+  static bool Admit(const ShareMap& shares, const std::string& key,
+                    Operation op, int64_t bytes);
+
+  // Protects the maps, not the shares themselves.
+  mutable rw_spinlock lock_;
+  ShareMap table_shares_;
+  ShareMap user_shares_;
+
+  // When TakeUsage() was last called.
+  MonoTime usage_start_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuotaManager);
+};
+
+} // namespace tserver
+} // namespace kudu
@@ -32,6 +32,14 @@ METRIC_DEFINE_histogram(server, scanner_duration,
                         kudu::MetricLevel::kInfo,
                         60000000LU, 2);
 
+METRIC_DEFINE_histogram(server, scanner_lookup_duration,
+                        "Scanner Lookup Duration",
+                        kudu::MetricUnit::kNanoseconds,
+                        "Histogram of the time taken to look up a scanner by its ID, "
+                        "including waiting for the lock of the scanner's stripe",
+                        kudu::MetricLevel::kDebug,
+                        1000000000LU, 2);
+
 namespace kudu {
 
 namespace tserver {
@@ -39,7 +47,8 @@ namespace tserver {
 ScannerMetrics::ScannerMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : scanners_expired(
           METRIC_scanners_expired.Instantiate(metric_entity)),
-      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)) {
+      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)),
+      scanner_lookup_duration(METRIC_scanner_lookup_duration.Instantiate(metric_entity)) {
 }
 
 void ScannerMetrics::SubmitScannerDuration(const MonoTime& time_started) {
@@ -41,6 +41,9 @@ struct ScannerMetrics {
 
   // Keeps track of the duration of scanners.
   scoped_refptr<Histogram> scanner_duration;
+
+  // Keeps track of the time taken to look up scanners by ID.
+  scoped_refptr<Histogram> scanner_lookup_duration;
 };
 
 } // namespace tserver
@@ -27,12 +27,16 @@
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/scanner_metrics.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/test_macros.h"
 
+DECLARE_bool(scanner_adaptive_batch_sizing);
+DECLARE_bool(scanner_gc_use_expiry_heap);
 DECLARE_int32(scanner_ttl_ms);
+DECLARE_int64(scanner_batch_memory_budget_bytes);
 
 namespace kudu {
 
@@ -98,5 +102,103 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+TEST(ScannerTest, TestExpireByHeap) {
+  scoped_refptr<TabletReplica> null_replica(nullptr);
+  FLAGS_scanner_ttl_ms = 100;
+  FLAGS_scanner_gc_use_expiry_heap = true;
+  MetricRegistry registry;
+  ScannerManager mgr(METRIC_ENTITY_server.Instantiate(&registry, "test"));
+  SharedScanner s1, s2, s3;
+  mgr.NewScanner(null_replica, RemoteUser(), RowFormatFlags::NO_FLAGS, &s1);
+  mgr.NewScanner(null_replica, RemoteUser(), RowFormatFlags::NO_FLAGS, &s2);
+  mgr.NewScanner(null_replica, RemoteUser(), RowFormatFlags::NO_FLAGS, &s3);
+  ASSERT_TRUE(mgr.UnregisterScanner(s3->id()));
+
+  // Nothing has expired yet, so the GC leaves the heaps alone.
+  mgr.RemoveExpiredScanners();
+  size_t num_entries = 0;
+  for (const auto* stripe : mgr.scanner_maps_) {
+    num_entries += stripe->expiry_heap_.size();
+  }
+  ASSERT_EQ(3, num_entries);
+
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  {
+    // Update the access time by locking and unlocking.
+    auto access = s2->LockForAccess();
+  }
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(1, mgr.CountActiveScanners());
+  ASSERT_EQ(1, mgr.metrics_->scanners_expired->value());
+  vector<SharedScanner> active_scanners;
+  mgr.ListScanners(&active_scanners);
+  ASSERT_EQ(s2->id(), active_scanners[0]->id());
+
+  // Only the entry of the scanner still active remains, with its new access
+  // time: it expires once idle for the TTL again.
+  num_entries = 0;
+  for (const auto* stripe : mgr.scanner_maps_) {
+    num_entries += stripe->expiry_heap_.size();
+  }
+  ASSERT_EQ(1, num_entries);
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(1, mgr.CountActiveScanners());
+  SleepFor(MonoDelta::FromMilliseconds(200));
+  mgr.RemoveExpiredScanners();
+  ASSERT_EQ(0, mgr.CountActiveScanners());
+  ASSERT_EQ(2, mgr.metrics_->scanners_expired->value());
+
+  // Lookups are timed.
+  SharedScanner result;
+  TabletServerErrorPB::Code error_code;
+  ASSERT_TRUE(mgr.LookupScanner(s2->id(), "", &error_code, &result).IsNotFound());
+  ASSERT_EQ(1, mgr.metrics_->scanner_lookup_duration->TotalCount());
+}
+
+TEST(ScannerTest, TestAdaptiveBatchSize) {
+  const size_t kKB = 1024;
+  const size_t kMB = 1024 * kKB;
+  scoped_refptr<TabletReplica> null_replica(nullptr);
+  ScannerManager mgr(nullptr);
+  SharedScanner s;
+  mgr.NewScanner(null_replica, RemoteUser(), RowFormatFlags::NO_FLAGS, &s);
+  auto l = s->LockForAccess();
+  const MonoTime start = MonoTime::Now();
+  const auto ms = [&](int n) { return start + MonoDelta::FromMilliseconds(n); };
+
+  // Without adaptive sizing, batches are of the size asked for.
+  ASSERT_EQ(kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, start));
+
+  FLAGS_scanner_adaptive_batch_sizing = true;
+  FLAGS_scanner_batch_memory_budget_bytes = 0;
+  ASSERT_EQ(kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, start));
+  s->RecordBatch(kMB, start, ms(10));
+
+  // The client came back sooner than the batch took to build: grow, up to the
+  // maximum.
+  ASSERT_EQ(2 * kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(11)));
+  ASSERT_EQ(kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, kMB, 8, ms(11)));
+
+  // The client took about as long: keep the size.
+  ASSERT_EQ(kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(30)));
+
+  // The client took much longer: shrink, down to the minimum, or to a block
+  // of rows if that's larger.
+  ASSERT_EQ(512 * kKB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(100)));
+  s->RecordBatch(64 * kKB, ms(100), ms(110));
+  ASSERT_EQ(64 * kKB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(200)));
+  ASSERT_EQ(128 * kKB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 1024, ms(200)));
+
+  // The batches being built elsewhere leave less of the memory budget to this
+  // one.
+  s->RecordBatch(kMB, ms(100), ms(110));
+  FLAGS_scanner_batch_memory_budget_bytes = 8 * kMB;
+  {
+    ScopedTrackedConsumption consumption(mgr.batch_mem_tracker(), 6 * kMB);
+    ASSERT_EQ(256 * kKB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(111)));
+  }
+  ASSERT_EQ(kMB, mgr.PickBatchSize(s.get(), kMB, 64 * kKB, 8 * kMB, 8, ms(111)));
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -23,14 +23,18 @@
 #include <mutex>
 #include <numeric>
 #include <ostream>
+#include <utility>
 
+#include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
 
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/hash/string_hash.h"
 #include "kudu/gutil/map-util.h"
@@ -44,10 +48,14 @@
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
+#include "kudu/util/trace.h"
+#include "kudu/util/trace_metrics.h"
 
 DEFINE_int32(scanner_ttl_ms, 60000,
              "Number of milliseconds of inactivity allowed for a scanner"
@@ -64,12 +72,56 @@ DEFINE_int32(scan_history_count, 20,
              "scans will be shown on the tablet server's scans dashboard.");
 TAG_FLAG(scan_history_count, experimental);
 
+DEFINE_bool(scanner_gc_use_expiry_heap, false,
+            "Whether to find the expired scanners using per-stripe heaps of the "
+            "scanners ordered by last access time, rather than by visiting every "
+            "scanner. With the heaps, each pass of the scanner GC only visits the "
+            "scanners that may have expired.");
+TAG_FLAG(scanner_gc_use_expiry_heap, experimental);
+TAG_FLAG(scanner_gc_use_expiry_heap, runtime);
+
+DEFINE_int64(scanner_read_ahead_bytes, 0,
+             "Amount of row data each scanner reads ahead in the background "
+             "after responding to a scan request, so that its next request "
+             "can be served without waiting for the rows to be read. 0 "
+             "disables the read-ahead.");
+TAG_FLAG(scanner_read_ahead_bytes, experimental);
+TAG_FLAG(scanner_read_ahead_bytes, runtime);
+
+DEFINE_int64(scanner_read_ahead_max_server_bytes, 256 * 1024 * 1024,
+             "Maximum amount of row data read ahead by all of the scanners of "
+             "a tablet server. See --scanner_read_ahead_bytes.");
+TAG_FLAG(scanner_read_ahead_max_server_bytes, experimental);
+TAG_FLAG(scanner_read_ahead_max_server_bytes, runtime);
+
+DEFINE_bool(scanner_adaptive_batch_sizing, false,
+            "Whether the tablet servers pick the size of each batch of a scan, "
+            "within the bounds requested by the client, rather than sending "
+            "batches of the size the client asked for. Batches grow while the "
+            "client asks for the next one sooner than it took to build the last, "
+            "shrink while the client takes much longer than that, and shrink as "
+            "the memory of the batches being built nears "
+            "--scanner_batch_memory_budget_bytes.");
+TAG_FLAG(scanner_adaptive_batch_sizing, experimental);
+TAG_FLAG(scanner_adaptive_batch_sizing, runtime);
+
+DEFINE_int64(scanner_batch_memory_budget_bytes, 512 * 1024 * 1024,
+             "The memory the batches of scan results being built by a tablet "
+             "server may take before the batches picked by "
+             "--scanner_adaptive_batch_sizing shrink to their minimum size. 0 "
+             "leaves the batch sizes unbounded by the server's memory.");
+TAG_FLAG(scanner_batch_memory_budget_bytes, experimental);
+TAG_FLAG(scanner_batch_memory_budget_bytes, runtime);
+
+DECLARE_int32(scanner_batch_size_rows);
+
 METRIC_DEFINE_gauge_size(server, active_scanners,
                          "Active Scanners",
                          kudu::MetricUnit::kScanners,
                          "Number of scanners that are currently active",
                          kudu::MetricLevel::kInfo);
 
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
@@ -78,15 +130,87 @@ using strings::Substitute;
 
 namespace kudu {
 
+extern const char* SCAN_PREDICATE_EVAL_US_METRIC_NAME;
+
+namespace cfile {
+extern const char* CFILE_CACHE_MISS_BYTES_METRIC_NAME;
+extern const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME;
+} // namespace cfile
+
+namespace tablet {
+extern const char* SCAN_CFILE_READ_US_METRIC_NAME;
+extern const char* SCAN_CFILE_DECODE_US_METRIC_NAME;
+extern const char* SCAN_DELTA_APPLY_US_METRIC_NAME;
+} // namespace tablet
+
 using rpc::RemoteUser;
 using tablet::TabletReplica;
 
 namespace tserver {
 
-ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
+extern const char* SCAN_SAFE_TIME_WAIT_US_METRIC_NAME;
+extern const char* SCAN_SERIALIZE_US_METRIC_NAME;
+
+ScanProfile ScanProfile::FromTrace(const Trace* trace) {
+  ScanProfile profile;
+  if (!trace) {
+    return profile;
+  }
+  const TraceMetrics& metrics = trace->metrics();
+  profile.cfile_read_us = metrics.GetMetric(tablet::SCAN_CFILE_READ_US_METRIC_NAME);
+  profile.cfile_decode_us = metrics.GetMetric(tablet::SCAN_CFILE_DECODE_US_METRIC_NAME);
+  profile.predicate_eval_us = metrics.GetMetric(SCAN_PREDICATE_EVAL_US_METRIC_NAME);
+  profile.delta_apply_us = metrics.GetMetric(tablet::SCAN_DELTA_APPLY_US_METRIC_NAME);
+  profile.safe_time_wait_us = metrics.GetMetric(SCAN_SAFE_TIME_WAIT_US_METRIC_NAME);
+  profile.serialize_us = metrics.GetMetric(SCAN_SERIALIZE_US_METRIC_NAME);
+  profile.cfile_cache_hit_bytes = metrics.GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME);
+  profile.cfile_cache_miss_bytes = metrics.GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME);
+  return profile;
+}
+
+ScanProfile& ScanProfile::operator+=(const ScanProfile& other) {
+  cfile_read_us += other.cfile_read_us;
+  cfile_decode_us += other.cfile_decode_us;
+  predicate_eval_us += other.predicate_eval_us;
+  delta_apply_us += other.delta_apply_us;
+  safe_time_wait_us += other.safe_time_wait_us;
+  serialize_us += other.serialize_us;
+  cfile_cache_hit_bytes += other.cfile_cache_hit_bytes;
+  cfile_cache_miss_bytes += other.cfile_cache_miss_bytes;
+  return *this;
+}
+
+ScanProfile& ScanProfile::operator-=(const ScanProfile& other) {
+  cfile_read_us -= other.cfile_read_us;
+  cfile_decode_us -= other.cfile_decode_us;
+  predicate_eval_us -= other.predicate_eval_us;
+  delta_apply_us -= other.delta_apply_us;
+  safe_time_wait_us -= other.safe_time_wait_us;
+  serialize_us -= other.serialize_us;
+  cfile_cache_hit_bytes -= other.cfile_cache_hit_bytes;
+  cfile_cache_miss_bytes -= other.cfile_cache_miss_bytes;
+  return *this;
+}
+
+void ScanProfile::ToPB(ScanProfilePB* pb) const {
+  pb->set_cfile_read_us(cfile_read_us);
+  pb->set_cfile_decode_us(cfile_decode_us);
+  pb->set_predicate_eval_us(predicate_eval_us);
+  pb->set_delta_apply_us(delta_apply_us);
+  pb->set_safe_time_wait_us(safe_time_wait_us);
+  pb->set_serialize_us(serialize_us);
+  pb->set_cfile_cache_hit_bytes(cfile_cache_hit_bytes);
+  pb->set_cfile_cache_miss_bytes(cfile_cache_miss_bytes);
+}
+
+ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                               shared_ptr<MemTracker> parent_mem_tracker)
     : shutdown_(false),
       shutdown_cv_(&shutdown_lock_),
-      completed_scans_offset_(0) {
+      completed_scans_offset_(0),
+      read_ahead_bytes_(0),
+      batch_mem_tracker_(MemTracker::CreateTracker(-1, "scan-batches",
+                                                   std::move(parent_mem_tracker))) {
   if (metric_entity) {
     metrics_.reset(new ScannerMetrics(metric_entity));
     METRIC_active_scanners.InstantiateFunctionGauge(
@@ -111,6 +235,12 @@ ScannerManager::~ScannerManager() {
   if (removal_thread_.get() != nullptr) {
     CHECK_OK(ThreadJoiner(removal_thread_.get()).Join());
   }
+  if (read_ahead_pool_) {
+    read_ahead_pool_->Shutdown();
+  }
+  if (parallel_scan_pool_) {
+    parallel_scan_pool_->Shutdown();
+  }
   STLDeleteElements(&scanner_maps_);
 }
 
@@ -118,9 +248,76 @@ Status ScannerManager::StartRemovalThread() {
   RETURN_NOT_OK(Thread::Create("scanners", "removal_thread",
                                [this]() { this->RunRemovalThread(); },
                                &removal_thread_));
+  RETURN_NOT_OK(ThreadPoolBuilder("scan-read-ahead").Build(&read_ahead_pool_));
+  RETURN_NOT_OK(ThreadPoolBuilder("scan-parallel").Build(&parallel_scan_pool_));
   return Status::OK();
 }
 
+void ScannerManager::StartReadAhead(const SharedScanner& scanner) {
+  const int64_t max_bytes = FLAGS_scanner_read_ahead_bytes;
+  if (max_bytes <= 0 || !read_ahead_pool_ ||
+      read_ahead_bytes() >= FLAGS_scanner_read_ahead_max_server_bytes) {
+    return;
+  }
+  const uint64_t seq = scanner->CancelReadAhead();
+  const size_t nrows = FLAGS_scanner_batch_size_rows;
+  Status s = read_ahead_pool_->Submit([this, scanner, seq, nrows, max_bytes]() {
+    // The time spent reading ahead is accounted to the scanner's profile too.
+    scoped_refptr<Trace> trace(new Trace);
+    {
+      ADOPT_TRACE(trace.get());
+      auto l = scanner->LockForAccess();
+      scanner->ReadAhead(seq, nrows, max_bytes, &this->read_ahead_bytes_,
+                         FLAGS_scanner_read_ahead_max_server_bytes);
+    }
+    scanner->AddProfile(ScanProfile::FromTrace(trace.get()));
+  });
+  WARN_NOT_OK(s, Substitute("unable to read ahead rows of scanner $0", scanner->id()));
+}
+
+size_t ScannerManager::PickBatchSize(Scanner* scanner,
+                                     size_t initial_bytes,
+                                     size_t min_bytes,
+                                     size_t max_bytes,
+                                     size_t row_width,
+                                     const MonoTime& now) {
+  // How much longer than its last batch took to build the client may take to
+  // come back before the batches shrink.
+  static constexpr int kSlowClientFactor = 4;
+  // The share of the memory budget left that a batch may take, so that the
+  // scanners building batches at the same time don't all take it at once.
+  static constexpr int64_t kBudgetShare = 8;
+
+  if (!FLAGS_scanner_adaptive_batch_sizing || max_bytes == 0) {
+    return initial_bytes;
+  }
+  // Batches are built a block of rows at a time: smaller ones overshoot.
+  min_bytes = std::min(std::max<size_t>(min_bytes, row_width * FLAGS_scanner_batch_size_rows),
+                       max_bytes);
+
+  size_t size = scanner->batch_size_bytes();
+  if (size == 0) {
+    size = initial_bytes;
+  } else {
+    const MonoDelta gap = now - scanner->last_batch_end();
+    const MonoDelta duration = scanner->last_batch_duration();
+    if (gap < duration) {
+      // The client consumes the batches faster than they're built: the
+      // round trips between them are what slows the scan down.
+      size *= 2;
+    } else if (gap.ToNanoseconds() > duration.ToNanoseconds() * kSlowClientFactor) {
+      // Smaller batches keep slow clients as busy, with less memory.
+      size /= 2;
+    }
+  }
+  const int64_t budget = FLAGS_scanner_batch_memory_budget_bytes;
+  if (budget > 0) {
+    const int64_t left = budget - batch_mem_tracker_->consumption();
+    size = std::min<int64_t>(size, std::max<int64_t>(left / kBudgetShare, 0));
+  }
+  return std::max(std::min(size, max_bytes), min_bytes);
+}
+
 void ScannerManager::RunRemovalThread() {
   while (true) {
     // Loop until we are shutdown.
@@ -157,6 +354,9 @@ void ScannerManager::NewScanner(const scoped_refptr<TabletReplica>& tablet_repli
     ScannerMapStripe& stripe = GetStripeByScannerId(id);
     std::lock_guard<RWMutex> l(stripe.lock_);
     success = InsertIfNotPresent(&stripe.scanners_by_id_, id, *scanner);
+    if (success) {
+      stripe.expiry_heap_.emplace((*scanner)->start_time(), id);
+    }
   }
 }
 
@@ -166,8 +366,16 @@ Status ScannerManager::LookupScanner(const string& scanner_id,
                                      SharedScanner* scanner) {
   SharedScanner ret;
   ScannerMapStripe& stripe = GetStripeByScannerId(scanner_id);
-  shared_lock<RWMutex> l(stripe.lock_);
-  bool found_scanner = FindCopy(stripe.scanners_by_id_, scanner_id, &ret);
+  bool found_scanner;
+  {
+    const MonoTime start = metrics_ ? MonoTime::Now() : MonoTime();
+    shared_lock<RWMutex> l(stripe.lock_);
+    found_scanner = FindCopy(stripe.scanners_by_id_, scanner_id, &ret);
+    if (metrics_) {
+      metrics_->scanner_lookup_duration->Increment(
+          (MonoTime::Now() - start).ToNanoseconds());
+    }
+  }
   if (!found_scanner) {
     *error_code = TabletServerErrorPB::SCANNER_EXPIRED;
     return Status::NotFound(Substitute("Scanner $0 not found (it may have expired)",
@@ -265,33 +473,37 @@ void ScannerManager::RemoveExpiredScanners() {
   MonoDelta scanner_ttl = MonoDelta::FromMilliseconds(FLAGS_scanner_ttl_ms);
   const MonoTime now = MonoTime::Now();
 
+  const bool use_heap = FLAGS_scanner_gc_use_expiry_heap;
+
   vector<ScanDescriptor> descriptors;
   for (ScannerMapStripe* stripe : scanner_maps_) {
     std::lock_guard<RWMutex> l(stripe->lock_);
+    if (use_heap) {
+      RemoveExpiredScannersByHeapUnlocked(stripe, scanner_ttl, now, &descriptors);
+      continue;
+    }
+    // The heap is rebuilt from the remaining scanners, so that it neither
+    // accumulates the entries of unregistered scanners while unused nor is
+    // out of date when the flag is turned on.
+    vector<ExpiryEntry> entries;
+    entries.reserve(stripe->scanners_by_id_.size());
     for (auto it = stripe->scanners_by_id_.begin(); it != stripe->scanners_by_id_.end();) {
       const SharedScanner& scanner = it->second;
       MonoDelta idle_time = scanner->TimeSinceLastAccess(now);
       if (idle_time <= scanner_ttl) {
+        entries.emplace_back(now - idle_time, it->first);
         ++it;
         continue;
       }
 
       // The scanner has expired because of inactivity.
-      LOG(INFO) << Substitute(
-          "Expiring scanner id: $0, of tablet $1, "
-          "after $2 ms of inactivity, which is > TTL ($3 ms).",
-          it->first,
-          scanner->tablet_id(),
-          idle_time.ToMilliseconds(),
-          scanner_ttl.ToMilliseconds());
+      LogExpiredScanner(*scanner, idle_time, scanner_ttl);
       if (scanner->is_initted()) {
         descriptors.emplace_back(scanner->Descriptor());
       }
       it = stripe->scanners_by_id_.erase(it);
-      if (metrics_) {
-        metrics_->scanners_expired->Increment();
-      }
     }
+    stripe->expiry_heap_ = ExpiryHeap(ExpiryEntryLater(), std::move(entries));
   }
 
   std::lock_guard<RWMutex> l(completed_scans_lock_);
@@ -302,6 +514,60 @@ void ScannerManager::RemoveExpiredScanners() {
   }
 }
 
+void ScannerManager::RemoveExpiredScannersByHeapUnlocked(
+    ScannerMapStripe* stripe,
+    const MonoDelta& scanner_ttl,
+    const MonoTime& now,
+    vector<ScanDescriptor>* descriptors) {
+  ExpiryHeap& heap = stripe->expiry_heap_;
+  // The entries' times are never later than the scanners' last accesses, so
+  // none of the scanners whose entries are within the TTL has expired. The
+  // entries of the others are either dropped, or pushed back with the
+  // scanners' actual last access times.
+  vector<ExpiryEntry> requeue;
+  while (!heap.empty() && now - heap.top().first > scanner_ttl) {
+    ExpiryEntry entry = heap.top();
+    heap.pop();
+    auto it = stripe->scanners_by_id_.find(entry.second);
+    if (it == stripe->scanners_by_id_.end()) {
+      // The scanner was unregistered.
+      continue;
+    }
+    const SharedScanner& scanner = it->second;
+    MonoDelta idle_time = scanner->TimeSinceLastAccess(now);
+    if (idle_time <= scanner_ttl) {
+      entry.first = now - idle_time;
+      requeue.emplace_back(std::move(entry));
+      continue;
+    }
+
+    // The scanner has expired because of inactivity.
+    LogExpiredScanner(*scanner, idle_time, scanner_ttl);
+    if (scanner->is_initted()) {
+      descriptors->emplace_back(scanner->Descriptor());
+    }
+    stripe->scanners_by_id_.erase(it);
+  }
+  for (auto& entry : requeue) {
+    heap.emplace(std::move(entry));
+  }
+}
+
+void ScannerManager::LogExpiredScanner(const Scanner& scanner,
+                                       const MonoDelta& idle_time,
+                                       const MonoDelta& scanner_ttl) {
+  LOG(INFO) << Substitute(
+      "Expiring scanner id: $0, of tablet $1, "
+      "after $2 ms of inactivity, which is > TTL ($3 ms).",
+      scanner.id(),
+      scanner.tablet_id(),
+      idle_time.ToMilliseconds(),
+      scanner_ttl.ToMilliseconds());
+  if (metrics_) {
+    metrics_->scanners_expired->Increment();
+  }
+}
+
 void ScannerManager::RecordCompletedScanUnlocked(ScanDescriptor descriptor) {
   if (completed_scans_.capacity() == 0) {
     return;
@@ -340,6 +606,9 @@ Scanner::Scanner(string id, const scoped_refptr<TabletReplica>& tablet_replica,
 }
 
 Scanner::~Scanner() {
+  if (server_read_ahead_bytes_) {
+    server_read_ahead_bytes_->fetch_sub(read_ahead_bytes_, std::memory_order_relaxed);
+  }
   if (tablet_replica_) {
     auto tablet = tablet_replica_->shared_tablet();
     if (tablet && tablet->metrics()) {
@@ -349,6 +618,20 @@ Scanner::~Scanner() {
   if (metrics_) {
     metrics_->SubmitScannerDuration(start_time_);
   }
+  for (auto& e : parked_continuations_) {
+    e.second();
+  }
+}
+
+std::function<void()> Scanner::TakeParkedContinuation() {
+  lock_.AssertAcquired();
+  auto it = parked_continuations_.find(call_seq_id_);
+  if (it == parked_continuations_.end()) {
+    return nullptr;
+  }
+  auto resume = std::move(it->second);
+  parked_continuations_.erase(it);
+  return resume;
 }
 
 void Scanner::AddTimings(const CpuTimes& elapsed) {
@@ -356,6 +639,119 @@ void Scanner::AddTimings(const CpuTimes& elapsed) {
   cpu_times_.Add(elapsed);
 }
 
+void Scanner::AddProfile(const ScanProfile& profile) {
+  std::unique_lock<RWMutex> l(cpu_times_lock_);
+  profile_ += profile;
+}
+
+void Scanner::GetProfile(ScanProfilePB* pb) const {
+  lock_.AssertAcquired();
+  profile().ToPB(pb);
+  vector<IteratorStats> stats_by_col;
+  iter_->GetIteratorStats(&stats_by_col);
+  DCHECK_EQ(stats_by_col.size(), iter_->schema().num_columns());
+  for (int col_idx = 0; col_idx < stats_by_col.size(); col_idx++) {
+    const auto& stats = stats_by_col[col_idx];
+    auto* col_pb = pb->add_columns();
+    col_pb->set_column_name(iter_->schema().column(col_idx).name());
+    col_pb->set_cells_read(stats.cells_read);
+    col_pb->set_bytes_read(stats.bytes_read);
+    col_pb->set_blocks_read(stats.blocks_read);
+    col_pb->set_blocks_read_from_disk(stats.blocks_read_from_disk);
+  }
+}
+
+RowBlock* Scanner::row_block(size_t nrows) {
+  lock_.AssertAcquired();
+  if (!row_block_ || row_block_->row_capacity() != nrows) {
+    row_block_.reset();
+    row_block_memory_.reset(new RowBlockMemory(32 * 1024));
+    row_block_.reset(new RowBlock(&iter()->schema(), nrows, row_block_memory_.get()));
+  }
+  return row_block_.get();
+}
+
+void Scanner::ResetRowBlockMemory() {
+  lock_.AssertAcquired();
+  if (row_block_memory_) {
+    row_block_memory_->Reset();
+  }
+  returned_read_ahead_block_ = {};
+}
+
+bool Scanner::HasNext() const {
+  lock_.AssertAcquired();
+  return !read_ahead_blocks_.empty() || !read_ahead_status_.ok() || iter()->HasNext();
+}
+
+Status Scanner::NextBlock(RowBlock* block, RowBlock** next) {
+  lock_.AssertAcquired();
+  if (!read_ahead_blocks_.empty()) {
+    returned_read_ahead_block_ = std::move(read_ahead_blocks_.front());
+    read_ahead_blocks_.pop_front();
+    read_ahead_bytes_ -= returned_read_ahead_block_.bytes;
+    server_read_ahead_bytes_->fetch_sub(returned_read_ahead_block_.bytes,
+                                        std::memory_order_relaxed);
+    *next = returned_read_ahead_block_.block.get();
+    return Status::OK();
+  }
+  if (PREDICT_FALSE(!read_ahead_status_.ok())) {
+    Status s = read_ahead_status_;
+    read_ahead_status_ = Status::OK();
+    return s;
+  }
+  *next = block;
+  return iter()->NextBlock(block);
+}
+
+void Scanner::ReadAhead(uint64_t seq, size_t nrows, int64_t max_bytes,
+                        std::atomic<int64_t>* server_bytes, int64_t max_server_bytes) {
+  lock_.AssertAcquired();
+  DCHECK(!server_read_ahead_bytes_ || server_read_ahead_bytes_ == server_bytes);
+  server_read_ahead_bytes_ = server_bytes;
+  const Schema& schema = iter()->schema();
+  while (read_ahead_status_.ok() &&
+         read_ahead_bytes_ < max_bytes &&
+         server_bytes->load(std::memory_order_relaxed) < max_server_bytes &&
+         read_ahead_seq_.load(std::memory_order_acquire) == seq &&
+         !has_fulfilled_limit() &&
+         iter()->HasNext()) {
+    ReadAheadBlock ra;
+    ra.memory.reset(new RowBlockMemory(32 * 1024));
+    ra.block.reset(new RowBlock(&schema, nrows, ra.memory.get()));
+    read_ahead_status_ = iter()->NextBlock(ra.block.get());
+    if (!read_ahead_status_.ok() || ra.block->nrows() == 0) {
+      continue;
+    }
+    ra.bytes = ra.block->nrows() * schema.byte_size() + ra.memory->arena.memory_footprint();
+    read_ahead_bytes_ += ra.bytes;
+    server_bytes->fetch_add(ra.bytes, std::memory_order_relaxed);
+    read_ahead_blocks_.emplace_back(std::move(ra));
+  }
+}
+
+Status Scanner::AddRuntimeFilters(
+    const google::protobuf::RepeatedPtrField<ColumnPredicatePB>& filters) {
+  lock_.AssertAcquired();
+  const Schema& schema = iter()->schema();
+  for (const auto& pb : filters) {
+    boost::optional<ColumnPredicate> predicate;
+    RETURN_NOT_OK(ColumnPredicateFromPB(schema, &arena_, pb, &predicate));
+    runtime_filters_.AddPredicate(std::move(*predicate));
+  }
+  return Status::OK();
+}
+
+void Scanner::ApplyRuntimeFilters(RowBlock* block) const {
+  lock_.AssertAcquired();
+  const Schema& schema = iter()->schema();
+  for (const auto& name_and_pred : runtime_filters_.predicates()) {
+    const int col_idx = schema.find_column(name_and_pred.first);
+    DCHECK_NE(Schema::kColumnNotFound, col_idx);
+    name_and_pred.second.Evaluate(block->column_block(col_idx), block->selection_vector());
+  }
+}
+
 void Scanner::Init(unique_ptr<RowwiseIterator> iter,
                    unique_ptr<ScanSpec> spec,
                    unique_ptr<Schema> client_projection) {
@@ -432,6 +828,7 @@ ScanDescriptor Scanner::Descriptor() const {
   descriptor.last_call_seq_id = ANNOTATE_UNPROTECTED_READ(call_seq_id_);
   descriptor.last_access_time = last_access_time_.load(std::memory_order_relaxed);
   descriptor.cpu_times = cpu_times();
+  descriptor.profile = profile();
 
   return descriptor;
 }
@@ -441,5 +838,10 @@ CpuTimes Scanner::cpu_times() const {
   return cpu_times_;
 }
 
+ScanProfile Scanner::profile() const {
+  shared_lock<RWMutex> l(cpu_times_lock_);
+  return profile_;
+}
+
 } // namespace tserver
 } // namespace kudu
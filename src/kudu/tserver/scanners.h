@@ -19,17 +19,24 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <glog/logging.h>
+#include <google/protobuf/repeated_field.h> // IWYU pragma: keep
 #include <gtest/gtest_prod.h>
 
+#include "kudu/common/common.pb.h"
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/rowblock_memory.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
@@ -44,14 +51,18 @@
 #include "kudu/util/mutex.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/rw_mutex.h"
+#include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/trace.h"
 
 namespace kudu {
 
+class RowBlock;
 class RowwiseIterator;
 class Schema;
-class Status;
+class MemTracker;
 class Thread;
+class ThreadPool;
 
 namespace tserver {
 
@@ -73,10 +84,14 @@ typedef std::shared_ptr<Scanner> SharedScanner;
 // removes any scanners which have not been accessed since a configurable TTL.
 class ScannerManager {
  public:
-  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity);
+  // The memory of the batches being built is accounted to a child of
+  // 'parent_mem_tracker', or of the root tracker if null.
+  explicit ScannerManager(const scoped_refptr<MetricEntity>& metric_entity,
+                          std::shared_ptr<MemTracker> parent_mem_tracker = nullptr);
   ~ScannerManager();
 
-  // Starts the expired scanner removal thread.
+  // Starts the expired scanner removal thread, and the pool of the threads
+  // reading ahead the scanners' rows.
   Status StartRemovalThread();
 
   // Create a new scanner with a unique ID, inserting it into the map. Further
@@ -116,8 +131,51 @@ class ScannerManager {
   // Iterate through scanners and remove any which are past their TTL.
   void RemoveExpiredScanners();
 
+  // With --scanner_read_ahead_bytes, starts reading ahead the rows of
+  // 'scanner' in the background, for its next batch to be returned from.
+  // The access lock may be held: the read-ahead waits for it.
+  void StartReadAhead(const SharedScanner& scanner);
+
+  // The amount of the scanners' read-ahead row data.
+  int64_t read_ahead_bytes() const {
+    return read_ahead_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the size of the next batch of 'scanner', in [min_bytes,
+  // max_bytes], for a request which arrived at 'now'. The size of the first
+  // batch is 'initial_bytes'. That of the next ones adapts to how fast the
+  // client comes back for more, compared to how long its last batch took to
+  // build, and is lowered as the memory of the batches being built
+  // server-wide (see batch_mem_tracker()) nears
+  // --scanner_batch_memory_budget_bytes. A batch holds at least a block of
+  // rows of 'row_width' bytes, if 'max_bytes' allows.
+  //
+  // Without --scanner_adaptive_batch_sizing, returns 'initial_bytes'.
+  //
+  // The access lock of 'scanner' must be held, and Scanner::RecordBatch()
+  // called once the batch is built.
+  size_t PickBatchSize(Scanner* scanner,
+                       size_t initial_bytes,
+                       size_t min_bytes,
+                       size_t max_bytes,
+                       size_t row_width,
+                       const MonoTime& now);
+
+  // Tracks the memory of the scan batches being built.
+  const std::shared_ptr<MemTracker>& batch_mem_tracker() const {
+    return batch_mem_tracker_;
+  }
+
+  // The pool on which the scans read several rowsets of a tablet at a time,
+  // see --scanner_parallel_scan_threads. Null until the removal thread is
+  // started.
+  ThreadPool* parallel_scan_pool() const {
+    return parallel_scan_pool_.get();
+  }
+
  private:
   FRIEND_TEST(ScannerTest, TestExpire);
+  FRIEND_TEST(ScannerTest, TestExpireByHeap);
 
   enum {
     kNumScannerMapStripes = 32
@@ -125,13 +183,43 @@ class ScannerManager {
 
   typedef std::unordered_map<std::string, SharedScanner> ScannerMap;
 
+  // An entry of a stripe's expiry heap: a scanner's ID, and the time it was
+  // last known to be accessed.
+  typedef std::pair<MonoTime, std::string> ExpiryEntry;
+  struct ExpiryEntryLater {
+    bool operator()(const ExpiryEntry& a, const ExpiryEntry& b) const {
+      return b.first < a.first;
+    }
+  };
+  typedef std::priority_queue<ExpiryEntry, std::vector<ExpiryEntry>, ExpiryEntryLater>
+      ExpiryHeap;
+
   struct ScannerMapStripe {
-    // Lock protecting the scanner map.
+    // Lock protecting the scanner map and the expiry heap.
     mutable RWMutex lock_;
     // Map of the currently active scanners.
     ScannerMap scanners_by_id_;
+    // The stripe's scanners, least recently accessed first. An entry's time
+    // may be older than its scanner's last access, and entries of scanners
+    // that were unregistered are only dropped when they reach the top, so
+    // that neither accessing nor unregistering a scanner touches the heap.
+    ExpiryHeap expiry_heap_;
   };
 
+  // Removes the scanners of 'stripe' which are past 'scanner_ttl' as of
+  // 'now', checking only the scanners whose heap entries are past it.
+  // Appends the descriptors of the initialized ones to 'descriptors'.
+  // Must be called with the stripe's lock held for writing.
+  void RemoveExpiredScannersByHeapUnlocked(ScannerMapStripe* stripe,
+                                           const MonoDelta& scanner_ttl,
+                                           const MonoTime& now,
+                                           std::vector<ScanDescriptor>* descriptors);
+
+  // Logs the expiration of 'scanner' after 'idle_time' and counts it.
+  void LogExpiredScanner(const Scanner& scanner,
+                         const MonoDelta& idle_time,
+                         const MonoDelta& scanner_ttl);
+
   // Periodically call RemoveExpiredScanners().
   void RunRemovalThread();
 
@@ -162,6 +250,19 @@ class ScannerManager {
   // Thread to remove expired scanners.
   scoped_refptr<kudu::Thread> removal_thread_;
 
+  // Runs the scanners' read-aheads.
+  std::unique_ptr<ThreadPool> read_ahead_pool_;
+
+  // Runs the reads of the rowsets of parallel scans.
+  std::unique_ptr<ThreadPool> parallel_scan_pool_;
+
+  // The total of the scanners' read-ahead row data, bounded by
+  // --scanner_read_ahead_max_server_bytes.
+  std::atomic<int64_t> read_ahead_bytes_;
+
+  // The memory of the scan batches being built.
+  std::shared_ptr<MemTracker> batch_mem_tracker_;
+
   FunctionGaugeDetacher metric_detacher_;
 
   DISALLOW_COPY_AND_ASSIGN(ScannerManager);
@@ -190,6 +291,29 @@ class ScopedUnregisterScanner {
   bool cancelled_;
 };
 
+// The amounts of time a scan spent in each of its phases, and the amounts of
+// data its reads found in or missed the block cache, as counted by the trace
+// metrics of the threads serving the scan.
+struct ScanProfile {
+  // Returns the profile counted by the trace metrics of 'trace', or an empty
+  // profile if 'trace' is null.
+  static ScanProfile FromTrace(const Trace* trace);
+
+  ScanProfile& operator+=(const ScanProfile& other);
+  ScanProfile& operator-=(const ScanProfile& other);
+
+  void ToPB(ScanProfilePB* pb) const;
+
+  int64_t cfile_read_us = 0;
+  int64_t cfile_decode_us = 0;
+  int64_t predicate_eval_us = 0;
+  int64_t delta_apply_us = 0;
+  int64_t safe_time_wait_us = 0;
+  int64_t serialize_us = 0;
+  int64_t cfile_cache_hit_bytes = 0;
+  int64_t cfile_cache_miss_bytes = 0;
+};
+
 // An open scanner on the server side.
 //
 // NOTE: unless otherwise specified, all methods of this class require that the
@@ -274,13 +398,98 @@ class Scanner {
   }
 
   // Add the timings in 'elapsed' to the total timings for this scanner.
+  // Does not require the AccessLock.
   void AddTimings(const CpuTimes& elapsed);
 
+  // Adds 'profile' to the profile of this scanner.
+  // Does not require the AccessLock.
+  void AddProfile(const ScanProfile& profile);
+
+  // Returns the profile of this scanner, with the per-column stats of its
+  // iterator.
+  //
+  // REQUIRES: is_initted() must be true.
+  void GetProfile(ScanProfilePB* pb) const;
+
   Arena* arena() {
     lock_.AssertAcquired();
     return &arena_;
   }
 
+  // Returns a block of 'nrows' rows to read the rows of iter() into. The
+  // block and its memory are kept across the scanner's batches, saving the
+  // allocation of their buffers for every batch. A new block is only created
+  // if the number of rows changes.
+  RowBlock* row_block(size_t nrows);
+
+  // Releases the rows last read into row_block(): their variable-length data
+  // and the references they hold to the underlying data blocks. The block's
+  // buffers are kept for the next batch.
+  void ResetRowBlockMemory();
+
+  // Adds 'filters' to the scanner's runtime filters: predicates which the
+  // client learned of after opening the scan, and which apply, in
+  // conjunction with the scan's own predicates, to the rows read from now
+  // on. Filters on the same column are merged. The filters' columns must be
+  // part of iter()'s schema.
+  Status AddRuntimeFilters(
+      const google::protobuf::RepeatedPtrField<ColumnPredicatePB>& filters);
+
+  // Deselects the rows of 'block', read from iter(), which don't match the
+  // runtime filters.
+  void ApplyRuntimeFilters(RowBlock* block) const;
+
+  // Returns whether the scan has rows left: rows read ahead, or rows iter()
+  // hasn't returned yet.
+  bool HasNext() const;
+
+  // Sets '*next' to the scan's next block of rows. That's the next block read
+  // ahead if any, which stays valid until the next call, or the next call to
+  // ResetRowBlockMemory(). Otherwise it's 'block', which the rows are read
+  // into from iter().
+  //
+  // An error of the read-ahead is returned once its rows are exhausted.
+  Status NextBlock(RowBlock* block, RowBlock** next);
+
+  // Cancels any read-ahead in progress or scheduled, returning the sequence
+  // number of the next one. Doesn't require the access lock.
+  uint64_t CancelReadAhead() {
+    return read_ahead_seq_.fetch_add(1, std::memory_order_acq_rel) + 1;
+  }
+
+  // Reads blocks of 'nrows' rows from iter() ahead of the scanner's next
+  // batches, stopping once 'max_bytes' of row data are read ahead, once the
+  // total read ahead by the server's scanners in '*server_bytes' reaches
+  // 'max_server_bytes', or once CancelReadAhead() is called after returning
+  // 'seq'. '*server_bytes' is kept up to date with the row data read ahead.
+  void ReadAhead(uint64_t seq, size_t nrows, int64_t max_bytes,
+                 std::atomic<int64_t>* server_bytes, int64_t max_server_bytes);
+
+  // The size of the scanner's last batch, as picked by
+  // ScannerManager::PickBatchSize(), or 0 before its first one.
+  size_t batch_size_bytes() const {
+    lock_.AssertAcquired();
+    return batch_size_bytes_;
+  }
+
+  // Records that a batch of 'size_bytes' was built between 'start' and 'end'.
+  void RecordBatch(size_t size_bytes, const MonoTime& start, const MonoTime& end) {
+    lock_.AssertAcquired();
+    batch_size_bytes_ = size_bytes;
+    last_batch_duration_ = end - start;
+    last_batch_end_ = end;
+  }
+
+  // The time it took to build the last batch, and the time it was done.
+  const MonoDelta& last_batch_duration() const {
+    lock_.AssertAcquired();
+    return last_batch_duration_;
+  }
+  const MonoTime& last_batch_end() const {
+    lock_.AssertAcquired();
+    return last_batch_end_;
+  }
+
   const std::string& id() const { return id_; }
 
   // Return the ScanSpec associated with this Scanner.
@@ -307,6 +516,22 @@ class Scanner {
     call_seq_id_++;
   }
 
+  // Keeps 'resume', which continues the scan with the call sequence ID
+  // 'seq_id', until the calls before it are done: see
+  // TakeParkedContinuation(). Returns false if a call with that sequence ID is
+  // parked already.
+  //
+  // The parked calls left when the scanner is destroyed are resumed then, and
+  // fail to find the scanner.
+  bool ParkContinuation(uint32_t seq_id, std::function<void()> resume) {
+    lock_.AssertAcquired();
+    return parked_continuations_.emplace(seq_id, std::move(resume)).second;
+  }
+
+  // Returns the parked call with the current call sequence ID, if any, so
+  // that it's resumed once the caller releases the scanner.
+  std::function<void()> TakeParkedContinuation();
+
   // Return the delta from the last time this scan was updated to 'now'.
   MonoDelta TimeSinceLastAccess(const MonoTime& now) const {
     std::unique_lock<Mutex> l(lock_, std::try_to_lock);
@@ -364,6 +589,10 @@ class Scanner {
   // Does not require the AccessLock.
   CpuTimes cpu_times() const;
 
+  // Returns the profile accounted to this scanner.
+  // Does not require the AccessLock.
+  ScanProfile profile() const;
+
  private:
   friend class ScannerManager;
 
@@ -417,6 +646,39 @@ class Scanner {
   // Assumed to be set once initted_ is true.
   std::unique_ptr<Schema> client_projection_schema_;
 
+  // The block returned by row_block(), and its memory, if any. Declared after
+  // 'iter_' so that they're destroyed first.
+  std::unique_ptr<RowBlockMemory> row_block_memory_;
+  std::unique_ptr<RowBlock> row_block_;
+
+  // The predicates added by AddRuntimeFilters(). Their values are allocated
+  // from 'arena_'.
+  ScanSpec runtime_filters_;
+
+  // A block of rows read ahead by ReadAhead(), with its memory.
+  struct ReadAheadBlock {
+    std::unique_ptr<RowBlockMemory> memory;
+    std::unique_ptr<RowBlock> block;
+    int64_t bytes;
+  };
+
+  // The blocks read ahead and not returned by NextBlock() yet, in order.
+  std::deque<ReadAheadBlock> read_ahead_blocks_;
+
+  // The read-ahead block last returned by NextBlock(), if any.
+  ReadAheadBlock returned_read_ahead_block_;
+
+  // The error the read-ahead stopped at.
+  Status read_ahead_status_;
+
+  // The amount of row data in 'read_ahead_blocks_', and the server-wide
+  // total it's accounted to, if any.
+  int64_t read_ahead_bytes_ = 0;
+  std::atomic<int64_t>* server_read_ahead_bytes_ = nullptr;
+
+  // Incremented by CancelReadAhead().
+  std::atomic<uint64_t> read_ahead_seq_ { 0 };
+
   // The last time that the scanner was accessed.
   // Only modified under lock_ but can be read outside.
   std::atomic<MonoTime> last_access_time_;
@@ -425,6 +687,15 @@ class Scanner {
   // Only modified under lock_ but can be read outside.
   uint32_t call_seq_id_;
 
+  // The last batch, see RecordBatch(). Protected by lock_.
+  size_t batch_size_bytes_ = 0;
+  MonoDelta last_batch_duration_;
+  MonoTime last_batch_end_;
+
+  // The continuations which arrived ahead of their turn, by call sequence ID.
+  // Protected by lock_.
+  std::map<uint32_t, std::function<void()>> parked_continuations_;
+
   // A summary of the statistics already reported to the metrics system
   // for this scanner. This allows us to report the metrics incrementally
   // as the scanner proceeds.
@@ -436,9 +707,10 @@ class Scanner {
   int64_t num_rows_returned_;
 
   // The cumulative amounts of wall, user cpu, and system cpu time spent on
-  // this scanner, in seconds.
+  // this scanner, in seconds, and the cumulative profile of its phases.
   mutable RWMutex cpu_times_lock_;
   CpuTimes cpu_times_;
+  ScanProfile profile_;
 
   DISALLOW_COPY_AND_ASSIGN(Scanner);
 };
@@ -484,9 +756,14 @@ struct ScanDescriptor {
   // The cumulative amounts of wall, user cpu, and system cpu time spent on
   // this scanner, in seconds.
   CpuTimes cpu_times;
+
+  // The cumulative profile of the scan's phases.
+  ScanProfile profile;
 };
 
 // RAII wrapper to update a scanner with timing information upon scope exit.
+// The scanner's profile is updated with the trace metrics of the current
+// trace counted in the scope.
 class ScopedAddScannerTiming {
  public:
   // 'scanner' must outlive the scoped object.
@@ -495,7 +772,8 @@ class ScopedAddScannerTiming {
   explicit ScopedAddScannerTiming(Scanner* scanner, CpuTimes* cpu_times)
       : stopped_(false),
         scanner_(scanner),
-        cpu_times_(cpu_times) {
+        cpu_times_(cpu_times),
+        start_profile_(ScanProfile::FromTrace(Trace::CurrentTrace())) {
     sw_.start();
   }
 
@@ -510,12 +788,16 @@ class ScopedAddScannerTiming {
     stopped_ = true;
     sw_.stop();
     scanner_->AddTimings(sw_.elapsed());
+    ScanProfile profile = ScanProfile::FromTrace(Trace::CurrentTrace());
+    profile -= start_profile_;
+    scanner_->AddProfile(profile);
     *cpu_times_ = scanner_->cpu_times();
   }
 
   bool stopped_;
   Scanner* scanner_;
   CpuTimes* cpu_times_;
+  const ScanProfile start_profile_;
   Stopwatch sw_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedAddScannerTiming);
@@ -521,6 +521,49 @@ TEST_P(TabletCopyClientBasicTest, TestDownloadAllBlocks) {
   }
 }
 
+// Test that a copy replacing a replica which was copied from the same source
+// reuses the blocks of the replica rather than download them.
+TEST_P(TabletCopyClientBasicTest, TestReuseLocalBlocks) {
+  ASSERT_OK(StartCopy());
+  ASSERT_OK(client_->FetchAll(nullptr /* no listener */));
+  ASSERT_OK(client_->Finish());
+  vector<BlockId> old_blocks = ListBlocks(*client_->superblock_);
+  ASSERT_GT(old_blocks.size(), 0);
+
+  // Copy the tablet again, the blocks of the replica being kept open as the
+  // tablet manager does when replacing a replica.
+  unique_ptr<ReusableLocalBlocks> local_blocks;
+  ASSERT_OK(ReusableLocalBlocks::Open(fs_manager_.get(), meta_, &local_blocks));
+  ASSERT_EQ(old_blocks.size(), local_blocks->num_blocks());
+  meta_->set_tablet_data_state(tablet::TABLET_DATA_TOMBSTONED);
+  ASSERT_OK(ResetTabletCopyClient());
+  ASSERT_OK(client_->SetTabletToReplace(meta_, 0));
+  client_->SetLocalBlocksToReuse(std::move(local_blocks));
+  ASSERT_OK(StartCopy());
+
+  // None of the blocks can be downloaded: the copy only succeeds if they're
+  // all reused, which the local copies can't do.
+  FLAGS_tablet_copy_fault_crash_during_download_block = 1;
+  Status s = client_->DownloadBlocks();
+  if (mode_ == TabletCopyMode::LOCAL) {
+    ASSERT_TRUE(s.IsIOError()) << s.ToString();
+    return;
+  }
+  ASSERT_OK(s);
+  ASSERT_OK(client_->transaction_->CommitCreatedBlocks());
+
+  vector<BlockId> new_blocks = ListBlocks(*client_->superblock_);
+  ASSERT_EQ(ListBlocks(*client_->remote_superblock_).size(), new_blocks.size());
+  for (const BlockId& block_id : new_blocks) {
+    unique_ptr<fs::ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  }
+  // The blocks of the replaced replica are gone.
+  for (const BlockId& block_id : old_blocks) {
+    ASSERT_FALSE(fs_manager_->BlockExists(block_id));
+  }
+}
+
 // Test that failing a disk outside fo the tablet copy client will eventually
 // stop the copy client and cause it to fail.
 TEST_P(TabletCopyClientBasicTest, TestFailedDiskStopsClient) {
@@ -17,12 +17,14 @@
 
 #include "kudu/tserver/tablet_copy_client.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include <boost/optional/optional.hpp>
 #include <gflags/gflags.h>
@@ -41,11 +43,14 @@
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_scheduler.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -53,6 +58,7 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/tablet/metadata.pb.h"
+#include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
 #include "kudu/tserver/tablet_copy.pb.h"
@@ -73,6 +79,7 @@
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/scoped_cleanup.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
@@ -142,6 +149,13 @@ DEFINE_int32(tablet_copy_download_threads_nums_per_session, 4,
 DEFINE_validator(tablet_copy_download_threads_nums_per_session,
      [](const char* /*n*/, int32_t v) { return v > 0; });
 
+DEFINE_bool(tablet_copy_reuse_local_blocks, false,
+            "Whether the tablet copies replacing a replica which has fallen behind "
+            "reuse the blocks of the replica having the same data as the source's, "
+            "copying them locally rather than downloading them.");
+TAG_FLAG(tablet_copy_reuse_local_blocks, experimental);
+TAG_FLAG(tablet_copy_reuse_local_blocks, runtime);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 METRIC_DEFINE_counter(server, tablet_copy_bytes_fetched,
@@ -150,6 +164,13 @@ METRIC_DEFINE_counter(server, tablet_copy_bytes_fetched,
                       "Number of bytes fetched during tablet copy operations since server start",
                       kudu::MetricLevel::kDebug);
 
+METRIC_DEFINE_counter(server, tablet_copy_bytes_reused,
+                      "Bytes Reused By Tablet Copy",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of the blocks of replaced replicas reused rather "
+                      "than fetched during tablet copy operations since server start",
+                      kudu::MetricLevel::kDebug);
+
 METRIC_DEFINE_gauge_int32(server, tablet_copy_open_client_sessions,
                           "Open Table Copy Client Sessions",
                           kudu::MetricUnit::kSessions,
@@ -165,16 +186,19 @@ namespace tserver {
 
 using consensus::ConsensusMetadata;
 using consensus::ConsensusMetadataManager;
+using consensus::IsRaftConfigWitness;
 using consensus::MakeOpId;
 using consensus::OpId;
 using fs::BlockManager;
 using fs::CreateBlockOptions;
+using fs::ReadableBlock;
 using fs::WritableBlock;
 using rpc::Messenger;
 using std::atomic;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 using tablet::ColumnDataPB;
 using tablet::DeltaDataPB;
@@ -185,8 +209,60 @@ using tablet::TabletMetadata;
 using tablet::TabletReplica;
 using tablet::TabletSuperBlockPB;
 
+Status ReusableLocalBlocks::Open(FsManager* fs_manager,
+                                 const scoped_refptr<TabletMetadata>& meta,
+                                 unique_ptr<ReusableLocalBlocks>* blocks) {
+  unique_ptr<ReusableLocalBlocks> ret(new ReusableLocalBlocks);
+  for (const auto& rowset : meta->rowsets()) {
+    vector<LocalBlock>* rowset_blocks = &ret->blocks_by_rowset_[rowset->id()];
+    for (const BlockId& block_id : rowset->GetAllBlocks()) {
+      unique_ptr<ReadableBlock> block;
+      RETURN_NOT_OK_PREPEND(fs_manager->OpenBlock(block_id, &block),
+                            Substitute("Unable to open block $0", block_id.ToString()));
+      uint64_t size;
+      RETURN_NOT_OK(block->Size(&size));
+      LocalBlock local_block;
+      local_block.info.reset(new ImmutableReadableBlockInfo(block.release(), size));
+      rowset_blocks->emplace_back(std::move(local_block));
+      ret->num_blocks_++;
+    }
+  }
+  *blocks = std::move(ret);
+  return Status::OK();
+}
+
+bool ReusableLocalBlocks::HasRowSet(int64_t rowset_id) const {
+  return ContainsKey(blocks_by_rowset_, rowset_id);
+}
+
+Status ReusableLocalBlocks::Find(int64_t rowset_id, int64_t length, uint32_t crc32,
+                                 const ImmutableReadableBlockInfo** block) {
+  *block = nullptr;
+  vector<LocalBlock>* rowset_blocks = FindOrNull(blocks_by_rowset_, rowset_id);
+  if (!rowset_blocks) {
+    return Status::OK();
+  }
+  for (auto& local_block : *rowset_blocks) {
+    if (local_block.info->size != length) {
+      continue;
+    }
+    if (!local_block.has_crc32) {
+      RETURN_NOT_OK_PREPEND(local_block.info->Checksum(&local_block.crc32),
+                            Substitute("Unable to checksum block $0",
+                                       local_block.info->readable->id().ToString()));
+      local_block.has_crc32 = true;
+    }
+    if (local_block.crc32 == crc32) {
+      *block = local_block.info.get();
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
 TabletCopyClientMetrics::TabletCopyClientMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : bytes_fetched(METRIC_tablet_copy_bytes_fetched.Instantiate(metric_entity)),
+      bytes_reused(METRIC_tablet_copy_bytes_reused.Instantiate(metric_entity)),
       open_client_sessions(METRIC_tablet_copy_open_client_sessions.Instantiate(metric_entity, 0)) {
 }
 
@@ -205,7 +281,8 @@ TabletCopyClient::TabletCopyClient(
       session_idle_timeout_millis_(FLAGS_tablet_copy_begin_session_timeout_ms),
       start_time_micros_(0),
       rng_(GetRandomSeed32()),
-      dst_tablet_copy_metrics_(dst_tablet_copy_metrics) {
+      dst_tablet_copy_metrics_(dst_tablet_copy_metrics),
+      source_supports_checksums_(true) {
   BlockManager* bm = dst_fs_manager->block_manager();
   transaction_ = bm->NewCreationTransaction();
   if (dst_tablet_copy_metrics_) {
@@ -226,6 +303,10 @@ TabletCopyClient::~TabletCopyClient() {
   }
 }
 
+void TabletCopyClient::SetLocalBlocksToReuse(unique_ptr<ReusableLocalBlocks> blocks) {
+  local_blocks_ = std::move(blocks);
+}
+
 Status TabletCopyClient::SetTabletToReplace(const scoped_refptr<TabletMetadata>& meta,
                                             int64_t caller_term) {
   CHECK_EQ(tablet_id_, meta->tablet_id());
@@ -456,7 +537,13 @@ Status TabletCopyClient::FetchAll(const scoped_refptr<TabletReplica>& tablet_rep
   // Download all the tablet's files.
   // Data blocks are downloaded in parallel, where the concurrency is
   // controlled by the --tablet_copy_download_threads_num_per_session flag.
-  RETURN_NOT_OK(DownloadBlocks());
+  // A witness replica keeps only the WAL, so it skips the data blocks and
+  // ends up with an empty superblock.
+  if (IsRaftConfigWitness(dst_fs_manager_->uuid(), remote_cstate_->committed_config())) {
+    LOG_WITH_PREFIX(INFO) << "Replica is a witness, skipping download of data blocks";
+  } else {
+    RETURN_NOT_OK(DownloadBlocks());
+  }
   RETURN_NOT_OK(DownloadWALs());
 
   return Status::OK();
@@ -637,6 +724,9 @@ int TabletCopyClient::CountRemoteBlocks() const {
     num_blocks += rowset.columns_size();
     num_blocks += rowset.redo_deltas_size();
     num_blocks += rowset.undo_deltas_size();
+    num_blocks += rowset.secondary_indexes_size();
+    num_blocks += rowset.bitmap_indexes_size();
+    num_blocks += rowset.column_bloom_filters_size();
     if (rowset.has_bloom_block()) {
       num_blocks++;
     }
@@ -670,6 +760,9 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   dst_rowset->clear_undo_deltas();
   dst_rowset->clear_bloom_block();
   dst_rowset->clear_adhoc_index_block();
+  dst_rowset->clear_secondary_indexes();
+  dst_rowset->clear_bitmap_indexes();
+  dst_rowset->clear_column_bloom_filters();
 
   // We can't leave superblock_ unserializable with unset required field
   // values in child elements, so we must download and rewrite each block
@@ -677,8 +770,9 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   Status s;
   for (const ColumnDataPB& src_col : src_rowset.columns()) {
     BlockIdPB new_block_id;
-    s = DownloadAndRewriteBlockIfEndStatusOK(src_col.block(), num_remote_blocks,
-                                             block_count, &new_block_id, end_status);
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_col.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
     if (!s.ok()) {
       return;
     }
@@ -688,8 +782,9 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   }
   for (const DeltaDataPB& src_redo : src_rowset.redo_deltas()) {
     BlockIdPB new_block_id;
-    s = DownloadAndRewriteBlockIfEndStatusOK(src_redo.block(), num_remote_blocks,
-                                             block_count, &new_block_id, end_status);
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_redo.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
     if (!s.ok()) {
       return;
     }
@@ -699,8 +794,9 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   }
   for (const DeltaDataPB& src_undo : src_rowset.undo_deltas()) {
     BlockIdPB new_block_id;
-    s = DownloadAndRewriteBlockIfEndStatusOK(src_undo.block(), num_remote_blocks,
-                                             block_count, &new_block_id, end_status);
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_undo.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
     if (!s.ok()) {
       return;
     }
@@ -710,8 +806,9 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   }
   if (src_rowset.has_bloom_block()) {
     BlockIdPB new_block_id;
-    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.bloom_block(), num_remote_blocks,
-                                             block_count, &new_block_id, end_status);
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_rowset.bloom_block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
     if (!s.ok()) {
       return;
     }
@@ -719,13 +816,50 @@ void TabletCopyClient::DownloadRowset(const RowSetDataPB& src_rowset,
   }
   if (src_rowset.has_adhoc_index_block()) {
     BlockIdPB new_block_id;
-    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.adhoc_index_block(), num_remote_blocks,
-                                             block_count, &new_block_id, end_status);
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_rowset.adhoc_index_block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
     if (!s.ok()) {
       return;
     }
     *dst_rowset->mutable_adhoc_index_block() = new_block_id;
   }
+  for (const ColumnDataPB& src_index : src_rowset.secondary_indexes()) {
+    BlockIdPB new_block_id;
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_index.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
+    if (!s.ok()) {
+      return;
+    }
+    ColumnDataPB* dst_index = dst_rowset->add_secondary_indexes();
+    *dst_index = src_index;
+    *dst_index->mutable_block() = new_block_id;
+  }
+  for (const ColumnDataPB& src_index : src_rowset.bitmap_indexes()) {
+    BlockIdPB new_block_id;
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_index.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
+    if (!s.ok()) {
+      return;
+    }
+    ColumnDataPB* dst_index = dst_rowset->add_bitmap_indexes();
+    *dst_index = src_index;
+    *dst_index->mutable_block() = new_block_id;
+  }
+  for (const ColumnDataPB& src_bloom : src_rowset.column_bloom_filters()) {
+    BlockIdPB new_block_id;
+    s = DownloadAndRewriteBlockIfEndStatusOK(src_rowset.id(), src_bloom.block(),
+                                             num_remote_blocks, block_count,
+                                             &new_block_id, end_status);
+    if (!s.ok()) {
+      return;
+    }
+    ColumnDataPB* dst_bloom = dst_rowset->add_column_bloom_filters();
+    *dst_bloom = src_bloom;
+    *dst_bloom->mutable_block() = new_block_id;
+  }
 }
 
 Status TabletCopyClient::DownloadBlocks() {
@@ -744,6 +878,7 @@ Status TabletCopyClient::DownloadBlocks() {
   // Each task downloads the blocks of the corresponding rowset sequentially.
   for (const RowSetDataPB& src_rowset : remote_superblock_->rowsets()) {
     RETURN_NOT_OK(tablet_download_pool_->Submit([&]() mutable {
+      fs::ScopedIOPriority io_priority(fs::IOPriority::TABLET_COPY);
       DownloadRowset(src_rowset, num_remote_blocks, &block_count, &end_status);
     }));
   }
@@ -817,7 +952,8 @@ Status TabletCopyClient::WriteConsensusMetadata() {
   return Status::OK();
 }
 
-Status TabletCopyClient::DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
+Status TabletCopyClient::DownloadAndRewriteBlock(int64_t rowset_id,
+                                                 const BlockIdPB& src_block_id,
                                                  int num_blocks,
                                                  atomic<int32_t>* block_count,
                                                  BlockIdPB* dest_block_id) {
@@ -826,15 +962,23 @@ Status TabletCopyClient::DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
                               old_block_id.ToString(),
                               block_count->load() + 1 , num_blocks));
   BlockId new_block_id;
-  RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
-      "Unable to download block with id " + old_block_id.ToString());
+  bool reused = false;
+  if (local_blocks_ && local_blocks_->HasRowSet(rowset_id) && source_supports_checksums_) {
+    RETURN_NOT_OK_PREPEND(ReuseLocalBlock(rowset_id, old_block_id, &new_block_id, &reused),
+        "Unable to look for a local copy of block with id " + old_block_id.ToString());
+  }
+  if (!reused) {
+    RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
+        "Unable to download block with id " + old_block_id.ToString());
+  }
 
   new_block_id.CopyToPB(dest_block_id);
   (*block_count)++;
   return Status::OK();
 }
 
-Status TabletCopyClient::DownloadAndRewriteBlockIfEndStatusOK(const BlockIdPB& src_block_id,
+Status TabletCopyClient::DownloadAndRewriteBlockIfEndStatusOK(int64_t rowset_id,
+                                                              const BlockIdPB& src_block_id,
                                                               int num_blocks,
                                                               atomic<int32_t>* block_count,
                                                               BlockIdPB* dest_block_id,
@@ -843,7 +987,8 @@ Status TabletCopyClient::DownloadAndRewriteBlockIfEndStatusOK(const BlockIdPB& s
     std::lock_guard<simple_spinlock> l(simple_lock_);
     RETURN_NOT_OK(*end_status);
   }
-  Status s = DownloadAndRewriteBlock(src_block_id, num_blocks, block_count, dest_block_id);
+  Status s = DownloadAndRewriteBlock(rowset_id, src_block_id, num_blocks, block_count,
+                                     dest_block_id);
   if (!s.ok()) {
     std::lock_guard<simple_spinlock> l(simple_lock_);
     if (!s.ok() && end_status->ok()) {
@@ -881,6 +1026,100 @@ Status TabletCopyClient::DownloadBlock(const BlockId& old_block_id,
   return Status::OK();
 }
 
+Status TabletCopyClient::ReuseLocalBlock(int64_t rowset_id,
+                                         const BlockId& old_block_id,
+                                         BlockId* new_block_id,
+                                         bool* reused) {
+  *reused = false;
+  int64_t length;
+  uint32_t crc32;
+  Status s = FetchBlockChecksum(old_block_id, &length, &crc32);
+  if (s.IsNotSupported()) {
+    LOG_WITH_PREFIX(INFO) << "Not reusing local blocks: " << s.ToString();
+    source_supports_checksums_ = false;
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+
+  // The local blocks are only an optimization: failing to read them isn't an
+  // error, the block is downloaded instead.
+  const ImmutableReadableBlockInfo* local_block;
+  s = local_blocks_->Find(rowset_id, length, crc32, &local_block);
+  if (!s.ok()) {
+    LOG_WITH_PREFIX(WARNING) << "Unable to look for a local copy of block "
+                             << old_block_id.ToString() << ": " << s.ToString();
+    return Status::OK();
+  }
+  if (!local_block) {
+    return Status::OK();
+  }
+  VLOG_WITH_PREFIX(1) << Substitute("Reusing local block $0 for block $1",
+                                    local_block->readable->id().ToString(),
+                                    old_block_id.ToString());
+  RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(), "Not copying block for replica");
+
+  unique_ptr<WritableBlock> block;
+  RETURN_NOT_OK_PREPEND(dst_fs_manager_->CreateNewBlock(CreateBlockOptions({ tablet_id_ }), &block),
+                        "Unable to create new block");
+  const int64_t buf_size = std::min<int64_t>(length, FLAGS_tablet_copy_transfer_chunk_size_bytes);
+  unique_ptr<uint8_t[]> buf(new uint8_t[std::max<int64_t>(buf_size, 1)]);
+  uint32_t copied_crc32 = 0;
+  for (int64_t offset = 0; offset < length; offset += buf_size) {
+    Slice slice(buf.get(), std::min(buf_size, length - offset));
+    s = local_block->Read(offset, slice);
+    if (!s.ok()) {
+      LOG_WITH_PREFIX(WARNING) << "Unable to read local block "
+                               << local_block->readable->id().ToString() << ": " << s.ToString();
+      return Status::OK();
+    }
+    // The data is checksummed again as it's copied: a local block which
+    // changed since it was first checksummed would be corrupt anyway.
+    copied_crc32 = crc::Crc32c(slice.data(), slice.size(), copied_crc32);
+    RETURN_NOT_OK_PREPEND(block->Append(slice), "Unable to write block");
+  }
+  if (PREDICT_FALSE(copied_crc32 != crc32)) {
+    LOG_WITH_PREFIX(WARNING) << "Local block " << local_block->readable->id().ToString()
+                             << " changed while copied";
+    return Status::OK();
+  }
+
+  *new_block_id = block->id();
+  RETURN_NOT_OK_PREPEND(block->Finalize(), "Unable to finalize block");
+  {
+    std::lock_guard<simple_spinlock> l(simple_lock_);
+    transaction_->AddCreatedBlock(std::move(block));
+  }
+  if (dst_tablet_copy_metrics_) {
+    dst_tablet_copy_metrics_->bytes_reused->IncrementBy(length);
+  }
+  *reused = true;
+  return Status::OK();
+}
+
+Status RemoteTabletCopyClient::FetchBlockChecksum(const BlockId& block_id,
+                                                  int64_t* length,
+                                                  uint32_t* crc32) {
+  rpc::RpcController controller;
+  controller.set_timeout(MonoDelta::FromMilliseconds(session_idle_timeout_millis_));
+  FetchDataRequestPB req;
+  req.set_session_id(session_id_);
+  req.mutable_data_id()->set_type(DataIdPB::BLOCK);
+  block_id.CopyToPB(req.mutable_data_id()->mutable_block_id());
+  req.set_checksum_only(true);
+
+  FetchDataResponsePB resp;
+  RETURN_NOT_OK_PREPEND(SendRpcWithRetry(&controller, [&] {
+      return proxy_->FetchData(req, &resp, &controller);
+  }), "unable to fetch block checksum from remote");
+  // The sources which don't know of checksum-only fetches send data instead.
+  if (!resp.has_data_crc32()) {
+    return Status::NotSupported("tablet copy source can't send only checksums");
+  }
+  *length = resp.chunk().total_data_length();
+  *crc32 = resp.data_crc32();
+  return Status::OK();
+}
+
 template<class Appendable>
 Status RemoteTabletCopyClient::DownloadFile(const DataIdPB& data_id,
                                             Appendable* appendable) {
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -75,9 +76,58 @@ struct TabletCopyClientMetrics {
   explicit TabletCopyClientMetrics(const scoped_refptr<MetricEntity>& metric_entity);
 
   scoped_refptr<Counter> bytes_fetched;
+  scoped_refptr<Counter> bytes_reused;
   scoped_refptr<AtomicGauge<int32_t>> open_client_sessions;
 };
 
+// The blocks of a local replica which a tablet copy is about to replace, kept
+// open so that they remain readable once the replica's data is deleted: the
+// copy may then reuse those of the blocks which the copy source has too,
+// rather than download them.
+//
+// The rowsets keep their ids across tablet copies, so a replica which was
+// copied from the source, or from the same replica as the source, before
+// falling behind has rowsets of the same ids and data as the source's, unless
+// they were compacted since. Only the blocks of the local rowsets having the
+// id of a source's rowset are considered, and a block is only reused if it
+// has the length and checksum of the source's.
+class ReusableLocalBlocks {
+ public:
+  // Opens the blocks of the rowsets of 'meta', which must not be changed
+  // while this is called, e.g. because its replica is shut down.
+  static Status Open(FsManager* fs_manager,
+                     const scoped_refptr<tablet::TabletMetadata>& meta,
+                     std::unique_ptr<ReusableLocalBlocks>* blocks);
+
+  // Returns whether the local replica has a rowset with id 'rowset_id'.
+  bool HasRowSet(int64_t rowset_id) const;
+
+  // Sets '*block' to a block of the local rowset 'rowset_id' of 'length'
+  // bytes whose CRC32C is 'crc32', or to nullptr if there is none.
+  //
+  // May be called concurrently for different rowsets.
+  Status Find(int64_t rowset_id, int64_t length, uint32_t crc32,
+              const ImmutableReadableBlockInfo** block);
+
+  int num_blocks() const { return num_blocks_; }
+
+ private:
+  struct LocalBlock {
+    std::unique_ptr<ImmutableReadableBlockInfo> info;
+
+    // The CRC32C of the block, computed the first time it's needed.
+    bool has_crc32 = false;
+    uint32_t crc32 = 0;
+  };
+
+  ReusableLocalBlocks() = default;
+
+  std::unordered_map<int64_t, std::vector<LocalBlock>> blocks_by_rowset_;
+  int num_blocks_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(ReusableLocalBlocks);
+};
+
 // Client class for using tablet copy to copy a tablet from another host.
 // This class is not thread-safe.
 //
@@ -98,6 +148,10 @@ class TabletCopyClient {
   Status SetTabletToReplace(const scoped_refptr<tablet::TabletMetadata>& meta,
                             int64_t caller_term);
 
+  // Makes the copy reuse those of the local 'blocks' which the copy source
+  // has too, rather than download them. Must be called before FetchAll().
+  void SetLocalBlocksToReuse(std::unique_ptr<ReusableLocalBlocks> blocks);
+
   // Start up a tablet copy session to bootstrap from the specified
   // bootstrap peer. Place a new superblock indicating that tablet copy is
   // in progress. If the 'metadata' pointer is passed as NULL, it is ignored,
@@ -142,6 +196,7 @@ class TabletCopyClient {
   FRIEND_TEST(TabletCopyClientBasicTest, TestDownloadWalMayFail);
   FRIEND_TEST(TabletCopyClientBasicTest, TestDownloadWalSegment);
   FRIEND_TEST(TabletCopyClientBasicTest, TestDownloadAllBlocks);
+  FRIEND_TEST(TabletCopyClientBasicTest, TestReuseLocalBlocks);
   FRIEND_TEST(TabletCopyClientAbortTest, TestAbort);
 
   // Construct the tablet copy client.
@@ -225,15 +280,18 @@ class TabletCopyClient {
   // is populated to reflect the new block IDs.
   Status DownloadBlocks();
 
-  // Download the remote block specified by 'src_block_id'. 'num_blocks' should
-  // be given as the total number of blocks there are to download (for logging
-  // purposes). Add the block to the tablet copy's transaction, to close blocks
-  // belonging to the transaction together when the copying is complete.
+  // Download the remote block specified by 'src_block_id', of the rowset
+  // 'rowset_id', or copy it from a local block to reuse if there is one with
+  // the same data. 'num_blocks' should be given as the total number of blocks
+  // there are to download (for logging purposes). Add the block to the tablet
+  // copy's transaction, to close blocks belonging to the transaction together
+  // when the copying is complete.
   //
   // On success:
   // - 'dest_block_id' is set to the new ID of the downloaded block.
   // - 'block_count' is incremented by 1.
-  Status DownloadAndRewriteBlock(const BlockIdPB& src_block_id,
+  Status DownloadAndRewriteBlock(int64_t rowset_id,
+                                 const BlockIdPB& src_block_id,
                                  int num_blocks,
                                  std::atomic<int32_t>* block_count,
                                  BlockIdPB* dest_block_id);
@@ -243,7 +301,8 @@ class TabletCopyClient {
   // This method is thread-safe.
   //
   // On failure, end_status is set as error status of DownloadAndRewriteBlock.
-  Status DownloadAndRewriteBlockIfEndStatusOK(const BlockIdPB& src_block_id,
+  Status DownloadAndRewriteBlockIfEndStatusOK(int64_t rowset_id,
+                                              const BlockIdPB& src_block_id,
                                               int num_blocks,
                                               std::atomic<int32_t>* block_count,
                                               BlockIdPB* dest_block_id,
@@ -257,6 +316,26 @@ class TabletCopyClient {
   Status DownloadBlock(const BlockId& old_block_id,
                        BlockId* new_block_id);
 
+  // Looks for a local block of the rowset 'rowset_id' with the data of the
+  // remote block 'old_block_id', and if there is one, copies it into a new
+  // block which is added to the tablet copy's transaction.
+  //
+  // On success, '*reused' is set to whether the block was copied, in which
+  // case 'new_block_id' is set to the new ID of the block.
+  Status ReuseLocalBlock(int64_t rowset_id,
+                         const BlockId& old_block_id,
+                         BlockId* new_block_id,
+                         bool* reused);
+
+  // Sets '*length' and '*crc32' to the length and the CRC32C of the block
+  // 'block_id' of the source, without transferring its data. Returns
+  // NotSupported if the source can't do that.
+  virtual Status FetchBlockChecksum(const BlockId& /*block_id*/,
+                                    int64_t* /*length*/,
+                                    uint32_t* /*crc32*/) {
+    return Status::NotSupported("fetching block checksums not supported");
+  }
+
   virtual Status TransferFile(const DataIdPB& data_id, fs::WritableBlock* appendable) = 0;
   virtual Status TransferFile(const DataIdPB& data_id, WritableFile* appendable) = 0;
 
@@ -304,6 +383,13 @@ class TabletCopyClient {
 
   TabletCopyClientMetrics* dst_tablet_copy_metrics_;
 
+  // The local blocks to reuse, if any.
+  std::unique_ptr<ReusableLocalBlocks> local_blocks_;
+
+  // Whether the source may be asked for the checksums of blocks, which is
+  // cleared the first time it can't.
+  std::atomic<bool> source_supports_checksums_;
+
   // Block transaction for the tablet copy.
   std::unique_ptr<fs::BlockCreationTransaction> transaction_;
 
@@ -335,6 +421,10 @@ class RemoteTabletCopyClient : public TabletCopyClient {
   Status TransferFile(const DataIdPB& data_id, fs::WritableBlock* appendable) override;
   Status TransferFile(const DataIdPB& data_id, WritableFile* appendable) override;
 
+  Status FetchBlockChecksum(const BlockId& block_id,
+                            int64_t* length,
+                            uint32_t* crc32) override;
+
   // Download a single remote file. The block and WAL implementations delegate
   // to this method when downloading files.
   //
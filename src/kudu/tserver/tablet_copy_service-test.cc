@@ -60,6 +60,7 @@
 
 DECLARE_bool(crash_on_eio);
 DECLARE_double(env_inject_eio);
+DECLARE_int64(tablet_copy_source_bytes_per_sec);
 DECLARE_uint64(tablet_copy_idle_timeout_sec);
 DECLARE_uint64(tablet_copy_timeout_poll_period_ms);
 
@@ -449,6 +450,39 @@ TEST_F(TabletCopyServiceTest, TestFetchBlockIncrementally) {
   }
 }
 
+class TabletCopyServiceThrottledTest : public TabletCopyServiceTest {
+ protected:
+  void SetUp() override {
+    // 100 bytes per 100ms refill period.
+    FLAGS_tablet_copy_source_bytes_per_sec = 1000;
+    TabletCopyServiceTest::SetUp();
+  }
+};
+
+// Test that the chunks sent are capped by the bandwidth limit, and that the
+// requests beyond it are rejected as retriable errors.
+TEST_F(TabletCopyServiceThrottledTest, TestFetchThrottled) {
+  string session_id;
+  tablet::TabletSuperBlockPB superblock;
+  ASSERT_OK(DoBeginValidTabletCopySession(&session_id, &superblock));
+  const DataIdPB data_id = AsDataTypeId(FirstColumnBlockId(superblock));
+
+  bool throttled = false;
+  for (int i = 0; i < 10 && !throttled; i++) {
+    FetchDataResponsePB resp;
+    RpcController controller;
+    Status s = DoFetchData(session_id, data_id, nullptr, nullptr, &resp, &controller);
+    if (s.ok()) {
+      ASSERT_LE(resp.chunk().data().size(), 100);
+      continue;
+    }
+    ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+    ASSERT_EQ(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, controller.error_response()->code());
+    throttled = true;
+  }
+  ASSERT_TRUE(throttled);
+}
+
 // Test that we are able to fetch log segments.
 TEST_F(TabletCopyServiceTest, TestFetchLog) {
   string session_id;
@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/tserver/tablet_copy_service.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <ostream>
@@ -70,6 +71,15 @@ DEFINE_uint64(tablet_copy_timeout_poll_period_ms, 10000,
               "tablet copy sessions, in millis");
 TAG_FLAG(tablet_copy_timeout_poll_period_ms, hidden);
 
+DEFINE_int64(tablet_copy_source_bytes_per_sec, 0,
+             "Maximum rate (bytes/s) at which this server sends the data of its "
+             "tablets to the tablet servers copying them, across all the tablet "
+             "copy sessions, including the ones of replica moves. Requests for "
+             "data beyond this rate are rejected, and retried after a backoff "
+             "by the copying servers. 0 means no limit.");
+TAG_FLAG(tablet_copy_source_bytes_per_sec, advanced);
+TAG_FLAG(tablet_copy_source_bytes_per_sec, experimental);
+
 DEFINE_double(fault_crash_on_handle_tc_fetch_data, 0.0,
               "Fraction of the time when the tablet will crash while "
               "servicing a TabletCopyService FetchData() RPC call. "
@@ -111,6 +121,14 @@ TabletCopyServiceImpl::TabletCopyServiceImpl(
       rand_(GetRandomSeed32()),
       shutdown_latch_(1),
       tablet_copy_metrics_(server->metric_entity()) {
+  if (FLAGS_tablet_copy_source_bytes_per_sec > 0) {
+    throttler_.reset(new Throttler(MonoTime::Now(), 0, FLAGS_tablet_copy_source_bytes_per_sec,
+                                   /*burst_factor=*/1.0));
+    // The throttler grants at most a refill period's worth of bytes at once.
+    max_throttled_chunk_bytes_ = std::max<int64_t>(
+        1, FLAGS_tablet_copy_source_bytes_per_sec * Throttler::kRefillPeriodMicros /
+           MonoTime::kMicrosecondsPerSecond);
+  }
   CHECK_OK(Thread::Create("tablet-copy", "tc-session-exp",
                           [this]() { this->EndExpiredSessions(); },
                           &session_expiration_thread_));
@@ -290,6 +308,41 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   RPC_RETURN_NOT_OK(ValidateFetchRequestDataId(data_id, &error_code),
                     error_code, "Invalid DataId", context);
 
+  if (req->checksum_only()) {
+    // No data is sent, so the bandwidth limit doesn't apply.
+    if (data_id.type() != DataIdPB::BLOCK) {
+      RPC_RETURN_NOT_OK(
+          Status::InvalidArgument("only the checksums of blocks may be fetched"),
+          TabletCopyErrorPB::INVALID_TABLET_COPY_REQUEST, "Invalid DataId", context);
+    }
+    uint32_t crc32 = 0;
+    int64_t total_data_length = 0;
+    RPC_RETURN_NOT_OK(session->GetBlockChecksum(BlockId::FromPB(data_id.block_id()), &crc32,
+                                                &total_data_length, &error_code),
+                      error_code, "Unable to get checksum of data block", context);
+    DataChunkPB* data_chunk = resp->mutable_chunk();
+    data_chunk->set_offset(0);
+    const string* data = data_chunk->mutable_data();
+    data_chunk->set_crc32(Crc32c(data->data(), data->size()));
+    data_chunk->set_total_data_length(total_data_length);
+    resp->set_data_crc32(crc32);
+    context->RespondSuccess();
+    return;
+  }
+
+  if (throttler_) {
+    if (client_maxlen <= 0 || client_maxlen > max_throttled_chunk_bytes_) {
+      client_maxlen = max_throttled_chunk_bytes_;
+    }
+    if (!throttler_->Take(MonoTime::Now(), 0, client_maxlen)) {
+      tablet_copy_metrics_.fetches_throttled->Increment();
+      context->RespondRpcFailure(
+          rpc::ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
+          Status::ServiceUnavailable("tablet copy bandwidth limit reached"));
+      return;
+    }
+  }
+
   DataChunkPB* data_chunk = resp->mutable_chunk();
   string* data = data_chunk->mutable_data();
   int64_t total_data_length = 0;
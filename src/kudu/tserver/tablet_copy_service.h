@@ -17,6 +17,8 @@
 #ifndef KUDU_TSERVER_TABLET_COPY_SERVICE_H_
 #define KUDU_TSERVER_TABLET_COPY_SERVICE_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <unordered_map>
 
@@ -30,6 +32,7 @@
 #include "kudu/util/random.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/throttler.h"
 
 namespace google {
 namespace protobuf {
@@ -133,6 +136,12 @@ class TabletCopyServiceImpl : public TabletCopyServiceIf {
   scoped_refptr<Thread> session_expiration_thread_;
 
   TabletCopySourceMetrics tablet_copy_metrics_;
+
+  // Limits the rate of the data sent, if --tablet_copy_source_bytes_per_sec
+  // is set, in which case the chunks sent are no larger than
+  // 'max_throttled_chunk_bytes_'.
+  std::unique_ptr<Throttler> throttler_;
+  int64_t max_throttled_chunk_bytes_ = 0;
 };
 
 } // namespace tserver
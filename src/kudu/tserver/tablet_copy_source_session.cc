@@ -39,6 +39,7 @@
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/fs_manager.h"
+#include "kudu/fs/io_scheduler.h"
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
@@ -47,6 +48,7 @@
 #include "kudu/rpc/transfer.h"
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
@@ -65,6 +67,13 @@ METRIC_DEFINE_counter(server, tablet_copy_bytes_sent,
                       "Number of bytes sent during tablet copy operations since server start",
                       kudu::MetricLevel::kDebug);
 
+METRIC_DEFINE_counter(server, tablet_copy_fetches_throttled,
+                      "Tablet Copy Fetches Throttled",
+                      kudu::MetricUnit::kRequests,
+                      "Number of requests for tablet copy data rejected since server "
+                      "start because of --tablet_copy_source_bytes_per_sec",
+                      kudu::MetricLevel::kDebug);
+
 METRIC_DEFINE_gauge_int32(server, tablet_copy_open_source_sessions,
                           "Open Table Copy Source Sessions",
                           kudu::MetricUnit::kSessions,
@@ -94,6 +103,7 @@ using tablet::TabletReplica;
 
 TabletCopySourceMetrics::TabletCopySourceMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : bytes_sent(METRIC_tablet_copy_bytes_sent.Instantiate(metric_entity)),
+      fetches_throttled(METRIC_tablet_copy_fetches_throttled.Instantiate(metric_entity)),
       open_source_sessions(METRIC_tablet_copy_open_source_sessions.Instantiate(metric_entity, 0)) {
 }
 
@@ -130,6 +140,9 @@ Status RemoteTabletCopySourceSession::InitOnce() {
   }
 
   RETURN_NOT_OK(tablet_replica_->CheckRunning());
+  if (PREDICT_FALSE(tablet_replica_->IsWitness())) {
+    return Status::NotSupported("witness replicas can't serve as a tablet copy source");
+  }
   RETURN_NOT_OK(CheckHealthyDirGroup());
 
   // Prevent log GC while we grab log segments and Tablet metadata.
@@ -204,6 +217,19 @@ Status RemoteTabletCopySourceSession::InitOnce() {
   return Status::OK();
 }
 
+Status ImmutableReadableBlockInfo::Checksum(uint32_t* crc32) const {
+  const int64_t buf_size = std::min<int64_t>(size, FLAGS_tablet_copy_transfer_chunk_size_bytes);
+  unique_ptr<uint8_t[]> buf(new uint8_t[std::max<int64_t>(buf_size, 1)]);
+  uint32_t crc = 0;
+  for (int64_t offset = 0; offset < size; offset += buf_size) {
+    Slice slice(buf.get(), std::min(buf_size, size - offset));
+    RETURN_NOT_OK(readable->Read(offset, slice));
+    crc = crc::Crc32c(slice.data(), slice.size(), crc);
+  }
+  *crc32 = crc;
+  return Status::OK();
+}
+
 // Determine the length of the data chunk to return to the client.
 static int64_t DetermineReadLength(int64_t bytes_remaining, int64_t requested_len) {
   // Overhead in the RPC for things like headers, protobuf data, etc.
@@ -298,6 +324,7 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
   ImmutableReadableBlockInfo* block_info;
   RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
 
+  fs::ScopedIOPriority io_priority(fs::IOPriority::TABLET_COPY);
   RETURN_NOT_OK(ReadFileChunkToBuf(block_info, offset, client_maxlen,
                                    Substitute("block $0", block_id.ToString()),
                                    data, block_file_size, error_code));
@@ -310,6 +337,27 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
   return Status::OK();
 }
 
+Status TabletCopySourceSession::GetBlockChecksum(const BlockId& block_id,
+                                                 uint32_t* crc32, int64_t* block_file_size,
+                                                 TabletCopyErrorPB::Code* error_code) {
+  DCHECK(init_once_.init_succeeded());
+  RETURN_NOT_OK_PREPEND(CheckHealthyDirGroup(error_code),
+                        "Tablet copy source could not get block");
+  ImmutableReadableBlockInfo* block_info;
+  RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
+
+  fs::ScopedIOPriority io_priority(fs::IOPriority::TABLET_COPY);
+  Status s = block_info->Checksum(crc32);
+  if (PREDICT_FALSE(!s.ok())) {
+    s = s.CloneAndPrepend(Substitute("Unable to checksum block $0", block_id.ToString()));
+    LOG(WARNING) << s.ToString();
+    *error_code = TabletCopyErrorPB::IO_ERROR;
+    return s;
+  }
+  *block_file_size = block_info->size;
+  return Status::OK();
+}
+
 Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
                                                    uint64_t offset, int64_t client_maxlen,
                                                    string* data, int64_t* log_file_size,
@@ -478,10 +526,8 @@ Status LocalTabletCopySourceSession::InitOnce() {
   RETURN_NOT_OK(CheckHealthyDirGroup());
 
   // Read the SuperBlock from disk.
-  string path = fs_manager_->GetTabletMetadataPath(tablet_id_);
   RETURN_NOT_OK_PREPEND(
-      pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, &tablet_superblock_,
-                                       pb_util::SENSITIVE),
+      TabletMetadata::ReadSuperBlockFromDisk(fs_manager_, tablet_id_, &tablet_superblock_),
       Substitute("Unable to access superblock for tablet $0", tablet_id_));
 
   // Open the data blocks and add them to the cache.
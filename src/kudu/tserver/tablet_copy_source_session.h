@@ -56,6 +56,7 @@ struct TabletCopySourceMetrics {
   explicit TabletCopySourceMetrics(const scoped_refptr<MetricEntity>& metric_entity);
 
   scoped_refptr<Counter> bytes_sent;
+  scoped_refptr<Counter> fetches_throttled;
   scoped_refptr<AtomicGauge<int32_t>> open_source_sessions;
 };
 
@@ -89,6 +90,9 @@ struct ImmutableReadableBlockInfo {
   Status Read(uint64_t offset, Slice data) const {
     return readable->Read(offset, data);
   }
+
+  // Sets '*crc32' to the CRC32C of the whole block.
+  Status Checksum(uint32_t* crc32) const;
 };
 
 enum class TabletCopyMode {
@@ -129,6 +133,14 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
                        std::string* data, int64_t* block_file_size,
                        TabletCopyErrorPB::Code* error_code);
 
+  // Open block for reading, if it's not already open, and compute the CRC32C
+  // of all of it into '*crc32'. The other params are as for GetBlockPiece().
+  //
+  // This method is thread-safe.
+  Status GetBlockChecksum(const BlockId& block_id,
+                          uint32_t* crc32, int64_t* block_file_size,
+                          TabletCopyErrorPB::Code* error_code);
+
   // Get a piece of a log segment.
   // The behavior and params are very similar to GetBlockPiece(), but this one
   // is only for sending WAL segment files.
@@ -42,14 +42,20 @@
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_export.h"
 #include "kudu/clock/clock.h"
 #include "kudu/clock/hybrid_clock.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/partition.h"
+#include "kudu/common/row.h"
 #include "kudu/common/row_operations.h"
 #include "kudu/common/row_operations.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/rowblock_memory.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/timestamp.h"
 #include "kudu/common/wire_protocol-test-util.h"
@@ -58,7 +64,9 @@
 #include "kudu/consensus/log-test-base.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/opid.pb.h"
 #include "kudu/consensus/raft_consensus.h"
+#include "kudu/consensus/time_manager.h"
 #include "kudu/fs/block_id.h"
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/data_dirs.h"
@@ -70,9 +78,11 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/escaping.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/strcat.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/rpc/messenger.h"
@@ -88,6 +98,7 @@
 #include "kudu/tablet/tablet_metadata.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/tablet/tablet_replica.h"
+#include "kudu/tserver/change_streams.h"
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/scanners.h"
@@ -129,6 +140,7 @@ using google::protobuf::util::MessageDifferencer;
 using kudu::clock::Clock;
 using kudu::clock::HybridClock;
 using kudu::consensus::ConsensusStatePB;
+using kudu::consensus::OpId;
 using kudu::fs::BlockManager;
 using kudu::fs::CreateCorruptBlock;
 using kudu::fs::DataDirManager;
@@ -140,6 +152,7 @@ using kudu::rpc::RpcController;
 using kudu::tablet::LocalTabletWriter;
 using kudu::tablet::RowSetDataPB;
 using kudu::tablet::Tablet;
+using kudu::tablet::TabletMetrics;
 using kudu::tablet::TabletReplica;
 using kudu::tablet::TabletStatePB;
 using kudu::tablet::TabletSuperBlockPB;
@@ -171,6 +184,7 @@ DEFINE_int32(delete_tablet_bench_num_flushes, 200,
 DEFINE_int32(num_tablets, 5, "Number of tablets to create for tests");
 DEFINE_int32(num_rowsets_per_tablet, 10, "Number of rowsets to create per tablet");
 
+DECLARE_bool(abort_work_past_client_deadline);
 DECLARE_bool(crash_on_eio);
 DECLARE_bool(enable_flush_deltamemstores);
 DECLARE_bool(enable_flush_memrowset);
@@ -178,13 +192,21 @@ DECLARE_bool(enable_maintenance_manager);
 DECLARE_bool(enable_rowset_compaction);
 DECLARE_bool(enable_workload_score_for_perf_improvement_ops);
 DECLARE_bool(fail_dns_resolution);
+DECLARE_bool(flush_tablets_before_shutdown);
 DECLARE_bool(rowset_metadata_store_keys);
+DECLARE_bool(scanner_async_safe_time_wait);
+DECLARE_bool(scanner_count_rows_from_metadata);
+DECLARE_bool(scanner_reuse_row_blocks);
 DECLARE_bool(scanner_unregister_on_invalid_seq_id);
 DECLARE_double(cfile_inject_corruption);
 DECLARE_double(env_inject_eio);
 DECLARE_double(env_inject_full);
 DECLARE_double(tablet_inject_kudu_2233);
 DECLARE_double(workload_score_upper_bound);
+DECLARE_int32(block_cache_keys_persist_interval_sec);
+DECLARE_int32(block_cache_warmup_max_blocks_per_sec);
+DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(change_stream_subscriber_idle_timeout_ms);
 DECLARE_int32(flush_threshold_mb);
 DECLARE_int32(flush_threshold_secs);
 DECLARE_int32(flush_upper_bound_ms);
@@ -194,31 +216,42 @@ DECLARE_int32(maintenance_manager_inject_latency_ms);
 DECLARE_int32(maintenance_manager_num_threads);
 DECLARE_int32(maintenance_manager_polling_interval_ms);
 DECLARE_int32(memory_pressure_percentage);
+DECLARE_int32(metrics_rendering_cache_ttl_ms);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_int32(rpc_service_queue_length);
 DECLARE_int32(scanner_batch_size_rows);
 DECLARE_int32(scanner_gc_check_interval_us);
+DECLARE_int32(scanner_inject_latency_on_each_batch_ms);
+DECLARE_int32(scanner_max_pipelined_continuations);
 DECLARE_int32(scanner_ttl_ms);
 DECLARE_int32(tablet_bootstrap_inject_latency_ms);
 DECLARE_int32(tablet_inject_latency_on_apply_write_op_ms);
+DECLARE_int32(tablet_row_cache_capacity_mb);
+DECLARE_int32(tserver_multi_get_max_keys);
+DECLARE_int32(tserver_multi_get_max_result_bytes);
 DECLARE_int32(workload_stats_rate_collection_min_interval_ms);
 DECLARE_int32(workload_stats_metric_collection_interval_ms);
+DECLARE_int64(scanner_read_ahead_bytes);
 DECLARE_string(block_manager);
 DECLARE_string(env_inject_eio_globs);
 DECLARE_string(env_inject_full_globs);
 DECLARE_uint32(tablet_apply_pool_overload_threshold_ms);
 
 // Declare these metrics prototypes for simpler unit testing of their behavior.
+METRIC_DECLARE_counter(block_cache_warmup_blocks_loaded);
 METRIC_DECLARE_counter(block_manager_total_bytes_read);
 METRIC_DECLARE_counter(log_block_manager_holes_punched);
 METRIC_DECLARE_counter(rows_inserted);
 METRIC_DECLARE_counter(rows_updated);
 METRIC_DECLARE_counter(rows_deleted);
+METRIC_DECLARE_counter(row_cache_hits);
+METRIC_DECLARE_counter(row_cache_misses);
 METRIC_DECLARE_counter(rpcs_queue_overflow);
 METRIC_DECLARE_counter(rpcs_timed_out_in_queue);
 METRIC_DECLARE_counter(scanners_expired);
 METRIC_DECLARE_gauge_int32(startup_progress_steps_remaining);
 METRIC_DECLARE_gauge_int64(startup_progress_time_elapsed);
+METRIC_DECLARE_gauge_uint64(block_cache_warmup_blocks_total);
 METRIC_DECLARE_gauge_uint64(log_block_manager_blocks_under_management);
 METRIC_DECLARE_gauge_uint64(log_block_manager_containers);
 METRIC_DECLARE_gauge_size(active_scanners);
@@ -227,6 +260,11 @@ METRIC_DECLARE_gauge_size(num_rowsets_on_disk);
 METRIC_DECLARE_histogram(flush_dms_duration);
 METRIC_DECLARE_histogram(op_apply_queue_length);
 METRIC_DECLARE_histogram(op_apply_queue_time);
+METRIC_DECLARE_histogram(server_op_prepare_queue_time);
+METRIC_DECLARE_histogram(server_write_op_apply_queue_time);
+METRIC_DECLARE_histogram(server_write_op_apply_run_time);
+METRIC_DECLARE_histogram(server_write_op_lock_wait_time);
+METRIC_DECLARE_histogram(server_write_op_replication_time);
 
 
 namespace kudu {
@@ -689,6 +727,40 @@ TEST_F(TabletServerTest, TestTombstonedTabletOnWebUI) {
   ASSERT_STR_NOT_CONTAINS(s, mini_server_->bound_rpc_addr().ToString());
 }
 
+// Test that the blocks in the block cache are read back into it after the
+// tablet server restarts.
+TEST_F(TabletServerTest, TestBlockCacheWarmUp) {
+  FLAGS_block_cache_keys_persist_interval_sec = 3600;
+  FLAGS_block_cache_warmup_max_blocks_per_sec = 0;
+  // Restart for the block cache warmer to run.
+  ASSERT_OK(ShutdownAndRebuildTablet());
+
+  constexpr int kNumRows = 1000;
+  NO_FATALS(InsertTestRowsDirect(0, kNumRows));
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  // Read the blocks of the flushed rowset into the block cache.
+  vector<KeyValue> expected;
+  for (int i = 0; i < kNumRows; i++) {
+    expected.emplace_back(i, i * 2);
+  }
+  NO_FATALS(VerifyRows(schema_, expected));
+
+  // The keys of the cached blocks are persisted upon shutdown. Start over
+  // with an empty block cache.
+  const string keys_path = mini_server_->server()->fs_manager()->GetBlockCacheKeysPath();
+  NO_FATALS(ShutdownTablet());
+  ASSERT_TRUE(env_->FileExists(keys_path));
+  Singleton<cfile::BlockCache>::UnsafeReset();
+  ASSERT_OK(ShutdownAndRebuildTablet());
+
+  const auto& entity = mini_server_->server()->metric_entity();
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_GT(METRIC_block_cache_warmup_blocks_total.Instantiate(entity, 0)->value(), 0);
+    ASSERT_GT(METRIC_block_cache_warmup_blocks_loaded.Instantiate(entity)->value(), 0);
+  });
+  NO_FATALS(VerifyRows(schema_, expected));
+}
+
 // When tablet server merge metrics by the same attributes, the metric
 // 'merged_entities_count_of_tablet' should be visible
 TEST_F(TabletServerTest, TestMergedEntitiesCount) {
@@ -702,6 +774,43 @@ TEST_F(TabletServerTest, TestMergedEntitiesCount) {
   ASSERT_STR_CONTAINS(buf.ToString(), "merged_entities_count_of_tablet");
 }
 
+TEST_F(TabletServerTest, TestPrometheusMetrics) {
+  NO_FATALS(InsertTestRowsRemote(0, 10));
+  EasyCurl c;
+  faststring buf;
+  const string addr = mini_server_->bound_http_addr().ToString();
+  ASSERT_OK(c.FetchURL(Substitute("http://$0/metrics_prometheus", addr), &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(), "# TYPE kudu_rows_inserted counter");
+  ASSERT_STR_CONTAINS(buf.ToString(),
+                      Substitute("kudu_rows_inserted{entity_type=\"tablet\",entity_id=\"$0\"} 10",
+                                 kTabletId));
+  ASSERT_STR_CONTAINS(buf.ToString(), "# TYPE kudu_write_op_apply_run_time summary");
+
+  // The metrics of the tablets may be rolled up by table.
+  ASSERT_OK(c.FetchURL(Substitute("http://$0/metrics_prometheus?metrics=rows_inserted&"
+                                  "merge_rules=tablet|table|table_name", addr), &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(),
+                      Substitute("kudu_rows_inserted{entity_type=\"table\",entity_id=\"$0\"} 10",
+                                 kTableId));
+  ASSERT_STR_NOT_CONTAINS(buf.ToString(), "entity_type=\"tablet\"");
+
+  // With the caching, the same request gets the same output until it expires,
+  // the other ones get theirs.
+  FLAGS_metrics_rendering_cache_ttl_ms = 60 * 1000;
+  const string url = Substitute("http://$0/metrics_prometheus?metrics=rows_inserted", addr);
+  ASSERT_OK(c.FetchURL(url, &buf));
+  const string cached = buf.ToString();
+  ASSERT_STR_CONTAINS(cached, "} 10\n");
+  NO_FATALS(InsertTestRowsRemote(10, 5));
+  ASSERT_OK(c.FetchURL(url, &buf));
+  ASSERT_EQ(cached, buf.ToString());
+  ASSERT_OK(c.FetchURL(url + "&include_untouched_metrics=false", &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(), "} 15\n");
+  FLAGS_metrics_rendering_cache_ttl_ms = 0;
+  ASSERT_OK(c.FetchURL(url, &buf));
+  ASSERT_STR_CONTAINS(buf.ToString(), "} 15\n");
+}
+
 class TabletServerDiskSpaceTest : public TabletServerTestBase,
                                   public testing::WithParamInterface<string> {
  public:
@@ -1381,6 +1490,36 @@ TEST_F(TabletServerTest, TestInsert) {
   ASSERT_GE(now_after.value(), now_before.value());
 }
 
+// The response to a MultiWrite RPC tells which writes were submitted to their
+// tablets: only those which weren't may be sent again.
+TEST_F(TabletServerTest, TestMultiWriteReportsSubmittedWrites) {
+  MultiWriteRequestPB req;
+  for (const auto* tablet_id : { kTabletId, "bogus" }) {
+    WriteRequestPB* write = req.add_writes();
+    write->set_tablet_id(tablet_id);
+    ASSERT_OK(SchemaToPB(schema_, write->mutable_schema()));
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 1, "original",
+                   write->mutable_row_operations());
+  }
+  // Inserting the same row twice: the second insert is submitted, and fails.
+  req.add_writes()->CopyFrom(req.writes(0));
+
+  MultiWriteResponsePB resp;
+  RpcController controller;
+  ASSERT_OK(proxy_->MultiWrite(req, &resp, &controller));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_EQ(3, resp.responses_size());
+  ASSERT_EQ(3, resp.submitted_size());
+  ASSERT_TRUE(resp.submitted(0));
+  ASSERT_FALSE(resp.submitted(1));
+  ASSERT_TRUE(resp.responses(1).has_error());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  ASSERT_TRUE(resp.submitted(2));
+  // Exactly one of the inserts of the same row fails.
+  ASSERT_EQ(1, resp.responses(0).per_row_errors_size() +
+               resp.responses(2).per_row_errors_size());
+}
+
 TEST_F(TabletServerTest, TestExternalConsistencyModes_ClientPropagated) {
   WriteRequestPB req;
   req.set_tablet_id(kTabletId);
@@ -1500,6 +1639,33 @@ TEST_F(TabletServerTest, TestExternalConsistencyModes_CommitWait) {
 }
 
 
+// Test that the phases of write ops are reported per tablet and per server.
+TEST_F(TabletServerTest, TestWriteOpPhaseMetrics) {
+  constexpr int kNumBatches = 5;
+  NO_FATALS(InsertTestRowsRemote(0, 10, kNumBatches));
+
+  scoped_refptr<TabletReplica> replica;
+  ASSERT_TRUE(mini_server_->server()->tablet_manager()->LookupTablet(kTabletId, &replica));
+  const TabletMetrics* metrics = replica->tablet()->metrics();
+  ASSERT_EQ(kNumBatches, metrics->write_op_lock_wait_time->TotalCount());
+  ASSERT_EQ(kNumBatches, metrics->write_op_replication_time->TotalCount());
+  ASSERT_EQ(kNumBatches, metrics->write_op_apply_queue_time->TotalCount());
+  ASSERT_EQ(kNumBatches, metrics->write_op_apply_run_time->TotalCount());
+
+  const auto& server_entity = mini_server_->server()->metric_entity();
+  for (auto* proto : { &METRIC_server_write_op_lock_wait_time,
+                       &METRIC_server_write_op_replication_time,
+                       &METRIC_server_write_op_apply_queue_time,
+                       &METRIC_server_write_op_apply_run_time }) {
+    SCOPED_TRACE(proto->name());
+    ASSERT_EQ(kNumBatches, proto->Instantiate(server_entity)->TotalCount());
+  }
+  // The prepare queue is also used by the tablet's other ops, e.g. the NO_OP
+  // replicated by its leader.
+  ASSERT_LE(kNumBatches,
+            METRIC_server_op_prepare_queue_time.Instantiate(server_entity)->TotalCount());
+}
+
 TEST_F(TabletServerTest, TestInsertAndMutate) {
 
   scoped_refptr<TabletReplica> tablet;
@@ -1869,6 +2035,26 @@ TEST_F(TabletServerTest, TestRecoveryWithMutationsWhileFlushing) {
                         KeyValue(7, 7) });
 }
 
+// Ensure that a quiescing tablet server flushes its tablets when shut down, so
+// that nothing is left in memory after their logs are replayed.
+TEST_F(TabletServerTest, TestFlushBeforeShutdownWhenQuiescing) {
+  FLAGS_flush_tablets_before_shutdown = true;
+  InsertTestRowsRemote(1, 10);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  NO_FATALS(UpdateTestRowRemote(1, 100));
+  InsertTestRowsRemote(11, 5);
+  ASSERT_FALSE(tablet_replica_->tablet()->MemRowSetEmpty());
+  ASSERT_FALSE(tablet_replica_->tablet()->DeltaMemRowSetEmpty());
+
+  *mini_server_->server()->mutable_quiescing() = true;
+  NO_FATALS(ShutdownAndRebuildTablet());
+  ASSERT_TRUE(tablet_replica_->tablet()->MemRowSetEmpty());
+  ASSERT_TRUE(tablet_replica_->tablet()->DeltaMemRowSetEmpty());
+  uint64_t num_rows;
+  ASSERT_OK(tablet_replica_->tablet()->CountRows(&num_rows));
+  ASSERT_EQ(15, num_rows);
+}
+
 // Tests performing mutations that are going to a DMS or to the following
 // DMS, when the initial one is flushed.
 TEST_F(TabletServerTest, TestRecoveryWithMutationsWhileFlushingAndCompacting) {
@@ -2485,6 +2671,135 @@ TEST_F(TabletServerTest, TestSnapshotScan_WithoutSnapshotTimestamp) {
   ASSERT_GT(resp.propagated_timestamp(), resp.snap_timestamp());
 }
 
+// Tests that a snapshot scan on a non-leader replica waiting for safe time to
+// advance is suspended, and resumed once safe time reaches its timestamp.
+TEST_F(TabletServerTest, TestSnapshotScan_SuspendedUntilSafe) {
+  FLAGS_scanner_async_safe_time_wait = true;
+  NO_FATALS(InsertTestRowsRemote(0, 1));
+
+  // Safe time of a non-leader advances only when told so by the leader.
+  auto* time_manager = tablet_replica_->time_manager();
+  time_manager->SetNonLeaderMode();
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_read_mode(READ_AT_SNAPSHOT);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(0);
+
+  CountDownLatch latch(1);
+  proxy_->ScanAsync(req, &resp, &rpc, [&]() { latch.CountDown(); });
+  ASSERT_FALSE(latch.WaitFor(MonoDelta::FromMilliseconds(100)));
+
+  time_manager->AdvanceSafeTime(mini_server_->server()->clock()->Now());
+  latch.Wait();
+  ASSERT_OK(rpc.status());
+  ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+  ASSERT_TRUE(resp.has_snap_timestamp());
+  ASSERT_LE(resp.snap_timestamp(), time_manager->GetSafeTime().ToUint64());
+
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(1, results.size());
+  time_manager->SetLeaderMode();
+}
+
+// Tests that a scan continuation which arrives ahead of its turn waits for the
+// calls before it rather than failing, unless it's too far ahead.
+TEST_F(TabletServerTest, TestPipelinedScanContinuations) {
+  NO_FATALS(InsertTestRowsDirect(0, 100));
+  // Responses of one block of 10 rows.
+  FLAGS_scanner_batch_size_rows = 10;
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  string scanner_id;
+  {
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    req.set_call_seq_id(0);
+    req.set_batch_size_bytes(0);
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    ASSERT_EQ(FLAGS_scanner_max_pipelined_continuations, resp.max_pipelined_continuations());
+    scanner_id = resp.scanner_id();
+  }
+
+  const auto continue_req = [&](uint32_t call_seq_id) {
+    ScanRequestPB req;
+    req.set_scanner_id(scanner_id);
+    req.set_call_seq_id(call_seq_id);
+    req.set_batch_size_bytes(1);
+    return req;
+  };
+
+  // The second continuation waits for the first one.
+  const ScanRequestPB req2 = continue_req(2);
+  ScanResponsePB resp2;
+  RpcController rpc2;
+  CountDownLatch latch(1);
+  proxy_->ScanAsync(req2, &resp2, &rpc2, [&]() { latch.CountDown(); });
+  ASSERT_FALSE(latch.WaitFor(MonoDelta::FromMilliseconds(100)));
+
+  vector<string> results;
+  {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(continue_req(1), &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    NO_FATALS(StringifyRowsFromResponse(schema_, rpc, &resp, &results));
+    ASSERT_EQ(10, results.size());
+  }
+  latch.Wait();
+  ASSERT_OK(rpc2.status());
+  ASSERT_FALSE(resp2.has_error()) << SecureDebugString(resp2);
+  NO_FATALS(StringifyRowsFromResponse(schema_, rpc2, &resp2, &results));
+  ASSERT_EQ(20, results.size());
+  std::sort(results.begin(), results.end());
+  ASSERT_EQ(results.end(), std::unique(results.begin(), results.end()));
+
+  // A continuation too far ahead of the scanner's call sequence ID fails.
+  {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(continue_req(4 + FLAGS_scanner_max_pipelined_continuations),
+                           &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_CALL_SEQ_ID, resp.error().code());
+  }
+}
+
+// With --abort_work_past_client_deadline, a scan whose client's deadline
+// passes while reading data is aborted, and its scanner is dropped.
+TEST_F(TabletServerTest, TestScanAbortedPastClientDeadline) {
+  FLAGS_abort_work_past_client_deadline = true;
+  NO_FATALS(InsertTestRowsDirect(0, 10));
+  FLAGS_scanner_inject_latency_on_each_batch_ms = 500;
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(MonoDelta::FromMilliseconds(100));
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  Status s = proxy_->Scan(req, &resp, &rpc);
+  ASSERT_TRUE(s.IsTimedOut()) << s.ToString();
+
+  auto* metrics = tablet_replica_->tablet()->metrics();
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_EQ(1, metrics->scans_aborted_past_deadline->value());
+    ASSERT_EQ(0, mini_server_->server()->scanner_manager()->CountActiveScanners());
+  });
+}
+
 // Tests that a snapshot in the future (beyond the current time plus maximum
 // synchronization error) fails as an invalid snapshot.
 TEST_F(TabletServerTest, TestSnapshotScan_SnapshotInTheFutureFails) {
@@ -2855,6 +3170,540 @@ TEST_F(TabletServerTest, TestConcurrentAccessToOneScanner) {
 }
 
 
+// Test a scan spanning many batches and requests with the scanner's row block
+// reused across them, including after its number of rows changes.
+TEST_F(TabletServerTest, TestScanReusingRowBlocks) {
+  FLAGS_scanner_reuse_row_blocks = true;
+  FLAGS_scanner_batch_size_rows = 10;
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  req.set_batch_size_bytes(1000);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_more_results());
+  }
+  vector<string> results;
+  NO_FATALS(StringifyRowsFromResponse(schema_, rpc, &resp, &results));
+
+  FLAGS_scanner_batch_size_rows = 64;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(kNumRows, results.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         i, i * 2), results[i]);
+  }
+}
+
+TEST_F(TabletServerTest, TestScanWithRuntimeFilters) {
+  FLAGS_scanner_batch_size_rows = 10;
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  RpcController rpc;
+
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  req.set_batch_size_bytes(1000);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_more_results());
+  }
+  vector<string> results;
+  NO_FATALS(StringifyRowsFromResponse(schema_, rpc, &resp, &results));
+  const int num_first_rows = results.size();
+  ASSERT_LT(num_first_rows, kNumRows / 2);
+
+  // Filter the rest of the scan on int_val < 1000, i.e. key < 500.
+  ScanRequestPB continue_req;
+  continue_req.set_scanner_id(resp.scanner_id());
+  continue_req.set_call_seq_id(1);
+  continue_req.set_batch_size_bytes(1000);
+  ColumnPredicatePB* filter = continue_req.add_runtime_filters();
+  filter->set_column("int_val");
+  int32_t upper_bound = 1000;
+  filter->mutable_range()->mutable_upper()->append(
+      reinterpret_cast<char*>(&upper_bound), sizeof(upper_bound));
+  {
+    rpc.Reset();
+    SCOPED_TRACE(SecureDebugString(continue_req));
+    ASSERT_OK(proxy_->Scan(continue_req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_more_results());
+  }
+  NO_FATALS(StringifyRowsFromResponse(schema_, rpc, &resp, &results));
+  // The filter applies to the requests which follow too.
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results, nullptr, 2));
+  ASSERT_EQ(kNumRows / 2, results.size());
+  for (int i = 0; i < kNumRows / 2; i++) {
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         i, i * 2), results[i]);
+  }
+
+  // Filters may only be on the scan's columns.
+  req.mutable_new_scan_request()->clear_projected_columns();
+  ASSERT_OK(SchemaToColumnPBs(schema_.CreateKeyProjection(),
+                              scan->mutable_projected_columns()));
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  continue_req.set_scanner_id(resp.scanner_id());
+  rpc.Reset();
+  ASSERT_OK(proxy_->Scan(continue_req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+}
+
+TEST_F(TabletServerTest, TestMultiGet) {
+  // Put rows in a DRS, with deltas, and in the MRS.
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  NO_FATALS(UpdateTestRowRemote(5, 12345));
+  NO_FATALS(DeleteTestRowsRemote(7, 1));
+  InsertTestRowsDirect(100, 10);
+
+  MultiGetRequestPB req;
+  MultiGetResponsePB resp;
+  RpcController rpc;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_projected_columns()));
+  for (int32_t key : { 105, 5, 7, 500, 42 }) {
+    KuduPartialRow row(&schema_);
+    ASSERT_OK(row.SetInt32("key", key));
+    ASSERT_OK(row.EncodeRowKey(req.add_encoded_keys()));
+  }
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+  }
+  // Neither the deleted row nor the missing one is returned.
+  ASSERT_EQ(3, resp.key_indexes_size());
+  ASSERT_EQ(0, resp.key_indexes(0));
+  ASSERT_EQ(1, resp.key_indexes(1));
+  ASSERT_EQ(4, resp.key_indexes(2));
+  ScanResponsePB scan_resp;
+  *scan_resp.mutable_data() = resp.data();
+  vector<string> results;
+  NO_FATALS(StringifyRowsFromResponse(schema_, rpc, &scan_resp, &results));
+  ASSERT_EQ(vector<string>({
+      R"((int32 key=105, int32 int_val=210, string string_val="hello 105"))",
+      R"((int32 key=5, int32 int_val=12345, string string_val="hello 5"))",
+      R"((int32 key=42, int32 int_val=84, string string_val="hello 42"))" }), results);
+
+  // No scanner was created.
+  ASSERT_EQ(0, mini_server_->server()->scanner_manager()->CountActiveScanners());
+
+  // Requests with too many keys, or whose rows are too large, are rejected.
+  {
+    google::FlagSaver saver;
+    FLAGS_tserver_multi_get_max_keys = 4;
+    resp.Clear();
+    rpc.Reset();
+    ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "exceeds the maximum of 4");
+
+    FLAGS_tserver_multi_get_max_keys = 5;
+    FLAGS_tserver_multi_get_max_result_bytes = 10;
+    resp.Clear();
+    rpc.Reset();
+    ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+    ASSERT_STR_CONTAINS(resp.error().status().message(), "exceeds the maximum of 10 bytes");
+  }
+
+  // Bad keys are rejected.
+  req.add_encoded_keys("x");
+  resp.Clear();
+  rpc.Reset();
+  ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+}
+
+TEST_F(TabletServerTest, TestExportBlocks) {
+  // Put rows in two DRSs, with several blocks per column.
+  FLAGS_cfile_default_block_size = 1024;
+  InsertTestRowsDirect(0, 1000);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(1000, 1000);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+
+  ExportBlocksRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, req.mutable_projected_columns()));
+  // Export a range of rows per request.
+  req.set_max_bytes(1);
+  vector<int32_t> keys;
+  vector<int32_t> int_vals;
+  vector<string> string_vals;
+  int num_requests = 0;
+  do {
+    ExportBlocksResponsePB resp;
+    RpcController rpc;
+    ASSERT_OK(proxy_->ExportBlocks(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(1, resp.rowsets_size());
+    num_requests++;
+    const auto& rowset = resp.rowsets(0);
+    ASSERT_EQ(req.start_row(), rowset.first_row());
+    ASSERT_LT(rowset.first_row(), rowset.end_row());
+    if (rowset.end_row() < rowset.num_rows()) {
+      ASSERT_EQ(rowset.end_row(), resp.next_row());
+      ASSERT_EQ(rowset.id(), resp.remaining_rowset_ids(0));
+    } else {
+      ASSERT_FALSE(resp.has_next_row());
+    }
+    req.set_snap_timestamp(resp.snap_timestamp());
+    req.mutable_rowset_ids()->CopyFrom(resp.remaining_rowset_ids());
+    req.set_start_row(resp.next_row());
+
+    ASSERT_EQ(schema_.num_columns(), rowset.columns_size());
+    for (int c = 0; c < schema_.num_columns(); c++) {
+      const ExportedCFilePB& column = rowset.columns(c);
+      cfile::ExportedCFile exported;
+      exported.type = schema_.column(c).type_info()->type();
+      exported.encoding = column.encoding();
+      exported.compression = column.compression();
+      exported.cfile_version = column.cfile_version();
+      exported.is_nullable = column.is_nullable();
+      ASSERT_EQ(schema_.column(c).is_nullable(), exported.is_nullable);
+      Slice dictionary;
+      if (column.has_dictionary_sidecar()) {
+        ASSERT_OK(rpc.GetInboundSidecar(column.dictionary_sidecar(), &dictionary));
+        exported.dictionary.append(dictionary.data(), dictionary.size());
+      }
+      Slice data;
+      ASSERT_OK(rpc.GetInboundSidecar(column.data_sidecar(), &data));
+      cfile::ExportedBlockDecoder decoder(&exported);
+      ASSERT_OK(decoder.Init());
+      // The blocks cover the range of rows, with the rows out of it skipped.
+      size_t num_rows = 0;
+      ASSERT_GT(column.blocks_size(), 0);
+      ASSERT_LE(column.blocks(0).first_row(), rowset.first_row());
+      size_t next_row = column.blocks(0).first_row();
+      for (const auto& block : column.blocks()) {
+        ASSERT_EQ(next_row, block.first_row());
+        ASSERT_LE(block.offset() + block.size(), data.size());
+        RowBlockMemory mem;
+        RowBlock rows(&schema_, block.num_rows(), &mem);
+        ColumnBlock cb = rows.column_block(c);
+        size_t n;
+        ASSERT_OK(decoder.DecodeBlock(Slice(data.data() + block.offset(), block.size()),
+                                      &cb, &n));
+        ASSERT_EQ(block.num_rows(), n);
+        for (size_t i = 0; i < n; i++) {
+          const size_t row = block.first_row() + i;
+          if (row < rowset.first_row() || row >= rowset.end_row()) {
+            continue;
+          }
+          num_rows++;
+          ASSERT_TRUE(!cb.is_nullable() || !cb.is_null(i));
+          switch (c) {
+            case 0:
+              keys.push_back(*reinterpret_cast<const int32_t*>(cb.cell_ptr(i)));
+              break;
+            case 1:
+              int_vals.push_back(*reinterpret_cast<const int32_t*>(cb.cell_ptr(i)));
+              break;
+            default:
+              string_vals.push_back(reinterpret_cast<const Slice*>(cb.cell_ptr(i))->ToString());
+          }
+        }
+        next_row += n;
+      }
+      ASSERT_GE(next_row, rowset.end_row());
+      ASSERT_EQ(rowset.end_row() - rowset.first_row(), num_rows);
+    }
+  } while (req.rowset_ids_size() > 0);
+  ASSERT_GT(num_requests, 2);
+  ASSERT_EQ(2000, keys.size());
+  ASSERT_EQ(keys.size(), int_vals.size());
+  ASSERT_EQ(keys.size(), string_vals.size());
+  for (int i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(i, keys[i]);
+    ASSERT_EQ(i * 2, int_vals[i]);
+    ASSERT_EQ(Substitute("hello $0", i), string_vals[i]);
+  }
+
+  // Once the base data no longer is the state of the tablet, the tablet must
+  // be scanned instead.
+  NO_FATALS(UpdateTestRowRemote(5, 12345));
+  req.clear_snap_timestamp();
+  req.clear_rowset_ids();
+  req.clear_start_row();
+  ExportBlocksResponsePB resp;
+  RpcController rpc;
+  ASSERT_OK(proxy_->ExportBlocks(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SNAPSHOT, resp.error().code());
+}
+
+TEST_F(TabletServerTest, TestGetChanges) {
+  NO_FATALS(InsertTestRowsRemote(0, 3, /*num_batches=*/1));
+  NO_FATALS(UpdateTestRowRemote(1, 12345));
+  NO_FATALS(DeleteTestRowsRemote(2, 1));
+
+  // Returns the changes of the response as "<op type> <key>" strings.
+  const auto decode_changes = [](const GetChangesResponsePB& resp, vector<string>* changes) {
+    Schema schema;
+    ASSERT_OK(SchemaFromPB(resp.schema(), &schema));
+    const Schema schema_with_ids = SchemaBuilder(schema).Build();
+    changes->clear();
+    for (const auto& change : resp.changes()) {
+      ASSERT_TRUE(change.has_op_id());
+      ASSERT_TRUE(change.has_timestamp());
+      Arena arena(1024);
+      RowOperationsPBDecoder dec(&change.row_operations(), &schema, &schema_with_ids, &arena);
+      vector<DecodedRowOperation> ops;
+      ASSERT_OK(dec.DecodeOperations<DecoderMode::WRITE_OPS>(&ops));
+      for (const auto& op : ops) {
+        ConstContiguousRow row(&schema_with_ids, op.row_data);
+        changes->emplace_back(Substitute(
+            "$0 $1", RowOperationsPB::Type_Name(op.type),
+            *reinterpret_cast<const int32_t*>(row.cell_ptr(0))));
+        if (op.type == RowOperationsPB::DELETE_RANGE) {
+          ConstContiguousRow upper_bound(&schema_with_ids, op.range_upper_bound);
+          StrAppend(&changes->back(), " ",
+                    *reinterpret_cast<const int32_t*>(upper_bound.cell_ptr(0)));
+        }
+      }
+    }
+  };
+
+  GetChangesRequestPB req;
+  GetChangesResponsePB resp;
+  RpcController rpc;
+  req.set_tablet_id(kTabletId);
+  req.set_subscriber_id("subscriber");
+  vector<string> changes;
+  // The ops are only read once their COMMITs are in the WAL, which they're
+  // appended to asynchronously.
+  ASSERT_EVENTUALLY([&] {
+    SCOPED_TRACE(SecureDebugString(req));
+    rpc.Reset();
+    ASSERT_OK(proxy_->GetChanges(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    NO_FATALS(decode_changes(resp, &changes));
+    ASSERT_EQ(vector<string>({ "INSERT 0", "INSERT 1", "INSERT 2", "UPDATE 1", "DELETE 2" }),
+              changes);
+  });
+  ASSERT_EQ(3, resp.changes_size());
+  ASSERT_EQ(3, resp.schema().columns_size());
+  ASSERT_FALSE(resp.has_more());
+  ASSERT_EQ(1, mini_server_->server()->change_stream_manager()->num_anchors());
+
+  // There are no further changes.
+  const OpId last_op_id = resp.last_op_id();
+  *req.mutable_after_op_id() = last_op_id;
+  rpc.Reset();
+  ASSERT_OK(proxy_->GetChanges(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(0, resp.changes_size());
+  ASSERT_FALSE(resp.has_more());
+  ASSERT_EQ(last_op_id.index(), resp.last_op_id().index());
+
+  // Only the changes of the projected columns of the rows in the key range
+  // are returned: the update of 'int_val' isn't.
+  req.clear_after_op_id();
+  ColumnSchemaPB* col = req.add_projected_columns();
+  col->set_name("string_val");
+  col->set_type(STRING);
+  col->set_is_nullable(true);
+  {
+    KuduPartialRow row(&schema_);
+    ASSERT_OK(row.SetInt32("key", 1));
+    ASSERT_OK(row.EncodeRowKey(req.mutable_lower_bound_primary_key()));
+    ASSERT_OK(row.SetInt32("key", 2));
+    ASSERT_OK(row.EncodeRowKey(req.mutable_exclusive_upper_bound_primary_key()));
+  }
+  rpc.Reset();
+  ASSERT_OK(proxy_->GetChanges(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error());
+  NO_FATALS(decode_changes(resp, &changes));
+  ASSERT_EQ(vector<string>({ "INSERT 1" }), changes);
+  ASSERT_EQ(2, resp.schema().columns_size());
+
+  // Ops which aren't committed can't be read after.
+  OpId op_id = last_op_id;
+  op_id.set_index(op_id.index() + 10);
+  *req.mutable_after_op_id() = op_id;
+  rpc.Reset();
+  ASSERT_OK(proxy_->GetChanges(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::CHANGES_UNAVAILABLE, resp.error().code());
+
+  // The row operations which failed when applied aren't returned, unlike the
+  // range deletes.
+  {
+    WriteRequestPB write_req;
+    WriteResponsePB write_resp;
+    write_req.set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToPB(schema_, write_req.mutable_schema()));
+    RowOperationsPB* data = write_req.mutable_row_operations();
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, 0, 0, "duplicate", data);
+    AddTestRowToPB(RowOperationsPB::UPDATE, schema_, 100, 0, "missing", data);
+    AddTestKeyToPB(RowOperationsPB::DELETE, schema_, 2, data);
+    AddTestRowToPB(RowOperationsPB::INSERT, schema_, 3, 6, "hello 3", data);
+    rpc.Reset();
+    ASSERT_OK(proxy_->Write(write_req, &write_resp, &rpc));
+    ASSERT_FALSE(write_resp.has_error());
+    ASSERT_EQ(3, write_resp.per_row_errors_size());
+
+    data->Clear();
+    AddTestKeyToPB(RowOperationsPB::DELETE_RANGE, schema_, 0, data);
+    AddTestKeyToPB(RowOperationsPB::RANGE_UPPER_BOUND, schema_, 2, data);
+    write_resp.Clear();
+    rpc.Reset();
+    ASSERT_OK(proxy_->Write(write_req, &write_resp, &rpc));
+    ASSERT_FALSE(write_resp.has_error());
+    ASSERT_EQ(0, write_resp.per_row_errors_size());
+  }
+  req.clear_projected_columns();
+  req.clear_lower_bound_primary_key();
+  req.clear_exclusive_upper_bound_primary_key();
+  *req.mutable_after_op_id() = last_op_id;
+  ASSERT_EVENTUALLY([&] {
+    resp.Clear();
+    rpc.Reset();
+    ASSERT_OK(proxy_->GetChanges(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_more());
+    NO_FATALS(decode_changes(resp, &changes));
+    ASSERT_EQ(vector<string>({ "INSERT 3", "DELETE_RANGE 0 2" }), changes);
+  });
+
+  // The anchors of idle subscribers are released.
+  FLAGS_change_stream_subscriber_idle_timeout_ms = 0;
+  mini_server_->server()->change_stream_manager()->ReleaseIdleAnchors();
+  ASSERT_EQ(0, mini_server_->server()->change_stream_manager()->num_anchors());
+}
+
+class TabletServerRowCacheTest : public TabletServerTestBase {
+ public:
+  void SetUp() override {
+    FLAGS_tablet_row_cache_capacity_mb = 1;
+    NO_FATALS(TabletServerTestBase::SetUp());
+    NO_FATALS(StartTabletServer(/*num_data_dirs=*/1));
+  }
+
+ protected:
+  // Looks up the rows of 'keys' with MultiGet, projecting the columns after
+  // the key in reverse order.
+  void MultiGet(const vector<int32_t>& keys, vector<string>* results) {
+    MultiGetRequestPB req;
+    MultiGetResponsePB resp;
+    RpcController rpc;
+    req.set_tablet_id(kTabletId);
+    const Schema projection({ schema_.column(2), schema_.column(1) }, 0);
+    ASSERT_OK(SchemaToColumnPBs(projection, req.mutable_projected_columns()));
+    for (int32_t key : keys) {
+      KuduPartialRow row(&schema_);
+      ASSERT_OK(row.SetInt32("key", key));
+      ASSERT_OK(row.EncodeRowKey(req.add_encoded_keys()));
+    }
+    ASSERT_OK(proxy_->MultiGet(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ScanResponsePB scan_resp;
+    *scan_resp.mutable_data() = resp.data();
+    results->clear();
+    NO_FATALS(StringifyRowsFromResponse(projection, rpc, &scan_resp, results));
+  }
+};
+
+// Test that rows looked up repeatedly are served from the row cache, and
+// that writes to them are visible right away.
+TEST_F(TabletServerRowCacheTest, TestMultiGetWithRowCache) {
+  InsertTestRowsDirect(0, 10);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  scoped_refptr<Counter> hits =
+      METRIC_row_cache_hits.Instantiate(tablet_replica_->tablet()->GetMetricEntity());
+  scoped_refptr<Counter> misses =
+      METRIC_row_cache_misses.Instantiate(tablet_replica_->tablet()->GetMetricEntity());
+
+  vector<string> results;
+  const vector<string> expected = {
+      R"((string string_val="hello 3", int32 int_val=6))",
+      R"((string string_val="hello 5", int32 int_val=10))" };
+  NO_FATALS(MultiGet({ 3, 5, 50 }, &results));
+  ASSERT_EQ(expected, results);
+  ASSERT_EQ(0, hits->value());
+  ASSERT_EQ(3, misses->value());
+
+  // The rows found are cached, the missing one isn't.
+  NO_FATALS(MultiGet({ 3, 5, 50 }, &results));
+  ASSERT_EQ(expected, results);
+  ASSERT_EQ(2, hits->value());
+  ASSERT_EQ(4, misses->value());
+
+  // Updated and deleted rows are dropped from the cache.
+  NO_FATALS(UpdateTestRowRemote(5, 12345));
+  NO_FATALS(DeleteTestRowsRemote(3, 1));
+  NO_FATALS(MultiGet({ 3, 5 }, &results));
+  ASSERT_EQ(vector<string>({ R"((string string_val="hello 5", int32 int_val=12345))" }),
+            results);
+  ASSERT_EQ(2, hits->value());
+  ASSERT_EQ(6, misses->value());
+  NO_FATALS(MultiGet({ 3, 5 }, &results));
+  ASSERT_EQ(vector<string>({ R"((string string_val="hello 5", int32 int_val=12345))" }),
+            results);
+  ASSERT_EQ(3, hits->value());
+}
+
+// Test that a scanner reads rows ahead between batches, and that the scan
+// returns the same rows with the read-ahead.
+TEST_F(TabletServerTest, TestScanWithReadAhead) {
+  FLAGS_scanner_read_ahead_bytes = 1024 * 1024;
+  FLAGS_scanner_batch_size_rows = 16;
+  constexpr int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+  ScannerManager* manager = mini_server_->server()->scanner_manager();
+
+  // Opening the scanner starts the read-ahead.
+  ScanResponsePB resp;
+  NO_FATALS(OpenScannerWithAllColumns(&resp));
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_GT(manager->read_ahead_bytes(), 0);
+  });
+
+  vector<string> results;
+  NO_FATALS(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(kNumRows, results.size());
+  for (int i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(Substitute(R"((int32 key=$0, int32 int_val=$1, string string_val="hello $0"))",
+                         i, i * 2), results[i]);
+  }
+
+  // The read-ahead data is released along with the scanner.
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_EQ(0, manager->read_ahead_bytes());
+  });
+}
+
 TEST_F(TabletServerTest, TestScanWithStringPredicates) {
   InsertTestRowsDirect(0, 100);
 
@@ -2891,6 +3740,76 @@ TEST_F(TabletServerTest, TestScanWithStringPredicates) {
   ASSERT_EQ(R"((int32 key=59, int32 int_val=118, string string_val="hello 59"))", results[9]);
 }
 
+TEST_F(TabletServerTest, TestScanProfile) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+
+  // Scans the tablet in batches of 'batch_size_bytes', returning the profile
+  // of the last response.
+  const auto scan = [&](int batch_size_bytes, ScanProfilePB* profile) {
+    ScanRequestPB req;
+    ScanResponsePB resp;
+    RpcController rpc;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    req.set_batch_size_bytes(batch_size_bytes);
+    req.set_return_profile(true);
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+    ASSERT_TRUE(resp.has_profile());
+    int64_t cells_read = 0;
+    while (resp.has_more_results()) {
+      // The profile accumulates over the scanner's requests.
+      int64_t cur_cells_read = 0;
+      for (const auto& col : resp.profile().columns()) {
+        cur_cells_read += col.cells_read();
+      }
+      ASSERT_GE(cur_cells_read, cells_read);
+      cells_read = cur_cells_read;
+
+      ScanRequestPB continue_req;
+      continue_req.set_scanner_id(resp.scanner_id());
+      continue_req.set_call_seq_id(req.call_seq_id() + 1);
+      continue_req.set_batch_size_bytes(batch_size_bytes);
+      continue_req.set_return_profile(true);
+      req = continue_req;
+      rpc.Reset();
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+      ASSERT_TRUE(resp.has_profile());
+    }
+    *profile = resp.profile();
+  };
+
+  ScanProfilePB profile;
+  NO_FATALS(scan(1024, &profile));
+  SCOPED_TRACE(SecureDebugString(profile));
+  ASSERT_EQ(static_cast<int>(schema_.num_columns()), profile.columns_size());
+  for (const auto& col : profile.columns()) {
+    ASSERT_EQ(kNumRows, col.cells_read());
+    ASSERT_GT(col.blocks_read(), 0);
+  }
+  ASSERT_GT(profile.cfile_cache_hit_bytes() + profile.cfile_cache_miss_bytes(), 0);
+
+  // The blocks read by the first scan are in the block cache now.
+  NO_FATALS(scan(1024 * 1024, &profile));
+  SCOPED_TRACE(SecureDebugString(profile));
+  for (const auto& col : profile.columns()) {
+    ASSERT_GT(col.blocks_read(), 0);
+    ASSERT_EQ(0, col.blocks_read_from_disk());
+  }
+  ASSERT_EQ(0, profile.cfile_cache_miss_bytes());
+
+  // The profile of the completed scans is kept.
+  int64_t cfile_cache_hit_bytes = 0;
+  for (const auto& desc : mini_server_->server()->scanner_manager()->ListScans()) {
+    cfile_cache_hit_bytes += desc.profile.cfile_cache_hit_bytes;
+  }
+  ASSERT_GT(cfile_cache_hit_bytes, 0);
+}
+
 TEST_F(TabletServerTest, TestColumnarScan) {
   const int kNumRows = 100;
   InsertTestRowsDirect(0, kNumRows);
@@ -3070,6 +3989,308 @@ TEST_F(TabletServerTest, TestScanWithPredicates) {
   ASSERT_EQ(50, results.size());
 }
 
+// Test that aggregates are computed by the tablet server, with partial
+// results spread over several scan responses.
+TEST_F(TabletServerTest, TestScanWithAggregates) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows);
+  // Use small batches so that the scan spans multiple responses.
+  FLAGS_scanner_batch_size_rows = 100;
+  FLAGS_scanner_inject_latency_on_each_batch_ms = 100;
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  req.set_batch_size_bytes(1024 * 1024);
+
+  // Set up a range predicate: key >= 100.
+  ColumnPredicatePB* pred = scan->add_column_predicates();
+  pred->set_column(schema_.column(0).name());
+  int32_t lower_bound = 100;
+  pred->mutable_range()->mutable_lower()->append(
+      reinterpret_cast<char*>(&lower_bound), sizeof(lower_bound));
+
+  // The aggregated columns aren't part of the (empty) projection.
+  scan->add_aggregates()->set_type(ColumnAggregatePB::COUNT);
+  ColumnAggregatePB* agg = scan->add_aggregates();
+  agg->set_type(ColumnAggregatePB::SUM);
+  agg->set_column(schema_.column(1).name());
+  agg = scan->add_aggregates();
+  agg->set_type(ColumnAggregatePB::MAX);
+  agg->set_column(schema_.column(0).name());
+  agg = scan->add_aggregates();
+  agg->set_type(ColumnAggregatePB::MIN);
+  agg->set_column(schema_.column(2).name());
+
+  int64_t count = 0;
+  int64_t sum = 0;
+  int32_t max_key = -1;
+  string min_string;
+  int num_responses = 0;
+  ScanResponsePB resp;
+  do {
+    RpcController rpc;
+    resp.Clear();
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_FALSE(resp.has_data());
+    ASSERT_EQ(4, resp.aggregate_results_size());
+    num_responses++;
+
+    count += resp.aggregate_results(0).count();
+    sum += resp.aggregate_results(1).int_sum();
+    if (resp.aggregate_results(2).has_value()) {
+      int32_t key;
+      memcpy(&key, resp.aggregate_results(2).value().data(), sizeof(key));
+      max_key = std::max(max_key, key);
+    }
+    if (resp.aggregate_results(3).has_value()) {
+      const string& value = resp.aggregate_results(3).value();
+      if (min_string.empty() || value < min_string) {
+        min_string = value;
+      }
+    }
+
+    req.clear_new_scan_request();
+    req.set_scanner_id(resp.scanner_id());
+    req.set_call_seq_id(req.call_seq_id() + 1);
+  } while (resp.has_more_results());
+
+  ASSERT_GT(num_responses, 1);
+  ASSERT_EQ(kNumRows - 100, count);
+  // int_val is twice the key.
+  ASSERT_EQ(2 * ((kNumRows - 1) * kNumRows / 2 - 99 * 100 / 2), sum);
+  ASSERT_EQ(kNumRows - 1, max_key);
+  ASSERT_EQ("hello 100", min_string);
+}
+
+// Test that top-N scans return the first rows of the tablet in the order of a
+// column, even if the column isn't part of the projection.
+TEST_F(TabletServerTest, TestTopNScan) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows / 2);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(kNumRows / 2, kNumRows / 2);
+  FLAGS_scanner_batch_size_rows = 2;
+
+  const Schema projection({ schema_.column(0) }, 0);
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_limit(5);
+  scan->mutable_order_by()->set_column_name(schema_.column(1).name());
+  scan->mutable_order_by()->set_descending(true);
+  ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+  req.set_batch_size_bytes(1024 * 1024);
+
+  ScanResponsePB resp;
+  {
+    RpcController rpc;
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    vector<string> results;
+    NO_FATALS(StringifyRowsFromResponse(projection, rpc, &resp, &results));
+    if (resp.has_more_results()) {
+      NO_FATALS(DrainScannerToStrings(resp.scanner_id(), projection, &results));
+    }
+    ASSERT_EQ(5, results.size());
+    for (int i = 0; i < results.size(); i++) {
+      ASSERT_EQ(Substitute("(int32 key=$0)", kNumRows - 1 - i), results[i]);
+    }
+  }
+
+  // Top-N scans must have a limit.
+  scan->clear_limit();
+  {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+}
+
+// Test that expression predicates over columns which aren't projected filter
+// the rows returned by a scan.
+TEST_F(TabletServerTest, TestExpressionPredicateScan) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows / 2);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(kNumRows / 2, kNumRows / 2);
+
+  const auto column = [](const string& name, ColumnExpressionPB* pb) {
+    pb->set_op(ColumnExpressionPB::COLUMN);
+    pb->set_column(name);
+  };
+  const auto literal = [](int64_t value, ColumnExpressionPB* pb) {
+    pb->set_op(ColumnExpressionPB::LITERAL);
+    pb->set_int64_value(value);
+  };
+
+  const Schema projection({ schema_.column(0) }, 0);
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(projection, scan->mutable_projected_columns()));
+  req.set_batch_size_bytes(1024 * 1024);
+
+  // int_val % 7 = 0 AND length(string_val) = 9, i.e. the keys in [100, 1000)
+  // which are multiples of 7.
+  ColumnExpressionPB* expr = scan->add_expression_predicates();
+  expr->set_op(ColumnExpressionPB::AND);
+  ColumnExpressionPB* mod_eq = expr->add_args();
+  mod_eq->set_op(ColumnExpressionPB::EQUAL);
+  ColumnExpressionPB* mod = mod_eq->add_args();
+  mod->set_op(ColumnExpressionPB::MODULO);
+  column(schema_.column(1).name(), mod->add_args());
+  literal(7, mod->add_args());
+  literal(0, mod_eq->add_args());
+  ColumnExpressionPB* len_eq = expr->add_args();
+  len_eq->set_op(ColumnExpressionPB::EQUAL);
+  ColumnExpressionPB* len = len_eq->add_args();
+  len->set_op(ColumnExpressionPB::LENGTH);
+  column(schema_.column(2).name(), len->add_args());
+  literal(9, len_eq->add_args());
+
+  ScanResponsePB resp;
+  {
+    RpcController rpc;
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    vector<string> results;
+    NO_FATALS(StringifyRowsFromResponse(projection, rpc, &resp, &results));
+    if (resp.has_more_results()) {
+      NO_FATALS(DrainScannerToStrings(resp.scanner_id(), projection, &results));
+    }
+    ASSERT_EQ(128, results.size());
+    std::sort(results.begin(), results.end());
+    ASSERT_EQ("(int32 key=105)", results.front());
+    ASSERT_EQ("(int32 key=994)", results.back());
+  }
+
+  // Expression predicates must be boolean.
+  const ColumnExpressionPB mod_copy = *mod;
+  *expr = mod_copy;
+  {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+}
+
+// Test that COUNT(*) scans without predicates are answered from the live row
+// counts of the tablet metadata, and agree with a regular scan.
+TEST_F(TabletServerTest, TestCountRowsFromMetadata) {
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  NO_FATALS(DeleteTestRowsRemote(10, 10));
+  InsertTestRowsDirect(100, 5);
+
+  const auto count_rows = [&](int64_t* count) {
+    ScanRequestPB req;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    scan->add_aggregates()->set_type(ColumnAggregatePB::COUNT);
+    req.set_batch_size_bytes(1024 * 1024);
+    *count = 0;
+    ScanResponsePB resp;
+    do {
+      RpcController rpc;
+      resp.Clear();
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+      ASSERT_EQ(1, resp.aggregate_results_size());
+      *count += resp.aggregate_results(0).count();
+      req.clear_new_scan_request();
+      req.set_scanner_id(resp.scanner_id());
+      req.set_call_seq_id(req.call_seq_id() + 1);
+    } while (resp.has_more_results());
+  };
+
+  // No rows are scanned when counting from the metadata.
+  const auto* rows_scanned = tablet_replica_->tablet()->metrics()->scanner_rows_scanned.get();
+  int64_t count;
+  NO_FATALS(count_rows(&count));
+  ASSERT_EQ(95, count);
+  ASSERT_EQ(0, rows_scanned->value());
+
+  FLAGS_scanner_count_rows_from_metadata = false;
+  NO_FATALS(count_rows(&count));
+  ASSERT_EQ(95, count);
+  ASSERT_GT(rows_scanned->value(), 0);
+}
+
+// Test that the groups of a GROUP BY scan are returned in several responses
+// if they don't fit in one, and that their partial results can be merged.
+TEST_F(TabletServerTest, TestGroupByScan) {
+  const int kNumRows = 1000;
+  InsertTestRowsDirect(0, kNumRows / 2);
+  ASSERT_OK(tablet_replica_->tablet()->Flush());
+  InsertTestRowsDirect(kNumRows / 2, kNumRows / 2);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ColumnAggregatePB* agg = scan->add_aggregates();
+  agg->set_type(ColumnAggregatePB::SUM);
+  agg->set_column(schema_.column(1).name());
+  scan->add_group_by_columns(schema_.column(0).name());
+  // Small enough that the groups of all the rows don't fit in one response.
+  req.set_batch_size_bytes(16 * 1024);
+
+  map<int32_t, int64_t> sums;
+  int num_responses = 0;
+  ScanResponsePB resp;
+  do {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(0, resp.aggregate_results_size());
+    for (const auto& group : resp.aggregate_groups()) {
+      ASSERT_EQ(1, group.keys_size());
+      ASSERT_EQ(1, group.results_size());
+      int32_t key;
+      ASSERT_EQ(sizeof(key), group.keys(0).value().size());
+      memcpy(&key, group.keys(0).value().data(), sizeof(key));
+      sums[key] += group.results(0).int_sum();
+    }
+    num_responses++;
+    req.clear_new_scan_request();
+    req.set_scanner_id(resp.scanner_id());
+    req.set_call_seq_id(req.call_seq_id() + 1);
+  } while (resp.has_more_results());
+
+  ASSERT_GT(num_responses, 1);
+  ASSERT_EQ(kNumRows, sums.size());
+  for (const auto& e : sums) {
+    ASSERT_EQ(e.first * 2, e.second);
+  }
+
+  // Group-by columns require aggregates.
+  req.Clear();
+  scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->add_group_by_columns(schema_.column(0).name());
+  {
+    RpcController rpc;
+    resp.Clear();
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+}
+
 TEST_F(TabletServerTest, TestScanWithEncodedPredicates) {
   InsertTestRowsDirect(0, 100);
 
@@ -4096,6 +5317,86 @@ TEST_F(TabletServerTest, TestRpcServerCreateDestroy) {
   }
 }
 
+// With --abort_work_past_client_deadline, a write whose client's deadline
+// passes while it's queued for prepare is aborted. A write replicated before
+// its client's deadline passes is still applied, and counted as wasted work.
+TEST_F(TabletServerTest, TestWritesPastClientDeadline) {
+  FLAGS_abort_work_past_client_deadline = true;
+  FLAGS_tablet_inject_latency_on_apply_write_op_ms = 1000;
+
+  WriteRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  AddTestRowWithNullableStringToPB(
+      RowOperationsPB::UPSERT, schema_, 0, 0, nullptr, req.mutable_row_operations());
+
+  // All the writes are to the same row. The first one holds the row's lock
+  // while it's slowly applied, so the second one waits for the lock while
+  // it's prepared, and the third one waits in the tablet's prepare queue.
+  const vector<MonoDelta> kTimeouts = { MonoDelta::FromSeconds(30),
+                                        MonoDelta::FromMilliseconds(300),
+                                        MonoDelta::FromMilliseconds(300) };
+  vector<unique_ptr<RpcController>> controllers;
+  vector<unique_ptr<WriteResponsePB>> responses;
+  CountDownLatch latch(kTimeouts.size());
+  for (const auto& timeout : kTimeouts) {
+    controllers.emplace_back(new RpcController);
+    controllers.back()->set_timeout(timeout);
+    responses.emplace_back(new WriteResponsePB);
+    proxy_->WriteAsync(req, responses.back().get(), controllers.back().get(),
+                       [&latch]() { latch.CountDown(); });
+    SleepFor(MonoDelta::FromMilliseconds(50));
+  }
+  latch.Wait();
+  ASSERT_OK(controllers[0]->status());
+  ASSERT_FALSE(responses[0]->has_error()) << SecureDebugString(*responses[0]);
+  ASSERT_TRUE(controllers[1]->status().IsTimedOut()) << controllers[1]->status().ToString();
+  ASSERT_TRUE(controllers[2]->status().IsTimedOut()) << controllers[2]->status().ToString();
+
+  auto* metrics = tablet_replica_->tablet()->metrics();
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_EQ(1, metrics->ops_aborted_past_deadline->value());
+    ASSERT_EQ(1, metrics->ops_applied_past_deadline->value());
+  });
+}
+
+// Writes to different rows of a tablet are applied concurrently.
+TEST_F(TabletServerTest, TestConcurrentApplyOfNonConflictingWrites) {
+  constexpr int kNumWrites = 4;
+  constexpr int kInjectedLatencyMs = 1000;
+  if (base::NumCPUs() < kNumWrites) {
+    LOG(WARNING) << "not enough CPUs to apply the writes concurrently, skipping the test";
+    return;
+  }
+  FLAGS_tablet_inject_latency_on_apply_write_op_ms = kInjectedLatencyMs;
+
+  vector<unique_ptr<RpcController>> controllers;
+  vector<unique_ptr<WriteResponsePB>> responses;
+  CountDownLatch latch(kNumWrites);
+  const MonoTime start = MonoTime::Now();
+  for (int i = 0; i < kNumWrites; i++) {
+    WriteRequestPB req;
+    req.set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+    AddTestRowWithNullableStringToPB(
+        RowOperationsPB::INSERT, schema_, i, i, nullptr, req.mutable_row_operations());
+    controllers.emplace_back(new RpcController);
+    responses.emplace_back(new WriteResponsePB);
+    proxy_->WriteAsync(req, responses.back().get(), controllers.back().get(),
+                       [&latch]() { latch.CountDown(); });
+  }
+  latch.Wait();
+  const MonoDelta elapsed = MonoTime::Now() - start;
+  for (int i = 0; i < kNumWrites; i++) {
+    ASSERT_OK(controllers[i]->status());
+    ASSERT_FALSE(responses[i]->has_error()) << SecureDebugString(*responses[i]);
+  }
+  // Applied one at a time, the writes would take kNumWrites times as long.
+  ASSERT_LT(elapsed.ToMilliseconds(), (kNumWrites - 1) * kInjectedLatencyMs);
+  NO_FATALS(VerifyRows(schema_, { KeyValue(0, 0), KeyValue(1, 1), KeyValue(2, 2),
+                                  KeyValue(3, 3) }));
+}
+
 TEST_F(TabletServerTest, TestWriteOutOfBounds) {
   const char *tabletId = "TestWriteOutOfBoundsTablet";
   Schema schema = SchemaBuilder(schema_).Build();
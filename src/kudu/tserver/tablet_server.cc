@@ -33,7 +33,10 @@
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/startup_path_handler.h"
 #include "kudu/transactions/txn_system_client.h"
+#include "kudu/tserver/block_cache_warmer.h"
+#include "kudu/tserver/change_streams.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/quota_manager.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_copy_service.h"
 #include "kudu/tserver/tablet_service.h"
@@ -65,7 +68,9 @@ TabletServer::TabletServer(const TabletServerOptions& opts)
       fail_heartbeats_for_tests_(false),
       opts_(opts),
       tablet_manager_(new TSTabletManager(this)),
-      scanner_manager_(new ScannerManager(metric_entity())),
+      scanner_manager_(new ScannerManager(metric_entity(), mem_tracker())),
+      change_stream_manager_(new ChangeStreamManager),
+      quota_manager_(new QuotaManager),
       path_handlers_(new TabletServerPathHandlers(this)) {
 }
 
@@ -119,6 +124,12 @@ Status TabletServer::Init() {
                         "Could not init Tablet Manager");
   RETURN_NOT_OK_PREPEND(scanner_manager_->StartRemovalThread(),
                         "Could not start expired Scanner removal thread");
+  RETURN_NOT_OK_PREPEND(change_stream_manager_->Start(),
+                        "Could not start the change stream anchor release thread");
+  block_cache_warmer_.reset(new BlockCacheWarmer(
+      fs_manager_.get(),
+      [tablets_processed, total_tablets]() { return *tablets_processed >= *total_tablets; },
+      metric_entity()));
 
   state_ = kInitialized;
   return Status::OK();
@@ -161,6 +172,8 @@ Status TabletServer::Start() {
 
   RETURN_NOT_OK(heartbeater_->Start());
   RETURN_NOT_OK(maintenance_manager_->Start());
+  RETURN_NOT_OK_PREPEND(block_cache_warmer_->Start(),
+                        "Could not start the block cache warmer");
 
   google::FlushLogFiles(google::INFO); // Flush the startup messages.
 
@@ -178,6 +191,13 @@ void TabletServer::ShutdownImpl() {
 
     // 2. Shut down the tserver's subsystems.
     maintenance_manager_->Shutdown();
+    // A quiescing server is likely being restarted: don't leave its tablets
+    // with much of their logs to replay.
+    if (quiescing()) {
+      tablet_manager_->FlushTabletsBeforeShutdown();
+    }
+    block_cache_warmer_->Shutdown();
+    change_stream_manager_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::DISK_ERROR);
     fs_manager_->UnsetErrorNotificationCb(ErrorHandlerType::CFILE_CORRUPTION);
@@ -37,7 +37,10 @@ class TxnSystemClientInitializer;
 
 namespace tserver {
 
+class BlockCacheWarmer;
+class ChangeStreamManager;
 class Heartbeater;
+class QuotaManager;
 class ScannerManager;
 class TSTabletManager;
 class TabletServerPathHandlers;
@@ -73,6 +76,10 @@ class TabletServer : public kserver::KuduServer {
 
   ScannerManager* scanner_manager() { return scanner_manager_.get(); }
 
+  ChangeStreamManager* change_stream_manager() { return change_stream_manager_.get(); }
+
+  QuotaManager* quota_manager() { return quota_manager_.get(); }
+
   Heartbeater* heartbeater() { return heartbeater_.get(); }
 
   void set_fail_heartbeats_for_tests(bool fail_heartbeats_for_tests) {
@@ -131,6 +138,12 @@ class TabletServer : public kserver::KuduServer {
   // dependencies.
   std::unique_ptr<ScannerManager> scanner_manager_;
 
+  // Keeps the WALs of tablets retained for their change stream subscribers.
+  std::unique_ptr<ChangeStreamManager> change_stream_manager_;
+
+  // Enforces this server's shares of the table and user quotas.
+  std::unique_ptr<QuotaManager> quota_manager_;
+
   // Thread that initializes a TxnSystemClient.
   std::unique_ptr<transactions::TxnSystemClientInitializer> client_initializer_;
 
@@ -143,6 +156,9 @@ class TabletServer : public kserver::KuduServer {
   // The maintenance manager for this tablet server
   std::shared_ptr<MaintenanceManager> maintenance_manager_;
 
+  // Keeps the block cache warm across restarts.
+  std::unique_ptr<BlockCacheWarmer> block_cache_warmer_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletServer);
 };
 
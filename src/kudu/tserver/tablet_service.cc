@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <map>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -34,12 +35,17 @@
 #include <glog/logging.h>
 #include <google/protobuf/stubs/port.h>
 
+#include "kudu/cfile/block_export.h"
+#include "kudu/cfile/type_encodings.h"
 #include "kudu/clock/clock.h"
+#include "kudu/common/column_aggregate.h"
+#include "kudu/common/column_expression.h"
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnar_serialization.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/encoded_key.h"
+#include "kudu/common/generic_iterators.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/iterator_stats.h"
 #include "kudu/common/key_range.h"
@@ -54,8 +60,11 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid.pb.h"
+#include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/raft_consensus.h"
 #include "kudu/consensus/replica_management.pb.h"
 #include "kudu/consensus/time_manager.h"
@@ -65,14 +74,17 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/rpc/inbound_call.h"
 #include "kudu/rpc/remote_user.h"
 #include "kudu/rpc/rpc_context.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/rpc_verification_util.h"
+#include "kudu/rpc/transfer.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/security/token_verifier.h"
 #include "kudu/server/server_base.h"
@@ -92,6 +104,8 @@
 #include "kudu/tablet/txn_coordinator.h"
 #include "kudu/transactions/transactions.pb.h"
 #include "kudu/transactions/txn_status_manager.h"
+#include "kudu/tserver/change_streams.h"
+#include "kudu/tserver/quota_manager.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_replica_lookup.h"
 #include "kudu/tserver/tablet_server.h"
@@ -105,12 +119,14 @@
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/process_memory.h"
 #include "kudu/util/random_util.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -129,6 +145,25 @@ DEFINE_int32(scanner_max_batch_size_bytes, 8 * 1024 * 1024,
 TAG_FLAG(scanner_max_batch_size_bytes, advanced);
 TAG_FLAG(scanner_max_batch_size_bytes, runtime);
 
+DEFINE_int32(tserver_multi_get_max_keys, 10000,
+             "The maximum number of keys that a MultiGet request may look up.");
+TAG_FLAG(tserver_multi_get_max_keys, advanced);
+TAG_FLAG(tserver_multi_get_max_keys, runtime);
+
+DEFINE_int32(tserver_multi_get_max_result_bytes, 8 * 1024 * 1024,
+             "The maximum size of the rows that a MultiGet request may return. "
+             "Requests whose rows are larger fail: their keys should be looked "
+             "up in several requests.");
+TAG_FLAG(tserver_multi_get_max_result_bytes, advanced);
+TAG_FLAG(tserver_multi_get_max_result_bytes, runtime);
+
+DEFINE_int32(scanner_adaptive_min_batch_size_bytes, 64 * 1024,
+             "The smallest batch of scan results picked with "
+             "--scanner_adaptive_batch_sizing for clients which don't ask for "
+             "a minimum size.");
+TAG_FLAG(scanner_adaptive_min_batch_size_bytes, experimental);
+TAG_FLAG(scanner_adaptive_min_batch_size_bytes, runtime);
+
 // The default value is sized to a power of 2 to improve BitmapCopy performance
 // when copying a RowBlock (in ORDERED scans).
 DEFINE_int32(scanner_batch_size_rows, 128,
@@ -136,6 +171,14 @@ DEFINE_int32(scanner_batch_size_rows, 128,
 TAG_FLAG(scanner_batch_size_rows, advanced);
 TAG_FLAG(scanner_batch_size_rows, runtime);
 
+DEFINE_bool(scanner_reuse_row_blocks, false,
+            "Whether scanners keep the row block their rows are read into, and "
+            "its memory, across their batches instead of allocating new ones "
+            "for every scan request.");
+TAG_FLAG(scanner_reuse_row_blocks, advanced);
+TAG_FLAG(scanner_reuse_row_blocks, experimental);
+TAG_FLAG(scanner_reuse_row_blocks, runtime);
+
 DEFINE_bool(scanner_allow_snapshot_scans_with_logical_timestamps, false,
             "If set, the server will support snapshot scans with logical timestamps.");
 TAG_FLAG(scanner_allow_snapshot_scans_with_logical_timestamps, unsafe);
@@ -148,6 +191,62 @@ DEFINE_int32(scanner_max_wait_ms, 1000,
 TAG_FLAG(scanner_max_wait_ms, advanced);
 TAG_FLAG(scanner_max_wait_ms, runtime);
 
+DEFINE_int32(scanner_max_follower_staleness_ms, 0,
+             "If positive, READ_AT_SNAPSHOT scans without a snapshot timestamp are "
+             "served by non-leader replicas at their current safe time, instead of "
+             "waiting for safe time to catch up with the local clock, as long as safe "
+             "time lags the clock by no more than this many milliseconds. The picked "
+             "timestamp is returned to the client. Leaders holding a lease (see "
+             "--raft_enable_leader_leases) always serve such scans at their safe time.");
+TAG_FLAG(scanner_max_follower_staleness_ms, experimental);
+TAG_FLAG(scanner_max_follower_staleness_ms, runtime);
+
+DEFINE_bool(scanner_count_rows_from_metadata, true,
+            "Whether to answer COUNT(*) scans without predicates from the live row "
+            "counts kept in the tablet metadata instead of scanning the tablet. "
+            "Only applies to READ_LATEST scans of tablets supporting live row counts.");
+TAG_FLAG(scanner_count_rows_from_metadata, advanced);
+TAG_FLAG(scanner_count_rows_from_metadata, runtime);
+
+DEFINE_uint64(scanner_max_top_n_limit, 100000,
+              "The maximum limit of a scan returning the top rows of a tablet in a given "
+              "order. The tablet server keeps that many rows in memory while scanning.");
+TAG_FLAG(scanner_max_top_n_limit, advanced);
+TAG_FLAG(scanner_max_top_n_limit, runtime);
+
+DEFINE_int32(scanner_parallel_scan_threads, 1,
+             "The maximum number of rowsets of a tablet an unordered scan reads at a "
+             "time, each on a thread of a pool shared by the scans of the tablet server. "
+             "This lets scans of large tablets use several cores. 1 reads the rowsets "
+             "one after the other on the thread handling the scan request.");
+TAG_FLAG(scanner_parallel_scan_threads, experimental);
+TAG_FLAG(scanner_parallel_scan_threads, runtime);
+
+DEFINE_bool(scanner_async_safe_time_wait, false,
+            "Whether new snapshot scans on non-leader replicas release their service "
+            "thread while waiting for safe time to reach the snapshot timestamp. Such "
+            "scans are resumed on a separate pool (see --scanner_resume_pool_max_threads) "
+            "once the timestamp is safe or the wait times out.");
+TAG_FLAG(scanner_async_safe_time_wait, experimental);
+TAG_FLAG(scanner_async_safe_time_wait, runtime);
+
+DEFINE_int32(scanner_max_pipelined_continuations, 4,
+             "The number of continuations of a scanner which may arrive ahead of "
+             "their turn, and wait for the calls before them rather than failing. "
+             "This lets clients keep several batches of a scanner in flight, so that "
+             "the throughput of a scan isn't capped by one batch per round trip. "
+             "The waiting continuations don't hold service threads, and are run on "
+             "the pool of --scanner_resume_pool_max_threads. 0 disables this.");
+TAG_FLAG(scanner_max_pipelined_continuations, experimental);
+TAG_FLAG(scanner_max_pipelined_continuations, runtime);
+
+DEFINE_int32(scanner_resume_pool_max_threads, 8,
+             "The maximum number of threads running snapshot scans resumed after "
+             "waiting for safe time asynchronously, and scan continuations resumed "
+             "after waiting for their turn. See --scanner_async_safe_time_wait and "
+             "--scanner_max_pipelined_continuations.");
+TAG_FLAG(scanner_resume_pool_max_threads, experimental);
+
 // Fault injection flags.
 DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "If set, the scanner will pause the specified number of milliesconds "
@@ -180,10 +279,32 @@ DEFINE_bool(tserver_txn_write_op_handling_enabled, true,
             "in the context of multi-row transactions");
 TAG_FLAG(tserver_txn_write_op_handling_enabled, hidden);
 
+DEFINE_bool(tserver_memory_backpressure, true,
+            "Whether to push back on writes deterministically when the process "
+            "memory consumption is past the soft memory limit: writes to tablets "
+            "whose memstores hold more than a share of --flush_threshold_mb, "
+            "shrinking as the consumption nears the hard memory limit, are "
+            "rejected with a retry-after hint while they're flushed. If false, "
+            "writes are rejected at random, with a probability growing with the "
+            "consumption.");
+TAG_FLAG(tserver_memory_backpressure, experimental);
+TAG_FLAG(tserver_memory_backpressure, runtime);
+
+DEFINE_int32(tserver_memory_backpressure_retry_after_ms, 50,
+             "The retry-after hint of the writes pushed back on because of memory "
+             "pressure, at the soft memory limit. The hint grows linearly to four "
+             "times this at the hard memory limit.");
+TAG_FLAG(tserver_memory_backpressure_retry_after_ms, experimental);
+TAG_FLAG(tserver_memory_backpressure_retry_after_ms, runtime);
+
+DECLARE_bool(abort_work_past_client_deadline);
 DECLARE_bool(enable_txn_system_client_init);
 DECLARE_bool(raft_prepare_replacement_before_eviction);
+DECLARE_bool(scanner_adaptive_batch_sizing);
+DECLARE_int32(flush_threshold_mb);
 DECLARE_int32(memory_limit_warn_threshold_percentage);
 DECLARE_int32(tablet_history_max_age_sec);
+DECLARE_int64(rpc_max_message_size);
 DECLARE_uint32(txn_keepalive_interval_ms);
 
 METRIC_DEFINE_counter(
@@ -206,7 +327,12 @@ using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownMode;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiConsensusRequestPB;
+using kudu::consensus::MultiConsensusResponsePB;
+using kudu::consensus::MultiVoteRequestPB;
+using kudu::consensus::MultiVoteResponsePB;
 using kudu::consensus::OpId;
+using kudu::consensus::OpIdToString;
 using kudu::consensus::RaftConsensus;
 using kudu::consensus::RaftPeerPB;
 using kudu::consensus::RunLeaderElectionRequestPB;
@@ -229,6 +355,7 @@ using kudu::security::TokenPB;
 using kudu::security::TokenVerifier;
 using kudu::server::ServerBase;
 using kudu::tablet::AlterSchemaOpState;
+using kudu::tablet::ExportedRowSet;
 using kudu::tablet::MvccSnapshot;
 using kudu::tablet::OpCompletionCallback;
 using kudu::tablet::ParticipantOpState;
@@ -243,6 +370,7 @@ using kudu::tablet::WriteAuthorizationContext;
 using kudu::tablet::WriteOpState;
 using kudu::tablet::WritePrivilegeType;
 using kudu::tablet::WritePrivileges;
+using std::map;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -260,6 +388,10 @@ extern const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME;
 namespace tserver {
 
 const char* SCANNER_BYTES_READ_METRIC_NAME = "scanner_bytes_read";
+// Trace metrics of the time scans spent waiting for their snapshots, and
+// serializing their rows.
+const char* SCAN_SAFE_TIME_WAIT_US_METRIC_NAME = "scan_safe_time_wait_us";
+const char* SCAN_SERIALIZE_US_METRIC_NAME = "scan_serialize_us";
 
 namespace {
 
@@ -290,24 +422,34 @@ bool LookupTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
   return true;
 }
 
-template<class RespClass>
-void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+// Returns the error for 'replica' not being RUNNING, but in 'tablet_state',
+// and sets 'error_code' to the corresponding code.
+Status TabletNotRunningError(const scoped_refptr<TabletReplica>& replica,
                              TabletStatePB tablet_state,
-                             RespClass* resp,
-                             RpcContext* context) {
+                             TabletServerErrorPB::Code* error_code) {
   Status s = Status::IllegalState("Tablet not RUNNING",
                                   tablet::TabletStatePB_Name(tablet_state));
-  auto error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
   if (replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_TOMBSTONED ||
       replica->tablet_metadata()->tablet_data_state() == TABLET_DATA_DELETED) {
     // Treat tombstoned tablets as if they don't exist for most purposes.
     // This takes precedence over failed, since we don't reset the failed
     // status of a TabletReplica when deleting it. Only tablet copy does that.
-    error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
   } else if (tablet_state == tablet::FAILED) {
     s = s.CloneAndAppend(replica->error().ToString());
-    error_code = TabletServerErrorPB::TABLET_FAILED;
+    *error_code = TabletServerErrorPB::TABLET_FAILED;
   }
+  return s;
+}
+
+template<class RespClass>
+void RespondTabletNotRunning(const scoped_refptr<TabletReplica>& replica,
+                             TabletStatePB tablet_state,
+                             RespClass* resp,
+                             RpcContext* context) {
+  TabletServerErrorPB::Code error_code;
+  Status s = TabletNotRunningError(replica, tablet_state, &error_code);
   SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
 }
 
@@ -345,6 +487,25 @@ bool LookupRunningTabletReplicaOrRespond(TabletReplicaLookupIf* tablet_manager,
   return true;
 }
 
+// Like LookupRunningTabletReplicaOrRespond(), but returns the failure, and
+// sets 'error_code' to its code, rather than responding to an RPC.
+Status LookupRunningTabletReplica(TabletReplicaLookupIf* tablet_manager,
+                                  const string& tablet_id,
+                                  scoped_refptr<TabletReplica>* replica,
+                                  TabletServerErrorPB::Code* error_code) {
+  Status s = tablet_manager->GetTabletReplica(tablet_id, replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = s.IsServiceUnavailable() ? TabletServerErrorPB::UNKNOWN_ERROR
+                                           : TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  TabletStatePB state = (*replica)->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    return TabletNotRunningError(*replica, state, error_code);
+  }
+  return Status::OK();
+}
+
 template<class ReqClass, class RespClass>
 bool CheckUuidMatchOrRespond(TabletReplicaLookupIf* tablet_manager,
                              const char* method_name,
@@ -561,6 +722,41 @@ static bool CheckScanPrivilegesOrRespond(const NewScanRequestPB& scan_pb, const
   return true;
 }
 
+// Checks that 'authorized_column_ids' include the columns projected by the
+// MultiGet request 'req', and the key columns of 'schema', which the lookups
+// use like predicates of a scan.
+//
+// Returns false if the lookups aren't authorized and uses 'context' to send an
+// error response.
+static bool CheckMultiGetPrivilegesOrRespond(const MultiGetRequestPB& req, const Schema& schema,
+                                             const unordered_set<ColumnId>& authorized_column_ids,
+                                             RpcContext* context) {
+  unordered_set<ColumnId> required_privileges(schema.get_key_column_ids().begin(),
+                                              schema.get_key_column_ids().end());
+  for (const auto& col : req.projected_columns()) {
+    int col_idx = schema.find_column(col.name());
+    if (col_idx == Schema::kColumnNotFound) {
+      LOG(WARNING) << Substitute("rejecting MultiGet request from $0: no column named '$1'",
+                                 context->requestor_string(), col.name());
+      context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
+          Status::NotAuthorized("not authorized to MultiGet"));
+      return false;
+    }
+    EmplaceIfNotPresent(&required_privileges, schema.column_id(col_idx));
+  }
+  for (const auto& required_col_id : required_privileges) {
+    if (!ContainsKey(authorized_column_ids, required_col_id)) {
+      LOG(WARNING) << Substitute("rejecting MultiGet request from $0: authz token doesn't "
+                                 "authorize column ID $1", context->requestor_string(),
+                                 required_col_id);
+      context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
+          Status::NotAuthorized("not authorized to MultiGet"));
+      return false;
+    }
+  }
+  return true;
+}
+
 // Returns false if the table ID of 'privilege' doesn't match 'table_id',
 // responding with an error via 'context' if so. Otherwise, returns true.
 // 'req_type' is used for logging purposes.
@@ -643,6 +839,13 @@ static bool VerifyAuthzTokenOrRespond(const TokenVerifier& token_verifier,
   return true;
 }
 
+static void SetupError(TabletServerErrorPB* error,
+                       const Status& s,
+                       TabletServerErrorPB::Code code) {
+  StatusToPB(s, error->mutable_status());
+  error->set_code(code);
+}
+
 static void SetupErrorAndRespond(TabletServerErrorPB* error,
                                  const Status& s,
                                  TabletServerErrorPB::Code code,
@@ -654,14 +857,15 @@ static void SetupErrorAndRespond(TabletServerErrorPB* error,
     return;
   }
   // Generic "service unavailable" errors will cause the client to retry later.
+  // Those with a retry-after hint are returned in the response, to carry it.
   if ((code == TabletServerErrorPB::UNKNOWN_ERROR ||
-       code == TabletServerErrorPB::THROTTLED) && s.IsServiceUnavailable()) {
+       code == TabletServerErrorPB::THROTTLED) && s.IsServiceUnavailable() &&
+      !error->has_retry_after_ms()) {
     context->RespondRpcFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, s);
     return;
   }
 
-  StatusToPB(s, error->mutable_status());
-  error->set_code(code);
+  SetupError(error, s, code);
   context->RespondNoCache();
 }
 
@@ -723,6 +927,86 @@ class TxnWriteCompletionCallback : public RpcOpCompletionCallback<WriteResponseP
   std::function<Status(void)> abort_func_;
 };
 
+// Responds to a MultiWrite RPC once all of its writes have completed.
+class MultiWriteCompletion {
+ public:
+  MultiWriteCompletion(RpcContext* context, int num_writes)
+      : context_(context),
+        num_pending_(num_writes) {}
+
+  void WriteDone() {
+    if (--num_pending_ == 0) {
+      context_->RespondSuccess();
+    }
+  }
+
+ private:
+  RpcContext* context_;
+  std::atomic<int> num_pending_;
+};
+
+// An op completion callback for one of the writes of a MultiWrite RPC: sets
+// the write's error, if any, in its own response.
+class MultiWriteOpCompletionCallback : public OpCompletionCallback {
+ public:
+  MultiWriteOpCompletionCallback(shared_ptr<MultiWriteCompletion> completion,
+                                 WriteResponsePB* response)
+      : completion_(std::move(completion)),
+        response_(response) {}
+
+  void OpCompleted() override {
+    if (!status_.ok()) {
+      SetupError(response_->mutable_error(), status_, code_);
+    }
+    completion_->WriteDone();
+  }
+
+ private:
+  shared_ptr<MultiWriteCompletion> completion_;
+  WriteResponsePB* response_;
+};
+
+// Responds to a ParticipateInTransactionBatch RPC once all of its participant
+// ops have completed.
+class ParticipantBatchCompletion {
+ public:
+  ParticipantBatchCompletion(RpcContext* context, int num_ops)
+      : context_(context),
+        num_pending_(num_ops) {}
+
+  void OpDone() {
+    if (--num_pending_ == 0) {
+      context_->RespondSuccess();
+    }
+  }
+
+ private:
+  RpcContext* context_;
+  std::atomic<int> num_pending_;
+};
+
+// An op completion callback for one of the ops of a
+// ParticipateInTransactionBatch RPC: sets the op's error, if any, in its own
+// response.
+class ParticipantBatchOpCompletionCallback : public OpCompletionCallback {
+ public:
+  ParticipantBatchOpCompletionCallback(shared_ptr<ParticipantBatchCompletion> completion,
+                                       ParticipantResponsePB* response)
+      : completion_(std::move(completion)),
+        response_(response) {}
+
+  void OpCompleted() override {
+    if (!status_.ok()) {
+      SetupError(response_->mutable_error(), status_, code_);
+    }
+    completion_->OpDone();
+  }
+
+ private:
+  shared_ptr<ParticipantBatchCompletion> completion_;
+  ParticipantResponsePB* response_;
+};
+
 // Generic interface to handle scan results.
 class ScanResultCollector {
  public:
@@ -743,17 +1027,35 @@ class ScanResultCollector {
   //
   // Does nothing by default.
   virtual Status InitSerializer(uint64_t /* row_format_flags */,
+                                const ScanSpec& /* spec */,
                                 const Schema& /* scanner_schema */,
-                                const Schema& /* client_schema */) {
+                                const Schema& /* client_schema */,
+                                const Schema& /* tablet_schema */) {
     return Status::OK();
   }
 
+  // Folds 'num_rows' rows which were counted from tablet metadata, without
+  // being materialized, into the response. Returns false if the collector
+  // needs the rows themselves, in which case the rows must be scanned.
+  virtual bool HandleRowCount(int64_t /* num_rows */) {
+    return false;
+  }
+
   CpuTimes* cpu_times() {
     return &cpu_times_;
   }
 
+  // The profile of the scan, set if the request asked for it.
+  ScanProfilePB* mutable_profile() {
+    return &profile_;
+  }
+  const ScanProfilePB& profile() const {
+    return profile_;
+  }
+
  private:
   CpuTimes cpu_times_;
+  ScanProfilePB profile_;
 };
 
 namespace {
@@ -792,6 +1094,13 @@ class ResultSerializer {
   // Serialize the pending rows into the response protobuf.
   // Must be called at most once.
   virtual void SetupResponse(RpcContext* context, ScanResponsePB* resp) = 0;
+
+  // Add 'num_rows' rows which were counted without being materialized to the
+  // pending response. Returns false if the serializer needs the rows
+  // themselves.
+  virtual bool AddRowCount(int64_t /* num_rows */) {
+    return false;
+  }
 };
 
 class RowwiseResultSerializer : public ResultSerializer {
@@ -854,12 +1163,34 @@ class ColumnarResultSerializer : public ResultSerializer {
                        int batch_size_bytes,
                        const Schema& scanner_schema,
                        const Schema& client_schema,
+                       const Schema& tablet_schema,
                        unique_ptr<ResultSerializer>* serializer) {
-    if (flags & ~RowFormatFlags::COLUMNAR_LAYOUT) {
+    if (flags & ~(RowFormatFlags::COLUMNAR_LAYOUT |
+                  RowFormatFlags::COLUMNAR_DICTIONARY_ENCODING)) {
       return Status::InvalidArgument("Row format flags not supported with columnar layout");
     }
+    // Send the string and binary columns which are dictionary-encoded on disk
+    // as dictionaries and codes. Columns renamed since the scan started aren't
+    // found, and are sent as they are: the format is described per response.
+    vector<bool> dictionary_columns;
+    if (flags & RowFormatFlags::COLUMNAR_DICTIONARY_ENCODING) {
+      for (const auto& col : client_schema.columns()) {
+        bool dictionary = false;
+        int tablet_col_idx = tablet_schema.find_column(col.name());
+        if (col.type_info()->physical_type() == BINARY &&
+            tablet_col_idx != Schema::kColumnNotFound) {
+          const ColumnSchema& tablet_col = tablet_schema.column(tablet_col_idx);
+          EncodingType encoding = tablet_col.attributes().encoding;
+          if (encoding == AUTO_ENCODING) {
+            encoding = cfile::TypeEncodingInfo::GetDefaultEncoding(tablet_col.type_info());
+          }
+          dictionary = encoding == DICT_ENCODING;
+        }
+        dictionary_columns.push_back(dictionary);
+      }
+    }
     serializer->reset(new ColumnarResultSerializer(
-        scanner_schema, client_schema, batch_size_bytes));
+        scanner_schema, client_schema, batch_size_bytes, dictionary_columns));
     return Status::OK();
   }
 
@@ -883,6 +1214,9 @@ class ColumnarResultSerializer : public ResultSerializer {
       if (col.non_null_bitmap) {
         total += col.non_null_bitmap->size();
       }
+      if (col.dictionary_codes) {
+        total += col.dictionary_codes->size();
+      }
     }
     return total;
   }
@@ -910,6 +1244,12 @@ class ColumnarResultSerializer : public ResultSerializer {
             RpcSidecar::FromFaststring((std::move(*col.non_null_bitmap))), &sidecar_idx));
         col_pb->set_non_null_bitmap_sidecar(sidecar_idx);
       }
+
+      if (col.dictionary_codes) {
+        CHECK_OK(context->AddOutboundSidecar(
+            RpcSidecar::FromFaststring((std::move(*col.dictionary_codes))), &sidecar_idx));
+        col_pb->set_dictionary_codes_sidecar(sidecar_idx);
+      }
     }
     data->set_num_rows(num_rows_);
   }
@@ -917,8 +1257,9 @@ class ColumnarResultSerializer : public ResultSerializer {
  private:
   ColumnarResultSerializer(const Schema& scanner_schema,
                            const Schema& client_schema,
-                           int batch_size_bytes)
-      : results_(scanner_schema, client_schema, batch_size_bytes) {
+                           int batch_size_bytes,
+                           const vector<bool>& dictionary_columns)
+      : results_(scanner_schema, client_schema, batch_size_bytes, dictionary_columns) {
   }
 
   int64_t num_rows_ = 0;
@@ -926,6 +1267,113 @@ class ColumnarResultSerializer : public ResultSerializer {
   bool done_ = false;
 };
 
+// Folds the scanned rows into the aggregates of the scan spec rather than
+// returning the rows themselves. The response carries one partial result per
+// aggregate.
+class AggregateResultSerializer : public ResultSerializer {
+ public:
+  static Status Create(const ScanSpec& spec,
+                       const Schema& scanner_schema,
+                       unique_ptr<ResultSerializer>* serializer) {
+    vector<unique_ptr<ColumnAggregator>> aggregators;
+    for (const auto& aggregate : spec.aggregates()) {
+      unique_ptr<ColumnAggregator> aggregator;
+      RETURN_NOT_OK(ColumnAggregator::Create(aggregate, scanner_schema, &aggregator));
+      aggregators.emplace_back(std::move(aggregator));
+    }
+    serializer->reset(new AggregateResultSerializer(std::move(aggregators)));
+    return Status::OK();
+  }
+
+  int SerializeRowBlock(const RowBlock& row_block,
+                        const Schema* /* unused */) override {
+    CHECK(!done_);
+    for (auto& aggregator : aggregators_) {
+      aggregator->AddRowBlock(row_block);
+    }
+    return row_block.selection_vector()->CountSelected();
+  }
+
+  // The partial results have a small, fixed size, so a single response can
+  // aggregate as many rows as the scan time budget allows.
+  size_t ResponseSize() const override {
+    return aggregators_.size() * sizeof(ColumnAggregateResultPB);
+  }
+
+  void SetupResponse(RpcContext* /* context */, ScanResponsePB* resp) override {
+    CHECK(!done_);
+    done_ = true;
+    for (const auto& aggregator : aggregators_) {
+      aggregator->ToPB(resp->add_aggregate_results());
+    }
+  }
+
+  bool AddRowCount(int64_t num_rows) override {
+    CHECK(!done_);
+    for (const auto& aggregator : aggregators_) {
+      if (!aggregator->counts_all_rows()) {
+        return false;
+      }
+    }
+    for (auto& aggregator : aggregators_) {
+      aggregator->AddRowCount(num_rows);
+    }
+    return true;
+  }
+
+ private:
+  explicit AggregateResultSerializer(vector<unique_ptr<ColumnAggregator>> aggregators)
+      : aggregators_(std::move(aggregators)) {
+  }
+
+  vector<unique_ptr<ColumnAggregator>> aggregators_;
+  bool done_ = false;
+};
+
+// Folds the scanned rows into the aggregates of the scan spec per group of
+// rows with the same values of the group-by columns. The response carries the
+// partial results of each group.
+class GroupedAggregateResultSerializer : public ResultSerializer {
+ public:
+  static Status Create(const ScanSpec& spec,
+                       const Schema& scanner_schema,
+                       unique_ptr<ResultSerializer>* serializer) {
+    unique_ptr<GroupedColumnAggregator> aggregator;
+    RETURN_NOT_OK(GroupedColumnAggregator::Create(
+        spec.aggregates(), spec.group_by_columns(), scanner_schema, &aggregator));
+    serializer->reset(new GroupedAggregateResultSerializer(std::move(aggregator)));
+    return Status::OK();
+  }
+
+  int SerializeRowBlock(const RowBlock& row_block,
+                        const Schema* /* unused */) override {
+    CHECK(!done_);
+    aggregator_->AddRowBlock(row_block);
+    return row_block.selection_vector()->CountSelected();
+  }
+
+  // The groups are bounded by the batch size like rows are: if there are too
+  // many of them, the response is sent early and the following rows are
+  // grouped anew by the next one, and the caller merges the partial results.
+  size_t ResponseSize() const override {
+    return aggregator_->memory_footprint();
+  }
+
+  void SetupResponse(RpcContext* /* context */, ScanResponsePB* resp) override {
+    CHECK(!done_);
+    done_ = true;
+    aggregator_->ToPB(resp->mutable_aggregate_groups());
+  }
+
+ private:
+  explicit GroupedAggregateResultSerializer(unique_ptr<GroupedColumnAggregator> aggregator)
+      : aggregator_(std::move(aggregator)) {
+  }
+
+  unique_ptr<GroupedColumnAggregator> aggregator_;
+  bool done_ = false;
+};
+
 } // anonymous namespace
 
 // Copies the scan result to the given row block PB and data buffers.
@@ -963,17 +1411,30 @@ class ScanResultCopier : public ScanResultCollector {
     return num_rows_returned_;
   }
 
+  bool HandleRowCount(int64_t num_rows) override {
+    return serializer_ && serializer_->AddRowCount(num_rows);
+  }
+
   Status InitSerializer(uint64_t row_format_flags,
+                        const ScanSpec& spec,
                         const Schema& scanner_schema,
-                        const Schema& client_schema) override {
+                        const Schema& client_schema,
+                        const Schema& tablet_schema) override {
     if (serializer_) {
       // TODO(todd) for the NewScanner case, this gets called twice
       // which is a bit ugly. Refactor to avoid!
       return Status::OK();
     }
+    if (spec.has_aggregates() && !spec.group_by_columns().empty()) {
+      return GroupedAggregateResultSerializer::Create(spec, scanner_schema, &serializer_);
+    }
+    if (spec.has_aggregates()) {
+      return AggregateResultSerializer::Create(spec, scanner_schema, &serializer_);
+    }
     if (row_format_flags & COLUMNAR_LAYOUT) {
-      return ColumnarResultSerializer::Create(
-          row_format_flags, batch_size_bytes_, scanner_schema, client_schema, &serializer_);
+      return ColumnarResultSerializer::Create(row_format_flags, batch_size_bytes_,
+                                              scanner_schema, client_schema, tablet_schema,
+                                              &serializer_);
     }
     serializer_.reset(new RowwiseResultSerializer(batch_size_bytes_, row_format_flags));
     return Status::OK();
@@ -1095,12 +1556,31 @@ static size_t GetMaxBatchSizeBytesHint(const ScanRequestPB* req) {
                   implicit_cast<uint32_t>(FLAGS_scanner_max_batch_size_bytes));
 }
 
+// Sets the bounds within which the batch sizes of a request are picked with
+// --scanner_adaptive_batch_sizing: those requested by the client, or else
+// from the server's default minimum up to the maximum batch size.
+static void GetBatchSizeBoundsBytes(const ScanRequestPB* req,
+                                    size_t* min_bytes,
+                                    size_t* max_bytes) {
+  const size_t server_max = FLAGS_scanner_max_batch_size_bytes;
+  *max_bytes = req->has_batch_size_bytes() ?
+      std::min<size_t>(req->batch_size_bytes(), server_max) : server_max;
+  const size_t min = req->has_min_batch_size_bytes() ?
+      req->min_batch_size_bytes() : FLAGS_scanner_adaptive_min_batch_size_bytes;
+  *min_bytes = std::min(min, *max_bytes);
+}
+
 TabletServiceImpl::TabletServiceImpl(TabletServer* server)
     : TabletServerServiceIf(server->metric_entity(), server->result_tracker()),
       server_(server),
       rng_(GetRandomSeed32()) {
   num_op_apply_queue_rejections_ = server_->metric_entity()->FindOrCreateCounter(
       &METRIC_op_apply_queue_overload_rejections);
+  unique_ptr<ThreadPool> pool;
+  CHECK_OK(ThreadPoolBuilder("scan-resume")
+           .set_max_threads(FLAGS_scanner_resume_pool_max_threads)
+           .Build(&pool));
+  scan_resume_pool_ = std::move(pool);
 }
 
 bool TabletServiceImpl::AuthorizeClientOrServiceUser(const google::protobuf::Message* /*req*/,
@@ -1395,12 +1875,63 @@ void TabletServiceAdminImpl::ParticipateInTransaction(const ParticipantRequestPB
   }
 }
 
+void TabletServiceAdminImpl::ParticipateInTransactionBatch(
+    const ParticipantBatchRequestPB* req,
+    ParticipantBatchResponsePB* resp,
+    RpcContext* context) {
+  const int num_ops = req->requests_size();
+  // The ops complete concurrently, each filling in its own response, so all
+  // of the responses are added up front.
+  for (int i = 0; i < num_ops; i++) {
+    resp->add_responses();
+  }
+
+  // The extra op accounted for is this function's: it keeps the RPC from
+  // being responded to before all of the ops are submitted.
+  auto completion = std::make_shared<ParticipantBatchCompletion>(context, num_ops + 1);
+  for (int i = 0; i < num_ops; i++) {
+    const ParticipantRequestPB* op_req = &req->requests(i);
+    ParticipantResponsePB* op_resp = resp->mutable_responses(i);
+    Status s;
+    TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    scoped_refptr<TabletReplica> replica;
+    shared_ptr<Tablet> tablet;
+    if (PREDICT_FALSE(!op_req->has_op() || !op_req->op().has_type() ||
+                      !op_req->op().has_txn_id() || !op_req->has_tablet_id())) {
+      s = Status::InvalidArgument(
+          Substitute("Missing fields in request: $0", SecureShortDebugString(*op_req)));
+    } else if (PREDICT_FALSE(op_req->op().type() == ParticipantOpPB::GET_METADATA)) {
+      s = Status::NotSupported("GET_METADATA ops can't be batched");
+    } else {
+      s = LookupRunningTabletReplica(server_->tablet_manager(), op_req->tablet_id(),
+                                     &replica, &error_code);
+      if (PREDICT_TRUE(s.ok())) {
+        s = GetTabletRef(replica, &tablet, &error_code);
+      }
+    }
+    if (PREDICT_TRUE(s.ok())) {
+      unique_ptr<ParticipantOpState> op_state(
+          new ParticipantOpState(replica.get(), tablet->txn_participant(), op_req, op_resp));
+      op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
+          new ParticipantBatchOpCompletionCallback(completion, op_resp)));
+      s = replica->SubmitTxnParticipantOp(std::move(op_state));
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupError(op_resp->mutable_error(), s, error_code);
+      completion->OpDone();
+    }
+  }
+  completion->OpDone();
+}
+
 bool TabletServiceAdminImpl::SupportsFeature(uint32_t feature) const {
   switch (feature) {
     case TabletServerFeatures::COLUMN_PREDICATES:
     case TabletServerFeatures::PAD_UNIXTIME_MICROS_TO_16_BYTES:
     case TabletServerFeatures::QUIESCING:
     case TabletServerFeatures::BLOOM_FILTER_PREDICATE_V2:
+    case TabletServerFeatures::PARTICIPANT_OP_BATCH:
     // TODO(awong): once transactions are useable, add a feature flag.
       return true;
     default:
@@ -1543,6 +2074,153 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     return;
   }
   boost::optional<WriteAuthorizationContext> authz_context;
+  if (!AuthorizeWriteOrRespond(*req, replica, context, &authz_context)) {
+    return;
+  }
+
+  unique_ptr<WriteOpState> op_state;
+  TabletServerErrorPB::Code error_code;
+  Status s = NewWriteOpState(req, resp, replica, std::move(authz_context),
+                             context->AreResultsTracked() ? context->request_id() : nullptr,
+                             context->remote_user().username(), &op_state, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+
+  const auto deadline = context->GetClientDeadline();
+  const auto& username = context->remote_user().username();
+  op_state->set_client_deadline(deadline);
+
+  if (!req->has_txn_id() ||
+      PREDICT_FALSE(!FLAGS_tserver_txn_write_op_handling_enabled)) {
+    op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
+        new RpcOpCompletionCallback<WriteResponsePB>(context, resp)));
+
+    // Submit the write operation. The RPC will be responded asynchronously.
+    s = replica->SubmitWrite(std::move(op_state));
+  } else {
+    if (!FLAGS_enable_txn_system_client_init) {
+      return SetupErrorAndRespond(
+          resp->mutable_error(),
+          Status::NotSupported(Substitute("txns not supported on server $0",
+                                          replica->permanent_uuid())),
+          TabletServerErrorPB::UNKNOWN_ERROR, context);
+    }
+    auto abort_func = [this, txn_id = req->txn_id(), &username] {
+      return server_->tablet_manager()->ScheduleAbortTxn(txn_id, username);
+    };
+    op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
+        new TxnWriteCompletionCallback(context, resp, std::move(abort_func))));
+
+    // If it's a write operation in the context of a multi-row transaction,
+    // schedule running preliminary tasks if necessary: register the tablet as
+    // a participant in the transaction and begin transaction for the
+    // participating tablet.
+    //
+    // This functor is to schedule preliminary tasks prior to submitting
+    // the write operation via TabletReplica::SubmitWrite().
+    const auto scheduler = [this, &username, replica, deadline](
+        int64_t txn_id, tablet::RegisteredTxnCallback began_txn_cb) {
+      return server_->tablet_manager()->SchedulePreliminaryTasksForTxnWrite(
+          std::move(replica), txn_id, username, deadline, std::move(began_txn_cb));
+    };
+    s = replica->SubmitTxnWrite(std::move(op_state), scheduler);
+    VLOG(2) << Substitute("submitting txn write op: $0", s.ToString());
+  }
+
+  // Check that we could submit the write
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(
+        resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+  }
+}
+
+void TabletServiceImpl::MultiWrite(const MultiWriteRequestPB* req,
+                                   MultiWriteResponsePB* resp,
+                                   RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiWrite",
+               "num_writes", req->writes_size());
+  DVLOG(3) << "Received MultiWrite RPC: " << SecureDebugString(*req);
+  const int num_writes = req->writes_size();
+  // The writes complete concurrently, each filling in its own response, so
+  // all of the responses are added up front.
+  for (int i = 0; i < num_writes; i++) {
+    resp->add_responses();
+    resp->add_submitted(false);
+  }
+
+  // Authorize all of the writes before submitting any: like a Write RPC, the
+  // whole RPC is rejected if one of them isn't authorized.
+  vector<scoped_refptr<TabletReplica>> replicas(num_writes);
+  vector<boost::optional<WriteAuthorizationContext>> authz_contexts(num_writes);
+  for (int i = 0; i < num_writes; i++) {
+    const auto& write = req->writes(i);
+    TabletServerErrorPB::Code error_code;
+    Status s;
+    if (PREDICT_FALSE(write.has_txn_id())) {
+      s = Status::NotSupported("MultiWrite doesn't support transactional writes");
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    } else {
+      s = LookupRunningTabletReplica(server_->tablet_manager(), write.tablet_id(),
+                                     &replicas[i], &error_code);
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      replicas[i].reset();
+      SetupError(resp->mutable_responses(i)->mutable_error(), s, error_code);
+      continue;
+    }
+    if (!AuthorizeWriteOrRespond(write, replicas[i], context, &authz_contexts[i])) {
+      return;
+    }
+  }
+
+  // The extra write accounted for is this function's: it keeps the RPC from
+  // being responded to before all of the writes are submitted.
+  auto completion = std::make_shared<MultiWriteCompletion>(context, num_writes + 1);
+  const auto deadline = context->GetClientDeadline();
+  for (int i = 0; i < num_writes; i++) {
+    if (!replicas[i]) {
+      completion->WriteDone();
+      continue;
+    }
+    WriteResponsePB* write_resp = resp->mutable_responses(i);
+    unique_ptr<WriteOpState> op_state;
+    TabletServerErrorPB::Code error_code;
+    // The writes' results aren't tracked individually: a retry of a write
+    // which failed in a MultiWrite RPC is a new request.
+    Status s = NewWriteOpState(&req->writes(i), write_resp, replicas[i],
+                               std::move(authz_contexts[i]), /*request_id=*/nullptr,
+                               context->remote_user().username(), &op_state, &error_code);
+    if (PREDICT_TRUE(s.ok())) {
+      op_state->set_client_deadline(deadline);
+      op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
+          new MultiWriteOpCompletionCallback(completion, write_resp)));
+      s = replicas[i]->SubmitWrite(std::move(op_state));
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      // The RPC isn't responded to before this function's write is done, so
+      // this doesn't race with sending the response.
+      resp->set_submitted(i, s.ok());
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupError(write_resp->mutable_error(), s, error_code);
+      completion->WriteDone();
+    }
+  }
+  completion->WriteDone();
+}
+
+void TabletServiceImpl::MultiGet(const MultiGetRequestPB* req,
+                                 MultiGetResponsePB* resp,
+                                 RpcContext* context) {
+  TRACE_EVENT2("tserver", "TabletServiceImpl::MultiGet",
+               "tablet_id", req->tablet_id(),
+               "num_keys", req->encoded_keys_size());
+  DVLOG(3) << "Received MultiGet RPC: " << SecureDebugString(*req);
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(
+        server_->tablet_manager(), req->tablet_id(), resp, context, &replica)) {
+    return;
+  }
   if (FLAGS_tserver_enforce_access_control) {
     TokenPB token;
     if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), *req, context, &token)) {
@@ -1550,55 +2228,412 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     }
     const auto& privilege = token.authz().table_privilege();
     if (!CheckMatchingTableIdOrRespond(privilege, replica->tablet_metadata()->table_id(),
-                                       "Write", context)) {
+                                       "MultiGet", context)) {
       return;
     }
-    WritePrivileges privileges;
-    if (privilege.insert_privilege()) {
-      InsertOrDie(&privileges, WritePrivilegeType::INSERT);
+    unordered_set<ColumnId> authorized_column_ids;
+    if (!CheckMayHaveScanPrivilegesOrRespond(privilege, "MultiGet",
+                                             &authorized_column_ids, context)) {
+      return;
     }
-    if (privilege.update_privilege()) {
-      InsertOrDie(&privileges, WritePrivilegeType::UPDATE);
+    if (!privilege.scan_privilege()) {
+      const SchemaPtr schema_ptr = replica->tablet_metadata()->schema();
+      if (!CheckMultiGetPrivilegesOrRespond(*req, *schema_ptr, authorized_column_ids,
+                                            context)) {
+        return;
+      }
     }
-    if (privilege.delete_privilege()) {
-      InsertOrDie(&privileges, WritePrivilegeType::DELETE);
+  }
+  if (PREDICT_FALSE(replica->IsWitness())) {
+    return SetupErrorAndRespond(resp->mutable_error(),
+                                Status::IllegalState("witness replicas can't serve lookups"),
+                                TabletServerErrorPB::TABLET_NOT_RUNNING, context);
+  }
+
+  Schema projection;
+  Status s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_TRUE(s.ok()) && projection.has_column_ids()) {
+    s = Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  if (PREDICT_TRUE(s.ok())) {
+    for (const auto& col : projection.columns()) {
+      if (col.type_info()->is_virtual()) {
+        s = Status::InvalidArgument("MultiGet doesn't support virtual columns", col.name());
+        break;
+      }
     }
-    if (privileges.empty()) {
-      // If we know there are no write-related privileges outright, we can
-      // short-circuit further checking and reject the request immediately.
-      // Otherwise, we'll defer the checking to the prepare phase of the
-      // op after decoding the operations.
-      LOG(WARNING) << Substitute("rejecting Write request from $0: no write privileges",
-                                 context->requestor_string());
-      context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
-          Status::NotAuthorized("not authorized to write"));
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(resp->mutable_error(), s,
+                                TabletServerErrorPB::INVALID_SCHEMA, context);
+  }
+  if (req->row_format_flags() & RowFormatFlags::COLUMNAR_LAYOUT) {
+    return SetupErrorAndRespond(
+        resp->mutable_error(),
+        Status::InvalidArgument("MultiGet doesn't support the columnar layout"),
+        TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+  }
+  if (PREDICT_FALSE(req->encoded_keys_size() > FLAGS_tserver_multi_get_max_keys)) {
+    return SetupErrorAndRespond(
+        resp->mutable_error(),
+        Status::InvalidArgument(Substitute("MultiGet of $0 keys exceeds the maximum of $1",
+                                           req->encoded_keys_size(),
+                                           FLAGS_tserver_multi_get_max_keys)),
+        TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+  }
+
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_TRUE(s.ok())) {
+    s = tablet->mvcc_manager()->CheckIsCleanTimeInitialized();
+    error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+
+  vector<Slice> encoded_keys;
+  encoded_keys.reserve(req->encoded_keys_size());
+  for (const auto& key : req->encoded_keys()) {
+    encoded_keys.emplace_back(key);
+  }
+  RowBlockMemory mem;
+  RowBlock block(&projection, encoded_keys.size(), &mem);
+  vector<int> key_indexes;
+  s = tablet->LookupRows(projection, encoded_keys, &block, &key_indexes);
+  if (PREDICT_FALSE(!s.ok())) {
+    if (s.IsInvalidArgument()) {
+      error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    } else if (tablet->HasBeenStopped()) {
+      error_code = TabletServerErrorPB::TABLET_FAILED;
+    } else {
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    }
+    return SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+  TRACE("Found $0 of $1 rows", key_indexes.size(), encoded_keys.size());
+
+  faststring rows_data;
+  faststring indirect_data;
+  int num_rows = SerializeRowBlock(
+      block, &projection, &rows_data, &indirect_data,
+      req->row_format_flags() & RowFormatFlags::PAD_UNIX_TIME_MICROS_TO_16_BYTES);
+  const size_t result_bytes = rows_data.size() + indirect_data.size();
+  if (PREDICT_FALSE(result_bytes > static_cast<size_t>(FLAGS_tserver_multi_get_max_result_bytes))) {
+    return SetupErrorAndRespond(
+        resp->mutable_error(),
+        Status::InvalidArgument(Substitute(
+            "MultiGet result of $0 bytes exceeds the maximum of $1 bytes",
+            result_bytes, FLAGS_tserver_multi_get_max_result_bytes)),
+        TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+  }
+  RowwiseRowBlockPB* data = resp->mutable_data();
+  data->set_num_rows(num_rows);
+  int rows_idx;
+  s = context->AddOutboundSidecar(RpcSidecar::FromFaststring(std::move(rows_data)), &rows_idx);
+  if (PREDICT_TRUE(s.ok())) {
+    data->set_rows_sidecar(rows_idx);
+    if (indirect_data.size() > 0) {
+      int indirect_idx;
+      s = context->AddOutboundSidecar(
+          RpcSidecar::FromFaststring(std::move(indirect_data)), &indirect_idx);
+      data->set_indirect_data_sidecar(indirect_idx);
+    }
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    resp->clear_data();
+    return SetupErrorAndRespond(resp->mutable_error(), s,
+                                TabletServerErrorPB::UNKNOWN_ERROR, context);
+  }
+  for (int idx : key_indexes) {
+    resp->add_key_indexes(idx);
+  }
+  resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::ExportBlocks(const ExportBlocksRequestPB* req,
+                                     ExportBlocksResponsePB* resp,
+                                     RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::ExportBlocks",
+               "tablet_id", req->tablet_id());
+  DVLOG(3) << "Received ExportBlocks RPC: " << SecureDebugString(*req);
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(
+        server_->tablet_manager(), req->tablet_id(), resp, context, &replica)) {
+    return;
+  }
+  if (FLAGS_tserver_enforce_access_control) {
+    TokenPB token;
+    if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), *req, context, &token)) {
+      return;
+    }
+    const auto& privilege = token.authz().table_privilege();
+    if (!CheckMatchingTableIdOrRespond(privilege, replica->tablet_metadata()->table_id(),
+                                       "ExportBlocks", context)) {
+      return;
+    }
+    unordered_set<ColumnId> authorized_column_ids;
+    if (!CheckMayHaveScanPrivilegesOrRespond(privilege, "ExportBlocks",
+                                             &authorized_column_ids, context)) {
       return;
     }
-    authz_context = WriteAuthorizationContext{ privileges, /*requested_op_types=*/{} };
+    if (!privilege.scan_privilege()) {
+      const SchemaPtr schema_ptr = replica->tablet_metadata()->schema();
+      for (const auto& col : req->projected_columns()) {
+        int col_idx = schema_ptr->find_column(col.name());
+        if (col_idx == Schema::kColumnNotFound ||
+            !ContainsKey(authorized_column_ids, schema_ptr->column_id(col_idx))) {
+          LOG(WARNING) << Substitute("rejecting ExportBlocks request from $0: authz token "
+                                     "doesn't authorize column '$1'",
+                                     context->requestor_string(), col.name());
+          context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
+              Status::NotAuthorized("not authorized to ExportBlocks"));
+          return;
+        }
+      }
+    }
+  }
+  if (PREDICT_FALSE(replica->IsWitness())) {
+    return SetupErrorAndRespond(resp->mutable_error(),
+                                Status::IllegalState("witness replicas can't export blocks"),
+                                TabletServerErrorPB::TABLET_NOT_RUNNING, context);
+  }
+
+  Schema projection;
+  Status s = ColumnPBsToSchema(req->projected_columns(), &projection);
+  if (PREDICT_TRUE(s.ok()) && projection.has_column_ids()) {
+    s = Status::InvalidArgument("User requests should not have Column IDs");
+  }
+  if (PREDICT_TRUE(s.ok())) {
+    for (const auto& col : projection.columns()) {
+      if (col.type_info()->is_virtual()) {
+        s = Status::InvalidArgument("ExportBlocks doesn't support virtual columns", col.name());
+        break;
+      }
+    }
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(resp->mutable_error(), s,
+                                TabletServerErrorPB::INVALID_SCHEMA, context);
   }
 
   shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code error_code;
-  Status s = GetTabletRef(replica, &tablet, &error_code);
+  s = GetTabletRef(replica, &tablet, &error_code);
+  if (PREDICT_TRUE(s.ok())) {
+    s = tablet->mvcc_manager()->CheckIsCleanTimeInitialized();
+    error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+  }
   if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
-    return;
+    return SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+
+  // Unlike scans, exports don't wait for the snapshot to be clean: the
+  // snapshot is only used to check that none of the deltas are visible in it.
+  const Timestamp clean_timestamp = tablet->mvcc_manager()->GetCleanTimestamp();
+  Timestamp snap_timestamp = clean_timestamp;
+  if (req->has_snap_timestamp()) {
+    snap_timestamp = Timestamp(req->snap_timestamp());
+    if (PREDICT_FALSE(snap_timestamp > clean_timestamp)) {
+      return SetupErrorAndRespond(
+          resp->mutable_error(),
+          Status::IllegalState(Substitute("snapshot timestamp $0 is past the clean timestamp $1",
+                                          snap_timestamp.ToString(),
+                                          clean_timestamp.ToString())),
+          TabletServerErrorPB::INVALID_SNAPSHOT, context);
+    }
+  }
+  const vector<int64_t> rowset_ids(req->rowset_ids().begin(), req->rowset_ids().end());
+  if (PREDICT_FALSE(rowset_ids.empty() && req->start_row() > 0)) {
+    return SetupErrorAndRespond(
+        resp->mutable_error(),
+        Status::InvalidArgument("a start row requires the rowsets to export"),
+        TabletServerErrorPB::INVALID_SCAN_SPEC, context);
+  }
+  // Each column takes up to two sidecars, of which a response has a limited
+  // number: the rowsets beyond it are left to the next request. So is the
+  // data beyond half the maximum size of a message.
+  const int sidecars_per_rowset = std::max<int>(1, 2 * projection.num_columns());
+  const int max_rowsets = std::max(1, rpc::TransferLimits::kMaxSidecars / sidecars_per_rowset);
+  const int64_t max_bytes = std::min<int64_t>(req->max_bytes(), FLAGS_rpc_max_message_size / 2);
+  vector<ExportedRowSet> rowsets;
+  vector<int64_t> remaining_rowset_ids;
+  rowid_t next_row;
+  s = tablet->ExportBaseData(projection, MvccSnapshot(snap_timestamp), rowset_ids,
+                             req->start_row(), max_bytes, max_rowsets,
+                             &rowsets, &remaining_rowset_ids, &next_row);
+  if (PREDICT_FALSE(!s.ok())) {
+    if (s.IsIllegalState()) {
+      error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
+    } else if (s.IsNotFound()) {
+      error_code = TabletServerErrorPB::INVALID_SCHEMA;
+    } else if (s.IsInvalidArgument()) {
+      error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    } else if (tablet->HasBeenStopped()) {
+      error_code = TabletServerErrorPB::TABLET_FAILED;
+    } else {
+      error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    }
+    return SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+  }
+
+  int64_t num_bytes = 0;
+  for (auto& rowset : rowsets) {
+    ExportBlocksResponsePB::RowSetPB* rowset_pb = resp->add_rowsets();
+    rowset_pb->set_id(rowset.id);
+    rowset_pb->set_num_rows(rowset.num_rows);
+    rowset_pb->set_first_row(rowset.first_row);
+    rowset_pb->set_end_row(rowset.end_row);
+    for (auto& column : rowset.columns) {
+      ExportedCFilePB* column_pb = rowset_pb->add_columns();
+      column_pb->set_encoding(column.encoding);
+      column_pb->set_compression(column.compression);
+      column_pb->set_cfile_version(column.cfile_version);
+      column_pb->set_is_nullable(column.is_nullable);
+      for (const auto& block : column.blocks) {
+        ExportedCFilePB::BlockPB* block_pb = column_pb->add_blocks();
+        block_pb->set_first_row(block.first_row);
+        block_pb->set_num_rows(block.num_rows);
+        block_pb->set_offset(block.offset);
+        block_pb->set_size(block.size);
+      }
+      num_bytes += column.data.size() + column.dictionary.size();
+      int idx;
+      if (column.dictionary.size() > 0) {
+        s = context->AddOutboundSidecar(
+            RpcSidecar::FromFaststring(std::move(column.dictionary)), &idx);
+        column_pb->set_dictionary_sidecar(idx);
+      }
+      if (PREDICT_TRUE(s.ok())) {
+        s = context->AddOutboundSidecar(
+            RpcSidecar::FromFaststring(std::move(column.data)), &idx);
+        column_pb->set_data_sidecar(idx);
+      }
+      if (PREDICT_FALSE(!s.ok())) {
+        resp->clear_rowsets();
+        return SetupErrorAndRespond(resp->mutable_error(), s,
+                                    TabletServerErrorPB::UNKNOWN_ERROR, context);
+      }
+    }
+  }
+  for (int64_t id : remaining_rowset_ids) {
+    resp->add_remaining_rowset_ids(id);
+  }
+  if (next_row > 0) {
+    resp->set_next_row(next_row);
+  }
+  TRACE("Exported $0 bytes of $1 rowsets", num_bytes, rowsets.size());
+  resp->set_snap_timestamp(snap_timestamp.ToUint64());
+  resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+  context->RespondSuccess();
+}
+
+bool TabletServiceImpl::AuthorizeWriteOrRespond(
+    const WriteRequestPB& req,
+    const scoped_refptr<TabletReplica>& replica,
+    RpcContext* context,
+    boost::optional<WriteAuthorizationContext>* authz_context) {
+  if (!FLAGS_tserver_enforce_access_control) {
+    return true;
+  }
+  TokenPB token;
+  if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), req, context, &token)) {
+    return false;
+  }
+  const auto& privilege = token.authz().table_privilege();
+  if (!CheckMatchingTableIdOrRespond(privilege, replica->tablet_metadata()->table_id(),
+                                     "Write", context)) {
+    return false;
+  }
+  WritePrivileges privileges;
+  if (privilege.insert_privilege()) {
+    InsertOrDie(&privileges, WritePrivilegeType::INSERT);
   }
+  if (privilege.update_privilege()) {
+    InsertOrDie(&privileges, WritePrivilegeType::UPDATE);
+  }
+  if (privilege.delete_privilege()) {
+    InsertOrDie(&privileges, WritePrivilegeType::DELETE);
+  }
+  if (privileges.empty()) {
+    // If we know there are no write-related privileges outright, we can
+    // short-circuit further checking and reject the request immediately.
+    // Otherwise, we'll defer the checking to the prepare phase of the
+    // op after decoding the operations.
+    LOG(WARNING) << Substitute("rejecting Write request from $0: no write privileges",
+                               context->requestor_string());
+    context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
+        Status::NotAuthorized("not authorized to write"));
+    return false;
+  }
+  *authz_context = WriteAuthorizationContext{ privileges, /*requested_op_types=*/{} };
+  return true;
+}
+
+// Returns whether a write to 'tablet' should be rejected because the process is
+// short of memory, setting '*capacity_pct' to the percentage of the hard memory
+// limit consumed if so, and '*retry_after' to when to retry the write.
+//
+// Past the soft memory limit, the writes to the tablets whose memstores hold
+// the most memory are pushed back on, while the maintenance manager flushes
+// them first, so writes to the other tablets go on: a tablet's memstores may
+// hold up to a share of --flush_threshold_mb which shrinks to nothing as the
+// consumption nears the hard memory limit.
+static bool MemoryBackpressure(const Tablet& tablet, double* capacity_pct,
+                               MonoDelta* retry_after) {
+  if (!FLAGS_tserver_memory_backpressure) {
+    return process_memory::SoftLimitExceeded(capacity_pct);
+  }
+  const double excess = process_memory::SoftLimitExcess(capacity_pct);
+  if (excess <= 0) {
+    return false;
+  }
+  if (excess < 1) {
+    const int64_t max_memstores_size =
+        static_cast<int64_t>(FLAGS_flush_threshold_mb * 1024LL * 1024 * (1 - excess));
+    if (tablet.MemRowSetSize() + tablet.DeltaMemStoresSize() <= max_memstores_size) {
+      return false;
+    }
+  }
+  *retry_after = MonoDelta::FromMilliseconds(
+      FLAGS_tserver_memory_backpressure_retry_after_ms * (1 + 3 * excess));
+  return true;
+}
+
+Status TabletServiceImpl::NewWriteOpState(
+    const WriteRequestPB* req,
+    WriteResponsePB* resp,
+    const scoped_refptr<TabletReplica>& replica,
+    boost::optional<WriteAuthorizationContext> authz_context,
+    const rpc::RequestIdPB* request_id,
+    const string& username,
+    unique_ptr<WriteOpState>* op_state,
+    TabletServerErrorPB::Code* error_code) {
+  shared_ptr<Tablet> tablet;
+  RETURN_NOT_OK(GetTabletRef(replica, &tablet, error_code));
 
   uint64_t bytes = req->row_operations().rows().size() +
       req->row_operations().indirect_data().size();
+  for (const auto& block : req->row_operations().columnar_blocks()) {
+    bytes += block.ByteSizeLong();
+  }
   if (!tablet->ShouldThrottleAllow(bytes)) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::ServiceUnavailable("Rejecting Write request: throttled"),
-                         TabletServerErrorPB::THROTTLED,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: throttled");
+  }
+  if (!server_->quota_manager()->AdmitWrite(replica->tablet_metadata()->table_id(),
+                                            username, bytes)) {
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: quota exceeded");
   }
 
   // Check for memory pressure; don't bother doing any additional work if we've
   // exceeded the limit.
   double capacity_pct;
-  if (process_memory::SoftLimitExceeded(&capacity_pct)) {
+  MonoDelta retry_after;
+  if (MemoryBackpressure(*tablet, &capacity_pct, &retry_after)) {
     tablet->metrics()->leader_memory_pressure_rejections->Increment();
     string msg = StringPrintf("Soft memory limit exceeded (at %.2f%% of capacity)", capacity_pct);
     if (capacity_pct >= FLAGS_memory_limit_warn_threshold_percentage) {
@@ -1606,19 +2641,17 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
-    SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    if (retry_after.Initialized()) {
+      resp->mutable_error()->set_retry_after_ms(retry_after.ToMilliseconds());
+    }
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::ServiceUnavailable(msg);
   }
 
   if (!server_->clock()->SupportsExternalConsistencyMode(req->external_consistency_mode())) {
-    Status s = Status::NotSupported("The configured clock does not support the"
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return Status::NotSupported("The configured clock does not support the"
         " required consistency mode.");
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
   }
 
   // If the apply queue is overloaded, the write request might be rejected.
@@ -1637,76 +2670,29 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
       static const Status kStatus = Status::ServiceUnavailable(
           "op apply queue is overloaded");
       num_op_apply_queue_rejections_->Increment();
-      return SetupErrorAndRespond(resp->mutable_error(),
-                                  kStatus,
-                                  TabletServerErrorPB::THROTTLED,
-                                  context);
+      *error_code = TabletServerErrorPB::THROTTLED;
+      return kStatus;
     }
   }
 
-  unique_ptr<WriteOpState> op_state(new WriteOpState(
-      replica.get(),
-      req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
-      resp,
-      std::move(authz_context)));
-
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
-  if (req->has_propagated_timestamp()) {
-    Timestamp ts(req->propagated_timestamp());
-    s = server_->clock()->Update(ts);
-  }
-  if (PREDICT_FALSE(!s.ok())) {
-    return SetupErrorAndRespond(
-        resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
-  }
-
-  const auto deadline = context->GetClientDeadline();
-  const auto& username = context->remote_user().username();
-
-  if (!req->has_txn_id() ||
-      PREDICT_FALSE(!FLAGS_tserver_txn_write_op_handling_enabled)) {
-    op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
-        new RpcOpCompletionCallback<WriteResponsePB>(context, resp)));
-
-    // Submit the write operation. The RPC will be responded asynchronously.
-    s = replica->SubmitWrite(std::move(op_state));
-  } else {
-    if (!FLAGS_enable_txn_system_client_init) {
-      return SetupErrorAndRespond(
-          resp->mutable_error(),
-          Status::NotSupported(Substitute("txns not supported on server $0",
-                                          replica->permanent_uuid())),
-          TabletServerErrorPB::UNKNOWN_ERROR, context);
-    }
-    auto abort_func = [this, txn_id = req->txn_id(), &username] {
-      return server_->tablet_manager()->ScheduleAbortTxn(txn_id, username);
-    };
-    op_state->set_completion_callback(unique_ptr<OpCompletionCallback>(
-        new TxnWriteCompletionCallback(context, resp, std::move(abort_func))));
-
-    // If it's a write operation in the context of a multi-row transaction,
-    // schedule running preliminary tasks if necessary: register the tablet as
-    // a participant in the transaction and begin transaction for the
-    // participating tablet.
-    //
-    // This functor is to schedule preliminary tasks prior to submitting
-    // the write operation via TabletReplica::SubmitWrite().
-    const auto scheduler = [this, &username, replica, deadline](
-        int64_t txn_id, tablet::RegisteredTxnCallback began_txn_cb) {
-      return server_->tablet_manager()->SchedulePreliminaryTasksForTxnWrite(
-          std::move(replica), txn_id, username, deadline, std::move(began_txn_cb));
-    };
-    s = replica->SubmitTxnWrite(std::move(op_state), scheduler);
-    VLOG(2) << Substitute("submitting txn write op: $0", s.ToString());
+  if (req->has_propagated_timestamp()) {
+    Timestamp ts(req->propagated_timestamp());
+    Status s = server_->clock()->Update(ts);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
   }
 
-  // Check that we could submit the write
-  if (PREDICT_FALSE(!s.ok())) {
-    return SetupErrorAndRespond(
-        resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
-  }
+  op_state->reset(new WriteOpState(
+      replica.get(),
+      req,
+      request_id,
+      resp,
+      std::move(authz_context)));
+  return Status::OK();
 }
 
 ConsensusServiceImpl::ConsensusServiceImpl(ServerBase* server,
@@ -1725,6 +2711,32 @@ bool ConsensusServiceImpl::AuthorizeServiceUser(const google::protobuf::Message*
   return server_->Authorize(rpc, ServerBase::SUPER_USER | ServerBase::SERVICE_USER);
 }
 
+bool ConsensusServiceImpl::SupportsFeature(uint32_t feature) const {
+  switch (feature) {
+    case consensus::OPS_AS_SIDECARS:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Fills 'req_with_ops' with 'req', along with the ops carried by the sidecars
+// of 'context' rather than embedded in 'req'.
+static Status ParseOpsFromSidecars(const ConsensusRequestPB& req,
+                                   const RpcContext& context,
+                                   ConsensusRequestPB* req_with_ops) {
+  req_with_ops->CopyFrom(req);
+  req_with_ops->clear_ops_sidecar_idx();
+  for (int32_t idx : req.ops_sidecar_idx()) {
+    Slice data;
+    RETURN_NOT_OK(context.GetInboundSidecar(idx, &data));
+    RETURN_NOT_OK_PREPEND(pb_util::ParseFromArray(req_with_ops->add_ops(),
+                                                  data.data(), data.size()),
+                          Substitute("could not parse op from sidecar $0", idx));
+  }
+  return Status::OK();
+}
+
 void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
                                            ConsensusResponsePB* resp,
                                            RpcContext* context) {
@@ -1741,6 +2753,17 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   // Submit the update directly to the TabletReplica's RaftConsensus instance.
   shared_ptr<RaftConsensus> consensus;
   if (!GetConsensusOrRespond(replica, resp, context, &consensus)) return;
+  ConsensusRequestPB req_with_ops;
+  if (req->ops_sidecar_idx_size() > 0) {
+    Status s = ParseOpsFromSidecars(*req, *context, &req_with_ops);
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s,
+                           TabletServerErrorPB::UNKNOWN_ERROR,
+                           context);
+      return;
+    }
+    req = &req_with_ops;
+  }
   Status s = consensus->Update(req, resp);
   if (PREDICT_FALSE(!s.ok())) {
     // Clear the response first, since a partially-filled response could
@@ -1756,6 +2779,69 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+// Applies one of the updates of a MultiUpdateConsensus() RPC. Unlike
+// UpdateConsensus(), errors are returned along with their code rather than
+// responded, since the other updates of the batch are still to be applied.
+static Status ApplyBatchedConsensusUpdate(TabletReplicaLookupIf* tablet_manager,
+                                          const ConsensusRequestPB& req,
+                                          ConsensusResponsePB* resp,
+                                          TabletServerErrorPB::Code* error_code) {
+  const string& local_uuid = tablet_manager->NodeInstance().permanent_uuid();
+  if (PREDICT_FALSE(req.dest_uuid() != local_uuid)) {
+    *error_code = TabletServerErrorPB::WRONG_SERVER_UUID;
+    return Status::InvalidArgument(Substitute("MultiUpdateConsensus: Wrong destination UUID "
+                                              "requested. Local UUID: $0. Requested UUID: $1",
+                                              local_uuid, req.dest_uuid()));
+  }
+  scoped_refptr<TabletReplica> replica;
+  Status s = tablet_manager->GetTabletReplica(req.tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = s.IsServiceUnavailable() ? TabletServerErrorPB::UNKNOWN_ERROR
+                                           : TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  const TabletStatePB state = replica->state();
+  if (PREDICT_FALSE(state != tablet::RUNNING)) {
+    const auto data_state = replica->tablet_metadata()->tablet_data_state();
+    if (data_state == TABLET_DATA_TOMBSTONED || data_state == TABLET_DATA_DELETED) {
+      *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    } else if (state == tablet::FAILED) {
+      *error_code = TabletServerErrorPB::TABLET_FAILED;
+    } else {
+      *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    }
+    return Status::IllegalState("Tablet not RUNNING", tablet::TabletStatePB_Name(state));
+  }
+  shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  if (PREDICT_FALSE(!consensus)) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::ServiceUnavailable("Raft Consensus unavailable",
+                                      "Tablet replica not initialized");
+  }
+  *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  return consensus->Update(&req, resp);
+}
+
+void ConsensusServiceImpl::MultiUpdateConsensus(const MultiConsensusRequestPB* req,
+                                                MultiConsensusResponsePB* resp,
+                                                RpcContext* context) {
+  DVLOG(3) << "Received Multi Consensus Update RPC with " << req->requests_size()
+           << " updates from " << context->requestor_string();
+  for (const auto& update_req : req->requests()) {
+    ConsensusResponsePB* update_resp = resp->add_responses();
+    TabletServerErrorPB::Code error_code;
+    Status s = ApplyBatchedConsensusUpdate(tablet_manager_, update_req, update_resp,
+                                           &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      // See UpdateConsensus() for why the response is cleared.
+      update_resp->Clear();
+      StatusToPB(s, update_resp->mutable_error()->mutable_status());
+      update_resp->mutable_error()->set_code(error_code);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 RpcContext* context) {
@@ -1820,6 +2906,66 @@ void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
   context->RespondSuccess();
 }
 
+// Handles one of the vote requests of a MultiRequestConsensusVote() RPC,
+// returning errors along with their code as ApplyBatchedConsensusUpdate() does.
+// See RequestConsensusVote() for the voting of tombstoned replicas.
+static Status HandleBatchedVoteRequest(TabletReplicaLookupIf* tablet_manager,
+                                       const VoteRequestPB& req,
+                                       VoteResponsePB* resp,
+                                       TabletServerErrorPB::Code* error_code) {
+  const string& local_uuid = tablet_manager->NodeInstance().permanent_uuid();
+  if (PREDICT_FALSE(req.has_dest_uuid() && req.dest_uuid() != local_uuid)) {
+    *error_code = TabletServerErrorPB::WRONG_SERVER_UUID;
+    return Status::InvalidArgument(Substitute("MultiRequestConsensusVote: Wrong destination "
+                                              "UUID requested. Local UUID: $0. Requested "
+                                              "UUID: $1", local_uuid, req.dest_uuid()));
+  }
+  scoped_refptr<TabletReplica> replica;
+  Status s = tablet_manager->GetTabletReplica(req.tablet_id(), &replica);
+  if (PREDICT_FALSE(!s.ok())) {
+    *error_code = s.IsServiceUnavailable() ? TabletServerErrorPB::UNKNOWN_ERROR
+                                           : TabletServerErrorPB::TABLET_NOT_FOUND;
+    return s;
+  }
+  boost::optional<OpId> last_logged_opid;
+  const tablet::TabletDataState data_state = replica->tablet_metadata()->tablet_data_state();
+  if (data_state == TABLET_DATA_DELETED) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::IllegalState("Tablet not RUNNING",
+                                tablet::TabletStatePB_Name(replica->state()));
+  }
+  if (data_state == TABLET_DATA_COPYING || data_state == TABLET_DATA_TOMBSTONED) {
+    last_logged_opid = replica->tablet_metadata()->tombstone_last_logged_opid();
+  }
+  shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  if (PREDICT_FALSE(!consensus)) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::ServiceUnavailable("Raft Consensus unavailable",
+                                      "Tablet replica not initialized");
+  }
+  *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  return consensus->RequestVote(
+      &req, consensus::TabletVotingState(std::move(last_logged_opid), data_state), resp);
+}
+
+void ConsensusServiceImpl::MultiRequestConsensusVote(const MultiVoteRequestPB* req,
+                                                     MultiVoteResponsePB* resp,
+                                                     RpcContext* context) {
+  VLOG(1) << "Received MultiRequestConsensusVote() RPC with " << req->requests_size()
+          << " vote requests from " << context->requestor_string();
+  for (const auto& vote_req : req->requests()) {
+    VoteResponsePB* vote_resp = resp->add_responses();
+    TabletServerErrorPB::Code error_code;
+    Status s = HandleBatchedVoteRequest(tablet_manager_, vote_req, vote_resp, &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      vote_resp->Clear();
+      StatusToPB(s, vote_resp->mutable_error()->mutable_status());
+      vote_resp->mutable_error()->set_code(error_code);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void ConsensusServiceImpl::ChangeConfig(const ChangeConfigRequestPB* req,
                                         ChangeConfigResponsePB* resp,
                                         RpcContext* context) {
@@ -2143,6 +3289,51 @@ void SetResourceMetrics(const RpcContext* context,
 void TabletServiceImpl::Scan(const ScanRequestPB* req,
                              ScanResponsePB* resp,
                              RpcContext* context) {
+  DoScan(req, resp, context, nullptr);
+}
+
+bool TabletServiceImpl::SuspendScanUntilSafe(shared_ptr<RaftConsensus> consensus,
+                                             const ResumedScan& state,
+                                             const ScanRequestPB* req,
+                                             ScanResponsePB* resp,
+                                             RpcContext* context) {
+  // The scan is resumed exactly once: when the snapshot timestamp becomes safe
+  // or when the wait times out, whichever comes first. Nothing here should
+  // refer to the replica: the callback is kept by its TimeManager.
+  auto resumed = std::make_shared<std::atomic<bool>>(false);
+  auto pool = scan_resume_pool_;
+  auto resume = [this, pool, resumed, state, req, resp, context]() {
+    if (resumed->exchange(true)) {
+      return;
+    }
+    Status s = pool->Submit([this, state, req, resp, context]() {
+      ADOPT_TRACE(context->trace());
+      DoScan(req, resp, context, &state);
+    });
+    if (PREDICT_FALSE(!s.ok())) {
+      context->RespondFailure(s.CloneAndPrepend("could not resume scan"));
+    }
+  };
+  if (!consensus->time_manager()->NotifyWhenSafe(state.snap_timestamp, state.wait_deadline,
+                                                 resume)) {
+    return false;
+  }
+  // The scan may have been resumed already: don't touch 'resp' or 'context'.
+  // If it times out, its callback is dropped from the time manager, which
+  // safe time may never advance again, e.g. on a partitioned follower.
+  server_->messenger()->ScheduleOnReactor(
+      [resume, consensus](const Status& /* s */) {
+        resume();
+        consensus->time_manager()->ExpireAsyncWaiters();
+      },
+      std::max(state.wait_deadline - MonoTime::Now(), MonoDelta::FromMilliseconds(0)));
+  return true;
+}
+
+void TabletServiceImpl::DoScan(const ScanRequestPB* req,
+                               ScanResponsePB* resp,
+                               RpcContext* context,
+                               const ResumedScan* resumed) {
   TRACE_EVENT0("tserver", "TabletServiceImpl::Scan");
 
   // Validate the request: user must pass a new_scan_request or
@@ -2202,11 +3393,61 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
                                              context, &replica)) {
       return;
     }
+    // A resumed scan was admitted when it was first received.
+    if (!resumed &&
+        !server_->quota_manager()->AdmitScan(replica->tablet_metadata()->table_id(),
+                                             context->remote_user().username())) {
+      SetupErrorAndRespond(resp->mutable_error(),
+                           Status::ServiceUnavailable("Rejecting Scan request: quota exceeded"),
+                           TabletServerErrorPB::THROTTLED, context);
+      return;
+    }
+    // The data version must be read before the scan's snapshot is taken: if
+    // rows are written in between, it changes once they're visible, and the
+    // results cached with it are re-scanned next time.
+    uint64_t data_version = 0;
+    if (scan_pb.return_data_version() || scan_pb.has_cached_data_version()) {
+      shared_ptr<Tablet> tablet;
+      Status s = GetTabletRef(replica, &tablet, &error_code);
+      if (PREDICT_FALSE(!s.ok())) {
+        SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+        return;
+      }
+      data_version = tablet->data_version();
+      resp->set_data_version(data_version);
+      // Only the results of READ_LATEST scans stay the same as long as the
+      // data does: the others may have to wait for this replica to catch up.
+      if (scan_pb.has_cached_data_version() &&
+          scan_pb.cached_data_version() == data_version &&
+          scan_pb.read_mode() == READ_LATEST) {
+        TRACE("Tablet data unchanged");
+        resp->set_data_unchanged(true);
+        resp->set_has_more_results(false);
+        resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+        context->RespondSuccess();
+        return;
+      }
+    }
+
     string scanner_id;
     Timestamp scan_timestamp;
-    Status s = HandleNewScanRequest(replica.get(), req, context,
+    bool suspended = false;
+    std::function<bool(const ResumedScan&)> suspend;
+    if (FLAGS_scanner_async_safe_time_wait && !resumed) {
+      shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+      suspend = [&, consensus](const ResumedScan& state) {
+        suspended = SuspendScanUntilSafe(consensus, state, req, resp, context);
+        return suspended;
+      };
+    }
+    Status s = HandleNewScanRequest(replica.get(), req, context, resumed, suspend,
                                     &collector, &scanner_id, &scan_timestamp, &has_more_results,
                                     &error_code);
+    if (suspended) {
+      // The response is sent once the scan is resumed.
+      DCHECK(s.IsIncomplete()) << s.ToString();
+      return;
+    }
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -2220,7 +3461,29 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
   } else if (req->has_scanner_id()) {
-    Status s = HandleContinueScanRequest(req, context, &collector, &has_more_results, &error_code);
+    // A continuation which arrives ahead of its turn is resumed on
+    // 'scan_resume_pool_' once the calls before it are done.
+    std::function<void()> resume;
+    if (FLAGS_scanner_max_pipelined_continuations > 0) {
+      auto pool = scan_resume_pool_;
+      resume = [this, pool, req, resp, context]() {
+        Status s = pool->Submit([this, req, resp, context]() {
+          ADOPT_TRACE(context->trace());
+          DoScan(req, resp, context, nullptr);
+        });
+        if (PREDICT_FALSE(!s.ok())) {
+          context->RespondFailure(s.CloneAndPrepend("could not resume scan"));
+        }
+      };
+    }
+    bool parked = false;
+    Status s = HandleContinueScanRequest(req, context, resume, &collector, &has_more_results,
+                                         &error_code, &parked);
+    if (parked) {
+      // The response is sent once the continuation is resumed.
+      DCHECK(s.IsIncomplete()) << s.ToString();
+      return;
+    }
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -2233,9 +3496,15 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
 
   collector.SetupResponse(context, resp);
   resp->set_has_more_results(has_more_results);
+  if (has_more_results && FLAGS_scanner_max_pipelined_continuations > 0) {
+    resp->set_max_pipelined_continuations(FLAGS_scanner_max_pipelined_continuations);
+  }
   resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
 
   SetResourceMetrics(context, collector.cpu_times(), resp->mutable_resource_metrics());
+  if (req->return_profile()) {
+    *resp->mutable_profile() = collector.profile();
+  }
   context->RespondSuccess();
 }
 
@@ -2433,6 +3702,195 @@ void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::GetChanges(const GetChangesRequestPB* req,
+                                   GetChangesResponsePB* resp,
+                                   RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::GetChanges",
+               "tablet_id", req->tablet_id());
+  DVLOG(3) << "Received GetChanges RPC: " << SecureDebugString(*req);
+  scoped_refptr<TabletReplica> replica;
+  if (!LookupRunningTabletReplicaOrRespond(
+        server_->tablet_manager(), req->tablet_id(), resp, context, &replica)) {
+    return;
+  }
+  if (FLAGS_tserver_enforce_access_control) {
+    TokenPB token;
+    if (!VerifyAuthzTokenOrRespond(server_->token_verifier(), *req, context, &token)) {
+      return;
+    }
+    const auto& privilege = token.authz().table_privilege();
+    if (!CheckMatchingTableIdOrRespond(privilege, replica->tablet_metadata()->table_id(),
+                                       "GetChanges", context)) {
+      return;
+    }
+    // Which rows had any of their columns updated is revealed regardless of
+    // the projection, so the changes of any of the columns may be returned.
+    if (!privilege.scan_privilege()) {
+      LOG(WARNING) << Substitute("rejecting GetChanges request from $0: no table-level "
+                                 "scan privileges", context->requestor_string());
+      context->RespondRpcFailure(ErrorStatusPB::FATAL_UNAUTHORIZED,
+                                 Status::NotAuthorized("not authorized to GetChanges"));
+      return;
+    }
+  }
+
+  const SchemaPtr tablet_schema_ptr = replica->tablet_metadata()->schema();
+  const Schema& tablet_schema = *tablet_schema_ptr;
+  const size_t num_key_columns = tablet_schema.num_key_columns();
+  vector<ColumnSchema> columns(tablet_schema.columns().begin(),
+                               tablet_schema.columns().begin() + num_key_columns);
+  if (req->projected_columns_size() == 0) {
+    columns = tablet_schema.columns();
+  }
+  for (const auto& column : req->projected_columns()) {
+    const int col_idx = tablet_schema.find_column(column.name());
+    if (PREDICT_FALSE(col_idx == Schema::kColumnNotFound)) {
+      return SetupErrorAndRespond(resp->mutable_error(),
+                                  Status::InvalidArgument("no such column", column.name()),
+                                  TabletServerErrorPB::INVALID_SCHEMA, context);
+    }
+    if (col_idx >= static_cast<int>(num_key_columns)) {
+      columns.emplace_back(tablet_schema.column(col_idx));
+    }
+  }
+  Schema projection;
+  Status s = projection.Reset(std::move(columns), num_key_columns);
+  if (PREDICT_FALSE(!s.ok())) {
+    return SetupErrorAndRespond(resp->mutable_error(), s,
+                                TabletServerErrorPB::INVALID_SCHEMA, context);
+  }
+
+  shared_ptr<RaftConsensus> consensus = replica->shared_consensus();
+  const auto committed_op_id = consensus ?
+      consensus->GetLastOpId(consensus::COMMITTED_OPID) : boost::none;
+  if (PREDICT_FALSE(!committed_op_id)) {
+    return SetupErrorAndRespond(resp->mutable_error(),
+                                Status::ServiceUnavailable("tablet's committed ops not known"),
+                                TabletServerErrorPB::TABLET_NOT_RUNNING, context);
+  }
+  const shared_ptr<log::LogReader> reader = replica->log()->reader();
+  int64_t after_index;
+  if (req->has_after_op_id()) {
+    after_index = req->after_op_id().index();
+    if (PREDICT_FALSE(after_index > committed_op_id->index())) {
+      return SetupErrorAndRespond(
+          resp->mutable_error(),
+          Status::InvalidArgument(Substitute("op $0 isn't committed",
+                                             OpIdToString(req->after_op_id()))),
+          TabletServerErrorPB::CHANGES_UNAVAILABLE, context);
+    }
+  } else {
+    const int64_t min_index = reader->GetMinReplicateIndex();
+    after_index = min_index > 0 ? min_index - 1 : committed_op_id->index();
+  }
+
+  // Anchor the WAL before checking that the ops to read are in it, so that
+  // they can't be garbage collected concurrently.
+  if (req->has_subscriber_id()) {
+    s = server_->change_stream_manager()->AnchorLog(
+        *replica.get(), req->subscriber_id(), after_index + 1);
+    if (PREDICT_FALSE(!s.ok())) {
+      return SetupErrorAndRespond(resp->mutable_error(), s,
+                                  TabletServerErrorPB::UNKNOWN_ERROR, context);
+    }
+  }
+  vector<consensus::ReplicateMsg*> replicates;
+  ElementDeleter deleter(&replicates);
+  if (after_index < committed_op_id->index()) {
+    if (PREDICT_FALSE(after_index + 1 < reader->GetMinReplicateIndex())) {
+      return SetupErrorAndRespond(
+          resp->mutable_error(),
+          Status::NotFound(Substitute("op $0 is no longer in the WAL", after_index + 1)),
+          TabletServerErrorPB::CHANGES_UNAVAILABLE, context);
+    }
+    // A different op at the position means the subscriber's position isn't
+    // one of this tablet's committed ops.
+    if (req->has_after_op_id() && after_index >= reader->GetMinReplicateIndex()) {
+      OpId after_op_id;
+      s = reader->LookupOpId(after_index, &after_op_id);
+      if (PREDICT_TRUE(s.ok()) && after_op_id.term() != req->after_op_id().term()) {
+        s = Status::InvalidArgument(Substitute("op $0 isn't committed",
+                                               OpIdToString(req->after_op_id())));
+      }
+      if (PREDICT_FALSE(!s.ok())) {
+        return SetupErrorAndRespond(resp->mutable_error(), s,
+                                    TabletServerErrorPB::CHANGES_UNAVAILABLE, context);
+      }
+    }
+    s = reader->ReadReplicatesInRange(after_index + 1, committed_op_id->index(),
+                                      req->max_bytes(), &replicates);
+    if (PREDICT_FALSE(!s.ok())) {
+      return SetupErrorAndRespond(resp->mutable_error(), s,
+                                  s.IsNotFound() ? TabletServerErrorPB::CHANGES_UNAVAILABLE
+                                                 : TabletServerErrorPB::UNKNOWN_ERROR,
+                                  context);
+    }
+  }
+  // Which row operations failed when applied is only recorded in the COMMITs.
+  map<int64_t, unique_ptr<consensus::CommitMsg>> commits;
+  if (!replicates.empty()) {
+    s = reader->ReadCommitsInRange(replicates.front()->id().index(),
+                                   replicates.back()->id().index(), &commits);
+    if (PREDICT_FALSE(!s.ok())) {
+      return SetupErrorAndRespond(resp->mutable_error(), s,
+                                  s.IsNotFound() ? TabletServerErrorPB::CHANGES_UNAVAILABLE
+                                                 : TabletServerErrorPB::UNKNOWN_ERROR,
+                                  context);
+    }
+  }
+  TRACE("Read $0 ops and $1 of their COMMITs from the WAL", replicates.size(), commits.size());
+
+  ChangeEncoder encoder(&tablet_schema, &projection,
+                        req->lower_bound_primary_key(),
+                        req->exclusive_upper_bound_primary_key());
+  const consensus::ReplicateMsg* last_replicate = nullptr;
+  for (const auto* replicate : replicates) {
+    if (replicate->op_type() != consensus::WRITE_OP ||
+        replicate->write_request().has_txn_id()) {
+      last_replicate = replicate;
+      continue;
+    }
+    // The op is committed, but its COMMIT isn't in the WAL yet: read it and
+    // the following ops next time.
+    const auto* commit = FindPointeeOrNull(commits, replicate->id().index());
+    if (!commit) {
+      break;
+    }
+    last_replicate = replicate;
+    auto* change = resp->add_changes();
+    s = encoder.EncodeChanges(*replicate, commit->result(), change->mutable_row_operations());
+    if (PREDICT_FALSE(!s.ok())) {
+      resp->clear_changes();
+      return SetupErrorAndRespond(resp->mutable_error(), s,
+                                  TabletServerErrorPB::MISMATCHED_SCHEMA, context);
+    }
+    if (change->row_operations().rows().empty()) {
+      resp->mutable_changes()->RemoveLast();
+      continue;
+    }
+    *change->mutable_op_id() = replicate->id();
+    change->set_timestamp(replicate->timestamp());
+  }
+
+  if (last_replicate) {
+    *resp->mutable_last_op_id() = last_replicate->id();
+  } else if (req->has_after_op_id()) {
+    *resp->mutable_last_op_id() = req->after_op_id();
+  } else if (replicates.empty()) {
+    *resp->mutable_last_op_id() = *committed_op_id;
+  }
+  const int64_t last_index =
+      resp->has_last_op_id() ? resp->last_op_id().index() : after_index;
+  resp->set_has_more(last_index < committed_op_id->index());
+  if (req->has_subscriber_id()) {
+    WARN_NOT_OK(server_->change_stream_manager()->AnchorLog(
+                    *replica.get(), req->subscriber_id(), last_index + 1),
+                "could not update the WAL anchor of a change stream subscriber");
+  }
+  CHECK_OK(SchemaToPB(projection, resp->mutable_schema()));
+  context->RespondSuccess();
+}
+
 void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
                                  ChecksumResponsePB* resp,
                                  RpcContext* context) {
@@ -2507,7 +3965,7 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
 
     string scanner_id;
     Timestamp snap_timestamp;
-    Status s = HandleNewScanRequest(replica.get(), &scan_req, context,
+    Status s = HandleNewScanRequest(replica.get(), &scan_req, context, nullptr, {},
                                     &collector, &scanner_id, &snap_timestamp, &has_more,
                                     &error_code);
     if (PREDICT_FALSE(!s.ok())) {
@@ -2522,7 +3980,9 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     const ContinueChecksumRequestPB& continue_req = req->continue_request();
     collector.set_agg_checksum(continue_req.previous_checksum());
     scan_req.set_scanner_id(continue_req.scanner_id());
-    Status s = HandleContinueScanRequest(&scan_req, context, &collector, &has_more, &error_code);
+    bool parked = false;
+    Status s = HandleContinueScanRequest(&scan_req, context, nullptr, &collector, &has_more,
+                                         &error_code, &parked);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -2548,6 +4008,17 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
     case TabletServerFeatures::QUIESCING:
     case TabletServerFeatures::BLOOM_FILTER_PREDICATE_V2:
     case TabletServerFeatures::COLUMNAR_LAYOUT_FEATURE:
+    case TabletServerFeatures::AGGREGATE_PUSHDOWN:
+    case TabletServerFeatures::MULTI_WRITE:
+    case TabletServerFeatures::COLUMNAR_WRITES:
+    case TabletServerFeatures::SCAN_DATA_VERSION:
+    case TabletServerFeatures::RUNTIME_FILTERS:
+    case TabletServerFeatures::MULTI_GET:
+    case TabletServerFeatures::TOP_N_PUSHDOWN:
+    case TabletServerFeatures::EXPRESSION_PREDICATES:
+    case TabletServerFeatures::COLUMNAR_DICTIONARY_ENCODING_FEATURE:
+    case TabletServerFeatures::GROUP_BY_PUSHDOWN:
+    case TabletServerFeatures::BLOCK_EXPORT:
       return true;
     default:
       return false;
@@ -2555,6 +4026,7 @@ bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
 }
 
 void TabletServiceImpl::Shutdown() {
+  scan_resume_pool_->Shutdown();
 }
 
 // Extract a void* pointer suitable for use in a ColumnRangePredicate from the
@@ -2681,6 +4153,34 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
   // Then any encoded key range predicates.
   RETURN_NOT_OK(DecodeEncodedKeyRange(scan_pb, tablet_schema, scanner, spec));
 
+  // Then the aggregates, if any.
+  for (const ColumnAggregatePB& agg_pb : scan_pb.aggregates()) {
+    boost::optional<ColumnAggregate> aggregate;
+    RETURN_NOT_OK(ColumnAggregateFromPB(tablet_schema, agg_pb, &aggregate));
+    spec->AddAggregate(std::move(*aggregate));
+  }
+  if (scan_pb.group_by_columns_size() > 0 && scan_pb.aggregates_size() == 0) {
+    return Status::InvalidArgument("group-by columns require aggregates");
+  }
+  for (const string& col_name : scan_pb.group_by_columns()) {
+    int32_t idx = tablet_schema.find_column(col_name);
+    if (idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("unknown group-by column", col_name);
+    }
+    spec->AddGroupByColumn(tablet_schema.column(idx));
+  }
+
+  // Then the expression predicates, which are evaluated after the column
+  // predicates.
+  for (const ColumnExpressionPB& expr_pb : scan_pb.expression_predicates()) {
+    shared_ptr<const ColumnExpression> expr;
+    RETURN_NOT_OK(ColumnExpressionFromPB(tablet_schema, expr_pb, &expr));
+    if (expr->type() != ColumnExpression::BOOL) {
+      return Status::InvalidArgument("expression predicate must be boolean", expr->ToString());
+    }
+    spec->AddExpressionPredicate(std::move(expr));
+  }
+
   // If the scanner has a limit, set it now.
   if (scan_pb.has_limit()) {
     spec->set_limit(scan_pb.limit());
@@ -2690,6 +4190,60 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
 }
 
 namespace {
+// Returns true if the scan only counts rows and can be answered from the live
+// row counts of the tablet's rowsets instead of by scanning them.
+//
+// The live row counts reflect all applied operations, which matches the
+// semantics of a READ_LATEST scan but not those of a snapshot scan. They also
+// can't account for predicates, primary key bounds or limits. Even then, the
+// tablet may refuse to count its rows: see Tablet::CountLiveRowsForScan().
+bool CanCountRowsFromMetadata(const NewScanRequestPB& scan_pb,
+                              const ScanSpec& spec,
+                              const Tablet& tablet) {
+  if (!FLAGS_scanner_count_rows_from_metadata ||
+      scan_pb.read_mode() != READ_LATEST ||
+      scan_pb.has_snap_start_timestamp() ||
+      !spec.has_aggregates() ||
+      !spec.group_by_columns().empty() ||
+      !spec.predicates().empty() ||
+      !spec.expression_predicates().empty() ||
+      spec.lower_bound_key() != nullptr ||
+      spec.exclusive_upper_bound_key() != nullptr ||
+      spec.has_limit() ||
+      !tablet.metadata()->supports_live_row_count()) {
+    return false;
+  }
+  return std::all_of(spec.aggregates().begin(), spec.aggregates().end(),
+                     [](const ColumnAggregate& aggregate) {
+                       return aggregate.type() == ColumnAggregatePB::COUNT &&
+                           !aggregate.column();
+                     });
+}
+
+// Checks that the order of a top-N scan can be honored with the rest of 'scan_pb'.
+Status ValidateTopNScan(const NewScanRequestPB& scan_pb, const Schema& tablet_schema) {
+  DCHECK(scan_pb.has_order_by());
+  if (!scan_pb.has_limit()) {
+    return Status::InvalidArgument("ordered top-N scans must have a limit");
+  }
+  if (scan_pb.limit() > FLAGS_scanner_max_top_n_limit) {
+    return Status::InvalidArgument(Substitute(
+        "limit $0 of top-N scan exceeds the maximum of $1",
+        scan_pb.limit(), FLAGS_scanner_max_top_n_limit));
+  }
+  if (scan_pb.order_mode() == ORDERED) {
+    return Status::InvalidArgument("top-N scans cannot be ordered by primary key");
+  }
+  if (scan_pb.aggregates_size() > 0) {
+    return Status::InvalidArgument("top-N scans cannot have aggregates");
+  }
+  if (tablet_schema.find_column(scan_pb.order_by().column_name()) == Schema::kColumnNotFound) {
+    return Status::InvalidArgument("no such column to order the scan by",
+                                   scan_pb.order_by().column_name());
+  }
+  return Status::OK();
+}
+
 // Checks if 'timestamp' is before the tablet's AHM if this is a
 // READ_AT_SNAPSHOT/READ_YOUR_WRITES scan. Returns Status::OK() if it's
 // not or Status::InvalidArgument() if it is.
@@ -2733,17 +4287,30 @@ Status VerifyLegalSnapshotTimestamps(Tablet* tablet, ReadMode read_mode,
   }
   return Status::OK();
 }
+
+// With --scanner_parallel_scan_threads, has the rowsets of unordered scans be
+// read on the pool of 'manager'.
+void SetParallelScanOptions(ScannerManager* manager, tablet::RowIteratorOptions* opts) {
+  const int num_threads = FLAGS_scanner_parallel_scan_threads;
+  if (num_threads > 1 && opts->order == UNORDERED && manager->parallel_scan_pool()) {
+    opts->parallel_scan_pool = manager->parallel_scan_pool();
+    opts->parallel_scan_threads = num_threads;
+  }
+}
 } // anonymous namespace
 
 // Start a new scan.
-Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
-                                               const ScanRequestPB* req,
-                                               const RpcContext* rpc_context,
-                                               ScanResultCollector* result_collector,
-                                               string* scanner_id,
-                                               Timestamp* snap_timestamp,
-                                               bool* has_more_results,
-                                               TabletServerErrorPB::Code* error_code) {
+Status TabletServiceImpl::HandleNewScanRequest(
+    TabletReplica* replica,
+    const ScanRequestPB* req,
+    const RpcContext* rpc_context,
+    const ResumedScan* resumed,
+    const std::function<bool(const ResumedScan&)>& suspend,
+    ScanResultCollector* result_collector,
+    string* scanner_id,
+    Timestamp* snap_timestamp,
+    bool* has_more_results,
+    TabletServerErrorPB::Code* error_code) {
   DCHECK(result_collector != nullptr);
   DCHECK(error_code != nullptr);
   DCHECK(req->has_new_scan_request());
@@ -2751,6 +4318,12 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleNewScanRequest",
                "tablet_id", scan_pb.tablet_id());
 
+  // A witness replica stores no tablet data, so there's nothing to scan.
+  if (PREDICT_FALSE(replica->IsWitness())) {
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return Status::IllegalState("witness replicas can't serve scans");
+  }
+
   SharedScanner scanner;
   server_->scanner_manager()->NewScanner(replica,
                                          rpc_context->remote_user(),
@@ -2795,6 +4368,14 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   const SchemaPtr tablet_schema_ptr = replica->tablet_metadata()->schema();
   const Schema& tablet_schema = *tablet_schema_ptr;
 
+  if (scan_pb.has_order_by()) {
+    s = ValidateTopNScan(scan_pb, tablet_schema);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
   ScanSpec spec;
   s = SetupScanSpec(scan_pb, tablet_schema, scanner, &spec);
   if (PREDICT_FALSE(!s.ok())) {
@@ -2802,6 +4383,17 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
+  // Hide the rows which have expired according to the table's TTL, even if
+  // they haven't been garbage-collected yet.
+  int ttl_col_idx;
+  int64_t ttl_cutoff_micros;
+  if (replica->tablet_metadata()->GetTtlCutoff(tablet_schema, GetCurrentTimeMicros(),
+                                               &ttl_col_idx, &ttl_cutoff_micros)) {
+    const int64_t* lower = scanner->arena()->NewObject<int64_t>(ttl_cutoff_micros);
+    spec.AddPredicate(ColumnPredicate::Range(tablet_schema.column(ttl_col_idx),
+                                             lower, nullptr));
+  }
+
   VLOG(3) << "Before optimizing scan spec: " << spec.ToString(tablet_schema);
   spec.PruneInlistValuesIfPossible(tablet_schema,
                                    replica->tablet_metadata()->partition(),
@@ -2816,6 +4408,14 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   // NOTE: We should build the missing column after optimizing scan which will
   // remove unnecessary predicates.
   vector<ColumnSchema> missing_cols = spec.GetMissingColumns(projection);
+  if (scan_pb.has_order_by()) {
+    const string& order_col_name = scan_pb.order_by().column_name();
+    if (projection.find_column(order_col_name) == Schema::kColumnNotFound &&
+        std::none_of(missing_cols.begin(), missing_cols.end(),
+                     [&](const ColumnSchema& col) { return col.name() == order_col_name; })) {
+      missing_cols.push_back(tablet_schema.column(tablet_schema.find_column(order_col_name)));
+    }
+  }
 
   // Build a new projection with the projection columns and the missing columns,
   // annotating each column as a key column appropriately.
@@ -2863,8 +4463,10 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
   VLOG(3) << "Scan projection: " << projection.ToString(Schema::BASE_INFO);
 
   s = result_collector->InitSerializer(scan_pb.row_format_flags(),
+                                       spec,
                                        projection,
-                                       *client_projection);
+                                       *client_projection,
+                                       tablet_schema);
   if (!s.ok()) {
     *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
     return s;
@@ -2892,6 +4494,18 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     return s;
   }
 
+  if (CanCountRowsFromMetadata(scan_pb, spec, *tablet)) {
+    uint64_t live_row_count;
+    s = tablet->CountLiveRowsForScan(&live_row_count);
+    if (s.ok() && result_collector->HandleRowCount(live_row_count)) {
+      TRACE("Counted $0 rows from tablet metadata", live_row_count);
+      *has_more_results = false;
+      return Status::OK();
+    }
+    VLOG(1) << Substitute("Could not count rows of tablet $0 from metadata: $1",
+                          tablet->tablet_id(), s.ToString());
+  }
+
   unique_ptr<RowwiseIterator> iter;
   boost::optional<Timestamp> snap_start_timestamp;
 
@@ -2910,17 +4524,31 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
           return Status::InvalidArgument("scan start timestamp is only supported "
                                          "in READ_AT_SNAPSHOT read mode");
         }
-        s = tablet->NewRowIterator(projection, &iter);
+        tablet::RowIteratorOptions opts;
+        opts.projection = &projection;
+        opts.snap_to_include = MvccSnapshot(*tablet->mvcc_manager());
+        SetParallelScanOptions(server_->scanner_manager(), &opts);
+        s = tablet->NewRowIterator(std::move(opts), &iter);
         break;
       }
       case READ_YOUR_WRITES: // Fallthrough intended
       case READ_AT_SNAPSHOT: {
         s = HandleScanAtSnapshot(
             scan_pb, rpc_context, projection, tablet.get(), replica->time_manager(),
-            &iter, &snap_start_timestamp, snap_timestamp, error_code);
+            resumed, suspend, &iter, &snap_start_timestamp, snap_timestamp, error_code);
         break;
       }
     }
+    if (suspend && s.IsIncomplete()) {
+      // The scan has been suspended until its snapshot timestamp is safe.
+      return s;
+    }
+    if (s.ok() && scan_pb.has_order_by()) {
+      iter = NewTopNIterator(TopNIteratorOptions(scan_pb.order_by().column_name(),
+                                                 scan_pb.order_by().descending(),
+                                                 scan_pb.limit()),
+                             std::move(iter));
+    }
     TRACE("Iterator created");
   }
 
@@ -3012,8 +4640,9 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
     ScanRequestPB continue_req(*req);
     continue_req.set_scanner_id(scanner->id());
     scanner_lock.Unlock();
-    RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, rpc_context, result_collector,
-                                            has_more_results, error_code));
+    bool parked = false;
+    RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, rpc_context, nullptr, result_collector,
+                                            has_more_results, error_code, &parked));
   } else {
     // Increment the scanner call sequence ID. HandleContinueScanRequest handles
     // this in the non-empty scan case.
@@ -3025,9 +4654,11 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletReplica* replica,
 // Continue an existing scan request.
 Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
                                                     const RpcContext* rpc_context,
+                                                    const std::function<void()>& resume,
                                                     ScanResultCollector* result_collector,
                                                     bool* has_more_results,
-                                                    TabletServerErrorPB::Code* error_code) {
+                                                    TabletServerErrorPB::Code* error_code,
+                                                    bool* parked) {
   DCHECK(req->has_scanner_id());
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleContinueScanRequest",
                "scanner_id", req->scanner_id());
@@ -3050,6 +4681,16 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     *error_code = code;
     return s;
   }
+  // The rows read ahead so far are enough to go on with: don't wait for more.
+  scanner->CancelReadAhead();
+  // The continuation parked by an earlier call, if it's next. It's resumed
+  // once the scanner is released.
+  std::function<void()> next_continuation;
+  SCOPED_CLEANUP({
+    if (next_continuation) {
+      next_continuation();
+    }
+  });
   // TODO(todd) consider TryLockForAccess and return ServiceUnavailable in the case that
   // another thread is already using the scanner? This should be rare in real
   // circumstances -- only relevant when a client performs some retries on timeout.
@@ -3073,6 +4714,16 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     return Status::OK();
   }
 
+  if (resume && req->call_seq_id() > scanner->call_seq_id() &&
+      req->call_seq_id() - scanner->call_seq_id() <=
+          static_cast<uint32_t>(FLAGS_scanner_max_pipelined_continuations) &&
+      scanner->ParkContinuation(req->call_seq_id(), resume)) {
+    // The scanner stays registered for the calls before this one.
+    unreg_scanner.Cancel();
+    *parked = true;
+    TRACE("Waiting for call $0 of scanner $1", scanner->call_seq_id(), scanner->id());
+    return Status::Incomplete("scan continuation arrived ahead of its turn");
+  }
   if (req->call_seq_id() != scanner->call_seq_id()) {
     *error_code = TabletServerErrorPB::INVALID_SCAN_CALL_SEQ_ID;
     if (!FLAGS_scanner_unregister_on_invalid_seq_id) {
@@ -3081,36 +4732,85 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     return Status::InvalidArgument("Invalid call sequence ID in scan request");
   }
   scanner->IncrementCallSeqId();
+  next_continuation = scanner->TakeParkedContinuation();
 
   RowwiseIterator* iter = scanner->iter();
 
   // Set the row format flags on the ScanResultCollector.
+  const SchemaPtr tablet_schema = scanner->tablet_replica()->tablet_metadata()->schema();
   s = result_collector->InitSerializer(scanner->row_format_flags(),
+                                       scanner->spec(),
                                        iter->schema(),
-                                       *scanner->client_projection_schema());
+                                       *scanner->client_projection_schema(),
+                                       *tablet_schema);
   if (!s.ok()) {
     *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
     return s;
   }
 
+  if (req->runtime_filters_size() > 0) {
+    s = scanner->AddRuntimeFilters(req->runtime_filters());
+    if (!s.ok()) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+    TRACE("Added $0 runtime filters", req->runtime_filters_size());
+  }
+
+  const MonoTime batch_start = MonoTime::Now();
+  if (FLAGS_scanner_adaptive_batch_sizing) {
+    size_t min_bytes;
+    size_t max_bytes;
+    GetBatchSizeBoundsBytes(req, &min_bytes, &max_bytes);
+    batch_size_bytes = server_->scanner_manager()->PickBatchSize(
+        scanner.get(), batch_size_bytes, min_bytes, max_bytes,
+        scanner->client_projection_schema()->byte_size(), batch_start);
+    TRACE("Picked a batch size of $0 bytes", batch_size_bytes);
+  }
+  // The memory of the batch is accounted to the server's scan batches while
+  // it's being built.
+  ScopedTrackedConsumption batch_consumption(
+      server_->scanner_manager()->batch_mem_tracker(), 0);
+
   // TODO(todd): could size the RowBlock based on the user's requested batch size?
   // If people had really large indirect objects, we would currently overshoot
   // their requested batch size by a lot.
-  RowBlockMemory mem(32 * 1024);
-  RowBlock block(&iter->schema(), FLAGS_scanner_batch_size_rows, &mem);
+  unique_ptr<RowBlockMemory> mem;
+  unique_ptr<RowBlock> local_block;
+  RowBlock* read_block;
+  if (FLAGS_scanner_reuse_row_blocks) {
+    read_block = scanner->row_block(FLAGS_scanner_batch_size_rows);
+  } else {
+    mem.reset(new RowBlockMemory(32 * 1024));
+    local_block.reset(new RowBlock(&iter->schema(), FLAGS_scanner_batch_size_rows, mem.get()));
+    read_block = local_block.get();
+  }
+  // The rows are serialized into the response by the time this call returns:
+  // don't hold on to their memory while the scanner is idle.
+  SCOPED_CLEANUP({
+    scanner->ResetRowBlockMemory();
+  });
 
   // TODO(todd): in the future, use the client timeout to set a budget. For now,
   // just use a half second, which should be plenty to amortize call overhead.
   int budget_ms = 500;
   MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
+  const bool abort_past_client_deadline = FLAGS_abort_work_past_client_deadline;
+  const MonoTime client_deadline = rpc_context->GetClientDeadline();
+  if (abort_past_client_deadline) {
+    // Respond early enough for the batch to reach the client in time.
+    deadline = std::min(deadline, client_deadline - MonoDelta::FromMilliseconds(10));
+  }
 
   int64_t rows_scanned = 0;
-  while (iter->HasNext() && !scanner->has_fulfilled_limit()) {
+  while (scanner->HasNext() && !scanner->has_fulfilled_limit()) {
     if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
     }
 
-    Status s = iter->NextBlock(&block);
+    // The rows are read into 'read_block', unless they were read ahead.
+    RowBlock* block;
+    Status s = scanner->NextBlock(read_block, &block);
     if (PREDICT_FALSE(!s.ok())) {
       LOG(WARNING) << "Copying rows from internal iterator for request "
                    << SecureShortDebugString(*req);
@@ -3118,28 +4818,43 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       return s;
     }
 
-    if (PREDICT_TRUE(block.nrows() > 0)) {
+    if (PREDICT_TRUE(block->nrows() > 0)) {
       // Count the number of rows scanned, regardless of predicates or deletions.
       // The collector will separately count the number of rows actually returned to
       // the client.
-      rows_scanned += block.nrows();
+      rows_scanned += block->nrows();
+      scanner->ApplyRuntimeFilters(block);
       if (scanner->spec().has_limit()) {
         int64_t rows_left = scanner->spec().limit() - scanner->num_rows_returned();
         DCHECK_GT(rows_left, 0);  // Guaranteed by has_fulfilled_limit()
-        block.selection_vector()->ClearToSelectAtMost(static_cast<size_t>(rows_left));
+        block->selection_vector()->ClearToSelectAtMost(static_cast<size_t>(rows_left));
       }
-      result_collector->HandleRowBlock(scanner.get(), block);
+      TRACE_COUNTER_SCOPE_LATENCY_US(SCAN_SERIALIZE_US_METRIC_NAME);
+      result_collector->HandleRowBlock(scanner.get(), *block);
     }
 
     int64_t response_size = result_collector->ResponseSize();
+    batch_consumption.Reset(response_size);
 
     if (VLOG_IS_ON(2)) {
       // This may be fairly expensive if row block size is small
-      TRACE("Copied block (nrows=$0), new size=$1", block.nrows(), response_size);
+      TRACE("Copied block (nrows=$0), new size=$1", block->nrows(), response_size);
     }
 
     // TODO: should check if RPC got cancelled, once we implement RPC cancellation.
-    if (PREDICT_FALSE(MonoTime::Now() >= deadline)) {
+    const MonoTime now = MonoTime::Now();
+    if (PREDICT_FALSE(abort_past_client_deadline && now >= client_deadline)) {
+      // The response would arrive too late for the client: stop reading, and
+      // drop the scanner, which the client can no longer continue.
+      TRACE("Client deadline expired - aborting scan");
+      shared_ptr<Tablet> tablet = scanner->tablet_replica()->shared_tablet();
+      if (tablet) {
+        tablet->metrics()->scans_aborted_past_deadline->Increment();
+      }
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return Status::TimedOut("client deadline passed while reading the scan's data");
+    }
+    if (PREDICT_FALSE(now >= deadline)) {
       TRACE("Deadline expired - responding early");
       break;
     }
@@ -3148,6 +4863,7 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
       break;
     }
   }
+  scanner->RecordBatch(batch_size_bytes, batch_start, MonoTime::Now());
 
   scoped_refptr<TabletReplica> replica = scanner->tablet_replica();
   shared_ptr<Tablet> tablet;
@@ -3187,10 +4903,17 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
     tablet->UpdateLastReadTime();
   }
 
-  *has_more_results = !req->close_scanner() && iter->HasNext() &&
+  if (req->return_profile()) {
+    // Account this request to the profile first.
+    scanner_timer.Stop();
+    scanner->GetProfile(result_collector->mutable_profile());
+  }
+
+  *has_more_results = !req->close_scanner() && scanner->HasNext() &&
       !scanner->has_fulfilled_limit();
   if (*has_more_results) {
     unreg_scanner.Cancel();
+    server_->scanner_manager()->StartReadAhead(scanner);
   } else {
     VLOG(2) << "Scanner " << scanner->id() << " complete: removing...";
   }
@@ -3216,6 +4939,9 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                                                const Schema& projection,
                                                Tablet* tablet,
                                                TimeManager* time_manager,
+                                               const ResumedScan* resumed,
+                                               const std::function<bool(const ResumedScan&)>&
+                                                   suspend,
                                                unique_ptr<RowwiseIterator>* iter,
                                                boost::optional<Timestamp>* snap_start_timestamp,
                                                Timestamp* snap_timestamp,
@@ -3246,34 +4972,51 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
     }
   }
 
-  // Based on the read mode, pick a timestamp and verify it.
-  Timestamp tmp_snap_timestamp;
-  Status s = PickAndVerifyTimestamp(scan_pb, tablet, &tmp_snap_timestamp);
-  if (PREDICT_FALSE(!s.ok())) {
-    *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
-    return s.CloneAndPrepend("cannot verify timestamp");
-  }
-
   // Reduce the client's deadline by a few msecs to allow for overhead.
   const MonoTime client_deadline =
       rpc_context->GetClientDeadline() - MonoDelta::FromMilliseconds(10);
 
-  // Its not good for the tablet server or for the client if we hang here forever. The tablet
-  // server will have one less available thread and the client might be stuck spending all
-  // of the allotted time for the scan on a partitioned server that will never have a consistent
-  // snapshot at 'snap_timestamp'.
-  // Because of this we clamp the client's deadline to the maximum configured
-  // scanner wait time. If the client sets a longer timeout then it can use it
-  // by retrying (possibly on other servers).
+  Timestamp tmp_snap_timestamp;
   bool was_clamped = false;
-  MonoTime final_deadline = ClampScanDeadlineForWait(client_deadline, &was_clamped);
+  MonoTime final_deadline;
+  MonoTime before;
+  Status s;
+  if (resumed) {
+    // A resumed scan keeps the timestamp and the wait deadline picked initially.
+    tmp_snap_timestamp = resumed->snap_timestamp;
+    was_clamped = resumed->wait_deadline_clamped;
+    final_deadline = resumed->wait_deadline;
+    before = resumed->wait_start;
+  } else {
+    // Based on the read mode, pick a timestamp and verify it.
+    s = PickAndVerifyTimestamp(scan_pb, tablet, time_manager, &tmp_snap_timestamp);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
+      return s.CloneAndPrepend("cannot verify timestamp");
+    }
+
+    // Its not good for the tablet server or for the client if we hang here forever. The tablet
+    // server will have one less available thread and the client might be stuck spending all
+    // of the allotted time for the scan on a partitioned server that will never have a
+    // consistent snapshot at 'snap_timestamp'.
+    // Because of this we clamp the client's deadline to the maximum configured
+    // scanner wait time. If the client sets a longer timeout then it can use it
+    // by retrying (possibly on other servers).
+    final_deadline = ClampScanDeadlineForWait(client_deadline, &was_clamped);
+    before = MonoTime::Now();
+
+    // Rather than blocking this thread until safe time catches up, the scan
+    // may be suspended and resumed later at the same timestamp.
+    if (suspend && suspend({ tmp_snap_timestamp, before, final_deadline, was_clamped })) {
+      return Status::Incomplete("scan suspended until the snapshot timestamp is safe");
+    }
+  }
 
   // Wait for the tablet to know that 'snap_timestamp' is safe. I.e. that all operations
   // that came before it are, at least, started. This, together with waiting for the mvcc
   // snapshot to be clean below, allows us to always return the same data when scanning at
   // the same timestamp (repeatable reads).
   TRACE("Waiting safe time to advance");
-  const MonoTime before = MonoTime::Now();
   s = time_manager->WaitUntilSafe(tmp_snap_timestamp, final_deadline);
 
   MvccSnapshot snap;
@@ -3295,12 +5038,14 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
 
   const auto duration_usec = (MonoTime::Now() - before).ToMicroseconds();
   tablet->metrics()->snapshot_read_inflight_wait_duration->Increment(duration_usec);
+  TRACE_COUNTER_INCREMENT(SCAN_SAFE_TIME_WAIT_US_METRIC_NAME, duration_usec);
   TRACE("All operations in snapshot committed. Waited for $0 microseconds", duration_usec);
 
   tablet::RowIteratorOptions opts;
   opts.projection = &projection;
   opts.snap_to_include = snap;
   opts.order = scan_pb.order_mode();
+  SetParallelScanOptions(server_->scanner_manager(), &opts);
 
   boost::optional<Timestamp> tmp_snap_start_timestamp;
   if (scan_pb.has_snap_start_timestamp()) {
@@ -3353,6 +5098,7 @@ Status TabletServiceImpl::ValidateTimestamp(const Timestamp& snap_timestamp) {
 
 Status TabletServiceImpl::PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb,
                                                  Tablet* tablet,
+                                                 TimeManager* time_manager,
                                                  Timestamp* snap_timestamp) {
   // If the client sent a timestamp update our clock with it.
   if (scan_pb.has_propagated_timestamp()) {
@@ -3371,11 +5117,24 @@ Status TabletServiceImpl::PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb
   if (read_mode == READ_AT_SNAPSHOT) {
     // For READ_AT_SNAPSHOT mode,
     //   1) if the client provided no snapshot timestamp we take the current
-    //      clock time as the snapshot timestamp.
+    //      clock time as the snapshot timestamp, unless the replica can serve
+    //      the latest data at its safe time without waiting (see
+    //      TimeManager::GetTimestampForLatestRead()) and that is not before
+    //      the propagated timestamp.
     //   2) else we use the client provided one, but make sure it is not too
     //      far in the future as to be invalid.
     if (!scan_pb.has_snap_timestamp()) {
-      tmp_snap_timestamp = server_->clock()->Now();
+      const MonoDelta max_staleness = FLAGS_scanner_max_follower_staleness_ms > 0
+          ? MonoDelta::FromMilliseconds(FLAGS_scanner_max_follower_staleness_ms)
+          : MonoDelta();
+      Timestamp latest_read_timestamp;
+      if (time_manager->GetTimestampForLatestRead(max_staleness, &latest_read_timestamp) &&
+          (!scan_pb.has_propagated_timestamp() ||
+           latest_read_timestamp.value() > scan_pb.propagated_timestamp())) {
+        tmp_snap_timestamp = latest_read_timestamp;
+      } else {
+        tmp_snap_timestamp = server_->clock()->Now();
+      }
     } else {
       tmp_snap_timestamp.FromUint64(scan_pb.snap_timestamp());
       RETURN_NOT_OK(ValidateTimestamp(tmp_snap_timestamp));
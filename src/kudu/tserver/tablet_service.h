@@ -17,9 +17,11 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
+#include "kudu/common/timestamp.h"
 #include "kudu/consensus/consensus.service.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/ref_counted.h"
@@ -27,6 +29,7 @@
 #include "kudu/tserver/tserver_admin.service.h"
 #include "kudu/tserver/tserver_service.service.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/random.h"
 
 namespace boost {
@@ -44,7 +47,7 @@ namespace kudu {
 class RowwiseIterator;
 class Schema;
 class Status;
-class Timestamp;
+class ThreadPool;
 
 namespace server {
 class ServerBase;
@@ -56,6 +59,11 @@ class ChangeConfigRequestPB;
 class ChangeConfigResponsePB;
 class ConsensusRequestPB;
 class ConsensusResponsePB;
+class MultiConsensusRequestPB;
+class MultiConsensusResponsePB;
+class MultiVoteRequestPB;
+class MultiVoteResponsePB;
+class RaftConsensus;
 class GetConsensusStateRequestPB;
 class GetConsensusStateResponsePB;
 class GetLastOpIdRequestPB;
@@ -76,12 +84,15 @@ class VoteResponsePB;
 } // namespace consensus
 
 namespace rpc {
+class RequestIdPB;
 class RpcContext;
 } // namespace rpc
 
 namespace tablet {
 class Tablet;
 class TabletReplica;
+class WriteOpState;
+struct WriteAuthorizationContext;
 } // namespace tablet
 
 namespace tserver {
@@ -90,12 +101,22 @@ class AlterSchemaRequestPB;
 class AlterSchemaResponsePB;
 class ChecksumRequestPB;
 class ChecksumResponsePB;
+class GetChangesRequestPB;
+class GetChangesResponsePB;
 class CoordinateTransactionRequestPB;
 class CoordinateTransactionResponsePB;
 class CreateTabletRequestPB;
 class CreateTabletResponsePB;
 class DeleteTabletRequestPB;
 class DeleteTabletResponsePB;
+class ExportBlocksRequestPB;
+class ExportBlocksResponsePB;
+class MultiGetRequestPB;
+class MultiGetResponsePB;
+class MultiWriteRequestPB;
+class MultiWriteResponsePB;
+class ParticipantBatchRequestPB;
+class ParticipantBatchResponsePB;
 class ParticipantRequestPB;
 class ParticipantResponsePB;
 class QuiesceTabletServerRequestPB;
@@ -132,6 +153,15 @@ class TabletServiceImpl : public TabletServerServiceIf {
   void Write(const WriteRequestPB* req, WriteResponsePB* resp,
              rpc::RpcContext* context) override;
 
+  void MultiWrite(const MultiWriteRequestPB* req, MultiWriteResponsePB* resp,
+                  rpc::RpcContext* context) override;
+
+  void MultiGet(const MultiGetRequestPB* req, MultiGetResponsePB* resp,
+                rpc::RpcContext* context) override;
+
+  void ExportBlocks(const ExportBlocksRequestPB* req, ExportBlocksResponsePB* resp,
+                    rpc::RpcContext* context) override;
+
   void Scan(const ScanRequestPB* req,
             ScanResponsePB* resp,
             rpc::RpcContext* context) override;
@@ -148,6 +178,10 @@ class TabletServiceImpl : public TabletServerServiceIf {
                      SplitKeyRangeResponsePB* resp,
                      rpc::RpcContext* context) override;
 
+  void GetChanges(const GetChangesRequestPB* req,
+                  GetChangesResponsePB* resp,
+                  rpc::RpcContext* context) override;
+
   void Checksum(const ChecksumRequestPB* req,
                 ChecksumResponsePB* resp,
                 rpc::RpcContext* context) override;
@@ -157,29 +191,98 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Checks the authz token of the write 'req' to 'replica', if access control
+  // is enforced, and sets 'authz_context' to the privileges it grants.
+  // Returns false, after responding to the RPC associated with 'context', if
+  // the write isn't authorized.
+  bool AuthorizeWriteOrRespond(const WriteRequestPB& req,
+                               const scoped_refptr<tablet::TabletReplica>& replica,
+                               rpc::RpcContext* context,
+                               boost::optional<tablet::WriteAuthorizationContext>* authz_context);
+
+  // Creates the op state for the write 'req' to 'replica', with its response
+  // in 'resp', unless the write must be rejected: because of throttling or
+  // memory pressure, for instance. In that case, returns the error and sets
+  // 'error_code' to its code.
+  Status NewWriteOpState(const WriteRequestPB* req,
+                         WriteResponsePB* resp,
+                         const scoped_refptr<tablet::TabletReplica>& replica,
+                         boost::optional<tablet::WriteAuthorizationContext> authz_context,
+                         const rpc::RequestIdPB* request_id,
+                         const std::string& username,
+                         std::unique_ptr<tablet::WriteOpState>* op_state,
+                         TabletServerErrorPB::Code* error_code);
+
+  // A new snapshot scan which waited for its snapshot timestamp to become safe
+  // without occupying a service thread: see SuspendScanUntilSafe().
+  struct ResumedScan {
+    // The snapshot timestamp picked when the scan was started.
+    Timestamp snap_timestamp;
+    // When the wait for 'snap_timestamp' started, and its deadline.
+    MonoTime wait_start;
+    MonoTime wait_deadline;
+    // Whether 'wait_deadline' is earlier than the client's deadline.
+    bool wait_deadline_clamped;
+  };
+
+  // Implementation of Scan(). If 'resumed' is set, the call is a new snapshot
+  // scan continuing after waiting for its snapshot timestamp to become safe.
+  void DoScan(const ScanRequestPB* req,
+              ScanResponsePB* resp,
+              rpc::RpcContext* context,
+              const ResumedScan* resumed);
+
+  // Arranges for the new scan 'req' to be resumed by DoScan() on
+  // 'scan_resume_pool_' once 'state.snap_timestamp' is safe according to the
+  // time manager of 'consensus', or once 'state.wait_deadline' has passed.
+  // Returns false if the scan should rather wait for safe time right away.
+  bool SuspendScanUntilSafe(std::shared_ptr<consensus::RaftConsensus> consensus,
+                            const ResumedScan& state,
+                            const ScanRequestPB* req,
+                            ScanResponsePB* resp,
+                            rpc::RpcContext* context);
+
+  // If 'suspend' is set, a new snapshot scan may be suspended after picking
+  // its timestamp (the function returning true), in which case
+  // Status::Incomplete is returned. See HandleScanAtSnapshot().
   Status HandleNewScanRequest(tablet::TabletReplica* tablet_replica,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
+                              const ResumedScan* resumed,
+                              const std::function<bool(const ResumedScan&)>& suspend,
                               ScanResultCollector* result_collector,
                               std::string* scanner_id,
                               Timestamp* snap_timestamp,
                               bool* has_more_results,
                               TabletServerErrorPB::Code* error_code);
 
+  // If 'resume' is set, a continuation which is ahead of its turn by at most
+  // --scanner_max_pipelined_continuations calls is parked on the scanner until
+  // the calls before it are done, in which case 'parked' is set, 'resume' is
+  // run once it's the continuation's turn, and Status::Incomplete is returned.
   Status HandleContinueScanRequest(const ScanRequestPB* req,
                                    const rpc::RpcContext* rpc_context,
+                                   const std::function<void()>& resume,
                                    ScanResultCollector* result_collector,
                                    bool* has_more_results,
-                                   TabletServerErrorPB::Code* error_code);
+                                   TabletServerErrorPB::Code* error_code,
+                                   bool* parked);
 
   // Handle READ_AT_SNAPSHOT and READ_YOUR_WRITES scans.
   // Returns the opened row iterator, the start timestamp of a snapshot scan,
   // if applicable, and the ending timestamp of a scan.
+  //
+  // A resumed scan uses the timestamp from 'resumed'. Otherwise, once the
+  // timestamp is picked, 'suspend' (if set) is given the chance to suspend the
+  // scan instead of waiting for safe time; if it does, Status::Incomplete is
+  // returned.
   Status HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                               const rpc::RpcContext* rpc_context,
                               const Schema& projection,
                               tablet::Tablet* tablet,
                               consensus::TimeManager* time_manager,
+                              const ResumedScan* resumed,
+                              const std::function<bool(const ResumedScan&)>& suspend,
                               std::unique_ptr<RowwiseIterator>* iter,
                               boost::optional<Timestamp>* snap_start_timestamp,
                               Timestamp* snap_timestamp,
@@ -194,6 +297,7 @@ class TabletServiceImpl : public TabletServerServiceIf {
   // timestamp is after the tablet's ancient history mark.
   Status PickAndVerifyTimestamp(const NewScanRequestPB& scan_pb,
                                 tablet::Tablet* tablet,
+                                consensus::TimeManager* time_manager,
                                 Timestamp* snap_timestamp);
 
   TabletServer* server_;
@@ -205,6 +309,10 @@ class TabletServiceImpl : public TabletServerServiceIf {
   // Counter to track number of rejected write requests while op apply queue
   // was overloaded.
   scoped_refptr<Counter> num_op_apply_queue_rejections_;
+
+  // Pool to run snapshot scans resumed after waiting for safe time without
+  // occupying a service thread. Shared with the callbacks resuming the scans.
+  std::shared_ptr<ThreadPool> scan_resume_pool_;
 };
 
 class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
@@ -239,6 +347,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                                 ParticipantResponsePB* resp,
                                 rpc::RpcContext* context) override;
 
+  void ParticipateInTransactionBatch(const ParticipantBatchRequestPB* req,
+                                     ParticipantBatchResponsePB* resp,
+                                     rpc::RpcContext* context) override;
+
   bool SupportsFeature(uint32_t feature) const override;
 
  private:
@@ -260,10 +372,20 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
                                consensus::ConsensusResponsePB* resp,
                                rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiUpdateConsensus(const consensus::MultiConsensusRequestPB* req,
+                                    consensus::MultiConsensusResponsePB* resp,
+                                    rpc::RpcContext* context) OVERRIDE;
+
+  bool SupportsFeature(uint32_t feature) const override;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
 
+  virtual void MultiRequestConsensusVote(const consensus::MultiVoteRequestPB* req,
+                                         consensus::MultiVoteResponsePB* resp,
+                                         rpc::RpcContext* context) OVERRIDE;
+
   virtual void ChangeConfig(const consensus::ChangeConfigRequestPB* req,
                             consensus::ChangeConfigResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
@@ -17,10 +17,12 @@
 
 #include "kudu/tserver/ts_tablet_manager.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <ostream>
 #include <set>
 #include <string>
@@ -37,6 +39,7 @@
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/consensus_meta_manager.h"
+#include "kudu/consensus/election_coordinator.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/metadata.pb.h"
@@ -87,6 +90,15 @@ DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
+DEFINE_bool(tablet_open_prioritize_likely_leaders, true,
+            "Whether to open the tablet replicas on startup in the order they're "
+            "likely to be needed: first the replicas which are the only voter of "
+            "their tablet, then the replicas which voted for themselves in the "
+            "latest term they know of, then the other voters, and non-voters last. "
+            "If false, the replicas are opened in the order they're found on disk.");
+TAG_FLAG(tablet_open_prioritize_likely_leaders, advanced);
+TAG_FLAG(tablet_open_prioritize_likely_leaders, runtime);
+
 DEFINE_int32(num_tablets_to_delete_simultaneously, 0,
              "Number of threads available to delete tablets. If this is set to 0 (the "
              "default), then the number of delete threads will be set based on the number "
@@ -184,12 +196,30 @@ DEFINE_int32(txn_participant_registration_inject_latency_ms, 0,
 TAG_FLAG(txn_participant_registration_inject_latency_ms, runtime);
 TAG_FLAG(txn_participant_registration_inject_latency_ms, unsafe);
 
+DEFINE_bool(flush_tablets_before_shutdown, false,
+            "Whether a quiescing tablet server flushes the in-memory stores of "
+            "its tablets when it is shut down, so that they don't have to replay "
+            "their logs when the server restarts. Tablets are flushed in "
+            "parallel, using the threads that open tablets at startup.");
+TAG_FLAG(flush_tablets_before_shutdown, advanced);
+TAG_FLAG(flush_tablets_before_shutdown, experimental);
+TAG_FLAG(flush_tablets_before_shutdown, runtime);
+
+DEFINE_int32(flush_tablets_before_shutdown_timeout_ms, 60 * 1000,
+             "With --flush_tablets_before_shutdown, the amount of time after which "
+             "the tablets that haven't started flushing yet are shut down without "
+             "being flushed.");
+TAG_FLAG(flush_tablets_before_shutdown_timeout_ms, advanced);
+TAG_FLAG(flush_tablets_before_shutdown_timeout_ms, experimental);
+TAG_FLAG(flush_tablets_before_shutdown_timeout_ms, runtime);
+
 DEFINE_bool(tablet_bootstrap_skip_opening_tablet_for_testing, false,
             "Whether to skip opening tablet when bootstrap. "
             "Only for testing.");
 TAG_FLAG(tablet_bootstrap_skip_opening_tablet_for_testing, hidden);
 
 DECLARE_bool(raft_prepare_replacement_before_eviction);
+DECLARE_bool(tablet_copy_reuse_local_blocks);
 DECLARE_uint32(txn_staleness_tracker_interval_ms);
 
 METRIC_DEFINE_gauge_int32(server, tablets_num_not_initialized,
@@ -265,6 +295,7 @@ using kudu::consensus::ConsensusMetadataCreateMode;
 using kudu::consensus::ConsensusMetadataManager;
 using kudu::consensus::ConsensusStatePB;
 using kudu::consensus::EXCLUDE_HEALTH_REPORT;
+using kudu::consensus::ElectionCoordinator;
 using kudu::consensus::INCLUDE_HEALTH_REPORT;
 using kudu::consensus::OpId;
 using kudu::consensus::OpIdToString;
@@ -293,6 +324,7 @@ using std::make_shared;
 using std::set;
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
@@ -310,6 +342,25 @@ bool ValidateUpdateTabletStatsInterval() {
 
   return true;
 }
+
+// Returns the priority with which to open the replica with consensus metadata
+// 'cmeta' hosted by the server with 'uuid' on startup: the lower, the sooner.
+// The replicas which are needed the soonest are those no other server can
+// stand in for, then those which are the most likely to be elected leader.
+int OpenPriority(ConsensusMetadata* cmeta, const string& uuid) {
+  if (!cmeta->IsVoterInConfig(uuid, consensus::ACTIVE_CONFIG)) {
+    return 3;
+  }
+  if (cmeta->CountVotersInConfig(consensus::ACTIVE_CONFIG) == 1) {
+    return 0;
+  }
+  // A leader votes for itself in the term it's elected in, so this is the
+  // best guess of whether the replica was the leader before the restart.
+  if (cmeta->has_voted_for() && cmeta->voted_for() == uuid) {
+    return 1;
+  }
+  return 2;
+}
 } // anonymous namespace
 
 GROUP_FLAG_VALIDATOR(update_tablet_stats_interval_ms, ValidateUpdateTabletStatsInterval);
@@ -317,6 +368,7 @@ GROUP_FLAG_VALIDATOR(update_tablet_stats_interval_ms, ValidateUpdateTabletStatsI
 TSTabletManager::TSTabletManager(TabletServer* server)
   : fs_manager_(server->fs_manager()),
     cmeta_manager_(new ConsensusMetadataManager(fs_manager_)),
+    election_coordinator_(make_shared<ElectionCoordinator>()),
     server_(server),
     shutdown_latch_(1),
     metric_registry_(server->metric_registry()),
@@ -486,6 +538,9 @@ Status TSTabletManager::Init(Timer* start_tablets,
   InitLocalRaftPeerPB();
 
   vector<scoped_refptr<TabletMetadata>> metas(tablet_ids.size());
+  // The priority with which to open each of the replicas: see OpenPriority().
+  vector<int> priorities(tablet_ids.size(), 0);
+  const bool prioritize = FLAGS_tablet_open_prioritize_likely_leaders;
 
   // First, load all of the tablet metadata. We do this before we start
   // submitting the actual OpenTablet() tasks so that we don't have to compete
@@ -502,8 +557,9 @@ Status TSTabletManager::Init(Timer* start_tablets,
         break;
       }
 
-      RETURN_NOT_OK(open_tablet_pool_->Submit([this, i, tablet_ids, &total_loaded_count,
-                                               &success_loaded_count, &metas,
+      RETURN_NOT_OK(open_tablet_pool_->Submit([this, i, tablet_ids, prioritize,
+                                               &total_loaded_count, &success_loaded_count,
+                                               &metas, &priorities,
                                                &seen_error, &first_error]() {
         const string& tablet_id = tablet_ids[i];
         Status s;
@@ -530,6 +586,15 @@ Status TSTabletManager::Init(Timer* start_tablets,
 
           success_loaded_count++;
           metas[i] = meta;
+
+          if (prioritize) {
+            // The consensus metadata is cached by the manager, so it's not
+            // read again when the replica is opened. If it can't be loaded,
+            // opening the replica fails and reports the error.
+            scoped_refptr<ConsensusMetadata> cmeta;
+            priorities[i] = cmeta_manager_->Load(tablet_id, &cmeta).ok() ?
+                OpenPriority(cmeta.get(), fs_manager_->uuid()) : 0;
+          }
         } while (false);
 
         if (!s.ok()) {
@@ -550,13 +615,22 @@ Status TSTabletManager::Init(Timer* start_tablets,
     *tablets_total = success_loaded_count.load();
   }
 
+  // The order in which to open the replicas. The sort is stable, so the
+  // replicas with the same priority are opened in the order they were found.
+  vector<int> open_order(metas.size());
+  std::iota(open_order.begin(), open_order.end(), 0);
+  std::stable_sort(open_order.begin(), open_order.end(), [&](int a, int b) {
+    return priorities[a] < priorities[b];
+  });
+
   // Now submit the "Open" task for each.
   METRIC_tablets_num_total_startup.Instantiate(server_->metric_entity(), *tablets_total);
   *tablets_processed = 0;
   int registered_count = 0;
   if (PREDICT_TRUE(!FLAGS_tablet_bootstrap_skip_opening_tablet_for_testing)) {
     SCOPED_LOG_TIMING(INFO, Substitute("register tablets"));
-    for (const auto& meta : metas) {
+    for (int i : open_order) {
+      const auto& meta = metas[i];
       if (!meta.get()) {
         continue;
       }
@@ -798,6 +872,7 @@ void TSTabletManager::RunTabletCopy(
   scoped_refptr<TabletReplica> old_replica;
   scoped_refptr<TabletMetadata> meta;
   bool replacing_tablet = false;
+  unique_ptr<ReusableLocalBlocks> local_blocks;
   scoped_refptr<TransitionInProgressDeleter> deleter;
   {
     std::lock_guard<RWMutex> lock(lock_);
@@ -854,6 +929,17 @@ void TSTabletManager::RunTabletCopy(
         // mutate the ConsensusMetadata.
         old_replica->Shutdown();
 
+        // Keep the blocks of the replica open, so that they remain readable
+        // once deleted below, for the copy to reuse those the source has too.
+        if (FLAGS_tablet_copy_reuse_local_blocks) {
+          Status s = ReusableLocalBlocks::Open(fs_manager_, meta, &local_blocks);
+          if (PREDICT_FALSE(!s.ok())) {
+            LOG(WARNING) << LogPrefix(tablet_id) << "Tablet Copy: not reusing local blocks: "
+                         << s.ToString();
+            local_blocks.reset();
+          }
+        }
+
         // Note that this leaves the data dir manager without any references to
         // tablet_id. This is okay because the tablet_copy_client should
         // generate a new disk group during the call to Start().
@@ -931,6 +1017,11 @@ void TSTabletManager::RunTabletCopy(
   if (replacing_tablet) {
     CALLBACK_RETURN_NOT_OK(tc_client.SetTabletToReplace(meta, leader_term));
   }
+  if (local_blocks) {
+    LOG(INFO) << LogPrefix(tablet_id) << "Tablet Copy: looking for "
+              << local_blocks->num_blocks() << " local blocks to reuse";
+    tc_client.SetLocalBlocksToReuse(std::move(local_blocks));
+  }
   CALLBACK_RETURN_NOT_OK(tc_client.Start(copy_source_addr, &meta));
 
   // After calling TabletCopyClient::Start(), the superblock is persisted in
@@ -1007,7 +1098,10 @@ Status TSTabletManager::CreateAndRegisterTabletReplica(
                         }));
   Status s = replica->Init({ server_->mutable_quiescing(),
                              server_->num_raft_leaders(),
-                             server_->raft_pool() });
+                             server_->raft_pool(),
+                             /*allow_status_msg_for_failed_peer=*/nullptr,
+                             server_->metric_entity(),
+                             election_coordinator_ });
   if (PREDICT_FALSE(!s.ok())) {
     replica->SetError(s);
     replica->Shutdown();
@@ -1442,6 +1536,49 @@ void TSTabletManager::IncrementTabletsProcessed(int tablets_total,
   }
 }
 
+void TSTabletManager::FlushTabletsBeforeShutdown() {
+  if (!FLAGS_flush_tablets_before_shutdown) {
+    return;
+  }
+  const MonoTime deadline = MonoTime::Now() +
+      MonoDelta::FromMilliseconds(FLAGS_flush_tablets_before_shutdown_timeout_ms);
+  vector<scoped_refptr<TabletReplica>> replicas;
+  GetTabletReplicas(&replicas);
+  LOG(INFO) << Substitute("Flushing $0 tablet replicas before shutting down...",
+                          replicas.size());
+  LOG_TIMING(INFO, "flushing tablet replicas before shutting down") {
+    for (const auto& replica : replicas) {
+      Status s = open_tablet_pool_->Submit([replica, deadline]() {
+        if (MonoTime::Now() > deadline) {
+          return;
+        }
+        shared_ptr<Tablet> tablet = replica->shared_tablet();
+        if (!tablet || replica->state() != tablet::RUNNING) {
+          return;
+        }
+        Status s;
+        if (!tablet->MemRowSetEmpty()) {
+          s = tablet->Flush();
+        }
+        if (s.ok()) {
+          s = tablet->FlushAllDMS();
+        }
+        if (s.ok()) {
+          s = replica->RunLogGC();
+        }
+        WARN_NOT_OK(s, Substitute("T $0: could not flush before shutting down",
+                                  replica->tablet_id()));
+      });
+      WARN_NOT_OK(s, Substitute("could not flush tablet $0 before shutting down",
+                                replica->tablet_id()));
+    }
+    if (!open_tablet_pool_->WaitUntil(deadline)) {
+      LOG(WARNING) << "Timed out flushing tablet replicas before shutting down: "
+                   << "the remaining ones will replay their logs upon restart";
+    }
+  }
+}
+
 void TSTabletManager::Shutdown() {
   {
     std::lock_guard<RWMutex> lock(lock_);
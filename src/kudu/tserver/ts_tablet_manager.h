@@ -67,6 +67,7 @@ class TxnSystemClient;
 
 namespace consensus {
 class ConsensusMetadataManager;
+class ElectionCoordinator;
 class OpId;
 class StartTabletCopyRequestPB;
 } // namespace consensus
@@ -121,6 +122,14 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
   // Shut down all of the tablets, gracefully flushing before shutdown.
   void Shutdown();
 
+  // With --flush_tablets_before_shutdown, flushes the MRS and DMSs of all the
+  // running tablets in parallel and garbage collects their logs, so that
+  // little is left to replay when they are bootstrapped again. Tablets not
+  // flushed within --flush_tablets_before_shutdown_timeout_ms are skipped.
+  //
+  // Should be called once no more writes are accepted, before Shutdown().
+  void FlushTabletsBeforeShutdown();
+
   // Create a new tablet and register it with the tablet manager. The new tablet
   // is persisted on disk and opened before this method returns.
   //
@@ -402,6 +411,9 @@ class TSTabletManager : public tserver::TabletReplicaLookupIf {
 
   const scoped_refptr<consensus::ConsensusMetadataManager> cmeta_manager_;
 
+  // Coordinates the leader elections of the replicas of the server.
+  const std::shared_ptr<consensus::ElectionCoordinator> election_coordinator_;
+
   TabletServer* const server_;
 
   consensus::RaftPeerPB local_peer_pb_;
@@ -528,10 +528,12 @@ void IteratorStatsToJson(const ScanDescriptor& scan, EasyJson* json) {
     row["bytes_read"] = HumanReadableNumBytes::ToString(stats.bytes_read);
     row["cells_read"] = HumanReadableInt::ToString(stats.cells_read);
     row["blocks_read"] = HumanReadableInt::ToString(stats.blocks_read);
+    row["blocks_read_from_disk"] = HumanReadableInt::ToString(stats.blocks_read_from_disk);
 
     row["bytes_read_title"] = stats.bytes_read;
     row["cells_read_title"] = stats.cells_read;
     row["blocks_read_title"] = stats.blocks_read;
+    row["blocks_read_from_disk_title"] = stats.blocks_read_from_disk;
   };
 
   IteratorStats total_stats;
@@ -545,6 +547,29 @@ void IteratorStatsToJson(const ScanDescriptor& scan, EasyJson* json) {
   fill_stats(total_row, "total", total_stats);
 }
 
+void ScanProfileToJson(const ScanProfile& profile, EasyJson* json) {
+  const auto add_time = [&] (const char* name, int64_t us) {
+    EasyJson row = json->PushBack(EasyJson::kObject);
+    row["name"] = name;
+    row["value"] = HumanReadableElapsedTime::ToShortString(us / 1e6);
+    row["value_title"] = Substitute("$0 us", us);
+  };
+  const auto add_bytes = [&] (const char* name, int64_t bytes) {
+    EasyJson row = json->PushBack(EasyJson::kObject);
+    row["name"] = name;
+    row["value"] = HumanReadableNumBytes::ToString(bytes);
+    row["value_title"] = bytes;
+  };
+  add_time("cfile read", profile.cfile_read_us);
+  add_time("cfile decode", profile.cfile_decode_us);
+  add_time("predicate eval", profile.predicate_eval_us);
+  add_time("delta apply", profile.delta_apply_us);
+  add_time("safe time wait", profile.safe_time_wait_us);
+  add_time("serialize", profile.serialize_us);
+  add_bytes("cache hit", profile.cfile_cache_hit_bytes);
+  add_bytes("cache miss", profile.cfile_cache_miss_bytes);
+}
+
 void ScanToJson(const ScanDescriptor& scan, EasyJson* json) {
   MonoTime now = MonoTime::Now();
   MonoDelta duration;
@@ -577,6 +602,9 @@ void ScanToJson(const ScanDescriptor& scan, EasyJson* json) {
   json->Set("duration_title", duration.ToSeconds());
   json->Set("time_since_start_title", time_since_start.ToSeconds());
 
+  EasyJson profile_json = json->Set("profile", EasyJson::kArray);
+  ScanProfileToJson(scan.profile, &profile_json);
+
   EasyJson stats_json = json->Set("stats", EasyJson::kArray);
   IteratorStatsToJson(scan, &stats_json);
 }
@@ -64,7 +64,11 @@ struct BenchSetup {
     // vast majority of lookups.
     ZIPFIAN,
     // Every item is equally likely to be looked up.
-    UNIFORM
+    UNIFORM,
+    // Half of the lookups follow a Zipfian distribution, while the other
+    // half are of items which are looked up only once, as if scanned.
+    // Only the former count towards the hit rate.
+    ZIPFIAN_WITH_SCAN
   };
   Pattern pattern;
 
@@ -74,13 +78,22 @@ struct BenchSetup {
   // in the cache.
   double dataset_cache_ratio;
 
+  Cache::EvictionPolicy eviction_policy = Cache::EvictionPolicy::LRU;
+
   string ToString() const {
     string ret;
     switch (pattern) {
       case Pattern::ZIPFIAN: ret += "ZIPFIAN"; break;
       case Pattern::UNIFORM: ret += "UNIFORM"; break;
+      case Pattern::ZIPFIAN_WITH_SCAN: ret += "ZIPFIAN_WITH_SCAN"; break;
+    }
+    ret += StringPrintf(" ratio=%.2fx n_unique=%d policy=", dataset_cache_ratio, max_key());
+    switch (eviction_policy) {
+      case Cache::EvictionPolicy::FIFO: ret += "FIFO"; break;
+      case Cache::EvictionPolicy::LRU: ret += "LRU"; break;
+      case Cache::EvictionPolicy::SLRU: ret += "SLRU"; break;
+      case Cache::EvictionPolicy::CLOCK: ret += "CLOCK"; break;
     }
-    ret += StringPrintf(" ratio=%.2fx n_unique=%d", dataset_cache_ratio, max_key());
     return ret;
   }
 
@@ -95,7 +108,15 @@ class CacheBench : public KuduTest,
  public:
   void SetUp() override {
     KuduTest::SetUp();
-    cache_.reset(NewCache(kCacheCapacity, "test-cache"));
+    if (GetParam().eviction_policy == Cache::EvictionPolicy::SLRU) {
+      cache_.reset(NewCache<Cache::EvictionPolicy::SLRU, Cache::MemoryType::DRAM>(
+          kCacheCapacity, "test-cache"));
+    } else if (GetParam().eviction_policy == Cache::EvictionPolicy::CLOCK) {
+      cache_.reset(NewCache<Cache::EvictionPolicy::CLOCK, Cache::MemoryType::DRAM>(
+          kCacheCapacity, "test-cache"));
+    } else {
+      cache_.reset(NewCache(kCacheCapacity, "test-cache"));
+    }
   }
 
   // Run queries against the cache until '*done' becomes true.
@@ -107,23 +128,37 @@ class CacheBench : public KuduTest,
     int64_t hits = 0;
     while (!*done) {
       uint32_t int_key;
-      if (setup.pattern == BenchSetup::Pattern::ZIPFIAN) {
-        int_key = r.Skewed(Bits::Log2Floor(setup.max_key()));
-      } else {
-        int_key = r.Uniform(setup.max_key());
+      bool scanned = false;
+      switch (setup.pattern) {
+        case BenchSetup::Pattern::ZIPFIAN:
+          int_key = r.Skewed(Bits::Log2Floor(setup.max_key()));
+          break;
+        case BenchSetup::Pattern::UNIFORM:
+          int_key = r.Uniform(setup.max_key());
+          break;
+        case BenchSetup::Pattern::ZIPFIAN_WITH_SCAN:
+          scanned = r.OneIn(2);
+          // Scanned keys are random 31-bit values above all the other keys,
+          // so they're practically never looked up again.
+          int_key = scanned ? (1U << 31) | r.Next()
+                            : r.Skewed(Bits::Log2Floor(setup.max_key()));
+          break;
       }
       char key_buf[sizeof(int_key)];
       memcpy(key_buf, &int_key, sizeof(int_key));
       Slice key_slice(key_buf, arraysize(key_buf));
       auto h(cache_->Lookup(key_slice, Cache::EXPECT_IN_CACHE));
-      if (h) {
-        ++hits;
-      } else {
+      if (!h) {
         auto ph(cache_->Allocate(
             key_slice, /* val_len=*/kEntrySize, /* charge=*/kEntrySize));
         cache_->Insert(std::move(ph), nullptr);
       }
-      ++lookups;
+      if (!scanned) {
+        if (h) {
+          ++hits;
+        }
+        ++lookups;
+      }
     }
     return {hits, lookups};
   }
@@ -155,12 +190,22 @@ class CacheBench : public KuduTest,
 };
 
 // Test both distributions, and for each, test both the case where the data
-// fits in the cache and where it is a bit larger.
+// fits in the cache and where it is a bit larger. Compare the LRU and SLRU
+// eviction policies when the data doesn't fit, with and without scans.
+// The CLOCK policy is mostly interesting for the lookup throughput with
+// many concurrent readers, e.g. with --num_threads=64.
 INSTANTIATE_TEST_SUITE_P(Patterns, CacheBench, testing::ValuesIn(std::vector<BenchSetup>{
       {BenchSetup::Pattern::ZIPFIAN, 1.0},
       {BenchSetup::Pattern::ZIPFIAN, 3.0},
       {BenchSetup::Pattern::UNIFORM, 1.0},
-      {BenchSetup::Pattern::UNIFORM, 3.0}
+      {BenchSetup::Pattern::UNIFORM, 3.0},
+      {BenchSetup::Pattern::ZIPFIAN, 3.0, Cache::EvictionPolicy::SLRU},
+      {BenchSetup::Pattern::UNIFORM, 3.0, Cache::EvictionPolicy::SLRU},
+      {BenchSetup::Pattern::ZIPFIAN_WITH_SCAN, 3.0},
+      {BenchSetup::Pattern::ZIPFIAN_WITH_SCAN, 3.0, Cache::EvictionPolicy::SLRU},
+      {BenchSetup::Pattern::ZIPFIAN, 1.0, Cache::EvictionPolicy::CLOCK},
+      {BenchSetup::Pattern::ZIPFIAN, 3.0, Cache::EvictionPolicy::CLOCK},
+      {BenchSetup::Pattern::UNIFORM, 3.0, Cache::EvictionPolicy::CLOCK}
     }));
 
 TEST_P(CacheBench, RunBench) {
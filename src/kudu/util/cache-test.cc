@@ -4,10 +4,12 @@
 
 #include "kudu/util/cache.h"
 
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -146,6 +148,24 @@ class CacheBaseTest : public KuduTest,
         }
         MemTracker::FindTracker("cache_test-sharded_lru_cache", &mem_tracker_);
         break;
+      case Cache::EvictionPolicy::SLRU:
+        if (mem_type != Cache::MemoryType::DRAM) {
+          FAIL() << "SLRU cache can only be of DRAM type";
+        }
+        cache_.reset(NewCache<Cache::EvictionPolicy::SLRU,
+                              Cache::MemoryType::DRAM>(cache_size(),
+                                                       "cache_test"));
+        MemTracker::FindTracker("cache_test-sharded_slru_cache", &mem_tracker_);
+        break;
+      case Cache::EvictionPolicy::CLOCK:
+        if (mem_type != Cache::MemoryType::DRAM) {
+          FAIL() << "CLOCK cache can only be of DRAM type";
+        }
+        cache_.reset(NewCache<Cache::EvictionPolicy::CLOCK,
+                              Cache::MemoryType::DRAM>(cache_size(),
+                                                       "cache_test"));
+        MemTracker::FindTracker("cache_test-sharded_clock_cache", &mem_tracker_);
+        break;
       default:
         FAIL() << "unrecognized cache eviction policy";
         break;
@@ -208,6 +228,18 @@ INSTANTIATE_TEST_SUITE_P(
         make_tuple(Cache::MemoryType::DRAM,
                    Cache::EvictionPolicy::LRU,
                    ShardingPolicy::SingleShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::SLRU,
+                   ShardingPolicy::MultiShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::SLRU,
+                   ShardingPolicy::SingleShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::CLOCK,
+                   ShardingPolicy::MultiShard),
+        make_tuple(Cache::MemoryType::DRAM,
+                   Cache::EvictionPolicy::CLOCK,
+                   ShardingPolicy::SingleShard),
         make_tuple(Cache::MemoryType::NVM,
                    Cache::EvictionPolicy::LRU,
                    ShardingPolicy::MultiShard),
@@ -533,4 +565,162 @@ TEST_P(LRUCacheTest, EvictionPolicy) {
   ASSERT_EQ(-1, Lookup(200));
 }
 
+class CLOCKCacheTest :
+    public CacheBaseTest,
+    public ::testing::WithParamInterface<ShardingPolicy> {
+ public:
+  CLOCKCacheTest()
+      : CacheBaseTest(16 * 1024 * 1024) {
+  }
+
+  void SetUp() override {
+    SetupWithParameters(Cache::MemoryType::DRAM,
+                        Cache::EvictionPolicy::CLOCK,
+                        GetParam());
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(ShardingPolicies, CLOCKCacheTest,
+                         ::testing::Values(ShardingPolicy::MultiShard,
+                                           ShardingPolicy::SingleShard));
+
+TEST_P(CLOCKCacheTest, EvictionPolicy) {
+  static constexpr int kNumElems = 1000;
+  const int size_per_elem = cache_size() / kNumElems;
+
+  Insert(100, 101);
+  Insert(200, 201);
+
+  // Loop adding and looking up new entries, but repeatedly accessing key 101.
+  // This frequently-used entry should not be evicted.
+  for (int i = 0; i < kNumElems + 1000; i++) {
+    Insert(1000+i, 2000+i, size_per_elem);
+    ASSERT_EQ(2000+i, Lookup(1000+i));
+    ASSERT_EQ(101, Lookup(100));
+  }
+  ASSERT_EQ(101, Lookup(100));
+  // Since '200' wasn't accessed in the loop above, it should have
+  // been evicted.
+  ASSERT_EQ(-1, Lookup(200));
+}
+
+// Run lookups concurrently with insertions and evictions.
+TEST_P(CLOCKCacheTest, ConcurrentLookups) {
+  static constexpr int kNumElems = 1000;
+  static constexpr int kNumThreads = 8;
+  const int size_per_elem = cache_size() / kNumElems;
+  for (int i = 0; i < kNumElems; i++) {
+    Insert(i, i, size_per_elem);
+  }
+  std::atomic<bool> done(false);
+  vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      int i = t;
+      while (!done) {
+        // Entries are either found with the right value or not at all.
+        int key = i++ % (2 * kNumElems);
+        int value = Lookup(key);
+        CHECK(value == -1 || value == key) << key << ": " << value;
+      }
+    });
+  }
+  for (int i = kNumElems; i < 2 * kNumElems; i++) {
+    std::string key_str = EncodeInt(i);
+    std::string val_str = EncodeInt(i);
+    auto handle(cache_->Allocate(key_str, val_str.size(), size_per_elem));
+    memcpy(cache_->MutableValue(&handle), val_str.data(), val_str.size());
+    // No eviction callback: it's not thread-safe.
+    cache_->Insert(std::move(handle), nullptr);
+  }
+  done = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// This class is dedicated for scenarios specific for SLRUCache.
+// The scenarios use a single-shard cache for simpler logic.
+class SLRUCacheTest : public CacheBaseTest {
+ public:
+  SLRUCacheTest()
+      : CacheBaseTest(16 * 1024 * 1024) {
+  }
+
+  void SetUp() override {
+    SetupWithParameters(Cache::MemoryType::DRAM,
+                        Cache::EvictionPolicy::SLRU,
+                        ShardingPolicy::SingleShard);
+  }
+
+  // Reads the entry for 'key' the way the block cache does: insert it
+  // on a miss.
+  void Read(int key, int charge) {
+    if (Lookup(key) == -1) {
+      Insert(key, key, charge);
+    }
+  }
+};
+
+// Verify that a scan over many entries, each read only once, doesn't evict
+// a smaller set of frequently read entries.
+TEST_F(SLRUCacheTest, ScanResistance) {
+  static constexpr int kNumElems = 1000;
+  static constexpr int kNumHotElems = 100;
+  const int size_per_elem = cache_size() / kNumElems;
+
+  for (int i = 0; i < kNumHotElems; i++) {
+    Read(i, size_per_elem);
+    ASSERT_EQ(i, Lookup(i));
+  }
+  // Scan over entries which don't fit into the cache altogether, occasionally
+  // reading the hot entries in between.
+  for (int i = kNumHotElems; i < kNumHotElems + 5 * kNumElems; i++) {
+    Read(i, size_per_elem);
+    if (i % 100 == 0) {
+      for (int j = 0; j < kNumHotElems; j++) {
+        ASSERT_EQ(j, Lookup(j));
+      }
+    }
+  }
+  ASSERT_GE(evicted_keys_.size(), 4 * kNumElems);
+  for (int i = 0; i < kNumHotElems; i++) {
+    SCOPED_TRACE(Substitute("hot element: index $0", i));
+    ASSERT_EQ(i, Lookup(i));
+  }
+  for (auto key : evicted_keys_) {
+    ASSERT_GE(key, kNumHotElems);
+  }
+}
+
+// Verify that a full cache only admits new entries which were looked up at
+// least as often as the entry they'd evict.
+TEST_F(SLRUCacheTest, Admission) {
+  static constexpr int kNumElems = 1000;
+  const int size_per_elem = cache_size() / kNumElems;
+
+  // Fill up the cache with entries which were read a few times.
+  for (int i = 0; i < kNumElems; i++) {
+    Read(i, size_per_elem);
+    ASSERT_EQ(i, Lookup(i));
+    ASSERT_EQ(i, Lookup(i));
+  }
+  ASSERT_TRUE(evicted_keys_.empty());
+
+  // An entry which was never looked up before isn't admitted: it's freed
+  // once released, without evicting any other entry.
+  Insert(kNumElems, kNumElems, size_per_elem);
+  ASSERT_EQ(1, evicted_keys_.size());
+  ASSERT_EQ(kNumElems, evicted_keys_[0]);
+  ASSERT_EQ(-1, Lookup(kNumElems));
+
+  // Once it's been looked up often enough, it replaces the oldest entry.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(-1, Lookup(kNumElems));
+  }
+  Insert(kNumElems, kNumElems, size_per_elem);
+  ASSERT_EQ(kNumElems, Lookup(kNumElems));
+  ASSERT_EQ(2, evicted_keys_.size());
+}
+
 }  // namespace kudu
@@ -4,13 +4,16 @@
 
 #include "kudu/util/cache.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <initializer_list>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -28,6 +31,7 @@
 #include "kudu/util/alignment.h"
 #include "kudu/util/cache_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/mem_tracker.h"
@@ -45,6 +49,18 @@ DEFINE_double(cache_memtracker_approximation_ratio, 0.01,
               "this ratio to improve performance. For tests.");
 TAG_FLAG(cache_memtracker_approximation_ratio, hidden);
 
+DEFINE_double(cache_slru_protected_ratio, 0.8,
+              "For caches with the SLRU eviction policy, the fraction of the capacity "
+              "which may be used by the protected segment, holding the entries that "
+              "were looked up again after being inserted.");
+TAG_FLAG(cache_slru_protected_ratio, advanced);
+
+DEFINE_bool(cache_slru_admission, true,
+            "For caches with the SLRU eviction policy, whether a full cache should only "
+            "admit new entries which were looked up at least as often as the entry "
+            "they would evict, as estimated by a frequency sketch of the lookups.");
+TAG_FLAG(cache_slru_admission, advanced);
+
 using std::atomic;
 using std::shared_ptr;
 using std::string;
@@ -83,6 +99,8 @@ struct RLHandle {
   uint32_t val_length;
   std::atomic<int32_t> refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  bool in_protected;  // Whether in the protected segment of an SLRU cache
+  std::atomic<bool> referenced;  // Reference bit of a CLOCK cache
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -198,6 +216,10 @@ string ToString(Cache::EvictionPolicy p) {
       return "fifo";
     case Cache::EvictionPolicy::LRU:
       return "lru";
+    case Cache::EvictionPolicy::SLRU:
+      return "slru";
+    case Cache::EvictionPolicy::CLOCK:
+      return "clock";
     default:
       LOG(FATAL) << "unexpected cache eviction policy: " << static_cast<int>(p);
       break;
@@ -205,6 +227,65 @@ string ToString(Cache::EvictionPolicy p) {
   return "unknown";
 }
 
+// A count-min sketch estimating how often keys are looked up, used to decide
+// whether new entries should be admitted into an SLRU cache. Each key maps to
+// one saturating 4-bit counter in each of kDepth rows, and its estimated
+// frequency is the smallest of them. To keep the estimates recent, all the
+// counters are halved once the number of increments reaches ten times the
+// number of counters per row.
+//
+// Not thread-safe.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(size_t width)
+      : width_bits_(Bits::Log2Ceiling64(std::max<size_t>(width, 64))),
+        counters_(kDepth << width_bits_),
+        num_increments_(0),
+        sample_size_((size_t{1} << width_bits_) * 10) {
+  }
+
+  void Increment(uint32_t hash) {
+    for (int i = 0; i < kDepth; i++) {
+      uint8_t& counter = counters_[Index(hash, i)];
+      if (counter < kMaxCount) {
+        counter++;
+      }
+    }
+    if (++num_increments_ == sample_size_) {
+      for (auto& counter : counters_) {
+        counter >>= 1;
+      }
+      num_increments_ /= 2;
+    }
+  }
+
+  int Estimate(uint32_t hash) const {
+    int estimate = kMaxCount;
+    for (int i = 0; i < kDepth; i++) {
+      estimate = std::min<int>(estimate, counters_[Index(hash, i)]);
+    }
+    return estimate;
+  }
+
+ private:
+  static constexpr int kDepth = 4;
+  static constexpr uint8_t kMaxCount = 15;
+
+  // Returns the index of the counter for 'hash' in row 'row'. The shard of an
+  // entry is picked by the top bits of its hash, so mix all of them in.
+  size_t Index(uint32_t hash, int row) const {
+    static constexpr uint32_t kSeeds[kDepth] = {
+      0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f };
+    uint32_t h = (hash ^ (hash >> 16)) * kSeeds[row];
+    return (static_cast<size_t>(row) << width_bits_) + (h >> (32 - width_bits_));
+  }
+
+  const int width_bits_;
+  std::vector<uint8_t> counters_;
+  size_t num_increments_;
+  const size_t sample_size_;
+};
+
 // A single shard of sharded cache.
 template<Cache::EvictionPolicy policy>
 class CacheShard {
@@ -216,6 +297,13 @@ class CacheShard {
   void SetCapacity(size_t capacity) {
     capacity_ = capacity;
     max_deferred_consumption_ = capacity * FLAGS_cache_memtracker_approximation_ratio;
+    if (policy == Cache::EvictionPolicy::SLRU) {
+      protected_capacity_ = capacity * FLAGS_cache_slru_protected_ratio;
+      if (FLAGS_cache_slru_admission) {
+        // Size the sketch for entries of 4KiB or more.
+        sketch_.reset(new FrequencySketch(capacity / 4096));
+      }
+    }
   }
 
   void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
@@ -229,9 +317,22 @@ class CacheShard {
 
  private:
   void RL_Remove(RLHandle* e);
+  // Make 'e' the newest entry of its segment.
   void RL_Append(RLHandle* e);
   // Update the recency list after a lookup operation.
   void RL_UpdateAfterLookup(RLHandle* e);
+  // Returns the entry to evict next, or nullptr if the cache is empty.
+  RLHandle* RL_EvictionCandidate();
+  // Whether a full cache should admit the new entry 'e'.
+  bool ShouldAdmit(RLHandle* e);
+  // Remove the entries of the given recency list which 'ctl' finds invalid,
+  // adding them to the list headed by '*to_remove_head' if they are no longer
+  // referenced.
+  void InvalidateList(const Cache::InvalidationControl& ctl,
+                      RLHandle* rl,
+                      size_t* valid_entry_count,
+                      size_t* invalid_entry_count,
+                      RLHandle** to_remove_head);
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(RLHandle* e);
@@ -265,14 +366,30 @@ class CacheShard {
   // Initialized before use.
   size_t capacity_;
 
-  // mutex_ protects the following state.
-  simple_spinlock mutex_;
+  // mutex_ protects the following state. For the CLOCK policy, lookups only
+  // take the reader lock of the current CPU, and may only set the reference
+  // bits of the entries concurrently.
+  typename std::conditional<policy == Cache::EvictionPolicy::CLOCK,
+                            percpu_rwlock, simple_spinlock>::type mutex_;
+  ScopedLockSiteRegistration mutex_site_{&mutex_, LockSite::kBlockCache};
   size_t usage_;
 
   // Dummy head of recency list.
   // rl.prev is newest entry, rl.next is oldest entry.
+  //
+  // For the SLRU policy, this is the probationary segment.
   RLHandle rl_;
 
+  // Dummy head of the recency list of the protected segment, for the SLRU
+  // policy. The protected segment may use up to 'protected_capacity_' of the
+  // shard's capacity, out of the total usage in 'usage_'.
+  RLHandle protected_rl_;
+  size_t protected_capacity_;
+  size_t protected_usage_;
+
+  // Lookup frequencies used for admission by the SLRU policy, if enabled.
+  unique_ptr<FrequencySketch> sketch_;
+
   HandleTable table_;
 
   MemTracker* mem_tracker_;
@@ -288,23 +405,29 @@ class CacheShard {
 template<Cache::EvictionPolicy policy>
 CacheShard<policy>::CacheShard(MemTracker* tracker)
     : usage_(0),
+      protected_capacity_(0),
+      protected_usage_(0),
       mem_tracker_(tracker),
       metrics_(nullptr) {
-  // Make empty circular linked list.
+  // Make empty circular linked lists.
   rl_.next = &rl_;
   rl_.prev = &rl_;
+  protected_rl_.next = &protected_rl_;
+  protected_rl_.prev = &protected_rl_;
 }
 
 template<Cache::EvictionPolicy policy>
 CacheShard<policy>::~CacheShard() {
-  for (RLHandle* e = rl_.next; e != &rl_; ) {
-    RLHandle* next = e->next;
-    DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
-        << "caller has an unreleased handle";
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (RLHandle* rl : { &rl_, &protected_rl_ }) {
+    for (RLHandle* e = rl->next; e != rl; ) {
+      RLHandle* next = e->next;
+      DCHECK_EQ(e->refs.load(std::memory_order_relaxed), 1)
+          << "caller has an unreleased handle";
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
     }
-    e = next;
   }
   mem_tracker_->Consume(deferred_consumption_);
 }
@@ -367,16 +490,36 @@ void CacheShard<policy>::RL_Remove(RLHandle* e) {
   e->prev->next = e->next;
   DCHECK_GE(usage_, e->charge);
   usage_ -= e->charge;
+  if (e->in_protected) {
+    DCHECK_GE(protected_usage_, e->charge);
+    protected_usage_ -= e->charge;
+  }
 }
 
 template<Cache::EvictionPolicy policy>
 void CacheShard<policy>::RL_Append(RLHandle* e) {
-  // Make "e" newest entry by inserting just before rl_.
-  e->next = &rl_;
-  e->prev = rl_.prev;
+  // Make "e" newest entry by inserting just before the list head.
+  RLHandle* rl = e->in_protected ? &protected_rl_ : &rl_;
+  e->next = rl;
+  e->prev = rl->prev;
   e->prev->next = e;
   e->next->prev = e;
   usage_ += e->charge;
+  if (e->in_protected) {
+    protected_usage_ += e->charge;
+  }
+}
+
+template<Cache::EvictionPolicy policy>
+RLHandle* CacheShard<policy>::RL_EvictionCandidate() {
+  // Entries are evicted from the probationary segment first.
+  if (rl_.next != &rl_) {
+    return rl_.next;
+  }
+  if (protected_rl_.next != &protected_rl_) {
+    return protected_rl_.next;
+  }
+  return nullptr;
 }
 
 template<>
@@ -389,6 +532,50 @@ void CacheShard<Cache::EvictionPolicy::LRU>::RL_UpdateAfterLookup(RLHandle* e) {
   RL_Append(e);
 }
 
+template<>
+void CacheShard<Cache::EvictionPolicy::SLRU>::RL_UpdateAfterLookup(RLHandle* e) {
+  // Promote the entry to (or within) the protected segment, and demote the
+  // oldest protected entries back to the probationary segment if needed.
+  RL_Remove(e);
+  e->in_protected = true;
+  RL_Append(e);
+  while (protected_usage_ > protected_capacity_ && protected_rl_.next != e) {
+    RLHandle* demoted = protected_rl_.next;
+    RL_Remove(demoted);
+    demoted->in_protected = false;
+    RL_Append(demoted);
+  }
+}
+
+template<>
+RLHandle* CacheShard<Cache::EvictionPolicy::CLOCK>::RL_EvictionCandidate() {
+  // Give the referenced entries a second chance. Since the reference bits are
+  // cleared along the way, this goes over the recency list at most once.
+  while (rl_.next != &rl_) {
+    RLHandle* e = rl_.next;
+    if (!e->referenced.load(std::memory_order_relaxed)) {
+      return e;
+    }
+    e->referenced.store(false, std::memory_order_relaxed);
+    RL_Remove(e);
+    RL_Append(e);
+  }
+  return nullptr;
+}
+
+template<Cache::EvictionPolicy policy>
+bool CacheShard<policy>::ShouldAdmit(RLHandle* e) {
+  if (!sketch_ || usage_ + e->charge <= capacity_) {
+    return true;
+  }
+  // Entries replacing existing ones are always admitted.
+  if (table_.Lookup(e->key(), e->hash) != nullptr) {
+    return true;
+  }
+  RLHandle* victim = RL_EvictionCandidate();
+  return victim == nullptr || sketch_->Estimate(e->hash) >= sketch_->Estimate(victim->hash);
+}
+
 template<Cache::EvictionPolicy policy>
 Cache::Handle* CacheShard<policy>::Lookup(const Slice& key,
                                           uint32_t hash,
@@ -396,6 +583,9 @@ Cache::Handle* CacheShard<policy>::Lookup(const Slice& key,
   RLHandle* e;
   {
     std::lock_guard<decltype(mutex_)> l(mutex_);
+    if (sketch_) {
+      sketch_->Increment(hash);
+    }
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
       e->refs.fetch_add(1, std::memory_order_relaxed);
@@ -409,6 +599,29 @@ Cache::Handle* CacheShard<policy>::Lookup(const Slice& key,
   return reinterpret_cast<Cache::Handle*>(e);
 }
 
+template<>
+Cache::Handle* CacheShard<Cache::EvictionPolicy::CLOCK>::Lookup(const Slice& key,
+                                                                uint32_t hash,
+                                                                bool caching) {
+  RLHandle* e;
+  {
+    shared_lock<rw_spinlock> l(mutex_.get_lock());
+    e = table_.Lookup(key, hash);
+    if (e != nullptr) {
+      e->refs.fetch_add(1, std::memory_order_relaxed);
+      // Avoid dirtying the entry's cache line if the bit is already set.
+      if (!e->referenced.load(std::memory_order_relaxed)) {
+        e->referenced.store(true, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Do the metrics outside of the lock.
+  UpdateMetricsLookup(e != nullptr, caching);
+
+  return reinterpret_cast<Cache::Handle*>(e);
+}
+
 template<Cache::EvictionPolicy policy>
 void CacheShard<policy>::Release(Cache::Handle* handle) {
   RLHandle* e = reinterpret_cast<RLHandle*>(handle);
@@ -425,6 +638,8 @@ Cache::Handle* CacheShard<policy>::Insert(
   // Set the remaining RLHandle members which were not already allocated during
   // Allocate().
   handle->eviction_callback = eviction_callback;
+  handle->in_protected = false;
+  handle->referenced.store(false, std::memory_order_relaxed);
   // Two refs for the handle: one from CacheShard, one for the returned handle.
   handle->refs.store(2, std::memory_order_relaxed);
   UpdateMemTracker(handle->charge);
@@ -437,6 +652,13 @@ Cache::Handle* CacheShard<policy>::Insert(
   {
     std::lock_guard<decltype(mutex_)> l(mutex_);
 
+    if (PREDICT_FALSE(!ShouldAdmit(handle))) {
+      // Hand the entry back to the caller without caching it: it's freed once
+      // the returned handle is released.
+      handle->refs.store(1, std::memory_order_relaxed);
+      return reinterpret_cast<Cache::Handle*>(handle);
+    }
+
     RL_Append(handle);
 
     RLHandle* old = table_.Insert(handle);
@@ -448,13 +670,13 @@ Cache::Handle* CacheShard<policy>::Insert(
       }
     }
 
-    while (usage_ > capacity_ && rl_.next != &rl_) {
-      RLHandle* old = rl_.next;
-      RL_Remove(old);
-      table_.Remove(old->key(), old->hash);
-      if (Unref(old)) {
-        old->next = to_remove_head;
-        to_remove_head = old;
+    RLHandle* evicted;
+    while (usage_ > capacity_ && (evicted = RL_EvictionCandidate()) != nullptr) {
+      RL_Remove(evicted);
+      table_.Remove(evicted->key(), evicted->hash);
+      if (Unref(evicted)) {
+        evicted->next = to_remove_head;
+        to_remove_head = evicted;
       }
     }
   }
@@ -489,6 +711,37 @@ void CacheShard<policy>::Erase(const Slice& key, uint32_t hash) {
   }
 }
 
+template<Cache::EvictionPolicy policy>
+void CacheShard<policy>::InvalidateList(const Cache::InvalidationControl& ctl,
+                                        RLHandle* rl,
+                                        size_t* valid_entry_count,
+                                        size_t* invalid_entry_count,
+                                        RLHandle** to_remove_head) {
+  // rl->next is the oldest (a.k.a. least relevant) entry in the recency list.
+  RLHandle* h = rl->next;
+  while (h != nullptr && h != rl &&
+         ctl.iteration_func(*valid_entry_count, *invalid_entry_count)) {
+    if (ctl.validity_func(h->key(), h->value())) {
+      // Continue iterating over the list.
+      h = h->next;
+      ++*valid_entry_count;
+      continue;
+    }
+    // Copy the handle slated for removal.
+    RLHandle* h_to_remove = h;
+    // Prepare for next iteration of the cycle.
+    h = h->next;
+
+    RL_Remove(h_to_remove);
+    table_.Remove(h_to_remove->key(), h_to_remove->hash);
+    if (Unref(h_to_remove)) {
+      h_to_remove->next = *to_remove_head;
+      *to_remove_head = h_to_remove;
+    }
+    ++*invalid_entry_count;
+  }
+}
+
 template<Cache::EvictionPolicy policy>
 size_t CacheShard<policy>::Invalidate(const Cache::InvalidationControl& ctl) {
   size_t invalid_entry_count = 0;
@@ -497,30 +750,10 @@ size_t CacheShard<policy>::Invalidate(const Cache::InvalidationControl& ctl) {
 
   {
     std::lock_guard<decltype(mutex_)> l(mutex_);
-
-    // rl_.next is the oldest (a.k.a. least relevant) entry in the recency list.
-    RLHandle* h = rl_.next;
-    while (h != nullptr && h != &rl_ &&
-           ctl.iteration_func(valid_entry_count, invalid_entry_count)) {
-      if (ctl.validity_func(h->key(), h->value())) {
-        // Continue iterating over the list.
-        h = h->next;
-        ++valid_entry_count;
-        continue;
-      }
-      // Copy the handle slated for removal.
-      RLHandle* h_to_remove = h;
-      // Prepare for next iteration of the cycle.
-      h = h->next;
-
-      RL_Remove(h_to_remove);
-      table_.Remove(h_to_remove->key(), h_to_remove->hash);
-      if (Unref(h_to_remove)) {
-        h_to_remove->next = to_remove_head;
-        to_remove_head = h_to_remove;
-      }
-      ++invalid_entry_count;
-    }
+    // The probationary segment of an SLRU cache holds its least relevant entries.
+    InvalidateList(ctl, &rl_, &valid_entry_count, &invalid_entry_count, &to_remove_head);
+    InvalidateList(ctl, &protected_rl_, &valid_entry_count, &invalid_entry_count,
+                   &to_remove_head);
   }
   // Once removed from the lookup table and the recency list, the entries
   // with no references left must be deallocated because Cache::Release()
@@ -695,6 +928,18 @@ Cache* NewCache<Cache::EvictionPolicy::LRU,
   return new ShardedCache<Cache::EvictionPolicy::LRU>(capacity, id);
 }
 
+template<>
+Cache* NewCache<Cache::EvictionPolicy::SLRU,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id) {
+  return new ShardedCache<Cache::EvictionPolicy::SLRU>(capacity, id);
+}
+
+template<>
+Cache* NewCache<Cache::EvictionPolicy::CLOCK,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id) {
+  return new ShardedCache<Cache::EvictionPolicy::CLOCK>(capacity, id);
+}
+
 std::ostream& operator<<(std::ostream& os, Cache::MemoryType mem_type) {
   switch (mem_type) {
     case Cache::MemoryType::DRAM:
@@ -49,6 +49,23 @@ class Cache {
 
     // The least-recently-used items are evicted.
     LRU,
+
+    // Segmented LRU: items start out in a probationary segment and are
+    // promoted to a protected segment when looked up again, so that a burst
+    // of items accessed only once (e.g., by a large scan) evicts other such
+    // items rather than the frequently used ones. When the cache is full, new
+    // items are only admitted if they've been looked up at least as often as
+    // the item they'd evict, as estimated by a frequency sketch (TinyLFU).
+    SLRU,
+
+    // An approximation of LRU for read-mostly workloads: lookups don't take
+    // the exclusive lock of a shard to move the entry within the recency
+    // list, but set the entry's reference bit under a per-CPU reader lock.
+    // When evicting, the entries with the bit set get a second chance: the
+    // bit is cleared and they're moved to the end of the recency list.
+    // Insertions are more expensive than with LRU, since the exclusive lock
+    // consists of all the per-CPU locks.
+    CLOCK,
   };
 
   // Callback interface which is called when an entry is evicted from the
@@ -373,6 +390,18 @@ template<>
 Cache* NewCache<Cache::EvictionPolicy::LRU,
                 Cache::MemoryType::DRAM>(size_t capacity, const std::string& id);
 
+// Create a new segmented LRU cache with a fixed size capacity, stored in DRAM.
+// See Cache::EvictionPolicy::SLRU for the details of the eviction policy.
+template<>
+Cache* NewCache<Cache::EvictionPolicy::SLRU,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id);
+
+// Create a new CLOCK cache with a fixed size capacity, stored in DRAM.
+// See Cache::EvictionPolicy::CLOCK for the details of the eviction policy.
+template<>
+Cache* NewCache<Cache::EvictionPolicy::CLOCK,
+                Cache::MemoryType::DRAM>(size_t capacity, const std::string& id);
+
 // A helper method to output cache memory type into ostream.
 std::ostream& operator<<(std::ostream& os, Cache::MemoryType mem_type);
 
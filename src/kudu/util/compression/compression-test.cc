@@ -28,11 +28,13 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -148,16 +150,95 @@ TEST_F(TestCompression, TestNoCompressionCodec) {
 }
 
 TEST_F(TestCompression, TestSnappyCompressionCodec) {
-  for (auto type : { SNAPPY, LZ4, ZLIB }) {
+  for (auto type : { SNAPPY, LZ4, ZLIB, ZSTD }) {
     NO_FATALS(TestCompressionCodec(type));
   }
 }
 
 TEST_F(TestCompression, TestSimpleBenchmark) {
   Random r(SeedRandom());
-  for (auto type : { SNAPPY, LZ4, ZLIB }) {
+  for (auto type : { SNAPPY, LZ4, ZLIB, ZSTD }) {
     NO_FATALS(Benchmark(r, type));
   }
 }
 
+TEST_F(TestCompression, TestZstdCompressionLevels) {
+  const CompressionCodec* fast;
+  const CompressionCodec* strong;
+  ASSERT_OK(GetCompressionCodec(ZSTD, 1, &fast));
+  ASSERT_OK(GetCompressionCodec(ZSTD, 19, &strong));
+  ASSERT_NE(fast, strong);
+  ASSERT_EQ(ZSTD, fast->type());
+
+  // The same level maps to the same codec instance.
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(ZSTD, 19, &codec));
+  ASSERT_EQ(strong, codec);
+
+  // Level 0 selects the server-wide default.
+  ASSERT_OK(GetCompressionCodec(ZSTD, 0, &codec));
+  ASSERT_NE(nullptr, codec);
+
+  Status s = GetCompressionCodec(ZSTD, 100, &codec);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // The level is ignored by the other codecs.
+  ASSERT_OK(GetCompressionCodec(LZ4, 100, &codec));
+  ASSERT_EQ(LZ4, codec->type());
+}
+
+TEST_F(TestCompression, TestZstdDictionary) {
+  constexpr int kNumSamples = 1000;
+
+  // Generate small, similar payloads which compress poorly on their own.
+  Random r(SeedRandom());
+  vector<string> payloads;
+  vector<Slice> samples;
+  payloads.reserve(kNumSamples);
+  for (int i = 0; i < kNumSamples; i++) {
+    payloads.emplace_back(strings::Substitute(
+        "{\"user_id\": $0, \"region\": \"us-west-$1\", \"status\": \"active\"}",
+        r.Next(), r.Uniform(4)));
+  }
+  for (const auto& p : payloads) {
+    samples.emplace_back(p);
+  }
+
+  string dict;
+  ASSERT_OK(TrainZstdDictionary(samples, 4096, &dict));
+  ASSERT_FALSE(dict.empty());
+  unique_ptr<CompressionCodec> dict_codec;
+  ASSERT_OK(CreateZstdDictionaryCodec(dict, 0, &dict_codec));
+  const CompressionCodec* plain_codec;
+  ASSERT_OK(GetCompressionCodec(ZSTD, &plain_codec));
+
+  size_t dict_total = 0;
+  size_t plain_total = 0;
+  for (const auto& sample : samples) {
+    unique_ptr<uint8_t[]> cbuffer(new uint8_t[dict_codec->MaxCompressedLength(sample.size())]);
+    size_t compressed;
+    ASSERT_OK(plain_codec->Compress(sample, cbuffer.get(), &compressed));
+    plain_total += compressed;
+
+    ASSERT_OK(dict_codec->Compress(sample, cbuffer.get(), &compressed));
+    dict_total += compressed;
+    unique_ptr<uint8_t[]> ubuffer(new uint8_t[sample.size()]);
+    ASSERT_OK(dict_codec->Uncompress(Slice(cbuffer.get(), compressed),
+                                     ubuffer.get(), sample.size()));
+    ASSERT_EQ(sample, Slice(ubuffer.get(), sample.size()));
+
+    // Data compressed with a dictionary can't be read without it.
+    Status s = plain_codec->Uncompress(Slice(cbuffer.get(), compressed),
+                                       ubuffer.get(), sample.size());
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+  LOG(INFO) << "Compressed size without dictionary: " << plain_total
+            << ", with dictionary: " << dict_total;
+  ASSERT_LT(dict_total, plain_total);
+
+  // Training needs samples to learn from.
+  Status s = TrainZstdDictionary({}, 4096, &dict);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 } // namespace kudu
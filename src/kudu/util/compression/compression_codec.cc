@@ -17,26 +17,52 @@
 
 #include "kudu/util/compression/compression_codec.h"
 
+#include <memory>
+#include <mutex>
 #include <ostream>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <lz4.h>
 #include <snappy-sinksource.h>
 #include <snappy.h>
+#include <zdict.h>
 #include <zlib.h>
+#include <zstd.h>
 
+#include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/debug/leakcheck_disabler.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/string_case.h"
+#include "kudu/util/threadlocal.h"
+
+DEFINE_int32(zstd_default_compression_level, 3,
+             "The level at which ZSTD compresses data when no level is specified, "
+             "e.g. for columns without a compression level. Higher levels give better "
+             "compression ratios at the expense of compression speed; decompression "
+             "speed is roughly the same at all levels.");
+TAG_FLAG(zstd_default_compression_level, advanced);
+DEFINE_validator(zstd_default_compression_level, [](const char* /*n*/, int32 v) {
+  return v != 0 && v >= ZSTD_minCLevel() && v <= ZSTD_maxCLevel();
+});
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 CompressionCodec::CompressionCodec() {
 }
@@ -244,7 +270,199 @@ class ZlibCodec : public CompressionCodec {
   }
 };
 
+namespace {
+
+// ZSTD compression and decompression contexts, which are expensive to create
+// and so are reused by all of the calls made on a thread.
+class ZstdContexts {
+ public:
+  ZstdContexts()
+      : cctx_(ZSTD_createCCtx()),
+        dctx_(ZSTD_createDCtx()) {
+    CHECK(cctx_ && dctx_) << "unable to allocate ZSTD contexts";
+  }
+
+  ~ZstdContexts() {
+    ZSTD_freeCCtx(cctx_);
+    ZSTD_freeDCtx(dctx_);
+  }
+
+  ZSTD_CCtx* cctx() const { return cctx_; }
+  ZSTD_DCtx* dctx() const { return dctx_; }
+
+  static ZstdContexts* Get() {
+    // Disable leak check. LSAN sometimes gets false positives on thread locals.
+    // See: https://github.com/google/sanitizers/issues/757
+    debug::ScopedLeakCheckDisabler d;
+    BLOCK_STATIC_THREAD_LOCAL(ZstdContexts, contexts);
+    return contexts;
+  }
+
+ private:
+  ZSTD_CCtx* const cctx_;
+  ZSTD_DCtx* const dctx_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZstdContexts);
+};
+
+Status ZstdStatus(size_t ret, const char* what) {
+  if (PREDICT_FALSE(ZSTD_isError(ret))) {
+    return Status::RuntimeError(what, ZSTD_getErrorName(ret));
+  }
+  return Status::OK();
+}
+
+// Replaces a 'level' of 0 with the default ZSTD level, and checks that the
+// result is in range.
+Status ResolveZstdLevel(int* level) {
+  if (*level == 0) {
+    *level = FLAGS_zstd_default_compression_level;
+  }
+  if (*level < ZSTD_minCLevel() || *level > ZSTD_maxCLevel()) {
+    return Status::InvalidArgument(
+        Substitute("ZSTD compression level must be between $0 and $1, got $2",
+                   ZSTD_minCLevel(), ZSTD_maxCLevel(), *level));
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+class ZstdCodec : public CompressionCodec {
+ public:
+  // Creates a codec compressing at 'level' without a dictionary.
+  explicit ZstdCodec(int level)
+      : level_(level),
+        cdict_(nullptr),
+        ddict_(nullptr) {
+  }
+
+  // Creates a codec using the given dictionaries, which it takes ownership of.
+  ZstdCodec(ZSTD_CDict* cdict, ZSTD_DDict* ddict)
+      : level_(0),
+        cdict_(cdict),
+        ddict_(ddict) {
+    DCHECK(cdict_);
+    DCHECK(ddict_);
+  }
+
+  ~ZstdCodec() {
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeDDict(ddict_);
+  }
+
+  Status Compress(const Slice& input,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    return Compress(vector<Slice>{ input }, compressed, compressed_length);
+  }
+
+  // Compresses the slices as a single frame using the streaming API, which
+  // avoids concatenating them first.
+  Status Compress(const vector<Slice>& input_slices,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    ZSTD_CCtx* cctx = ZstdContexts::Get()->cctx();
+    size_t total_size = 0;
+    for (const Slice& s : input_slices) {
+      total_size += s.size();
+    }
+    RETURN_NOT_OK(ZstdStatus(ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters),
+                             "unable to reset ZSTD context"));
+    RETURN_NOT_OK(ZstdStatus(ZSTD_CCtx_setPledgedSrcSize(cctx, total_size),
+                             "unable to set ZSTD source size"));
+    if (cdict_) {
+      RETURN_NOT_OK(ZstdStatus(ZSTD_CCtx_refCDict(cctx, cdict_),
+                               "unable to set ZSTD dictionary"));
+    } else {
+      RETURN_NOT_OK(ZstdStatus(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level_),
+                               "unable to set ZSTD compression level"));
+    }
+
+    ZSTD_outBuffer out = { compressed, MaxCompressedLength(total_size), 0 };
+    for (const Slice& s : input_slices) {
+      ZSTD_inBuffer in = { s.data(), s.size(), 0 };
+      while (in.pos < in.size) {
+        RETURN_NOT_OK(ZstdStatus(ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_continue),
+                                 "unable to compress the buffer"));
+      }
+    }
+    ZSTD_inBuffer empty = { nullptr, 0, 0 };
+    size_t remaining;
+    do {
+      remaining = ZSTD_compressStream2(cctx, &out, &empty, ZSTD_e_end);
+      RETURN_NOT_OK(ZstdStatus(remaining, "unable to compress the buffer"));
+      if (PREDICT_FALSE(remaining > 0 && out.pos == out.size)) {
+        return Status::RuntimeError("ZSTD compressed size exceeds its bound");
+      }
+    } while (remaining > 0);
+    *compressed_length = out.pos;
+    return Status::OK();
+  }
+
+  Status Uncompress(const Slice& compressed,
+                    uint8_t *uncompressed, size_t uncompressed_length) const OVERRIDE {
+    ZSTD_DCtx* dctx = ZstdContexts::Get()->dctx();
+    size_t n = ddict_ ?
+        ZSTD_decompress_usingDDict(dctx, uncompressed, uncompressed_length,
+                                   compressed.data(), compressed.size(), ddict_) :
+        ZSTD_decompressDCtx(dctx, uncompressed, uncompressed_length,
+                            compressed.data(), compressed.size());
+    if (PREDICT_FALSE(ZSTD_isError(n))) {
+      return Status::Corruption(
+          Substitute("unable to uncompress the buffer: $0", ZSTD_getErrorName(n)),
+          KUDU_REDACT(compressed.ToDebugString(100)));
+    }
+    if (PREDICT_FALSE(n != uncompressed_length)) {
+      return Status::Corruption(
+          Substitute("uncompressed $0 bytes, expected $1", n, uncompressed_length));
+    }
+    return Status::OK();
+  }
+
+  size_t MaxCompressedLength(size_t source_bytes) const OVERRIDE {
+    return ZSTD_compressBound(source_bytes);
+  }
+
+  CompressionType type() const override {
+    return ZSTD;
+  }
+
+ private:
+  const int level_;
+  ZSTD_CDict* const cdict_;
+  ZSTD_DDict* const ddict_;
+};
+
+// Keeps a singleton ZSTD codec for each compression level in use.
+class ZstdCodecCache {
+ public:
+  static ZstdCodecCache* GetSingleton() {
+    return Singleton<ZstdCodecCache>::get();
+  }
+
+  const CompressionCodec* Get(int level) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto& codec = codecs_[level];
+    if (!codec) {
+      codec.reset(new ZstdCodec(level));
+    }
+    return codec.get();
+  }
+
+ private:
+  friend class Singleton<ZstdCodecCache>;
+  ZstdCodecCache() {}
+
+  simple_spinlock lock_;
+  std::unordered_map<int, unique_ptr<ZstdCodec>> codecs_;
+};
+
+Status GetCompressionCodec(CompressionType compression,
+                           const CompressionCodec** codec) {
+  return GetCompressionCodec(compression, /*level=*/0, codec);
+}
+
 Status GetCompressionCodec(CompressionType compression,
+                           int level,
                            const CompressionCodec** codec) {
   switch (compression) {
     case NO_COMPRESSION:
@@ -259,12 +477,52 @@ Status GetCompressionCodec(CompressionType compression,
     case ZLIB:
       *codec = ZlibCodec::GetSingleton();
       break;
+    case ZSTD:
+      RETURN_NOT_OK(ResolveZstdLevel(&level));
+      *codec = ZstdCodecCache::GetSingleton()->Get(level);
+      break;
     default:
       return Status::NotFound("bad compression type");
   }
   return Status::OK();
 }
 
+Status TrainZstdDictionary(const vector<Slice>& samples,
+                           size_t max_dict_size,
+                           string* dict) {
+  faststring buffer;
+  vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (const Slice& s : samples) {
+    buffer.append(s.data(), s.size());
+    sample_sizes.push_back(s.size());
+  }
+  dict->resize(max_dict_size);
+  size_t n = ZDICT_trainFromBuffer(&(*dict)[0], max_dict_size,
+                                   buffer.data(), sample_sizes.data(), sample_sizes.size());
+  if (ZDICT_isError(n)) {
+    dict->clear();
+    return Status::InvalidArgument("unable to train ZSTD dictionary", ZDICT_getErrorName(n));
+  }
+  dict->resize(n);
+  return Status::OK();
+}
+
+Status CreateZstdDictionaryCodec(const Slice& dict,
+                                 int level,
+                                 unique_ptr<CompressionCodec>* codec) {
+  RETURN_NOT_OK(ResolveZstdLevel(&level));
+  ZSTD_CDict* cdict = ZSTD_createCDict(dict.data(), dict.size(), level);
+  ZSTD_DDict* ddict = ZSTD_createDDict(dict.data(), dict.size());
+  if (!cdict || !ddict) {
+    ZSTD_freeCDict(cdict);
+    ZSTD_freeDDict(ddict);
+    return Status::InvalidArgument("unable to load ZSTD dictionary");
+  }
+  codec->reset(new ZstdCodec(cdict, ddict));
+  return Status::OK();
+}
+
 CompressionType GetCompressionCodecType(const std::string& name) {
   std::string uname;
   ToUpperCase(name, &uname);
@@ -275,6 +533,8 @@ CompressionType GetCompressionCodecType(const std::string& name) {
     return LZ4;
   if (uname == "ZLIB")
     return ZLIB;
+  if (uname == "ZSTD")
+    return ZSTD;
   if (uname == "NO_COMPRESSION")
     return NO_COMPRESSION;
 
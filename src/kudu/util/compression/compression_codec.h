@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -71,6 +72,36 @@ class CompressionCodec {
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec);
 
+// Like the above, but compresses at the given level for codecs which support
+// levels (currently only ZSTD). A level of 0 selects the default level; other
+// codecs ignore the level.
+//
+// Returns InvalidArgument if the level is out of range for the codec.
+Status GetCompressionCodec(CompressionType compression,
+                           int level,
+                           const CompressionCodec** codec);
+
+// Trains a ZSTD dictionary of at most 'max_dict_size' bytes from 'samples',
+// which should be representative of the data to be compressed. Dictionaries
+// substantially improve the compression ratio of small inputs, such as
+// individual blocks of a few KB.
+//
+// Returns InvalidArgument if the samples are not sufficient to train a
+// dictionary.
+Status TrainZstdDictionary(const std::vector<Slice>& samples,
+                           size_t max_dict_size,
+                           std::string* dict);
+
+// Creates a ZSTD codec which compresses at 'level' using the dictionary
+// 'dict', as produced by TrainZstdDictionary(). Data compressed by the codec
+// can only be uncompressed by a codec using the same dictionary.
+//
+// Unlike the codecs returned by GetCompressionCodec(), the codec is owned by
+// the caller.
+Status CreateZstdDictionaryCodec(const Slice& dict,
+                                 int level,
+                                 std::unique_ptr<CompressionCodec>* codec);
+
 // Returns the compression codec type given the name
 CompressionType GetCompressionCodecType(const std::string& name);
 
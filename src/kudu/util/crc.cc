@@ -16,6 +16,13 @@
 // under the License.
 #include "kudu/util/crc.h"
 
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
 #include <crcutil/interface.h>
 
 #include "kudu/gutil/once.h"
@@ -52,5 +59,52 @@ uint32_t Crc32c(const void* data, size_t length, uint32_t prev_crc32) {
   return static_cast<uint32_t>(crc_tmp); // Only uses lower 32 bits.
 }
 
+#if defined(__SSE4_2__) && defined(__x86_64__)
+namespace {
+
+inline uint64_t Load64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Computes the CRCs of three buffers at a time. The CRC32 instruction has a
+// latency of three cycles but a throughput of one per cycle, so running
+// three independent dependency chains keeps the CRC unit busy. The common
+// prefix of the buffers is interleaved, and the rest of each buffer is
+// finished with the regular implementation.
+void Crc32cThreeWay(const Slice& a, const Slice& b, const Slice& c, uint32_t* crcs) {
+  const size_t common = std::min({ a.size(), b.size(), c.size() }) & ~static_cast<size_t>(7);
+  const uint8_t* pa = a.data();
+  const uint8_t* pb = b.data();
+  const uint8_t* pc = c.data();
+  uint64_t ca = 0xffffffff;
+  uint64_t cb = 0xffffffff;
+  uint64_t cc = 0xffffffff;
+  for (size_t i = 0; i < common; i += 8) {
+    ca = _mm_crc32_u64(ca, Load64(pa + i));
+    cb = _mm_crc32_u64(cb, Load64(pb + i));
+    cc = _mm_crc32_u64(cc, Load64(pc + i));
+  }
+  crcs[0] = Crc32c(pa + common, a.size() - common, ~static_cast<uint32_t>(ca));
+  crcs[1] = Crc32c(pb + common, b.size() - common, ~static_cast<uint32_t>(cb));
+  crcs[2] = Crc32c(pc + common, c.size() - common, ~static_cast<uint32_t>(cc));
+}
+
+} // anonymous namespace
+#endif
+
+void Crc32cBatch(ArrayView<const Slice> data, uint32_t* crcs) {
+  size_t i = 0;
+#if defined(__SSE4_2__) && defined(__x86_64__)
+  for (; i + 3 <= data.size(); i += 3) {
+    Crc32cThreeWay(data[i], data[i + 1], data[i + 2], &crcs[i]);
+  }
+#endif
+  for (; i < data.size(); i++) {
+    crcs[i] = Crc32c(data[i].data(), data[i].size());
+  }
+}
+
 } // namespace crc
 } // namespace kudu
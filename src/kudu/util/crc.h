@@ -22,6 +22,9 @@
 
 #include <crcutil/interface.h>
 
+#include "kudu/util/array_view.h"
+#include "kudu/util/slice.h"
+
 namespace kudu {
 namespace crc {
 
@@ -37,6 +40,15 @@ uint32_t Crc32c(const void* data, size_t length);
 // extends it to new chunk and returns the result.
 uint32_t Crc32c(const void* data, size_t length, uint32_t prev_crc32);
 
+// Computes the CRC32C of each slice of 'data' independently, storing the
+// results in 'crcs', which must have room for data.size() values.
+//
+// Equivalent to calling Crc32c() on each slice, but faster for batches of
+// similarly sized buffers: the buffers are checksummed three at a time with
+// interleaved CRC32 instructions, so that each instruction's latency is
+// hidden behind the other buffers' instructions.
+void Crc32cBatch(ArrayView<const Slice> data, uint32_t* crcs);
+
 } // namespace crc
 } // namespace kudu
 
@@ -970,6 +970,50 @@ TEST_F(TestEnv, TestRWFile) {
   ASSERT_EQ(kTestData.length(), sz);
 }
 
+// Test that direct I/O works with reads and writes of any size and offset,
+// and that unaligned writes preserve the surrounding data and the file size.
+TEST_F(TestEnv, TestRWFileDirectIO) {
+  RWFileOptions opts;
+  opts.direct_io = true;
+  unique_ptr<RWFile> file;
+  ASSERT_OK(env_->NewRWFile(opts, GetTestPath("foo"), &file));
+  const uint64_t base = file->GetEncryptionHeaderSize();
+
+  Random rand(SeedRandom());
+  string expected;
+  for (int i = 0; i < 100; i++) {
+    // Write at random offsets around the end of the file (possibly leaving
+    // a gap), or rewrite some of its interior.
+    uint64_t offset = rand.Uniform(expected.size() + 5000);
+    string data = RandomString(rand.Uniform(9000) + 1, &rand);
+    ASSERT_OK(file->Write(base + offset, data));
+    if (offset + data.size() > expected.size()) {
+      expected.resize(offset + data.size(), '\0');
+    }
+    expected.replace(offset, data.size(), data);
+
+    uint64_t size;
+    ASSERT_OK(file->Size(&size));
+    ASSERT_EQ(base + expected.size(), size);
+
+    // Read a random range back into two buffers.
+    uint64_t read_offset = rand.Uniform(expected.size());
+    size_t length = rand.Uniform(expected.size() - read_offset) + 1;
+    string buf(length, '\0');
+    size_t split = rand.Uniform(length);
+    uint8_t* p = reinterpret_cast<uint8_t*>(&buf[0]);
+    vector<Slice> results = { Slice(p, split), Slice(p + split, length - split) };
+    ASSERT_OK(file->ReadV(base + read_offset, results));
+    ASSERT_EQ(expected.substr(read_offset, length), buf);
+  }
+
+  // Reads past the end of the file fail.
+  uint8_t scratch[10];
+  Status s = file->Read(base + expected.size() - 5, Slice(scratch, sizeof(scratch)));
+  ASSERT_TRUE(s.IsEndOfFile()) << s.ToString();
+  ASSERT_OK(file->Close());
+}
+
 TEST_F(TestEnv, TestCanonicalize) {
   vector<string> synonyms = { GetTestPath("."), GetTestPath("./."), GetTestPath(".//./") };
   for (const string& synonym : synonyms) {
@@ -190,6 +190,16 @@ class Env {
   // Synchronize the entry for a specific directory.
   virtual Status SyncDir(const std::string& dirname) = 0;
 
+  // Synchronize all data and metadata of the filesystem containing 'path'
+  // to disk, as a single operation.
+  //
+  // Once a sync of a filesystem fails, every later sync of it fails too: the
+  // writes that failed may belong to any file of the filesystem.
+  //
+  // Returns NotSupported if the platform can't do so, or can't report write
+  // errors of such syncs reliably (Linux before 5.8).
+  virtual Status SyncFilesystem(const std::string& path) = 0;
+
   // Recursively delete the specified directory.
   // This should operate safely, not following any symlinks, etc.
   virtual Status DeleteRecursively(const std::string &dirname) = 0;
@@ -594,8 +604,21 @@ struct RWFileOptions {
   // encrypted if encryption is enabled.
   bool is_sensitive;
 
+  // Whether to bypass the page cache for reads and writes (O_DIRECT). Reads
+  // and writes may be of any size and at any offset: they're transparently
+  // widened to the alignment required for direct I/O, so a write to a range
+  // which isn't aligned will read and rewrite the surrounding data. Thus, the
+  // file shouldn't be written concurrently by several threads unless their
+  // writes are to distinct aligned ranges.
+  //
+  // Ignored (with a warning) by filesystems which don't support direct I/O.
+  bool direct_io;
+
   RWFileOptions()
-      : sync_on_close(false), mode(Env::CREATE_OR_OPEN_WITH_TRUNCATE), is_sensitive(false) {}
+      : sync_on_close(false),
+        mode(Env::CREATE_OR_OPEN_WITH_TRUNCATE),
+        is_sensitive(false),
+        direct_io(false) {}
 };
 
 // A file abstraction for both reading and writing. No notion of a built-in
@@ -685,6 +708,13 @@ class RWFile : public File {
   // Filesystems that don't implement this will return an error.
   virtual Status PunchHole(uint64_t offset, size_t length) = 0;
 
+  // Zeroes the range given by 'offset' and 'length' of the file, extending
+  // the file if the range ends past its end. Unlike with PunchHole(), the
+  // space stays allocated: where the filesystem supports it, the range is
+  // merely marked as unwritten, without writing anything but metadata.
+  // Otherwise, zeros are written to it.
+  virtual Status ZeroRange(uint64_t offset, size_t length) = 0;
+
   // Flushes the range of dirty data (not metadata) given by 'offset' and
   // 'length' to disk. If length is 0, all bytes from 'offset' to the end
   // of the file are flushed.
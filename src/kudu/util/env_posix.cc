@@ -31,6 +31,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <ostream>
@@ -52,14 +53,17 @@
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/alignment.h"
 #include "kudu/util/array_view.h"
 #include "kudu/util/coding-inl.h"
+#include "kudu/util/debug/leakcheck_disabler.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/errno.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/flags.h"
+#include "kudu/util/io_uring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/monotime.h"
@@ -70,6 +74,7 @@
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/thread_restrictions.h"
+#include "kudu/util/threadlocal.h"
 #include "kudu/util/trace.h"
 
 #if defined(__APPLE__)
@@ -104,6 +109,9 @@ using strings::Substitute;
 #ifndef FALLOC_FL_PUNCH_HOLE
 #define FALLOC_FL_PUNCH_HOLE  0x02 /* de-allocates range */
 #endif
+#ifndef FALLOC_FL_ZERO_RANGE
+#define FALLOC_FL_ZERO_RANGE  0x10 /* converts range to unwritten extents */
+#endif
 
 
 #ifndef __APPLE__
@@ -211,6 +219,14 @@ TAG_FLAG(encryption_key_length, hidden);
 DEFINE_validator(encryption_key_length,
                  [](const char* /*n*/, int32 v) { return v == 128 || v == 192 || v == 256; });
 
+DEFINE_bool(env_use_io_uring, false,
+            "Whether to use io_uring(7) for reads and writes of more than IOV_MAX "
+            "buffers at a time, submitting all the required system calls to the "
+            "kernel at once. Falls back to preadv(2) and pwritev(2) if io_uring "
+            "is not available.");
+TAG_FLAG(env_use_io_uring, advanced);
+TAG_FLAG(env_use_io_uring, experimental);
+
 static __thread uint64_t thread_local_id;
 static Atomic64 cur_thread_local_id_;
 
@@ -376,6 +392,120 @@ ssize_t pwritevsim(int fd, const struct iovec* iovec, int count, off_t offset) {
 
 #endif
 
+// The number of operations each thread's io_uring can batch together.
+constexpr uint32_t kIoUringEntries = 32;
+
+// A lazily-created io_uring for the current thread.
+class ThreadIoUring {
+ public:
+  // Returns the calling thread's ring, or nullptr if io_uring is not
+  // available.
+  static IoUring* Get() {
+    // Disable leak check. LSAN sometimes gets false positives on thread locals.
+    // See: https://github.com/google/sanitizers/issues/757
+    debug::ScopedLeakCheckDisabler d;
+    BLOCK_STATIC_THREAD_LOCAL(ThreadIoUring, ring);
+    return ring->ring_.get();
+  }
+
+  ThreadIoUring() {
+    Status s = IoUring::Create(kIoUringEntries, &ring_);
+    if (!s.ok()) {
+      KLOG_FIRST_N(WARNING, 1) << "unable to use io_uring, falling back to "
+                               << "blocking system calls: " << s.ToString();
+      ring_.reset();
+    }
+  }
+
+ private:
+  unique_ptr<IoUring> ring_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadIoUring);
+};
+
+// Reads or writes the 'iov_count' iovecs at 'iov' at 'offset' of 'fd' with
+// as many IOV_MAX-sized operations as fit in 'ring', all submitted at once.
+// Returns the number of bytes transferred contiguously from 'offset', or -1
+// and sets errno if nothing was transferred.
+ssize_t DoVectorIOWithRing(IoUring* ring, bool write, int fd, const struct iovec* iov,
+                           size_t iov_count, uint64_t offset) {
+  DCHECK_EQ(0, ring->num_queued());
+  vector<size_t> lengths;
+  for (size_t i = 0; i < iov_count && ring->num_queued() < ring->capacity(); i += IOV_MAX) {
+    const int count = std::min(iov_count - i, static_cast<size_t>(IOV_MAX));
+    size_t length = 0;
+    for (int j = 0; j < count; j++) {
+      length += iov[i + j].iov_len;
+    }
+    if (write) {
+      ring->PrepareWriteV(fd, iov + i, count, offset);
+    } else {
+      ring->PrepareReadV(fd, iov + i, count, offset);
+    }
+    lengths.push_back(length);
+    offset += length;
+  }
+  vector<int> results;
+  Status s = ring->SubmitAndWait(&results);
+  if (PREDICT_FALSE(!s.ok())) {
+    errno = s.posix_code();
+    return -1;
+  }
+  // A short transfer in one operation leaves a gap before the data
+  // transferred by the following ones, so stop counting at the first one.
+  ssize_t transferred = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (PREDICT_FALSE(results[i] < 0)) {
+      if (transferred == 0) {
+        errno = -results[i];
+        return -1;
+      }
+      break;
+    }
+    transferred += results[i];
+    if (PREDICT_FALSE(results[i] < lengths[i])) {
+      break;
+    }
+  }
+  return transferred;
+}
+
+// Like preadv(2), but 'iov_count' may be greater than IOV_MAX. Not all of the
+// data may be read even if it is available, like with a short read.
+ssize_t DoPreadV(int fd, const struct iovec* iov, size_t iov_count, uint64_t offset) {
+  if (PREDICT_FALSE(FLAGS_env_use_io_uring && iov_count > IOV_MAX)) {
+    IoUring* ring = ThreadIoUring::Get();
+    if (ring) {
+      return DoVectorIOWithRing(ring, /*write=*/false, fd, iov, iov_count, offset);
+    }
+  }
+  // Never request more than IOV_MAX in one request.
+  iov_count = std::min(iov_count, static_cast<size_t>(IOV_MAX));
+#if defined(__APPLE__)
+  return preadvsim(fd, iov, iov_count, offset);
+#else
+  return preadv(fd, iov, iov_count, offset);
+#endif
+}
+
+// Like pwritev(2), but 'iov_count' may be greater than IOV_MAX. Not all of
+// the data may be written, like with a short write.
+ssize_t DoPwriteV(int fd, const struct iovec* iov, size_t iov_count, uint64_t offset) {
+  if (PREDICT_FALSE(FLAGS_env_use_io_uring && iov_count > IOV_MAX)) {
+    IoUring* ring = ThreadIoUring::Get();
+    if (ring) {
+      return DoVectorIOWithRing(ring, /*write=*/true, fd, iov, iov_count, offset);
+    }
+  }
+  // Never request more than IOV_MAX in one request.
+  iov_count = std::min(iov_count, static_cast<size_t>(IOV_MAX));
+#if defined(__APPLE__)
+  return pwritevsim(fd, iov, iov_count, offset);
+#else
+  return pwritev(fd, iov, iov_count, offset);
+#endif
+}
+
 void DoClose(int fd) {
   int err;
   RETRY_ON_EINTR(err, close(fd));
@@ -589,14 +719,8 @@ Status DoReadV(
   size_t completed_iov = 0;
   size_t rem = bytes_req;
   while (rem > 0) {
-    // Never request more than IOV_MAX in one request
-    size_t iov_count = std::min(iov_size - completed_iov, static_cast<size_t>(IOV_MAX));
     ssize_t r;
-#if defined(__APPLE__)
-    RETRY_ON_EINTR(r, preadvsim(fd, iov + completed_iov, iov_count, cur_offset));
-#else
-    RETRY_ON_EINTR(r, preadv(fd, iov + completed_iov, iov_count, cur_offset));
-#endif
+    RETRY_ON_EINTR(r, DoPreadV(fd, iov + completed_iov, iov_size - completed_iov, cur_offset));
     // Fake a short read for testing
     if (PREDICT_FALSE(FLAGS_env_inject_short_read_bytes > 0 && rem == bytes_req)) {
       DCHECK_LT(FLAGS_env_inject_short_read_bytes, r);
@@ -694,14 +818,8 @@ Status DoWriteV(
   size_t completed_iov = 0;
   size_t rem = bytes_req;
   while (rem > 0) {
-    // Never request more than IOV_MAX in one request.
-    size_t iov_count = std::min(iov_size - completed_iov, static_cast<size_t>(IOV_MAX));
     ssize_t w;
-#if defined(__APPLE__)
-    RETRY_ON_EINTR(w, pwritevsim(fd, iov + completed_iov, iov_count, cur_offset));
-#else
-    RETRY_ON_EINTR(w, pwritev(fd, iov + completed_iov, iov_count, cur_offset));
-#endif
+    RETRY_ON_EINTR(w, DoPwriteV(fd, iov + completed_iov, iov_size - completed_iov, cur_offset));
     // Fake a short write for testing.
     if (PREDICT_FALSE(FLAGS_env_inject_short_write_bytes > 0 && rem == bytes_req)) {
       DCHECK_LT(FLAGS_env_inject_short_write_bytes, w);
@@ -741,6 +859,217 @@ Status DoWriteV(
   return Status::OK();
 }
 
+// The alignment of the offsets, sizes and memory buffers used for direct
+// I/O. The logical block size of devices is at most 4KiB in practice.
+constexpr size_t kDirectIOAlignment = 4096;
+
+// Each thread caches a buffer of this size for direct I/O of up to this many
+// bytes, so that small reads and writes don't need to allocate memory.
+constexpr size_t kCachedDirectIOBufferSize = 1024 * 1024;
+
+// A memory buffer which is suitably aligned for direct I/O.
+class DirectIOBuffer {
+ public:
+  explicit DirectIOBuffer(size_t size) {
+    if (size <= kCachedDirectIOBufferSize) {
+      ThreadCache* cache = ThreadCache::Get();
+      std::swap(data_, cache->buffer);
+      size = kCachedDirectIOBufferSize;
+    }
+    if (!data_) {
+      void* data;
+      CHECK_EQ(0, posix_memalign(&data, kDirectIOAlignment, size));
+      data_ = static_cast<uint8_t*>(data);
+    }
+    size_ = size;
+  }
+
+  ~DirectIOBuffer() {
+    if (size_ == kCachedDirectIOBufferSize) {
+      ThreadCache* cache = ThreadCache::Get();
+      if (!cache->buffer) {
+        cache->buffer = data_;
+        return;
+      }
+    }
+    free(data_);
+  }
+
+  uint8_t* data() const { return data_; }
+
+ private:
+  struct ThreadCache {
+    ~ThreadCache() {
+      free(buffer);
+    }
+
+    static ThreadCache* Get() {
+      // Disable leak check. LSAN sometimes gets false positives on thread locals.
+      // See: https://github.com/google/sanitizers/issues/757
+      debug::ScopedLeakCheckDisabler d;
+      BLOCK_STATIC_THREAD_LOCAL(ThreadCache, cache);
+      return cache;
+    }
+
+    uint8_t* buffer = nullptr;
+  };
+
+  uint8_t* data_ = nullptr;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectIOBuffer);
+};
+
+// Reads up to 'length' bytes at 'offset' of 'fd', which was opened for direct
+// I/O, into 'buf', stopping at the end of the file. Sets 'bytes_read' to the
+// number of bytes read.
+Status DoDirectPread(int fd, const string& filename, uint64_t offset, uint8_t* buf,
+                     size_t length, size_t* bytes_read) {
+  DCHECK_EQ(0, offset % kDirectIOAlignment);
+  DCHECK_EQ(0, length % kDirectIOAlignment);
+  size_t done = 0;
+  while (done < length) {
+    ssize_t r;
+    RETRY_ON_EINTR(r, pread(fd, buf + done, length - done, offset + done));
+    if (PREDICT_FALSE(r < 0)) {
+      return IOError(filename, errno);
+    }
+    done += r;
+    // A read which isn't a multiple of the alignment can only be at the end
+    // of the file, and couldn't be continued from an unaligned offset anyway.
+    if (r == 0 || r % kDirectIOAlignment != 0) {
+      break;
+    }
+  }
+  *bytes_read = done;
+  return Status::OK();
+}
+
+// Like DoReadV(), but for files opened for direct I/O: reads the aligned
+// range which contains the requested one into a bounce buffer.
+Status DoReadVDirect(
+    int fd,
+    const string& filename,
+    uint64_t offset,
+    ArrayView<Slice> results,
+    const EncryptionHeader* eh) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  ThreadRestrictions::AssertIOAllowed();
+
+  size_t bytes_req = 0;
+  for (const auto& result : results) {
+    bytes_req += result.size();
+  }
+  const uint64_t start = KUDU_ALIGN_DOWN(offset, kDirectIOAlignment);
+  const uint64_t end = KUDU_ALIGN_UP(offset + bytes_req, kDirectIOAlignment);
+  DirectIOBuffer buf(end - start);
+  size_t bytes_read;
+  RETURN_NOT_OK(DoDirectPread(fd, filename, start, buf.data(), end - start, &bytes_read));
+  if (PREDICT_FALSE(bytes_read < offset - start + bytes_req)) {
+    return Status::EndOfFile(
+        Substitute("EOF trying to read $0 bytes at offset $1", bytes_req, offset));
+  }
+  const uint8_t* src = buf.data() + (offset - start);
+  for (auto& result : results) {
+    memcpy(result.mutable_data(), src, result.size());
+    src += result.size();
+  }
+  if (eh) {
+    RETURN_NOT_OK(DoDecryptV(eh, offset, results));
+  }
+  return Status::OK();
+}
+
+// Like DoWriteV(), but for files opened for direct I/O: writes the aligned
+// range which contains the requested one from a bounce buffer. The parts of
+// the first and last aligned blocks outside of the requested range are
+// filled in with the existing contents of the file.
+Status DoWriteVDirect(
+    int fd,
+    const string& filename,
+    uint64_t offset,
+    ArrayView<const Slice> data,
+    const EncryptionHeader* eh) {
+  MAYBE_RETURN_EIO(filename, IOError(Env::kInjectedFailureStatusMsg, EIO));
+  ThreadRestrictions::AssertIOAllowed();
+
+  size_t bytes_req = 0;
+  for (const auto& d : data) {
+    bytes_req += d.size();
+  }
+  if (bytes_req == 0) {
+    return Status::OK();
+  }
+  const uint64_t data_end = offset + bytes_req;
+  const uint64_t start = KUDU_ALIGN_DOWN(offset, kDirectIOAlignment);
+  const uint64_t end = KUDU_ALIGN_UP(data_end, kDirectIOAlignment);
+  DirectIOBuffer buf(end - start);
+  auto fill_block = [&](uint64_t block_offset) {
+    uint8_t* block = buf.data() + (block_offset - start);
+    memset(block, 0, kDirectIOAlignment);
+    size_t ignored;
+    return DoDirectPread(fd, filename, block_offset, block, kDirectIOAlignment, &ignored);
+  };
+  if (offset != start) {
+    RETURN_NOT_OK(fill_block(start));
+  }
+  const uint64_t last_block = end - kDirectIOAlignment;
+  if (data_end != end && (last_block != start || offset == start)) {
+    RETURN_NOT_OK(fill_block(last_block));
+  }
+
+  uint8_t* dst = buf.data() + (offset - start);
+  if (eh) {
+    vector<Slice> ciphertext;
+    ciphertext.reserve(data.size());
+    for (const auto& d : data) {
+      ciphertext.emplace_back(dst, d.size());
+      dst += d.size();
+    }
+    RETURN_NOT_OK(DoEncryptV(eh, offset, data, ciphertext));
+  } else {
+    for (const auto& d : data) {
+      memcpy(dst, d.data(), d.size());
+      dst += d.size();
+    }
+  }
+
+  struct stat st;
+  if (PREDICT_FALSE(fstat(fd, &st) < 0)) {
+    return IOError(filename, errno);
+  }
+  const Slice aligned(buf.data(), end - start);
+  RETURN_NOT_OK(DoWriteV(fd, filename, start, ArrayView<const Slice>(&aligned, 1), nullptr));
+
+  // Writing the whole last block may have extended the file past the end of
+  // the data; restore the size it'd have had with a regular write.
+  const uint64_t expected_size = std::max<uint64_t>(st.st_size, data_end);
+  if (end > expected_size) {
+    int ret;
+    RETRY_ON_EINTR(ret, ftruncate(fd, expected_size));
+    if (PREDICT_FALSE(ret != 0)) {
+      return IOError(filename, errno);
+    }
+  }
+  return Status::OK();
+}
+
+// Enables direct I/O on 'fd'. Returns false if the filesystem doesn't
+// support it.
+bool EnableDirectIO(int fd, const string& filename) {
+#if defined(__linux__)
+  int flags = fcntl(fd, F_GETFL);
+  if (flags >= 0 && fcntl(fd, F_SETFL, flags | O_DIRECT) == 0) {
+    return true;
+  }
+  KLOG_FIRST_N(WARNING, 1) << Substitute("unable to use direct I/O for $0: $1",
+                                         filename, ErrnoToString(errno));
+#else
+  KLOG_FIRST_N(WARNING, 1) << "direct I/O is not supported on this platform";
+#endif
+  return false;
+}
+
 Status GenerateHeader(EncryptionHeader* eh) {
   switch (FLAGS_encryption_key_length) {
     case 128:
@@ -821,6 +1150,17 @@ Status DoIsOnXfsFilesystem(const string& path, bool* result) {
   return Status::OK();
 }
 
+// Returns whether the kernel release 'release' (e.g. "5.10.0-19-amd64") is at
+// least version 'major'.'minor'.
+bool KernelAtLeast(const string& release, int major, int minor) {
+  int rel_major = 0;
+  int rel_minor = 0;
+  if (sscanf(release.c_str(), "%d.%d", &rel_major, &rel_minor) != 2) {
+    return false;
+  }
+  return rel_major > major || (rel_major == major && rel_minor >= minor);
+}
+
 Status ReadEncryptionHeader(int fd, const string& filename, const EncryptionHeader& server_key,
                             EncryptionHeader* eh) {
   char magic[7];
@@ -1215,29 +1555,31 @@ class PosixWritableFile : public WritableFile {
 class PosixRWFile : public RWFile {
  public:
   PosixRWFile(string fname, int fd, bool sync_on_close, bool encrypted,
-              EncryptionHeader eh)
+              EncryptionHeader eh, bool direct_io)
       : filename_(std::move(fname)),
         fd_(fd),
         sync_on_close_(sync_on_close),
         is_on_xfs_(false),
         closed_(false),
         encrypted_(encrypted),
-        encryption_header_(eh) {}
+        encryption_header_(eh),
+        direct_io_(direct_io) {}
 
   ~PosixRWFile() {
     WARN_NOT_OK(Close(), "Failed to close " + filename_);
   }
 
   virtual Status Read(uint64_t offset, Slice result) const OVERRIDE {
-    DCHECK_GE(offset, GetEncryptionHeaderSize());
-    return DoReadV(fd_, filename_, offset, ArrayView<Slice>(&result, 1),
-                   encrypted_ ? &encryption_header_ : nullptr);
+    return ReadV(offset, ArrayView<Slice>(&result, 1));
   }
 
   virtual Status ReadV(uint64_t offset, ArrayView<Slice> results) const OVERRIDE {
     DCHECK_GE(offset, GetEncryptionHeaderSize());
-    return DoReadV(fd_, filename_, offset, results,
-                   encrypted_ ? &encryption_header_ : nullptr);
+    const EncryptionHeader* eh = encrypted_ ? &encryption_header_ : nullptr;
+    if (direct_io_) {
+      return DoReadVDirect(fd_, filename_, offset, results, eh);
+    }
+    return DoReadV(fd_, filename_, offset, results, eh);
   }
 
   virtual Status Write(uint64_t offset, const Slice& data) OVERRIDE {
@@ -1246,8 +1588,11 @@ class PosixRWFile : public RWFile {
 
   virtual Status WriteV(uint64_t offset, ArrayView<const Slice> data) OVERRIDE {
     DCHECK_GE(offset, GetEncryptionHeaderSize());
-    return DoWriteV(fd_, filename_, offset, data,
-                    encrypted_ ? &encryption_header_ : nullptr);
+    const EncryptionHeader* eh = encrypted_ ? &encryption_header_ : nullptr;
+    if (direct_io_) {
+      return DoWriteVDirect(fd_, filename_, offset, data, eh);
+    }
+    return DoWriteV(fd_, filename_, offset, data, eh);
   }
 
   virtual Status PreAllocate(uint64_t offset,
@@ -1329,6 +1674,35 @@ class PosixRWFile : public RWFile {
 #endif
   }
 
+  virtual Status ZeroRange(uint64_t offset, size_t length) OVERRIDE {
+    TRACE_EVENT1("io", "PosixRWFile::ZeroRange", "path", filename_);
+    MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+#if defined(__linux__)
+    int ret;
+    RETRY_ON_EINTR(ret, fallocate(fd_, FALLOC_FL_ZERO_RANGE, offset, length));
+    if (ret == 0) {
+      return Status::OK();
+    }
+    if (errno != EOPNOTSUPP && errno != ENOSYS) {
+      return IOError(filename_, errno);
+    }
+#endif
+    if (direct_io_) {
+      return Status::NotSupported("zeroing a range of a file opened for direct I/O");
+    }
+    // Write the zeros out.
+    constexpr size_t kChunkSize = 1024 * 1024;
+    const string zeros(std::min(length, kChunkSize), '\0');
+    while (length > 0) {
+      const size_t n = std::min(length, zeros.size());
+      RETURN_NOT_OK(Write(offset, Slice(zeros.data(), n)));
+      offset += n;
+      length -= n;
+    }
+    return Status::OK();
+  }
+
   virtual Status Flush(FlushMode mode, uint64_t offset, size_t length) OVERRIDE {
     TRACE_EVENT1("io", "PosixRWFile::Flush", "path", filename_);
     MAYBE_RETURN_EIO(filename_, IOError(Env::kInjectedFailureStatusMsg, EIO));
@@ -1491,6 +1865,9 @@ class PosixRWFile : public RWFile {
   bool closed_;
   const bool encrypted_;
   const EncryptionHeader encryption_header_;
+
+  // Whether the file was opened with O_DIRECT.
+  const bool direct_io_;
 };
 
 int LockOrUnlock(int fd, bool lock) {
@@ -1637,8 +2014,11 @@ class PosixEnv : public Env {
         RETURN_NOT_OK(WriteEncryptionHeader(fd, fname, *server_key_, eh));
       }
     }
+    // The encryption header is read and written with regular I/O, so direct
+    // I/O is only enabled afterwards.
+    bool direct_io = opts.direct_io && EnableDirectIO(fd, fname);
     result->reset(new PosixRWFile(fname, fd, opts.sync_on_close,
-                                  encrypt, eh));
+                                  encrypt, eh, direct_io));
     return Status::OK();
   }
 
@@ -1654,8 +2034,9 @@ class PosixEnv : public Env {
       RETURN_NOT_OK(GenerateHeader(&eh));
       RETURN_NOT_OK(WriteEncryptionHeader(fd, *created_filename, *server_key_, eh));
     }
+    bool direct_io = opts.direct_io && EnableDirectIO(fd, *created_filename);
     res->reset(new PosixRWFile(*created_filename, fd, opts.sync_on_close,
-                               encrypt, eh));
+                               encrypt, eh, direct_io));
     return Status::OK();
   }
 
@@ -1767,6 +2148,55 @@ class PosixEnv : public Env {
     return Status::OK();
   }
 
+  virtual Status SyncFilesystem(const string& path) OVERRIDE {
+    TRACE_EVENT1("io", "SyncFilesystem", "path", path);
+    MAYBE_RETURN_EIO(path, IOError(Env::kInjectedFailureStatusMsg, EIO));
+    ThreadRestrictions::AssertIOAllowed();
+    if (FLAGS_never_fsync) return Status::OK();
+#if defined(__linux__)
+    // Before Linux 5.8, syncfs() doesn't report writeback errors at all.
+    static const bool kSyncfsReportsErrors = KernelAtLeast(GetKernelRelease(), 5, 8);
+    if (!kSyncfsReportsErrors) {
+      return Status::NotSupported("syncfs() doesn't report write errors on this kernel");
+    }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+      return IOError(path, errno);
+    }
+    SyncfsState* state;
+    {
+      std::lock_guard<std::mutex> l(syncfs_states_lock_);
+      auto& s = syncfs_states_[st.st_dev];
+      if (!s) {
+        s.reset(new SyncfsState);
+      }
+      state = s.get();
+    }
+    // syncfs() only reports the writeback errors that happened since its fd
+    // was opened, and reports each of them once per fd. So the fd is kept open
+    // for the lifetime of the process, the syncs of a filesystem are
+    // serialized so that no caller misses an error reported to another, and a
+    // failure is returned to every later caller too.
+    std::lock_guard<std::mutex> l(state->lock);
+    RETURN_NOT_OK(state->error);
+    if (state->fd < 0) {
+      int fd;
+      RETRY_ON_EINTR(fd, open(path.c_str(), O_RDONLY));
+      if (fd < 0) {
+        return IOError(path, errno);
+      }
+      state->fd = fd;
+    }
+    if (syncfs(state->fd) != 0) {
+      state->error = IOError(path, errno);
+      return state->error;
+    }
+    return Status::OK();
+#else
+    return Status::NotSupported("syncing a whole filesystem is not supported on this platform");
+#endif
+  }
+
   virtual Status DeleteRecursively(const string &name) OVERRIDE {
     return Walk(
         name, POST_ORDER,
@@ -2399,6 +2829,21 @@ class PosixEnv : public Env {
   }
 
   std::optional<EncryptionHeader> server_key_;
+
+  // The state of the syncs of one filesystem by SyncFilesystem().
+  struct SyncfsState {
+    std::mutex lock;
+    // The fd the filesystem is synced through, or -1 if none was opened yet.
+    // Never closed.
+    int fd = -1;
+    // The first error of a sync of the filesystem.
+    Status error;
+  };
+
+  // Protects 'syncfs_states_', but not its entries.
+  std::mutex syncfs_states_lock_;
+  // The sync state of each filesystem, by device. Entries are never removed.
+  std::map<dev_t, unique_ptr<SyncfsState>> syncfs_states_;
 };
 
 }  // namespace
@@ -281,6 +281,12 @@ class Descriptor<RWFile> : public RWFile {
     return opened.file()->PunchHole(offset, length);
   }
 
+  Status ZeroRange(uint64_t offset, size_t length) override {
+    ScopedOpenedDescriptor<RWFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary<Env::MUST_EXIST>(&opened));
+    return opened.file()->ZeroRange(offset, length);
+  }
+
   Status Flush(FlushMode mode, uint64_t offset, size_t length) override {
     ScopedOpenedDescriptor<RWFile> opened(&base_);
     RETURN_NOT_OK(ReopenFileIfNecessary<Env::MUST_EXIST>(&opened));
@@ -351,6 +357,7 @@ class Descriptor<RWFile> : public RWFile {
     RWFileOptions opts;
     opts.mode = Mode;
     opts.is_sensitive = true;
+    opts.direct_io = direct_io_;
     unique_ptr<RWFile> f;
     RETURN_NOT_OK(base_.env()->NewRWFile(opts, base_.filename(), &f));
 
@@ -365,6 +372,10 @@ class Descriptor<RWFile> : public RWFile {
   BaseDescriptor<RWFile> base_;
   KuduOnceDynamic once_;
 
+  // Whether the file is opened for direct I/O. Set when the descriptor is
+  // created.
+  bool direct_io_ = false;
+
   DISALLOW_COPY_AND_ASSIGN(Descriptor);
 };
 
@@ -508,6 +519,7 @@ Status FileCache::Init() {
 
 template <>
 Status FileCache::DoOpenFile(const string& file_name,
+                             bool direct_io,
                              shared_ptr<internal::Descriptor<RWFile>>* file,
                              bool* created_desc) {
   shared_ptr<internal::Descriptor<RWFile>> d;
@@ -517,6 +529,11 @@ Status FileCache::DoOpenFile(const string& file_name,
     d = FindDescriptorUnlocked(file_name, FindMode::CREATE_IF_NOT_EXIST,
                                &rwf_descs_, &cd);
     DCHECK(d);
+    if (cd) {
+      d->direct_io_ = direct_io;
+    } else {
+      DCHECK_EQ(direct_io, d->direct_io_) << file_name;
+    }
 
 #ifndef NDEBUG
     // Enforce the invariant that a particular file name may only be used by one
@@ -536,8 +553,10 @@ Status FileCache::DoOpenFile(const string& file_name,
 
 template <>
 Status FileCache::DoOpenFile(const string& file_name,
+                             bool direct_io,
                              shared_ptr<internal::Descriptor<RandomAccessFile>>* file,
                              bool* created_desc) {
+  DCHECK(!direct_io) << "direct I/O is only supported for RWFiles";
   shared_ptr<internal::Descriptor<RandomAccessFile>> d;
   bool cd;
   {
@@ -564,10 +583,11 @@ Status FileCache::DoOpenFile(const string& file_name,
 
 template <>
 Status FileCache::OpenFile<Env::CREATE_OR_OPEN>(const string& file_name,
-                                                shared_ptr<RWFile>* file) {
+                                                shared_ptr<RWFile>* file,
+                                                bool direct_io) {
   shared_ptr<internal::Descriptor<RWFile>> d;
   bool ignored;
-  RETURN_NOT_OK(DoOpenFile(file_name, &d, &ignored));
+  RETURN_NOT_OK(DoOpenFile(file_name, direct_io, &d, &ignored));
 
   // Check that the underlying file can be opened (no-op for found descriptors).
   RETURN_NOT_OK(d->Init<Env::CREATE_OR_OPEN>());
@@ -577,10 +597,11 @@ Status FileCache::OpenFile<Env::CREATE_OR_OPEN>(const string& file_name,
 
 template <>
 Status FileCache::OpenFile<Env::MUST_CREATE>(const string& file_name,
-                                             shared_ptr<RWFile>* file) {
+                                             shared_ptr<RWFile>* file,
+                                             bool direct_io) {
   shared_ptr<internal::Descriptor<RWFile>> d;
   bool created_desc;
-  RETURN_NOT_OK(DoOpenFile(file_name, &d, &created_desc));
+  RETURN_NOT_OK(DoOpenFile(file_name, direct_io, &d, &created_desc));
 
   if (!created_desc) {
     return Status::AlreadyPresent("file already exists", file_name);
@@ -594,10 +615,11 @@ Status FileCache::OpenFile<Env::MUST_CREATE>(const string& file_name,
 
 template <>
 Status FileCache::OpenFile<Env::MUST_EXIST>(const string& file_name,
-                                            shared_ptr<RWFile>* file) {
+                                            shared_ptr<RWFile>* file,
+                                            bool direct_io) {
   shared_ptr<internal::Descriptor<RWFile>> d;
   bool ignored;
-  RETURN_NOT_OK(DoOpenFile(file_name, &d, &ignored));
+  RETURN_NOT_OK(DoOpenFile(file_name, direct_io, &d, &ignored));
 
   // Check that the underlying file can be opened (no-op for found descriptors).
   RETURN_NOT_OK(d->Init<Env::MUST_EXIST>());
@@ -607,10 +629,11 @@ Status FileCache::OpenFile<Env::MUST_EXIST>(const string& file_name,
 
 template <>
 Status FileCache::OpenFile<Env::MUST_EXIST>(const string& file_name,
-                                            shared_ptr<RandomAccessFile>* file) {
+                                            shared_ptr<RandomAccessFile>* file,
+                                            bool direct_io) {
   shared_ptr<internal::Descriptor<RandomAccessFile>> d;
   bool ignored;
-  RETURN_NOT_OK(DoOpenFile(file_name, &d, &ignored));
+  RETURN_NOT_OK(DoOpenFile(file_name, direct_io, &d, &ignored));
 
   // Check that the underlying file can be opened (no-op for found descriptors).
   RETURN_NOT_OK(d->Init());
@@ -133,9 +133,14 @@ class FileCache {
   // recreated, and truncate it so it's empty for the second client, but the
   // truncation would corrupt the file for the first client. In short, take
   // great care when using any mode apart from MUST_EXIST.
+  //
+  // If 'direct_io' is true, the file is opened for direct I/O; see
+  // RWFileOptions::direct_io. Only RWFiles support direct I/O, and all opens
+  // of a particular file must agree on it while the file is in use.
   template <Env::OpenMode Mode, class FileType>
   Status OpenFile(const std::string& file_name,
-                  std::shared_ptr<FileType>* file);
+                  std::shared_ptr<FileType>* file,
+                  bool direct_io = false);
 
   // Deletes a file by name through the cache.
   //
@@ -222,6 +227,7 @@ class FileCache {
   // OpenFile because C++ prohibits partial specialization of template functions.
   template <class FileType>
   Status DoOpenFile(const std::string& file_name,
+                    bool direct_io,
                     std::shared_ptr<FileType>* file,
                     bool* created_desc);
 
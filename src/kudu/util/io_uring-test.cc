@@ -0,0 +1,174 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/io_uring.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags_declare.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/array_view.h"
+#include "kudu/util/env.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+DECLARE_bool(env_use_io_uring);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+
+class IoUringTest : public KuduTest {
+ public:
+  void SetUp() override {
+    KuduTest::SetUp();
+    Status s = IoUring::Create(8, &ring_);
+    if (s.IsNotSupported()) {
+      LOG(WARNING) << "skipping test: " << s.ToString();
+      return;
+    }
+    ASSERT_OK(s);
+    path_ = GetTestPath("file");
+    fd_ = open(path_.c_str(), O_CREAT | O_RDWR, 0644);
+    ASSERT_GE(fd_, 0) << strerror(errno);
+  }
+
+  void TearDown() override {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    KuduTest::TearDown();
+  }
+
+ protected:
+  unique_ptr<IoUring> ring_;
+  string path_;
+  int fd_ = -1;
+};
+
+TEST_F(IoUringTest, TestReadWrite) {
+  if (!ring_) return;
+  ASSERT_GE(ring_->capacity(), 8);
+
+  // Write two buffers with separate operations in one batch.
+  char a[] = "hello ";
+  char b[] = "world";
+  struct iovec write_iov[] = { { a, strlen(a) }, { b, strlen(b) } };
+  ring_->PrepareWriteV(fd_, &write_iov[0], 1, 0);
+  ring_->PrepareWriteV(fd_, &write_iov[1], 1, strlen(a));
+  ring_->PrepareFsync(fd_, /*datasync=*/true);
+  ASSERT_EQ(3, ring_->num_queued());
+  vector<int> results;
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_EQ(0, ring_->num_queued());
+  ASSERT_EQ((vector<int>{ 6, 5, 0 }), results);
+
+  // Read them back into a single buffer, and past the end of the file.
+  char buf[11];
+  char past_end[4];
+  struct iovec read_iov[] = { { buf, sizeof(buf) }, { past_end, sizeof(past_end) } };
+  ring_->PrepareReadV(fd_, &read_iov[0], 1, 0);
+  ring_->PrepareReadV(fd_, &read_iov[1], 1, sizeof(buf));
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_EQ((vector<int>{ 11, 0 }), results);
+  ASSERT_EQ("hello world", string(buf, sizeof(buf)));
+
+  // Errors are reported per operation.
+  ring_->PrepareReadV(-1, &read_iov[0], 1, 0);
+  ring_->PrepareReadV(fd_, &read_iov[0], 1, 0);
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_EQ((vector<int>{ -EBADF, 11 }), results);
+
+  // An empty batch is a no-op.
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_TRUE(results.empty());
+}
+
+TEST_F(IoUringTest, TestLinkedOperations) {
+  if (!ring_) return;
+  char data[] = "data";
+  struct iovec iov = { data, strlen(data) };
+
+  // The sync only runs once the write completed successfully.
+  ring_->PrepareWriteV(fd_, &iov, 1, 0);
+  ring_->LinkWithNext();
+  ring_->PrepareFsync(fd_, /*datasync=*/false);
+  vector<int> results;
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_EQ((vector<int>{ 4, 0 }), results);
+
+  // If the write fails, the sync is cancelled.
+  ring_->PrepareWriteV(-1, &iov, 1, 0);
+  ring_->LinkWithNext();
+  ring_->PrepareFsync(fd_, /*datasync=*/false);
+  ASSERT_OK(ring_->SubmitAndWait(&results));
+  ASSERT_EQ((vector<int>{ -EBADF, -ECANCELED }), results);
+}
+
+// Test that the Env reads and writes more than IOV_MAX slices at a time
+// correctly when using io_uring.
+TEST_F(IoUringTest, TestEnvVectorIO) {
+  if (!ring_) return;
+  FLAGS_env_use_io_uring = true;
+
+  const size_t kSliceCount = IOV_MAX * 3 + 42;
+  const size_t kSliceSize = 3;
+  vector<uint8_t> data(kSliceCount * kSliceSize);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = i * 31;
+  }
+  vector<Slice> write_slices;
+  for (size_t i = 0; i < kSliceCount; i++) {
+    write_slices.emplace_back(&data[i * kSliceSize], kSliceSize);
+  }
+  unique_ptr<RWFile> file;
+  const string path = GetTestPath("env_file");
+  ASSERT_OK(env_->NewRWFile(RWFileOptions(), path, &file));
+  const uint64_t offset = file->GetEncryptionHeaderSize();
+  ASSERT_OK(file->WriteV(offset, write_slices));
+
+  vector<uint8_t> read_data(data.size());
+  vector<Slice> read_slices;
+  for (size_t i = 0; i < kSliceCount; i++) {
+    read_slices.emplace_back(&read_data[i * kSliceSize], kSliceSize);
+  }
+  ASSERT_OK(file->ReadV(offset, read_slices));
+  ASSERT_EQ(data, read_data);
+
+  // Reading past the end of the file fails.
+  read_slices.emplace_back(&read_data[0], 1);
+  Status s = file->ReadV(offset, read_slices);
+  ASSERT_TRUE(s.IsEndOfFile()) << s.ToString();
+}
+
+} // namespace kudu
@@ -0,0 +1,255 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/io_uring.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/util/errno.h"
+
+// The kernel headers may be recent enough to define the io_uring structures
+// but the C library may not know about the system calls yet.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#define KUDU_HAVE_IO_URING 1
+#endif
+
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+
+#if defined(KUDU_HAVE_IO_URING)
+
+namespace {
+
+Status IoUringError(const char* what, int err) {
+  return Status::IOError(what, ErrnoToString(err), err);
+}
+
+} // anonymous namespace
+
+Status IoUring::Create(uint32_t entries, unique_ptr<IoUring>* ring) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    int err = errno;
+    // Old kernels don't have the system call, and seccomp policies (e.g. in
+    // containers) may forbid it.
+    if (err == ENOSYS || err == EPERM) {
+      return Status::NotSupported("io_uring is not available", ErrnoToString(err), err);
+    }
+    return IoUringError("io_uring_setup failed", err);
+  }
+  unique_ptr<IoUring> r(new IoUring);
+  r->ring_fd_ = fd;
+  r->sq_entries_ = params.sq_entries;
+
+  r->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  r->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    r->sq_ring_size_ = std::max(r->sq_ring_size_, r->cq_ring_size_);
+  }
+  void* sq_ring = mmap(nullptr, r->sq_ring_size_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return IoUringError("unable to map io_uring submission queue", errno);
+  }
+  r->sq_ring_ = sq_ring;
+  if (single_mmap) {
+    r->cq_ring_ = sq_ring;
+    r->cq_ring_size_ = 0;
+  } else {
+    void* cq_ring = mmap(nullptr, r->cq_ring_size_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return IoUringError("unable to map io_uring completion queue", errno);
+    }
+    r->cq_ring_ = cq_ring;
+  }
+  r->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, r->sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return IoUringError("unable to map io_uring submission queue entries", errno);
+  }
+  r->sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  uint8_t* sq = static_cast<uint8_t*>(r->sq_ring_);
+  r->sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+  r->sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+  r->sq_mask_ = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+  r->sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+  uint8_t* cq = static_cast<uint8_t*>(r->cq_ring_);
+  r->cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+  r->cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+  r->cq_mask_ = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+  r->cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  *ring = std::move(r);
+  return Status::OK();
+}
+
+IoUring::~IoUring() {
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+struct io_uring_sqe* IoUring::NextSqe() {
+  CHECK_LT(queued_, sq_entries_) << "too many queued io_uring operations";
+  // Only this thread writes the tail, so it doesn't need to be read
+  // atomically. It is published in SubmitAndWait().
+  uint32_t index = (*sq_tail_ + queued_) & sq_mask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = queued_;
+  sq_array_[index] = index;
+  queued_++;
+  return sqe;
+}
+
+void IoUring::PrepareReadV(int fd, const struct iovec* iov, int iov_count, uint64_t offset) {
+  struct io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(iov);
+  sqe->len = iov_count;
+  sqe->off = offset;
+}
+
+void IoUring::PrepareWriteV(int fd, const struct iovec* iov, int iov_count, uint64_t offset) {
+  struct io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(iov);
+  sqe->len = iov_count;
+  sqe->off = offset;
+}
+
+void IoUring::PrepareFsync(int fd, bool datasync) {
+  struct io_uring_sqe* sqe = NextSqe();
+  sqe->opcode = IORING_OP_FSYNC;
+  sqe->fd = fd;
+  sqe->fsync_flags = datasync ? IORING_FSYNC_DATASYNC : 0;
+}
+
+void IoUring::LinkWithNext() {
+  DCHECK_GT(queued_, 0);
+  uint32_t index = (*sq_tail_ + queued_ - 1) & sq_mask_;
+  sqes_[index].flags |= IOSQE_IO_LINK;
+}
+
+Status IoUring::SubmitAndWait(vector<int>* results) {
+  const size_t num_ops = queued_;
+  results->assign(num_ops, 0);
+  if (num_ops == 0) {
+    return Status::OK();
+  }
+  queued_ = 0;
+  // Publish the new entries to the kernel.
+  __atomic_store_n(sq_tail_, *sq_tail_ + num_ops, __ATOMIC_RELEASE);
+
+  size_t to_submit = num_ops;
+  size_t completed = 0;
+  while (completed < num_ops) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, num_ops - completed,
+                      IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return IoUringError("io_uring_enter failed", errno);
+    }
+    to_submit -= ret;
+
+    // Reap the completions.
+    uint32_t head = *cq_head_;
+    uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      const struct io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      DCHECK_LT(cqe.user_data, num_ops);
+      (*results)[cqe.user_data] = cqe.res;
+      completed++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+  return Status::OK();
+}
+
+#else
+
+Status IoUring::Create(uint32_t /*entries*/, unique_ptr<IoUring>* /*ring*/) {
+  return Status::NotSupported("io_uring is not supported on this platform");
+}
+
+IoUring::~IoUring() {
+}
+
+struct io_uring_sqe* IoUring::NextSqe() {
+  LOG(FATAL) << "io_uring is not supported on this platform";
+  return nullptr;
+}
+
+void IoUring::PrepareReadV(int /*fd*/, const struct iovec* /*iov*/, int /*iov_count*/,
+                           uint64_t /*offset*/) {
+  NextSqe();
+}
+
+void IoUring::PrepareWriteV(int /*fd*/, const struct iovec* /*iov*/, int /*iov_count*/,
+                            uint64_t /*offset*/) {
+  NextSqe();
+}
+
+void IoUring::PrepareFsync(int /*fd*/, bool /*datasync*/) {
+  NextSqe();
+}
+
+void IoUring::LinkWithNext() {
+  NextSqe();
+}
+
+Status IoUring::SubmitAndWait(vector<int>* /*results*/) {
+  return Status::NotSupported("io_uring is not supported on this platform");
+}
+
+#endif // defined(KUDU_HAVE_IO_URING)
+
+} // namespace kudu
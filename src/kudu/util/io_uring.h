@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/status.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace kudu {
+
+// A minimal wrapper around a Linux io_uring instance, used to submit several
+// I/O operations to the kernel with a single system call.
+//
+// The ring is driven with the raw io_uring_setup(2) and io_uring_enter(2)
+// system calls, so no library is required; on platforms or kernels which
+// don't support io_uring, Create() returns Status::NotSupported and callers
+// should fall back to the regular blocking system calls.
+//
+// Operations are queued with the Prepare*() methods and run with
+// SubmitAndWait(). The iovecs passed to PrepareReadV() and PrepareWriteV()
+// must remain valid until SubmitAndWait() returns.
+//
+// This class is not thread-safe; typically each thread has its own ring.
+class IoUring {
+ public:
+  // Creates a ring which can hold up to 'entries' queued operations.
+  static Status Create(uint32_t entries, std::unique_ptr<IoUring>* ring);
+
+  ~IoUring();
+
+  // Queues a preadv(2)/pwritev(2) of the 'iov_count' iovecs at 'iov' to or
+  // from 'offset' in 'fd'.
+  void PrepareReadV(int fd, const struct iovec* iov, int iov_count, uint64_t offset);
+  void PrepareWriteV(int fd, const struct iovec* iov, int iov_count, uint64_t offset);
+
+  // Queues an fsync(2) or, if 'datasync' is true, an fdatasync(2) of 'fd'.
+  void PrepareFsync(int fd, bool datasync);
+
+  // Makes the operation queued last a prerequisite of the next one queued:
+  // the next operation only starts once the last one completes, and fails
+  // with -ECANCELED if the last one fails or is short. This allows e.g.
+  // queuing a write and the sync which makes it durable together.
+  void LinkWithNext();
+
+  // Submits all queued operations and waits for them to complete.
+  //
+  // On success, 'results' holds the result of each operation in the order
+  // they were queued: the number of bytes transferred for reads and writes,
+  // 0 for syncs, or a negated errno value if the operation failed. A
+  // non-OK status means that the ring itself failed; the state of the
+  // queued operations is undefined in that case.
+  Status SubmitAndWait(std::vector<int>* results);
+
+  // The maximum number of operations which may be queued at once.
+  uint32_t capacity() const { return sq_entries_; }
+
+  // The number of operations queued since the last SubmitAndWait().
+  size_t num_queued() const { return queued_; }
+
+ private:
+  IoUring() = default;
+
+  // Returns the next free submission queue entry, cleared. The entry's
+  // user data is set to its position in the batch.
+  struct io_uring_sqe* NextSqe();
+
+  int ring_fd_ = -1;
+
+  // The mapped submission and completion queue rings, and their sizes.
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  // Pointers into the mapped rings.
+  uint32_t* sq_head_ = nullptr;
+  uint32_t* sq_tail_ = nullptr;
+  uint32_t sq_mask_ = 0;
+  uint32_t* sq_array_ = nullptr;
+  uint32_t* cq_head_ = nullptr;
+  uint32_t* cq_tail_ = nullptr;
+  uint32_t cq_mask_ = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+
+  uint32_t sq_entries_ = 0;
+
+  // The number of entries queued in the current batch.
+  size_t queued_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+} // namespace kudu
@@ -0,0 +1,245 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/lock_contention.h"
+
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/metrics.h"
+
+DEFINE_bool(lock_contention_site_profiling, false,
+            "Whether to attribute lock contention to the hot-path lock sites "
+            "(MVCC, lock manager, block cache, memory trackers, RPC service queues "
+            "and catalog manager), exposed as metrics and on the /contention page.");
+TAG_FLAG(lock_contention_site_profiling, experimental);
+TAG_FLAG(lock_contention_site_profiling, runtime);
+
+#define DEFINE_LOCK_SITE_METRICS(site, descr)                                  \
+  METRIC_DEFINE_gauge_uint64(server, site##_lock_contentions,                  \
+      "Contended " descr " Lock Acquisitions", kudu::MetricUnit::kOperations,   \
+      "Number of acquisitions of the " descr " locks which had to wait, "       \
+      "since the server started. Only counted while "                          \
+      "--lock_contention_site_profiling is enabled.",                          \
+      kudu::MetricLevel::kDebug,                                               \
+      kudu::EXPOSE_AS_COUNTER);                                                \
+  METRIC_DEFINE_gauge_uint64(server, site##_lock_contention_time,              \
+      descr " Lock Contention Time", kudu::MetricUnit::kMicroseconds,          \
+      "Time spent waiting to acquire the " descr " locks since the server "     \
+      "started. Only counted while --lock_contention_site_profiling is "       \
+      "enabled.",                                                              \
+      kudu::MetricLevel::kDebug,                                               \
+      kudu::EXPOSE_AS_COUNTER)
+
+DEFINE_LOCK_SITE_METRICS(mvcc, "MVCC");
+DEFINE_LOCK_SITE_METRICS(lock_manager, "Row Lock Manager");
+DEFINE_LOCK_SITE_METRICS(block_cache, "Block Cache Shard");
+DEFINE_LOCK_SITE_METRICS(mem_tracker, "Memory Tracker");
+DEFINE_LOCK_SITE_METRICS(service_queue, "RPC Service Queue");
+DEFINE_LOCK_SITE_METRICS(catalog_manager, "Catalog Manager");
+
+#undef DEFINE_LOCK_SITE_METRICS
+
+using std::lock_guard;
+using std::unordered_map;
+
+namespace kudu {
+
+namespace {
+
+// The registered locks, sharded by address so that registrations and
+// contended acquisitions of unrelated locks rarely serialize. std::mutex is
+// used rather than the Kudu locks, whose contention is recorded here.
+class LockRegistry {
+ public:
+  void Register(const void* lock, LockSite site) {
+    Shard* s = GetShard(lock);
+    lock_guard<std::mutex> l(s->lock);
+    s->sites[lock] = site;
+  }
+
+  void Unregister(const void* lock) {
+    Shard* s = GetShard(lock);
+    lock_guard<std::mutex> l(s->lock);
+    s->sites.erase(lock);
+  }
+
+  bool Lookup(const void* lock, LockSite* site) {
+    Shard* s = GetShard(lock);
+    lock_guard<std::mutex> l(s->lock);
+    const auto it = s->sites.find(lock);
+    if (it == s->sites.end()) {
+      return false;
+    }
+    *site = it->second;
+    return true;
+  }
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  struct Shard {
+    std::mutex lock;
+    unordered_map<const void*, LockSite> sites;
+  };
+
+  Shard* GetShard(const void* lock) {
+    return &shards_[std::hash<const void*>()(lock) % kNumShards];
+  }
+
+  Shard shards_[kNumShards];
+};
+
+LockRegistry* Registry() {
+  static LockRegistry* registry = new LockRegistry();
+  return registry;
+}
+
+// The wait times of the contended acquisitions of each site, in microseconds.
+HdrHistogram* SiteWaitTimes(LockSite site) {
+  static HdrHistogram** hists = []() {
+    auto** h = new HdrHistogram*[kNumLockSites];
+    for (int i = 0; i < kNumLockSites; i++) {
+      // Track waits of up to 60 seconds with 2 significant digits.
+      h[i] = new HdrHistogram(60 * 1000 * 1000, 2);
+    }
+    return h;
+  }();
+  return hists[static_cast<int>(site)];
+}
+
+} // anonymous namespace
+
+const char* LockSiteName(LockSite site) {
+  switch (site) {
+    case LockSite::kMvcc: return "mvcc";
+    case LockSite::kLockManager: return "lock_manager";
+    case LockSite::kBlockCache: return "block_cache";
+    case LockSite::kMemTracker: return "mem_tracker";
+    case LockSite::kServiceQueue: return "service_queue";
+    case LockSite::kCatalogManager: return "catalog_manager";
+  }
+  LOG(FATAL) << "unknown lock site";
+  return "";
+}
+
+ScopedLockSiteRegistration::ScopedLockSiteRegistration(const void* lock, LockSite site)
+    : lock_(lock) {
+  Registry()->Register(lock, site);
+}
+
+ScopedLockSiteRegistration::~ScopedLockSiteRegistration() {
+  Registry()->Unregister(lock_);
+}
+
+void RecordLockContention(const void* lock, int64_t wait_micros) {
+  if (PREDICT_TRUE(!FLAGS_lock_contention_site_profiling)) {
+    return;
+  }
+  LockSite site;
+  if (Registry()->Lookup(lock, &site)) {
+    SiteWaitTimes(site)->Increment(wait_micros);
+  }
+}
+
+void RecordLockContentionCycles(const void* lock, int64_t wait_cycles) {
+  if (PREDICT_TRUE(!FLAGS_lock_contention_site_profiling)) {
+    return;
+  }
+  RecordLockContention(lock, static_cast<int64_t>(
+      static_cast<double>(wait_cycles) * 1000000 / base::CyclesPerSecond()));
+}
+
+void RegisterLockContentionMetrics(const scoped_refptr<MetricEntity>& entity) {
+#define REGISTER_LOCK_SITE_METRICS(site, enum_value)                           \
+  entity->NeverRetire(                                                         \
+      METRIC_##site##_lock_contentions.InstantiateFunctionGauge(               \
+          entity, []() { return SiteWaitTimes(enum_value)->TotalCount(); }));  \
+  entity->NeverRetire(                                                         \
+      METRIC_##site##_lock_contention_time.InstantiateFunctionGauge(           \
+          entity, []() { return SiteWaitTimes(enum_value)->TotalSum(); }))
+
+  REGISTER_LOCK_SITE_METRICS(mvcc, LockSite::kMvcc);
+  REGISTER_LOCK_SITE_METRICS(lock_manager, LockSite::kLockManager);
+  REGISTER_LOCK_SITE_METRICS(block_cache, LockSite::kBlockCache);
+  REGISTER_LOCK_SITE_METRICS(mem_tracker, LockSite::kMemTracker);
+  REGISTER_LOCK_SITE_METRICS(service_queue, LockSite::kServiceQueue);
+  REGISTER_LOCK_SITE_METRICS(catalog_manager, LockSite::kCatalogManager);
+
+#undef REGISTER_LOCK_SITE_METRICS
+}
+
+void DumpLockContention(std::ostream* out, bool as_html) {
+  static const char* const kColumns[] = {
+    "Lock site", "Contentions", "Total wait (us)", "Mean (us)",
+    "p50 (us)", "p99 (us)", "p99.9 (us)", "Max (us)"
+  };
+  if (as_html) {
+    *out << "<h1>Lock Contention</h1>\n";
+    if (!FLAGS_lock_contention_site_profiling) {
+      *out << "<p>Lock contention is only attributed to lock sites while "
+           << "--lock_contention_site_profiling is enabled.</p>\n";
+    }
+    *out << "<table class='table table-striped'>\n<thead><tr>";
+    for (const char* c : kColumns) {
+      *out << "<th>" << c << "</th>";
+    }
+    *out << "</tr></thead>\n<tbody>\n";
+  } else {
+    for (int i = 0; i < arraysize(kColumns); i++) {
+      *out << (i ? "\t" : "") << kColumns[i];
+    }
+    *out << "\n";
+  }
+  for (int i = 0; i < kNumLockSites; i++) {
+    const LockSite site = static_cast<LockSite>(i);
+    HdrHistogram snapshot(*SiteWaitTimes(site));
+    const uint64_t values[] = {
+      snapshot.TotalCount(), snapshot.TotalSum(),
+      static_cast<uint64_t>(snapshot.MeanValue()),
+      snapshot.ValueAtPercentile(50), snapshot.ValueAtPercentile(99),
+      snapshot.ValueAtPercentile(99.9), snapshot.MaxValue(),
+    };
+    if (as_html) {
+      *out << "<tr><td>" << LockSiteName(site) << "</td>";
+      for (const auto v : values) {
+        *out << "<td>" << v << "</td>";
+      }
+      *out << "</tr>\n";
+    } else {
+      *out << LockSiteName(site);
+      for (const auto v : values) {
+        *out << "\t" << v;
+      }
+      *out << "\n";
+    }
+  }
+  if (as_html) {
+    *out << "</tbody>\n</table>\n";
+  }
+}
+
+} // namespace kudu
@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+
+namespace kudu {
+
+class MetricEntity;
+
+// The hot-path lock sites to which lock contention is attributed, in addition
+// to the process-wide contention measured by spinlock_profiling.h.
+//
+// Each site covers all instances of a lock, e.g. the MVCC locks of all of the
+// tablets of a server.
+enum class LockSite {
+  kMvcc,
+  kLockManager,
+  kBlockCache,
+  kMemTracker,
+  kServiceQueue,
+  kCatalogManager,
+};
+constexpr int kNumLockSites = 6;
+
+const char* LockSiteName(LockSite site);
+
+// While alive, attributes the contention on the lock at 'lock' to 'site'.
+// Typically a member of the class owning the lock, declared right after it.
+//
+// Works with simple_spinlock, rw_spinlock and Mutex, whose contended
+// acquisitions call RecordLockContention().
+class ScopedLockSiteRegistration {
+ public:
+  ScopedLockSiteRegistration(const void* lock, LockSite site);
+  ~ScopedLockSiteRegistration();
+
+ private:
+  const void* const lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLockSiteRegistration);
+};
+
+// Records that a thread waited 'wait_micros' to acquire the lock at 'lock'.
+// Does nothing unless the lock is registered and --lock_contention_site_profiling
+// is enabled.
+void RecordLockContention(const void* lock, int64_t wait_micros);
+
+// Records that a thread waited 'wait_cycles' CPU cycles to acquire the lock at
+// 'lock', as reported by the spinlock contention hooks.
+void RecordLockContentionCycles(const void* lock, int64_t wait_cycles);
+
+// Register metrics in the given server entity with the number of contended
+// acquisitions and the total wait time of each lock site.
+void RegisterLockContentionMetrics(const scoped_refptr<MetricEntity>& entity);
+
+// Writes a table of the contention of each lock site to 'out', as HTML if
+// 'as_html' is true, or as text otherwise.
+void DumpLockContention(std::ostream* out, bool as_html);
+
+} // namespace kudu
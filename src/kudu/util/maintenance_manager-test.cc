@@ -44,6 +44,7 @@
 #include "kudu/util/maintenance_manager_metrics.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -72,6 +73,8 @@ DECLARE_bool(enable_maintenance_manager);
 DECLARE_int64(log_target_replay_size_mb);
 DECLARE_double(maintenance_op_multiplier);
 DECLARE_int32(max_priority_range);
+DECLARE_int32(maintenance_manager_io_cost_unit_mb);
+DECLARE_int32(maintenance_manager_max_ops_per_disk);
 namespace kudu {
 
 // Set this a bit bigger so that the manager could keep track of all possible completed ops.
@@ -91,6 +94,8 @@ class TestMaintenanceOp : public MaintenanceOp {
       ram_anchored_(500),
       logs_retained_bytes_(0),
       perf_improvement_(0),
+      io_cost_bytes_(0),
+      disk_key_(0),
       metric_entity_(METRIC_ENTITY_test.Instantiate(&metric_registry_, "test")),
       maintenance_op_duration_(METRIC_maintenance_op_duration.Instantiate(metric_entity_)),
       maintenance_ops_running_(METRIC_maintenance_ops_running.Instantiate(metric_entity_, 0)),
@@ -155,6 +160,8 @@ class TestMaintenanceOp : public MaintenanceOp {
     stats->set_logs_retained_bytes(logs_retained_bytes_);
     stats->set_perf_improvement(perf_improvement_);
     stats->set_workload_score(workload_score_);
+    stats->set_io_cost_bytes(io_cost_bytes_);
+    stats->set_disk_key(disk_key_);
 
     ++update_stats_count_;
   }
@@ -194,6 +201,16 @@ class TestMaintenanceOp : public MaintenanceOp {
     workload_score_ = workload_score;
   }
 
+  void set_io_cost_bytes(int64_t io_cost_bytes) {
+    std::lock_guard<simple_spinlock> guard(lock_);
+    io_cost_bytes_ = io_cost_bytes;
+  }
+
+  void set_disk_key(int64_t disk_key) {
+    std::lock_guard<simple_spinlock> guard(lock_);
+    disk_key_ = disk_key;
+  }
+
   scoped_refptr<Histogram> DurationHistogram() const override {
     return maintenance_op_duration_;
   }
@@ -235,6 +252,8 @@ class TestMaintenanceOp : public MaintenanceOp {
   uint64_t ram_anchored_;
   uint64_t logs_retained_bytes_;
   uint64_t perf_improvement_;
+  int64_t io_cost_bytes_;
+  int64_t disk_key_;
   MetricRegistry metric_registry_;
   scoped_refptr<MetricEntity> metric_entity_;
   scoped_refptr<Histogram> maintenance_op_duration_;
@@ -289,6 +308,10 @@ class MaintenanceManagerTest : public KuduTest {
         [&](double* /* consumption */) {
           return indicate_memory_pressure_.load();
         });
+    manager_->set_soft_limit_exceeded_func_for_tests(
+        [&](double* /* consumption */) {
+          return indicate_soft_limit_exceeded_.load();
+        });
     ASSERT_OK(manager_->Start());
   }
 
@@ -318,6 +341,7 @@ class MaintenanceManagerTest : public KuduTest {
 
   shared_ptr<MaintenanceManager> manager_;
   std::atomic<bool> indicate_memory_pressure_ { false };
+  std::atomic<bool> indicate_soft_limit_exceeded_ { false };
 };
 
 // Just create the MaintenanceManager and then shut it down, to make sure
@@ -444,6 +468,30 @@ TEST_F(MaintenanceManagerTest, TestMemoryPressurePerformsNoMemoryOp) {
   manager_->UnregisterOp(&op);
 }
 
+// Test that past the soft memory limit, the op anchoring the most memory runs
+// first, even if others retain more logs.
+TEST_F(MaintenanceManagerTest, TestSoftLimitPrioritizesMostMemory) {
+  TestMaintenanceOp logs_op("logs", MaintenanceOp::HIGH_IO_USAGE);
+  logs_op.set_logs_retained_bytes(100);
+  logs_op.set_ram_anchored(0);
+  TestMaintenanceOp memory_op("memory", MaintenanceOp::HIGH_IO_USAGE);
+  memory_op.set_ram_anchored(100);
+  manager_->RegisterOp(&logs_op);
+  manager_->RegisterOp(&memory_op);
+  SCOPED_CLEANUP({
+    manager_->UnregisterOp(&logs_op);
+    manager_->UnregisterOp(&memory_op);
+  });
+
+  // Under mere memory pressure, the op retaining the most logs would run
+  // first: past the soft limit, it's the op anchoring the most memory.
+  indicate_soft_limit_exceeded_ = true;
+  ASSERT_EVENTUALLY([&] {
+    ASSERT_EQ(1, memory_op.DurationHistogram()->TotalCount());
+  });
+  ASSERT_EQ(0, logs_op.DurationHistogram()->TotalCount());
+}
+
 // Test that ops are prioritized correctly when we add log retention.
 TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   const int64_t kMB = 1024 * 1024;
@@ -623,6 +671,61 @@ TEST_F(MaintenanceManagerTest, TestOpFactors) {
                    manager_->AdjustedPerfScore(1, 0, op5.priority()));
 }
 
+// Test that perf improvement ops are weighed by their IO cost, and that ops on
+// busy disks are passed over in favor of ops on other disks.
+TEST_F(MaintenanceManagerTest, TestCostAwareSelection) {
+  const int64_t kMB = 1024 * 1024;
+
+  StopManager();
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE);
+  op1.set_perf_improvement(10);
+  op1.set_io_cost_bytes(100 * kMB);
+  op1.set_disk_key(1);
+
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE);
+  op2.set_perf_improvement(5);
+  op2.set_io_cost_bytes(10 * kMB);
+  op2.set_disk_key(2);
+
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+  SCOPED_CLEANUP({
+    manager_->UnregisterOp(&op1);
+    manager_->UnregisterOp(&op2);
+  });
+
+  // By default, the cost of the ops is ignored.
+  auto op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op1, op_and_why.first);
+  EXPECT_EQ("perf score=10.000000", op_and_why.second);
+
+  // Per byte of IO, op2 is the better deal.
+  FLAGS_maintenance_manager_io_cost_unit_mb = 10;
+  ASSERT_DOUBLE_EQ(10.0 / 11, manager_->CostAdjustedPerfScore(10, 100 * kMB));
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op2, op_and_why.first);
+  EXPECT_EQ("perf score=2.500000", op_and_why.second);
+
+  // If op2's disk is already busy, op1 runs on its idle disk instead.
+  FLAGS_maintenance_manager_max_ops_per_disk = 1;
+  {
+    std::lock_guard<Mutex> guard(manager_->running_instances_lock_);
+    manager_->running_ops_by_disk_[2] = 1;
+  }
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op1, op_and_why.first);
+
+  // Ops on a disk with room to spare are still eligible.
+  FLAGS_maintenance_manager_max_ops_per_disk = 2;
+  op_and_why = manager_->FindBestOp();
+  ASSERT_EQ(&op2, op_and_why.first);
+  {
+    std::lock_guard<Mutex> guard(manager_->running_instances_lock_);
+    manager_->running_ops_by_disk_.clear();
+  }
+}
+
 // Test priority OP launching.
 TEST_F(MaintenanceManagerTest, TestPriorityOpLaunch) {
   StopManager();
@@ -26,6 +26,7 @@
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -114,6 +115,30 @@ TAG_FLAG(max_priority_range, advanced);
 TAG_FLAG(max_priority_range, experimental);
 TAG_FLAG(max_priority_range, runtime);
 
+DEFINE_int32(maintenance_manager_io_cost_unit_mb, 0,
+             "If positive, the perf improvement score of a maintenance op is "
+             "divided by (1 + C / U), where C is the op's estimated IO cost and U "
+             "is this many mebibytes, so that ops with the most benefit per byte "
+             "of IO are preferred over ones that are merely large. A value of 0 "
+             "ignores the cost of ops.");
+DEFINE_validator(maintenance_manager_io_cost_unit_mb,
+                 [](const char* /*n*/, int32 v) { return v >= 0; });
+TAG_FLAG(maintenance_manager_io_cost_unit_mb, advanced);
+TAG_FLAG(maintenance_manager_io_cost_unit_mb, experimental);
+TAG_FLAG(maintenance_manager_io_cost_unit_mb, runtime);
+
+DEFINE_int32(maintenance_manager_max_ops_per_disk, 0,
+             "Maximum number of high IO perf improvement ops the maintenance "
+             "manager runs concurrently on the same set of data directories. "
+             "When the limit is reached, ops on other data directories are "
+             "scheduled instead, so that threads don't pile onto one disk while "
+             "others are idle. A value of 0 means no limit.");
+DEFINE_validator(maintenance_manager_max_ops_per_disk,
+                 [](const char* /*n*/, int32 v) { return v >= 0; });
+TAG_FLAG(maintenance_manager_max_ops_per_disk, advanced);
+TAG_FLAG(maintenance_manager_max_ops_per_disk, experimental);
+TAG_FLAG(maintenance_manager_max_ops_per_disk, runtime);
+
 DEFINE_int32(maintenance_manager_inject_latency_ms, 0,
              "Injects latency into maintenance thread. For use in tests only.");
 TAG_FLAG(maintenance_manager_inject_latency_ms, runtime);
@@ -133,6 +158,8 @@ void MaintenanceOpStats::Clear() {
   data_retained_bytes_ = 0;
   perf_improvement_ = 0;
   workload_score_ = 0;
+  io_cost_bytes_ = 0;
+  disk_key_ = 0;
   last_modified_ = MonoTime();
 }
 
@@ -189,6 +216,9 @@ MaintenanceManager::MaintenanceManager(
       completed_ops_count_(0),
       rand_(GetRandomSeed32()),
       memory_pressure_func_(&process_memory::UnderMemoryPressure),
+      soft_limit_exceeded_func_([](double* capacity_pct) {
+        return process_memory::SoftLimitExcess(capacity_pct) > 0;
+      }),
       metrics_(CHECK_NOTNULL(metric_entity)) {
   CHECK_OK(ThreadPoolBuilder("MaintenanceMgr")
                .set_min_threads(num_threads_)
@@ -312,6 +342,7 @@ void MaintenanceManager::RunSchedulerThread() {
 
   while (true) {
     MaintenanceOp* op = nullptr;
+    int64_t disk_key = 0;
     string op_note;
     {
       std::unique_lock<Mutex> guard(lock_);
@@ -348,6 +379,7 @@ void MaintenanceManager::RunSchedulerThread() {
         op_note = std::move(best_op_and_why.second);
       }
       if (op) {
+        disk_key = FindOrDie(ops_, op).disk_key();
         // While 'running_instances_lock_' is held, check one more time for
         // whether the op is cancelled. This ensures that we don't attempt to
         // launch an op that has been destructed in UnregisterOp(). See
@@ -358,7 +390,7 @@ void MaintenanceManager::RunSchedulerThread() {
               << "picked maintenance operation that has been cancelled";
           continue;
         }
-        IncreaseOpCount(op);
+        IncreaseOpCount(op, disk_key);
         prev_iter_found_no_work = false;
       } else {
         VLOG_AND_TRACE_WITH_PREFIX("maintenance", 2)
@@ -375,14 +407,14 @@ void MaintenanceManager::RunSchedulerThread() {
                             << ". Re-running scheduler.";
       metrics_.SubmitOpPrepareFailed();
       std::lock_guard<Mutex> guard(running_instances_lock_);
-      DecreaseOpCountAndNotifyWaiters(op);
+      DecreaseOpCountAndNotifyWaiters(op, disk_key);
       continue;
     }
 
     LOG_AND_TRACE_WITH_PREFIX("maintenance", INFO)
         << Substitute("Scheduling $0: $1", op->name(), op_note);
     // Submit the maintenance operation to be run on the "MaintenanceMgr" pool.
-    CHECK_OK(thread_pool_->Submit([this, op]() { this->LaunchOp(op); }));
+    CHECK_OK(thread_pool_->Submit([this, op, disk_key]() { this->LaunchOp(op, disk_key); }));
   }
 }
 
@@ -398,7 +430,8 @@ void MaintenanceManager::RunSchedulerThread() {
 // - If there are Ops that we can run that free disk space, run whichever frees
 //   the most space (e.g. GCing ancient deltas).
 // - Finally, if there's nothing else that we really need to do, we run the Op
-//   that will improve performance the most.
+//   that will improve performance the most, optionally per byte of IO it costs
+//   and skipping high IO Ops on disks that are already busy.
 //
 // In general, we want to prioritize limiting the amount of expensive resources
 // we hold onto. Low IO ops that free WAL disk space are preferred, followed by
@@ -424,11 +457,21 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
   int64_t most_logs_retained_bytes_ram_anchored = 0;
   MaintenanceOp* most_logs_retained_bytes_ram_anchored_op = nullptr;
 
+  int64_t most_ram_anchored = 0;
+  MaintenanceOp* most_ram_anchored_op = nullptr;
+
   int64_t most_data_retained_bytes = 0;
   MaintenanceOp* most_data_retained_bytes_op = nullptr;
 
   double best_perf_improvement = 0;
   MaintenanceOp* best_perf_improvement_op = nullptr;
+
+  const int32_t max_ops_per_disk = FLAGS_maintenance_manager_max_ops_per_disk;
+  std::unordered_map<int64_t, int> running_ops_by_disk;
+  if (max_ops_per_disk > 0) {
+    std::lock_guard<Mutex> guard(running_instances_lock_);
+    running_ops_by_disk = running_ops_by_disk_;
+  }
   for (auto& val : ops_) {
     MaintenanceOp* op(val.first);
     MaintenanceOpStats& stats(val.second);
@@ -460,6 +503,10 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
       most_logs_retained_bytes = logs_retained_bytes;
       most_logs_retained_bytes_ram_anchored = ram_anchored;
     }
+    if (ram_anchored > most_ram_anchored) {
+      most_ram_anchored_op = op;
+      most_ram_anchored = ram_anchored;
+    }
 
     const auto data_retained_bytes = stats.data_retained_bytes();
     if (data_retained_bytes > most_data_retained_bytes) {
@@ -470,8 +517,18 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
                         op->name(), data_retained_bytes);
     }
 
-    const auto perf_improvement =
-        AdjustedPerfScore(stats.perf_improvement(), stats.workload_score(), op->priority());
+    if (max_ops_per_disk > 0 &&
+        op->io_usage() == MaintenanceOp::HIGH_IO_USAGE &&
+        stats.disk_key() != 0 &&
+        FindWithDefault(running_ops_by_disk, stats.disk_key(), 0) >= max_ops_per_disk) {
+      VLOG_AND_TRACE_WITH_PREFIX("maintenance", 2)
+          << Substitute("Op $0 skipped for perf improvement: its disks are busy",
+                        op->name());
+      continue;
+    }
+    const auto perf_improvement = CostAdjustedPerfScore(
+        AdjustedPerfScore(stats.perf_improvement(), stats.workload_score(), op->priority()),
+        stats.io_cost_bytes());
     if ((!best_perf_improvement_op) ||
         (perf_improvement > best_perf_improvement)) {
       best_perf_improvement_op = op;
@@ -496,6 +553,18 @@ pair<MaintenanceOp*, string> MaintenanceManager::FindBestOp() {
   // all ops that anchor memory (and also anchor WALs) will eventually be
   // performed.
   double capacity_pct;
+
+  // Past the soft memory limit, the writes to the tablets whose memstores hold
+  // the most memory are pushed back on (see TabletServiceImpl): flush the op
+  // anchoring the most memory right away, for those writes to go on, and for
+  // the consumption to go back under the limit the soonest.
+  if (most_ram_anchored_op && soft_limit_exceeded_func_(&capacity_pct)) {
+    string note = StringPrintf("past the soft memory limit (%.2f%% used), "
+                               "flush %" PRIu64 " bytes memory",
+                               capacity_pct, most_ram_anchored);
+    return {most_ram_anchored_op, std::move(note)};
+  }
+
   if (memory_pressure_func_(&capacity_pct) && most_logs_retained_bytes_ram_anchored_op) {
     DCHECK_GT(most_logs_retained_bytes_ram_anchored, 0);
     string note = StringPrintf("under memory pressure (%.2f%% used), "
@@ -551,7 +620,15 @@ double MaintenanceManager::AdjustedPerfScore(double perf_improvement,
   return perf_score * std::pow(FLAGS_maintenance_op_multiplier, priority);
 }
 
-void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
+double MaintenanceManager::CostAdjustedPerfScore(double perf_score, int64_t io_cost_bytes) {
+  const double unit_bytes = FLAGS_maintenance_manager_io_cost_unit_mb * 1024.0 * 1024.0;
+  if (unit_bytes <= 0 || io_cost_bytes <= 0) {
+    return perf_score;
+  }
+  return perf_score / (1 + io_cost_bytes / unit_bytes);
+}
+
+void MaintenanceManager::LaunchOp(MaintenanceOp* op, int64_t disk_key) {
   const auto thread_id = Thread::CurrentThreadId();
   OpInstance op_instance;
   op_instance.thread_id = thread_id;
@@ -577,7 +654,7 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
       op_instance.duration = now - op_instance.start_mono_time;
       op->DurationHistogram()->Increment(op_instance.duration.ToMilliseconds());
 
-      DecreaseOpCountAndNotifyWaiters(op);
+      DecreaseOpCountAndNotifyWaiters(op, disk_key);
     }
     cond_.Signal(); // wake up the scheduler
 
@@ -669,16 +746,26 @@ bool MaintenanceManager::CouldNotLaunchNewOp(bool prev_iter_found_no_work) {
   return (!HasFreeThreads() || prev_iter_found_no_work || disabled_for_tests()) && !shutdown_;
 }
 
-void MaintenanceManager::IncreaseOpCount(MaintenanceOp* op) {
+void MaintenanceManager::IncreaseOpCount(MaintenanceOp* op, int64_t disk_key) {
   running_instances_lock_.AssertAcquired();
   ++running_ops_;
   ++op->running_;
+  if (disk_key != 0) {
+    ++running_ops_by_disk_[disk_key];
+  }
 }
 
-void MaintenanceManager::DecreaseOpCountAndNotifyWaiters(MaintenanceOp* op) {
+void MaintenanceManager::DecreaseOpCountAndNotifyWaiters(MaintenanceOp* op, int64_t disk_key) {
   running_instances_lock_.AssertAcquired();
   --running_ops_;
   --op->running_;
+  if (disk_key != 0) {
+    auto it = running_ops_by_disk_.find(disk_key);
+    DCHECK(it != running_ops_by_disk_.end());
+    if (--it->second == 0) {
+      running_ops_by_disk_.erase(it);
+    }
+  }
   op->cond_->Signal();
 }
 
@@ -122,6 +122,26 @@ class MaintenanceOpStats {
     workload_score_ = workload_score;
   }
 
+  int64_t io_cost_bytes() const {
+    DCHECK(valid_);
+    return io_cost_bytes_;
+  }
+
+  void set_io_cost_bytes(int64_t io_cost_bytes) {
+    UpdateLastModified();
+    io_cost_bytes_ = io_cost_bytes;
+  }
+
+  int64_t disk_key() const {
+    DCHECK(valid_);
+    return disk_key_;
+  }
+
+  void set_disk_key(int64_t disk_key) {
+    UpdateLastModified();
+    disk_key_ = disk_key;
+  }
+
   const MonoTime& last_modified() const {
     DCHECK(valid_);
     return last_modified_;
@@ -164,6 +184,16 @@ class MaintenanceOpStats {
 
   double workload_score_;
 
+  // The approximate number of bytes this operation would read and write if it
+  // ran, which also stands in for the CPU time it would take. May be 0 if
+  // unknown.
+  int64_t io_cost_bytes_;
+
+  // Identifies the set of data directories this operation does its IO on, so
+  // that the manager can spread concurrent operations across disks. Operations
+  // on the same directories have the same key. May be 0 if unknown.
+  int64_t disk_key_;
+
   // The last time that the stats were modified.
   MonoTime last_modified_;
 };
@@ -334,6 +364,11 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
     memory_pressure_func_ = std::move(f);
   }
 
+  void set_soft_limit_exceeded_func_for_tests(std::function<bool(double*)> f) {
+    std::lock_guard<Mutex> guard(lock_);
+    soft_limit_exceeded_func_ = std::move(f);
+  }
+
   static const Options kDefaultOptions;
 
  private:
@@ -341,6 +376,7 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   FRIEND_TEST(MaintenanceManagerTest, TestPrioritizeLogRetentionUnderMemoryPressure);
   FRIEND_TEST(MaintenanceManagerTest, TestOpFactors);
   FRIEND_TEST(MaintenanceManagerTest, VerifyMetrics);
+  FRIEND_TEST(MaintenanceManagerTest, TestCostAwareSelection);
 
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapType;
@@ -361,7 +397,13 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // and the table's priority.
   static double AdjustedPerfScore(double perf_improvement, double workload_score, int32_t priority);
 
-  void LaunchOp(MaintenanceOp* op);
+  // Divide the perf score by the op's estimated IO cost, if costs are taken
+  // into account (see --maintenance_manager_io_cost_unit_mb).
+  static double CostAdjustedPerfScore(double perf_score, int64_t io_cost_bytes);
+
+  // 'disk_key' is the key of the data directories the op runs on, as reported
+  // in its stats when it was scheduled.
+  void LaunchOp(MaintenanceOp* op, int64_t disk_key);
 
   std::string LogPrefix() const;
 
@@ -369,8 +411,8 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
 
   bool CouldNotLaunchNewOp(bool prev_iter_found_no_work);
 
-  void IncreaseOpCount(MaintenanceOp *op);
-  void DecreaseOpCountAndNotifyWaiters(MaintenanceOp *op);
+  void IncreaseOpCount(MaintenanceOp *op, int64_t disk_key);
+  void DecreaseOpCountAndNotifyWaiters(MaintenanceOp *op, int64_t disk_key);
 
   // Adds ops in 'ops_pending_registration_' to 'ops_'. Must be called while
   // 'lock_' is held.
@@ -422,6 +464,10 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // This is indirected for testing purposes.
   std::function<bool(double*)> memory_pressure_func_;
 
+  // Function which should return true if the server's memory consumption is
+  // past the soft memory limit. Also indirected for testing purposes.
+  std::function<bool(double*)> soft_limit_exceeded_func_;
+
   // Running instances lock.
   //
   // This is separate from lock_ so that worker threads don't need to take the
@@ -437,6 +483,12 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   // Protected by running_instances_lock_;
   std::unordered_map<int64_t, OpInstance*> running_instances_;
 
+  // Number of scheduled or running ops per disk key. Ops with an unknown disk
+  // key (0) aren't tracked.
+  //
+  // Protected by running_instances_lock_;
+  std::unordered_map<int64_t, int> running_ops_by_disk_;
+
   // MM-specific metrics.
   MaintenanceManagerMetrics metrics_;
 
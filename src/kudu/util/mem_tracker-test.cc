@@ -28,6 +28,7 @@
 #include <utility>
 #include <vector>
 
+#include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
@@ -38,6 +39,8 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int64(mem_tracker_consumption_batch_bytes);
+
 namespace kudu {
 
 using std::equal_to;
@@ -63,6 +66,44 @@ TEST(MemTrackerTest, SingleTrackerNoLimit) {
   EXPECT_EQ(t->consumption(), 0);
 }
 
+TEST(MemTrackerTest, BatchedConsumption) {
+  google::FlagSaver saver;
+  FLAGS_mem_tracker_consumption_batch_bytes = 1024;
+  shared_ptr<MemTracker> p = MemTracker::CreateTracker(-1, "p");
+  shared_ptr<MemTracker> c = MemTracker::CreateTracker(100 * 1024, "c", p);
+
+  // The consumption is exact, whether or not it has been batched.
+  p->Consume(10);
+  EXPECT_EQ(10, p->consumption());
+  p->Release(10);
+  EXPECT_EQ(0, p->consumption());
+
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIters = 10000;
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kNumIters; j++) {
+        c->Consume(10);
+        c->Release(7);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // The limited tracker isn't batched, so its limit is enforced precisely.
+  constexpr int64_t kExpected = kNumThreads * kNumIters * 3;
+  EXPECT_EQ(kExpected, c->consumption());
+  EXPECT_EQ(kExpected, p->consumption());
+  EXPECT_FALSE(c->TryConsume(100 * 1024 - kExpected + 1));
+  EXPECT_TRUE(c->TryConsume(100 * 1024 - kExpected));
+  EXPECT_FALSE(c->LimitExceeded());
+  c->Release(100 * 1024);
+  EXPECT_EQ(0, c->consumption());
+  EXPECT_EQ(0, p->consumption());
+}
+
 TEST(MemTrackerTest, SingleTrackerWithLimit) {
   shared_ptr<MemTracker> t = MemTracker::CreateTracker(11, "t");
   EXPECT_TRUE(t->has_limit());
@@ -17,6 +17,8 @@
 
 #include "kudu/util/mem_tracker.h"
 
+#include <sched.h>
+
 #include <algorithm>
 #include <cstddef>
 #include <deque>
@@ -27,13 +29,28 @@
 #include <stack>
 #include <type_traits>
 
+#include <gflags/gflags.h>
+
 #include "kudu/gutil/once.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/mem_tracker.pb.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/process_memory.h"
 
+DEFINE_int64(mem_tracker_consumption_batch_bytes, 0,
+             "If positive, the memory trackers without a limit accumulate the "
+             "consumption of each CPU and only apply it to the tracker once it "
+             "reaches this many bytes, which avoids contending on the trackers "
+             "shared by many threads, such as the root tracker. Their reported "
+             "consumption remains exact, but their peak consumption may be off by "
+             "up to this many bytes per CPU. Trackers with a limit are never "
+             "batched. Only applies to trackers created after it's set.");
+TAG_FLAG(mem_tracker_consumption_batch_bytes, experimental);
+TAG_FLAG(mem_tracker_consumption_batch_bytes, advanced);
+
 namespace kudu {
 
 // NOTE: this class has been adapted from Impala, so the code style varies
@@ -79,8 +96,17 @@ MemTracker::MemTracker(int64_t byte_limit, const string& id, shared_ptr<MemTrack
       id_(id),
       descr_(Substitute("memory consumption for $0", id)),
       parent_(std::move(parent)),
-      consumption_(0) {
+      consumption_(0),
+      num_pending_(0),
+      batch_bytes_(FLAGS_mem_tracker_consumption_batch_bytes) {
   VLOG(1) << "Creating tracker " << ToString();
+#ifndef __APPLE__
+  // OSX doesn't have a way to get the index of the CPU running this thread.
+  if (batch_bytes_ > 0 && limit_ < 0) {
+    num_pending_ = base::MaxCPUIndex() + 1;
+    pending_.reset(new PendingConsumption[num_pending_]);
+  }
+#endif
 }
 
 MemTracker::~MemTracker() {
@@ -231,7 +257,7 @@ void MemTracker::Consume(int64_t bytes) {
     return;
   }
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
+    tracker->IncrementConsumption(bytes);
   }
 }
 
@@ -246,7 +272,7 @@ bool MemTracker::TryConsume(int64_t bytes) {
   for (i = all_trackers_.size() - 1; i >= 0; --i) {
     MemTracker *tracker = all_trackers_[i];
     if (tracker->limit_ < 0) {
-      tracker->consumption_.IncrementBy(bytes);
+      tracker->IncrementConsumption(bytes);
     } else {
       if (!tracker->consumption_.TryIncrementBy(bytes, tracker->limit_)) {
         break;
@@ -264,7 +290,7 @@ bool MemTracker::TryConsume(int64_t bytes) {
   // for error reporting so this is probably okay. Rolling those back is
   // pretty hard; we'd need something like 2PC.
   for (int j = all_trackers_.size() - 1; j > i; --j) {
-    all_trackers_[j]->consumption_.IncrementBy(-bytes);
+    all_trackers_[j]->IncrementConsumption(-bytes);
   }
   return false;
 }
@@ -287,11 +313,37 @@ void MemTracker::Release(int64_t bytes) {
   }
 
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
+    tracker->IncrementConsumption(-bytes);
   }
   process_memory::MaybeGCAfterRelease(bytes);
 }
 
+void MemTracker::IncrementConsumption(int64_t bytes) {
+  if (PREDICT_TRUE(!pending_)) {
+    consumption_.IncrementBy(bytes);
+    return;
+  }
+#if defined(__APPLE__)
+  int cpu = 0;
+#else
+  int cpu = sched_getcpu();
+#endif
+  DCHECK_LT(cpu, num_pending_);
+  std::atomic<int64_t>* pending = &pending_[cpu].bytes;
+  int64_t new_pending = pending->fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  if (new_pending >= batch_bytes_ || new_pending <= -batch_bytes_) {
+    consumption_.IncrementBy(pending->exchange(0, std::memory_order_relaxed));
+  }
+}
+
+int64_t MemTracker::PendingConsumptionBytes() const {
+  int64_t total = 0;
+  for (int i = 0; i < num_pending_; i++) {
+    total += pending_[i].bytes.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
 bool MemTracker::AnyLimitExceeded() {
   for (const auto& tracker : limit_trackers_) {
     if (tracker->LimitExceeded()) {
@@ -17,6 +17,7 @@
 #ifndef KUDU_UTIL_MEM_TRACKER_H
 #define KUDU_UTIL_MEM_TRACKER_H
 
+#include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
@@ -26,7 +27,9 @@
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/port.h"
 #include "kudu/util/high_water_mark.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/mutex.h"
 
 namespace kudu {
@@ -146,9 +149,15 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   // Returns the memory consumed in bytes.
   int64_t consumption() const {
-    return consumption_.current_value();
+    if (PREDICT_TRUE(!pending_)) {
+      return consumption_.current_value();
+    }
+    return consumption_.current_value() + PendingConsumptionBytes();
   }
 
+  // Returns the peak memory consumed in bytes. If the consumption of this
+  // tracker is batched, the peak may be off by up to the batch size times the
+  // number of CPUs.
   int64_t peak_consumption() const { return consumption_.max_value(); }
 
   // Retrieve the parent tracker, or NULL If one is not set.
@@ -178,6 +187,13 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // Creates the root tracker.
   static void CreateRootTracker();
 
+  // Adds 'bytes' to the consumption of this tracker alone, batching the
+  // update in the current CPU's pending consumption if it's enabled.
+  void IncrementConsumption(int64_t bytes);
+
+  // Returns the sum of the pending consumption of all CPUs.
+  int64_t PendingConsumptionBytes() const;
+
   int64_t limit_;
   const std::string id_;
   const std::string descr_;
@@ -185,6 +201,23 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
 
   HighWaterMark consumption_;
 
+  // Consumption which hasn't yet been applied to 'consumption_', per CPU.
+  //
+  // Updating 'consumption_' of the trackers which are shared by many threads,
+  // the root tracker in particular, bounces its cache line between the CPUs.
+  // To avoid that, unlimited trackers accumulate the consumption of each CPU
+  // while --mem_tracker_consumption_batch_bytes is set, and only apply it once
+  // it reaches the batch size. Trackers with a limit are never batched, so
+  // that their limits are enforced precisely.
+  struct PendingConsumption {
+    std::atomic<int64_t> bytes { 0 };
+    char padding[CACHELINE_SIZE > sizeof(std::atomic<int64_t>) ?
+                 CACHELINE_SIZE - sizeof(std::atomic<int64_t>) : 1];
+  } CACHELINE_ALIGNED;
+  std::unique_ptr<PendingConsumption[]> pending_;
+  int num_pending_;
+  int64_t batch_bytes_;
+
   // this tracker plus all of its ancestors
   std::vector<MemTracker*> all_trackers_;
   // all_trackers_ with valid limits
@@ -194,6 +227,8 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
   // listing only (i.e. updating the consumption of a parent tracker does not
   // update that of its children).
   mutable Mutex child_trackers_lock_;
+  ScopedLockSiteRegistration child_trackers_lock_site_{
+      &child_trackers_lock_, LockSite::kMemTracker};
   std::list<std::weak_ptr<MemTracker>> child_trackers_;
 
   // Iterator into parent_->child_trackers_ for this object. Stored to have O(1)
@@ -45,6 +45,7 @@ namespace kudu {
 using std::shared_ptr;
 using std::string;
 using std::thread;
+using std::unique_ptr;
 using std::vector;
 
 // From the "arena" allocate number of bytes required to copy the "to_write" buffer
@@ -260,6 +261,41 @@ TEST(TestArena, TestMemoryTrackingEnforced) {
   ASSERT_EQ(256, mem_tracker->consumption());
 }
 
+TEST(TestArena, TestHugePageBufferAllocator) {
+  const size_t kHugePageSize = HugePageBufferAllocator::kHugePageSize;
+  BufferAllocator* allocator = HugePageBufferAllocator::Get();
+
+  // Buffers of a multiple of the huge page size are aligned to it.
+  unique_ptr<Buffer> buffer(allocator->Allocate(kHugePageSize));
+  ASSERT_NE(nullptr, buffer);
+  ASSERT_EQ(kHugePageSize, buffer->size());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(buffer->data()) % kHugePageSize);
+
+  // Other buffers are regular heap allocations, and keep their contents when
+  // reallocated to a huge page sized buffer.
+  unique_ptr<Buffer> small(allocator->Allocate(100));
+  ASSERT_NE(nullptr, small);
+  memset(small->data(), 0xab, small->size());
+  ASSERT_NE(nullptr, allocator->Reallocate(2 * kHugePageSize, small.get()));
+  ASSERT_EQ(2 * kHugePageSize, small->size());
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(small->data()) % kHugePageSize);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(0xab, reinterpret_cast<uint8_t*>(small->data())[i]);
+  }
+
+  // An arena with huge page sized components, still tracked by its allocator.
+  shared_ptr<MemTracker> mem_tracker = MemTracker::CreateTracker(-1, "arena-test-tracker");
+  shared_ptr<MemoryTrackingBufferAllocator> tracking_allocator(
+      new MemoryTrackingBufferAllocator(allocator, mem_tracker));
+  MemoryTrackingArena arena(kHugePageSize / 2, tracking_allocator);
+  arena.SetMaxBufferSize(kHugePageSize);
+  ASSERT_NE(nullptr, arena.AllocateBytes(kHugePageSize / 2));
+  void* allocated = arena.AllocateBytes(kHugePageSize / 2);
+  ASSERT_NE(nullptr, allocated);
+  ASSERT_EQ(0, reinterpret_cast<uintptr_t>(allocated) % kHugePageSize);
+  ASSERT_EQ(kHugePageSize / 2 + kHugePageSize, mem_tracker->consumption());
+}
+
 TEST(TestArena, TestSTLAllocator) {
   Arena a(256);
   typedef vector<int, ArenaAllocator<int, false> > ArenaVector;
@@ -59,7 +59,10 @@ ArenaBase<THREADSAFE>::ArenaBase(size_t initial_buffer_size)
 
 template <bool THREADSAFE>
 void ArenaBase<THREADSAFE>::SetMaxBufferSize(size_t size) {
-  DCHECK_LE(size, kMaxTcmallocFastAllocation);
+  // Larger buffers are only expected from arenas backed by huge pages, which
+  // are allocated in multiples of the huge page size.
+  DCHECK(size <= kMaxTcmallocFastAllocation ||
+         size % HugePageBufferAllocator::kHugePageSize == 0) << size;
   max_buffer_size_ = size;
 }
 
@@ -96,7 +96,9 @@ class ArenaBase {
   explicit ArenaBase(size_t initial_buffer_size);
 
   // Set the maximum buffer size allocated for this arena.
-  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes).
+  // The maximum buffer size allowed is slightly less than ~1MB (8192 * 127 bytes),
+  // unless the arena uses HugePageBufferAllocator, in which case it may be a
+  // multiple of HugePageBufferAllocator::kHugePageSize.
   //
   // Consider the following pros/cons of large buffer sizes:
   //
@@ -27,6 +27,8 @@
 #include <mm_malloc.h>
 #endif //__aarch64__
 
+#include <sys/mman.h>
+
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
@@ -173,6 +175,69 @@ void* HeapBufferAllocator::Realloc(void* previous_data, size_t previous_size,
   }
 }
 
+constexpr size_t HugePageBufferAllocator::kHugePageSize;
+
+Buffer* HugePageBufferAllocator::AllocateInternal(
+    const size_t requested,
+    const size_t minimal,
+    BufferAllocator* const originator) {
+  DCHECK_LE(minimal, requested);
+  void* data;
+  size_t attempted = requested;
+  while (true) {
+    data = (attempted == 0) ? &dummy_buffer[0] : Malloc(attempted);
+    if (data != nullptr) {
+      return CreateBuffer(data, attempted, originator);
+    }
+    if (attempted == minimal) return nullptr;
+    attempted = minimal + (attempted - minimal - 1) / 2;
+  }
+}
+
+bool HugePageBufferAllocator::ReallocateInternal(
+    const size_t requested,
+    const size_t minimal,
+    Buffer* const buffer,
+    BufferAllocator* const originator) {
+  DCHECK_LE(minimal, requested);
+  size_t attempted = requested;
+  while (true) {
+    // realloc() wouldn't keep the alignment of the huge page sized buffers,
+    // so the data is always copied to a new buffer.
+    void* data = (attempted == 0) ? &dummy_buffer[0] : Malloc(attempted);
+    if (data != nullptr) {
+      if (buffer->size() > 0) {
+        memcpy(data, buffer->data(), min(buffer->size(), attempted));
+        free(buffer->data());
+      }
+      UpdateBuffer(data, attempted, buffer);
+      return true;
+    }
+    if (attempted == minimal) return false;
+    attempted = minimal + (attempted - minimal - 1) / 2;
+  }
+}
+
+void HugePageBufferAllocator::FreeInternal(Buffer* buffer) {
+  if (buffer->size() > 0) free(buffer->data());
+}
+
+void* HugePageBufferAllocator::Malloc(size_t size) {
+  if (size % kHugePageSize != 0) {
+    return malloc(size);
+  }
+  void* data;
+  if (posix_memalign(&data, kHugePageSize, size)) {
+    return nullptr;
+  }
+#ifdef MADV_HUGEPAGE
+  // This is only advisory: with transparent huge pages disabled, or in
+  // 'never' mode, the buffer is mapped with regular pages.
+  madvise(data, size, MADV_HUGEPAGE);
+#endif
+  return data;
+}
+
 Buffer* ClearingBufferAllocator::AllocateInternal(size_t requested,
                                                   size_t minimal,
                                                   BufferAllocator* originator) {
@@ -282,6 +282,57 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocates buffers on the heap, like HeapBufferAllocator, but backs the
+// buffers whose size is a multiple of the huge page size with transparent
+// huge pages: they are aligned to the huge page size, and the kernel is
+// advised to map them with huge pages where supported. Other buffers are
+// allocated with malloc().
+//
+// It's meant for arenas which hold a lot of data that is accessed randomly,
+// e.g. the B-trees of the MemRowSets, which otherwise incur many TLB misses.
+// Such arenas should use kHugePageSize as their max buffer size.
+class HugePageBufferAllocator : public BufferAllocator {
+ public:
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  virtual ~HugePageBufferAllocator() {}
+
+  // Returns a singleton instance of the huge page allocator.
+  static HugePageBufferAllocator* Get() {
+    return Singleton<HugePageBufferAllocator>::get();
+  }
+
+  virtual size_t Available() const OVERRIDE {
+    return std::numeric_limits<size_t>::max();
+  }
+
+ private:
+  friend class Singleton<HugePageBufferAllocator>;
+
+  // Allocates a 'requested'-sized buffer or, if that fails, retries with
+  // sizes halfway between the last attempted one and 'minimal', down to
+  // 'minimal'. Returns NULL if even that fails. A smaller buffer is only aligned
+  // to kHugePageSize if its size happens to be a multiple of it.
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  // Allocates 'size' bytes, aligned to kHugePageSize if 'size' is a non-zero
+  // multiple of it.
+  static void* Malloc(size_t size);
+
+  HugePageBufferAllocator() {}
+
+  DISALLOW_COPY_AND_ASSIGN(HugePageBufferAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
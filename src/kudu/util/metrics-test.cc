@@ -889,6 +889,59 @@ TEST_F(MetricsTest, TestDontDumpUntouched) {
   ASSERT_STR_CONTAINS(out.str(), "test_gauge");
 }
 
+TEST_F(MetricsTest, PrometheusPrintTest) {
+  scoped_refptr<Counter> test_counter = METRIC_test_counter.Instantiate(entity_);
+  test_counter->IncrementBy(2);
+  METRIC_test_counter.Instantiate(entity_same_attr_)->IncrementBy(10);
+  METRIC_test_counter.Instantiate(entity_diff_attr_);
+  scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
+  hist->Increment(2);
+  hist->Increment(4);
+  METRIC_test_gauge.Instantiate(entity_, 5);
+  METRIC_test_string_gauge.Instantiate(entity_, "value");
+
+  {
+    std::ostringstream out;
+    ASSERT_OK(registry_.WriteAsPrometheus(&out, MetricJsonOptions()));
+    const string s = out.str();
+    // The samples of a family directly follow its HELP and TYPE lines.
+    ASSERT_STR_CONTAINS(s, "# HELP kudu_test_counter Description of test counter\n"
+                           "# TYPE kudu_test_counter counter\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_counter{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-same-attr1\"} 2\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_counter{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-same-attr2\"} 10\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_counter{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-diff-attr\"} 0\n");
+    ASSERT_STR_CONTAINS(s, "# TYPE kudu_test_hist summary\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_hist{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-same-attr1\",quantile=\"0.99\"} 4\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_hist_sum{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-same-attr1\"} 6\n");
+    ASSERT_STR_CONTAINS(s, "kudu_test_hist_count{entity_type=\"test_entity\","
+                           "entity_id=\"my-test-same-attr1\"} 2\n");
+    ASSERT_STR_CONTAINS(s, "# TYPE kudu_test_gauge gauge\n");
+    ASSERT_STR_CONTAINS(s, "entity_id=\"my-test-same-attr1\"} 5\n");
+    // String gauges have no numeric value.
+    ASSERT_STR_NOT_CONTAINS(s, "test_string_gauge");
+  }
+
+  // The entities may be merged, and the untouched metrics skipped.
+  {
+    MetricJsonOptions opts;
+    opts.merge_rules.emplace("test_entity", MergeAttributes("merged_entity", "attr_for_merge"));
+    opts.filters.entity_metrics.emplace_back("test_counter");
+    opts.include_untouched_metrics = false;
+    std::ostringstream out;
+    ASSERT_OK(registry_.WriteAsPrometheus(&out, opts));
+    const string s = out.str();
+    ASSERT_STR_CONTAINS(s, "kudu_test_counter{entity_type=\"merged_entity\","
+                           "entity_id=\"same_attr\"} 12\n");
+    ASSERT_STR_NOT_CONTAINS(s, "diff_attr");
+    ASSERT_STR_NOT_CONTAINS(s, "kudu_test_hist");
+  }
+}
+
 METRIC_DEFINE_counter(test_entity, warn_counter, "Warn Metric", MetricUnit::kRequests,
                       "Description of warn metric",
                       kudu::MetricLevel::kWarn);
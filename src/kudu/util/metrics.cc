@@ -16,7 +16,11 @@
 // under the License.
 #include "kudu/util/metrics.h"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <iostream>
+#include <sstream>
 #include <utility>
 
 #include <gflags/gflags.h>
@@ -25,6 +29,7 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
@@ -44,6 +49,8 @@ METRIC_DEFINE_entity(server);
 
 namespace kudu {
 
+using std::ostream;
+using std::pair;
 using std::string;
 using std::unordered_set;
 using std::vector;
@@ -89,6 +96,97 @@ void WriteToJson(JsonWriter* writer,
   }
 }
 
+namespace {
+
+// Escapes 's' for it to be a label value ('escape_quotes') or the text of a
+// HELP line of the Prometheus text format.
+string EscapeForPrometheus(const string& s, bool escape_quotes) {
+  string escaped;
+  escaped.reserve(s.size());
+  for (char c : s) {
+    switch (c) {
+      case '\\':
+        escaped.append("\\\\");
+        break;
+      case '\n':
+        escaped.append("\\n");
+        break;
+      case '"':
+        escaped.append(escape_quotes ? "\\\"" : "\"");
+        break;
+      default:
+        escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+const char* PrometheusType(MetricType::Type type) {
+  switch (type) {
+    case MetricType::kCounter:
+      return "counter";
+    case MetricType::kHistogram:
+      return "summary";
+    default:
+      return "gauge";
+  }
+}
+
+// The metrics of a Prometheus metric family, i.e. of the prototypes of the
+// same name, each with the labels of its entity.
+struct PrometheusFamily {
+  const MetricPrototype* prototype = nullptr;
+  vector<pair<const string*, scoped_refptr<Metric>>> metrics;
+};
+
+typedef std::unordered_map<const MetricPrototype*,
+                           PrometheusFamily,
+                           MetricPrototypeHash,
+                           MetricPrototypeEqualTo> PrometheusFamilies;
+
+template<typename Collection>
+void AddToPrometheusFamilies(const string* labels,
+                             const Collection& metrics,
+                             const MetricJsonOptions& opts,
+                             PrometheusFamilies* families) {
+  for (const auto& val : metrics) {
+    const auto& m = val.second;
+    if (!m->ModifiedInOrAfterEpoch(opts.only_modified_in_or_after_epoch) ||
+        (!opts.include_untouched_metrics && m->IsUntouched())) {
+      continue;
+    }
+    PrometheusFamily* family = &(*families)[m->prototype()];
+    if (family->prototype == nullptr) {
+      family->prototype = m->prototype();
+    } else if (family->prototype->type() != m->prototype()->type()) {
+      // All the metrics of a family must be of the same type.
+      continue;
+    }
+    family->metrics.emplace_back(labels, m);
+  }
+}
+
+} // anonymous namespace
+
+void WritePrometheusSample(const string& name,
+                           const string& labels,
+                           double value,
+                           ostream* out) {
+  *out << name;
+  if (!labels.empty()) {
+    *out << '{' << labels << '}';
+  }
+  *out << ' ';
+  if (std::isnan(value)) {
+    *out << "NaN";
+  } else if (std::isinf(value)) {
+    *out << (value > 0 ? "+Inf" : "-Inf");
+  } else {
+    *out << SimpleDtoa(value);
+  }
+  *out << '\n';
+}
+
 //
 // MetricUnit
 //
@@ -540,6 +638,79 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer, const MetricJsonOptions&
   return Status::OK();
 }
 
+Status MetricRegistry::WriteAsPrometheus(ostream* out, const MetricJsonOptions& opts) const {
+  EntityMap entities;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    entities = entities_;
+  }
+
+  // The samples of a metric family must be written together, so the metrics
+  // are grouped by family before being written out.
+  std::deque<string> labels;
+  PrometheusFamilies families;
+  MergedEntityMetrics collections;
+  if (opts.merge_rules.empty()) {
+    for (const auto& e : entities) {
+      MetricEntity::MetricMap metrics;
+      MetricEntity::AttributeMap attrs;
+      if (!e.second->GetMetricsAndAttrs(opts.filters, &metrics, &attrs).ok()) {
+        // The entity has been filtered.
+        continue;
+      }
+      labels.emplace_back(Substitute("entity_type=\"$0\",entity_id=\"$1\"",
+                                     EscapeForPrometheus(e.second->prototype_->name(), true),
+                                     EscapeForPrometheus(e.second->id(), true)));
+      AddToPrometheusFamilies(&labels.back(), metrics, opts, &families);
+    }
+  } else {
+    for (const auto& e : entities) {
+      WARN_NOT_OK(e.second->CollectTo(&collections, opts.filters, opts.merge_rules),
+                  Substitute("Failed to collect entity $0", e.second->id()));
+    }
+    for (const auto& entity_metrics : collections) {
+      labels.emplace_back(Substitute("entity_type=\"$0\",entity_id=\"$1\"",
+                                     EscapeForPrometheus(entity_metrics.first.type_, true),
+                                     EscapeForPrometheus(entity_metrics.first.id_, true)));
+      AddToPrometheusFamilies(&labels.back(), entity_metrics.second, opts, &families);
+    }
+  }
+
+  vector<const PrometheusFamily*> sorted_families;
+  sorted_families.reserve(families.size());
+  for (const auto& f : families) {
+    sorted_families.push_back(&f.second);
+  }
+  std::sort(sorted_families.begin(), sorted_families.end(),
+            [](const PrometheusFamily* a, const PrometheusFamily* b) {
+              return strcmp(a->prototype->name(), b->prototype->name()) < 0;
+            });
+  for (const PrometheusFamily* family : sorted_families) {
+    const string name = Substitute("kudu_$0", family->prototype->name());
+    std::ostringstream samples;
+    for (const auto& m : family->metrics) {
+      m.second->WriteAsPrometheus(name, *m.first, &samples);
+    }
+    const string samples_str = samples.str();
+    if (samples_str.empty()) {
+      // Only non-numeric metrics, e.g. string gauges.
+      continue;
+    }
+    *out << "# HELP " << name << " "
+         << EscapeForPrometheus(family->prototype->description(), false) << "\n";
+    *out << "# TYPE " << name << " " << PrometheusType(family->prototype->type()) << "\n";
+    *out << samples_str;
+  }
+
+  // Like WriteAsJson(), retire the old metrics once the current ones have been
+  // dumped.
+  families.clear();
+  collections.clear();
+  entities.clear();
+  const_cast<MetricRegistry*>(this)->RetireOldMetrics();
+  return Status::OK();
+}
+
 void MetricRegistry::RetireOldMetrics() {
   std::lock_guard<simple_spinlock> l(lock_);
   for (auto it = entities_.begin(); it != entities_.end();) {
@@ -977,6 +1148,25 @@ Status Histogram::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
+void Histogram::WriteAsPrometheus(const string& name,
+                                  const string& labels,
+                                  ostream* out) const {
+  static const struct {
+    const char* quantile;
+    double percentile;
+  } kQuantiles[] = {
+    { "0.5", 50 }, { "0.75", 75 }, { "0.95", 95 }, { "0.99", 99 }, { "0.999", 99.9 },
+    { "0.9999", 99.99 },
+  };
+  const string quantile_labels_prefix = labels.empty() ? "" : labels + ",";
+  for (const auto& q : kQuantiles) {
+    WritePrometheusSample(name, Substitute("$0quantile=\"$1\"", quantile_labels_prefix, q.quantile),
+                          histogram_->ValueAtPercentile(q.percentile), out);
+  }
+  WritePrometheusSample(name + "_sum", labels, histogram_->TotalSum(), out);
+  WritePrometheusSample(name + "_count", labels, histogram_->TotalCount(), out);
+}
+
 Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                          const MetricJsonOptions& opts) const {
   snapshot_pb->set_name(prototype_->name());
@@ -223,6 +223,20 @@
 //      ...
 // ]
 //
+// =================
+// Prometheus output
+// =================
+//
+// The metrics may also be written in the Prometheus text exposition format,
+// filtered and merged like the JSON output. Each metric is named after its
+// prototype, prefixed with 'kudu_', and its entity is told by labels:
+//
+// # HELP kudu_log_reader_bytes_read Number of bytes read since tablet start
+// # TYPE kudu_log_reader_bytes_read counter
+// kudu_log_reader_bytes_read{entity_type="tablet",entity_id="e95e57ba..."} 0
+//
+// Histograms are written as summaries, and string gauges not at all.
+//
 /////////////////////////////////////////////////////
 
 #include <algorithm>
@@ -757,6 +771,14 @@ class Metric : public RefCountedThreadSafe<Metric> {
   virtual Status WriteAsJson(JsonWriter* writer,
                              const MetricJsonOptions& opts) const = 0;
 
+  // Writes the samples of this metric, named 'name' and labeled with 'labels'
+  // (e.g. 'entity_type="tablet",entity_id="abc"'), to 'out' in the Prometheus
+  // text format. Metrics with no numeric value write nothing.
+  virtual void WriteAsPrometheus(const std::string& name,
+                                 const std::string& labels,
+                                 std::ostream* out) const {
+  }
+
   const MetricPrototype* prototype() const { return prototype_; }
 
   // Return true if this metric has never been touched.
@@ -877,6 +899,14 @@ class MetricRegistry {
   // output of this function.
   Status WriteAsJson(JsonWriter* writer, const MetricJsonOptions& opts) const;
 
+  // Writes metrics in this registry to 'out' in the Prometheus text format,
+  // labeled with the type and the id of their (maybe merged) entities.
+  //
+  // The options are those of WriteAsJson(), of which only 'filters',
+  // 'merge_rules', 'only_modified_in_or_after_epoch' and
+  // 'include_untouched_metrics' apply.
+  Status WriteAsPrometheus(std::ostream* out, const MetricJsonOptions& opts) const;
+
   // For each registered entity, retires orphaned metrics. If an entity has no more
   // metrics and there are no external references, entities are removed as well.
   //
@@ -1009,6 +1039,13 @@ class GaugePrototype : public MetricPrototype {
   DISALLOW_COPY_AND_ASSIGN(GaugePrototype);
 };
 
+// Writes the sample 'value' of the metric 'name' labeled with 'labels' to 'out'
+// in the Prometheus text format. See Metric::WriteAsPrometheus().
+void WritePrometheusSample(const std::string& name,
+                           const std::string& labels,
+                           double value,
+                           std::ostream* out);
+
 // Abstract base class to provide point-in-time metric values.
 class Gauge : public Metric {
  public:
@@ -1069,6 +1106,11 @@ class MeanGauge : public Gauge {
     return false;
   }
   void MergeFrom(const scoped_refptr<Metric>& other) override;
+  void WriteAsPrometheus(const std::string& name,
+                         const std::string& labels,
+                         std::ostream* out) const override {
+    WritePrometheusSample(name, labels, value(), out);
+  }
 
  protected:
   virtual void WriteValue(JsonWriter* writer) const override;
@@ -1143,6 +1185,11 @@ class AtomicGauge : public Gauge {
         LOG(FATAL) << "Unknown AtomicGauge type: " << prototype()->name();
     }
   }
+  void WriteAsPrometheus(const std::string& name,
+                         const std::string& labels,
+                         std::ostream* out) const override {
+    WritePrometheusSample(name, labels, static_cast<double>(value()), out);
+  }
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -1239,6 +1286,12 @@ class FunctionGauge : public Gauge {
     writer->Value(value());
   }
 
+  void WriteAsPrometheus(const std::string& name,
+                         const std::string& labels,
+                         std::ostream* out) const override {
+    WritePrometheusSample(name, labels, static_cast<double>(value()), out);
+  }
+
   // Reset this FunctionGauge to return a specific value.
   // This should be used during destruction. If you want a settable
   // Gauge, use a normal Gauge instead of a FunctionGauge.
@@ -1359,6 +1412,11 @@ class Counter : public Metric {
   void IncrementBy(int64_t amount);
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
+  void WriteAsPrometheus(const std::string& name,
+                         const std::string& labels,
+                         std::ostream* out) const override {
+    WritePrometheusSample(name, labels, value(), out);
+  }
 
   virtual bool IsUntouched() const override {
     return value() == 0;
@@ -1434,6 +1492,12 @@ class Histogram : public Metric {
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
 
+  // Writes the histogram as a summary: its percentiles as quantiles, and its
+  // total sum and count.
+  void WriteAsPrometheus(const std::string& name,
+                         const std::string& labels,
+                         std::ostream* out) const override;
+
   // Returns a snapshot of this histogram including the bucketed values and counts.
   Status GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
                                 const MetricJsonOptions& opts) const;
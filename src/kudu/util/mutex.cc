@@ -34,6 +34,7 @@
 #include "kudu/util/debug-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/trace.h"
 
 using std::string;
@@ -114,6 +115,7 @@ void Mutex::Acquire() {
   if (wait_time > 0) {
     TRACE_COUNTER_INCREMENT("mutex_wait_us", wait_time);
   }
+  RecordLockContention(this, wait_time);
 
 #ifndef NDEBUG
   CheckUnheldAndMark();
@@ -259,6 +259,21 @@ Status Socket::SetReusePort(bool flag) {
   #endif
 }
 
+Status Socket::GetIncomingCpu(int* cpu) const {
+  #ifdef SO_INCOMING_CPU
+    int val = -1;
+    socklen_t val_len = sizeof(val);
+    if (::getsockopt(fd_, SOL_SOCKET, SO_INCOMING_CPU, &val, &val_len) == -1) {
+      int err = errno;
+      return Status::NetworkError("getsockopt(SO_INCOMING_CPU) failed", ErrnoToString(err), err);
+    }
+    *cpu = val;
+    return Status::OK();
+  #else
+    return Status::NotSupported("failed to get SO_INCOMING_CPU: protocol not available");
+  #endif
+}
+
 Status Socket::BindAndListen(const Sockaddr &sockaddr,
                              int listen_queue_size) {
   RETURN_NOT_OK(SetReuseAddr(true));
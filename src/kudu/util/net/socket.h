@@ -90,6 +90,10 @@ class Socket {
   // Sets SO_REUSEPORT to 'flag'. Should be used prior to Bind().
   Status SetReusePort(bool flag);
 
+  // Sets 'cpu' to the CPU which processed the most recent incoming packets of
+  // this socket (SO_INCOMING_CPU), or to -1 if that's not known yet.
+  Status GetIncomingCpu(int* cpu) const;
+
   // Convenience method to invoke the common sequence:
   // 1) SetReuseAddr(true)
   // 2) Bind()
@@ -273,6 +273,21 @@ bool SoftLimitExceeded(double* current_capacity_pct) {
   return false;
 }
 
+double SoftLimitExcess(double* current_capacity_pct) {
+  InitLimits();
+  int64_t consumption = CurrentConsumption();
+  if (consumption < g_soft_limit) {
+    return 0;
+  }
+  if (current_capacity_pct) {
+    *current_capacity_pct = static_cast<double>(consumption) / g_hard_limit * 100;
+  }
+  if (consumption >= g_hard_limit) {
+    return 1;
+  }
+  return static_cast<double>(consumption - g_soft_limit) / (g_hard_limit - g_soft_limit);
+}
+
 void MaybeGCAfterRelease(int64_t released_bytes) {
 #ifdef TCMALLOC_ENABLED
   int64_t now_released = base::subtle::NoBarrier_AtomicIncrement(
@@ -27,6 +27,14 @@ namespace process_memory {
 // of the hard limit consumed is written to it.
 bool SoftLimitExceeded(double* current_capacity_pct);
 
+// Returns how far the process-wide memory consumption is past the soft limit,
+// relative to the distance to the hard limit: 0 under the soft limit, and 1 at
+// the hard limit or above it. Unlike SoftLimitExceeded(), it's deterministic.
+//
+// If the soft limit is exceeded and 'current_capacity_pct' is not NULL, the
+// percentage of the hard limit consumed is written to it.
+double SoftLimitExcess(double* current_capacity_pct);
+
 // Return true if we are under memory pressure (i.e if we are nearing the point at which
 // SoftLimitExceeded will begin to return true).
 //
@@ -91,4 +91,17 @@ TEST(RWSemaphoreTest, TestBasicOperation) {
   }
 }
 
+TEST(RWSemaphoreTest, TestTryLockIfUnlocked) {
+  rw_semaphore sem;
+  {
+    shared_lock<rw_semaphore> l(sem);
+    ASSERT_FALSE(sem.try_lock_if_unlocked());
+  }
+  ASSERT_TRUE(sem.try_lock_if_unlocked());
+  ASSERT_FALSE(sem.try_lock_if_unlocked());
+  ASSERT_FALSE(sem.try_lock());
+  sem.unlock();
+  ASSERT_FALSE(sem.is_locked());
+}
+
 } // namespace kudu
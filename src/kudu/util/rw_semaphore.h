@@ -26,9 +26,11 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/walltime.h"
 #ifdef RW_SEMAPHORE_TRACK_HOLDER
 #include "kudu/util/debug-util.h"
 #endif
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/thread.h"
 
 namespace kudu {
@@ -68,6 +70,7 @@ class rw_semaphore {
 
   void lock_shared() {
     int loop_count = 0;
+    int64_t wait_start_micros = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect no write lock
@@ -76,8 +79,14 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      if (loop_count == 0) {
+        wait_start_micros = GetMonoTimeMicros();
+      }
       boost::detail::yield(loop_count++);
     }
+    if (PREDICT_FALSE(loop_count > 0)) {
+      RecordLockContention(this, GetMonoTimeMicros() - wait_start_micros);
+    }
   }
 
   void unlock_shared() {
@@ -115,13 +124,29 @@ class rw_semaphore {
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    // A try_lock() isn't contended, however long it waits for the readers.
+    int64_t unused_wait_start_micros = 0;
+    WaitPendingReaders(&unused_wait_start_micros);
+    RecordLockHolderStack();
+    return true;
+  }
+
+  // Tries to acquire a write lock, if no one else has it in either mode.
+  // Unlike try_lock(), this function doesn't wait for readers.
+  bool try_lock_if_unlocked() {
+    if (base::subtle::Acquire_CompareAndSwap(&state_, 0, kWriteFlag) != 0) {
+      return false;
+    }
+#ifndef NDEBUG
+    writer_tid_ = Thread::CurrentThreadId();
+#endif // NDEBUG
     RecordLockHolderStack();
     return true;
   }
 
   void lock() {
     int loop_count = 0;
+    int64_t wait_start_micros = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect some 0+ readers
@@ -132,10 +157,16 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      if (loop_count == 0) {
+        wait_start_micros = GetMonoTimeMicros();
+      }
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    WaitPendingReaders(&wait_start_micros);
+    if (PREDICT_FALSE(wait_start_micros > 0)) {
+      RecordLockContention(this, GetMonoTimeMicros() - wait_start_micros);
+    }
 
 #ifndef NDEBUG
     writer_tid_ = Thread::CurrentThreadId();
@@ -188,9 +219,14 @@ class rw_semaphore {
   }
 #endif
 
-  void WaitPendingReaders() {
+  // Sets '*wait_start_micros' to the current time if it's not already set
+  // and the readers are still pending.
+  void WaitPendingReaders(int64_t* wait_start_micros) {
     int loop_count = 0;
     while ((base::subtle::Acquire_Load(&state_) & kNumReadersMask) > 0) {
+      if (loop_count == 0 && *wait_start_micros == 0) {
+        *wait_start_micros = GetMonoTimeMicros();
+      }
       boost::detail::yield(loop_count++);
     }
   }
@@ -19,12 +19,16 @@
 #include <ostream>
 #include <string>
 
+#include <gflags/gflags_declare.h>
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/spinlock.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -43,6 +47,11 @@ namespace gutil {
 extern void SubmitSpinLockProfileData(const void *, int64);
 } // namespace gutil
 
+DECLARE_bool(lock_contention_site_profiling);
+
+using std::string;
+using std::vector;
+
 namespace kudu {
 
 class SpinLockProfilingTest : public KuduTest {};
@@ -78,4 +87,44 @@ TEST_F(SpinLockProfilingTest, TestStackCollection) {
   ASSERT_EQ(0, dropped);
 }
 
+namespace {
+// Returns the number of contentions of 'site' reported by DumpLockContention().
+int64_t GetSiteContentions(LockSite site) {
+  std::ostringstream out;
+  DumpLockContention(&out, /*as_html=*/false);
+  vector<string> lines = strings::Split(out.str(), "\n", strings::SkipEmpty());
+  for (const string& line : lines) {
+    vector<string> fields = strings::Split(line, "\t");
+    if (fields.size() > 1 && fields[0] == LockSiteName(site)) {
+      int64_t count;
+      CHECK(safe_strto64(fields[1], &count));
+      return count;
+    }
+  }
+  LOG(FATAL) << "site not found";
+  return -1;
+}
+} // anonymous namespace
+
+TEST_F(SpinLockProfilingTest, TestLockSiteAttribution) {
+  base::SpinLock registered_lock;
+  base::SpinLock other_lock;
+  ScopedLockSiteRegistration reg(&registered_lock, LockSite::kMvcc);
+  const int64_t initial = GetSiteContentions(LockSite::kMvcc);
+
+  // Nothing is attributed unless the profiling is enabled.
+  gutil::SubmitSpinLockProfileData(&registered_lock, 12345);
+  ASSERT_EQ(initial, GetSiteContentions(LockSite::kMvcc));
+
+  FLAGS_lock_contention_site_profiling = true;
+  gutil::SubmitSpinLockProfileData(&registered_lock, 12345);
+  gutil::SubmitSpinLockProfileData(&other_lock, 12345);
+  RecordLockContention(&registered_lock, 10);
+  ASSERT_EQ(initial + 2, GetSiteContentions(LockSite::kMvcc));
+
+  std::ostringstream html;
+  DumpLockContention(&html, /*as_html=*/true);
+  ASSERT_STR_CONTAINS(html.str(), "<td>mvcc</td>");
+}
+
 } // namespace kudu
@@ -34,6 +34,7 @@
 #include "kudu/util/atomic.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/lock_contention.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/striped64.h"
 #include "kudu/util/trace.h"
@@ -214,6 +215,7 @@ bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t*
 
 void SubmitSpinLockProfileData(const void *contendedlock, int64_t wait_cycles) {
   TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+  RecordLockContentionCycles(contendedlock, wait_cycles);
   bool profiling_enabled = base::subtle::Acquire_Load(&g_profiling_enabled);
   bool long_wait_time = wait_cycles > FLAGS_lock_contention_trace_threshold_cycles;
   // Short circuit this function quickly in the common case.
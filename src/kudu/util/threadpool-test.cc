@@ -540,6 +540,149 @@ TEST_F(ThreadPoolTest, TestMetrics) {
   ASSERT_EQ(6, all_metrics[0].run_time_us_histogram->TotalCount());
 }
 
+METRIC_DEFINE_gauge_int32(test_entity, active_threads, "active threads",
+                          MetricUnit::kThreads, "active threads",
+                          kudu::MetricLevel::kInfo);
+
+METRIC_DEFINE_gauge_int32(test_entity, max_threads, "max threads",
+                          MetricUnit::kThreads, "max threads",
+                          kudu::MetricLevel::kInfo);
+
+TEST_F(ThreadPoolTest, TestUtilizationMetrics) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> pool_entity = METRIC_ENTITY_test_entity.Instantiate(
+      &registry, "pool");
+  scoped_refptr<MetricEntity> token_entity = METRIC_ENTITY_test_entity.Instantiate(
+      &registry, "token");
+  ThreadPoolMetrics pool_metrics;
+  pool_metrics.active_threads_gauge = METRIC_active_threads.Instantiate(pool_entity, 0);
+  pool_metrics.max_threads_gauge = METRIC_max_threads.Instantiate(pool_entity, 0);
+  ThreadPoolMetrics token_metrics;
+  token_metrics.active_threads_gauge = METRIC_active_threads.Instantiate(token_entity, 0);
+
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(2)
+                                   .set_metrics(pool_metrics)));
+  ASSERT_EQ(2, pool_metrics.max_threads_gauge->value());
+  unique_ptr<ThreadPoolToken> token = pool_->NewTokenWithMetrics(
+      ThreadPool::ExecutionMode::SERIAL, token_metrics);
+
+  CountDownLatch latch(1);
+  ASSERT_OK(token->Submit([&latch]() { latch.Wait(); }));
+  ASSERT_OK(pool_->Submit([&latch]() { latch.Wait(); }));
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(2, pool_metrics.active_threads_gauge->value());
+    ASSERT_EQ(1, token_metrics.active_threads_gauge->value());
+  });
+  latch.CountDown();
+  pool_->Wait();
+  ASSERT_EQ(0, pool_metrics.active_threads_gauge->value());
+  ASSERT_EQ(0, token_metrics.active_threads_gauge->value());
+}
+
+// Test that a pool with adaptive sizing raises its maximum number of threads
+// while tasks wait in its queue, and lowers it back once they don't.
+TEST_F(ThreadPoolTest, TestAdaptiveSizing) {
+  if (base::NumCPUs() < 4) {
+    // The pool only grows while the system has idle CPU cores.
+    LOG(WARNING) << "skipping test: not enough CPU cores";
+    GTEST_SKIP();
+  }
+  constexpr int kMaxThreadsLimit = 3;
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(1)
+                                   .set_adaptive_sizing(kMaxThreadsLimit,
+                                                        MonoDelta::FromMilliseconds(1))));
+  ASSERT_EQ(1, pool_->max_threads());
+
+  // Keep the queue busy with tasks which sleep rather than use the CPU.
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(pool_->Submit([]() { SleepFor(MonoDelta::FromMilliseconds(10)); }));
+  }
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(kMaxThreadsLimit, pool_->max_threads());
+  });
+  ASSERT_GT(pool_->num_threads(), 1);
+  pool_->Wait();
+
+  // Instant tasks don't wait in the queue, so the maximum is lowered back.
+  ASSERT_EVENTUALLY([&]() {
+    for (int i = 0; i < 10; i++) {
+      ASSERT_OK(pool_->Submit([]() {}));
+      pool_->Wait();
+      SleepFor(MonoDelta::FromMilliseconds(20));
+    }
+    ASSERT_EQ(1, pool_->max_threads());
+  });
+}
+
+// Test that the idle threads of a sharded pool run the tasks queued in the
+// shards whose threads are busy.
+TEST_F(ThreadPoolTest, TestShardedPoolStealsTasks) {
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_min_threads(2)
+                                   .set_max_threads(2)
+                                   .set_num_shards(2)));
+  ASSERT_EQ(2, pool_->max_threads());
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(2, pool_->num_threads());
+  });
+
+  // Both tasks are queued in the same shard, which only has one thread.
+  unique_ptr<ThreadPoolToken> t = pool_->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  CountDownLatch blocker(1);
+  CountDownLatch done(1);
+  ASSERT_OK(t->Submit([&blocker]() { blocker.Wait(); }));
+  ASSERT_OK(t->Submit([&done]() { done.CountDown(); }));
+  ASSERT_TRUE(done.WaitFor(MonoDelta::FromSeconds(10)));
+  ASSERT_EVENTUALLY([&]() {
+    ASSERT_EQ(1, pool_->num_active_threads());
+  });
+
+  blocker.CountDown();
+  pool_->Wait();
+  ASSERT_EQ(0, pool_->num_active_threads());
+}
+
+// Test that the tasks of serial tokens run in order even when the threads of
+// the other shards of the pool steal them, and that Wait() also waits for the
+// tasks submitted while it's waiting for the other shards.
+TEST_F(ThreadPoolTest, TestShardedPoolSerialTokens) {
+  constexpr int kNumTokens = 16;
+  constexpr int kNumTasksPerToken = 200;
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_max_threads(8)
+                                   .set_num_shards(4)));
+  vector<unique_ptr<ThreadPoolToken>> tokens;
+  vector<vector<int>> results(kNumTokens);
+  for (int i = 0; i < kNumTokens; i++) {
+    tokens.emplace_back(pool_->NewToken(ThreadPool::ExecutionMode::SERIAL));
+  }
+  atomic<int> num_chained(0);
+  for (int i = 0; i < kNumTasksPerToken; i++) {
+    for (int j = 0; j < kNumTokens; j++) {
+      ASSERT_OK(tokens[j]->Submit([&, i, j]() {
+        results[j].push_back(i);
+        if (i == kNumTasksPerToken - 1) {
+          // Submit a task to a token which is likely in another shard.
+          CHECK_OK(tokens[(j + 1) % kNumTokens]->Submit([&]() {
+            SleepFor(MonoDelta::FromMilliseconds(10));
+            num_chained++;
+          }));
+        }
+      }));
+    }
+  }
+  pool_->Wait();
+  ASSERT_EQ(kNumTokens, num_chained);
+  for (int j = 0; j < kNumTokens; j++) {
+    ASSERT_EQ(kNumTasksPerToken, results[j].size());
+    for (int i = 0; i < kNumTasksPerToken; i++) {
+      ASSERT_EQ(i, results[j][i]);
+    }
+  }
+}
+
 // Test scenario to verify the functionality of the QueueLoadMeter.
 TEST_F(ThreadPoolTest, QueueLoadMeter) {
   const auto kQueueTimeThresholdMs = 100;
@@ -865,6 +1008,66 @@ TEST_P(ThreadPoolPerformanceTest, ConcurrentAndSerialTasksMix) {
           time_elapsed.wall_seconds());
 }
 
+// A test to assess how the throughput of a pool scales with the number of its
+// shards when many threads submit tiny tasks to it.
+class ThreadPoolShardingPerformanceTest :
+    public ThreadPoolTest,
+    public testing::WithParamInterface<int> {
+};
+INSTANTIATE_TEST_SUITE_P(NumShards, ThreadPoolShardingPerformanceTest,
+                         ::testing::Values(1, 4, 16));
+
+TEST_P(ThreadPoolShardingPerformanceTest, ConcurrentAndSerialTasksMix) {
+  SKIP_IF_SLOW_NOT_ALLOWED();
+
+  constexpr auto kNumTasksPerSchedulerThread = 25000;
+  const auto kNumCPUs = base::NumCPUs();
+  const auto kNumShards = GetParam();
+  const auto kMaxThreads = std::max(kNumShards, kNumCPUs);
+  const auto kNumSchedulerThreads = std::max(2, kNumCPUs);
+  const auto kNumSerialTokens = kNumSchedulerThreads / 4;
+
+  ASSERT_OK(RebuildPoolWithBuilder(ThreadPoolBuilder(kDefaultPoolName)
+                                   .set_min_threads(kMaxThreads)
+                                   .set_max_threads(kMaxThreads)
+                                   .set_num_shards(kNumShards)));
+
+  vector<thread> threads;
+  threads.reserve(kNumSchedulerThreads);
+  Barrier b(kNumSchedulerThreads + 1);
+  for (auto si = 0; si < kNumSchedulerThreads; ++si) {
+    threads.emplace_back([&, si]() {
+      unique_ptr<ThreadPoolToken> token(pool_->NewToken(
+          (si < kNumSerialTokens) ? ThreadPool::ExecutionMode::SERIAL
+                                  : ThreadPool::ExecutionMode::CONCURRENT));
+      b.Wait();
+      for (auto i = 0; i < kNumTasksPerSchedulerThread; ++i) {
+        CHECK_OK(token->Submit([](){}));
+      }
+      token->Wait();
+    });
+  }
+
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  b.Wait();
+  sw.start();
+  for (auto& t : threads) {
+    t.join();
+  }
+  pool_->Wait();
+  sw.stop();
+
+  const auto time_elapsed = sw.elapsed();
+  LOG(INFO) << Substitute("Processed $0 tasks in $1",
+                          kNumSchedulerThreads * kNumTasksPerSchedulerThread,
+                          time_elapsed.ToString());
+  LOG(INFO) << Substitute(
+      "Processing rate ($0 shards): $1 tasks/sec",
+      kNumShards,
+      static_cast<double>(kNumSchedulerThreads * kNumTasksPerSchedulerThread) /
+          time_elapsed.wall_seconds());
+}
+
 // Test that a thread pool will crash if asked to run its own blocking
 // functions in a pool thread.
 //
@@ -17,6 +17,9 @@
 
 #include "kudu/util/threadpool.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <functional>
 #include <limits>
@@ -32,6 +35,8 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/walltime.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/thread.h"
@@ -46,6 +51,38 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
+namespace {
+
+// How often a pool with adaptive sizing evaluates its load, at most.
+const MonoDelta kAdaptiveSizingPeriod = MonoDelta::FromMilliseconds(100);
+
+// Returns the share of 'total' of the shard with index 'idx' among
+// 'num_shards' shards.
+int ShardShare(int total, int num_shards, int idx) {
+  return total / num_shards + (idx < total % num_shards ? 1 : 0);
+}
+
+// Returns whether fewer threads are runnable system-wide than there are CPU
+// cores, i.e. whether additional worker threads could run without taking CPU
+// time from other threads.
+bool HasIdleCpuCores() {
+  faststring buf;
+  if (!ReadFileToString(Env::Default(), "/proc/stat", &buf).ok()) {
+    return false;
+  }
+  static const char kProcsRunning[] = "\nprocs_running ";
+  const string stat = buf.ToString();
+  const auto pos = stat.find(kProcsRunning);
+  if (pos == string::npos) {
+    return false;
+  }
+  // The count includes the thread reading it.
+  const int procs_running = atoi(stat.c_str() + pos + strlen(kProcsRunning));
+  return procs_running < base::NumCPUs();
+}
+
+} // anonymous namespace
+
 ////////////////////////////////////////////////////////
 // ThreadPoolBuilder
 ////////////////////////////////////////////////////////
@@ -56,8 +93,10 @@ ThreadPoolBuilder::ThreadPoolBuilder(string name)
       max_threads_(base::NumCPUs()),
       max_queue_size_(std::numeric_limits<int>::max()),
       idle_timeout_(MonoDelta::FromMilliseconds(500)),
+      max_threads_limit_(0),
       enable_scheduler_(false),
-      schedule_period_ms_(100) {}
+      schedule_period_ms_(100),
+      num_shards_(1) {}
 
 ThreadPoolBuilder& ThreadPoolBuilder::set_trace_metric_prefix(const string& prefix) {
   trace_metric_prefix_ = prefix;
@@ -91,6 +130,15 @@ ThreadPoolBuilder& ThreadPoolBuilder::set_metrics(ThreadPoolMetrics metrics) {
   return *this;
 }
 
+ThreadPoolBuilder& ThreadPoolBuilder::set_adaptive_sizing(int max_threads_limit,
+                                                          const MonoDelta& target_queue_time) {
+  CHECK_GT(max_threads_limit, 0);
+  CHECK(target_queue_time.Initialized());
+  max_threads_limit_ = max_threads_limit;
+  target_queue_time_ = target_queue_time;
+  return *this;
+}
+
 ThreadPoolBuilder& ThreadPoolBuilder::set_enable_scheduler() {
   enable_scheduler_ = true;
   return *this;
@@ -101,6 +149,12 @@ ThreadPoolBuilder& ThreadPoolBuilder::set_schedule_period_ms(uint32_t schedule_p
   return *this;
 }
 
+ThreadPoolBuilder& ThreadPoolBuilder::set_num_shards(int num_shards) {
+  CHECK_GT(num_shards, 0);
+  num_shards_ = num_shards;
+  return *this;
+}
+
 ThreadPoolBuilder& ThreadPoolBuilder::set_queue_overload_threshold(
     const MonoDelta& threshold) {
   queue_overload_threshold_ = threshold;
@@ -341,16 +395,25 @@ const char* ThreadPoolToken::StateToString(State s) {
 ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     : name_(builder.name_),
       min_threads_(builder.min_threads_),
-      max_threads_(builder.max_threads_),
+      base_max_threads_(builder.max_threads_),
+      max_threads_limit_(builder.max_threads_limit_ > 0 ?
+                         std::max(builder.max_threads_limit_, builder.max_threads_) : 0),
+      target_queue_time_(builder.target_queue_time_),
       max_queue_size_(builder.max_queue_size_),
       idle_timeout_(builder.idle_timeout_),
+      parent_(nullptr),
+      next_shard_(0),
       pool_status_(Status::Uninitialized("The pool was not initialized.")),
       idle_cond_(&lock_),
       no_threads_cond_(&lock_),
       num_threads_(0),
       num_threads_pending_start_(0),
       active_threads_(0),
+      max_threads_(builder.max_threads_),
+      max_queue_time_since_resize_(MonoDelta::FromNanoseconds(0)),
+      last_resize_time_(MonoTime::Now()),
       total_queued_tasks_(0),
+      num_submitted_(0),
       tokenless_(NewToken(ExecutionMode::CONCURRENT)),
       metrics_(builder.metrics_),
       scheduler_(nullptr),
@@ -366,10 +429,42 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
   run_cpu_time_trace_metric_name_ = TraceMetrics::InternName(
       prefix + ".run_cpu_time_us");
 
+  if (metrics_.max_threads_gauge) {
+    metrics_.max_threads_gauge->set_value(max_threads_);
+  }
+
   const auto& ovt = builder.queue_overload_threshold_;
   if (ovt.Initialized() && ovt.ToNanoseconds() > 0) {
     load_meter_.reset(new QueueLoadMeter(*this, ovt, max_threads_));
   }
+
+  const int num_shards = std::min(builder.num_shards_, base_max_threads_);
+  if (num_shards > 1) {
+    ThreadPoolMetrics shard_metrics = metrics_;
+    // The maximum number of threads of the pool is the sum of those of its
+    // shards, which is what 'max_threads_gauge' tracks already.
+    shard_metrics.max_threads_gauge = nullptr;
+    for (int i = 0; i < num_shards; i++) {
+      ThreadPoolBuilder b(name_);
+      b.set_trace_metric_prefix(prefix)
+       .set_min_threads(ShardShare(min_threads_, num_shards, i))
+       .set_max_threads(ShardShare(base_max_threads_, num_shards, i))
+       .set_max_queue_size(ShardShare(max_queue_size_, num_shards, i))
+       .set_idle_timeout(idle_timeout_)
+       .set_queue_overload_threshold(builder.queue_overload_threshold_)
+       .set_metrics(shard_metrics)
+       .set_schedule_period_ms(schedule_period_ms_);
+      if (max_threads_limit_ > 0) {
+        b.set_adaptive_sizing(ShardShare(max_threads_limit_, num_shards, i),
+                              target_queue_time_);
+      }
+      if (enable_scheduler_) {
+        b.set_enable_scheduler();
+      }
+      shards_.emplace_back(new ThreadPool(b));
+      shards_.back()->parent_ = this;
+    }
+  }
 }
 
 ThreadPool::~ThreadPool() {
@@ -385,6 +480,16 @@ Status ThreadPool::Init() {
     return Status::NotSupported("The thread pool is already initialized");
   }
   pool_status_ = Status::OK();
+  if (!shards_.empty()) {
+    for (auto& s : shards_) {
+      Status status = s->Init();
+      if (!status.ok()) {
+        Shutdown();
+        return status;
+      }
+    }
+    return Status::OK();
+  }
   num_threads_pending_start_ = min_threads_;
   for (int i = 0; i < min_threads_; i++) {
     Status status = CreateThread();
@@ -401,6 +506,17 @@ Status ThreadPool::Init() {
 }
 
 void ThreadPool::Shutdown() {
+  if (!shards_.empty()) {
+    {
+      MutexLock l(lock_);
+      pool_status_ = Status::ServiceUnavailable("The pool has been shut down.");
+    }
+    for (auto& s : shards_) {
+      s->Shutdown();
+    }
+    return;
+  }
+
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
 
@@ -455,6 +571,11 @@ void ThreadPool::Shutdown() {
   while (num_threads_ + num_threads_pending_start_ > 0) {
     no_threads_cond_.Wait();
   }
+  // Worker threads of the other shards of the pool may still be running the
+  // tasks they stole from this one.
+  while (active_threads_ > 0) {
+    idle_cond_.Wait();
+  }
 
   // All the threads have exited. Check the state of each token.
   for (auto* t : tokens_) {
@@ -479,6 +600,10 @@ unique_ptr<ThreadPoolToken> ThreadPool::NewToken(ExecutionMode mode) {
 
 unique_ptr<ThreadPoolToken> ThreadPool::NewTokenWithMetrics(
     ExecutionMode mode, ThreadPoolMetrics metrics) {
+  if (!shards_.empty()) {
+    const auto idx = next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+    return shards_[idx]->NewTokenWithMetrics(mode, std::move(metrics));
+  }
   MutexLock guard(lock_);
   unique_ptr<ThreadPoolToken> t(new ThreadPoolToken(this,
                                                     mode,
@@ -489,6 +614,20 @@ unique_ptr<ThreadPoolToken> ThreadPool::NewTokenWithMetrics(
 
 bool ThreadPool::QueueOverloaded(MonoDelta* overloaded_time,
                                  MonoDelta* threshold) const {
+  if (!shards_.empty()) {
+    // The pool is overloaded if any of its shards is.
+    bool overloaded = false;
+    for (const auto& s : shards_) {
+      MonoDelta shard_overloaded_time;
+      if (s->QueueOverloaded(&shard_overloaded_time, threshold)) {
+        if (overloaded_time && (!overloaded || shard_overloaded_time > *overloaded_time)) {
+          *overloaded_time = shard_overloaded_time;
+        }
+        overloaded = true;
+      }
+    }
+    return overloaded;
+  }
   if (!load_meter_) {
     return false;
   }
@@ -506,6 +645,10 @@ void ThreadPool::ReleaseToken(ThreadPoolToken* t) {
 }
 
 Status ThreadPool::Submit(std::function<void()> f) {
+  if (!shards_.empty()) {
+    const auto idx = next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+    return shards_[idx]->Submit(std::move(f));
+  }
   return DoSubmit(std::move(f), tokenless_.get());
 }
 
@@ -559,6 +702,9 @@ Status ThreadPool::DoSubmit(std::function<void()> f, ThreadPoolToken* token) {
     need_a_thread = true;
     num_threads_pending_start_++;
   }
+  // If this is a shard which is short of threads for the task, have an idle
+  // thread of another shard steal it.
+  const bool need_a_thief = parent_ && additional_threads > 0 && !need_a_thread;
 
   Task task;
   task.func = std::move(f);
@@ -583,6 +729,7 @@ Status ThreadPool::DoSubmit(std::function<void()> f, ThreadPoolToken* token) {
     }
   }
   int length_at_submit = total_queued_tasks_++;
+  num_submitted_++;
 
   // Wake up an idle thread for this task. Choosing the thread at the front of
   // the list ensures LIFO semantics as idling threads are also added to the front.
@@ -612,6 +759,10 @@ Status ThreadPool::DoSubmit(std::function<void()> f, ThreadPoolToken* token) {
     metrics_.queue_length_histogram->Increment(length_at_submit);
   }
 
+  if (need_a_thief) {
+    parent_->WakeThreadToSteal(this);
+  }
+
   if (need_a_thread) {
     Status status = CreateThread();
     if (!status.ok()) {
@@ -632,14 +783,16 @@ Status ThreadPool::DoSubmit(std::function<void()> f, ThreadPoolToken* token) {
 }
 
 void ThreadPool::Wait() {
-  MutexLock unique_lock(lock_);
-  CheckNotPoolThreadUnlocked();
-  while (total_queued_tasks_ > 0 || active_threads_ > 0) {
-    idle_cond_.Wait();
-  }
+  WaitIdleUntil(nullptr, nullptr);
 }
 
 void ThreadPool::WaitForScheduler() {
+  if (!shards_.empty()) {
+    for (auto& s : shards_) {
+      s->WaitForScheduler();
+    }
+    return;
+  }
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
   // Generally, ignore scheduler's pending tasks, but
@@ -652,13 +805,47 @@ void ThreadPool::WaitForScheduler() {
 }
 
 bool ThreadPool::WaitUntil(const MonoTime& until) {
+  return WaitIdleUntil(&until, nullptr);
+}
+
+bool ThreadPool::WaitIdleUntil(const MonoTime* until, int64_t* num_submitted) {
+  if (!shards_.empty()) {
+    // A task run by one shard may submit tasks to another shard which was
+    // already found idle. So the shards are waited for again until no task
+    // was submitted to any of them since they were last found idle: each
+    // shard was then idle during the whole time in between.
+    int64_t prev_submitted = -1;
+    while (true) {
+      int64_t submitted = 0;
+      for (auto& s : shards_) {
+        int64_t shard_submitted;
+        if (!s->WaitIdleUntil(until, &shard_submitted)) {
+          return false;
+        }
+        submitted += shard_submitted;
+      }
+      if (submitted == prev_submitted) {
+        if (num_submitted) {
+          *num_submitted = submitted;
+        }
+        return true;
+      }
+      prev_submitted = submitted;
+    }
+  }
+
   MutexLock unique_lock(lock_);
   CheckNotPoolThreadUnlocked();
   while (total_queued_tasks_ > 0 || active_threads_ > 0) {
-    if (!idle_cond_.WaitUntil(until)) {
+    if (!until) {
+      idle_cond_.Wait();
+    } else if (!idle_cond_.WaitUntil(*until)) {
       return false;
     }
   }
+  if (num_submitted) {
+    *num_submitted = num_submitted_;
+  }
   return true;
 }
 
@@ -686,6 +873,17 @@ void ThreadPool::DispatchThread() {
       break;
     }
 
+    if (queue_.empty() && parent_) {
+      // Before going idle, help the other shards of the pool with their
+      // queued tasks, if they're short of threads.
+      unique_lock.Unlock();
+      const bool stole = parent_->StealTaskFromShards(this);
+      unique_lock.Lock();
+      if (stole || !queue_.empty()) {
+        continue;
+      }
+    }
+
     if (queue_.empty()) {
       // There's no work to do, let's go idle.
       //
@@ -721,95 +919,20 @@ void ThreadPool::DispatchThread() {
     }
 
     // Get the next token and task to execute.
-    ThreadPoolToken* token = queue_.front();
-    queue_.pop_front();
-    DCHECK_EQ(ThreadPoolToken::State::RUNNING, token->state());
-    DCHECK(!token->entries_.empty());
-    Task task = std::move(token->entries_.front());
-    token->entries_.pop_front();
-    token->active_threads_++;
-    --total_queued_tasks_;
-    ++active_threads_;
-
-    const MonoTime now(MonoTime::Now());
-    const MonoDelta queue_time = now - task.submit_time;
-    NotifyLoadMeterUnlocked(queue_time);
+    ThreadPoolToken* token;
+    Task task;
+    MonoDelta queue_time;
+    const bool resize_due = DequeueTaskUnlocked(&token, &task, &queue_time);
 
     unique_lock.Unlock();
 
-    // Release the reference which was held by the queued item.
-    ADOPT_TRACE(task.trace);
-    if (task.trace) {
-      task.trace->Release();
-    }
-
-    // Update metrics.
-    const int64_t queue_time_us = queue_time.ToMicroseconds();
-    TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
-    if (metrics_.queue_time_us_histogram) {
-      metrics_.queue_time_us_histogram->Increment(queue_time_us);
-    }
-    if (token->metrics_.queue_time_us_histogram) {
-      token->metrics_.queue_time_us_histogram->Increment(queue_time_us);
+    if (resize_due) {
+      ResizeForLoad();
     }
+    RunTask(token, &task, queue_time);
 
-    // Execute the task
-    {
-      MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
-      MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
-
-      task.func();
-
-      int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
-      int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
-
-      if (metrics_.run_time_us_histogram) {
-        metrics_.run_time_us_histogram->Increment(wall_us);
-      }
-      if (token->metrics_.run_time_us_histogram) {
-        token->metrics_.run_time_us_histogram->Increment(wall_us);
-      }
-      TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
-      TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
-    }
-    // Destruct the task while we do not hold the lock.
-    //
-    // The task's destructor may be expensive if it has a lot of bound
-    // objects, and we don't want to block submission of the threadpool.
-    // In the worst case, the destructor might even try to do something
-    // with this threadpool, and produce a deadlock.
-    task.func = nullptr;
     unique_lock.Lock();
-
-    // Possible states:
-    // 1. The token was shut down while we ran its task. Transition to QUIESCED.
-    // 2. The token has no more queued tasks. Transition back to IDLE.
-    // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
-    ThreadPoolToken::State state = token->state();
-    DCHECK(state == ThreadPoolToken::State::RUNNING ||
-           state == ThreadPoolToken::State::QUIESCING);
-    if (--token->active_threads_ == 0) {
-      if (state == ThreadPoolToken::State::QUIESCING) {
-        DCHECK(token->entries_.empty());
-        token->Transition(ThreadPoolToken::State::QUIESCED);
-      } else if (token->entries_.empty()) {
-        token->Transition(ThreadPoolToken::State::IDLE);
-      } else if (token->mode() == ExecutionMode::SERIAL) {
-        queue_.emplace_back(token);
-      }
-    }
-    if (!queue_.empty()) {
-      // If the queue is empty, the LoadMeter is notified on next iteration of
-      // the outer while() loop under the 'if (queue_.empty())' clause. Here
-      // it's crucial to call NotifyLoadMeter() _before_ decrementing
-      // 'active_threads_' to avoid reporting this thread as a spare one despite
-      // the fact that it will run a task from the non-empty queue immediately
-      // on next iteration of the outer while() loop.
-      NotifyLoadMeterUnlocked();
-    }
-    if (--active_threads_ == 0) {
-      idle_cond_.Broadcast();
-    }
+    FinishTaskUnlocked(token);
   }
 
   // It's important that we hold the lock between exiting the loop and dropping
@@ -829,6 +952,180 @@ void ThreadPool::DispatchThread() {
   }
 }
 
+bool ThreadPool::DequeueTaskUnlocked(ThreadPoolToken** token, Task* task,
+                                     MonoDelta* queue_time) {
+  lock_.AssertAcquired();
+  ThreadPoolToken* t = queue_.front();
+  queue_.pop_front();
+  DCHECK_EQ(ThreadPoolToken::State::RUNNING, t->state());
+  DCHECK(!t->entries_.empty());
+  *task = std::move(t->entries_.front());
+  t->entries_.pop_front();
+  t->active_threads_++;
+  --total_queued_tasks_;
+  ++active_threads_;
+  if (metrics_.active_threads_gauge) {
+    metrics_.active_threads_gauge->Increment();
+  }
+  if (t->metrics_.active_threads_gauge) {
+    t->metrics_.active_threads_gauge->Increment();
+  }
+  *token = t;
+
+  const MonoTime now(MonoTime::Now());
+  *queue_time = now - task->submit_time;
+  NotifyLoadMeterUnlocked(*queue_time);
+  return UpdateAdaptiveSizingUnlocked(now, *queue_time);
+}
+
+void ThreadPool::RunTask(ThreadPoolToken* token, Task* task, const MonoDelta& queue_time) {
+  // Release the reference which was held by the queued item.
+  ADOPT_TRACE(task->trace);
+  if (task->trace) {
+    task->trace->Release();
+  }
+
+  // Update metrics.
+  const int64_t queue_time_us = queue_time.ToMicroseconds();
+  TRACE_COUNTER_INCREMENT(queue_time_trace_metric_name_, queue_time_us);
+  if (metrics_.queue_time_us_histogram) {
+    metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  }
+  if (token->metrics_.queue_time_us_histogram) {
+    token->metrics_.queue_time_us_histogram->Increment(queue_time_us);
+  }
+
+  // Execute the task
+  {
+    MicrosecondsInt64 start_wall_us = GetMonoTimeMicros();
+    MicrosecondsInt64 start_cpu_us = GetThreadCpuTimeMicros();
+
+    task->func();
+
+    int64_t wall_us = GetMonoTimeMicros() - start_wall_us;
+    int64_t cpu_us = GetThreadCpuTimeMicros() - start_cpu_us;
+
+    if (metrics_.run_time_us_histogram) {
+      metrics_.run_time_us_histogram->Increment(wall_us);
+    }
+    if (token->metrics_.run_time_us_histogram) {
+      token->metrics_.run_time_us_histogram->Increment(wall_us);
+    }
+    TRACE_COUNTER_INCREMENT(run_wall_time_trace_metric_name_, wall_us);
+    TRACE_COUNTER_INCREMENT(run_cpu_time_trace_metric_name_, cpu_us);
+  }
+  // Destruct the task while we do not hold the lock.
+  //
+  // The task's destructor may be expensive if it has a lot of bound
+  // objects, and we don't want to block submission of the threadpool.
+  // In the worst case, the destructor might even try to do something
+  // with this threadpool, and produce a deadlock.
+  task->func = nullptr;
+}
+
+void ThreadPool::FinishTaskUnlocked(ThreadPoolToken* token) {
+  lock_.AssertAcquired();
+  // Possible states:
+  // 1. The token was shut down while we ran its task. Transition to QUIESCED.
+  // 2. The token has no more queued tasks. Transition back to IDLE.
+  // 3. The token has more tasks. Requeue it and transition back to RUNNABLE.
+  ThreadPoolToken::State state = token->state();
+  DCHECK(state == ThreadPoolToken::State::RUNNING ||
+         state == ThreadPoolToken::State::QUIESCING);
+  if (token->metrics_.active_threads_gauge) {
+    token->metrics_.active_threads_gauge->IncrementBy(-1);
+  }
+  if (--token->active_threads_ == 0) {
+    if (state == ThreadPoolToken::State::QUIESCING) {
+      DCHECK(token->entries_.empty());
+      token->Transition(ThreadPoolToken::State::QUIESCED);
+    } else if (token->entries_.empty()) {
+      token->Transition(ThreadPoolToken::State::IDLE);
+    } else if (token->mode() == ExecutionMode::SERIAL) {
+      queue_.emplace_back(token);
+    }
+  }
+  if (!queue_.empty()) {
+    // If the queue is empty, the LoadMeter is notified on next iteration of
+    // the outer while() loop under the 'if (queue_.empty())' clause. Here
+    // it's crucial to call NotifyLoadMeter() _before_ decrementing
+    // 'active_threads_' to avoid reporting this thread as a spare one despite
+    // the fact that it will run a task from the non-empty queue immediately
+    // on next iteration of the outer while() loop.
+    NotifyLoadMeterUnlocked();
+  }
+  if (metrics_.active_threads_gauge) {
+    metrics_.active_threads_gauge->IncrementBy(-1);
+  }
+  if (--active_threads_ == 0) {
+    idle_cond_.Broadcast();
+  }
+}
+
+bool ThreadPool::StealTask() {
+  MutexLock unique_lock(lock_);
+  // Only steal from a shard whose own threads can't keep up with its queue.
+  if (!pool_status_.ok() || queue_.empty() ||
+      !idle_threads_.empty() || num_threads_pending_start_ > 0) {
+    return false;
+  }
+  // While it runs the task, the thief counts as a thread of this shard, so
+  // that it's detected if the task would deadlock by waiting for the shard.
+  Thread* current = Thread::current_thread();
+  InsertOrDie(&threads_, current);
+
+  ThreadPoolToken* token;
+  Task task;
+  MonoDelta queue_time;
+  const bool resize_due = DequeueTaskUnlocked(&token, &task, &queue_time);
+
+  unique_lock.Unlock();
+
+  if (resize_due) {
+    ResizeForLoad();
+  }
+  RunTask(token, &task, queue_time);
+
+  unique_lock.Lock();
+  FinishTaskUnlocked(token);
+  CHECK_EQ(threads_.erase(current), 1);
+  return true;
+}
+
+bool ThreadPool::StealTaskFromShards(const ThreadPool* thief) {
+  DCHECK(!shards_.empty());
+  // Start from a different shard each time so that the busiest shards aren't
+  // always the last to be helped.
+  const size_t start = next_shard_.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < shards_.size(); i++) {
+    ThreadPool* victim = shards_[(start + i) % shards_.size()].get();
+    if (victim != thief && victim->StealTask()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WakeThreadToSteal(const ThreadPool* busy) {
+  DCHECK(!shards_.empty());
+  for (auto& s : shards_) {
+    if (s.get() != busy && s->WakeIdleThread()) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::WakeIdleThread() {
+  MutexLock guard(lock_);
+  if (idle_threads_.empty()) {
+    return false;
+  }
+  idle_threads_.front().not_empty.Signal();
+  idle_threads_.pop_front();
+  NotifyLoadMeterUnlocked();
+  return true;
+}
+
 Status ThreadPool::CreateThread() {
   return kudu::Thread::Create("thread pool", strings::Substitute("$0 [worker]", name_),
                               [this]() { this->DispatchThread(); }, nullptr);
@@ -859,6 +1156,70 @@ void ThreadPool::NotifyLoadMeterUnlocked(const MonoDelta& queue_time) {
                                        active_threads_ < max_threads_);
 }
 
+bool ThreadPool::UpdateAdaptiveSizingUnlocked(const MonoTime& now,
+                                              const MonoDelta& queue_time) {
+  if (max_threads_limit_ == 0) {
+    return false;
+  }
+  lock_.AssertAcquired();
+  if (queue_time > max_queue_time_since_resize_) {
+    max_queue_time_since_resize_ = queue_time;
+  }
+  if (now - last_resize_time_ < kAdaptiveSizingPeriod) {
+    return false;
+  }
+  // Reset here rather than in ResizeForLoad() so that only one worker
+  // evaluates the load of the pool per period.
+  last_resize_time_ = now;
+  return true;
+}
+
+void ThreadPool::ResizeForLoad() {
+  // Reading the system's CPU load involves reading from /proc, so do it
+  // without holding the lock.
+  const bool has_idle_cores = HasIdleCpuCores();
+
+  MutexLock guard(lock_);
+  const MonoDelta max_queue_time = max_queue_time_since_resize_;
+  max_queue_time_since_resize_ = MonoDelta::FromNanoseconds(0);
+  bool need_a_thread = false;
+  if (max_queue_time > target_queue_time_) {
+    if (has_idle_cores && max_threads_ < max_threads_limit_) {
+      max_threads_++;
+      if (metrics_.max_threads_gauge) {
+        metrics_.max_threads_gauge->set_value(max_threads_);
+      }
+      VLOG(1) << Substitute("Raised the maximum number of threads of pool $0 to $1: "
+                            "tasks waited up to $2 in the queue",
+                            name_, max_threads_, max_queue_time.ToString());
+      // Start the additional thread right away if there are tasks waiting,
+      // rather than at the next submission.
+      if (!queue_.empty() && num_threads_ + num_threads_pending_start_ < max_threads_) {
+        need_a_thread = true;
+        num_threads_pending_start_++;
+      }
+    }
+  } else if (max_queue_time.ToNanoseconds() * 2 < target_queue_time_.ToNanoseconds() &&
+             max_threads_ > base_max_threads_) {
+    max_threads_--;
+    if (metrics_.max_threads_gauge) {
+      metrics_.max_threads_gauge->set_value(max_threads_);
+    }
+    VLOG(1) << Substitute("Lowered the maximum number of threads of pool $0 to $1",
+                          name_, max_threads_);
+  }
+  guard.Unlock();
+
+  if (need_a_thread) {
+    Status s = CreateThread();
+    if (!s.ok()) {
+      guard.Lock();
+      num_threads_pending_start_--;
+      LOG(ERROR) << "Thread pool failed to create thread: " << s.ToString();
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////
 // ThreadPool::QueueLoadMeter
 ////////////////////////////////////////////////////////
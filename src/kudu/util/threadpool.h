@@ -29,6 +29,7 @@
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive/list_hook.hpp>
@@ -63,6 +64,13 @@ struct ThreadPoolMetrics {
 
   // Measures the amount of time that tasks spend running.
   scoped_refptr<Histogram> run_time_us_histogram;
+
+  // Tracks the number of worker threads currently running tasks.
+  scoped_refptr<AtomicGauge<int32_t>> active_threads_gauge;
+
+  // Tracks the maximum number of worker threads. Only used for the metrics
+  // of a pool, not of a token.
+  scoped_refptr<AtomicGauge<int32_t>> max_threads_gauge;
 };
 
 // ThreadPool takes a lot of arguments. We provide sane defaults with a builder.
@@ -110,6 +118,24 @@ struct ThreadPoolMetrics {
 // metrics: Histograms, counters, etc. to update on various threadpool events.
 //    Default: not set.
 //
+// adaptive_sizing: If set, the maximum number of threads adapts to the load
+//    of the pool, between max_threads and 'max_threads_limit'. The maximum is
+//    raised when tasks wait in the queue for longer than 'target_queue_time'
+//    while the system has idle CPU cores, and lowered back when the queue
+//    times are well under the target. Threads above the lowered maximum exit
+//    once idle for idle_timeout.
+//    Default: not set.
+//
+// num_shards: If greater than 1, the pool is split into this many shards,
+//    each with its own queue, lock and share of min_threads, max_threads and
+//    max_queue_size (and of the adaptive sizing limit). Tokens and tokenless
+//    tasks are spread among the shards, and a worker thread whose shard has
+//    no queued tasks runs the tasks queued in the busy shards instead of
+//    going idle. This lets pools with many worker threads scale without
+//    contending on a single lock. The tasks of a SERIAL token are still run
+//    one at a time, in the order they were submitted.
+//    Default: 1.
+//
 class ThreadPoolBuilder {
  public:
   explicit ThreadPoolBuilder(std::string name);
@@ -123,8 +149,11 @@ class ThreadPoolBuilder {
   ThreadPoolBuilder& set_idle_timeout(const MonoDelta& idle_timeout);
   ThreadPoolBuilder& set_queue_overload_threshold(const MonoDelta& threshold);
   ThreadPoolBuilder& set_metrics(ThreadPoolMetrics metrics);
+  ThreadPoolBuilder& set_adaptive_sizing(int max_threads_limit,
+                                         const MonoDelta& target_queue_time);
   ThreadPoolBuilder& set_enable_scheduler();
   ThreadPoolBuilder& set_schedule_period_ms(uint32_t schedule_period_ms);
+  ThreadPoolBuilder& set_num_shards(int num_shards);
 
   // Instantiate a new ThreadPool with the existing builder arguments.
   Status Build(std::unique_ptr<ThreadPool>* pool) const;
@@ -139,8 +168,11 @@ class ThreadPoolBuilder {
   MonoDelta idle_timeout_;
   MonoDelta queue_overload_threshold_;
   ThreadPoolMetrics metrics_;
+  int max_threads_limit_;
+  MonoDelta target_queue_time_;
   bool enable_scheduler_;
   uint32_t schedule_period_ms_;
+  int num_shards_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadPoolBuilder);
 };
@@ -272,10 +304,31 @@ class ThreadPool {
   // Return the number of threads currently running (or in the process of starting up)
   // for this thread pool.
   int num_threads() const {
+    if (!shards_.empty()) {
+      int num = 0;
+      for (const auto& s : shards_) {
+        num += s->num_threads();
+      }
+      return num;
+    }
     MutexLock l(lock_);
     return num_threads_ + num_threads_pending_start_;
   }
 
+  // Return the current maximum number of threads of this thread pool. This
+  // only changes if the pool was built with adaptive sizing.
+  int max_threads() const {
+    if (!shards_.empty()) {
+      int num = 0;
+      for (const auto& s : shards_) {
+        num += s->max_threads();
+      }
+      return num;
+    }
+    MutexLock l(lock_);
+    return max_threads_;
+  }
+
   // Whether the ThreadPool's queue is overloaded. If queue overload threshold
   // isn't set, returns 'false'. Otherwise, returns whether the queue is
   // overloaded. If overloaded, 'overloaded_time' and 'threshold' are both
@@ -287,6 +340,7 @@ class ThreadPool {
   FRIEND_TEST(ThreadPoolTest, TestSimpleTasks);
   FRIEND_TEST(ThreadPoolTest, TestThreadPoolWithNoMinimum);
   FRIEND_TEST(ThreadPoolTest, TestThreadPoolWithSchedulerAndNoMinimum);
+  FRIEND_TEST(ThreadPoolTest, TestShardedPoolStealsTasks);
   FRIEND_TEST(ThreadPoolTest, TestVariableSizeThreadPool);
 
   friend class ThreadPoolBuilder;
@@ -435,6 +489,43 @@ class ThreadPool {
   // Dispatcher responsible for dequeueing and executing the tasks
   void DispatchThread();
 
+  // Dequeues the next task to run, accounting for the calling thread as an
+  // active thread of the pool. The queue must not be empty. Returns true if
+  // ResizeForLoad() is due.
+  bool DequeueTaskUnlocked(ThreadPoolToken** token, Task* task, MonoDelta* queue_time);
+
+  // Runs 'task' of 'token', which waited for 'queue_time' in the queue.
+  //
+  // NOTE: lock_ must not be held.
+  void RunTask(ThreadPoolToken* token, Task* task, const MonoDelta& queue_time);
+
+  // Accounts for the completion of a task of 'token' run by the calling thread.
+  void FinishTaskUnlocked(ThreadPoolToken* token);
+
+  // Runs a task queued in this shard from a worker thread of another shard of
+  // the same pool, unless this shard's own threads are about to run it.
+  // Returns true if a task was run.
+  //
+  // NOTE: lock_ must not be held.
+  bool StealTask();
+
+  // Runs a task queued in a shard other than 'thief'. Returns true if a task
+  // was run.
+  bool StealTaskFromShards(const ThreadPool* thief);
+
+  // Wakes up an idle worker thread of a shard other than 'busy', so that it
+  // steals the tasks queued in 'busy'.
+  void WakeThreadToSteal(const ThreadPool* busy);
+
+  // Wakes up an idle worker thread, if any. Returns true if it did.
+  bool WakeIdleThread();
+
+  // Waits for the pool to reach the idle state, or until '*until' time is
+  // reached if 'until' is not null. Returns true if the pool reached the idle
+  // state, in which case the number of tasks ever submitted to the pool is
+  // stored in 'num_submitted', if not null.
+  bool WaitIdleUntil(const MonoTime* until, int64_t* num_submitted);
+
   // Create new thread.
   //
   // REQUIRES: caller has incremented 'num_threads_pending_start_' ahead of this call.
@@ -466,6 +557,17 @@ class ThreadPool {
   //  * a new task has been scheduled (i.e. added into the queue)
   void NotifyLoadMeterUnlocked(const MonoDelta& queue_time = MonoDelta());
 
+  // Accounts for the queue time of a task dispatched at 'now' for adaptive
+  // sizing. Returns true if ResizeForLoad() is due.
+  bool UpdateAdaptiveSizingUnlocked(const MonoTime& now, const MonoDelta& queue_time);
+
+  // Raises or lowers the maximum number of threads according to the queue
+  // times of the tasks dispatched since the last call, starting a thread if
+  // the maximum was raised and tasks are queued.
+  //
+  // NOTE: lock_ must not be held.
+  void ResizeForLoad();
+
   SchedulerThread* scheduler() {
     return scheduler_;
   }
@@ -476,16 +578,40 @@ class ThreadPool {
   // Return the number of threads currently running for this thread pool.
   // Used by tests to avoid tsan test case down.
   int num_active_threads() {
+    if (!shards_.empty()) {
+      int num = 0;
+      for (const auto& s : shards_) {
+        num += s->num_active_threads();
+      }
+      return num;
+    }
     MutexLock l(lock_);
     return active_threads_;
   }
 
   const std::string name_;
   const int min_threads_;
-  const int max_threads_;
+  // The configured maximum number of threads.
+  const int base_max_threads_;
+  // The limit for the maximum number of threads with adaptive sizing, or 0 if
+  // adaptive sizing is disabled.
+  const int max_threads_limit_;
+  const MonoDelta target_queue_time_;
   const int max_queue_size_;
   const MonoDelta idle_timeout_;
 
+  // The shards of a pool built with more than one shard, each of them a pool
+  // of its own. The tasks of such a pool are queued to, and run by, its
+  // shards only.
+  std::vector<std::unique_ptr<ThreadPool>> shards_;
+
+  // The pool this pool is a shard of, or null.
+  ThreadPool* parent_;
+
+  // The shard to which the next token or tokenless task is assigned, modulo
+  // the number of shards.
+  std::atomic<uint32_t> next_shard_;
+
   // Overall status of the pool. Set to an error when the pool is shut down.
   //
   // Protected by 'lock_'.
@@ -520,12 +646,30 @@ class ThreadPool {
   // Protected by lock_.
   int active_threads_;
 
+  // Current maximum number of threads. Between 'base_max_threads_' and
+  // 'max_threads_limit_' with adaptive sizing, 'base_max_threads_' otherwise.
+  //
+  // Protected by lock_.
+  int max_threads_;
+
+  // The longest queue time of the tasks dispatched since adaptive sizing last
+  // evaluated the load of the pool, and when it did.
+  //
+  // Protected by lock_.
+  MonoDelta max_queue_time_since_resize_;
+  MonoTime last_resize_time_;
+
   // Total number of client tasks queued, either directly (queue_) or
   // indirectly (tokens_).
   //
   // Protected by lock_.
   int total_queued_tasks_;
 
+  // Number of client tasks ever submitted.
+  //
+  // Protected by lock_.
+  int64_t num_submitted_;
+
   // All allocated tokens.
   //
   // Protected by lock_.
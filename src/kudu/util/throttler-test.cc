@@ -73,4 +73,19 @@ TEST_F(ThrottlerTest, TestBurst) {
   ASSERT_FALSE(t0.Take(now, 1, 1));
 }
 
+TEST_F(ThrottlerTest, TestLowRate) {
+  // Rates which refill less than a token per period are still enforced
+  // exactly, rather than rounded.
+  MonoTime now = MonoTime::Now();
+  Throttler t0(now, 5, 0, 1);
+  int num_taken = 0;
+  for (int p = 0; p < 100; p++) {
+    now += MonoDelta::FromMilliseconds(100);
+    while (t0.Take(now, 1, 0)) {
+      num_taken++;
+    }
+  }
+  ASSERT_EQ(50, num_taken);
+}
+
 } // namespace kudu
@@ -22,28 +22,44 @@
 
 namespace kudu {
 
+namespace {
+
+// The maximum number of tokens of a bucket refilled at 'rate' per second.
+// Buckets with a rate hold at least one token, however low the rate.
+uint64_t TokenMax(uint64_t rate, double burst_factor) {
+  if (rate == 0) {
+    return 0;
+  }
+  return std::max<uint64_t>(
+      1, static_cast<uint64_t>(rate * burst_factor / Throttler::kRefillsPerSecond));
+}
+
+} // anonymous namespace
+
 Throttler::Throttler(MonoTime now, uint64_t op_rate, uint64_t byte_rate, double burst_factor) :
     next_refill_(now) {
-  op_refill_ = op_rate / (MonoTime::kMicrosecondsPerSecond / kRefillPeriodMicros);
+  op_rate_ = op_rate;
+  op_credit_ = 0;
   op_token_ = 0;
-  op_token_max_ = static_cast<uint64_t>(op_refill_ * burst_factor);
-  byte_refill_ = byte_rate / (MonoTime::kMicrosecondsPerSecond / kRefillPeriodMicros);
+  op_token_max_ = TokenMax(op_rate, burst_factor);
+  byte_rate_ = byte_rate;
+  byte_credit_ = 0;
   byte_token_ = 0;
-  byte_token_max_ = static_cast<uint64_t>(byte_refill_ * burst_factor);
+  byte_token_max_ = TokenMax(byte_rate, burst_factor);
 }
 
 bool Throttler::Take(MonoTime now, uint64_t op, uint64_t byte) {
-  if (op_refill_ == 0 && byte_refill_ == 0) {
+  if (op_rate_ == 0 && byte_rate_ == 0) {
     return true;
   }
   std::lock_guard<simple_spinlock> lock(lock_);
   Refill(now);
-  if ((op_refill_ == 0 || op <= op_token_) &&
-      (byte_refill_ == 0 || byte <= byte_token_)) {
-    if (op_refill_ > 0) {
+  if ((op_rate_ == 0 || op <= op_token_) &&
+      (byte_rate_ == 0 || byte <= byte_token_)) {
+    if (op_rate_ > 0) {
       op_token_ -= op;
     }
-    if (byte_refill_ > 0) {
+    if (byte_rate_ > 0) {
       byte_token_ -= byte;
     }
     return true;
@@ -58,10 +74,12 @@ void Throttler::Refill(MonoTime now) {
   }
   uint64_t num_period = d / kRefillPeriodMicros + 1;
   next_refill_ += MonoDelta::FromMicroseconds(num_period * kRefillPeriodMicros);
-  op_token_ += num_period * op_refill_;
-  op_token_ = std::min(op_token_, op_token_max_);
-  byte_token_ += num_period * byte_refill_;
-  byte_token_ = std::min(byte_token_, byte_token_max_);
+  op_credit_ += num_period * op_rate_;
+  op_token_ = std::min(op_token_ + op_credit_ / kRefillsPerSecond, op_token_max_);
+  op_credit_ %= kRefillsPerSecond;
+  byte_credit_ += num_period * byte_rate_;
+  byte_token_ = std::min(byte_token_ + byte_credit_ / kRefillsPerSecond, byte_token_max_);
+  byte_credit_ %= kRefillsPerSecond;
 }
 
 } // namespace kudu
@@ -29,7 +29,8 @@ class Throttler {
  public:
   // Refill period is 100ms.
   enum {
-    kRefillPeriodMicros = 100000
+    kRefillPeriodMicros = 100000,
+    kRefillsPerSecond = MonoTime::kMicrosecondsPerSecond / kRefillPeriodMicros
   };
 
   // Construct a throttler with max operation per second, max IO bytes per second
@@ -48,10 +49,15 @@ class Throttler {
   void Refill(MonoTime now);
 
   MonoTime next_refill_;
-  uint64_t op_refill_;
+  uint64_t op_rate_;
+  // The fraction of an operation token refilled so far, in
+  // 1/kRefillsPerSecond units: rates which aren't multiples of
+  // kRefillsPerSecond are refilled exactly over several periods.
+  uint64_t op_credit_;
   uint64_t op_token_;
   uint64_t op_token_max_;
-  uint64_t byte_refill_;
+  uint64_t byte_rate_;
+  uint64_t byte_credit_;
   uint64_t byte_token_;
   uint64_t byte_token_max_;
   simple_spinlock lock_;
@@ -49,6 +49,7 @@
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/trace_context.h"
 #include "kudu/util/trace_metrics.h"
 
 using kudu::debug::TraceLog;
@@ -113,6 +114,45 @@ TEST_F(TraceTest, TestAttach) {
             XOutDigits(traceB->DumpToString(Trace::NO_FLAGS)));
 }
 
+TEST_F(TraceTest, TestTraceContext) {
+  TraceContext root = TraceContext::NewRoot();
+  ASSERT_TRUE(root.IsValid());
+  ASSERT_TRUE(root.sampled);
+  ASSERT_EQ(0, root.parent_span_id);
+
+  TraceContext child = root.NewChild();
+  ASSERT_EQ(root.trace_id_high, child.trace_id_high);
+  ASSERT_EQ(root.trace_id_low, child.trace_id_low);
+  ASSERT_EQ(root.span_id, child.parent_span_id);
+  ASSERT_NE(root.span_id, child.span_id);
+
+  // Round trip through the W3C 'traceparent' representation.
+  const string traceparent = child.ToTraceParent();
+  ASSERT_EQ(55, traceparent.size());
+  TraceContext parsed;
+  ASSERT_TRUE(TraceContext::FromTraceParent(traceparent, &parsed));
+  ASSERT_EQ(child.trace_id_high, parsed.trace_id_high);
+  ASSERT_EQ(child.trace_id_low, parsed.trace_id_low);
+  ASSERT_EQ(child.span_id, parsed.span_id);
+  ASSERT_TRUE(parsed.sampled);
+
+  ASSERT_TRUE(TraceContext::FromTraceParent(
+      "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00", &parsed));
+  ASSERT_EQ(0x4bf92f3577b34da6ULL, parsed.trace_id_high);
+  ASSERT_EQ(0xa3ce929d0e0e4736ULL, parsed.trace_id_low);
+  ASSERT_EQ(0x00f067aa0ba902b7ULL, parsed.span_id);
+  ASSERT_FALSE(parsed.sampled);
+
+  // The all-zero ids are invalid, as are other versions and malformed contexts.
+  ASSERT_FALSE(TraceContext::FromTraceParent(
+      "00-00000000000000000000000000000000-00f067aa0ba902b7-01", &parsed));
+  ASSERT_FALSE(TraceContext::FromTraceParent(
+      "01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01", &parsed));
+  ASSERT_FALSE(TraceContext::FromTraceParent(
+      "00-4bf92f3577b34da6a3ce929d0e0e473x-00f067aa0ba902b7-01", &parsed));
+  ASSERT_FALSE(TraceContext::FromTraceParent("00-4bf92f", &parsed));
+}
+
 TEST_F(TraceTest, TestChildTrace) {
   scoped_refptr<Trace> traceA(new Trace);
   scoped_refptr<Trace> traceB(new Trace);
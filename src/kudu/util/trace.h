@@ -29,6 +29,7 @@
 #include "kudu/gutil/threading/thread_collision_warner.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/trace_context.h"
 #include "kudu/util/trace_metrics.h"
 
 namespace kudu {
@@ -204,6 +205,18 @@ class Trace : public RefCountedThreadSafe<Trace> {
     return metrics_;
   }
 
+  // The context of the distributed trace span this trace belongs to, if
+  // any. Outbound RPCs made by a thread which adopted this trace propagate
+  // the context when it's sampled.
+  //
+  // The context should be set before the trace is shared between threads.
+  const TraceContext& trace_context() const {
+    return trace_context_;
+  }
+  void set_trace_context(const TraceContext& ctx) {
+    trace_context_ = ctx;
+  }
+
  private:
   friend class ScopedAdoptTrace;
   friend class RefCountedThreadSafe<Trace>;
@@ -236,6 +249,8 @@ class Trace : public RefCountedThreadSafe<Trace> {
 
   TraceMetrics metrics_;
 
+  TraceContext trace_context_;
+
   DISALLOW_COPY_AND_ASSIGN(Trace);
 };
 
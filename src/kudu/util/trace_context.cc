@@ -0,0 +1,148 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/trace_context.h"
+
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+
+using std::shared_ptr;
+using std::string;
+
+namespace kudu {
+
+namespace {
+
+ThreadSafeRandom* IdGenerator() {
+  static ThreadSafeRandom* rng = new ThreadSafeRandom(GetRandomSeed32());
+  return rng;
+}
+
+// Returns a random non-zero id.
+uint64_t NewId() {
+  uint64_t id;
+  do {
+    id = IdGenerator()->Next64();
+  } while (id == 0);
+  return id;
+}
+
+// Logs each span exported to it.
+class LoggingTraceSink : public TraceSink {
+ public:
+  void Export(const TraceSpan& span) override {
+    LOG(INFO) << "Trace span " << span.name
+              << (span.kind == TraceSpan::CLIENT ? " (client)" : " (server)")
+              << ": traceparent=" << span.context.ToTraceParent()
+              << " parent_span_id=" << StringPrintf("%016" PRIx64, span.context.parent_span_id)
+              << " peer=" << span.peer
+              << " start_time_unix_us=" << span.start_time_unix_micros
+              << " duration_us=" << span.duration_micros
+              << (span.error.empty() ? "" : " error=") << span.error;
+  }
+};
+
+simple_spinlock sink_lock;
+shared_ptr<TraceSink>* sink = nullptr;
+
+} // anonymous namespace
+
+bool TraceContext::IsValid() const {
+  return (trace_id_high != 0 || trace_id_low != 0) && span_id != 0;
+}
+
+TraceContext TraceContext::NewRoot() {
+  TraceContext ctx;
+  ctx.trace_id_high = NewId();
+  ctx.trace_id_low = NewId();
+  ctx.span_id = NewId();
+  ctx.sampled = true;
+  return ctx;
+}
+
+TraceContext TraceContext::NewChild() const {
+  TraceContext ctx = *this;
+  ctx.parent_span_id = span_id;
+  ctx.span_id = NewId();
+  return ctx;
+}
+
+string TraceContext::ToTraceParent() const {
+  return StringPrintf("00-%016" PRIx64 "%016" PRIx64 "-%016" PRIx64 "-%02x",
+                      trace_id_high, trace_id_low, span_id, sampled ? 1 : 0);
+}
+
+bool TraceContext::FromTraceParent(const string& traceparent, TraceContext* ctx) {
+  // Version 00 is exactly 55 characters long.
+  if (traceparent.size() != 55 || traceparent[2] != '-' || traceparent[35] != '-' ||
+      traceparent[52] != '-' || traceparent.compare(0, 2, "00") != 0) {
+    return false;
+  }
+  for (int i = 3; i < traceparent.size(); i++) {
+    if (i != 35 && i != 52 && !isxdigit(traceparent[i])) {
+      return false;
+    }
+  }
+  TraceContext parsed;
+  unsigned int flags;
+  if (sscanf(traceparent.c_str(), "00-%16" SCNx64 "%16" SCNx64 "-%16" SCNx64 "-%2x",
+             &parsed.trace_id_high, &parsed.trace_id_low, &parsed.span_id, &flags) != 4) {
+    return false;
+  }
+  if (!parsed.IsValid()) {
+    return false;
+  }
+  parsed.sampled = flags & 1;
+  *ctx = parsed;
+  return true;
+}
+
+void SetTraceSink(shared_ptr<TraceSink> new_sink) {
+  std::lock_guard<simple_spinlock> l(sink_lock);
+  if (!sink) {
+    sink = new shared_ptr<TraceSink>();
+  }
+  *sink = std::move(new_sink);
+}
+
+void ExportTraceSpan(const TraceSpan& span) {
+  shared_ptr<TraceSink> s;
+  {
+    std::lock_guard<simple_spinlock> l(sink_lock);
+    if (sink) {
+      s = *sink;
+    }
+  }
+  if (s) {
+    s->Export(span);
+    return;
+  }
+  static LoggingTraceSink* default_sink = new LoggingTraceSink();
+  default_sink->Export(span);
+}
+
+} // namespace kudu
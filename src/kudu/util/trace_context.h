@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace kudu {
+
+// The identity of a span of a distributed trace, following the W3C Trace
+// Context model used by OpenTelemetry: a 128-bit trace id shared by all of
+// the spans of the trace, a 64-bit id of the span itself and the id of its
+// parent span, if any.
+//
+// A context is only propagated (e.g. in the headers of RPCs) when it's
+// sampled, so unsampled requests pay no tracing cost beyond the sampling
+// decision.
+struct TraceContext {
+  uint64_t trace_id_high = 0;
+  uint64_t trace_id_low = 0;
+  uint64_t span_id = 0;
+  // 0 if this is the root span of the trace.
+  uint64_t parent_span_id = 0;
+  bool sampled = false;
+
+  // Whether this identifies a span, i.e. both of its ids are non-zero.
+  bool IsValid() const;
+
+  // Returns a sampled context for the root span of a new trace.
+  static TraceContext NewRoot();
+
+  // Returns the context of a new child span of this span.
+  TraceContext NewChild() const;
+
+  // Returns the W3C 'traceparent' representation of this context:
+  //
+  //   00-<32 hex digits trace id>-<16 hex digits span id>-<2 hex digits flags>
+  std::string ToTraceParent() const;
+
+  // Parses a W3C 'traceparent' into 'ctx'. Returns false if 'traceparent'
+  // is malformed. The parent span id of 'ctx' is left as 0.
+  static bool FromTraceParent(const std::string& traceparent, TraceContext* ctx);
+};
+
+// A finished span of a distributed trace.
+struct TraceSpan {
+  enum Kind {
+    // The caller's side of an RPC.
+    CLIENT,
+    // The callee's side of an RPC.
+    SERVER,
+  };
+
+  TraceContext context;
+  Kind kind;
+  // The name of the operation, e.g. the fully-qualified name of the RPC's method.
+  std::string name;
+  // The address of the remote end of the RPC.
+  std::string peer;
+  int64_t start_time_unix_micros = 0;
+  int64_t duration_micros = 0;
+  // Empty if the operation succeeded.
+  std::string error;
+};
+
+// Receives the spans of sampled traces as they finish, e.g. to export them
+// to an OpenTelemetry collector.
+//
+// Implementations must be thread-safe: spans are exported from the threads
+// finishing them, including RPC reactor threads, so Export() should not
+// block.
+class TraceSink {
+ public:
+  virtual ~TraceSink() = default;
+
+  virtual void Export(const TraceSpan& span) = 0;
+};
+
+// Installs 'sink' as the process-wide trace sink. If 'sink' is null, the
+// default sink, which logs each span, is restored.
+void SetTraceSink(std::shared_ptr<TraceSink> sink);
+
+// Exports 'span' to the process-wide trace sink.
+void ExportTraceSpan(const TraceSpan& span);
+
+} // namespace kudu
@@ -584,6 +584,27 @@ build_lz4() {
   popd
 }
 
+build_zstd() {
+  ZSTD_BDIR=$TP_BUILD_DIR/$ZSTD_NAME$MODE_SUFFIX
+  mkdir -p $ZSTD_BDIR
+  pushd $ZSTD_BDIR
+  rm -Rf CMakeCache.txt CMakeFiles/
+  CFLAGS="$EXTRA_CFLAGS -fPIC" \
+    cmake \
+    -DCMAKE_BUILD_TYPE=release \
+    -DCMAKE_INSTALL_PREFIX:PATH=$PREFIX \
+    -DCMAKE_INSTALL_LIBDIR=lib \
+    -DZSTD_BUILD_PROGRAMS=OFF \
+    -DZSTD_BUILD_SHARED=OFF \
+    -DZSTD_BUILD_STATIC=ON \
+    -DZSTD_BUILD_TESTS=OFF \
+    -DZSTD_MULTITHREAD_SUPPORT=OFF \
+    $EXTRA_CMAKE_FLAGS \
+    $ZSTD_SOURCE/build/cmake
+  ${NINJA:-make} -j$PARALLEL $EXTRA_MAKEFLAGS install
+  popd
+}
+
 build_bitshuffle() {
   BITSHUFFLE_BDIR=$TP_BUILD_DIR/$BITSHUFFLE_NAME$MODE_SUFFIX
   mkdir -p $BITSHUFFLE_BDIR
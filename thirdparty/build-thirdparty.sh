@@ -76,6 +76,7 @@ else
       "gperftools")   F_GPERFTOOLS=1 ;;
       "libev")        F_LIBEV=1 ;;
       "lz4")          F_LZ4=1 ;;
+      "zstd")         F_ZSTD=1 ;;
       "bitshuffle")   F_BITSHUFFLE=1 ;;
       "protobuf")     F_PROTOBUF=1 ;;
       "rapidjson")    F_RAPIDJSON=1 ;;
@@ -309,6 +310,10 @@ if [ -n "$F_UNINSTRUMENTED" -o -n "$F_LZ4" ]; then
   build_lz4
 fi
 
+if [ -n "$F_UNINSTRUMENTED" -o -n "$F_ZSTD" ]; then
+  build_zstd
+fi
+
 if [ -n "$F_UNINSTRUMENTED" -o -n "$F_BITSHUFFLE" ]; then
   build_bitshuffle
 fi
@@ -492,6 +497,10 @@ if [ -n "$F_TSAN" -o -n "$F_LZ4" ]; then
   build_lz4
 fi
 
+if [ -n "$F_TSAN" -o -n "$F_ZSTD" ]; then
+  build_zstd
+fi
+
 if [ -n "$F_TSAN" -o -n "$F_BITSHUFFLE" ]; then
   build_bitshuffle
 fi